@@ -0,0 +1,206 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/program_options.hpp>
+
+#include <heyoka/llvm_state.hpp>
+#include <heyoka/nbody.hpp>
+#include <heyoka/taylor.hpp>
+
+#include "benchmark_harness.hpp"
+
+using namespace heyoka;
+using namespace heyoka_benchmark;
+
+namespace
+{
+
+double median(std::vector<double> v)
+{
+    std::sort(v.begin(), v.end());
+
+    const auto n = v.size();
+
+    return n % 2u == 1u ? v[n / 2u] : (v[n / 2u - 1u] + v[n / 2u]) / 2;
+}
+
+// Initial conditions for the N-body problem (for a single lane): a central
+// body with unit mass, and n - 1 small bodies on quasi-circular orbits
+// with increasing radii.
+std::vector<double> make_init_state(std::uint32_t n)
+{
+    std::vector<double> retval(6u * n);
+
+    for (std::uint32_t i = 1; i < n; ++i) {
+        const auto r = 1. + i;
+        const auto v = std::sqrt(1. / r);
+        const auto phi = 6.283185307179586 * i / n;
+        const auto inc = .01 * i;
+
+        retval[6u * i + 0u] = r * std::cos(phi);
+        retval[6u * i + 1u] = r * std::sin(phi);
+        retval[6u * i + 3u] = -v * std::sin(phi) * std::cos(inc);
+        retval[6u * i + 4u] = v * std::cos(phi) * std::cos(inc);
+        retval[6u * i + 5u] = v * std::sin(inc);
+    }
+
+    return retval;
+}
+
+// Measure the step throughput (in steps per second, summed over the
+// lanes) of the N-body system with n bodies for the given batch sizes,
+// and compare the recommendation of taylor_tune_batch_size() with the
+// best measured batch size.
+void run_system(harness &h, std::uint32_t n, bool cm, double tol, const std::vector<std::uint32_t> &batch_sizes,
+                std::uint32_t n_steps)
+{
+    const auto sys = make_nbody_sys(n, kw::masses = [n]() {
+        std::vector<double> m(n, 1e-5);
+        m[0] = 1;
+        return m;
+    }());
+    const auto init_state = make_init_state(n);
+
+    const auto label = "n=" + std::to_string(n) + ",cm=" + std::to_string(cm);
+
+    double scalar_thr = 0, best_thr = 0;
+    std::uint32_t best_bs = 0;
+
+    for (const auto batch_size : batch_sizes) {
+        const auto bs_state = detail::taylor_replicate_lanes(init_state, batch_size);
+
+        auto ta = taylor_adaptive_batch<double>{sys, bs_state, batch_size, kw::tol = tol, kw::compact_mode = cm};
+
+        const auto blabel = label + ",batch=" + std::to_string(batch_size);
+
+        h.record("object_code_size[" + blabel + "]", "B",
+                 static_cast<double>(ta.get_llvm_state().get_object_code().size()));
+
+        std::vector<double> samples;
+        h.measure("throughput[" + blabel + "]", "steps/s", [&]() {
+            std::copy(bs_state.begin(), bs_state.end(), ta.get_state_data());
+            std::fill(ta.get_time_data(), ta.get_time_data() + batch_size, 0.);
+
+            const auto elapsed = harness::elapsed([&]() {
+                for (std::uint32_t i = 0; i < n_steps; ++i) {
+                    ta.step();
+                }
+            });
+
+            samples.push_back(static_cast<double>(n_steps) * batch_size / elapsed);
+
+            return samples.back();
+        });
+
+        samples.erase(samples.begin(), samples.begin() + static_cast<std::ptrdiff_t>(h.get_n_warmup()));
+        const auto thr = median(samples);
+
+        if (batch_size == 1u) {
+            scalar_thr = thr;
+        }
+        if (thr > best_thr) {
+            best_thr = thr;
+            best_bs = batch_size;
+        }
+    }
+
+    if (scalar_thr > 0) {
+        h.record("best_speedup[" + label + "]", "x", best_thr / scalar_thr);
+    }
+    h.set_param("best_batch_size[" + label + "]", std::to_string(best_bs));
+
+    const auto bt = taylor_tune_batch_size<double>(sys, init_state, kw::tol = tol, kw::compact_mode = cm,
+                                                   kw::max_batch_size = batch_sizes.back());
+    h.set_param("recommended_batch_size[" + label + "]", std::to_string(bt.batch_size));
+}
+
+} // namespace
+
+// Crossover between scalar and batch mode: for N-body systems of increasing size, measure
+// the step throughput (summed over the lanes) for several batch sizes, recording the speedup
+// of the best batch size over the scalar integration (batch size 1). For large systems, the
+// register pressure and the code size eventually offset the gains of the vectorisation. The
+// best batch sizes are compared with the recommendations of taylor_tune_batch_size().
+int main(int argc, char *argv[])
+{
+    namespace po = boost::program_options;
+
+    std::vector<std::uint32_t> n_bodies, batch_sizes;
+    double tol;
+    std::uint32_t n_steps, max_nc_bodies;
+
+    const auto rbs = recommended_batch_size<double>();
+    std::vector<std::uint32_t> def_bs;
+    for (std::uint32_t b = 1; b <= 2u * rbs; b *= 2u) {
+        def_bs.push_back(b);
+    }
+
+    harness h("batch_crossover");
+
+    po::options_description desc("Options");
+
+    desc.add_options()("help", "produce help message")(
+        "n_bodies", po::value(&n_bodies)->multitoken()->default_value({2, 3, 6, 10, 20}, "2 3 6 10 20"),
+        "numbers of bodies")(
+        "batch_sizes", po::value(&batch_sizes)->multitoken()->default_value(def_bs, "powers of 2 up to 2 * SIMD size"),
+        "batch sizes (in increasing order, starting from 1)")(
+        "tol", po::value(&tol)->default_value(1e-15), "tolerance")(
+        "n_steps", po::value(&n_steps)->default_value(1000u), "number of steps for the throughput")(
+        "max_nc_bodies", po::value(&max_nc_bodies)->default_value(10u),
+        "maximum number of bodies in non-compact mode")("no_compact_mode", "do not sweep over compact mode");
+    h.add_options(desc);
+
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    po::notify(vm);
+
+    if (vm.count("help")) {
+        std::cout << desc << "\n";
+        return 0;
+    }
+
+    h.check_options();
+
+    if (batch_sizes.empty() || batch_sizes[0] != 1u || !std::is_sorted(batch_sizes.begin(), batch_sizes.end())) {
+        throw std::invalid_argument("The batch sizes must be in increasing order, starting from 1");
+    }
+    if (std::find_if(n_bodies.begin(), n_bodies.end(), [](auto n) { return n < 2u; }) != n_bodies.end()) {
+        throw std::invalid_argument("The number of bodies must be at least 2");
+    }
+
+    h.set_param("tol", std::to_string(tol));
+    h.set_param("n_steps", std::to_string(n_steps));
+    h.set_param("recommended_simd_batch_size", std::to_string(rbs));
+
+    for (const auto n : n_bodies) {
+        for (auto cm : {false, true}) {
+            // NOTE: the non-compact mode is impractically
+            // slow to compile for large systems.
+            if (!cm && n > max_nc_bodies) {
+                continue;
+            }
+
+            if (cm && vm.count("no_compact_mode")) {
+                continue;
+            }
+
+            run_system(h, n, cm, tol, batch_sizes, n_steps);
+        }
+    }
+
+    h.report();
+}
@@ -0,0 +1,258 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef HEYOKA_BENCHMARK_HARNESS_HPP
+#define HEYOKA_BENCHMARK_HARNESS_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/program_options.hpp>
+
+namespace heyoka_benchmark
+{
+
+// Common harness for the benchmarks, producing machine-readable results.
+//
+// Each metric (e.g., the construction time, the compilation time, the step throughput,
+// the accuracy) is measured via measure(), which invokes a function returning
+// a sample of the metric n_warmup + n_runs times, discarding the warm-up samples.
+// The report contains, for each metric, the median, the 10th/25th/75th/90th percentiles,
+// the min, the max and the mean of the samples, in text, JSON or CSV format.
+// The command-line options of the harness are added via add_options():
+//
+// --n_runs     number of timed runs (defaults to 10),
+// --n_warmup   number of warm-up runs (defaults to 1),
+// --format     output format ('text', 'json' or 'csv', defaults to 'text'),
+// --output     output file (if empty, the report is printed to screen).
+class harness
+{
+    struct metric {
+        std::string name, unit;
+        std::vector<double> samples;
+    };
+
+    std::string m_name;
+    unsigned m_n_runs = 10, m_n_warmup = 1;
+    std::string m_format = "text", m_output;
+    std::vector<std::pair<std::string, std::string>> m_params;
+    std::vector<metric> m_metrics;
+
+    metric &get_metric(const std::string &name, const std::string &unit)
+    {
+        const auto it
+            = std::find_if(m_metrics.begin(), m_metrics.end(), [&name](const auto &m) { return m.name == name; });
+
+        if (it != m_metrics.end()) {
+            if (it->unit != unit) {
+                throw std::invalid_argument("The metric '" + name + "' was recorded with the units '" + it->unit
+                                            + "' and '" + unit + "'");
+            }
+
+            return *it;
+        }
+
+        return m_metrics.emplace_back(metric{name, unit, {}});
+    }
+
+    // Percentile p (in [0, 1]) of the sorted vector v, via linear interpolation.
+    static double percentile(const std::vector<double> &v, double p)
+    {
+        if (v.empty()) {
+            return std::numeric_limits<double>::quiet_NaN();
+        }
+
+        const auto pos = p * static_cast<double>(v.size() - 1u);
+        const auto lo = static_cast<std::size_t>(std::floor(pos));
+        const auto hi = std::min(lo + 1u, v.size() - 1u);
+
+        return v[lo] + (v[hi] - v[lo]) * (pos - static_cast<double>(lo));
+    }
+
+    static std::string json_escape(const std::string &s)
+    {
+        std::string retval;
+
+        for (const auto c : s) {
+            if (c == '"' || c == '\\') {
+                retval += '\\';
+            }
+            retval += c;
+        }
+
+        return retval;
+    }
+
+    void write(std::ostream &os) const
+    {
+        os.precision(std::numeric_limits<double>::max_digits10);
+
+        // The statistics of a metric.
+        auto stats = [](const metric &m) {
+            auto v = m.samples;
+            std::sort(v.begin(), v.end());
+
+            double mean = 0;
+            for (const auto &x : v) {
+                mean += x;
+            }
+            mean /= static_cast<double>(v.size());
+
+            return std::vector<std::pair<const char *, double>>{
+                {"median", percentile(v, .5)}, {"p10", percentile(v, .1)}, {"p25", percentile(v, .25)},
+                {"p75", percentile(v, .75)},   {"p90", percentile(v, .9)}, {"min", v.front()},
+                {"max", v.back()},             {"mean", mean}};
+        };
+
+        if (m_format == "json") {
+            os << "{\n  \"benchmark\": \"" << json_escape(m_name) << "\",\n  \"params\": {";
+            for (decltype(m_params.size()) i = 0; i < m_params.size(); ++i) {
+                os << (i == 0u ? "" : ", ") << '"' << json_escape(m_params[i].first) << "\": \""
+                   << json_escape(m_params[i].second) << '"';
+            }
+            os << "},\n  \"metrics\": [";
+            for (decltype(m_metrics.size()) i = 0; i < m_metrics.size(); ++i) {
+                const auto &m = m_metrics[i];
+
+                os << (i == 0u ? "\n" : ",\n") << "    {\"name\": \"" << json_escape(m.name) << "\", \"unit\": \""
+                   << json_escape(m.unit) << "\", \"n\": " << m.samples.size();
+                for (const auto &[sname, val] : stats(m)) {
+                    os << ", \"" << sname << "\": ";
+                    // NOTE: JSON has no representation for non-finite values.
+                    if (std::isfinite(val)) {
+                        os << val;
+                    } else {
+                        os << "null";
+                    }
+                }
+                os << '}';
+            }
+            os << "\n  ]\n}\n";
+        } else if (m_format == "csv") {
+            os << "benchmark,metric,unit,n,median,p10,p25,p75,p90,min,max,mean\n";
+            for (const auto &m : m_metrics) {
+                os << m_name << ',' << m.name << ',' << m.unit << ',' << m.samples.size();
+                for (const auto &p : stats(m)) {
+                    os << ',' << p.second;
+                }
+                os << '\n';
+            }
+        } else {
+            os << "Benchmark: " << m_name << '\n';
+            for (const auto &[pname, pval] : m_params) {
+                os << "  " << pname << ": " << pval << '\n';
+            }
+            for (const auto &m : m_metrics) {
+                os << m.name << " [" << m.unit << "], " << m.samples.size() << " runs:";
+                for (const auto &[sname, val] : stats(m)) {
+                    os << ' ' << sname << '=' << val;
+                }
+                os << '\n';
+            }
+        }
+    }
+
+public:
+    explicit harness(std::string name) : m_name(std::move(name)) {}
+
+    void add_options(boost::program_options::options_description &desc)
+    {
+        namespace po = boost::program_options;
+
+        desc.add_options()("n_runs", po::value<unsigned>(&m_n_runs)->default_value(10u), "number of timed runs")(
+            "n_warmup", po::value<unsigned>(&m_n_warmup)->default_value(1u), "number of warm-up runs")(
+            "format", po::value<std::string>(&m_format)->default_value("text"),
+            "output format ('text', 'json' or 'csv')")(
+            "output", po::value<std::string>(&m_output)->default_value(""),
+            "output file (if empty, the report is printed to screen)");
+    }
+
+    // Check the options (to be invoked after the parsing of the command line).
+    void check_options() const
+    {
+        if (m_n_runs == 0u) {
+            throw std::invalid_argument("The number of runs of a benchmark cannot be zero");
+        }
+
+        if (m_format != "text" && m_format != "json" && m_format != "csv") {
+            throw std::invalid_argument("Invalid output format for a benchmark: '" + m_format + "'");
+        }
+    }
+
+    unsigned get_n_runs() const
+    {
+        return m_n_runs;
+    }
+    unsigned get_n_warmup() const
+    {
+        return m_n_warmup;
+    }
+
+    // Record a parameter of the benchmark (e.g., the floating-point
+    // type or the batch size) in the report.
+    void set_param(const std::string &name, const std::string &value)
+    {
+        m_params.emplace_back(name, value);
+    }
+
+    // Record a sample of a metric.
+    void record(const std::string &name, const std::string &unit, double value)
+    {
+        get_metric(name, unit).samples.push_back(value);
+    }
+
+    // Invoke f n_warmup + n_runs times, recording the values returned
+    // by the timed runs as samples of the metric name.
+    template <typename F>
+    void measure(const std::string &name, const std::string &unit, F &&f)
+    {
+        for (auto i = 0u; i < m_n_warmup; ++i) {
+            static_cast<void>(f());
+        }
+
+        for (auto i = 0u; i < m_n_runs; ++i) {
+            record(name, unit, static_cast<double>(f()));
+        }
+    }
+
+    // The wall-clock time (in seconds) of an invocation of f.
+    template <typename F>
+    static double elapsed(F &&f)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        f();
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    void report() const
+    {
+        if (m_output.empty()) {
+            write(std::cout);
+        } else {
+            std::ofstream of(m_output, std::ios_base::out | std::ios_base::trunc);
+            if (!of) {
+                throw std::invalid_argument("Cannot open the output file '" + m_output + "'");
+            }
+            write(of);
+        }
+    }
+};
+
+} // namespace heyoka_benchmark
+
+#endif
@@ -0,0 +1,179 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/program_options.hpp>
+
+#include <heyoka/expression.hpp>
+#include <heyoka/llvm_state.hpp>
+#include <heyoka/mascon.hpp>
+#include <heyoka/nbody.hpp>
+#include <heyoka/taylor.hpp>
+
+#include "benchmark_harness.hpp"
+
+#include "data/mascon_67p.hpp"
+#include "data/mascon_bennu.hpp"
+#include "data/mascon_itokawa.hpp"
+
+using namespace heyoka;
+using namespace heyoka_benchmark;
+
+namespace
+{
+
+// Build the integrator via make_ta (taking as input the system built by make_sys),
+// n_warmup + n_runs times, recording the time spent in each stage
+// of the construction, according to the llvm_state statistics.
+template <typename S, typename F>
+void run_stages(harness &h, const std::string &label, S &&make_sys, F &&make_ta)
+{
+    auto rec = [&](const std::string &name, double value) { h.record(name + '[' + label + ']', "s", value); };
+
+    for (auto i = 0u; i < h.get_n_warmup() + h.get_n_runs(); ++i) {
+        std::vector<std::pair<expression, expression>> sys;
+        const auto sys_time = harness::elapsed([&]() { sys = make_sys(); });
+
+        taylor_adaptive<double> ta;
+        const auto tot_time = harness::elapsed([&]() { ta = make_ta(std::move(sys)); });
+
+        if (i < h.get_n_warmup()) {
+            continue;
+        }
+
+        const auto &st = ta.get_llvm_state().stats();
+
+        rec("sys_build_time", sys_time);
+        rec("construction_time", tot_time);
+        // NOTE: the decomposition time includes the CSE and sorting
+        // times, the IR generation time includes the segmentation time.
+        rec("decompose_time", st.decompose_time);
+        rec("cse_time", st.cse_time);
+        rec("sort_time", st.sort_time);
+        rec("segment_time", st.segment_time);
+        rec("ir_gen_time", st.ir_gen_time);
+        rec("opt_time", st.opt_time);
+        rec("codegen_time", st.codegen_time);
+        rec("link_time", st.link_time);
+        h.record("n_ir_instructions[" + label + "]", "instr", static_cast<double>(st.n_ir_instructions));
+        h.record("object_size[" + label + "]", "B", static_cast<double>(st.object_size));
+    }
+}
+
+template <typename P, typename M>
+void run_mascon(harness &h, const std::string &name, const P &points, const M &masses, double wz, bool cm)
+{
+    // Inclined quasi-circular orbit.
+    const auto r0 = 3., incl = 45. / 360 * 6.28;
+    const std::vector<double> ic{r0, 0., 0., 0., std::cos(incl) * std::sqrt(1. / r0) - wz * r0,
+                                 std::sin(incl) * std::sqrt(1. / r0)};
+
+    run_stages(
+        h, "sys=" + name + ",n=" + std::to_string(std::size(masses)) + ",cm=" + std::to_string(cm),
+        [&]() {
+            return make_mascon_system(kw::points = points, kw::masses = masses,
+                                      kw::omega = std::vector<double>{0., 0., wz});
+        },
+        [&](auto sys) {
+            return taylor_adaptive<double>{std::move(sys), ic, kw::compact_mode = cm, kw::tol = 1e-14};
+        });
+}
+
+} // namespace
+
+// Timings of the stages of the construction of the integrators for large systems: the
+// construction of the system, the Taylor decomposition (and its CSE and sorting), the
+// segmentation of the decomposition in compact mode, the IR generation, the optimisation,
+// the codegen and the linking. The systems are N-body problems with increasing numbers
+// of bodies and the mascon models of 67P, Bennu and Itokawa, in compact and non-compact mode.
+int main(int argc, char *argv[])
+{
+    namespace po = boost::program_options;
+
+    std::vector<std::uint32_t> n_bodies;
+    std::uint32_t max_nc_bodies;
+    std::vector<std::string> mascons;
+
+    harness h("compile_stages");
+
+    po::options_description desc("Options");
+
+    desc.add_options()("help", "produce help message")(
+        "n_bodies", po::value(&n_bodies)->multitoken()->default_value({10, 50, 100, 200}, "10 50 100 200"),
+        "numbers of bodies of the N-body systems")(
+        "max_nc_bodies", po::value(&max_nc_bodies)->default_value(50u),
+        "maximum number of bodies for the N-body systems in non-compact mode")(
+        "mascons", po::value(&mascons)->multitoken()->default_value({"67p", "bennu", "itokawa"}, "67p bennu itokawa"),
+        "mascon models ('67p', 'bennu' or 'itokawa')")("mascon_non_compact",
+                                                       "build the mascon systems also in non-compact mode");
+    h.add_options(desc);
+
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    po::notify(vm);
+
+    if (vm.count("help")) {
+        std::cout << desc << "\n";
+        return 0;
+    }
+
+    h.check_options();
+
+    h.set_param("max_nc_bodies", std::to_string(max_nc_bodies));
+
+    for (const auto n : n_bodies) {
+        std::vector<double> init_state(6u * n);
+        std::iota(init_state.begin(), init_state.end(), 1.);
+
+        for (auto cm : {false, true}) {
+            // NOTE: the non-compact mode is impractically
+            // slow for large numbers of bodies.
+            if (!cm && n > max_nc_bodies) {
+                continue;
+            }
+
+            run_stages(
+                h, "sys=nbody,n=" + std::to_string(n) + ",cm=" + std::to_string(cm),
+                [n]() { return make_nbody_sys(n); },
+                [&](auto sys) {
+                    return taylor_adaptive<double>{std::move(sys), init_state, kw::compact_mode = cm};
+                });
+        }
+    }
+
+    // See the mascon_models benchmark for the units
+    // and the angular velocities of the asteroids.
+    for (const auto &m : mascons) {
+        for (auto cm : {false, true}) {
+            if (!cm && !vm.count("mascon_non_compact")) {
+                continue;
+            }
+
+            if (m == "67p") {
+                run_mascon(h, m, mascon_points_67p, mascon_masses_67p, 0.633440278094151, cm);
+            } else if (m == "bennu") {
+                run_mascon(h, m, mascon_points_bennu, mascon_masses_bennu, 1.5633255034258877, cm);
+            } else if (m == "itokawa") {
+                run_mascon(h, m, mascon_points_itokawa, mascon_masses_itokawa, 0.9830980174940738, cm);
+            } else {
+                throw std::invalid_argument("Invalid mascon model: '" + m + "'");
+            }
+        }
+    }
+
+    h.report();
+}
@@ -9,7 +9,9 @@
 #include <chrono>
 #include <iostream>
 #include <random>
+#include <vector>
 
+#include <heyoka/compiled_function.hpp>
 #include <heyoka/expression.hpp>
 #include <heyoka/gp.hpp>
 #include <heyoka/llvm_state.hpp>
@@ -114,30 +116,35 @@ int main()
     duration = duration_cast<microseconds>(stop - start);
     std::cout << "Millions of evaluations per second (tree in batches of 200): "
               << 1. / (static_cast<double>(duration.count()) / N) << "M\n";
-    //
-    // Init the LLVM machinery.
-    // llvm_state s{kw::mname = "optimized"};    //
-    //// 6 - we time the function call from llvm batch
-    // auto func_batch = s.fetch_batch("f");
-    // out = std::vector<double>(10000, 0.12345);
-    // auto llvm_batch_args = random_args_batch(2, 10000);
-    // start = high_resolution_clock::now();
-    // func_batch(out.data(), llvm_batch_args.data());
-    // stop = high_resolution_clock::now();
-    // duration = duration_cast<microseconds>(stop - start);
-    // std::cout << "Millions of evaluations per second (llvm batch 10000): "
-    //          << 1. / (static_cast<double>(duration.count()) / N) << "M\n";
-    //
-    //// 7 - we time the function call from llvm batch (20).
-    // auto g_batch = s.fetch_batch("g");
-    // start = high_resolution_clock::now();
-    // for (auto i = 0u; i < 500u; ++i) {
-    //    g_batch(out.data() + i * 20, llvm_batch_args.data() + 2 * i * 20);
-    //}
-    // stop = high_resolution_clock::now();
-    // duration = duration_cast<microseconds>(stop - start);
-    // std::cout << "Millions of evaluations per second (llvm batch 20): "
-    //          << 1. / (static_cast<double>(duration.count()) / N) << "M\n";
-    //
+
+    //// 6 - we time the compiled function (scalar calls)
+    compiled_function<double> cf{{ex}, kw::vars = {"x"_var, "y"_var}};
+    std::vector<double> point(2);
+    double res = 0;
+    start = high_resolution_clock::now();
+    for (auto &args : args_vv) {
+        point[0] = args[0];
+        point[1] = args[1];
+        cf(&res, point.data());
+    }
+    stop = high_resolution_clock::now();
+    duration = duration_cast<microseconds>(stop - start);
+    std::cout << "Millions of evaluations per second (compiled function): "
+              << 1. / (static_cast<double>(duration.count()) / N) << "M\n";
+
+    //// 7 - we time the compiled function (SIMD batch evaluation)
+    std::vector<double> cf_in(2u * N);
+    for (decltype(args_vv.size()) i = 0u; i < args_vv.size(); ++i) {
+        cf_in[i] = args_vv[i][0];
+        cf_in[N + i] = args_vv[i][1];
+    }
+    out = std::vector<double>(N, 0.12345);
+    start = high_resolution_clock::now();
+    cf.eval_batch(out.data(), cf_in.data(), N);
+    stop = high_resolution_clock::now();
+    duration = duration_cast<microseconds>(stop - start);
+    std::cout << "Millions of evaluations per second (compiled function in one batch, batch size "
+              << cf.get_batch_size() << "): " << 1. / (static_cast<double>(duration.count()) / N) << "M\n";
+
     return 0;
 }
@@ -1,8 +1,11 @@
 #include <chrono>
 #include <iostream>
 #include <random>
+#include <string>
+#include <vector>
 
 #include <heyoka/gp.hpp>
+#include <heyoka/gp_program.hpp>
 #include <heyoka/splitmix64.hpp>
 
 using namespace heyoka;
@@ -57,6 +60,14 @@ int main()
     auto duration = duration_cast<microseconds>(stop - start);
     std::cout << "Millions of expressions generated per second: " << N / static_cast<double>(duration.count()) << "M\n";
 
+    // 1b - The same, generating the whole population in parallel
+    start = high_resolution_clock::now();
+    auto pop = generator.generate_population(N, 2u, 4u);
+    stop = high_resolution_clock::now();
+    duration = duration_cast<microseconds>(stop - start);
+    std::cout << "Millions of expressions generated per second (population): "
+              << N / static_cast<double>(duration.count()) << "M\n";
+
     // 2 - We time the node counter
     start = high_resolution_clock::now();
     for (auto i = 0u; i < N; ++i) {
@@ -99,6 +110,33 @@ int main()
     std::cout << "Millions of crossovers per second (no node count): " << N / static_cast<double>(duration.count()) / 2
               << "M\n";
 
+    // 5b - The same with the programs, in which the subtrees are located in constant time
+    std::vector<gp_program> progs;
+    for (const auto &ex : exs_original) {
+        progs.emplace_back(ex, std::vector<std::string>{"x", "y"});
+    }
+    start = high_resolution_clock::now();
+    for (auto i = 0u; i < N / 2; ++i) {
+        std::size_t n2 = std::uniform_int_distribution<std::size_t>(0, progs[2 * i].size() - 1u)(engine);
+        std::size_t n3 = std::uniform_int_distribution<std::size_t>(0, progs[2 * i + 1].size() - 1u)(engine);
+        crossover(progs[2 * i], progs[2 * i + 1], n2, n3);
+    }
+    stop = high_resolution_clock::now();
+    duration = duration_cast<microseconds>(stop - start);
+    std::cout << "Millions of crossovers per second (programs): " << N / static_cast<double>(duration.count()) / 2
+              << "M\n";
+
+    // 5c - Targeted mutations of the programs
+    start = high_resolution_clock::now();
+    for (auto i = 0u; i < N; ++i) {
+        std::size_t n2 = std::uniform_int_distribution<std::size_t>(0, progs[i].size() - 1u)(engine);
+        mutate(progs[i], n2, generator, 0u, 2u);
+    }
+    stop = high_resolution_clock::now();
+    duration = duration_cast<microseconds>(stop - start);
+    std::cout << "Millions of mutations per second (programs): " << N / static_cast<double>(duration.count())
+              << "M\n";
+
     // 6 - We time the single step of a genetic algorithm, evaluation, crossover over data with 200 points of
     // dimension 3.
     auto data = random_args_vv(200u, 3u);
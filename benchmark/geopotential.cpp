@@ -0,0 +1,85 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include <boost/program_options.hpp>
+
+#include <heyoka/expression.hpp>
+#include <heyoka/geopotential.hpp>
+#include <heyoka/kw.hpp>
+#include <heyoka/taylor.hpp>
+
+// Construction and integration times of a low Earth orbit in a
+// geopotential of given degree and order (with random coefficients
+// decaying as in Kaula's rule), in non-dimensional units.
+
+using namespace heyoka;
+using namespace std::chrono;
+
+int main(int argc, char *argv[])
+{
+    namespace po = boost::program_options;
+
+    std::uint32_t n_max;
+    double final_time;
+
+    po::options_description desc("Options");
+
+    desc.add_options()("help", "produce help message")(
+        "n_max", po::value<std::uint32_t>(&n_max)->default_value(20), "degree and order of the geopotential")(
+        "final_time", po::value<double>(&final_time)->default_value(100.), "final time")("compact_mode",
+                                                                                        "compact mode");
+
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    po::notify(vm);
+
+    if (vm.count("help")) {
+        std::cout << desc << "\n";
+        return 0;
+    }
+
+    // Random coefficients, with C_00 = 1 and C_20 as for the Earth.
+    std::mt19937 rng(42);
+    std::normal_distribution<double> ndist;
+
+    std::vector<double> pars(geopotential_n_pars(n_max));
+    for (std::uint32_t n = 2; n <= n_max; ++n) {
+        for (std::uint32_t m = 0; m <= n; ++m) {
+            const auto idx = geopotential_par_index(n, m);
+            pars[idx] = 1e-5 / (n * n) * ndist(rng);
+            pars[idx + 1u] = m == 0u ? 0. : 1e-5 / (n * n) * ndist(rng);
+        }
+    }
+    pars[geopotential_par_index(0, 0)] = 1;
+    pars[geopotential_par_index(2, 0)] = -4.841651e-4;
+
+    auto [x, y, z, vx, vy, vz] = make_vars("x", "y", "z", "vx", "vy", "vz");
+
+    const auto acc = geopotential_acc(x, y, z, n_max, n_max, 1., 1.);
+
+    auto start = high_resolution_clock::now();
+    taylor_adaptive<double> ta{
+        {prime(x) = vx, prime(y) = vy, prime(z) = vz, prime(vx) = acc[0], prime(vy) = acc[1], prime(vz) = acc[2]},
+        {1.1, 0., 0., 0., .6, .7},
+        kw::pars = pars,
+        kw::compact_mode = vm.count("compact_mode") > 0u};
+    std::cout << "Construction time: " << duration_cast<milliseconds>(high_resolution_clock::now() - start).count()
+              << "ms\n";
+    std::cout << "Size of the decomposition: " << ta.get_decomposition().size() << '\n';
+
+    start = high_resolution_clock::now();
+    ta.propagate_until(final_time);
+    std::cout << "Integration time: " << duration_cast<milliseconds>(high_resolution_clock::now() - start).count()
+              << "ms\n";
+}
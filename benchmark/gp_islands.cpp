@@ -0,0 +1,84 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <boost/program_options.hpp>
+
+#include <heyoka/gp.hpp>
+#include <heyoka/gp_islands.hpp>
+#include <heyoka/splitmix64.hpp>
+
+using namespace heyoka;
+
+// Throughput of the island model (in evaluated individuals per second)
+// as a function of the number of threads, on a symbolic regression
+// problem with one island per hardware thread.
+
+int main(int argc, char *argv[])
+{
+    namespace po = boost::program_options;
+
+    std::size_t n_points, pop_size, n_gens;
+    unsigned n_islands;
+
+    po::options_description desc("Options");
+
+    desc.add_options()("help", "produce help message")(
+        "n_points", po::value<std::size_t>(&n_points)->default_value(1000u), "number of points in the dataset")(
+        "pop_size", po::value<std::size_t>(&pop_size)->default_value(200u), "population size of each island")(
+        "n_gens", po::value<std::size_t>(&n_gens)->default_value(50u), "number of generations")(
+        "n_islands", po::value<unsigned>(&n_islands)->default_value(std::max(1u, std::thread::hardware_concurrency())),
+        "number of islands");
+
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    po::notify(vm);
+
+    if (vm.count("help")) {
+        std::cout << desc << "\n";
+        return 0;
+    }
+
+    // The dataset, generated by x * y + sin(x) - y**2.
+    splitmix64 engine(12345u);
+    std::uniform_real_distribution<double> dist(-1., 1.);
+    std::vector<double> data(2u * n_points), target(n_points);
+    for (auto &v : data) {
+        v = dist(engine);
+    }
+    for (std::size_t i = 0; i < n_points; ++i) {
+        const auto x = data[i], y = data[n_points + i];
+        target[i] = x * y + std::sin(x) - y * y;
+    }
+
+    expression_generator generator({"x", "y"}, engine);
+
+    for (auto n_threads = 1u; n_threads <= n_islands; n_threads *= 2u) {
+        gp_islands isl(generator, data.data(), target.data(), n_points, n_islands, pop_size, 42);
+
+        const auto start = std::chrono::high_resolution_clock::now();
+
+        isl.evolve(n_gens, 10, 2, n_threads);
+
+        const auto elapsed = static_cast<double>(
+            std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - start)
+                .count());
+
+        std::cout << "Threads: " << n_threads << ", individuals per second: "
+                  << static_cast<double>(n_islands * pop_size * n_gens) / elapsed * 1e6
+                  << ", best fitness: " << isl.get_best().second << '\n';
+    }
+}
@@ -0,0 +1,71 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+
+#include <boost/program_options.hpp>
+
+#include <heyoka/llvm_state.hpp>
+#include <heyoka/nbody.hpp>
+#include <heyoka/taylor.hpp>
+
+using namespace heyoka;
+
+// Benchmark for the Taylor decomposition of large ODE systems
+// (N-body systems with many bodies). The timings of the decomposition,
+// of the CSE and of the sorting of the decomposition are reported
+// separately from the IR generation.
+int main(int argc, char *argv[])
+{
+    namespace po = boost::program_options;
+
+    std::uint32_t n_bodies;
+    bool jet = false;
+
+    po::options_description desc("Options");
+
+    desc.add_options()("help", "produce help message")("n", po::value<std::uint32_t>(&n_bodies)->default_value(150),
+                                                       "number of bodies")(
+        "jet", "also generate the IR of the Taylor jet (in compact mode)");
+
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    po::notify(vm);
+
+    if (vm.count("help")) {
+        std::cout << desc << "\n";
+        return 0;
+    }
+
+    if (vm.count("jet")) {
+        jet = true;
+    }
+
+    const auto sys = make_nbody_sys(n_bodies);
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    const auto dc = taylor_decompose(sys);
+
+    auto elapsed = static_cast<double>(
+        std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - start)
+            .count());
+
+    std::cout << "Number of u variables: " << dc.size() << '\n';
+    std::cout << "Decomposition time: " << elapsed << "ms\n";
+
+    if (jet) {
+        llvm_state s;
+
+        taylor_add_jet<double>(s, "jet", sys, 20, 1, false, true);
+
+        std::cout << s.stats() << '\n';
+    }
+}
@@ -0,0 +1,94 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+#include <boost/program_options.hpp>
+
+#include <heyoka/kw.hpp>
+#include <heyoka/mascon.hpp>
+#include <heyoka/taylor.hpp>
+
+#include "data/mascon_67p.hpp"
+
+// Comparison between the full mascon model of 67P and its multipole
+// approximation, for an orbit outside the sphere of radius min_radius.
+
+using namespace heyoka;
+using namespace std::chrono;
+
+int main(int argc, char *argv[])
+{
+    namespace po = boost::program_options;
+
+    double tol, min_radius, r0, final_time;
+
+    po::options_description desc("Options");
+
+    desc.add_options()("help", "produce help message")(
+        "tol", po::value<double>(&tol)->default_value(1e-8), "tolerance of the multipole expansions")(
+        "min_radius", po::value<double>(&min_radius)->default_value(2.), "minimum radius of the orbit")(
+        "r0", po::value<double>(&r0)->default_value(3.), "initial radius of the orbit")(
+        "final_time", po::value<double>(&final_time)->default_value(10.), "final time");
+
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    po::notify(vm);
+
+    if (vm.count("help")) {
+        std::cout << desc << "\n";
+        return 0;
+    }
+
+    // See the mascon_models benchmark for the units.
+    const auto wz = 0.633440278094151;
+    const std::vector<double> omega{0., 0., wz};
+
+    // Circular-like inclined orbit.
+    const auto incl = 45. / 360 * 6.28;
+    const std::vector<double> ic{r0, 0., 0., 0., std::cos(incl) * std::sqrt(1. / r0) - wz * r0,
+                                 std::sin(incl) * std::sqrt(1. / r0)};
+
+    auto start = high_resolution_clock::now();
+    taylor_adaptive<double> ta_full{
+        make_mascon_system(kw::points = mascon_points_67p, kw::masses = mascon_masses_67p, kw::omega = omega), ic,
+        kw::compact_mode = true, kw::tol = 1e-14};
+    std::cout << "Full model, construction time: "
+              << duration_cast<milliseconds>(high_resolution_clock::now() - start).count() << "ms\n";
+
+    start = high_resolution_clock::now();
+    taylor_adaptive<double> ta_mp{make_mascon_multipole_system(kw::points = mascon_points_67p,
+                                                               kw::masses = mascon_masses_67p, kw::omega = omega,
+                                                               kw::tol = tol, kw::min_radius = min_radius),
+                                  ic, kw::compact_mode = true, kw::tol = 1e-14};
+    std::cout << "Multipole model, construction time: "
+              << duration_cast<milliseconds>(high_resolution_clock::now() - start).count() << "ms\n";
+
+    std::cout << "Size of the decompositions: " << ta_full.get_decomposition().size() << " (full) vs "
+              << ta_mp.get_decomposition().size() << " (multipole)\n";
+
+    start = high_resolution_clock::now();
+    ta_full.propagate_until(final_time);
+    std::cout << "Full model, integration time: "
+              << duration_cast<milliseconds>(high_resolution_clock::now() - start).count() << "ms\n";
+
+    start = high_resolution_clock::now();
+    ta_mp.propagate_until(final_time);
+    std::cout << "Multipole model, integration time: "
+              << duration_cast<milliseconds>(high_resolution_clock::now() - start).count() << "ms\n";
+
+    const auto &s_full = ta_full.get_state();
+    const auto &s_mp = ta_mp.get_state();
+    std::cout << "Final position difference: "
+              << std::sqrt((s_full[0] - s_mp[0]) * (s_full[0] - s_mp[0]) + (s_full[1] - s_mp[1]) * (s_full[1] - s_mp[1])
+                           + (s_full[2] - s_mp[2]) * (s_full[2] - s_mp[2]))
+              << '\n';
+}
@@ -9,11 +9,13 @@
 #include <chrono>
 #include <cstdint>
 #include <iostream>
+#include <memory>
 #include <numeric>
 #include <vector>
 
 #include <boost/program_options.hpp>
 
+#include <heyoka/expression_arena.hpp>
 #include <heyoka/nbody.hpp>
 #include <heyoka/taylor.hpp>
 
@@ -26,12 +28,13 @@ int main(int argc, char *argv[])
     std::uint32_t n_bodies;
     bool compact_mode = false;
     bool function_inlining = true;
+    bool use_arena = false;
 
     po::options_description desc("Options");
 
     desc.add_options()("help", "produce help message")("n", po::value<std::uint32_t>(&n_bodies)->default_value(2),
                                                        "number of bodies")("compact_mode", "compact mode")(
-        "disable_inlining", "disable function inlining");
+        "disable_inlining", "disable function inlining")("arena", "allocate the expressions from an arena");
 
     po::variables_map vm;
     po::store(po::parse_command_line(argc, argv, desc), vm);
@@ -50,11 +53,20 @@ int main(int argc, char *argv[])
         function_inlining = false;
     }
 
+    if (vm.count("arena")) {
+        use_arena = true;
+    }
+
     std::vector<double> init_state(6u * n_bodies);
     std::iota(init_state.begin(), init_state.end(), 1.);
 
     auto start = std::chrono::high_resolution_clock::now();
 
+    std::unique_ptr<expression_arena> arena;
+    if (use_arena) {
+        arena = std::make_unique<expression_arena>();
+    }
+
     taylor_adaptive<double> ta{make_nbody_sys(n_bodies), std::move(init_state), kw::high_accuracy = true,
                                kw::compact_mode = compact_mode, kw::inline_functions = function_inlining};
 
@@ -0,0 +1,115 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include <boost/program_options.hpp>
+
+#include <heyoka/nbody.hpp>
+#include <heyoka/nbody_bh.hpp>
+#include <heyoka/taylor.hpp>
+
+using namespace heyoka;
+
+// Comparison of the Barnes-Hut N-body integrator with the exact
+// N-body system (in compact mode), for a random cloud of bodies.
+// The exact integration can be skipped for large n.
+
+namespace
+{
+
+auto elapsed_ms(std::chrono::high_resolution_clock::time_point start)
+{
+    return static_cast<double>(
+        std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - start)
+            .count());
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    namespace po = boost::program_options;
+
+    std::uint32_t n_bodies, leaf_size;
+    double theta, tol, final_time, Gconst;
+
+    po::options_description desc("Options");
+
+    desc.add_options()("help", "produce help message")("n", po::value<std::uint32_t>(&n_bodies)->default_value(1000),
+                                                       "number of bodies")(
+        "theta", po::value<double>(&theta)->default_value(.5), "opening angle")(
+        "leaf_size", po::value<std::uint32_t>(&leaf_size)->default_value(8), "maximum number of bodies in a leaf")(
+        "tol", po::value<double>(&tol)->default_value(1e-10), "tolerance")(
+        "final_time", po::value<double>(&final_time)->default_value(1.), "final time")(
+        "G", po::value<double>(&Gconst)->default_value(1e-3), "gravitational constant")(
+        "skip_exact", "skip the exact integration");
+
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    po::notify(vm);
+
+    if (vm.count("help")) {
+        std::cout << desc << "\n";
+        return 0;
+    }
+
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<double> pdist(-10., 10.), vdist(-.1, .1);
+
+    std::vector<double> init_state(6u * n_bodies);
+    for (std::uint32_t i = 0; i < n_bodies; ++i) {
+        for (auto k = 0u; k < 3u; ++k) {
+            init_state[6u * i + k] = pdist(rng);
+            init_state[6u * i + 3u + k] = vdist(rng);
+        }
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    nbody_bh bh{init_state, kw::theta = theta, kw::leaf_size = leaf_size, kw::tol = tol, kw::Gconst = Gconst};
+
+    std::cout << "Barnes-Hut construction time: " << elapsed_ms(start) << "ms\n";
+
+    start = std::chrono::high_resolution_clock::now();
+    const auto n_steps_bh = bh.propagate_until(final_time);
+
+    std::cout << "Barnes-Hut integration time: " << elapsed_ms(start) << "ms (" << n_steps_bh << " steps, "
+              << bh.get_n_near_pairs() << " near pairs in the last step)\n";
+
+    if (vm.count("skip_exact")) {
+        return 0;
+    }
+
+    start = std::chrono::high_resolution_clock::now();
+
+    taylor_adaptive<double> ta{make_nbody_sys(n_bodies, kw::Gconst = Gconst), init_state, kw::tol = tol,
+                               kw::compact_mode = true};
+
+    std::cout << "Exact construction time: " << elapsed_ms(start) << "ms\n";
+
+    start = std::chrono::high_resolution_clock::now();
+    ta.propagate_until(final_time);
+
+    std::cout << "Exact integration time: " << elapsed_ms(start) << "ms\n";
+
+    double max_diff = 0;
+    for (std::uint32_t i = 0; i < n_bodies; ++i) {
+        for (auto k = 0u; k < 3u; ++k) {
+            max_diff = std::max(max_diff, std::abs(bh.get_state()[6u * i + k] - ta.get_state()[6u * i + k]));
+        }
+    }
+
+    std::cout << "Max position difference: " << max_diff << '\n';
+}
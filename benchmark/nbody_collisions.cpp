@@ -0,0 +1,106 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include <boost/math/constants/constants.hpp>
+#include <boost/program_options.hpp>
+
+#include <heyoka/nbody.hpp>
+#include <heyoka/nbody_collisions.hpp>
+#include <heyoka/taylor.hpp>
+
+// Collision detection in a disk of planetesimals orbiting a central star:
+// cost of the detection with respect to the cost of the steps, and number
+// of candidate pairs from the broad phase.
+
+using namespace heyoka;
+using namespace std::chrono;
+
+int main(int argc, char *argv[])
+{
+    namespace po = boost::program_options;
+
+    std::uint32_t n;
+    std::size_t n_steps;
+    double radius;
+
+    po::options_description desc("Options");
+
+    desc.add_options()("help", "produce help message")(
+        "n", po::value<std::uint32_t>(&n)->default_value(200u), "number of planetesimals")(
+        "n_steps", po::value<std::size_t>(&n_steps)->default_value(100u), "number of steps")(
+        "radius", po::value<double>(&radius)->default_value(1e-3), "radius of the planetesimals");
+
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    po::notify(vm);
+
+    if (vm.count("help")) {
+        std::cout << desc << "\n";
+        return 0;
+    }
+
+    const auto pi = boost::math::constants::pi<double>();
+
+    // Planetesimals on nearly-circular orbits
+    // between 1 and 2 around the star.
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<double> rdist(1., 2.), adist(0., 2 * pi), zdist(-1e-2, 1e-2);
+
+    std::vector<double> masses{1.}, state(6u * (n + 1u)), radii{5e-3};
+    for (std::uint32_t i = 1; i <= n; ++i) {
+        const auto r = rdist(rng), th = adist(rng), v = 1 / std::sqrt(r);
+
+        state[6u * i] = r * std::cos(th);
+        state[6u * i + 1u] = r * std::sin(th);
+        state[6u * i + 2u] = zdist(rng);
+        state[6u * i + 3u] = -v * std::sin(th);
+        state[6u * i + 4u] = v * std::cos(th);
+        state[6u * i + 5u] = zdist(rng);
+
+        masses.push_back(1e-9);
+        radii.push_back(radius);
+    }
+
+    auto start = high_resolution_clock::now();
+    taylor_adaptive<double> ta{make_nbody_sys(n + 1u, kw::masses = masses), state, kw::compact_mode = true};
+    std::cout << "Construction time: " << duration_cast<milliseconds>(high_resolution_clock::now() - start).count()
+              << "ms\n";
+
+    nbody_collision_detector det{radii};
+
+    double step_time = 0, det_time = 0;
+    std::size_t n_cand = 0, n_coll = 0;
+
+    for (std::size_t i = 0; i < n_steps; ++i) {
+        start = high_resolution_clock::now();
+        ta.step(true);
+        step_time += duration_cast<duration<double, std::micro>>(high_resolution_clock::now() - start).count();
+
+        start = high_resolution_clock::now();
+        n_coll += static_cast<std::size_t>(static_cast<bool>(det.detect(ta)));
+        det_time += duration_cast<duration<double, std::micro>>(high_resolution_clock::now() - start).count();
+
+        n_cand += det.get_n_candidates();
+    }
+
+    const auto n_pairs = static_cast<double>(n + 1u) * n / 2;
+
+    std::cout << "Average step time       : " << step_time / static_cast<double>(n_steps) << "us\n";
+    std::cout << "Average detection time  : " << det_time / static_cast<double>(n_steps) << "us\n";
+    std::cout << "Average candidate pairs : " << static_cast<double>(n_cand) / static_cast<double>(n_steps)
+              << " (out of " << n_pairs << ")\n";
+    std::cout << "Steps with collisions   : " << n_coll << '\n';
+}
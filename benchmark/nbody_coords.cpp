@@ -0,0 +1,170 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/program_options.hpp>
+
+#include <heyoka/nbody.hpp>
+#include <heyoka/taylor.hpp>
+
+// Number of steps per simulated Myr in the integration of the outer
+// solar system in barycentric, Jacobi and democratic heliocentric coordinates.
+
+using namespace heyoka;
+
+namespace
+{
+
+const std::vector<double> masses{1.00000597682, 1 / 1047.355, 1 / 3501.6, 1 / 22869., 1 / 19314., 7.4074074e-09};
+
+const auto G = 0.01720209895 * 0.01720209895 * 365 * 365;
+
+double get_energy(const std::vector<double> &s)
+{
+    double kin = 0, pot = 0;
+
+    for (std::size_t i = 0; i < masses.size(); ++i) {
+        kin += masses[i] / 2 * (s[6u * i + 3u] * s[6u * i + 3u] + s[6u * i + 4u] * s[6u * i + 4u]
+                                + s[6u * i + 5u] * s[6u * i + 5u]);
+
+        for (auto j = i + 1u; j < masses.size(); ++j) {
+            const auto dx = s[6u * i] - s[6u * j], dy = s[6u * i + 1u] - s[6u * j + 1u],
+                       dz = s[6u * i + 2u] - s[6u * j + 2u];
+
+            pot -= G * masses[i] * masses[j] / std::sqrt(dx * dx + dy * dy + dz * dz);
+        }
+    }
+
+    return kin + pot;
+}
+
+// Integrate up to final_time, and print the number of steps per Myr
+// and the final relative energy error. to_bary converts the state
+// of the integrator into a barycentric state.
+template <typename F>
+void run_integration(const std::string &name, taylor_adaptive<double> &ta, double final_time, const F &to_bary)
+{
+    const auto init_energy = get_energy(to_bary(ta.get_state()));
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    std::size_t n_steps = 0;
+    while (ta.get_time() < final_time) {
+        const auto [res, h] = ta.step(final_time - ta.get_time());
+        if (res != taylor_outcome::success && res != taylor_outcome::time_limit) {
+            throw std::runtime_error("Error status detected: " + std::to_string(static_cast<int>(res)));
+        }
+        ++n_steps;
+    }
+
+    const auto elapsed = static_cast<double>(
+        std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - start)
+            .count());
+
+    std::cout << name << ":\n";
+    std::cout << "  Steps per Myr     : " << static_cast<double>(n_steps) / final_time * 1E6 << '\n';
+    std::cout << "  Integration time  : " << elapsed << "ms\n";
+    std::cout << "  Final energy error: "
+              << std::abs((init_energy - get_energy(to_bary(ta.get_state()))) / init_energy) << '\n';
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    namespace po = boost::program_options;
+
+    double final_time;
+    bool compact_mode = false;
+
+    po::options_description desc("Options");
+
+    desc.add_options()("help", "produce help message")(
+        "final_time", po::value<double>(&final_time)->default_value(1E5), "simulation end time (in years)")(
+        "compact_mode", "compact mode");
+
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    po::notify(vm);
+
+    if (vm.count("help")) {
+        std::cout << desc << "\n";
+        return 0;
+    }
+
+    if (vm.count("compact_mode")) {
+        compact_mode = true;
+    }
+
+    if (!std::isfinite(final_time) || final_time <= 0) {
+        throw std::invalid_argument("The final time must be finite and positive, but it is "
+                                    + std::to_string(final_time) + " instead");
+    }
+
+    std::vector<double> ic = {// Sun.
+                              -4.06428567034226e-3, -6.08813756435987e-3, -1.66162304225834e-6,
+                              +6.69048890636161e-6 * 365, -6.33922479583593e-6 * 365, -3.13202145590767e-9 * 365,
+                              // Jupiter.
+                              +3.40546614227466e+0, +3.62978190075864e+0, +3.42386261766577e-2,
+                              -5.59797969310664e-3 * 365, +5.51815399480116e-3 * 365, -2.66711392865591e-6 * 365,
+                              // Saturn.
+                              +6.60801554403466e+0, +6.38084674585064e+0, -1.36145963724542e-1,
+                              -4.17354020307064e-3 * 365, +3.99723751748116e-3 * 365, +1.67206320571441e-5 * 365,
+                              // Uranus.
+                              +1.11636331405597e+1, +1.60373479057256e+1, +3.61783279369958e-1,
+                              -3.25884806151064e-3 * 365, +2.06438412905916e-3 * 365, -2.17699042180559e-5 * 365,
+                              // Neptune.
+                              -3.01777243405203e+1, +1.91155314998064e+0, -1.53887595621042e-1,
+                              -2.17471785045538e-4 * 365, -3.11361111025884e-3 * 365, +3.58344705491441e-5 * 365,
+                              // Pluto.
+                              -2.13858977531573e+1, +3.20719104739886e+1, +2.49245689556096e+0,
+                              -1.76936577252484e-3 * 365, -2.06720938381724e-3 * 365, +6.58091931493844e-4 * 365};
+
+    // Move to the barycentric frame.
+    double tot_mass = 0;
+    for (auto m : masses) {
+        tot_mass += m;
+    }
+    for (auto j = 0u; j < 6u; ++j) {
+        double com = 0;
+        for (auto i = 0u; i < 6u; ++i) {
+            com += masses[i] * ic[6u * i + j];
+        }
+        for (auto i = 0u; i < 6u; ++i) {
+            ic[6u * i + j] -= com / tot_mass;
+        }
+    }
+
+    {
+        taylor_adaptive<double> ta{make_nbody_sys(6, kw::masses = masses, kw::Gconst = G), ic,
+                                   kw::high_accuracy = true, kw::compact_mode = compact_mode};
+        run_integration("Barycentric", ta, final_time, [](const auto &s) { return s; });
+    }
+
+    {
+        taylor_adaptive<double> ta{make_nbody_jacobi_sys(6, kw::masses = masses, kw::Gconst = G),
+                                   nbody_to_jacobi(masses, ic), kw::high_accuracy = true,
+                                   kw::compact_mode = compact_mode};
+        run_integration("Jacobi", ta, final_time, [](const auto &s) { return nbody_from_jacobi(masses, s); });
+    }
+
+    {
+        taylor_adaptive<double> ta{make_nbody_dh_sys(6, kw::masses = masses, kw::Gconst = G), nbody_to_dh(masses, ic),
+                                   kw::high_accuracy = true, kw::compact_mode = compact_mode};
+        run_integration("Democratic heliocentric", ta, final_time,
+                        [](const auto &s) { return nbody_from_dh(masses, s); });
+    }
+}
@@ -0,0 +1,121 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include <boost/program_options.hpp>
+
+#include <heyoka/llvm_state.hpp>
+#include <heyoka/nbody.hpp>
+#include <heyoka/taylor.hpp>
+
+using namespace heyoka;
+
+// Comparison of the construction and evaluation times of the N-body
+// jets produced by taylor_add_nbody_jet() (loops over the pairs of bodies)
+// and by taylor_add_jet() on make_nbody_par_sys() in compact mode.
+// The construction of the latter can be skipped for large n.
+
+namespace
+{
+
+auto elapsed_ms(std::chrono::high_resolution_clock::time_point start)
+{
+    return static_cast<double>(
+        std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - start)
+            .count());
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    namespace po = boost::program_options;
+
+    std::uint32_t n_bodies, order, n_evals;
+
+    po::options_description desc("Options");
+
+    desc.add_options()("help", "produce help message")("n", po::value<std::uint32_t>(&n_bodies)->default_value(100),
+                                                       "number of bodies")(
+        "order", po::value<std::uint32_t>(&order)->default_value(20), "Taylor order")(
+        "n_evals", po::value<std::uint32_t>(&n_evals)->default_value(10), "number of jet evaluations")(
+        "skip_sys", "skip the jet built from the N-body expressions");
+
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    po::notify(vm);
+
+    if (vm.count("help")) {
+        std::cout << desc << "\n";
+        return 0;
+    }
+
+    // Bodies on a randomly perturbed line, with random masses.
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<double> dist(-.1, .1), mdist(.5, 1.5);
+
+    std::vector<double> init_state(6u * n_bodies), pars(n_bodies);
+    for (std::uint32_t i = 0; i < n_bodies; ++i) {
+        init_state[6u * i] = i + dist(rng);
+        for (auto k = 1u; k < 6u; ++k) {
+            init_state[6u * i + k] = dist(rng);
+        }
+        pars[i] = mdist(rng);
+    }
+
+    std::vector<double> jet(init_state.size() * (order + 1u));
+    const double time = 0;
+
+    auto run = [&](const char *name, auto add_jet) {
+        auto start = std::chrono::high_resolution_clock::now();
+
+        llvm_state s;
+        add_jet(s);
+        s.compile();
+
+        auto jptr = reinterpret_cast<void (*)(double *, const double *, const double *)>(s.jit_lookup("jet"));
+
+        std::cout << name << " construction time: " << elapsed_ms(start) << "ms\n";
+
+        start = std::chrono::high_resolution_clock::now();
+
+        for (std::uint32_t i = 0; i < n_evals; ++i) {
+            std::copy(init_state.begin(), init_state.end(), jet.begin());
+            jptr(jet.data(), pars.data(), &time);
+        }
+
+        std::cout << name << " evaluation time: " << elapsed_ms(start) / n_evals << "ms\n";
+
+        return jet;
+    };
+
+    const auto jet_loop
+        = run("Loop", [&](llvm_state &s) { taylor_add_nbody_jet<double>(s, "jet", n_bodies, order, 1); });
+
+    if (!vm.count("skip_sys")) {
+        const auto jet_sys = run("Expressions", [&](llvm_state &s) {
+            taylor_add_jet<double>(s, "jet", make_nbody_par_sys(n_bodies), order, 1, false, true);
+        });
+
+        double max_rel_diff = 0;
+        for (decltype(jet.size()) i = 0; i < jet.size(); ++i) {
+            if (jet_sys[i] != 0) {
+                max_rel_diff = std::max(max_rel_diff, std::abs((jet_loop[i] - jet_sys[i]) / jet_sys[i]));
+            }
+        }
+
+        std::cout << "Max relative difference: " << max_rel_diff << '\n';
+    }
+}
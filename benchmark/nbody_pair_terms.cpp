@@ -0,0 +1,171 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <string>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include <boost/program_options.hpp>
+
+#include <heyoka/binary_operator.hpp>
+#include <heyoka/expression.hpp>
+#include <heyoka/func.hpp>
+#include <heyoka/nbody.hpp>
+#include <heyoka/taylor.hpp>
+
+using namespace heyoka;
+
+// Statistics about the Taylor decompositions of the N-body systems, with
+// fixed and par-based masses, in the full and in the restricted problem.
+// For each system, the number of u variables per kind of operation is
+// reported together with the number of interacting pairs of bodies: the
+// r**-3 terms (i.e., the pow() and sum_sq() u variables) must be computed
+// once per interacting pair. The step time is reported as well.
+
+namespace
+{
+
+std::string op_name(const expression &ex)
+{
+    if (const auto bptr = std::get_if<binary_operator>(&ex.value())) {
+        switch (bptr->op()) {
+            case binary_operator::type::add:
+                return "add";
+            case binary_operator::type::sub:
+                return "sub";
+            case binary_operator::type::mul:
+                return "mul";
+            default:
+                return "div";
+        }
+    }
+
+    if (const auto fptr = std::get_if<func>(&ex.value())) {
+        return fptr->get_name();
+    }
+
+    return "variable";
+}
+
+void run(const std::string &name, const std::vector<std::pair<expression, expression>> &sys, std::uint32_t n_bodies,
+         std::uint64_t n_pairs, const std::vector<double> &pars, unsigned n_steps, bool compact_mode)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+
+    const auto dc = taylor_decompose(sys);
+
+    auto elapsed = static_cast<double>(
+        std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - start)
+            .count());
+
+    std::map<std::string, std::uint64_t> counts;
+    for (const auto &p : dc) {
+        ++counts[op_name(p.first)];
+    }
+
+    std::cout << name << ":\n";
+    std::cout << "  Number of u variables: " << dc.size() << '\n';
+    std::cout << "  Number of interacting pairs: " << n_pairs << '\n';
+    for (const auto &[op, c] : counts) {
+        std::cout << "  " << op << ": " << c << '\n';
+    }
+    std::cout << "  r**-3 terms computed once per pair: "
+              << ((counts["pow"] == n_pairs && counts["sum_sq"] == n_pairs) ? "yes" : "NO") << '\n';
+    std::cout << "  Decomposition time: " << elapsed << "ms\n";
+
+    // Initial conditions: the bodies on a line,
+    // with velocities perpendicular to it.
+    std::vector<double> init_state(6u * n_bodies);
+    for (std::uint32_t i = 0; i < n_bodies; ++i) {
+        init_state[6u * i] = i + 1.;
+        init_state[6u * i + 4u] = 1. / std::sqrt(i + 1.);
+    }
+
+    taylor_adaptive<double> ta{sys, std::move(init_state), kw::compact_mode = compact_mode, kw::pars = pars};
+
+    // Warm up.
+    ta.step();
+
+    start = std::chrono::high_resolution_clock::now();
+
+    for (auto i = 0u; i < n_steps; ++i) {
+        ta.step();
+    }
+
+    elapsed = static_cast<double>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - start)
+            .count());
+
+    std::cout << "  Step time: " << elapsed / n_steps << "ns\n";
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    namespace po = boost::program_options;
+
+    std::uint32_t n_bodies, n_massive;
+    unsigned n_steps;
+    bool compact_mode = false;
+
+    po::options_description desc("Options");
+
+    desc.add_options()("help", "produce help message")("n", po::value<std::uint32_t>(&n_bodies)->default_value(10),
+                                                       "number of bodies")(
+        "n_massive", po::value<std::uint32_t>(&n_massive)->default_value(3),
+        "number of massive bodies in the restricted problem")(
+        "n_steps", po::value<unsigned>(&n_steps)->default_value(1000u), "number of timed steps")("compact_mode",
+                                                                                               "compact mode");
+
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    po::notify(vm);
+
+    if (vm.count("help")) {
+        std::cout << desc << "\n";
+        return 0;
+    }
+
+    if (vm.count("compact_mode")) {
+        compact_mode = true;
+    }
+
+    if (n_bodies < 2u || n_massive == 0u || n_massive > n_bodies) {
+        std::cerr << "Invalid number of bodies\n";
+        return 1;
+    }
+
+    // The number of pairs in the full and in the restricted
+    // problem (in which the massless bodies do not interact
+    // with each other).
+    const auto n = static_cast<std::uint64_t>(n_bodies), nm = static_cast<std::uint64_t>(n_massive);
+    const auto n_pairs_full = n * (n - 1u) / 2u;
+    const auto n_pairs_restr = n_pairs_full - (n - nm) * (n - nm - 1u) / 2u;
+
+    // The masses.
+    std::vector<double> masses(n_bodies, 1e-3), masses_restr(n_bodies, 0.);
+    masses[0] = masses_restr[0] = 1.;
+    for (std::uint32_t i = 1; i < n_massive; ++i) {
+        masses_restr[i] = 1e-3;
+    }
+
+    run("Fixed masses", make_nbody_sys(n_bodies, kw::masses = masses), n_bodies, n_pairs_full, {}, n_steps,
+        compact_mode);
+    run("Par masses", make_nbody_par_sys(n_bodies), n_bodies, n_pairs_full, masses, n_steps, compact_mode);
+    run("Fixed masses, restricted", make_nbody_sys(n_bodies, kw::masses = masses_restr), n_bodies, n_pairs_restr, {},
+        n_steps, compact_mode);
+    run("Par masses, restricted", make_nbody_par_sys(n_bodies, kw::n_massive = n_massive), n_bodies, n_pairs_restr,
+        std::vector<double>(masses_restr.begin(), masses_restr.begin() + n_massive), n_steps, compact_mode);
+}
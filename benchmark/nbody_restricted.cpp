@@ -0,0 +1,101 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <utility>
+#include <vector>
+
+#include <boost/math/constants/constants.hpp>
+#include <boost/program_options.hpp>
+
+#include <heyoka/nbody.hpp>
+#include <heyoka/nbody_restricted.hpp>
+
+// Propagation of a large number of test particles in the field
+// of the Sun and of the giant planets.
+
+using namespace heyoka;
+using namespace std::chrono;
+
+int main(int argc, char *argv[])
+{
+    namespace po = boost::program_options;
+
+    std::size_t n_tp;
+    std::uint32_t batch_size;
+    unsigned n_threads;
+    double final_time;
+    bool compact_mode = false;
+
+    po::options_description desc("Options");
+
+    desc.add_options()("help", "produce help message")(
+        "n_tp", po::value<std::size_t>(&n_tp)->default_value(100000ul), "number of test particles")(
+        "batch_size", po::value<std::uint32_t>(&batch_size)->default_value(4u),
+        "batch size of the integrator for the test particles")(
+        "n_threads", po::value<unsigned>(&n_threads)->default_value(0u), "number of threads (0 for all)")(
+        "final_time", po::value<double>(&final_time)->default_value(100.), "simulation end time (in years)")(
+        "compact_mode", "compact mode");
+
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    po::notify(vm);
+
+    if (vm.count("help")) {
+        std::cout << desc << "\n";
+        return 0;
+    }
+
+    if (vm.count("compact_mode")) {
+        compact_mode = true;
+    }
+
+    const auto pi = boost::math::constants::pi<double>();
+    const auto G = 0.01720209895 * 0.01720209895 * 365 * 365;
+
+    // The Sun and the giant planets on their (approximate) orbits.
+    const std::vector<double> masses{1.00000597682, 1 / 1047.355, 1 / 3501.6, 1 / 22869., 1 / 19314.};
+    std::vector<double> massive_state(6u);
+    for (const auto &[i, a] : {std::pair{1u, 5.2}, std::pair{2u, 9.55}, std::pair{3u, 19.2}, std::pair{4u, 30.1}}) {
+        const auto s = oe_to_cartesian(G * (masses[0] + masses[i]), {a, .05, .02, 1. * i, 2. * i, 3. * i});
+        massive_state.insert(massive_state.end(), s.begin(), s.end());
+    }
+
+    // The test particles, in the main asteroid belt.
+    const std::array<std::pair<double, double>, 6> bounds{std::pair{2.1, 3.3},    std::pair{0., .2},
+                                                          std::pair{0., .3},      std::pair{0., 2 * pi},
+                                                          std::pair{0., 2 * pi},  std::pair{0., 2 * pi}};
+    std::vector<double> tp_state;
+    for (std::size_t i = 0; i < n_tp; ++i) {
+        const auto s = random_elliptic_state(G * masses[0], bounds, static_cast<unsigned>(i));
+        tp_state.insert(tp_state.end(), s.begin(), s.end());
+    }
+
+    auto start = high_resolution_clock::now();
+
+    nbody_restricted nr{massive_state,           std::move(tp_state),         kw::masses = masses,
+                        kw::Gconst = G,          kw::batch_size = batch_size, kw::n_threads = n_threads,
+                        kw::compact_mode = compact_mode};
+
+    std::cout << "Construction time: " << duration_cast<milliseconds>(high_resolution_clock::now() - start).count()
+              << "ms\n";
+
+    start = high_resolution_clock::now();
+    const auto n_steps = nr.propagate_until(final_time);
+    const auto elapsed = duration_cast<milliseconds>(high_resolution_clock::now() - start).count();
+
+    std::cout << "Integration time: " << elapsed << "ms\n";
+    std::cout << "Number of steps of the massive bodies: " << n_steps << '\n';
+    std::cout << "Time per test particle per step of the massive bodies: "
+              << static_cast<double>(elapsed) * 1E6 / (static_cast<double>(n_steps) * static_cast<double>(n_tp))
+              << "ns\n";
+}
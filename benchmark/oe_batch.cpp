@@ -0,0 +1,95 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+#include <utility>
+#include <vector>
+
+#include <boost/math/constants/constants.hpp>
+#include <boost/program_options.hpp>
+
+#include <heyoka/nbody.hpp>
+
+// Generation of random elliptic states and conversion into orbital
+// elements, scalar versions vs batch versions.
+
+using namespace heyoka;
+using namespace std::chrono;
+
+int main(int argc, char *argv[])
+{
+    namespace po = boost::program_options;
+
+    std::size_t n;
+    unsigned n_threads;
+
+    po::options_description desc("Options");
+
+    desc.add_options()("help", "produce help message")("n", po::value<std::size_t>(&n)->default_value(1000000ul),
+                                                       "number of states")(
+        "n_threads", po::value<unsigned>(&n_threads)->default_value(0), "number of threads (0 for all)");
+
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    po::notify(vm);
+
+    if (vm.count("help")) {
+        std::cout << desc << "\n";
+        return 0;
+    }
+
+    const auto pi = boost::math::constants::pi<double>();
+    const std::array<std::pair<double, double>, 6> bounds{std::pair{.5, 5.},         std::pair{.01, .9},
+                                                          std::pair{.01, pi - .01},   std::pair{0., 2 * pi},
+                                                          std::pair{0., 2 * pi},      std::pair{0., 2 * pi}};
+
+    // Scalar versions.
+    std::vector<std::array<double, 6>> states(n), oes(n);
+
+    auto start = high_resolution_clock::now();
+    for (std::size_t i = 0; i < n; ++i) {
+        states[i] = random_elliptic_state(1., bounds, static_cast<unsigned>(i));
+    }
+    std::cout << "Scalar generation: " << duration_cast<milliseconds>(high_resolution_clock::now() - start).count()
+              << "ms\n";
+
+    start = high_resolution_clock::now();
+    for (std::size_t i = 0; i < n; ++i) {
+        oes[i] = cartesian_to_oe(1., states[i]);
+    }
+    std::cout << "Scalar conversion: " << duration_cast<milliseconds>(high_resolution_clock::now() - start).count()
+              << "ms\n";
+
+    // Batch versions.
+    std::array<std::vector<double>, 6> st, oe;
+    for (auto j = 0u; j < 6u; ++j) {
+        st[j].resize(n);
+        oe[j].resize(n);
+    }
+    const std::array st_ptrs{st[0].data(), st[1].data(), st[2].data(), st[3].data(), st[4].data(), st[5].data()};
+    const std::array oe_ptrs{oe[0].data(), oe[1].data(), oe[2].data(), oe[3].data(), oe[4].data(), oe[5].data()};
+    const std::array<const double *, 6> st_cptrs{st_ptrs[0], st_ptrs[1], st_ptrs[2],
+                                                 st_ptrs[3], st_ptrs[4], st_ptrs[5]};
+
+    // NOTE: warm up, so that the compilation is not timed.
+    random_elliptic_state_batch(1., bounds, st_ptrs, 1, 42);
+    cartesian_to_oe_batch(1., st_cptrs, oe_ptrs, 1);
+
+    start = high_resolution_clock::now();
+    random_elliptic_state_batch(1., bounds, st_ptrs, n, 42, n_threads);
+    std::cout << "Batch generation: " << duration_cast<milliseconds>(high_resolution_clock::now() - start).count()
+              << "ms\n";
+
+    start = high_resolution_clock::now();
+    cartesian_to_oe_batch(1., st_cptrs, oe_ptrs, n, n_threads);
+    std::cout << "Batch conversion: " << duration_cast<milliseconds>(high_resolution_clock::now() - start).count()
+              << "ms\n";
+}
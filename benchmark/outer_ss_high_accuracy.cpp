@@ -0,0 +1,151 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <heyoka/config.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <initializer_list>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include <boost/program_options.hpp>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <heyoka/nbody.hpp>
+#include <heyoka/taylor.hpp>
+
+#include "benchmark_harness.hpp"
+
+using namespace heyoka;
+using namespace heyoka_benchmark;
+
+// Measure the overhead of the high-accuracy mode on the outer
+// Solar System setup of the outer_ss_long_term benchmark: the step
+// throughput is measured with and without high accuracy,
+// and the ratio of the two is recorded as the overhead.
+template <typename T>
+void run_bench(harness &h, T final_time, bool compact_mode, T tol)
+{
+    const auto masses
+        = std::vector{T(1.00000597682), T(1) / 1047.355, T(1) / 3501.6, T(1) / 22869., T(1) / 19314., T(7.4074074e-09)};
+
+    const auto G = T(0.01720209895) * T(0.01720209895) * 365 * 365;
+
+    const auto sys = make_nbody_sys(6, kw::masses = masses, kw::Gconst = G);
+
+    const auto ic = {// Sun.
+                     -4.06428567034226e-3, -6.08813756435987e-3, -1.66162304225834e-6, +6.69048890636161e-6 * 365,
+                     -6.33922479583593e-6 * 365, -3.13202145590767e-9 * 365,
+                     // Jupiter.
+                     +3.40546614227466e+0, +3.62978190075864e+0, +3.42386261766577e-2, -5.59797969310664e-3 * 365,
+                     +5.51815399480116e-3 * 365, -2.66711392865591e-6 * 365,
+                     // Saturn.
+                     +6.60801554403466e+0, +6.38084674585064e+0, -1.36145963724542e-1, -4.17354020307064e-3 * 365,
+                     +3.99723751748116e-3 * 365, +1.67206320571441e-5 * 365,
+                     // Uranus.
+                     +1.11636331405597e+1, +1.60373479057256e+1, +3.61783279369958e-1, -3.25884806151064e-3 * 365,
+                     +2.06438412905916e-3 * 365, -2.17699042180559e-5 * 365,
+                     // Neptune.
+                     -3.01777243405203e+1, +1.91155314998064e+0, -1.53887595621042e-1, -2.17471785045538e-4 * 365,
+                     -3.11361111025884e-3 * 365, +3.58344705491441e-5 * 365,
+                     // Pluto.
+                     -2.13858977531573e+1, +3.20719104739886e+1, +2.49245689556096e+0, -1.76936577252484e-3 * 365,
+                     -2.06720938381724e-3 * 365, +6.58091931493844e-4 * 365};
+
+    const auto init_state = std::vector<T>(ic.begin(), ic.end());
+
+    // Measure the step throughput of an integrator.
+    auto step_throughput = [&](taylor_adaptive<T> &ta) {
+        ta.set_time(T(0));
+        std::copy(init_state.begin(), init_state.end(), ta.get_state_data());
+
+        auto n_steps = 0.;
+        const auto elapsed
+            = harness::elapsed([&]() { n_steps = static_cast<double>(std::get<3>(ta.propagate_until(final_time))); });
+
+        return n_steps / elapsed;
+    };
+
+    taylor_adaptive<T> ta_normal{sys, init_state, kw::compact_mode = compact_mode, kw::tol = tol};
+    taylor_adaptive<T> ta_ha{sys, init_state, kw::high_accuracy = true, kw::compact_mode = compact_mode, kw::tol = tol};
+
+    double tp_normal = 0, tp_ha = 0;
+
+    h.measure("step_throughput_normal", "steps/s", [&]() { return tp_normal = step_throughput(ta_normal); });
+    h.measure("step_throughput_high_accuracy", "steps/s", [&]() { return tp_ha = step_throughput(ta_ha); });
+
+    h.record("high_accuracy_overhead", "ratio", tp_normal / tp_ha);
+}
+
+int main(int argc, char *argv[])
+{
+    namespace po = boost::program_options;
+
+    std::string fp_type;
+    double final_time, tol;
+    bool compact_mode = false;
+
+    harness h("outer_ss_high_accuracy");
+
+    po::options_description desc("Options");
+
+    desc.add_options()("help", "produce help message")(
+        "fp_type", po::value<std::string>(&fp_type)->default_value("double"), "floating-point type")(
+        "final_time", po::value<double>(&final_time)->default_value(1E4), "simulation end time (in years)")(
+        "compact_mode", "compact mode")("tol", po::value<double>(&tol)->default_value(0.),
+                                        "tolerance (if 0, it will be automatically deduced)");
+    h.add_options(desc);
+
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    po::notify(vm);
+
+    if (vm.count("help")) {
+        std::cout << desc << "\n";
+        return 0;
+    }
+
+    h.check_options();
+
+    if (vm.count("compact_mode")) {
+        compact_mode = true;
+    }
+
+    if (!std::isfinite(final_time) || final_time <= 0) {
+        throw std::invalid_argument("The final time must be finite and positive, but it is "
+                                    + std::to_string(final_time) + " instead");
+    }
+
+    h.set_param("fp_type", fp_type);
+    h.set_param("final_time", std::to_string(final_time));
+    h.set_param("compact_mode", compact_mode ? "true" : "false");
+    h.set_param("tol", std::to_string(tol));
+
+    if (fp_type == "double") {
+        run_bench<double>(h, final_time, compact_mode, tol);
+    } else if (fp_type == "long double") {
+        run_bench<long double>(h, final_time, compact_mode, tol);
+#if defined(HEYOKA_HAVE_REAL128)
+    } else if (fp_type == "real128") {
+        run_bench<mppp::real128>(h, mppp::real128{final_time}, compact_mode, mppp::real128{tol});
+#endif
+    } else {
+        throw std::invalid_argument("Invalid floating-point type: '" + fp_type + "'");
+    }
+
+    h.report();
+}
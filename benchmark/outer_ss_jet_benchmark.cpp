@@ -7,58 +7,88 @@
 // with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
 
 #include <algorithm>
-#include <chrono>
 #include <initializer_list>
 #include <iostream>
 #include <stdexcept>
 #include <string>
 #include <vector>
 
+#include <boost/program_options.hpp>
+
 #include <heyoka/llvm_state.hpp>
 #include <heyoka/nbody.hpp>
 #include <heyoka/taylor.hpp>
 
+#include "benchmark_harness.hpp"
+
 using namespace heyoka;
+using namespace heyoka_benchmark;
 
 int main(int argc, char *argv[])
 {
-    auto batch_size = 1u;
-
-    if (argc > 1) {
-        auto bs = std::stoi(argv[1]);
-        if (bs <= 0) {
-            throw std::invalid_argument("The batch size must be positive, but it is " + std::string(argv[1])
-                                        + " instead");
-        }
-        batch_size = static_cast<unsigned>(bs);
+    namespace po = boost::program_options;
+
+    unsigned batch_size = 0;
+
+    harness h("outer_ss_jet_benchmark");
+
+    po::options_description desc("Options");
+
+    desc.add_options()("help", "produce help message")(
+        "batch_size", po::value<unsigned>(&batch_size)->default_value(1u), "batch size");
+    h.add_options(desc);
+
+    // NOTE: the batch size can also be passed as
+    // a positional argument.
+    po::positional_options_description pdesc;
+    pdesc.add("batch_size", 1);
+
+    po::variables_map vm;
+    po::store(po::command_line_parser(argc, argv).options(desc).positional(pdesc).run(), vm);
+    po::notify(vm);
+
+    if (vm.count("help")) {
+        std::cout << desc << "\n";
+        return 0;
+    }
+
+    h.check_options();
+
+    if (batch_size == 0u) {
+        throw std::invalid_argument("The batch size must be positive");
     }
 
     auto masses = std::vector{1.00000597682, 1. / 1047.355, 1. / 3501.6, 1. / 22869., 1. / 19314., 7.4074074e-09};
 
     const auto G = 0.01720209895 * 0.01720209895;
 
-    auto sys = make_nbody_sys(6, kw::masses = masses, kw::Gconst = G);
-
-    llvm_state s;
+    const auto sys = make_nbody_sys(6, kw::masses = masses, kw::Gconst = G);
 
     const auto order = 20u;
 
-    auto start = std::chrono::high_resolution_clock::now();
+    h.set_param("batch_size", std::to_string(batch_size));
+    h.set_param("order", std::to_string(order));
 
-    taylor_add_jet<double>(s, "jet", std::move(sys), order, batch_size, false, false);
+    auto make_jet = [&](llvm_state &s) {
+        taylor_add_jet<double>(s, "jet", sys, order, batch_size, false, false);
 
-    // std::cout << s.get_ir() << '\n';
-    // s.dump_object_code("tjb.o");
+        s.compile();
 
-    s.compile();
+        return reinterpret_cast<void (*)(double *, const double *, const double *)>(s.jit_lookup("jet"));
+    };
 
-    auto jet_ptr = reinterpret_cast<void (*)(double *, const double *, const double *)>(s.jit_lookup("jet"));
+    h.measure("construction_time", "s", [&]() {
+        return harness::elapsed([&]() {
+            llvm_state s;
+            make_jet(s);
+        });
+    });
 
-    auto elapsed = static_cast<double>(
-        std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - start)
-            .count());
+    llvm_state s;
 
-    std::cout << "Construction time: " << elapsed << "μs\n";
+    auto jet_ptr = make_jet(s);
+
+    h.record("compile_time", "s", s.get_optimise_time() + s.get_compile_time());
 
     std::vector<double> jet(36u * (order + 1u) * batch_size);
     auto ic = {// Sun.
@@ -83,29 +113,25 @@ int main(int argc, char *argv[])
 
     auto ptr = jet.data();
 
-    // Warm up.
-    jet_ptr(ptr, nullptr, nullptr);
-
-    start = std::chrono::high_resolution_clock::now();
-
-    // Do 400 evaluations.
-    for (auto i = 0; i < 40; ++i) {
-        jet_ptr(ptr, nullptr, nullptr);
-        jet_ptr(ptr, nullptr, nullptr);
-        jet_ptr(ptr, nullptr, nullptr);
-        jet_ptr(ptr, nullptr, nullptr);
-        jet_ptr(ptr, nullptr, nullptr);
-        jet_ptr(ptr, nullptr, nullptr);
-        jet_ptr(ptr, nullptr, nullptr);
-        jet_ptr(ptr, nullptr, nullptr);
-        jet_ptr(ptr, nullptr, nullptr);
-    }
-
-    elapsed = static_cast<double>(
-        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - start)
-            .count());
-
-    std::cout << "Order " << order << ", batch size " << batch_size << ": " << elapsed / 400 << "ns\n";
+    // NOTE: each run does 360 evaluations, and the
+    // time per evaluation is recorded.
+    h.measure("jet_time", "ns", [&]() {
+        return harness::elapsed([&]() {
+            for (auto i = 0; i < 40; ++i) {
+                jet_ptr(ptr, nullptr, nullptr);
+                jet_ptr(ptr, nullptr, nullptr);
+                jet_ptr(ptr, nullptr, nullptr);
+                jet_ptr(ptr, nullptr, nullptr);
+                jet_ptr(ptr, nullptr, nullptr);
+                jet_ptr(ptr, nullptr, nullptr);
+                jet_ptr(ptr, nullptr, nullptr);
+                jet_ptr(ptr, nullptr, nullptr);
+                jet_ptr(ptr, nullptr, nullptr);
+            }
+        }) / 360 * 1e9;
+    });
+
+    h.report();
 
     return 0;
 }
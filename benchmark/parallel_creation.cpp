@@ -0,0 +1,95 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <numeric>
+#include <thread>
+#include <vector>
+
+#include <boost/program_options.hpp>
+
+#include <heyoka/nbody.hpp>
+#include <heyoka/taylor.hpp>
+
+using namespace heyoka;
+
+// Throughput of the concurrent construction of
+// integrators, as a function of the number of threads.
+int main(int argc, char *argv[])
+{
+    namespace po = boost::program_options;
+
+    std::uint32_t n_bodies;
+    unsigned n_iters, max_threads;
+    bool compact_mode = false;
+
+    po::options_description desc("Options");
+
+    desc.add_options()("help", "produce help message")("n", po::value<std::uint32_t>(&n_bodies)->default_value(3),
+                                                       "number of bodies")(
+        "iters", po::value<unsigned>(&n_iters)->default_value(4), "number of integrators built by each thread")(
+        "max_threads", po::value<unsigned>(&max_threads)->default_value(std::thread::hardware_concurrency()),
+        "maximum number of threads")("compact_mode", "compact mode");
+
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    po::notify(vm);
+
+    if (vm.count("help")) {
+        std::cout << desc << "\n";
+        return 0;
+    }
+
+    if (vm.count("compact_mode")) {
+        compact_mode = true;
+    }
+
+    max_threads = std::max(max_threads, 1u);
+
+    const auto sys = make_nbody_sys(n_bodies);
+
+    std::vector<double> init_state(6u * n_bodies);
+    std::iota(init_state.begin(), init_state.end(), 1.);
+
+    double base_throughput = 0;
+
+    for (auto n_threads = 1u; n_threads <= max_threads; n_threads *= 2u) {
+        std::vector<std::thread> threads;
+
+        auto start = std::chrono::high_resolution_clock::now();
+
+        for (auto i = 0u; i < n_threads; ++i) {
+            threads.emplace_back([&]() {
+                for (auto j = 0u; j < n_iters; ++j) {
+                    taylor_adaptive<double> ta{sys, init_state, kw::compact_mode = compact_mode};
+                }
+            });
+        }
+
+        for (auto &t : threads) {
+            t.join();
+        }
+
+        auto elapsed = static_cast<double>(
+            std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - start)
+                .count());
+
+        // Integrators built per second.
+        const auto throughput = n_threads * n_iters / (elapsed / 1e6);
+
+        if (n_threads == 1u) {
+            base_throughput = throughput;
+        }
+
+        std::cout << "Threads: " << n_threads << ", throughput: " << throughput
+                  << " integrators/s, scaling: " << throughput / base_throughput << '\n';
+    }
+}
@@ -0,0 +1,177 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/program_options.hpp>
+
+#include <heyoka/expression.hpp>
+#include <heyoka/kw.hpp>
+#include <heyoka/mascon.hpp>
+#include <heyoka/polyhedral.hpp>
+#include <heyoka/taylor.hpp>
+
+// Comparison between the polyhedral gravity model and the mascon model of
+// a triaxial ellipsoid with semi-axes (1, .7, .5) and unitary density. The
+// polyhedron is a latitude-longitude mesh of the surface, while the mascons
+// are placed on a regular grid inside the ellipsoid.
+// NOTE: the mascon models in the data directory do not come with the
+// corresponding surface meshes, hence the synthetic body.
+
+using namespace heyoka;
+using namespace std::chrono;
+
+namespace
+{
+
+constexpr double ell_a = 1, ell_b = .7, ell_c = .5;
+
+// Latitude-longitude mesh of the ellipsoid, with n_lat bands
+// and n_lon sectors.
+auto make_mesh(std::uint32_t n_lat, std::uint32_t n_lon)
+{
+    const auto pi = std::acos(-1.);
+
+    std::vector<std::array<double, 3>> vertices;
+    std::vector<std::array<std::uint32_t, 3>> faces;
+
+    // The poles.
+    vertices.push_back({0., 0., ell_c});
+    vertices.push_back({0., 0., -ell_c});
+
+    for (std::uint32_t i = 1; i < n_lat; ++i) {
+        const auto theta = pi * i / n_lat;
+        for (std::uint32_t j = 0; j < n_lon; ++j) {
+            const auto phi = 2 * pi * j / n_lon;
+            vertices.push_back({ell_a * std::sin(theta) * std::cos(phi), ell_b * std::sin(theta) * std::sin(phi),
+                                ell_c * std::cos(theta)});
+        }
+    }
+
+    // Index of the j-th vertex of the i-th ring (i = 1, ..., n_lat - 1).
+    auto vidx = [n_lon](std::uint32_t i, std::uint32_t j) { return 2u + (i - 1u) * n_lon + j % n_lon; };
+
+    for (std::uint32_t j = 0; j < n_lon; ++j) {
+        faces.push_back({0, vidx(1, j), vidx(1, j + 1u)});
+        faces.push_back({1, vidx(n_lat - 1u, j + 1u), vidx(n_lat - 1u, j)});
+    }
+
+    for (std::uint32_t i = 1; i + 1u < n_lat; ++i) {
+        for (std::uint32_t j = 0; j < n_lon; ++j) {
+            faces.push_back({vidx(i, j), vidx(i + 1u, j), vidx(i + 1u, j + 1u)});
+            faces.push_back({vidx(i, j), vidx(i + 1u, j + 1u), vidx(i, j + 1u)});
+        }
+    }
+
+    return std::make_pair(vertices, faces);
+}
+
+// Mascons on a regular grid with n points along the major axis.
+auto make_mascons(std::uint32_t n)
+{
+    std::vector<std::vector<double>> points;
+    std::vector<double> masses;
+
+    const auto h = 2 * ell_a / n;
+    for (std::uint32_t i = 0; i < n; ++i) {
+        for (std::uint32_t j = 0; j < n; ++j) {
+            for (std::uint32_t k = 0; k < n; ++k) {
+                const auto x = -ell_a + h * (i + .5), y = -ell_a + h * (j + .5), z = -ell_a + h * (k + .5);
+
+                if (x * x / (ell_a * ell_a) + y * y / (ell_b * ell_b) + z * z / (ell_c * ell_c) <= 1) {
+                    points.push_back({x, y, z});
+                    masses.push_back(h * h * h);
+                }
+            }
+        }
+    }
+
+    return std::make_pair(points, masses);
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    namespace po = boost::program_options;
+
+    std::uint32_t n_lat, n_lon, n_grid;
+    double r0, final_time;
+
+    po::options_description desc("Options");
+
+    desc.add_options()("help", "produce help message")(
+        "n_lat", po::value<std::uint32_t>(&n_lat)->default_value(20), "number of latitude bands of the mesh")(
+        "n_lon", po::value<std::uint32_t>(&n_lon)->default_value(40), "number of longitude sectors of the mesh")(
+        "n_grid", po::value<std::uint32_t>(&n_grid)->default_value(30), "size of the grid of the mascons")(
+        "r0", po::value<double>(&r0)->default_value(1.5), "initial radius of the orbit")(
+        "final_time", po::value<double>(&final_time)->default_value(10.), "final time");
+
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    po::notify(vm);
+
+    if (vm.count("help")) {
+        std::cout << desc << "\n";
+        return 0;
+    }
+
+    const auto [vertices, faces] = make_mesh(n_lat, n_lon);
+    const auto [points, masses] = make_mascons(n_grid);
+
+    std::cout << "Polyhedron: " << vertices.size() << " vertices, " << faces.size() << " faces\n";
+    std::cout << "Mascon model: " << points.size() << " points\n";
+
+    const std::vector<double> omega{0., 0., .5};
+    const auto mass = 4. / 3 * std::acos(-1.) * ell_a * ell_b * ell_c;
+    const std::vector<double> ic{r0, 0., 0., 0., std::sqrt(mass / r0) - omega[2] * r0, 0.};
+
+    auto poly_sys = make_polyhedral_system(kw::vertices = vertices, kw::faces = faces, kw::omega = omega);
+    auto masc_sys = make_mascon_system(kw::points = points, kw::masses = masses, kw::omega = omega);
+
+    // Compare the accelerations at the initial conditions.
+    const std::unordered_map<std::string, double> map{{"x", ic[0]},  {"y", ic[1]},  {"z", ic[2]},
+                                                      {"vx", ic[3]}, {"vy", ic[4]}, {"vz", ic[5]}};
+    std::cout << "Initial x acceleration: " << eval_dbl(poly_sys[3].second, map) << " (polyhedral) vs "
+              << eval_dbl(masc_sys[3].second, map) << " (mascon)\n";
+
+    auto start = high_resolution_clock::now();
+    taylor_adaptive<double> ta_poly{poly_sys, ic, kw::compact_mode = true, kw::tol = 1e-14};
+    std::cout << "Polyhedral model, construction time: "
+              << duration_cast<milliseconds>(high_resolution_clock::now() - start).count() << "ms\n";
+
+    start = high_resolution_clock::now();
+    taylor_adaptive<double> ta_masc{masc_sys, ic, kw::compact_mode = true, kw::tol = 1e-14};
+    std::cout << "Mascon model, construction time: "
+              << duration_cast<milliseconds>(high_resolution_clock::now() - start).count() << "ms\n";
+
+    start = high_resolution_clock::now();
+    ta_poly.propagate_until(final_time);
+    std::cout << "Polyhedral model, integration time: "
+              << duration_cast<milliseconds>(high_resolution_clock::now() - start).count() << "ms\n";
+
+    start = high_resolution_clock::now();
+    ta_masc.propagate_until(final_time);
+    std::cout << "Mascon model, integration time: "
+              << duration_cast<milliseconds>(high_resolution_clock::now() - start).count() << "ms\n";
+
+    const auto &s_poly = ta_poly.get_state();
+    const auto &s_masc = ta_masc.get_state();
+    std::cout << "Final position difference: "
+              << std::sqrt((s_poly[0] - s_masc[0]) * (s_poly[0] - s_masc[0])
+                           + (s_poly[1] - s_masc[1]) * (s_poly[1] - s_masc[1])
+                           + (s_poly[2] - s_masc[2]) * (s_poly[2] - s_masc[2]))
+              << '\n';
+}
@@ -0,0 +1,351 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <boost/program_options.hpp>
+
+#if defined(__linux__)
+
+#include <unistd.h>
+
+#endif
+
+#include <heyoka/ensemble_propagate.hpp>
+#include <heyoka/nbody.hpp>
+#include <heyoka/taylor.hpp>
+
+#include "benchmark_harness.hpp"
+
+using namespace heyoka;
+using namespace heyoka_benchmark;
+
+namespace
+{
+
+// The resident set size of the process (in bytes), if available.
+std::optional<double> get_rss()
+{
+#if defined(__linux__)
+    std::ifstream ifs("/proc/self/statm");
+
+    double size = 0, resident = 0;
+    if (ifs >> size >> resident) {
+        return resident * static_cast<double>(::sysconf(_SC_PAGESIZE));
+    }
+#endif
+
+    return {};
+}
+
+double median(std::vector<double> v)
+{
+    std::sort(v.begin(), v.end());
+
+    const auto n = v.size();
+
+    return n % 2u == 1u ? v[n / 2u] : (v[n / 2u - 1u] + v[n / 2u]) / 2;
+}
+
+// Initial conditions for the N-body problem: a central body with unit mass,
+// and n - 1 small bodies on quasi-circular orbits with increasing radii. The
+// state of each batch lane is slightly perturbed.
+std::vector<double> make_init_state(std::uint32_t n, std::uint32_t batch_size)
+{
+    std::vector<double> retval(6u * n * batch_size);
+
+    for (std::uint32_t i = 1; i < n; ++i) {
+        const auto r = 1. + i;
+        const auto v = std::sqrt(1. / r);
+        const auto phi = 6.283185307179586 * i / n;
+        const auto inc = .01 * i;
+
+        const double s[] = {r * std::cos(phi),
+                            r * std::sin(phi),
+                            0.,
+                            -v * std::sin(phi) * std::cos(inc),
+                            v * std::cos(phi) * std::cos(inc),
+                            v * std::sin(inc)};
+
+        for (std::uint32_t j = 0; j < 6u; ++j) {
+            for (std::uint32_t k = 0; k < batch_size; ++k) {
+                retval[(6u * i + j) * batch_size + k] = s[j] * (1 + 1e-6 * k);
+            }
+        }
+    }
+
+    return retval;
+}
+
+struct config {
+    std::uint32_t n_bodies;
+    double tol;
+    std::uint32_t batch_size;
+    bool compact_mode, high_accuracy;
+};
+
+struct sweep_opts {
+    std::uint32_t n_steps;
+    std::size_t n_iter;
+    double ens_time;
+    std::vector<unsigned> threads;
+};
+
+template <typename Ta>
+void run_ensemble(harness &h, const Ta &ta, const std::string &label, const sweep_opts &so)
+{
+    // The throughput (in steps per second), recorded for each number of threads.
+    std::vector<std::pair<unsigned, double>> thr;
+
+    for (const auto n_threads : so.threads) {
+        const auto tlabel = label + ",threads=" + std::to_string(n_threads);
+        const auto name = "ensemble_throughput[" + tlabel + "]";
+
+        std::vector<double> samples;
+
+        h.measure(name, "steps/s", [&]() {
+            double n_steps = 0;
+
+            const auto elapsed = harness::elapsed([&]() {
+                if constexpr (std::is_same_v<Ta, taylor_adaptive<double>>) {
+                    const auto res = ensemble_propagate_until<double>(
+                        ta, so.ens_time, so.n_iter,
+                        [](taylor_adaptive<double> &t, std::size_t i) {
+                            t.get_state_data()[6] *= 1 + 1e-8 * static_cast<double>(i);
+                        },
+                        0, n_threads);
+
+                    for (const auto &r : res) {
+                        n_steps += static_cast<double>(std::get<3>(r));
+                    }
+                } else {
+                    const auto batch_size = ta.get_batch_size();
+
+                    const auto res = ensemble_propagate_until_batch<double>(
+                        ta, so.ens_time, so.n_iter,
+                        [batch_size](taylor_adaptive_batch<double> &t, std::uint32_t slot, std::size_t i) {
+                            t.get_state_data()[6u * batch_size + slot] *= 1 + 1e-8 * static_cast<double>(i);
+                        },
+                        0, n_threads);
+
+                    for (const auto &r : res) {
+                        n_steps += static_cast<double>(std::get<3>(r));
+                    }
+                }
+            });
+
+            samples.push_back(n_steps / elapsed);
+
+            return samples.back();
+        });
+
+        // NOTE: the warm-up samples are included in samples,
+        // skip them in the computation of the median.
+        samples.erase(samples.begin(), samples.begin() + static_cast<std::ptrdiff_t>(h.get_n_warmup()));
+        thr.emplace_back(n_threads, median(samples));
+    }
+
+    // Speedup and parallel efficiency with respect to the
+    // smallest number of threads in the sweep.
+    if (!thr.empty()) {
+        const auto [base_threads, base_thr] = thr.front();
+
+        for (const auto &[n_threads, t] : thr) {
+            const auto speedup = t / base_thr;
+            const auto tlabel = label + ",threads=" + std::to_string(n_threads);
+
+            h.record("ensemble_speedup[" + tlabel + "]", "x", speedup);
+            h.record("ensemble_efficiency[" + tlabel + "]", "rel",
+                     speedup * static_cast<double>(base_threads) / static_cast<double>(n_threads));
+        }
+    }
+}
+
+template <typename Ta>
+void run_config(harness &h, const config &c, const sweep_opts &so)
+{
+    const auto sys = make_nbody_sys(c.n_bodies, kw::masses = [&c]() {
+        std::vector<double> m(c.n_bodies, 1e-5);
+        m[0] = 1;
+        return m;
+    }());
+
+    const auto init_state = make_init_state(c.n_bodies, c.batch_size);
+
+    auto make_ta = [&]() {
+        if constexpr (std::is_same_v<Ta, taylor_adaptive<double>>) {
+            return Ta{sys, init_state, kw::tol = c.tol, kw::compact_mode = c.compact_mode,
+                      kw::high_accuracy = c.high_accuracy};
+        } else {
+            return Ta{sys,
+                      init_state,
+                      c.batch_size,
+                      kw::tol = c.tol,
+                      kw::compact_mode = c.compact_mode,
+                      kw::high_accuracy = c.high_accuracy};
+        }
+    };
+
+    // Memory footprint: the resident set size increase due to the construction
+    // of the first integrator of the configuration (including the JIT session
+    // and the compiled code), the size of the object code and the size of the
+    // buffer of the Taylor coefficients.
+    const auto rss0 = get_rss();
+    auto ta = make_ta();
+    const auto rss1 = get_rss();
+
+    std::ostringstream oss;
+    oss << "n=" << c.n_bodies << ",order=" << ta.get_order() << ",batch=" << c.batch_size
+        << ",cm=" << c.compact_mode << ",ha=" << c.high_accuracy;
+    const auto label = oss.str();
+
+    if (rss0 && rss1) {
+        h.record("rss_increase[" + label + "]", "B", std::max(0., *rss1 - *rss0));
+    }
+    h.record("object_code_size[" + label + "]", "B", static_cast<double>(ta.get_llvm_state().get_object_code().size()));
+    h.record("tc_size[" + label + "]", "B", static_cast<double>(ta.get_tc().size() * sizeof(double)));
+
+    h.record("compile_time[" + label + "]", "s",
+             ta.get_llvm_state().get_optimise_time() + ta.get_llvm_state().get_compile_time());
+    h.measure("construction_time[" + label + "]", "s", [&]() { return harness::elapsed(make_ta); });
+
+    // Step throughput: the number of steps (per lane) per second.
+    auto ta_step = ta;
+    h.measure("step_throughput[" + label + "]", "steps/s", [&]() {
+        std::copy(init_state.begin(), init_state.end(), ta_step.get_state_data());
+
+        const auto elapsed = harness::elapsed([&]() {
+            for (std::uint32_t i = 0; i < so.n_steps; ++i) {
+                ta_step.step();
+            }
+        });
+
+        return static_cast<double>(so.n_steps) * c.batch_size / elapsed;
+    });
+
+    run_ensemble(h, ta, label, so);
+}
+
+} // namespace
+
+// Scaling benchmark suite: sweep the number of bodies, the Taylor order (via the tolerance),
+// the batch size, compact mode, high accuracy mode and (for the ensemble propagation) the
+// number of threads, recording for each configuration the construction and compilation
+// times, the memory footprint, the step throughput and the parallel speedup.
+int main(int argc, char *argv[])
+{
+    namespace po = boost::program_options;
+
+    std::vector<std::uint32_t> n_bodies, batch_sizes;
+    std::vector<double> tols;
+    sweep_opts so;
+
+    std::vector<unsigned> def_threads;
+    for (auto n = 1u; n <= std::max(1u, std::thread::hardware_concurrency()); n *= 2u) {
+        def_threads.push_back(n);
+    }
+
+    harness h("scaling_suite");
+
+    po::options_description desc("Options");
+
+    desc.add_options()("help", "produce help message")(
+        "n_bodies", po::value(&n_bodies)->multitoken()->default_value({3, 6}, "3 6"), "numbers of bodies")(
+        "tols", po::value(&tols)->multitoken()->default_value({1e-8, 1e-15}, "1e-8 1e-15"),
+        "tolerances (each determining a Taylor order)")(
+        "batch_sizes", po::value(&batch_sizes)->multitoken()->default_value({1, 2, 4, 8}, "1 2 4 8"), "batch sizes")(
+        "threads", po::value(&so.threads)->multitoken()->default_value(def_threads, "powers of 2 up to the core count"),
+        "numbers of threads for the ensemble propagation")(
+        "n_steps", po::value(&so.n_steps)->default_value(1000u), "number of steps for the step throughput")(
+        "n_iter", po::value(&so.n_iter)->default_value(64u), "number of iterations of the ensemble propagation")(
+        "ens_time", po::value(&so.ens_time)->default_value(100.), "final time of the ensemble propagation")(
+        "no_compact_mode", "do not sweep over compact mode")("sweep_high_accuracy",
+                                                            "sweep over high accuracy mode");
+    h.add_options(desc);
+
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    po::notify(vm);
+
+    if (vm.count("help")) {
+        std::cout << desc << "\n";
+        return 0;
+    }
+
+    h.check_options();
+
+    if (std::find(batch_sizes.begin(), batch_sizes.end(), 0u) != batch_sizes.end()) {
+        throw std::invalid_argument("The batch size cannot be zero");
+    }
+    if (std::find(so.threads.begin(), so.threads.end(), 0u) != so.threads.end()) {
+        throw std::invalid_argument("The number of threads cannot be zero");
+    }
+    if (std::find_if(n_bodies.begin(), n_bodies.end(), [](auto n) { return n < 2u; }) != n_bodies.end()) {
+        throw std::invalid_argument("The number of bodies must be at least 2");
+    }
+
+    std::vector<bool> cms{false}, has{false};
+    if (!vm.count("no_compact_mode")) {
+        cms.push_back(true);
+    }
+    if (vm.count("sweep_high_accuracy")) {
+        has.push_back(true);
+    }
+
+    auto join = [](const auto &v) {
+        std::ostringstream oss;
+        for (decltype(v.size()) i = 0; i < v.size(); ++i) {
+            oss << (i == 0u ? "" : " ") << v[i];
+        }
+        return oss.str();
+    };
+
+    h.set_param("n_bodies", join(n_bodies));
+    h.set_param("tols", join(tols));
+    h.set_param("batch_sizes", join(batch_sizes));
+    h.set_param("threads", join(so.threads));
+    h.set_param("compact_mode", join(cms));
+    h.set_param("high_accuracy", join(has));
+    h.set_param("n_steps", std::to_string(so.n_steps));
+    h.set_param("n_iter", std::to_string(so.n_iter));
+    h.set_param("ens_time", std::to_string(so.ens_time));
+
+    for (const auto n : n_bodies) {
+        for (const auto tol : tols) {
+            for (const auto batch_size : batch_sizes) {
+                for (const auto cm : cms) {
+                    for (const auto ha : has) {
+                        const config c{n, tol, batch_size, cm, ha};
+
+                        if (batch_size == 1u) {
+                            run_config<taylor_adaptive<double>>(h, c, so);
+                        } else {
+                            run_config<taylor_adaptive_batch<double>>(h, c, so);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    h.report();
+}
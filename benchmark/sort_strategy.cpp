@@ -0,0 +1,150 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <initializer_list>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/program_options.hpp>
+
+#include <heyoka/expression.hpp>
+#include <heyoka/mascon.hpp>
+#include <heyoka/nbody.hpp>
+#include <heyoka/taylor.hpp>
+
+#include "data/mascon_bennu.hpp"
+
+using namespace heyoka;
+
+// Comparison of the step times of the integrators built with
+// the different reordering strategies for the Taylor decomposition,
+// on the outer Solar System (the system of outer_ss_jet_benchmark) and on
+// a mascon model of Bennu (the system of mascon_models).
+
+template <typename F>
+void run(const std::string &name, const F &factory, unsigned n_steps)
+{
+    for (auto ss : {taylor_sort_strategy::bfs, taylor_sort_strategy::dfs, taylor_sort_strategy::live_range}) {
+        auto start = std::chrono::high_resolution_clock::now();
+
+        auto ta = factory(ss);
+
+        auto elapsed = static_cast<double>(
+            std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - start)
+                .count());
+
+        std::cout << name << ", " << ss << ": construction time " << elapsed << "ms, ";
+
+        // Warm up.
+        ta.step();
+
+        start = std::chrono::high_resolution_clock::now();
+
+        for (auto i = 0u; i < n_steps; ++i) {
+            ta.step();
+        }
+
+        elapsed = static_cast<double>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - start)
+                .count());
+
+        std::cout << "step time " << elapsed / n_steps << "ns\n";
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    namespace po = boost::program_options;
+
+    unsigned n_steps;
+    std::uint32_t n_mascons;
+    bool compact_mode = false;
+
+    po::options_description desc("Options");
+
+    desc.add_options()("help", "produce help message")(
+        "n_steps", po::value<unsigned>(&n_steps)->default_value(1000u), "number of timed steps")(
+        "n_mascons", po::value<std::uint32_t>(&n_mascons)->default_value(100u),
+        "number of mascons of the Bennu model")("compact_mode", "compact mode");
+
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    po::notify(vm);
+
+    if (vm.count("help")) {
+        std::cout << desc << "\n";
+        return 0;
+    }
+
+    if (vm.count("compact_mode")) {
+        compact_mode = true;
+    }
+
+    // The outer Solar System.
+    const auto masses = std::vector{1.00000597682, 1. / 1047.355, 1. / 3501.6, 1. / 22869., 1. / 19314., 7.4074074e-09};
+    const auto G = 0.01720209895 * 0.01720209895;
+    const auto ss_sys = make_nbody_sys(6, kw::masses = masses, kw::Gconst = G);
+    const std::vector<double> ss_ic = {// Sun.
+                                       -4.06428567034226e-3, -6.08813756435987e-3, -1.66162304225834e-6,
+                                       +6.69048890636161e-6, -6.33922479583593e-6, -3.13202145590767e-9,
+                                       // Jupiter.
+                                       +3.40546614227466e+0, +3.62978190075864e+0, +3.42386261766577e-2,
+                                       -5.59797969310664e-3, +5.51815399480116e-3, -2.66711392865591e-6,
+                                       // Saturn.
+                                       +6.60801554403466e+0, +6.38084674585064e+0, -1.36145963724542e-1,
+                                       -4.17354020307064e-3, +3.99723751748116e-3, +1.67206320571441e-5,
+                                       // Uranus.
+                                       +1.11636331405597e+1, +1.60373479057256e+1, +3.61783279369958e-1,
+                                       -3.25884806151064e-3, +2.06438412905916e-3, -2.17699042180559e-5,
+                                       // Neptune.
+                                       -3.01777243405203e+1, +1.91155314998064e+0, -1.53887595621042e-1,
+                                       -2.17471785045538e-4, -3.11361111025884e-3, +3.58344705491441e-5,
+                                       // Pluto.
+                                       -2.13858977531573e+1, +3.20719104739886e+1, +2.49245689556096e+0,
+                                       -1.76936577252484e-3, -2.06720938381724e-3, +6.58091931493844e-4};
+
+    run(
+        "Outer Solar System",
+        [&](taylor_sort_strategy ss) {
+            return taylor_adaptive<double>{ss_sys, ss_ic, kw::compact_mode = compact_mode, kw::sort_strategy = ss};
+        },
+        n_steps);
+
+    // The mascon model of Bennu, truncated to the first n_mascons mascons.
+    if (n_mascons > std::size(mascon_masses_bennu)) {
+        n_mascons = static_cast<std::uint32_t>(std::size(mascon_masses_bennu));
+    }
+    std::vector<std::vector<double>> points;
+    std::vector<double> mmasses;
+    for (std::uint32_t i = 0; i < n_mascons; ++i) {
+        points.emplace_back(std::begin(mascon_points_bennu[i]), std::end(mascon_points_bennu[i]));
+        mmasses.push_back(mascon_masses_bennu[i]);
+    }
+
+    // NOTE: same setup as in the mascon_models benchmark.
+    const auto wz = 1.5633255034258877, r0 = 3., incl = 45.;
+    const auto mascon_sys
+        = make_mascon_system(kw::points = points, kw::masses = mmasses, kw::omega = std::vector<double>{0., 0., wz});
+    const auto v0y = std::cos(incl / 360 * 6.28) * std::sqrt(1. / r0) - wz * r0;
+    const auto v0z = std::sin(incl / 360 * 6.28) * std::sqrt(1. / r0);
+    const std::vector<double> mascon_ic = {r0, 0., 0., 0., v0y, v0z};
+
+    run(
+        "Bennu (" + std::to_string(n_mascons) + " mascons)",
+        [&](taylor_sort_strategy ss) {
+            return taylor_adaptive<double>{mascon_sys, mascon_ic, kw::compact_mode = compact_mode,
+                                           kw::sort_strategy = ss, kw::tol = 1e-14};
+        },
+        n_steps);
+}
@@ -0,0 +1,133 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <cmath>
+#include <cstdint>
+#include <initializer_list>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <boost/program_options.hpp>
+
+#include <heyoka/nbody.hpp>
+#include <heyoka/perf_counters.hpp>
+#include <heyoka/taylor.hpp>
+
+// Hardware performance counters of the steps of an N-body integrator
+// (a central body plus planets on circular orbits) in compact and
+// non-compact mode and for several batch sizes. The counts are averaged
+// over the steps and divided by the batch size, and they are split
+// between the jet (including the determination of the timestep) and
+// the state update.
+
+using namespace heyoka;
+
+namespace
+{
+
+void print_counts(const std::string &name, const std::vector<step_perf_counts> &v, std::uint32_t batch_size)
+{
+    step_perf_counts tot;
+    for (const auto &spc : v) {
+        tot.step += spc.step;
+        tot.update += spc.update;
+    }
+
+    const auto den = static_cast<double>(v.size()) * batch_size;
+
+    auto print_row = [den](const char *label, const perf_counts &c) {
+        std::cout << "    " << label << "cycles: " << static_cast<double>(c.cycles) / den
+                  << ", instructions: " << static_cast<double>(c.instructions) / den
+                  << ", IPC: " << static_cast<double>(c.instructions) / static_cast<double>(c.cycles)
+                  << ", cache misses: " << static_cast<double>(c.cache_misses) / den
+                  << ", raw: " << static_cast<double>(c.raw) / den << '\n';
+    };
+
+    std::cout << name << ":\n";
+    print_row("Jet   : ", tot.jet());
+    print_row("Update: ", tot.update);
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    namespace po = boost::program_options;
+
+    unsigned n_planets = 0, n_steps = 0;
+    std::string raw_config;
+
+    po::options_description desc("Options");
+
+    desc.add_options()("help", "produce help message")(
+        "n_planets", po::value<unsigned>(&n_planets)->default_value(5u), "number of planets")(
+        "n_steps", po::value<unsigned>(&n_steps)->default_value(1000u), "number of steps")(
+        "raw_config", po::value<std::string>(&raw_config)->default_value("0"),
+        "configuration of the raw event (e.g., 0x10c7)");
+
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    po::notify(vm);
+
+    if (vm.count("help")) {
+        std::cout << desc << "\n";
+        return 0;
+    }
+
+    const auto raw = static_cast<std::uint64_t>(std::stoull(raw_config, nullptr, 0));
+
+    if (!perf_counters_available()) {
+        std::cout << "The hardware performance counters are not available\n";
+        return 0;
+    }
+
+    // The initial state of the system.
+    std::vector<double> masses{1.}, state(6u);
+    for (auto i = 0u; i < n_planets; ++i) {
+        const auto r = 1. + i, v = 1 / std::sqrt(r), phi = .7 * i;
+
+        masses.push_back(1e-4);
+        state.insert(state.end(),
+                     {r * std::cos(phi), r * std::sin(phi), 0., -v * std::sin(phi), v * std::cos(phi), 0.});
+    }
+
+    const auto sys = make_nbody_sys(n_planets + 1u, kw::masses = masses);
+
+    for (auto cm : {false, true}) {
+        const std::string mode = cm ? "compact mode" : "non-compact mode";
+
+        {
+            auto ta = taylor_adaptive<double>{sys, state, kw::compact_mode = cm};
+            ta.enable_perf_counters(raw);
+
+            for (auto i = 0u; i < n_steps; ++i) {
+                ta.step();
+            }
+
+            print_counts(mode + ", scalar", ta.get_perf_counts(), 1);
+        }
+
+        for (std::uint32_t batch_size : {2u, 4u}) {
+            // Replicate the state in all batch lanes.
+            std::vector<double> bstate;
+            for (auto x : state) {
+                bstate.insert(bstate.end(), batch_size, x);
+            }
+
+            auto ta = taylor_adaptive_batch<double>{sys, bstate, batch_size, kw::compact_mode = cm};
+            ta.enable_perf_counters(raw);
+
+            for (auto i = 0u; i < n_steps; ++i) {
+                ta.step();
+            }
+
+            print_counts(mode + ", batch size " + std::to_string(batch_size), ta.get_perf_counts(), batch_size);
+        }
+    }
+}
@@ -0,0 +1,118 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <heyoka/expression.hpp>
+#include <heyoka/llvm_state.hpp>
+#include <heyoka/math.hpp>
+#include <heyoka/taylor.hpp>
+
+using namespace heyoka;
+
+// Compare the computation of the jets of Taylor derivatives at many points
+// via a loop of calls to the function added by taylor_add_jet() (with the copies
+// into/from the interleaved jet layout) and via the function added by taylor_add_jet_multi().
+int main(int argc, char *argv[])
+{
+    auto batch_size = 1u;
+    auto parallel_mode = false;
+
+    if (argc > 1) {
+        auto bs = std::stoi(argv[1]);
+        if (bs <= 0) {
+            throw std::invalid_argument("The batch size must be positive, but it is " + std::string(argv[1])
+                                        + " instead");
+        }
+        batch_size = static_cast<unsigned>(bs);
+    }
+
+    if (argc > 2) {
+        parallel_mode = std::string(argv[2]) == "parallel";
+    }
+
+    auto [vx0, vx1, vy0, vy1, vz0, vz1, x0, x1, y0, y1, z0, z1]
+        = make_vars("vx0", "vx1", "vy0", "vy1", "vz0", "vz1", "x0", "x1", "y0", "y1", "z0", "z1");
+
+    auto x01 = x1 - x0;
+    auto y01 = y1 - y0;
+    auto z01 = z1 - z0;
+    auto r01_m3 = pow(x01 * x01 + y01 * y01 + z01 * z01, -3_dbl / 2_dbl);
+
+    const std::vector<expression> sys{x01 * r01_m3, -x01 * r01_m3, y01 * r01_m3, -y01 * r01_m3, z01 * r01_m3,
+                                      -z01 * r01_m3, vx0, vx1, vy0, vy1, vz0, vz1};
+
+    const auto order = 20u;
+    const auto n_eq = 12u;
+    const std::uint32_t n_points = 100000u - 100000u % batch_size;
+
+    llvm_state s, s_multi;
+
+    taylor_add_jet<double>(s, "jet", sys, order, batch_size, false, false);
+    taylor_add_jet_multi<double>(s_multi, "jet_multi", sys, order, batch_size, false, false, parallel_mode);
+
+    s.compile();
+    s_multi.compile();
+
+    auto jet_ptr = reinterpret_cast<void (*)(double *, const double *, const double *)>(s.jit_lookup("jet"));
+    auto jet_multi_ptr
+        = reinterpret_cast<void (*)(double *, const double *, const double *, const double *, std::uint32_t,
+                                    std::uint64_t)>(s_multi.jit_lookup("jet_multi"));
+
+    // The input/output arrays in SoA layout.
+    std::vector<double> in(n_eq * n_points), out((order + 1u) * n_eq * n_points);
+    for (decltype(in.size()) i = 0; i < in.size(); ++i) {
+        in[i] = 1 + static_cast<double>(i % 7u) / 10;
+    }
+
+    // Loop of calls to the jet function.
+    std::vector<double> jet(n_eq * (order + 1u) * batch_size);
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    for (std::uint32_t p = 0; p < n_points; p += batch_size) {
+        for (auto i = 0u; i < n_eq; ++i) {
+            for (auto j = 0u; j < batch_size; ++j) {
+                jet[i * batch_size + j] = in[i * n_points + p + j];
+            }
+        }
+
+        jet_ptr(jet.data(), nullptr, nullptr);
+
+        for (auto r = 0u; r < n_eq * (order + 1u); ++r) {
+            for (auto j = 0u; j < batch_size; ++j) {
+                out[r * n_points + p + j] = jet[r * batch_size + j];
+            }
+        }
+    }
+
+    auto elapsed = static_cast<double>(
+        std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - start)
+            .count());
+
+    std::cout << "Loop of jet calls, batch size " << batch_size << ": " << elapsed << "us\n";
+
+    // Jet function for multiple points.
+    start = std::chrono::high_resolution_clock::now();
+
+    jet_multi_ptr(out.data(), in.data(), nullptr, nullptr, n_points, n_points);
+
+    elapsed = static_cast<double>(
+        std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - start)
+            .count());
+
+    std::cout << "Jet function for multiple points, batch size " << batch_size
+              << (parallel_mode ? " (parallel)" : "") << ": " << elapsed << "us\n";
+
+    return 0;
+}
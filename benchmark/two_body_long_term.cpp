@@ -8,9 +8,11 @@
 
 #include <algorithm>
 #include <array>
+#include <chrono>
 #include <cmath>
 #include <fstream>
 #include <initializer_list>
+#include <iostream>
 #include <limits>
 #include <ostream>
 #include <stdexcept>
@@ -41,7 +43,7 @@ T tbp_energy(const std::vector<T> &st)
 }
 
 template <typename T>
-void run_integration()
+void run_integration(bool high_accuracy = false)
 {
     using std::abs;
     using std::log10;
@@ -59,7 +61,7 @@ void run_integration()
 
     std::vector<T> init_state{x0, y0, z0, vx0, vy0, vz0, -x0, -y0, -z0, -vx0, -vy0, -vz0};
 
-    heyoka::taylor_adaptive<T> ta{std::move(sys), std::move(init_state)};
+    heyoka::taylor_adaptive<T> ta{std::move(sys), std::move(init_state), heyoka::kw::high_accuracy = high_accuracy};
 
     const auto &st = ta.get_state();
 
@@ -79,6 +81,8 @@ void run_integration()
         t = pow(T(10), t);
     }
 
+    const auto t_start = std::chrono::steady_clock::now();
+
     std::ofstream of("two_body_long_term.txt");
     of.precision(std::numeric_limits<T>::max_digits10);
     auto it = save_times.begin();
@@ -110,6 +114,12 @@ void run_integration()
             throw std::runtime_error("Error status detected: " + std::to_string(static_cast<int>(res)));
         }
     }
+
+    const auto elapsed
+        = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - t_start).count();
+
+    std::cout << "Total runtime: " << elapsed << "ms\n";
+    std::cout << "Final relative energy error: " << abs((en - tbp_energy(st)) / en) << '\n';
 }
 
 int main(int argc, char *argv[])
@@ -126,6 +136,11 @@ int main(int argc, char *argv[])
             case 1:
                 run_integration<long double>();
                 break;
+            case 2:
+                // Double precision with the high-accuracy mode,
+                // for comparison with the long double integrator.
+                run_integration<double>(true);
+                break;
             default:
                 throw std::invalid_argument("Invalid floating point type selected (" + std::string(argv[1]) + ")");
                 break;
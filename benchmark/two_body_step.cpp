@@ -8,11 +8,13 @@
 
 #include <heyoka/config.hpp>
 
-#include <chrono>
+#include <algorithm>
+#include <cmath>
 #include <initializer_list>
 #include <iostream>
 #include <stdexcept>
 #include <string>
+#include <tuple>
 #include <utility>
 #include <vector>
 
@@ -27,41 +29,66 @@
 #include <heyoka/nbody.hpp>
 #include <heyoka/taylor.hpp>
 
-#include "benchmark_utils.hpp"
+#include "benchmark_harness.hpp"
 
 using namespace heyoka;
 using namespace heyoka_benchmark;
 
+// Energy of the test particle.
 template <typename T>
-void run_bench(T tol, bool high_accuracy, bool compact_mode, bool fast_math)
+T tbp_energy(const T *s)
 {
-    warmup();
+    using std::sqrt;
+
+    const auto x = s[6] - s[0], y = s[7] - s[1], z = s[8] - s[2];
+    const auto vx = s[9] - s[3], vy = s[10] - s[4], vz = s[11] - s[5];
+
+    return (vx * vx + vy * vy + vz * vz) / 2 - 1 / sqrt(x * x + y * y + z * z);
+}
+
+template <typename T>
+void run_bench(harness &h, T tol, bool high_accuracy, bool compact_mode, bool fast_math)
+{
+    using std::abs;
 
     // NOTE: this setup mimics the 'simplest' test from rebound.
-    auto sys = make_nbody_sys(2, kw::masses = {1., 0.});
+    const auto sys = make_nbody_sys(2, kw::masses = {1., 0.});
+
+    const std::vector init_state{T(0), T(0), T(0), T(0), T(0), T(0), T(1), T(0), T(0), T(0), T(1), T(0)};
 
-    std::vector init_state{T(0), T(0), T(0), T(0), T(0), T(0), T(1), T(0), T(0), T(0), T(1), T(0)};
+    auto make_ta = [&]() {
+        return taylor_adaptive<T>{sys,           init_state,
+                                  kw::high_accuracy = high_accuracy,
+                                  kw::tol = tol, kw::compact_mode = compact_mode,
+                                  kw::fast_math = fast_math};
+    };
 
-    auto start = std::chrono::high_resolution_clock::now();
+    h.measure("construction_time", "s", [&]() { return harness::elapsed(make_ta); });
 
-    auto tad = taylor_adaptive<T>{std::move(sys), std::move(init_state),           kw::high_accuracy = high_accuracy,
-                                  kw::tol = tol,  kw::compact_mode = compact_mode, kw::fast_math = fast_math};
+    auto tad = make_ta();
 
-    auto elapsed = static_cast<double>(
-        std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - start)
-            .count());
+    h.record("compile_time", "s", tad.get_llvm_state().get_optimise_time() + tad.get_llvm_state().get_compile_time());
 
-    std::cout << "Construction time: " << elapsed << "ms\n";
+    const auto E0 = tbp_energy(init_state.data());
 
-    start = std::chrono::high_resolution_clock::now();
+    // NOTE: the final energy error is recorded
+    // at each run, together with the throughput.
+    double rel_err = 0;
 
-    tad.propagate_until(T(10000));
+    h.measure("step_throughput", "steps/s", [&]() {
+        std::copy(init_state.begin(), init_state.end(), tad.get_state_data());
+        tad.set_time(T(0));
 
-    elapsed = static_cast<double>(
-        std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - start)
-            .count());
+        auto n_steps = 0.;
+        const auto elapsed
+            = harness::elapsed([&]() { n_steps = static_cast<double>(std::get<3>(tad.propagate_until(T(10000)))); });
 
-    std::cout << "Integration time: " << elapsed << "μs\n";
+        rel_err = static_cast<double>(abs((tbp_energy(tad.get_state_data()) - E0) / E0));
+
+        return n_steps / elapsed;
+    });
+
+    h.record("energy_error", "rel", rel_err);
 }
 
 int main(int argc, char *argv[])
@@ -74,6 +101,8 @@ int main(int argc, char *argv[])
     bool compact_mode = false;
     bool fast_math = false;
 
+    harness h("two_body_step");
+
     po::options_description desc("Options");
 
     desc.add_options()("help", "produce help message")(
@@ -81,6 +110,7 @@ int main(int argc, char *argv[])
         "tol", po::value<double>(&tol)->default_value(0.), "tolerance (if 0, it will be the type's epsilon)")(
         "high_accuracy", "enable high-accuracy mode")("compact_mode", "enable compact mode")("fast_math",
                                                                                              "enable fast math flags");
+    h.add_options(desc);
 
     po::variables_map vm;
     po::store(po::parse_command_line(argc, argv, desc), vm);
@@ -91,6 +121,8 @@ int main(int argc, char *argv[])
         return 0;
     }
 
+    h.check_options();
+
     if (vm.count("high_accuracy")) {
         high_accuracy = true;
     }
@@ -103,15 +135,23 @@ int main(int argc, char *argv[])
         fast_math = true;
     }
 
+    h.set_param("fp_type", fp_type);
+    h.set_param("tol", std::to_string(tol));
+    h.set_param("high_accuracy", high_accuracy ? "true" : "false");
+    h.set_param("compact_mode", compact_mode ? "true" : "false");
+    h.set_param("fast_math", fast_math ? "true" : "false");
+
     if (fp_type == "double") {
-        run_bench<double>(tol, high_accuracy, compact_mode, fast_math);
+        run_bench<double>(h, tol, high_accuracy, compact_mode, fast_math);
     } else if (fp_type == "long double") {
-        run_bench<long double>(tol, high_accuracy, compact_mode, fast_math);
+        run_bench<long double>(h, tol, high_accuracy, compact_mode, fast_math);
 #if defined(HEYOKA_HAVE_REAL128)
     } else if (fp_type == "real128") {
-        run_bench<mppp::real128>(mppp::real128(tol), high_accuracy, compact_mode, fast_math);
+        run_bench<mppp::real128>(h, mppp::real128(tol), high_accuracy, compact_mode, fast_math);
 #endif
     } else {
         throw std::invalid_argument("Invalid floating-point type: '" + fp_type + "'");
     }
+
+    h.report();
 }
@@ -25,14 +25,23 @@
 
 #endif
 
+#include <heyoka/llvm_state.hpp>
 #include <heyoka/nbody.hpp>
 #include <heyoka/taylor.hpp>
 
 using namespace heyoka;
 
 template <typename T>
-void run_bench(T tol, bool high_accuracy, std::uint32_t batch_size, bool compact_mode, bool fast_math)
+void run_bench(T tol, bool high_accuracy, std::uint32_t batch_size, bool compact_mode, bool fast_math, bool vw512)
 {
+    // A batch size of zero means the recommended
+    // batch size for the host machine.
+    if (batch_size == 0u) {
+        batch_size = recommended_batch_size<T>(vw512);
+    }
+
+    std::cout << "Batch size: " << batch_size << '\n';
+
     // NOTE: this setup mimics the 'simplest' test from rebound.
     auto sys = make_nbody_sys(2, kw::masses = {1., 0.});
 
@@ -62,7 +71,8 @@ void run_bench(T tol, bool high_accuracy, std::uint32_t batch_size, bool compact
                                         kw::high_accuracy = high_accuracy,
                                         kw::tol = tol,
                                         kw::compact_mode = compact_mode,
-                                        kw::fast_math = fast_math};
+                                        kw::fast_math = fast_math,
+                                        kw::prefer_vw512 = vw512};
 
     auto elapsed = static_cast<double>(
         std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - start)
@@ -94,15 +104,17 @@ int main(int argc, char *argv[])
     std::uint32_t batch_size;
     bool compact_mode = false;
     bool fast_math = false;
+    bool vw512 = false;
 
     po::options_description desc("Options");
 
     desc.add_options()("help", "produce help message")(
         "fp_type", po::value<std::string>(&fp_type)->default_value("double"), "floating-point type")(
         "tol", po::value<double>(&tol)->default_value(0.), "tolerance (if 0, it will be the type's epsilon)")(
-        "batch_size", po::value<std::uint32_t>(&batch_size)->default_value(1u), "batch size")(
-        "high_accuracy", "enable high-accuracy mode")("compact_mode", "enable compact mode")("fast_math",
-                                                                                             "enable fast math flags");
+        "batch_size", po::value<std::uint32_t>(&batch_size)->default_value(1u),
+        "batch size (if 0, it will be the recommended batch size for the host machine)")(
+        "high_accuracy", "enable high-accuracy mode")("compact_mode", "enable compact mode")(
+        "fast_math", "enable fast math flags")("vw512", "enable 512-bit vectors on AVX-512 capable machines");
 
     po::variables_map vm;
     po::store(po::parse_command_line(argc, argv, desc), vm);
@@ -113,11 +125,6 @@ int main(int argc, char *argv[])
         return 0;
     }
 
-    // Validate the command-line arguments.
-    if (batch_size == 0u) {
-        throw std::invalid_argument("The batch size cannot be zero");
-    }
-
     if (vm.count("high_accuracy")) {
         high_accuracy = true;
     }
@@ -130,13 +137,17 @@ int main(int argc, char *argv[])
         fast_math = true;
     }
 
+    if (vm.count("vw512")) {
+        vw512 = true;
+    }
+
     if (fp_type == "double") {
-        run_bench<double>(tol, high_accuracy, batch_size, compact_mode, fast_math);
+        run_bench<double>(tol, high_accuracy, batch_size, compact_mode, fast_math, vw512);
     } else if (fp_type == "long double") {
-        run_bench<long double>(tol, high_accuracy, batch_size, compact_mode, fast_math);
+        run_bench<long double>(tol, high_accuracy, batch_size, compact_mode, fast_math, vw512);
 #if defined(HEYOKA_HAVE_REAL128)
     } else if (fp_type == "real128") {
-        run_bench<mppp::real128>(mppp::real128(tol), high_accuracy, batch_size, compact_mode, fast_math);
+        run_bench<mppp::real128>(mppp::real128(tol), high_accuracy, batch_size, compact_mode, fast_math, vw512);
 #endif
     } else {
         throw std::invalid_argument("Invalid floating-point type: '" + fp_type + "'");
@@ -0,0 +1,326 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <heyoka/config.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <boost/program_options.hpp>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <heyoka/expression.hpp>
+#include <heyoka/mascon.hpp>
+#include <heyoka/nbody.hpp>
+#include <heyoka/taylor.hpp>
+
+#include "benchmark_harness.hpp"
+#include "benchmark_utils.hpp"
+
+using namespace heyoka;
+using namespace heyoka_benchmark;
+
+namespace
+{
+
+// A point of a work-precision curve.
+struct wp_point {
+    std::string label;
+    double time, error;
+};
+
+double median(std::vector<double> v)
+{
+    std::sort(v.begin(), v.end());
+
+    const auto n = v.size();
+
+    return n % 2u == 1u ? v[n / 2u] : (v[n / 2u - 1u] + v[n / 2u]) / 2;
+}
+
+// Relative error of the state x with respect to the reference state ref.
+double state_error(const std::vector<double> &x, const std::vector<long double> &ref)
+{
+    long double num = 0, den = 0;
+
+    for (decltype(x.size()) i = 0; i < x.size(); ++i) {
+        num += (x[i] - ref[i]) * (x[i] - ref[i]);
+        den += ref[i] * ref[i];
+    }
+
+    return static_cast<double>(std::sqrt(num / den));
+}
+
+// Run the integrator built by make_ta up to final_time, recording the wall-clock
+// time, the number of steps, the error with respect to the final reference
+// state ref and the relative error on the conserved quantity E.
+template <typename F>
+wp_point run_point(harness &h, const std::string &sys_name, double tol, bool ha, F &&make_ta, double final_time,
+                   const std::vector<long double> &ref, const std::function<double(const std::vector<double> &)> &E)
+{
+    auto ta = make_ta(tol, ha);
+    const auto init_state = ta.get_state();
+    const auto E0 = E(init_state);
+
+    std::ostringstream oss;
+    oss.precision(3);
+    oss << "sys=" << sys_name << ",tol=" << tol << ",order=" << ta.get_order() << ",ha=" << ha;
+    const auto label = oss.str();
+
+    std::vector<double> samples;
+    std::size_t n_steps = 0;
+
+    h.measure("wall_time[" + label + "]", "s", [&]() {
+        std::copy(init_state.begin(), init_state.end(), ta.get_state_data());
+        ta.set_time(0.);
+
+        samples.push_back(harness::elapsed([&]() {
+            const auto res = ta.propagate_until(final_time);
+
+            if (std::get<0>(res) != taylor_outcome::time_limit) {
+                throw std::runtime_error("The integration of the system '" + sys_name + "' failed");
+            }
+
+            n_steps = std::get<3>(res);
+        }));
+
+        return samples.back();
+    });
+
+    samples.erase(samples.begin(), samples.begin() + static_cast<std::ptrdiff_t>(h.get_n_warmup()));
+
+    const auto err = state_error(ta.get_state(), ref);
+
+    h.record("n_steps[" + label + "]", "steps", static_cast<double>(n_steps));
+    h.record("state_error[" + label + "]", "rel", err);
+    h.record("energy_error[" + label + "]", "rel", std::abs((E(ta.get_state()) - E0) / E0));
+
+    return wp_point{label, median(samples), err};
+}
+
+// Two-body problem with the initial conditions of the two_body_long_term benchmark.
+// The reference solution is analytic.
+namespace tbp
+{
+
+const std::vector<double> init_state{0.12753732455163191,  1.38595818266122,     0.35732917545977527,
+                                     -0.41861303824199964, 0.032224544954305295, 0.070829797576461351,
+                                     -0.12753732455163191, -1.38595818266122,    -0.35732917545977527,
+                                     0.41861303824199964,  -0.032224544954305295, -0.070829797576461351};
+
+double energy(const std::vector<double> &st)
+{
+    const auto Dx = st[0] - st[6], Dy = st[1] - st[7], Dz = st[2] - st[8];
+
+    const auto v2_0 = st[3] * st[3] + st[4] * st[4] + st[5] * st[5];
+    const auto v2_1 = st[9] * st[9] + st[10] * st[10] + st[11] * st[11];
+
+    return (v2_0 + v2_1) / 2 - 1 / std::sqrt(Dx * Dx + Dy * Dy + Dz * Dz);
+}
+
+// The analytic solution at the time t. As the masses are equal and the centre
+// of mass is at rest in the origin, the positions and velocities of the bodies
+// are +-1/2 the relative position and velocity, which follow a Keplerian orbit
+// with mu = 2.
+std::vector<long double> reference(long double t)
+{
+    using ld = long double;
+
+    const auto &s = init_state;
+    const ld mu = 2;
+
+    const auto kep = cart_to_kep(std::array<ld, 3>{ld(s[0]) - s[6], ld(s[1]) - s[7], ld(s[2]) - s[8]},
+                                 std::array<ld, 3>{ld(s[3]) - s[9], ld(s[4]) - s[10], ld(s[5]) - s[11]}, mu);
+    const auto [a, e, i, om, Om, nu0] = kep;
+
+    // Propagate the mean anomaly, and solve the Kepler equation via Newton iterations.
+    const auto E0 = 2 * std::atan(std::sqrt((1 - e) / (1 + e)) * std::tan(nu0 / 2));
+    const auto M = E0 - e * std::sin(E0) + std::sqrt(mu / (a * a * a)) * t;
+
+    auto E = M;
+    for (auto k = 0; k < 100; ++k) {
+        const auto dE = (E - e * std::sin(E) - M) / (1 - e * std::cos(E));
+        E -= dE;
+
+        if (std::abs(dE) <= std::numeric_limits<ld>::epsilon() * (1 + std::abs(E))) {
+            break;
+        }
+    }
+
+    const auto nu = 2 * std::atan(std::sqrt((1 + e) / (1 - e)) * std::tan(E / 2));
+    const auto [x, v] = kep_to_cart(std::array<ld, 6>{a, e, i, om, Om, nu}, mu);
+
+    return {x[0] / 2,  x[1] / 2,  x[2] / 2,  v[0] / 2,  v[1] / 2,  v[2] / 2,
+            -x[0] / 2, -x[1] / 2, -x[2] / 2, -v[0] / 2, -v[1] / 2, -v[2] / 2};
+}
+
+} // namespace tbp
+
+// Orbit around a small synthetic mascon model (8 mascons at the vertices of a
+// box), in the frame rotating with the body. The conserved quantity is the
+// Jacobi integral from energy_mascon_system(), and the reference solution is
+// computed with a high-precision integrator.
+namespace masc
+{
+
+const std::vector<std::vector<double>> points{{.5, .3, .2},   {.5, .3, -.2},   {.5, -.3, .2},   {.5, -.3, -.2},
+                                              {-.5, .3, .2},  {-.5, .3, -.2},  {-.5, -.3, .2},  {-.5, -.3, -.2}};
+const std::vector<double> masses(8, 1. / 8);
+const std::vector<double> omega{0., 0., .5};
+// NOTE: inclined quasi-circular orbit with radius 2.
+const std::vector<double> init_state{
+    2., 0., 0., 0., std::sqrt(1. / 2) * std::cos(.3) - omega[2] * 2, std::sqrt(1. / 2) * std::sin(.3)};
+
+auto sys()
+{
+    return make_mascon_system(kw::points = points, kw::masses = masses, kw::omega = omega);
+}
+
+double energy(const std::vector<double> &st)
+{
+    return eval_dbl(energy_mascon_system(kw::state = st, kw::points = points, kw::masses = masses, kw::omega = omega),
+                    std::unordered_map<std::string, double>{});
+}
+
+template <typename R>
+std::vector<long double> reference(double t)
+{
+    taylor_adaptive<R> ta{sys(), std::vector<R>(init_state.begin(), init_state.end())};
+
+    const auto res = ta.propagate_until(R(t));
+    if (std::get<0>(res) != taylor_outcome::time_limit) {
+        throw std::runtime_error("The computation of the reference solution failed");
+    }
+
+    std::vector<long double> retval;
+    for (const auto &x : ta.get_state()) {
+        retval.push_back(static_cast<long double>(x));
+    }
+
+    return retval;
+}
+
+} // namespace masc
+
+} // namespace
+
+// Work-precision curves: for a given system, sweep the tolerance and the high-accuracy
+// mode of the integrator, and record for each configuration the wall-clock time and the
+// number of steps of the integration, the error on the final state with respect to a
+// reference solution and the relative error on a conserved quantity. The cheapest
+// configuration which meets the accuracy budget (if any) is reported in the params.
+int main(int argc, char *argv[])
+{
+    namespace po = boost::program_options;
+
+    std::string sys_name, ref_fp_type;
+    std::vector<double> tols;
+    double final_time, budget;
+
+    harness h("work_precision");
+
+    po::options_description desc("Options");
+
+    desc.add_options()("help", "produce help message")(
+        "system", po::value<std::string>(&sys_name)->default_value("two_body"), "system ('two_body' or 'mascon')")(
+        "tols", po::value(&tols)->multitoken()->default_value({1e-6, 1e-9, 1e-12, 1e-15}, "1e-6 1e-9 1e-12 1e-15"),
+        "tolerances")("final_time", po::value<double>(&final_time)->default_value(1000.), "final time")(
+        "ref_fp_type", po::value<std::string>(&ref_fp_type)->default_value("long double"),
+        "floating-point type of the reference integrator for the mascon system ('long double' or 'real128')")(
+        "budget", po::value<double>(&budget)->default_value(1e-10), "accuracy budget on the final state")(
+        "no_high_accuracy", "do not sweep over high accuracy mode");
+    h.add_options(desc);
+
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    po::notify(vm);
+
+    if (vm.count("help")) {
+        std::cout << desc << "\n";
+        return 0;
+    }
+
+    h.check_options();
+
+    std::vector<bool> has{false};
+    if (!vm.count("no_high_accuracy")) {
+        has.push_back(true);
+    }
+
+    h.set_param("system", sys_name);
+    h.set_param("final_time", std::to_string(final_time));
+    h.set_param("budget", std::to_string(budget));
+
+    std::vector<long double> ref;
+    std::function<double(const std::vector<double> &)> E;
+    std::function<taylor_adaptive<double>(double, bool)> make_ta;
+
+    if (sys_name == "two_body") {
+        h.set_param("reference", "analytic");
+
+        ref = tbp::reference(final_time);
+        E = tbp::energy;
+        make_ta = [](double tol, bool ha) {
+            return taylor_adaptive<double>{make_nbody_sys(2), tbp::init_state, kw::tol = tol, kw::high_accuracy = ha};
+        };
+    } else if (sys_name == "mascon") {
+        h.set_param("reference", ref_fp_type);
+
+        if (ref_fp_type == "long double") {
+            ref = masc::reference<long double>(final_time);
+#if defined(HEYOKA_HAVE_REAL128)
+        } else if (ref_fp_type == "real128") {
+            ref = masc::reference<mppp::real128>(final_time);
+#endif
+        } else {
+            throw std::invalid_argument("Invalid floating-point type for the reference integrator: '" + ref_fp_type
+                                        + "'");
+        }
+
+        E = masc::energy;
+        make_ta = [](double tol, bool ha) {
+            return taylor_adaptive<double>{masc::sys(), masc::init_state, kw::tol = tol, kw::high_accuracy = ha};
+        };
+    } else {
+        throw std::invalid_argument("Invalid system: '" + sys_name + "'");
+    }
+
+    std::optional<wp_point> cheapest;
+
+    for (const auto tol : tols) {
+        for (const auto ha : has) {
+            auto pt = run_point(h, sys_name, tol, ha, make_ta, final_time, ref, E);
+
+            if (pt.error <= budget && (!cheapest || pt.time < cheapest->time)) {
+                cheapest = std::move(pt);
+            }
+        }
+    }
+
+    h.set_param("cheapest", cheapest ? cheapest->label : "none");
+
+    h.report();
+}
@@ -30,24 +30,41 @@
 
 #include <heyoka/detail/fwd_decl.hpp>
 #include <heyoka/detail/llvm_fwd.hpp>
+#include <heyoka/detail/node_meta.hpp>
 #include <heyoka/detail/type_traits.hpp>
 #include <heyoka/detail/visibility.hpp>
 
 namespace heyoka
 {
 
+namespace detail
+{
+
+// The operands of a binary operator, together
+// with the cache of its properties.
+struct bo_node;
+
+} // namespace detail
+
 HEYOKA_DLL_PUBLIC void swap(binary_operator &, binary_operator &) noexcept;
 
 class HEYOKA_DLL_PUBLIC binary_operator
 {
     friend HEYOKA_DLL_PUBLIC void swap(binary_operator &, binary_operator &) noexcept;
+    friend HEYOKA_DLL_PUBLIC const detail::node_meta *detail::node_meta_ptr(const expression &);
 
 public:
     enum class type { add, sub, mul, div };
 
 private:
     type m_type;
-    std::unique_ptr<std::array<expression, 2>> m_ops;
+    // NOTE: the operands are shared among copies, and they
+    // are copied only when accessed via the non-const
+    // getters of a shared binary operator (copy-on-write).
+    std::shared_ptr<detail::bo_node> m_ops;
+
+    HEYOKA_DLL_LOCAL detail::bo_node &mutable_node();
+    HEYOKA_DLL_LOCAL const detail::node_meta &meta() const;
 
 public:
     explicit binary_operator(type, expression, expression);
@@ -0,0 +1,376 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef HEYOKA_COMPILED_FUNCTION_HPP
+#define HEYOKA_COMPILED_FUNCTION_HPP
+
+#include <heyoka/config.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <heyoka/detail/igor.hpp>
+#include <heyoka/detail/type_traits.hpp>
+#include <heyoka/detail/visibility.hpp>
+#include <heyoka/expression.hpp>
+#include <heyoka/llvm_state.hpp>
+
+namespace heyoka
+{
+
+namespace kw
+{
+
+IGOR_MAKE_NAMED_ARGUMENT(vars);
+IGOR_MAKE_NAMED_ARGUMENT(batch_size);
+
+} // namespace kw
+
+// Add to the state s a function with the given name for the evaluation of the
+// expressions fn. The values of the variables in vars are read from the input array,
+// the values of the expressions are written into the output array. If vars is empty,
+// the variables are deduced from fn and sorted alphabetically.
+//
+// The signature of the function is
+//
+// void (T *out, const T *in, const T *par, std::uint64_t stride)
+//
+// where the batch_size values of the i-th variable are read from in + i * stride,
+// and the batch_size values of the i-th expression are written into out + i * stride.
+// The return value is the list of variables.
+HEYOKA_DLL_PUBLIC std::vector<expression> add_cfunc_dbl(llvm_state &, const std::string &,
+                                                        const std::vector<expression> &, std::vector<expression>,
+                                                        std::uint32_t);
+HEYOKA_DLL_PUBLIC std::vector<expression> add_cfunc_ldbl(llvm_state &, const std::string &,
+                                                         const std::vector<expression> &, std::vector<expression>,
+                                                         std::uint32_t);
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+HEYOKA_DLL_PUBLIC std::vector<expression> add_cfunc_f128(llvm_state &, const std::string &,
+                                                         const std::vector<expression> &, std::vector<expression>,
+                                                         std::uint32_t);
+
+#endif
+
+template <typename T>
+std::vector<expression> add_cfunc(llvm_state &s, const std::string &name, const std::vector<expression> &fn,
+                                  std::vector<expression> vars, std::uint32_t batch_size)
+{
+    if constexpr (std::is_same_v<T, double>) {
+        return add_cfunc_dbl(s, name, fn, std::move(vars), batch_size);
+    } else if constexpr (std::is_same_v<T, long double>) {
+        return add_cfunc_ldbl(s, name, fn, std::move(vars), batch_size);
+#if defined(HEYOKA_HAVE_REAL128)
+    } else if constexpr (std::is_same_v<T, mppp::real128>) {
+        return add_cfunc_f128(s, name, fn, std::move(vars), batch_size);
+#endif
+    } else {
+        static_assert(detail::always_false_v<T>, "Unhandled type.");
+    }
+}
+
+// Add to the state s a function with the given name for the evaluation of the
+// Jacobian of the expressions fn with respect to the variables vars. The code is
+// generated via forward-mode differentiation, so that the subexpressions (and their
+// derivatives) are computed only once. The signature of the function is the same
+// as in add_cfunc(), and the derivative of the i-th expression with respect to the
+// j-th variable is written into out + (i * n_vars + j) * stride.
+HEYOKA_DLL_PUBLIC std::vector<expression> add_cfunc_jac_dbl(llvm_state &, const std::string &,
+                                                            const std::vector<expression> &, std::vector<expression>,
+                                                            std::uint32_t);
+HEYOKA_DLL_PUBLIC std::vector<expression> add_cfunc_jac_ldbl(llvm_state &, const std::string &,
+                                                             const std::vector<expression> &, std::vector<expression>,
+                                                             std::uint32_t);
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+HEYOKA_DLL_PUBLIC std::vector<expression> add_cfunc_jac_f128(llvm_state &, const std::string &,
+                                                             const std::vector<expression> &, std::vector<expression>,
+                                                             std::uint32_t);
+
+#endif
+
+template <typename T>
+std::vector<expression> add_cfunc_jac(llvm_state &s, const std::string &name, const std::vector<expression> &fn,
+                                      std::vector<expression> vars, std::uint32_t batch_size)
+{
+    if constexpr (std::is_same_v<T, double>) {
+        return add_cfunc_jac_dbl(s, name, fn, std::move(vars), batch_size);
+    } else if constexpr (std::is_same_v<T, long double>) {
+        return add_cfunc_jac_ldbl(s, name, fn, std::move(vars), batch_size);
+#if defined(HEYOKA_HAVE_REAL128)
+    } else if constexpr (std::is_same_v<T, mppp::real128>) {
+        return add_cfunc_jac_f128(s, name, fn, std::move(vars), batch_size);
+#endif
+    } else {
+        static_assert(detail::always_false_v<T>, "Unhandled type.");
+    }
+}
+
+// Add to the state s a function with the given name for the evaluation of the
+// expressions fn together with their Jacobian with respect to the parameters
+// par[0], ..., par[n_pars - 1] (n_pars being the number of parameters of fn). The
+// signature of the function is the same as in add_cfunc(). The value of the i-th
+// expression is written into out + i * (n_pars + 1) * stride, and its derivative with
+// respect to par[j] into out + (i * (n_pars + 1) + 1 + j) * stride. As in add_cfunc_jac(),
+// the code is generated via forward-mode differentiation.
+HEYOKA_DLL_PUBLIC std::vector<expression> add_cfunc_par_jac_dbl(llvm_state &, const std::string &,
+                                                                const std::vector<expression> &,
+                                                                std::vector<expression>, std::uint32_t);
+HEYOKA_DLL_PUBLIC std::vector<expression> add_cfunc_par_jac_ldbl(llvm_state &, const std::string &,
+                                                                 const std::vector<expression> &,
+                                                                 std::vector<expression>, std::uint32_t);
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+HEYOKA_DLL_PUBLIC std::vector<expression> add_cfunc_par_jac_f128(llvm_state &, const std::string &,
+                                                                 const std::vector<expression> &,
+                                                                 std::vector<expression>, std::uint32_t);
+
+#endif
+
+template <typename T>
+std::vector<expression> add_cfunc_par_jac(llvm_state &s, const std::string &name, const std::vector<expression> &fn,
+                                          std::vector<expression> vars, std::uint32_t batch_size)
+{
+    if constexpr (std::is_same_v<T, double>) {
+        return add_cfunc_par_jac_dbl(s, name, fn, std::move(vars), batch_size);
+    } else if constexpr (std::is_same_v<T, long double>) {
+        return add_cfunc_par_jac_ldbl(s, name, fn, std::move(vars), batch_size);
+#if defined(HEYOKA_HAVE_REAL128)
+    } else if constexpr (std::is_same_v<T, mppp::real128>) {
+        return add_cfunc_par_jac_f128(s, name, fn, std::move(vars), batch_size);
+#endif
+    } else {
+        static_assert(detail::always_false_v<T>, "Unhandled type.");
+    }
+}
+
+namespace detail
+{
+
+// Default SIMD batch size for a compiled function in the state s
+// (i.e., the natural vector width of the target).
+template <typename T>
+std::uint32_t cfunc_default_batch_size(const llvm_state &);
+
+} // namespace detail
+
+// Compiled function: the expressions in fn are JIT-compiled
+// into a scalar and a SIMD function for the evaluation
+// over contiguous arrays of input and output values. The
+// subexpressions common to several expressions are
+// evaluated only once per point.
+template <typename T>
+class HEYOKA_DLL_PUBLIC compiled_function
+{
+    // The LLVM machinery.
+    llvm_state m_llvm;
+    // The expressions and the variables.
+    std::vector<expression> m_fn;
+    std::vector<expression> m_vars;
+    // The SIMD batch size.
+    std::uint32_t m_batch_size;
+    // The number of parameters.
+    std::uint32_t m_n_pars;
+    // The compiled functions.
+    using cfunc_t = void (*)(T *, const T *, const T *, std::uint64_t);
+    cfunc_t m_f_scalar;
+    cfunc_t m_f_batch;
+
+    HEYOKA_DLL_LOCAL void fetch_functions();
+
+    // NOTE: apparently on Windows we need to re-iterate
+    // here that this is going to be dll-exported.
+    HEYOKA_DLL_PUBLIC void finalise_ctor_impl(std::vector<expression>, std::vector<expression>, std::uint32_t);
+    template <typename... KwArgs>
+    void finalise_ctor(std::vector<expression> fn, KwArgs &&...kw_args)
+    {
+        igor::parser p{kw_args...};
+
+        if constexpr (p.has_unnamed_arguments()) {
+            static_assert(detail::always_false_v<KwArgs...>,
+                          "The variadic arguments in the construction of a compiled function contain "
+                          "unnamed arguments.");
+        } else {
+            // The list of variables (defaults to empty,
+            // that is, deduce the variables from fn).
+            auto vars = [&p]() -> std::vector<expression> {
+                if constexpr (p.has(kw::vars)) {
+                    return std::forward<decltype(p(kw::vars))>(p(kw::vars));
+                } else {
+                    return {};
+                }
+            }();
+
+            // The SIMD batch size (defaults to zero, that is,
+            // the natural vector width for the target).
+            auto batch_size = [&p]() -> std::uint32_t {
+                if constexpr (p.has(kw::batch_size)) {
+                    return std::forward<decltype(p(kw::batch_size))>(p(kw::batch_size));
+                } else {
+                    return 0;
+                }
+            }();
+
+            finalise_ctor_impl(std::move(fn), std::move(vars), batch_size);
+        }
+    }
+
+public:
+    template <typename... KwArgs>
+    explicit compiled_function(std::vector<expression> fn, KwArgs &&...kw_args)
+        : m_llvm{std::forward<KwArgs>(kw_args)...}
+    {
+        finalise_ctor(std::move(fn), std::forward<KwArgs>(kw_args)...);
+    }
+
+    compiled_function(const compiled_function &);
+    compiled_function(compiled_function &&) noexcept;
+
+    compiled_function &operator=(const compiled_function &);
+    compiled_function &operator=(compiled_function &&) noexcept;
+
+    ~compiled_function();
+
+    const llvm_state &get_llvm_state() const;
+    const std::vector<expression> &get_fn() const;
+    const std::vector<expression> &get_vars() const;
+    std::uint32_t get_batch_size() const;
+
+    // Evaluation on a single point: in contains the values
+    // of the variables, out will contain the values of
+    // the expressions and pars the values of the parameters.
+    void operator()(T *, const T *, const T * = nullptr) const;
+    std::vector<T> operator()(const std::vector<T> &, const std::vector<T> & = {}) const;
+
+    // Evaluation on n_points points. in is a row-major array of size n_vars x n_points
+    // (the values of the i-th variable are in the i-th row), out is
+    // a row-major array of size n_fn x n_points.
+    void eval_batch(T *, const T *, std::size_t, const T * = nullptr) const;
+    void eval_batch(std::vector<T> &, const std::vector<T> &, std::size_t, const std::vector<T> & = {}) const;
+    // Multithreaded counterpart of eval_batch(), in which the points are split into chunks
+    // evaluated by n_threads threads (0 means the number of hardware threads). in and out
+    // are accessed in place, thus in can be, e.g., the data of a mapped_columns.
+    void eval_batch_parallel(T *, const T *, std::size_t, const T * = nullptr, unsigned = 0) const;
+};
+
+// Compiled population: each expression in pop is JIT-compiled into its own scalar
+// and SIMD function, and all the functions are added to a single module together
+// with a dispatcher selecting the function to be invoked via the index of
+// the expression. Compared to a compiled_function for each expression, the
+// setup of the JIT and the optimisation pipeline are run only once for the
+// whole population. Unless otherwise specified via kw::opt_level, the
+// optimisation level is 1.
+//
+// The keyword arguments are the same as in compiled_function.
+template <typename T>
+class HEYOKA_DLL_PUBLIC compiled_population
+{
+    // The LLVM machinery.
+    llvm_state m_llvm;
+    // The expressions and the variables.
+    std::vector<expression> m_pop;
+    std::vector<expression> m_vars;
+    // The SIMD batch size.
+    std::uint32_t m_batch_size;
+    // The number of parameters.
+    std::uint32_t m_n_pars;
+    // The dispatchers.
+    using dfunc_t = void (*)(std::uint64_t, T *, const T *, const T *, std::uint64_t);
+    dfunc_t m_d_scalar;
+    dfunc_t m_d_batch;
+
+    HEYOKA_DLL_LOCAL void fetch_functions();
+
+    HEYOKA_DLL_PUBLIC void finalise_ctor_impl(std::vector<expression>, std::vector<expression>, std::uint32_t);
+    template <typename... KwArgs>
+    void finalise_ctor(std::vector<expression> pop, KwArgs &&...kw_args)
+    {
+        igor::parser p{kw_args...};
+
+        if constexpr (p.has_unnamed_arguments()) {
+            static_assert(detail::always_false_v<KwArgs...>,
+                          "The variadic arguments in the construction of a compiled population contain "
+                          "unnamed arguments.");
+        } else {
+            auto vars = [&p]() -> std::vector<expression> {
+                if constexpr (p.has(kw::vars)) {
+                    return std::forward<decltype(p(kw::vars))>(p(kw::vars));
+                } else {
+                    return {};
+                }
+            }();
+
+            auto batch_size = [&p]() -> std::uint32_t {
+                if constexpr (p.has(kw::batch_size)) {
+                    return std::forward<decltype(p(kw::batch_size))>(p(kw::batch_size));
+                } else {
+                    return 0;
+                }
+            }();
+
+            finalise_ctor_impl(std::move(pop), std::move(vars), batch_size);
+        }
+    }
+
+    template <typename... KwArgs>
+    static llvm_state make_llvm_state(KwArgs &&...kw_args)
+    {
+        igor::parser p{kw_args...};
+
+        if constexpr (p.has(kw::opt_level)) {
+            return llvm_state{std::forward<KwArgs>(kw_args)...};
+        } else {
+            return llvm_state{std::forward<KwArgs>(kw_args)..., kw::opt_level = 1u};
+        }
+    }
+
+public:
+    template <typename... KwArgs>
+    explicit compiled_population(std::vector<expression> pop, KwArgs &&...kw_args)
+        : m_llvm(make_llvm_state(std::forward<KwArgs>(kw_args)...))
+    {
+        finalise_ctor(std::move(pop), std::forward<KwArgs>(kw_args)...);
+    }
+
+    compiled_population(const compiled_population &);
+    compiled_population(compiled_population &&) noexcept;
+
+    compiled_population &operator=(const compiled_population &);
+    compiled_population &operator=(compiled_population &&) noexcept;
+
+    ~compiled_population();
+
+    const llvm_state &get_llvm_state() const;
+    const std::vector<expression> &get_pop() const;
+    const std::vector<expression> &get_vars() const;
+    std::uint32_t get_batch_size() const;
+
+    // Evaluation of the expression with index idx on n_points points. in is a row-major
+    // array of size n_vars x n_points (the values of the i-th variable are in the i-th row),
+    // the n_points values of the expression are written into out.
+    void eval_batch(std::size_t, T *, const T *, std::size_t, const T * = nullptr) const;
+    // Evaluation of all the expressions: out is a row-major array of size pop.size() x n_points.
+    void eval_batch(std::vector<T> &, const std::vector<T> &, std::size_t, const std::vector<T> & = {}) const;
+};
+
+} // namespace heyoka
+
+#endif
@@ -0,0 +1,137 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef HEYOKA_DETAIL_BINARY_IO_HPP
+#define HEYOKA_DETAIL_BINARY_IO_HPP
+
+#include <heyoka/config.hpp>
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <heyoka/detail/fwd_decl.hpp>
+#include <heyoka/detail/visibility.hpp>
+
+// Minimal machinery for the binary serialisation of
+// the objects used in the integrator classes.
+// NOTE: the binary format is not portable across
+// architectures or different versions of heyoka.
+namespace heyoka::detail
+{
+
+// Arithmetic types and enums are written/read as raw bytes.
+template <typename T, std::enable_if_t<std::disjunction_v<std::is_arithmetic<T>, std::is_enum<T>>, int> = 0>
+inline void bin_save(std::ostream &os, const T &x)
+{
+    os.write(reinterpret_cast<const char *>(&x), sizeof(T));
+}
+
+template <typename T, std::enable_if_t<std::disjunction_v<std::is_arithmetic<T>, std::is_enum<T>>, int> = 0>
+inline void bin_load(std::istream &is, T &x)
+{
+    if (!is.read(reinterpret_cast<char *>(&x), sizeof(T))) {
+        throw std::invalid_argument("Error reading binary data from an input stream");
+    }
+}
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+inline void bin_save(std::ostream &os, const mppp::real128 &x)
+{
+    os.write(reinterpret_cast<const char *>(&x.m_value), sizeof(x.m_value));
+}
+
+inline void bin_load(std::istream &is, mppp::real128 &x)
+{
+    if (!is.read(reinterpret_cast<char *>(&x.m_value), sizeof(x.m_value))) {
+        throw std::invalid_argument("Error reading binary data from an input stream");
+    }
+}
+
+#endif
+
+// NOTE: strings are written as their size
+// followed by the characters.
+void bin_save(std::ostream &, const std::string &);
+void bin_load(std::istream &, std::string &);
+
+void bin_save(std::ostream &, const expression &);
+void bin_load(std::istream &, expression &);
+
+// Check whether the function with the given name can be deserialised, and
+// construct it from its arguments (without simplifications, as in the deserialisation).
+bool func_has_factory(const std::string &);
+expression func_from_factory(const std::string &, std::vector<expression> &&);
+
+// NOTE: forward declarations, so that the functions
+// for pairs and vectors can be nested.
+template <typename T>
+void bin_save(std::ostream &, const std::vector<T> &);
+template <typename T>
+void bin_load(std::istream &, std::vector<T> &);
+
+template <typename T, typename U>
+inline void bin_save(std::ostream &os, const std::pair<T, U> &p)
+{
+    bin_save(os, p.first);
+    bin_save(os, p.second);
+}
+
+template <typename T, typename U>
+inline void bin_load(std::istream &is, std::pair<T, U> &p)
+{
+    bin_load(is, p.first);
+    bin_load(is, p.second);
+}
+
+template <typename T>
+inline void bin_save(std::ostream &os, const std::vector<T> &v)
+{
+    static_assert(!std::is_same_v<T, bool>);
+
+    bin_save(os, static_cast<std::uint64_t>(v.size()));
+
+    for (const auto &x : v) {
+        bin_save(os, x);
+    }
+}
+
+template <typename T>
+inline void bin_load(std::istream &is, std::vector<T> &v)
+{
+    static_assert(!std::is_same_v<T, bool>);
+
+    std::uint64_t size = 0;
+    bin_load(is, size);
+
+    // NOTE: don't reserve() based on the size read from
+    // the stream, as it could be garbage.
+    std::vector<T> tmp;
+    for (std::uint64_t i = 0; i < size; ++i) {
+        tmp.emplace_back();
+        bin_load(is, tmp.back());
+    }
+
+    v = std::move(tmp);
+}
+
+} // namespace heyoka::detail
+
+#endif
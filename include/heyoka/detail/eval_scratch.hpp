@@ -0,0 +1,42 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef HEYOKA_DETAIL_EVAL_SCRATCH_HPP
+#define HEYOKA_DETAIL_EVAL_SCRATCH_HPP
+
+#include <vector>
+
+namespace heyoka::detail
+{
+
+// Handle to a per-thread scratch buffer for the batch evaluation of expressions.
+// The buffers of each thread are organised as a stack, so that nested evaluations
+// (e.g., in the recursive evaluation of the operands of a node) use distinct buffers.
+// The buffers are returned to the stack on destruction and their storage is kept, so that
+// the subsequent evaluations in the same thread do not allocate memory.
+class eval_scratch
+{
+    std::vector<double> *m_buf;
+
+public:
+    eval_scratch();
+    eval_scratch(const eval_scratch &) = delete;
+    eval_scratch(eval_scratch &&) = delete;
+    eval_scratch &operator=(const eval_scratch &) = delete;
+    eval_scratch &operator=(eval_scratch &&) = delete;
+    ~eval_scratch();
+
+    std::vector<double> &get()
+    {
+        return *m_buf;
+    }
+};
+
+} // namespace heyoka::detail
+
+#endif
@@ -14,6 +14,7 @@
 #include <initializer_list>
 #include <string>
 #include <typeinfo>
+#include <utility>
 #include <vector>
 
 #include <heyoka/detail/fwd_decl.hpp>
@@ -44,7 +45,7 @@ inline llvm::Type *to_llvm_vector_type(llvm::LLVMContext &c, std::uint32_t batch
 }
 
 HEYOKA_DLL_PUBLIC llvm::Value *load_vector_from_memory(ir_builder &, llvm::Value *, std::uint32_t);
-HEYOKA_DLL_PUBLIC void store_vector_to_memory(ir_builder &, llvm::Value *, llvm::Value *);
+HEYOKA_DLL_PUBLIC void store_vector_to_memory(ir_builder &, llvm::Value *, llvm::Value *, bool = false);
 
 HEYOKA_DLL_PUBLIC llvm::Value *vector_splat(ir_builder &, llvm::Value *, std::uint32_t);
 
@@ -54,6 +55,11 @@ HEYOKA_DLL_PUBLIC llvm::Value *scalars_to_vector(ir_builder &, const std::vector
 
 HEYOKA_DLL_PUBLIC llvm::Value *pairwise_sum(ir_builder &, std::vector<llvm::Value *> &);
 
+HEYOKA_DLL_PUBLIC llvm::Value *llvm_fma(llvm_state &, llvm::Value *, llvm::Value *, llvm::Value *);
+
+HEYOKA_DLL_PUBLIC llvm::Value *pairwise_sum_prod(llvm_state &, const std::vector<llvm::Value *> &,
+                                                 const std::vector<llvm::Value *> &);
+
 HEYOKA_DLL_PUBLIC llvm::Value *llvm_invoke_intrinsic(llvm_state &, const std::string &,
                                                      const std::vector<llvm::Type *> &,
                                                      const std::vector<llvm::Value *> &);
@@ -68,9 +74,22 @@ HEYOKA_DLL_PUBLIC llvm::Value *llvm_invoke_external(llvm_state &, const std::str
 HEYOKA_DLL_PUBLIC llvm::Value *llvm_invoke_internal(llvm_state &, const std::string &,
                                                     const std::vector<llvm::Value *> &);
 
+// Optimisation hints for the loops created by llvm_loop_u32(),
+// attached to the loop as llvm.loop metadata. Zero values
+// mean no hint.
+struct llvm_loop_hints {
+    // The unroll count (1 disables unrolling).
+    std::uint32_t unroll_count = 0;
+    // The vectorisation width (1 disables vectorisation).
+    std::uint32_t vectorize_width = 0;
+    // The interleave count.
+    std::uint32_t interleave_count = 0;
+};
+
 HEYOKA_DLL_PUBLIC void llvm_loop_u32(llvm_state &, llvm::Value *, llvm::Value *,
                                      const std::function<void(llvm::Value *)> &,
-                                     const std::function<llvm::Value *(llvm::Value *)> & = {});
+                                     const std::function<llvm::Value *(llvm::Value *)> & = {},
+                                     const llvm_loop_hints & = {});
 
 HEYOKA_DLL_PUBLIC void llvm_if_then_else(llvm_state &, llvm::Value *, const std::function<void()> &,
                                          const std::function<void()> &);
@@ -83,8 +102,27 @@ HEYOKA_DLL_PUBLIC bool compare_function_signature(llvm::Function *, llvm::Type *
 
 HEYOKA_DLL_PUBLIC llvm::Value *make_global_zero_array(llvm::Module &, llvm::ArrayType *);
 
+HEYOKA_DLL_PUBLIC llvm::GlobalVariable *make_global_const_array(llvm::Module &, llvm::Constant *);
+
 HEYOKA_DLL_PUBLIC llvm::Value *call_extern_vec(llvm_state &, llvm::Value *, const std::string &);
 
+HEYOKA_DLL_PUBLIC llvm::Value *llvm_invoke_sleef(llvm_state &, const std::string &, const std::vector<llvm::Value *> &);
+
+HEYOKA_DLL_PUBLIC std::pair<llvm::Value *, llvm::Value *> llvm_sleef_sincos(llvm_state &, llvm::Value *);
+
+// Double-length (i.e., double-double) addition, used by the compensated
+// summation of the time. The numbers are represented as unevaluated sums
+// hi + lo of two floating-point values (or vectors).
+// NOTE: this is not a double-double floating-point type, which is not
+// supported by the integrators.
+HEYOKA_DLL_PUBLIC std::pair<llvm::Value *, llvm::Value *> llvm_dl_add(llvm_state &, llvm::Value *, llvm::Value *,
+                                                                      llvm::Value *, llvm::Value *);
+
+// Step of the compensated Horner scheme.
+HEYOKA_DLL_PUBLIC std::pair<llvm::Value *, llvm::Value *> llvm_comp_horner_step(llvm_state &, llvm::Value *,
+                                                                                llvm::Value *, llvm::Value *,
+                                                                                llvm::Value *);
+
 } // namespace heyoka::detail
 
 #endif
@@ -0,0 +1,136 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef HEYOKA_DETAIL_NODE_META_HPP
+#define HEYOKA_DETAIL_NODE_META_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <heyoka/detail/fwd_decl.hpp>
+#include <heyoka/detail/visibility.hpp>
+
+namespace heyoka::detail
+{
+
+// The cached properties of a binary operator or of a function (see hash(),
+// get_n_nodes(), get_depth(), get_param_size() and get_variables()). The cache
+// is stored in the node shared among copies, it is filled lazily by the queries
+// and it is cleared whenever the node is accessed via the non-const getters
+// of binary_operator and func.
+// NOTE: the mutable references returned by the non-const getters must
+// thus not be used to modify a node after it has been queried.
+// NOTE: the cached hash value of a binary operator does not include
+// the type of the operator, which is not shared among copies.
+// NOTE: the members are accessed atomically, so that shared nodes can
+// be queried concurrently (racing threads store the same values).
+class node_meta
+{
+    static constexpr unsigned has_hash = 1, has_n_nodes = 2, has_depth = 4, has_param_size = 8;
+
+    mutable std::atomic<unsigned> m_flags{0};
+    mutable std::atomic<std::size_t> m_hash{0}, m_n_nodes{0}, m_depth{0};
+    mutable std::atomic<std::uint32_t> m_param_size{0};
+    // NOTE: this is accessed via the atomic functions for shared_ptr.
+    mutable std::shared_ptr<const std::vector<std::string>> m_vars;
+
+    template <typename T>
+    bool get(unsigned flag, const std::atomic<T> &val, T &out) const
+    {
+        if ((m_flags.load(std::memory_order_acquire) & flag) == 0u) {
+            return false;
+        }
+
+        out = val.load(std::memory_order_relaxed);
+
+        return true;
+    }
+
+    template <typename T>
+    void set(unsigned flag, std::atomic<T> &val, T x) const
+    {
+        val.store(x, std::memory_order_relaxed);
+        m_flags.fetch_or(flag, std::memory_order_release);
+    }
+
+public:
+    node_meta() = default;
+    // NOTE: the copies start with an empty cache.
+    node_meta(const node_meta &) noexcept {}
+    node_meta &operator=(const node_meta &) noexcept
+    {
+        reset();
+
+        return *this;
+    }
+    ~node_meta() = default;
+
+    void reset() noexcept
+    {
+        m_flags.store(0, std::memory_order_relaxed);
+        std::atomic_store(&m_vars, std::shared_ptr<const std::vector<std::string>>{});
+    }
+
+    bool get_hash(std::size_t &out) const
+    {
+        return get(has_hash, m_hash, out);
+    }
+    void set_hash(std::size_t x) const
+    {
+        set(has_hash, m_hash, x);
+    }
+
+    bool get_n_nodes(std::size_t &out) const
+    {
+        return get(has_n_nodes, m_n_nodes, out);
+    }
+    void set_n_nodes(std::size_t x) const
+    {
+        set(has_n_nodes, m_n_nodes, x);
+    }
+
+    bool get_depth(std::size_t &out) const
+    {
+        return get(has_depth, m_depth, out);
+    }
+    void set_depth(std::size_t x) const
+    {
+        set(has_depth, m_depth, x);
+    }
+
+    bool get_param_size(std::uint32_t &out) const
+    {
+        return get(has_param_size, m_param_size, out);
+    }
+    void set_param_size(std::uint32_t x) const
+    {
+        set(has_param_size, m_param_size, x);
+    }
+
+    // NOTE: null if the variables have not been cached.
+    std::shared_ptr<const std::vector<std::string>> get_variables() const
+    {
+        return std::atomic_load(&m_vars);
+    }
+    void set_variables(std::shared_ptr<const std::vector<std::string>> v) const
+    {
+        std::atomic_store(&m_vars, std::move(v));
+    }
+};
+
+// The cache of the node ex (null for numbers, variables and params).
+HEYOKA_DLL_PUBLIC const node_meta *node_meta_ptr(const expression &);
+
+} // namespace heyoka::detail
+
+#endif
@@ -0,0 +1,240 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef HEYOKA_DETAIL_POLY_ROOTS_HPP
+#define HEYOKA_DETAIL_POLY_ROOTS_HPP
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <limits>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+// Utilities for the real root isolation of polynomials,
+// used in event and collision detection.
+
+namespace heyoka::detail
+{
+
+// Evaluate the polynomial with coefficients cf
+// (in ascending order) at x via the Horner scheme.
+template <typename T>
+inline T poly_eval(const std::vector<T> &cf, T x)
+{
+    assert(!cf.empty());
+
+    auto retval = cf.back();
+    for (auto i = cf.size() - 1u; i > 0u; --i) {
+        retval = cf[i - 1u] + retval * x;
+    }
+
+    return retval;
+}
+
+// Evaluate the first derivative of the polynomial
+// with coefficients cf (in ascending order) at x.
+template <typename T>
+inline T poly_eval_der(const std::vector<T> &cf, T x)
+{
+    assert(!cf.empty());
+
+    T retval(0);
+    for (auto i = cf.size() - 1u; i > 0u; --i) {
+        retval = cf[i] * static_cast<T>(i) + retval * x;
+    }
+
+    return retval;
+}
+
+// Transform in place the polynomial p(x) with coefficients
+// cf (in ascending order) into p(x + 1).
+template <typename T>
+inline void poly_translate_1(std::vector<T> &cf)
+{
+    const auto n = cf.size();
+
+    for (decltype(cf.size()) i = 0; i + 1u < n; ++i) {
+        for (auto j = n - 1u; j > i; --j) {
+            cf[j - 1u] += cf[j];
+        }
+    }
+}
+
+// Count the sign changes in the coefficients cf, ignoring zeroes.
+template <typename T>
+inline std::uint32_t poly_n_sign_changes(const std::vector<T> &cf)
+{
+    std::uint32_t retval = 0;
+    int last_sign = 0;
+
+    for (const auto &c : cf) {
+        const auto cur_sign = static_cast<int>(c > 0) - static_cast<int>(c < 0);
+
+        if (cur_sign != 0) {
+            retval += static_cast<std::uint32_t>(last_sign != 0 && cur_sign != last_sign);
+            last_sign = cur_sign;
+        }
+    }
+
+    return retval;
+}
+
+// Upper bound on the number of roots in (0, 1) of the polynomial with
+// coefficients cf, via Descartes' rule of signs applied
+// to (x + 1)**n * p(1 / (x + 1)). tmp is a temporary buffer.
+template <typename T>
+inline std::uint32_t poly_descartes_01(const std::vector<T> &cf, std::vector<T> &tmp)
+{
+    tmp.assign(cf.rbegin(), cf.rend());
+    poly_translate_1(tmp);
+
+    return poly_n_sign_changes(tmp);
+}
+
+// Locate via bisection the root in (0, 1) of the polynomial with coefficients
+// cf. The polynomial is assumed to have a single root in (0, 1), and cf[0] must
+// be nonzero.
+template <typename T>
+inline T poly_bisect_01(const std::vector<T> &cf)
+{
+    assert(!cf.empty());
+    assert(cf[0] != 0);
+
+    const auto sign_lo = cf[0] > 0;
+    T lo(0), hi(1);
+
+    for (auto i = 0; i < std::numeric_limits<T>::digits + 2; ++i) {
+        const auto mid = lo + (hi - lo) / 2;
+
+        if (mid <= lo || mid >= hi) {
+            // We cannot refine the interval any further.
+            break;
+        }
+
+        const auto val = poly_eval(cf, mid);
+        if (val == 0) {
+            return mid;
+        }
+
+        if ((val > 0) == sign_lo) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+
+    return lo + (hi - lo) / 2;
+}
+
+// Remove the roots in zero from the polynomial with coefficients cf
+// (i.e., divide it by x until cf[0] is nonzero). Returns true
+// if roots in zero were found.
+template <typename T>
+inline bool poly_strip_zero_roots(std::vector<T> &cf)
+{
+    assert(!cf.empty());
+
+    auto it = cf.begin();
+    for (; it + 1 != cf.end() && *it == 0; ++it) {
+    }
+
+    if (it == cf.begin()) {
+        return false;
+    }
+
+    cf.erase(cf.begin(), it);
+
+    return true;
+}
+
+// Find the real roots in [0, 1) of the polynomial with coefficients cf (in ascending order),
+// appending them to roots (in no particular order). The roots are isolated via the
+// Vincent-Collins-Akritas bisection method (based on Descartes' rule of signs) and then
+// refined via bisection. Roots of even multiplicity may be missed, and clusters of roots
+// which cannot be separated in the working precision are reported as a single root.
+// tmp is a temporary buffer.
+template <typename T>
+inline void poly_find_roots_01(std::vector<T> cf, std::vector<T> &roots, std::vector<T> &tmp)
+{
+    assert(!cf.empty());
+
+    if (std::all_of(cf.begin(), cf.end(), [](const auto &c) { return c == 0; })) {
+        // Identically zero polynomial, don't report any root.
+        return;
+    }
+
+    // Handle the root(s) in zero.
+    if (poly_strip_zero_roots(cf)) {
+        roots.emplace_back(0);
+    }
+
+    // NOTE: limit the total number of subdivisions
+    // in order to prevent pathological runtimes.
+    constexpr auto max_n_iter = 1000u;
+    auto n_iter = 0u;
+
+    // The list of intervals to be examined. Each interval
+    // is represented by its bounds lb and ub, and by the
+    // coefficients of the polynomial q(x) = p(lb + (ub - lb) * x).
+    std::vector<std::tuple<T, T, std::vector<T>>> wlist;
+    wlist.emplace_back(T(0), T(1), std::move(cf));
+
+    while (!wlist.empty()) {
+        auto [lb, ub, q] = std::move(wlist.back());
+        wlist.pop_back();
+
+        const auto n_sc = poly_descartes_01(q, tmp);
+
+        if (n_sc == 0u) {
+            // No roots in the interval.
+            continue;
+        }
+
+        if (n_sc == 1u) {
+            // Exactly one root in the interval, refine it.
+            roots.push_back(lb + (ub - lb) * poly_bisect_01(q));
+            continue;
+        }
+
+        if (ub - lb <= std::numeric_limits<T>::epsilon() || ++n_iter > max_n_iter) {
+            // The interval cannot be subdivided any further,
+            // report its midpoint as a root.
+            roots.push_back(lb + (ub - lb) / 2);
+            continue;
+        }
+
+        // Split the interval in two halves. The polynomial
+        // for the left half is q(x / 2), the polynomial for the
+        // right half is q((x + 1) / 2).
+        const auto mid = lb + (ub - lb) / 2;
+
+        auto q_left = std::move(q);
+        T fac(1);
+        for (auto &c : q_left) {
+            c *= fac;
+            fac /= 2;
+        }
+
+        auto q_right = q_left;
+        poly_translate_1(q_right);
+
+        // Check if the midpoint is a root.
+        if (poly_strip_zero_roots(q_right)) {
+            roots.push_back(mid);
+        }
+
+        wlist.emplace_back(mid, ub, std::move(q_right));
+        wlist.emplace_back(lb, mid, std::move(q_left));
+    }
+}
+
+} // namespace heyoka::detail
+
+#endif
@@ -0,0 +1,65 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef HEYOKA_DETAIL_RUN_WORKERS_HPP
+#define HEYOKA_DETAIL_RUN_WORKERS_HPP
+
+#include <cassert>
+#include <exception>
+#include <thread>
+#include <vector>
+
+namespace heyoka::detail
+{
+
+// Run worker_func(i) for i in [0, n_threads), using a separate thread
+// for each worker (the current thread is used as the first worker).
+// stop is invoked to stop the workers already running if the creation of
+// a thread fails. The exceptions thrown by the workers are expected
+// to be stored in eptrs: the first one, if any, is re-thrown here.
+template <typename F, typename S>
+inline void run_workers(unsigned n_threads, const F &worker_func, const S &stop,
+                        const std::vector<std::exception_ptr> &eptrs)
+{
+    assert(n_threads > 0u);
+    assert(eptrs.size() == n_threads);
+
+    std::vector<std::thread> threads;
+    try {
+        for (unsigned i = 1; i < n_threads; ++i) {
+            threads.emplace_back(worker_func, i);
+        }
+    } catch (...) {
+        // Failure in the creation of a thread: stop
+        // the threads already created and re-throw.
+        stop();
+
+        for (auto &thr : threads) {
+            thr.join();
+        }
+
+        throw;
+    }
+
+    worker_func(0);
+
+    for (auto &thr : threads) {
+        thr.join();
+    }
+
+    // Re-throw the first exception, if any.
+    for (const auto &eptr : eptrs) {
+        if (eptr) {
+            std::rethrow_exception(eptr);
+        }
+    }
+}
+
+} // namespace heyoka::detail
+
+#endif
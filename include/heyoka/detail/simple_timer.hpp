@@ -38,6 +38,24 @@ private:
     const std::chrono::high_resolution_clock::time_point m_start;
 };
 
+// RAII helper to accumulate into out the wall-clock
+// time (in seconds) elapsed during its lifetime.
+class time_accumulator
+{
+public:
+    explicit time_accumulator(double &out) : m_out(out), m_start(std::chrono::steady_clock::now()) {}
+    time_accumulator(const time_accumulator &) = delete;
+    time_accumulator &operator=(const time_accumulator &) = delete;
+    ~time_accumulator()
+    {
+        m_out += std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count();
+    }
+
+private:
+    double &m_out;
+    const std::chrono::steady_clock::time_point m_start;
+};
+
 } // namespace heyoka::detail
 
 #endif
@@ -12,14 +12,14 @@
 #include <cstdint>
 #include <string>
 
+#include <heyoka/detail/fwd_decl.hpp>
 #include <heyoka/detail/llvm_fwd.hpp>
 #include <heyoka/detail/visibility.hpp>
 
 namespace heyoka::detail
 {
 
-HEYOKA_DLL_PUBLIC std::string sleef_function_name(llvm::LLVMContext &, const std::string &, llvm::Type *,
-                                                  std::uint32_t);
+HEYOKA_DLL_PUBLIC std::string sleef_function_name(llvm_state &, const std::string &, llvm::Type *, std::uint32_t);
 
 } // namespace heyoka::detail
 
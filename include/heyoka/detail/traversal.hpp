@@ -0,0 +1,166 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef HEYOKA_DETAIL_TRAVERSAL_HPP
+#define HEYOKA_DETAIL_TRAVERSAL_HPP
+
+#include <cassert>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include <heyoka/detail/visibility.hpp>
+#include <heyoka/expression.hpp>
+
+// Non-recursive traversals of expressions. The traversals use an explicit
+// stack, so that the depth of the expressions is limited only by the available
+// memory, and they visit the subexpressions shared among copies
+// (see the copy-on-write semantics of binary_operator and func) only once.
+
+namespace heyoka::detail
+{
+
+// The identity of the node ex: this is shared among the copies of ex,
+// and it is null for numbers, variables and params.
+HEYOKA_DLL_PUBLIC const void *node_key(const expression &);
+
+// The range of the arguments of ex (empty for numbers, variables and params).
+HEYOKA_DLL_PUBLIC std::pair<const expression *, const expression *> node_args(const expression &);
+
+// Rebuild the binary operator or the function ex with the arguments
+// in the range [b, b + n), where n is the number of arguments of ex.
+HEYOKA_DLL_PUBLIC expression node_rebuild(const expression &, expression *);
+
+// Post-order fold of the expression ex.
+//
+// The nodes for which descend() returns false, and the nodes without
+// arguments, are mapped to R via leaf(). The other nodes are mapped to R via
+// node(), which is passed the node and a pointer to the results of its arguments.
+// The results for the nodes with a non-null node_key() are memoised in memo,
+// which can be shared among several folds, as long as the nodes it refers
+// to are alive.
+template <typename R, typename Leaf, typename Node, typename Descend>
+inline R fold_postorder(const expression &ex, Leaf &&leaf, Node &&node, Descend &&descend,
+                        std::unordered_map<const void *, R> &memo)
+{
+    // The stack of nodes to be visited, with a flag
+    // signalling whether the arguments of the node
+    // have already been pushed to the stack.
+    std::vector<std::pair<const expression *, bool>> stack{{&ex, false}};
+    // The stack of results.
+    std::vector<R> res;
+
+    while (!stack.empty()) {
+        const auto [cur, expanded] = stack.back();
+        stack.pop_back();
+
+        const auto key = node_key(*cur);
+
+        if (!expanded) {
+            if (key == nullptr) {
+                res.push_back(leaf(*cur));
+                continue;
+            }
+
+            if (auto it = memo.find(key); it != memo.end()) {
+                res.push_back(it->second);
+                continue;
+            }
+
+            if (!descend(*cur)) {
+                auto r = leaf(*cur);
+                memo.emplace(key, r);
+                res.push_back(std::move(r));
+                continue;
+            }
+
+            stack.emplace_back(cur, true);
+
+            // NOTE: push the arguments in reverse order,
+            // so that they are visited in order.
+            const auto [b, e] = node_args(*cur);
+            for (auto it = e; it != b;) {
+                stack.emplace_back(--it, false);
+            }
+        } else {
+            const auto [b, e] = node_args(*cur);
+            const auto n_args = static_cast<decltype(res.size())>(e - b);
+            assert(res.size() >= n_args);
+
+            auto r = node(*cur, res.data() + (res.size() - n_args));
+            res.erase(res.end() - static_cast<typename std::vector<R>::difference_type>(n_args), res.end());
+
+            memo.emplace(key, r);
+            res.push_back(std::move(r));
+        }
+    }
+
+    assert(res.size() == 1u);
+
+    return std::move(res.back());
+}
+
+template <typename R, typename Leaf, typename Node, typename Descend>
+inline R fold_postorder(const expression &ex, Leaf &&leaf, Node &&node, Descend &&descend)
+{
+    std::unordered_map<const void *, R> memo;
+
+    return fold_postorder<R>(ex, std::forward<Leaf>(leaf), std::forward<Node>(node), std::forward<Descend>(descend),
+                             memo);
+}
+
+// Post-order transformation of the expression ex: the nodes without arguments
+// are replaced by leaf(), the other nodes are rebuilt with the transformed arguments
+// (the nodes whose arguments are not changed are shared with ex). The transformed
+// nodes are memoised in memo, which can be shared among several transformations
+// with the same leaf() (see fold_postorder()).
+template <typename Leaf>
+inline expression transform_postorder(const expression &ex, Leaf &&leaf,
+                                      std::unordered_map<const void *, expression> &memo)
+{
+    return fold_postorder<expression>(
+        ex, std::forward<Leaf>(leaf), [](const expression &n, expression *args) { return node_rebuild(n, args); },
+        [](const expression &) { return true; }, memo);
+}
+
+template <typename Leaf>
+inline expression transform_postorder(const expression &ex, Leaf &&leaf)
+{
+    std::unordered_map<const void *, expression> memo;
+
+    return transform_postorder(ex, std::forward<Leaf>(leaf), memo);
+}
+
+// Pre-order visit of the unique nodes of the expression ex.
+template <typename F>
+inline void visit_unique(const expression &ex, F &&f)
+{
+    std::vector<const expression *> stack{&ex};
+    std::unordered_set<const void *> visited;
+
+    while (!stack.empty()) {
+        const auto cur = stack.back();
+        stack.pop_back();
+
+        if (const auto key = node_key(*cur); key != nullptr && !visited.insert(key).second) {
+            continue;
+        }
+
+        f(*cur);
+
+        const auto [b, e] = node_args(*cur);
+        for (auto it = e; it != b;) {
+            stack.push_back(--it);
+        }
+    }
+}
+
+} // namespace heyoka::detail
+
+#endif
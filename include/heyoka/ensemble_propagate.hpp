@@ -0,0 +1,190 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef HEYOKA_ENSEMBLE_PROPAGATE_HPP
+#define HEYOKA_ENSEMBLE_PROPAGATE_HPP
+
+#include <heyoka/config.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <heyoka/detail/visibility.hpp>
+#include <heyoka/taylor.hpp>
+
+namespace heyoka
+{
+
+// Online statistics of a set of vectors of size dim (e.g., the final states of the iterations of an
+// ensemble propagation): the number of samples, the mean, the covariance matrix and, optionally,
+// the histograms of the components, with n_bins equally-sized bins spanning the range [lb[i], ub[i])
+// for the i-th component (the values outside the range are not counted). The mean and the covariance
+// matrix are updated sample by sample via Welford's algorithm, so that the memory occupied by the
+// accumulator does not depend on the number of samples, and two accumulators can be merged
+// (e.g., the per-thread accumulators of an ensemble propagation).
+template <typename T>
+class HEYOKA_DLL_PUBLIC ensemble_stats
+{
+    std::uint32_t m_dim = 0;
+    std::size_t m_count = 0;
+    std::vector<T> m_mean;
+    // The sums of the products of the deviations
+    // from the mean (row-major dim x dim matrix).
+    std::vector<T> m_m2;
+    std::uint32_t m_n_bins = 0;
+    std::vector<T> m_lb, m_ub;
+    // The histograms (row-major dim x n_bins matrix).
+    std::vector<std::size_t> m_hist;
+    // Scratch buffer used in add().
+    std::vector<T> m_delta;
+
+public:
+    ensemble_stats();
+    explicit ensemble_stats(std::uint32_t);
+    explicit ensemble_stats(std::uint32_t, std::uint32_t, std::vector<T>, std::vector<T>);
+
+    // Add the sample whose i-th component is x[i * stride].
+    void add(const T *, std::size_t = 1);
+    void merge(const ensemble_stats &);
+
+    std::uint32_t get_dim() const;
+    std::size_t get_count() const;
+    const std::vector<T> &get_mean() const;
+    // NOTE: the sample covariance matrix (row-major dim x dim),
+    // which requires at least two samples.
+    std::vector<T> get_cov() const;
+
+    std::uint32_t get_n_bins() const;
+    const std::vector<T> &get_lb() const;
+    const std::vector<T> &get_ub() const;
+    const std::vector<std::size_t> &get_hist() const;
+};
+
+// Ensemble propagation: propagate n_iter copies of the integrator tmpl up to the time t,
+// using multiple threads of execution. Before the propagation, each copy is reset to the
+// state, time and parameters of tmpl, and then the generator gen is invoked with the copy
+// and the iteration index as arguments (so that, e.g., the initial conditions can be altered).
+// The copies are reused across iterations (that is, the LLVM code is never recompiled),
+// and they share the compiled code of tmpl unless compact mode is active. Each copy is
+// created (and thus its memory is first touched) by its own worker thread, so that on NUMA
+// machines the state of each copy lives on the memory node of its worker. The exceptions
+// thrown while creating the copies are propagated to the caller. max_steps is forwarded
+// to propagate_until(), n_threads is the number of worker threads (0 means the number
+// of hardware threads).
+//
+// The return value contains, for each iteration:
+// - the outcome of propagate_until(),
+// - the min/max timesteps,
+// - the total number of steps,
+// - the final time,
+// - the final state.
+//
+// NOTE: gen (and the event callbacks, if any) will be invoked concurrently
+// from multiple threads.
+//
+// NOTE: for ensembles distributed across multiple processes (e.g., MPI ranks),
+// tmpl can be constructed in a single process and sent to the other processes
+// via save()/load(): the loaded integrators include the object code, and thus
+// they do not need to be recompiled. Each process can then propagate a chunk of
+// the iterations, with gen offsetting the iteration index by the beginning of the chunk.
+template <typename T>
+HEYOKA_DLL_PUBLIC std::vector<std::tuple<taylor_outcome, T, T, std::size_t, T, std::vector<T>>>
+ensemble_propagate_until(const taylor_adaptive<T> &, T, std::size_t,
+                         const std::function<void(taylor_adaptive<T> &, std::size_t)> &, std::size_t = 0,
+                         unsigned = 0);
+
+// Reduction variants of ensemble_propagate_until(): instead of returning the result of each iteration,
+// the final states are accumulated into per-thread copies of the (empty) accumulator proto, which
+// are merged at the end. Only the iterations reaching the time t are accumulated, and the indices
+// of the other iterations are returned (in ascending order) together with the accumulator.
+// In ensemble_propagate_grid_stats(), the states at the time points of the grid (see propagate_grid())
+// are accumulated into one accumulator per time point, and only the time points that were reached
+// are accumulated.
+// NOTE: the order in which the samples are accumulated depends on the scheduling
+// of the iterations, thus the results are not bitwise reproducible across runs.
+template <typename T>
+HEYOKA_DLL_PUBLIC std::pair<ensemble_stats<T>, std::vector<std::size_t>>
+ensemble_propagate_until_stats(const taylor_adaptive<T> &, T, std::size_t,
+                               const std::function<void(taylor_adaptive<T> &, std::size_t)> &,
+                               const ensemble_stats<T> &, std::size_t = 0, unsigned = 0);
+
+template <typename T>
+HEYOKA_DLL_PUBLIC std::vector<ensemble_stats<T>>
+ensemble_propagate_grid_stats(const taylor_adaptive<T> &, const std::vector<T> &, std::size_t,
+                              const std::function<void(taylor_adaptive<T> &, std::size_t)> &,
+                              const ensemble_stats<T> &, std::size_t = 0, unsigned = 0);
+
+// Batch counterpart of ensemble_propagate_until(): the iterations are processed in the batch
+// slots of n_threads copies of the batch integrator tmpl. Whenever one of the slots of a copy
+// finishes its propagation up to the time t, the slot is immediately refilled with the next
+// pending iteration, so that no SIMD lane idles while the other lanes are still being propagated.
+// Before invoking the generator gen with the copy, the slot index and the iteration index as
+// arguments, the slot is reset to the state, time and parameters of the corresponding slot of tmpl.
+// The generator is expected to alter only the values of the slot it has been invoked for.
+//
+// max_steps is the maximum number of steps for each iteration. The return value has the same
+// structure as in ensemble_propagate_until().
+template <typename T>
+HEYOKA_DLL_PUBLIC std::vector<std::tuple<taylor_outcome, T, T, std::size_t, T, std::vector<T>>>
+ensemble_propagate_until_batch(const taylor_adaptive_batch<T> &, T, std::size_t,
+                               const std::function<void(taylor_adaptive_batch<T> &, std::uint32_t, std::size_t)> &,
+                               std::size_t = 0, unsigned = 0);
+
+// Reduction variant of ensemble_propagate_until_batch() (see ensemble_propagate_until_stats()).
+// The final states are accumulated directly from the batch slots of the workers.
+template <typename T>
+HEYOKA_DLL_PUBLIC std::pair<ensemble_stats<T>, std::vector<std::size_t>> ensemble_propagate_until_batch_stats(
+    const taylor_adaptive_batch<T> &, T, std::size_t,
+    const std::function<void(taylor_adaptive_batch<T> &, std::uint32_t, std::size_t)> &, const ensemble_stats<T> &,
+    std::size_t = 0, unsigned = 0);
+
+// An independent scalar propagation job for ensemble_propagate_jobs_batch(): the propagation
+// of the state vector state (with the parameter values pars) from the time time to the time final_time.
+template <typename T>
+struct propagate_job {
+    std::vector<T> state;
+    std::vector<T> pars;
+    T time = 0;
+    T final_time = 0;
+};
+
+// Lane-packing scheduler: propagate the independent scalar jobs, all referring to the ODE system
+// of the batch integrator tmpl, in the batch slots of the workers of ensemble_propagate_until_batch().
+// Whenever a job is finished, its batch slot is immediately refilled with the next pending job. The
+// return value contains the results of the jobs, with the same structure as in ensemble_propagate_until().
+template <typename T>
+HEYOKA_DLL_PUBLIC std::vector<std::tuple<taylor_outcome, T, T, std::size_t, T, std::vector<T>>>
+ensemble_propagate_jobs_batch(const taylor_adaptive_batch<T> &, const std::vector<propagate_job<T>> &,
+                              std::size_t = 0, unsigned = 0);
+
+// Parameter sweep: propagate up to the time t the initial conditions of the batch integrator tmpl
+// with each of the parameter sets in pars, which is a row-major matrix with one row of n_pars values
+// per parameter set (where n_pars is the number of parameters of tmpl per batch slot). The parameter
+// sets are packed into the batch slots of the workers of ensemble_propagate_until_batch(), so that
+// both the SIMD lanes and the worker threads are filled, and the code is compiled only once (in tmpl).
+//
+// The return value contains the outcomes of the propagations (one per parameter set), and the final
+// states as a row-major matrix with one row of dim values per parameter set.
+template <typename T>
+HEYOKA_DLL_PUBLIC std::pair<std::vector<taylor_outcome>, std::vector<T>>
+ensemble_sweep_pars_batch(const taylor_adaptive_batch<T> &, T, const std::vector<T> &, std::size_t = 0,
+                          unsigned = 0);
+
+} // namespace heyoka
+
+#endif
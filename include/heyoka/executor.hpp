@@ -0,0 +1,153 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef HEYOKA_EXECUTOR_HPP
+#define HEYOKA_EXECUTOR_HPP
+
+#include <heyoka/config.hpp>
+
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <memory>
+#include <ostream>
+#include <tuple>
+#include <vector>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <heyoka/detail/visibility.hpp>
+#include <heyoka/taylor.hpp>
+
+namespace heyoka
+{
+
+// Policies for the pinning of the worker threads to the CPUs available to the process
+// (i.e., the CPUs in the affinity mask of the thread creating the workers):
+// - none: the workers are not pinned,
+// - compact: the i-th worker is pinned to the i-th available CPU, with the CPUs ordered
+//   by NUMA node, so that the workers fill a node before moving to the next one,
+// - scatter: the workers are distributed round-robin across the NUMA nodes and, within
+//   each node, across the physical cores before using their SMT siblings.
+// If there are more workers than available CPUs, the CPUs are reused cyclically.
+// NOTE: the integrators created by a pinned worker (e.g., the per-thread copies in the
+// ensemble propagations) are first-touched, and thus allocated, on the NUMA node of the worker.
+// NOTE: pinning is supported only on Linux, elsewhere the policy is ignored.
+enum class pin_policy { none, compact, scatter };
+
+HEYOKA_DLL_PUBLIC std::ostream &operator<<(std::ostream &, pin_policy);
+
+// Configuration of the worker threads of the executors and of the ensemble propagations:
+// the number of threads used when the number of threads is not specified (0 meaning
+// the number of hardware threads) and the pinning policy. The initial configuration
+// is read from the environment variables HEYOKA_NUM_THREADS and HEYOKA_PIN_POLICY
+// ("none", "compact" or "scatter").
+// NOTE: the configuration is read by the executors upon construction and by the
+// ensemble propagations upon invocation.
+struct HEYOKA_DLL_PUBLIC thread_config {
+    unsigned n_threads = 0;
+    pin_policy pinning = pin_policy::none;
+};
+
+HEYOKA_DLL_PUBLIC thread_config get_thread_config();
+HEYOKA_DLL_PUBLIC void set_thread_config(const thread_config &);
+
+namespace detail
+{
+
+// Parse the thread configuration from the environment variables.
+HEYOKA_DLL_PUBLIC thread_config thread_config_from_env();
+
+// Number of worker threads for the requested number n_threads
+// (0 meaning the default, see thread_config).
+HEYOKA_DLL_PUBLIC unsigned resolve_n_threads(unsigned);
+
+// Pin the calling thread as the worker with index idx according to the policy p.
+// The original affinity of the thread is restored upon destruction.
+class HEYOKA_DLL_PUBLIC thread_pin_guard
+{
+    std::vector<unsigned> m_orig_cpus;
+    bool m_pinned = false;
+
+public:
+    explicit thread_pin_guard(pin_policy, unsigned);
+    thread_pin_guard(const thread_pin_guard &) = delete;
+    thread_pin_guard(thread_pin_guard &&) = delete;
+    thread_pin_guard &operator=(const thread_pin_guard &) = delete;
+    thread_pin_guard &operator=(thread_pin_guard &&) = delete;
+    ~thread_pin_guard();
+
+    bool pinned() const;
+};
+
+} // namespace detail
+
+// Thread pool for the asynchronous execution of tasks. The tasks
+// are run in the order of submission by n_threads worker threads (0 means
+// the default number of threads, see thread_config), which are pinned
+// according to the pinning policy (which defaults to the policy in the
+// thread configuration). The destructor waits for the completion
+// of all the submitted tasks.
+class HEYOKA_DLL_PUBLIC executor
+{
+    struct impl;
+
+    std::unique_ptr<impl> m_impl;
+
+public:
+    explicit executor(unsigned = 0);
+    explicit executor(unsigned, pin_policy);
+    executor(const executor &) = delete;
+    executor(executor &&) = delete;
+    executor &operator=(const executor &) = delete;
+    executor &operator=(executor &&) = delete;
+    ~executor();
+
+    unsigned get_n_threads() const;
+    pin_policy get_pin_policy() const;
+
+    // Submit a task for execution.
+    // NOTE: the exceptions thrown by the task are
+    // discarded (the async propagate functions below
+    // transport them via the returned futures).
+    void submit(std::function<void()>);
+};
+
+// The executor used by default in the async propagate functions
+// (which is created on first use, with the thread configuration in effect at that time).
+HEYOKA_DLL_PUBLIC executor &default_executor();
+
+// Asynchronous counterparts of the propagate_until()/propagate_for() member
+// functions of the integrators, which are run as tasks in the executor ex. The
+// returned futures hold the return values of the propagate functions (or the
+// exceptions thrown by them).
+// NOTE: the integrator must not be accessed (and it must not be destroyed)
+// until the future becomes ready.
+template <typename T>
+HEYOKA_DLL_PUBLIC std::future<std::tuple<taylor_outcome, T, T, std::size_t>>
+propagate_until_async(taylor_adaptive<T> &, T, std::size_t = 0, executor & = default_executor());
+
+template <typename T>
+HEYOKA_DLL_PUBLIC std::future<std::tuple<taylor_outcome, T, T, std::size_t>>
+propagate_for_async(taylor_adaptive<T> &, T, std::size_t = 0, executor & = default_executor());
+
+template <typename T>
+HEYOKA_DLL_PUBLIC std::future<std::vector<std::tuple<taylor_outcome, T, T, std::size_t>>>
+propagate_until_async(taylor_adaptive_batch<T> &, std::vector<T>, std::size_t = 0, executor & = default_executor());
+
+template <typename T>
+HEYOKA_DLL_PUBLIC std::future<std::vector<std::tuple<taylor_outcome, T, T, std::size_t>>>
+propagate_for_async(taylor_adaptive_batch<T> &, std::vector<T>, std::size_t = 0, executor & = default_executor());
+
+} // namespace heyoka
+
+#endif
@@ -15,6 +15,7 @@
 #include <cstddef>
 #include <cstdint>
 #include <functional>
+#include <istream>
 #include <ostream>
 #include <stdexcept>
 #include <string>
@@ -167,6 +168,12 @@ HEYOKA_DLL_PUBLIC std::ostream &operator<<(std::ostream &, const expression &);
 HEYOKA_DLL_PUBLIC std::vector<std::string> get_variables(const expression &);
 HEYOKA_DLL_PUBLIC void rename_variables(expression &, const std::unordered_map<std::string, std::string> &);
 
+// The number of nodes of an expression (counting the shared
+// subexpressions as many times as they appear) and the length
+// of the longest path from the root to a number, variable or param.
+HEYOKA_DLL_PUBLIC std::size_t get_n_nodes(const expression &);
+HEYOKA_DLL_PUBLIC std::size_t get_depth(const expression &);
+
 HEYOKA_DLL_PUBLIC expression operator+(expression);
 HEYOKA_DLL_PUBLIC expression operator-(expression);
 
@@ -249,13 +256,34 @@ HEYOKA_DLL_PUBLIC expression &operator/=(expression &, mppp::real128);
 HEYOKA_DLL_PUBLIC bool operator==(const expression &, const expression &);
 HEYOKA_DLL_PUBLIC bool operator!=(const expression &, const expression &);
 
+// Substitution of the variables with the given names. The subexpressions shared among
+// the expressions (or within an expression) are transformed once, and the results
+// are shared in the output, as are the subexpressions not containing the substituted variables.
 HEYOKA_DLL_PUBLIC expression subs(const expression &, const std::unordered_map<std::string, expression> &);
+HEYOKA_DLL_PUBLIC std::vector<expression> subs(const std::vector<expression> &,
+                                               const std::unordered_map<std::string, expression> &);
 
 HEYOKA_DLL_PUBLIC expression diff(const expression &, const std::string &);
 HEYOKA_DLL_PUBLIC expression diff(const expression &, const expression &);
 
+// Differentiate all the expressions in a vector with respect to all the variables
+// in a list. The result is the row-major Jacobian (i.e., the derivative of the i-th
+// expression with respect to the j-th variable is at index i * n_vars + j). The
+// derivatives of the subexpressions shared among the expressions are computed only once.
+HEYOKA_DLL_PUBLIC std::vector<expression> diff(const std::vector<expression> &, const std::vector<std::string> &);
+
 HEYOKA_DLL_PUBLIC expression pairwise_sum(std::vector<expression>);
 
+// Algebraic simplification: the constants are folded, the arguments of sums
+// and products are flattened and sorted into a canonical order, the repeated
+// terms of sums and the powers of the same base in products are merged, and the
+// identities (e.g., x * 1, x - x, square(sqrt(x))) are removed.
+// NOTE: the transformations assume real arithmetic, and thus the
+// numerical results may differ in the last bits (or, outside the domain
+// of the original expression, in the generation of NaNs).
+HEYOKA_DLL_PUBLIC expression simplify(const expression &);
+HEYOKA_DLL_PUBLIC std::vector<expression> simplify(const std::vector<expression> &);
+
 HEYOKA_DLL_PUBLIC double eval_dbl(const expression &, const std::unordered_map<std::string, double> &,
                                   const std::vector<double> & = {});
 
@@ -263,6 +291,42 @@ HEYOKA_DLL_PUBLIC void eval_batch_dbl(std::vector<double> &, const expression &,
                                       const std::unordered_map<std::string, std::vector<double>> &,
                                       const std::vector<double> & = {});
 
+// Id-indexed evaluation: the value of the variable with id i (see variable::id())
+// is read from in[i], where in is an array of n_in values, so that no name lookup
+// is performed during the evaluation. The functions are evaluated
+// via their eval_num_dbl() implementations.
+HEYOKA_DLL_PUBLIC double eval_dbl_by_id(const expression &, const double *, std::size_t,
+                                        const std::vector<double> & = {});
+
+// Batch counterpart of eval_dbl_by_id(): in is a row-major array of n_in x batch_size
+// values (the values of the variable with id i are stored in the i-th row), and the
+// batch_size results are written into out.
+HEYOKA_DLL_PUBLIC void eval_batch_dbl_by_id(double *, const expression &, const double *, std::size_t, std::size_t,
+                                            const std::vector<double> & = {});
+
+// Columnar counterpart of eval_batch_dbl_by_id(): the n_points values of the variable
+// with id i are read from the array cols[i] (which can be null if the variable does not
+// appear in the expression), and the n_points results are written into out. The points
+// are evaluated in blocks, so that the intermediate results stay in cache.
+HEYOKA_DLL_PUBLIC void eval_batch_dbl_cols(double *, const expression &, const std::vector<const double *> &,
+                                           std::size_t, const std::vector<double> & = {});
+
+// Substitution of the variables with the given ids (see subs()).
+HEYOKA_DLL_PUBLIC expression subs_by_id(const expression &, const std::unordered_map<std::uint32_t, expression> &);
+HEYOKA_DLL_PUBLIC std::vector<expression> subs_by_id(const std::vector<expression> &,
+                                                     const std::unordered_map<std::uint32_t, expression> &);
+
+// Compact binary serialisation of expressions and of systems of equations. The subexpressions
+// shared among the expressions (or within an expression) are written once, and they are shared
+// again after loading, which takes linear time in the size of the data.
+// NOTE: the binary format is not portable across architectures or different versions of heyoka.
+HEYOKA_DLL_PUBLIC void save_expression(std::ostream &, const expression &);
+HEYOKA_DLL_PUBLIC expression load_expression(std::istream &);
+HEYOKA_DLL_PUBLIC void save_expressions(std::ostream &, const std::vector<expression> &);
+HEYOKA_DLL_PUBLIC std::vector<expression> load_expressions(std::istream &);
+HEYOKA_DLL_PUBLIC void save_sys(std::ostream &, const std::vector<std::pair<expression, expression>> &);
+HEYOKA_DLL_PUBLIC std::vector<std::pair<expression, expression>> load_sys(std::istream &);
+
 // When traversing the expression tree with some recursive algorithm we may have to do some book-keeping and use
 // preallocated memory to store the result, in which case the corresponding function is called update_*. A corresponding
 // method, more friendly to use, takes care of allocating memory and initializing the book-keeping variables, its called
@@ -367,9 +431,17 @@ public:
     expression operator[](std::uint32_t) const;
 };
 
+class HEYOKA_DLL_PUBLIC shared_par_impl
+{
+public:
+    expression operator[](std::uint32_t) const;
+};
+
 } // namespace detail
 
 inline constexpr detail::par_impl par;
+// Lane-shared params (see param.hpp).
+inline constexpr detail::shared_par_impl shared_par;
 
 namespace detail
 {
@@ -0,0 +1,129 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef HEYOKA_EXPRESSION_ARENA_HPP
+#define HEYOKA_EXPRESSION_ARENA_HPP
+
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <heyoka/detail/visibility.hpp>
+
+namespace heyoka
+{
+
+namespace detail
+{
+
+// Bump allocator for the nodes of the expression trees.
+// Memory is carved out of large blocks and it is released
+// only when the arena is destroyed.
+class HEYOKA_DLL_PUBLIC expr_arena
+{
+    std::vector<std::unique_ptr<unsigned char[]>> m_blocks;
+    unsigned char *m_cur = nullptr;
+    std::size_t m_left = 0;
+
+public:
+    expr_arena();
+    expr_arena(const expr_arena &) = delete;
+    expr_arena(expr_arena &&) = delete;
+    ~expr_arena();
+
+    expr_arena &operator=(const expr_arena &) = delete;
+    expr_arena &operator=(expr_arena &&) = delete;
+
+    void *allocate(std::size_t, std::size_t);
+};
+
+// The arena currently active in the calling thread
+// (null if no arena is active).
+HEYOKA_DLL_PUBLIC const std::shared_ptr<expr_arena> &current_expr_arena();
+
+// Allocator drawing memory from an arena. Deallocation is a no-op.
+// NOTE: each allocator holds a reference to the arena. When used with
+// std::allocate_shared(), this means that the control block of each node
+// keeps the arena alive, so that nodes can safely outlive the scope
+// in which they were created.
+template <typename T>
+struct expr_arena_allocator {
+    using value_type = T;
+
+    std::shared_ptr<expr_arena> m_arena;
+
+    explicit expr_arena_allocator(std::shared_ptr<expr_arena> a) : m_arena(std::move(a)) {}
+    template <typename U>
+    expr_arena_allocator(const expr_arena_allocator<U> &other) : m_arena(other.m_arena)
+    {
+    }
+
+    T *allocate(std::size_t n)
+    {
+        return static_cast<T *>(m_arena->allocate(sizeof(T) * n, alignof(T)));
+    }
+    void deallocate(T *, std::size_t) noexcept {}
+};
+
+template <typename T, typename U>
+inline bool operator==(const expr_arena_allocator<T> &a, const expr_arena_allocator<U> &b)
+{
+    return a.m_arena == b.m_arena;
+}
+
+template <typename T, typename U>
+inline bool operator!=(const expr_arena_allocator<T> &a, const expr_arena_allocator<U> &b)
+{
+    return !(a == b);
+}
+
+// Create a shared node, drawing memory from the current arena (if any).
+template <typename T, typename... Args>
+inline std::shared_ptr<T> make_shared_node(Args &&...args)
+{
+    if (const auto &ar = current_expr_arena()) {
+        return std::allocate_shared<T>(expr_arena_allocator<T>(ar), std::forward<Args>(args)...);
+    } else {
+        return std::make_shared<T>(std::forward<Args>(args)...);
+    }
+}
+
+} // namespace detail
+
+// Scoped arena allocation: while an object of this class is alive,
+// the nodes of the expressions created in the calling thread
+// are allocated contiguously from a private arena, instead of
+// one by one via the global allocator. The memory of the arena is
+// released in one shot when the last expression allocated
+// from it is destroyed.
+//
+// Scopes can be nested, in which case the innermost scope is
+// active until its destruction.
+//
+// NOTE: the arena never reuses memory, thus it is suited for
+// bursts of construction (e.g., the definition of a system of ODEs
+// and its Taylor decomposition) rather than for long-lived
+// workloads creating and destroying many temporaries.
+class HEYOKA_DLL_PUBLIC expression_arena
+{
+    std::shared_ptr<detail::expr_arena> m_prev;
+
+public:
+    expression_arena();
+    expression_arena(const expression_arena &) = delete;
+    expression_arena(expression_arena &&) = delete;
+    ~expression_arena();
+
+    expression_arena &operator=(const expression_arena &) = delete;
+    expression_arena &operator=(expression_arena &&) = delete;
+};
+
+} // namespace heyoka
+
+#endif
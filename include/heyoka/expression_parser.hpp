@@ -0,0 +1,52 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef HEYOKA_EXPRESSION_PARSER_HPP
+#define HEYOKA_EXPRESSION_PARSER_HPP
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <heyoka/detail/visibility.hpp>
+#include <heyoka/expression.hpp>
+
+namespace heyoka
+{
+
+// Parsing of expressions from text. The grammar is a superset of the output of operator<<, and it contains:
+// - the numbers (in double precision), e.g., 1.5, 2.0000000000000000, 1e-3, inf and nan,
+// - the variables (identifiers made of letters, digits and underscores, not starting with a digit),
+// - the params (par[i] and shared_par[i]) and heyoka::time (t, as printed by operator<<),
+// - the functions which can be serialised (e.g., sin(x), pow(x, 2.5), sum(x, y, z)),
+// - the binary operators +, -, *, / (with the usual precedence and left associativity),
+//   the unary minus and the parentheses.
+// A minus in front of a number is part of the number (so that, e.g., "-1. * x" is parsed as
+// the multiplication of x by the number -1.), otherwise the unary minus is parsed as a multiplication
+// by -1. (as in the unary operator-()). The whitespace is ignored.
+//
+// The parser does not recurse, so that the depth of the expressions is limited only by the
+// available memory, and the binary operators and the functions are built directly (i.e., without
+// the simplifications of the arithmetic operators). The identical subexpressions are shared in the
+// result, also among the expressions parsed by the same invocation of parse_expressions()/parse_sys().
+//
+// NOTE: the numbers in long double or quadruple precision are parsed in double precision,
+// and the functions printed in a custom format (e.g., tsin() and tcos(), printed as
+// "sin(a * t + b)") are parsed according to the printed format. The errors are reported
+// as std::invalid_argument, with the position in the input string.
+HEYOKA_DLL_PUBLIC expression parse_expression(const std::string &);
+
+// Expressions separated by semicolons (a trailing semicolon is allowed).
+HEYOKA_DLL_PUBLIC std::vector<expression> parse_expressions(const std::string &);
+
+// Equations in the form lhs = rhs, separated by semicolons (a trailing semicolon is allowed).
+HEYOKA_DLL_PUBLIC std::vector<std::pair<expression, expression>> parse_sys(const std::string &);
+
+} // namespace heyoka
+
+#endif
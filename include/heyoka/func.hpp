@@ -31,9 +31,12 @@
 
 #include <heyoka/detail/fwd_decl.hpp>
 #include <heyoka/detail/llvm_fwd.hpp>
+#include <heyoka/detail/node_meta.hpp>
 #include <heyoka/detail/type_traits.hpp>
 #include <heyoka/detail/visibility.hpp>
 #include <heyoka/exceptions.hpp>
+#include <heyoka/expression_arena.hpp>
+#include <heyoka/interval.hpp>
 
 namespace heyoka
 {
@@ -64,7 +67,7 @@ namespace detail
 
 struct HEYOKA_DLL_PUBLIC func_inner_base {
     virtual ~func_inner_base();
-    virtual std::unique_ptr<func_inner_base> clone() const = 0;
+    virtual std::shared_ptr<func_inner_base> clone() const = 0;
 
     virtual std::type_index get_type_index() const = 0;
     virtual const void *get_ptr() const = 0;
@@ -76,6 +79,8 @@ struct HEYOKA_DLL_PUBLIC func_inner_base {
     virtual const std::vector<expression> &args() const = 0;
     virtual std::pair<std::vector<expression>::iterator, std::vector<expression>::iterator> get_mutable_args_it() = 0;
 
+    virtual bool is_time_dependent() const = 0;
+
     virtual llvm::Value *codegen_dbl(llvm_state &, const std::vector<llvm::Value *> &) const = 0;
     virtual llvm::Value *codegen_ldbl(llvm_state &, const std::vector<llvm::Value *> &) const = 0;
 #if defined(HEYOKA_HAVE_REAL128)
@@ -89,6 +94,7 @@ struct HEYOKA_DLL_PUBLIC func_inner_base {
                                 const std::vector<double> &) const = 0;
     virtual double eval_num_dbl(const std::vector<double> &) const = 0;
     virtual double deval_num_dbl(const std::vector<double> &, std::vector<double>::size_type) const = 0;
+    virtual interval eval_interval_dbl(const std::vector<interval> &) const = 0;
 
     virtual std::vector<std::pair<expression, std::vector<std::uint32_t>>>::size_type
     taylor_decompose(std::vector<std::pair<expression, std::vector<std::uint32_t>>> &) && = 0;
@@ -108,6 +114,9 @@ struct HEYOKA_DLL_PUBLIC func_inner_base {
 #if defined(HEYOKA_HAVE_REAL128)
     virtual llvm::Function *taylor_c_diff_func_f128(llvm_state &, std::uint32_t, std::uint32_t) const = 0;
 #endif
+
+    // The cached properties of the function (see node_meta).
+    node_meta m_meta;
 };
 
 template <typename T>
@@ -117,6 +126,12 @@ using func_to_stream_t
 template <typename T>
 inline constexpr bool func_has_to_stream_v = std::is_same_v<detected_t<func_to_stream_t, T>, void>;
 
+template <typename T>
+using func_is_time_dependent_t = decltype(std::declval<std::add_lvalue_reference_t<const T>>().is_time_dependent());
+
+template <typename T>
+inline constexpr bool func_has_is_time_dependent_v = std::is_same_v<detected_t<func_is_time_dependent_t, T>, bool>;
+
 template <typename T>
 using func_codegen_dbl_t = decltype(std::declval<std::add_lvalue_reference_t<const T>>().codegen_dbl(
     std::declval<llvm_state &>(), std::declval<const std::vector<llvm::Value *> &>()));
@@ -178,6 +193,13 @@ using func_deval_num_dbl_t = decltype(std::declval<std::add_lvalue_reference_t<c
 template <typename T>
 inline constexpr bool func_has_deval_num_dbl_v = std::is_same_v<detected_t<func_deval_num_dbl_t, T>, double>;
 
+template <typename T>
+using func_eval_interval_dbl_t = decltype(std::declval<std::add_lvalue_reference_t<const T>>().eval_interval_dbl(
+    std::declval<const std::vector<interval> &>()));
+
+template <typename T>
+inline constexpr bool func_has_eval_interval_dbl_v = std::is_same_v<detected_t<func_eval_interval_dbl_t, T>, interval>;
+
 template <typename T>
 using func_taylor_decompose_t = decltype(std::declval<std::add_rvalue_reference_t<T>>().taylor_decompose(
     std::declval<std::vector<std::pair<expression, std::vector<std::uint32_t>>> &>()));
@@ -275,9 +297,12 @@ struct HEYOKA_DLL_PUBLIC_INLINE_CLASS func_inner final : func_inner_base {
     explicit func_inner(T &&x) : m_value(std::move(x)) {}
 
     // The clone function.
-    std::unique_ptr<func_inner_base> clone() const final
+    // NOTE: the clone is created directly as a shared node, so that
+    // the control block and the object are allocated in one go
+    // (from the current arena, if any).
+    std::shared_ptr<func_inner_base> clone() const final
     {
-        return std::make_unique<func_inner>(m_value);
+        return make_shared_node<func_inner>(m_value);
     }
 
     // Get the type at runtime.
@@ -320,6 +345,17 @@ struct HEYOKA_DLL_PUBLIC_INLINE_CLASS func_inner final : func_inner_base {
         return static_cast<func_base *>(&m_value)->get_mutable_args_it();
     }
 
+    // NOTE: by default, a function depends on time
+    // only through its arguments.
+    bool is_time_dependent() const final
+    {
+        if constexpr (func_has_is_time_dependent_v<T>) {
+            return m_value.is_time_dependent();
+        } else {
+            return false;
+        }
+    }
+
     // codegen.
     llvm::Value *codegen_dbl(llvm_state &s, const std::vector<llvm::Value *> &v) const final
     {
@@ -387,6 +423,15 @@ struct HEYOKA_DLL_PUBLIC_INLINE_CLASS func_inner final : func_inner_base {
                                         + get_name() + "'");
         }
     }
+    interval eval_interval_dbl(const std::vector<interval> &v) const final
+    {
+        if constexpr (func_has_eval_interval_dbl_v<T>) {
+            return m_value.eval_interval_dbl(v);
+        } else {
+            throw not_implemented_error("double interval eval is not implemented for the function '" + get_name()
+                                        + "'");
+        }
+    }
 
     // Taylor.
     std::vector<std::pair<expression, std::vector<std::uint32_t>>>::size_type
@@ -479,12 +524,19 @@ class HEYOKA_DLL_PUBLIC func
 {
     friend HEYOKA_DLL_PUBLIC void swap(func &, func &) noexcept;
     friend HEYOKA_DLL_PUBLIC std::ostream &operator<<(std::ostream &, const func &);
+    friend HEYOKA_DLL_PUBLIC const detail::node_meta *detail::node_meta_ptr(const expression &);
 
     // Pointer to the inner base.
-    std::unique_ptr<detail::func_inner_base> m_ptr;
+    // NOTE: the inner base is shared among copies, and it
+    // is cloned only when accessed via the non-const
+    // member functions of a shared func (copy-on-write).
+    std::shared_ptr<detail::func_inner_base> m_ptr;
 
     // Just two small helpers to make sure that whenever we require
     // access to the pointer it actually points to something.
+    // NOTE: the non-const overload ensures that the
+    // inner base is not shared, and it clears its
+    // cached properties.
     const detail::func_inner_base *ptr() const;
     detail::func_inner_base *ptr();
 
@@ -496,7 +548,8 @@ class HEYOKA_DLL_PUBLIC func
 
 public:
     template <typename T, generic_ctor_enabler<T &&> = 0>
-    explicit func(T &&x) : m_ptr(std::make_unique<detail::func_inner<detail::uncvref_t<T>>>(std::forward<T>(x)))
+    explicit func(T &&x)
+        : m_ptr(detail::make_shared_node<detail::func_inner<detail::uncvref_t<T>>>(std::forward<T>(x)))
     {
     }
 
@@ -517,6 +570,11 @@ public:
     const std::vector<expression> &args() const;
     std::pair<std::vector<expression>::iterator, std::vector<expression>::iterator> get_mutable_args_it();
 
+    // Check if the function depends explicitly on time (i.e., not
+    // only through its arguments), such as heyoka::time or the
+    // functions of time whose arguments are numbers or params.
+    bool is_time_dependent() const;
+
     llvm::Value *codegen_dbl(llvm_state &, const std::vector<llvm::Value *> &) const;
     llvm::Value *codegen_ldbl(llvm_state &, const std::vector<llvm::Value *> &) const;
 #if defined(HEYOKA_HAVE_REAL128)
@@ -530,6 +588,7 @@ public:
                         const std::vector<double> &) const;
     double eval_num_dbl(const std::vector<double> &) const;
     double deval_num_dbl(const std::vector<double> &, std::vector<double>::size_type) const;
+    interval eval_interval_dbl(const std::vector<interval> &) const;
 
     std::vector<std::pair<expression, std::vector<std::uint32_t>>>::size_type
     taylor_decompose(std::vector<std::pair<expression, std::vector<std::uint32_t>>> &) &&;
@@ -570,6 +629,7 @@ HEYOKA_DLL_PUBLIC void eval_batch_dbl(std::vector<double> &, const func &,
                                       const std::vector<double> &);
 HEYOKA_DLL_PUBLIC double eval_num_dbl(const func &, const std::vector<double> &);
 HEYOKA_DLL_PUBLIC double deval_num_dbl(const func &, const std::vector<double> &, std::vector<double>::size_type);
+HEYOKA_DLL_PUBLIC interval eval_interval_dbl(const func &, const std::vector<interval> &);
 
 HEYOKA_DLL_PUBLIC void update_connections(std::vector<std::vector<std::size_t>> &, const func &, std::size_t &);
 HEYOKA_DLL_PUBLIC void update_node_values_dbl(std::vector<double> &, const func &,
@@ -665,6 +725,17 @@ inline llvm::Function *taylor_c_diff_func(llvm_state &s, const func &f, std::uin
     }
 }
 
+// Registration of the vector implementations (e.g., from a SIMD library such as SVML
+// or libmvec) of an external scalar function. The arguments are the name of the scalar
+// function, the SIMD width and the name of the vector implementation, which must
+// accept and return SIMD vectors of the given width. When an external scalar function
+// is invoked on SIMD vectors in the code generation of a function (e.g., via
+// detail::call_extern_vec()), the registered vector implementations are used in place
+// of one call of the scalar function per vector element.
+HEYOKA_DLL_PUBLIC void register_vector_function(const std::string &, std::uint32_t, const std::string &);
+HEYOKA_DLL_PUBLIC void unregister_vector_functions(const std::string &);
+HEYOKA_DLL_PUBLIC std::vector<std::pair<std::uint32_t, std::string>> get_vector_functions(const std::string &);
+
 } // namespace heyoka
 
 #endif
@@ -0,0 +1,47 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef HEYOKA_GEOPOTENTIAL_HPP
+#define HEYOKA_GEOPOTENTIAL_HPP
+
+#include <array>
+#include <cstdint>
+
+#include <heyoka/detail/visibility.hpp>
+#include <heyoka/expression.hpp>
+
+namespace heyoka
+{
+
+// Gravitational acceleration at the point (x, y, z) (in the body-fixed frame) due to a
+// spherical-harmonics expansion of the gravity field up to degree n_max and order m_max,
+// with gravitational parameter mu and reference radius R.
+//
+// The fully-normalised coefficients are runtime parameters: the coefficients of degree n
+// and order m are read from par[par_offset + geopotential_par_index(n, m)] (C_nm) and
+// from the following parameter (S_nm), for 0 <= m <= n <= n_max (the coefficients with
+// m > m_max are ignored). C_00 is usually 1, so that the expansion includes the
+// Keplerian term.
+//
+// The acceleration is computed via the recursions of Cunningham for the
+// solid harmonics V_nm and W_nm, so that the size of the Taylor decomposition
+// grows as n_max**2 and, in compact mode, the terms of the recursions
+// are evaluated in loops.
+HEYOKA_DLL_PUBLIC std::array<expression, 3> geopotential_acc(const expression &, const expression &,
+                                                             const expression &, std::uint32_t, std::uint32_t, double,
+                                                             double, std::uint32_t = 0);
+
+// The index of C_nm in the array of the coefficients, i.e., 2 * (n * (n + 1) / 2 + m).
+HEYOKA_DLL_PUBLIC std::uint32_t geopotential_par_index(std::uint32_t, std::uint32_t);
+
+// The total number of parameters for an expansion up to degree n_max, i.e., (n_max + 1) * (n_max + 2).
+HEYOKA_DLL_PUBLIC std::uint32_t geopotential_n_pars(std::uint32_t);
+
+} // namespace heyoka
+
+#endif
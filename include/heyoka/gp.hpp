@@ -10,8 +10,11 @@
 #define HEYOKA_GP_HPP
 
 #include <cstddef>
+#include <optional>
 #include <ostream>
 #include <string>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include <heyoka/binary_operator.hpp>
@@ -36,10 +39,19 @@ private:
     double m_range_dbl;
     mutable splitmix64 m_e;
 
+    HEYOKA_DLL_LOCAL expression generate(splitmix64 &, unsigned, unsigned, unsigned) const;
+
 public:
     explicit expression_generator(const std::vector<std::string> &, splitmix64 &);
     expression operator()(unsigned, unsigned, unsigned = 0u) const;
 
+    // Generate n random expressions with depths in [min_depth, max_depth], using n_threads
+    // threads (0 means the number of hardware threads). The i-th expression is generated
+    // from its own random stream, seeded from the i-th value of a sequence whose seed is
+    // drawn from the internal engine: the result is thus independent of the number of threads.
+    // The nodes are allocated from per-thread arenas (see expression_arena).
+    std::vector<expression> generate_population(std::size_t, unsigned, unsigned, unsigned = 0) const;
+
     // getters
     const std::vector<binary_operator::type> &get_bos() const;
     const std::vector<expression (*)(expression)> &get_u_funcs() const;
@@ -69,6 +81,77 @@ HEYOKA_DLL_PUBLIC void mutate(expression &, std::size_t, const expression_genera
 HEYOKA_DLL_PUBLIC void crossover(expression &, expression &, splitmix64 &);
 HEYOKA_DLL_PUBLIC void crossover(expression &, expression &, std::size_t, std::size_t);
 
+// Population-level fitness evaluation: compute the mean squared error of each individual
+// in pop over a dataset of n_points points. data is a row-major array of vars.size() x n_points
+// values (the values of the i-th variable in vars are stored in the i-th row), target contains
+// the n_points target values and pars the values of the params.
+//
+// The individuals are distributed among n_threads threads (0 means the number of
+// hardware threads), and each individual is evaluated over blocks of points
+// with vectorisable loops. The functions are evaluated via their eval_num_dbl()
+// implementations.
+//
+// The individuals which are structurally identical are evaluated only once.
+HEYOKA_DLL_PUBLIC std::vector<double> population_mse(const std::vector<expression> &, const std::vector<std::string> &,
+                                                     const double *, const double *, std::size_t,
+                                                     const std::vector<double> & = {}, unsigned = 0);
+
+// Cache of the fitness values of the individuals of a population, keyed on the
+// structure of the individuals. The lookups of copies of an individual already in
+// the cache take constant time (as the copies share their nodes), while the lookups of
+// structurally-identical but distinct individuals require hashing.
+//
+// NOTE: the cache does not know about the dataset, thus it must
+// be cleared if the dataset or the params change.
+class HEYOKA_DLL_PUBLIC fitness_cache
+{
+    std::unordered_map<expression, double> m_map;
+    // The cached values keyed on the identity of the nodes. The
+    // expressions are stored as well, in order to keep the nodes alive.
+    std::unordered_map<const void *, std::pair<expression, double>> m_id_map;
+
+public:
+    fitness_cache();
+    fitness_cache(const fitness_cache &);
+    fitness_cache(fitness_cache &&) noexcept;
+
+    fitness_cache &operator=(const fitness_cache &);
+    fitness_cache &operator=(fitness_cache &&) noexcept;
+
+    ~fitness_cache();
+
+    std::optional<double> find(const expression &);
+    void insert(const expression &, double);
+
+    std::size_t size() const;
+    void clear();
+};
+
+// Population-level fitness evaluation with a persistent cache: the individuals
+// whose fitness is in cache are not re-evaluated, and the cache
+// is updated with the fitness of the other individuals.
+HEYOKA_DLL_PUBLIC std::vector<double> population_mse(const std::vector<expression> &, const std::vector<std::string> &,
+                                                     const double *, const double *, std::size_t, fitness_cache &,
+                                                     const std::vector<double> & = {}, unsigned = 0);
+
+// Replace the number leaves of ex with the params par[n0], par[n0 + 1], ..., where n0
+// is the number of params already present in ex (see get_param_size()). The numbers
+// are numbered from left to right, and their values are returned alongside the new expression.
+HEYOKA_DLL_PUBLIC std::pair<expression, std::vector<double>> numbers_to_pars(const expression &);
+
+// Optimisation of the numerical constants of ex, so that the mean squared error over
+// a dataset (with the same layout as in population_mse()) is minimised. The numbers
+// are turned into params via numbers_to_pars(), and the values and the gradients
+// with respect to the params are JIT-compiled (see add_cfunc_par_jac()) and evaluated
+// in SIMD batches at each of the (at most max_iter) iterations of a Levenberg-Marquardt
+// optimiser. The params already present in ex are held fixed to the values in pars.
+//
+// The return value is the expression with the optimised constants, together with its
+// mean squared error.
+HEYOKA_DLL_PUBLIC std::pair<expression, double> optimise_constants(const expression &, const std::vector<std::string> &,
+                                                                   const double *, const double *, std::size_t,
+                                                                   const std::vector<double> & = {}, unsigned = 20);
+
 } // namespace heyoka
 
 #endif
@@ -0,0 +1,95 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef HEYOKA_GP_ISLANDS_HPP
+#define HEYOKA_GP_ISLANDS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <heyoka/detail/visibility.hpp>
+#include <heyoka/expression.hpp>
+#include <heyoka/gp.hpp>
+#include <heyoka/splitmix64.hpp>
+
+namespace heyoka
+{
+
+// Island-model genetic programming for symbolic regression over a dataset
+// (with the same layout as in population_mse()). Each island evolves its own
+// population in its own thread, with its own expression_generator and splitmix64
+// (seeded from seed and from the index of the island), via tournament selection,
+// crossover and mutation. The best individual of each island is always kept,
+// and the fitness (i.e., the mean squared error) is computed via population_mse()
+// with a per-island fitness_cache. Every migration_interval generations, the best
+// n_migrants individuals of each island replace the worst individuals of the next
+// island in a ring. The results do not depend on the number of threads.
+//
+// The template generator provides the building blocks of the expressions (its
+// list of variables must match the dataset).
+//
+// NOTE: the dataset is not copied, and it must stay alive
+// for the lifetime of the object.
+class HEYOKA_DLL_PUBLIC gp_islands
+{
+public:
+    struct island {
+        expression_generator generator;
+        splitmix64 engine;
+        std::vector<expression> pop;
+        std::vector<double> fitness;
+        fitness_cache cache;
+    };
+
+private:
+    std::vector<island> m_islands;
+    const double *m_data;
+    const double *m_target;
+    std::size_t m_n_points;
+    unsigned m_min_depth, m_max_depth;
+    double m_crossover_p, m_mutation_p;
+    std::size_t m_n_gens = 0;
+
+    HEYOKA_DLL_LOCAL void evaluate(island &) const;
+    HEYOKA_DLL_LOCAL void evolve_island(island &, std::size_t) const;
+    HEYOKA_DLL_LOCAL void migrate(std::size_t);
+
+public:
+    // The arguments are the template generator, the dataset (data, target and n_points),
+    // the number of islands, the population size of each island, the seed, the minimum
+    // and maximum depths of the generated expressions, the crossover probability and the
+    // mutation probability (per node, see mutate()).
+    explicit gp_islands(const expression_generator &, const double *, const double *, std::size_t, std::size_t,
+                        std::size_t, std::uint64_t, unsigned = 2, unsigned = 4, double = .9, double = .1);
+
+    gp_islands(const gp_islands &);
+    gp_islands(gp_islands &&) noexcept;
+
+    gp_islands &operator=(const gp_islands &);
+    gp_islands &operator=(gp_islands &&) noexcept;
+
+    ~gp_islands();
+
+    const std::vector<island> &get_islands() const;
+    // The total number of generations evolved so far.
+    std::size_t get_n_gens() const;
+
+    // Evolve the islands for n_gens generations, using n_threads
+    // threads (0 means the number of hardware threads).
+    void evolve(std::size_t, std::size_t = 10, std::size_t = 1, unsigned = 0);
+
+    // The best individual over all the islands, and its fitness.
+    std::pair<expression, double> get_best() const;
+};
+
+} // namespace heyoka
+
+#endif
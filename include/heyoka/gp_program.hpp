@@ -0,0 +1,170 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef HEYOKA_GP_PROGRAM_HPP
+#define HEYOKA_GP_PROGRAM_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <heyoka/detail/visibility.hpp>
+#include <heyoka/expression.hpp>
+#include <heyoka/gp.hpp>
+#include <heyoka/number.hpp>
+#include <heyoka/splitmix64.hpp>
+
+namespace heyoka
+{
+
+// Linear (postfix) representation of an expression, evaluated via a stack machine.
+// The expression is expanded into a tree (i.e., the subexpressions shared among
+// copies are repeated), and each node becomes an instruction: the instructions of
+// the subtree of a node precede it and are contiguous. Hence, the instructions
+// are in one-to-one correspondence with the nodes counted by count_nodes(), and
+// the node ids used here are the pre-order ids of fetch_from_node_id().
+//
+// The variables are referred to via their indices in vars. If vars is empty,
+// the variables are deduced from the expression and sorted alphabetically.
+// The functions are evaluated via their eval_num_dbl() implementations.
+class HEYOKA_DLL_PUBLIC gp_program
+{
+    friend class cached_gp_program;
+
+public:
+    // The instruction types.
+    enum class op_code : std::uint8_t { var, num, par, add, sub, mul, div, func };
+
+    struct instruction {
+        op_code op;
+        // For var instructions, the index of the variable; for num
+        // instructions, the index of the number in the table of numbers;
+        // for par instructions, the index of the parameter; for func instructions,
+        // the index of the function in the table of functions.
+        std::uint32_t idx;
+        // The number of instructions in the subtree of the node
+        // (including the instruction itself).
+        std::uint32_t size;
+    };
+
+private:
+    std::vector<std::string> m_vars;
+    std::vector<instruction> m_code;
+    // The tables of numbers and functions. The functions
+    // are stored as expressions, whose arguments are ignored.
+    std::vector<number> m_nums;
+    std::vector<double> m_nums_dbl;
+    std::vector<expression> m_funcs;
+    // The index of the instruction of each node,
+    // in the pre-order numbering of the nodes.
+    std::vector<std::uint32_t> m_node_idx;
+    // The maximum depth of the stack during the evaluation.
+    std::uint32_t m_max_depth = 0;
+    // The number of params required by the evaluation.
+    std::uint32_t m_n_pars = 0;
+
+    HEYOKA_DLL_LOCAL void finalise();
+
+public:
+    explicit gp_program(const expression &, std::vector<std::string> = {});
+
+    gp_program(const gp_program &);
+    gp_program(gp_program &&) noexcept;
+
+    gp_program &operator=(const gp_program &);
+    gp_program &operator=(gp_program &&) noexcept;
+
+    ~gp_program();
+
+    const std::vector<std::string> &get_vars() const;
+    const std::vector<instruction> &get_code() const;
+    std::size_t size() const;
+
+    // Conversion back to an expression.
+    expression to_expression() const;
+
+    // The range [b, e) of the instructions of the subtree
+    // of the node with the given pre-order id (in constant time).
+    std::pair<std::size_t, std::size_t> subtree(std::size_t) const;
+
+    // Replace the subtree of the node node_id with the
+    // subtree of the node other_id in other. The two programs
+    // must have the same list of variables.
+    void replace_subtree(std::size_t, const gp_program &, std::size_t);
+
+    // Evaluation at n_points points. in is a row-major array of size n_vars x n_points
+    // (the values of the i-th variable are in the i-th row), the values are written into
+    // out (n_points values).
+    void eval_batch(double *, const double *, std::size_t, const std::vector<double> & = {}) const;
+};
+
+// Program with cached node values: the values of all the nodes of the program over
+// a dataset are stored, so that, after the replacement of a subtree, only the
+// nodes of the new subtree and its ancestors are re-evaluated. in is a row-major
+// array of size n_vars x n_points (the values of the i-th variable are in the i-th row).
+//
+// NOTE: the dataset is not copied, and it must stay alive
+// for the lifetime of the object.
+class HEYOKA_DLL_PUBLIC cached_gp_program
+{
+    friend HEYOKA_DLL_PUBLIC void crossover(cached_gp_program &, cached_gp_program &, std::size_t, std::size_t);
+
+    gp_program m_p;
+    const double *m_in;
+    std::size_t m_n_points;
+    std::vector<double> m_pars;
+    // The values of the nodes: the values of the node
+    // corresponding to the i-th instruction start at index i * n_points.
+    std::vector<double> m_values;
+
+    HEYOKA_DLL_LOCAL void check_pars(const gp_program &) const;
+    HEYOKA_DLL_LOCAL bool same_dataset(const cached_gp_program &) const;
+    HEYOKA_DLL_LOCAL void eval_node(std::size_t);
+    HEYOKA_DLL_LOCAL void replace_subtree_impl(std::size_t, const gp_program &, std::size_t, const double *);
+
+public:
+    explicit cached_gp_program(gp_program, const double *, std::size_t, std::vector<double> = {});
+
+    cached_gp_program(const cached_gp_program &);
+    cached_gp_program(cached_gp_program &&) noexcept;
+
+    cached_gp_program &operator=(const cached_gp_program &);
+    cached_gp_program &operator=(cached_gp_program &&) noexcept;
+
+    ~cached_gp_program();
+
+    const gp_program &get_program() const;
+    std::size_t get_n_points() const;
+
+    // The n_points values of the node with the given pre-order
+    // id, and of the program (i.e., of the root node).
+    const double *get_node_values(std::size_t) const;
+    const double *get_values() const;
+
+    // Replace the subtree of the node node_id with the subtree of the node other_id
+    // in other. If other is a cached program over the same dataset and with the same
+    // params, the values of the nodes of the new subtree are copied rather than re-evaluated.
+    void replace_subtree(std::size_t, const gp_program &, std::size_t);
+    void replace_subtree(std::size_t, const cached_gp_program &, std::size_t);
+};
+
+// Counterparts of the expression manipulators for programs.
+HEYOKA_DLL_PUBLIC void mutate(gp_program &, std::size_t, const expression_generator &, const unsigned, const unsigned);
+HEYOKA_DLL_PUBLIC void crossover(gp_program &, gp_program &, splitmix64 &);
+HEYOKA_DLL_PUBLIC void crossover(gp_program &, gp_program &, std::size_t, std::size_t);
+
+HEYOKA_DLL_PUBLIC void mutate(cached_gp_program &, std::size_t, const expression_generator &, const unsigned,
+                              const unsigned);
+HEYOKA_DLL_PUBLIC void crossover(cached_gp_program &, cached_gp_program &, splitmix64 &);
+HEYOKA_DLL_PUBLIC void crossover(cached_gp_program &, cached_gp_program &, std::size_t, std::size_t);
+
+} // namespace heyoka
+
+#endif
@@ -0,0 +1,105 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef HEYOKA_GRADIENT_TAPE_HPP
+#define HEYOKA_GRADIENT_TAPE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <heyoka/detail/visibility.hpp>
+#include <heyoka/expression.hpp>
+#include <heyoka/func.hpp>
+
+namespace heyoka
+{
+
+// Reverse-mode automatic differentiation tape. The expression is flattened
+// once, at construction, into a topologically-sorted array of nodes (common
+// subexpressions are recorded only once). The evaluation of the value and the gradient
+// of the expression then amounts to a forward and a reverse sweep over the tape,
+// using buffers which are allocated only once.
+//
+// The gradient is computed with respect to the variables in vars. If vars is empty,
+// the variables are deduced from the expression and sorted alphabetically.
+// The functions are evaluated via their eval_num_dbl() and deval_num_dbl()
+// implementations.
+//
+// NOTE: the evaluation functions are not const, because they
+// use internal buffers. Concurrent evaluations require separate copies
+// of the tape.
+class HEYOKA_DLL_PUBLIC gradient_tape
+{
+public:
+    // The node types.
+    enum class node_type : std::uint8_t { var, num, par, add, sub, mul, div, func };
+
+    // A node of the tape.
+    struct node {
+        node_type type;
+        // For var nodes, a is the index of the variable; for par nodes, the index
+        // of the parameter; for binary operators, a and b are the indices of
+        // the operands; for func nodes, a is the offset of the indices of the arguments
+        // in the tape and b the number of arguments.
+        std::uint32_t a;
+        std::uint32_t b;
+        // The value of num nodes.
+        double value;
+        // The index of the function object of func nodes.
+        std::uint32_t f_idx;
+    };
+
+private:
+    expression m_ex;
+    std::vector<std::string> m_vars;
+    std::vector<node> m_nodes;
+    // The function objects and the arguments of func nodes.
+    std::vector<func> m_funcs;
+    std::vector<std::uint32_t> m_args;
+    // The index of the var node of each variable (or the
+    // number of nodes if the variable does not appear in the expression).
+    std::vector<std::uint32_t> m_var_nodes;
+    // Buffers for the forward and reverse sweeps.
+    std::vector<double> m_values;
+    std::vector<double> m_adj;
+    std::vector<double> m_fargs;
+
+    HEYOKA_DLL_LOCAL void sweep(double *, double *, const double *, std::size_t, std::size_t, std::size_t,
+                                const double *);
+
+public:
+    explicit gradient_tape(expression, std::vector<std::string> = {});
+
+    gradient_tape(const gradient_tape &);
+    gradient_tape(gradient_tape &&) noexcept;
+
+    gradient_tape &operator=(const gradient_tape &);
+    gradient_tape &operator=(gradient_tape &&) noexcept;
+
+    ~gradient_tape();
+
+    const expression &get_expression() const;
+    const std::vector<std::string> &get_vars() const;
+    std::size_t get_n_nodes() const;
+
+    // Value and gradient at a single point: in contains the values of the variables,
+    // the gradient is written into grad and the value of the expression is returned.
+    double operator()(double *, const double *, const double * = nullptr);
+
+    // Value and gradient at n_points points. in is a row-major array of size
+    // n_vars x n_points (the values of the i-th variable are in the i-th row),
+    // the values are written into out (n_points values) and the gradient
+    // into grad (row-major, n_vars x n_points).
+    void eval_batch(double *, double *, const double *, std::size_t, const double * = nullptr);
+};
+
+} // namespace heyoka
+
+#endif
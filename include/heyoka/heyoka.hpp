@@ -10,19 +10,41 @@
 #define HEYOKA_HEYOKA_HPP
 
 #include <heyoka/binary_operator.hpp>
+#include <heyoka/compiled_function.hpp>
+#include <heyoka/ensemble_propagate.hpp>
 #include <heyoka/exceptions.hpp>
+#include <heyoka/executor.hpp>
 #include <heyoka/expression.hpp>
+#include <heyoka/expression_arena.hpp>
+#include <heyoka/expression_parser.hpp>
 #include <heyoka/func.hpp>
+#include <heyoka/geopotential.hpp>
 #include <heyoka/gp.hpp>
+#include <heyoka/gp_islands.hpp>
+#include <heyoka/gp_program.hpp>
+#include <heyoka/gradient_tape.hpp>
+#include <heyoka/interval.hpp>
 #include <heyoka/kw.hpp>
 #include <heyoka/llvm_state.hpp>
+#include <heyoka/mapped_columns.hpp>
 #include <heyoka/mascon.hpp>
 #include <heyoka/math.hpp>
 #include <heyoka/nbody.hpp>
+#include <heyoka/nbody_bh.hpp>
+#include <heyoka/nbody_collisions.hpp>
+#include <heyoka/nbody_restricted.hpp>
 #include <heyoka/number.hpp>
 #include <heyoka/param.hpp>
+#include <heyoka/perf_counters.hpp>
+#include <heyoka/polyhedral.hpp>
 #include <heyoka/splitmix64.hpp>
 #include <heyoka/taylor.hpp>
+#include <heyoka/taylor_interval.hpp>
+#include <heyoka/taylor_multi.hpp>
+#include <heyoka/taylor_traj.hpp>
+#include <heyoka/tracing.hpp>
+#include <heyoka/trig_pairs.hpp>
+#include <heyoka/vareqs.hpp>
 #include <heyoka/variable.hpp>
 
 #endif
@@ -0,0 +1,144 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef HEYOKA_INTERVAL_HPP
+#define HEYOKA_INTERVAL_HPP
+
+#include <cmath>
+#include <limits>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <heyoka/detail/fwd_decl.hpp>
+#include <heyoka/detail/visibility.hpp>
+
+namespace heyoka
+{
+
+// Closed interval [lower, upper] of doubles, used in the interval-arithmetic
+// evaluation of expressions. The bounds may be infinite, and an interval with NaN
+// bounds signals that the evaluation (possibly) hit points outside the domain
+// of a function.
+//
+// NOTE: the bounds of the results of the operations are widened by one ulp,
+// in order to account for the rounding errors of the floating-point arithmetic
+// and of the elementary functions. The enclosures are thus rigorous as long as the
+// elementary functions of the C++ standard library are accurate to within one ulp.
+struct interval {
+    double lower;
+    double upper;
+};
+
+HEYOKA_DLL_PUBLIC bool operator==(const interval &, const interval &);
+HEYOKA_DLL_PUBLIC bool operator!=(const interval &, const interval &);
+
+HEYOKA_DLL_PUBLIC std::ostream &operator<<(std::ostream &, const interval &);
+
+HEYOKA_DLL_PUBLIC interval operator+(const interval &, const interval &);
+HEYOKA_DLL_PUBLIC interval operator-(const interval &, const interval &);
+HEYOKA_DLL_PUBLIC interval operator*(const interval &, const interval &);
+HEYOKA_DLL_PUBLIC interval operator/(const interval &, const interval &);
+
+// Check if both bounds are finite (which implies that no domain error was detected).
+HEYOKA_DLL_PUBLIC bool is_finite(const interval &);
+
+// Interval evaluation of ex over the box defined by the intervals of the variables in map.
+// The params are evaluated as degenerate intervals.
+HEYOKA_DLL_PUBLIC interval eval_interval_dbl(const expression &, const std::unordered_map<std::string, interval> &,
+                                             const std::vector<double> & = {});
+
+// Interval evaluation of ex over several boxes: the i-th box is defined by the i-th
+// intervals of the variables in map (which must all contain the same number of intervals).
+// If map is empty, ex is evaluated over a single box.
+HEYOKA_DLL_PUBLIC void eval_batch_interval_dbl(std::vector<interval> &, const expression &,
+                                               const std::unordered_map<std::string, std::vector<interval>> &,
+                                               const std::vector<double> & = {});
+
+namespace detail
+{
+
+// Helpers for the implementation of the interval
+// evaluation of the functions.
+
+inline interval interval_nan()
+{
+    const auto nan = std::numeric_limits<double>::quiet_NaN();
+
+    return {nan, nan};
+}
+
+inline bool interval_isnan(const interval &a)
+{
+    return std::isnan(a.lower) || std::isnan(a.upper);
+}
+
+// The interval [l, u], widened by one ulp.
+inline interval interval_round_out(double l, double u)
+{
+    if (std::isnan(l) || std::isnan(u)) {
+        return interval_nan();
+    }
+
+    constexpr auto inf = std::numeric_limits<double>::infinity();
+
+    return {std::nextafter(l, -inf), std::nextafter(u, inf)};
+}
+
+// Image of a via the increasing (if incr is true) or decreasing function
+// f, defined over the domain [dl, du]. If a is not contained in the
+// domain, a NaN interval is returned.
+template <typename F>
+inline interval interval_monotonic(const interval &a, F &&f, bool incr,
+                                   double dl = -std::numeric_limits<double>::infinity(),
+                                   double du = std::numeric_limits<double>::infinity())
+{
+    if (interval_isnan(a) || a.lower < dl || a.upper > du) {
+        return interval_nan();
+    }
+
+    return incr ? interval_round_out(f(a.lower), f(a.upper)) : interval_round_out(f(a.upper), f(a.lower));
+}
+
+// Image of a via the function f, decreasing
+// over (-inf, 0] and increasing over [0, inf).
+template <typename F>
+inline interval interval_even(const interval &a, F &&f)
+{
+    if (interval_isnan(a)) {
+        return interval_nan();
+    }
+
+    if (a.lower >= 0) {
+        return interval_round_out(f(a.lower), f(a.upper));
+    }
+
+    if (a.upper <= 0) {
+        return interval_round_out(f(a.upper), f(a.lower));
+    }
+
+    const auto fl = f(a.lower), fu = f(a.upper);
+
+    return interval_round_out(f(0.), fl > fu ? fl : fu);
+}
+
+// Images of a via the sine and the cosine.
+HEYOKA_DLL_PUBLIC interval interval_sin(const interval &);
+HEYOKA_DLL_PUBLIC interval interval_cos(const interval &);
+
+// Check if a contains (up to a small relative tolerance)
+// a point of the form offset + k * period, k integer.
+HEYOKA_DLL_PUBLIC bool interval_contains_periodic(const interval &, double, double);
+
+} // namespace detail
+
+} // namespace heyoka
+
+#endif
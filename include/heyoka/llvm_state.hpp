@@ -9,8 +9,12 @@
 #ifndef HEYOKA_LLVM_STATE_HPP
 #define HEYOKA_LLVM_STATE_HPP
 
+#include <heyoka/config.hpp>
+
+#include <cstddef>
 #include <cstdint>
 #include <initializer_list>
+#include <istream>
 #include <memory>
 #include <ostream>
 #include <string>
@@ -19,6 +23,12 @@
 #include <utility>
 #include <vector>
 
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
 #include <heyoka/detail/fwd_decl.hpp>
 #include <heyoka/detail/igor.hpp>
 #include <heyoka/detail/llvm_fwd.hpp>
@@ -38,14 +48,132 @@ struct target_features {
     bool avx = false;
     bool avx2 = false;
     bool avx512f = false;
+    // Hardware fused multiply-add.
+    bool fma = false;
 };
 
-// NOTE: no need to make this DLL-public as long
-// as this is used only in library code.
+// NOTE: no need to make these DLL-public as long
+// as they are used only in library code.
 const target_features &get_target_features();
+// The features of the target machine of an llvm_state
+// (which may differ from the host machine).
+const target_features &get_target_features(const llvm_state &);
 
 } // namespace detail
 
+// Optimisation pipeline profiles:
+// - standard: the default pipeline, controlled by the
+//   optimisation level,
+// - fast_compile: a minimal set of optimisation passes
+//   (no inlining) and fast instruction selection in the codegen,
+//   which trade runtime performance for compilation speed,
+// - aggressive: the standard pipeline with the addition of
+//   the SLP and loop vectorizers.
+enum class opt_profile { standard, fast_compile, aggressive };
+
+HEYOKA_DLL_PUBLIC std::ostream &operator<<(std::ostream &, opt_profile);
+
+// Accuracy tiers of the SLEEF vector implementations
+// of the elementary functions:
+// - u10: maximum error of 1.0 ULP,
+// - u35: maximum error of 3.5 ULP (faster). The functions
+//   for which SLEEF provides only the 1.0-ULP variant
+//   (e.g., exp() and pow()) use the u10 implementations.
+// The accuracy tier has no effect if heyoka was built
+// without SLEEF support.
+enum class sleef_accuracy { u10, u35 };
+
+HEYOKA_DLL_PUBLIC std::ostream &operator<<(std::ostream &, sleef_accuracy);
+
+// JIT event listeners, which register the code compiled by an llvm_state
+// with external tools (they can be combined via operator|()):
+// - gdb: the GDB JIT interface, so that the compiled functions show up
+//   with their names in the backtraces of gdb/lldb,
+// - perf_map: a perf map file (/tmp/perf-<pid>.map, Linux only), from which
+//   the Linux perf tool resolves the names of the compiled functions,
+// - perf_jitdump: LLVM's jitdump listener for the Linux perf tool (the
+//   profile must be post-processed with 'perf inject --jit'),
+// - intel: the Intel JIT profiling API, used by VTune.
+// The perf_jitdump and intel listeners are available only if LLVM was built
+// with, respectively, LLVM_USE_PERF and LLVM_USE_INTEL_JITEVENTS.
+//
+// NOTE: with the listeners enabled, the object code is linked in memory
+// via LLVM's RuntimeDyld linker, and the llvm_state instances with
+// different listeners do not share their JIT sessions.
+enum class jit_listener : unsigned { none = 0, gdb = 1, perf_map = 2, perf_jitdump = 4, intel = 8 };
+
+constexpr jit_listener operator|(jit_listener a, jit_listener b)
+{
+    return static_cast<jit_listener>(static_cast<unsigned>(a) | static_cast<unsigned>(b));
+}
+
+constexpr jit_listener operator&(jit_listener a, jit_listener b)
+{
+    return static_cast<jit_listener>(static_cast<unsigned>(a) & static_cast<unsigned>(b));
+}
+
+HEYOKA_DLL_PUBLIC std::ostream &operator<<(std::ostream &, jit_listener);
+
+// Timings (in seconds) and statistics collected during the
+// construction of the code in an llvm_state. The timings are
+// accumulated over all the functions added to the state.
+struct llvm_state_stats {
+    // Decomposition of the ODE systems (including
+    // the CSE and sorting of the decompositions).
+    double decompose_time = 0;
+    double cse_time = 0;
+    double sort_time = 0;
+    // IR generation (excluding the decomposition
+    // and the optimisation).
+    double ir_gen_time = 0;
+    // Segmentation of the decomposition in compact
+    // mode (included in ir_gen_time).
+    double segment_time = 0;
+    // Optimisation passes.
+    double opt_time = 0;
+    // Machine codegen.
+    double codegen_time = 0;
+    // Addition of the object code to the jit and symbol lookup.
+    double link_time = 0;
+    // Number of IR instructions before and after the optimisation.
+    std::uint64_t n_ir_instructions = 0;
+    std::uint64_t n_opt_ir_instructions = 0;
+    // Size (in bytes) of the object code.
+    std::uint64_t object_size = 0;
+    // Automatic selection of the compact mode (see compact_mode_auto):
+    // the estimated number of operations in the default-mode computation
+    // of the Taylor derivatives (zero if no selection took place), the
+    // threshold above which the compact mode is selected, and the selection.
+    std::uint64_t cm_estimate = 0;
+    std::uint64_t cm_threshold = 0;
+    bool cm_selected = false;
+};
+
+HEYOKA_DLL_PUBLIC std::ostream &operator<<(std::ostream &, const llvm_state_stats &);
+
+// Breakdown of the memory (in bytes) used by an llvm_state.
+struct HEYOKA_DLL_PUBLIC llvm_state_memory_usage {
+    // The IR snapshot (in bitcode format) of the compiled
+    // module (see drop_ir_snapshot()).
+    std::size_t ir_snapshot = 0;
+    // The object code saved in the state (see the
+    // 'save_object_code' keyword argument).
+    std::size_t object_code = 0;
+    // The IR and object code of the ISA variants.
+    std::size_t variants = 0;
+    // The IR of the PGO-instrumented module.
+    std::size_t pgo_ir = 0;
+    // The object code loaded into the jit.
+    // NOTE: the jit is shared among the copies of
+    // a compiled state, and this memory is thus
+    // shared as well.
+    std::size_t jit_code = 0;
+
+    std::size_t total() const;
+};
+
+HEYOKA_DLL_PUBLIC std::ostream &operator<<(std::ostream &, const llvm_state_memory_usage &);
+
 namespace kw
 {
 
@@ -54,31 +182,169 @@ IGOR_MAKE_NAMED_ARGUMENT(opt_level);
 IGOR_MAKE_NAMED_ARGUMENT(fast_math);
 IGOR_MAKE_NAMED_ARGUMENT(save_object_code);
 IGOR_MAKE_NAMED_ARGUMENT(inline_functions);
+IGOR_MAKE_NAMED_ARGUMENT(cache_dir);
+IGOR_MAKE_NAMED_ARGUMENT(compile_threads);
+IGOR_MAKE_NAMED_ARGUMENT(prefer_vw512);
+IGOR_MAKE_NAMED_ARGUMENT(target_cpu);
+IGOR_MAKE_NAMED_ARGUMENT(target_features);
+IGOR_MAKE_NAMED_ARGUMENT(opt_profile);
+IGOR_MAKE_NAMED_ARGUMENT(sleef_accuracy);
+IGOR_MAKE_NAMED_ARGUMENT(jit_listeners);
+IGOR_MAKE_NAMED_ARGUMENT(sleef_bitcode);
+IGOR_MAKE_NAMED_ARGUMENT(ir_snapshot);
 
 } // namespace kw
 
 HEYOKA_DLL_PUBLIC std::ostream &operator<<(std::ostream &, const llvm_state &);
 
+// Helpers to determine the batch size which makes the best use of the
+// SIMD capabilities of the host machine. If the boolean argument is true,
+// 512-bit vectors are assumed to be enabled (see the prefer_vw512
+// keyword argument of llvm_state).
+HEYOKA_DLL_PUBLIC std::uint32_t recommended_batch_size_dbl(bool = false);
+HEYOKA_DLL_PUBLIC std::uint32_t recommended_batch_size_ldbl(bool = false);
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+HEYOKA_DLL_PUBLIC std::uint32_t recommended_batch_size_f128(bool = false);
+
+#endif
+
+template <typename T>
+inline std::uint32_t recommended_batch_size(bool vw512 = false)
+{
+    if constexpr (std::is_same_v<T, double>) {
+        return recommended_batch_size_dbl(vw512);
+    } else if constexpr (std::is_same_v<T, long double>) {
+        return recommended_batch_size_ldbl(vw512);
+#if defined(HEYOKA_HAVE_REAL128)
+    } else if constexpr (std::is_same_v<T, mppp::real128>) {
+        return recommended_batch_size_f128(vw512);
+#endif
+    } else {
+        static_assert(detail::always_false_v<T>, "Unhandled type.");
+    }
+}
+
+// NOTE: distinct llvm_state objects (and thus the integrators
+// built on top of them) can be constructed, optimised and compiled
+// concurrently from multiple threads. A single llvm_state object must
+// not be accessed concurrently from multiple threads, while the compiled
+// code can be run concurrently (unless specified otherwise).
 class HEYOKA_DLL_PUBLIC llvm_state
 {
     friend HEYOKA_DLL_PUBLIC std::ostream &operator<<(std::ostream &, const llvm_state &);
+    friend const detail::target_features &detail::get_target_features(const llvm_state &);
 
     struct jit;
 
-    std::unique_ptr<jit> m_jitter;
+    // NOTE: the jit is shared (and never mutated) among
+    // copies of a compiled llvm_state.
+    std::shared_ptr<jit> m_jitter;
     std::unique_ptr<llvm::Module> m_module;
     std::unique_ptr<ir_builder> m_builder;
     unsigned m_opt_level;
-    std::string m_ir_snapshot;
+    // NOTE: the IR snapshot is immutable, and it
+    // is shared among copies of a compiled llvm_state.
+    // The snapshot is stored in bitcode format, and the
+    // textual IR is re-created from it on demand (see get_ir()).
+    std::shared_ptr<const std::string> m_ir_snapshot;
     bool m_fast_math;
     std::string m_module_name;
     bool m_save_object_code;
     std::string m_object_code;
     bool m_inline_functions;
+    // The directory of the on-disk object code
+    // cache (empty if the cache is disabled).
+    std::string m_cache_dir;
+    // The number of threads used in the
+    // optimisation and codegen of the module.
+    unsigned m_n_compile_threads;
+    // Flag to enable the use of 512-bit vectors
+    // on AVX-512 capable targets.
+    bool m_prefer_vw512;
+    // The target CPU and target features requested
+    // by the user (if empty, the properties of the
+    // host machine are used).
+    // NOTE: the target triple is always the one of the
+    // host, as the compiled code is linked and run in-process
+    // by the jit. Accelerator targets (e.g., NVPTX/AMDGPU) would
+    // need a device runtime and a different calling convention for
+    // the state buffers, and they are not supported.
+    std::string m_target_cpu;
+    std::string m_target_features;
+    // The optimisation pipeline profile.
+    opt_profile m_opt_profile;
+    // The accuracy tier of the SLEEF functions.
+    sleef_accuracy m_sleef_accuracy;
+    // The JIT event listeners.
+    jit_listener m_jit_listeners;
+    // The path of an LLVM bitcode (or textual IR) file (e.g., SLEEF's bitcode library)
+    // providing the definitions of the external functions invoked by the
+    // module. If not empty, the definitions are linked into the module
+    // in optimise() (see link_sleef_bitcode()), so that they can be inlined.
+    std::string m_sleef_bitcode;
+    // Flag to enable the creation of the IR snapshot
+    // during compilation. If the snapshot is disabled, the object
+    // code is stored in the state instead, so that the state can
+    // still be copied and serialised.
+    bool m_ir_snapshot_enabled;
+    // Timings and statistics.
+    llvm_state_stats m_stats;
+    // The cache key of the module and the object code
+    // fetched from the cache, if any.
+    std::string m_cache_key;
+    std::string m_cached_object;
+    bool m_cache_hit = false;
+    // Additional variants of the compiled code, targeting
+    // other CPUs (see add_variant()). For each variant
+    // we store the target CPU/features requested by the
+    // user, the effective target features, the IR snapshot
+    // and the object code.
+    struct isa_variant {
+        std::string cpu, features, eff_features, ir, obj;
+    };
+    std::vector<isa_variant> m_variants;
+    // The functions to be compiled lazily
+    // (see mark_lazy()).
+    std::vector<std::string> m_lazy_functions;
+    // Profile-guided optimisation: the instrumentation
+    // flag and the IR of the instrumented module before
+    // optimisation (see pgo_instrument()).
+    bool m_pgo_instrument = false;
+    std::string m_pgo_ir;
+    // Flag signalling that the IR snapshot was dropped
+    // (see drop_ir_snapshot()) or that it was not created
+    // (see the 'ir_snapshot' keyword argument).
+    bool m_ir_dropped = false;
+    // The prefix prepended to the names passed
+    // to jit_lookup() (see set_symbol_prefix()).
+    std::string m_sym_prefix;
 
     // Check functions.
     HEYOKA_DLL_LOCAL void check_uncompiled(const char *) const;
     HEYOKA_DLL_LOCAL void check_compiled(const char *) const;
+    HEYOKA_DLL_LOCAL void check_ir_snapshot(const char *) const;
+
+    // Cache machinery.
+    HEYOKA_DLL_LOCAL std::string get_cache_key() const;
+    HEYOKA_DLL_LOCAL std::string get_cache_path() const;
+    HEYOKA_DLL_LOCAL void cache_lookup();
+    HEYOKA_DLL_LOCAL void cache_store(const std::string &) const;
+
+    // Helpers to parse IR into the module and
+    // to run codegen on the module.
+    HEYOKA_DLL_LOCAL void parse_ir(const std::string &);
+    HEYOKA_DLL_LOCAL void parse_bitcode(const std::string &);
+    HEYOKA_DLL_LOCAL std::string emit_object_code();
+    HEYOKA_DLL_LOCAL std::string get_compiled_object_code() const;
+
+    // Parallel optimisation/codegen.
+    HEYOKA_DLL_LOCAL void parallel_optimise();
+    HEYOKA_DLL_LOCAL void parallel_compile();
+
+    // Linking of the bitcode of the external functions.
+    HEYOKA_DLL_LOCAL void link_sleef_bitcode();
 
     // Implementation details for the variadic constructor.
     template <typename... KwArgs>
@@ -136,10 +402,107 @@ class HEYOKA_DLL_PUBLIC llvm_state
                 }
             }();
 
-            return std::tuple{std::move(mod_name), opt_level, fmath, socode, i_func};
+            // Cache directory (defaults to empty string,
+            // that is, no cache).
+            auto c_dir = [&p]() -> std::string {
+                if constexpr (p.has(kw::cache_dir)) {
+                    return std::forward<decltype(p(kw::cache_dir))>(p(kw::cache_dir));
+                } else {
+                    return "";
+                }
+            }();
+
+            // Number of compilation threads (defaults to 1). A value
+            // of 0 means the number of hardware threads.
+            auto n_c_threads = [&p]() -> unsigned {
+                if constexpr (p.has(kw::compile_threads)) {
+                    return std::forward<decltype(p(kw::compile_threads))>(p(kw::compile_threads));
+                } else {
+                    return 1;
+                }
+            }();
+
+            // Prefer 512-bit vectors (defaults to false).
+            auto vw512 = [&p]() -> bool {
+                if constexpr (p.has(kw::prefer_vw512)) {
+                    return std::forward<decltype(p(kw::prefer_vw512))>(p(kw::prefer_vw512));
+                } else {
+                    return false;
+                }
+            }();
+
+            // Target CPU and target features (default to empty
+            // strings, that is, the host CPU and its features).
+            auto t_cpu = [&p]() -> std::string {
+                if constexpr (p.has(kw::target_cpu)) {
+                    return std::forward<decltype(p(kw::target_cpu))>(p(kw::target_cpu));
+                } else {
+                    return "";
+                }
+            }();
+            auto t_features = [&p]() -> std::string {
+                if constexpr (p.has(kw::target_features)) {
+                    return std::forward<decltype(p(kw::target_features))>(p(kw::target_features));
+                } else {
+                    return "";
+                }
+            }();
+
+            // Optimisation pipeline profile (defaults to standard).
+            auto o_profile = [&p]() -> opt_profile {
+                if constexpr (p.has(kw::opt_profile)) {
+                    return std::forward<decltype(p(kw::opt_profile))>(p(kw::opt_profile));
+                } else {
+                    return opt_profile::standard;
+                }
+            }();
+
+            // Accuracy tier of the SLEEF functions (defaults to u10).
+            auto s_acc = [&p]() -> sleef_accuracy {
+                if constexpr (p.has(kw::sleef_accuracy)) {
+                    return std::forward<decltype(p(kw::sleef_accuracy))>(p(kw::sleef_accuracy));
+                } else {
+                    return sleef_accuracy::u10;
+                }
+            }();
+
+            // JIT event listeners (defaults to none).
+            auto jit_ls = [&p]() -> jit_listener {
+                if constexpr (p.has(kw::jit_listeners)) {
+                    return std::forward<decltype(p(kw::jit_listeners))>(p(kw::jit_listeners));
+                } else {
+                    return jit_listener::none;
+                }
+            }();
+
+            // Path of the bitcode file providing the definitions
+            // of the external functions (defaults to empty string,
+            // that is, the external functions are not linked in).
+            auto s_bc = [&p]() -> std::string {
+                if constexpr (p.has(kw::sleef_bitcode)) {
+                    return std::forward<decltype(p(kw::sleef_bitcode))>(p(kw::sleef_bitcode));
+                } else {
+                    return "";
+                }
+            }();
+
+            // Creation of the IR snapshot during
+            // compilation (defaults to true).
+            auto ir_snap = [&p]() -> bool {
+                if constexpr (p.has(kw::ir_snapshot)) {
+                    return std::forward<decltype(p(kw::ir_snapshot))>(p(kw::ir_snapshot));
+                } else {
+                    return true;
+                }
+            }();
+
+            return std::tuple{std::move(mod_name), opt_level, fmath, socode, i_func, std::move(c_dir), n_c_threads,
+                              vw512, std::move(t_cpu), std::move(t_features), o_profile, s_acc, jit_ls,
+                              std::move(s_bc), ir_snap};
         }
     }
-    explicit llvm_state(std::tuple<std::string, unsigned, bool, bool, bool> &&);
+    explicit llvm_state(std::tuple<std::string, unsigned, bool, bool, bool, std::string, unsigned, bool, std::string,
+                                   std::string, opt_profile, sleef_accuracy, jit_listener, std::string, bool> &&);
 
 public:
     llvm_state();
@@ -168,6 +531,8 @@ public:
     unsigned &opt_level();
     bool &fast_math();
     bool &inline_functions();
+    bool &prefer_vw512();
+    llvm_state_stats &stats();
 
     const llvm::Module &module() const;
     const ir_builder &builder() const;
@@ -175,14 +540,42 @@ public:
     const unsigned &opt_level() const;
     const bool &fast_math() const;
     const bool &inline_functions() const;
+    const bool &prefer_vw512() const;
+    const llvm_state_stats &stats() const;
+    const std::string &get_cache_dir() const;
+    unsigned get_compile_threads() const;
+    std::string get_target_cpu() const;
+    std::string get_target_features() const;
+    opt_profile get_opt_profile() const;
+    sleef_accuracy get_sleef_accuracy() const;
+    jit_listener get_jit_listeners() const;
+    const std::string &get_sleef_bitcode() const;
+    double get_optimise_time() const;
+    double get_compile_time() const;
+    bool cache_hit() const;
 
     std::string get_ir() const;
     void dump_object_code(const std::string &) const;
     const std::string &get_object_code() const;
+    void load_object_code(const std::string &);
+
+    llvm_state_memory_usage memory_usage() const;
+    void drop_ir_snapshot();
+    bool ir_snapshot_dropped() const;
 
     void verify_function(const std::string &);
     void verify_function(llvm::Function *);
 
+    void mark_lazy(const std::string &);
+
+    void link_module(const llvm_state &, const std::string &);
+    void set_symbol_prefix(std::string);
+    const std::string &get_symbol_prefix() const;
+
+    void pgo_instrument();
+    bool pgo_instrumented() const;
+    void pgo_recompile();
+
     void optimise();
 
     bool is_compiled() const;
@@ -190,6 +583,20 @@ public:
     void compile();
 
     std::uintptr_t jit_lookup(const std::string &);
+
+    llvm_state deep_copy() const;
+    // Create an uncompiled copy of the state from the IR
+    // (the IR snapshot, if the state is compiled). The copy has
+    // its own jit, and it can be optimised (e.g., with a different
+    // optimisation level) and compiled in another thread.
+    llvm_state uncompiled_copy() const;
+
+    llvm_state make_variant(const std::string &, const std::string & = "") const;
+    void add_variant(const llvm_state &);
+    std::size_t get_n_variants() const;
+
+    void save(std::ostream &) const;
+    void load(std::istream &);
 };
 
 } // namespace heyoka
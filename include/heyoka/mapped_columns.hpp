@@ -0,0 +1,67 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef HEYOKA_MAPPED_COLUMNS_HPP
+#define HEYOKA_MAPPED_COLUMNS_HPP
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#include <heyoka/detail/visibility.hpp>
+
+namespace heyoka
+{
+
+namespace detail
+{
+
+struct mapped_columns_impl;
+
+} // namespace detail
+
+// Read-only memory mapping of a binary file containing a columnar dataset:
+// n_cols columns of n_points values of type T each, stored in the native
+// representation one column after the other, without any header. The number
+// of points is deduced from the size of the file.
+//
+// The layout of the mapped data is the layout of the input of the batch evaluation
+// of the compiled functions (i.e., a row-major array of size n_cols x n_points), and
+// thus the dataset can be evaluated in place, without copies. The columns can also be
+// passed to eval_batch_dbl_cols().
+template <typename T>
+class HEYOKA_DLL_PUBLIC mapped_columns
+{
+    std::unique_ptr<detail::mapped_columns_impl> m_impl;
+    std::size_t m_n_cols = 0;
+    std::size_t m_n_points = 0;
+
+public:
+    explicit mapped_columns(const std::string &, std::size_t);
+    mapped_columns(mapped_columns &&) noexcept;
+    mapped_columns &operator=(mapped_columns &&) noexcept;
+    ~mapped_columns();
+
+    std::size_t get_n_cols() const
+    {
+        return m_n_cols;
+    }
+    std::size_t get_n_points() const
+    {
+        return m_n_points;
+    }
+
+    // NOTE: the returned pointers are null
+    // if the dataset contains no points.
+    const T *data() const;
+    const T *column(std::size_t) const;
+};
+
+} // namespace heyoka
+
+#endif
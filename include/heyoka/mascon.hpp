@@ -13,14 +13,34 @@
 #include <heyoka/expression.hpp>
 #include <heyoka/kw.hpp>
 #include <heyoka/math.hpp>
+#include <heyoka/taylor.hpp>
+#include <array>
+#include <cstdint>
+#include <iterator>
+#include <stdexcept>
+#include <string>
 #include <vector>
 
 namespace heyoka
 {
 
+namespace kw
+{
+
+IGOR_MAKE_NAMED_ARGUMENT(min_radius);
+
+} // namespace kw
+
 namespace detail
 {
 
+// Assemble the equations of motion in the frame rotating with the asteroid
+// from the gravitational accelerations (as lists of terms to be summed) and
+// from the angular velocity. The state variables are x, y, z, vx, vy, vz.
+HEYOKA_DLL_PUBLIC std::vector<std::pair<expression, expression>>
+mascon_assemble_system(std::vector<expression>, std::vector<expression>, std::vector<expression>, const expression &,
+                       const expression &, const expression &);
+
 HEYOKA_DLL_PUBLIC std::vector<std::pair<expression, expression>>
     make_mascon_system_impl(expression, std::vector<std::vector<expression>>, std::vector<expression>, expression,
                             expression, expression);
@@ -29,6 +49,13 @@ HEYOKA_DLL_PUBLIC expression energy_mascon_system_impl(expression, std::vector<e
                                                        std::vector<std::vector<expression>>, std::vector<expression>,
                                                        expression, expression, expression);
 
+HEYOKA_DLL_PUBLIC std::vector<std::pair<expression, expression>> make_mascon_par_system_impl(std::uint32_t,
+                                                                                            expression);
+
+HEYOKA_DLL_PUBLIC std::vector<std::pair<expression, expression>>
+make_mascon_multipole_system_impl(double, std::vector<std::array<double, 3>>, std::vector<double>,
+                                  std::array<double, 3>, double, double);
+
 } // namespace detail
 
 // mascon_points -> [N,3] array containing the positions of the masses (units L)
@@ -100,6 +127,176 @@ inline std::vector<std::pair<expression, expression>> make_mascon_system(KwArgs
     }
 }
 
+// Version of make_mascon_system() in which the positions and the masses of the n mascon points
+// and the angular velocity of the asteroid are runtime parameters, so that the same compiled
+// integrator can be re-used for different mascon models with the same number of points
+// (or for updates of the model). The layout of the parameters is:
+//
+// par[4 * i], par[4 * i + 1], par[4 * i + 2] -> position of the i-th mascon point (units L)
+// par[4 * i + 3] -> mass of the i-th mascon point (units M)
+// par[4 * n], par[4 * n + 1], par[4 * n + 2] -> angular velocity of the asteroid (units rad/T)
+//
+// (see make_mascon_pars()). The only kwarg is GConst (defaults to 1).
+//
+// NOTE: in compact mode, the contributions of the mascon points are computed by loops
+// reading the parameters from the array, thus neither the size of the
+// generated code nor the construction time depend on the values of the parameters.
+template <typename... KwArgs>
+inline std::vector<std::pair<expression, expression>> make_mascon_par_system(std::uint32_t n, KwArgs &&...kw_args)
+{
+    igor::parser p{kw_args...};
+    if constexpr (p.has_unnamed_arguments()) {
+        static_assert(detail::always_false_v<KwArgs...>,
+                      "The variadic arguments in the construction of the mascon system contain "
+                      "unnamed arguments.");
+    } else {
+        // G constant (defaults to 1).
+        auto Gconst = [&p]() {
+            if constexpr (p.has(kw::Gconst)) {
+                return expression{number{std::forward<decltype(p(kw::Gconst))>(p(kw::Gconst))}};
+            } else {
+                return expression{number{1.}};
+            }
+        }();
+
+        return detail::make_mascon_par_system_impl(n, std::move(Gconst));
+    }
+}
+
+// Construct the array of parameters for the system returned by make_mascon_par_system()
+// from the positions and the masses of the mascon points and from the angular velocity.
+template <typename P, typename M, typename W>
+inline std::vector<double> make_mascon_pars(const P &mascon_points, const M &mascon_masses, const W &omega)
+{
+    if (std::size(mascon_points) != std::size(mascon_masses)) {
+        throw std::invalid_argument("Inconsistent sizes detected in make_mascon_pars(): the number of mascon points is "
+                                    + std::to_string(std::size(mascon_points))
+                                    + ", while the number of mascon masses is "
+                                    + std::to_string(std::size(mascon_masses)));
+    }
+
+    std::vector<double> retval;
+
+    auto m_it = std::begin(mascon_masses);
+    for (const auto &point : mascon_points) {
+        if (std::size(point) != 3) {
+            throw std::invalid_argument("All mascon points must have a dimension of exactly 3. A dimension of "
+                                        + std::to_string(std::size(point))
+                                        + " was detected in make_mascon_pars().");
+        }
+
+        retval.push_back(static_cast<double>(point[0]));
+        retval.push_back(static_cast<double>(point[1]));
+        retval.push_back(static_cast<double>(point[2]));
+        retval.push_back(static_cast<double>(*m_it));
+        ++m_it;
+    }
+
+    retval.push_back(static_cast<double>(omega[0]));
+    retval.push_back(static_cast<double>(omega[1]));
+    retval.push_back(static_cast<double>(omega[2]));
+
+    return retval;
+}
+
+// Approximated version of make_mascon_system(), valid for orbits that lie outside
+// the sphere of radius min_radius centred in the origin. The mascon points are sorted
+// into an octree, and the clusters of points which are far enough from the sphere
+// are replaced by their multipole expansion (up to the quadrupole) around their
+// centre of mass. The kwargs are the same as in make_mascon_system(), plus:
+//
+// tol kwarg -> estimated upper bound for the relative error in the acceleration due
+//              to each cluster (no default)
+// min_radius kwarg -> radius of the sphere (units L, no default)
+//
+// The number of terms (and thus the cost of the Taylor jet) decreases with the
+// tolerance and with the radius of the sphere.
+//
+// NOTE: contrary to make_mascon_system(), the positions and mascon_masses
+// of the mascon points must be numerical values.
+//
+// NOTE: the Taylor derivatives of all the terms are computed in the precision of the
+// integrator, as there is no way of evaluating a part of the decomposition in a lower
+// precision. With extended-precision integrators, this function is thus the way of reducing
+// the cost of the far-field terms: the multipole coefficients of the clusters are computed in
+// double precision, only the clusters close to the sphere are summed directly and the
+// accumulation of all the terms happens in the precision of the integrator.
+template <typename... KwArgs>
+inline std::vector<std::pair<expression, expression>> make_mascon_multipole_system(KwArgs &&...kw_args)
+{
+    igor::parser p{kw_args...};
+    if constexpr (p.has_unnamed_arguments()) {
+        static_assert(detail::always_false_v<KwArgs...>,
+                      "The variadic arguments in the construction of the mascon multipole system contain "
+                      "unnamed arguments.");
+    } else {
+        // G constant (defaults to 1).
+        const auto Gconst = [&p]() -> double {
+            if constexpr (p.has(kw::Gconst)) {
+                return std::forward<decltype(p(kw::Gconst))>(p(kw::Gconst));
+            } else {
+                return 1.;
+            }
+        }();
+
+        // mascon_points (no default)
+        std::vector<std::array<double, 3>> mascon_points;
+        if constexpr (p.has(kw::points)) {
+            for (const auto &point : p(kw::points)) {
+                if (std::size(point) == 3) {
+                    mascon_points.push_back(std::array<double, 3>{static_cast<double>(point[0]),
+                                                                  static_cast<double>(point[1]),
+                                                                  static_cast<double>(point[2])});
+                } else {
+                    throw std::invalid_argument("All mascon points must have a dimension of exactly 3. A dimension of "
+                                                + std::to_string(std::size(point))
+                                                + " was detected when constructing the mascon multipole system.");
+                }
+            }
+        } else {
+            static_assert(detail::always_false_v<KwArgs...>, "mascon_points is missing from the kwarg list!");
+        };
+
+        // mascon_masses (no default)
+        std::vector<double> mascon_masses;
+        if constexpr (p.has(kw::masses)) {
+            for (const auto &mass : p(kw::masses)) {
+                mascon_masses.push_back(static_cast<double>(mass));
+            }
+        } else {
+            static_assert(detail::always_false_v<KwArgs...>, "mascon_masses is missing from the kwarg list!");
+        };
+
+        // omega (no default)
+        std::array<double, 3> omega{};
+        if constexpr (p.has(kw::omega)) {
+            omega = {static_cast<double>(p(kw::omega)[0]), static_cast<double>(p(kw::omega)[1]),
+                     static_cast<double>(p(kw::omega)[2])};
+        } else {
+            static_assert(detail::always_false_v<KwArgs...>, "omega is missing from the kwarg list!");
+        };
+
+        // tol (no default)
+        double tol;
+        if constexpr (p.has(kw::tol)) {
+            tol = std::forward<decltype(p(kw::tol))>(p(kw::tol));
+        } else {
+            static_assert(detail::always_false_v<KwArgs...>, "tol is missing from the kwarg list!");
+        };
+
+        // min_radius (no default)
+        double min_radius;
+        if constexpr (p.has(kw::min_radius)) {
+            min_radius = std::forward<decltype(p(kw::min_radius))>(p(kw::min_radius));
+        } else {
+            static_assert(detail::always_false_v<KwArgs...>, "min_radius is missing from the kwarg list!");
+        };
+
+        return detail::make_mascon_multipole_system_impl(Gconst, std::move(mascon_points), std::move(mascon_masses),
+                                                         omega, tol, min_radius);
+    }
+}
+
 // x -> system state
 // mascon_points -> [N,3] array containing the positions of the masses (units L)
 // mascon_masses -> [N] array containing the position of the masses (units M)
@@ -17,17 +17,25 @@
 #include <heyoka/math/atanh.hpp>
 #include <heyoka/math/cos.hpp>
 #include <heyoka/math/cosh.hpp>
+#include <heyoka/math/dot.hpp>
+#include <heyoka/math/ephem.hpp>
 #include <heyoka/math/erf.hpp>
 #include <heyoka/math/exp.hpp>
+#include <heyoka/math/inv.hpp>
+#include <heyoka/math/kepE.hpp>
 #include <heyoka/math/log.hpp>
 #include <heyoka/math/pow.hpp>
+#include <heyoka/math/rsqrt.hpp>
 #include <heyoka/math/sigmoid.hpp>
 #include <heyoka/math/sin.hpp>
 #include <heyoka/math/sinh.hpp>
 #include <heyoka/math/sqrt.hpp>
 #include <heyoka/math/square.hpp>
+#include <heyoka/math/sum.hpp>
 #include <heyoka/math/tan.hpp>
 #include <heyoka/math/tanh.hpp>
+#include <heyoka/math/tharm.hpp>
 #include <heyoka/math/time.hpp>
+#include <heyoka/math/tpoly.hpp>
 
 #endif
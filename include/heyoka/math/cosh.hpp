@@ -37,6 +37,8 @@ public:
     llvm::Value *codegen_f128(llvm_state &, const std::vector<llvm::Value *> &) const;
 #endif
 
+    interval eval_interval_dbl(const std::vector<interval> &) const;
+
     std::vector<std::pair<expression, std::vector<std::uint32_t>>>::size_type
     taylor_decompose(std::vector<std::pair<expression, std::vector<std::uint32_t>>> &) &&;
     llvm::Value *taylor_diff_dbl(llvm_state &, const std::vector<std::uint32_t> &, const std::vector<llvm::Value *> &,
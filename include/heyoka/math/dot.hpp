@@ -0,0 +1,81 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef HEYOKA_MATH_DOT_HPP
+#define HEYOKA_MATH_DOT_HPP
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <heyoka/config.hpp>
+#include <heyoka/detail/fwd_decl.hpp>
+#include <heyoka/detail/llvm_fwd.hpp>
+#include <heyoka/detail/visibility.hpp>
+#include <heyoka/func.hpp>
+
+namespace heyoka
+{
+
+namespace detail
+{
+
+// Dot product of a vector of numerical/param coefficients
+// and a vector of terms. The arguments are stored as the
+// interleaved sequence c0, x0, c1, x1, ...
+class HEYOKA_DLL_PUBLIC dot_impl : public func_base
+{
+public:
+    dot_impl();
+    explicit dot_impl(std::vector<expression>, std::vector<expression>);
+
+    llvm::Value *codegen_dbl(llvm_state &, const std::vector<llvm::Value *> &) const;
+    llvm::Value *codegen_ldbl(llvm_state &, const std::vector<llvm::Value *> &) const;
+#if defined(HEYOKA_HAVE_REAL128)
+    llvm::Value *codegen_f128(llvm_state &, const std::vector<llvm::Value *> &) const;
+#endif
+
+    expression diff(const std::string &) const;
+
+    interval eval_interval_dbl(const std::vector<interval> &) const;
+
+    llvm::Value *taylor_diff_dbl(llvm_state &, const std::vector<std::uint32_t> &, const std::vector<llvm::Value *> &,
+                                 llvm::Value *, llvm::Value *, std::uint32_t, std::uint32_t, std::uint32_t,
+                                 std::uint32_t) const;
+    llvm::Value *taylor_diff_ldbl(llvm_state &, const std::vector<std::uint32_t> &, const std::vector<llvm::Value *> &,
+                                  llvm::Value *, llvm::Value *, std::uint32_t, std::uint32_t, std::uint32_t,
+                                  std::uint32_t) const;
+#if defined(HEYOKA_HAVE_REAL128)
+    llvm::Value *taylor_diff_f128(llvm_state &, const std::vector<std::uint32_t> &, const std::vector<llvm::Value *> &,
+                                  llvm::Value *, llvm::Value *, std::uint32_t, std::uint32_t, std::uint32_t,
+                                  std::uint32_t) const;
+#endif
+    llvm::Function *taylor_c_diff_func_dbl(llvm_state &, std::uint32_t, std::uint32_t) const;
+    llvm::Function *taylor_c_diff_func_ldbl(llvm_state &, std::uint32_t, std::uint32_t) const;
+#if defined(HEYOKA_HAVE_REAL128)
+    llvm::Function *taylor_c_diff_func_f128(llvm_state &, std::uint32_t, std::uint32_t) const;
+#endif
+};
+
+} // namespace detail
+
+// NOTE: the coefficients must be numbers or params.
+HEYOKA_DLL_PUBLIC expression dot(std::vector<expression>, std::vector<expression>);
+
+// Dense layer of a neural network: the n_out outputs are act(dot(w_i, inputs) + b_i), where
+// the weights w_i and the bias b_i of the i-th output are the params par[par_offset + i * (n_in + 1) + j],
+// with j in [0, n_in) for the weights and j == n_in for the bias. If act is empty, the layer is linear.
+// NOTE: the Taylor derivatives of each output are computed via a single dot product
+// per order, rather than via one multiplication per weight.
+HEYOKA_DLL_PUBLIC std::vector<expression> dense_layer(const std::vector<expression> &, std::uint32_t, std::uint32_t,
+                                                      const std::function<expression(expression)> & = {});
+
+} // namespace heyoka
+
+#endif
@@ -0,0 +1,108 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef HEYOKA_MATH_EPHEM_HPP
+#define HEYOKA_MATH_EPHEM_HPP
+
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <variant>
+#include <vector>
+
+#include <heyoka/config.hpp>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <heyoka/detail/fwd_decl.hpp>
+#include <heyoka/detail/llvm_fwd.hpp>
+#include <heyoka/detail/visibility.hpp>
+#include <heyoka/expression.hpp>
+#include <heyoka/func.hpp>
+
+namespace heyoka
+{
+
+template <typename>
+class taylor_cheb_traj;
+
+namespace detail
+{
+
+// A component of a precomputed trajectory, evaluated
+// as a function of time. The trajectory is shared among
+// the components and among the copies of the function.
+class HEYOKA_DLL_PUBLIC ephem_impl : public func_base
+{
+public:
+    using traj_ptr_t = std::variant<std::shared_ptr<const taylor_cheb_traj<double>>,
+                                    std::shared_ptr<const taylor_cheb_traj<long double>>
+#if defined(HEYOKA_HAVE_REAL128)
+                                    ,
+                                    std::shared_ptr<const taylor_cheb_traj<mppp::real128>>
+#endif
+                                    >;
+
+private:
+    traj_ptr_t m_traj;
+    std::uint32_t m_comp = 0;
+
+public:
+    ephem_impl();
+    explicit ephem_impl(std::string, traj_ptr_t, std::uint32_t);
+
+    const traj_ptr_t &get_traj() const;
+    std::uint32_t get_comp() const;
+
+    void to_stream(std::ostream &) const;
+
+    bool is_time_dependent() const;
+
+    expression diff(const std::string &) const;
+
+    llvm::Value *taylor_diff_dbl(llvm_state &, const std::vector<std::uint32_t> &, const std::vector<llvm::Value *> &,
+                                 llvm::Value *, llvm::Value *, std::uint32_t, std::uint32_t, std::uint32_t,
+                                 std::uint32_t) const;
+    llvm::Value *taylor_diff_ldbl(llvm_state &, const std::vector<std::uint32_t> &, const std::vector<llvm::Value *> &,
+                                  llvm::Value *, llvm::Value *, std::uint32_t, std::uint32_t, std::uint32_t,
+                                  std::uint32_t) const;
+#if defined(HEYOKA_HAVE_REAL128)
+    llvm::Value *taylor_diff_f128(llvm_state &, const std::vector<std::uint32_t> &, const std::vector<llvm::Value *> &,
+                                  llvm::Value *, llvm::Value *, std::uint32_t, std::uint32_t, std::uint32_t,
+                                  std::uint32_t) const;
+#endif
+    llvm::Function *taylor_c_diff_func_dbl(llvm_state &, std::uint32_t, std::uint32_t) const;
+    llvm::Function *taylor_c_diff_func_ldbl(llvm_state &, std::uint32_t, std::uint32_t) const;
+#if defined(HEYOKA_HAVE_REAL128)
+    llvm::Function *taylor_c_diff_func_f128(llvm_state &, std::uint32_t, std::uint32_t) const;
+#endif
+};
+
+} // namespace detail
+
+// Turn a precomputed trajectory into functions of time, one per state variable, which can be used
+// in the right-hand side of an ODE system (e.g., for the positions of perturbing bodies whose motion is
+// known in advance). The Taylor derivatives are computed from the Chebyshev series of the trajectory at
+// the time of the current step, so that the perturbers do not contribute to the dimension of the system.
+// The floating-point type of the trajectory must match the floating-point type of the integrator. Outside
+// the time range of the trajectory, the functions evaluate to NaN (and thus the integration stops with a
+// non-finite state).
+// NOTE: the trajectory is copied and kept alive by the returned expressions (and by the integrators
+// constructed from them), but the JIT-compiled code refers to it by address. Hence, llvm_state objects
+// extracted from an integrator must not outlive it. The functions cannot be serialised.
+template <typename T>
+HEYOKA_DLL_PUBLIC std::vector<expression> ephem(const taylor_cheb_traj<T> &);
+
+} // namespace heyoka
+
+#endif
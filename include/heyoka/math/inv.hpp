@@ -0,0 +1,25 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef HEYOKA_MATH_INV_HPP
+#define HEYOKA_MATH_INV_HPP
+
+#include <heyoka/detail/fwd_decl.hpp>
+#include <heyoka/detail/visibility.hpp>
+
+namespace heyoka
+{
+
+// The reciprocal 1 / x.
+// NOTE: this is implemented as pow(x, -1), which has a dedicated
+// (division-free) Taylor recurrence.
+HEYOKA_DLL_PUBLIC expression inv(expression);
+
+} // namespace heyoka
+
+#endif
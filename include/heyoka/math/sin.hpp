@@ -46,6 +46,7 @@ public:
                         const std::vector<double> &) const;
     double eval_num_dbl(const std::vector<double> &) const;
     double deval_num_dbl(const std::vector<double> &, std::vector<double>::size_type) const;
+    interval eval_interval_dbl(const std::vector<interval> &) const;
 
     std::vector<std::pair<expression, std::vector<std::uint32_t>>>::size_type
     taylor_decompose(std::vector<std::pair<expression, std::vector<std::uint32_t>>> &) &&;
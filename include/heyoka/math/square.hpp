@@ -40,6 +40,8 @@ public:
 
     expression diff(const std::string &) const;
 
+    interval eval_interval_dbl(const std::vector<interval> &) const;
+
     llvm::Value *taylor_diff_dbl(llvm_state &, const std::vector<std::uint32_t> &, const std::vector<llvm::Value *> &,
                                  llvm::Value *, llvm::Value *, std::uint32_t, std::uint32_t, std::uint32_t,
                                  std::uint32_t) const;
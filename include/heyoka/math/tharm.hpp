@@ -0,0 +1,76 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef HEYOKA_MATH_THARM_HPP
+#define HEYOKA_MATH_THARM_HPP
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <heyoka/config.hpp>
+#include <heyoka/detail/fwd_decl.hpp>
+#include <heyoka/detail/llvm_fwd.hpp>
+#include <heyoka/detail/visibility.hpp>
+#include <heyoka/expression.hpp>
+#include <heyoka/func.hpp>
+
+namespace heyoka
+{
+
+namespace detail
+{
+
+// Harmonic function of time, cos(omega * t + phi) or sin(omega * t + phi),
+// with the frequency omega and the phase phi given as numbers or params.
+class HEYOKA_DLL_PUBLIC tharm_impl : public func_base
+{
+public:
+    tharm_impl();
+    explicit tharm_impl(bool, expression, expression);
+
+    bool is_sin() const;
+
+    void to_stream(std::ostream &) const;
+
+    bool is_time_dependent() const;
+
+    expression diff(const std::string &) const;
+
+    llvm::Value *taylor_diff_dbl(llvm_state &, const std::vector<std::uint32_t> &, const std::vector<llvm::Value *> &,
+                                 llvm::Value *, llvm::Value *, std::uint32_t, std::uint32_t, std::uint32_t,
+                                 std::uint32_t) const;
+    llvm::Value *taylor_diff_ldbl(llvm_state &, const std::vector<std::uint32_t> &, const std::vector<llvm::Value *> &,
+                                  llvm::Value *, llvm::Value *, std::uint32_t, std::uint32_t, std::uint32_t,
+                                  std::uint32_t) const;
+#if defined(HEYOKA_HAVE_REAL128)
+    llvm::Value *taylor_diff_f128(llvm_state &, const std::vector<std::uint32_t> &, const std::vector<llvm::Value *> &,
+                                  llvm::Value *, llvm::Value *, std::uint32_t, std::uint32_t, std::uint32_t,
+                                  std::uint32_t) const;
+#endif
+    llvm::Function *taylor_c_diff_func_dbl(llvm_state &, std::uint32_t, std::uint32_t) const;
+    llvm::Function *taylor_c_diff_func_ldbl(llvm_state &, std::uint32_t, std::uint32_t) const;
+#if defined(HEYOKA_HAVE_REAL128)
+    llvm::Function *taylor_c_diff_func_f128(llvm_state &, std::uint32_t, std::uint32_t) const;
+#endif
+};
+
+} // namespace detail
+
+// Forcing terms of the form cos(omega * t + phi) and sin(omega * t + phi), where omega and phi must be numbers
+// or params. Contrary to cos(omega * heyoka::time + phi), which adds to the decomposition the u variables for the
+// argument and for the sine/cosine pair (whose Taylor derivatives are computed via convolutions), the Taylor
+// derivatives of these functions are computed via the recurrence a_n = -omega**2 * a_{n-2} / (n * (n - 1)), which
+// requires a single sine/cosine evaluation per step and O(1) operations for each order.
+HEYOKA_DLL_PUBLIC expression tcos(expression, expression = expression{0.});
+HEYOKA_DLL_PUBLIC expression tsin(expression, expression = expression{0.});
+
+} // namespace heyoka
+
+#endif
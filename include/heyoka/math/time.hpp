@@ -33,6 +33,8 @@ public:
 
     void to_stream(std::ostream &) const;
 
+    bool is_time_dependent() const;
+
     llvm::Value *taylor_diff_dbl(llvm_state &, const std::vector<std::uint32_t> &, const std::vector<llvm::Value *> &,
                                  llvm::Value *, llvm::Value *, std::uint32_t, std::uint32_t, std::uint32_t,
                                  std::uint32_t) const;
@@ -9,22 +9,35 @@
 #ifndef HEYOKA_NBODY_HPP
 #define HEYOKA_NBODY_HPP
 
+#include <heyoka/config.hpp>
+
 #include <array>
+#include <cstddef>
 #include <cstdint>
 #include <random>
 #include <stdexcept>
+#include <string>
+#include <tuple>
 #include <type_traits>
 #include <utility>
 #include <vector>
 
 #include <boost/numeric/conversion/cast.hpp>
 
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
 #include <heyoka/detail/fwd_decl.hpp>
 #include <heyoka/detail/igor.hpp>
 #include <heyoka/detail/type_traits.hpp>
 #include <heyoka/detail/visibility.hpp>
+#include <heyoka/expression.hpp>
 #include <heyoka/kw.hpp>
 #include <heyoka/number.hpp>
+#include <heyoka/taylor.hpp>
 
 namespace heyoka
 {
@@ -38,6 +51,12 @@ HEYOKA_DLL_PUBLIC std::vector<std::pair<expression, expression>> make_nbody_sys_
 HEYOKA_DLL_PUBLIC std::vector<std::pair<expression, expression>> make_nbody_sys_par_masses(std::uint32_t, number,
                                                                                            std::uint32_t);
 
+HEYOKA_DLL_PUBLIC std::vector<std::pair<expression, expression>> make_nbody_jacobi_sys_impl(std::uint32_t, number,
+                                                                                            std::vector<number>);
+
+HEYOKA_DLL_PUBLIC std::vector<std::pair<expression, expression>> make_nbody_dh_sys_impl(std::uint32_t, number,
+                                                                                        std::vector<number>);
+
 } // namespace detail
 
 // Create an ODE system representing a Newtonian N-body problem.
@@ -100,6 +119,135 @@ inline std::vector<std::pair<expression, expression>> make_nbody_sys(std::uint32
     }
 }
 
+namespace detail
+{
+
+// Parse the kwargs of the N-body systems in Jacobi/democratic heliocentric
+// coordinates (which are the same as in make_nbody_sys()).
+template <typename... KwArgs>
+inline auto make_nbody_rel_sys_args(std::uint32_t n, KwArgs &&...kw_args)
+{
+    if (n < 2u) {
+        throw std::invalid_argument("At least 2 bodies are needed to construct an N-body system");
+    }
+
+    igor::parser p{kw_args...};
+
+    if constexpr (p.has_unnamed_arguments()) {
+        static_assert(detail::always_false_v<KwArgs...>,
+                      "The variadic arguments in the construction of an N-body system contain "
+                      "unnamed arguments.");
+    } else {
+        // G constant (defaults to 1).
+        auto G_const = [&p]() {
+            if constexpr (p.has(kw::Gconst)) {
+                return number{std::forward<decltype(p(kw::Gconst))>(p(kw::Gconst))};
+            } else {
+                return number{1.};
+            }
+        }();
+
+        std::vector<number> masses_vec;
+
+        if constexpr (p.has(kw::masses)) {
+            for (const auto &mass_value : p(kw::masses)) {
+                masses_vec.emplace_back(mass_value);
+            }
+        } else {
+            masses_vec.resize(static_cast<decltype(masses_vec.size())>(n), number{1.});
+        }
+
+        return std::pair{std::move(G_const), std::move(masses_vec)};
+    }
+}
+
+} // namespace detail
+
+// Create an ODE system representing a Newtonian N-body problem in Jacobi coordinates.
+// The kwargs are the same as in make_nbody_sys(), and the mass of the first body
+// must not be zero. The state variables x_i, y_i, ..., vz_i (i in [1, n)) are the position
+// and velocity of body i relative to the centre of mass of the bodies [0, i), thus the
+// system has 6 * (n - 1) equations (the motion of the centre of mass is removed).
+// See nbody_to_jacobi() and nbody_from_jacobi() for the conversions from/to
+// barycentric states.
+//
+// NOTE: in hierarchical systems dominated by a central mass (e.g., planetary systems),
+// the Jacobi vectors are close to Keplerian orbits, and the frequent changes in
+// the barycentric velocity of the central body do not enter the state.
+template <typename... KwArgs>
+inline std::vector<std::pair<expression, expression>> make_nbody_jacobi_sys(std::uint32_t n, KwArgs &&...kw_args)
+{
+    auto [G_const, masses_vec] = detail::make_nbody_rel_sys_args(n, std::forward<KwArgs>(kw_args)...);
+
+    return detail::make_nbody_jacobi_sys_impl(n, std::move(G_const), std::move(masses_vec));
+}
+
+// Create an ODE system representing a Newtonian N-body problem in democratic heliocentric
+// coordinates. The kwargs are the same as in make_nbody_sys(), and the mass of the first
+// body must not be zero. The state variables x_i, y_i, z_i (i in [1, n)) are the position
+// of body i relative to body 0, while vx_i, vy_i, vz_i are the barycentric velocity of body i.
+// The system has 6 * (n - 1) equations. See nbody_to_dh() and nbody_from_dh()
+// for the conversions from/to barycentric states.
+template <typename... KwArgs>
+inline std::vector<std::pair<expression, expression>> make_nbody_dh_sys(std::uint32_t n, KwArgs &&...kw_args)
+{
+    auto [G_const, masses_vec] = detail::make_nbody_rel_sys_args(n, std::forward<KwArgs>(kw_args)...);
+
+    return detail::make_nbody_dh_sys_impl(n, std::move(G_const), std::move(masses_vec));
+}
+
+// Conversions between barycentric states (for n bodies, with the layout of make_nbody_sys())
+// and Jacobi/democratic heliocentric states (for the bodies [1, n), with the layout of
+// make_nbody_jacobi_sys() and make_nbody_dh_sys()). The masses must be finite and
+// non-negative, with a nonzero mass for the first body. The barycentric states produced
+// by nbody_from_jacobi() and nbody_from_dh() have the centre of mass at rest at the origin.
+HEYOKA_DLL_PUBLIC std::vector<double> nbody_to_jacobi(const std::vector<double> &, const std::vector<double> &);
+HEYOKA_DLL_PUBLIC std::vector<double> nbody_from_jacobi(const std::vector<double> &, const std::vector<double> &);
+HEYOKA_DLL_PUBLIC std::vector<double> nbody_to_dh(const std::vector<double> &, const std::vector<double> &);
+HEYOKA_DLL_PUBLIC std::vector<double> nbody_from_dh(const std::vector<double> &, const std::vector<double> &);
+
+// Create an ODE system representing a perturbed two-body problem with the Sundman time transformation
+// dt = r**alpha * ds, where r is the distance from the origin and s is the independent variable of the
+// system. mu is the gravitational parameter and pert contains the components of the perturbing
+// acceleration. The state variables are x, y, z, vx, vy, vz and t, where t is the physical time (the
+// independent variable heyoka::time is instead the fictitious time s), and pert can depend on them.
+// With alpha = 1 (i.e., ds proportional to the eccentric anomaly), the timesteps in s do not shrink
+// at the pericentre of highly eccentric orbits. See propagate_until_physical() for the propagation
+// up to a physical time.
+HEYOKA_DLL_PUBLIC std::vector<std::pair<expression, expression>>
+make_sundman_sys(number, std::array<expression, 3> = {}, number = number{1.});
+
+// Create an ODE system representing a perturbed two-body problem in Kustaanheimo-Stiefel (KS) coordinates.
+// The arguments are the same as in make_sundman_sys(). The state variables are the KS coordinates
+// u0, ..., u3, their derivatives up0, ..., up3 with respect to the fictitious time s (dt = r * ds), the Kepler
+// energy E = v**2 / 2 - mu / r and the physical time t. The perturbing acceleration is expressed in terms
+// of x, y, z, vx, vy, vz and t, which are replaced with the KS expressions. The unperturbed motion
+// is a harmonic oscillator (for elliptic orbits), and the collisions are regular.
+// See cartesian_to_ks() and ks_to_cartesian() for the conversions of the states.
+// NOTE: mu (which must be finite and positive) does not appear in the equations,
+// as it enters the motion only via the initial value of E (see cartesian_to_ks()).
+HEYOKA_DLL_PUBLIC std::vector<std::pair<expression, expression>> make_ks_sys(number, std::array<expression, 3> = {});
+
+// Conversions between the cartesian state (x, y, z, vx, vy, vz) at the time t and the state of
+// make_ks_sys() (u0, ..., u3, up0, ..., up3, E, t). cartesian_to_ks() requires a nonzero distance
+// from the origin, and it returns the KS state satisfying the bilinear relation
+// u3 * up0 - u2 * up1 + u1 * up2 - u0 * up3 = 0. ks_to_cartesian() returns the cartesian state
+// followed by the physical time.
+HEYOKA_DLL_PUBLIC std::array<double, 10> cartesian_to_ks(double, const std::array<double, 6> &, double = 0);
+HEYOKA_DLL_PUBLIC std::array<double, 7> ks_to_cartesian(const std::array<double, 10> &);
+
+// Propagate the state of ta until the physical time t, which is the last state variable (e.g.,
+// in the systems of make_sundman_sys() and make_ks_sys(), in which the physical time is a monotonic
+// function of the independent variable). The return value has the same meaning as in propagate_until().
+// The integrator steps forward or backward in the independent variable, and the step in which
+// the physical time crosses t is truncated via root finding on the dense output, so that the last state
+// variable is set to t. max_steps is the maximum number of steps (0 for no limit).
+//
+// NOTE: after the truncation, the dense output of the last step is not available.
+template <typename T>
+HEYOKA_DLL_PUBLIC std::tuple<taylor_outcome, T, T, std::size_t> propagate_until_physical(taylor_adaptive<T> &, T,
+                                                                                          std::size_t = 0);
+
 namespace kw
 {
 
@@ -144,11 +292,71 @@ inline std::vector<std::pair<expression, expression>> make_nbody_par_sys(std::ui
     }
 }
 
+// Add to s a function for the computation of the jet of Taylor derivatives of a Newtonian
+// N-body problem with n bodies. Unlike taylor_add_jet() on the system produced by
+// make_nbody_par_sys(), the derivatives are computed via loops over the pairs of bodies
+// (rather than via a Taylor decomposition of the O(n**2) expressions of the accelerations),
+// so that the construction time and the code size do not depend on n.
+//
+// The function has the same signature and the same layout of the jet as the functions
+// created by taylor_add_jet() (with the state variables ordered as in make_nbody_sys()),
+// and the masses are read from the first n elements of the array of parameters.
+// The Taylor coefficients of the pairwise distances are stored in global arrays
+// of size O(n**2 * order), thus the function cannot be invoked
+// concurrently from multiple threads.
+HEYOKA_DLL_PUBLIC void taylor_add_nbody_jet_dbl(llvm_state &, const std::string &, std::uint32_t, std::uint32_t,
+                                                std::uint32_t, number = number{1.});
+HEYOKA_DLL_PUBLIC void taylor_add_nbody_jet_ldbl(llvm_state &, const std::string &, std::uint32_t, std::uint32_t,
+                                                 std::uint32_t, number = number{1.});
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+HEYOKA_DLL_PUBLIC void taylor_add_nbody_jet_f128(llvm_state &, const std::string &, std::uint32_t, std::uint32_t,
+                                                 std::uint32_t, number = number{1.});
+
+#endif
+
+template <typename T>
+inline void taylor_add_nbody_jet(llvm_state &s, const std::string &name, std::uint32_t n, std::uint32_t order,
+                                 std::uint32_t batch_size, number Gconst = number{1.})
+{
+    if constexpr (std::is_same_v<T, double>) {
+        taylor_add_nbody_jet_dbl(s, name, n, order, batch_size, std::move(Gconst));
+    } else if constexpr (std::is_same_v<T, long double>) {
+        taylor_add_nbody_jet_ldbl(s, name, n, order, batch_size, std::move(Gconst));
+#if defined(HEYOKA_HAVE_REAL128)
+    } else if constexpr (std::is_same_v<T, mppp::real128>) {
+        taylor_add_nbody_jet_f128(s, name, n, order, batch_size, std::move(Gconst));
+#endif
+    } else {
+        static_assert(detail::always_false_v<T>, "Unhandled type.");
+    }
+}
+
 HEYOKA_DLL_PUBLIC std::array<double, 6> random_elliptic_state(double, const std::array<std::pair<double, double>, 6> &,
                                                               unsigned = std::random_device{}());
 
 HEYOKA_DLL_PUBLIC std::array<double, 6> cartesian_to_oe(double, const std::array<double, 6> &);
 
+// Inverse of cartesian_to_oe() (for elliptic orbits).
+HEYOKA_DLL_PUBLIC std::array<double, 6> oe_to_cartesian(double, const std::array<double, 6> &);
+
+// Batch versions of oe_to_cartesian(), cartesian_to_oe() and random_elliptic_state() for
+// n states in SoA layout: the i-th component of the j-th state is stored in in[i][j] (or out[i][j]).
+// The conversions are JIT-compiled into SIMD functions, and the states are processed in chunks
+// by n_threads threads (0 means the number of hardware threads). In random_elliptic_state_batch(),
+// the j-th state is generated from the j-th splitmix64 stream of the sequence starting
+// from seed, so that the results do not depend on the number of threads.
+//
+// NOTE: the functions are compiled on the first invocation.
+HEYOKA_DLL_PUBLIC void oe_to_cartesian_batch(double, const std::array<const double *, 6> &,
+                                             const std::array<double *, 6> &, std::size_t, unsigned = 0);
+HEYOKA_DLL_PUBLIC void cartesian_to_oe_batch(double, const std::array<const double *, 6> &,
+                                             const std::array<double *, 6> &, std::size_t, unsigned = 0);
+HEYOKA_DLL_PUBLIC void random_elliptic_state_batch(double, const std::array<std::pair<double, double>, 6> &,
+                                                   const std::array<double *, 6> &, std::size_t, std::uint64_t,
+                                                   unsigned = 0);
+
 } // namespace heyoka
 
 #endif
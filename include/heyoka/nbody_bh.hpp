@@ -0,0 +1,167 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef HEYOKA_NBODY_BH_HPP
+#define HEYOKA_NBODY_BH_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include <heyoka/detail/igor.hpp>
+#include <heyoka/detail/type_traits.hpp>
+#include <heyoka/detail/visibility.hpp>
+#include <heyoka/kw.hpp>
+#include <heyoka/llvm_state.hpp>
+#include <heyoka/taylor.hpp>
+
+namespace heyoka
+{
+
+namespace kw
+{
+
+IGOR_MAKE_NAMED_ARGUMENT(theta);
+IGOR_MAKE_NAMED_ARGUMENT(leaf_size);
+
+} // namespace kw
+
+// Approximate integrator for Newtonian N-body problems with a large number of bodies.
+//
+// At the beginning of each step, the bodies are sorted into an octree, and the tree
+// is traversed for each body following the Barnes-Hut criterion: the nodes whose
+// size is smaller than theta times their distance from the body exert a far-field
+// (monopole) acceleration, which is kept constant during the step. The interactions
+// with the bodies in the opened leaves (the near interactions) are integrated with
+// a Taylor method, whose derivatives are computed by a JIT-compiled function looping
+// over the list of the near pairs (see also taylor_add_nbody_jet()). The step size
+// and the Taylor order are deduced from the tolerance as in taylor_adaptive.
+//
+// The state is ordered as in make_nbody_sys(). The kwargs are:
+//
+// - 'masses', the masses of the bodies (defaults to a value of 1 for all bodies),
+// - 'Gconst', the gravitational constant (defaults to 1),
+// - 'tol', the tolerance of the Taylor method (defaults to the machine epsilon),
+// - 'theta', the opening angle of the Barnes-Hut criterion (defaults to 0.5, with
+//   smaller values yielding more accurate and slower steps; for a value of 0, all interactions are
+//   near and the integration is exact),
+// - 'leaf_size', the maximum number of bodies in a leaf of the octree (defaults to 8).
+//
+// NOTE: the far-field accelerations are frozen during a step, thus the accuracy of the far-field
+// contributions is limited by the step size, rather than by the tolerance of the Taylor method.
+class HEYOKA_DLL_PUBLIC nbody_bh
+{
+public:
+    using jet_f_t = void (*)(double *, const double *, const std::uint32_t *, std::uint32_t, double *);
+
+private:
+    std::uint32_t m_n;
+    std::vector<double> m_state;
+    std::vector<double> m_masses;
+    double m_time = 0;
+    double m_Gconst;
+    double m_tol;
+    double m_theta;
+    std::uint32_t m_leaf_size;
+    std::uint32_t m_order;
+    llvm_state m_llvm;
+    jet_f_t m_jet_f = nullptr;
+    // Buffers: the jet, the masses followed by the far-field accelerations,
+    // the list of the near pairs and the storage for the Taylor
+    // coefficients of the pairwise quantities.
+    std::vector<double> m_jet, m_pars, m_scratch;
+    std::vector<std::uint32_t> m_pairs;
+
+    HEYOKA_DLL_LOCAL void finalise_ctor(std::vector<double>, double, double, double, std::uint32_t);
+    HEYOKA_DLL_LOCAL void compute_interactions();
+
+public:
+    template <typename... KwArgs>
+    explicit nbody_bh(std::vector<double> state, KwArgs &&...kw_args) : m_state(std::move(state))
+    {
+        igor::parser p{kw_args...};
+
+        if constexpr (p.has_unnamed_arguments()) {
+            static_assert(detail::always_false_v<KwArgs...>,
+                          "The variadic arguments in the construction of a Barnes-Hut N-body integrator contain "
+                          "unnamed arguments.");
+        } else {
+            std::vector<double> masses;
+            if constexpr (p.has(kw::masses)) {
+                for (const auto &m : p(kw::masses)) {
+                    masses.emplace_back(m);
+                }
+            } else {
+                masses.resize(m_state.size() / 6u, 1.);
+            }
+
+            // G constant (defaults to 1).
+            const auto Gconst = [&p]() -> double {
+                if constexpr (p.has(kw::Gconst)) {
+                    return std::forward<decltype(p(kw::Gconst))>(p(kw::Gconst));
+                } else {
+                    return 1.;
+                }
+            }();
+
+            // Tolerance (defaults to the machine epsilon).
+            const auto tol = [&p]() -> double {
+                if constexpr (p.has(kw::tol)) {
+                    return std::forward<decltype(p(kw::tol))>(p(kw::tol));
+                } else {
+                    return std::numeric_limits<double>::epsilon();
+                }
+            }();
+
+            // Opening angle (defaults to 0.5).
+            const auto theta = [&p]() -> double {
+                if constexpr (p.has(kw::theta)) {
+                    return std::forward<decltype(p(kw::theta))>(p(kw::theta));
+                } else {
+                    return .5;
+                }
+            }();
+
+            std::uint32_t leaf_size = 8;
+            if constexpr (p.has(kw::leaf_size)) {
+                leaf_size = std::forward<decltype(p(kw::leaf_size))>(p(kw::leaf_size));
+            }
+
+            finalise_ctor(std::move(masses), Gconst, tol, theta, leaf_size);
+        }
+    }
+
+    nbody_bh(const nbody_bh &);
+    nbody_bh(nbody_bh &&) noexcept;
+
+    nbody_bh &operator=(const nbody_bh &);
+    nbody_bh &operator=(nbody_bh &&) noexcept;
+
+    ~nbody_bh();
+
+    const std::vector<double> &get_state() const;
+    const std::vector<double> &get_masses() const;
+    double get_time() const;
+    std::uint32_t get_order() const;
+    double get_theta() const;
+    // The number of near pairs of bodies in the last step.
+    std::size_t get_n_near_pairs() const;
+
+    // Perform a single step, with a step size limited in absolute
+    // value by max_delta_t. The step size is returned.
+    double step(double = std::numeric_limits<double>::infinity());
+    // Propagate until the time t (which must not be in the past).
+    // The number of steps is returned.
+    std::size_t propagate_until(double);
+};
+
+} // namespace heyoka
+
+#endif
@@ -0,0 +1,86 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef HEYOKA_NBODY_COLLISIONS_HPP
+#define HEYOKA_NBODY_COLLISIONS_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include <heyoka/detail/visibility.hpp>
+#include <heyoka/taylor.hpp>
+
+namespace heyoka
+{
+
+// A collision between the bodies i and j (i < j) at the time t.
+struct nbody_collision {
+    std::uint32_t i;
+    std::uint32_t j;
+    double t;
+};
+
+// Detection of the collisions between spherical bodies during the steps of an integrator
+// for a Newtonian N-body problem (with the state variables ordered as in make_nbody_sys()).
+//
+// The collisions are detected on the Taylor polynomials of the positions computed in the
+// last step of the integrator, which must thus have been performed with write_tc = true.
+// In the broad phase, the axis-aligned bounding boxes of the trajectories of the bodies over
+// the step are computed from the Taylor coefficients (and inflated by the radii), and the
+// overlapping pairs of boxes are identified via sweep and prune along the x axis. In the
+// narrow phase, the collision time of each candidate pair is computed as the earliest zero
+// crossing of the polynomial |r_j - r_i|**2 - (R_i + R_j)**2 (with a negative derivative,
+// that is, while the bodies are approaching each other).
+//
+// NOTE: the collisions are detected on the Taylor polynomials, thus their accuracy
+// is the accuracy of the dense output of the integrator.
+class HEYOKA_DLL_PUBLIC nbody_collision_detector
+{
+    std::vector<double> m_radii;
+    // Buffers: the bounding boxes, the order of the
+    // bodies along the x axis, the list of the active
+    // bodies in the sweep and the candidate pairs.
+    std::vector<std::array<double, 6>> m_boxes;
+    std::vector<std::uint32_t> m_order, m_active;
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> m_pairs;
+    // Buffers for the narrow phase.
+    std::array<std::vector<double>, 3> m_diff;
+    std::vector<double> m_poly, m_roots, m_tmp;
+
+    HEYOKA_DLL_LOCAL void broad_phase(const taylor_adaptive<double> &);
+    HEYOKA_DLL_LOCAL std::optional<double> narrow_phase(const taylor_adaptive<double> &, std::uint32_t,
+                                                        std::uint32_t);
+
+public:
+    // The radii of the bodies (which must be finite and non-negative).
+    explicit nbody_collision_detector(std::vector<double>);
+
+    nbody_collision_detector(const nbody_collision_detector &);
+    nbody_collision_detector(nbody_collision_detector &&) noexcept;
+
+    nbody_collision_detector &operator=(const nbody_collision_detector &);
+    nbody_collision_detector &operator=(nbody_collision_detector &&) noexcept;
+
+    ~nbody_collision_detector();
+
+    const std::vector<double> &get_radii() const;
+    // The number of candidate pairs identified by the
+    // broad phase in the last invocation of detect().
+    std::size_t get_n_candidates() const;
+
+    // Detect the earliest collision during the last step of ta, if any.
+    std::optional<nbody_collision> detect(const taylor_adaptive<double> &);
+};
+
+} // namespace heyoka
+
+#endif
@@ -0,0 +1,161 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef HEYOKA_NBODY_RESTRICTED_HPP
+#define HEYOKA_NBODY_RESTRICTED_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include <heyoka/compiled_function.hpp>
+#include <heyoka/detail/igor.hpp>
+#include <heyoka/detail/type_traits.hpp>
+#include <heyoka/detail/visibility.hpp>
+#include <heyoka/kw.hpp>
+#include <heyoka/taylor.hpp>
+
+namespace heyoka
+{
+
+namespace kw
+{
+
+IGOR_MAKE_NAMED_ARGUMENT(n_threads);
+
+} // namespace kw
+
+// Integrator for a restricted N-body problem, consisting of a set of massive bodies
+// and of a (possibly large) set of massless test particles.
+//
+// The massive bodies are integrated with a taylor_adaptive integrator for the system
+// produced by make_nbody_sys(). After each step, the Taylor coefficients of the positions
+// of the massive bodies are loaded into the parameters of a batch integrator for the
+// motion of a single test particle, in which the positions of the massive bodies are
+// polynomials of time. The test particles are then propagated, batch_size at a time, up to the
+// end of the step of the massive bodies. Thus, the cost of the integration scales
+// linearly with the number of test particles, and the test particles are propagated
+// in parallel by n_threads threads (0 means the number of hardware threads).
+//
+// The states of the massive bodies and of the test particles are ordered as in make_nbody_sys().
+// The kwargs are:
+//
+// - 'masses', the masses of the massive bodies (defaults to a value of 1 for all bodies),
+// - 'Gconst', the gravitational constant (defaults to 1),
+// - 'tol', the tolerance of the integrators (defaults to the machine epsilon),
+// - 'compact_mode', the compact mode flag of the integrators (defaults to false),
+// - 'batch_size', the batch size of the integrator for the test particles (defaults to 4),
+// - 'n_threads', the number of threads for the propagation of the test particles (defaults to 0).
+class HEYOKA_DLL_PUBLIC nbody_restricted
+{
+    std::uint32_t m_n_massive = 0;
+    std::size_t m_n_tp = 0;
+    unsigned m_n_threads = 0;
+    taylor_adaptive<double> m_ta;
+    // The integrator for the test particles, and its
+    // copies used by the worker threads.
+    taylor_adaptive_batch<double> m_tp_ta;
+    std::vector<taylor_adaptive_batch<double>> m_workers;
+    std::vector<double> m_tp_state;
+
+    HEYOKA_DLL_LOCAL void finalise_ctor(std::vector<double>, std::vector<double>, double, double, bool,
+                                        std::uint32_t);
+    HEYOKA_DLL_LOCAL void propagate_tp(double, double);
+
+public:
+    template <typename... KwArgs>
+    explicit nbody_restricted(std::vector<double> massive_state, std::vector<double> tp_state,
+                              KwArgs &&...kw_args)
+        : m_tp_state(std::move(tp_state))
+    {
+        igor::parser p{kw_args...};
+
+        if constexpr (p.has_unnamed_arguments()) {
+            static_assert(detail::always_false_v<KwArgs...>,
+                          "The variadic arguments in the construction of a restricted N-body integrator contain "
+                          "unnamed arguments.");
+        } else {
+            std::vector<double> masses;
+            if constexpr (p.has(kw::masses)) {
+                for (const auto &m : p(kw::masses)) {
+                    masses.emplace_back(m);
+                }
+            } else {
+                masses.resize(massive_state.size() / 6u, 1.);
+            }
+
+            // G constant (defaults to 1).
+            const auto Gconst = [&p]() -> double {
+                if constexpr (p.has(kw::Gconst)) {
+                    return std::forward<decltype(p(kw::Gconst))>(p(kw::Gconst));
+                } else {
+                    return 1.;
+                }
+            }();
+
+            // Tolerance (defaults to the machine epsilon).
+            const auto tol = [&p]() -> double {
+                if constexpr (p.has(kw::tol)) {
+                    return std::forward<decltype(p(kw::tol))>(p(kw::tol));
+                } else {
+                    return std::numeric_limits<double>::epsilon();
+                }
+            }();
+
+            // Compact mode (defaults to false).
+            const auto compact_mode = [&p]() -> bool {
+                if constexpr (p.has(kw::compact_mode)) {
+                    return std::forward<decltype(p(kw::compact_mode))>(p(kw::compact_mode));
+                } else {
+                    return false;
+                }
+            }();
+
+            std::uint32_t batch_size = 4;
+            if constexpr (p.has(kw::batch_size)) {
+                batch_size = std::forward<decltype(p(kw::batch_size))>(p(kw::batch_size));
+            }
+
+            if constexpr (p.has(kw::n_threads)) {
+                m_n_threads = std::forward<decltype(p(kw::n_threads))>(p(kw::n_threads));
+            }
+
+            finalise_ctor(std::move(massive_state), std::move(masses), Gconst, tol, compact_mode, batch_size);
+        }
+    }
+
+    nbody_restricted(const nbody_restricted &);
+    nbody_restricted(nbody_restricted &&) noexcept;
+
+    nbody_restricted &operator=(const nbody_restricted &);
+    nbody_restricted &operator=(nbody_restricted &&) noexcept;
+
+    ~nbody_restricted();
+
+    double get_time() const;
+    std::uint32_t get_n_massive() const;
+    std::size_t get_n_tp() const;
+    const std::vector<double> &get_massive_state() const;
+    const std::vector<double> &get_tp_state() const;
+    // The integrators of the massive bodies and of the test particles.
+    const taylor_adaptive<double> &get_massive_integrator() const;
+    const taylor_adaptive_batch<double> &get_tp_integrator() const;
+
+    // Perform a single step, with a step size limited
+    // by max_delta_t. The step size is returned.
+    double step(double = std::numeric_limits<double>::infinity());
+    // Propagate until the time t (which must not be in the past).
+    // The number of steps is returned.
+    std::size_t propagate_until(double);
+};
+
+} // namespace heyoka
+
+#endif
@@ -23,12 +23,17 @@
 namespace heyoka
 {
 
+// NOTE: a lane-shared param has the same value for all
+// the batch elements in batch mode. Only the value in the
+// first batch element is read, via a scalar load followed
+// by a broadcast, rather than via a vector load.
 class HEYOKA_DLL_PUBLIC param
 {
     std::uint32_t m_index;
+    bool m_shared = false;
 
 public:
-    explicit param(std::uint32_t);
+    explicit param(std::uint32_t, bool = false);
 
     param(const param &);
     param(param &&) noexcept;
@@ -41,6 +46,8 @@ public:
     const std::uint32_t &idx() const;
 
     std::uint32_t &idx();
+
+    bool is_shared() const;
 };
 
 HEYOKA_DLL_PUBLIC void swap(param &, param &) noexcept;
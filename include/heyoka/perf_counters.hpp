@@ -0,0 +1,110 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef HEYOKA_PERF_COUNTERS_HPP
+#define HEYOKA_PERF_COUNTERS_HPP
+
+#include <array>
+#include <cstdint>
+#include <ostream>
+#include <thread>
+
+#include <heyoka/detail/visibility.hpp>
+
+namespace heyoka
+{
+
+// Values of the hardware performance counters.
+struct perf_counts {
+    std::uint64_t cycles = 0;
+    std::uint64_t instructions = 0;
+    std::uint64_t cache_misses = 0;
+    // The count of the raw event selected by the user (see perf_counter_group),
+    // e.g., the number of retired packed floating-point instructions,
+    // as a measure of the vector utilisation.
+    std::uint64_t raw = 0;
+};
+
+HEYOKA_DLL_PUBLIC perf_counts &operator+=(perf_counts &, const perf_counts &);
+HEYOKA_DLL_PUBLIC perf_counts operator+(const perf_counts &, const perf_counts &);
+// NOTE: the subtraction saturates at zero.
+HEYOKA_DLL_PUBLIC perf_counts operator-(const perf_counts &, const perf_counts &);
+
+HEYOKA_DLL_PUBLIC std::ostream &operator<<(std::ostream &, const perf_counts &);
+
+// The hardware performance counters of a step of an adaptive Taylor integrator.
+// step contains the counts of the whole invocation of the stepper (i.e., the
+// computation of the jet of derivatives, the determination of the timestep and
+// the update of the state), update contains the counts of the evaluation of the
+// Taylor polynomials which updates the state vector. The counts of the jet
+// (and of the determination of the timestep) are thus step - update.
+//
+// NOTE: the update is measured via a separate evaluation of the Taylor polynomials
+// with the same code used by the dense output, after the invocation of the stepper.
+struct step_perf_counts {
+    perf_counts step;
+    perf_counts update;
+
+    perf_counts jet() const
+    {
+        return step - update;
+    }
+};
+
+HEYOKA_DLL_PUBLIC std::ostream &operator<<(std::ostream &, const step_perf_counts &);
+
+// Check if the hardware performance counters are available
+// (i.e., if the counters of the cycles and of the instructions
+// can be opened by the current process).
+HEYOKA_DLL_PUBLIC bool perf_counters_available();
+
+// Group of hardware performance counters for the calling thread, measuring
+// the cycles, the instructions, the cache misses and (if raw_config is nonzero)
+// the raw event identified by raw_config (whose meaning depends on the CPU,
+// e.g., on recent Intel CPUs 0x10c7 is FP_ARITH_INST_RETIRED.256B_PACKED_DOUBLE).
+// The counters exclude the kernel and the hypervisor.
+//
+// The counters are implemented via perf_event_open() on Linux, on other platforms
+// the constructor throws a not_implemented_error. If the counters of the cycles or
+// of the instructions cannot be opened, a std::runtime_error is thrown. The counters
+// of the cache misses and of the raw event are instead optional, and they read as
+// zero if they are not supported (see has_cache_misses() and has_raw()).
+//
+// NOTE: the counters measure only the thread which created the group.
+class HEYOKA_DLL_PUBLIC perf_counter_group
+{
+    // The file descriptors of the counters (cycles, instructions, cache misses and raw event),
+    // -1 if the counter is not available. The counter of the cycles is the group leader.
+    std::array<int, 4> m_fds;
+    std::uint64_t m_raw_config;
+    std::thread::id m_tid;
+
+    void close_fds() noexcept;
+
+public:
+    explicit perf_counter_group(std::uint64_t = 0);
+    perf_counter_group(const perf_counter_group &) = delete;
+    perf_counter_group(perf_counter_group &&) noexcept;
+    perf_counter_group &operator=(const perf_counter_group &) = delete;
+    perf_counter_group &operator=(perf_counter_group &&) noexcept;
+    ~perf_counter_group();
+
+    bool has_cache_misses() const;
+    bool has_raw() const;
+    std::uint64_t get_raw_config() const;
+    std::thread::id get_thread_id() const;
+
+    // Reset and enable the counters.
+    void start();
+    // Disable the counters and read their values.
+    perf_counts stop();
+};
+
+} // namespace heyoka
+
+#endif
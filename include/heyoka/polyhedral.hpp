@@ -0,0 +1,150 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef HEYOKA_POLYHEDRAL_HPP
+#define HEYOKA_POLYHEDRAL_HPP
+
+#include <array>
+#include <cstdint>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <heyoka/detail/igor.hpp>
+#include <heyoka/detail/type_traits.hpp>
+#include <heyoka/detail/visibility.hpp>
+#include <heyoka/expression.hpp>
+#include <heyoka/kw.hpp>
+
+namespace heyoka
+{
+
+namespace kw
+{
+
+IGOR_MAKE_NAMED_ARGUMENT(vertices);
+IGOR_MAKE_NAMED_ARGUMENT(faces);
+IGOR_MAKE_NAMED_ARGUMENT(density);
+
+} // namespace kw
+
+// Gravitational acceleration at the point (x, y, z) due to a homogeneous polyhedron
+// of density 1, according to the closed-form expressions of Werner & Scheeres (1997).
+// The polyhedron is defined by its (numerical) vertices and by its triangular faces
+// (as triplets of indices into the vertices), which must be oriented counterclockwise when
+// seen from the outside. The mesh must be closed, i.e., each edge must be shared by
+// exactly two faces. The last argument is the gravitational constant
+// multiplied by the density.
+//
+// The acceleration is the sum of a term for each edge and a term for each face,
+// built from the distances to the vertices (which are shared by the edges and the
+// faces). In compact mode, these terms are evaluated in loops over the edges
+// and the faces.
+// NOTE: the expressions are singular on the edges of the polyhedron.
+HEYOKA_DLL_PUBLIC std::array<expression, 3> polyhedral_acc(const expression &, const expression &, const expression &,
+                                                           const std::vector<std::array<double, 3>> &,
+                                                           const std::vector<std::array<std::uint32_t, 3>> &,
+                                                           double = 1);
+
+namespace detail
+{
+
+HEYOKA_DLL_PUBLIC std::vector<std::pair<expression, expression>>
+make_polyhedral_system_impl(const std::vector<std::array<double, 3>> &,
+                            const std::vector<std::array<std::uint32_t, 3>> &, double, const std::array<double, 3> &);
+
+} // namespace detail
+
+// Equations of motion around an asteroid described by a homogeneous polyhedron,
+// in the frame rotating with the asteroid (see make_mascon_system()).
+//
+// vertices -> [N,3] array containing the vertices of the polyhedron (units L)
+// faces -> [M,3] array containing the indices of the vertices of the faces (see polyhedral_acc())
+// omega -> angular velocity of the asteroid in the frame of the polyhedron (units rad/T)
+//
+// density kwarg -> density of the asteroid (units M/L^3, defaults to 1)
+// GConst kwarg -> Cavendish constant (units L^3/T^2/M, defaults to 1)
+template <typename... KwArgs>
+inline std::vector<std::pair<expression, expression>> make_polyhedral_system(KwArgs &&...kw_args)
+{
+    igor::parser p{kw_args...};
+    if constexpr (p.has_unnamed_arguments()) {
+        static_assert(detail::always_false_v<KwArgs...>,
+                      "The variadic arguments in the construction of the polyhedral system contain "
+                      "unnamed arguments.");
+    } else {
+        // G constant (defaults to 1).
+        const auto Gconst = [&p]() -> double {
+            if constexpr (p.has(kw::Gconst)) {
+                return std::forward<decltype(p(kw::Gconst))>(p(kw::Gconst));
+            } else {
+                return 1.;
+            }
+        }();
+
+        // Density (defaults to 1).
+        const auto density = [&p]() -> double {
+            if constexpr (p.has(kw::density)) {
+                return std::forward<decltype(p(kw::density))>(p(kw::density));
+            } else {
+                return 1.;
+            }
+        }();
+
+        // vertices (no default)
+        std::vector<std::array<double, 3>> vertices;
+        if constexpr (p.has(kw::vertices)) {
+            for (const auto &v : p(kw::vertices)) {
+                if (std::size(v) != 3) {
+                    throw std::invalid_argument("All the vertices of a polyhedron must have a dimension of exactly "
+                                                "3. A dimension of "
+                                                + std::to_string(std::size(v))
+                                                + " was detected when constructing the polyhedral system.");
+                }
+
+                vertices.push_back({static_cast<double>(v[0]), static_cast<double>(v[1]), static_cast<double>(v[2])});
+            }
+        } else {
+            static_assert(detail::always_false_v<KwArgs...>, "vertices is missing from the kwarg list!");
+        };
+
+        // faces (no default)
+        std::vector<std::array<std::uint32_t, 3>> faces;
+        if constexpr (p.has(kw::faces)) {
+            for (const auto &f : p(kw::faces)) {
+                if (std::size(f) != 3) {
+                    throw std::invalid_argument("All the faces of a polyhedron must have exactly 3 vertices. "
+                                                + std::to_string(std::size(f))
+                                                + " vertices were detected when constructing the polyhedral system.");
+                }
+
+                faces.push_back({static_cast<std::uint32_t>(f[0]), static_cast<std::uint32_t>(f[1]),
+                                 static_cast<std::uint32_t>(f[2])});
+            }
+        } else {
+            static_assert(detail::always_false_v<KwArgs...>, "faces is missing from the kwarg list!");
+        };
+
+        // omega (no default)
+        std::array<double, 3> omega{};
+        if constexpr (p.has(kw::omega)) {
+            omega = {static_cast<double>(p(kw::omega)[0]), static_cast<double>(p(kw::omega)[1]),
+                     static_cast<double>(p(kw::omega)[2])};
+        } else {
+            static_assert(detail::always_false_v<KwArgs...>, "omega is missing from the kwarg list!");
+        };
+
+        return detail::make_polyhedral_system_impl(vertices, faces, Gconst * density, omega);
+    }
+}
+
+} // namespace heyoka
+
+#endif
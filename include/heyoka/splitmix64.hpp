@@ -33,6 +33,13 @@ struct splitmix64 {
         return z ^ (z >> 31);
     }
 
+    // Advance the sequence by n values in constant time
+    // (the state is incremented by a constant at each step).
+    constexpr void jump(std::uint64_t n)
+    {
+        m_state += n * 0x9e3779b97f4a7c15;
+    }
+
     // Provide also an interface compatible with the UniformRandomBitGenerator concept:
     // https://en.cppreference.com/w/cpp/named_req/UniformRandomBitGenerator
     using result_type = std::uint64_t;
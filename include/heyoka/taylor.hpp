@@ -11,9 +11,19 @@
 
 #include <heyoka/config.hpp>
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <cstddef>
 #include <cstdint>
+#include <exception>
+#include <functional>
+#include <future>
+#include <istream>
 #include <limits>
+#include <map>
+#include <memory>
+#include <optional>
 #include <ostream>
 #include <string>
 #include <tuple>
@@ -35,6 +45,7 @@
 #include <heyoka/detail/visibility.hpp>
 #include <heyoka/expression.hpp>
 #include <heyoka/llvm_state.hpp>
+#include <heyoka/perf_counters.hpp>
 
 namespace heyoka
 {
@@ -118,11 +129,36 @@ HEYOKA_DLL_PUBLIC std::string taylor_mangle_suffix(llvm::Type *);
 
 } // namespace detail
 
+// The Taylor decomposition of an ODE system (see taylor_decompose()).
+// NOTE: the decompositions returned by the get_decomposition() functions of the
+// integrators can be used to construct other integrators (and jets),
+// skipping the symbolic processing of the system.
+using taylor_dc_t = std::vector<std::pair<expression, std::vector<std::uint32_t>>>;
+
+// Binary serialisation of Taylor decompositions.
+HEYOKA_DLL_PUBLIC void taylor_save_dc(std::ostream &, const taylor_dc_t &);
+HEYOKA_DLL_PUBLIC taylor_dc_t taylor_load_dc(std::istream &);
+
 HEYOKA_DLL_PUBLIC std::vector<std::pair<expression, std::vector<std::uint32_t>>>
     taylor_decompose(std::vector<expression>);
 HEYOKA_DLL_PUBLIC std::vector<std::pair<expression, std::vector<std::uint32_t>>>
     taylor_decompose(std::vector<std::pair<expression, expression>>);
 
+HEYOKA_DLL_PUBLIC
+std::pair<std::vector<std::pair<expression, std::vector<std::uint32_t>>>, std::vector<std::uint32_t>>
+    taylor_decompose(std::vector<expression>, std::vector<expression>);
+HEYOKA_DLL_PUBLIC
+std::pair<std::vector<std::pair<expression, std::vector<std::uint32_t>>>, std::vector<std::uint32_t>>
+    taylor_decompose(std::vector<std::pair<expression, expression>>, std::vector<expression>);
+
+// Statistics about the segments into which the Taylor decomposition of a system of n_eq equations
+// is split in compact mode. In compact mode, the derivatives of the u variables in a segment
+// are computed by looping, for each kind of operation (e.g., "mul_var_num", the multiplication
+// of a u variable by a number), over the u variables defined by that operation. The return value
+// contains, for each segment, the number of u variables for each kind of operation.
+HEYOKA_DLL_PUBLIC std::vector<std::map<std::string, std::uint32_t>>
+taylor_segment_stats(const std::vector<std::pair<expression, std::vector<std::uint32_t>>> &, std::uint32_t);
+
 HEYOKA_DLL_PUBLIC std::vector<std::pair<expression, std::vector<std::uint32_t>>>
 taylor_add_jet_dbl(llvm_state &, const std::string &, std::vector<expression>, std::uint32_t, std::uint32_t, bool,
                    bool);
@@ -189,6 +225,176 @@ taylor_add_jet(llvm_state &s, const std::string &name, std::vector<std::pair<exp
     }
 }
 
+// NOTE: these overloads add a jet from a precomputed
+// Taylor decomposition (e.g., from get_decomposition()),
+// which is returned unchanged.
+HEYOKA_DLL_PUBLIC taylor_dc_t taylor_add_jet_dbl(llvm_state &, const std::string &, taylor_dc_t, std::uint32_t,
+                                                 std::uint32_t, bool, bool);
+HEYOKA_DLL_PUBLIC taylor_dc_t taylor_add_jet_ldbl(llvm_state &, const std::string &, taylor_dc_t, std::uint32_t,
+                                                  std::uint32_t, bool, bool);
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+HEYOKA_DLL_PUBLIC taylor_dc_t taylor_add_jet_f128(llvm_state &, const std::string &, taylor_dc_t, std::uint32_t,
+                                                  std::uint32_t, bool, bool);
+
+#endif
+
+template <typename T>
+taylor_dc_t taylor_add_jet(llvm_state &s, const std::string &name, taylor_dc_t dc, std::uint32_t order,
+                           std::uint32_t batch_size, bool high_accuracy, bool compact_mode)
+{
+    if constexpr (std::is_same_v<T, double>) {
+        return taylor_add_jet_dbl(s, name, std::move(dc), order, batch_size, high_accuracy, compact_mode);
+    } else if constexpr (std::is_same_v<T, long double>) {
+        return taylor_add_jet_ldbl(s, name, std::move(dc), order, batch_size, high_accuracy, compact_mode);
+#if defined(HEYOKA_HAVE_REAL128)
+    } else if constexpr (std::is_same_v<T, mppp::real128>) {
+        return taylor_add_jet_f128(s, name, std::move(dc), order, batch_size, high_accuracy, compact_mode);
+#endif
+    } else {
+        static_assert(detail::always_false_v<T>, "Unhandled type.");
+    }
+}
+
+// Add to the state s a function with the given name for the computation of the jets
+// of Taylor derivatives up to the given order at multiple points. The signature of the function is
+//
+// void (T *out, const T *in, const T *par, const T *time, std::uint32_t n_points, std::uint64_t stride)
+//
+// where the arrays (which cannot overlap) are in SoA layout: the value of the i-th state variable
+// at the point p is read from in[i * stride + p], the value of the j-th parameter from
+// par[j * stride + p] and the time from time[p], while the derivative of order o of the i-th
+// state variable is written into out[(o * n_eq + i) * stride + p] (including the order 0).
+// The loop over the points is performed by the compiled code, batch_size points at a time
+// (the remaining points are processed in scalar mode). In parallel mode, which is not
+// supported in compact mode, the batches are processed by multiple threads and the
+// function is not reentrant.
+HEYOKA_DLL_PUBLIC std::vector<std::pair<expression, std::vector<std::uint32_t>>>
+taylor_add_jet_multi_dbl(llvm_state &, const std::string &, std::vector<expression>, std::uint32_t,
+                         std::uint32_t, bool, bool, bool);
+HEYOKA_DLL_PUBLIC std::vector<std::pair<expression, std::vector<std::uint32_t>>>
+taylor_add_jet_multi_ldbl(llvm_state &, const std::string &, std::vector<expression>, std::uint32_t,
+                          std::uint32_t, bool, bool, bool);
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+HEYOKA_DLL_PUBLIC std::vector<std::pair<expression, std::vector<std::uint32_t>>>
+taylor_add_jet_multi_f128(llvm_state &, const std::string &, std::vector<expression>, std::uint32_t,
+                          std::uint32_t, bool, bool, bool);
+
+#endif
+
+template <typename T>
+std::vector<std::pair<expression, std::vector<std::uint32_t>>>
+taylor_add_jet_multi(llvm_state &s, const std::string &name, std::vector<expression> sys, std::uint32_t order,
+                     std::uint32_t batch_size, bool high_accuracy, bool compact_mode, bool parallel_mode = false)
+{
+    if constexpr (std::is_same_v<T, double>) {
+        return taylor_add_jet_multi_dbl(s, name, std::move(sys), order, batch_size, high_accuracy, compact_mode,
+                                        parallel_mode);
+    } else if constexpr (std::is_same_v<T, long double>) {
+        return taylor_add_jet_multi_ldbl(s, name, std::move(sys), order, batch_size, high_accuracy, compact_mode,
+                                         parallel_mode);
+#if defined(HEYOKA_HAVE_REAL128)
+    } else if constexpr (std::is_same_v<T, mppp::real128>) {
+        return taylor_add_jet_multi_f128(s, name, std::move(sys), order, batch_size, high_accuracy, compact_mode,
+                                         parallel_mode);
+#endif
+    } else {
+        static_assert(detail::always_false_v<T>, "Unhandled type.");
+    }
+}
+
+HEYOKA_DLL_PUBLIC std::vector<std::pair<expression, std::vector<std::uint32_t>>>
+taylor_add_jet_multi_dbl(llvm_state &, const std::string &, std::vector<std::pair<expression, expression>>,
+                         std::uint32_t, std::uint32_t, bool, bool, bool);
+HEYOKA_DLL_PUBLIC std::vector<std::pair<expression, std::vector<std::uint32_t>>>
+taylor_add_jet_multi_ldbl(llvm_state &, const std::string &, std::vector<std::pair<expression, expression>>,
+                          std::uint32_t, std::uint32_t, bool, bool, bool);
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+HEYOKA_DLL_PUBLIC std::vector<std::pair<expression, std::vector<std::uint32_t>>>
+taylor_add_jet_multi_f128(llvm_state &, const std::string &, std::vector<std::pair<expression, expression>>,
+                          std::uint32_t, std::uint32_t, bool, bool, bool);
+
+#endif
+
+template <typename T>
+std::vector<std::pair<expression, std::vector<std::uint32_t>>>
+taylor_add_jet_multi(llvm_state &s, const std::string &name, std::vector<std::pair<expression, expression>> sys,
+                     std::uint32_t order, std::uint32_t batch_size, bool high_accuracy, bool compact_mode,
+                     bool parallel_mode = false)
+{
+    if constexpr (std::is_same_v<T, double>) {
+        return taylor_add_jet_multi_dbl(s, name, std::move(sys), order, batch_size, high_accuracy, compact_mode,
+                                        parallel_mode);
+    } else if constexpr (std::is_same_v<T, long double>) {
+        return taylor_add_jet_multi_ldbl(s, name, std::move(sys), order, batch_size, high_accuracy, compact_mode,
+                                         parallel_mode);
+#if defined(HEYOKA_HAVE_REAL128)
+    } else if constexpr (std::is_same_v<T, mppp::real128>) {
+        return taylor_add_jet_multi_f128(s, name, std::move(sys), order, batch_size, high_accuracy, compact_mode,
+                                         parallel_mode);
+#endif
+    } else {
+        static_assert(detail::always_false_v<T>, "Unhandled type.");
+    }
+}
+
+// Add to the state s a function with the given name for the computation of the jet of Taylor
+// derivatives up to the given order of the outputs only, i.e., of a set of functions of the state
+// variables of sys. The state variables which do not feed (directly or via the equations
+// of other state variables) the outputs are removed from the system before the decomposition,
+// so that only the u variables needed by the outputs are computed. The signature of the function is
+//
+// void (T *in_out, const T *par, const T *time)
+//
+// where in_out contains on input the values of the retained state variables (with the
+// same layout as in taylor_add_jet()), and on output the derivatives of order o of the j-th
+// output at in_out[(o * n_out + j) * batch_size] (including the order 0). The size of in_out
+// must thus be at least max(n_eq, n_out * (order + 1)) * batch_size, where n_eq is the number
+// of retained state variables. The return value contains the Taylor decomposition of the
+// pruned system (whose first n_eq entries are the retained state variables, in the original
+// order) and the indices of the u variables representing the outputs.
+HEYOKA_DLL_PUBLIC std::pair<taylor_dc_t, std::vector<std::uint32_t>>
+taylor_add_jet_outputs_dbl(llvm_state &, const std::string &, std::vector<std::pair<expression, expression>>,
+                           std::vector<expression>, std::uint32_t, std::uint32_t, bool, bool);
+HEYOKA_DLL_PUBLIC std::pair<taylor_dc_t, std::vector<std::uint32_t>>
+taylor_add_jet_outputs_ldbl(llvm_state &, const std::string &, std::vector<std::pair<expression, expression>>,
+                            std::vector<expression>, std::uint32_t, std::uint32_t, bool, bool);
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+HEYOKA_DLL_PUBLIC std::pair<taylor_dc_t, std::vector<std::uint32_t>>
+taylor_add_jet_outputs_f128(llvm_state &, const std::string &, std::vector<std::pair<expression, expression>>,
+                            std::vector<expression>, std::uint32_t, std::uint32_t, bool, bool);
+
+#endif
+
+template <typename T>
+std::pair<taylor_dc_t, std::vector<std::uint32_t>>
+taylor_add_jet_outputs(llvm_state &s, const std::string &name, std::vector<std::pair<expression, expression>> sys,
+                       std::vector<expression> outputs, std::uint32_t order, std::uint32_t batch_size,
+                       bool high_accuracy, bool compact_mode)
+{
+    if constexpr (std::is_same_v<T, double>) {
+        return taylor_add_jet_outputs_dbl(s, name, std::move(sys), std::move(outputs), order, batch_size,
+                                          high_accuracy, compact_mode);
+    } else if constexpr (std::is_same_v<T, long double>) {
+        return taylor_add_jet_outputs_ldbl(s, name, std::move(sys), std::move(outputs), order, batch_size,
+                                           high_accuracy, compact_mode);
+#if defined(HEYOKA_HAVE_REAL128)
+    } else if constexpr (std::is_same_v<T, mppp::real128>) {
+        return taylor_add_jet_outputs_f128(s, name, std::move(sys), std::move(outputs), order, batch_size,
+                                           high_accuracy, compact_mode);
+#endif
+    } else {
+        static_assert(detail::always_false_v<T>, "Unhandled type.");
+    }
+}
+
 HEYOKA_DLL_PUBLIC std::tuple<std::vector<std::pair<expression, std::vector<std::uint32_t>>>, std::uint32_t>
 taylor_add_adaptive_step_dbl(llvm_state &, const std::string &, std::vector<expression>, double, std::uint32_t, bool,
                              bool);
@@ -326,14 +532,247 @@ taylor_add_custom_step(llvm_state &s, const std::string &name, std::vector<std::
 // Enum to represent the outcome of a Taylor integration
 // stepping function.
 enum class taylor_outcome {
-    success,     // Integration step was successful, no time/step limits were reached.
-    step_limit,  // Maximum number of steps reached.
-    time_limit,  // Time limit reached.
-    err_nf_state // Non-finite state detected at the end of the timestep.
+    success,        // Integration step was successful, no time/step limits were reached.
+    step_limit,     // Maximum number of steps reached.
+    time_limit,     // Time limit reached.
+    err_nf_state,   // Non-finite state detected at the end of the timestep.
+    terminal_event, // A terminal event was triggered.
+    cb_stop,        // The propagation was stopped by the step callback.
+    stiff           // Stiffness was detected (see enable_stiffness_detection()).
 };
 
 HEYOKA_DLL_PUBLIC std::ostream &operator<<(std::ostream &, taylor_outcome);
 
+// Callback invoked by the propagate_for()/propagate_until() functions at the end
+// of each timestep (including the last one). f is invoked with the context
+// pointer ctx, and the propagation stops with the cb_stop outcome if
+// f returns false. A null f means no callback.
+//
+// NOTE: f is invoked directly from the compiled propagate kernel (when the kernel
+// is used), thus it has access only to the current state and time of the integrator,
+// it must not change the time and it must not throw. The overloads of the propagate
+// functions accepting a generic callable wrap it into a step_callback.
+struct step_callback {
+    bool (*f)(void *) = nullptr;
+    void *ctx = nullptr;
+};
+
+namespace detail
+{
+
+// Invoke prop (a propagate function accepting a step_callback) with a step_callback
+// wrapping the callable cb, which is invoked with the integrator ta. An exception
+// thrown by cb stops the propagation, and it is rethrown after prop returns.
+template <typename Ta, typename F, typename Prop>
+inline decltype(auto) propagate_with_callable(Ta &ta, F &cb, const Prop &prop)
+{
+    struct cb_ctx {
+        F *cb;
+        Ta *ta;
+        std::exception_ptr eptr;
+    } ctx{&cb, &ta, {}};
+
+    auto tramp = [](void *p) -> bool {
+        auto &c = *static_cast<cb_ctx *>(p);
+
+        try {
+            return static_cast<bool>((*c.cb)(*c.ta));
+        } catch (...) {
+            c.eptr = std::current_exception();
+            return false;
+        }
+    };
+
+    decltype(auto) ret = prop(step_callback{+tramp, &ctx});
+
+    if (ctx.eptr) {
+        std::rethrow_exception(ctx.eptr);
+    }
+
+    return ret;
+}
+
+template <typename F, typename Ta>
+inline constexpr bool is_step_callable_v = std::is_invocable_r_v<bool, F &, Ta &>;
+
+} // namespace detail
+
+// Statistics of the steps of an adaptive Taylor integrator (see enable_stats()).
+// In batch mode, the counters of the outcomes, of the zero timesteps and of the
+// histogram are summed over the batch lanes.
+struct taylor_stats {
+    // Number of invocations of the stepper.
+    std::size_t n_steps = 0;
+    // Number of (lane) steps truncated by the time limit (e.g., the
+    // final time of propagate_until() or the last grid point of
+    // propagate_grid()) or by a terminal event, and number of (lane)
+    // steps which produced a non-finite state.
+    std::size_t n_time_limited = 0;
+    std::size_t n_terminal_events = 0;
+    std::size_t n_errors = 0;
+    // Number of (lane) steps with a zero timestep.
+    std::size_t n_zero_h = 0;
+    // Number of steps whose stiffness ratio exceeded the threshold, and
+    // max stiffness ratio (recorded only if the stiffness detection
+    // is enabled, see enable_stiffness_detection()).
+    std::size_t n_stiff = 0;
+    double max_stiffness_ratio = 0;
+    // Total, min and max wall-clock time (in seconds)
+    // of the invocations of the stepper.
+    double step_time = 0;
+    double min_step_time = std::numeric_limits<double>::infinity();
+    double max_step_time = 0;
+    // Histogram of the timesteps: the value associated to the key
+    // e is the number of (lane) steps with abs(h) in [2**e, 2**(e+1)).
+    std::map<int, std::size_t> h_hist;
+    // Batch mode only: the number of steps with a nonzero timestep in
+    // each batch lane (the utilisation of a lane being lane_n_active[i] / n_steps).
+    std::vector<std::size_t> lane_n_active;
+};
+
+HEYOKA_DLL_PUBLIC std::ostream &operator<<(std::ostream &, const taylor_stats &);
+
+// Breakdown of the memory (in bytes) used by an adaptive integrator.
+struct HEYOKA_DLL_PUBLIC taylor_memory_usage {
+    // The llvm_state.
+    llvm_state_memory_usage llvm;
+    // An estimate of the memory used by the Taylor decomposition
+    // (see drop_decomposition()). The nodes of the expressions
+    // shared among the elements of the decomposition are counted once.
+    std::size_t decomposition = 0;
+    // The Taylor coefficients.
+    std::size_t tc = 0;
+    // The other buffers (state, parameters, dense
+    // output, event detection, etc.).
+    std::size_t buffers = 0;
+
+    std::size_t total() const;
+};
+
+HEYOKA_DLL_PUBLIC std::ostream &operator<<(std::ostream &, const taylor_memory_usage &);
+
+// Store of the Taylor coefficients of the steps of an adaptive Taylor integrator
+// (see enable_checkpoints()), from which the trajectory can be evaluated at any
+// time within the recorded steps without re-integrating the system (e.g., in the
+// backward sweep of an adjoint computation). The steps must be contiguous and
+// in the same direction in time.
+template <typename T>
+class HEYOKA_DLL_PUBLIC taylor_checkpoints
+{
+    std::uint32_t m_dim = 0;
+    std::uint32_t m_order = 0;
+    // The times at the boundaries of the steps (n_steps + 1 values,
+    // or none if no step was recorded).
+    std::vector<T> m_times;
+    // The Taylor coefficients of the state variables at the beginning
+    // of each step, each step in the layout of get_tc() (without the
+    // coefficients of the event equations).
+    std::vector<T> m_tcs;
+    // The output of operator().
+    std::vector<T> m_out;
+
+public:
+    taylor_checkpoints();
+    explicit taylor_checkpoints(std::uint32_t, std::uint32_t);
+
+    std::uint32_t get_dim() const
+    {
+        return m_dim;
+    }
+    std::uint32_t get_order() const
+    {
+        return m_order;
+    }
+    std::size_t get_n_steps() const
+    {
+        return m_times.empty() ? 0 : m_times.size() - 1u;
+    }
+    const std::vector<T> &get_times() const
+    {
+        return m_times;
+    }
+    const std::vector<T> &get_tcs() const
+    {
+        return m_tcs;
+    }
+    // NOTE: an exception is thrown
+    // if no step was recorded.
+    std::pair<T, T> get_bounds() const;
+
+    // Record a step from the first to the second
+    // time, with the given Taylor coefficients.
+    void add_step(T, T, const T *);
+    void clear();
+    void shrink_to_fit();
+
+    // Evaluate the state at the given time, which
+    // must be within the bounds of the recorded steps.
+    const std::vector<T> &operator()(T);
+
+    void save(std::ostream &) const;
+    void load(std::istream &);
+};
+
+// Record of the monitoring of the invariants of an adaptive Taylor integrator
+// (see enable_invariants()). The invariants are evaluated every n steps, and
+// their drifts are the differences with respect to the reference values.
+template <typename T>
+struct taylor_invariants {
+    // The reference values of the invariants (i.e., their
+    // values when the monitoring was enabled or reset).
+    std::vector<T> ref;
+    // The times of the evaluations and the drifts of the
+    // invariants (row-major, n_evals x n_inv).
+    std::vector<T> times;
+    std::vector<T> drifts;
+    // The max abs drift of each invariant.
+    std::vector<T> max_drift;
+};
+
+// Enum to represent the direction
+// of the zero crossing of an event.
+enum class event_direction { negative = -1, any = 0, positive = 1 };
+
+HEYOKA_DLL_PUBLIC std::ostream &operator<<(std::ostream &, event_direction);
+
+// Enum to represent the strategy used to reorder
+// the Taylor decomposition of an ODE system:
+// - bfs: breadth-first topological sort, clustering together
+//   the independent operations (this is the default);
+// - dfs: the depth-first order produced by the decomposition,
+//   in which the u variables tend to be consumed right after
+//   their definition;
+// - live_range: topological sort which favours the u variables
+//   whose arguments were computed most recently, in order to
+//   shorten the live ranges of the u variables (this can reduce
+//   the register pressure in non-compact mode).
+enum class taylor_sort_strategy { bfs, dfs, live_range };
+
+HEYOKA_DLL_PUBLIC std::ostream &operator<<(std::ostream &, taylor_sort_strategy);
+
+// Layout of the array of Taylor derivatives in compact mode:
+// - order_major: the derivatives of all the u variables at
+//   order 0, followed by the derivatives at order 1, etc. (this
+//   is the default);
+// - var_major: the derivatives of the first u variable at all orders,
+//   followed by the derivatives of the second u variable, etc. In this
+//   layout, the derivatives of a u variable read in the computation
+//   of the derivatives of higher order are contiguous in memory.
+enum class taylor_jet_layout { order_major, var_major };
+
+HEYOKA_DLL_PUBLIC std::ostream &operator<<(std::ostream &, taylor_jet_layout);
+
+// Tag to request the automatic selection of the compact mode in the construction
+// of an adaptive Taylor integrator (kw::compact_mode = compact_mode_auto). The compact
+// mode is selected if the estimated number of operations in the default-mode computation
+// of the Taylor derivatives (which is deduced from the number of unique subexpressions
+// of the system and from the Taylor order) exceeds a threshold. The estimate and the
+// selection are recorded in the stats of the llvm_state of the integrator.
+struct compact_mode_auto_t {
+};
+
+inline constexpr compact_mode_auto_t compact_mode_auto{};
+
 namespace kw
 {
 
@@ -342,62 +781,554 @@ IGOR_MAKE_NAMED_ARGUMENT(tol);
 IGOR_MAKE_NAMED_ARGUMENT(high_accuracy);
 IGOR_MAKE_NAMED_ARGUMENT(compact_mode);
 IGOR_MAKE_NAMED_ARGUMENT(pars);
+IGOR_MAKE_NAMED_ARGUMENT(t_events);
+IGOR_MAKE_NAMED_ARGUMENT(nt_events);
+IGOR_MAKE_NAMED_ARGUMENT(isa_variants);
+IGOR_MAKE_NAMED_ARGUMENT(pgo_steps);
+IGOR_MAKE_NAMED_ARGUMENT(simplify);
+IGOR_MAKE_NAMED_ARGUMENT(sort_strategy);
+IGOR_MAKE_NAMED_ARGUMENT(parallel_mode);
+IGOR_MAKE_NAMED_ARGUMENT(unroll_threshold);
+IGOR_MAKE_NAMED_ARGUMENT(jet_layout);
+IGOR_MAKE_NAMED_ARGUMENT(rtol);
+IGOR_MAKE_NAMED_ARGUMENT(atol);
+IGOR_MAKE_NAMED_ARGUMENT(err_weights);
+IGOR_MAKE_NAMED_ARGUMENT(compensated_time);
+IGOR_MAKE_NAMED_ARGUMENT(predict_h);
+IGOR_MAKE_NAMED_ARGUMENT(simd_segments);
+IGOR_MAKE_NAMED_ARGUMENT(estrin);
+IGOR_MAKE_NAMED_ARGUMENT(mem_hints);
+
+// Keyword argument for the variable-order integration.
+IGOR_MAKE_NAMED_ARGUMENT(orders);
+
+// Keyword argument for the fixed Taylor order.
+IGOR_MAKE_NAMED_ARGUMENT(order);
+
+// Keyword argument for the selection of the order.
+IGOR_MAKE_NAMED_ARGUMENT(tuning_orders);
+
+// Keyword arguments for the automatic selection of the batch size.
+IGOR_MAKE_NAMED_ARGUMENT(max_batch_size);
+IGOR_MAKE_NAMED_ARGUMENT(tuning_steps);
+
+// Keyword arguments for the events.
+IGOR_MAKE_NAMED_ARGUMENT(callback);
+IGOR_MAKE_NAMED_ARGUMENT(cooldown);
+IGOR_MAKE_NAMED_ARGUMENT(direction);
+
+} // namespace kw
+
+template <typename>
+class taylor_multi_builder;
+
+namespace detail
+{
+
+namespace kw_internal
+{
+
+// Internal keyword argument used by taylor_multi_builder
+// to defer the optimisation and the compilation of an integrator.
+IGOR_MAKE_NAMED_ARGUMENT(deferred_compile);
+
+} // namespace kw_internal
+
+template <typename T>
+class HEYOKA_DLL_PUBLIC taylor_adaptive_impl;
+
+template <typename>
+struct taylor_invariants_impl;
+
+// NOTE: the deleter is defined in the source file, so that the
+// destructor of the owning pointer can be instantiated in the
+// constructors of the integrator, where the monitor is incomplete.
+template <typename T>
+struct HEYOKA_DLL_PUBLIC taylor_invariants_deleter {
+    void operator()(taylor_invariants_impl<T> *) const noexcept;
+};
+
+// Non-terminal event. When the event equation
+// crosses zero during a timestep, the callback will be
+// invoked with the integrator and the time of the zero
+// crossing as arguments. The integration then continues
+// normally.
+template <typename T>
+class HEYOKA_DLL_PUBLIC nt_event_impl
+{
+public:
+    using callback_t = std::function<void(taylor_adaptive_impl<T> &, T)>;
+
+private:
+    expression eq;
+    callback_t callback;
+    event_direction dir;
+
+    HEYOKA_DLL_LOCAL void finalise_ctor(event_direction);
+
+public:
+    template <typename... KwArgs>
+    explicit nt_event_impl(expression e, callback_t cb, KwArgs &&...kw_args)
+        : eq(std::move(e)), callback(std::move(cb))
+    {
+        igor::parser p{kw_args...};
+
+        if constexpr (p.has_unnamed_arguments()) {
+            static_assert(detail::always_false_v<KwArgs...>,
+                          "The variadic arguments in the construction of a non-terminal event contain "
+                          "unnamed arguments.");
+        } else {
+            // Direction (defaults to any).
+            auto d = [&p]() -> event_direction {
+                if constexpr (p.has(kw::direction)) {
+                    return std::forward<decltype(p(kw::direction))>(p(kw::direction));
+                } else {
+                    return event_direction::any;
+                }
+            }();
+
+            finalise_ctor(d);
+        }
+    }
+
+    nt_event_impl(const nt_event_impl &);
+    nt_event_impl(nt_event_impl &&);
+
+    nt_event_impl &operator=(const nt_event_impl &);
+    nt_event_impl &operator=(nt_event_impl &&);
+
+    ~nt_event_impl();
+
+    const expression &get_expression() const;
+    const callback_t &get_callback() const;
+    event_direction get_direction() const;
+};
+
+// Terminal event. When the event equation crosses zero
+// during a timestep, the timestep is truncated at the
+// time of the zero crossing and the integration is stopped.
+// If a callback is provided, it will be invoked with the
+// integrator and the time of the zero crossing as arguments.
+// If the callback returns true, the integration will not
+// be stopped. After a terminal event has been triggered,
+// the zero crossings of the event equation within the
+// cooldown time will be ignored. A negative cooldown
+// (the default) means that the cooldown will be deduced
+// automatically.
+template <typename T>
+class HEYOKA_DLL_PUBLIC t_event_impl
+{
+public:
+    using callback_t = std::function<bool(taylor_adaptive_impl<T> &, T)>;
+
+private:
+    expression eq;
+    callback_t callback;
+    T cooldown;
+    event_direction dir;
+
+    HEYOKA_DLL_LOCAL void finalise_ctor(callback_t, T, event_direction);
+
+public:
+    template <typename... KwArgs>
+    explicit t_event_impl(expression e, KwArgs &&...kw_args) : eq(std::move(e))
+    {
+        igor::parser p{kw_args...};
+
+        if constexpr (p.has_unnamed_arguments()) {
+            static_assert(detail::always_false_v<KwArgs...>,
+                          "The variadic arguments in the construction of a terminal event contain "
+                          "unnamed arguments.");
+        } else {
+            // Callback (defaults to empty).
+            auto cb = [&p]() -> callback_t {
+                if constexpr (p.has(kw::callback)) {
+                    return std::forward<decltype(p(kw::callback))>(p(kw::callback));
+                } else {
+                    return {};
+                }
+            }();
+
+            // Cooldown (defaults to -1, that is, auto-deduced).
+            auto cd = [&p]() -> T {
+                if constexpr (p.has(kw::cooldown)) {
+                    return std::forward<decltype(p(kw::cooldown))>(p(kw::cooldown));
+                } else {
+                    return T(-1);
+                }
+            }();
+
+            // Direction (defaults to any).
+            auto d = [&p]() -> event_direction {
+                if constexpr (p.has(kw::direction)) {
+                    return std::forward<decltype(p(kw::direction))>(p(kw::direction));
+                } else {
+                    return event_direction::any;
+                }
+            }();
+
+            finalise_ctor(std::move(cb), cd, d);
+        }
+    }
+
+    t_event_impl(const t_event_impl &);
+    t_event_impl(t_event_impl &&);
+
+    t_event_impl &operator=(const t_event_impl &);
+    t_event_impl &operator=(t_event_impl &&);
+
+    ~t_event_impl();
+
+    const expression &get_expression() const;
+    const callback_t &get_callback() const;
+    event_direction get_direction() const;
+    T get_cooldown() const;
+};
+
+} // namespace detail
+
+template <typename T>
+using nt_event = detail::nt_event_impl<T>;
+
+template <typename T>
+using t_event = detail::t_event_impl<T>;
+
+namespace detail
+{
+
+// Helper for parsing common options for the Taylor integrators.
+template <typename T, typename... KwArgs>
+inline auto taylor_adaptive_common_ops(KwArgs &&...kw_args)
+{
+    igor::parser p{kw_args...};
+
+    // High accuracy mode (defaults to false).
+    auto high_accuracy = [&p]() -> bool {
+        if constexpr (p.has(kw::high_accuracy)) {
+            return std::forward<decltype(p(kw::high_accuracy))>(p(kw::high_accuracy));
+        } else {
+            return false;
+        }
+    }();
+
+    // tol (defaults to eps).
+    auto tol = [&p]() -> T {
+        if constexpr (p.has(kw::tol)) {
+            auto retval = std::forward<decltype(p(kw::tol))>(p(kw::tol));
+            if (retval != T(0)) {
+                // NOTE: this covers the NaN case as well.
+                return retval;
+            }
+            // NOTE: zero tolerance will be interpreted
+            // as automatically-deduced by falling through
+            // the code below.
+        }
+
+        return std::numeric_limits<T>::epsilon();
+    }();
+
+    // Compact mode (defaults to false).
+    // NOTE: with compact_mode_auto, the compact mode is selected
+    // later via taylor_select_compact_mode().
+    auto compact_mode = [&p]() -> bool {
+        if constexpr (p.has(kw::compact_mode)) {
+            if constexpr (std::is_same_v<uncvref_t<decltype(p(kw::compact_mode))>, compact_mode_auto_t>) {
+                return false;
+            } else {
+                return std::forward<decltype(p(kw::compact_mode))>(p(kw::compact_mode));
+            }
+        } else {
+            return false;
+        }
+    }();
+
+    // Vector of parameters (defaults to empty vector).
+    auto pars = [&p]() -> std::vector<T> {
+        if constexpr (p.has(kw::pars)) {
+            return std::forward<decltype(p(kw::pars))>(p(kw::pars));
+        } else {
+            return {};
+        }
+    }();
+
+    // Target CPUs for the ISA variants of the
+    // integrator (defaults to empty vector).
+    auto isa_variants = [&p]() -> std::vector<std::string> {
+        if constexpr (p.has(kw::isa_variants)) {
+            return std::forward<decltype(p(kw::isa_variants))>(p(kw::isa_variants));
+        } else {
+            return {};
+        }
+    }();
+
+    // Number of steps after which the integrator is recompiled
+    // using the profile data collected by the instrumented
+    // stepper (defaults to zero, which disables the
+    // profile-guided optimisation).
+    auto pgo_steps = [&p]() -> std::size_t {
+        if constexpr (p.has(kw::pgo_steps)) {
+            return std::forward<decltype(p(kw::pgo_steps))>(p(kw::pgo_steps));
+        } else {
+            return 0;
+        }
+    }();
+
+    // Reordering strategy for the Taylor decomposition (defaults to bfs).
+    auto sort_strategy = [&p]() -> taylor_sort_strategy {
+        if constexpr (p.has(kw::sort_strategy)) {
+            return std::forward<decltype(p(kw::sort_strategy))>(p(kw::sort_strategy));
+        } else {
+            return taylor_sort_strategy::bfs;
+        }
+    }();
+
+    // Parallel mode (defaults to false).
+    auto parallel_mode = [&p]() -> bool {
+        if constexpr (p.has(kw::parallel_mode)) {
+            return std::forward<decltype(p(kw::parallel_mode))>(p(kw::parallel_mode));
+        } else {
+            return false;
+        }
+    }();
+
+    // Hybrid compact mode: in compact mode, the segments of the Taylor
+    // decomposition with fewer than unroll_threshold u variables
+    // are unrolled (defaults to zero, i.e., no segment is unrolled).
+    auto unroll_threshold = [&p]() -> std::uint32_t {
+        if constexpr (p.has(kw::unroll_threshold)) {
+            return std::forward<decltype(p(kw::unroll_threshold))>(p(kw::unroll_threshold));
+        } else {
+            return 0;
+        }
+    }();
+
+    // Layout of the array of the Taylor derivatives
+    // in compact mode (defaults to order_major).
+    auto jet_layout = [&p]() -> taylor_jet_layout {
+        if constexpr (p.has(kw::jet_layout)) {
+            return std::forward<decltype(p(kw::jet_layout))>(p(kw::jet_layout));
+        } else {
+            return taylor_jet_layout::order_major;
+        }
+    }();
+
+    // Mixed absolute/relative error control: the absolute and relative tolerances
+    // (defaulting to tol if any of kw::rtol, kw::atol and kw::err_weights is
+    // provided, to zero otherwise, which disables the mixed error control)
+    // and the per-component error weights (defaults to empty, i.e., unit weights).
+    constexpr auto mixed_ctrl = p.has(kw::rtol) || p.has(kw::atol) || p.has(kw::err_weights);
+
+    auto rtol = [&p, tol]() -> T {
+        if constexpr (p.has(kw::rtol)) {
+            return std::forward<decltype(p(kw::rtol))>(p(kw::rtol));
+        } else {
+            return mixed_ctrl ? tol : T(0);
+        }
+    }();
+
+    auto atol = [&p, tol]() -> T {
+        if constexpr (p.has(kw::atol)) {
+            return std::forward<decltype(p(kw::atol))>(p(kw::atol));
+        } else {
+            return mixed_ctrl ? tol : T(0);
+        }
+    }();
+
+    auto err_weights = [&p]() -> std::vector<T> {
+        if constexpr (p.has(kw::err_weights)) {
+            return std::forward<decltype(p(kw::err_weights))>(p(kw::err_weights));
+        } else {
+            return {};
+        }
+    }();
+
+    return std::tuple{high_accuracy,
+                      tol,
+                      compact_mode,
+                      std::move(pars),
+                      std::move(isa_variants),
+                      pgo_steps,
+                      sort_strategy,
+                      parallel_mode,
+                      unroll_threshold,
+                      jet_layout,
+                      rtol,
+                      atol,
+                      std::move(err_weights)};
+}
+
+// Helpers to apply simplify() to the right-hand sides
+// of an ODE system, before the Taylor decomposition.
+inline std::vector<expression> taylor_simplify_sys(std::vector<expression> sys)
+{
+    return simplify(sys);
+}
+
+inline std::vector<std::pair<expression, expression>>
+taylor_simplify_sys(std::vector<std::pair<expression, expression>> sys)
+{
+    std::vector<expression> rhs;
+    rhs.reserve(sys.size());
+    for (const auto &p : sys) {
+        rhs.push_back(p.second);
+    }
+
+    rhs = simplify(rhs);
+
+    for (decltype(sys.size()) i = 0; i < sys.size(); ++i) {
+        sys[i].second = std::move(rhs[i]);
+    }
+
+    return sys;
+}
+
+// NOTE: a precomputed Taylor decomposition cannot be
+// simplified, this throws an exception.
+HEYOKA_DLL_PUBLIC taylor_dc_t taylor_simplify_sys(taylor_dc_t);
+
+// Parser for the simplify keyword argument (defaults to false).
+template <typename... KwArgs>
+inline bool taylor_simplify_kw(KwArgs &&...kw_args)
+{
+    igor::parser p{kw_args...};
+
+    if constexpr (p.has(kw::simplify)) {
+        return std::forward<decltype(p(kw::simplify))>(p(kw::simplify));
+    } else {
+        return false;
+    }
+}
+
+// Parser for the automatic selection of the compact mode
+// (i.e., kw::compact_mode = compact_mode_auto).
+template <typename... KwArgs>
+inline bool taylor_compact_mode_auto_kw(KwArgs &&...kw_args)
+{
+    igor::parser p{kw_args...};
+
+    if constexpr (p.has(kw::compact_mode)) {
+        return std::is_same_v<uncvref_t<decltype(p(kw::compact_mode))>, compact_mode_auto_t>;
+    } else {
+        return false;
+    }
+}
+
+// Automatic selection of the compact mode for the system sys, with the Taylor
+// order deduced from the tolerances (or the highest order of the
+// variable-order integration, if provided). The selection is recorded
+// in the stats of s.
+template <typename T, typename U>
+HEYOKA_DLL_PUBLIC bool taylor_select_compact_mode(llvm_state &, const U &, T, T, T,
+                                                  const std::vector<std::uint32_t> &);
+
+// Parser for the compensated_time keyword argument (defaults to false).
+template <typename... KwArgs>
+inline bool taylor_compensated_time_kw(KwArgs &&...kw_args)
+{
+    igor::parser p{kw_args...};
+
+    if constexpr (p.has(kw::compensated_time)) {
+        return std::forward<decltype(p(kw::compensated_time))>(p(kw::compensated_time));
+    } else {
+        return false;
+    }
+}
+
+// Parser for the predict_h keyword argument (defaults to false).
+template <typename... KwArgs>
+inline bool taylor_predict_h_kw(KwArgs &&...kw_args)
+{
+    igor::parser p{kw_args...};
 
-} // namespace kw
+    if constexpr (p.has(kw::predict_h)) {
+        return std::forward<decltype(p(kw::predict_h))>(p(kw::predict_h));
+    } else {
+        return false;
+    }
+}
 
-namespace detail
+// Parser for the simd_segments keyword argument (defaults to false).
+// NOTE: this keyword argument enables, in the scalar integrators in default
+// mode (double precision only), the computation of the Taylor derivatives
+// via SIMD instructions across the independent u variables within
+// each segment of the decomposition.
+template <typename... KwArgs>
+inline bool taylor_simd_segments_kw(KwArgs &&...kw_args)
 {
+    igor::parser p{kw_args...};
 
-// Helper for parsing common options for the Taylor integrators.
-template <typename T, typename... KwArgs>
-inline auto taylor_adaptive_common_ops(KwArgs &&...kw_args)
+    if constexpr (p.has(kw::simd_segments)) {
+        return std::forward<decltype(p(kw::simd_segments))>(p(kw::simd_segments));
+    } else {
+        return false;
+    }
+}
+
+// Parser for the estrin keyword argument (defaults to false).
+// NOTE: this keyword argument enables, in default mode, the evaluation
+// of the Taylor polynomials in the update of the state via Estrin's scheme
+// (instead of Horner's scheme), which shortens the chain of dependent
+// operations from order to log2(order + 1) levels. It is ignored in compact
+// mode and in high-accuracy mode (which uses the compensated Horner scheme).
+template <typename... KwArgs>
+inline bool taylor_estrin_kw(KwArgs &&...kw_args)
 {
     igor::parser p{kw_args...};
 
-    // High accuracy mode (defaults to false).
-    auto high_accuracy = [&p]() -> bool {
-        if constexpr (p.has(kw::high_accuracy)) {
-            return std::forward<decltype(p(kw::high_accuracy))>(p(kw::high_accuracy));
-        } else {
-            return false;
-        }
-    }();
+    if constexpr (p.has(kw::estrin)) {
+        return std::forward<decltype(p(kw::estrin))>(p(kw::estrin));
+    } else {
+        return false;
+    }
+}
 
-    // tol (defaults to eps).
-    auto tol = [&p]() -> T {
-        if constexpr (p.has(kw::tol)) {
-            auto retval = std::forward<decltype(p(kw::tol))>(p(kw::tol));
-            if (retval != T(0)) {
-                // NOTE: this covers the NaN case as well.
-                return retval;
-            }
-            // NOTE: zero tolerance will be interpreted
-            // as automatically-deduced by falling through
-            // the code below.
-        }
+// Parser for the mem_hints keyword argument (defaults to false).
+// NOTE: this keyword argument enables, in compact mode, the software prefetching
+// of the slots of the array of derivatives written at the next order, and the
+// non-temporal stores of the Taylor coefficients, which are not read back
+// by the stepper. This can help the large (memory-bound) systems.
+template <typename... KwArgs>
+inline bool taylor_mem_hints_kw(KwArgs &&...kw_args)
+{
+    igor::parser p{kw_args...};
 
-        return std::numeric_limits<T>::epsilon();
-    }();
+    if constexpr (p.has(kw::mem_hints)) {
+        return std::forward<decltype(p(kw::mem_hints))>(p(kw::mem_hints));
+    } else {
+        return false;
+    }
+}
 
-    // Compact mode (defaults to false).
-    auto compact_mode = [&p]() -> bool {
-        if constexpr (p.has(kw::compact_mode)) {
-            return std::forward<decltype(p(kw::compact_mode))>(p(kw::compact_mode));
-        } else {
-            return false;
-        }
-    }();
+// Parser for the order keyword argument (defaults to zero, that is, the
+// order deduced from the tolerance as ceil(-log(tol) / 2 + 1)).
+// NOTE: the step sizes are computed for the given order as usual, thus
+// the accuracy is preserved, but the throughput depends on the order
+// (see taylor_tune_order()).
+template <typename... KwArgs>
+inline std::uint32_t taylor_order_kw(KwArgs &&...kw_args)
+{
+    igor::parser p{kw_args...};
 
-    // Vector of parameters (defaults to empty vector).
-    auto pars = [&p]() -> std::vector<T> {
-        if constexpr (p.has(kw::pars)) {
-            return std::forward<decltype(p(kw::pars))>(p(kw::pars));
-        } else {
-            return {};
-        }
-    }();
+    if constexpr (p.has(kw::order)) {
+        return std::forward<decltype(p(kw::order))>(p(kw::order));
+    } else {
+        return 0;
+    }
+}
 
-    return std::tuple{high_accuracy, tol, compact_mode, std::move(pars)};
+// Parser for the internal deferred_compile keyword argument (defaults to false).
+// NOTE: if set, the optimisation and the compilation of the integrator
+// are left to taylor_multi_builder::compile().
+template <typename... KwArgs>
+inline bool taylor_deferred_compile_kw(KwArgs &&...kw_args)
+{
+    igor::parser p{kw_args...};
+
+    if constexpr (p.has(kw_internal::deferred_compile)) {
+        return std::forward<decltype(p(kw_internal::deferred_compile))>(p(kw_internal::deferred_compile));
+    } else {
+        return false;
+    }
 }
 
 template <typename T>
@@ -407,29 +1338,142 @@ class HEYOKA_DLL_PUBLIC taylor_adaptive_impl
     std::vector<T> m_state;
     // Time.
     T m_time;
+    // The low-order part of the time. With the compensated
+    // summation of the time, (m_time, m_time_lo) is a double-length
+    // representation of the time. Otherwise, this is always zero.
+    T m_time_lo = 0;
     // The LLVM machinery.
     llvm_state m_llvm;
     // Dimension of the system.
     std::uint32_t m_dim;
     // Taylor decomposition.
-    std::vector<std::pair<expression, std::vector<std::uint32_t>>> m_dc;
+    // NOTE: the decomposition is immutable, and it is
+    // shared among copies of the integrator (null if dropped).
+    std::shared_ptr<const std::vector<std::pair<expression, std::vector<std::uint32_t>>>> m_dc;
+    // The objects whose addresses are embedded in the compiled
+    // code (e.g., the trajectories of the ephem functions), kept
+    // alive independently of the decomposition.
+    std::vector<std::shared_ptr<const void>> m_keep_alive;
     // Taylor order.
     std::uint32_t m_order;
-    // The stepper.
-    using step_f_t = void (*)(T *, const T *, const T *, T *, T *);
+    // The stepper. The return value is nonzero if the
+    // updated state contains only finite values.
+    using step_f_t = std::uint32_t (*)(T *, const T *, const T *, T *, T *);
     step_f_t m_step_f;
     // The vector of parameters.
     std::vector<T> m_pars;
     // The vector for the Taylor coefficients.
     std::vector<T> m_tc;
+    // Size of the last timestep taken.
+    T m_last_h;
+    // The function for computing the dense output.
+    // NOTE: this is fetched on first use (see get_d_out_f()).
+    using d_out_f_t = void (*)(T *, const T *, const T *);
+    d_out_f_t m_d_out_f;
+    // The vector for the dense output.
+    std::vector<T> m_d_out;
+    // Compact mode flag.
+    bool m_compact_mode;
+    // Flag for the compensated summation of the time.
+    bool m_comp_time = false;
+    // Flag for the step size prediction, and the step size predicted
+    // from the Taylor coefficients of the last step (zero if
+    // no prediction is available).
+    bool m_predict_h = false;
+    T m_pred_h = 0;
+    // The external buffers for the state and the parameters
+    // (null if not bound, see bind_buffers()).
+    T *m_ext_state = nullptr;
+    T *m_ext_pars = nullptr;
+    // The number of steps remaining before the recompilation
+    // with the profile data (zero if no recompilation is pending).
+    std::size_t m_pgo_steps;
+    // The propagate kernel, running the loop of propagate_until()
+    // within the compiled code. The return value is the outcome code.
+    // NOTE: this is fetched on first use (see get_prop_f()).
+    using prop_f_t = std::uint32_t (*)(T *, const T *, T *, T *, std::uint64_t *, bool (*)(void *), void *);
+    prop_f_t m_prop_f = nullptr;
+
+public:
+    using nt_event_t = nt_event_impl<T>;
+    using t_event_t = t_event_impl<T>;
+
+private:
+    // The terminal and non-terminal events.
+    std::vector<t_event_t> m_tes;
+    std::vector<nt_event_t> m_ntes;
+    // The cooldowns of the terminal events, represented
+    // as (trigger time, cooldown) pairs. An empty optional
+    // means that the event is not in cooldown.
+    std::vector<std::optional<std::pair<T, T>>> m_te_cooldowns;
+    // Buffers used during event detection.
+    std::vector<T> m_ev_poly, m_ev_tmp, m_ev_roots;
+    std::vector<std::tuple<T, std::uint32_t>> m_t_ev_times, m_nt_ev_times;
+    // The hardware performance counters (empty if the
+    // profiling of the steps is not enabled), the counts
+    // of the profiled steps and the output buffer used
+    // in the measurement of the state update.
+    std::unique_ptr<perf_counter_group> m_perf;
+    std::vector<step_perf_counts> m_perf_counts;
+    std::vector<T> m_perf_buf;
+    // The statistics of the steps (empty if
+    // the collection of the statistics is not enabled).
+    std::optional<taylor_stats> m_stats;
+    // The recorded checkpoints (empty if
+    // the recording is not enabled).
+    std::optional<taylor_checkpoints<T>> m_ckpts;
+    // The monitor of the invariants (null if
+    // the monitoring is not enabled).
+    std::unique_ptr<taylor_invariants_impl<T>, taylor_invariants_deleter<T>> m_inv;
+    // The stiffness detection: the threshold and the number of consecutive
+    // steps (zero if the detection is not enabled), the current count of the
+    // consecutive stiff steps and the stiffness ratio of the last step.
+    T m_stiff_threshold = 0;
+    std::size_t m_stiff_n_steps = 0, m_stiff_count = 0;
+    T m_stiff_ratio = 0;
+    // The re-optimised LLVM state being compiled
+    // in the background (see optimise_async()).
+    std::future<llvm_state> m_opt_fut;
+    // Buffers used in step_symmetric().
+    std::vector<T> m_sym_mid, m_sym_z;
+    // The data for the variable-order integration (all empty if the order
+    // is fixed): the increasing orders of the steppers, the steppers,
+    // the dense output functions (fetched on first use), the logarithms
+    // of the step size factors of the orders, the buffer for the norms of the
+    // Taylor coefficients and the index of the order of the last step.
+    std::vector<std::uint32_t> m_vo_orders;
+    std::vector<step_f_t> m_vo_step_f;
+    std::vector<d_out_f_t> m_vo_d_out_f;
+    std::vector<T> m_vo_log_rhofac, m_vo_norms;
+    std::uint32_t m_vo_idx = 0;
+    // Flag signalling that the compilation was deferred
+    // to taylor_multi_builder::compile() (see finalise_deferred()).
+    bool m_deferred = false;
+
+    friend class taylor_multi_builder<T>;
 
     HEYOKA_DLL_LOCAL std::tuple<taylor_outcome, T> step_impl(T, bool);
+    HEYOKA_DLL_LOCAL std::tuple<taylor_outcome, T> step_impl_core(T, bool);
+    HEYOKA_DLL_LOCAL void stiffness_update(std::tuple<taylor_outcome, T> &);
+    HEYOKA_DLL_LOCAL d_out_f_t get_d_out_f();
+    HEYOKA_DLL_LOCAL prop_f_t get_prop_f();
+    HEYOKA_DLL_LOCAL void fetch_step_f();
+    HEYOKA_DLL_LOCAL void vo_select_order();
+    HEYOKA_DLL_LOCAL void pgo_recompile();
+    HEYOKA_DLL_LOCAL void poll_optimise();
+    HEYOKA_DLL_LOCAL void reset_impl(const std::vector<T> &, T, const std::vector<T> *);
+    HEYOKA_DLL_LOCAL taylor_outcome sym_flow(T);
+    HEYOKA_DLL_LOCAL void finalise_deferred(const llvm_state &, std::string);
 
     // Private implementation-detail constructor machinery.
     // NOTE: apparently on Windows we need to re-iterate
     // here that this is going to be dll-exported.
     template <typename U>
-    HEYOKA_DLL_PUBLIC void finalise_ctor_impl(U, std::vector<T>, T, T, bool, bool, std::vector<T>);
+    HEYOKA_DLL_PUBLIC void finalise_ctor_impl(U, std::vector<T>, T, T, bool, bool, std::vector<T>,
+                                              std::vector<t_event_t>, std::vector<nt_event_t>,
+                                              std::vector<std::string>, std::size_t, taylor_sort_strategy, bool,
+                                              std::uint32_t, taylor_jet_layout, T, T, std::vector<T>,
+                                              std::vector<std::uint32_t>, bool, bool, bool, bool, std::uint32_t, bool);
     template <typename U, typename... KwArgs>
     void finalise_ctor(U sys, std::vector<T> state, KwArgs &&...kw_args)
     {
@@ -449,15 +1493,70 @@ class HEYOKA_DLL_PUBLIC taylor_adaptive_impl
                 }
             }();
 
-            auto [high_accuracy, tol, compact_mode, pars]
+            auto [high_accuracy, tol, compact_mode, pars, isa_variants, pgo_steps, sort_strategy, parallel_mode,
+                  unroll_threshold, jet_layout, rtol, atol, err_weights]
                 = taylor_adaptive_common_ops<T>(std::forward<KwArgs>(kw_args)...);
 
+            // Simplification of the system (defaults to false).
+            if (taylor_simplify_kw(std::forward<KwArgs>(kw_args)...)) {
+                sys = taylor_simplify_sys(std::move(sys));
+            }
+
+            // Terminal events (defaults to empty).
+            auto tes = [&p]() -> std::vector<t_event_t> {
+                if constexpr (p.has(kw::t_events)) {
+                    return std::forward<decltype(p(kw::t_events))>(p(kw::t_events));
+                } else {
+                    return {};
+                }
+            }();
+
+            // Non-terminal events (defaults to empty).
+            auto ntes = [&p]() -> std::vector<nt_event_t> {
+                if constexpr (p.has(kw::nt_events)) {
+                    return std::forward<decltype(p(kw::nt_events))>(p(kw::nt_events));
+                } else {
+                    return {};
+                }
+            }();
+
+            static_assert(!p.has(kw::orders) || !p.has(kw::order),
+                          "The order cannot be specified in the variable-order integration.");
+
+            // The orders of the variable-order integration (defaults
+            // to empty, that is, fixed order deduced from the tolerance).
+            auto orders = [&p]() -> std::vector<std::uint32_t> {
+                if constexpr (p.has(kw::orders)) {
+                    return std::forward<decltype(p(kw::orders))>(p(kw::orders));
+                } else {
+                    return {};
+                }
+            }();
+
+            const auto order = taylor_order_kw(std::forward<KwArgs>(kw_args)...);
+
+            if (taylor_compact_mode_auto_kw(std::forward<KwArgs>(kw_args)...)) {
+                compact_mode = taylor_select_compact_mode(m_llvm, sys, tol, rtol, atol,
+                                                          order == 0u ? orders : std::vector{order});
+            }
+
+            m_deferred = taylor_deferred_compile_kw(std::forward<KwArgs>(kw_args)...);
+
             finalise_ctor_impl(std::move(sys), std::move(state), time, tol, high_accuracy, compact_mode,
-                               std::move(pars));
+                               std::move(pars), std::move(tes), std::move(ntes), std::move(isa_variants), pgo_steps,
+                               sort_strategy, parallel_mode, unroll_threshold, jet_layout, rtol, atol,
+                               std::move(err_weights), std::move(orders),
+                               taylor_compensated_time_kw(std::forward<KwArgs>(kw_args)...),
+                               taylor_predict_h_kw(std::forward<KwArgs>(kw_args)...),
+                               taylor_simd_segments_kw(std::forward<KwArgs>(kw_args)...),
+                               taylor_estrin_kw(std::forward<KwArgs>(kw_args)...), order,
+                               taylor_mem_hints_kw(std::forward<KwArgs>(kw_args)...));
         }
     }
 
 public:
+    taylor_adaptive_impl();
+
     template <typename... KwArgs>
     explicit taylor_adaptive_impl(std::vector<expression> sys, std::vector<T> state, KwArgs &&...kw_args)
         : m_llvm{std::forward<KwArgs>(kw_args)...}
@@ -471,6 +1570,14 @@ public:
     {
         finalise_ctor(std::move(sys), std::move(state), std::forward<KwArgs>(kw_args)...);
     }
+    // NOTE: construction from a precomputed Taylor decomposition, which
+    // skips the symbolic processing of the system. The events are not supported.
+    template <typename... KwArgs>
+    explicit taylor_adaptive_impl(taylor_dc_t dc, std::vector<T> state, KwArgs &&...kw_args)
+        : m_llvm{std::forward<KwArgs>(kw_args)...}
+    {
+        finalise_ctor(std::move(dc), std::move(state), std::forward<KwArgs>(kw_args)...);
+    }
 
     taylor_adaptive_impl(const taylor_adaptive_impl &);
     taylor_adaptive_impl(taylor_adaptive_impl &&) noexcept;
@@ -484,7 +1591,11 @@ public:
 
     const std::vector<std::pair<expression, std::vector<std::uint32_t>>> &get_decomposition() const;
 
+    // NOTE: in the variable-order integration, get_order()
+    // returns the order of the last step, and get_orders()
+    // returns the orders of the steppers (empty if the order is fixed).
     std::uint32_t get_order() const;
+    const std::vector<std::uint32_t> &get_orders() const;
     std::uint32_t get_dim() const;
 
     T get_time() const
@@ -494,34 +1605,57 @@ public:
     void set_time(T t)
     {
         m_time = t;
+        m_time_lo = 0;
     }
-
-    const std::vector<T> &get_state() const
+    // The double-length representation (hi, lo) of the time. Without
+    // the compensated summation of the time, lo is always zero.
+    std::pair<T, T> get_dtime() const
     {
-        return m_state;
+        return {m_time, m_time_lo};
     }
-    const T *get_state_data() const
+    void set_dtime(T, T);
+    bool get_compensated_time() const
     {
-        return m_state.data();
+        return m_comp_time;
     }
-    T *get_state_data()
+    bool get_predict_h() const
     {
-        return m_state.data();
+        return m_predict_h;
     }
 
-    const std::vector<T> &get_pars() const
+    // NOTE: if external buffers are bound via bind_buffers(), the
+    // state/parameters can be accessed only via the data pointers:
+    // get_state()/get_pars() throw for the bound buffers.
+    const std::vector<T> &get_state() const;
+    const T *get_state_data() const
+    {
+        return m_ext_state == nullptr ? m_state.data() : m_ext_state;
+    }
+    T *get_state_data()
     {
-        return m_pars;
+        return m_ext_state == nullptr ? m_state.data() : m_ext_state;
     }
+
+    const std::vector<T> &get_pars() const;
     const T *get_pars_data() const
     {
-        return m_pars.data();
+        return m_ext_pars == nullptr ? m_pars.data() : m_ext_pars;
     }
     T *get_pars_data()
     {
-        return m_pars.data();
+        return m_ext_pars == nullptr ? m_pars.data() : m_ext_pars;
+    }
+    typename std::vector<T>::size_type get_pars_size() const
+    {
+        return m_pars.size();
     }
 
+    // Bind external buffers for the state and the parameters (a null
+    // pointer keeps the internal buffer), on which the integrator then
+    // operates in place.
+    void bind_buffers(T *, T *);
+    void unbind_buffers();
+
     const std::vector<T> &get_tc() const
     {
         return m_tc;
@@ -535,9 +1669,150 @@ public:
         return m_tc.data();
     }
 
+    T get_last_h() const
+    {
+        return m_last_h;
+    }
+
+    const std::vector<T> &get_d_output() const
+    {
+        return m_d_out;
+    }
+    const std::vector<T> &update_d_output(T);
+
+    const std::vector<t_event_t> &get_t_events() const
+    {
+        return m_tes;
+    }
+    const std::vector<nt_event_t> &get_nt_events() const
+    {
+        return m_ntes;
+    }
+    void reset_cooldowns();
+
+    // Re-initialise the integrator with a new state, time and (optionally)
+    // parameters, keeping the compiled code and the buffers. The per-run data
+    // (e.g., the last timestep and the event cooldowns) is cleared.
+    void reset(const std::vector<T> &, T = 0);
+    void reset(const std::vector<T> &, T, const std::vector<T> &);
+
+    // NOTE: binary serialisation. Integrators
+    // with events cannot be serialised.
+    void save(std::ostream &) const;
+    void load(std::istream &);
+
+    // Profiling of the steps via the hardware performance counters
+    // (see perf_counters.hpp). When enabled, the counts of each step
+    // are appended to get_perf_counts(). The argument of enable_perf_counters()
+    // is the configuration of the optional raw event (zero to disable it).
+    // NOTE: the profiling state is not copied or serialised.
+    void enable_perf_counters(std::uint64_t = 0);
+    void disable_perf_counters();
+    bool perf_counters_enabled() const;
+    const std::vector<step_perf_counts> &get_perf_counts() const;
+    void reset_perf_counts();
+
+    // Collection of the statistics of the steps (see taylor_stats).
+    // NOTE: the statistics are copied, but not serialised.
+    void enable_stats();
+    void disable_stats();
+    bool stats_enabled() const;
+    // NOTE: if the collection of the statistics
+    // is not enabled, an exception is thrown.
+    const taylor_stats &get_stats() const;
+    void reset_stats();
+
+    // Recording of the Taylor coefficients of the successful steps with a nonzero
+    // timestep (see taylor_checkpoints). The recording is not supported by the
+    // variable-order integrator.
+    // NOTE: the checkpoints are copied, but not serialised (they can
+    // be saved separately via taylor_checkpoints::save()).
+    void enable_checkpoints();
+    void disable_checkpoints();
+    bool checkpoints_enabled() const;
+    // NOTE: if the recording is not enabled,
+    // an exception is thrown.
+    const taylor_checkpoints<T> &get_checkpoints() const;
+    void reset_checkpoints();
+
+    // Monitoring of the invariants (e.g., the energy) of the system (see
+    // taylor_invariants). The invariants are expressions of the state variables
+    // and of the parameters, JIT-compiled when the monitoring is enabled and
+    // evaluated after every n successful steps with a nonzero timestep (n being
+    // the second argument). The monitoring requires the Taylor
+    // decomposition (see drop_decomposition()), and it is not performed
+    // by step_symmetric().
+    // NOTE: the monitor is copied, but not serialised.
+    void enable_invariants(const std::vector<expression> &, std::size_t = 1);
+    void disable_invariants();
+    bool invariants_enabled() const;
+    // NOTE: if the monitoring is not enabled,
+    // an exception is thrown.
+    const taylor_invariants<T> &get_invariants() const;
+    // Clear the record and take the current
+    // values of the invariants as references.
+    void reset_invariants();
+
+    // Stiffness detection. After each successful step whose timestep was not limited (e.g.,
+    // by the time limit), the stiffness ratio of the step is computed from the Taylor
+    // coefficients of orders 0 and 1, as the ratio between the time scale of the variation
+    // of the state (max abs value of the state over max abs value of the first derivatives)
+    // and the timestep (which is determined by the coefficients of the highest orders).
+    // On stiff problems, the timestep is limited by the fast decaying modes, while the
+    // state evolves slowly, and the ratio is large. If the ratio exceeds the threshold
+    // (first argument) for n consecutive steps (second argument), the step returns the stiff
+    // outcome, and the propagate functions stop. The stiffness detection is not supported by
+    // the variable-order integrator.
+    // NOTE: like the step size control, the ratio assumes that the state variables
+    // have comparable scales.
+    // NOTE: the configuration is copied, but not serialised.
+    void enable_stiffness_detection(T = T(1000), std::size_t = 100);
+    void disable_stiffness_detection();
+    bool stiffness_detection_enabled() const;
+    // NOTE: zero if no step was taken since the
+    // stiffness detection was enabled.
+    T get_stiffness_ratio() const;
+
+    // Memory footprint. drop_decomposition() releases the Taylor decomposition
+    // (after which get_decomposition() returns an empty vector), drop_ir_snapshot()
+    // releases the IR snapshot of the llvm_state (see llvm_state::drop_ir_snapshot()).
+    // NOTE: the decomposition and the IR snapshot are not needed for the integration,
+    // but, after drop_ir_snapshot(), the integrator cannot be copied in compact mode.
+    taylor_memory_usage memory_usage() const;
+    void drop_decomposition();
+    void drop_ir_snapshot();
+
+    // Re-optimise the compiled code in a background thread with the given
+    // optimisation level. In the meantime, the integrator can be used as usual,
+    // and the re-optimised code replaces the current code at the beginning of the
+    // first step (or propagation) after the completion of the background compilation.
+    // The typical use is to construct the integrator with kw::opt_level = 0u
+    // (which minimises the time to the first step) and to invoke optimise_async()
+    // right after the construction. wait_optimise() waits for the completion of
+    // the background compilation (if any) and replaces the code, returning
+    // true if the code was replaced.
+    // NOTE: the background compilation is not copied or serialised,
+    // and the destructor waits for its completion.
+    void optimise_async(unsigned = 3);
+    bool optimise_pending() const;
+    bool wait_optimise();
+
     std::tuple<taylor_outcome, T> step(bool = false);
     std::tuple<taylor_outcome, T> step_backward(bool = false);
     std::tuple<taylor_outcome, T> step(T, bool = false);
+    // Time-symmetric step with the given timestep, for the long-term
+    // integration of time-reversible (e.g., Hamiltonian) systems with
+    // a constant timestep. The step is reversible (i.e., a step with -h
+    // restores the original state) up to the tolerance of the fixed-point
+    // iteration. The return value contains the outcome (step_limit
+    // if the fixed-point iteration did not converge within the given maximum
+    // number of iterations) and the number of iterations.
+    // NOTE: the symmetric step is not supported with events
+    // or with the recording of the checkpoints.
+    // NOTE: if the outcome is neither success nor step_limit, the state and
+    // the time are left as computed by the last flow of the step (i.e., they
+    // refer neither to the beginning nor to the end of the step).
+    std::tuple<taylor_outcome, std::uint32_t> step_symmetric(T, std::uint32_t = 20);
 
     // NOTE: return values:
     // - outcome,
@@ -547,8 +1822,29 @@ public:
     //   undertaken.
     // NOTE: the min/max timesteps are well-defined
     // only if at least 1-2 steps were taken successfully.
-    std::tuple<taylor_outcome, T, T, std::size_t> propagate_for(T, std::size_t = 0);
-    std::tuple<taylor_outcome, T, T, std::size_t> propagate_until(T, std::size_t = 0);
+    // NOTE: see step_callback for the optional step callback. The callable cb
+    // in the overloads below is invoked with a reference to the integrator.
+    std::tuple<taylor_outcome, T, T, std::size_t> propagate_for(T, std::size_t = 0, step_callback = {});
+    std::tuple<taylor_outcome, T, T, std::size_t> propagate_until(T, std::size_t = 0, step_callback = {});
+    template <typename F, std::enable_if_t<is_step_callable_v<F, taylor_adaptive_impl>, int> = 0>
+    std::tuple<taylor_outcome, T, T, std::size_t> propagate_for(T delta_t, std::size_t max_steps, F &&cb)
+    {
+        return propagate_with_callable(*this, cb, [&](step_callback scb) {
+            return propagate_for(delta_t, max_steps, scb);
+        });
+    }
+    template <typename F, std::enable_if_t<is_step_callable_v<F, taylor_adaptive_impl>, int> = 0>
+    std::tuple<taylor_outcome, T, T, std::size_t> propagate_until(T t, std::size_t max_steps, F &&cb)
+    {
+        return propagate_with_callable(*this, cb, [&](step_callback scb) {
+            return propagate_until(t, max_steps, scb);
+        });
+    }
+    // NOTE: the last element of the return value
+    // contains the state vectors at the grid points
+    // that were reached (grid-major, state-minor).
+    std::tuple<taylor_outcome, T, T, std::size_t, std::vector<T>> propagate_grid(const std::vector<T> &,
+                                                                                 std::size_t = 0);
 };
 
 } // namespace detail
@@ -610,9 +1906,71 @@ struct taylor_adaptive_t_impl<mppp::real128> {
 template <typename T>
 using taylor_adaptive = typename detail::taylor_adaptive_t_impl<T>::type;
 
+// Tag to request the automatic selection of the batch size
+// in the construction of an adaptive batch Taylor integrator
+// (see taylor_tune_batch_size()).
+struct batch_size_auto_t {
+};
+
+inline constexpr batch_size_auto_t batch_size_auto{};
+
+// The results of the measurement of the step throughput
+// of an ODE system for several batch sizes.
+struct HEYOKA_DLL_PUBLIC taylor_batch_tuning {
+    // The batch sizes tried.
+    std::vector<std::uint32_t> batch_sizes;
+    // The corresponding step throughputs: the number of
+    // steps per second, summed over the lanes of the batch.
+    std::vector<double> throughputs;
+    // The recommended batch size.
+    std::uint32_t batch_size = 1;
+};
+
+HEYOKA_DLL_PUBLIC std::ostream &operator<<(std::ostream &, const taylor_batch_tuning &);
+
+template <typename T, typename U, typename... KwArgs>
+taylor_batch_tuning taylor_tune_batch_size(const U &, const std::vector<T> &, const KwArgs &...);
+
+// The results of the measurement of the cost of the
+// integration of an ODE system for several Taylor orders.
+struct HEYOKA_DLL_PUBLIC taylor_order_tuning {
+    // The orders tried.
+    std::vector<std::uint32_t> orders;
+    // The corresponding number of steps per unit of integration time.
+    std::vector<double> steps_per_time;
+    // The corresponding wall-clock cost per step (in seconds).
+    std::vector<double> step_costs;
+    // The recommended order, i.e., the order minimising the
+    // wall-clock time per unit of integration time.
+    std::uint32_t order = 0;
+};
+
+HEYOKA_DLL_PUBLIC std::ostream &operator<<(std::ostream &, const taylor_order_tuning &);
+
 namespace detail
 {
 
+HEYOKA_DLL_PUBLIC std::vector<std::uint32_t> taylor_batch_tuning_candidates(std::uint32_t);
+HEYOKA_DLL_PUBLIC std::vector<std::uint32_t> taylor_order_tuning_candidates(double);
+HEYOKA_DLL_PUBLIC std::uint32_t taylor_order_tuning_select(const taylor_order_tuning &);
+HEYOKA_DLL_PUBLIC std::uint32_t taylor_batch_tuning_select(const std::vector<std::uint32_t> &,
+                                                           const std::vector<double> &);
+
+// Replicate the values in v (the state or the parameters
+// for a single lane) over the lanes of a batch of size batch_size.
+template <typename T>
+inline std::vector<T> taylor_replicate_lanes(const std::vector<T> &v, std::uint32_t batch_size)
+{
+    std::vector<T> retval;
+    retval.reserve(v.size() * batch_size);
+
+    for (const auto &x : v) {
+        retval.insert(retval.end(), batch_size, x);
+    }
+
+    return retval;
+}
+
 template <typename T>
 class HEYOKA_DLL_PUBLIC taylor_adaptive_batch_impl
 {
@@ -622,21 +1980,55 @@ class HEYOKA_DLL_PUBLIC taylor_adaptive_batch_impl
     std::vector<T> m_state;
     // Times.
     std::vector<T> m_time;
+    // The low-order parts of the times (see
+    // taylor_adaptive_impl::m_time_lo).
+    std::vector<T> m_time_lo;
     // The LLVM machinery.
     llvm_state m_llvm;
     // Dimension of the system.
     std::uint32_t m_dim;
     // Taylor decomposition.
-    std::vector<std::pair<expression, std::vector<std::uint32_t>>> m_dc;
+    // NOTE: the decomposition is immutable, and it is
+    // shared among copies of the integrator (null if dropped).
+    std::shared_ptr<const std::vector<std::pair<expression, std::vector<std::uint32_t>>>> m_dc;
+    // The objects whose addresses are embedded in the compiled
+    // code (e.g., the trajectories of the ephem functions), kept
+    // alive independently of the decomposition.
+    std::vector<std::shared_ptr<const void>> m_keep_alive;
     // Taylor order.
     std::uint32_t m_order;
-    // The stepper.
-    using step_f_t = void (*)(T *, const T *, const T *, T *, T *);
+    // The stepper. The return value is nonzero if the
+    // updated state contains only finite values.
+    using step_f_t = std::uint32_t (*)(T *, const T *, const T *, T *, T *);
     step_f_t m_step_f;
     // The vector of parameters.
     std::vector<T> m_pars;
     // The vector for the Taylor coefficients.
     std::vector<T> m_tc;
+    // The sizes of the last timesteps taken.
+    std::vector<T> m_last_h;
+    // The function for computing the dense output.
+    // NOTE: this is fetched on first use (see get_d_out_f()).
+    using d_out_f_t = void (*)(T *, const T *, const T *);
+    d_out_f_t m_d_out_f;
+    // The vector for the dense output.
+    std::vector<T> m_d_out;
+    // Compact mode flag.
+    bool m_compact_mode;
+    // Flag for the compensated summation of the times.
+    bool m_comp_time = false;
+    // Flag for the step size prediction.
+    // NOTE: with the step size prediction, the second half
+    // of m_delta_ts stores the step sizes predicted from the
+    // Taylor coefficients of the last step.
+    bool m_predict_h = false;
+    // The external buffers for the state and the parameters
+    // (null if not bound, see bind_buffers()).
+    T *m_ext_state = nullptr;
+    T *m_ext_pars = nullptr;
+    // The number of steps remaining before the recompilation
+    // with the profile data (zero if no recompilation is pending).
+    std::size_t m_pgo_steps;
     // Temporary vectors for use
     // in the timestepping functions.
     // These two are used as default values,
@@ -653,13 +2045,40 @@ class HEYOKA_DLL_PUBLIC taylor_adaptive_batch_impl
     std::vector<T> m_min_abs_h, m_max_abs_h;
     std::vector<T> m_cur_max_delta_ts;
     std::vector<T> m_pfor_ts;
+    // Temporary vector used in the dense output implementation.
+    std::vector<T> m_d_out_time;
+    // Temporary vectors used in the propagate_grid() implementation.
+    std::vector<std::size_t> m_grid_idx;
+    std::vector<T> m_grid_lane_t;
+    // The hardware performance counters (empty if the
+    // profiling of the steps is not enabled), the counts
+    // of the profiled steps and the output buffer used
+    // in the measurement of the state update.
+    std::unique_ptr<perf_counter_group> m_perf;
+    std::vector<step_perf_counts> m_perf_counts;
+    std::vector<T> m_perf_buf;
+    // The statistics of the steps (empty if
+    // the collection of the statistics is not enabled).
+    std::optional<taylor_stats> m_stats;
+    // Flag signalling that the compilation was deferred
+    // to taylor_multi_builder::compile() (see finalise_deferred()).
+    bool m_deferred = false;
+
+    friend class taylor_multi_builder<T>;
 
     HEYOKA_DLL_LOCAL const std::vector<std::tuple<taylor_outcome, T>> &step_impl(const std::vector<T> &, bool);
+    HEYOKA_DLL_LOCAL const std::vector<std::tuple<taylor_outcome, T>> &step_impl_core(const std::vector<T> &, bool);
+    HEYOKA_DLL_LOCAL d_out_f_t get_d_out_f();
+    HEYOKA_DLL_LOCAL void pgo_recompile();
+    HEYOKA_DLL_LOCAL void reset_impl(const std::vector<T> &, const std::vector<T> &, const std::vector<T> *);
+    HEYOKA_DLL_LOCAL void finalise_deferred(const llvm_state &, std::string);
 
     // Private implementation-detail constructor machinery.
     template <typename U>
     HEYOKA_DLL_PUBLIC void finalise_ctor_impl(U, std::vector<T>, std::uint32_t, std::vector<T>, T, bool, bool,
-                                              std::vector<T>);
+                                              std::vector<T>, std::vector<std::string>, std::size_t,
+                                              taylor_sort_strategy, bool, std::uint32_t, taylor_jet_layout, T, T,
+                                              std::vector<T>, bool, bool, bool, std::uint32_t, bool);
     template <typename U, typename... KwArgs>
     void finalise_ctor(U sys, std::vector<T> state, std::uint32_t batch_size, KwArgs &&...kw_args)
     {
@@ -670,6 +2089,9 @@ class HEYOKA_DLL_PUBLIC taylor_adaptive_batch_impl
                           "The variadic arguments in the construction of an adaptive batch Taylor integrator contain "
                           "unnamed arguments.");
         } else {
+            static_assert(!p.has(kw::orders),
+                          "The variable-order integration is not supported by the adaptive batch Taylor integrator.");
+
             // Initial times (defaults to a vector of zeroes).
             auto time = [&p, batch_size]() -> std::vector<T> {
                 if constexpr (p.has(kw::time)) {
@@ -679,15 +2101,88 @@ class HEYOKA_DLL_PUBLIC taylor_adaptive_batch_impl
                 }
             }();
 
-            auto [high_accuracy, tol, compact_mode, pars]
+            auto [high_accuracy, tol, compact_mode, pars, isa_variants, pgo_steps, sort_strategy, parallel_mode,
+                  unroll_threshold, jet_layout, rtol, atol, err_weights]
                 = taylor_adaptive_common_ops<T>(std::forward<KwArgs>(kw_args)...);
 
+            // Simplification of the system (defaults to false).
+            if (taylor_simplify_kw(std::forward<KwArgs>(kw_args)...)) {
+                sys = taylor_simplify_sys(std::move(sys));
+            }
+
+            const auto order = taylor_order_kw(std::forward<KwArgs>(kw_args)...);
+
+            if (taylor_compact_mode_auto_kw(std::forward<KwArgs>(kw_args)...)) {
+                compact_mode = taylor_select_compact_mode(m_llvm, sys, tol, rtol, atol,
+                                                          order == 0u ? std::vector<std::uint32_t>{}
+                                                                      : std::vector{order});
+            }
+
+            m_deferred = taylor_deferred_compile_kw(std::forward<KwArgs>(kw_args)...);
+
             finalise_ctor_impl(std::move(sys), std::move(state), batch_size, std::move(time), tol, high_accuracy,
-                               compact_mode, std::move(pars));
+                               compact_mode, std::move(pars), std::move(isa_variants), pgo_steps, sort_strategy,
+                               parallel_mode, unroll_threshold, jet_layout, rtol, atol, std::move(err_weights),
+                               taylor_compensated_time_kw(std::forward<KwArgs>(kw_args)...),
+                               taylor_predict_h_kw(std::forward<KwArgs>(kw_args)...),
+                               taylor_estrin_kw(std::forward<KwArgs>(kw_args)...), order,
+                               taylor_mem_hints_kw(std::forward<KwArgs>(kw_args)...));
+        }
+    }
+    // NOTE: in the construction with the automatic selection of the batch
+    // size, the state and the parameters are provided for a single lane and
+    // they are replicated over the lanes of the batch.
+    template <typename U, typename... KwArgs>
+    void finalise_ctor_auto(U sys, std::vector<T> state, KwArgs &&...kw_args)
+    {
+        igor::parser p{kw_args...};
+
+        if constexpr (p.has_unnamed_arguments()) {
+            static_assert(detail::always_false_v<KwArgs...>,
+                          "The variadic arguments in the construction of an adaptive batch Taylor integrator contain "
+                          "unnamed arguments.");
+        } else {
+            static_assert(!p.has(kw::orders),
+                          "The variable-order integration is not supported by the adaptive batch Taylor integrator.");
+            static_assert(!p.has(kw::time), "The initial times cannot be specified in the construction of an adaptive "
+                                            "batch Taylor integrator with automatic selection of the batch size.");
+
+            const auto batch_size = taylor_tune_batch_size<T>(sys, state, kw_args...).batch_size;
+
+            auto [high_accuracy, tol, compact_mode, pars, isa_variants, pgo_steps, sort_strategy, parallel_mode,
+                  unroll_threshold, jet_layout, rtol, atol, err_weights]
+                = taylor_adaptive_common_ops<T>(std::forward<KwArgs>(kw_args)...);
+
+            // Simplification of the system (defaults to false).
+            if (taylor_simplify_kw(std::forward<KwArgs>(kw_args)...)) {
+                sys = taylor_simplify_sys(std::move(sys));
+            }
+
+            const auto order = taylor_order_kw(std::forward<KwArgs>(kw_args)...);
+
+            if (taylor_compact_mode_auto_kw(std::forward<KwArgs>(kw_args)...)) {
+                compact_mode = taylor_select_compact_mode(m_llvm, sys, tol, rtol, atol,
+                                                          order == 0u ? std::vector<std::uint32_t>{}
+                                                                      : std::vector{order});
+            }
+
+            m_deferred = taylor_deferred_compile_kw(std::forward<KwArgs>(kw_args)...);
+
+            finalise_ctor_impl(std::move(sys), taylor_replicate_lanes(state, batch_size), batch_size,
+                               std::vector<T>(static_cast<typename std::vector<T>::size_type>(batch_size), T(0)), tol,
+                               high_accuracy, compact_mode, taylor_replicate_lanes(pars, batch_size),
+                               std::move(isa_variants), pgo_steps, sort_strategy, parallel_mode, unroll_threshold,
+                               jet_layout, rtol, atol, std::move(err_weights),
+                               taylor_compensated_time_kw(std::forward<KwArgs>(kw_args)...),
+                               taylor_predict_h_kw(std::forward<KwArgs>(kw_args)...),
+                               taylor_estrin_kw(std::forward<KwArgs>(kw_args)...), order,
+                               taylor_mem_hints_kw(std::forward<KwArgs>(kw_args)...));
         }
     }
 
 public:
+    taylor_adaptive_batch_impl();
+
     template <typename... KwArgs>
     explicit taylor_adaptive_batch_impl(std::vector<expression> sys, std::vector<T> state, std::uint32_t batch_size,
                                         KwArgs &&...kw_args)
@@ -702,6 +2197,28 @@ public:
     {
         finalise_ctor(std::move(sys), std::move(state), batch_size, std::forward<KwArgs>(kw_args)...);
     }
+    // NOTE: see the scalar counterpart.
+    template <typename... KwArgs>
+    explicit taylor_adaptive_batch_impl(taylor_dc_t dc, std::vector<T> state, std::uint32_t batch_size,
+                                        KwArgs &&...kw_args)
+        : m_llvm{std::forward<KwArgs>(kw_args)...}
+    {
+        finalise_ctor(std::move(dc), std::move(state), batch_size, std::forward<KwArgs>(kw_args)...);
+    }
+    template <typename... KwArgs>
+    explicit taylor_adaptive_batch_impl(std::vector<expression> sys, std::vector<T> state, batch_size_auto_t,
+                                        KwArgs &&...kw_args)
+        : m_llvm{std::forward<KwArgs>(kw_args)...}
+    {
+        finalise_ctor_auto(std::move(sys), std::move(state), std::forward<KwArgs>(kw_args)...);
+    }
+    template <typename... KwArgs>
+    explicit taylor_adaptive_batch_impl(std::vector<std::pair<expression, expression>> sys, std::vector<T> state,
+                                        batch_size_auto_t, KwArgs &&...kw_args)
+        : m_llvm{std::forward<KwArgs>(kw_args)...}
+    {
+        finalise_ctor_auto(std::move(sys), std::move(state), std::forward<KwArgs>(kw_args)...);
+    }
 
     taylor_adaptive_batch_impl(const taylor_adaptive_batch_impl &);
     taylor_adaptive_batch_impl(taylor_adaptive_batch_impl &&) noexcept;
@@ -719,6 +2236,9 @@ public:
     std::uint32_t get_order() const;
     std::uint32_t get_dim() const;
 
+    // NOTE: with the compensated summation of the times, modifying
+    // the times via get_time_data() does not reset their low-order
+    // parts (which can be reset via set_time()).
     const std::vector<T> &get_time() const
     {
         return m_time;
@@ -731,33 +2251,59 @@ public:
     {
         return m_time.data();
     }
+    void set_time(const std::vector<T> &);
+    std::pair<const std::vector<T> &, const std::vector<T> &> get_dtime() const
+    {
+        return {m_time, m_time_lo};
+    }
+    void set_dtime(const std::vector<T> &, const std::vector<T> &);
 
-    const std::vector<T> &get_state() const
+    // Re-initialise the integrator with new states, times and (optionally)
+    // parameters (see the scalar counterpart).
+    void reset(const std::vector<T> &, const std::vector<T> &);
+    void reset(const std::vector<T> &, const std::vector<T> &, const std::vector<T> &);
+    bool get_compensated_time() const
+    {
+        return m_comp_time;
+    }
+    bool get_predict_h() const
     {
-        return m_state;
+        return m_predict_h;
     }
+
+    // NOTE: if external buffers are bound via bind_buffers(), the
+    // state/parameters can be accessed only via the data pointers:
+    // get_state()/get_pars() throw for the bound buffers.
+    const std::vector<T> &get_state() const;
     const T *get_state_data() const
     {
-        return m_state.data();
+        return m_ext_state == nullptr ? m_state.data() : m_ext_state;
     }
     T *get_state_data()
     {
-        return m_state.data();
+        return m_ext_state == nullptr ? m_state.data() : m_ext_state;
     }
 
-    const std::vector<T> &get_pars() const
-    {
-        return m_pars;
-    }
+    const std::vector<T> &get_pars() const;
     const T *get_pars_data() const
     {
-        return m_pars.data();
+        return m_ext_pars == nullptr ? m_pars.data() : m_ext_pars;
     }
     T *get_pars_data()
     {
-        return m_pars.data();
+        return m_ext_pars == nullptr ? m_pars.data() : m_ext_pars;
+    }
+    typename std::vector<T>::size_type get_pars_size() const
+    {
+        return m_pars.size();
     }
 
+    // Bind external buffers for the state and the parameters (a null
+    // pointer keeps the internal buffer), on which the integrator then
+    // operates in place.
+    void bind_buffers(T *, T *);
+    void unbind_buffers();
+
     const std::vector<T> &get_tc() const
     {
         return m_tc;
@@ -771,14 +2317,77 @@ public:
         return m_tc.data();
     }
 
+    const std::vector<T> &get_last_h() const
+    {
+        return m_last_h;
+    }
+
+    const std::vector<T> &get_d_output() const
+    {
+        return m_d_out;
+    }
+    const std::vector<T> &update_d_output(const std::vector<T> &);
+
+    // Binary serialisation.
+    void save(std::ostream &) const;
+    void load(std::istream &);
+
+    // Profiling of the steps via the hardware performance
+    // counters (see the scalar integrator).
+    void enable_perf_counters(std::uint64_t = 0);
+    void disable_perf_counters();
+    bool perf_counters_enabled() const;
+    const std::vector<step_perf_counts> &get_perf_counts() const;
+    void reset_perf_counts();
+
+    // Collection of the statistics of the
+    // steps (see the scalar integrator).
+    void enable_stats();
+    void disable_stats();
+    bool stats_enabled() const;
+    const taylor_stats &get_stats() const;
+    void reset_stats();
+
+    // Memory footprint (see the scalar integrator).
+    taylor_memory_usage memory_usage() const;
+    void drop_decomposition();
+    void drop_ir_snapshot();
+
     const std::vector<std::tuple<taylor_outcome, T>> &step(bool = false);
     const std::vector<std::tuple<taylor_outcome, T>> &step_backward(bool = false);
     const std::vector<std::tuple<taylor_outcome, T>> &step(const std::vector<T> &, bool = false);
 
-    const std::vector<std::tuple<taylor_outcome, T, T, std::size_t>> &propagate_for(const std::vector<T> &,
-                                                                                    std::size_t = 0);
-    const std::vector<std::tuple<taylor_outcome, T, T, std::size_t>> &propagate_until(const std::vector<T> &,
-                                                                                      std::size_t = 0);
+    // NOTE: the step callback is invoked at the end of each batch step. With the
+    // cb_stop outcome, the batch elements which reached the time limit
+    // in the last step retain the time_limit outcome.
+    const std::vector<std::tuple<taylor_outcome, T, T, std::size_t>> &
+    propagate_for(const std::vector<T> &, std::size_t = 0, step_callback = {});
+    const std::vector<std::tuple<taylor_outcome, T, T, std::size_t>> &
+    propagate_until(const std::vector<T> &, std::size_t = 0, step_callback = {});
+    template <typename F, std::enable_if_t<is_step_callable_v<F, taylor_adaptive_batch_impl>, int> = 0>
+    const std::vector<std::tuple<taylor_outcome, T, T, std::size_t>> &
+    propagate_for(const std::vector<T> &delta_ts, std::size_t max_steps, F &&cb)
+    {
+        return propagate_with_callable(*this, cb, [&](step_callback scb) -> decltype(auto) {
+            return propagate_for(delta_ts, max_steps, scb);
+        });
+    }
+    template <typename F, std::enable_if_t<is_step_callable_v<F, taylor_adaptive_batch_impl>, int> = 0>
+    const std::vector<std::tuple<taylor_outcome, T, T, std::size_t>> &
+    propagate_until(const std::vector<T> &ts, std::size_t max_steps, F &&cb)
+    {
+        return propagate_with_callable(*this, cb, [&](step_callback scb) -> decltype(auto) {
+            return propagate_until(ts, max_steps, scb);
+        });
+    }
+    // NOTE: the outcomes of the propagation for each
+    // batch element are available via get_propagate_res().
+    std::vector<T> propagate_grid(const std::vector<T> &, std::size_t = 0);
+
+    const std::vector<std::tuple<taylor_outcome, T, T, std::size_t>> &get_propagate_res() const
+    {
+        return m_prop_res;
+    }
 };
 
 } // namespace detail
@@ -840,6 +2449,191 @@ struct taylor_adaptive_batch_t_impl<mppp::real128> {
 template <typename T>
 using taylor_adaptive_batch = typename detail::taylor_adaptive_batch_t_impl<T>::type;
 
+// Measure the step throughput of the ODE system sys for several batch sizes,
+// and recommend the batch size with the highest throughput. The batch sizes
+// tried are the powers of two up to kw::max_batch_size (defaults to twice
+// the recommended SIMD batch size for T), plus kw::max_batch_size itself.
+// The state (and, optionally, the parameters) are provided for a single
+// lane, the other keyword arguments are passed to the constructor of the
+// integrators. The throughput is measured over kw::tuning_steps steps
+// (defaults to 100) from the initial state.
+template <typename T, typename U, typename... KwArgs>
+inline taylor_batch_tuning taylor_tune_batch_size(const U &sys, const std::vector<T> &state,
+                                                  const KwArgs &...kw_args)
+{
+    igor::parser p{kw_args...};
+
+    if constexpr (p.has_unnamed_arguments()) {
+        static_assert(detail::always_false_v<KwArgs...>,
+                      "The variadic arguments in the selection of the batch size contain unnamed arguments.");
+    } else {
+        static_assert(!p.has(kw::time), "The initial times cannot be specified in the selection of the batch size.");
+
+        const auto max_batch_size = [&p]() -> std::uint32_t {
+            if constexpr (p.has(kw::max_batch_size)) {
+                return p(kw::max_batch_size);
+            } else if constexpr (p.has(kw::prefer_vw512)) {
+                return 2u * recommended_batch_size<T>(p(kw::prefer_vw512));
+            } else {
+                return 2u * recommended_batch_size<T>();
+            }
+        }();
+
+        const auto n_steps = [&p]() -> std::size_t {
+            if constexpr (p.has(kw::tuning_steps)) {
+                return p(kw::tuning_steps);
+            } else {
+                return 100;
+            }
+        }();
+
+        taylor_batch_tuning retval;
+
+        for (const auto batch_size : detail::taylor_batch_tuning_candidates(max_batch_size)) {
+            const auto init_state = detail::taylor_replicate_lanes(state, batch_size);
+
+            // NOTE: the keyword arguments are passed as lvalues, as
+            // they are used for the construction of several integrators.
+            taylor_adaptive_batch<T> ta{std::vector(sys), init_state, batch_size, kw_args...};
+
+            if constexpr (p.has(kw::pars)) {
+                const auto pars = detail::taylor_replicate_lanes(std::vector<T>(p(kw::pars)), batch_size);
+                std::copy(pars.begin(), pars.end(), ta.get_pars_data());
+            }
+
+            const auto init_pars = ta.get_pars();
+
+            // One warm-up step.
+            ta.step();
+
+            std::size_t n_success = 0;
+            const auto start = std::chrono::steady_clock::now();
+
+            for (std::size_t i = 0; i < n_steps; ++i) {
+                const auto &res = ta.step();
+
+                if (std::all_of(res.begin(), res.end(),
+                                [](const auto &t) { return std::get<0>(t) == taylor_outcome::success; })) {
+                    ++n_success;
+                } else {
+                    // Restart from the initial conditions if
+                    // the integration failed in any lane.
+                    std::copy(init_state.begin(), init_state.end(), ta.get_state_data());
+                    std::copy(init_pars.begin(), init_pars.end(), ta.get_pars_data());
+                    std::fill(ta.get_time_data(), ta.get_time_data() + batch_size, T(0));
+                }
+            }
+
+            const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            retval.batch_sizes.push_back(batch_size);
+            retval.throughputs.push_back(elapsed > 0 ? static_cast<double>(n_success) * batch_size / elapsed : 0.);
+        }
+
+        retval.batch_size = detail::taylor_batch_tuning_select(retval.batch_sizes, retval.throughputs);
+
+        return retval;
+    }
+}
+
+// Measure the cost of the integration of the ODE system sys for several Taylor orders,
+// and recommend the order minimising the wall-clock time per unit of integration time
+// (i.e., the product of the number of steps per unit of integration time and of the cost per step)
+// at the tolerance of the integrator. The orders tried are kw::tuning_orders (defaults to
+// the orders from o - 8 to o + 8 in steps of 2, where o is the order deduced from the tolerance,
+// see taylor_order_kw()). The other keyword arguments are passed to the constructor of the
+// integrators, and the cost is measured over kw::tuning_steps steps (defaults to 100)
+// from the initial state.
+//
+// NOTE: the measurement covers only the initial part of the trajectory, thus the
+// number of tuning steps should be large enough to sample the typical dynamics.
+template <typename T, typename U, typename... KwArgs>
+inline taylor_order_tuning taylor_tune_order(const U &sys, const std::vector<T> &state, const KwArgs &...kw_args)
+{
+    igor::parser p{kw_args...};
+
+    if constexpr (p.has_unnamed_arguments()) {
+        static_assert(detail::always_false_v<KwArgs...>,
+                      "The variadic arguments in the selection of the order contain unnamed arguments.");
+    } else {
+        static_assert(!p.has(kw::order) && !p.has(kw::orders),
+                      "The order cannot be specified in the selection of the order.");
+
+        const auto candidates = [&]() -> std::vector<std::uint32_t> {
+            if constexpr (p.has(kw::tuning_orders)) {
+                return std::vector<std::uint32_t>(p(kw::tuning_orders));
+            } else {
+                // NOTE: with the mixed error control, the order is
+                // deduced from the smallest nonzero tolerance.
+                const auto ops = detail::taylor_adaptive_common_ops<T>(kw_args...);
+                const auto &rtol = std::get<10>(ops);
+                const auto &atol = std::get<11>(ops);
+                const auto &err_weights = std::get<12>(ops);
+                const auto tol = (rtol != 0 || atol != 0 || !err_weights.empty())
+                                     ? (rtol == 0 ? atol : std::min(atol, rtol))
+                                     : std::get<1>(ops);
+
+                return detail::taylor_order_tuning_candidates(static_cast<double>(tol));
+            }
+        }();
+
+        const auto n_steps = [&p]() -> std::size_t {
+            if constexpr (p.has(kw::tuning_steps)) {
+                return p(kw::tuning_steps);
+            } else {
+                return 100;
+            }
+        }();
+
+        taylor_order_tuning retval;
+
+        for (const auto order : candidates) {
+            // NOTE: the keyword arguments are passed as lvalues, as
+            // they are used for the construction of several integrators.
+            taylor_adaptive<T> ta{std::vector(sys), state, kw_args..., kw::order = order};
+
+            const auto init_time = ta.get_time();
+            const auto init_pars = ta.get_pars();
+
+            // One warm-up step.
+            ta.step();
+            ta.set_time(init_time);
+            std::copy(state.begin(), state.end(), ta.get_state_data());
+
+            std::size_t n_success = 0;
+            double int_time = 0;
+            const auto start = std::chrono::steady_clock::now();
+
+            for (std::size_t i = 0; i < n_steps; ++i) {
+                const auto [oc, h] = ta.step();
+
+                if (oc == taylor_outcome::success) {
+                    ++n_success;
+                    int_time += std::abs(static_cast<double>(h));
+                } else {
+                    // Restart from the initial conditions
+                    // if the integration failed.
+                    std::copy(state.begin(), state.end(), ta.get_state_data());
+                    std::copy(init_pars.begin(), init_pars.end(), ta.get_pars_data());
+                    ta.set_time(init_time);
+                }
+            }
+
+            const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            retval.orders.push_back(order);
+            retval.steps_per_time.push_back(int_time > 0 ? static_cast<double>(n_success) / int_time
+                                                         : std::numeric_limits<double>::infinity());
+            retval.step_costs.push_back(n_success > 0 ? elapsed / static_cast<double>(n_success)
+                                                      : std::numeric_limits<double>::infinity());
+        }
+
+        retval.order = detail::taylor_order_tuning_select(retval);
+
+        return retval;
+    }
+}
+
 namespace detail
 {
 
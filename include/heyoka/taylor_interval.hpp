@@ -0,0 +1,122 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef HEYOKA_TAYLOR_INTERVAL_HPP
+#define HEYOKA_TAYLOR_INTERVAL_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <heyoka/detail/visibility.hpp>
+#include <heyoka/expression.hpp>
+#include <heyoka/interval.hpp>
+#include <heyoka/taylor.hpp>
+
+namespace heyoka
+{
+
+// Validated integrator of autonomous ODE systems in double precision, which propagates
+// boxes of initial conditions via the interval Taylor series method. The state contains the
+// intervals of the state variables for each box, in box-major order (that is, the first
+// dim values are the intervals of the first box, and so on).
+//
+// In each step of size h, an a priori enclosure B of the solution over [0, h] is first validated
+// via the Picard operator (i.e., by checking that X0 + [0, h] * f(B) is contained in B, where X0
+// is the current box). The new box is then the enclosure of the Taylor polynomial of the solution
+// over X0, plus the Lagrange remainder enclosed over B. The Taylor coefficients are computed from the
+// Lie derivatives of the state variables, which are computed symbolically at construction, and all the
+// boxes are evaluated together via eval_batch_interval_dbl().
+//
+// NOTE: the enclosures are rigorous under the same assumptions of the interval evaluator (see
+// interval), and up to the rounding errors in the constants of the symbolic derivatives
+// (which are folded in floating-point arithmetic). Because of the wrapping effect, the widths of the boxes grow with the propagation
+// time faster than the actual spread of the solutions, and the boxes should thus be kept small.
+// The size of the symbolic Lie derivatives grows quickly with the order, which should
+// be kept low (e.g., below 10) for nontrivial systems. Non-autonomous systems
+// (i.e., containing heyoka::time) are not supported.
+class HEYOKA_DLL_PUBLIC taylor_interval
+{
+    std::uint32_t m_dim = 0;
+    std::uint32_t m_order = 0;
+    std::vector<std::string> m_vars;
+    // The time derivatives of orders [1, order] of the state variables,
+    // as functions of the state variables: the derivative of order k
+    // of the i-th state variable is at index (k - 1) * dim + i.
+    std::vector<expression> m_tc;
+    // The enclosures of 1 / k!, k in [1, order].
+    std::vector<interval> m_fact_inv;
+    std::vector<double> m_pars;
+    double m_time = 0;
+    std::vector<interval> m_state;
+    // Buffers for the evaluations.
+    std::unordered_map<std::string, std::vector<interval>> m_map;
+    std::vector<interval> m_b, m_new_b, m_acc, m_out;
+
+    HEYOKA_DLL_LOCAL void load_boxes(const std::vector<interval> &);
+    HEYOKA_DLL_LOCAL bool apriori_enclosure(const interval &);
+
+public:
+    explicit taylor_interval(std::vector<std::pair<expression, expression>>, std::vector<interval>,
+                             std::uint32_t = 8, std::vector<double> = {}, double = 0);
+
+    std::uint32_t get_dim() const
+    {
+        return m_dim;
+    }
+    std::uint32_t get_order() const
+    {
+        return m_order;
+    }
+    std::size_t get_n_boxes() const
+    {
+        return m_state.size() / m_dim;
+    }
+    double get_time() const
+    {
+        return m_time;
+    }
+    void set_time(double t)
+    {
+        m_time = t;
+    }
+    const std::vector<interval> &get_state() const
+    {
+        return m_state;
+    }
+    const std::vector<double> &get_pars() const
+    {
+        return m_pars;
+    }
+    const std::vector<expression> &get_tc() const
+    {
+        return m_tc;
+    }
+
+    // Replace the boxes.
+    void set_state(std::vector<interval>);
+
+    // Take a step of size h (which may be negative). If the enclosure
+    // could not be validated for all the boxes, the state and the time
+    // are left untouched and false is returned.
+    bool step(double);
+    // Propagate up to the time t, with steps of size at most abs(h). The step
+    // size is halved (up to n_halvings times) when a step cannot be validated, and
+    // doubled back after each validated step. The return value contains
+    // time_limit (or err_nf_state, if a step could not be validated with the
+    // smallest step size) and the number of steps taken.
+    std::tuple<taylor_outcome, std::size_t> propagate_until(double, double, std::uint32_t = 20);
+};
+
+} // namespace heyoka
+
+#endif
@@ -0,0 +1,135 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef HEYOKA_TAYLOR_MULTI_HPP
+#define HEYOKA_TAYLOR_MULTI_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include <heyoka/detail/visibility.hpp>
+#include <heyoka/expression.hpp>
+#include <heyoka/llvm_state.hpp>
+#include <heyoka/taylor.hpp>
+
+namespace heyoka
+{
+
+// Builder of a set of adaptive Taylor integrators (for different ODE systems, orders, batch
+// sizes, etc.) whose code is compiled into a single llvm_state, so that the overhead of the
+// optimisation and of the jit compilation is paid once for all the integrators. The integrators
+// are added via add()/add_batch(), which accept the same arguments as the constructors of
+// taylor_adaptive/taylor_adaptive_batch. compile() then links the modules of the integrators into the
+// llvm_state of the builder (with the symbols of the i-th integrator prefixed by "heyoka.multi.<i>."),
+// runs a single optimisation pass and a single compilation, and hands each integrator a copy of
+// the compiled state (which shares the compiled code). Afterwards, the integrators can be
+// fetched via get()/get_batch(), and they can be used (and copied, moved out of the builder
+// or serialised) as the integrators constructed directly.
+//
+// NOTE: the settings of the llvm_state of the builder (e.g., the optimisation level) are used
+// in the optimisation and in the compilation of the shared module, while the settings affecting the
+// code generation (fast math, target CPU and features, 512-bit vectors and accuracy of the SLEEF
+// functions) must be the same in the llvm_state of each integrator (which is constructed from the keyword
+// arguments passed to add()/add_batch()). The compact-mode functions are not shared among the integrators.
+// The ISA variants and the profile-guided optimisation are not supported. In compact mode, the copies
+// of the integrators recompile the whole shared module (see the copy constructor of taylor_adaptive).
+template <typename T>
+class HEYOKA_DLL_PUBLIC taylor_multi_builder
+{
+    llvm_state m_llvm;
+    std::vector<taylor_adaptive<T>> m_tas;
+    std::vector<taylor_adaptive_batch<T>> m_tabs;
+    bool m_compiled = false;
+
+    HEYOKA_DLL_LOCAL void check_uncompiled(const char *) const;
+    HEYOKA_DLL_LOCAL void check_compiled(const char *) const;
+    void check_llvm_state(const llvm_state &) const;
+
+    template <typename U, typename... KwArgs>
+    std::size_t add_impl(U sys, std::vector<T> state, KwArgs &&...kw_args)
+    {
+        check_uncompiled(__func__);
+
+        m_tas.emplace_back(std::move(sys), std::move(state), detail::kw_internal::deferred_compile = true,
+                           std::forward<KwArgs>(kw_args)...);
+
+        try {
+            check_llvm_state(m_tas.back().get_llvm_state());
+        } catch (...) {
+            m_tas.pop_back();
+            throw;
+        }
+
+        return m_tas.size() - 1u;
+    }
+    template <typename U, typename... KwArgs>
+    std::size_t add_batch_impl(U sys, std::vector<T> state, std::uint32_t batch_size, KwArgs &&...kw_args)
+    {
+        check_uncompiled(__func__);
+
+        m_tabs.emplace_back(std::move(sys), std::move(state), batch_size, detail::kw_internal::deferred_compile = true,
+                            std::forward<KwArgs>(kw_args)...);
+
+        try {
+            check_llvm_state(m_tabs.back().get_llvm_state());
+        } catch (...) {
+            m_tabs.pop_back();
+            throw;
+        }
+
+        return m_tabs.size() - 1u;
+    }
+
+public:
+    explicit taylor_multi_builder(llvm_state = llvm_state{});
+
+    // Add an integrator, returning its index.
+    template <typename... KwArgs>
+    std::size_t add(std::vector<expression> sys, std::vector<T> state, KwArgs &&...kw_args)
+    {
+        return add_impl(std::move(sys), std::move(state), std::forward<KwArgs>(kw_args)...);
+    }
+    template <typename... KwArgs>
+    std::size_t add(std::vector<std::pair<expression, expression>> sys, std::vector<T> state, KwArgs &&...kw_args)
+    {
+        return add_impl(std::move(sys), std::move(state), std::forward<KwArgs>(kw_args)...);
+    }
+
+    // Add a batch integrator, returning its index
+    // (among the batch integrators).
+    template <typename... KwArgs>
+    std::size_t add_batch(std::vector<expression> sys, std::vector<T> state, std::uint32_t batch_size,
+                          KwArgs &&...kw_args)
+    {
+        return add_batch_impl(std::move(sys), std::move(state), batch_size, std::forward<KwArgs>(kw_args)...);
+    }
+    template <typename... KwArgs>
+    std::size_t add_batch(std::vector<std::pair<expression, expression>> sys, std::vector<T> state,
+                          std::uint32_t batch_size, KwArgs &&...kw_args)
+    {
+        return add_batch_impl(std::move(sys), std::move(state), batch_size, std::forward<KwArgs>(kw_args)...);
+    }
+
+    std::size_t get_n_integrators() const;
+    std::size_t get_n_batch_integrators() const;
+
+    void compile();
+    bool is_compiled() const;
+
+    const llvm_state &get_llvm_state() const;
+
+    // NOTE: these can be invoked only after compile().
+    taylor_adaptive<T> &get(std::size_t);
+    taylor_adaptive_batch<T> &get_batch(std::size_t);
+};
+
+} // namespace heyoka
+
+#endif
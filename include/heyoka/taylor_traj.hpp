@@ -0,0 +1,199 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef HEYOKA_TAYLOR_TRAJ_HPP
+#define HEYOKA_TAYLOR_TRAJ_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <heyoka/detail/visibility.hpp>
+#include <heyoka/taylor.hpp>
+
+namespace heyoka
+{
+
+namespace detail
+{
+
+template <typename>
+struct taylor_traj_writer_impl;
+
+template <typename>
+struct taylor_traj_reader_impl;
+
+} // namespace detail
+
+// Streaming writer of the Taylor coefficients of the steps of an integrator into a binary file.
+// The file contains a fixed-size header followed by one record per step, each record consisting of
+// the times at the boundaries of the step, followed by the Taylor coefficients of the state
+// variables (in the layout of taylor_checkpoints). The file is grown in chunks of chunk_steps
+// records, and the records are written into memory-mapped chunks of the file, so that
+// no formatting or intermediate buffering is involved.
+//
+// The typical use is to record the checkpoints of an integrator (see enable_checkpoints()), and
+// after each propagation to append() them to the writer and reset them, so that the memory usage
+// stays bounded. In ensembles, each worker integrator can stream into its own writer.
+//
+// The steps must be contiguous and in the same direction in time. The file is truncated
+// to its actual size by close() (which is invoked by the destructor).
+template <typename T>
+class HEYOKA_DLL_PUBLIC taylor_traj_writer
+{
+    std::unique_ptr<detail::taylor_traj_writer_impl<T>> m_impl;
+
+    HEYOKA_DLL_LOCAL detail::taylor_traj_writer_impl<T> &get_impl() const;
+
+public:
+    explicit taylor_traj_writer(const std::string &, std::uint32_t, std::uint32_t, std::size_t = 1024);
+    taylor_traj_writer(taylor_traj_writer &&) noexcept;
+    taylor_traj_writer &operator=(taylor_traj_writer &&) noexcept;
+    ~taylor_traj_writer();
+
+    std::uint32_t get_dim() const;
+    std::uint32_t get_order() const;
+    std::size_t get_n_steps() const;
+
+    // Write a step from the first to the second time,
+    // with the given Taylor coefficients.
+    void add_step(T, T, const T *);
+    // Write all the steps recorded in a store of checkpoints.
+    void append(const taylor_checkpoints<T> &);
+
+    // Flush the written steps to the file.
+    void flush();
+    // Flush and close the file. Any further
+    // write into the writer will throw.
+    void close();
+};
+
+// Reader of the files produced by taylor_traj_writer. The file is memory-mapped, and
+// the state at any time within the recorded steps is reconstructed via binary search
+// over the step boundaries (that is, in O(log(n_steps))) and Horner evaluation.
+template <typename T>
+class HEYOKA_DLL_PUBLIC taylor_traj_reader
+{
+    std::unique_ptr<detail::taylor_traj_reader_impl<T>> m_impl;
+
+public:
+    explicit taylor_traj_reader(const std::string &);
+    taylor_traj_reader(taylor_traj_reader &&) noexcept;
+    taylor_traj_reader &operator=(taylor_traj_reader &&) noexcept;
+    ~taylor_traj_reader();
+
+    std::uint32_t get_dim() const;
+    std::uint32_t get_order() const;
+    std::size_t get_n_steps() const;
+    // NOTE: an exception is thrown
+    // if no step was recorded.
+    std::pair<T, T> get_bounds() const;
+
+    // Evaluate the state at the given time, which
+    // must be within the bounds of the recorded steps.
+    const std::vector<T> &operator()(T);
+};
+
+// Compact store of the steps of an integrator, in which the Taylor polynomial of each state
+// variable in each step is re-fitted in the Chebyshev basis over the time range of the step,
+// and the Chebyshev series is truncated after the smallest number of terms for which the sum of the
+// absolute values of the dropped coefficients does not exceed the tolerance. Because the Chebyshev
+// polynomials are bounded by 1 in absolute value, the reconstructed state differs from the state
+// computed via the Taylor polynomials by at most the tolerance (plus roundoff) within each step.
+//
+// The number of stored coefficients for each state variable depends on its smoothness
+// and on the tolerance (which, for the typical precision requirements of ephemerides, is usually
+// several orders of magnitude larger than the tolerance of the integrator), and it is often
+// a small fraction of the order + 1 coefficients of the Taylor polynomials.
+template <typename T>
+class HEYOKA_DLL_PUBLIC taylor_cheb_traj
+{
+    std::uint32_t m_dim = 0;
+    std::uint32_t m_order = 0;
+    T m_tol = 0;
+    // The times at the boundaries of the steps (n_steps + 1 values,
+    // or none if no step was recorded).
+    std::vector<T> m_times;
+    // The number of Chebyshev coefficients of each state variable in each
+    // step (n_steps * dim values), and the offsets in m_coeffs of the
+    // coefficients of each step (n_steps + 1 values, or none).
+    std::vector<std::uint32_t> m_n_coeffs;
+    std::vector<std::size_t> m_offsets;
+    // The Chebyshev coefficients.
+    std::vector<T> m_coeffs;
+    // The cosines at the Chebyshev nodes used in the re-fitting,
+    // a buffer for the re-fitting and the output of operator().
+    std::vector<T> m_cos, m_buf, m_out;
+
+    HEYOKA_DLL_LOCAL void init_cos();
+
+public:
+    taylor_cheb_traj();
+    explicit taylor_cheb_traj(std::uint32_t, std::uint32_t, T);
+    explicit taylor_cheb_traj(const taylor_checkpoints<T> &, T);
+
+    std::uint32_t get_dim() const
+    {
+        return m_dim;
+    }
+    std::uint32_t get_order() const
+    {
+        return m_order;
+    }
+    T get_tol() const
+    {
+        return m_tol;
+    }
+    std::size_t get_n_steps() const
+    {
+        return m_times.empty() ? 0 : m_times.size() - 1u;
+    }
+    const std::vector<T> &get_times() const
+    {
+        return m_times;
+    }
+    const std::vector<std::uint32_t> &get_n_coeffs() const
+    {
+        return m_n_coeffs;
+    }
+    const std::vector<std::size_t> &get_offsets() const
+    {
+        return m_offsets;
+    }
+    const std::vector<T> &get_coeffs() const
+    {
+        return m_coeffs;
+    }
+    // NOTE: an exception is thrown
+    // if no step was recorded.
+    std::pair<T, T> get_bounds() const;
+
+    // Compress and record a step from the first to the second time,
+    // with the given Taylor coefficients (in the layout of taylor_checkpoints).
+    void add_step(T, T, const T *);
+    // Compress and record all the steps recorded in a store of checkpoints.
+    void append(const taylor_checkpoints<T> &);
+    void clear();
+    void shrink_to_fit();
+
+    // Evaluate the state at the given time, which
+    // must be within the bounds of the recorded steps.
+    const std::vector<T> &operator()(T);
+
+    void save(std::ostream &) const;
+    void load(std::istream &);
+};
+
+} // namespace heyoka
+
+#endif
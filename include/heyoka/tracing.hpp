@@ -0,0 +1,133 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef HEYOKA_TRACING_HPP
+#define HEYOKA_TRACING_HPP
+
+#include <heyoka/config.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+#include <heyoka/detail/visibility.hpp>
+
+namespace heyoka
+{
+
+// Tracing of the operations of the integrators and of the LLVM machinery.
+//
+// When heyoka is built with the HEYOKA_WITH_TRACING option, the beginning and
+// the end of the steps, of the propagate functions, of the event detection and of the
+// optimisation/compilation of the llvm_state objects are reported to the trace sink
+// set via set_trace_sink() (if any). Otherwise, the tracing points compile to nothing
+// and the sink is never invoked.
+//
+// NOTE: the sink is invoked from the threads running the traced
+// operations (possibly concurrently), thus it must be thread-safe.
+
+enum class trace_phase { begin, end };
+
+struct trace_event {
+    // The name of the traced operation (e.g., "step", "propagate_until", "compile").
+    const char *name;
+    trace_phase phase;
+    // The time of the event, in nanoseconds since
+    // an arbitrary epoch (from a steady clock).
+    std::int64_t timestamp;
+    // The identifier of the calling thread.
+    std::uint64_t thread_id;
+    // The address of the object performing the operation
+    // (e.g., the integrator), which allows to tell apart
+    // the operations of different objects.
+    const void *object;
+};
+
+using trace_sink = std::function<void(const trace_event &)>;
+
+// Check if the tracing points were compiled in.
+HEYOKA_DLL_PUBLIC bool tracing_available();
+
+// Set (or, if empty, remove) the global trace sink.
+HEYOKA_DLL_PUBLIC void set_trace_sink(trace_sink);
+
+// Sink collecting the events in the Chrome trace event format (which can
+// be loaded with chrome://tracing or Perfetto). The copies of a chrome_trace_sink
+// share the collected events, so that a copy can be passed to set_trace_sink().
+class HEYOKA_DLL_PUBLIC chrome_trace_sink
+{
+    struct impl;
+
+    std::shared_ptr<impl> m_impl;
+
+public:
+    chrome_trace_sink();
+
+    void operator()(const trace_event &) const;
+
+    std::size_t size() const;
+    void clear() const;
+
+    std::string to_json() const;
+    void write(const std::string &) const;
+};
+
+namespace detail
+{
+
+HEYOKA_DLL_PUBLIC bool trace_active();
+HEYOKA_DLL_PUBLIC void trace_emit(const char *, trace_phase, const void *);
+
+// RAII helper emitting the begin/end events of a traced scope.
+class trace_scope
+{
+    const char *m_name;
+    const void *m_object;
+    bool m_active;
+
+public:
+    explicit trace_scope(const char *name, const void *object)
+        : m_name(name), m_object(object), m_active(trace_active())
+    {
+        if (m_active) {
+            trace_emit(m_name, trace_phase::begin, m_object);
+        }
+    }
+    trace_scope(const trace_scope &) = delete;
+    trace_scope &operator=(const trace_scope &) = delete;
+    ~trace_scope()
+    {
+        if (m_active) {
+            trace_emit(m_name, trace_phase::end, m_object);
+        }
+    }
+};
+
+} // namespace detail
+
+} // namespace heyoka
+
+#define HEYOKA_TRACE_CONCAT_IMPL(a, b) a##b
+#define HEYOKA_TRACE_CONCAT(a, b) HEYOKA_TRACE_CONCAT_IMPL(a, b)
+
+// Trace the current scope as the operation name
+// performed by the object obj.
+#if defined(HEYOKA_WITH_TRACING)
+
+#define HEYOKA_TRACE_SCOPE(name, obj)                                                                                  \
+    const ::heyoka::detail::trace_scope HEYOKA_TRACE_CONCAT(heyoka_trace_scope_, __LINE__)(name, obj)
+
+#else
+
+#define HEYOKA_TRACE_SCOPE(name, obj) ((void)0)
+
+#endif
+
+#endif
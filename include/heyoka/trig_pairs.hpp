@@ -0,0 +1,69 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef HEYOKA_TRIG_PAIRS_HPP
+#define HEYOKA_TRIG_PAIRS_HPP
+
+#include <cmath>
+#include <utility>
+#include <vector>
+
+#include <heyoka/detail/visibility.hpp>
+#include <heyoka/expression.hpp>
+
+namespace heyoka
+{
+
+namespace detail
+{
+
+HEYOKA_DLL_PUBLIC std::vector<std::vector<std::pair<expression, expression>>::size_type>
+trig_pairs_indices(const std::vector<std::pair<expression, expression>> &, const std::vector<expression> &);
+
+} // namespace detail
+
+// Transform the ODE system sys so that the sines and cosines of the (angular) state
+// variables in angles are maintained as state variables, rather than being computed
+// via transcendental function calls.
+//
+// For each angle v with equation v' = f, the returned system replaces sin(v) and cos(v)
+// in the right-hand sides with the new state variables sin_v and cos_v, whose equations
+//
+// sin_v' = cos_v * f,
+// cos_v' = -sin_v * f
+//
+// are appended, in the order of the angles, to the (transformed) original equations.
+HEYOKA_DLL_PUBLIC std::vector<std::pair<expression, expression>>
+make_trig_pairs(const std::vector<std::pair<expression, expression>> &, const std::vector<expression> &);
+
+// Helper to build the initial state for the system returned by make_trig_pairs(),
+// from the initial state of the original system sys.
+template <typename T>
+inline std::vector<T> make_trig_pairs_state(const std::vector<std::pair<expression, expression>> &sys,
+                                            std::vector<T> state, const std::vector<expression> &angles)
+{
+    using std::cos;
+    using std::sin;
+
+    const auto idxs = detail::trig_pairs_indices(sys, angles);
+
+    state.reserve(state.size() + 2u * idxs.size());
+
+    for (auto idx : idxs) {
+        const auto v = state.at(idx);
+
+        state.push_back(sin(v));
+        state.push_back(cos(v));
+    }
+
+    return state;
+}
+
+} // namespace heyoka
+
+#endif
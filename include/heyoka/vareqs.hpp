@@ -0,0 +1,158 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef HEYOKA_VAREQS_HPP
+#define HEYOKA_VAREQS_HPP
+
+#include <heyoka/config.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include <heyoka/detail/visibility.hpp>
+#include <heyoka/expression.hpp>
+#include <heyoka/taylor.hpp>
+
+namespace heyoka
+{
+
+// Augment the ODE system sys with its first-order variational equations, that is,
+// the equations for the sensitivities of the state with respect to the initial
+// conditions (the state transition matrix) and, if n_pars > 0, with respect to
+// the parameters par[0], ..., par[n_pars - 1].
+//
+// If the state variables of sys are x_0, ..., x_{n-1}, the returned system contains,
+// in the following order:
+//
+// - the original equations,
+// - the equations for the n x n variables dx_i/dx_j_0 (row-major),
+// - the equations for the n x n_pars variables dx_i/dpar[k] (row-major).
+//
+// The derivatives of the right-hand sides are shared among the variational
+// equations, so that the Taylor decomposition of the augmented system can
+// reuse them via common subexpression elimination.
+HEYOKA_DLL_PUBLIC std::vector<std::pair<expression, expression>>
+make_vareqs(const std::vector<std::pair<expression, expression>> &, std::uint32_t = 0);
+
+// Helper to build the initial state for the system returned by make_vareqs(): the
+// state transition matrix is initialised to the identity, the sensitivities
+// with respect to the parameters to zero.
+template <typename T>
+inline std::vector<T> make_vareqs_state(std::vector<T> state, std::uint32_t n_pars = 0)
+{
+    const auto n = state.size();
+
+    if (n > std::numeric_limits<decltype(n)>::max() / (n + n_pars + 1u)) {
+        throw std::overflow_error("Overflow detected in the construction of the initial state of a system of "
+                                  "variational equations");
+    }
+
+    state.reserve(n * (n + n_pars + 1u));
+
+    for (decltype(state.size()) i = 0; i < n; ++i) {
+        for (decltype(state.size()) j = 0; j < n; ++j) {
+            state.push_back(i == j ? T(1) : T(0));
+        }
+    }
+
+    state.resize(n * (n + n_pars + 1u), T(0));
+
+    return state;
+}
+
+// High-order variational equations: augment the ODE system sys with the equations for
+// all the partial derivatives of the state with respect to the initial conditions, up to the
+// given order. The state of the returned system thus contains the coefficients
+// of the Taylor expansion of the flow with respect to the deviations of the initial conditions,
+// and a single propagation yields the truncated polynomial map from the initial deviations
+// to the final state (which can be evaluated via eval_vareqs_ho()).
+//
+// The derivatives are ordered according to the multi-indices returned by
+// vareqs_ho_indices() (the first one, i.e., the zero multi-index, corresponding to the original
+// equations), and for each multi-index the returned system contains the equations for the derivatives
+// of all the state variables. The variable for the derivative of x with respect to x_0^2 y_0
+// (where x_0, y_0 are the initial conditions of x and y) is named "dx/dx_0^2dy_0".
+//
+// NOTE: the number of equations is n * binomial(n + order, order), and
+// compact mode is recommended for all but the smallest systems.
+HEYOKA_DLL_PUBLIC std::vector<std::pair<expression, expression>>
+make_vareqs_ho(const std::vector<std::pair<expression, expression>> &, std::uint32_t);
+
+// The multi-indices of the derivatives in the system returned by make_vareqs_ho(), for a system
+// of n equations: the multi-indices are sorted first by degree and then in lexicographically
+// descending order (e.g., (0, 0), (1, 0), (0, 1), (2, 0), (1, 1), (0, 2) for n = 2 and order 2).
+HEYOKA_DLL_PUBLIC std::vector<std::vector<std::uint32_t>> vareqs_ho_indices(std::uint32_t, std::uint32_t);
+
+// Helper to build the initial state for the system returned by make_vareqs_ho(): the
+// first-order derivatives are initialised to the identity, the higher-order ones to zero.
+template <typename T>
+inline std::vector<T> make_vareqs_ho_state(std::vector<T> state, std::uint32_t order)
+{
+    const auto n = state.size();
+
+    if (n > std::numeric_limits<std::uint32_t>::max()) {
+        throw std::overflow_error("Overflow detected in the construction of the initial state of a system of "
+                                  "high-order variational equations");
+    }
+
+    const auto n_idx = vareqs_ho_indices(static_cast<std::uint32_t>(n), order).size();
+
+    if (n_idx > std::numeric_limits<decltype(state.size())>::max() / (n == 0u ? 1u : n)) {
+        throw std::overflow_error("Overflow detected in the construction of the initial state of a system of "
+                                  "high-order variational equations");
+    }
+
+    state.resize(n * n_idx, T(0));
+
+    if (order > 0u) {
+        // NOTE: the first-order derivatives
+        // immediately follow the original state.
+        for (decltype(state.size()) i = 0; i < n; ++i) {
+            state[n + i * n + i] = T(1);
+        }
+    }
+
+    return state;
+}
+
+// Evaluate the polynomial map stored in the state of a system returned by
+// make_vareqs_ho() (for a system of n equations) at the deviations dx of the initial
+// conditions. The return value contains the values of the n state variables.
+template <typename T>
+HEYOKA_DLL_PUBLIC std::vector<T> eval_vareqs_ho(const T *, std::uint32_t, std::uint32_t, const std::vector<T> &);
+
+// Gradient of a loss with respect to the parameters, for the training of ODE systems
+// (e.g., neural ODEs built via dense_layer()). ta must be a batch integrator for the
+// system returned by make_vareqs(sys, n_pars), states contains the initial states
+// of the n_traj trajectories of sys (one after the other), and each trajectory is propagated
+// from the current time of ta up to the time t, in the batch slots of ta.
+//
+// After the propagation of a trajectory, the loss function is invoked with the final state
+// of the trajectory, an output buffer (of the size of the state, initialised to zero) for the
+// gradient of the loss with respect to the final state and the index of the trajectory. The loss
+// function returns the value of the loss for the trajectory, and the chain rule is then applied
+// via the sensitivities with respect to the parameters.
+//
+// The return value contains the total loss and its gradient with respect to par[0], ..., par[n_pars - 1],
+// summed over the trajectories. The compiled code of ta is reused for all the trajectories, and
+// on exit ta contains the propagated state of the last group of trajectories. The values of the
+// parameters are those stored in ta, and they are normally the same in all the batch slots.
+// max_steps is forwarded to propagate_until().
+template <typename T>
+HEYOKA_DLL_PUBLIC std::pair<T, std::vector<T>>
+vareqs_loss_grad_batch(taylor_adaptive_batch<T> &, std::uint32_t, const std::vector<T> &, T,
+                       const std::function<T(const T *, T *, std::size_t)> &, std::size_t = 0);
+
+} // namespace heyoka
+
+#endif
@@ -10,6 +10,7 @@
 #define HEYOKA_VARIABLE_HPP
 
 #include <cstddef>
+#include <cstdint>
 #include <ostream>
 #include <string>
 #include <unordered_map>
@@ -22,9 +23,40 @@
 namespace heyoka
 {
 
+namespace detail
+{
+
+// Construct the u variable with index i (i.e., the variable
+// named "u_i") of a Taylor decomposition. After the first construction,
+// the name is neither formatted nor hashed.
+HEYOKA_DLL_PUBLIC variable make_u_var(std::uint32_t);
+
+// The index of a u variable (e.g., 123 for "u_123").
+// NOTE: the index is cached in the variable for the canonical
+// names of the u variables (i.e., without leading zeroes), which
+// include all the names generated in the Taylor decompositions.
+HEYOKA_DLL_PUBLIC std::uint32_t uname_to_index(const variable &);
+
+} // namespace detail
+
+// NOTE: the names of the variables are interned in a global table,
+// and each variable stores a pointer to the interned name and a compact
+// integer id (unique for each name). This makes copies and comparisons cheap,
+// and allows to index the values of the variables by id
+// during the evaluation of expressions (see eval_dbl_by_id()).
+// The interned names are never freed.
 class HEYOKA_DLL_PUBLIC variable
 {
-    std::string m_name;
+    const std::string *m_name;
+    std::uint32_t m_id;
+    // The index of the u variable, or the max
+    // value if this is not a u variable.
+    std::uint32_t m_u_idx;
+
+    explicit variable(const std::string *, std::uint32_t, std::uint32_t);
+
+    friend HEYOKA_DLL_PUBLIC variable detail::make_u_var(std::uint32_t);
+    friend HEYOKA_DLL_PUBLIC std::uint32_t detail::uname_to_index(const variable &);
 
 public:
     explicit variable(std::string);
@@ -35,8 +67,8 @@ public:
     variable &operator=(const variable &);
     variable &operator=(variable &&) noexcept;
 
-    std::string &name();
     const std::string &name() const;
+    std::uint32_t id() const;
 };
 
 HEYOKA_DLL_PUBLIC void swap(variable &, variable &) noexcept;
@@ -25,6 +25,8 @@
 #include <variant>
 #include <vector>
 
+#include <boost/numeric/conversion/cast.hpp>
+
 #include <fmt/format.h>
 
 #include <llvm/IR/BasicBlock.h>
@@ -41,11 +43,14 @@
 #endif
 
 #include <heyoka/binary_operator.hpp>
+#include <heyoka/detail/eval_scratch.hpp>
 #include <heyoka/detail/llvm_fwd.hpp>
 #include <heyoka/detail/llvm_helpers.hpp>
+#include <heyoka/detail/node_meta.hpp>
 #include <heyoka/detail/string_conv.hpp>
 #include <heyoka/detail/type_traits.hpp>
 #include <heyoka/expression.hpp>
+#include <heyoka/expression_arena.hpp>
 #include <heyoka/llvm_state.hpp>
 #include <heyoka/number.hpp>
 #include <heyoka/taylor.hpp>
@@ -54,22 +59,76 @@
 namespace heyoka
 {
 
+namespace detail
+{
+
+struct bo_node {
+    std::array<expression, 2> ops;
+    node_meta meta;
+};
+
+} // namespace detail
+
 binary_operator::binary_operator(type t, expression e1, expression e2)
     : m_type(t),
-      // NOTE: need to use naked new as make_unique won't work with aggregate
-      // initialization.
-      m_ops(new std::array<expression, 2>{std::move(e1), std::move(e2)})
+      // NOTE: aggregate initialization is not available via make_shared(),
+      // thus we default-construct the operands and assign them afterwards.
+      m_ops(detail::make_shared_node<detail::bo_node>())
 {
+    m_ops->ops[0] = std::move(e1);
+    m_ops->ops[1] = std::move(e2);
 }
 
-binary_operator::binary_operator(const binary_operator &other)
-    : m_type(other.m_type), m_ops(std::make_unique<std::array<expression, 2>>(*other.m_ops))
+// NOTE: the copy shares the operands with other.
+binary_operator::binary_operator(const binary_operator &other) : m_type(other.m_type), m_ops(other.m_ops)
 {
+    assert(m_ops);
 }
 
 binary_operator::binary_operator(binary_operator &&) noexcept = default;
 
-binary_operator::~binary_operator() = default;
+// NOTE: the destruction of a long chain of binary operators (e.g., an unbalanced
+// sum) would recurse as deeply as the chain. Here the operands whose ownership
+// is about to be released are detached and destroyed iteratively instead.
+binary_operator::~binary_operator()
+{
+    auto is_unique = [](const std::shared_ptr<detail::bo_node> &ops) {
+        return ops && ops.use_count() == 1;
+    };
+
+    // Fast path: the operands are not released, or they do
+    // not contain binary operators whose operands are released.
+    if (!is_unique(m_ops) || std::none_of(m_ops->ops.begin(), m_ops->ops.end(), [&is_unique](const expression &op) {
+            auto bo_ptr = std::get_if<binary_operator>(&op.value());
+            return bo_ptr != nullptr && is_unique(bo_ptr->m_ops);
+        })) {
+        return;
+    }
+
+    std::vector<std::shared_ptr<detail::bo_node>> stack;
+
+    auto detach = [&stack, &is_unique](std::shared_ptr<detail::bo_node> &ops) {
+        if (is_unique(ops)) {
+            stack.push_back(std::move(ops));
+        }
+    };
+
+    detach(m_ops);
+
+    while (!stack.empty()) {
+        auto cur = std::move(stack.back());
+        stack.pop_back();
+
+        for (auto &op : cur->ops) {
+            if (auto bo_ptr = std::get_if<binary_operator>(&op.value())) {
+                detach(bo_ptr->m_ops);
+            }
+        }
+
+        // NOTE: cur is destroyed here, and the destructors of its
+        // operands do not recurse, as their operands have been detached.
+    }
+}
 
 binary_operator &binary_operator::operator=(const binary_operator &bo)
 {
@@ -79,20 +138,54 @@ binary_operator &binary_operator::operator=(const binary_operator &bo)
     return *this;
 }
 
-binary_operator &binary_operator::operator=(binary_operator &&) noexcept = default;
+binary_operator &binary_operator::operator=(binary_operator &&other) noexcept
+{
+    // NOTE: the current operands are released
+    // via the destructor of tmp (see above).
+    binary_operator tmp(std::move(other));
+    std::swap(m_type, tmp.m_type);
+    m_ops.swap(tmp.m_ops);
 
-expression &binary_operator::lhs()
+    return *this;
+}
+
+// Fetch a mutable reference to the node, making
+// a private copy first if it is shared with other
+// binary operators. The cached properties of the
+// node are cleared, as the caller may modify it.
+// NOTE: the copy is shallow, as the operands
+// in turn share their subexpressions.
+detail::bo_node &binary_operator::mutable_node()
 {
     assert(m_ops);
-    return (*m_ops)[0];
+
+    if (m_ops.use_count() > 1) {
+        m_ops = detail::make_shared_node<detail::bo_node>(*m_ops);
+    } else {
+        m_ops->meta.reset();
+    }
+
+    return *m_ops;
 }
 
-expression &binary_operator::rhs()
+const detail::node_meta &binary_operator::meta() const
 {
     assert(m_ops);
-    return (*m_ops)[1];
+    return m_ops->meta;
+}
+
+expression &binary_operator::lhs()
+{
+    return mutable_node().ops[0];
+}
+
+expression &binary_operator::rhs()
+{
+    return mutable_node().ops[1];
 }
 
+// NOTE: the type is not shared among copies, and
+// the cached properties of the node do not depend on it.
 binary_operator::type &binary_operator::op()
 {
     assert(m_type >= type::add && m_type <= type::div);
@@ -101,20 +194,19 @@ binary_operator::type &binary_operator::op()
 
 std::array<expression, 2> &binary_operator::args()
 {
-    assert(m_ops);
-    return *m_ops;
+    return mutable_node().ops;
 }
 
 const expression &binary_operator::lhs() const
 {
     assert(m_ops);
-    return (*m_ops)[0];
+    return m_ops->ops[0];
 }
 
 const expression &binary_operator::rhs() const
 {
     assert(m_ops);
-    return (*m_ops)[1];
+    return m_ops->ops[1];
 }
 
 const binary_operator::type &binary_operator::op() const
@@ -126,7 +218,7 @@ const binary_operator::type &binary_operator::op() const
 const std::array<expression, 2> &binary_operator::args() const
 {
     assert(m_ops);
-    return *m_ops;
+    return m_ops->ops;
 }
 
 void swap(binary_operator &bo0, binary_operator &bo1) noexcept
@@ -135,9 +227,11 @@ void swap(binary_operator &bo0, binary_operator &bo1) noexcept
     std::swap(bo0.m_ops, bo1.m_ops);
 }
 
+// NOTE: the implementation of hash() is in expression.cpp,
+// where the hash value is cached in the node.
 std::size_t hash(const binary_operator &bo)
 {
-    return std::hash<binary_operator::type>{}(bo.op()) + hash(bo.lhs()) + hash(bo.rhs());
+    return hash(expression{bo});
 }
 
 std::ostream &operator<<(std::ostream &os, const binary_operator &bo)
@@ -162,27 +256,29 @@ std::ostream &operator<<(std::ostream &os, const binary_operator &bo)
     return os << ' ' << bo.rhs() << ')';
 }
 
+// NOTE: the implementations of get_variables(), rename_variables(), subs(), diff()
+// and eval_dbl() are in expression.cpp, where the expression is traversed
+// without recursion.
 std::vector<std::string> get_variables(const binary_operator &bo)
 {
-    auto lhs_vars = get_variables(bo.lhs());
-    auto rhs_vars = get_variables(bo.rhs());
-
-    lhs_vars.insert(lhs_vars.end(), std::make_move_iterator(rhs_vars.begin()), std::make_move_iterator(rhs_vars.end()));
-
-    std::sort(lhs_vars.begin(), lhs_vars.end());
-    lhs_vars.erase(std::unique(lhs_vars.begin(), lhs_vars.end()), lhs_vars.end());
-
-    return lhs_vars;
+    return get_variables(expression{bo});
 }
 
 void rename_variables(binary_operator &bo, const std::unordered_map<std::string, std::string> &repl_map)
 {
-    rename_variables(bo.lhs(), repl_map);
-    rename_variables(bo.rhs(), repl_map);
+    expression tmp{std::move(bo)};
+    rename_variables(tmp, repl_map);
+    bo = std::move(std::get<binary_operator>(tmp.value()));
 }
 
 bool operator==(const binary_operator &o1, const binary_operator &o2)
 {
+    // NOTE: shared operands are equal
+    // without further checks.
+    if (o1.op() == o2.op() && &o1.args() == &o2.args()) {
+        return true;
+    }
+
     return o1.op() == o2.op() && o1.lhs() == o2.lhs() && o1.rhs() == o2.rhs();
 }
 
@@ -193,42 +289,29 @@ bool operator!=(const binary_operator &o1, const binary_operator &o2)
 
 expression subs(const binary_operator &bo, const std::unordered_map<std::string, expression> &smap)
 {
-    return expression{binary_operator{bo.op(), subs(bo.lhs(), smap), subs(bo.rhs(), smap)}};
+    return subs(expression{bo}, smap);
 }
 
 expression diff(const binary_operator &bo, const std::string &s)
 {
-    switch (bo.op()) {
-        case binary_operator::type::add:
-            return diff(bo.lhs(), s) + diff(bo.rhs(), s);
-        case binary_operator::type::sub:
-            return diff(bo.lhs(), s) - diff(bo.rhs(), s);
-        case binary_operator::type::mul:
-            return diff(bo.lhs(), s) * bo.rhs() + bo.lhs() * diff(bo.rhs(), s);
-        default:
-            return (diff(bo.lhs(), s) * bo.rhs() - bo.lhs() * diff(bo.rhs(), s)) / (bo.rhs() * bo.rhs());
-    }
+    return diff(expression{bo}, s);
 }
 
 double eval_dbl(const binary_operator &bo, const std::unordered_map<std::string, double> &map,
                 const std::vector<double> &pars)
 {
-    switch (bo.op()) {
-        case binary_operator::type::add:
-            return eval_dbl(bo.lhs(), map, pars) + eval_dbl(bo.rhs(), map, pars);
-        case binary_operator::type::sub:
-            return eval_dbl(bo.lhs(), map, pars) - eval_dbl(bo.rhs(), map, pars);
-        case binary_operator::type::mul:
-            return eval_dbl(bo.lhs(), map, pars) * eval_dbl(bo.rhs(), map, pars);
-        default:
-            return eval_dbl(bo.lhs(), map, pars) / eval_dbl(bo.rhs(), map, pars);
-    }
+    return eval_dbl(expression{bo}, map, pars);
 }
 
 void eval_batch_dbl(std::vector<double> &out_values, const binary_operator &bo,
                     const std::unordered_map<std::string, std::vector<double>> &map, const std::vector<double> &pars)
 {
-    auto tmp = out_values;
+    // NOTE: the rhs is evaluated into a per-thread
+    // scratch buffer, in order to avoid allocations.
+    detail::eval_scratch es;
+    auto &tmp = es.get();
+    tmp.resize(out_values.size());
+
     eval_batch_dbl(out_values, bo.lhs(), map, pars);
     eval_batch_dbl(tmp, bo.rhs(), map, pars);
     switch (bo.op()) {
@@ -339,11 +422,11 @@ taylor_decompose_in_place(binary_operator &&bo,
         // The lhs required decomposition, and its decomposition
         // was placed at index dres_lhs in u_vars_defs. Replace the lhs
         // a u variable pointing at index dres_lhs.
-        bo.lhs() = expression{variable{"u_" + detail::li_to_string(dres_lhs)}};
+        bo.lhs() = expression{detail::make_u_var(boost::numeric_cast<std::uint32_t>(dres_lhs))};
     }
 
     if (const auto dres_rhs = taylor_decompose_in_place(std::move(bo.rhs()), u_vars_defs)) {
-        bo.rhs() = expression{variable{"u_" + detail::li_to_string(dres_rhs)}};
+        bo.rhs() = expression{detail::make_u_var(boost::numeric_cast<std::uint32_t>(dres_rhs))};
     }
 
     // Append the binary operator after decomposition
@@ -389,7 +472,7 @@ llvm::Value *bo_taylor_diff_addsub_impl(llvm_state &s, const U &num, const varia
 {
     auto &builder = s.builder();
 
-    auto ret = taylor_fetch_diff(arr, uname_to_index(var.name()), order, n_uvars);
+    auto ret = taylor_fetch_diff(arr, uname_to_index(var), order, n_uvars);
 
     if (order == 0u) {
         auto n = taylor_codegen_numparam<T>(s, num, par_ptr, batch_size);
@@ -412,7 +495,7 @@ llvm::Value *bo_taylor_diff_addsub_impl(llvm_state &s, const variable &var, cons
                                         std::uint32_t n_uvars, std::uint32_t order, std::uint32_t,
                                         std::uint32_t batch_size)
 {
-    auto ret = taylor_fetch_diff(arr, uname_to_index(var.name()), order, n_uvars);
+    auto ret = taylor_fetch_diff(arr, uname_to_index(var), order, n_uvars);
 
     if (order == 0u) {
         auto &builder = s.builder();
@@ -431,8 +514,8 @@ llvm::Value *bo_taylor_diff_addsub_impl(llvm_state &s, const variable &var0, con
                                         const std::vector<llvm::Value *> &arr, llvm::Value *, std::uint32_t n_uvars,
                                         std::uint32_t order, std::uint32_t, std::uint32_t)
 {
-    auto v0 = taylor_fetch_diff(arr, uname_to_index(var0.name()), order, n_uvars);
-    auto v1 = taylor_fetch_diff(arr, uname_to_index(var1.name()), order, n_uvars);
+    auto v0 = taylor_fetch_diff(arr, uname_to_index(var0), order, n_uvars);
+    auto v1 = taylor_fetch_diff(arr, uname_to_index(var1), order, n_uvars);
 
     if constexpr (AddOrSub) {
         return s.builder().CreateFAdd(v0, v1);
@@ -501,7 +584,7 @@ llvm::Value *bo_taylor_diff_mul_impl(llvm_state &s, const variable &var, const U
 {
     auto &builder = s.builder();
 
-    auto ret = taylor_fetch_diff(arr, uname_to_index(var.name()), order, n_uvars);
+    auto ret = taylor_fetch_diff(arr, uname_to_index(var), order, n_uvars);
     auto mul = taylor_codegen_numparam<T>(s, num, par_ptr, batch_size);
 
     return builder.CreateFMul(mul, ret);
@@ -523,22 +606,19 @@ llvm::Value *bo_taylor_diff_mul_impl(llvm_state &s, const variable &var0, const
                                      std::uint32_t order, std::uint32_t, std::uint32_t)
 {
     // Fetch the indices of the u variables.
-    const auto u_idx0 = uname_to_index(var0.name());
-    const auto u_idx1 = uname_to_index(var1.name());
+    const auto u_idx0 = uname_to_index(var0);
+    const auto u_idx1 = uname_to_index(var1);
 
     // NOTE: iteration in the [0, order] range
     // (i.e., order inclusive).
-    std::vector<llvm::Value *> sum;
-    auto &builder = s.builder();
+    std::vector<llvm::Value *> v0, v1;
     for (std::uint32_t j = 0; j <= order; ++j) {
-        auto v0 = taylor_fetch_diff(arr, u_idx0, order - j, n_uvars);
-        auto v1 = taylor_fetch_diff(arr, u_idx1, j, n_uvars);
-
-        // Add v0*v1 to the sum.
-        sum.push_back(builder.CreateFMul(v0, v1));
+        v0.push_back(taylor_fetch_diff(arr, u_idx0, order - j, n_uvars));
+        v1.push_back(taylor_fetch_diff(arr, u_idx1, j, n_uvars));
     }
 
-    return pairwise_sum(builder, sum);
+    // Sum the products v0*v1.
+    return pairwise_sum_prod(s, v0, v1);
 }
 
 // All the other cases.
@@ -593,7 +673,7 @@ llvm::Value *bo_taylor_diff_div_impl(llvm_state &s, const U &nv, const variable
     auto &builder = s.builder();
 
     // Fetch the index of var1.
-    const auto u_idx1 = uname_to_index(var1.name());
+    const auto u_idx1 = uname_to_index(var1);
 
     if (order == 0u) {
         // Special casing for zero order.
@@ -601,7 +681,7 @@ llvm::Value *bo_taylor_diff_div_impl(llvm_state &s, const U &nv, const variable
             if constexpr (std::is_same_v<U, number> || std::is_same_v<U, param>) {
                 return taylor_codegen_numparam<T>(s, nv, par_ptr, batch_size);
             } else {
-                return taylor_fetch_diff(arr, uname_to_index(nv.name()), 0, n_uvars);
+                return taylor_fetch_diff(arr, uname_to_index(nv), 0, n_uvars);
             }
         }();
 
@@ -610,17 +690,14 @@ llvm::Value *bo_taylor_diff_div_impl(llvm_state &s, const U &nv, const variable
 
     // NOTE: iteration in the [1, order] range
     // (i.e., order inclusive).
-    std::vector<llvm::Value *> sum;
+    std::vector<llvm::Value *> v0, v1;
     for (std::uint32_t j = 1; j <= order; ++j) {
-        auto v0 = taylor_fetch_diff(arr, idx, order - j, n_uvars);
-        auto v1 = taylor_fetch_diff(arr, u_idx1, j, n_uvars);
-
-        // Add v0*v1 to the sum.
-        sum.push_back(builder.CreateFMul(v0, v1));
+        v0.push_back(taylor_fetch_diff(arr, idx, order - j, n_uvars));
+        v1.push_back(taylor_fetch_diff(arr, u_idx1, j, n_uvars));
     }
 
-    // Init the return value as the result of the sum.
-    auto ret_acc = pairwise_sum(builder, sum);
+    // Init the return value as the result of the sum of the products v0*v1.
+    auto ret_acc = pairwise_sum_prod(s, v0, v1);
 
     // Load the divisor for the quotient formula.
     // This is the zero-th order derivative of var1.
@@ -633,7 +710,7 @@ llvm::Value *bo_taylor_diff_div_impl(llvm_state &s, const U &nv, const variable
     } else {
         // nv is a variable. We need to fetch its
         // derivative of order 'order' from the array of derivatives.
-        auto diff_nv_v = taylor_fetch_diff(arr, uname_to_index(nv.name()), order, n_uvars);
+        auto diff_nv_v = taylor_fetch_diff(arr, uname_to_index(nv), order, n_uvars);
 
         // Produce the result: (diff_nv_v - ret_acc) / div.
         return builder.CreateFDiv(builder.CreateFSub(diff_nv_v, ret_acc), div);
@@ -648,7 +725,7 @@ llvm::Value *bo_taylor_diff_div_impl(llvm_state &s, const variable &var, const U
 {
     auto &builder = s.builder();
 
-    auto ret = taylor_fetch_diff(arr, uname_to_index(var.name()), order, n_uvars);
+    auto ret = taylor_fetch_diff(arr, uname_to_index(var), order, n_uvars);
     auto div = taylor_codegen_numparam<T>(s, num, par_ptr, batch_size);
 
     return builder.CreateFDiv(ret, div);
@@ -1457,7 +1534,7 @@ llvm::Function *bo_taylor_c_diff_func_mul_impl(llvm_state &s, const binary_opera
         llvm_loop_u32(s, builder.getInt32(0), builder.CreateAdd(ord, builder.getInt32(1)), [&](llvm::Value *j) {
             auto b_nj = taylor_c_load_diff(s, diff_ptr, n_uvars, builder.CreateSub(ord, j), idx0);
             auto cj = taylor_c_load_diff(s, diff_ptr, n_uvars, j, idx1);
-            builder.CreateStore(builder.CreateFAdd(builder.CreateLoad(acc), builder.CreateFMul(b_nj, cj)), acc);
+            builder.CreateStore(llvm_fma(s, b_nj, cj, builder.CreateLoad(acc)), acc);
         });
 
         // Create the return value.
@@ -1690,7 +1767,7 @@ llvm::Function *bo_taylor_c_diff_func_div_impl(llvm_state &s, const binary_opera
                 llvm_loop_u32(s, builder.getInt32(1), builder.CreateAdd(ord, builder.getInt32(1)), [&](llvm::Value *j) {
                     auto cj = taylor_c_load_diff(s, diff_ptr, n_uvars, j, var_idx);
                     auto a_nj = taylor_c_load_diff(s, diff_ptr, n_uvars, builder.CreateSub(ord, j), u_idx);
-                    builder.CreateStore(builder.CreateFAdd(builder.CreateLoad(acc), builder.CreateFMul(cj, a_nj)), acc);
+                    builder.CreateStore(llvm_fma(s, cj, a_nj, builder.CreateLoad(acc)), acc);
                 });
 
                 // Negate the loop summation.
@@ -1789,7 +1866,7 @@ llvm::Function *bo_taylor_c_diff_func_div_impl(llvm_state &s, const binary_opera
         llvm_loop_u32(s, builder.getInt32(1), builder.CreateAdd(ord, builder.getInt32(1)), [&](llvm::Value *j) {
             auto cj = taylor_c_load_diff(s, diff_ptr, n_uvars, j, var_idx1);
             auto a_nj = taylor_c_load_diff(s, diff_ptr, n_uvars, builder.CreateSub(ord, j), u_idx);
-            builder.CreateStore(builder.CreateFAdd(builder.CreateLoad(acc), builder.CreateFMul(cj, a_nj)), acc);
+            builder.CreateStore(llvm_fma(s, cj, a_nj, builder.CreateLoad(acc)), acc);
         });
 
         auto ret = builder.CreateFSub(taylor_c_load_diff(s, diff_ptr, n_uvars, ord, var_idx0), builder.CreateLoad(acc));
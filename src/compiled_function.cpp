@@ -0,0 +1,1090 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <heyoka/config.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <limits>
+#include <optional>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include <boost/numeric/conversion/cast.hpp>
+
+#include <fmt/format.h>
+
+#include <llvm/IR/Attributes.h>
+#include <llvm/IR/BasicBlock.h>
+#include <llvm/IR/DerivedTypes.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/Module.h>
+#include <llvm/IR/Type.h>
+#include <llvm/IR/Value.h>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <heyoka/binary_operator.hpp>
+#include <heyoka/compiled_function.hpp>
+#include <heyoka/detail/llvm_helpers.hpp>
+#include <heyoka/detail/run_workers.hpp>
+#include <heyoka/detail/simple_timer.hpp>
+#include <heyoka/detail/type_traits.hpp>
+#include <heyoka/expression.hpp>
+#include <heyoka/func.hpp>
+#include <heyoka/llvm_state.hpp>
+#include <heyoka/number.hpp>
+#include <heyoka/param.hpp>
+#include <heyoka/variable.hpp>
+
+namespace heyoka
+{
+
+namespace detail
+{
+
+namespace
+{
+
+// Codegen for the expression ex. The values of the subexpressions
+// are memoised in memo, so that common subexpressions are computed only once
+// (also across the different expressions of a compiled function, since memo
+// is shared). var_idx maps the ids of the variables to their indices in the input array.
+template <typename T>
+llvm::Value *cfunc_codegen(llvm_state &s, const expression &ex, std::unordered_map<expression, llvm::Value *> &memo,
+                           const std::unordered_map<std::uint32_t, std::uint32_t> &var_idx, llvm::Value *in_ptr,
+                           llvm::Value *par_ptr, llvm::Value *stride, std::uint32_t batch_size)
+{
+    if (auto it = memo.find(ex); it != memo.end()) {
+        return it->second;
+    }
+
+    // NOTE: additions and multiplications are commutative (also
+    // in floating-point arithmetic), thus a + b can reuse the value
+    // of b + a, if it was already computed.
+    if (const auto *bo = std::get_if<binary_operator>(&ex.value());
+        bo != nullptr && (bo->op() == binary_operator::type::add || bo->op() == binary_operator::type::mul)) {
+        if (auto it = memo.find(expression{binary_operator{bo->op(), bo->rhs(), bo->lhs()}}); it != memo.end()) {
+            auto *ret = it->second;
+            memo.emplace(ex, ret);
+
+            return ret;
+        }
+    }
+
+    auto &builder = s.builder();
+    auto *fp_t = to_llvm_type<T>(s.context());
+
+    auto rec = [&](const expression &e) {
+        return cfunc_codegen<T>(s, e, memo, var_idx, in_ptr, par_ptr, stride, batch_size);
+    };
+
+    auto *ret = std::visit(
+        [&](const auto &v) -> llvm::Value * {
+            using type = uncvref_t<decltype(v)>;
+
+            if constexpr (std::is_same_v<type, number>) {
+                return vector_splat(builder, codegen<T>(s, v), batch_size);
+            } else if constexpr (std::is_same_v<type, param>) {
+                // NOTE: the parameters are shared by all
+                // the points in a batch.
+                auto *ptr = builder.CreateInBoundsGEP(fp_t, par_ptr, builder.getInt32(v.idx()));
+
+                return vector_splat(builder, builder.CreateLoad(fp_t, ptr), batch_size);
+            } else if constexpr (std::is_same_v<type, variable>) {
+                const auto it = var_idx.find(v.id());
+                if (it == var_idx.end()) {
+                    throw std::invalid_argument("Cannot generate the code for the variable '" + v.name()
+                                                + "', because it is not in the list of the variables of the "
+                                                  "compiled function");
+                }
+
+                auto *offset = builder.CreateMul(stride, builder.getInt64(it->second));
+
+                return load_vector_from_memory(builder, builder.CreateInBoundsGEP(fp_t, in_ptr, offset), batch_size);
+            } else if constexpr (std::is_same_v<type, binary_operator>) {
+                auto *a = rec(v.lhs());
+                auto *b = rec(v.rhs());
+
+                switch (v.op()) {
+                    case binary_operator::type::add:
+                        return builder.CreateFAdd(a, b);
+                    case binary_operator::type::sub:
+                        return builder.CreateFSub(a, b);
+                    case binary_operator::type::mul:
+                        return builder.CreateFMul(a, b);
+                    default:
+                        return builder.CreateFDiv(a, b);
+                }
+            } else if constexpr (std::is_same_v<type, func>) {
+                std::vector<llvm::Value *> args;
+                args.reserve(v.args().size());
+                for (const auto &arg : v.args()) {
+                    args.push_back(rec(arg));
+                }
+
+                return codegen_from_values<T>(s, v, args);
+            } else {
+                static_assert(always_false_v<T>, "Unhandled expression type.");
+            }
+        },
+        ex.value());
+
+    memo.emplace(ex, ret);
+
+    return ret;
+}
+
+// Codegen for the derivative of the expression ex with respect to the variable
+// with index j (or, if wrt_par is true, with respect to the parameter
+// par[j]), via forward-mode differentiation. The values of the
+// subexpressions are taken from (and added to) memo, the derivatives are memoised
+// in tmemo and the values of the partial derivatives of the functions with respect
+// to their arguments are memoised in pmemo. A null return value means that the
+// derivative is identically zero.
+template <typename T>
+llvm::Value *cfunc_tangent_codegen(llvm_state &s, const expression &ex, std::uint32_t j, bool wrt_par,
+                                   std::unordered_map<expression, llvm::Value *> &memo,
+                                   std::unordered_map<expression, llvm::Value *> &tmemo,
+                                   std::unordered_map<expression, std::vector<llvm::Value *>> &pmemo,
+                                   const std::unordered_map<std::uint32_t, std::uint32_t> &var_idx,
+                                   llvm::Value *in_ptr, llvm::Value *par_ptr, llvm::Value *stride,
+                                   std::uint32_t batch_size)
+{
+    if (auto it = tmemo.find(ex); it != tmemo.end()) {
+        return it->second;
+    }
+
+    auto &builder = s.builder();
+
+    auto val = [&](const expression &e) {
+        return cfunc_codegen<T>(s, e, memo, var_idx, in_ptr, par_ptr, stride, batch_size);
+    };
+    auto rec = [&](const expression &e) {
+        return cfunc_tangent_codegen<T>(s, e, j, wrt_par, memo, tmemo, pmemo, var_idx, in_ptr, par_ptr, stride,
+                                        batch_size);
+    };
+
+    auto *ret = std::visit(
+        [&](const auto &v) -> llvm::Value * {
+            using type = uncvref_t<decltype(v)>;
+
+            if constexpr (std::is_same_v<type, number>) {
+                return nullptr;
+            } else if constexpr (std::is_same_v<type, param>) {
+                return wrt_par && v.idx() == j ? vector_splat(builder, codegen<T>(s, number{1.}), batch_size) : nullptr;
+            } else if constexpr (std::is_same_v<type, variable>) {
+                const auto it = var_idx.find(v.id());
+                if (it == var_idx.end()) {
+                    throw std::invalid_argument("Cannot generate the code for the variable '" + v.name()
+                                                + "', because it is not in the list of the variables of the "
+                                                  "compiled function");
+                }
+
+                return !wrt_par && it->second == j ? vector_splat(builder, codegen<T>(s, number{1.}), batch_size)
+                                                   : nullptr;
+            } else if constexpr (std::is_same_v<type, binary_operator>) {
+                auto *da = rec(v.lhs());
+                auto *db = rec(v.rhs());
+
+                if (da == nullptr && db == nullptr) {
+                    return nullptr;
+                }
+
+                switch (v.op()) {
+                    case binary_operator::type::add:
+                        return da == nullptr ? db : (db == nullptr ? da : builder.CreateFAdd(da, db));
+                    case binary_operator::type::sub:
+                        return da == nullptr ? builder.CreateFNeg(db)
+                                             : (db == nullptr ? da : builder.CreateFSub(da, db));
+                    case binary_operator::type::mul: {
+                        // d(a*b) = da*b + a*db.
+                        auto *t1 = da == nullptr ? nullptr : builder.CreateFMul(da, val(v.rhs()));
+                        auto *t2 = db == nullptr ? nullptr : builder.CreateFMul(val(v.lhs()), db);
+
+                        return t1 == nullptr ? t2 : (t2 == nullptr ? t1 : builder.CreateFAdd(t1, t2));
+                    }
+                    default: {
+                        // d(a/b) = (da - (a/b)*db) / b.
+                        auto *b = val(v.rhs());
+
+                        if (db == nullptr) {
+                            return builder.CreateFDiv(da, b);
+                        }
+
+                        auto *t = builder.CreateFMul(val(ex), db);
+
+                        return builder.CreateFDiv(da == nullptr ? builder.CreateFNeg(t) : builder.CreateFSub(da, t),
+                                                  b);
+                    }
+                }
+            } else if constexpr (std::is_same_v<type, func>) {
+                const auto n_args = v.args().size();
+
+                // Fetch (or create) the cache of the partial derivatives.
+                auto &pders = pmemo.try_emplace(ex, std::vector<llvm::Value *>(n_args, nullptr)).first->second;
+
+                llvm::Value *retval = nullptr;
+
+                for (decltype(v.args().size()) k = 0; k < n_args; ++k) {
+                    auto *dk = rec(v.args()[k]);
+                    if (dk == nullptr) {
+                        continue;
+                    }
+
+                    if (pders[k] == nullptr) {
+                        // Compute the partial derivative of the function with respect to its k-th argument:
+                        // the arguments are replaced by placeholder variables, and, after the symbolic
+                        // differentiation, the placeholders are replaced back by the arguments.
+                        auto tmp = v;
+                        std::unordered_map<std::string, expression> smap;
+                        decltype(v.args().size()) idx = 0;
+                        for (auto [b, e] = tmp.get_mutable_args_it(); b != e; ++b, ++idx) {
+                            const auto ph_name = "__cfunc_jac_arg_" + std::to_string(idx);
+                            smap.emplace(ph_name, v.args()[idx]);
+                            *b = expression{variable{ph_name}};
+                        }
+
+                        const auto pder = subs(diff(expression{std::move(tmp)}, "__cfunc_jac_arg_" + std::to_string(k)),
+                                               smap);
+
+                        // NOTE: the reference into pmemo is stable, as unordered_map
+                        // does not invalidate references upon insertion.
+                        pders[k] = val(pder);
+                    }
+
+                    auto *t = builder.CreateFMul(pders[k], dk);
+                    retval = retval == nullptr ? t : builder.CreateFAdd(retval, t);
+                }
+
+                return retval;
+            } else {
+                static_assert(always_false_v<T>, "Unhandled expression type.");
+            }
+        },
+        ex.value());
+
+    tmemo.emplace(ex, ret);
+
+    return ret;
+}
+
+// Helper to deduce the list of variables of fn,
+// or to validate the list vars.
+std::vector<expression> cfunc_vars(const std::vector<expression> &fn, std::vector<expression> vars)
+{
+    if (vars.empty()) {
+        std::set<std::string> names;
+        for (const auto &ex : fn) {
+            for (auto &name : get_variables(ex)) {
+                names.insert(std::move(name));
+            }
+        }
+
+        for (const auto &name : names) {
+            vars.emplace_back(variable{name});
+        }
+    } else {
+        std::set<std::string> names;
+        for (const auto &v : vars) {
+            if (!std::holds_alternative<variable>(v.value())) {
+                std::ostringstream oss;
+                oss << v;
+
+                throw std::invalid_argument("The list of variables of a compiled function can contain only variables, "
+                                            "but the expression '"
+                                            + oss.str() + "' was found instead");
+            }
+
+            if (!names.insert(std::get<variable>(v.value()).name()).second) {
+                throw std::invalid_argument("The list of variables of a compiled function contains the variable '"
+                                            + std::get<variable>(v.value()).name() + "' more than once");
+            }
+        }
+    }
+
+    return vars;
+}
+
+// The quantities computed by a compiled function: the values of the
+// expressions, their Jacobian with respect to the variables, or their
+// values together with their Jacobian with respect to the parameters.
+enum class cfunc_kind { value, jac, par_jac };
+
+// Add a compiled function of the given kind to s.
+template <typename T>
+std::vector<expression> add_cfunc_impl(llvm_state &s, const std::string &name, const std::vector<expression> &fn,
+                                       std::vector<expression> vars, std::uint32_t batch_size, bool optimise,
+                                       cfunc_kind kind = cfunc_kind::value)
+{
+    if (s.is_compiled()) {
+        throw std::invalid_argument("A compiled function cannot be added to an llvm_state after compilation");
+    }
+
+    if (batch_size == 0u) {
+        throw std::invalid_argument("The batch size of a compiled function cannot be zero");
+    }
+
+    vars = cfunc_vars(fn, std::move(vars));
+
+    if (vars.size() > std::numeric_limits<std::uint32_t>::max()) {
+        throw std::overflow_error("Overflow detected in the number of variables of a compiled function");
+    }
+
+    std::unordered_map<std::uint32_t, std::uint32_t> var_idx;
+    for (decltype(vars.size()) i = 0; i < vars.size(); ++i) {
+        var_idx.emplace(std::get<variable>(vars[i].value()).id(), static_cast<std::uint32_t>(i));
+    }
+
+    // Time the IR generation.
+    std::optional<time_accumulator> ta_ir;
+    ta_ir.emplace(s.stats().ir_gen_time);
+
+    auto &builder = s.builder();
+    auto *fp_t = to_llvm_type<T>(s.context());
+
+    // Prepare the function prototype. The first argument is a float pointer to the output
+    // array, the second argument a const float pointer to the input array, the third argument
+    // a const float pointer to the pars, the fourth argument the stride of the input
+    // and output arrays. The arrays cannot overlap.
+    std::vector<llvm::Type *> fargs(3, llvm::PointerType::getUnqual(fp_t));
+    fargs.push_back(builder.getInt64Ty());
+    // The function does not return anything.
+    auto *ft = llvm::FunctionType::get(builder.getVoidTy(), fargs, false);
+    assert(ft != nullptr);
+    // Now create the function.
+    auto *f = llvm::Function::Create(ft, llvm::Function::ExternalLinkage, name, &s.module());
+    if (f == nullptr) {
+        throw std::invalid_argument("Unable to create a compiled function with name '" + name + "'");
+    }
+
+    // Set the names/attributes of the function arguments.
+    auto out_ptr = f->args().begin();
+    out_ptr->setName("out_ptr");
+    out_ptr->addAttr(llvm::Attribute::NoCapture);
+    out_ptr->addAttr(llvm::Attribute::NoAlias);
+    out_ptr->addAttr(llvm::Attribute::WriteOnly);
+
+    auto in_ptr = out_ptr + 1;
+    in_ptr->setName("in_ptr");
+    in_ptr->addAttr(llvm::Attribute::NoCapture);
+    in_ptr->addAttr(llvm::Attribute::NoAlias);
+    in_ptr->addAttr(llvm::Attribute::ReadOnly);
+
+    auto par_ptr = in_ptr + 1;
+    par_ptr->setName("par_ptr");
+    par_ptr->addAttr(llvm::Attribute::NoCapture);
+    par_ptr->addAttr(llvm::Attribute::NoAlias);
+    par_ptr->addAttr(llvm::Attribute::ReadOnly);
+
+    auto stride = par_ptr + 1;
+    stride->setName("stride");
+
+    // Create a new basic block to start insertion into.
+    auto *bb = llvm::BasicBlock::Create(s.context(), "entry", f);
+    assert(bb != nullptr);
+    builder.SetInsertPoint(bb);
+
+    std::unordered_map<expression, llvm::Value *> memo;
+
+    if (kind == cfunc_kind::jac) {
+        // NOTE: the value and the partial derivatives of each subexpression
+        // are computed once and shared among all the derivatives.
+        std::unordered_map<expression, std::vector<llvm::Value *>> pmemo;
+        const auto n_vars = static_cast<std::uint32_t>(vars.size());
+
+        for (std::uint32_t j = 0; j < n_vars; ++j) {
+            std::unordered_map<expression, llvm::Value *> tmemo;
+
+            for (decltype(fn.size()) i = 0; i < fn.size(); ++i) {
+                auto *der = cfunc_tangent_codegen<T>(s, fn[i], j, false, memo, tmemo, pmemo, var_idx, in_ptr,
+                                                     par_ptr, stride, batch_size);
+                if (der == nullptr) {
+                    der = vector_splat(builder, codegen<T>(s, number{0.}), batch_size);
+                }
+
+                // NOTE: the derivative of the i-th expression with respect
+                // to the j-th variable goes into the row i * n_vars + j.
+                const auto row = boost::numeric_cast<std::uint64_t>(i) * n_vars + j;
+                auto *offset = builder.CreateMul(stride, builder.getInt64(row));
+                store_vector_to_memory(builder, builder.CreateInBoundsGEP(fp_t, out_ptr, offset), der);
+            }
+        }
+    } else if (kind == cfunc_kind::par_jac) {
+        std::uint32_t n_pars = 0;
+        for (const auto &ex : fn) {
+            n_pars = std::max(n_pars, get_param_size(ex));
+        }
+
+        if (n_pars == std::numeric_limits<std::uint32_t>::max()) {
+            throw std::overflow_error("Overflow detected in the number of parameters of a compiled function");
+        }
+
+        // NOTE: the values go into the rows i * (n_pars + 1), the derivatives
+        // with respect to the parameters into the subsequent n_pars rows.
+        for (decltype(fn.size()) i = 0; i < fn.size(); ++i) {
+            const auto row = boost::numeric_cast<std::uint64_t>(i) * (n_pars + 1u);
+            auto *offset = builder.CreateMul(stride, builder.getInt64(row));
+            store_vector_to_memory(builder, builder.CreateInBoundsGEP(fp_t, out_ptr, offset),
+                                   cfunc_codegen<T>(s, fn[i], memo, var_idx, in_ptr, par_ptr, stride, batch_size));
+        }
+
+        std::unordered_map<expression, std::vector<llvm::Value *>> pmemo;
+
+        for (std::uint32_t j = 0; j < n_pars; ++j) {
+            std::unordered_map<expression, llvm::Value *> tmemo;
+
+            for (decltype(fn.size()) i = 0; i < fn.size(); ++i) {
+                auto *der = cfunc_tangent_codegen<T>(s, fn[i], j, true, memo, tmemo, pmemo, var_idx, in_ptr,
+                                                     par_ptr, stride, batch_size);
+                if (der == nullptr) {
+                    der = vector_splat(builder, codegen<T>(s, number{0.}), batch_size);
+                }
+
+                const auto row = boost::numeric_cast<std::uint64_t>(i) * (n_pars + 1u) + 1u + j;
+                auto *offset = builder.CreateMul(stride, builder.getInt64(row));
+                store_vector_to_memory(builder, builder.CreateInBoundsGEP(fp_t, out_ptr, offset), der);
+            }
+        }
+    } else {
+        for (decltype(fn.size()) i = 0; i < fn.size(); ++i) {
+            auto *val = cfunc_codegen<T>(s, fn[i], memo, var_idx, in_ptr, par_ptr, stride, batch_size);
+
+            auto *offset = builder.CreateMul(stride, builder.getInt64(boost::numeric_cast<std::uint64_t>(i)));
+            store_vector_to_memory(builder, builder.CreateInBoundsGEP(fp_t, out_ptr, offset), val);
+        }
+    }
+
+    // Finish off the function.
+    builder.CreateRetVoid();
+
+    // Verify it.
+    s.verify_function(f);
+
+    ta_ir.reset();
+
+    if (optimise) {
+        // Run the optimisation pass.
+        s.optimise();
+    }
+
+    return vars;
+}
+
+} // namespace
+
+template <typename T>
+std::uint32_t cfunc_default_batch_size(const llvm_state &s)
+{
+    if constexpr (std::is_same_v<T, double>) {
+        const auto &tf = get_target_features(s);
+
+        if (tf.avx512f && s.prefer_vw512()) {
+            return 8;
+        }
+
+        if (tf.avx) {
+            return 4;
+        }
+
+        if (tf.sse2) {
+            return 2;
+        }
+    }
+
+    return 1;
+}
+
+// Explicit instantiations.
+template std::uint32_t cfunc_default_batch_size<double>(const llvm_state &);
+template std::uint32_t cfunc_default_batch_size<long double>(const llvm_state &);
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+template std::uint32_t cfunc_default_batch_size<mppp::real128>(const llvm_state &);
+
+#endif
+
+namespace
+{
+
+// Make the function with the given name in s internal and non-inlinable:
+// in a compiled population, the functions of the expressions are
+// invoked only via the dispatcher, whose size thus stays
+// proportional to the number of expressions.
+void cfunc_make_internal(llvm_state &s, const std::string &name)
+{
+    auto *f = s.module().getFunction(name);
+    assert(f != nullptr);
+
+    f->setLinkage(llvm::Function::InternalLinkage);
+    f->addFnAttr(llvm::Attribute::NoInline);
+}
+
+// Add to s a dispatcher with the given name. The signature of the dispatcher is
+//
+// void (std::uint64_t idx, T *out, const T *in, const T *par, std::uint64_t stride)
+//
+// and the dispatcher forwards the last four arguments to the function fnames[idx].
+template <typename T>
+void cfunc_add_dispatcher(llvm_state &s, const std::string &name, const std::vector<std::string> &fnames)
+{
+    if (s.is_compiled()) {
+        throw std::invalid_argument("A dispatcher cannot be added to an llvm_state after compilation");
+    }
+
+    std::optional<time_accumulator> ta_ir;
+    ta_ir.emplace(s.stats().ir_gen_time);
+
+    auto &builder = s.builder();
+    auto &context = s.context();
+    auto *fp_t = to_llvm_type<T>(context);
+
+    std::vector<llvm::Type *> fargs{builder.getInt64Ty()};
+    fargs.insert(fargs.end(), 3, llvm::PointerType::getUnqual(fp_t));
+    fargs.push_back(builder.getInt64Ty());
+    auto *ft = llvm::FunctionType::get(builder.getVoidTy(), fargs, false);
+    assert(ft != nullptr);
+    auto *f = llvm::Function::Create(ft, llvm::Function::ExternalLinkage, name, &s.module());
+    if (f == nullptr) {
+        throw std::invalid_argument("Unable to create a dispatcher with name '" + name + "'");
+    }
+
+    auto arg_it = f->args().begin();
+    auto *idx = &*arg_it;
+    idx->setName("idx");
+    std::vector<llvm::Value *> cargs;
+    for (++arg_it; arg_it != f->args().end(); ++arg_it) {
+        cargs.push_back(&*arg_it);
+    }
+
+    auto *bb = llvm::BasicBlock::Create(context, "entry", f);
+    assert(bb != nullptr);
+    auto *bb_def = llvm::BasicBlock::Create(context, "default", f);
+    assert(bb_def != nullptr);
+
+    builder.SetInsertPoint(bb);
+    auto *sw = builder.CreateSwitch(idx, bb_def, boost::numeric_cast<unsigned>(fnames.size()));
+
+    for (decltype(fnames.size()) i = 0; i < fnames.size(); ++i) {
+        auto *callee = s.module().getFunction(fnames[i]);
+        assert(callee != nullptr);
+
+        auto *bb_case = llvm::BasicBlock::Create(context, "", f);
+        assert(bb_case != nullptr);
+        sw->addCase(builder.getInt64(boost::numeric_cast<std::uint64_t>(i)), bb_case);
+
+        builder.SetInsertPoint(bb_case);
+        builder.CreateCall(callee, cargs);
+        builder.CreateRetVoid();
+    }
+
+    // NOTE: the validity of the index is checked
+    // before invoking the dispatcher.
+    builder.SetInsertPoint(bb_def);
+    builder.CreateRetVoid();
+
+    s.verify_function(f);
+}
+
+} // namespace
+
+} // namespace detail
+
+std::vector<expression> add_cfunc_dbl(llvm_state &s, const std::string &name, const std::vector<expression> &fn,
+                                      std::vector<expression> vars, std::uint32_t batch_size)
+{
+    return detail::add_cfunc_impl<double>(s, name, fn, std::move(vars), batch_size, true);
+}
+
+std::vector<expression> add_cfunc_ldbl(llvm_state &s, const std::string &name, const std::vector<expression> &fn,
+                                       std::vector<expression> vars, std::uint32_t batch_size)
+{
+    return detail::add_cfunc_impl<long double>(s, name, fn, std::move(vars), batch_size, true);
+}
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+std::vector<expression> add_cfunc_f128(llvm_state &s, const std::string &name, const std::vector<expression> &fn,
+                                       std::vector<expression> vars, std::uint32_t batch_size)
+{
+    return detail::add_cfunc_impl<mppp::real128>(s, name, fn, std::move(vars), batch_size, true);
+}
+
+#endif
+
+std::vector<expression> add_cfunc_jac_dbl(llvm_state &s, const std::string &name, const std::vector<expression> &fn,
+                                          std::vector<expression> vars, std::uint32_t batch_size)
+{
+    return detail::add_cfunc_impl<double>(s, name, fn, std::move(vars), batch_size, true, detail::cfunc_kind::jac);
+}
+
+std::vector<expression> add_cfunc_jac_ldbl(llvm_state &s, const std::string &name, const std::vector<expression> &fn,
+                                           std::vector<expression> vars, std::uint32_t batch_size)
+{
+    return detail::add_cfunc_impl<long double>(s, name, fn, std::move(vars), batch_size, true, detail::cfunc_kind::jac);
+}
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+std::vector<expression> add_cfunc_jac_f128(llvm_state &s, const std::string &name, const std::vector<expression> &fn,
+                                           std::vector<expression> vars, std::uint32_t batch_size)
+{
+    return detail::add_cfunc_impl<mppp::real128>(s, name, fn, std::move(vars), batch_size, true,
+                                                 detail::cfunc_kind::jac);
+}
+
+#endif
+
+std::vector<expression> add_cfunc_par_jac_dbl(llvm_state &s, const std::string &name,
+                                              const std::vector<expression> &fn, std::vector<expression> vars,
+                                              std::uint32_t batch_size)
+{
+    return detail::add_cfunc_impl<double>(s, name, fn, std::move(vars), batch_size, true, detail::cfunc_kind::par_jac);
+}
+
+std::vector<expression> add_cfunc_par_jac_ldbl(llvm_state &s, const std::string &name,
+                                               const std::vector<expression> &fn, std::vector<expression> vars,
+                                               std::uint32_t batch_size)
+{
+    return detail::add_cfunc_impl<long double>(s, name, fn, std::move(vars), batch_size, true,
+                                               detail::cfunc_kind::par_jac);
+}
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+std::vector<expression> add_cfunc_par_jac_f128(llvm_state &s, const std::string &name,
+                                               const std::vector<expression> &fn, std::vector<expression> vars,
+                                               std::uint32_t batch_size)
+{
+    return detail::add_cfunc_impl<mppp::real128>(s, name, fn, std::move(vars), batch_size, true,
+                                                 detail::cfunc_kind::par_jac);
+}
+
+#endif
+
+template <typename T>
+void compiled_function<T>::finalise_ctor_impl(std::vector<expression> fn, std::vector<expression> vars,
+                                              std::uint32_t batch_size)
+{
+    m_fn = std::move(fn);
+
+    if (batch_size == 0u) {
+        batch_size = detail::cfunc_default_batch_size<T>(m_llvm);
+    }
+    m_batch_size = batch_size;
+
+    // Add the scalar function and, if needed,
+    // the batch function.
+    m_vars = detail::add_cfunc_impl<T>(m_llvm, "cfunc", m_fn, std::move(vars), 1, false);
+    if (m_batch_size > 1u) {
+        detail::add_cfunc_impl<T>(m_llvm, "cfunc.batch", m_fn, m_vars, m_batch_size, false);
+    }
+
+    m_n_pars = 0;
+    for (const auto &ex : m_fn) {
+        m_n_pars = std::max(m_n_pars, get_param_size(ex));
+    }
+
+    // Run the optimisation pass.
+    m_llvm.optimise();
+
+    // Run the jit.
+    m_llvm.compile();
+
+    fetch_functions();
+}
+
+template <typename T>
+void compiled_function<T>::fetch_functions()
+{
+    m_f_scalar = reinterpret_cast<cfunc_t>(m_llvm.jit_lookup("cfunc"));
+    m_f_batch = m_batch_size > 1u ? reinterpret_cast<cfunc_t>(m_llvm.jit_lookup("cfunc.batch")) : m_f_scalar;
+}
+
+template <typename T>
+compiled_function<T>::compiled_function(const compiled_function &other)
+    // NOTE: make a deep copy of the state, so that
+    // the copy owns its compiled code.
+    : m_llvm(other.m_llvm.deep_copy()), m_fn(other.m_fn), m_vars(other.m_vars), m_batch_size(other.m_batch_size),
+      m_n_pars(other.m_n_pars)
+{
+    fetch_functions();
+}
+
+template <typename T>
+compiled_function<T>::compiled_function(compiled_function &&) noexcept = default;
+
+template <typename T>
+compiled_function<T> &compiled_function<T>::operator=(const compiled_function &other)
+{
+    if (this != &other) {
+        *this = compiled_function(other);
+    }
+
+    return *this;
+}
+
+template <typename T>
+compiled_function<T> &compiled_function<T>::operator=(compiled_function &&) noexcept = default;
+
+template <typename T>
+compiled_function<T>::~compiled_function() = default;
+
+template <typename T>
+const llvm_state &compiled_function<T>::get_llvm_state() const
+{
+    return m_llvm;
+}
+
+template <typename T>
+const std::vector<expression> &compiled_function<T>::get_fn() const
+{
+    return m_fn;
+}
+
+template <typename T>
+const std::vector<expression> &compiled_function<T>::get_vars() const
+{
+    return m_vars;
+}
+
+template <typename T>
+std::uint32_t compiled_function<T>::get_batch_size() const
+{
+    return m_batch_size;
+}
+
+template <typename T>
+void compiled_function<T>::operator()(T *out, const T *in, const T *pars) const
+{
+    m_f_scalar(out, in, pars, 1);
+}
+
+template <typename T>
+std::vector<T> compiled_function<T>::operator()(const std::vector<T> &in, const std::vector<T> &pars) const
+{
+    using namespace fmt::literals;
+
+    if (in.size() != m_vars.size()) {
+        throw std::invalid_argument("Invalid input array passed to a compiled function: the number of variables is {}, "
+                                    "but the size of the input array is {}"_format(m_vars.size(), in.size()));
+    }
+
+    if (pars.size() < m_n_pars) {
+        throw std::invalid_argument("Invalid array of parameters passed to a compiled function: the number of "
+                                    "parameters is {}, but the size of the array of parameters is {}"_format(
+                                        m_n_pars, pars.size()));
+    }
+
+    std::vector<T> retval(m_fn.size());
+
+    (*this)(retval.data(), in.data(), pars.data());
+
+    return retval;
+}
+
+template <typename T>
+void compiled_function<T>::eval_batch(T *out, const T *in, std::size_t n_points, const T *pars) const
+{
+    const auto stride = boost::numeric_cast<std::uint64_t>(n_points);
+
+    std::size_t i = 0;
+
+    // Process the points in SIMD batches.
+    for (; n_points - i >= m_batch_size; i += m_batch_size) {
+        m_f_batch(out + i, in + i, pars, stride);
+    }
+
+    // Process the remaining points one by one.
+    for (; i < n_points; ++i) {
+        m_f_scalar(out + i, in + i, pars, stride);
+    }
+}
+
+template <typename T>
+void compiled_function<T>::eval_batch(std::vector<T> &out, const std::vector<T> &in, std::size_t n_points,
+                                      const std::vector<T> &pars) const
+{
+    using namespace fmt::literals;
+
+    if (n_points > std::numeric_limits<std::size_t>::max() / std::max<std::size_t>(m_vars.size(), 1)
+        || n_points > std::numeric_limits<std::size_t>::max() / std::max<std::size_t>(m_fn.size(), 1)) {
+        throw std::overflow_error("Overflow detected in the batch evaluation of a compiled function");
+    }
+
+    if (in.size() != m_vars.size() * n_points) {
+        throw std::invalid_argument("Invalid input array passed to the batch evaluation of a compiled function: the "
+                                    "expected size is {}, but the size of the input array is {}"_format(
+                                        m_vars.size() * n_points, in.size()));
+    }
+
+    if (pars.size() < m_n_pars) {
+        throw std::invalid_argument("Invalid array of parameters passed to the batch evaluation of a compiled "
+                                    "function: the number of parameters is {}, but the size of the array of "
+                                    "parameters is {}"_format(m_n_pars, pars.size()));
+    }
+
+    out.resize(m_fn.size() * n_points);
+
+    eval_batch(out.data(), in.data(), n_points, pars.data());
+}
+
+template <typename T>
+void compiled_function<T>::eval_batch_parallel(T *out, const T *in, std::size_t n_points, const T *pars,
+                                               unsigned n_threads) const
+{
+    const auto stride = boost::numeric_cast<std::uint64_t>(n_points);
+
+    if (n_points == 0u) {
+        return;
+    }
+
+    if (n_threads == 0u) {
+        n_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    // NOTE: the points are handed out in chunks whose size
+    // is a multiple of the batch size, so that only the
+    // last chunk may need scalar evaluations.
+    const std::size_t chunk_size = 1024u * m_batch_size;
+    const auto n_chunks = n_points / chunk_size + static_cast<std::size_t>(n_points % chunk_size != 0u);
+    if (n_threads > n_chunks) {
+        n_threads = static_cast<unsigned>(n_chunks);
+    }
+
+    std::atomic<std::size_t> next_chunk(0);
+    std::vector<std::exception_ptr> eptrs(n_threads);
+
+    auto worker_func = [&](unsigned thread_idx) {
+        try {
+            for (auto c = next_chunk.fetch_add(1); c < n_chunks; c = next_chunk.fetch_add(1)) {
+                const auto end = std::min(n_points, (c + 1u) * chunk_size);
+                auto i = c * chunk_size;
+
+                for (; end - i >= m_batch_size; i += m_batch_size) {
+                    m_f_batch(out + i, in + i, pars, stride);
+                }
+
+                for (; i < end; ++i) {
+                    m_f_scalar(out + i, in + i, pars, stride);
+                }
+            }
+        } catch (...) {
+            eptrs[thread_idx] = std::current_exception();
+
+            next_chunk.store(n_chunks);
+        }
+    };
+
+    detail::run_workers(n_threads, worker_func, [&]() { next_chunk.store(n_chunks); }, eptrs);
+}
+
+// Explicit instantiations.
+template class compiled_function<double>;
+template class compiled_function<long double>;
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+template class compiled_function<mppp::real128>;
+
+#endif
+
+template <typename T>
+void compiled_population<T>::finalise_ctor_impl(std::vector<expression> pop, std::vector<expression> vars,
+                                                std::uint32_t batch_size)
+{
+    m_pop = std::move(pop);
+
+    if (batch_size == 0u) {
+        batch_size = detail::cfunc_default_batch_size<T>(m_llvm);
+    }
+    m_batch_size = batch_size;
+
+    // NOTE: the variables are deduced (or validated)
+    // once for the whole population.
+    m_vars = detail::cfunc_vars(m_pop, std::move(vars));
+
+    // Add the scalar and batch functions of the expressions,
+    // then the dispatchers.
+    std::vector<std::string> s_names, b_names;
+    for (decltype(m_pop.size()) i = 0; i < m_pop.size(); ++i) {
+        s_names.push_back("cpop." + std::to_string(i));
+        detail::add_cfunc_impl<T>(m_llvm, s_names.back(), {m_pop[i]}, m_vars, 1, false);
+        detail::cfunc_make_internal(m_llvm, s_names.back());
+
+        if (m_batch_size > 1u) {
+            b_names.push_back("cpop.batch." + std::to_string(i));
+            detail::add_cfunc_impl<T>(m_llvm, b_names.back(), {m_pop[i]}, m_vars, m_batch_size, false);
+            detail::cfunc_make_internal(m_llvm, b_names.back());
+        }
+    }
+
+    detail::cfunc_add_dispatcher<T>(m_llvm, "cpop", s_names);
+    if (m_batch_size > 1u) {
+        detail::cfunc_add_dispatcher<T>(m_llvm, "cpop.batch", b_names);
+    }
+
+    m_n_pars = 0;
+    for (const auto &ex : m_pop) {
+        m_n_pars = std::max(m_n_pars, get_param_size(ex));
+    }
+
+    // NOTE: a single optimisation pass and
+    // compilation for the whole population.
+    m_llvm.optimise();
+
+    m_llvm.compile();
+
+    fetch_functions();
+}
+
+template <typename T>
+void compiled_population<T>::fetch_functions()
+{
+    m_d_scalar = reinterpret_cast<dfunc_t>(m_llvm.jit_lookup("cpop"));
+    m_d_batch = m_batch_size > 1u ? reinterpret_cast<dfunc_t>(m_llvm.jit_lookup("cpop.batch")) : m_d_scalar;
+}
+
+template <typename T>
+compiled_population<T>::compiled_population(const compiled_population &other)
+    : m_llvm(other.m_llvm.deep_copy()), m_pop(other.m_pop), m_vars(other.m_vars), m_batch_size(other.m_batch_size),
+      m_n_pars(other.m_n_pars)
+{
+    fetch_functions();
+}
+
+template <typename T>
+compiled_population<T>::compiled_population(compiled_population &&) noexcept = default;
+
+template <typename T>
+compiled_population<T> &compiled_population<T>::operator=(const compiled_population &other)
+{
+    if (this != &other) {
+        *this = compiled_population(other);
+    }
+
+    return *this;
+}
+
+template <typename T>
+compiled_population<T> &compiled_population<T>::operator=(compiled_population &&) noexcept = default;
+
+template <typename T>
+compiled_population<T>::~compiled_population() = default;
+
+template <typename T>
+const llvm_state &compiled_population<T>::get_llvm_state() const
+{
+    return m_llvm;
+}
+
+template <typename T>
+const std::vector<expression> &compiled_population<T>::get_pop() const
+{
+    return m_pop;
+}
+
+template <typename T>
+const std::vector<expression> &compiled_population<T>::get_vars() const
+{
+    return m_vars;
+}
+
+template <typename T>
+std::uint32_t compiled_population<T>::get_batch_size() const
+{
+    return m_batch_size;
+}
+
+template <typename T>
+void compiled_population<T>::eval_batch(std::size_t idx, T *out, const T *in, std::size_t n_points,
+                                        const T *pars) const
+{
+    using namespace fmt::literals;
+
+    if (idx >= m_pop.size()) {
+        throw std::invalid_argument("Invalid index {} passed to the evaluation of a compiled population of size "
+                                    "{}"_format(idx, m_pop.size()));
+    }
+
+    const auto stride = boost::numeric_cast<std::uint64_t>(n_points);
+    const auto i_idx = static_cast<std::uint64_t>(idx);
+
+    std::size_t i = 0;
+
+    // Process the points in SIMD batches.
+    for (; n_points - i >= m_batch_size; i += m_batch_size) {
+        m_d_batch(i_idx, out + i, in + i, pars, stride);
+    }
+
+    // Process the remaining points one by one.
+    for (; i < n_points; ++i) {
+        m_d_scalar(i_idx, out + i, in + i, pars, stride);
+    }
+}
+
+template <typename T>
+void compiled_population<T>::eval_batch(std::vector<T> &out, const std::vector<T> &in, std::size_t n_points,
+                                        const std::vector<T> &pars) const
+{
+    using namespace fmt::literals;
+
+    if (n_points > std::numeric_limits<std::size_t>::max() / std::max<std::size_t>(m_vars.size(), 1)
+        || n_points > std::numeric_limits<std::size_t>::max() / std::max<std::size_t>(m_pop.size(), 1)) {
+        throw std::overflow_error("Overflow detected in the batch evaluation of a compiled population");
+    }
+
+    if (in.size() != m_vars.size() * n_points) {
+        throw std::invalid_argument("Invalid input array passed to the batch evaluation of a compiled population: "
+                                    "the expected size is {}, but the size of the input array is {}"_format(
+                                        m_vars.size() * n_points, in.size()));
+    }
+
+    if (pars.size() < m_n_pars) {
+        throw std::invalid_argument("Invalid array of parameters passed to the batch evaluation of a compiled "
+                                    "population: the number of parameters is {}, but the size of the array of "
+                                    "parameters is {}"_format(m_n_pars, pars.size()));
+    }
+
+    out.resize(m_pop.size() * n_points);
+
+    for (decltype(m_pop.size()) idx = 0; idx < m_pop.size(); ++idx) {
+        eval_batch(idx, out.data() + idx * n_points, in.data(), n_points, pars.data());
+    }
+}
+
+// Explicit instantiations.
+template class compiled_population<double>;
+template class compiled_population<long double>;
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+template class compiled_population<mppp::real128>;
+
+#endif
+
+} // namespace heyoka
@@ -0,0 +1,592 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <heyoka/config.hpp>
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <istream>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <heyoka/binary_operator.hpp>
+#include <heyoka/detail/binary_io.hpp>
+#include <heyoka/detail/traversal.hpp>
+#include <heyoka/detail/type_traits.hpp>
+#include <heyoka/expression.hpp>
+#include <heyoka/func.hpp>
+#include <heyoka/math.hpp>
+#include <heyoka/number.hpp>
+#include <heyoka/param.hpp>
+#include <heyoka/variable.hpp>
+
+namespace heyoka::detail
+{
+
+void bin_save(std::ostream &os, const std::string &s)
+{
+    bin_save(os, static_cast<std::uint64_t>(s.size()));
+    os.write(s.data(), static_cast<std::streamsize>(s.size()));
+}
+
+void bin_load(std::istream &is, std::string &s)
+{
+    std::uint64_t size = 0;
+    bin_load(is, size);
+
+    // NOTE: read in chunks, so that we don't try to
+    // allocate huge amounts of memory if the size
+    // read from the stream is garbage.
+    std::string tmp;
+    char buffer[1024];
+    while (size > 0u) {
+        const auto n = size < sizeof(buffer) ? static_cast<std::size_t>(size) : sizeof(buffer);
+
+        if (!is.read(buffer, static_cast<std::streamsize>(n))) {
+            throw std::invalid_argument("Error reading binary data from an input stream");
+        }
+
+        tmp.append(buffer, n);
+        size -= n;
+    }
+
+    s = std::move(tmp);
+}
+
+namespace
+{
+
+// Map of the functions which can be deserialised. The
+// key is the function name, the value is a factory
+// function building the function from its arguments.
+// NOTE: the functions are constructed directly (rather
+// than via the math functions, e.g., heyoka::sin())
+// in order to avoid automatic simplifications.
+template <typename F>
+expression make_unary_func(std::vector<expression> &&args)
+{
+    if (args.size() != 1u) {
+        throw std::invalid_argument("Error deserialising a unary function: " + std::to_string(args.size())
+                                    + " argument(s) were found in the input stream");
+    }
+
+    return expression{func{F{std::move(args[0])}}};
+}
+
+using func_factory_t = std::function<expression(std::vector<expression> &&)>;
+
+const std::unordered_map<std::string, func_factory_t> &get_func_factories()
+{
+    static const std::unordered_map<std::string, func_factory_t> retval{
+        {"acos", make_unary_func<acos_impl>},
+        {"acosh", make_unary_func<acosh_impl>},
+        {"asin", make_unary_func<asin_impl>},
+        {"asinh", make_unary_func<asinh_impl>},
+        {"atan", make_unary_func<atan_impl>},
+        {"atanh", make_unary_func<atanh_impl>},
+        {"cos", make_unary_func<cos_impl>},
+        {"cosh", make_unary_func<cosh_impl>},
+        {"erf", make_unary_func<erf_impl>},
+        {"exp", make_unary_func<exp_impl>},
+        {"kepE",
+         [](std::vector<expression> &&args) {
+             if (args.size() != 2u) {
+                 throw std::invalid_argument("Error deserialising the kepE() function: " + std::to_string(args.size())
+                                             + " argument(s) were found in the input stream");
+             }
+
+             return expression{func{kepE_impl{std::move(args[0]), std::move(args[1])}}};
+         }},
+        {"log", make_unary_func<log_impl>},
+        {"pow",
+         [](std::vector<expression> &&args) {
+             if (args.size() != 2u) {
+                 throw std::invalid_argument("Error deserialising the pow() function: " + std::to_string(args.size())
+                                             + " argument(s) were found in the input stream");
+             }
+
+             return expression{func{pow_impl{std::move(args[0]), std::move(args[1])}}};
+         }},
+        {"sigmoid", make_unary_func<sigmoid_impl>},
+        {"sin", make_unary_func<sin_impl>},
+        {"sinh", make_unary_func<sinh_impl>},
+        {"sqrt", make_unary_func<sqrt_impl>},
+        {"square", make_unary_func<square_impl>},
+        {"sum", [](std::vector<expression> &&args) { return expression{func{sum_impl{std::move(args)}}}; }},
+        {"sum_sq", [](std::vector<expression> &&args) { return expression{func{sum_sq_impl{std::move(args)}}}; }},
+        {"tan", make_unary_func<tan_impl>},
+        {"tanh", make_unary_func<tanh_impl>},
+        {"tcos",
+         [](std::vector<expression> &&args) {
+             if (args.size() != 2u) {
+                 throw std::invalid_argument("Error deserialising the tcos() function: " + std::to_string(args.size())
+                                             + " argument(s) were found in the input stream");
+             }
+
+             return expression{func{tharm_impl{false, std::move(args[0]), std::move(args[1])}}};
+         }},
+        {"time",
+         [](std::vector<expression> &&args) {
+             if (!args.empty()) {
+                 throw std::invalid_argument("Error deserialising the time function: " + std::to_string(args.size())
+                                             + " argument(s) were found in the input stream");
+             }
+
+             return expression{func{time_impl{}}};
+         }},
+        {"tpoly", [](std::vector<expression> &&args) { return expression{func{tpoly_impl{std::move(args)}}}; }},
+        {"tsin",
+         [](std::vector<expression> &&args) {
+             if (args.size() != 2u) {
+                 throw std::invalid_argument("Error deserialising the tsin() function: " + std::to_string(args.size())
+                                             + " argument(s) were found in the input stream");
+             }
+
+             return expression{func{tharm_impl{true, std::move(args[0]), std::move(args[1])}}};
+         }}};
+
+    return retval;
+}
+
+} // namespace
+
+// NOTE: expressions are written as the index of the active
+// member of the variant, followed by the content of the member.
+void bin_save(std::ostream &os, const expression &e)
+{
+    bin_save(os, static_cast<std::uint8_t>(e.value().index()));
+
+    std::visit(
+        [&os](const auto &v) {
+            using type = uncvref_t<decltype(v)>;
+
+            if constexpr (std::is_same_v<type, number>) {
+                bin_save(os, static_cast<std::uint8_t>(v.value().index()));
+                std::visit([&os](const auto &x) { bin_save(os, x); }, v.value());
+            } else if constexpr (std::is_same_v<type, variable>) {
+                bin_save(os, v.name());
+            } else if constexpr (std::is_same_v<type, binary_operator>) {
+                bin_save(os, v.op());
+                bin_save(os, v.lhs());
+                bin_save(os, v.rhs());
+            } else if constexpr (std::is_same_v<type, func>) {
+                if (get_func_factories().count(v.get_name()) == 0u) {
+                    throw std::invalid_argument("The function '" + v.get_name() + "' cannot be serialised");
+                }
+
+                bin_save(os, v.get_name());
+                bin_save(os, v.args());
+            } else if constexpr (std::is_same_v<type, param>) {
+                bin_save(os, v.idx());
+                bin_save(os, static_cast<std::uint8_t>(v.is_shared()));
+            } else {
+                static_assert(always_false_v<type>, "Unhandled type.");
+            }
+        },
+        e.value());
+}
+
+namespace
+{
+
+// Load into e a number (idx == 0), a variable (idx == 1),
+// or a param (idx == 4), returning false for the other indices.
+bool bin_load_leaf(std::istream &is, std::uint8_t idx, expression &e)
+{
+    switch (idx) {
+        case 0: {
+            std::uint8_t n_idx = 0;
+            bin_load(is, n_idx);
+
+            switch (n_idx) {
+                case 0: {
+                    double x = 0;
+                    bin_load(is, x);
+                    e = expression{number{x}};
+                    break;
+                }
+                case 1: {
+                    long double x = 0;
+                    bin_load(is, x);
+                    e = expression{number{x}};
+                    break;
+                }
+#if defined(HEYOKA_HAVE_REAL128)
+                case 2: {
+                    mppp::real128 x;
+                    bin_load(is, x);
+                    e = expression{number{x}};
+                    break;
+                }
+#endif
+                default:
+                    throw std::invalid_argument("Invalid number type index " + std::to_string(n_idx)
+                                                + " detected while deserialising an expression");
+            }
+
+            break;
+        }
+        case 1: {
+            std::string name;
+            bin_load(is, name);
+            e = expression{variable{std::move(name)}};
+            break;
+        }
+        case 4: {
+            std::uint32_t p_idx = 0;
+            std::uint8_t shared = 0;
+            bin_load(is, p_idx);
+            bin_load(is, shared);
+            e = expression{param{p_idx, shared != 0u}};
+            break;
+        }
+        default:
+            return false;
+    }
+
+    return true;
+}
+
+binary_operator::type bin_load_op(std::istream &is)
+{
+    auto op = binary_operator::type::add;
+    bin_load(is, op);
+    if (op != binary_operator::type::add && op != binary_operator::type::sub && op != binary_operator::type::mul
+        && op != binary_operator::type::div) {
+        throw std::invalid_argument("Invalid binary operator type detected while deserialising an expression");
+    }
+
+    return op;
+}
+
+expression make_func(const std::string &name, std::vector<expression> &&args)
+{
+    const auto &facs = get_func_factories();
+    const auto it = facs.find(name);
+    if (it == facs.end()) {
+        throw std::invalid_argument("The function '" + name + "' cannot be deserialised");
+    }
+
+    return it->second(std::move(args));
+}
+
+} // namespace
+
+bool func_has_factory(const std::string &name)
+{
+    return get_func_factories().count(name) != 0u;
+}
+
+expression func_from_factory(const std::string &name, std::vector<expression> &&args)
+{
+    return make_func(name, std::move(args));
+}
+
+void bin_load(std::istream &is, expression &e)
+{
+    std::uint8_t idx = 0;
+    bin_load(is, idx);
+
+    if (bin_load_leaf(is, idx, e)) {
+        return;
+    }
+
+    switch (idx) {
+        case 2: {
+            const auto op = bin_load_op(is);
+
+            expression lhs, rhs;
+            bin_load(is, lhs);
+            bin_load(is, rhs);
+            e = expression{binary_operator{op, std::move(lhs), std::move(rhs)}};
+            break;
+        }
+        case 3: {
+            std::string name;
+            bin_load(is, name);
+
+            std::vector<expression> args;
+            bin_load(is, args);
+            e = make_func(name, std::move(args));
+            break;
+        }
+        default:
+            throw std::invalid_argument("Invalid type index " + std::to_string(idx)
+                                        + " detected while deserialising an expression");
+    }
+}
+
+namespace
+{
+
+// NOTE: in the DAG format, the unique nodes of a set of root expressions are
+// written in post-order (so that the arguments of a node precede the node), followed
+// by the ids of the roots. The id of a node is its position in the sequence. Each node
+// is written as the index of the active member of the variant, followed by:
+// - for numbers, variables and params, the content of the member (as in the tree format),
+// - for binary operators, the operator and the ids of the arguments,
+// - for functions, the name, the number of arguments and their ids.
+// The nodes shared among the roots (or within a root), and the repeated
+// variables and params, are written once, and the shared nodes are
+// shared again after loading.
+void dag_save(std::ostream &os, const std::string &tag, const std::vector<const expression *> &roots)
+{
+    bin_save(os, tag);
+    bin_save(os, std::string{HEYOKA_VERSION_STRING});
+
+    // NOTE: the nodes are first written into a buffer,
+    // as their number is known only at the end of the traversal.
+    std::ostringstream buf;
+    std::uint64_t n_nodes = 0;
+
+    std::unordered_map<std::string, std::uint64_t> var_ids;
+    // NOTE: the key of a param is its index, shifted
+    // left by one bit and tagged with the shared flag.
+    std::unordered_map<std::uint64_t, std::uint64_t> par_ids;
+
+    auto leaf = [&](const expression &ex) -> std::uint64_t {
+        if (const auto *p_var = std::get_if<variable>(&ex.value())) {
+            if (const auto it = var_ids.find(p_var->name()); it != var_ids.end()) {
+                return it->second;
+            }
+
+            var_ids.emplace(p_var->name(), n_nodes);
+        } else if (const auto *p_par = std::get_if<param>(&ex.value())) {
+            const auto key
+                = (static_cast<std::uint64_t>(p_par->idx()) << 1) | static_cast<std::uint64_t>(p_par->is_shared());
+
+            if (const auto it = par_ids.find(key); it != par_ids.end()) {
+                return it->second;
+            }
+
+            par_ids.emplace(key, n_nodes);
+        } else {
+            assert(std::holds_alternative<number>(ex.value()));
+        }
+
+        bin_save(buf, ex);
+
+        return n_nodes++;
+    };
+
+    auto node = [&](const expression &ex, const std::uint64_t *args) -> std::uint64_t {
+        bin_save(buf, static_cast<std::uint8_t>(ex.value().index()));
+
+        std::visit(
+            [&](const auto &v) {
+                using type = uncvref_t<decltype(v)>;
+
+                if constexpr (std::is_same_v<type, binary_operator>) {
+                    bin_save(buf, v.op());
+                    bin_save(buf, args[0]);
+                    bin_save(buf, args[1]);
+                } else if constexpr (std::is_same_v<type, func>) {
+                    if (get_func_factories().count(v.get_name()) == 0u) {
+                        throw std::invalid_argument("The function '" + v.get_name() + "' cannot be serialised");
+                    }
+
+                    bin_save(buf, v.get_name());
+                    bin_save(buf, static_cast<std::uint64_t>(v.args().size()));
+                    for (decltype(v.args().size()) i = 0; i < v.args().size(); ++i) {
+                        bin_save(buf, args[i]);
+                    }
+                } else {
+                    assert(false);
+                }
+            },
+            ex.value());
+
+        return n_nodes++;
+    };
+
+    // NOTE: the memo is shared among the roots, so that
+    // the nodes shared among them are written once.
+    std::unordered_map<const void *, std::uint64_t> memo;
+    std::vector<std::uint64_t> root_ids;
+    for (const auto *r : roots) {
+        root_ids.push_back(fold_postorder<std::uint64_t>(
+            *r, leaf, node, [](const expression &) { return true; }, memo));
+    }
+
+    bin_save(os, n_nodes);
+    const auto str = buf.str();
+    os.write(str.data(), static_cast<std::streamsize>(str.size()));
+    bin_save(os, root_ids);
+}
+
+std::vector<expression> dag_load(std::istream &is, const std::string &tag)
+{
+    std::string s_tag, version;
+
+    bin_load(is, s_tag);
+    if (s_tag != tag) {
+        throw std::invalid_argument("Error loading an object of type '" + tag
+                                    + "' from an input stream: the stream contains an object of type '" + s_tag
+                                    + "' instead");
+    }
+
+    bin_load(is, version);
+    if (version != HEYOKA_VERSION_STRING) {
+        throw std::invalid_argument("Error loading an object of type '" + tag
+                                    + "' from an input stream: the object was saved with heyoka version " + version
+                                    + ", but the current heyoka version is " + HEYOKA_VERSION_STRING);
+    }
+
+    std::uint64_t n_nodes = 0;
+    bin_load(is, n_nodes);
+
+    // NOTE: don't reserve() based on the size read from
+    // the stream, as it could be garbage.
+    std::vector<expression> nodes;
+
+    // Read the id of an already-loaded node.
+    auto load_node = [&is, &nodes]() -> const expression & {
+        std::uint64_t id = 0;
+        bin_load(is, id);
+
+        if (id >= nodes.size()) {
+            throw std::invalid_argument("Invalid node id " + std::to_string(id)
+                                        + " detected while deserialising an expression");
+        }
+
+        return nodes[static_cast<decltype(nodes.size())>(id)];
+    };
+
+    for (std::uint64_t i = 0; i < n_nodes; ++i) {
+        std::uint8_t idx = 0;
+        bin_load(is, idx);
+
+        expression e;
+        if (!bin_load_leaf(is, idx, e)) {
+            switch (idx) {
+                case 2: {
+                    const auto op = bin_load_op(is);
+
+                    // NOTE: the copies of the arguments share their nodes.
+                    auto lhs = load_node();
+                    auto rhs = load_node();
+                    e = expression{binary_operator{op, std::move(lhs), std::move(rhs)}};
+                    break;
+                }
+                case 3: {
+                    std::string name;
+                    bin_load(is, name);
+
+                    std::uint64_t n_args = 0;
+                    bin_load(is, n_args);
+
+                    std::vector<expression> args;
+                    for (std::uint64_t j = 0; j < n_args; ++j) {
+                        args.push_back(load_node());
+                    }
+                    e = make_func(name, std::move(args));
+                    break;
+                }
+                default:
+                    throw std::invalid_argument("Invalid type index " + std::to_string(idx)
+                                                + " detected while deserialising an expression");
+            }
+        }
+
+        nodes.push_back(std::move(e));
+    }
+
+    std::uint64_t n_roots = 0;
+    bin_load(is, n_roots);
+
+    std::vector<expression> retval;
+    for (std::uint64_t i = 0; i < n_roots; ++i) {
+        retval.push_back(load_node());
+    }
+
+    return retval;
+}
+
+} // namespace
+
+} // namespace heyoka::detail
+
+namespace heyoka
+{
+
+void save_expression(std::ostream &os, const expression &e)
+{
+    detail::dag_save(os, "expression", {&e});
+}
+
+expression load_expression(std::istream &is)
+{
+    auto retval = detail::dag_load(is, "expression");
+    if (retval.size() != 1u) {
+        throw std::invalid_argument("Error loading an expression from an input stream: "
+                                    + std::to_string(retval.size()) + " expressions were found");
+    }
+
+    return std::move(retval[0]);
+}
+
+void save_expressions(std::ostream &os, const std::vector<expression> &v)
+{
+    std::vector<const expression *> roots;
+    for (const auto &e : v) {
+        roots.push_back(&e);
+    }
+
+    detail::dag_save(os, "expressions", roots);
+}
+
+std::vector<expression> load_expressions(std::istream &is)
+{
+    return detail::dag_load(is, "expressions");
+}
+
+// NOTE: the roots of a system are the lhs
+// and the rhs of the equations, interleaved.
+void save_sys(std::ostream &os, const std::vector<std::pair<expression, expression>> &sys)
+{
+    std::vector<const expression *> roots;
+    for (const auto &[lhs, rhs] : sys) {
+        roots.push_back(&lhs);
+        roots.push_back(&rhs);
+    }
+
+    detail::dag_save(os, "sys", roots);
+}
+
+std::vector<std::pair<expression, expression>> load_sys(std::istream &is)
+{
+    auto roots = detail::dag_load(is, "sys");
+    if (roots.size() % 2u != 0u) {
+        throw std::invalid_argument("Error loading a system of equations from an input stream: an odd number of "
+                                    "expressions was found");
+    }
+
+    std::vector<std::pair<expression, expression>> retval;
+    for (decltype(roots.size()) i = 0; i < roots.size(); i += 2u) {
+        retval.emplace_back(std::move(roots[i]), std::move(roots[i + 1u]));
+    }
+
+    return retval;
+}
+
+} // namespace heyoka
@@ -0,0 +1,169 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <heyoka/detail/visibility.hpp>
+
+namespace heyoka::detail
+{
+
+// The signature of the worker functions generated
+// by the JIT in parallel compact mode.
+using cm_par_worker_t = void (*)(std::uint32_t, std::uint32_t);
+
+namespace
+{
+
+// Minimal thread pool for the execution of the parallel
+// loops in the compact-mode Taylor integrators.
+//
+// The pool runs one loop at a time: the calling thread participates
+// in the execution of the loop, and the iterations are distributed
+// among the threads in chunks via an atomic counter. If the pool is busy
+// (e.g., because several integrators are being used concurrently
+// from different threads), the loop is executed in the calling thread.
+class cm_par_pool
+{
+    std::vector<std::thread> m_threads;
+    // Mutex serialising the submission of the loops.
+    std::mutex m_submit_mutex;
+    // Mutex and condition variables protecting the
+    // state of the current loop.
+    std::mutex m_mutex;
+    std::condition_variable m_cv_start, m_cv_done;
+    // The current loop.
+    cm_par_worker_t m_fptr = nullptr;
+    std::uint32_t m_ncalls = 0;
+    std::uint32_t m_grain = 1;
+    // NOTE: use a 64-bit counter so that the
+    // increments never overflow.
+    std::atomic<std::uint64_t> m_next{0};
+    // The number of pool threads still working on the current loop.
+    unsigned m_n_busy = 0;
+    // Counter of the submitted loops, used to wake up the pool threads.
+    std::uint64_t m_gen = 0;
+    bool m_stop = false;
+
+    void work()
+    {
+        const std::uint64_t ncalls = m_ncalls, grain = m_grain;
+
+        for (auto b = m_next.fetch_add(grain); b < ncalls; b = m_next.fetch_add(grain)) {
+            m_fptr(static_cast<std::uint32_t>(b), static_cast<std::uint32_t>(std::min(b + grain, ncalls)));
+        }
+    }
+
+    void thread_main()
+    {
+        std::uint64_t gen = 0;
+
+        while (true) {
+            {
+                std::unique_lock lock(m_mutex);
+                m_cv_start.wait(lock, [this, gen]() { return m_stop || m_gen != gen; });
+
+                if (m_stop) {
+                    return;
+                }
+
+                gen = m_gen;
+            }
+
+            work();
+
+            {
+                std::lock_guard lock(m_mutex);
+
+                if (--m_n_busy == 0u) {
+                    m_cv_done.notify_one();
+                }
+            }
+        }
+    }
+
+public:
+    cm_par_pool()
+    {
+        const auto n_threads = std::thread::hardware_concurrency();
+
+        try {
+            for (unsigned i = 1; i < n_threads; ++i) {
+                m_threads.emplace_back([this]() { thread_main(); });
+            }
+        } catch (...) {
+            // NOTE: if the creation of a thread fails, just
+            // go on with the threads created so far.
+        }
+    }
+    cm_par_pool(const cm_par_pool &) = delete;
+    cm_par_pool &operator=(const cm_par_pool &) = delete;
+    ~cm_par_pool()
+    {
+        {
+            std::lock_guard lock(m_mutex);
+            m_stop = true;
+        }
+        m_cv_start.notify_all();
+
+        for (auto &thr : m_threads) {
+            thr.join();
+        }
+    }
+
+    void run(std::uint32_t ncalls, cm_par_worker_t fptr)
+    {
+        std::unique_lock submit_lock(m_submit_mutex, std::try_to_lock);
+
+        if (!submit_lock.owns_lock() || m_threads.empty() || ncalls < 2u) {
+            fptr(0, ncalls);
+            return;
+        }
+
+        {
+            std::lock_guard lock(m_mutex);
+
+            m_fptr = fptr;
+            m_ncalls = ncalls;
+            // NOTE: split the loop in several chunks per thread,
+            // in order to even out the load.
+            m_grain = std::max(std::uint32_t(1), static_cast<std::uint32_t>(ncalls / (8u * (m_threads.size() + 1u))));
+            m_next.store(0);
+            m_n_busy = static_cast<unsigned>(m_threads.size());
+            ++m_gen;
+        }
+        m_cv_start.notify_all();
+
+        work();
+
+        std::unique_lock lock(m_mutex);
+        m_cv_done.wait(lock, [this]() { return m_n_busy == 0u; });
+    }
+};
+
+} // namespace
+
+} // namespace heyoka::detail
+
+// Run fptr(b, e) over chunks [b, e) covering the range [0, ncalls),
+// in parallel. This is invoked from the code generated by the
+// Taylor integrators in parallel compact mode.
+extern "C" HEYOKA_DLL_PUBLIC void heyoka_cm_par_looper(std::uint32_t ncalls,
+                                                       heyoka::detail::cm_par_worker_t fptr) noexcept
+{
+    // NOTE: the pool is created on first use.
+    static heyoka::detail::cm_par_pool pool;
+
+    pool.run(ncalls, fptr);
+}
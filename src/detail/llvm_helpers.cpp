@@ -10,15 +10,22 @@
 
 #include <algorithm>
 #include <cassert>
+#include <cmath>
+#include <cstddef>
 #include <cstdint>
 #include <functional>
 #include <initializer_list>
 #include <limits>
+#include <map>
+#include <mutex>
+#include <optional>
 #include <stdexcept>
 #include <string>
+#include <tuple>
 #include <typeindex>
 #include <typeinfo>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include <boost/numeric/conversion/cast.hpp>
@@ -32,9 +39,13 @@
 #include <llvm/IR/DataLayout.h>
 #include <llvm/IR/DerivedTypes.h>
 #include <llvm/IR/Function.h>
+#include <llvm/IR/GlobalVariable.h>
 #include <llvm/IR/IRBuilder.h>
 #include <llvm/IR/InstrTypes.h>
+#include <llvm/IR/Instructions.h>
 #include <llvm/IR/Intrinsics.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Metadata.h>
 #include <llvm/IR/Module.h>
 #include <llvm/IR/Type.h>
 #include <llvm/IR/Value.h>
@@ -50,6 +61,8 @@
 
 #include <heyoka/detail/llvm_fwd.hpp>
 #include <heyoka/detail/llvm_helpers.hpp>
+#include <heyoka/detail/sleef.hpp>
+#include <heyoka/func.hpp>
 #include <heyoka/llvm_state.hpp>
 
 namespace heyoka::detail
@@ -104,6 +117,21 @@ const auto type_map = []() {
     return retval;
 }();
 
+// Check if the in-memory layout of the vector type vector_t, whose
+// element type is elem_t, is the layout of an array of vector_t's elements.
+// In such case, a vector can be loaded/stored with a single memory
+// instruction from/to a (densely-packed) array of scalars.
+// NOTE: this is not the case for element types whose
+// alloc size is larger than their size (e.g., x86_fp80).
+bool vector_matches_array_layout(ir_builder &builder, llvm::Type *elem_t, llvm::Type *vector_t,
+                                 std::uint32_t vector_size)
+{
+    const auto &dl = builder.GetInsertBlock()->getModule()->getDataLayout();
+
+    return dl.getTypeSizeInBits(elem_t) == dl.getTypeAllocSizeInBits(elem_t)
+           && dl.getTypeAllocSizeInBits(vector_t) == dl.getTypeAllocSizeInBits(elem_t) * vector_size;
+}
+
 } // namespace
 
 // Implementation of the function to associate a C++ type to
@@ -137,9 +165,20 @@ llvm::Value *load_vector_from_memory(ir_builder &builder, llvm::Value *ptr, std:
     auto ptr_t = llvm::cast<llvm::PointerType>(ptr->getType());
 
     // Create the vector type.
-    auto vector_t = make_vector_type(ptr_t->getElementType(), vector_size);
+    auto elem_t = ptr_t->getElementType();
+    auto vector_t = make_vector_type(elem_t, vector_size);
     assert(vector_t != nullptr);
 
+    if (vector_matches_array_layout(builder, elem_t, vector_t, vector_size)) {
+        // Load the vector with a single instruction.
+        // NOTE: the alignment of the data in memory is
+        // guaranteed only to be the alignment of the scalar type.
+        const auto &dl = builder.GetInsertBlock()->getModule()->getDataLayout();
+        auto vptr = builder.CreateBitCast(ptr, llvm::PointerType::get(vector_t, ptr_t->getAddressSpace()));
+
+        return builder.CreateAlignedLoad(vector_t, vptr, dl.getABITypeAlign(elem_t));
+    }
+
     // Create the output vector.
     auto ret = static_cast<llvm::Value *>(llvm::UndefValue::get(vector_t));
 
@@ -153,20 +192,43 @@ llvm::Value *load_vector_from_memory(ir_builder &builder, llvm::Value *ptr, std:
 }
 
 // Helper to store the content of vector vec to the pointer ptr. If vec is not a vector,
-// a plain store will be performed.
-void store_vector_to_memory(ir_builder &builder, llvm::Value *ptr, llvm::Value *vec)
+// a plain store will be performed. If nontemporal is true, the stores are marked
+// as non-temporal (i.e., the stored values are not expected to be read back soon).
+void store_vector_to_memory(ir_builder &builder, llvm::Value *ptr, llvm::Value *vec, bool nontemporal)
 {
+    auto mark = [&builder, nontemporal](llvm::StoreInst *st) {
+        if (nontemporal) {
+            st->setMetadata(llvm::LLVMContext::MD_nontemporal,
+                            llvm::MDNode::get(builder.getContext(),
+                                              {llvm::ConstantAsMetadata::get(builder.getInt32(1))}));
+        }
+    };
+
     if (auto v_ptr_t = llvm::dyn_cast<llvm::VectorType>(vec->getType())) {
         // Determine the vector size.
         const auto vector_size = boost::numeric_cast<std::uint32_t>(v_ptr_t->getNumElements());
 
+        auto elem_t = v_ptr_t->getElementType();
+        if (vector_matches_array_layout(builder, elem_t, v_ptr_t, vector_size)) {
+            // Store the vector with a single instruction.
+            // NOTE: see the alignment considerations
+            // in load_vector_from_memory().
+            const auto &dl = builder.GetInsertBlock()->getModule()->getDataLayout();
+            auto ptr_t = llvm::cast<llvm::PointerType>(ptr->getType());
+            auto vptr = builder.CreateBitCast(ptr, llvm::PointerType::get(v_ptr_t, ptr_t->getAddressSpace()));
+
+            mark(builder.CreateAlignedStore(vec, vptr, dl.getABITypeAlign(elem_t)));
+
+            return;
+        }
+
         for (std::uint32_t i = 0; i < vector_size; ++i) {
-            builder.CreateStore(builder.CreateExtractElement(vec, i),
-                                builder.CreateInBoundsGEP(ptr, {builder.getInt32(i)}));
+            mark(builder.CreateStore(builder.CreateExtractElement(vec, i),
+                                     builder.CreateInBoundsGEP(ptr, {builder.getInt32(i)})));
         }
     } else {
         // Not a vector, store vec directly.
-        builder.CreateStore(vec, ptr);
+        mark(builder.CreateStore(vec, ptr));
     }
 }
 
@@ -270,6 +332,39 @@ llvm::Value *scalars_to_vector(ir_builder &builder, const std::vector<llvm::Valu
     return vec;
 }
 
+namespace
+{
+
+// The width of the SIMD vectors used in the vectorised
+// pairwise summation of scalar values.
+constexpr std::uint32_t pairwise_sum_vec_width = 4;
+
+// Horizontal reduction of the SIMD vector vec via a tree
+// of additions of its halves (the size of vec must be a power of 2).
+llvm::Value *pairwise_sum_hreduce(ir_builder &builder, llvm::Value *vec, std::uint32_t width)
+{
+    assert(width > 0u && (width & (width - 1u)) == 0u);
+
+    while (width != 1u) {
+        width /= 2u;
+
+        std::vector<int> lo_mask, hi_mask;
+        for (std::uint32_t i = 0; i < width; ++i) {
+            lo_mask.push_back(boost::numeric_cast<int>(i));
+            hi_mask.push_back(boost::numeric_cast<int>(i + width));
+        }
+
+        auto *lo = builder.CreateShuffleVector(vec, vec, lo_mask);
+        auto *hi = builder.CreateShuffleVector(vec, vec, hi_mask);
+
+        vec = builder.CreateFAdd(lo, hi);
+    }
+
+    return builder.CreateExtractElement(vec, static_cast<std::uint64_t>(0));
+}
+
+} // namespace
+
 // Pairwise summation of a vector of LLVM values.
 // https://en.wikipedia.org/wiki/Pairwise_summation
 llvm::Value *pairwise_sum(ir_builder &builder, std::vector<llvm::Value *> &sum)
@@ -280,6 +375,33 @@ llvm::Value *pairwise_sum(ir_builder &builder, std::vector<llvm::Value *> &sum)
         throw std::overflow_error("Overflow detected in pairwise_sum()");
     }
 
+    // NOTE: large sums of scalar floating-point values are packed
+    // into SIMD vectors, which are summed pairwise and then reduced
+    // horizontally. This way, the scalar code (e.g., batch_size == 1)
+    // performs the bulk of the additions via SIMD instructions, and
+    // the summation tree contains width times fewer additions.
+    // The leftover terms are summed as scalars.
+    // NOTE: the summation order is still a pairwise one, and thus
+    // the O(log(n)) error bound is preserved.
+    if (const auto tp = sum[0]->getType(); (tp->isFloatTy() || tp->isDoubleTy())
+                                           && sum.size() >= 2u * pairwise_sum_vec_width) {
+        const auto n_vec = sum.size() / pairwise_sum_vec_width;
+
+        std::vector<llvm::Value *> vec_sum, tmp;
+        for (decltype(sum.size()) i = 0; i < n_vec; ++i) {
+            tmp.assign(sum.begin() + static_cast<std::ptrdiff_t>(i * pairwise_sum_vec_width),
+                       sum.begin() + static_cast<std::ptrdiff_t>((i + 1u) * pairwise_sum_vec_width));
+
+            vec_sum.push_back(scalars_to_vector(builder, tmp));
+        }
+
+        std::vector<llvm::Value *> new_sum(sum.begin() + static_cast<std::ptrdiff_t>(n_vec * pairwise_sum_vec_width),
+                                           sum.end());
+        new_sum.push_back(pairwise_sum_hreduce(builder, pairwise_sum(builder, vec_sum), pairwise_sum_vec_width));
+
+        new_sum.swap(sum);
+    }
+
     while (sum.size() != 1u) {
         std::vector<llvm::Value *> new_sum;
 
@@ -300,6 +422,47 @@ llvm::Value *pairwise_sum(ir_builder &builder, std::vector<llvm::Value *> &sum)
     return sum[0];
 }
 
+// Compute a * b + c. If the target of s supports fma and the values are
+// single or double-precision (scalars or vectors), the computation is done via
+// the fma intrinsic (i.e., with a single rounding), otherwise via a multiplication
+// followed by an addition.
+// NOTE: the fma intrinsic is not used for the other floating-point types,
+// as it would be lowered to a (slow) call into the math library.
+llvm::Value *llvm_fma(llvm_state &s, llvm::Value *a, llvm::Value *b, llvm::Value *c)
+{
+    auto &builder = s.builder();
+
+    if (const auto tp = a->getType()->getScalarType();
+        get_target_features(s).fma && (tp->isFloatTy() || tp->isDoubleTy())) {
+        return llvm_invoke_intrinsic(s, "llvm.fma", {a->getType()}, {a, b, c});
+    } else {
+        return builder.CreateFAdd(builder.CreateFMul(a, b), c);
+    }
+}
+
+// Pairwise summation of the products a[i] * b[i]. The products
+// are grouped in pairs, each pair being computed via one multiplication
+// and one llvm_fma(), before the pairwise summation of the results.
+llvm::Value *pairwise_sum_prod(llvm_state &s, const std::vector<llvm::Value *> &a,
+                               const std::vector<llvm::Value *> &b)
+{
+    assert(!a.empty());
+    assert(a.size() == b.size());
+
+    auto &builder = s.builder();
+
+    std::vector<llvm::Value *> sum;
+    for (decltype(a.size()) i = 0; i < a.size(); i += 2u) {
+        if (i + 1u == a.size()) {
+            sum.push_back(builder.CreateFMul(a[i], b[i]));
+        } else {
+            sum.push_back(llvm_fma(s, a[i], b[i], builder.CreateFMul(a[i + 1u], b[i + 1u])));
+        }
+    }
+
+    return pairwise_sum(builder, sum);
+}
+
 // Helper to invoke an intrinsic function with arguments 'args'. 'types' are the argument type(s) for
 // overloaded intrinsics.
 llvm::Value *llvm_invoke_intrinsic(llvm_state &s, const std::string &name, const std::vector<llvm::Type *> &types,
@@ -428,6 +591,68 @@ llvm::Value *llvm_invoke_internal(llvm_state &s, const std::string &name, const
     return r;
 }
 
+namespace
+{
+
+// Add to the module of s a global array of n
+// zero-initialised 64-bit counters for the
+// profile-guided optimisation of the module.
+// NOTE: the counters have external linkage,
+// so that they can be looked up in the jit.
+llvm::GlobalVariable *pgo_add_counters(llvm_state &s, std::uint64_t n)
+{
+    auto *arr_t = llvm::ArrayType::get(s.builder().getInt64Ty(), n);
+
+    return new llvm::GlobalVariable(s.module(), arr_t, false, llvm::GlobalVariable::ExternalLinkage,
+                                    llvm::ConstantAggregateZero::get(arr_t), "heyoka.pgo");
+}
+
+// Create a metadata node referring to the counters.
+llvm::MDNode *pgo_md(llvm_state &s, llvm::GlobalVariable *counters)
+{
+    return llvm::MDNode::get(s.context(), {llvm::ValueAsMetadata::get(counters)});
+}
+
+// Add val (a 64-bit integer) to the counter at index idx.
+void pgo_increment(llvm_state &s, llvm::GlobalVariable *counters, std::uint32_t idx, llvm::Value *val)
+{
+    auto &builder = s.builder();
+
+    auto *ptr = builder.CreateConstInBoundsGEP2_32(counters->getValueType(), counters, 0, idx);
+
+    // NOTE: use atomic increments, as the compiled
+    // code may be run concurrently.
+#if LLVM_VERSION_MAJOR >= 13
+    auto *inc = builder.CreateAtomicRMW(llvm::AtomicRMWInst::Add, ptr, val, llvm::MaybeAlign(),
+                                        llvm::AtomicOrdering::Monotonic);
+#else
+    auto *inc = builder.CreateAtomicRMW(llvm::AtomicRMWInst::Add, ptr, val, llvm::AtomicOrdering::Monotonic);
+#endif
+
+    inc->setMetadata("heyoka.pgo.counter", llvm::MDNode::get(s.context(), {}));
+}
+
+// Instrument the entry of the function f, if needed.
+void pgo_instrument_entry(llvm_state &s, llvm::Function *f)
+{
+    if (f->getMetadata("heyoka.pgo.entry") != nullptr) {
+        return;
+    }
+
+    auto &builder = s.builder();
+
+    auto *counters = pgo_add_counters(s, 1);
+    f->setMetadata("heyoka.pgo.entry", pgo_md(s, counters));
+
+    auto &entry_bb = f->getEntryBlock();
+
+    llvm::IRBuilderBase::InsertPointGuard ipg(builder);
+    builder.SetInsertPoint(&entry_bb, entry_bb.getFirstInsertionPt());
+    pgo_increment(s, counters, 0, builder.getInt64(1));
+}
+
+} // namespace
+
 // Create an LLVM for loop in the form:
 //
 // for (auto i = begin; i < end; i = next_cur(i)) {
@@ -438,8 +663,61 @@ llvm::Value *llvm_invoke_internal(llvm_state &s, const std::string &name, const
 // if next_cur is not provided, is ++i.
 //
 // begin/end must be 32-bit unsigned integer values.
+//
+// If the instrumentation is enabled in s (see llvm_state::pgo_instrument()),
+// the number of times the loop is entered/skipped, the number of
+// iterations and the number of invocations of the
+// current function are counted.
+namespace
+{
+
+// Create the llvm.loop metadata node for the given hints
+// (or return null if there are no hints).
+llvm::MDNode *llvm_loop_md(llvm_state &s, const llvm_loop_hints &hints)
+{
+    auto &context = s.context();
+    auto &builder = s.builder();
+
+    // NOTE: the first operand is a placeholder
+    // for the self-reference.
+    std::vector<llvm::Metadata *> ops{nullptr};
+
+    auto add_hint = [&](const char *name, std::uint32_t n) {
+        ops.push_back(llvm::MDNode::get(
+            context, {llvm::MDString::get(context, name), llvm::ConstantAsMetadata::get(builder.getInt32(n))}));
+    };
+
+    if (hints.unroll_count == 1u) {
+        ops.push_back(llvm::MDNode::get(context, {llvm::MDString::get(context, "llvm.loop.unroll.disable")}));
+    } else if (hints.unroll_count > 1u) {
+        add_hint("llvm.loop.unroll.count", hints.unroll_count);
+    }
+
+    if (hints.vectorize_width > 0u) {
+        add_hint("llvm.loop.vectorize.width", hints.vectorize_width);
+    }
+
+    if (hints.interleave_count > 0u) {
+        add_hint("llvm.loop.interleave.count", hints.interleave_count);
+    }
+
+    if (ops.size() == 1u) {
+        return nullptr;
+    }
+
+    // NOTE: the loop id must be distinct and self-referential.
+    auto *loop_id = llvm::MDNode::getDistinct(context, ops);
+    loop_id->replaceOperandWith(0, loop_id);
+
+    return loop_id;
+}
+
+} // namespace
+
+// NOTE: the hints, if any, are attached to the branch
+// instruction at the end of the loop (the latch).
 void llvm_loop_u32(llvm_state &s, llvm::Value *begin, llvm::Value *end, const std::function<void(llvm::Value *)> &body,
-                   const std::function<llvm::Value *(llvm::Value *)> &next_cur)
+                   const std::function<llvm::Value *(llvm::Value *)> &next_cur, const llvm_loop_hints &hints)
 {
     assert(body);
     assert(begin->getType() == end->getType());
@@ -463,7 +741,23 @@ void llvm_loop_u32(llvm_state &s, llvm::Value *begin, llvm::Value *end, const st
     // In such a case, we will jump directly to after_bb.
     // NOTE: unsigned integral comparison.
     auto skip_cond = builder.CreateICmp(llvm::CmpInst::ICMP_UGE, begin, end);
-    builder.CreateCondBr(skip_cond, after_bb, loop_bb);
+
+    // Setup the instrumentation, if requested. The counters
+    // are [entered, skipped, iterations].
+    llvm::GlobalVariable *counters = nullptr;
+    if (s.pgo_instrumented()) {
+        pgo_instrument_entry(s, f);
+
+        counters = pgo_add_counters(s, 3);
+
+        pgo_increment(s, counters, 0, builder.CreateZExt(builder.CreateNot(skip_cond), builder.getInt64Ty()));
+        pgo_increment(s, counters, 1, builder.CreateZExt(skip_cond, builder.getInt64Ty()));
+    }
+
+    auto *skip_br = builder.CreateCondBr(skip_cond, after_bb, loop_bb);
+    if (counters != nullptr) {
+        skip_br->setMetadata("heyoka.pgo.skip", pgo_md(s, counters));
+    }
 
     // Get a reference to the current block for
     // later usage in the phi node.
@@ -477,6 +771,10 @@ void llvm_loop_u32(llvm_state &s, llvm::Value *begin, llvm::Value *end, const st
     auto cur = builder.CreatePHI(builder.getInt32Ty(), 2);
     cur->addIncoming(begin, preheader_bb);
 
+    if (counters != nullptr) {
+        pgo_increment(s, counters, 2, builder.getInt64(1));
+    }
+
     // Execute the loop body and the post-body code.
     llvm::Value *next;
     try {
@@ -505,7 +803,13 @@ void llvm_loop_u32(llvm_state &s, llvm::Value *begin, llvm::Value *end, const st
     f->getBasicBlockList().push_back(after_bb);
 
     // Insert the conditional branch into the end of loop_end_bb.
-    builder.CreateCondBr(end_cond, loop_bb, after_bb);
+    auto *latch_br = builder.CreateCondBr(end_cond, loop_bb, after_bb);
+    if (counters != nullptr) {
+        latch_br->setMetadata("heyoka.pgo.latch", pgo_md(s, counters));
+    }
+    if (auto *loop_id = llvm_loop_md(s, hints)) {
+        latch_br->setMetadata(llvm::LLVMContext::MD_loop, loop_id);
+    }
 
     // Any new code will be inserted in after_bb.
     builder.SetInsertPoint(after_bb);
@@ -647,30 +951,495 @@ llvm::Value *make_global_zero_array(llvm::Module &m, llvm::ArrayType *t)
     return gl_arr;
 }
 
+namespace
+{
+
+// Helper to compute a key identifying the content of the array constant init,
+// used for the interning of the global read-only arrays. The return value
+// is empty if the content of init cannot be inspected cheaply.
+std::optional<std::string> const_array_key(llvm::Constant *init)
+{
+    auto key = llvm_type_name(init->getType());
+
+    if (auto *cds = llvm::dyn_cast<llvm::ConstantDataSequential>(init)) {
+        key += cds->getRawDataValues().str();
+    } else if (llvm::isa<llvm::ConstantAggregateZero>(init)) {
+        key += "zero";
+    } else {
+        // NOTE: the arrays of long double and quadruple-precision
+        // values are not represented as sequential data.
+        for (const auto &op : init->operands()) {
+            if (auto *cfp = llvm::dyn_cast<llvm::ConstantFP>(op)) {
+                const auto ai = cfp->getValueAPF().bitcastToAPInt();
+                key.append(reinterpret_cast<const char *>(ai.getRawData()), ai.getNumWords() * sizeof(std::uint64_t));
+            } else if (auto *ci = llvm::dyn_cast<llvm::ConstantInt>(op); ci != nullptr && ci->getBitWidth() <= 64u) {
+                const auto val = ci->getZExtValue();
+                key.append(reinterpret_cast<const char *>(&val), sizeof(val));
+            } else {
+                return {};
+            }
+        }
+    }
+
+    return key;
+}
+
+} // namespace
+
+// Helper to create a global read-only array variable in the module m with
+// initializer init and internal linkage. The arrays with the same content are
+// interned: if m already contains an array created by this function with the
+// same initializer, it is returned instead of a new one.
+// NOTE: the arrays are looked up via their names, which are derived from a hash
+// of their content. The constants are uniqued in the context, hence the
+// comparison of the initializers detects the hash collisions.
+llvm::GlobalVariable *make_global_const_array(llvm::Module &m, llvm::Constant *init)
+{
+    assert(init != nullptr);
+    assert(llvm::isa<llvm::ArrayType>(init->getType()));
+
+    const auto key = const_array_key(init);
+
+    const auto name = key ? "heyoka.const_arr." + std::to_string(std::hash<std::string>{}(*key)) : std::string{};
+
+    if (key) {
+        if (auto *gv = m.getNamedGlobal(name);
+            gv != nullptr && gv->isConstant() && gv->hasInitializer() && gv->getInitializer() == init) {
+            return gv;
+        }
+    }
+
+    auto *gv = new llvm::GlobalVariable(m, init->getType(), true, llvm::GlobalVariable::InternalLinkage, init, name);
+    // NOTE: the address of the array is not significant, which
+    // allows LLVM to merge the arrays which were not interned.
+    gv->setUnnamedAddr(llvm::GlobalValue::UnnamedAddr::Global);
+
+    return gv;
+}
+
+namespace
+{
+
+// The attributes of the invocations of the external
+// mathematical functions.
+// NOTE: in theory we may add ReadNone here as well,
+// but for some reason, at least up to LLVM 10,
+// this causes strange codegen issues. Revisit
+// in the future.
+const std::vector<int> ext_math_attrs
+    = {llvm::Attribute::NoUnwind, llvm::Attribute::Speculatable, llvm::Attribute::WillReturn};
+
+// Invoke on the vector arguments args (which must all be of the same type) the vector
+// implementations of a function listed in impls, as (width, name) pairs sorted by
+// decreasing width. If no implementation is available for the width of the arguments,
+// the arguments are split into chunks of the available widths (padding the last
+// chunk, if needed).
+llvm::Value *llvm_invoke_vector_impls(llvm_state &s, const std::vector<std::pair<std::uint32_t, std::string>> &impls,
+                                      const std::vector<llvm::Value *> &args)
+{
+    assert(!impls.empty());
+    assert(!args.empty());
+
+    auto &builder = s.builder();
+
+    auto *vec_t = llvm::cast<llvm::VectorType>(args[0]->getType());
+    auto *scal_t = vec_t->getElementType();
+    const auto n = boost::numeric_cast<std::uint32_t>(vec_t->getNumElements());
+
+    // The implementation is available for the full width.
+    if (const auto it = std::find_if(impls.begin(), impls.end(), [n](const auto &p) { return p.first == n; });
+        it != impls.end()) {
+        return llvm_invoke_external(s, it->second, vec_t, args, ext_math_attrs);
+    }
+
+    std::vector<llvm::Value *> res_scalars;
+    for (std::uint32_t offset = 0; offset < n;) {
+        const std::uint32_t rem = n - offset;
+
+        // Pick the widest chunk which fits in the remaining lanes. If there
+        // is none, pick the narrowest one and pad it.
+        const auto it = std::find_if(impls.begin(), impls.end(), [rem](const auto &p) { return p.first <= rem; });
+        const auto &[w, vfn] = (it == impls.end()) ? impls.back() : *it;
+        const auto n_used = std::min(w, rem);
+
+        // NOTE: the padding lanes repeat the last lane of the chunk.
+        std::vector<int> mask;
+        for (std::uint32_t k = 0; k < w; ++k) {
+            mask.push_back(boost::numeric_cast<int>(offset + std::min(k, n_used - 1u)));
+        }
+
+        std::vector<llvm::Value *> chunk_args;
+        for (auto *a : args) {
+            chunk_args.push_back(builder.CreateShuffleVector(a, a, mask));
+        }
+
+        auto *res = llvm_invoke_external(s, vfn, make_vector_type(scal_t, w), chunk_args, ext_math_attrs);
+
+        const auto scalars = vector_to_scalars(builder, res);
+        res_scalars.insert(res_scalars.end(), scalars.begin(), scalars.begin() + n_used);
+
+        offset += n_used;
+    }
+
+    return scalars_to_vector(builder, res_scalars);
+}
+
+// The registry of the vector implementations of the external
+// scalar functions (see register_vector_function()).
+struct vector_function_registry {
+    std::mutex m_mutex;
+    // NOTE: the implementations are sorted by decreasing width.
+    std::unordered_map<std::string, std::map<std::uint32_t, std::string, std::greater<>>> m_map;
+};
+
+vector_function_registry &get_vector_function_registry()
+{
+    static vector_function_registry reg;
+
+    return reg;
+}
+
+} // namespace
+
 // Helper to invoke an external function on a vector argument.
-// The function will be called on each element of the vector separately,
-// and the return will be re-assembled as a vector.
+// If vector implementations of the function were registered (see
+// register_vector_function()), they will be used. Otherwise, the function
+// will be called on each element of the vector separately, and the
+// return will be re-assembled as a vector.
 llvm::Value *call_extern_vec(llvm_state &s, llvm::Value *arg, const std::string &fname)
 {
     auto &builder = s.builder();
 
+    if (llvm::isa<llvm::VectorType>(arg->getType())) {
+        if (const auto impls = get_vector_functions(fname); !impls.empty()) {
+            return llvm_invoke_vector_impls(s, impls, {arg});
+        }
+    }
+
     // Decompose the argument into scalars.
     auto scalars = vector_to_scalars(builder, arg);
 
     // Invoke the function on each scalar.
     std::vector<llvm::Value *> retvals;
     for (auto scal : scalars) {
-        retvals.push_back(llvm_invoke_external(
-            s, fname, scal->getType(), {scal},
-            // NOTE: in theory we may add ReadNone here as well,
-            // but for some reason, at least up to LLVM 10,
-            // this causes strange codegen issues. Revisit
-            // in the future.
-            {llvm::Attribute::NoUnwind, llvm::Attribute::Speculatable, llvm::Attribute::WillReturn}));
+        retvals.push_back(llvm_invoke_external(s, fname, scal->getType(), {scal}, ext_math_attrs));
     }
 
     // Build a vector with the results.
     return scalars_to_vector(builder, retvals);
 }
 
+// Invoke the SLEEF implementation of the function f on the vector arguments args
+// (which must all be of the same type). If SLEEF does not provide an implementation
+// for the width of the arguments, the arguments are split into chunks of the widths
+// supported by SLEEF (padding the last chunk, if needed). If no SLEEF implementation
+// is available for f and the scalar type of the arguments, nullptr will be returned.
+llvm::Value *llvm_invoke_sleef(llvm_state &s, const std::string &f, const std::vector<llvm::Value *> &args)
+{
+    assert(!args.empty());
+
+    auto vec_t = llvm::dyn_cast<llvm::VectorType>(args[0]->getType());
+    if (vec_t == nullptr) {
+        return nullptr;
+    }
+
+    auto *scal_t = vec_t->getElementType();
+
+    // Determine the SIMD widths for which the SLEEF function
+    // is available, from the widest to the narrowest.
+    std::vector<std::pair<std::uint32_t, std::string>> impls;
+    for (std::uint32_t w = 16; w >= 2u; w /= 2u) {
+        if (auto sfn = sleef_function_name(s, f, scal_t, w); !sfn.empty()) {
+            impls.emplace_back(w, std::move(sfn));
+        }
+    }
+
+    if (impls.empty()) {
+        return nullptr;
+    }
+
+    return llvm_invoke_vector_impls(s, impls, args);
+}
+
+// Compute sin(x) and cos(x) with a single invocation of the SLEEF sincos()
+// function. If no SLEEF sincos() is available for the type of x, a pair
+// of null pointers will be returned.
+//
+// NOTE: the SLEEF function is invoked via an internal wrapper which is marked
+// as not accessing memory and which is never inlined. This allows LLVM to
+// merge the invocations of the wrapper with the same argument (e.g., from the
+// Taylor derivatives of order 0 of sin(x) and cos(x)) into a single call.
+std::pair<llvm::Value *, llvm::Value *> llvm_sleef_sincos(llvm_state &s, llvm::Value *x)
+{
+    auto vec_t = llvm::dyn_cast<llvm::VectorType>(x->getType());
+    if (vec_t == nullptr) {
+        return {nullptr, nullptr};
+    }
+
+    const auto sfn = sleef_function_name(s, "sincos", vec_t->getElementType(),
+                                         boost::numeric_cast<std::uint32_t>(vec_t->getNumElements()));
+    if (sfn.empty()) {
+        return {nullptr, nullptr};
+    }
+
+    auto &md = s.module();
+    auto &builder = s.builder();
+    auto &context = s.context();
+
+    // The return type of the wrapper, which mirrors the
+    // struct returned by the SLEEF function.
+    auto *ret_t = llvm::StructType::get(context, {vec_t, vec_t});
+
+    const auto wname = "heyoka_" + sfn;
+    auto *f = md.getFunction(wname);
+
+    if (f == nullptr) {
+        // Fetch the current insertion block.
+        auto orig_bb = builder.GetInsertBlock();
+
+        f = llvm::Function::Create(llvm::FunctionType::get(ret_t, {vec_t}, false), llvm::Function::InternalLinkage,
+                                   wname, &md);
+        assert(f != nullptr);
+        f->setDoesNotAccessMemory();
+        f->setDoesNotThrow();
+        f->addFnAttr(llvm::Attribute::WillReturn);
+        f->addFnAttr(llvm::Attribute::NoInline);
+
+        builder.SetInsertPoint(llvm::BasicBlock::Create(context, "entry", f));
+
+        // NOTE: the struct returned by the SLEEF function is larger
+        // than two eightbytes, and thus it is returned via memory
+        // (that is, via a pointer passed as first argument).
+        auto *sleef_f = md.getFunction(sfn);
+        if (sleef_f == nullptr) {
+            sleef_f = llvm::Function::Create(
+                llvm::FunctionType::get(builder.getVoidTy(), {llvm::PointerType::getUnqual(ret_t), vec_t}, false),
+                llvm::Function::ExternalLinkage, sfn, &md);
+            assert(sleef_f != nullptr);
+            sleef_f->addParamAttr(0, llvm::Attribute::getWithStructRetType(context, ret_t));
+            sleef_f->setDoesNotThrow();
+            sleef_f->addFnAttr(llvm::Attribute::WillReturn);
+        }
+
+        auto *res = builder.CreateAlloca(ret_t);
+        auto *call = builder.CreateCall(sleef_f, {res, f->args().begin()});
+        call->addParamAttr(0, llvm::Attribute::getWithStructRetType(context, ret_t));
+
+        builder.CreateRet(builder.CreateLoad(ret_t, res));
+
+        s.verify_function(f);
+
+        // Restore the original insertion block.
+        builder.SetInsertPoint(orig_bb);
+    }
+
+    auto *ret = builder.CreateCall(f, {x});
+
+    llvm::Value *sin_x = builder.CreateExtractValue(ret, {0});
+    llvm::Value *cos_x = builder.CreateExtractValue(ret, {1});
+
+    return {sin_x, cos_x};
+}
+
+namespace
+{
+
+// Error-free transformation of the sum a + b: the return value
+// is the pair (s, e) such that s = fl(a + b) and a + b = s + e exactly.
+// NOTE: the builder must have all the fast math flags turned off.
+std::pair<llvm::Value *, llvm::Value *> llvm_eft_sum(ir_builder &builder, llvm::Value *a, llvm::Value *b)
+{
+    auto *x = builder.CreateFAdd(a, b);
+    auto *z = builder.CreateFSub(x, a);
+    auto *y = builder.CreateFAdd(builder.CreateFSub(a, builder.CreateFSub(x, z)), builder.CreateFSub(b, z));
+
+    return {x, y};
+}
+
+// Same as llvm_eft_sum(), but requires |a| >= |b|.
+std::pair<llvm::Value *, llvm::Value *> llvm_eft_quick_sum(ir_builder &builder, llvm::Value *a, llvm::Value *b)
+{
+    auto *x = builder.CreateFAdd(a, b);
+    auto *y = builder.CreateFSub(b, builder.CreateFSub(x, a));
+
+    return {x, y};
+}
+
+// Veltkamp splitting of a: the return value is the pair (hi, lo) such that
+// a = hi + lo exactly, with hi and lo representable with half of the
+// bits of the significand.
+// NOTE: the builder must have all the fast math flags turned off.
+std::pair<llvm::Value *, llvm::Value *> llvm_veltkamp_split(ir_builder &builder, llvm::Value *a)
+{
+    auto *tp = a->getType();
+
+    // The splitter 2**ceil(p / 2) + 1, where p is the number
+    // of bits of the significand.
+    const auto n_bits = tp->getScalarType()->getFPMantissaWidth();
+    assert(n_bits > 0);
+    auto *splitter = llvm::ConstantFP::get(tp, std::ldexp(1., (n_bits + 1) / 2) + 1.);
+
+    auto *t = builder.CreateFMul(splitter, a);
+    auto *hi = builder.CreateFSub(t, builder.CreateFSub(t, a));
+    auto *lo = builder.CreateFSub(a, hi);
+
+    return {hi, lo};
+}
+
+// Error-free transformation of the product a * b: the return value
+// is the pair (p, e) such that p = fl(a * b) and a * b = p + e exactly.
+// The error term is computed via fma for single and double precision on
+// targets supporting fma, and via heyoka_fma128() for quadruple precision.
+// Otherwise (i.e., for x86 extended precision, which has no hardware fma,
+// and for the targets without fma), the error term is computed via Dekker's
+// product, in order to avoid the calls into the math library.
+// NOTE: Dekker's product is exact in the absence of overflow and underflow.
+// NOTE: the builder must have all the fast math flags turned off.
+std::pair<llvm::Value *, llvm::Value *> llvm_eft_product(llvm_state &s, llvm::Value *a, llvm::Value *b)
+{
+    auto &builder = s.builder();
+
+    auto *x = builder.CreateFMul(a, b);
+
+    auto *scal_t = a->getType()->getScalarType();
+
+    if (get_target_features(s).fma && (scal_t->isFloatTy() || scal_t->isDoubleTy())) {
+        auto *y = llvm_invoke_intrinsic(s, "llvm.fma", {a->getType()}, {a, b, builder.CreateFNeg(x)});
+
+        return {x, y};
+    }
+
+#if defined(HEYOKA_HAVE_REAL128)
+    if (scal_t == llvm::Type::getFP128Ty(s.context())) {
+        // NOTE: the fp128 fma intrinsic is not lowered
+        // correctly, call into heyoka_fma128() instead.
+        const auto a_scalars = vector_to_scalars(builder, a), b_scalars = vector_to_scalars(builder, b),
+                   mx_scalars = vector_to_scalars(builder, builder.CreateFNeg(x));
+
+        std::vector<llvm::Value *> y_scalars;
+        for (decltype(a_scalars.size()) i = 0; i < a_scalars.size(); ++i) {
+            y_scalars.push_back(llvm_invoke_external(
+                s, "heyoka_fma128", scal_t, {a_scalars[i], b_scalars[i], mx_scalars[i]},
+                // NOTE: in theory we may add ReadNone here as well,
+                // but for some reason, at least up to LLVM 10,
+                // this causes strange codegen issues. Revisit
+                // in the future.
+                {llvm::Attribute::NoUnwind, llvm::Attribute::Speculatable, llvm::Attribute::WillReturn}));
+        }
+
+        return {x, scalars_to_vector(builder, y_scalars)};
+    }
+#endif
+
+    // Dekker's product.
+    const auto [a_hi, a_lo] = llvm_veltkamp_split(builder, a);
+    const auto [b_hi, b_lo] = llvm_veltkamp_split(builder, b);
+
+    auto *y = builder.CreateFSub(builder.CreateFMul(a_hi, b_hi), x);
+    y = builder.CreateFAdd(y, builder.CreateFMul(a_hi, b_lo));
+    y = builder.CreateFAdd(y, builder.CreateFMul(a_lo, b_hi));
+    y = builder.CreateFAdd(y, builder.CreateFMul(a_lo, b_lo));
+
+    return {x, y};
+}
+
+} // namespace
+
+// Addition of the double-length numbers x_hi + x_lo and y_hi + y_lo.
+// NOTE: the double-length addition relies on the exact IEEE semantics
+// of the floating-point operations, hence the fast math flags of the
+// builder (including fp contraction) are turned off in its implementation.
+std::pair<llvm::Value *, llvm::Value *> llvm_dl_add(llvm_state &state, llvm::Value *x_hi, llvm::Value *x_lo,
+                                                    llvm::Value *y_hi, llvm::Value *y_lo)
+{
+    auto &builder = state.builder();
+
+    llvm::IRBuilderBase::FastMathFlagGuard fmf_guard(builder);
+    builder.setFastMathFlags(llvm::FastMathFlags{});
+
+    auto [s, e] = llvm_eft_sum(builder, x_hi, y_hi);
+    auto [t, f] = llvm_eft_sum(builder, x_lo, y_lo);
+
+    e = builder.CreateFAdd(e, t);
+    std::tie(s, e) = llvm_eft_quick_sum(builder, s, e);
+    e = builder.CreateFAdd(e, f);
+
+    return llvm_eft_quick_sum(builder, s, e);
+}
+
+// Step of the compensated Horner scheme for the evaluation of a polynomial at x:
+// given the current value r and the current error term c, return the pair
+// (fl(r * x + cf), c * x + rounding errors of r * x + cf). At the end of the
+// evaluation, the sum of the two values approximates the value of the polynomial
+// as if it had been computed in twice the working precision.
+// See Graillat, Langlois, Louvet, "Compensated Horner Scheme" (2005).
+std::pair<llvm::Value *, llvm::Value *> llvm_comp_horner_step(llvm_state &s, llvm::Value *r, llvm::Value *c,
+                                                              llvm::Value *cf, llvm::Value *x)
+{
+    auto &builder = s.builder();
+
+    llvm::IRBuilderBase::FastMathFlagGuard fmf_guard(builder);
+    builder.setFastMathFlags(llvm::FastMathFlags{});
+
+    auto [p, pi] = llvm_eft_product(s, r, x);
+    auto [new_r, sigma] = llvm_eft_sum(builder, p, cf);
+
+    // NOTE: the rounding errors of the accumulation of the
+    // error term are negligible, thus llvm_fma() is used (which
+    // avoids the calls into the math library).
+    auto *new_c = llvm_fma(s, c, x, builder.CreateFAdd(pi, sigma));
+
+    return {new_r, new_c};
+}
+
 } // namespace heyoka::detail
+
+namespace heyoka
+{
+
+void register_vector_function(const std::string &name, std::uint32_t width, const std::string &vname)
+{
+    if (name.empty() || vname.empty()) {
+        throw std::invalid_argument("The names of a function and of its vector implementation cannot be empty");
+    }
+
+    if (width < 2u) {
+        throw std::invalid_argument("The SIMD width of the vector implementation '" + vname + "' of the function '"
+                                    + name + "' must be at least 2, but it is " + std::to_string(width) + " instead");
+    }
+
+    auto &reg = detail::get_vector_function_registry();
+
+    std::lock_guard lock(reg.m_mutex);
+
+    // NOTE: a previous registration for the same
+    // width is replaced.
+    reg.m_map[name][width] = vname;
+}
+
+void unregister_vector_functions(const std::string &name)
+{
+    auto &reg = detail::get_vector_function_registry();
+
+    std::lock_guard lock(reg.m_mutex);
+
+    reg.m_map.erase(name);
+}
+
+// NOTE: the implementations are returned as (width, name)
+// pairs sorted by decreasing width.
+std::vector<std::pair<std::uint32_t, std::string>> get_vector_functions(const std::string &name)
+{
+    auto &reg = detail::get_vector_function_registry();
+
+    std::lock_guard lock(reg.m_mutex);
+
+    const auto it = reg.m_map.find(name);
+    if (it == reg.m_map.end()) {
+        return {};
+    }
+
+    return {it->second.begin(), it->second.end()};
+}
+
+} // namespace heyoka
@@ -10,6 +10,8 @@
 
 #if defined(HEYOKA_WITH_SLEEF)
 
+#include <array>
+#include <cassert>
 #include <cstddef>
 #include <cstdint>
 #include <functional>
@@ -23,6 +25,7 @@
 
 #include <sleef.h>
 
+#include <heyoka/detail/fwd_decl.hpp>
 #include <heyoka/detail/llvm_fwd.hpp>
 #include <heyoka/detail/sleef.hpp>
 #include <heyoka/detail/visibility.hpp>
@@ -53,11 +56,10 @@ struct sleef_key_hasher {
 // sleef map type.
 using sleef_map_t = std::unordered_map<sleef_key_t, std::string, sleef_key_hasher>;
 
-// Helper to construct the sleef map for the double-precision type.
-auto make_sleef_map_dbl()
+// Helper to construct the sleef map for the double-precision type,
+// given the features of the target machine.
+auto make_sleef_map_dbl(const target_features &features)
 {
-    const auto &features = get_target_features();
-
     sleef_map_t retval;
 
     // sin().
@@ -300,6 +302,67 @@ auto make_sleef_map_dbl()
         retval[{"erf", 2}] = "Sleef_erfd2_u10sse2";
     }
 
+    // sincos().
+    // NOTE: the sincos() functions return the sine and the cosine
+    // of the argument as a pair of SIMD vectors.
+    if (features.avx512f) {
+        retval[{"sincos", 8}] = "Sleef_sincosd8_u10avx512f";
+        retval[{"sincos", 4}] = "Sleef_sincosd4_u10avx2";
+        retval[{"sincos", 2}] = "Sleef_sincosd2_u10avx2128";
+    } else if (features.avx2) {
+        retval[{"sincos", 4}] = "Sleef_sincosd4_u10avx2";
+        retval[{"sincos", 2}] = "Sleef_sincosd2_u10avx2128";
+    } else if (features.avx) {
+        retval[{"sincos", 4}] = "Sleef_sincosd4_u10avx";
+        retval[{"sincos", 2}] = "Sleef_sincosd2_u10sse4";
+    } else if (features.sse2) {
+        retval[{"sincos", 2}] = "Sleef_sincosd2_u10sse2";
+    }
+
+    return retval;
+}
+
+// Switch the functions in the sleef map m to the 3.5-ULP variants.
+// NOTE: only a subset of the functions have a 3.5-ULP variant, the
+// other functions are left as they are.
+sleef_map_t sleef_map_to_u35(sleef_map_t m)
+{
+    for (auto &[k, name] : m) {
+        const auto &fname = std::get<0>(k);
+
+        if (fname == "sin" || fname == "cos" || fname == "sincos" || fname == "tan" || fname == "asin"
+            || fname == "acos" || fname == "atan" || fname == "log" || fname == "sinh" || fname == "cosh"
+            || fname == "tanh") {
+            const auto pos = name.rfind("_u10");
+            assert(pos != std::string::npos);
+
+            name.replace(pos, 4, "_u35");
+        }
+    }
+
+    return m;
+}
+
+// Build the sleef maps for all the possible combinations of target
+// features and accuracy tiers. The combination of the target features
+// is encoded as a bitmask in the lowest 4 bits of the index, the accuracy
+// tier in the 5th bit.
+template <typename F>
+std::array<sleef_map_t, 32> make_sleef_maps(const F &maker)
+{
+    std::array<sleef_map_t, 32> retval;
+
+    for (unsigned i = 0; i < 16u; ++i) {
+        target_features tf;
+        tf.sse2 = (i & 1u) != 0u;
+        tf.avx = (i & 2u) != 0u;
+        tf.avx2 = (i & 4u) != 0u;
+        tf.avx512f = (i & 8u) != 0u;
+
+        retval[i] = maker(tf);
+        retval[i + 16u] = sleef_map_to_u35(retval[i]);
+    }
+
     return retval;
 }
 
@@ -307,21 +370,37 @@ auto make_sleef_map_dbl()
 
 // Fetch an appropriate sleef function name, given the name of the mathematical
 // function f, the desired SIMD width s and the scalar floating-point type t.
-// If no sleef function is available, return an empty string.
-std::string sleef_function_name(llvm::LLVMContext &c, const std::string &f, llvm::Type *t, std::uint32_t s)
+// The sleef function is selected according to the features of the target
+// machine and to the accuracy tier of the state st. If no sleef function
+// is available, return an empty string.
+std::string sleef_function_name(llvm_state &st, const std::string &f, llvm::Type *t, std::uint32_t s)
 {
-    if (t == llvm::Type::getDoubleTy(c)) {
-        static const auto sleef_map = detail::make_sleef_map_dbl();
+    // NOTE: the sleef maps are built once for all the possible
+    // combinations of target features and accuracy tiers.
+    static const auto sleef_maps_dbl = make_sleef_maps(make_sleef_map_dbl);
+
+    // NOTE: sleef does not provide vector implementations for
+    // extended-precision types, whose vector math calls are thus
+    // scalarised. The single-precision sleef functions are not
+    // mapped, as heyoka does not support single-precision floating-point
+    // types: they should be added together with a float integrator.
+    if (t != llvm::Type::getDoubleTy(st.context())) {
+        return "";
+    }
 
-        const auto it = sleef_map.find({f, s});
+    const auto &tf = get_target_features(st);
+    const auto u35 = st.get_sleef_accuracy() == sleef_accuracy::u35;
+    const auto &sleef_map
+        = sleef_maps_dbl[static_cast<unsigned>(tf.sse2) + (static_cast<unsigned>(tf.avx) << 1)
+                         + (static_cast<unsigned>(tf.avx2) << 2) + (static_cast<unsigned>(tf.avx512f) << 3)
+                         + (static_cast<unsigned>(u35) << 4)];
 
-        if (it == sleef_map.end()) {
-            return "";
-        } else {
-            return it->second;
-        }
-    } else {
+    const auto it = sleef_map.find({f, s});
+
+    if (it == sleef_map.end()) {
         return "";
+    } else {
+        return it->second;
     }
 }
 
@@ -343,9 +422,9 @@ HEYOKA_DLL_PUBLIC double sleef_dummy_f(double x)
 #include <cstdint>
 #include <string>
 
-#include <llvm/IR/LLVMContext.h>
 #include <llvm/IR/Type.h>
 
+#include <heyoka/detail/fwd_decl.hpp>
 #include <heyoka/detail/sleef.hpp>
 
 namespace heyoka::detail
@@ -353,7 +432,7 @@ namespace heyoka::detail
 
 // If heyoka is not configured with sleef support, sleef_function_name() will always return
 // an empty string.
-std::string sleef_function_name(llvm::LLVMContext &, const std::string &, llvm::Type *, std::uint32_t)
+std::string sleef_function_name(llvm_state &, const std::string &, llvm::Type *, std::uint32_t)
 {
     return "";
 }
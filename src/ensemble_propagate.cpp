@@ -0,0 +1,989 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <heyoka/config.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <heyoka/detail/run_workers.hpp>
+#include <heyoka/ensemble_propagate.hpp>
+#include <heyoka/executor.hpp>
+#include <heyoka/taylor.hpp>
+
+namespace heyoka
+{
+
+namespace detail
+{
+
+namespace
+{
+
+// Create in the calling worker thread the copy of the template integrator tmpl.
+// NOTE: the memory of the copy is allocated and first-touched by the worker thread,
+// so that, on NUMA machines, it is placed on the memory node of the worker. The copies
+// are serialised via the mutex, so that tmpl is never accessed concurrently while
+// the copies are being made.
+template <typename TA>
+TA &ensemble_make_worker(std::optional<TA> &worker, const TA &tmpl, std::mutex &mut)
+{
+    {
+        std::lock_guard lock(mut);
+
+        worker.emplace(tmpl);
+    }
+
+    return *worker;
+}
+
+} // namespace
+
+} // namespace detail
+
+template <typename T>
+ensemble_stats<T>::ensemble_stats() = default;
+
+template <typename T>
+ensemble_stats<T>::ensemble_stats(std::uint32_t dim)
+    : m_dim(dim), m_mean(dim), m_m2(static_cast<std::size_t>(dim) * dim), m_delta(dim)
+{
+}
+
+template <typename T>
+ensemble_stats<T>::ensemble_stats(std::uint32_t dim, std::uint32_t n_bins, std::vector<T> lb, std::vector<T> ub)
+    : ensemble_stats(dim)
+{
+    using std::isfinite;
+
+    if (n_bins == 0u) {
+        throw std::invalid_argument("The number of bins of the histograms of an ensemble_stats cannot be zero");
+    }
+
+    if (lb.size() != dim || ub.size() != dim) {
+        throw std::invalid_argument("The sizes of the bounds of the histograms of an ensemble_stats ("
+                                    + std::to_string(lb.size()) + " and " + std::to_string(ub.size())
+                                    + ") must be equal to the dimension (" + std::to_string(dim) + ")");
+    }
+
+    for (std::uint32_t i = 0; i < dim; ++i) {
+        if (!isfinite(lb[i]) || !isfinite(ub[i]) || !(lb[i] < ub[i])) {
+            throw std::invalid_argument("Invalid bounds for the histogram of the component " + std::to_string(i)
+                                        + " of an ensemble_stats: the bounds must be finite and the lower bound "
+                                          "must be less than the upper bound");
+        }
+    }
+
+    m_n_bins = n_bins;
+    m_lb = std::move(lb);
+    m_ub = std::move(ub);
+    m_hist.resize(static_cast<std::size_t>(dim) * n_bins);
+}
+
+template <typename T>
+void ensemble_stats<T>::add(const T *x, std::size_t stride)
+{
+    ++m_count;
+    const auto n = static_cast<T>(m_count);
+
+    // Update the mean, storing the deviations from the old mean.
+    for (std::uint32_t i = 0; i < m_dim; ++i) {
+        m_delta[i] = x[i * stride] - m_mean[i];
+        m_mean[i] += m_delta[i] / n;
+    }
+
+    // Update the sums of the products of the deviations (using
+    // the deviations from the old and from the new mean).
+    for (std::uint32_t i = 0; i < m_dim; ++i) {
+        for (std::uint32_t j = 0; j < m_dim; ++j) {
+            m_m2[static_cast<std::size_t>(i) * m_dim + j] += m_delta[i] * (x[j * stride] - m_mean[j]);
+        }
+    }
+
+    // Update the histograms.
+    // NOTE: the comparisons exclude also the NaNs.
+    for (std::uint32_t i = 0; m_n_bins != 0u && i < m_dim; ++i) {
+        const auto xi = x[i * stride];
+
+        if (xi >= m_lb[i] && xi < m_ub[i]) {
+            auto b = static_cast<std::size_t>((xi - m_lb[i]) / (m_ub[i] - m_lb[i]) * static_cast<T>(m_n_bins));
+            // NOTE: guard against the rounding errors at the upper bound.
+            b = std::min(b, static_cast<std::size_t>(m_n_bins - 1u));
+
+            ++m_hist[static_cast<std::size_t>(i) * m_n_bins + b];
+        }
+    }
+}
+
+// NOTE: the merging of the means and of the sums of
+// the products of the deviations is due to Chan et al.
+template <typename T>
+void ensemble_stats<T>::merge(const ensemble_stats &other)
+{
+    if (other.m_dim != m_dim || other.m_n_bins != m_n_bins || other.m_lb != m_lb || other.m_ub != m_ub) {
+        throw std::invalid_argument(
+            "Cannot merge two ensemble_stats with different dimensions or histogram configurations");
+    }
+
+    if (other.m_count == 0u) {
+        return;
+    }
+
+    const auto na = static_cast<T>(m_count), nb = static_cast<T>(other.m_count);
+    const auto n = na + nb;
+
+    for (std::uint32_t i = 0; i < m_dim; ++i) {
+        m_delta[i] = other.m_mean[i] - m_mean[i];
+    }
+
+    for (std::uint32_t i = 0; i < m_dim; ++i) {
+        for (std::uint32_t j = 0; j < m_dim; ++j) {
+            const auto idx = static_cast<std::size_t>(i) * m_dim + j;
+            m_m2[idx] += other.m_m2[idx] + m_delta[i] * m_delta[j] * (na * nb / n);
+        }
+    }
+
+    for (std::uint32_t i = 0; i < m_dim; ++i) {
+        m_mean[i] += m_delta[i] * (nb / n);
+    }
+
+    for (decltype(m_hist.size()) i = 0; i < m_hist.size(); ++i) {
+        m_hist[i] += other.m_hist[i];
+    }
+
+    m_count += other.m_count;
+}
+
+template <typename T>
+std::uint32_t ensemble_stats<T>::get_dim() const
+{
+    return m_dim;
+}
+
+template <typename T>
+std::size_t ensemble_stats<T>::get_count() const
+{
+    return m_count;
+}
+
+template <typename T>
+const std::vector<T> &ensemble_stats<T>::get_mean() const
+{
+    return m_mean;
+}
+
+template <typename T>
+std::vector<T> ensemble_stats<T>::get_cov() const
+{
+    if (m_count < 2u) {
+        throw std::invalid_argument("At least two samples are needed to compute the covariance matrix of an "
+                                    "ensemble_stats, but the number of samples is "
+                                    + std::to_string(m_count));
+    }
+
+    auto retval = m_m2;
+    const auto d = static_cast<T>(m_count - 1u);
+    for (auto &x : retval) {
+        x /= d;
+    }
+
+    return retval;
+}
+
+template <typename T>
+std::uint32_t ensemble_stats<T>::get_n_bins() const
+{
+    return m_n_bins;
+}
+
+template <typename T>
+const std::vector<T> &ensemble_stats<T>::get_lb() const
+{
+    return m_lb;
+}
+
+template <typename T>
+const std::vector<T> &ensemble_stats<T>::get_ub() const
+{
+    return m_ub;
+}
+
+template <typename T>
+const std::vector<std::size_t> &ensemble_stats<T>::get_hist() const
+{
+    return m_hist;
+}
+
+namespace detail
+{
+
+namespace
+{
+
+// Determine the number of worker threads for n_jobs independent jobs
+// (0 n_threads means the default number of threads, see thread_config).
+unsigned ensemble_n_threads(unsigned n_threads, std::size_t n_jobs)
+{
+    n_threads = detail::resolve_n_threads(n_threads);
+    if (n_threads > n_jobs) {
+        n_threads = static_cast<unsigned>(n_jobs);
+    }
+
+    return n_threads;
+}
+
+// Implementation of the scalar ensemble propagations: after the reset of the
+// worker ta and the invocation of gen, body(thread_idx, i, ta) propagates
+// and records the iteration i in the worker thread thread_idx.
+template <typename T, typename F>
+void ensemble_until_impl(const taylor_adaptive<T> &tmpl, std::size_t n_iter,
+                         const std::function<void(taylor_adaptive<T> &, std::size_t)> &gen, unsigned n_threads,
+                         const F &body)
+{
+    if (n_iter == 0u) {
+        return;
+    }
+
+    n_threads = ensemble_n_threads(n_threads, n_iter);
+
+    // The worker integrators, one per thread, which
+    // are created in the worker threads.
+    // NOTE: the copies share the compiled code with tmpl
+    // (unless compact mode is active).
+    std::vector<std::optional<taylor_adaptive<T>>> workers(n_threads);
+    std::mutex workers_mutex;
+
+    // The index of the next iteration to be processed.
+    // NOTE: the iterations are handed out dynamically one by one,
+    // so that the workload is balanced even if the propagation
+    // times differ wildly across iterations.
+    std::atomic<std::size_t> next_idx(0);
+
+    // The exceptions thrown in the worker threads, if any.
+    std::vector<std::exception_ptr> eptrs(n_threads);
+
+    // NOTE: the workers are pinned before creating their
+    // copies of tmpl (see thread_config).
+    const auto pinning = get_thread_config().pinning;
+
+    auto worker_func = [&](unsigned thread_idx) {
+        const detail::thread_pin_guard pg(pinning, thread_idx);
+
+        try {
+            auto &ta = detail::ensemble_make_worker(workers[thread_idx], tmpl, workers_mutex);
+
+            for (auto i = next_idx.fetch_add(1); i < n_iter; i = next_idx.fetch_add(1)) {
+                // Reset the worker to the template.
+                std::copy(tmpl.get_state().begin(), tmpl.get_state().end(), ta.get_state_data());
+                std::copy(tmpl.get_pars().begin(), tmpl.get_pars().end(), ta.get_pars_data());
+                ta.set_time(tmpl.get_time());
+                ta.reset_cooldowns();
+
+                // Invoke the generator.
+                gen(ta, i);
+
+                // Run the propagation and record the result.
+                body(thread_idx, i, ta);
+            }
+        } catch (...) {
+            eptrs[thread_idx] = std::current_exception();
+
+            // Stop the other workers.
+            next_idx.store(n_iter);
+        }
+    };
+
+    detail::run_workers(n_threads, worker_func, [&]() { next_idx.store(n_iter); }, eptrs);
+}
+
+// Check that the accumulator proto passed to the function fname
+// is empty and that its dimension is dim.
+template <typename T>
+void ensemble_check_stats(const ensemble_stats<T> &proto, std::uint32_t dim, const char *fname)
+{
+    if (proto.get_dim() != dim) {
+        throw std::invalid_argument(std::string{"The dimension of the statistics accumulator passed to "} + fname
+                                    + "() (" + std::to_string(proto.get_dim())
+                                    + ") does not match the dimension of the integrator ("
+                                    + std::to_string(dim) + ")");
+    }
+
+    if (proto.get_count() != 0u) {
+        throw std::invalid_argument(std::string{"The statistics accumulator passed to "} + fname
+                                    + "() must not contain any sample");
+    }
+}
+
+// Merge the per-thread accumulators into a copy of proto.
+template <typename T>
+ensemble_stats<T> ensemble_merge_stats(const ensemble_stats<T> &proto,
+                                       const std::vector<std::optional<ensemble_stats<T>>> &accs)
+{
+    auto retval = proto;
+
+    for (const auto &acc : accs) {
+        if (acc) {
+            retval.merge(*acc);
+        }
+    }
+
+    return retval;
+}
+
+// Merge the per-thread lists of the failed iterations.
+std::vector<std::size_t> ensemble_merge_failed(const std::vector<std::vector<std::size_t>> &failed)
+{
+    std::vector<std::size_t> retval;
+
+    for (const auto &f : failed) {
+        retval.insert(retval.end(), f.begin(), f.end());
+    }
+
+    std::sort(retval.begin(), retval.end());
+
+    return retval;
+}
+
+} // namespace
+
+} // namespace detail
+
+template <typename T>
+std::vector<std::tuple<taylor_outcome, T, T, std::size_t, T, std::vector<T>>>
+ensemble_propagate_until(const taylor_adaptive<T> &tmpl, T t, std::size_t n_iter,
+                         const std::function<void(taylor_adaptive<T> &, std::size_t)> &gen, std::size_t max_steps,
+                         unsigned n_threads)
+{
+    if (!gen) {
+        throw std::invalid_argument("Cannot invoke ensemble_propagate_until() with an empty generator");
+    }
+
+    std::vector<std::tuple<taylor_outcome, T, T, std::size_t, T, std::vector<T>>> retval(n_iter);
+
+    detail::ensemble_until_impl<T>(tmpl, n_iter, gen, n_threads, [&](unsigned, std::size_t i, taylor_adaptive<T> &ta) {
+        const auto [oc, min_h, max_h, n_steps] = ta.propagate_until(t, max_steps);
+        retval[i] = std::tuple{oc, min_h, max_h, n_steps, ta.get_time(), ta.get_state()};
+    });
+
+    return retval;
+}
+
+template <typename T>
+std::pair<ensemble_stats<T>, std::vector<std::size_t>>
+ensemble_propagate_until_stats(const taylor_adaptive<T> &tmpl, T t, std::size_t n_iter,
+                               const std::function<void(taylor_adaptive<T> &, std::size_t)> &gen,
+                               const ensemble_stats<T> &proto, std::size_t max_steps, unsigned n_threads)
+{
+    if (!gen) {
+        throw std::invalid_argument("Cannot invoke ensemble_propagate_until_stats() with an empty generator");
+    }
+
+    detail::ensemble_check_stats(proto, tmpl.get_dim(), "ensemble_propagate_until_stats");
+
+    // The per-thread accumulators and lists of the failed iterations.
+    const auto n_workers = detail::ensemble_n_threads(n_threads, n_iter);
+    std::vector<std::optional<ensemble_stats<T>>> accs(n_workers);
+    std::vector<std::vector<std::size_t>> failed(n_workers);
+
+    detail::ensemble_until_impl<T>(tmpl, n_iter, gen, n_threads,
+                                   [&](unsigned thread_idx, std::size_t i, taylor_adaptive<T> &ta) {
+                                       const auto oc = std::get<0>(ta.propagate_until(t, max_steps));
+
+                                       if (oc != taylor_outcome::time_limit) {
+                                           failed[thread_idx].push_back(i);
+                                           return;
+                                       }
+
+                                       auto &acc = accs[thread_idx];
+                                       if (!acc) {
+                                           acc.emplace(proto);
+                                       }
+                                       acc->add(ta.get_state().data());
+                                   });
+
+    return {detail::ensemble_merge_stats(proto, accs), detail::ensemble_merge_failed(failed)};
+}
+
+template <typename T>
+std::vector<ensemble_stats<T>>
+ensemble_propagate_grid_stats(const taylor_adaptive<T> &tmpl, const std::vector<T> &grid, std::size_t n_iter,
+                              const std::function<void(taylor_adaptive<T> &, std::size_t)> &gen,
+                              const ensemble_stats<T> &proto, std::size_t max_steps, unsigned n_threads)
+{
+    if (!gen) {
+        throw std::invalid_argument("Cannot invoke ensemble_propagate_grid_stats() with an empty generator");
+    }
+
+    detail::ensemble_check_stats(proto, tmpl.get_dim(), "ensemble_propagate_grid_stats");
+
+    const auto dim = tmpl.get_dim();
+
+    // The per-thread accumulators, one per grid point.
+    const auto n_workers = detail::ensemble_n_threads(n_threads, n_iter);
+    std::vector<std::vector<std::optional<ensemble_stats<T>>>> accs(n_workers);
+
+    detail::ensemble_until_impl<T>(
+        tmpl, n_iter, gen, n_threads, [&](unsigned thread_idx, std::size_t, taylor_adaptive<T> &ta) {
+            const auto states = std::get<4>(ta.propagate_grid(grid, max_steps));
+
+            auto &acc = accs[thread_idx];
+            acc.resize(grid.size());
+
+            // NOTE: only the grid points which were reached are recorded.
+            for (decltype(states.size()) k = 0; k < states.size() / dim; ++k) {
+                if (!acc[k]) {
+                    acc[k].emplace(proto);
+                }
+                acc[k]->add(states.data() + k * dim);
+            }
+        });
+
+    std::vector<ensemble_stats<T>> retval(grid.size(), proto);
+    for (const auto &acc : accs) {
+        for (decltype(acc.size()) k = 0; k < acc.size(); ++k) {
+            if (acc[k]) {
+                retval[k].merge(*acc[k]);
+            }
+        }
+    }
+
+    return retval;
+}
+
+namespace detail
+{
+
+namespace
+{
+
+// The number of worker threads of the batch ensemble propagations: each
+// worker should be able to fill up at least once all its batch slots.
+unsigned ensemble_batch_n_threads(unsigned n_threads, std::size_t n_iter, std::uint32_t batch_size)
+{
+    return ensemble_n_threads(n_threads, n_iter / batch_size + static_cast<std::size_t>(n_iter % batch_size != 0u));
+}
+
+// Implementation of ensemble_propagate_until_batch(), in which the final
+// time of the propagation of the iteration i is final_t(i). When the
+// propagation of the iteration i in the batch slot lane of the worker ta is
+// finished, write(thread_idx, i, outcome, min_h, max_h, n_steps, ta, lane)
+// records the result. fname is the name of the calling function, used in
+// the error messages.
+template <typename T, typename F, typename W>
+void ensemble_until_batch_impl(const taylor_adaptive_batch<T> &tmpl, std::size_t n_iter,
+                               const std::function<void(taylor_adaptive_batch<T> &, std::uint32_t, std::size_t)> &gen,
+                               const F &final_t, std::size_t max_steps, unsigned n_threads, const char *fname,
+                               const W &write)
+{
+    using std::abs;
+    using std::isfinite;
+
+    if (n_iter == 0u) {
+        return;
+    }
+
+    const auto batch_size = tmpl.get_batch_size();
+    const auto dim = tmpl.get_dim();
+    const auto n_pars = tmpl.get_pars().size() / batch_size;
+
+    n_threads = ensemble_batch_n_threads(n_threads, n_iter, batch_size);
+
+    // The worker integrators, one per thread, which
+    // are created in the worker threads.
+    std::vector<std::optional<taylor_adaptive_batch<T>>> workers(n_threads);
+    std::mutex workers_mutex;
+
+    // The index of the next iteration to be processed.
+    std::atomic<std::size_t> next_idx(0);
+
+    std::vector<std::exception_ptr> eptrs(n_threads);
+
+    // NOTE: the workers are pinned before creating their
+    // copies of tmpl (see thread_config).
+    const auto pinning = get_thread_config().pinning;
+
+    auto worker_func = [&](unsigned thread_idx) {
+        const detail::thread_pin_guard pg(pinning, thread_idx);
+
+        taylor_adaptive_batch<T> *ta_ptr = nullptr;
+        try {
+            ta_ptr = &detail::ensemble_make_worker(workers[thread_idx], tmpl, workers_mutex);
+        } catch (...) {
+            eptrs[thread_idx] = std::current_exception();
+            next_idx.store(n_iter);
+
+            return;
+        }
+        auto &ta = *ta_ptr;
+
+        // Reset the batch slot lane to the template.
+        auto reset_lane = [&](std::uint32_t lane) {
+            for (std::uint32_t j = 0; j < dim; ++j) {
+                ta.get_state_data()[j * batch_size + lane] = tmpl.get_state()[j * batch_size + lane];
+            }
+            for (decltype(tmpl.get_pars().size()) j = 0; j < n_pars; ++j) {
+                ta.get_pars_data()[j * batch_size + lane] = tmpl.get_pars()[j * batch_size + lane];
+            }
+            ta.get_time_data()[lane] = tmpl.get_time()[lane];
+        };
+
+        // The iteration currently being processed in each batch slot.
+        // A slot is inactive if its iteration index is n_iter.
+        std::vector<std::size_t> cur_iter(batch_size, n_iter);
+        // The final time of the iteration being processed in each batch slot.
+        std::vector<T> cur_final_t(batch_size);
+        // The per-slot step counters and min/max abs(h).
+        std::vector<std::size_t> ts_count(batch_size);
+        std::vector<T> min_abs_h(batch_size), max_abs_h(batch_size);
+        // The max timesteps passed to the stepper.
+        std::vector<T> max_delta_ts(batch_size);
+
+        // Fill the batch slot lane with the next pending iteration,
+        // if any. Return false if there are no more pending iterations.
+        auto fill_lane = [&](std::uint32_t lane) {
+            const auto i = next_idx.fetch_add(1);
+
+            // NOTE: reset the slot also if there are no more
+            // iterations, so that an inactive slot never contains
+            // non-finite values.
+            reset_lane(lane);
+
+            if (i >= n_iter) {
+                cur_iter[lane] = n_iter;
+                return false;
+            }
+
+            // Invoke the generator.
+            gen(ta, lane, i);
+
+            if (!isfinite(ta.get_time()[lane])) {
+                throw std::invalid_argument(std::string{"The generator passed to "} + fname
+                                            + "() produced a non-finite time for the iteration "
+                                            + std::to_string(i));
+            }
+
+            cur_iter[lane] = i;
+            cur_final_t[lane] = final_t(i);
+            ts_count[lane] = 0;
+            min_abs_h[lane] = std::numeric_limits<T>::infinity();
+            max_abs_h[lane] = 0;
+
+            return true;
+        };
+
+        try {
+            // Initial filling of the batch slots.
+            auto n_active = 0u;
+            for (std::uint32_t lane = 0; lane < batch_size; ++lane) {
+                n_active += static_cast<unsigned>(fill_lane(lane));
+            }
+
+            while (n_active > 0u) {
+                // Compute the max integration times for this timestep.
+                // Inactive slots are not propagated.
+                for (std::uint32_t lane = 0; lane < batch_size; ++lane) {
+                    max_delta_ts[lane] = cur_iter[lane] == n_iter ? T(0) : cur_final_t[lane] - ta.get_time()[lane];
+                }
+
+                const auto &step_res = ta.step(max_delta_ts);
+
+                for (std::uint32_t lane = 0; lane < batch_size; ++lane) {
+                    if (cur_iter[lane] == n_iter) {
+                        continue;
+                    }
+
+                    const auto [oc, h] = step_res[lane];
+
+                    // Determine if the propagation of the slot is finished,
+                    // and with which outcome.
+                    auto done = false;
+                    auto final_oc = oc;
+
+                    if (oc == taylor_outcome::success || oc == taylor_outcome::time_limit) {
+                        // NOTE: the step counters increase only if we integrated
+                        // for a non-zero time.
+                        ts_count[lane] += static_cast<std::size_t>(h != 0);
+
+                        if (oc == taylor_outcome::time_limit) {
+                            done = true;
+                        } else {
+                            min_abs_h[lane] = std::min(min_abs_h[lane], abs(h));
+                            max_abs_h[lane] = std::max(max_abs_h[lane], abs(h));
+
+                            if (max_steps != 0u && ts_count[lane] == max_steps) {
+                                done = true;
+                                final_oc = taylor_outcome::step_limit;
+                            }
+                        }
+                    } else {
+                        // Error condition.
+                        done = true;
+                    }
+
+                    if (done) {
+                        write(thread_idx, cur_iter[lane], final_oc, min_abs_h[lane], max_abs_h[lane], ts_count[lane],
+                              ta, lane);
+
+                        // Refill the slot.
+                        n_active -= static_cast<unsigned>(!fill_lane(lane));
+                    }
+                }
+            }
+        } catch (...) {
+            eptrs[thread_idx] = std::current_exception();
+
+            // Stop the other workers.
+            next_idx.store(n_iter);
+        }
+    };
+
+    detail::run_workers(n_threads, worker_func, [&]() { next_idx.store(n_iter); }, eptrs);
+}
+
+// Implementation of ensemble_propagate_until_batch() returning the result of each iteration.
+template <typename T, typename F>
+std::vector<std::tuple<taylor_outcome, T, T, std::size_t, T, std::vector<T>>>
+ensemble_until_batch_res(const taylor_adaptive_batch<T> &tmpl, std::size_t n_iter,
+                         const std::function<void(taylor_adaptive_batch<T> &, std::uint32_t, std::size_t)> &gen,
+                         const F &final_t, std::size_t max_steps, unsigned n_threads, const char *fname)
+{
+    const auto batch_size = tmpl.get_batch_size();
+    const auto dim = tmpl.get_dim();
+
+    std::vector<std::tuple<taylor_outcome, T, T, std::size_t, T, std::vector<T>>> retval(n_iter);
+
+    ensemble_until_batch_impl<T>(tmpl, n_iter, gen, final_t, max_steps, n_threads, fname,
+                                 [&](unsigned, std::size_t i, taylor_outcome oc, T min_h, T max_h, std::size_t n_steps,
+                                     const taylor_adaptive_batch<T> &ta, std::uint32_t lane) {
+                                     std::vector<T> st(dim);
+                                     for (std::uint32_t j = 0; j < dim; ++j) {
+                                         st[j] = ta.get_state()[j * batch_size + lane];
+                                     }
+
+                                     retval[i] = std::tuple{oc, min_h, max_h, n_steps, ta.get_time()[lane],
+                                                            std::move(st)};
+                                 });
+
+    return retval;
+}
+
+} // namespace
+
+} // namespace detail
+
+template <typename T>
+std::vector<std::tuple<taylor_outcome, T, T, std::size_t, T, std::vector<T>>>
+ensemble_propagate_until_batch(const taylor_adaptive_batch<T> &tmpl, T t, std::size_t n_iter,
+                               const std::function<void(taylor_adaptive_batch<T> &, std::uint32_t, std::size_t)> &gen,
+                               std::size_t max_steps, unsigned n_threads)
+{
+    using std::isfinite;
+
+    if (!gen) {
+        throw std::invalid_argument("Cannot invoke ensemble_propagate_until_batch() with an empty generator");
+    }
+
+    if (!isfinite(t)) {
+        throw std::invalid_argument("A non-finite time was passed to ensemble_propagate_until_batch()");
+    }
+
+    return detail::ensemble_until_batch_res<T>(
+        tmpl, n_iter, gen, [t](std::size_t) { return t; }, max_steps, n_threads, "ensemble_propagate_until_batch");
+}
+
+template <typename T>
+std::pair<ensemble_stats<T>, std::vector<std::size_t>> ensemble_propagate_until_batch_stats(
+    const taylor_adaptive_batch<T> &tmpl, T t, std::size_t n_iter,
+    const std::function<void(taylor_adaptive_batch<T> &, std::uint32_t, std::size_t)> &gen,
+    const ensemble_stats<T> &proto, std::size_t max_steps, unsigned n_threads)
+{
+    using std::isfinite;
+
+    if (!gen) {
+        throw std::invalid_argument("Cannot invoke ensemble_propagate_until_batch_stats() with an empty generator");
+    }
+
+    if (!isfinite(t)) {
+        throw std::invalid_argument("A non-finite time was passed to ensemble_propagate_until_batch_stats()");
+    }
+
+    detail::ensemble_check_stats(proto, tmpl.get_dim(), "ensemble_propagate_until_batch_stats");
+
+    const auto batch_size = tmpl.get_batch_size();
+
+    // The per-thread accumulators and lists of the failed iterations.
+    const auto n_workers = detail::ensemble_batch_n_threads(n_threads, n_iter, batch_size);
+    std::vector<std::optional<ensemble_stats<T>>> accs(n_workers);
+    std::vector<std::vector<std::size_t>> failed(n_workers);
+
+    detail::ensemble_until_batch_impl<T>(
+        tmpl, n_iter, gen, [t](std::size_t) { return t; }, max_steps, n_threads,
+        "ensemble_propagate_until_batch_stats",
+        [&](unsigned thread_idx, std::size_t i, taylor_outcome oc, T, T, std::size_t,
+            const taylor_adaptive_batch<T> &ta, std::uint32_t lane) {
+            if (oc != taylor_outcome::time_limit) {
+                failed[thread_idx].push_back(i);
+                return;
+            }
+
+            auto &acc = accs[thread_idx];
+            if (!acc) {
+                acc.emplace(proto);
+            }
+            // NOTE: the state of the slot is read in place
+            // from the state vector of the batch integrator.
+            acc->add(ta.get_state().data() + lane, batch_size);
+        });
+
+    return {detail::ensemble_merge_stats(proto, accs), detail::ensemble_merge_failed(failed)};
+}
+
+template <typename T>
+std::vector<std::tuple<taylor_outcome, T, T, std::size_t, T, std::vector<T>>>
+ensemble_propagate_jobs_batch(const taylor_adaptive_batch<T> &tmpl, const std::vector<propagate_job<T>> &jobs,
+                              std::size_t max_steps, unsigned n_threads)
+{
+    using std::isfinite;
+
+    const auto batch_size = tmpl.get_batch_size();
+    const auto dim = tmpl.get_dim();
+    const auto n_pars = tmpl.get_pars().size() / batch_size;
+
+    // Validate the jobs.
+    for (decltype(jobs.size()) i = 0; i < jobs.size(); ++i) {
+        const auto &job = jobs[i];
+
+        if (job.state.size() != dim) {
+            throw std::invalid_argument("Invalid state vector size in the job " + std::to_string(i)
+                                        + " passed to ensemble_propagate_jobs_batch(): the expected size is "
+                                        + std::to_string(dim) + ", but the size is "
+                                        + std::to_string(job.state.size()));
+        }
+
+        if (job.pars.size() != n_pars) {
+            throw std::invalid_argument("Invalid number of parameters in the job " + std::to_string(i)
+                                        + " passed to ensemble_propagate_jobs_batch(): the expected number is "
+                                        + std::to_string(n_pars) + ", but the number is "
+                                        + std::to_string(job.pars.size()));
+        }
+
+        if (!isfinite(job.time) || !isfinite(job.final_time)) {
+            throw std::invalid_argument("A non-finite time was detected in the job " + std::to_string(i)
+                                        + " passed to ensemble_propagate_jobs_batch()");
+        }
+    }
+
+    // Load the job i into the batch slot lane.
+    auto gen = [&jobs, dim, n_pars, batch_size](taylor_adaptive_batch<T> &ta, std::uint32_t lane, std::size_t i) {
+        const auto &job = jobs[i];
+
+        for (std::uint32_t j = 0; j < dim; ++j) {
+            ta.get_state_data()[j * batch_size + lane] = job.state[j];
+        }
+        for (decltype(job.pars.size()) j = 0; j < n_pars; ++j) {
+            ta.get_pars_data()[j * batch_size + lane] = job.pars[j];
+        }
+        ta.get_time_data()[lane] = job.time;
+    };
+
+    return detail::ensemble_until_batch_res<T>(
+        tmpl, jobs.size(), gen, [&jobs](std::size_t i) { return jobs[i].final_time; }, max_steps, n_threads,
+        "ensemble_propagate_jobs_batch");
+}
+
+template <typename T>
+std::pair<std::vector<taylor_outcome>, std::vector<T>>
+ensemble_sweep_pars_batch(const taylor_adaptive_batch<T> &tmpl, T t, const std::vector<T> &pars,
+                          std::size_t max_steps, unsigned n_threads)
+{
+    const auto batch_size = tmpl.get_batch_size();
+    const auto dim = tmpl.get_dim();
+    const auto n_pars = tmpl.get_pars().size() / batch_size;
+
+    if (n_pars == 0u) {
+        throw std::invalid_argument(
+            "Cannot invoke ensemble_sweep_pars_batch() with an integrator which does not have any parameter");
+    }
+
+    if (pars.size() % n_pars != 0u) {
+        throw std::invalid_argument("The size of the parameter matrix passed to ensemble_sweep_pars_batch() ("
+                                    + std::to_string(pars.size()) + ") is not a multiple of the number of parameters ("
+                                    + std::to_string(n_pars) + ")");
+    }
+
+    const auto n_sets = pars.size() / n_pars;
+
+    // Write the parameter set i into the batch slot lane.
+    auto gen = [&pars, n_pars, batch_size](taylor_adaptive_batch<T> &ta, std::uint32_t lane, std::size_t i) {
+        for (decltype(pars.size()) j = 0; j < n_pars; ++j) {
+            ta.get_pars_data()[j * batch_size + lane] = pars[i * n_pars + j];
+        }
+    };
+
+    auto res = ensemble_propagate_until_batch<T>(tmpl, t, n_sets, gen, max_steps, n_threads);
+
+    // Pack the results.
+    std::pair<std::vector<taylor_outcome>, std::vector<T>> retval;
+    retval.first.reserve(n_sets);
+    retval.second.reserve(n_sets * dim);
+
+    for (const auto &r : res) {
+        retval.first.push_back(std::get<0>(r));
+
+        const auto &st = std::get<5>(r);
+        retval.second.insert(retval.second.end(), st.begin(), st.end());
+    }
+
+    return retval;
+}
+
+// Explicit instantiations.
+template HEYOKA_DLL_PUBLIC
+    std::vector<std::tuple<taylor_outcome, double, double, std::size_t, double, std::vector<double>>>
+    ensemble_propagate_until(const taylor_adaptive<double> &, double, std::size_t,
+                             const std::function<void(taylor_adaptive<double> &, std::size_t)> &, std::size_t,
+                             unsigned);
+
+template HEYOKA_DLL_PUBLIC std::vector<std::tuple<taylor_outcome, long double, long double, std::size_t, long double,
+                                                  std::vector<long double>>>
+ensemble_propagate_until(const taylor_adaptive<long double> &, long double, std::size_t,
+                         const std::function<void(taylor_adaptive<long double> &, std::size_t)> &, std::size_t,
+                         unsigned);
+
+template HEYOKA_DLL_PUBLIC
+    std::vector<std::tuple<taylor_outcome, double, double, std::size_t, double, std::vector<double>>>
+    ensemble_propagate_until_batch(
+        const taylor_adaptive_batch<double> &, double, std::size_t,
+        const std::function<void(taylor_adaptive_batch<double> &, std::uint32_t, std::size_t)> &, std::size_t,
+        unsigned);
+
+template HEYOKA_DLL_PUBLIC std::vector<std::tuple<taylor_outcome, long double, long double, std::size_t, long double,
+                                                  std::vector<long double>>>
+ensemble_propagate_until_batch(
+    const taylor_adaptive_batch<long double> &, long double, std::size_t,
+    const std::function<void(taylor_adaptive_batch<long double> &, std::uint32_t, std::size_t)> &, std::size_t,
+    unsigned);
+
+template HEYOKA_DLL_PUBLIC
+    std::vector<std::tuple<taylor_outcome, double, double, std::size_t, double, std::vector<double>>>
+    ensemble_propagate_jobs_batch(const taylor_adaptive_batch<double> &, const std::vector<propagate_job<double>> &,
+                                  std::size_t, unsigned);
+
+template HEYOKA_DLL_PUBLIC std::vector<std::tuple<taylor_outcome, long double, long double, std::size_t, long double,
+                                                  std::vector<long double>>>
+ensemble_propagate_jobs_batch(const taylor_adaptive_batch<long double> &,
+                              const std::vector<propagate_job<long double>> &, std::size_t, unsigned);
+
+template HEYOKA_DLL_PUBLIC std::pair<std::vector<taylor_outcome>, std::vector<double>>
+ensemble_sweep_pars_batch(const taylor_adaptive_batch<double> &, double, const std::vector<double> &, std::size_t,
+                          unsigned);
+
+template HEYOKA_DLL_PUBLIC std::pair<std::vector<taylor_outcome>, std::vector<long double>>
+ensemble_sweep_pars_batch(const taylor_adaptive_batch<long double> &, long double, const std::vector<long double> &,
+                          std::size_t, unsigned);
+
+template class ensemble_stats<double>;
+
+template HEYOKA_DLL_PUBLIC std::pair<ensemble_stats<double>, std::vector<std::size_t>>
+ensemble_propagate_until_stats(const taylor_adaptive<double> &, double, std::size_t,
+                               const std::function<void(taylor_adaptive<double> &, std::size_t)> &,
+                               const ensemble_stats<double> &, std::size_t, unsigned);
+
+template HEYOKA_DLL_PUBLIC std::vector<ensemble_stats<double>>
+ensemble_propagate_grid_stats(const taylor_adaptive<double> &, const std::vector<double> &, std::size_t,
+                              const std::function<void(taylor_adaptive<double> &, std::size_t)> &,
+                              const ensemble_stats<double> &, std::size_t, unsigned);
+
+template HEYOKA_DLL_PUBLIC std::pair<ensemble_stats<double>, std::vector<std::size_t>>
+ensemble_propagate_until_batch_stats(
+    const taylor_adaptive_batch<double> &, double, std::size_t,
+    const std::function<void(taylor_adaptive_batch<double> &, std::uint32_t, std::size_t)> &,
+    const ensemble_stats<double> &, std::size_t, unsigned);
+
+template class ensemble_stats<long double>;
+
+template HEYOKA_DLL_PUBLIC std::pair<ensemble_stats<long double>, std::vector<std::size_t>>
+ensemble_propagate_until_stats(const taylor_adaptive<long double> &, long double, std::size_t,
+                               const std::function<void(taylor_adaptive<long double> &, std::size_t)> &,
+                               const ensemble_stats<long double> &, std::size_t, unsigned);
+
+template HEYOKA_DLL_PUBLIC std::vector<ensemble_stats<long double>>
+ensemble_propagate_grid_stats(const taylor_adaptive<long double> &, const std::vector<long double> &, std::size_t,
+                              const std::function<void(taylor_adaptive<long double> &, std::size_t)> &,
+                              const ensemble_stats<long double> &, std::size_t, unsigned);
+
+template HEYOKA_DLL_PUBLIC std::pair<ensemble_stats<long double>, std::vector<std::size_t>>
+ensemble_propagate_until_batch_stats(
+    const taylor_adaptive_batch<long double> &, long double, std::size_t,
+    const std::function<void(taylor_adaptive_batch<long double> &, std::uint32_t, std::size_t)> &,
+    const ensemble_stats<long double> &, std::size_t, unsigned);
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+template HEYOKA_DLL_PUBLIC std::vector<std::tuple<taylor_outcome, mppp::real128, mppp::real128, std::size_t,
+                                                  mppp::real128, std::vector<mppp::real128>>>
+ensemble_propagate_until(const taylor_adaptive<mppp::real128> &, mppp::real128, std::size_t,
+                         const std::function<void(taylor_adaptive<mppp::real128> &, std::size_t)> &, std::size_t,
+                         unsigned);
+
+template HEYOKA_DLL_PUBLIC std::vector<std::tuple<taylor_outcome, mppp::real128, mppp::real128, std::size_t,
+                                                  mppp::real128, std::vector<mppp::real128>>>
+ensemble_propagate_until_batch(
+    const taylor_adaptive_batch<mppp::real128> &, mppp::real128, std::size_t,
+    const std::function<void(taylor_adaptive_batch<mppp::real128> &, std::uint32_t, std::size_t)> &, std::size_t,
+    unsigned);
+
+template HEYOKA_DLL_PUBLIC std::vector<std::tuple<taylor_outcome, mppp::real128, mppp::real128, std::size_t,
+                                                  mppp::real128, std::vector<mppp::real128>>>
+ensemble_propagate_jobs_batch(const taylor_adaptive_batch<mppp::real128> &,
+                              const std::vector<propagate_job<mppp::real128>> &, std::size_t, unsigned);
+
+template HEYOKA_DLL_PUBLIC std::pair<std::vector<taylor_outcome>, std::vector<mppp::real128>>
+ensemble_sweep_pars_batch(const taylor_adaptive_batch<mppp::real128> &, mppp::real128,
+                          const std::vector<mppp::real128> &, std::size_t, unsigned);
+
+template class ensemble_stats<mppp::real128>;
+
+template HEYOKA_DLL_PUBLIC std::pair<ensemble_stats<mppp::real128>, std::vector<std::size_t>>
+ensemble_propagate_until_stats(const taylor_adaptive<mppp::real128> &, mppp::real128, std::size_t,
+                               const std::function<void(taylor_adaptive<mppp::real128> &, std::size_t)> &,
+                               const ensemble_stats<mppp::real128> &, std::size_t, unsigned);
+
+template HEYOKA_DLL_PUBLIC std::vector<ensemble_stats<mppp::real128>>
+ensemble_propagate_grid_stats(const taylor_adaptive<mppp::real128> &, const std::vector<mppp::real128> &, std::size_t,
+                              const std::function<void(taylor_adaptive<mppp::real128> &, std::size_t)> &,
+                              const ensemble_stats<mppp::real128> &, std::size_t, unsigned);
+
+template HEYOKA_DLL_PUBLIC std::pair<ensemble_stats<mppp::real128>, std::vector<std::size_t>>
+ensemble_propagate_until_batch_stats(
+    const taylor_adaptive_batch<mppp::real128> &, mppp::real128, std::size_t,
+    const std::function<void(taylor_adaptive_batch<mppp::real128> &, std::uint32_t, std::size_t)> &,
+    const ensemble_stats<mppp::real128> &, std::size_t, unsigned);
+
+#endif
+
+} // namespace heyoka
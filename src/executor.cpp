@@ -0,0 +1,557 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <heyoka/config.hpp>
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdlib>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include <fmt/format.h>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#if defined(__linux__)
+
+#include <pthread.h>
+#include <sched.h>
+
+#endif
+
+#include <heyoka/executor.hpp>
+#include <heyoka/taylor.hpp>
+
+namespace heyoka
+{
+
+std::ostream &operator<<(std::ostream &os, pin_policy p)
+{
+    switch (p) {
+        case pin_policy::none:
+            os << "none";
+            break;
+        case pin_policy::compact:
+            os << "compact";
+            break;
+        case pin_policy::scatter:
+            os << "scatter";
+            break;
+        default:
+            os << "invalid";
+    }
+
+    return os;
+}
+
+namespace detail
+{
+
+namespace
+{
+
+// Fetch the value of the environment variable name
+// (empty if the variable is not set).
+std::string thread_config_env(const char *name)
+{
+    const auto *ptr = std::getenv(name);
+
+    return ptr == nullptr ? std::string{} : std::string{ptr};
+}
+
+#if defined(__linux__)
+
+// Parse a list of CPUs (or NUMA nodes) in the sysfs format (e.g., "0-3,8,10-11").
+// NOTE: an empty list is returned if the format is not recognised.
+std::vector<unsigned> parse_cpu_list(const std::string &str)
+{
+    std::vector<unsigned> retval;
+
+    std::string::size_type pos = 0;
+    while (pos < str.size() && str[pos] != '\n') {
+        const auto end = std::min(str.find_first_of(",\n", pos), str.size());
+        const auto item = str.substr(pos, end - pos);
+        const auto dash = item.find('-');
+
+        try {
+            const auto first = std::stoul(item.substr(0, dash));
+            const auto last = dash == std::string::npos ? first : std::stoul(item.substr(dash + 1u));
+
+            if (last < first || last >= static_cast<unsigned long>(CPU_SETSIZE)) {
+                return {};
+            }
+
+            for (auto i = first; i <= last; ++i) {
+                retval.push_back(static_cast<unsigned>(i));
+            }
+        } catch (...) {
+            return {};
+        }
+
+        pos = end == str.size() ? end : end + 1u;
+    }
+
+    return retval;
+}
+
+// Read a list of CPUs (or NUMA nodes) from the sysfs file path
+// (empty if the file cannot be read).
+std::vector<unsigned> read_cpu_list(const std::string &path)
+{
+    std::ifstream ifs(path);
+    std::string line;
+
+    if (!std::getline(ifs, line)) {
+        return {};
+    }
+
+    return parse_cpu_list(line);
+}
+
+// Order the CPUs in the affinity mask of the calling thread according to the policy p.
+std::vector<unsigned> pin_cpu_order(pin_policy p)
+{
+    ::cpu_set_t set;
+    CPU_ZERO(&set);
+    if (::pthread_getaffinity_np(::pthread_self(), sizeof(set), &set) != 0) {
+        return {};
+    }
+
+    // The NUMA node and the index among the SMT siblings of each CPU.
+    // NOTE: if the topology is not available, all the CPUs are
+    // assumed to belong to node 0 and to different cores.
+    struct cpu_info {
+        unsigned cpu, node, smt;
+    };
+    std::vector<cpu_info> cpus;
+    for (unsigned c = 0; c < static_cast<unsigned>(CPU_SETSIZE); ++c) {
+        if (CPU_ISSET(c, &set)) {
+            const auto siblings
+                = read_cpu_list("/sys/devices/system/cpu/cpu" + std::to_string(c) + "/topology/thread_siblings_list");
+            const auto smt = std::find(siblings.begin(), siblings.end(), c);
+
+            cpus.push_back(cpu_info{c, 0, smt == siblings.end() ? 0u : static_cast<unsigned>(smt - siblings.begin())});
+        }
+    }
+
+    for (const auto node : read_cpu_list("/sys/devices/system/node/possible")) {
+        for (const auto c : read_cpu_list("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist")) {
+            for (auto &ci : cpus) {
+                if (ci.cpu == c) {
+                    ci.node = node;
+                }
+            }
+        }
+    }
+
+    std::vector<unsigned> retval;
+
+    if (p == pin_policy::compact) {
+        std::stable_sort(cpus.begin(), cpus.end(),
+                         [](const cpu_info &a, const cpu_info &b) { return a.node < b.node; });
+
+        for (const auto &ci : cpus) {
+            retval.push_back(ci.cpu);
+        }
+    } else {
+        // Within each node, the first SMT siblings (i.e., the physical cores) come first.
+        std::stable_sort(cpus.begin(), cpus.end(), [](const cpu_info &a, const cpu_info &b) {
+            return a.node < b.node || (a.node == b.node && a.smt < b.smt);
+        });
+
+        // Split the CPUs by node, and take them round-robin from the nodes.
+        std::vector<std::vector<unsigned>> nodes;
+        for (auto it = cpus.begin(); it != cpus.end(); ++it) {
+            if (it == cpus.begin() || it->node != (it - 1)->node) {
+                nodes.emplace_back();
+            }
+            nodes.back().push_back(it->cpu);
+        }
+
+        for (std::size_t i = 0; retval.size() < cpus.size(); ++i) {
+            for (const auto &node : nodes) {
+                if (i < node.size()) {
+                    retval.push_back(node[i]);
+                }
+            }
+        }
+    }
+
+    return retval;
+}
+
+// Set the affinity of the calling thread to the CPUs in cpus.
+bool set_thread_cpus(const std::vector<unsigned> &cpus)
+{
+    ::cpu_set_t set;
+    CPU_ZERO(&set);
+    for (const auto c : cpus) {
+        CPU_SET(c, &set);
+    }
+
+    return ::pthread_setaffinity_np(::pthread_self(), sizeof(set), &set) == 0;
+}
+
+#endif
+
+// The thread configuration, protected by a mutex.
+std::mutex thread_config_mutex;
+
+thread_config &thread_config_ref()
+{
+    static thread_config cfg = thread_config_from_env();
+
+    return cfg;
+}
+
+} // namespace
+
+thread_config thread_config_from_env()
+{
+    using namespace fmt::literals;
+
+    thread_config retval;
+
+    if (const auto n_str = thread_config_env("HEYOKA_NUM_THREADS"); !n_str.empty()) {
+        std::size_t pos = 0;
+        unsigned long n = 0;
+        try {
+            n = std::stoul(n_str, &pos);
+        } catch (...) {
+            pos = 0;
+        }
+
+        if (pos != n_str.size() || n > std::numeric_limits<unsigned>::max()) {
+            throw std::invalid_argument(
+                "Invalid value '{}' for the environment variable HEYOKA_NUM_THREADS: a non-negative integer "
+                "is expected"_format(n_str));
+        }
+
+        retval.n_threads = static_cast<unsigned>(n);
+    }
+
+    if (const auto p_str = thread_config_env("HEYOKA_PIN_POLICY"); !p_str.empty()) {
+        if (p_str == "none") {
+            retval.pinning = pin_policy::none;
+        } else if (p_str == "compact") {
+            retval.pinning = pin_policy::compact;
+        } else if (p_str == "scatter") {
+            retval.pinning = pin_policy::scatter;
+        } else {
+            throw std::invalid_argument("Invalid value '{}' for the environment variable HEYOKA_PIN_POLICY: the "
+                                        "valid values are 'none', 'compact' and 'scatter'"_format(p_str));
+        }
+    }
+
+    return retval;
+}
+
+unsigned resolve_n_threads(unsigned n_threads)
+{
+    if (n_threads == 0u) {
+        n_threads = get_thread_config().n_threads;
+    }
+
+    if (n_threads == 0u) {
+        n_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    return n_threads;
+}
+
+// NOTE: pinning is best-effort, and the errors
+// (e.g., restricted affinity changes) are ignored.
+thread_pin_guard::thread_pin_guard([[maybe_unused]] pin_policy p, [[maybe_unused]] unsigned idx)
+{
+#if defined(__linux__)
+    if (p == pin_policy::none) {
+        return;
+    }
+
+    try {
+        auto order = pin_cpu_order(p);
+        if (order.empty()) {
+            return;
+        }
+
+        const auto cpu = order[idx % order.size()];
+        m_orig_cpus = std::move(order);
+        m_pinned = set_thread_cpus({cpu});
+    } catch (...) {
+    }
+#endif
+}
+
+thread_pin_guard::~thread_pin_guard()
+{
+#if defined(__linux__)
+    if (m_pinned) {
+        set_thread_cpus(m_orig_cpus);
+    }
+#endif
+}
+
+bool thread_pin_guard::pinned() const
+{
+    return m_pinned;
+}
+
+} // namespace detail
+
+thread_config get_thread_config()
+{
+    std::lock_guard lock(detail::thread_config_mutex);
+
+    return detail::thread_config_ref();
+}
+
+void set_thread_config(const thread_config &cfg)
+{
+    if (cfg.pinning != pin_policy::none && cfg.pinning != pin_policy::compact && cfg.pinning != pin_policy::scatter) {
+        throw std::invalid_argument("Invalid pinning policy specified in the thread configuration");
+    }
+
+    std::lock_guard lock(detail::thread_config_mutex);
+
+    detail::thread_config_ref() = cfg;
+}
+
+struct executor::impl {
+    std::vector<std::thread> m_threads;
+    pin_policy m_pinning = pin_policy::none;
+    // Mutex and condition variable protecting
+    // the queue of the pending tasks.
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::deque<std::function<void()>> m_queue;
+    bool m_stop = false;
+
+    void thread_main(unsigned idx)
+    {
+        // NOTE: the workers are pinned for their whole lifetime.
+        const detail::thread_pin_guard pg(m_pinning, idx);
+
+        while (true) {
+            std::function<void()> task;
+
+            {
+                std::unique_lock lock(m_mutex);
+                m_cv.wait(lock, [this]() { return m_stop || !m_queue.empty(); });
+
+                // NOTE: the pending tasks are run
+                // before stopping.
+                if (m_queue.empty()) {
+                    return;
+                }
+
+                task = std::move(m_queue.front());
+                m_queue.pop_front();
+            }
+
+            try {
+                task();
+            } catch (...) {
+            }
+        }
+    }
+
+    void stop()
+    {
+        {
+            std::lock_guard lock(m_mutex);
+            m_stop = true;
+        }
+        m_cv.notify_all();
+
+        for (auto &thr : m_threads) {
+            thr.join();
+        }
+    }
+};
+
+executor::executor(unsigned n_threads) : executor(n_threads, get_thread_config().pinning) {}
+
+executor::executor(unsigned n_threads, pin_policy pinning) : m_impl(std::make_unique<impl>())
+{
+    if (pinning != pin_policy::none && pinning != pin_policy::compact && pinning != pin_policy::scatter) {
+        throw std::invalid_argument("Invalid pinning policy specified in the construction of an executor");
+    }
+
+    n_threads = detail::resolve_n_threads(n_threads);
+    m_impl->m_pinning = pinning;
+
+    try {
+        for (unsigned i = 0; i < n_threads; ++i) {
+            m_impl->m_threads.emplace_back([impl_ptr = m_impl.get(), i]() { impl_ptr->thread_main(i); });
+        }
+    } catch (...) {
+        // Stop the threads already created and re-throw.
+        m_impl->stop();
+
+        throw;
+    }
+}
+
+executor::~executor()
+{
+    m_impl->stop();
+}
+
+unsigned executor::get_n_threads() const
+{
+    return static_cast<unsigned>(m_impl->m_threads.size());
+}
+
+pin_policy executor::get_pin_policy() const
+{
+    return m_impl->m_pinning;
+}
+
+void executor::submit(std::function<void()> task)
+{
+    if (!task) {
+        throw std::invalid_argument("Cannot submit an empty task to an executor");
+    }
+
+    {
+        std::lock_guard lock(m_impl->m_mutex);
+        m_impl->m_queue.push_back(std::move(task));
+    }
+    m_impl->m_cv.notify_one();
+}
+
+executor &default_executor()
+{
+    static executor ex;
+
+    return ex;
+}
+
+namespace detail
+{
+
+namespace
+{
+
+// Run f() as a task in the executor ex, returning
+// a future for the return value of f().
+template <typename F>
+auto executor_async(executor &ex, F f)
+{
+    // NOTE: std::function requires copyable callables,
+    // hence the shared pointer to the packaged task.
+    auto task = std::make_shared<std::packaged_task<decltype(f())()>>(std::move(f));
+    auto retval = task->get_future();
+
+    ex.submit([task]() { (*task)(); });
+
+    return retval;
+}
+
+} // namespace
+
+} // namespace detail
+
+template <typename T>
+std::future<std::tuple<taylor_outcome, T, T, std::size_t>> propagate_until_async(taylor_adaptive<T> &ta, T t,
+                                                                                 std::size_t max_steps, executor &ex)
+{
+    return detail::executor_async(ex, [&ta, t, max_steps]() { return ta.propagate_until(t, max_steps); });
+}
+
+template <typename T>
+std::future<std::tuple<taylor_outcome, T, T, std::size_t>> propagate_for_async(taylor_adaptive<T> &ta, T delta_t,
+                                                                               std::size_t max_steps, executor &ex)
+{
+    return detail::executor_async(ex, [&ta, delta_t, max_steps]() { return ta.propagate_for(delta_t, max_steps); });
+}
+
+template <typename T>
+std::future<std::vector<std::tuple<taylor_outcome, T, T, std::size_t>>>
+propagate_until_async(taylor_adaptive_batch<T> &ta, std::vector<T> t, std::size_t max_steps, executor &ex)
+{
+    return detail::executor_async(ex, [&ta, t = std::move(t), max_steps]() {
+        return std::vector<std::tuple<taylor_outcome, T, T, std::size_t>>(ta.propagate_until(t, max_steps));
+    });
+}
+
+template <typename T>
+std::future<std::vector<std::tuple<taylor_outcome, T, T, std::size_t>>>
+propagate_for_async(taylor_adaptive_batch<T> &ta, std::vector<T> delta_t, std::size_t max_steps, executor &ex)
+{
+    return detail::executor_async(ex, [&ta, delta_t = std::move(delta_t), max_steps]() {
+        return std::vector<std::tuple<taylor_outcome, T, T, std::size_t>>(ta.propagate_for(delta_t, max_steps));
+    });
+}
+
+// Explicit instantiations.
+template HEYOKA_DLL_PUBLIC std::future<std::tuple<taylor_outcome, double, double, std::size_t>>
+propagate_until_async(taylor_adaptive<double> &, double, std::size_t, executor &);
+
+template HEYOKA_DLL_PUBLIC std::future<std::tuple<taylor_outcome, double, double, std::size_t>>
+propagate_for_async(taylor_adaptive<double> &, double, std::size_t, executor &);
+
+template HEYOKA_DLL_PUBLIC std::future<std::vector<std::tuple<taylor_outcome, double, double, std::size_t>>>
+propagate_until_async(taylor_adaptive_batch<double> &, std::vector<double>, std::size_t, executor &);
+
+template HEYOKA_DLL_PUBLIC std::future<std::vector<std::tuple<taylor_outcome, double, double, std::size_t>>>
+propagate_for_async(taylor_adaptive_batch<double> &, std::vector<double>, std::size_t, executor &);
+
+template HEYOKA_DLL_PUBLIC std::future<std::tuple<taylor_outcome, long double, long double, std::size_t>>
+propagate_until_async(taylor_adaptive<long double> &, long double, std::size_t, executor &);
+
+template HEYOKA_DLL_PUBLIC std::future<std::tuple<taylor_outcome, long double, long double, std::size_t>>
+propagate_for_async(taylor_adaptive<long double> &, long double, std::size_t, executor &);
+
+template HEYOKA_DLL_PUBLIC
+    std::future<std::vector<std::tuple<taylor_outcome, long double, long double, std::size_t>>>
+    propagate_until_async(taylor_adaptive_batch<long double> &, std::vector<long double>, std::size_t, executor &);
+
+template HEYOKA_DLL_PUBLIC
+    std::future<std::vector<std::tuple<taylor_outcome, long double, long double, std::size_t>>>
+    propagate_for_async(taylor_adaptive_batch<long double> &, std::vector<long double>, std::size_t, executor &);
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+template HEYOKA_DLL_PUBLIC std::future<std::tuple<taylor_outcome, mppp::real128, mppp::real128, std::size_t>>
+propagate_until_async(taylor_adaptive<mppp::real128> &, mppp::real128, std::size_t, executor &);
+
+template HEYOKA_DLL_PUBLIC std::future<std::tuple<taylor_outcome, mppp::real128, mppp::real128, std::size_t>>
+propagate_for_async(taylor_adaptive<mppp::real128> &, mppp::real128, std::size_t, executor &);
+
+template HEYOKA_DLL_PUBLIC
+    std::future<std::vector<std::tuple<taylor_outcome, mppp::real128, mppp::real128, std::size_t>>>
+    propagate_until_async(taylor_adaptive_batch<mppp::real128> &, std::vector<mppp::real128>, std::size_t,
+                          executor &);
+
+template HEYOKA_DLL_PUBLIC
+    std::future<std::vector<std::tuple<taylor_outcome, mppp::real128, mppp::real128, std::size_t>>>
+    propagate_for_async(taylor_adaptive_batch<mppp::real128> &, std::vector<mppp::real128>, std::size_t,
+                        executor &);
+
+#endif
+
+} // namespace heyoka
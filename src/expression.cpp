@@ -8,20 +8,42 @@
 
 #include <heyoka/config.hpp>
 
+#include <algorithm>
+#include <cassert>
 #include <cmath>
 #include <cstddef>
 #include <cstdint>
+#include <deque>
+#include <functional>
 #include <limits>
+#include <memory>
+#include <numeric>
 #include <ostream>
 #include <sstream>
 #include <stdexcept>
 #include <string>
 #include <type_traits>
+#include <typeindex>
 #include <unordered_map>
 #include <utility>
 #include <variant>
 #include <vector>
 
+#include <boost/version.hpp>
+
+// NOTE: the header for hash_combine changed in version 1.67.
+#if (BOOST_VERSION / 100000 > 1) || (BOOST_VERSION / 100000 == 1 && BOOST_VERSION / 100 % 1000 >= 67)
+
+#include <boost/container_hash/hash.hpp>
+
+#else
+
+#include <boost/functional/hash.hpp>
+
+#endif
+
+#include <fmt/format.h>
+
 #include <llvm/IR/Function.h>
 #include <llvm/IR/Value.h>
 
@@ -32,7 +54,10 @@
 #endif
 
 #include <heyoka/binary_operator.hpp>
+#include <heyoka/detail/eval_scratch.hpp>
 #include <heyoka/detail/llvm_fwd.hpp>
+#include <heyoka/detail/node_meta.hpp>
+#include <heyoka/detail/traversal.hpp>
 #include <heyoka/detail/type_traits.hpp>
 #include <heyoka/expression.hpp>
 #include <heyoka/func.hpp>
@@ -167,14 +192,245 @@ detail::prime_wrapper operator""_p(const char *s, std::size_t n)
 
 } // namespace literals
 
+namespace detail
+{
+
+const void *node_key(const expression &ex)
+{
+    return std::visit(
+        [](const auto &v) -> const void * {
+            using type = uncvref_t<decltype(v)>;
+
+            if constexpr (std::is_same_v<type, binary_operator>) {
+                // NOTE: the operands are shared among
+                // the copies of a binary operator.
+                return &v.lhs();
+            } else if constexpr (std::is_same_v<type, func>) {
+                return v.get_ptr();
+            } else {
+                return nullptr;
+            }
+        },
+        ex.value());
+}
+
+std::pair<const expression *, const expression *> node_args(const expression &ex)
+{
+    return std::visit(
+        [](const auto &v) -> std::pair<const expression *, const expression *> {
+            using type = uncvref_t<decltype(v)>;
+
+            if constexpr (std::is_same_v<type, binary_operator> || std::is_same_v<type, func>) {
+                const auto &args = v.args();
+
+                return {args.data(), args.data() + args.size()};
+            } else {
+                return {nullptr, nullptr};
+            }
+        },
+        ex.value());
+}
+
+const node_meta *node_meta_ptr(const expression &ex)
+{
+    return std::visit(
+        [](const auto &v) -> const node_meta * {
+            using type = uncvref_t<decltype(v)>;
+
+            if constexpr (std::is_same_v<type, binary_operator>) {
+                return &v.meta();
+            } else if constexpr (std::is_same_v<type, func>) {
+                return &v.ptr()->m_meta;
+            } else {
+                return nullptr;
+            }
+        },
+        ex.value());
+}
+
+namespace
+{
+
+// Compute a property of ex cached in the nodes (see node_meta). leaf() computes the
+// property of the numbers, variables and params, node() computes the property of a binary
+// operator or of a function from the properties of its arguments, get() and set() fetch and
+// store the property in the cache of a node.
+// NOTE: the nodes whose property is cached are not descended into.
+template <typename R, typename Leaf, typename Node, typename Get, typename Set>
+R cached_fold(const expression &ex, const Leaf &leaf, const Node &node, const Get &get, const Set &set)
+{
+    // Fast paths for the leaves and the cached nodes.
+    if (const auto *m = node_meta_ptr(ex); m == nullptr) {
+        return leaf(ex);
+    } else if (R r{}; get(ex, *m, r)) {
+        return r;
+    }
+
+    return fold_postorder<R>(
+        ex,
+        [&](const expression &e) {
+            if (const auto *m = node_meta_ptr(e)) {
+                R r{};
+                [[maybe_unused]] const auto cached = get(e, *m, r);
+                assert(cached);
+
+                return r;
+            }
+
+            return leaf(e);
+        },
+        [&](const expression &e, const R *c) {
+            auto r = node(e, c);
+            set(e, *node_meta_ptr(e), r);
+
+            return r;
+        },
+        [&](const expression &e) {
+            R r{};
+
+            return !get(e, *node_meta_ptr(e), r);
+        });
+}
+
+} // namespace
+
+namespace
+{
+
+// Check if the expressions a and b are the same node, that is, either
+// the same shared node or two identical leaves.
+// NOTE: this is stricter than operator==(), as it does not consider
+// equal numbers of different types, or zeroes of different sign.
+bool node_same(const expression &a, const expression &b)
+{
+    if (a.value().index() != b.value().index()) {
+        return false;
+    }
+
+    if (const auto key = node_key(a); key != nullptr) {
+        return key == node_key(b);
+    }
+
+    return std::visit(
+        [&b](const auto &v) {
+            using type = uncvref_t<decltype(v)>;
+
+            if constexpr (std::is_same_v<type, number>) {
+                const auto &n = std::get<number>(b.value());
+
+                if (v.value().index() != n.value().index()) {
+                    return false;
+                }
+
+                return std::visit(
+                    [&n](const auto &x) {
+                        const auto &y = std::get<uncvref_t<decltype(x)>>(n.value());
+
+                        return x == y && (x != 0 || 1 / x == 1 / y);
+                    },
+                    v.value());
+            } else if constexpr (std::is_same_v<type, variable> || std::is_same_v<type, param>) {
+                return v == std::get<type>(b.value());
+            } else {
+                // NOTE: unreachable, binary operators and
+                // functions have a non-null key.
+                return false;
+            }
+        },
+        a.value());
+}
+
+} // namespace
+
+// NOTE: if all the new arguments are the same nodes as the original arguments,
+// a (shallow) copy of ex is returned, so that the transformations which
+// leave a subexpression untouched (e.g., rename_variables() and subs() on a
+// subexpression without the affected variables) do not reallocate it.
+expression node_rebuild(const expression &ex, expression *args)
+{
+    if (const auto [b, e] = node_args(ex); std::equal(b, e, args, node_same)) {
+        return ex;
+    }
+
+    return std::visit(
+        [args](const auto &v) -> expression {
+            using type = uncvref_t<decltype(v)>;
+
+            if constexpr (std::is_same_v<type, binary_operator>) {
+                return expression{binary_operator{v.op(), std::move(args[0]), std::move(args[1])}};
+            } else if constexpr (std::is_same_v<type, func>) {
+                auto tmp = v;
+                auto *cur_arg = args;
+                for (auto [b, e] = tmp.get_mutable_args_it(); b != e; ++b, ++cur_arg) {
+                    *b = std::move(*cur_arg);
+                }
+
+                return expression{std::move(tmp)};
+            } else {
+                assert(false);
+
+                return expression{v};
+            }
+        },
+        ex.value());
+}
+
+} // namespace detail
+
+// NOTE: the list of variables is cached only in the node e, and the
+// cached lists of its subexpressions are reused, so that the memory
+// occupied by the cache is proportional to the number of queries.
 std::vector<std::string> get_variables(const expression &e)
 {
-    return std::visit([](const auto &arg) { return get_variables(arg); }, e.value());
+    const auto *m = detail::node_meta_ptr(e);
+
+    if (m != nullptr) {
+        if (const auto cached = m->get_variables()) {
+            return *cached;
+        }
+    }
+
+    std::vector<std::string> ret;
+
+    // NOTE: the result of the fold is unused (std::vector<bool>
+    // cannot be used as the stack of results of the fold).
+    detail::fold_postorder<int>(
+        e,
+        [&ret](const expression &ex) {
+            if (auto var_ptr = std::get_if<variable>(&ex.value())) {
+                ret.push_back(var_ptr->name());
+            } else if (const auto *mp = detail::node_meta_ptr(ex)) {
+                const auto cached = mp->get_variables();
+                assert(cached);
+                ret.insert(ret.end(), cached->begin(), cached->end());
+            }
+
+            return 0;
+        },
+        [](const expression &, const int *) { return 0; },
+        [](const expression &ex) { return !detail::node_meta_ptr(ex)->get_variables(); });
+
+    std::sort(ret.begin(), ret.end());
+    ret.erase(std::unique(ret.begin(), ret.end()), ret.end());
+
+    if (m != nullptr) {
+        m->set_variables(std::make_shared<const std::vector<std::string>>(ret));
+    }
+
+    return ret;
 }
 
 void rename_variables(expression &e, const std::unordered_map<std::string, std::string> &repl_map)
 {
-    std::visit([&repl_map](auto &arg) { rename_variables(arg, repl_map); }, e.value());
+    e = detail::transform_postorder(e, [&repl_map](const expression &ex) {
+        auto ret = ex;
+
+        if (auto var_ptr = std::get_if<variable>(&ret.value())) {
+            rename_variables(*var_ptr, repl_map);
+        }
+
+        return ret;
+    });
 }
 
 void swap(expression &ex0, expression &ex1) noexcept
@@ -182,9 +438,94 @@ void swap(expression &ex0, expression &ex1) noexcept
     std::swap(ex0.value(), ex1.value());
 }
 
+// NOTE: the hash value of a binary operator is the sum of the hash values of
+// the type and of the operands, the hash value of a function combines the
+// hash values of the name, of the type index and of the arguments.
 std::size_t hash(const expression &ex)
 {
-    return std::visit([](const auto &v) { return hash(v); }, ex.value());
+    // NOTE: the hash value of the type of a binary operator
+    // is not cached in the node (see node_meta).
+    auto type_hash = [](const expression &e) -> std::size_t {
+        if (auto bo_ptr = std::get_if<binary_operator>(&e.value())) {
+            return std::hash<binary_operator::type>{}(bo_ptr->op());
+        }
+
+        return 0;
+    };
+
+    return detail::cached_fold<std::size_t>(
+        ex,
+        [](const expression &e) {
+            return std::visit(
+                [](const auto &v) -> std::size_t {
+                    using type = detail::uncvref_t<decltype(v)>;
+
+                    if constexpr (std::is_same_v<type, binary_operator> || std::is_same_v<type, func>) {
+                        assert(false);
+
+                        return 0;
+                    } else {
+                        return hash(v);
+                    }
+                },
+                e.value());
+        },
+        [](const expression &e, const std::size_t *c) {
+            if (auto bo_ptr = std::get_if<binary_operator>(&e.value())) {
+                return std::hash<binary_operator::type>{}(bo_ptr->op()) + c[0] + c[1];
+            }
+
+            const auto &f = std::get<func>(e.value());
+
+            std::size_t seed = std::hash<std::string>{}(f.get_name());
+
+            boost::hash_combine(seed, f.get_type_index());
+
+            for (decltype(f.args().size()) i = 0; i < f.args().size(); ++i) {
+                boost::hash_combine(seed, c[i]);
+            }
+
+            return seed;
+        },
+        [&type_hash](const expression &e, const detail::node_meta &m, std::size_t &out) {
+            if (!m.get_hash(out)) {
+                return false;
+            }
+
+            out += type_hash(e);
+
+            return true;
+        },
+        [&type_hash](const expression &e, const detail::node_meta &m, std::size_t h) {
+            m.set_hash(h - type_hash(e));
+        });
+}
+
+std::size_t get_n_nodes(const expression &ex)
+{
+    return detail::cached_fold<std::size_t>(
+        ex, [](const expression &) -> std::size_t { return 1; },
+        [](const expression &e, const std::size_t *c) {
+            const auto [b, end] = detail::node_args(e);
+
+            return std::accumulate(c, c + (end - b), std::size_t(1));
+        },
+        [](const expression &, const detail::node_meta &m, std::size_t &out) { return m.get_n_nodes(out); },
+        [](const expression &, const detail::node_meta &m, std::size_t n) { m.set_n_nodes(n); });
+}
+
+std::size_t get_depth(const expression &ex)
+{
+    return detail::cached_fold<std::size_t>(
+        ex, [](const expression &) -> std::size_t { return 0; },
+        [](const expression &e, const std::size_t *c) {
+            const auto [b, end] = detail::node_args(e);
+
+            return std::accumulate(c, c + (end - b), std::size_t(0),
+                                   [](std::size_t a, std::size_t x) { return std::max(a, x + 1u); });
+        },
+        [](const expression &, const detail::node_meta &m, std::size_t &out) { return m.get_depth(out); },
+        [](const expression &, const detail::node_meta &m, std::size_t n) { m.set_depth(n); });
 }
 
 std::ostream &operator<<(std::ostream &os, const expression &e)
@@ -624,7 +965,29 @@ bool operator!=(const expression &e1, const expression &e2)
 
 expression diff(const expression &e, const std::string &s)
 {
-    return std::visit([&s](const auto &arg) { return diff(arg, s); }, e.value());
+    // NOTE: the derivatives of the functions are computed via their
+    // diff() implementations, thus the fold descends only
+    // into the binary operators.
+    return detail::fold_postorder<expression>(
+        e,
+        [&s](const expression &ex) {
+            return std::visit([&s](const auto &arg) { return diff(arg, s); }, ex.value());
+        },
+        [](const expression &ex, expression *d) {
+            const auto &bo = std::get<binary_operator>(ex.value());
+
+            switch (bo.op()) {
+                case binary_operator::type::add:
+                    return std::move(d[0]) + std::move(d[1]);
+                case binary_operator::type::sub:
+                    return std::move(d[0]) - std::move(d[1]);
+                case binary_operator::type::mul:
+                    return std::move(d[0]) * bo.rhs() + bo.lhs() * std::move(d[1]);
+                default:
+                    return (std::move(d[0]) * bo.rhs() - bo.lhs() * std::move(d[1])) / (bo.rhs() * bo.rhs());
+            }
+        },
+        [](const expression &ex) { return std::holds_alternative<binary_operator>(ex.value()); });
 }
 
 expression diff(const expression &e, const expression &x)
@@ -645,9 +1008,142 @@ expression diff(const expression &e, const expression &x)
         x.value());
 }
 
+namespace detail
+{
+
+namespace
+{
+
+// The partial derivatives of the function f with respect to its arguments.
+std::vector<expression> diff_func_partials(const func &f)
+{
+    // NOTE: the arguments are replaced by placeholder variables for
+    // the symbolic differentiation, and then restored.
+    auto tmp = f;
+    std::vector<std::string> names;
+    std::unordered_map<std::string, expression> smap;
+    for (auto [b, e] = tmp.get_mutable_args_it(); b != e; ++b) {
+        auto name = "__diff_arg_" + std::to_string(names.size());
+        smap.emplace(name, *b);
+        *b = expression{variable{name}};
+        names.push_back(std::move(name));
+    }
+
+    std::vector<expression> retval;
+    retval.reserve(names.size());
+    for (const auto &name : names) {
+        retval.push_back(subs(tmp.diff(name), smap));
+    }
+
+    return retval;
+}
+
+} // namespace
+
+} // namespace detail
+
+std::vector<expression> diff(const std::vector<expression> &v_ex, const std::vector<std::string> &vars)
+{
+    const auto n_vars = vars.size();
+
+    std::vector<expression> retval(v_ex.size() * n_vars);
+
+    // The partial derivatives of the functions with respect to their
+    // arguments, shared among all the differentiation variables.
+    std::unordered_map<const void *, std::vector<expression>> fpartials;
+
+    for (decltype(vars.size()) j = 0; j < n_vars; ++j) {
+        const auto &s = vars[j];
+
+        // NOTE: the derivatives with respect to s are memoised across
+        // all the expressions, so that the subexpressions shared among
+        // (and within) them are differentiated only once.
+        std::unordered_map<const void *, expression> memo;
+
+        auto leaf = [&s](const expression &ex) {
+            return std::visit([&s](const auto &arg) { return diff(arg, s); }, ex.value());
+        };
+
+        auto node = [&fpartials](const expression &ex, expression *d) {
+            if (const auto *bo = std::get_if<binary_operator>(&ex.value())) {
+                switch (bo->op()) {
+                    case binary_operator::type::add:
+                        return std::move(d[0]) + std::move(d[1]);
+                    case binary_operator::type::sub:
+                        return std::move(d[0]) - std::move(d[1]);
+                    case binary_operator::type::mul:
+                        return std::move(d[0]) * bo->rhs() + bo->lhs() * std::move(d[1]);
+                    default:
+                        return (std::move(d[0]) * bo->rhs() - bo->lhs() * std::move(d[1])) / (bo->rhs() * bo->rhs());
+                }
+            }
+
+            // Functions: chain rule.
+            const auto &f = std::get<func>(ex.value());
+            auto it = fpartials.find(detail::node_key(ex));
+            if (it == fpartials.end()) {
+                it = fpartials.emplace(detail::node_key(ex), detail::diff_func_partials(f)).first;
+            }
+            const auto &partials = it->second;
+
+            std::vector<expression> terms;
+            for (decltype(partials.size()) k = 0; k < partials.size(); ++k) {
+                if (const auto *nptr = std::get_if<number>(&d[k].value()); nptr == nullptr || !is_zero(*nptr)) {
+                    terms.push_back(partials[k] * std::move(d[k]));
+                }
+            }
+
+            return terms.empty() ? expression{number{0.}} : pairwise_sum(std::move(terms));
+        };
+
+        // NOTE: the nodes without arguments (e.g., time) are differentiated via diff().
+        auto descend = [](const expression &ex) {
+            const auto [b, e] = detail::node_args(ex);
+            return b != e;
+        };
+
+        for (decltype(v_ex.size()) i = 0; i < v_ex.size(); ++i) {
+            retval[i * n_vars + j] = detail::fold_postorder<expression>(v_ex[i], leaf, node, descend, memo);
+        }
+    }
+
+    return retval;
+}
+
 expression subs(const expression &e, const std::unordered_map<std::string, expression> &smap)
 {
-    return std::visit([&smap](const auto &arg) { return subs(arg, smap); }, e.value());
+    if (smap.empty()) {
+        return e;
+    }
+
+    return detail::transform_postorder(e, [&smap](const expression &ex) {
+        return std::visit([&smap](const auto &arg) { return subs(arg, smap); }, ex.value());
+    });
+}
+
+std::vector<expression> subs(const std::vector<expression> &v_ex,
+                             const std::unordered_map<std::string, expression> &smap)
+{
+    if (smap.empty()) {
+        return v_ex;
+    }
+
+    auto leaf = [&smap](const expression &ex) {
+        return std::visit([&smap](const auto &arg) { return subs(arg, smap); }, ex.value());
+    };
+
+    // NOTE: share the memo among the expressions, so that the subexpressions
+    // shared among the expressions are transformed only once (and the
+    // results are shared in the output).
+    std::unordered_map<const void *, expression> memo;
+
+    std::vector<expression> retval;
+    retval.reserve(v_ex.size());
+    for (const auto &ex : v_ex) {
+        retval.push_back(detail::transform_postorder(ex, leaf, memo));
+    }
+
+    return retval;
 }
 
 // Pairwise summation of a vector of expressions.
@@ -685,7 +1181,27 @@ expression pairwise_sum(std::vector<expression> sum)
 double eval_dbl(const expression &e, const std::unordered_map<std::string, double> &map,
                 const std::vector<double> &pars)
 {
-    return std::visit([&](const auto &arg) { return eval_dbl(arg, map, pars); }, e.value());
+    // NOTE: the functions are evaluated via their eval_dbl()
+    // implementations, thus the fold descends only
+    // into the binary operators.
+    return detail::fold_postorder<double>(
+        e,
+        [&](const expression &ex) {
+            return std::visit([&](const auto &arg) { return eval_dbl(arg, map, pars); }, ex.value());
+        },
+        [](const expression &ex, const double *v) {
+            switch (std::get<binary_operator>(ex.value()).op()) {
+                case binary_operator::type::add:
+                    return v[0] + v[1];
+                case binary_operator::type::sub:
+                    return v[0] - v[1];
+                case binary_operator::type::mul:
+                    return v[0] * v[1];
+                default:
+                    return v[0] / v[1];
+            }
+        },
+        [](const expression &ex) { return std::holds_alternative<binary_operator>(ex.value()); });
 }
 
 void eval_batch_dbl(std::vector<double> &retval, const expression &e,
@@ -694,6 +1210,288 @@ void eval_batch_dbl(std::vector<double> &retval, const expression &e,
     std::visit([&](const auto &arg) { eval_batch_dbl(retval, arg, map, pars); }, e.value());
 }
 
+namespace detail
+{
+
+namespace
+{
+
+// The per-thread stack of scratch buffers. The buffers
+// in [0, depth) are in use.
+// NOTE: use a deque so that the buffers in use
+// are not moved when the stack grows.
+struct eval_scratch_stack {
+    std::deque<std::vector<double>> bufs;
+    std::size_t depth = 0;
+};
+
+thread_local eval_scratch_stack eval_scratch_tls;
+
+} // namespace
+
+eval_scratch::eval_scratch()
+{
+    auto &st = eval_scratch_tls;
+
+    if (st.depth == st.bufs.size()) {
+        st.bufs.emplace_back();
+    }
+
+    m_buf = &st.bufs[st.depth++];
+}
+
+eval_scratch::~eval_scratch()
+{
+    assert(eval_scratch_tls.depth > 0u);
+
+    --eval_scratch_tls.depth;
+}
+
+namespace
+{
+
+double eval_dbl_by_id_impl(const expression &e, const double *in, std::size_t n_in, const std::vector<double> &pars)
+{
+    return std::visit(
+        [&](const auto &arg) -> double {
+            using type = detail::uncvref_t<decltype(arg)>;
+
+            if constexpr (std::is_same_v<type, variable>) {
+                if (arg.id() >= n_in) {
+                    using namespace fmt::literals;
+
+                    throw std::invalid_argument(
+                        "Cannot evaluate the variable '{}' because its id ({}) is not less than the size of the "
+                        "input array ({})"_format(arg.name(), arg.id(), n_in));
+                }
+
+                return in[arg.id()];
+            } else if constexpr (std::is_same_v<type, binary_operator>) {
+                const auto a = eval_dbl_by_id_impl(arg.lhs(), in, n_in, pars);
+                const auto b = eval_dbl_by_id_impl(arg.rhs(), in, n_in, pars);
+
+                switch (arg.op()) {
+                    case binary_operator::type::add:
+                        return a + b;
+                    case binary_operator::type::sub:
+                        return a - b;
+                    case binary_operator::type::mul:
+                        return a * b;
+                    default:
+                        return a / b;
+                }
+            } else if constexpr (std::is_same_v<type, func>) {
+                std::vector<double> args;
+                args.reserve(arg.args().size());
+                for (const auto &a : arg.args()) {
+                    args.push_back(eval_dbl_by_id_impl(a, in, n_in, pars));
+                }
+
+                return eval_num_dbl(arg, args);
+            } else {
+                // Numbers and params do not depend on the values
+                // of the variables.
+                return eval_dbl(arg, {}, pars);
+            }
+        },
+        e.value());
+}
+
+// Number of rows of scratch space needed
+// to evaluate e in batch mode.
+std::size_t eval_batch_scratch_rows(const expression &e)
+{
+    return std::visit(
+        [](const auto &arg) -> std::size_t {
+            using type = detail::uncvref_t<decltype(arg)>;
+
+            if constexpr (std::is_same_v<type, binary_operator>) {
+                // NOTE: the lhs is evaluated directly into the output,
+                // the rhs into one row of scratch space.
+                return std::max(eval_batch_scratch_rows(arg.lhs()), 1u + eval_batch_scratch_rows(arg.rhs()));
+            } else if constexpr (std::is_same_v<type, func>) {
+                // NOTE: each argument is evaluated into its own row.
+                std::size_t ret = 0;
+                for (const auto &a : arg.args()) {
+                    ret = std::max(ret, eval_batch_scratch_rows(a));
+                }
+
+                return arg.args().size() + ret;
+            } else {
+                return 0;
+            }
+        },
+        e.value());
+}
+
+// Evaluate e at batch_size points, reading the values of the variable with id i
+// from cols[i] + offset (where cols is an array of n_in pointers).
+void eval_batch_dbl_by_id_impl(double *out, const expression &e, const double *const *cols, std::size_t n_in,
+                               std::size_t offset, std::size_t batch_size, const std::vector<double> &pars,
+                               double *scratch)
+{
+    std::visit(
+        [&](const auto &arg) {
+            using type = detail::uncvref_t<decltype(arg)>;
+
+            if constexpr (std::is_same_v<type, variable>) {
+                if (arg.id() >= n_in) {
+                    using namespace fmt::literals;
+
+                    throw std::invalid_argument(
+                        "Cannot evaluate the variable '{}' because its id ({}) is not less than the number of rows "
+                        "of the input array ({})"_format(arg.name(), arg.id(), n_in));
+                }
+
+                const auto col = cols[arg.id()];
+                if (col == nullptr) {
+                    throw std::invalid_argument("Cannot evaluate the variable '" + arg.name()
+                                                + "' because its column is null");
+                }
+
+                std::copy(col + offset, col + offset + batch_size, out);
+            } else if constexpr (std::is_same_v<type, binary_operator>) {
+                eval_batch_dbl_by_id_impl(out, arg.lhs(), cols, n_in, offset, batch_size, pars, scratch);
+                eval_batch_dbl_by_id_impl(scratch, arg.rhs(), cols, n_in, offset, batch_size, pars,
+                                          scratch + batch_size);
+
+                switch (arg.op()) {
+                    case binary_operator::type::add:
+                        std::transform(out, out + batch_size, scratch, out, std::plus<>{});
+                        break;
+                    case binary_operator::type::sub:
+                        std::transform(out, out + batch_size, scratch, out, std::minus<>{});
+                        break;
+                    case binary_operator::type::mul:
+                        std::transform(out, out + batch_size, scratch, out, std::multiplies<>{});
+                        break;
+                    default:
+                        std::transform(out, out + batch_size, scratch, out, std::divides<>{});
+                }
+            } else if constexpr (std::is_same_v<type, func>) {
+                const auto n_args = arg.args().size();
+                const auto next_scratch = scratch + n_args * batch_size;
+
+                for (decltype(arg.args().size()) k = 0; k < n_args; ++k) {
+                    eval_batch_dbl_by_id_impl(scratch + k * batch_size, arg.args()[k], cols, n_in, offset,
+                                              batch_size, pars, next_scratch);
+                }
+
+                detail::eval_scratch es;
+                auto &args = es.get();
+                args.resize(n_args);
+
+                for (std::size_t j = 0; j < batch_size; ++j) {
+                    for (decltype(args.size()) k = 0; k < n_args; ++k) {
+                        args[k] = scratch[k * batch_size + j];
+                    }
+
+                    out[j] = eval_num_dbl(arg, args);
+                }
+            } else {
+                std::fill(out, out + batch_size, eval_dbl(arg, {}, pars));
+            }
+        },
+        e.value());
+}
+
+} // namespace
+
+} // namespace detail
+
+double eval_dbl_by_id(const expression &e, const double *in, std::size_t n_in, const std::vector<double> &pars)
+{
+    return detail::eval_dbl_by_id_impl(e, in, n_in, pars);
+}
+
+void eval_batch_dbl_by_id(double *out, const expression &e, const double *in, std::size_t n_in,
+                          std::size_t batch_size, const std::vector<double> &pars)
+{
+    // Build the pointers to the rows of the input array.
+    std::vector<const double *> cols(n_in);
+    for (std::size_t i = 0; i < n_in; ++i) {
+        cols[i] = in + i * batch_size;
+    }
+
+    eval_batch_dbl_cols(out, e, cols, batch_size, pars);
+}
+
+void eval_batch_dbl_cols(double *out, const expression &e, const std::vector<const double *> &cols,
+                         std::size_t n_points, const std::vector<double> &pars)
+{
+    if (n_points == 0u) {
+        return;
+    }
+
+    // NOTE: the evaluation proceeds in blocks of points, so that the
+    // intermediate results stay in cache. The scratch space for a block
+    // is taken from the per-thread scratch buffers.
+    constexpr std::size_t block_size = 512;
+
+    const auto bs = std::min(block_size, n_points);
+
+    detail::eval_scratch es;
+    auto &scratch = es.get();
+    scratch.resize(detail::eval_batch_scratch_rows(e) * bs);
+
+    for (std::size_t b = 0; b < n_points; b += bs) {
+        detail::eval_batch_dbl_by_id_impl(out + b, e, cols.data(), cols.size(), b, std::min(bs, n_points - b), pars,
+                                          scratch.data());
+    }
+}
+
+namespace detail
+{
+
+namespace
+{
+
+// The leaf transformation of subs_by_id().
+expression subs_by_id_leaf(const expression &ex, const std::unordered_map<std::uint32_t, expression> &smap)
+{
+    if (const auto *var_ptr = std::get_if<variable>(&ex.value())) {
+        if (auto it = smap.find(var_ptr->id()); it != smap.end()) {
+            return it->second;
+        }
+    }
+
+    return ex;
+}
+
+} // namespace
+
+} // namespace detail
+
+expression subs_by_id(const expression &e, const std::unordered_map<std::uint32_t, expression> &smap)
+{
+    if (smap.empty()) {
+        return e;
+    }
+
+    return detail::transform_postorder(e, [&smap](const expression &ex) { return detail::subs_by_id_leaf(ex, smap); });
+}
+
+std::vector<expression> subs_by_id(const std::vector<expression> &v_ex,
+                                   const std::unordered_map<std::uint32_t, expression> &smap)
+{
+    if (smap.empty()) {
+        return v_ex;
+    }
+
+    auto leaf = [&smap](const expression &ex) { return detail::subs_by_id_leaf(ex, smap); };
+
+    // NOTE: share the memo among the expressions (see subs()).
+    std::unordered_map<const void *, expression> memo;
+
+    std::vector<expression> retval;
+    retval.reserve(v_ex.size());
+    for (const auto &ex : v_ex) {
+        retval.push_back(detail::transform_postorder(ex, leaf, memo));
+    }
+
+    return retval;
+}
+
 std::vector<std::vector<std::size_t>> compute_connections(const expression &e)
 {
     std::vector<std::vector<std::size_t>> node_connections;
@@ -936,6 +1734,11 @@ expression par_impl::operator[](std::uint32_t idx) const
     return expression{param{idx}};
 }
 
+expression shared_par_impl::operator[](std::uint32_t idx) const
+{
+    return expression{param{idx, true}};
+}
+
 } // namespace detail
 
 // Determine the size of the parameter vector from the highest
@@ -943,27 +1746,27 @@ expression par_impl::operator[](std::uint32_t idx) const
 // is zero, no params appear in the expression.
 std::uint32_t get_param_size(const expression &ex)
 {
-    std::uint32_t retval = 0;
-
-    std::visit(
-        [&retval](const auto &v) {
-            using type = detail::uncvref_t<decltype(v)>;
-
-            if constexpr (std::is_same_v<type, param>) {
-                if (v.idx() == std::numeric_limits<std::uint32_t>::max()) {
+    return detail::cached_fold<std::uint32_t>(
+        ex,
+        [](const expression &e) -> std::uint32_t {
+            if (auto par_ptr = std::get_if<param>(&e.value())) {
+                if (par_ptr->idx() == std::numeric_limits<std::uint32_t>::max()) {
                     throw std::overflow_error("Overflow dected in get_n_param()");
                 }
 
-                retval = std::max(static_cast<std::uint32_t>(v.idx() + 1u), retval);
-            } else if constexpr (std::is_same_v<type, binary_operator> || std::is_same_v<type, func>) {
-                for (const auto &a : v.args()) {
-                    retval = std::max(get_param_size(a), retval);
-                }
+                return par_ptr->idx() + 1u;
             }
+
+            return 0;
         },
-        ex.value());
+        [](const expression &e, const std::uint32_t *c) {
+            const auto [b, end] = detail::node_args(e);
 
-    return retval;
+            return std::accumulate(c, c + (end - b), std::uint32_t(0),
+                                   [](std::uint32_t a, std::uint32_t x) { return std::max(a, x); });
+        },
+        [](const expression &, const detail::node_meta &m, std::uint32_t &out) { return m.get_param_size(out); },
+        [](const expression &, const detail::node_meta &m, std::uint32_t n) { m.set_param_size(n); });
 }
 
 } // namespace heyoka
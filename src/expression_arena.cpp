@@ -0,0 +1,95 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+#include <heyoka/expression_arena.hpp>
+
+namespace heyoka
+{
+
+namespace detail
+{
+
+namespace
+{
+
+// Size of the memory blocks allocated by an arena.
+constexpr std::size_t arena_block_size = 64u * 1024u;
+
+// The arena currently active in each thread.
+thread_local std::shared_ptr<expr_arena> cur_arena;
+
+} // namespace
+
+expr_arena::expr_arena() = default;
+
+expr_arena::~expr_arena() = default;
+
+void *expr_arena::allocate(std::size_t size, std::size_t align)
+{
+    assert(align > 0u && (align & (align - 1u)) == 0u);
+
+    // Padding needed to align the current pointer.
+    auto pad = [this, align]() {
+        const auto addr = reinterpret_cast<std::size_t>(m_cur);
+        return static_cast<std::size_t>((align - addr % align) % align);
+    };
+
+    if (m_cur == nullptr || m_left < size || m_left - size < pad()) {
+        // NOTE: large requests get a block on their own, so that
+        // the remainder of the current block is not wasted.
+        if (size + align > arena_block_size / 4u) {
+            auto blk = std::make_unique<unsigned char[]>(size + align);
+            auto ptr = static_cast<void *>(blk.get());
+            auto space = size + align;
+            // NOTE: std::align() cannot fail here, as we over-allocated by align.
+            std::align(align, size, ptr, space);
+            m_blocks.push_back(std::move(blk));
+
+            return ptr;
+        }
+
+        m_blocks.push_back(std::make_unique<unsigned char[]>(arena_block_size));
+        m_cur = m_blocks.back().get();
+        m_left = arena_block_size;
+    }
+
+    const auto p = pad();
+    assert(m_left >= p + size);
+
+    auto ret = m_cur + p;
+    m_cur += p + size;
+    m_left -= p + size;
+
+    return ret;
+}
+
+const std::shared_ptr<expr_arena> &current_expr_arena()
+{
+    return cur_arena;
+}
+
+} // namespace detail
+
+expression_arena::expression_arena() : m_prev(std::move(detail::cur_arena))
+{
+    detail::cur_arena = std::make_shared<detail::expr_arena>();
+}
+
+expression_arena::~expression_arena()
+{
+    // NOTE: the arena stays alive as long as
+    // nodes allocated from it exist.
+    detail::cur_arena = std::move(m_prev);
+}
+
+} // namespace heyoka
@@ -0,0 +1,574 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <heyoka/binary_operator.hpp>
+#include <heyoka/detail/binary_io.hpp>
+#include <heyoka/detail/string_conv.hpp>
+#include <heyoka/expression.hpp>
+#include <heyoka/expression_parser.hpp>
+#include <heyoka/number.hpp>
+#include <heyoka/param.hpp>
+#include <heyoka/variable.hpp>
+
+namespace heyoka
+{
+
+namespace detail
+{
+
+namespace
+{
+
+enum class tok_kind { number, variable, param, time, func_open, lparen, rparen, comma, op, sep, end };
+
+struct token {
+    tok_kind kind = tok_kind::end;
+    // The position of the token in the input.
+    std::size_t pos = 0;
+    double num = 0;
+    // The name of a variable or of a function.
+    std::string name;
+    std::uint32_t p_idx = 0;
+    bool shared = false;
+    // The operator (+, -, * or /) or the separator (';' or '=').
+    char op = 0;
+};
+
+bool is_digit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+bool is_ident_start(char c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+}
+
+bool is_space(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v';
+}
+
+// Shunting-yard parser of expressions. The parsed nodes are stored in m_nodes
+// and they are identified by their index. The nodes are hash-consed via
+// m_ids, whose keys are built from the content of the leaves and from the
+// ids of the arguments of the other nodes.
+class expr_parser
+{
+    const std::string &m_str;
+    std::size_t m_pos = 0;
+
+    std::vector<expression> m_nodes;
+    std::unordered_map<std::string, std::size_t> m_ids;
+    std::string m_key;
+
+    // An entry in the stack of the operators: a binary operator (+, -, *, /),
+    // a unary minus ('u'), an open parenthesis ('(') or a function call ('f'),
+    // whose arguments start at the index start in the stack of the operands.
+    struct op_entry {
+        char kind;
+        std::size_t pos;
+        std::string name;
+        std::size_t start;
+    };
+
+    [[noreturn]] void error(std::size_t pos, const std::string &msg) const
+    {
+        throw std::invalid_argument("Error parsing an expression at position " + std::to_string(pos) + ": " + msg);
+    }
+
+    void skip_ws()
+    {
+        while (m_pos < m_str.size() && is_space(m_str[m_pos])) {
+            ++m_pos;
+        }
+    }
+
+    double lex_number()
+    {
+        const auto start = m_pos;
+
+        auto digits = [this]() {
+            std::size_t n = 0;
+            for (; m_pos < m_str.size() && is_digit(m_str[m_pos]); ++m_pos, ++n) {
+            }
+            return n;
+        };
+
+        auto n_digits = digits();
+        if (m_pos < m_str.size() && m_str[m_pos] == '.') {
+            ++m_pos;
+            n_digits += digits();
+        }
+        if (n_digits == 0u) {
+            error(start, "invalid number");
+        }
+
+        if (m_pos < m_str.size() && (m_str[m_pos] == 'e' || m_str[m_pos] == 'E')) {
+            ++m_pos;
+            if (m_pos < m_str.size() && (m_str[m_pos] == '+' || m_str[m_pos] == '-')) {
+                ++m_pos;
+            }
+            if (digits() == 0u) {
+                error(start, "invalid exponent in the number '" + m_str.substr(start, m_pos - start) + "'");
+            }
+        }
+
+        // NOTE: std::from_chars() for floating-point types is not
+        // available on all the supported compilers.
+#if defined(__cpp_lib_to_chars)
+        double x = 0;
+        const auto *end = m_str.data() + m_pos;
+        const auto res = std::from_chars(m_str.data() + start, end, x);
+        if (res.ec != std::errc{} || res.ptr != end) {
+            error(start, "the number '" + m_str.substr(start, m_pos - start) + "' cannot be represented");
+        }
+
+        return x;
+#else
+        try {
+            return li_from_string<double>(m_str.substr(start, m_pos - start));
+        } catch (...) {
+            error(start, "the number '" + m_str.substr(start, m_pos - start) + "' cannot be represented");
+        }
+#endif
+    }
+
+    std::uint32_t lex_par_idx()
+    {
+        const auto start = m_pos;
+
+        std::uint64_t idx = 0;
+        for (; m_pos < m_str.size() && is_digit(m_str[m_pos]); ++m_pos) {
+            idx = idx * 10u + static_cast<std::uint64_t>(m_str[m_pos] - '0');
+            if (idx > std::numeric_limits<std::uint32_t>::max()) {
+                error(start, "the index of a param is too large");
+            }
+        }
+        if (m_pos == start) {
+            error(start, "invalid index of a param");
+        }
+
+        return static_cast<std::uint32_t>(idx);
+    }
+
+    token next()
+    {
+        skip_ws();
+
+        token t;
+        t.pos = m_pos;
+
+        if (m_pos == m_str.size()) {
+            return t;
+        }
+
+        const auto c = m_str[m_pos];
+
+        if (is_digit(c) || c == '.') {
+            t.kind = tok_kind::number;
+            t.num = lex_number();
+            return t;
+        }
+
+        if (is_ident_start(c)) {
+            const auto start = m_pos;
+            for (; m_pos < m_str.size() && (is_ident_start(m_str[m_pos]) || is_digit(m_str[m_pos])); ++m_pos) {
+            }
+            t.name = m_str.substr(start, m_pos - start);
+
+            skip_ws();
+            const auto nc = m_pos < m_str.size() ? m_str[m_pos] : '\0';
+
+            if ((t.name == "par" || t.name == "shared_par") && nc == '[') {
+                ++m_pos;
+                skip_ws();
+                t.p_idx = lex_par_idx();
+                skip_ws();
+                if (m_pos == m_str.size() || m_str[m_pos] != ']') {
+                    error(m_pos, "expected ']'");
+                }
+                ++m_pos;
+
+                t.kind = tok_kind::param;
+                t.shared = t.name == "shared_par";
+            } else if (nc == '(') {
+                ++m_pos;
+                t.kind = tok_kind::func_open;
+            } else if (t.name == "t") {
+                t.kind = tok_kind::time;
+            } else if (t.name == "inf" || t.name == "nan") {
+                t.kind = tok_kind::number;
+                t.num = t.name == "inf" ? std::numeric_limits<double>::infinity()
+                                        : std::numeric_limits<double>::quiet_NaN();
+            } else {
+                t.kind = tok_kind::variable;
+            }
+
+            return t;
+        }
+
+        ++m_pos;
+
+        switch (c) {
+            case '(':
+                t.kind = tok_kind::lparen;
+                break;
+            case ')':
+                t.kind = tok_kind::rparen;
+                break;
+            case ',':
+                t.kind = tok_kind::comma;
+                break;
+            case '+':
+            case '-':
+            case '*':
+            case '/':
+                t.kind = tok_kind::op;
+                t.op = c;
+                break;
+            case ';':
+            case '=':
+                t.kind = tok_kind::sep;
+                t.op = c;
+                break;
+            default:
+                error(t.pos, std::string{"unexpected character '"} + c + "'");
+        }
+
+        return t;
+    }
+
+    // Fetch the id of the node with key m_key, building
+    // the node via f() if it does not exist yet.
+    template <typename F>
+    std::size_t intern(F &&f)
+    {
+        const auto [it, inserted] = m_ids.emplace(m_key, m_nodes.size());
+
+        if (inserted) {
+            try {
+                m_nodes.push_back(f());
+            } catch (...) {
+                m_ids.erase(it);
+                throw;
+            }
+        }
+
+        return it->second;
+    }
+
+    void key_append_id(std::size_t id)
+    {
+        m_key.append(reinterpret_cast<const char *>(&id), sizeof(id));
+    }
+
+    std::size_t number_id(double x)
+    {
+        // NOTE: the key contains the bit pattern of x, so that,
+        // e.g., 0. and -0. are distinct.
+        m_key.assign(1, 'n');
+        m_key.append(reinterpret_cast<const char *>(&x), sizeof(x));
+
+        return intern([x]() { return expression{number{x}}; });
+    }
+
+    std::size_t variable_id(const std::string &name)
+    {
+        m_key.assign(1, 'v');
+        m_key += name;
+
+        return intern([&name]() { return expression{variable{name}}; });
+    }
+
+    std::size_t param_id(std::uint32_t idx, bool shared)
+    {
+        m_key.assign(1, shared ? 's' : 'p');
+        m_key.append(reinterpret_cast<const char *>(&idx), sizeof(idx));
+
+        return intern([idx, shared]() { return expression{param{idx, shared}}; });
+    }
+
+    std::size_t binop_id(char op, std::size_t lhs, std::size_t rhs)
+    {
+        m_key.assign(1, 'b');
+        m_key += op;
+        key_append_id(lhs);
+        key_append_id(rhs);
+
+        return intern([this, op, lhs, rhs]() {
+            const auto type = op == '+'   ? binary_operator::type::add
+                              : op == '-' ? binary_operator::type::sub
+                              : op == '*' ? binary_operator::type::mul
+                                          : binary_operator::type::div;
+
+            return expression{binary_operator{type, m_nodes[lhs], m_nodes[rhs]}};
+        });
+    }
+
+    // The function with the given name, whose arguments are the ids
+    // in the range [b, e).
+    std::size_t func_id(const std::string &name, std::size_t pos, const std::size_t *b, const std::size_t *e)
+    {
+        if (!func_has_factory(name)) {
+            error(pos, "unknown function '" + name + "'");
+        }
+
+        m_key.assign(1, 'f');
+        m_key += name;
+        m_key += '\0';
+        for (auto it = b; it != e; ++it) {
+            key_append_id(*it);
+        }
+
+        return intern([&]() {
+            std::vector<expression> args;
+            for (auto it = b; it != e; ++it) {
+                args.push_back(m_nodes[*it]);
+            }
+
+            try {
+                return func_from_factory(name, std::move(args));
+            } catch (const std::invalid_argument &ex) {
+                error(pos, ex.what());
+            }
+        });
+    }
+
+public:
+    explicit expr_parser(const std::string &s) : m_str(s) {}
+
+    const expression &get_node(std::size_t id) const
+    {
+        return m_nodes[id];
+    }
+
+    // Check whether only whitespace is left in the input.
+    bool at_end()
+    {
+        skip_ws();
+
+        return m_pos == m_str.size();
+    }
+
+    // Parse an expression, returning its id and the token
+    // terminating it (a separator or the end of the input).
+    std::pair<std::size_t, token> parse()
+    {
+        std::vector<std::size_t> operands;
+        std::vector<op_entry> ops;
+        bool expect_operand = true;
+
+        auto prec = [](char k) {
+            switch (k) {
+                case '+':
+                case '-':
+                    return 1;
+                case '*':
+                case '/':
+                    return 2;
+                case 'u':
+                    return 3;
+                default:
+                    return 0;
+            }
+        };
+
+        auto reduce = [&]() {
+            const auto kind = ops.back().kind;
+            ops.pop_back();
+
+            if (kind == 'u') {
+                operands.back() = binop_id('*', number_id(-1.), operands.back());
+            } else {
+                const auto rhs = operands.back();
+                operands.pop_back();
+                operands.back() = binop_id(kind, operands.back(), rhs);
+            }
+        };
+
+        auto reduce_all = [&]() {
+            while (!ops.empty() && prec(ops.back().kind) > 0) {
+                reduce();
+            }
+        };
+
+        auto finish_func = [&]() {
+            const auto &f = ops.back();
+            const auto id = func_id(f.name, f.pos, operands.data() + f.start, operands.data() + operands.size());
+            operands.resize(f.start);
+            operands.push_back(id);
+            ops.pop_back();
+        };
+
+        while (true) {
+            auto tok = next();
+
+            if (expect_operand) {
+                switch (tok.kind) {
+                    case tok_kind::number:
+                        operands.push_back(number_id(tok.num));
+                        expect_operand = false;
+                        break;
+                    case tok_kind::variable:
+                        operands.push_back(variable_id(tok.name));
+                        expect_operand = false;
+                        break;
+                    case tok_kind::param:
+                        operands.push_back(param_id(tok.p_idx, tok.shared));
+                        expect_operand = false;
+                        break;
+                    case tok_kind::time:
+                        operands.push_back(func_id("time", tok.pos, nullptr, nullptr));
+                        expect_operand = false;
+                        break;
+                    case tok_kind::func_open:
+                        ops.push_back(op_entry{'f', tok.pos, std::move(tok.name), operands.size()});
+                        break;
+                    case tok_kind::lparen:
+                        ops.push_back(op_entry{'(', tok.pos, {}, 0});
+                        break;
+                    case tok_kind::op:
+                        if (tok.op == '-') {
+                            // NOTE: a minus in front of a number is part of the number.
+                            skip_ws();
+                            if (m_pos < m_str.size() && (is_digit(m_str[m_pos]) || m_str[m_pos] == '.')) {
+                                operands.push_back(number_id(-lex_number()));
+                                expect_operand = false;
+                            } else {
+                                ops.push_back(op_entry{'u', tok.pos, {}, 0});
+                            }
+                        } else if (tok.op != '+') {
+                            error(tok.pos, "expected an operand");
+                        }
+                        break;
+                    case tok_kind::rparen:
+                        // A function without arguments.
+                        if (!ops.empty() && ops.back().kind == 'f' && ops.back().start == operands.size()) {
+                            finish_func();
+                            expect_operand = false;
+                            break;
+                        }
+                        [[fallthrough]];
+                    default:
+                        error(tok.pos, "expected an operand");
+                }
+            } else {
+                switch (tok.kind) {
+                    case tok_kind::op:
+                        while (!ops.empty() && prec(ops.back().kind) >= prec(tok.op)) {
+                            reduce();
+                        }
+                        ops.push_back(op_entry{tok.op, tok.pos, {}, 0});
+                        expect_operand = true;
+                        break;
+                    case tok_kind::rparen:
+                        reduce_all();
+                        if (ops.empty()) {
+                            error(tok.pos, "unbalanced ')'");
+                        }
+                        if (ops.back().kind == '(') {
+                            ops.pop_back();
+                        } else {
+                            finish_func();
+                        }
+                        break;
+                    case tok_kind::comma:
+                        reduce_all();
+                        if (ops.empty() || ops.back().kind != 'f') {
+                            error(tok.pos, "unexpected ','");
+                        }
+                        expect_operand = true;
+                        break;
+                    case tok_kind::sep:
+                    case tok_kind::end:
+                        reduce_all();
+                        if (!ops.empty()) {
+                            error(ops.back().pos, "unbalanced '('");
+                        }
+
+                        return {operands.back(), std::move(tok)};
+                    default:
+                        error(tok.pos, "expected an operator");
+                }
+            }
+        }
+    }
+};
+
+} // namespace
+
+} // namespace detail
+
+expression parse_expression(const std::string &s)
+{
+    detail::expr_parser p(s);
+
+    const auto [id, tok] = p.parse();
+    if (tok.kind != detail::tok_kind::end) {
+        throw std::invalid_argument("Error parsing an expression at position " + std::to_string(tok.pos)
+                                    + ": unexpected '" + tok.op + "'");
+    }
+
+    return p.get_node(id);
+}
+
+std::vector<expression> parse_expressions(const std::string &s)
+{
+    detail::expr_parser p(s);
+
+    std::vector<expression> retval;
+    while (!p.at_end()) {
+        const auto [id, tok] = p.parse();
+        if (tok.kind == detail::tok_kind::sep && tok.op != ';') {
+            throw std::invalid_argument("Error parsing an expression at position " + std::to_string(tok.pos)
+                                        + ": unexpected '" + tok.op + "'");
+        }
+
+        retval.push_back(p.get_node(id));
+    }
+
+    return retval;
+}
+
+std::vector<std::pair<expression, expression>> parse_sys(const std::string &s)
+{
+    detail::expr_parser p(s);
+
+    std::vector<std::pair<expression, expression>> retval;
+    while (!p.at_end()) {
+        const auto [lhs, ltok] = p.parse();
+        if (ltok.kind != detail::tok_kind::sep || ltok.op != '=') {
+            throw std::invalid_argument("Error parsing a system of equations at position " + std::to_string(ltok.pos)
+                                        + ": expected '='");
+        }
+
+        const auto [rhs, rtok] = p.parse();
+        if (rtok.kind == detail::tok_kind::sep && rtok.op != ';') {
+            throw std::invalid_argument("Error parsing a system of equations at position " + std::to_string(rtok.pos)
+                                        + ": unexpected '" + rtok.op + "'");
+        }
+
+        retval.emplace_back(p.get_node(lhs), p.get_node(rhs));
+    }
+
+    return retval;
+}
+
+} // namespace heyoka
@@ -24,18 +24,7 @@
 #include <utility>
 #include <vector>
 
-#include <boost/version.hpp>
-
-// NOTE: the header for hash_combine changed in version 1.67.
-#if (BOOST_VERSION / 100000 > 1) || (BOOST_VERSION / 100000 == 1 && BOOST_VERSION / 100 % 1000 >= 67)
-
-#include <boost/container_hash/hash.hpp>
-
-#else
-
-#include <boost/functional/hash.hpp>
-
-#endif
+#include <boost/numeric/conversion/cast.hpp>
 
 #include <fmt/format.h>
 
@@ -52,6 +41,7 @@
 #include <heyoka/detail/type_traits.hpp>
 #include <heyoka/expression.hpp>
 #include <heyoka/func.hpp>
+#include <heyoka/interval.hpp>
 #include <heyoka/variable.hpp>
 
 namespace heyoka
@@ -111,7 +101,7 @@ void func_default_td_impl(func_base &fb, std::vector<std::pair<expression, std::
 {
     for (auto r = fb.get_mutable_args_it(); r.first != r.second; ++r.first) {
         if (const auto dres = taylor_decompose_in_place(std::move(*r.first), u_vars_defs)) {
-            *r.first = expression{variable{"u_" + li_to_string(dres)}};
+            *r.first = expression{detail::make_u_var(boost::numeric_cast<std::uint32_t>(dres))};
         }
     }
 }
@@ -136,7 +126,11 @@ func_inner_base::~func_inner_base() = default;
 
 } // namespace detail
 
-func::func(const func &f) : m_ptr(f.ptr()->clone()) {}
+// NOTE: the copy shares the inner base with f.
+func::func(const func &f) : m_ptr(f.m_ptr)
+{
+    assert(m_ptr);
+}
 
 func::func(func &&) noexcept = default;
 
@@ -164,6 +158,15 @@ const detail::func_inner_base *func::ptr() const
 detail::func_inner_base *func::ptr()
 {
     assert(m_ptr.get() != nullptr);
+
+    // NOTE: the clone is shallow, as the arguments
+    // in turn share their subexpressions.
+    if (m_ptr.use_count() > 1) {
+        m_ptr = m_ptr->clone();
+    } else {
+        m_ptr->m_meta.reset();
+    }
+
     return m_ptr.get();
 }
 
@@ -197,6 +200,11 @@ std::pair<std::vector<expression>::iterator, std::vector<expression>::iterator>
     return ptr()->get_mutable_args_it();
 }
 
+bool func::is_time_dependent() const
+{
+    return ptr()->is_time_dependent();
+}
+
 llvm::Value *func::codegen_dbl(llvm_state &s, const std::vector<llvm::Value *> &v) const
 {
     using namespace fmt::literals;
@@ -327,6 +335,20 @@ double func::deval_num_dbl(const std::vector<double> &v, std::vector<double>::si
     return ptr()->deval_num_dbl(v, i);
 }
 
+interval func::eval_interval_dbl(const std::vector<interval> &v) const
+{
+    if (v.size() != args().size()) {
+        using namespace fmt::literals;
+
+        throw std::invalid_argument(
+            "Inconsistent number of arguments supplied to the double interval evaluation of the function '{}': {} "
+            "arguments were expected, but {} arguments were provided instead"_format(get_name(), args().size(),
+                                                                                     v.size()));
+    }
+
+    return ptr()->eval_interval_dbl(v);
+}
+
 std::vector<std::pair<expression, std::vector<std::uint32_t>>>::size_type
 func::taylor_decompose(std::vector<std::pair<expression, std::vector<std::uint32_t>>> &u_vars_defs) &&
 {
@@ -550,25 +572,21 @@ std::ostream &operator<<(std::ostream &os, const func &f)
     return os;
 }
 
+// NOTE: the implementation of hash() is in expression.cpp,
+// where the hash value is cached in the node.
 std::size_t hash(const func &f)
 {
-    // NOTE: the hash value is computed by combining the hash values of:
-    // - the function name,
-    // - the function inner type index,
-    // - the arguments' hashes.
-    std::size_t seed = std::hash<std::string>{}(f.get_name());
-
-    boost::hash_combine(seed, f.get_type_index());
-
-    for (const auto &arg : f.args()) {
-        boost::hash_combine(seed, hash(arg));
-    }
-
-    return seed;
+    return hash(expression{f});
 }
 
 bool operator==(const func &a, const func &b)
 {
+    // NOTE: functions sharing the inner
+    // base are equal without further checks.
+    if (a.get_ptr() == b.get_ptr()) {
+        return true;
+    }
+
     return a.get_name() == b.get_name() && a.get_type_index() == b.get_type_index() && a.args() == b.args();
 }
 
@@ -577,37 +595,24 @@ bool operator!=(const func &a, const func &b)
     return !(a == b);
 }
 
+// NOTE: the implementations of get_variables(), rename_variables()
+// and subs() are in expression.cpp, where the expression is traversed
+// without recursion.
 std::vector<std::string> get_variables(const func &f)
 {
-    std::vector<std::string> ret;
-
-    for (const auto &arg : f.args()) {
-        auto tmp = get_variables(arg);
-        ret.insert(ret.end(), std::make_move_iterator(tmp.begin()), std::make_move_iterator(tmp.end()));
-        std::sort(ret.begin(), ret.end());
-        ret.erase(std::unique(ret.begin(), ret.end()), ret.end());
-    }
-
-    return ret;
+    return get_variables(expression{f});
 }
 
 void rename_variables(func &f, const std::unordered_map<std::string, std::string> &repl_map)
 {
-    for (auto [b, e] = f.get_mutable_args_it(); b != e; ++b) {
-        rename_variables(*b, repl_map);
-    }
+    expression tmp{std::move(f)};
+    rename_variables(tmp, repl_map);
+    f = std::move(std::get<func>(tmp.value()));
 }
 
-// NOTE: implementing this in-place would perform better.
 expression subs(const func &f, const std::unordered_map<std::string, expression> &smap)
 {
-    auto tmp = f;
-
-    for (auto [b, e] = tmp.get_mutable_args_it(); b != e; ++b) {
-        *b = subs(*b, smap);
-    }
-
-    return expression{std::move(tmp)};
+    return subs(expression{f}, smap);
 }
 
 expression diff(const func &f, const std::string &s)
@@ -636,6 +641,11 @@ double deval_num_dbl(const func &f, const std::vector<double> &in, std::vector<d
     return f.deval_num_dbl(in, d);
 }
 
+interval eval_interval_dbl(const func &f, const std::vector<interval> &in)
+{
+    return f.eval_interval_dbl(in);
+}
+
 void update_node_values_dbl(std::vector<double> &node_values, const func &f,
                             const std::unordered_map<std::string, double> &map,
                             const std::vector<std::vector<std::size_t>> &node_connections, std::size_t &node_counter)
@@ -0,0 +1,194 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <heyoka/expression.hpp>
+#include <heyoka/geopotential.hpp>
+#include <heyoka/math.hpp>
+
+namespace heyoka
+{
+
+std::uint32_t geopotential_n_pars(std::uint32_t n_max)
+{
+    // NOTE: the largest index is (n_max + 1) * (n_max + 2) - 1.
+    if (n_max > 65533u) {
+        throw std::overflow_error("Overflow detected in the computation of the number of parameters of a "
+                                  "geopotential");
+    }
+
+    return (n_max + 1u) * (n_max + 2u);
+}
+
+std::uint32_t geopotential_par_index(std::uint32_t n, std::uint32_t m)
+{
+    if (m > n) {
+        using namespace fmt::literals;
+
+        throw std::invalid_argument(
+            "The order of a coefficient of a geopotential ({}) cannot be larger than its degree ({})"_format(m, n));
+    }
+
+    // Check for overflow.
+    geopotential_n_pars(n);
+
+    return n * (n + 1u) + 2u * m;
+}
+
+namespace detail
+{
+
+namespace
+{
+
+// The normalisation factor of the coefficients of degree n and order m.
+double geopotential_norm(std::uint32_t n, std::uint32_t m)
+{
+    const auto dn = static_cast<double>(n), dm = static_cast<double>(m);
+
+    return std::exp(
+        (std::log((m == 0u ? 1. : 2.) * (2 * dn + 1)) + std::lgamma(dn - dm + 1) - std::lgamma(dn + dm + 1)) / 2);
+}
+
+} // namespace
+
+} // namespace detail
+
+std::array<expression, 3> geopotential_acc(const expression &x, const expression &y, const expression &z,
+                                           std::uint32_t n_max, std::uint32_t m_max, double mu, double R,
+                                           std::uint32_t par_offset)
+{
+    using namespace fmt::literals;
+
+    if (m_max > n_max) {
+        throw std::invalid_argument(
+            "The order of a geopotential ({}) cannot be larger than its degree ({})"_format(m_max, n_max));
+    }
+
+    if (!std::isfinite(mu)) {
+        throw std::invalid_argument(
+            "The gravitational parameter of a geopotential must be finite, but it is {} instead"_format(mu));
+    }
+
+    if (!std::isfinite(R) || R <= 0) {
+        throw std::invalid_argument(
+            "The reference radius of a geopotential must be finite and positive, but it is {} instead"_format(R));
+    }
+
+    if (geopotential_n_pars(n_max) > std::numeric_limits<std::uint32_t>::max() - par_offset) {
+        throw std::overflow_error("Overflow detected in the computation of the indices of the parameters of a "
+                                  "geopotential");
+    }
+
+    // The solid harmonics V_nm and W_nm (normalised by R), for 0 <= m <= n <= n_max + 1
+    // and m <= m_max + 1. W_n0 is identically zero and it is not stored.
+    const auto r2 = sum_sq({x, y, z});
+    const auto i_r2 = expression{1.} / r2;
+    const auto xr = expression{R} * x * i_r2, yr = expression{R} * y * i_r2, zr = expression{R} * z * i_r2;
+    const auto rr = expression{R * R} * i_r2;
+
+    const auto n_rec = n_max + 1u, m_rec = m_max + 1u;
+
+    std::vector<std::vector<expression>> V(n_rec + 1u), W(n_rec + 1u);
+
+    // NOTE: V and W are computed by columns (i.e., for increasing m).
+    for (std::uint32_t m = 0; m <= m_rec; ++m) {
+        for (std::uint32_t n = m; n <= n_rec; ++n) {
+            V[n].resize(m + 1u);
+            W[n].resize(m + 1u);
+        }
+
+        // The sectoral harmonics.
+        if (m == 0u) {
+            V[0][0] = expression{R} * pow(r2, expression{-1. / 2});
+        } else if (m == 1u) {
+            V[1][1] = xr * V[0][0];
+            W[1][1] = yr * V[0][0];
+        } else {
+            const auto fac = expression{2. * m - 1};
+            V[m][m] = fac * (xr * V[m - 1u][m - 1u] - yr * W[m - 1u][m - 1u]);
+            W[m][m] = fac * (xr * W[m - 1u][m - 1u] + yr * V[m - 1u][m - 1u]);
+        }
+
+        // The other harmonics of order m.
+        for (std::uint32_t n = m + 1u; n <= n_rec; ++n) {
+            const auto dn = static_cast<double>(n), dm = static_cast<double>(m);
+            const auto f1 = expression{(2 * dn - 1) / (dn - dm)} * zr;
+
+            if (n == m + 1u) {
+                V[n][m] = f1 * V[n - 1u][m];
+                if (m != 0u) {
+                    W[n][m] = f1 * W[n - 1u][m];
+                }
+            } else {
+                const auto f2 = expression{(dn + dm - 1) / (dn - dm)} * rr;
+
+                V[n][m] = f1 * V[n - 1u][m] - f2 * V[n - 2u][m];
+                if (m != 0u) {
+                    W[n][m] = f1 * W[n - 1u][m] - f2 * W[n - 2u][m];
+                }
+            }
+        }
+    }
+
+    // Accumulate the terms of the accelerations.
+    std::vector<expression> x_acc, y_acc, z_acc;
+
+    for (std::uint32_t n = 0; n <= n_max; ++n) {
+        for (std::uint32_t m = 0; m <= std::min(n, m_max); ++m) {
+            const auto norm = detail::geopotential_norm(n, m);
+            const auto idx = par_offset + geopotential_par_index(n, m);
+
+            const auto C = expression{norm} * par[idx];
+
+            if (m == 0u) {
+                x_acc.push_back(-C * V[n + 1u][1]);
+                y_acc.push_back(-C * W[n + 1u][1]);
+                z_acc.push_back(expression{-static_cast<double>(n + 1u)} * C * V[n + 1u][0]);
+            } else {
+                const auto S = expression{norm} * par[idx + 1u];
+                const auto f = expression{(n - m + 2.) * (n - m + 1.) / 2};
+
+                // NOTE: W_{n+1,0} is zero.
+                const auto Vm = V[n + 1u][m - 1u];
+
+                x_acc.push_back(expression{-.5} * (C * V[n + 1u][m + 1u] + S * W[n + 1u][m + 1u]));
+                y_acc.push_back(expression{.5} * (S * V[n + 1u][m + 1u] - C * W[n + 1u][m + 1u]));
+
+                if (m == 1u) {
+                    x_acc.push_back(f * C * Vm);
+                    y_acc.push_back(f * S * Vm);
+                } else {
+                    const auto Wm = W[n + 1u][m - 1u];
+
+                    x_acc.push_back(f * (C * Vm + S * Wm));
+                    y_acc.push_back(f * (S * Vm - C * Wm));
+                }
+
+                z_acc.push_back(expression{-static_cast<double>(n - m + 1u)}
+                                * (C * V[n + 1u][m] + S * W[n + 1u][m]));
+            }
+        }
+    }
+
+    const auto k = expression{mu / (R * R)};
+
+    return {k * sum(std::move(x_acc)), k * sum(std::move(y_acc)), k * sum(std::move(z_acc))};
+}
+
+} // namespace heyoka
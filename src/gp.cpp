@@ -6,24 +6,47 @@
 // Public License v. 2.0. If a copy of the MPL was not distributed
 // with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cmath>
 #include <cstddef>
+#include <cstdint>
+#include <exception>
 #include <iostream>
 #include <iterator>
+#include <limits>
+#include <numeric>
+#include <optional>
 #include <random>
 #include <stdexcept>
 #include <string>
+#include <thread>
 #include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
 #include <variant>
 #include <vector>
 
+#include <boost/numeric/conversion/cast.hpp>
+
+#include <fmt/format.h>
+
 #include <heyoka/binary_operator.hpp>
+#include <heyoka/compiled_function.hpp>
+#include <heyoka/detail/run_workers.hpp>
+#include <heyoka/detail/traversal.hpp>
 #include <heyoka/detail/type_traits.hpp>
 #include <heyoka/expression.hpp>
+#include <heyoka/expression_arena.hpp>
 #include <heyoka/func.hpp>
 #include <heyoka/gp.hpp>
+#include <heyoka/llvm_state.hpp>
 #include <heyoka/math.hpp>
 #include <heyoka/number.hpp>
+#include <heyoka/param.hpp>
+#include <heyoka/splitmix64.hpp>
 #include <heyoka/variable.hpp>
 
 namespace heyoka
@@ -43,48 +66,263 @@ It random_element(It start, It end, Rng &g)
     return start;
 }
 
-void fetch_from_node_id_impl(expression &ex, std::size_t node_id, std::size_t &node_counter, expression *&ret)
+// Fetch the node with id node_id in the pre-order numbering of the nodes of ex.
+// NOTE: the subtrees which do not contain the node are skipped via their
+// counts, which are cached in the nodes (see get_n_nodes()).
+expression *fetch_from_node_id_impl(expression &ex, std::size_t node_id)
 {
-    if (node_counter == node_id) {
-        ret = &ex;
-    } else {
+    if (node_id >= get_n_nodes(ex)) {
+        return nullptr;
+    }
+
+    auto *cur = &ex;
+    std::size_t node_counter = 0;
+
+    while (node_counter != node_id) {
+        // Skip the current node.
         ++node_counter;
-        std::visit(
-            [node_id, &node_counter, &ret](auto &node) {
+
+        // NOTE: take the mutable arguments of the current node, as the
+        // caller may modify the returned node.
+        auto *next = std::visit(
+            [node_id, &node_counter](auto &node) -> expression * {
                 using type = detail::uncvref_t<decltype(node)>;
-                if constexpr (std::is_same_v<type, binary_operator>) {
-                    for (auto &arg : node.args()) {
-                        fetch_from_node_id_impl(arg, node_id, node_counter, ret);
-                        if (ret) {
-                            return;
+
+                if constexpr (std::is_same_v<type, binary_operator> || std::is_same_v<type, func>) {
+                    auto [b, e] = [&node]() {
+                        if constexpr (std::is_same_v<type, binary_operator>) {
+                            return std::pair{node.args().begin(), node.args().end()};
+                        } else {
+                            return node.get_mutable_args_it();
                         }
-                    }
-                } else if constexpr (std::is_same_v<type, func>) {
-                    for (auto [b, e] = node.get_mutable_args_it(); b != e; ++b) {
-                        fetch_from_node_id_impl(*b, node_id, node_counter, ret);
-                        if (ret) {
-                            return;
+                    }();
+
+                    for (; b != e; ++b) {
+                        const auto n = get_n_nodes(*b);
+
+                        if (node_id < node_counter + n) {
+                            return &*b;
                         }
+
+                        node_counter += n;
                     }
                 }
+
+                return nullptr;
             },
-            ex.value());
+            cur->value());
+
+        assert(next != nullptr);
+        cur = next;
     }
+
+    return cur;
 }
 
-void count_nodes_impl(const expression &e, std::size_t &node_counter)
-{
-    ++node_counter;
-    std::visit(
-        [&node_counter](auto &node) {
-            using type = detail::uncvref_t<decltype(node)>;
-            if constexpr (std::is_same_v<type, func> || std::is_same_v<type, binary_operator>) {
-                for (auto &arg : node.args()) {
-                    count_nodes_impl(arg, node_counter);
+// Maximum number of points processed in a single
+// pass over the tape of an individual.
+constexpr std::size_t population_eval_block_size = 256;
+
+// The tape of an individual, used in the population-level evaluation.
+// The expression is flattened into a topologically-sorted array of
+// nodes (the subexpressions shared among copies are recorded only once),
+// and the params are replaced by their values.
+struct population_tape {
+    enum class node_type : std::uint8_t { var, num, add, sub, mul, div, func };
+
+    struct node {
+        node_type type;
+        // For var nodes, a is the row of the variable in the dataset; for binary
+        // operators, a and b are the indices of the operands; for func nodes, a is the
+        // offset of the indices of the arguments in args and b the number of arguments.
+        std::uint32_t a;
+        std::uint32_t b;
+        // The value of num nodes.
+        double value;
+        // The function object of func nodes.
+        const func *f;
+    };
+
+    std::vector<node> nodes;
+    std::vector<std::uint32_t> args;
+
+    std::uint32_t push(node n)
+    {
+        if (nodes.size() == std::numeric_limits<std::uint32_t>::max()) {
+            throw std::overflow_error("Overflow detected in the number of nodes of an individual");
+        }
+
+        nodes.push_back(n);
+
+        return static_cast<std::uint32_t>(nodes.size() - 1u);
+    }
+
+    void record(const expression &ex, const std::unordered_map<std::string, std::uint32_t> &var_idx,
+                const std::vector<double> &pars)
+    {
+        nodes.clear();
+        args.clear();
+
+        fold_postorder<std::uint32_t>(
+            ex,
+            [&](const expression &n) -> std::uint32_t {
+                if (const auto vptr = std::get_if<variable>(&n.value())) {
+                    const auto it = var_idx.find(vptr->name());
+                    if (it == var_idx.end()) {
+                        throw std::invalid_argument("The variable '" + vptr->name()
+                                                    + "' is not in the list of the variables of the dataset");
+                    }
+
+                    return push(node{node_type::var, it->second, 0, 0, nullptr});
+                } else if (const auto pptr = std::get_if<param>(&n.value())) {
+                    return push(node{node_type::num, 0, 0, eval_dbl(*pptr, {}, pars), nullptr});
+                } else {
+                    return push(node{node_type::num, 0, 0, eval_dbl(std::get<number>(n.value()), {}, {}), nullptr});
+                }
+            },
+            [&](const expression &n, const std::uint32_t *c) -> std::uint32_t {
+                if (const auto bptr = std::get_if<binary_operator>(&n.value())) {
+                    switch (bptr->op()) {
+                        case binary_operator::type::add:
+                            return push(node{node_type::add, c[0], c[1], 0, nullptr});
+                        case binary_operator::type::sub:
+                            return push(node{node_type::sub, c[0], c[1], 0, nullptr});
+                        case binary_operator::type::mul:
+                            return push(node{node_type::mul, c[0], c[1], 0, nullptr});
+                        default:
+                            return push(node{node_type::div, c[0], c[1], 0, nullptr});
+                    }
                 }
+
+                const auto &f = std::get<func>(n.value());
+                const auto n_args = static_cast<std::uint32_t>(f.args().size());
+                const auto offset = static_cast<std::uint32_t>(args.size());
+                args.insert(args.end(), c, c + n_args);
+
+                return push(node{node_type::func, offset, n_args, 0, &f});
+            },
+            [](const expression &) { return true; });
+    }
+
+    // Evaluate the tape over the n points starting at index begin,
+    // returning the sum of the squared residuals. The i-th variable is read
+    // from data + i * stride. vals and fargs are scratch buffers.
+    double sq_res(const double *data, const double *target, std::size_t stride, std::size_t begin, std::size_t n,
+                  std::vector<double> &vals, std::vector<double> &fargs) const
+    {
+        assert(n > 0u && n <= population_eval_block_size);
+        assert(!nodes.empty());
+
+        // NOTE: the values of the i-th node are stored starting from index i * n,
+        // so that the loops over the points operate on contiguous memory
+        // and can be vectorised by the compiler.
+        vals.resize(nodes.size() * n);
+        auto *buf = vals.data();
+
+        for (decltype(nodes.size()) i = 0; i < nodes.size(); ++i) {
+            const auto &nd = nodes[i];
+            auto *v = buf + i * n;
+            // The operands of the binary operators.
+            const double *va = nullptr, *vb = nullptr;
+            if (nd.type != node_type::var && nd.type != node_type::num && nd.type != node_type::func) {
+                va = buf + static_cast<std::size_t>(nd.a) * n;
+                vb = buf + static_cast<std::size_t>(nd.b) * n;
+            }
+
+            switch (nd.type) {
+                case node_type::var: {
+                    const auto *row = data + nd.a * stride + begin;
+                    std::copy(row, row + n, v);
+                    break;
+                }
+                case node_type::num:
+                    std::fill(v, v + n, nd.value);
+                    break;
+                case node_type::add:
+                    for (std::size_t j = 0; j < n; ++j) {
+                        v[j] = va[j] + vb[j];
+                    }
+                    break;
+                case node_type::sub:
+                    for (std::size_t j = 0; j < n; ++j) {
+                        v[j] = va[j] - vb[j];
+                    }
+                    break;
+                case node_type::mul:
+                    for (std::size_t j = 0; j < n; ++j) {
+                        v[j] = va[j] * vb[j];
+                    }
+                    break;
+                case node_type::div:
+                    for (std::size_t j = 0; j < n; ++j) {
+                        v[j] = va[j] / vb[j];
+                    }
+                    break;
+                default:
+                    assert(nd.type == node_type::func);
+
+                    fargs.resize(nd.b);
+                    for (std::size_t j = 0; j < n; ++j) {
+                        for (std::uint32_t k = 0; k < nd.b; ++k) {
+                            fargs[k] = buf[static_cast<std::size_t>(args[nd.a + k]) * n + j];
+                        }
+                        v[j] = nd.f->eval_num_dbl(fargs);
+                    }
+            }
+        }
+
+        const auto *res = buf + (nodes.size() - 1u) * n;
+        double acc = 0;
+        for (std::size_t j = 0; j < n; ++j) {
+            const auto r = res[j] - target[begin + j];
+            acc += r * r;
+        }
+
+        return acc;
+    }
+};
+
+// Solve in-place the symmetric positive-definite system a x = b of size m via a
+// Cholesky decomposition (a is stored in row-major order and it is overwritten).
+// Returns false if a is not (numerically) positive-definite.
+bool cholesky_solve(std::vector<double> &a, std::vector<double> &b, std::size_t m)
+{
+    for (std::size_t j = 0; j < m; ++j) {
+        auto d = a[j * m + j];
+        for (std::size_t k = 0; k < j; ++k) {
+            d -= a[j * m + k] * a[j * m + k];
+        }
+
+        if (!(d > 0)) {
+            return false;
+        }
+
+        a[j * m + j] = std::sqrt(d);
+
+        for (auto i = j + 1u; i < m; ++i) {
+            auto v = a[i * m + j];
+            for (std::size_t k = 0; k < j; ++k) {
+                v -= a[i * m + k] * a[j * m + k];
             }
-        },
-        e.value());
+            a[i * m + j] = v / a[j * m + j];
+        }
+    }
+
+    // Forward and back substitution.
+    for (std::size_t i = 0; i < m; ++i) {
+        for (std::size_t k = 0; k < i; ++k) {
+            b[i] -= a[i * m + k] * b[k];
+        }
+        b[i] /= a[i * m + i];
+    }
+    for (auto i = m; i-- > 0u;) {
+        for (auto k = i + 1u; k < m; ++k) {
+            b[i] -= a[k * m + i] * b[k];
+        }
+        b[i] /= a[i * m + i];
+    }
+
+    return true;
 }
 
 } // namespace
@@ -105,105 +343,144 @@ expression_generator::expression_generator(const std::vector<std::string> &vars,
 };
 
 expression expression_generator::operator()(unsigned min_depth, unsigned max_depth, unsigned depth) const
+{
+    return generate(m_e, min_depth, max_depth, depth);
+}
+
+expression expression_generator::generate(splitmix64 &e, unsigned min_depth, unsigned max_depth,
+                                          unsigned depth) const
 {
     std::uniform_real_distribution<double> rng01(0.0, 1.0);
     std::uniform_real_distribution<double> rngm11(-1.0, 1.0);
 
-    // First we decide what node type this will be.
-    node_type type;
-    if (depth < min_depth) {
-        // If the node depth is below the minimum desired, we force leaves (num or var) to be not selected
-        double n_bos = static_cast<double>(m_bos.size());
-        double n_u_fun = static_cast<double>(m_u_funcs.size());
-        double n_b_fun = static_cast<double>(m_b_funcs.size());
-        std::discrete_distribution<> dis({n_bos * m_weights[0], n_u_fun * m_weights[1], n_b_fun * m_weights[2]});
-        switch (dis(m_e)) {
-            case 0:
-                type = node_type::bo;
-                break;
-            case 1:
-                type = node_type::u_fun;
-                break;
-            case 2:
-                type = node_type::b_fun;
-                break;
-        }
-    } else if (depth >= max_depth) {
-        // If the node depth is above the maximum desired, we force leaves (num or var) to be selected
-        double n_var = static_cast<double>(m_vars.size());
-        std::discrete_distribution<> dis({n_var * m_weights[3], m_weights[4]});
-        switch (dis(m_e)) {
-            case 0:
-                type = node_type::var;
-                break;
-            case 1:
-                type = node_type::num;
-                break;
+    // First we decide what node type this will be. The weights of the node types
+    // are bo, u_fun, b_fun, var and num. If the node depth is below the minimum desired,
+    // leaves (num or var) are not selected, if it is above the maximum desired,
+    // only leaves are selected.
+    // NOTE: the node type is sampled without allocating, as
+    // this is invoked once per node.
+    const auto n_bos = static_cast<double>(m_bos.size());
+    const auto n_u_fun = static_cast<double>(m_u_funcs.size());
+    const auto n_b_fun = static_cast<double>(m_b_funcs.size());
+    const auto n_var = static_cast<double>(m_vars.size());
+    const bool leaves = depth >= min_depth, non_leaves = !leaves || depth < max_depth;
+    const double w[] = {non_leaves ? n_bos * m_weights[0] : 0., non_leaves ? n_u_fun * m_weights[1] : 0.,
+                        non_leaves ? n_b_fun * m_weights[2] : 0., leaves ? n_var * m_weights[3] : 0.,
+                        leaves ? m_weights[4] : 0.};
+    const node_type types[] = {node_type::bo, node_type::u_fun, node_type::b_fun, node_type::var, node_type::num};
+
+    const auto tot = std::accumulate(std::begin(w), std::end(w), 0.);
+    if (!(tot > 0)) {
+        throw std::invalid_argument("Cannot generate a random expression: all the node types have a null probability");
+    }
+
+    // NOTE: pick the last type with nonzero weight by default,
+    // in case of roundoff errors in the accumulation.
+    auto type = node_type::num;
+    for (auto i = std::size(w); i-- > 0u;) {
+        if (w[i] > 0) {
+            type = types[i];
+            break;
         }
-    } else {
-        // else we can get anything
-        double n_bos = static_cast<double>(m_bos.size());
-        double n_u_fun = static_cast<double>(m_u_funcs.size());
-        double n_b_fun = static_cast<double>(m_b_funcs.size());
-        double n_var = static_cast<double>(m_vars.size());
-        std::discrete_distribution<> dis(
-            {n_bos * m_weights[0], n_u_fun * m_weights[1], n_b_fun * m_weights[2], n_var * m_weights[3], m_weights[4]});
-        switch (dis(m_e)) {
-            case 0:
-                type = node_type::bo;
-                break;
-            case 1:
-                type = node_type::u_fun;
-                break;
-            case 2:
-                type = node_type::b_fun;
-                break;
-            case 3:
-                type = node_type::var;
-                break;
-            case 4:
-                type = node_type::num;
-                break;
+    }
+    const auto u = rng01(e) * tot;
+    double cum = 0;
+    for (std::size_t i = 0; i < std::size(w); ++i) {
+        cum += w[i];
+        if (w[i] > 0 && u < cum) {
+            type = types[i];
+            break;
         }
     }
+
     // Once we know the node type we create one at random out of the user defined possible choices
     switch (type) {
         case node_type::num: {
             // We return a random number in -m_range_dbl, m_range_dbl
-            auto value = rngm11(m_e) * m_range_dbl;
+            auto value = rngm11(e) * m_range_dbl;
             return expression{number{value}};
-            break;
         }
         case node_type::var: {
             // We return one of the variables in m_vars
-            auto symbol = *detail::random_element(m_vars.begin(), m_vars.end(), m_e);
+            const auto &symbol = *detail::random_element(m_vars.begin(), m_vars.end(), e);
             return expression{variable{symbol}};
-            break;
         }
         case node_type::bo: {
             // We return one of the binary oprators in m_bos with randomly constructed arguments
-            auto bo_type = *detail::random_element(m_bos.begin(), m_bos.end(), m_e);
-            return expression{binary_operator(bo_type, this->operator()(min_depth, max_depth, depth + 1),
-                                              this->operator()(min_depth, max_depth, depth + 1))};
-            break;
+            auto bo_type = *detail::random_element(m_bos.begin(), m_bos.end(), e);
+            // NOTE: generate the arguments in order.
+            auto lhs = generate(e, min_depth, max_depth, depth + 1);
+            auto rhs = generate(e, min_depth, max_depth, depth + 1);
+            return expression{binary_operator(bo_type, std::move(lhs), std::move(rhs))};
         }
         case node_type::u_fun: {
             // We return one of the unary functions in m_u_funcs with randomly constructed argument
-            auto u_f = *detail::random_element(m_u_funcs.begin(), m_u_funcs.end(), m_e);
-            return u_f(this->operator()(min_depth, max_depth, depth + 1));
-            break;
+            auto u_f = *detail::random_element(m_u_funcs.begin(), m_u_funcs.end(), e);
+            return u_f(generate(e, min_depth, max_depth, depth + 1));
         }
-        case node_type::b_fun: {
+        default: {
             // We return one of the binary functions in m_b_funcs with randomly constructed arguments
-            auto b_f = *detail::random_element(m_b_funcs.begin(), m_b_funcs.end(), m_e);
-            return b_f(this->operator()(min_depth, max_depth, depth + 1),
-                       this->operator()(min_depth, max_depth, depth + 1));
-            break;
+            auto b_f = *detail::random_element(m_b_funcs.begin(), m_b_funcs.end(), e);
+            auto a0 = generate(e, min_depth, max_depth, depth + 1);
+            auto a1 = generate(e, min_depth, max_depth, depth + 1);
+            return b_f(std::move(a0), std::move(a1));
         }
-        default:
-            throw;
     }
-};
+}
+
+std::vector<expression> expression_generator::generate_population(std::size_t n, unsigned min_depth,
+                                                                  unsigned max_depth, unsigned n_threads) const
+{
+    std::vector<expression> retval(n);
+    if (n == 0u) {
+        return retval;
+    }
+
+    // The seed of the random streams.
+    const auto seed = m_e.next();
+
+    if (n_threads == 0u) {
+        n_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    // NOTE: the expressions are handed out in chunks,
+    // so that the counter is not contended.
+    constexpr std::size_t chunk_size = 256;
+    const auto n_chunks = n / chunk_size + static_cast<std::size_t>(n % chunk_size != 0u);
+    if (n_threads > n_chunks) {
+        n_threads = static_cast<unsigned>(n_chunks);
+    }
+
+    std::atomic<std::size_t> next_chunk(0);
+    std::vector<std::exception_ptr> eptrs(n_threads);
+
+    auto worker_func = [&](unsigned thread_idx) {
+        try {
+            // NOTE: the nodes are allocated from a per-thread arena.
+            expression_arena arena;
+
+            for (auto c = next_chunk.fetch_add(1); c < n_chunks; c = next_chunk.fetch_add(1)) {
+                for (auto i = c * chunk_size; i < std::min(n, (c + 1u) * chunk_size); ++i) {
+                    // The stream of the i-th expression is seeded with
+                    // the i-th value of the sequence starting from seed.
+                    splitmix64 e{seed};
+                    e.jump(i);
+                    splitmix64 ei{e.next()};
+
+                    retval[i] = generate(ei, min_depth, max_depth, 0);
+                }
+            }
+        } catch (...) {
+            eptrs[thread_idx] = std::current_exception();
+
+            next_chunk.store(n_chunks);
+        }
+    };
+
+    detail::run_workers(n_threads, worker_func, [&]() { next_chunk.store(n_chunks); }, eptrs);
+
+    return retval;
+}
 
 const std::vector<binary_operator::type> &expression_generator::get_bos() const
 {
@@ -351,19 +628,12 @@ void mutate(expression &e, std::size_t node_id, const expression_generator &gene
 
 std::size_t count_nodes(const expression &e)
 {
-    std::size_t node_counter = 0u;
-    detail::count_nodes_impl(e, node_counter);
-    return node_counter;
+    return get_n_nodes(e);
 }
 
 expression *fetch_from_node_id(expression &ex, std::size_t node_id)
 {
-    std::size_t cur_id = 0;
-    expression *ret = nullptr;
-
-    detail::fetch_from_node_id_impl(ex, node_id, cur_id, ret);
-
-    return ret;
+    return detail::fetch_from_node_id_impl(ex, node_id);
 }
 
 // Crossover
@@ -395,4 +665,398 @@ void crossover(expression &e1, expression &e2, std::size_t node_id1, std::size_t
     swap(*e2_sub_ptr, *e1_sub_ptr);
 }
 
+fitness_cache::fitness_cache() = default;
+fitness_cache::fitness_cache(const fitness_cache &) = default;
+fitness_cache::fitness_cache(fitness_cache &&) noexcept = default;
+fitness_cache &fitness_cache::operator=(const fitness_cache &) = default;
+fitness_cache &fitness_cache::operator=(fitness_cache &&) noexcept = default;
+fitness_cache::~fitness_cache() = default;
+
+std::optional<double> fitness_cache::find(const expression &ex)
+{
+    const auto key = detail::node_key(ex);
+
+    if (key != nullptr) {
+        if (const auto it = m_id_map.find(key); it != m_id_map.end()) {
+            return it->second.second;
+        }
+    }
+
+    const auto it = m_map.find(ex);
+    if (it == m_map.end()) {
+        return {};
+    }
+
+    // Record the identity of ex, so that the next
+    // lookups of its copies will not need hashing.
+    if (key != nullptr) {
+        m_id_map.emplace(key, std::pair{ex, it->second});
+    }
+
+    return it->second;
+}
+
+void fitness_cache::insert(const expression &ex, double value)
+{
+    if (const auto key = detail::node_key(ex); key != nullptr) {
+        m_id_map.insert_or_assign(key, std::pair{ex, value});
+    }
+
+    m_map.insert_or_assign(ex, value);
+}
+
+std::size_t fitness_cache::size() const
+{
+    return m_map.size();
+}
+
+void fitness_cache::clear()
+{
+    m_id_map.clear();
+    m_map.clear();
+}
+
+namespace detail
+{
+
+namespace
+{
+
+// Evaluate the mean squared errors of the individuals
+// pop[idx[0]], pop[idx[1]], ... in parallel.
+std::vector<double> population_mse_impl(const std::vector<expression> &pop, const std::vector<std::size_t> &idx,
+                                        const std::unordered_map<std::string, std::uint32_t> &var_idx,
+                                        const double *data, const double *target, std::size_t n_points,
+                                        const std::vector<double> &pars, unsigned n_threads)
+{
+    std::vector<double> retval(idx.size());
+    if (idx.empty()) {
+        return retval;
+    }
+
+    // Determine the number of worker threads.
+    if (n_threads == 0u) {
+        n_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    if (n_threads > idx.size()) {
+        n_threads = static_cast<unsigned>(idx.size());
+    }
+
+    // NOTE: the individuals are handed out dynamically one by one,
+    // as their evaluation costs may differ wildly.
+    std::atomic<std::size_t> next_idx(0);
+
+    std::vector<std::exception_ptr> eptrs(n_threads);
+
+    auto worker_func = [&](unsigned thread_idx) {
+        try {
+            // NOTE: the tape and the buffers are reused
+            // across the individuals.
+            population_tape tape;
+            std::vector<double> vals, fargs;
+
+            for (auto i = next_idx.fetch_add(1); i < idx.size(); i = next_idx.fetch_add(1)) {
+                tape.record(pop[idx[i]], var_idx, pars);
+
+                double acc = 0;
+                for (std::size_t begin = 0; begin < n_points; begin += population_eval_block_size) {
+                    acc += tape.sq_res(data, target, n_points, begin,
+                                       std::min(population_eval_block_size, n_points - begin), vals, fargs);
+                }
+
+                retval[i] = acc / static_cast<double>(n_points);
+            }
+        } catch (...) {
+            eptrs[thread_idx] = std::current_exception();
+
+            // Stop the other workers.
+            next_idx.store(idx.size());
+        }
+    };
+
+    run_workers(n_threads, worker_func, [&]() { next_idx.store(idx.size()); }, eptrs);
+
+    return retval;
+}
+
+} // namespace
+
+} // namespace detail
+
+std::vector<double> population_mse(const std::vector<expression> &pop, const std::vector<std::string> &vars,
+                                   const double *data, const double *target, std::size_t n_points,
+                                   const std::vector<double> &pars, unsigned n_threads)
+{
+    // NOTE: the duplicates within pop are
+    // evaluated only once.
+    fitness_cache cache;
+
+    return population_mse(pop, vars, data, target, n_points, cache, pars, n_threads);
+}
+
+std::vector<double> population_mse(const std::vector<expression> &pop, const std::vector<std::string> &vars,
+                                   const double *data, const double *target, std::size_t n_points,
+                                   fitness_cache &cache, const std::vector<double> &pars, unsigned n_threads)
+{
+    if (n_points == 0u) {
+        throw std::invalid_argument("Cannot evaluate the fitness of a population over an empty dataset");
+    }
+
+    if (vars.size() > std::numeric_limits<std::uint32_t>::max()) {
+        throw std::overflow_error("Overflow detected in the number of variables of a dataset");
+    }
+
+    std::unordered_map<std::string, std::uint32_t> var_idx;
+    for (decltype(vars.size()) i = 0; i < vars.size(); ++i) {
+        if (!var_idx.emplace(vars[i], static_cast<std::uint32_t>(i)).second) {
+            throw std::invalid_argument("The list of variables of a dataset contains duplicates");
+        }
+    }
+
+    std::vector<double> retval(pop.size());
+
+    // Determine the individuals to be evaluated: todo contains the indices
+    // of the individuals which are neither in the cache nor duplicates of an
+    // individual already in todo. For each individual in pop, src contains
+    // the position of its representative in todo (or npos, if its fitness
+    // was found in the cache). The duplicates are looked up first via the
+    // identity of their nodes and then via hashing.
+    constexpr auto npos = std::numeric_limits<std::size_t>::max();
+    std::vector<std::size_t> todo, src(pop.size(), npos);
+    std::unordered_map<const void *, std::size_t> id_todo;
+    std::unordered_map<expression, std::size_t> st_todo;
+
+    for (decltype(pop.size()) i = 0; i < pop.size(); ++i) {
+        if (const auto cached = cache.find(pop[i])) {
+            retval[i] = *cached;
+            continue;
+        }
+
+        const auto key = detail::node_key(pop[i]);
+        if (key != nullptr) {
+            if (const auto it = id_todo.find(key); it != id_todo.end()) {
+                src[i] = it->second;
+                continue;
+            }
+        }
+
+        const auto [it, new_ind] = st_todo.try_emplace(pop[i], todo.size());
+        if (new_ind) {
+            todo.push_back(i);
+        }
+        src[i] = it->second;
+
+        if (key != nullptr) {
+            id_todo.emplace(key, it->second);
+        }
+    }
+
+    const auto vals = detail::population_mse_impl(pop, todo, var_idx, data, target, n_points, pars, n_threads);
+
+    for (decltype(pop.size()) i = 0; i < pop.size(); ++i) {
+        if (src[i] != npos) {
+            retval[i] = vals[src[i]];
+        }
+    }
+
+    // NOTE: the cache is updated only after
+    // a successful evaluation.
+    for (decltype(todo.size()) i = 0; i < todo.size(); ++i) {
+        cache.insert(pop[todo[i]], vals[i]);
+    }
+
+    return retval;
+}
+
+std::pair<expression, std::vector<double>> numbers_to_pars(const expression &ex)
+{
+    const auto n0 = get_param_size(ex);
+
+    std::vector<double> values;
+
+    auto ret = detail::transform_postorder(ex, [&](const expression &n) {
+        if (const auto nptr = std::get_if<number>(&n.value())) {
+            if (values.size() >= std::numeric_limits<std::uint32_t>::max() - n0) {
+                throw std::overflow_error("Overflow detected in the number of params of an expression");
+            }
+
+            values.push_back(eval_dbl(*nptr, {}, {}));
+
+            return expression{param{static_cast<std::uint32_t>(n0 + (values.size() - 1u))}};
+        }
+
+        return n;
+    });
+
+    return {std::move(ret), std::move(values)};
+}
+
+std::pair<expression, double> optimise_constants(const expression &ex, const std::vector<std::string> &vars,
+                                                 const double *data, const double *target, std::size_t n_points,
+                                                 const std::vector<double> &pars, unsigned max_iter)
+{
+    using namespace fmt::literals;
+
+    if (n_points == 0u) {
+        throw std::invalid_argument("Cannot optimise the constants of an expression over an empty dataset");
+    }
+
+    std::vector<expression> vars_ex;
+    {
+        std::unordered_set<std::string> names;
+        for (const auto &name : vars) {
+            if (!names.insert(name).second) {
+                throw std::invalid_argument("The list of variables of a dataset contains duplicates");
+            }
+
+            vars_ex.emplace_back(variable{name});
+        }
+    }
+
+    const auto n_fixed = get_param_size(ex);
+    if (pars.size() < n_fixed) {
+        throw std::invalid_argument("The optimisation of the constants of an expression requires {} param value(s), "
+                                    "but only {} value(s) were provided"_format(n_fixed, pars.size()));
+    }
+
+    auto [ex_p, cvals] = numbers_to_pars(ex);
+    const auto m = cvals.size();
+
+    if (m == 0u) {
+        // Nothing to optimise.
+        return {ex, population_mse({ex}, vars, data, target, n_points, pars, 1)[0]};
+    }
+
+    // The params of ex_p: the fixed ones, followed by the constants.
+    std::vector<double> p(pars.begin(), pars.begin() + n_fixed);
+    p.insert(p.end(), cvals.begin(), cvals.end());
+    const auto n_p = p.size();
+
+    if (n_points > std::numeric_limits<std::size_t>::max() / (n_p + 1u)) {
+        throw std::overflow_error("Overflow detected in the optimisation of the constants of an expression");
+    }
+
+    // JIT-compile the value and the gradient with respect
+    // to the params, in scalar and in batch mode.
+    llvm_state s;
+    const auto batch_size = detail::cfunc_default_batch_size<double>(s);
+    add_cfunc_par_jac<double>(s, "fit", {ex_p}, vars_ex, 1);
+    if (batch_size > 1u) {
+        add_cfunc_par_jac<double>(s, "fit.batch", {ex_p}, vars_ex, batch_size);
+    }
+    s.compile();
+
+    using fit_t = void (*)(double *, const double *, const double *, std::uint64_t);
+    auto *f_scalar = reinterpret_cast<fit_t>(s.jit_lookup("fit"));
+    auto *f_batch = batch_size > 1u ? reinterpret_cast<fit_t>(s.jit_lookup("fit.batch")) : f_scalar;
+
+    const auto stride = boost::numeric_cast<std::uint64_t>(n_points);
+
+    // Evaluate the value and the gradient with the params cur_p into buf, and
+    // assemble the normal equations (jtj and jtr) of the Gauss-Newton step
+    // with respect to the constants. Returns the sum of the squared residuals.
+    std::vector<double> buf((n_p + 1u) * n_points), buf_new(buf.size());
+    std::vector<double> jtj(m * m), jtr(m), jtj_new(m * m), jtr_new(m);
+    auto eval = [&](const std::vector<double> &cur_p, std::vector<double> &b, std::vector<double> &a,
+                    std::vector<double> &g) {
+        std::size_t i = 0;
+        for (; n_points - i >= batch_size; i += batch_size) {
+            f_batch(b.data() + i, data + i, cur_p.data(), stride);
+        }
+        for (; i < n_points; ++i) {
+            f_scalar(b.data() + i, data + i, cur_p.data(), stride);
+        }
+
+        std::fill(a.begin(), a.end(), 0.);
+        std::fill(g.begin(), g.end(), 0.);
+
+        double cost = 0;
+        // NOTE: the derivatives with respect to the constants
+        // start at the row 1 + n_fixed of the buffer.
+        const auto *jac = b.data() + (1u + n_fixed) * n_points;
+        for (std::size_t k = 0; k < n_points; ++k) {
+            const auto r = b[k] - target[k];
+            cost += r * r;
+
+            for (std::size_t u = 0; u < m; ++u) {
+                const auto ju = jac[u * n_points + k];
+                g[u] += ju * r;
+                for (std::size_t v = 0; v <= u; ++v) {
+                    a[u * m + v] += ju * jac[v * n_points + k];
+                }
+            }
+        }
+
+        // Fill in the upper triangle.
+        for (std::size_t u = 0; u < m; ++u) {
+            for (auto v = u + 1u; v < m; ++v) {
+                a[u * m + v] = a[v * m + u];
+            }
+        }
+
+        return cost;
+    };
+
+    auto cost = eval(p, buf, jtj, jtr);
+
+    // The Levenberg-Marquardt iterations. The damping term is
+    // lambda * (diag(jtj) + 1), so that the constants with a null
+    // derivative do not make the system singular.
+    double lambda = 1e-3;
+    std::vector<double> a(m * m), delta(m), p_new(n_p);
+    for (unsigned it = 0; it < max_iter && std::isfinite(cost) && cost > 0; ++it) {
+        a = jtj;
+        for (std::size_t u = 0; u < m; ++u) {
+            a[u * m + u] += lambda * (jtj[u * m + u] + 1.);
+            delta[u] = -jtr[u];
+        }
+
+        if (!detail::cholesky_solve(a, delta, m)) {
+            lambda *= 10;
+            continue;
+        }
+
+        p_new = p;
+        for (std::size_t u = 0; u < m; ++u) {
+            p_new[n_fixed + u] += delta[u];
+        }
+
+        const auto cost_new = eval(p_new, buf_new, jtj_new, jtr_new);
+
+        if (std::isfinite(cost_new) && cost_new < cost) {
+            const auto converged = cost - cost_new <= 1e-12 * cost;
+
+            p.swap(p_new);
+            buf.swap(buf_new);
+            jtj.swap(jtj_new);
+            jtr.swap(jtr_new);
+            cost = cost_new;
+            lambda = std::max(lambda / 10, 1e-12);
+
+            if (converged) {
+                break;
+            }
+        } else {
+            lambda *= 10;
+            if (lambda > 1e12) {
+                break;
+            }
+        }
+    }
+
+    // Put the optimised constants back into ex. NOTE: the numbers
+    // are visited in the same order as in numbers_to_pars().
+    std::size_t c_idx = 0;
+    auto ret = detail::transform_postorder(ex, [&](const expression &n) {
+        if (std::holds_alternative<number>(n.value())) {
+            assert(c_idx < m);
+            return expression{number{p[n_fixed + c_idx++]}};
+        }
+
+        return n;
+    });
+
+    return {std::move(ret), cost / static_cast<double>(n_points)};
+}
+
 } // namespace heyoka
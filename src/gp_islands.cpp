@@ -0,0 +1,316 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <heyoka/detail/run_workers.hpp>
+#include <heyoka/expression.hpp>
+#include <heyoka/gp.hpp>
+#include <heyoka/gp_islands.hpp>
+#include <heyoka/splitmix64.hpp>
+
+namespace heyoka
+{
+
+namespace detail
+{
+
+namespace
+{
+
+// The number of individuals taking part in a tournament.
+constexpr std::size_t gp_islands_tournament_size = 3;
+
+// The maximum number of nodes of the offspring of a crossover:
+// the larger offspring are discarded, in order to limit the bloat.
+constexpr std::size_t gp_islands_max_nodes = 256;
+
+// Fitness used for the comparisons, mapping the non-finite
+// values to infinity.
+double gp_islands_cmp_fitness(double f)
+{
+    return std::isfinite(f) ? f : std::numeric_limits<double>::infinity();
+}
+
+// Pick the index of the best of gp_islands_tournament_size random individuals.
+std::size_t gp_islands_tournament(const std::vector<double> &fitness, splitmix64 &engine)
+{
+    std::uniform_int_distribution<std::size_t> dist(0, fitness.size() - 1u);
+
+    auto retval = dist(engine);
+    for (std::size_t i = 1; i < gp_islands_tournament_size; ++i) {
+        const auto idx = dist(engine);
+        if (gp_islands_cmp_fitness(fitness[idx]) < gp_islands_cmp_fitness(fitness[retval])) {
+            retval = idx;
+        }
+    }
+
+    return retval;
+}
+
+// The indices of the individuals of an island, sorted by increasing fitness.
+std::vector<std::size_t> gp_islands_ranking(const std::vector<double> &fitness)
+{
+    std::vector<std::size_t> retval(fitness.size());
+    std::iota(retval.begin(), retval.end(), std::size_t(0));
+    std::stable_sort(retval.begin(), retval.end(), [&fitness](std::size_t a, std::size_t b) {
+        return gp_islands_cmp_fitness(fitness[a]) < gp_islands_cmp_fitness(fitness[b]);
+    });
+
+    return retval;
+}
+
+} // namespace
+
+} // namespace detail
+
+gp_islands::gp_islands(const expression_generator &generator, const double *data, const double *target,
+                       std::size_t n_points, std::size_t n_islands, std::size_t pop_size, std::uint64_t seed,
+                       unsigned min_depth, unsigned max_depth, double crossover_p, double mutation_p)
+    : m_data(data), m_target(target), m_n_points(n_points), m_min_depth(min_depth), m_max_depth(max_depth),
+      m_crossover_p(crossover_p), m_mutation_p(mutation_p)
+{
+    if (n_islands == 0u) {
+        throw std::invalid_argument("The number of islands of an island model cannot be zero");
+    }
+
+    if (pop_size == 0u) {
+        throw std::invalid_argument("The population size of an island model cannot be zero");
+    }
+
+    if (n_points == 0u) {
+        throw std::invalid_argument("Cannot run an island model over an empty dataset");
+    }
+
+    if (!(crossover_p >= 0 && crossover_p <= 1) || !(mutation_p >= 0 && mutation_p <= 1)) {
+        throw std::invalid_argument("The crossover and mutation probabilities of an island model must be in the "
+                                    "[0, 1] range");
+    }
+
+    // NOTE: the seed of each island is drawn from a splitmix64 sequence, so that
+    // the engines of the islands are statistically independent.
+    splitmix64 seeder{seed};
+
+    for (std::size_t i = 0; i < n_islands; ++i) {
+        splitmix64 engine{seeder.next()};
+
+        // NOTE: each island has its own generator (with its own internal
+        // engine), with the same building blocks as the template.
+        expression_generator gen(generator.get_vars(), engine);
+        gen.set_bos(generator.get_bos());
+        gen.set_u_funcs(generator.get_u_funcs());
+        gen.set_b_funcs(generator.get_b_funcs());
+        gen.set_range_dbl(generator.get_range_dbl());
+        gen.set_weights(generator.get_weights());
+
+        auto pop = gen.generate_population(pop_size, min_depth, max_depth, 1);
+
+        m_islands.push_back(island{std::move(gen), engine, std::move(pop), {}, {}});
+    }
+
+    for (auto &isl : m_islands) {
+        evaluate(isl);
+    }
+}
+
+gp_islands::gp_islands(const gp_islands &) = default;
+
+gp_islands::gp_islands(gp_islands &&) noexcept = default;
+
+gp_islands &gp_islands::operator=(const gp_islands &) = default;
+
+gp_islands &gp_islands::operator=(gp_islands &&) noexcept = default;
+
+gp_islands::~gp_islands() = default;
+
+const std::vector<gp_islands::island> &gp_islands::get_islands() const
+{
+    return m_islands;
+}
+
+std::size_t gp_islands::get_n_gens() const
+{
+    return m_n_gens;
+}
+
+// Compute the fitness of the population of isl.
+void gp_islands::evaluate(island &isl) const
+{
+    // NOTE: bound the memory used by the cache, by clearing it
+    // when it grows much larger than the population.
+    if (isl.cache.size() > 8u * isl.pop.size()) {
+        isl.cache.clear();
+    }
+
+    // NOTE: the islands run in parallel, thus
+    // each island is evaluated in a single thread.
+    isl.fitness = population_mse(isl.pop, isl.generator.get_vars(), m_data, m_target, m_n_points, isl.cache, {}, 1);
+}
+
+// Evolve isl for n_gens generations.
+void gp_islands::evolve_island(island &isl, std::size_t n_gens) const
+{
+    std::uniform_real_distribution<> rng01(0., 1.);
+
+    const auto pop_size = isl.pop.size();
+    std::vector<expression> offspring;
+    offspring.reserve(pop_size);
+
+    for (std::size_t g = 0; g < n_gens; ++g) {
+        offspring.clear();
+
+        // Elitism: the best individual survives unchanged.
+        const auto best = static_cast<std::size_t>(
+            std::min_element(isl.fitness.begin(), isl.fitness.end(),
+                             [](double a, double b) {
+                                 return detail::gp_islands_cmp_fitness(a) < detail::gp_islands_cmp_fitness(b);
+                             })
+            - isl.fitness.begin());
+        offspring.push_back(isl.pop[best]);
+
+        while (offspring.size() < pop_size) {
+            auto child = isl.pop[detail::gp_islands_tournament(isl.fitness, isl.engine)];
+
+            if (rng01(isl.engine) < m_crossover_p) {
+                auto other = isl.pop[detail::gp_islands_tournament(isl.fitness, isl.engine)];
+                auto orig = child;
+
+                crossover(child, other, isl.engine);
+
+                if (count_nodes(child) > detail::gp_islands_max_nodes) {
+                    child = std::move(orig);
+                }
+            }
+
+            mutate(child, isl.generator, m_mutation_p, isl.engine, m_min_depth, m_max_depth);
+
+            offspring.push_back(std::move(child));
+        }
+
+        isl.pop.swap(offspring);
+        evaluate(isl);
+    }
+}
+
+// Ring migration: the best n_migrants individuals of each island
+// replace the worst individuals of the next island.
+void gp_islands::migrate(std::size_t n_migrants)
+{
+    const auto n_islands = m_islands.size();
+    if (n_islands < 2u) {
+        return;
+    }
+
+    // NOTE: the migrants are selected before any replacement, so that
+    // the result does not depend on the order of the islands.
+    std::vector<std::vector<std::pair<expression, double>>> migrants(n_islands);
+    for (std::size_t i = 0; i < n_islands; ++i) {
+        const auto &isl = m_islands[i];
+        const auto ranking = detail::gp_islands_ranking(isl.fitness);
+        const auto n = std::min(n_migrants, ranking.size());
+
+        for (std::size_t k = 0; k < n; ++k) {
+            migrants[i].emplace_back(isl.pop[ranking[k]], isl.fitness[ranking[k]]);
+        }
+    }
+
+    for (std::size_t i = 0; i < n_islands; ++i) {
+        auto &dest = m_islands[(i + 1u) % n_islands];
+        const auto ranking = detail::gp_islands_ranking(dest.fitness);
+
+        for (std::size_t k = 0; k < migrants[i].size(); ++k) {
+            const auto idx = ranking[ranking.size() - 1u - k];
+
+            dest.pop[idx] = migrants[i][k].first;
+            dest.fitness[idx] = migrants[i][k].second;
+        }
+    }
+}
+
+void gp_islands::evolve(std::size_t n_gens, std::size_t migration_interval, std::size_t n_migrants,
+                        unsigned n_threads)
+{
+    if (migration_interval == 0u) {
+        throw std::invalid_argument("The migration interval of an island model cannot be zero");
+    }
+
+    const auto n_islands = m_islands.size();
+
+    if (n_threads == 0u) {
+        n_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    if (n_threads > n_islands) {
+        n_threads = static_cast<unsigned>(n_islands);
+    }
+
+    while (n_gens > 0u) {
+        // Evolve the islands in parallel until the next migration.
+        const auto epoch = std::min(n_gens, migration_interval - m_n_gens % migration_interval);
+
+        // NOTE: the islands are handed out dynamically,
+        // as their evolution costs may differ.
+        std::atomic<std::size_t> next_idx(0);
+
+        std::vector<std::exception_ptr> eptrs(n_threads);
+
+        auto worker_func = [&](unsigned thread_idx) {
+            try {
+                for (auto i = next_idx.fetch_add(1); i < n_islands; i = next_idx.fetch_add(1)) {
+                    evolve_island(m_islands[i], epoch);
+                }
+            } catch (...) {
+                eptrs[thread_idx] = std::current_exception();
+
+                // Stop the other workers.
+                next_idx.store(n_islands);
+            }
+        };
+
+        detail::run_workers(n_threads, worker_func, [&]() { next_idx.store(n_islands); }, eptrs);
+
+        m_n_gens += epoch;
+        n_gens -= epoch;
+
+        if (m_n_gens % migration_interval == 0u) {
+            migrate(n_migrants);
+        }
+    }
+}
+
+std::pair<expression, double> gp_islands::get_best() const
+{
+    const island *best_isl = nullptr;
+    std::size_t best_idx = 0;
+
+    for (const auto &isl : m_islands) {
+        for (std::size_t i = 0; i < isl.pop.size(); ++i) {
+            if (best_isl == nullptr
+                || detail::gp_islands_cmp_fitness(isl.fitness[i])
+                       < detail::gp_islands_cmp_fitness(best_isl->fitness[best_idx])) {
+                best_isl = &isl;
+                best_idx = i;
+            }
+        }
+    }
+
+    return {best_isl->pop[best_idx], best_isl->fitness[best_idx]};
+}
+
+} // namespace heyoka
@@ -0,0 +1,739 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include <heyoka/binary_operator.hpp>
+#include <heyoka/detail/traversal.hpp>
+#include <heyoka/detail/type_traits.hpp>
+#include <heyoka/expression.hpp>
+#include <heyoka/func.hpp>
+#include <heyoka/gp.hpp>
+#include <heyoka/gp_program.hpp>
+#include <heyoka/number.hpp>
+#include <heyoka/param.hpp>
+#include <heyoka/splitmix64.hpp>
+#include <heyoka/variable.hpp>
+
+namespace heyoka
+{
+
+namespace detail
+{
+
+namespace
+{
+
+// Maximum number of points processed
+// in a single pass over the program.
+constexpr std::size_t gp_program_block_size = 256;
+
+// Write into children the indices of the roots of the subtrees of the arguments
+// of the k-th instruction in code, in the order of the arguments.
+void gp_program_children(const std::vector<gp_program::instruction> &code, std::size_t k,
+                         std::vector<std::size_t> &children)
+{
+    children.clear();
+
+    // NOTE: walk backwards from the last argument.
+    const auto b = k + 1u - code[k].size;
+    for (auto c = k; c > b;) {
+        --c;
+        children.push_back(c);
+        c -= code[c].size - 1u;
+    }
+
+    std::reverse(children.begin(), children.end());
+}
+
+} // namespace
+
+} // namespace detail
+
+gp_program::gp_program(const expression &ex, std::vector<std::string> vars)
+{
+    // Deduce or validate the list of variables.
+    if (vars.empty()) {
+        for (auto &name : get_variables(ex)) {
+            vars.push_back(std::move(name));
+        }
+        std::sort(vars.begin(), vars.end());
+        vars.erase(std::unique(vars.begin(), vars.end()), vars.end());
+    } else if (std::set<std::string>(vars.begin(), vars.end()).size() != vars.size()) {
+        throw std::invalid_argument("The list of variables of a program contains duplicates");
+    }
+
+    if (vars.size() > std::numeric_limits<std::uint32_t>::max()) {
+        throw std::overflow_error("Overflow detected in the number of variables of a program");
+    }
+
+    m_vars = std::move(vars);
+
+    std::unordered_map<std::string, std::uint32_t> var_idx;
+    for (decltype(m_vars.size()) i = 0; i < m_vars.size(); ++i) {
+        var_idx.emplace(m_vars[i], static_cast<std::uint32_t>(i));
+    }
+
+    // Emit the instruction for the node ex.
+    // NOTE: the sizes of the subtrees are
+    // computed later, in finalise().
+    auto emit = [&](const expression &e) {
+        if (m_code.size() == std::numeric_limits<std::uint32_t>::max()) {
+            throw std::overflow_error("Overflow detected in the number of instructions of a program");
+        }
+
+        std::visit(
+            [&](const auto &v) {
+                using type = detail::uncvref_t<decltype(v)>;
+
+                if constexpr (std::is_same_v<type, number>) {
+                    m_code.push_back(instruction{op_code::num, static_cast<std::uint32_t>(m_nums.size()), 0});
+                    m_nums.push_back(v);
+                } else if constexpr (std::is_same_v<type, param>) {
+                    m_code.push_back(instruction{op_code::par, v.idx(), 0});
+                } else if constexpr (std::is_same_v<type, variable>) {
+                    const auto it = var_idx.find(v.name());
+                    if (it == var_idx.end()) {
+                        throw std::invalid_argument("The variable '" + v.name()
+                                                    + "' is not in the list of the variables of the program");
+                    }
+
+                    m_code.push_back(instruction{op_code::var, it->second, 0});
+                } else if constexpr (std::is_same_v<type, binary_operator>) {
+                    switch (v.op()) {
+                        case binary_operator::type::add:
+                            m_code.push_back(instruction{op_code::add, 0, 0});
+                            break;
+                        case binary_operator::type::sub:
+                            m_code.push_back(instruction{op_code::sub, 0, 0});
+                            break;
+                        case binary_operator::type::mul:
+                            m_code.push_back(instruction{op_code::mul, 0, 0});
+                            break;
+                        default:
+                            m_code.push_back(instruction{op_code::div, 0, 0});
+                    }
+                } else if constexpr (std::is_same_v<type, func>) {
+                    m_code.push_back(instruction{op_code::func, static_cast<std::uint32_t>(m_funcs.size()), 0});
+                    m_funcs.push_back(e);
+                } else {
+                    static_assert(detail::always_false_v<type>, "Unhandled expression type.");
+                }
+            },
+            e.value());
+    };
+
+    // Post-order visit of the tree of ex.
+    // NOTE: the shared subexpressions are not memoised,
+    // so that each node of the tree becomes an instruction.
+    std::vector<std::pair<const expression *, bool>> stack{{&ex, false}};
+    while (!stack.empty()) {
+        const auto [cur, expanded] = stack.back();
+        stack.pop_back();
+
+        const auto [b, e] = detail::node_args(*cur);
+
+        if (!expanded && b != e) {
+            stack.emplace_back(cur, true);
+
+            for (auto it = e; it != b;) {
+                stack.emplace_back(--it, false);
+            }
+        } else {
+            emit(*cur);
+        }
+    }
+
+    finalise();
+}
+
+gp_program::gp_program(const gp_program &) = default;
+
+gp_program::gp_program(gp_program &&) noexcept = default;
+
+gp_program &gp_program::operator=(const gp_program &) = default;
+
+gp_program &gp_program::operator=(gp_program &&) noexcept = default;
+
+gp_program::~gp_program() = default;
+
+// Compute the sizes of the subtrees, the pre-order index of the nodes,
+// the maximum depth of the stack and the number of params, and remove from
+// the tables the numbers and the functions which are not referenced any more.
+void gp_program::finalise()
+{
+    std::vector<number> nums;
+    std::vector<expression> funcs;
+    std::vector<std::uint32_t> sizes;
+
+    m_max_depth = 0;
+    m_n_pars = 0;
+
+    // NOTE: each entry of the tables is referred
+    // to by a single instruction.
+    for (auto &ins : m_code) {
+        std::uint32_t arity = 0;
+
+        switch (ins.op) {
+            case op_code::num:
+                nums.push_back(std::move(m_nums[ins.idx]));
+                ins.idx = static_cast<std::uint32_t>(nums.size() - 1u);
+                break;
+            case op_code::par:
+                m_n_pars = std::max(m_n_pars, ins.idx + 1u);
+                break;
+            case op_code::func: {
+                const auto [b, e] = detail::node_args(m_funcs[ins.idx]);
+                arity = static_cast<std::uint32_t>(e - b);
+                funcs.push_back(std::move(m_funcs[ins.idx]));
+                ins.idx = static_cast<std::uint32_t>(funcs.size() - 1u);
+                break;
+            }
+            case op_code::var:
+                break;
+            default:
+                arity = 2;
+        }
+
+        assert(sizes.size() >= arity);
+        std::uint32_t size = 1;
+        for (std::uint32_t i = 0; i < arity; ++i) {
+            size += sizes.back();
+            sizes.pop_back();
+        }
+
+        ins.size = size;
+        sizes.push_back(size);
+        m_max_depth = std::max(m_max_depth, static_cast<std::uint32_t>(sizes.size()));
+    }
+
+    assert(sizes.size() == 1u);
+
+    // Compute the pre-order ids of the nodes, from the root downwards.
+    // The ids of the subtree of a node with id p are in the range
+    // [p, p + size), so that the ids of the subtrees of the arguments
+    // can be determined walking backwards from the last argument.
+    std::vector<std::uint32_t> pre(m_code.size());
+    m_node_idx.resize(m_code.size());
+    for (auto k = m_code.size(); k-- > 0u;) {
+        m_node_idx[pre[k]] = static_cast<std::uint32_t>(k);
+
+        auto next = pre[k] + m_code[k].size;
+        const auto b = k + 1u - m_code[k].size;
+        for (auto c = k; c > b;) {
+            --c;
+            pre[c] = next - m_code[c].size;
+            next = pre[c];
+            c -= m_code[c].size - 1u;
+        }
+    }
+
+    m_nums = std::move(nums);
+    m_funcs = std::move(funcs);
+
+    m_nums_dbl.clear();
+    for (const auto &n : m_nums) {
+        m_nums_dbl.push_back(eval_dbl(n, {}, {}));
+    }
+}
+
+const std::vector<std::string> &gp_program::get_vars() const
+{
+    return m_vars;
+}
+
+const std::vector<gp_program::instruction> &gp_program::get_code() const
+{
+    return m_code;
+}
+
+std::size_t gp_program::size() const
+{
+    return m_code.size();
+}
+
+expression gp_program::to_expression() const
+{
+    std::vector<expression> stack;
+
+    for (const auto &ins : m_code) {
+        switch (ins.op) {
+            case op_code::var:
+                stack.emplace_back(variable{m_vars[ins.idx]});
+                break;
+            case op_code::num:
+                stack.emplace_back(m_nums[ins.idx]);
+                break;
+            case op_code::par:
+                stack.emplace_back(param{ins.idx});
+                break;
+            case op_code::func: {
+                const auto &f = m_funcs[ins.idx];
+                const auto [b, e] = detail::node_args(f);
+                const auto arity = static_cast<decltype(stack.size())>(e - b);
+                assert(stack.size() >= arity);
+
+                std::vector<expression> args(std::make_move_iterator(stack.end() - arity),
+                                             std::make_move_iterator(stack.end()));
+                stack.resize(stack.size() - arity);
+                stack.push_back(detail::node_rebuild(f, args.data()));
+                break;
+            }
+            default: {
+                assert(stack.size() >= 2u);
+
+                auto rhs = std::move(stack.back());
+                stack.pop_back();
+                auto lhs = std::move(stack.back());
+                stack.pop_back();
+
+                const auto type = [&ins]() {
+                    switch (ins.op) {
+                        case op_code::add:
+                            return binary_operator::type::add;
+                        case op_code::sub:
+                            return binary_operator::type::sub;
+                        case op_code::mul:
+                            return binary_operator::type::mul;
+                        default:
+                            return binary_operator::type::div;
+                    }
+                }();
+
+                stack.emplace_back(binary_operator{type, std::move(lhs), std::move(rhs)});
+            }
+        }
+    }
+
+    assert(stack.size() == 1u);
+
+    return std::move(stack.back());
+}
+
+std::pair<std::size_t, std::size_t> gp_program::subtree(std::size_t node_id) const
+{
+    if (node_id >= m_code.size()) {
+        throw std::invalid_argument("The node id requested: " + std::to_string(node_id)
+                                    + " was not found in the program");
+    }
+
+    const auto idx = static_cast<std::size_t>(m_node_idx[node_id]);
+
+    return {idx + 1u - m_code[idx].size, idx + 1u};
+}
+
+void gp_program::replace_subtree(std::size_t node_id, const gp_program &other, std::size_t other_id)
+{
+    if (m_vars != other.m_vars) {
+        throw std::invalid_argument("Cannot replace a subtree of a program with the subtree of a program "
+                                    "with a different list of variables");
+    }
+
+    const auto [b, e] = subtree(node_id);
+    const auto [ob, oe] = other.subtree(other_id);
+
+    if (m_code.size() - (e - b) > std::numeric_limits<std::uint32_t>::max() - (oe - ob)) {
+        throw std::overflow_error("Overflow detected in the number of instructions of a program");
+    }
+
+    // Copy the subtree of other, adding its numbers
+    // and functions to the tables.
+    // NOTE: other may coincide with this.
+    std::vector<instruction> frag(other.m_code.begin() + static_cast<std::ptrdiff_t>(ob),
+                                  other.m_code.begin() + static_cast<std::ptrdiff_t>(oe));
+    for (auto &ins : frag) {
+        if (ins.op == op_code::num) {
+            auto n = other.m_nums[ins.idx];
+            ins.idx = static_cast<std::uint32_t>(m_nums.size());
+            m_nums.push_back(std::move(n));
+        } else if (ins.op == op_code::func) {
+            auto f = other.m_funcs[ins.idx];
+            ins.idx = static_cast<std::uint32_t>(m_funcs.size());
+            m_funcs.push_back(std::move(f));
+        }
+    }
+
+    m_code.erase(m_code.begin() + static_cast<std::ptrdiff_t>(b), m_code.begin() + static_cast<std::ptrdiff_t>(e));
+    m_code.insert(m_code.begin() + static_cast<std::ptrdiff_t>(b), frag.begin(), frag.end());
+
+    finalise();
+}
+
+void gp_program::eval_batch(double *out, const double *in, std::size_t n_points, const std::vector<double> &pars) const
+{
+    if (pars.size() < m_n_pars) {
+        throw std::invalid_argument("The evaluation of the program requires " + std::to_string(m_n_pars)
+                                    + " param(s), but only " + std::to_string(pars.size())
+                                    + " value(s) were provided");
+    }
+
+    // The stack: the i-th row starts at index i * n, where n
+    // is the number of points in the current block.
+    // NOTE: the loops over the points operate on contiguous
+    // memory and can be vectorised by the compiler.
+    std::vector<double> buf(static_cast<std::size_t>(m_max_depth) * detail::gp_program_block_size);
+    std::vector<double> fargs;
+
+    for (std::size_t begin = 0; begin < n_points; begin += detail::gp_program_block_size) {
+        const auto n = std::min(detail::gp_program_block_size, n_points - begin);
+        auto row = [&buf, n](std::size_t i) { return buf.data() + i * n; };
+
+        std::size_t depth = 0;
+
+        for (const auto &ins : m_code) {
+            switch (ins.op) {
+                case op_code::var: {
+                    const auto *src = in + ins.idx * n_points + begin;
+                    std::copy(src, src + n, row(depth++));
+                    break;
+                }
+                case op_code::num: {
+                    auto *v = row(depth++);
+                    std::fill(v, v + n, m_nums_dbl[ins.idx]);
+                    break;
+                }
+                case op_code::par: {
+                    auto *v = row(depth++);
+                    std::fill(v, v + n, pars[ins.idx]);
+                    break;
+                }
+                case op_code::func: {
+                    const auto &f = std::get<func>(m_funcs[ins.idx].value());
+                    const auto arity = f.args().size();
+                    assert(depth >= arity);
+
+                    depth -= arity;
+                    fargs.resize(arity);
+
+                    auto *v = row(depth++);
+                    for (std::size_t j = 0; j < n; ++j) {
+                        for (decltype(fargs.size()) k = 0; k < arity; ++k) {
+                            fargs[k] = row(depth - 1u + k)[j];
+                        }
+                        v[j] = f.eval_num_dbl(fargs);
+                    }
+                    break;
+                }
+                default: {
+                    assert(depth >= 2u);
+
+                    --depth;
+                    auto *va = row(depth - 1u);
+                    const auto *vb = row(depth);
+
+                    switch (ins.op) {
+                        case op_code::add:
+                            for (std::size_t j = 0; j < n; ++j) {
+                                va[j] += vb[j];
+                            }
+                            break;
+                        case op_code::sub:
+                            for (std::size_t j = 0; j < n; ++j) {
+                                va[j] -= vb[j];
+                            }
+                            break;
+                        case op_code::mul:
+                            for (std::size_t j = 0; j < n; ++j) {
+                                va[j] *= vb[j];
+                            }
+                            break;
+                        default:
+                            for (std::size_t j = 0; j < n; ++j) {
+                                va[j] /= vb[j];
+                            }
+                    }
+                }
+            }
+        }
+
+        assert(depth == 1u);
+
+        std::copy(row(0), row(0) + n, out + begin);
+    }
+}
+
+void mutate(gp_program &p, std::size_t node_id, const expression_generator &generator, const unsigned min_depth,
+            const unsigned max_depth)
+{
+    // NOTE: validate the node id before generating the new subtree.
+    p.subtree(node_id);
+
+    p.replace_subtree(node_id, gp_program{generator(min_depth, max_depth), p.get_vars()}, 0);
+}
+
+void crossover(gp_program &p1, gp_program &p2, splitmix64 &engine)
+{
+    std::uniform_int_distribution<std::size_t> t1(0, p1.size() - 1u);
+    std::uniform_int_distribution<std::size_t> t2(0, p2.size() - 1u);
+    const auto node_id1 = t1(engine);
+    const auto node_id2 = t2(engine);
+
+    crossover(p1, p2, node_id1, node_id2);
+}
+
+void crossover(gp_program &p1, gp_program &p2, std::size_t node_id1, std::size_t node_id2)
+{
+    // NOTE: validate the node ids before modifying the programs.
+    p1.subtree(node_id1);
+    p2.subtree(node_id2);
+
+    const auto p1_copy = p1;
+    p1.replace_subtree(node_id1, p2, node_id2);
+    p2.replace_subtree(node_id2, p1_copy, node_id1);
+}
+
+cached_gp_program::cached_gp_program(gp_program p, const double *in, std::size_t n_points, std::vector<double> pars)
+    : m_p(std::move(p)), m_in(in), m_n_points(n_points), m_pars(std::move(pars))
+{
+    if (m_n_points == 0u) {
+        throw std::invalid_argument("The number of points of a cached program cannot be zero");
+    }
+
+    if (m_p.size() > std::numeric_limits<std::size_t>::max() / m_n_points) {
+        throw std::overflow_error("Overflow detected in the number of node values of a cached program");
+    }
+
+    check_pars(m_p);
+
+    m_values.resize(m_p.size() * m_n_points);
+    for (std::size_t k = 0; k < m_p.size(); ++k) {
+        eval_node(k);
+    }
+}
+
+cached_gp_program::cached_gp_program(const cached_gp_program &) = default;
+
+cached_gp_program::cached_gp_program(cached_gp_program &&) noexcept = default;
+
+cached_gp_program &cached_gp_program::operator=(const cached_gp_program &) = default;
+
+cached_gp_program &cached_gp_program::operator=(cached_gp_program &&) noexcept = default;
+
+cached_gp_program::~cached_gp_program() = default;
+
+// Check that the params suffice for the evaluation of p.
+void cached_gp_program::check_pars(const gp_program &p) const
+{
+    if (m_pars.size() < p.m_n_pars) {
+        throw std::invalid_argument("The evaluation of the program requires " + std::to_string(p.m_n_pars)
+                                    + " param(s), but only " + std::to_string(m_pars.size())
+                                    + " value(s) were provided");
+    }
+}
+
+// Compute the values of the node corresponding to the k-th instruction,
+// from the values of the nodes of its arguments.
+void cached_gp_program::eval_node(std::size_t k)
+{
+    const auto &code = m_p.m_code;
+    const auto &ins = code[k];
+    const auto n = m_n_points;
+    auto row = [this, n](std::size_t i) { return m_values.data() + i * n; };
+    auto *v = row(k);
+
+    switch (ins.op) {
+        case gp_program::op_code::var: {
+            const auto *src = m_in + ins.idx * n;
+            std::copy(src, src + n, v);
+            break;
+        }
+        case gp_program::op_code::num:
+            std::fill(v, v + n, m_p.m_nums_dbl[ins.idx]);
+            break;
+        case gp_program::op_code::par:
+            std::fill(v, v + n, m_pars[ins.idx]);
+            break;
+        case gp_program::op_code::func: {
+            const auto &f = std::get<func>(m_p.m_funcs[ins.idx].value());
+
+            std::vector<std::size_t> children;
+            detail::gp_program_children(code, k, children);
+            std::vector<double> fargs(children.size());
+
+            for (std::size_t j = 0; j < n; ++j) {
+                for (decltype(fargs.size()) i = 0; i < fargs.size(); ++i) {
+                    fargs[i] = row(children[i])[j];
+                }
+                v[j] = f.eval_num_dbl(fargs);
+            }
+            break;
+        }
+        default: {
+            // NOTE: the root of the rhs immediately
+            // precedes the instruction.
+            assert(k >= 2u);
+            const auto *vb = row(k - 1u);
+            const auto *va = row(k - 1u - code[k - 1u].size);
+
+            switch (ins.op) {
+                case gp_program::op_code::add:
+                    for (std::size_t j = 0; j < n; ++j) {
+                        v[j] = va[j] + vb[j];
+                    }
+                    break;
+                case gp_program::op_code::sub:
+                    for (std::size_t j = 0; j < n; ++j) {
+                        v[j] = va[j] - vb[j];
+                    }
+                    break;
+                case gp_program::op_code::mul:
+                    for (std::size_t j = 0; j < n; ++j) {
+                        v[j] = va[j] * vb[j];
+                    }
+                    break;
+                default:
+                    for (std::size_t j = 0; j < n; ++j) {
+                        v[j] = va[j] / vb[j];
+                    }
+            }
+        }
+    }
+}
+
+const gp_program &cached_gp_program::get_program() const
+{
+    return m_p;
+}
+
+std::size_t cached_gp_program::get_n_points() const
+{
+    return m_n_points;
+}
+
+const double *cached_gp_program::get_node_values(std::size_t node_id) const
+{
+    // NOTE: the root of the subtree is its last instruction.
+    return m_values.data() + (m_p.subtree(node_id).second - 1u) * m_n_points;
+}
+
+const double *cached_gp_program::get_values() const
+{
+    return m_values.data() + (m_p.size() - 1u) * m_n_points;
+}
+
+// Implementation of replace_subtree(). If vals is not null, it contains
+// the values of the nodes of the subtree of other_id in other.
+void cached_gp_program::replace_subtree_impl(std::size_t node_id, const gp_program &other, std::size_t other_id,
+                                             const double *vals)
+{
+    const auto [b, e] = m_p.subtree(node_id);
+    const auto [ob, oe] = other.subtree(other_id);
+    const auto n_new = oe - ob;
+
+    if (m_p.size() - (e - b) > std::numeric_limits<std::size_t>::max() / m_n_points - n_new) {
+        throw std::overflow_error("Overflow detected in the number of node values of a cached program");
+    }
+
+    // NOTE: if other is m_p, the subtree has to be copied
+    // before m_p is modified.
+    auto new_p = m_p;
+    new_p.replace_subtree(node_id, other, other_id);
+    check_pars(new_p);
+    m_p = std::move(new_p);
+
+    // Replace the values of the old subtree.
+    const auto n = m_n_points;
+    m_values.erase(m_values.begin() + static_cast<std::ptrdiff_t>(b * n),
+                   m_values.begin() + static_cast<std::ptrdiff_t>(e * n));
+    const auto it_b = m_values.begin() + static_cast<std::ptrdiff_t>(b * n);
+
+    if (vals == nullptr) {
+        m_values.insert(it_b, n_new * n, 0.);
+
+        for (auto k = b; k < b + n_new; ++k) {
+            eval_node(k);
+        }
+    } else {
+        m_values.insert(it_b, vals, vals + n_new * n);
+    }
+
+    // Re-evaluate the ancestors of the new subtree, that is,
+    // the following nodes whose subtrees contain it.
+    const auto &code = m_p.m_code;
+    for (auto k = b + n_new; k < code.size(); ++k) {
+        if (k + 1u - code[k].size <= b) {
+            eval_node(k);
+        }
+    }
+}
+
+bool cached_gp_program::same_dataset(const cached_gp_program &other) const
+{
+    return m_in == other.m_in && m_n_points == other.m_n_points && m_pars == other.m_pars;
+}
+
+void cached_gp_program::replace_subtree(std::size_t node_id, const gp_program &other, std::size_t other_id)
+{
+    replace_subtree_impl(node_id, other, other_id, nullptr);
+}
+
+void cached_gp_program::replace_subtree(std::size_t node_id, const cached_gp_program &other, std::size_t other_id)
+{
+    if (same_dataset(other) && this != &other) {
+        const auto ob = other.m_p.subtree(other_id).first;
+
+        replace_subtree_impl(node_id, other.m_p, other_id, other.m_values.data() + ob * m_n_points);
+    } else {
+        // NOTE: if other is this, the values of the subtree would
+        // be overwritten during the replacement. Re-evaluate them.
+        replace_subtree_impl(node_id, other.m_p, other_id, nullptr);
+    }
+}
+
+void mutate(cached_gp_program &p, std::size_t node_id, const expression_generator &generator,
+            const unsigned min_depth, const unsigned max_depth)
+{
+    p.get_program().subtree(node_id);
+
+    p.replace_subtree(node_id, gp_program{generator(min_depth, max_depth), p.get_program().get_vars()}, 0);
+}
+
+void crossover(cached_gp_program &p1, cached_gp_program &p2, splitmix64 &engine)
+{
+    std::uniform_int_distribution<std::size_t> t1(0, p1.get_program().size() - 1u);
+    std::uniform_int_distribution<std::size_t> t2(0, p2.get_program().size() - 1u);
+    const auto node_id1 = t1(engine);
+    const auto node_id2 = t2(engine);
+
+    crossover(p1, p2, node_id1, node_id2);
+}
+
+void crossover(cached_gp_program &p1, cached_gp_program &p2, std::size_t node_id1, std::size_t node_id2)
+{
+    const auto [b1, e1] = p1.m_p.subtree(node_id1);
+    p2.m_p.subtree(node_id2);
+
+    // NOTE: save the program of p1 (and the values of the subtree,
+    // if they can be reused in p2) before p1 is modified.
+    const auto p1_prog = p1.m_p;
+    const auto reuse = p1.same_dataset(p2) && &p1 != &p2;
+    std::vector<double> vals;
+    if (reuse) {
+        vals.assign(p1.m_values.begin() + static_cast<std::ptrdiff_t>(b1 * p1.m_n_points),
+                    p1.m_values.begin() + static_cast<std::ptrdiff_t>(e1 * p1.m_n_points));
+    }
+
+    p1.replace_subtree(node_id1, p2, node_id2);
+    p2.replace_subtree_impl(node_id2, p1_prog, node_id1, reuse ? vals.data() : nullptr);
+}
+
+} // namespace heyoka
@@ -0,0 +1,367 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include <heyoka/binary_operator.hpp>
+#include <heyoka/detail/type_traits.hpp>
+#include <heyoka/expression.hpp>
+#include <heyoka/func.hpp>
+#include <heyoka/gradient_tape.hpp>
+#include <heyoka/number.hpp>
+#include <heyoka/param.hpp>
+#include <heyoka/variable.hpp>
+
+namespace heyoka
+{
+
+namespace detail
+{
+
+namespace
+{
+
+// Maximum number of points processed
+// in a single sweep over the tape.
+constexpr std::size_t gradient_tape_block_size = 64;
+
+// Helper to flatten an expression into a tape.
+struct gradient_tape_recorder {
+    using node = gradient_tape::node;
+    using node_type = gradient_tape::node_type;
+
+    std::vector<node> &nodes;
+    std::vector<func> &funcs;
+    std::vector<std::uint32_t> &args;
+    // Map from the ids of the variables to their indices.
+    const std::unordered_map<std::uint32_t, std::uint32_t> &var_idx;
+    // The already-recorded subexpressions.
+    std::unordered_map<expression, std::uint32_t> memo;
+
+    std::uint32_t push(node n)
+    {
+        if (nodes.size() == std::numeric_limits<std::uint32_t>::max()) {
+            throw std::overflow_error("Overflow detected in the number of nodes of a gradient tape");
+        }
+
+        nodes.push_back(n);
+
+        return static_cast<std::uint32_t>(nodes.size() - 1u);
+    }
+
+    std::uint32_t operator()(const expression &ex)
+    {
+        if (auto it = memo.find(ex); it != memo.end()) {
+            return it->second;
+        }
+
+        const auto ret = std::visit(
+            [this](const auto &v) -> std::uint32_t {
+                using type = uncvref_t<decltype(v)>;
+
+                if constexpr (std::is_same_v<type, number>) {
+                    return push(node{node_type::num, 0, 0, eval_dbl(v, {}, {}), 0});
+                } else if constexpr (std::is_same_v<type, param>) {
+                    return push(node{node_type::par, v.idx(), 0, 0, 0});
+                } else if constexpr (std::is_same_v<type, variable>) {
+                    const auto it = var_idx.find(v.id());
+                    if (it == var_idx.end()) {
+                        throw std::invalid_argument("The variable '" + v.name()
+                                                    + "' is not in the list of the variables of the gradient tape");
+                    }
+
+                    return push(node{node_type::var, it->second, 0, 0, 0});
+                } else if constexpr (std::is_same_v<type, binary_operator>) {
+                    const auto a = (*this)(v.lhs());
+                    const auto b = (*this)(v.rhs());
+
+                    switch (v.op()) {
+                        case binary_operator::type::add:
+                            return push(node{node_type::add, a, b, 0, 0});
+                        case binary_operator::type::sub:
+                            return push(node{node_type::sub, a, b, 0, 0});
+                        case binary_operator::type::mul:
+                            return push(node{node_type::mul, a, b, 0, 0});
+                        default:
+                            return push(node{node_type::div, a, b, 0, 0});
+                    }
+                } else if constexpr (std::is_same_v<type, func>) {
+                    std::vector<std::uint32_t> f_args;
+                    for (const auto &arg : v.args()) {
+                        f_args.push_back((*this)(arg));
+                    }
+
+                    const auto offset = static_cast<std::uint32_t>(args.size());
+                    args.insert(args.end(), f_args.begin(), f_args.end());
+
+                    funcs.push_back(v);
+
+                    return push(node{node_type::func, offset, static_cast<std::uint32_t>(f_args.size()), 0,
+                                     static_cast<std::uint32_t>(funcs.size() - 1u)});
+                } else {
+                    static_assert(always_false_v<type>, "Unhandled expression type.");
+                }
+            },
+            ex.value());
+
+        memo.emplace(ex, ret);
+
+        return ret;
+    }
+};
+
+} // namespace
+
+} // namespace detail
+
+gradient_tape::gradient_tape(expression ex, std::vector<std::string> vars) : m_ex(std::move(ex))
+{
+    // Deduce or validate the list of variables.
+    if (vars.empty()) {
+        for (auto &name : get_variables(m_ex)) {
+            vars.push_back(std::move(name));
+        }
+        std::sort(vars.begin(), vars.end());
+        vars.erase(std::unique(vars.begin(), vars.end()), vars.end());
+    } else if (std::set<std::string>(vars.begin(), vars.end()).size() != vars.size()) {
+        throw std::invalid_argument("The list of variables of a gradient tape contains duplicates");
+    }
+
+    if (vars.size() > std::numeric_limits<std::uint32_t>::max()) {
+        throw std::overflow_error("Overflow detected in the number of variables of a gradient tape");
+    }
+
+    m_vars = std::move(vars);
+
+    std::unordered_map<std::uint32_t, std::uint32_t> var_idx;
+    for (decltype(m_vars.size()) i = 0; i < m_vars.size(); ++i) {
+        var_idx.emplace(variable{m_vars[i]}.id(), static_cast<std::uint32_t>(i));
+    }
+
+    // Record the tape.
+    detail::gradient_tape_recorder{m_nodes, m_funcs, m_args, var_idx, {}}(m_ex);
+
+    const auto n_nodes = static_cast<std::uint32_t>(m_nodes.size());
+
+    m_var_nodes.resize(m_vars.size(), n_nodes);
+    for (std::uint32_t i = 0; i < n_nodes; ++i) {
+        if (m_nodes[i].type == node_type::var) {
+            m_var_nodes[m_nodes[i].a] = i;
+        }
+    }
+
+    // Prepare the buffers.
+    m_values.resize(m_nodes.size() * detail::gradient_tape_block_size);
+    m_adj.resize(m_nodes.size() * detail::gradient_tape_block_size);
+    std::uint32_t max_args = 0;
+    for (const auto &n : m_nodes) {
+        if (n.type == node_type::func) {
+            max_args = std::max(max_args, n.b);
+        }
+    }
+    m_fargs.resize(max_args);
+}
+
+gradient_tape::gradient_tape(const gradient_tape &) = default;
+
+gradient_tape::gradient_tape(gradient_tape &&) noexcept = default;
+
+gradient_tape &gradient_tape::operator=(const gradient_tape &) = default;
+
+gradient_tape &gradient_tape::operator=(gradient_tape &&) noexcept = default;
+
+gradient_tape::~gradient_tape() = default;
+
+const expression &gradient_tape::get_expression() const
+{
+    return m_ex;
+}
+
+const std::vector<std::string> &gradient_tape::get_vars() const
+{
+    return m_vars;
+}
+
+std::size_t gradient_tape::get_n_nodes() const
+{
+    return m_nodes.size();
+}
+
+// Forward and reverse sweeps over the tape for the n points starting at
+// index begin. The i-th variable is read from in + i * stride, the i-th component
+// of the gradient is written into grad + i * stride. In the internal buffers, the
+// values/adjoints of the i-th node are stored starting from index i * n.
+void gradient_tape::sweep(double *out, double *grad, const double *in, std::size_t stride, std::size_t begin,
+                          std::size_t n, const double *pars)
+{
+    assert(n > 0u && n <= detail::gradient_tape_block_size);
+    assert(!m_nodes.empty());
+
+    const auto n_nodes = m_nodes.size();
+    auto *vals = m_values.data();
+    auto *adj = m_adj.data();
+
+    // Helper to gather the values of the arguments
+    // of the func node nd at the point j.
+    auto gather = [&](const node &nd, std::size_t j) {
+        for (std::uint32_t k = 0; k < nd.b; ++k) {
+            m_fargs[k] = vals[m_args[nd.a + k] * n + j];
+        }
+    };
+
+    // Forward sweep.
+    for (std::size_t i = 0; i < n_nodes; ++i) {
+        const auto &nd = m_nodes[i];
+        auto *v = vals + i * n;
+        // NOTE: the operands of the binary operators.
+        auto va = [&]() { return vals + nd.a * n; };
+        auto vb = [&]() { return vals + nd.b * n; };
+
+        switch (nd.type) {
+            case node_type::var:
+                std::copy(in + nd.a * stride + begin, in + nd.a * stride + begin + n, v);
+                break;
+            case node_type::num:
+                std::fill(v, v + n, nd.value);
+                break;
+            case node_type::par:
+                std::fill(v, v + n, pars[nd.a]);
+                break;
+            case node_type::add:
+                for (std::size_t j = 0; j < n; ++j) {
+                    v[j] = va()[j] + vb()[j];
+                }
+                break;
+            case node_type::sub:
+                for (std::size_t j = 0; j < n; ++j) {
+                    v[j] = va()[j] - vb()[j];
+                }
+                break;
+            case node_type::mul:
+                for (std::size_t j = 0; j < n; ++j) {
+                    v[j] = va()[j] * vb()[j];
+                }
+                break;
+            case node_type::div:
+                for (std::size_t j = 0; j < n; ++j) {
+                    v[j] = va()[j] / vb()[j];
+                }
+                break;
+            default: {
+                assert(nd.type == node_type::func);
+                const auto &f = m_funcs[nd.f_idx];
+                for (std::size_t j = 0; j < n; ++j) {
+                    gather(nd, j);
+                    v[j] = f.eval_num_dbl(m_fargs);
+                }
+            }
+        }
+    }
+
+    // Reverse sweep.
+    std::fill(adj, adj + n_nodes * n, 0.);
+    std::fill(adj + (n_nodes - 1u) * n, adj + n_nodes * n, 1.);
+
+    for (auto i = n_nodes; i-- > 0u;) {
+        const auto &nd = m_nodes[i];
+        const auto *g = adj + i * n;
+        const auto *v = vals + i * n;
+
+        switch (nd.type) {
+            case node_type::add:
+            case node_type::sub:
+            case node_type::mul:
+            case node_type::div: {
+                const auto *va = vals + nd.a * n;
+                const auto *vb = vals + nd.b * n;
+                auto *ga = adj + nd.a * n;
+                auto *gb = adj + nd.b * n;
+
+                // NOTE: the operands may coincide (e.g., x * x),
+                // in which case ga and gb overlap.
+                for (std::size_t j = 0; j < n; ++j) {
+                    switch (nd.type) {
+                        case node_type::add:
+                            ga[j] += g[j];
+                            gb[j] += g[j];
+                            break;
+                        case node_type::sub:
+                            ga[j] += g[j];
+                            gb[j] -= g[j];
+                            break;
+                        case node_type::mul:
+                            ga[j] += g[j] * vb[j];
+                            gb[j] += g[j] * va[j];
+                            break;
+                        default:
+                            ga[j] += g[j] / vb[j];
+                            gb[j] -= g[j] * v[j] / vb[j];
+                    }
+                }
+                break;
+            }
+            case node_type::func: {
+                const auto &f = m_funcs[nd.f_idx];
+                for (std::size_t j = 0; j < n; ++j) {
+                    gather(nd, j);
+                    for (std::uint32_t k = 0; k < nd.b; ++k) {
+                        adj[m_args[nd.a + k] * n + j] += g[j] * f.deval_num_dbl(m_fargs, k);
+                    }
+                }
+                break;
+            }
+            default:
+                // Leaves: nothing to propagate.
+                break;
+        }
+    }
+
+    // Write out the values and the gradient.
+    std::copy(vals + (n_nodes - 1u) * n, vals + n_nodes * n, out + begin);
+
+    for (decltype(m_var_nodes.size()) k = 0; k < m_var_nodes.size(); ++k) {
+        auto *gk = grad + k * stride + begin;
+
+        if (m_var_nodes[k] == n_nodes) {
+            // The variable does not appear in the expression.
+            std::fill(gk, gk + n, 0.);
+        } else {
+            std::copy(adj + m_var_nodes[k] * n, adj + m_var_nodes[k] * n + n, gk);
+        }
+    }
+}
+
+double gradient_tape::operator()(double *grad, const double *in, const double *pars)
+{
+    double ret = 0;
+
+    sweep(&ret, grad, in, 1, 0, 1, pars);
+
+    return ret;
+}
+
+void gradient_tape::eval_batch(double *out, double *grad, const double *in, std::size_t n_points, const double *pars)
+{
+    for (std::size_t begin = 0; begin < n_points; begin += detail::gradient_tape_block_size) {
+        sweep(out, grad, in, n_points, begin, std::min(detail::gradient_tape_block_size, n_points - begin), pars);
+    }
+}
+
+} // namespace heyoka
@@ -0,0 +1,336 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <iterator>
+#include <limits>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <heyoka/binary_operator.hpp>
+#include <heyoka/detail/traversal.hpp>
+#include <heyoka/expression.hpp>
+#include <heyoka/func.hpp>
+#include <heyoka/interval.hpp>
+#include <heyoka/number.hpp>
+#include <heyoka/param.hpp>
+#include <heyoka/variable.hpp>
+
+namespace heyoka
+{
+
+bool operator==(const interval &a, const interval &b)
+{
+    return a.lower == b.lower && a.upper == b.upper;
+}
+
+bool operator!=(const interval &a, const interval &b)
+{
+    return !(a == b);
+}
+
+std::ostream &operator<<(std::ostream &os, const interval &a)
+{
+    return os << '[' << a.lower << ", " << a.upper << ']';
+}
+
+interval operator+(const interval &a, const interval &b)
+{
+    if (detail::interval_isnan(a) || detail::interval_isnan(b)) {
+        return detail::interval_nan();
+    }
+
+    return detail::interval_round_out(a.lower + b.lower, a.upper + b.upper);
+}
+
+interval operator-(const interval &a, const interval &b)
+{
+    if (detail::interval_isnan(a) || detail::interval_isnan(b)) {
+        return detail::interval_nan();
+    }
+
+    return detail::interval_round_out(a.lower - b.upper, a.upper - b.lower);
+}
+
+namespace detail
+{
+
+namespace
+{
+
+// Product of two bounds, with the convention 0 * inf = 0.
+double interval_mul_bounds(double x, double y)
+{
+    return (x == 0 || y == 0) ? 0. : x * y;
+}
+
+} // namespace
+
+} // namespace detail
+
+interval operator*(const interval &a, const interval &b)
+{
+    if (detail::interval_isnan(a) || detail::interval_isnan(b)) {
+        return detail::interval_nan();
+    }
+
+    const double p[] = {detail::interval_mul_bounds(a.lower, b.lower), detail::interval_mul_bounds(a.lower, b.upper),
+                        detail::interval_mul_bounds(a.upper, b.lower), detail::interval_mul_bounds(a.upper, b.upper)};
+
+    const auto [min_it, max_it] = std::minmax_element(std::begin(p), std::end(p));
+
+    return detail::interval_round_out(*min_it, *max_it);
+}
+
+interval operator/(const interval &a, const interval &b)
+{
+    if (detail::interval_isnan(a) || detail::interval_isnan(b)) {
+        return detail::interval_nan();
+    }
+
+    if (b.lower == 0 && b.upper == 0) {
+        // Division by zero.
+        return detail::interval_nan();
+    }
+
+    constexpr auto inf = std::numeric_limits<double>::infinity();
+
+    if (b.lower <= 0 && b.upper >= 0) {
+        // NOTE: the divisor contains zero,
+        // the result is unbounded.
+        return {-inf, inf};
+    }
+
+    // NOTE: 1 / b is computed with outward
+    // rounding as well.
+    return a * detail::interval_round_out(1. / b.upper, 1. / b.lower);
+}
+
+namespace detail
+{
+
+namespace
+{
+
+constexpr double interval_pi = 3.141592653589793238462643383279502884;
+
+// Image of a via the sine (if cos is false) or the cosine.
+interval interval_sin_cos(const interval &a, bool cos)
+{
+    if (interval_isnan(a)) {
+        return interval_nan();
+    }
+
+    if (!std::isfinite(a.lower) || !std::isfinite(a.upper) || a.upper - a.lower >= 2 * interval_pi) {
+        return {-1., 1.};
+    }
+
+    const auto fl = cos ? std::cos(a.lower) : std::sin(a.lower);
+    const auto fu = cos ? std::cos(a.upper) : std::sin(a.upper);
+
+    auto retval = interval_round_out(std::min(fl, fu), std::max(fl, fu));
+
+    // The maxima of the sine are at pi/2 + 2k*pi and its minima at -pi/2 + 2k*pi,
+    // the maxima of the cosine are at 2k*pi and its minima at pi + 2k*pi.
+    if (interval_contains_periodic(a, cos ? 0. : interval_pi / 2, 2 * interval_pi)) {
+        retval.upper = 1;
+    }
+    if (interval_contains_periodic(a, cos ? interval_pi : -interval_pi / 2, 2 * interval_pi)) {
+        retval.lower = -1;
+    }
+
+    retval.lower = std::max(retval.lower, -1.);
+    retval.upper = std::min(retval.upper, 1.);
+
+    return retval;
+}
+
+} // namespace
+
+bool interval_contains_periodic(const interval &a, double offset, double period)
+{
+    // NOTE: widen a slightly, in order to account for the
+    // rounding errors in the reduction of the bounds.
+    const auto tol = 1e-12 * (1 + std::max(std::abs(a.lower), std::abs(a.upper)));
+
+    return std::ceil((a.lower - tol - offset) / period) <= std::floor((a.upper + tol - offset) / period);
+}
+
+interval interval_sin(const interval &a)
+{
+    return interval_sin_cos(a, false);
+}
+
+interval interval_cos(const interval &a)
+{
+    return interval_sin_cos(a, true);
+}
+
+} // namespace detail
+
+bool is_finite(const interval &a)
+{
+    return std::isfinite(a.lower) && std::isfinite(a.upper);
+}
+
+namespace detail
+{
+
+namespace
+{
+
+interval eval_interval_bo(const binary_operator &bo, const interval &a, const interval &b)
+{
+    switch (bo.op()) {
+        case binary_operator::type::add:
+            return a + b;
+        case binary_operator::type::sub:
+            return a - b;
+        case binary_operator::type::mul:
+            return a * b;
+        default:
+            return a / b;
+    }
+}
+
+void check_interval(const std::string &name, const interval &a)
+{
+    if (!(a.lower <= a.upper)) {
+        using namespace fmt::literals;
+
+        throw std::invalid_argument(
+            "Invalid interval [{}, {}] supplied for the variable '{}' in an interval evaluation"_format(a.lower, a.upper,
+                                                                                                       name));
+    }
+}
+
+} // namespace
+
+} // namespace detail
+
+interval eval_interval_dbl(const expression &ex, const std::unordered_map<std::string, interval> &map,
+                           const std::vector<double> &pars)
+{
+    return detail::fold_postorder<interval>(
+        ex,
+        [&](const expression &n) -> interval {
+            if (const auto vptr = std::get_if<variable>(&n.value())) {
+                const auto it = map.find(vptr->name());
+                if (it == map.end()) {
+                    throw std::invalid_argument("Cannot evaluate the variable '" + vptr->name()
+                                                + "' because it is missing from the evaluation map");
+                }
+
+                detail::check_interval(vptr->name(), it->second);
+
+                return it->second;
+            } else if (const auto pptr = std::get_if<param>(&n.value())) {
+                const auto v = eval_dbl(*pptr, {}, pars);
+
+                return {v, v};
+            } else {
+                const auto v = eval_dbl(std::get<number>(n.value()), {}, {});
+
+                return {v, v};
+            }
+        },
+        [](const expression &n, const interval *args) -> interval {
+            if (const auto bptr = std::get_if<binary_operator>(&n.value())) {
+                return detail::eval_interval_bo(*bptr, args[0], args[1]);
+            }
+
+            const auto &f = std::get<func>(n.value());
+
+            return f.eval_interval_dbl(std::vector<interval>(args, args + f.args().size()));
+        },
+        [](const expression &) { return true; });
+}
+
+void eval_batch_interval_dbl(std::vector<interval> &out, const expression &ex,
+                             const std::unordered_map<std::string, std::vector<interval>> &map,
+                             const std::vector<double> &pars)
+{
+    // Determine the number of boxes.
+    std::size_t n_boxes = 1;
+    if (!map.empty()) {
+        n_boxes = map.begin()->second.size();
+
+        for (const auto &[name, ivals] : map) {
+            if (ivals.size() != n_boxes) {
+                throw std::invalid_argument("Inconsistent number of boxes in the map of a batched interval evaluation: "
+                                            "the variable '"
+                                            + name + "' has " + std::to_string(ivals.size())
+                                            + " intervals, but " + std::to_string(n_boxes) + " were expected");
+            }
+
+            for (const auto &a : ivals) {
+                detail::check_interval(name, a);
+            }
+        }
+    }
+
+    // NOTE: fold the expression once, evaluating
+    // all the boxes at each node.
+    std::vector<interval> fargs;
+
+    out = detail::fold_postorder<std::vector<interval>>(
+        ex,
+        [&](const expression &n) -> std::vector<interval> {
+            if (const auto vptr = std::get_if<variable>(&n.value())) {
+                const auto it = map.find(vptr->name());
+                if (it == map.end()) {
+                    throw std::invalid_argument("Cannot evaluate the variable '" + vptr->name()
+                                                + "' because it is missing from the evaluation map");
+                }
+
+                return it->second;
+            } else if (const auto pptr = std::get_if<param>(&n.value())) {
+                const auto v = eval_dbl(*pptr, {}, pars);
+
+                return std::vector<interval>(n_boxes, interval{v, v});
+            } else {
+                const auto v = eval_dbl(std::get<number>(n.value()), {}, {});
+
+                return std::vector<interval>(n_boxes, interval{v, v});
+            }
+        },
+        [&](const expression &n, const std::vector<interval> *args) -> std::vector<interval> {
+            std::vector<interval> retval(n_boxes);
+
+            if (const auto bptr = std::get_if<binary_operator>(&n.value())) {
+                for (std::size_t i = 0; i < n_boxes; ++i) {
+                    retval[i] = detail::eval_interval_bo(*bptr, args[0][i], args[1][i]);
+                }
+            } else {
+                const auto &f = std::get<func>(n.value());
+                const auto n_args = f.args().size();
+
+                for (std::size_t i = 0; i < n_boxes; ++i) {
+                    fargs.resize(n_args);
+                    for (decltype(f.args().size()) k = 0; k < n_args; ++k) {
+                        fargs[k] = args[k][i];
+                    }
+
+                    retval[i] = f.eval_interval_dbl(fargs);
+                }
+            }
+
+            return retval;
+        },
+        [](const expression &) { return true; });
+}
+
+} // namespace heyoka
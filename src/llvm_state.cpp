@@ -6,55 +6,91 @@
 // Public License v. 2.0. If a copy of the MPL was not distributed
 // with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cstddef>
 #include <cstdint>
+#include <exception>
+#include <fstream>
+#include <functional>
 #include <initializer_list>
 #include <iostream>
+#include <iterator>
+#include <limits>
+#include <map>
 #include <memory>
 #include <mutex>
+#include <set>
 #include <ostream>
 #include <sstream>
 #include <stdexcept>
 #include <string>
 #include <system_error>
+#include <thread>
 #include <tuple>
 #include <type_traits>
 #include <utility>
 #include <variant>
 #include <vector>
 
+#if defined(__linux__)
+
+#include <unistd.h>
+
+#endif
+
 #include <boost/algorithm/string.hpp>
 #include <boost/filesystem.hpp>
+#include <boost/lexical_cast.hpp>
 
 #include <fmt/format.h>
 
 #include <llvm/ADT/SmallString.h>
 #include <llvm/ADT/SmallVector.h>
+#include <llvm/ADT/StringSet.h>
 #include <llvm/ADT/Triple.h>
 #include <llvm/Analysis/TargetLibraryInfo.h>
 #include <llvm/Analysis/TargetTransformInfo.h>
+#include <llvm/Bitcode/BitcodeReader.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
 #include <llvm/CodeGen/TargetPassConfig.h>
 #include <llvm/Config/llvm-config.h>
+#include <llvm/ExecutionEngine/JITEventListener.h>
 #include <llvm/ExecutionEngine/JITSymbol.h>
 #include <llvm/ExecutionEngine/Orc/CompileUtils.h>
 #include <llvm/ExecutionEngine/Orc/Core.h>
 #include <llvm/ExecutionEngine/Orc/ExecutionUtils.h>
 #include <llvm/ExecutionEngine/Orc/JITTargetMachineBuilder.h>
 #include <llvm/ExecutionEngine/Orc/LLJIT.h>
+#include <llvm/ExecutionEngine/Orc/RTDyldObjectLinkingLayer.h>
 #include <llvm/ExecutionEngine/Orc/ThreadSafeModule.h>
+#include <llvm/ExecutionEngine/RuntimeDyld.h>
+#include <llvm/ExecutionEngine/SectionMemoryManager.h>
 #include <llvm/IR/Attributes.h>
+#include <llvm/IR/DataLayout.h>
 #include <llvm/IR/Function.h>
+#include <llvm/IR/GlobalVariable.h>
 #include <llvm/IR/IRBuilder.h>
 #include <llvm/IR/InstrTypes.h>
 #include <llvm/IR/LLVMContext.h>
 #include <llvm/IR/LegacyPassManager.h>
+#include <llvm/IR/MDBuilder.h>
+#include <llvm/IR/Metadata.h>
 #include <llvm/IR/Module.h>
 #include <llvm/IR/Operator.h>
 #include <llvm/IR/Value.h>
 #include <llvm/IR/Verifier.h>
 #include <llvm/IRReader/IRReader.h>
+#include <llvm/Linker/Linker.h>
+#include <llvm/MC/MCSubtargetInfo.h>
+#include <llvm/MC/SubtargetFeature.h>
+#include <llvm/Object/ObjectFile.h>
+#include <llvm/Object/SymbolSize.h>
 #include <llvm/Pass.h>
 #include <llvm/Support/CodeGen.h>
+#include <llvm/Support/Error.h>
+#include <llvm/Support/Host.h>
 #include <llvm/Support/MemoryBuffer.h>
 #include <llvm/Support/SourceMgr.h>
 #include <llvm/Support/TargetRegistry.h>
@@ -62,7 +98,13 @@
 #include <llvm/Support/raw_ostream.h>
 #include <llvm/Target/TargetMachine.h>
 #include <llvm/Transforms/IPO.h>
+#include <llvm/Transforms/IPO/Internalize.h>
 #include <llvm/Transforms/IPO/PassManagerBuilder.h>
+#include <llvm/Transforms/Scalar.h>
+#include <llvm/Transforms/Utils.h>
+#include <llvm/Transforms/Utils/Cloning.h>
+#include <llvm/Transforms/Utils/SplitModule.h>
+#include <llvm/Transforms/Utils/ValueMapper.h>
 #include <llvm/Transforms/Vectorize.h>
 
 #if LLVM_VERSION_MAJOR == 10
@@ -71,9 +113,13 @@
 
 #endif
 
+#include <heyoka/config.hpp>
+#include <heyoka/detail/binary_io.hpp>
 #include <heyoka/detail/llvm_fwd.hpp>
+#include <heyoka/detail/simple_timer.hpp>
 #include <heyoka/llvm_state.hpp>
 #include <heyoka/number.hpp>
+#include <heyoka/tracing.hpp>
 #include <heyoka/variable.hpp>
 
 namespace heyoka
@@ -88,47 +134,148 @@ namespace
 // Make sure our definition of ir_builder matches llvm::IRBuilder<>.
 static_assert(std::is_same_v<ir_builder, llvm::IRBuilder<>>, "Inconsistent definition of the ir_builder type.");
 
-// Helper function to detect specific features
-// on the host machine via LLVM's machinery.
-target_features get_target_features_impl()
-{
-    auto jtmb = llvm::orc::JITTargetMachineBuilder::detectHost();
-    if (!jtmb) {
-        throw std::invalid_argument("Error creating a JITTargetMachineBuilder for the host system");
-    }
+std::once_flag nt_inited;
 
-    auto tm = jtmb->createTargetMachine();
-    if (!tm) {
-        throw std::invalid_argument("Error creating the target machine");
-    }
+// Initialise the native target. This must be done before
+// the creation of any target machine.
+// NOTE: this can be invoked concurrently from multiple threads,
+// the initialisation is done only once.
+void init_native_target()
+{
+    std::call_once(nt_inited, []() {
+        llvm::InitializeNativeTarget();
+        llvm::InitializeNativeTargetAsmPrinter();
+        llvm::InitializeNativeTargetAsmParser();
+    });
+}
 
+// Helper function to detect specific features
+// of the target machine tm.
+target_features get_target_features_impl(const llvm::TargetMachine &tm)
+{
     target_features retval;
 
-    const auto target_name = std::string{(*tm)->getTarget().getName()};
+    const auto target_name = std::string{tm.getTarget().getName()};
 
     if (target_name == "x86-64" || target_name == "x86") {
-        const auto t_features = (*tm)->getTargetFeatureString();
+        // NOTE: query the subtarget info rather than the feature
+        // string, so that the features implied by the target
+        // CPU are taken into account as well.
+        const auto &sti = *tm.getMCSubtargetInfo();
 
-        if (boost::algorithm::contains(t_features, "+avx512f")) {
+        if (sti.checkFeatures("+avx512f")) {
             retval.avx512f = true;
         }
 
-        if (boost::algorithm::contains(t_features, "+avx2")) {
+        if (sti.checkFeatures("+avx2")) {
             retval.avx2 = true;
         }
 
-        if (boost::algorithm::contains(t_features, "+avx")) {
+        if (sti.checkFeatures("+avx")) {
             retval.avx = true;
         }
 
+        if (sti.checkFeatures("+fma")) {
+            retval.fma = true;
+        }
+
         // SSE2 is always available on x86-64.
-        assert(boost::algorithm::contains(t_features, "+sse2"));
+        assert(sti.checkFeatures("+sse2"));
         retval.sse2 = true;
     }
 
+    if (target_name == "aarch64" || target_name == "arm64" || target_name == "ppc64" || target_name == "ppc64le") {
+        // NOTE: fma is part of the base ISA on these targets.
+        retval.fma = true;
+    }
+
     return retval;
 }
 
+// Helper to append to the target feature string 'features'
+// the SIMD features in tf. This is used to account for the features
+// implied by the target CPU, which do not appear in the feature string
+// of a target machine built from an explicitly-specified CPU.
+std::string effective_target_features(std::string features, const target_features &tf)
+{
+    for (const auto &[flag, name] : {std::pair{tf.sse2, "+sse2"}, std::pair{tf.avx, "+avx"},
+                                     std::pair{tf.avx2, "+avx2"}, std::pair{tf.avx512f, "+avx512f"}}) {
+        if (flag) {
+            if (!features.empty()) {
+                features += ',';
+            }
+            features += name;
+        }
+    }
+
+    return features;
+}
+
+// Helper to rank a target feature string, for the purpose of selecting
+// the best ISA variant of a compiled llvm_state: the higher the number of
+// distinct enabled features, the better the variant.
+std::size_t rank_target_features(const std::string &features)
+{
+    std::vector<std::string> feats;
+    boost::algorithm::split(feats, features, boost::algorithm::is_any_of(","));
+
+    std::set<std::string> enabled;
+    for (const auto &f : feats) {
+        if (!f.empty() && f[0] == '+') {
+            enabled.insert(f);
+        }
+    }
+
+    return enabled.size();
+}
+
+// Helper function to detect specific features
+// on the host machine via LLVM's machinery.
+target_features get_target_features_impl()
+{
+    // NOTE: this may be invoked before
+    // the creation of any llvm_state.
+    init_native_target();
+
+    auto jtmb = llvm::orc::JITTargetMachineBuilder::detectHost();
+    if (!jtmb) {
+        throw std::invalid_argument("Error creating a JITTargetMachineBuilder for the host system");
+    }
+
+    auto tm = jtmb->createTargetMachine();
+    if (!tm) {
+        throw std::invalid_argument("Error creating the target machine");
+    }
+
+    return get_target_features_impl(**tm);
+}
+
+// The target feature string of the host machine.
+std::string host_target_features()
+{
+    auto jtmb = llvm::orc::JITTargetMachineBuilder::detectHost();
+    if (!jtmb) {
+        throw std::invalid_argument("Error creating a JITTargetMachineBuilder for the host system");
+    }
+
+    return jtmb->getFeatures().getString();
+}
+
+// Helper to check if the code compiled for the target features
+// 'features' can be run on a machine with the target features 'host_features'.
+// That is, all the features enabled in 'features' must be enabled in 'host_features' too.
+bool target_features_compatible(const std::string &features, const std::string &host_features)
+{
+    std::vector<std::string> feats, host_feats;
+    boost::algorithm::split(feats, features, boost::algorithm::is_any_of(","));
+    boost::algorithm::split(host_feats, host_features, boost::algorithm::is_any_of(","));
+    std::sort(host_feats.begin(), host_feats.end());
+
+    return std::all_of(feats.begin(), feats.end(), [&host_feats](const std::string &f) {
+        return f.empty() || f[0] != '+' || std::binary_search(host_feats.begin(), host_feats.end(), f);
+    });
+}
+
 } // namespace
 
 // Helper function to fetch a const ref to a global object
@@ -140,601 +287,2498 @@ const target_features &get_target_features()
     return retval;
 }
 
+
 namespace
 {
 
-std::once_flag nt_inited;
+// Count the number of IR instructions in the module m.
+std::uint64_t count_instructions(const llvm::Module &m)
+{
+    std::uint64_t retval = 0;
 
-} // namespace
+    for (const auto &f : m) {
+        retval += f.getInstructionCount();
+    }
 
-} // namespace detail
+    return retval;
+}
 
-// Implementation of the jit class.
-struct llvm_state::jit {
-    std::unique_ptr<llvm::orc::LLJIT> m_lljit;
-    std::unique_ptr<llvm::TargetMachine> m_tm;
-    std::unique_ptr<llvm::orc::ThreadSafeContext> m_ctx;
+// Run the optimisation passes on the module m, using the
+// target machine tm.
+void optimise_module(llvm::Module &m, llvm::TargetMachine &tm, unsigned opt_level, bool inline_functions,
+                     bool prefer_vw512, opt_profile profile)
+{
+    if (opt_level > 0u) {
+        // NOTE: the logic here largely mimics (with a lot of simplifications)
+        // the implementation of the 'opt' tool. See:
+        // https://github.com/llvm/llvm-project/blob/release/10.x/llvm/tools/opt/opt.cpp
+
+        // For every function in the module, setup its attributes
+        // so that the codegen uses all the features available on
+        // the host CPU.
 #if LLVM_VERSION_MAJOR == 10
-    std::unique_ptr<llvm::Triple> m_triple;
-#endif
+        ::setFunctionAttributes(tm.getTargetCPU().str(), tm.getTargetFeatureString().str(), m);
+#else
+        // NOTE: in LLVM > 10, the setFunctionAttributes() function is gone in favour of another
+        // function in another namespace, which however does not seem to work out of the box
+        // because (I think) it might be reading some non-existent command-line options. See:
+        // https://llvm.org/doxygen/CommandFlags_8cpp_source.html#l00552
+        // Here we are reproducing a trimmed-down version of the same function.
+        const auto cpu = tm.getTargetCPU().str();
+        const auto features = tm.getTargetFeatureString().str();
 
-    jit()
-    {
-        // NOTE: the native target initialization needs to be done only once
-        std::call_once(detail::nt_inited, []() {
-            llvm::InitializeNativeTarget();
-            llvm::InitializeNativeTargetAsmPrinter();
-            llvm::InitializeNativeTargetAsmParser();
-        });
+        for (auto &f : m) {
+            auto attrs = f.getAttributes();
+            llvm::AttrBuilder new_attrs;
 
-        // Create the target machine builder.
-        auto jtmb = llvm::orc::JITTargetMachineBuilder::detectHost();
-        if (!jtmb) {
-            throw std::invalid_argument("Error creating a JITTargetMachineBuilder for the host system");
-        }
-        // Set the codegen optimisation level to aggressive.
-        jtmb->setCodeGenOptLevel(llvm::CodeGenOpt::Aggressive);
+            if (!cpu.empty() && !f.hasFnAttribute("target-cpu")) {
+                new_attrs.addAttribute("target-cpu", cpu);
+            }
 
-        // Create the jit builder.
-        llvm::orc::LLJITBuilder lljit_builder;
-        // NOTE: other settable properties may
-        // be of interest:
-        // https://www.llvm.org/doxygen/classllvm_1_1orc_1_1LLJITBuilder.html
-        lljit_builder.setJITTargetMachineBuilder(*jtmb);
+            if (!features.empty()) {
+                auto old_features = f.getFnAttribute("target-features").getValueAsString();
 
-        // Create the jit.
-        auto lljit = lljit_builder.create();
-        if (!lljit) {
-            throw std::invalid_argument("Error creating an LLJIT object");
-        }
-        m_lljit = std::move(*lljit);
+                if (old_features.empty()) {
+                    new_attrs.addAttribute("target-features", features);
+                } else {
+                    llvm::SmallString<256> appended(old_features);
+                    appended.push_back(',');
+                    appended.append(features);
+                    new_attrs.addAttribute("target-features", appended);
+                }
+            }
 
-        // Setup the jit so that it can look up symbols from the current process.
-        auto dlsg = llvm::orc::DynamicLibrarySearchGenerator::GetForCurrentProcess(
-            m_lljit->getDataLayout().getGlobalPrefix());
-        if (!dlsg) {
-            throw std::invalid_argument("Could not create the dynamic library search generator");
+            f.setAttributes(attrs.addAttributes(m.getContext(), llvm::AttributeList::FunctionIndex, new_attrs));
         }
-        m_lljit->getMainJITDylib().addGenerator(std::move(*dlsg));
+#endif
 
-        // Keep a target machine around to fetch various
-        // properties of the host CPU.
-        auto tm = jtmb->createTargetMachine();
-        if (!tm) {
-            throw std::invalid_argument("Error creating the target machine");
+        // NOTE: currently LLVM forces 256-bit vector
+        // width when AVX-512 is available, due to clock
+        // frequency scaling concerns. Forcing 512-bit vector
+        // width unconditionally can hurt performance in scalar mode,
+        // thus it is enabled only on request (e.g., when using
+        // a batch size of 8 in double precision).
+        if (prefer_vw512) {
+            for (auto &f : m) {
+                if (!f.isDeclaration()) {
+                    f.addFnAttr("prefer-vector-width", "512");
+                }
+            }
         }
-        m_tm = std::move(*tm);
-
-        // Create the context.
-        m_ctx = std::make_unique<llvm::orc::ThreadSafeContext>(std::make_unique<llvm::LLVMContext>());
-
-#if LLVM_VERSION_MAJOR == 10
-        // NOTE: on LLVM 10, we cannot fetch the target triple
-        // from the lljit class. Thus, we get it from the jtmb instead.
-        m_triple = std::make_unique<llvm::Triple>(jtmb->getTargetTriple());
-#endif
 
-        // NOTE: by default, errors in the execution session are printed
-        // to screen. A custom error reported can be specified, ideally
-        // we would like th throw here but I am not sure whether throwing
-        // here would disrupt LLVM's cleanup actions?
-        // https://llvm.org/doxygen/classllvm_1_1orc_1_1ExecutionSession.html
-    }
+        // Init the module pass manager.
+        auto module_pm = std::make_unique<llvm::legacy::PassManager>();
+        // These are passes which set up target-specific info
+        // that are used by successive optimisation passes.
+        auto tliwp = std::make_unique<llvm::TargetLibraryInfoWrapperPass>(
+            llvm::TargetLibraryInfoImpl(tm.getTargetTriple()));
+        module_pm->add(tliwp.release());
+        module_pm->add(llvm::createTargetTransformInfoWrapperPass(tm.getTargetIRAnalysis()));
 
-    jit(const jit &) = delete;
-    jit(jit &&) = delete;
-    jit &operator=(const jit &) = delete;
-    jit &operator=(jit &&) = delete;
+        // NOTE: not sure what this does, presumably some target-specifc
+        // configuration.
+        module_pm->add(static_cast<llvm::LLVMTargetMachine &>(tm).createPassConfig(*module_pm));
 
-    ~jit() = default;
+        // Init the function pass manager.
+        auto f_pm = std::make_unique<llvm::legacy::FunctionPassManager>(&m);
+        f_pm->add(llvm::createTargetTransformInfoWrapperPass(tm.getTargetIRAnalysis()));
 
-    // Accessors.
-    llvm::LLVMContext &get_context()
-    {
-        return *m_ctx->getContext();
-    }
-    const llvm::LLVMContext &get_context() const
-    {
-        return *m_ctx->getContext();
-    }
-    std::string get_target_cpu() const
-    {
-        return m_tm->getTargetCPU().str();
-    }
-    std::string get_target_features() const
-    {
-        return m_tm->getTargetFeatureString().str();
-    }
-    llvm::TargetIRAnalysis get_target_ir_analysis() const
-    {
-        return m_tm->getTargetIRAnalysis();
-    }
-    const llvm::Triple &get_target_triple() const
-    {
-#if LLVM_VERSION_MAJOR == 10
-        return *m_triple;
-#else
-        return m_lljit->getTargetTriple();
-#endif
-    }
+        // Add an initial pass to vectorize load/stores.
+        // This is useful to ensure that the
+        // pattern adopted in load_vector_from_memory() and
+        // store_vector_to_memory() is translated to
+        // vectorized store/load instructions.
+        auto lsv_pass = std::unique_ptr<llvm::Pass>(llvm::createLoadStoreVectorizerPass());
+        f_pm->add(lsv_pass.release());
 
-    void add_module(std::unique_ptr<llvm::Module> &&m)
-    {
-        auto err = m_lljit->addIRModule(llvm::orc::ThreadSafeModule(std::move(m), *m_ctx));
+        if (profile == opt_profile::fast_compile) {
+            // Minimal pipeline: promote the allocas to registers
+            // and run a couple of cheap cleanup passes. No inlining.
+            f_pm->add(llvm::createPromoteMemoryToRegisterPass());
+            f_pm->add(llvm::createEarlyCSEPass());
+            f_pm->add(llvm::createCFGSimplificationPass());
+        } else {
+            // We use the helper class PassManagerBuilder to populate the module
+            // pass manager with standard options.
+            llvm::PassManagerBuilder pm_builder;
+            // See here for the defaults:
+            // https://llvm.org/doxygen/PassManagerBuilder_8cpp_source.html
+            // NOTE: we used to have the SLP vectorizer on here, but
+            // we don't activate it any more in favour of explicit vectorization.
+            // The aggressive profile re-enables it (together with the loop
+            // vectorizer) on top of the explicit vectorization.
+            pm_builder.OptLevel = opt_level;
+            if (profile == opt_profile::aggressive) {
+                pm_builder.SLPVectorize = true;
+                pm_builder.LoopVectorize = true;
+            }
+            if (inline_functions) {
+                // Enable function inlining if the inlining flag is enabled.
+                pm_builder.Inliner = llvm::createFunctionInliningPass(opt_level, 0, false);
+            }
 
-        if (err) {
-            std::string err_report;
-            llvm::raw_string_ostream ostr(err_report);
+            tm.adjustPassManager(pm_builder);
 
-            ostr << err;
+            // Populate both the function pass manager and the module pass manager.
+            pm_builder.populateFunctionPassManager(*f_pm);
+            pm_builder.populateModulePassManager(*module_pm);
+        }
 
-            throw std::invalid_argument("The function for adding a module to the jit failed. The full error message:\n"
-                                        + ostr.str());
+        // Run the function pass manager on all functions in the module.
+        f_pm->doInitialization();
+        for (auto &f : m) {
+            f_pm->run(f);
         }
-    }
+        f_pm->doFinalization();
 
-    // Symbol lookup.
-    llvm::Expected<llvm::JITEvaluatedSymbol> lookup(const std::string &name)
-    {
-        return m_lljit->lookup(name);
+        // Run the module passes.
+        module_pm->run(m);
     }
-};
+}
 
-llvm_state::llvm_state(std::tuple<std::string, unsigned, bool, bool, bool> &&tup)
-    : m_jitter(std::make_unique<jit>()), m_opt_level(std::get<1>(tup)), m_fast_math(std::get<2>(tup)),
-      m_module_name(std::move(std::get<0>(tup))), m_save_object_code(std::get<3>(tup)),
-      m_inline_functions(std::get<4>(tup))
+// Run codegen on the module m, using the target
+// machine tm, and return the object code.
+std::string emit_object_code(llvm::Module &m, llvm::TargetMachine &tm)
 {
-    // Create the module.
-    m_module = std::make_unique<llvm::Module>(m_module_name, context());
-    // Setup the data layout and the target triple.
-    m_module->setDataLayout(m_jitter->m_lljit->getDataLayout());
-    m_module->setTargetTriple(m_jitter->get_target_triple().str());
+    // Setup a buffer+stream for dumping the object code.
+    llvm::SmallVector<char, 0> buffer;
+    llvm::raw_svector_ostream buf_stream(buffer);
 
-    // Create a new builder for the module.
-    m_builder = std::make_unique<ir_builder>(context());
+    // Setup the machinery for dumping the object code.
+    llvm::legacy::PassManager pass;
 
-    if (m_fast_math) {
-        // Set flags for faster math at the
-        // price of potential change of semantics.
-        llvm::FastMathFlags fmf;
-        fmf.setFast();
-        m_builder->setFastMathFlags(fmf);
-    } else {
-        // By default, allow only fp contraction.
-        // NOTE: if we ever implement double-double
-        // arithmetic, we must either revisit this
-        // or make sure that fp contraction is off
-        // for the double-double primitives.
-        llvm::FastMathFlags fmf;
-        fmf.setAllowContract();
-        m_builder->setFastMathFlags(fmf);
+    if (tm.addPassesToEmitFile(pass, buf_stream, nullptr, llvm::CGFT_ObjectFile)) {
+        throw std::invalid_argument("The target machine can't emit a file of this type");
     }
+
+    // Dump the object code.
+    pass.run(m);
+
+    auto str_ref = buf_stream.str();
+    return std::string(str_ref.begin(), str_ref.end());
 }
 
-// NOTE: this will ensure that all kwargs
-// are set to their default values.
-llvm_state::llvm_state() : llvm_state(kw_args_ctor_impl()) {}
+// Helpers to convert a module to/from bitcode.
+// NOTE: bitcode is used to move modules across LLVM
+// contexts, which cannot be used concurrently
+// from multiple threads.
+std::string module_to_bitcode(const llvm::Module &m)
+{
+    std::string out;
+    llvm::raw_string_ostream ostr(out);
 
-llvm_state::llvm_state(const llvm_state &other)
-    : m_jitter(std::make_unique<jit>()), m_opt_level(other.m_opt_level), m_fast_math(other.m_fast_math),
-      m_module_name(other.m_module_name), m_save_object_code(other.m_save_object_code),
-      m_object_code(other.m_object_code), m_inline_functions(other.m_inline_functions)
+    llvm::WriteBitcodeToFile(m, ostr);
+
+    return std::move(ostr.str());
+}
+
+std::unique_ptr<llvm::Module> bitcode_to_module(const std::string &bc, llvm::LLVMContext &ctx)
 {
-    // Get the IR of other.
-    auto other_ir = other.get_ir();
+    auto ret = llvm::parseBitcodeFile(llvm::MemoryBufferRef(bc, "bitcode"), ctx);
 
-    // Create the corresponding memory buffer.
-    auto mb = llvm::MemoryBuffer::getMemBuffer(std::move(other_ir));
+    if (!ret) {
+        throw std::invalid_argument("Error parsing bitcode. The full error message:\n"
+                                    + llvm::toString(ret.takeError()));
+    }
 
-    // Construct a new module from the parsed IR.
-    llvm::SMDiagnostic err;
-    m_module = llvm::parseIR(*mb, err, context());
+    return std::move(*ret);
+}
+
+// Split the module m into at most n partitions, and return
+// the partitions in bitcode format.
+// NOTE: the partitions which do not contain any
+// definition are discarded.
+std::vector<std::string> split_module(std::unique_ptr<llvm::Module> &&m, unsigned n)
+{
+    std::vector<std::string> retval;
+
+    // NOTE: in LLVM >= 12, SplitModule() takes the
+    // module by reference rather than by unique_ptr.
+#if LLVM_VERSION_MAJOR < 12
+    llvm::SplitModule(std::move(m), n, [&retval](std::unique_ptr<llvm::Module> mp) {
+#else
+    llvm::SplitModule(*m, n, [&retval](std::unique_ptr<llvm::Module> mp) {
+#endif
+        for (const auto &gv : mp->global_values()) {
+            if (!gv.isDeclaration()) {
+                retval.push_back(module_to_bitcode(*mp));
+                break;
+            }
+        }
+    });
+
+    return retval;
+}
+
+// Remove from the module m the definitions of the functions
+// in names, and return a new module in bitcode format containing
+// only those definitions. The local symbols of m are externalised
+// beforehand, so that they can be referenced across the two modules.
+// NOTE: the functions which are used within m are not extracted,
+// as the code in m could not be linked before the compilation
+// of the extracted functions. If no function is extracted,
+// an empty string is returned.
+std::string extract_functions(llvm::Module &m, const std::vector<std::string> &names)
+{
+    std::vector<llvm::Function *> fs;
+    for (const auto &name : names) {
+        auto *f = m.getFunction(name);
+
+        if (f != nullptr && !f->isDeclaration() && f->use_empty()) {
+            fs.push_back(f);
+        }
+    }
+
+    if (fs.empty()) {
+        return {};
+    }
+
+    // NOTE: this mirrors the externalisation
+    // performed by SplitModule().
+    for (auto &gv : m.global_values()) {
+        if (gv.hasLocalLinkage()) {
+            gv.setLinkage(llvm::GlobalValue::ExternalLinkage);
+            gv.setVisibility(llvm::GlobalValue::HiddenVisibility);
+        }
+
+        if (!gv.hasName()) {
+            gv.setName("heyoka_unnamed");
+        }
+    }
+
+    llvm::ValueToValueMapTy vmap;
+    auto lazy_m = llvm::CloneModule(m, vmap, [&fs](const llvm::GlobalValue *gv) {
+        return std::find(fs.begin(), fs.end(), gv) != fs.end();
+    });
+
+    for (auto *f : fs) {
+        f->deleteBody();
+    }
+
+    return module_to_bitcode(*lazy_m);
+}
+
+// Scale the counts a and b so that they fit in the
+// 32-bit branch weights, preserving their ratio.
+std::pair<std::uint32_t, std::uint32_t> pgo_branch_weights(std::uint64_t a, std::uint64_t b)
+{
+    constexpr auto u32_max = std::numeric_limits<std::uint32_t>::max();
+
+    const auto scale = std::max(a, b) / u32_max + 1u;
+
+    return {static_cast<std::uint32_t>(a / scale), static_cast<std::uint32_t>(b / scale)};
+}
+
+// Attach the profile data to the instrumented module m, and
+// remove the instrumentation. counters maps the names of the
+// counters global arrays to their values.
+// NOTE: the instrumentation is added by llvm_loop_u32():
+// - the loop back-edges and the branches skipping
+//   the loops are tagged with the heyoka.pgo.latch and
+//   heyoka.pgo.skip metadata, referring to the counters
+//   [entered, skipped, iterations] of the loop,
+// - the functions are tagged with the heyoka.pgo.entry
+//   metadata, referring to the entry counter of the function,
+// - the counter increments are tagged with the
+//   heyoka.pgo.counter metadata.
+// Counters which are not in the map are ignored.
+void pgo_apply_profile(llvm::Module &m, const std::map<std::string, const std::uint64_t *> &counters)
+{
+    // Fetch the counters referred to by the metadata
+    // kind_name of obj (nullptr if not available).
+    auto get_counters = [&counters](const auto &obj, const char *kind_name) -> const std::uint64_t * {
+        auto *md = obj.getMetadata(kind_name);
+        if (md == nullptr || md->getNumOperands() != 1u) {
+            return nullptr;
+        }
+
+        auto *vam = llvm::dyn_cast_or_null<llvm::ValueAsMetadata>(md->getOperand(0).get());
+        if (vam == nullptr) {
+            return nullptr;
+        }
+
+        const auto it = counters.find(vam->getValue()->getName().str());
+
+        return it == counters.end() ? nullptr : it->second;
+    };
+
+    llvm::MDBuilder mdb(m.getContext());
+
+    std::vector<llvm::Instruction *> incs;
+
+    for (auto &f : m) {
+        if (const auto *c = get_counters(f, "heyoka.pgo.entry")) {
+            f.setEntryCount(llvm::Function::ProfileCount(c[0], llvm::Function::PCT_Real));
+        }
+        f.setMetadata("heyoka.pgo.entry", nullptr);
+
+        for (auto &bb : f) {
+            for (auto &inst : bb) {
+                if (inst.getMetadata("heyoka.pgo.counter") != nullptr) {
+                    incs.push_back(&inst);
+                    continue;
+                }
+
+                // NOTE: the entered/skipped counts are the weights
+                // of the skip branch (whose true successor
+                // skips the loop), while the weights of the back-edge
+                // are the number of iterations minus the number
+                // of loop entries (the true successor is the loop
+                // header) and the number of loop exits.
+                if (const auto *c = get_counters(inst, "heyoka.pgo.skip")) {
+                    if (c[0] != 0u || c[1] != 0u) {
+                        const auto [w_t, w_f] = pgo_branch_weights(c[1], c[0]);
+                        inst.setMetadata(llvm::LLVMContext::MD_prof, mdb.createBranchWeights(w_t, w_f));
+                    }
+                }
+                if (const auto *c = get_counters(inst, "heyoka.pgo.latch")) {
+                    if (c[2] != 0u) {
+                        const auto [w_t, w_f] = pgo_branch_weights(c[2] - c[0], c[0]);
+                        inst.setMetadata(llvm::LLVMContext::MD_prof, mdb.createBranchWeights(w_t, w_f));
+                    }
+                }
+
+                inst.setMetadata("heyoka.pgo.skip", nullptr);
+                inst.setMetadata("heyoka.pgo.latch", nullptr);
+            }
+        }
+    }
+
+    // Remove the instrumentation. The computation of
+    // the increments will be removed by the optimiser.
+    for (auto *inst : incs) {
+        inst->eraseFromParent();
+    }
+
+    std::vector<llvm::GlobalVariable *> gvs;
+    for (auto &gv : m.globals()) {
+        if (gv.getName().startswith("heyoka.pgo") && gv.use_empty()) {
+            gvs.push_back(&gv);
+        }
+    }
+
+    for (auto *gv : gvs) {
+        gv->eraseFromParent();
+    }
+}
+
+// Invoke f(i) for i in [0, n) using up to n threads. The first exception
+// thrown by f, if any, is re-thrown after all threads have been joined.
+template <typename F>
+void parallel_run(std::size_t n, const F &f)
+{
+    std::vector<std::exception_ptr> eptrs(n);
+
+    auto wrapper = [&f, &eptrs](std::size_t i) {
+        try {
+            f(i);
+        } catch (...) {
+            eptrs[i] = std::current_exception();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    try {
+        for (std::size_t i = 1; i < n; ++i) {
+            threads.emplace_back(wrapper, i);
+        }
+    } catch (...) {
+        for (auto &thr : threads) {
+            thr.join();
+        }
+
+        throw;
+    }
+
+    if (n > 0u) {
+        wrapper(0);
+    }
+
+    for (auto &thr : threads) {
+        thr.join();
+    }
+
+    for (const auto &eptr : eptrs) {
+        if (eptr) {
+            std::rethrow_exception(eptr);
+        }
+    }
+}
+
+// JIT event listener writing the symbols of the compiled
+// functions into the perf map file of the process
+// (/tmp/perf-<pid>.map), in the format expected
+// by the Linux perf tool.
+// NOTE: the entries are never removed from the map file,
+// as the format provides no way of doing so.
+class perf_map_listener final : public llvm::JITEventListener
+{
+    std::mutex m_mutex;
+    std::ofstream m_file;
+
+public:
+    perf_map_listener()
+    {
+#if defined(__linux__)
+        const auto path = "/tmp/perf-" + std::to_string(::getpid()) + ".map";
+
+        m_file.open(path, std::ios_base::out | std::ios_base::app);
+        if (!m_file) {
+            throw std::invalid_argument("Unable to open the perf map file '" + path + "'");
+        }
+#else
+        throw std::invalid_argument("The perf map JIT event listener is available only on Linux");
+#endif
+    }
+
+    void notifyObjectLoaded(ObjectKey, const llvm::object::ObjectFile &obj,
+                            const llvm::RuntimeDyld::LoadedObjectInfo &info) override
+    {
+        // NOTE: in the object for debug, the addresses of
+        // the symbols are the addresses in memory.
+        const auto dbg_obj = info.getObjectForDebug(obj);
+        if (dbg_obj.getBinary() == nullptr) {
+            return;
+        }
+
+        std::lock_guard lock(m_mutex);
+
+        for (const auto &[sym, size] : llvm::object::computeSymbolSizes(*dbg_obj.getBinary())) {
+            auto type = sym.getType();
+            if (!type) {
+                llvm::consumeError(type.takeError());
+                continue;
+            }
+            if (*type != llvm::object::SymbolRef::ST_Function) {
+                continue;
+            }
+
+            auto name = sym.getName();
+            if (!name) {
+                llvm::consumeError(name.takeError());
+                continue;
+            }
+
+            auto addr = sym.getAddress();
+            if (!addr) {
+                llvm::consumeError(addr.takeError());
+                continue;
+            }
+
+            m_file << std::hex << *addr << ' ' << size << std::dec << ' ' << name->str() << '\n';
+        }
+
+        m_file.flush();
+    }
+};
+
+// Fetch the (process-wide) JIT event listeners in ls.
+std::vector<llvm::JITEventListener *> get_jit_event_listeners(jit_listener ls)
+{
+    std::vector<llvm::JITEventListener *> retval;
+
+    if ((ls & jit_listener::gdb) != jit_listener::none) {
+        retval.push_back(llvm::JITEventListener::createGDBRegistrationListener());
+    }
+
+    if ((ls & jit_listener::perf_map) != jit_listener::none) {
+        static perf_map_listener pml;
+        retval.push_back(&pml);
+    }
+
+    if ((ls & jit_listener::perf_jitdump) != jit_listener::none) {
+        auto *l = llvm::JITEventListener::createPerfJITEventListener();
+        if (l == nullptr) {
+            throw std::invalid_argument(
+                "The perf jitdump JIT event listener is not available (LLVM must be built with LLVM_USE_PERF)");
+        }
+        retval.push_back(l);
+    }
+
+    if ((ls & jit_listener::intel) != jit_listener::none) {
+        // NOTE: the Intel listener is allocated on each invocation,
+        // keep a single instance around for the whole process.
+        static auto *const il = llvm::JITEventListener::createIntelJITEventListener();
+        if (il == nullptr) {
+            throw std::invalid_argument("The Intel JIT event listener is not available (LLVM must be built with "
+                                        "LLVM_USE_INTEL_JITEVENTS)");
+        }
+        retval.push_back(il);
+    }
+
+    return retval;
+}
+
+// A JIT session, shared among the llvm_state instances
+// targeting the same CPU. Each llvm_state adds its code
+// to its own JITDylib within the session, so that the
+// symbols of different states do not clash.
+struct jit_session {
+    std::unique_ptr<llvm::orc::LLJIT> m_lljit;
+    std::unique_ptr<llvm::orc::JITTargetMachineBuilder> m_jtmb;
+#if LLVM_VERSION_MAJOR == 10
+    std::unique_ptr<llvm::Triple> m_triple;
+#endif
+    // Counter used to generate unique JITDylib names.
+    std::atomic<unsigned long long> m_dylib_counter{0};
+
+    // NOTE: if cpu and/or features are not empty, they override
+    // the properties of the host CPU in the target machine (i.e.,
+    // the generated code is meant to be run on a different CPU).
+    // If fast_codegen is true, the codegen is run without optimisations
+    // and with fast instruction selection. listeners are the
+    // JIT event listeners to be registered with the object linking layer.
+    jit_session(const std::string &cpu, const std::string &features, bool fast_codegen, jit_listener listeners)
+    {
+        init_native_target();
+
+        // Create the target machine builder.
+        auto jtmb = llvm::orc::JITTargetMachineBuilder::detectHost();
+        if (!jtmb) {
+            throw std::invalid_argument("Error creating a JITTargetMachineBuilder for the host system");
+        }
+        if (fast_codegen) {
+            jtmb->setCodeGenOptLevel(llvm::CodeGenOpt::None);
+
+            auto opts = jtmb->getOptions();
+            opts.EnableFastISel = true;
+            jtmb->setOptions(std::move(opts));
+        } else {
+            // Set the codegen optimisation level to aggressive.
+            jtmb->setCodeGenOptLevel(llvm::CodeGenOpt::Aggressive);
+        }
+
+        if (!cpu.empty() || !features.empty()) {
+            // Override the target CPU and its features.
+            // NOTE: if only the CPU is specified, the features
+            // are those implied by the CPU (i.e., the host features
+            // are discarded).
+            if (!cpu.empty()) {
+                jtmb->setCPU(cpu);
+            }
+            jtmb->getFeatures() = llvm::SubtargetFeatures(features);
+        }
+
+        // Create the jit builder.
+        llvm::orc::LLJITBuilder lljit_builder;
+        // NOTE: other settable properties may
+        // be of interest:
+        // https://www.llvm.org/doxygen/classllvm_1_1orc_1_1LLJITBuilder.html
+        lljit_builder.setJITTargetMachineBuilder(*jtmb);
+        // NOTE: the session can be used concurrently by multiple
+        // llvm_state instances. The default compiler of the jit
+        // owns a single target machine and cannot be used concurrently,
+        // thus we use a compiler which creates a new target machine
+        // for each compilation.
+#if LLVM_VERSION_MAJOR == 10
+        lljit_builder.setCompileFunctionCreator(
+            [](llvm::orc::JITTargetMachineBuilder j) -> llvm::Expected<llvm::orc::IRCompileLayer::CompileFunction> {
+                return llvm::orc::ConcurrentIRCompiler(std::move(j));
+            });
+#else
+        lljit_builder.setCompileFunctionCreator(
+            [](llvm::orc::JITTargetMachineBuilder j)
+                -> llvm::Expected<std::unique_ptr<llvm::orc::IRCompileLayer::IRCompiler>> {
+                return std::make_unique<llvm::orc::ConcurrentIRCompiler>(std::move(j));
+            });
+#endif
+
+        // Setup the JIT event listeners, if requested.
+        if (listeners != jit_listener::none) {
+            auto ls = get_jit_event_listeners(listeners);
+
+            lljit_builder.setObjectLinkingLayerCreator(
+                [ls = std::move(ls)](llvm::orc::ExecutionSession &es,
+                                     const llvm::Triple &tt) -> std::unique_ptr<llvm::orc::ObjectLayer> {
+#if LLVM_VERSION_MAJOR >= 16
+                    auto get_mm
+                        = [](const llvm::MemoryBuffer &) { return std::make_unique<llvm::SectionMemoryManager>(); };
+#else
+                    auto get_mm = []() { return std::make_unique<llvm::SectionMemoryManager>(); };
+#endif
+                    auto layer = std::make_unique<llvm::orc::RTDyldObjectLinkingLayer>(es, std::move(get_mm));
+
+                    // NOTE: this mirrors the setup of the default
+                    // object linking layer of the LLJIT class.
+                    if (tt.isOSBinFormatCOFF()) {
+                        layer->setOverrideObjectFlagsWithResponsibilityFlags(true);
+                        layer->setAutoClaimResponsibilityForObjectSymbols(true);
+                    }
+
+                    for (auto *l : ls) {
+                        layer->registerJITEventListener(*l);
+                    }
+
+                    return layer;
+                });
+        }
+
+        // Create the jit.
+        auto lljit = lljit_builder.create();
+        if (!lljit) {
+            throw std::invalid_argument("Error creating an LLJIT object");
+        }
+        m_lljit = std::move(*lljit);
+
+#if LLVM_VERSION_MAJOR == 10
+        // NOTE: on LLVM 10, we cannot fetch the target triple
+        // from the lljit class. Thus, we get it from the jtmb instead.
+        m_triple = std::make_unique<llvm::Triple>(jtmb->getTargetTriple());
+#endif
+
+        // Keep also the target machine builder, so that we
+        // can create target machines for the session.
+        m_jtmb = std::make_unique<llvm::orc::JITTargetMachineBuilder>(std::move(*jtmb));
+
+        // NOTE: by default, errors in the execution session are printed
+        // to screen. A custom error reported can be specified, ideally
+        // we would like th throw here but I am not sure whether throwing
+        // here would disrupt LLVM's cleanup actions?
+        // https://llvm.org/doxygen/classllvm_1_1orc_1_1ExecutionSession.html
+    }
+
+    jit_session(const jit_session &) = delete;
+    jit_session(jit_session &&) = delete;
+    jit_session &operator=(const jit_session &) = delete;
+    jit_session &operator=(jit_session &&) = delete;
+
+    ~jit_session() = default;
+
+    // Create a new JITDylib in the session. The JITDylib
+    // can look up symbols from the current process.
+    llvm::orc::JITDylib &create_dylib()
+    {
+        auto name = "heyoka_dylib_" + std::to_string(m_dylib_counter.fetch_add(1u));
+
+#if LLVM_VERSION_MAJOR == 10
+        auto &dylib = m_lljit->createJITDylib(std::move(name));
+#else
+        auto edylib = m_lljit->createJITDylib(std::move(name));
+        if (!edylib) {
+            llvm::consumeError(edylib.takeError());
+
+            throw std::invalid_argument("Could not create a JITDylib");
+        }
+        auto &dylib = *edylib;
+#endif
+
+        auto dlsg = llvm::orc::DynamicLibrarySearchGenerator::GetForCurrentProcess(
+            m_lljit->getDataLayout().getGlobalPrefix());
+        if (!dlsg) {
+            throw std::invalid_argument("Could not create the dynamic library search generator");
+        }
+        dylib.addGenerator(std::move(*dlsg));
+
+        return dylib;
+    }
+
+    // Remove a JITDylib from the session.
+    // NOTE: before LLVM 12, there is no way of freeing
+    // the resources associated to a JITDylib (they are
+    // freed only when the session is destroyed).
+    void remove_dylib([[maybe_unused]] llvm::orc::JITDylib &dylib) noexcept
+    {
+#if LLVM_VERSION_MAJOR >= 13
+        llvm::consumeError(m_lljit->getExecutionSession().removeJITDylib(dylib));
+#elif LLVM_VERSION_MAJOR == 12
+        llvm::consumeError(dylib.clear());
+#endif
+    }
+};
+
+// The process-wide pool of JIT sessions, indexed by target CPU,
+// target features, codegen mode and JIT event listeners. The sessions are kept alive by the llvm_state
+// instances using them, and they are destroyed (thus freeing all
+// their resources) when the last llvm_state using them is destroyed.
+std::mutex jit_session_mutex;
+std::map<std::tuple<std::string, std::string, bool, jit_listener>, std::weak_ptr<jit_session>> jit_sessions;
+
+std::shared_ptr<jit_session> get_jit_session(const std::string &cpu, const std::string &features, bool fast_codegen,
+                                             jit_listener listeners)
+{
+    std::lock_guard lock(jit_session_mutex);
+
+    auto &wp = jit_sessions[{cpu, features, fast_codegen, listeners}];
+
+    auto retval = wp.lock();
+    if (!retval) {
+        retval = std::make_shared<jit_session>(cpu, features, fast_codegen, listeners);
+        wp = retval;
+    }
+
+    return retval;
+}
+
+// Re-create the textual IR of the module called mname
+// from the (possibly null) IR snapshot snap, in bitcode format.
+// NOTE: the module is parsed in a new context, so that
+// the context of the jit (which is shared among the copies of
+// a compiled state) is never accessed.
+std::string ir_snapshot_str(const std::shared_ptr<const std::string> &snap, const std::string &mname)
+{
+    if (!snap) {
+        return {};
+    }
+
+    llvm::LLVMContext ctx;
+    auto m = bitcode_to_module(*snap, ctx);
+    m->setModuleIdentifier(mname);
+
+    std::string out;
+    llvm::raw_string_ostream ostr(out);
+    m->print(ostr, nullptr);
+
+    return std::move(ostr.str());
+}
+
+} // namespace
+
+} // namespace detail
+
+// Implementation of the jit class.
+struct llvm_state::jit {
+    // NOTE: the session must be destroyed after the
+    // other data members which refer to it.
+    std::shared_ptr<detail::jit_session> m_session;
+    llvm::orc::JITDylib *m_dylib = nullptr;
+    std::unique_ptr<llvm::TargetMachine> m_tm;
+    std::unique_ptr<llvm::orc::ThreadSafeContext> m_ctx;
+    detail::target_features m_features;
+    // The lazily-compiled functions (sorted) and the module containing
+    // them in bitcode format (empty if there are no lazy functions
+    // or if they have already been compiled).
+    // NOTE: the mutex protects m_lazy_bc, as the jit is shared
+    // among copies of a compiled llvm_state, which may be used concurrently.
+    std::vector<std::string> m_lazy_names;
+    std::string m_lazy_bc;
+    std::mutex m_lazy_mutex;
+
+    jit(const std::string &cpu, const std::string &features, bool fast_codegen, jit_listener listeners)
+        : m_session(detail::get_jit_session(cpu, features, fast_codegen, listeners)),
+          m_dylib(&m_session->create_dylib())
+    {
+        try {
+            // Keep a target machine around to fetch various
+            // properties of the target CPU.
+            m_tm = create_target_machine();
+
+            if (!cpu.empty() && !m_tm->getMCSubtargetInfo()->isCPUStringValid(cpu)) {
+                throw std::invalid_argument("Invalid target CPU '" + cpu
+                                            + "' specified in the construction of an llvm_state");
+            }
+        } catch (...) {
+            m_session->remove_dylib(*m_dylib);
+            throw;
+        }
+
+        // Detect the features of the target machine.
+        m_features = detail::get_target_features_impl(*m_tm);
+
+        // Create the context.
+        m_ctx = std::make_unique<llvm::orc::ThreadSafeContext>(std::make_unique<llvm::LLVMContext>());
+    }
+
+    jit(const jit &) = delete;
+    jit(jit &&) = delete;
+    jit &operator=(const jit &) = delete;
+    jit &operator=(jit &&) = delete;
+
+    // NOTE: free the resources of the compiled code
+    // when the jit is destroyed.
+    ~jit()
+    {
+        m_session->remove_dylib(*m_dylib);
+    }
+
+    // Accessors.
+    llvm::LLVMContext &get_context()
+    {
+        return *m_ctx->getContext();
+    }
+    const llvm::LLVMContext &get_context() const
+    {
+        return *m_ctx->getContext();
+    }
+    std::string get_target_cpu() const
+    {
+        return m_tm->getTargetCPU().str();
+    }
+    std::string get_target_features() const
+    {
+        return m_tm->getTargetFeatureString().str();
+    }
+    // NOTE: this includes the SIMD features implied by the target CPU.
+    std::string get_effective_features() const
+    {
+        return detail::effective_target_features(get_target_features(), m_features);
+    }
+    llvm::TargetIRAnalysis get_target_ir_analysis() const
+    {
+        return m_tm->getTargetIRAnalysis();
+    }
+    const llvm::Triple &get_target_triple() const
+    {
+#if LLVM_VERSION_MAJOR == 10
+        return *m_session->m_triple;
+#else
+        return m_session->m_lljit->getTargetTriple();
+#endif
+    }
+    const llvm::DataLayout &get_data_layout() const
+    {
+        return m_session->m_lljit->getDataLayout();
+    }
+
+    void add_module(std::unique_ptr<llvm::Module> &&m)
+    {
+        auto err = m_session->m_lljit->addIRModule(*m_dylib, llvm::orc::ThreadSafeModule(std::move(m), *m_ctx));
+
+        if (err) {
+            std::string err_report;
+            llvm::raw_string_ostream ostr(err_report);
+
+            ostr << err;
+
+            throw std::invalid_argument("The function for adding a module to the jit failed. The full error message:\n"
+                                        + ostr.str());
+        }
+    }
+
+    void add_object(const std::string &obj)
+    {
+        add_object(llvm::MemoryBuffer::getMemBufferCopy(obj));
+    }
+
+    // NOTE: the jit takes ownership of the buffer,
+    // no copy of the object code is made.
+    void add_object(std::unique_ptr<llvm::MemoryBuffer> buf)
+    {
+        auto err = m_session->m_lljit->addObjectFile(*m_dylib, std::move(buf));
+
+        if (err) {
+            std::string err_report;
+            llvm::raw_string_ostream ostr(err_report);
+
+            ostr << err;
+
+            throw std::invalid_argument(
+                "The function for adding an object file to the jit failed. The full error message:\n" + ostr.str());
+        }
+    }
+
+    // Create a new target machine for the target CPU.
+    // NOTE: target machines cannot be used concurrently
+    // from multiple threads.
+    std::unique_ptr<llvm::TargetMachine> create_target_machine() const
+    {
+        auto tm = m_session->m_jtmb->createTargetMachine();
+        if (!tm) {
+            throw std::invalid_argument("Error creating the target machine");
+        }
+
+        return std::move(*tm);
+    }
+
+    // Setup the lazily-compiled functions.
+    void set_lazy(std::vector<std::string> names, std::string bc)
+    {
+        std::sort(names.begin(), names.end());
+
+        m_lazy_names = std::move(names);
+        m_lazy_bc = std::move(bc);
+    }
+
+    // Symbol lookup. If name is a lazily-compiled
+    // function, the lazy module is compiled first.
+    llvm::Expected<llvm::JITEvaluatedSymbol> lookup(const std::string &name)
+    {
+        if (std::binary_search(m_lazy_names.begin(), m_lazy_names.end(), name)) {
+            std::lock_guard lock(m_lazy_mutex);
+
+            if (!m_lazy_bc.empty()) {
+                llvm::LLVMContext ctx;
+
+                auto m = detail::bitcode_to_module(m_lazy_bc, ctx);
+                auto tm = create_target_machine();
+                add_object(detail::emit_object_code(*m, *tm));
+
+                m_lazy_bc.clear();
+            }
+        }
+
+        return m_session->m_lljit->lookup(*m_dylib, name);
+    }
+};
+
+llvm_state::llvm_state(
+    std::tuple<std::string, unsigned, bool, bool, bool, std::string, unsigned, bool, std::string, std::string,
+               opt_profile, sleef_accuracy, jit_listener, std::string, bool> &&tup)
+    : m_jitter(std::make_shared<jit>(std::get<8>(tup), std::get<9>(tup),
+                                     std::get<10>(tup) == opt_profile::fast_compile, std::get<12>(tup))),
+      m_opt_level(std::get<1>(tup)),
+      m_fast_math(std::get<2>(tup)), m_module_name(std::move(std::get<0>(tup))), m_save_object_code(std::get<3>(tup)),
+      m_inline_functions(std::get<4>(tup)), m_cache_dir(std::move(std::get<5>(tup))),
+      m_n_compile_threads(std::get<6>(tup)), m_prefer_vw512(std::get<7>(tup)),
+      m_target_cpu(std::move(std::get<8>(tup))), m_target_features(std::move(std::get<9>(tup))),
+      m_opt_profile(std::get<10>(tup)), m_sleef_accuracy(std::get<11>(tup)), m_jit_listeners(std::get<12>(tup)),
+      m_sleef_bitcode(std::move(std::get<13>(tup))), m_ir_snapshot_enabled(std::get<14>(tup))
+{
+    if (m_n_compile_threads == 0u) {
+        m_n_compile_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    // Create the module.
+    m_module = std::make_unique<llvm::Module>(m_module_name, context());
+    // Setup the data layout and the target triple.
+    m_module->setDataLayout(m_jitter->get_data_layout());
+    m_module->setTargetTriple(m_jitter->get_target_triple().str());
+
+    // Create a new builder for the module.
+    m_builder = std::make_unique<ir_builder>(context());
+
+    if (m_fast_math) {
+        // Set flags for faster math at the
+        // price of potential change of semantics.
+        llvm::FastMathFlags fmf;
+        fmf.setFast();
+        m_builder->setFastMathFlags(fmf);
+    } else {
+        // By default, allow only fp contraction.
+        // NOTE: the double-length addition (see llvm_dl_add())
+        // turns off fp contraction in its implementation.
+        llvm::FastMathFlags fmf;
+        fmf.setAllowContract();
+        m_builder->setFastMathFlags(fmf);
+    }
+}
+
+// NOTE: this will ensure that all kwargs
+// are set to their default values.
+llvm_state::llvm_state() : llvm_state(kw_args_ctor_impl()) {}
+
+// NOTE: if other has been compiled already, the copy will share
+// the jit (and thus the compiled code) with other. This is safe
+// because a compiled llvm_state can only be used to look up symbols.
+// Otherwise, the module is deep-copied.
+llvm_state::llvm_state(const llvm_state &other)
+    : m_jitter(other.m_jitter), m_opt_level(other.m_opt_level), m_ir_snapshot(other.m_ir_snapshot),
+      m_fast_math(other.m_fast_math), m_module_name(other.m_module_name),
+      m_save_object_code(other.m_save_object_code), m_object_code(other.m_object_code),
+      m_inline_functions(other.m_inline_functions), m_cache_dir(other.m_cache_dir),
+      m_n_compile_threads(other.m_n_compile_threads), m_prefer_vw512(other.m_prefer_vw512),
+      m_target_cpu(other.m_target_cpu), m_target_features(other.m_target_features),
+      m_opt_profile(other.m_opt_profile), m_sleef_accuracy(other.m_sleef_accuracy),
+      m_jit_listeners(other.m_jit_listeners), m_sleef_bitcode(other.m_sleef_bitcode),
+      m_ir_snapshot_enabled(other.m_ir_snapshot_enabled), m_stats(other.m_stats),
+      m_cache_hit(other.m_cache_hit), m_variants(other.m_variants), m_lazy_functions(other.m_lazy_functions),
+      m_pgo_instrument(other.m_pgo_instrument), m_pgo_ir(other.m_pgo_ir), m_ir_dropped(other.m_ir_dropped),
+      m_sym_prefix(other.m_sym_prefix)
+{
+    if (!other.is_compiled()) {
+        *this = other.deep_copy();
+    }
+}
+
+llvm_state::llvm_state(llvm_state &&) noexcept = default;
+
+llvm_state &llvm_state::operator=(const llvm_state &other)
+{
+    if (this != &other) {
+        *this = llvm_state(other);
+    }
+
+    return *this;
+}
+
+llvm_state &llvm_state::operator=(llvm_state &&) noexcept = default;
+
+llvm_state::~llvm_state() = default;
+
+llvm::Module &llvm_state::module()
+{
+    check_uncompiled(__func__);
+    return *m_module;
+}
+
+ir_builder &llvm_state::builder()
+{
+    check_uncompiled(__func__);
+    return *m_builder;
+}
+
+llvm::LLVMContext &llvm_state::context()
+{
+    return m_jitter->get_context();
+}
+
+unsigned &llvm_state::opt_level()
+{
+    return m_opt_level;
+}
+
+bool &llvm_state::fast_math()
+{
+    return m_fast_math;
+}
+
+bool &llvm_state::inline_functions()
+{
+    return m_inline_functions;
+}
+
+bool &llvm_state::prefer_vw512()
+{
+    return m_prefer_vw512;
+}
+
+const llvm::Module &llvm_state::module() const
+{
+    check_uncompiled(__func__);
+    return *m_module;
+}
+
+const ir_builder &llvm_state::builder() const
+{
+    check_uncompiled(__func__);
+    return *m_builder;
+}
+
+const llvm::LLVMContext &llvm_state::context() const
+{
+    return m_jitter->get_context();
+}
+
+const unsigned &llvm_state::opt_level() const
+{
+    return m_opt_level;
+}
+
+const bool &llvm_state::fast_math() const
+{
+    return m_fast_math;
+}
+
+const bool &llvm_state::inline_functions() const
+{
+    return m_inline_functions;
+}
+
+const bool &llvm_state::prefer_vw512() const
+{
+    return m_prefer_vw512;
+}
+
+const std::string &llvm_state::get_cache_dir() const
+{
+    return m_cache_dir;
+}
+
+// NOTE: this returns true if the object code
+// was (or will be, if the module has not been
+// compiled yet) fetched from the cache.
+bool llvm_state::cache_hit() const
+{
+    return m_cache_hit;
+}
+
+unsigned llvm_state::get_compile_threads() const
+{
+    return m_n_compile_threads;
+}
+
+const detail::target_features &detail::get_target_features(const llvm_state &s)
+{
+    return s.m_jitter->m_features;
+}
+
+// NOTE: these return the properties of the target
+// machine, which are those of the host machine
+// unless the target_cpu/target_features keyword
+// arguments were used in the construction.
+std::string llvm_state::get_target_cpu() const
+{
+    return m_jitter->get_target_cpu();
+}
+
+std::string llvm_state::get_target_features() const
+{
+    return m_jitter->get_target_features();
+}
+
+opt_profile llvm_state::get_opt_profile() const
+{
+    return m_opt_profile;
+}
+
+sleef_accuracy llvm_state::get_sleef_accuracy() const
+{
+    return m_sleef_accuracy;
+}
+
+jit_listener llvm_state::get_jit_listeners() const
+{
+    return m_jit_listeners;
+}
+
+const std::string &llvm_state::get_sleef_bitcode() const
+{
+    return m_sleef_bitcode;
+}
+
+// NOTE: these return the total wall-clock time
+// (in seconds) spent in optimise() and in the
+// compilation (i.e., codegen and linking).
+double llvm_state::get_optimise_time() const
+{
+    return m_stats.opt_time;
+}
+
+double llvm_state::get_compile_time() const
+{
+    return m_stats.codegen_time + m_stats.link_time;
+}
+
+llvm_state_stats &llvm_state::stats()
+{
+    return m_stats;
+}
+
+const llvm_state_stats &llvm_state::stats() const
+{
+    return m_stats;
+}
+
+void llvm_state::check_uncompiled(const char *f) const
+{
     if (!m_module) {
-        std::string err_report;
-        llvm::raw_string_ostream ostr(err_report);
+        throw std::invalid_argument(std::string{"The function '"} + f
+                                    + "' can be invoked only if the module has not been compiled yet");
+    }
+}
+
+void llvm_state::check_compiled(const char *f) const
+{
+    if (m_module) {
+        throw std::invalid_argument(std::string{"The function '"} + f
+                                    + "' can be invoked only after the module has been compiled");
+    }
+}
+
+void llvm_state::check_ir_snapshot(const char *f) const
+{
+    if (m_ir_dropped) {
+        throw std::invalid_argument(std::string{"The function '"} + f
+                                    + "' cannot be invoked after the IR snapshot has been dropped (or if the "
+                                      "creation of the snapshot was disabled via the 'ir_snapshot' keyword argument)");
+    }
+}
+
+void llvm_state::verify_function(llvm::Function *f)
+{
+    check_uncompiled(__func__);
+
+    if (f == nullptr) {
+        throw std::invalid_argument("Cannot verify a null function pointer");
+    }
+
+    std::string err_report;
+    llvm::raw_string_ostream ostr(err_report);
+    if (llvm::verifyFunction(*f, &ostr)) {
+        // Remove function before throwing.
+        const auto fname = std::string(f->getName());
+        f->eraseFromParent();
+        throw std::invalid_argument("The verification of the function '" + fname + "' failed. The full error message:\n"
+                                    + ostr.str());
+    }
+}
+
+// Mark the function name to be compiled lazily, that is,
+// upon its first lookup rather than in compile(). This is useful
+// for auxiliary functions which may never be used.
+// NOTE: lazy compilation is disabled if the object
+// code needs to be stored (i.e., if save_object_code is
+// true or if the cache is enabled). Functions which are called
+// by other functions in the module are never compiled lazily.
+void llvm_state::mark_lazy(const std::string &name)
+{
+    check_uncompiled(__func__);
+
+    if (std::find(m_lazy_functions.begin(), m_lazy_functions.end(), name) == m_lazy_functions.end()) {
+        m_lazy_functions.push_back(name);
+    }
+}
+
+// Link into the module the module of the uncompiled state other, prepending prefix
+// to the names of the functions and of the global variables which are defined
+// with external linkage in other. The functions marked as lazy in other
+// are marked as lazy in this state as well. Afterwards, the functions of other
+// can be looked up in the compiled state by setting the symbol prefix to prefix
+// (see set_symbol_prefix()). This allows to compile several modules with a single
+// optimisation pass and a single jit compilation.
+// NOTE: the definitions with internal linkage are not deduplicated (e.g., the
+// compact-mode functions which other shares with the module are linked anew), and
+// the settings of other (e.g., the optimisation level) are ignored.
+void llvm_state::link_module(const llvm_state &other, const std::string &prefix)
+{
+    check_uncompiled(__func__);
+    other.check_uncompiled(__func__);
+
+    if (this == &other) {
+        throw std::invalid_argument("Cannot link the module of an llvm_state into itself");
+    }
+
+    if (prefix.empty()) {
+        throw std::invalid_argument("The prefix passed to link_module() cannot be empty");
+    }
+
+    if (m_pgo_instrument || other.m_pgo_instrument) {
+        throw std::invalid_argument(
+            "The linking of modules is not supported in an llvm_state instrumented for the profile-guided "
+            "optimisation");
+    }
+
+    if (!other.m_variants.empty()) {
+        throw std::invalid_argument("Cannot link the module of an llvm_state with ISA variants");
+    }
+
+    // NOTE: the module is moved into the context
+    // of this state via bitcode.
+    auto src = detail::bitcode_to_module(detail::module_to_bitcode(*other.m_module), context());
+
+    for (auto &f : src->functions()) {
+        if (!f.isDeclaration() && f.hasExternalLinkage()) {
+            f.setName(prefix + f.getName().str());
+        }
+    }
+
+    for (auto &gv : src->globals()) {
+        if (!gv.isDeclaration() && gv.hasExternalLinkage()) {
+            gv.setName(prefix + gv.getName().str());
+        }
+    }
+
+    if (llvm::Linker::linkModules(*m_module, std::move(src))) {
+        throw std::invalid_argument("Error linking the module '" + other.m_module_name + "' into the module '"
+                                    + m_module_name + "'");
+    }
+
+    for (const auto &name : other.m_lazy_functions) {
+        mark_lazy(prefix + name);
+    }
+}
+
+// Set the prefix prepended to the names passed to
+// jit_lookup(). This is used to look up the functions
+// of a module linked via link_module().
+void llvm_state::set_symbol_prefix(std::string prefix)
+{
+    if (m_pgo_instrument) {
+        throw std::invalid_argument(
+            "The symbol prefix cannot be set in an llvm_state instrumented for the profile-guided optimisation");
+    }
+
+    m_sym_prefix = std::move(prefix);
+}
+
+const std::string &llvm_state::get_symbol_prefix() const
+{
+    return m_sym_prefix;
+}
+
+// Enable the instrumentation of the loops generated by
+// llvm_loop_u32() in this state, which must be invoked
+// before the IR is generated. After the compiled code has been run,
+// pgo_recompile() recompiles the module using the collected
+// profile data (trip counts and branch probabilities of the loops,
+// and function entry counts).
+// NOTE: the counters are updated atomically, thus the instrumented
+// code can be run concurrently.
+void llvm_state::pgo_instrument()
+{
+    check_uncompiled(__func__);
+
+    m_pgo_instrument = true;
+}
+
+bool llvm_state::pgo_instrumented() const
+{
+    return m_pgo_instrument;
+}
+
+// Recompile the instrumented module, using the profile data
+// collected while running the compiled code. The resulting state
+// is not instrumented.
+// NOTE: the pointers fetched via jit_lookup() from this state must be
+// fetched again after the recompilation (the old pointers remain valid
+// as long as copies of the original state exist). This function must
+// not be invoked while the compiled code is running.
+void llvm_state::pgo_recompile()
+{
+    check_compiled(__func__);
+
+    if (m_pgo_ir.empty()) {
+        throw std::invalid_argument("Cannot recompile an llvm_state with profile data if the instrumentation was "
+                                    "not enabled before the compilation");
+    }
+
+    llvm_state tmp(std::tuple{m_module_name, m_opt_level, m_fast_math, m_save_object_code, m_inline_functions,
+                              m_cache_dir, m_n_compile_threads, m_prefer_vw512, m_target_cpu, m_target_features,
+                              m_opt_profile, m_sleef_accuracy, m_jit_listeners, m_sleef_bitcode,
+                              m_ir_snapshot_enabled});
+
+    tmp.parse_ir(m_pgo_ir);
+
+    // Fetch the counters.
+    std::map<std::string, const std::uint64_t *> counters;
+    for (const auto &gv : tmp.module().globals()) {
+        const auto name = gv.getName().str();
+
+        if (name.rfind("heyoka.pgo", 0) == 0) {
+            // NOTE: if the compiled code is an ISA variant
+            // loaded from a serialised state, the counters
+            // are not available.
+            try {
+                counters.emplace(name, reinterpret_cast<const std::uint64_t *>(jit_lookup(name)));
+            } catch (const std::invalid_argument &) {
+            }
+        }
+    }
+
+    detail::pgo_apply_profile(tmp.module(), counters);
+
+    tmp.m_variants = m_variants;
+    tmp.m_lazy_functions = m_lazy_functions;
+    tmp.m_sym_prefix = m_sym_prefix;
+
+    tmp.optimise();
+    tmp.compile();
+
+    *this = std::move(tmp);
+}
+
+void llvm_state::verify_function(const std::string &name)
+{
+    check_uncompiled(__func__);
+
+    // Lookup the function in the module.
+    auto f = m_module->getFunction(name);
+    if (f == nullptr) {
+        throw std::invalid_argument("The function '" + name + "' does not exist in the module");
+    }
+
+    // Run the actual check.
+    verify_function(f);
+}
+
+void llvm_state::optimise()
+{
+    HEYOKA_TRACE_SCOPE("optimise", this);
+
+    check_uncompiled(__func__);
+
+    // NOTE: link the external functions before anything
+    // else, so that the linked definitions are part of the
+    // cache key and of the instrumented IR.
+    if (!m_sleef_bitcode.empty()) {
+        link_sleef_bitcode();
+    }
 
-        err.print("", ostr);
+    m_stats.n_ir_instructions = detail::count_instructions(*m_module);
 
-        throw std::invalid_argument("Error parsing the IR while copying an llvm_state. The full error message:\n"
-                                    + ostr.str());
+    // Store the instrumented IR before optimising, so that
+    // it can be later recompiled with the profile data.
+    if (m_pgo_instrument && m_pgo_ir.empty()) {
+        m_pgo_ir = get_ir();
     }
 
-    // Create a new builder for the module.
-    m_builder = std::make_unique<ir_builder>(context());
+    detail::time_accumulator ta(m_stats.opt_time);
 
-    if (m_fast_math) {
-        // Set flags for faster math at the
-        // price of potential change of semantics.
-        llvm::FastMathFlags fmf;
-        fmf.setFast();
-        m_builder->setFastMathFlags(fmf);
+    if (!m_cache_dir.empty()) {
+        // Check if the object code for the current
+        // module is in the cache. If it is, there's
+        // no need to run the optimisation passes.
+        cache_lookup();
+
+        if (m_cache_hit) {
+            return;
+        }
+    }
+
+    if (m_n_compile_threads > 1u) {
+        // Optimise the module in parallel.
+        parallel_optimise();
     } else {
-        // By default, allow only fp contraction.
-        // NOTE: if we ever implement double-double
-        // arithmetic, we must either revisit this
-        // or make sure that fp contraction is off
-        // for the double-double primitives.
-        llvm::FastMathFlags fmf;
-        fmf.setAllowContract();
-        m_builder->setFastMathFlags(fmf);
+        detail::optimise_module(*m_module, *m_jitter->m_tm, m_opt_level, m_inline_functions, m_prefer_vw512,
+                                m_opt_profile);
+    }
+}
+
+void llvm_state::compile()
+{
+    HEYOKA_TRACE_SCOPE("compile", this);
+
+    check_uncompiled(__func__);
+
+    // Run a verification on the module before compiling.
+    {
+        std::string out;
+        llvm::raw_string_ostream ostr(out);
+
+        if (llvm::verifyModule(*m_module, &ostr)) {
+            using namespace fmt::literals;
+
+            throw std::runtime_error(
+                "The verification of the module '{}' produced an error:\n{}"_format(m_module_name, ostr.str()));
+        }
+    }
+
+    // Store a snapshot of the IR before compiling.
+    // NOTE: the snapshot is stored in bitcode format, which
+    // is much faster to create and more compact than the
+    // textual IR (see get_ir()).
+    if (m_ir_snapshot_enabled) {
+        m_ir_snapshot = std::make_shared<const std::string>(detail::module_to_bitcode(*m_module));
+    } else {
+        m_ir_dropped = true;
+    }
+    m_stats.n_opt_ir_instructions = detail::count_instructions(*m_module);
+
+    // NOTE: if optimise() was not invoked, the
+    // instrumented IR is the unoptimised IR.
+    if (m_pgo_instrument && m_pgo_ir.empty()) {
+        m_pgo_ir = get_ir();
+    }
+
+    // Look up the object code in the cache, if
+    // this was not done already in optimise().
+    // NOTE: if the module was altered after optimise(),
+    // the cache key is not updated.
+    if (!m_cache_dir.empty() && m_cache_key.empty()) {
+        cache_lookup();
+    }
+
+    if (m_cache_hit) {
+        // Cache hit: add the cached object code
+        // to the jit, skipping codegen.
+        {
+            detail::time_accumulator ta(m_stats.link_time);
+            m_jitter->add_object(m_cached_object);
+        }
+        m_stats.object_size = m_cached_object.size();
+
+        // NOTE: keep the object code around, so that
+        // it is available when serialising.
+        m_object_code = std::move(m_cached_object);
+        m_cached_object.clear();
+
+        m_module.reset();
+
+        return;
+    }
+
+    // NOTE: we need to store the object code if
+    // requested, if the cache is enabled or if the IR
+    // snapshot is disabled (so that the state can still
+    // be copied and serialised).
+    const auto store_obj = m_save_object_code || !m_cache_dir.empty() || !m_ir_snapshot_enabled;
+
+    if (!store_obj && !m_lazy_functions.empty()) {
+        // Move the lazy functions into a separate module,
+        // which will be compiled upon the first lookup
+        // of any of them.
+        // NOTE: laziness requires the object code not to be
+        // stored, as the stored object code must contain
+        // all the functions in the module.
+        auto lazy_bc = detail::extract_functions(*m_module, m_lazy_functions);
+
+        if (!lazy_bc.empty()) {
+            m_jitter->set_lazy(m_lazy_functions, std::move(lazy_bc));
+        }
+    }
+
+    if (!store_obj && m_n_compile_threads > 1u) {
+        // NOTE: parallel codegen produces multiple object files,
+        // thus we use it only if we don't need to store the object code.
+        parallel_compile();
+
+        return;
+    }
+
+    // NOTE: run the codegen here rather than lazily
+    // in the jit, so that it can be timed separately
+    // from the linking.
+    std::string obj;
+    {
+        detail::time_accumulator ta(m_stats.codegen_time);
+        obj = emit_object_code();
+    }
+    m_stats.object_size = obj.size();
+
+    if (!m_cache_dir.empty()) {
+        cache_store(obj);
+    }
+
+    {
+        detail::time_accumulator ta(m_stats.link_time);
+        m_jitter->add_object(obj);
     }
 
-    // Run the compilation if other was compiled.
-    if (!other.m_module) {
-        compile();
+    if (store_obj) {
+        m_object_code = std::move(obj);
     }
+
+    m_module.reset();
 }
 
-llvm_state::llvm_state(llvm_state &&) noexcept = default;
+// Compute the cache key for the current module. The key
+// contains the version of heyoka and LLVM, the properties of the
+// host CPU, the optimisation flags and the IR of the module.
+// The IR encodes the decomposition, the floating-point types
+// and the batch size of the functions in the module.
+std::string llvm_state::get_cache_key() const
+{
+    std::ostringstream oss;
+    oss << std::boolalpha;
 
-llvm_state &llvm_state::operator=(const llvm_state &other)
+    oss << "heyoka " << HEYOKA_VERSION_STRING << '\n';
+    oss << "LLVM " << LLVM_VERSION_STRING << '\n';
+    oss << m_jitter->get_target_triple().str() << '\n';
+    oss << m_jitter->get_target_cpu() << '\n';
+    oss << m_jitter->get_target_features() << '\n';
+    oss << m_opt_level << '\n';
+    oss << m_fast_math << '\n';
+    oss << m_inline_functions << '\n';
+    oss << m_prefer_vw512 << '\n';
+    oss << m_opt_profile << '\n';
+    oss << m_sleef_accuracy << '\n';
+    oss << m_sleef_bitcode << '\n';
+    oss << get_ir();
+
+    return oss.str();
+}
+
+// The path of the cache file for the current cache key.
+std::string llvm_state::get_cache_path() const
 {
-    if (this != &other) {
-        *this = llvm_state(other);
+    assert(!m_cache_key.empty());
+
+    using namespace fmt::literals;
+
+    const auto fname = "heyoka_{:016x}.o"_format(std::hash<std::string>{}(m_cache_key));
+
+    return (boost::filesystem::path{m_cache_dir} / fname).string();
+}
+
+// Look up the current module in the cache.
+// NOTE: the cache files contain the size of the key, the key
+// itself and the object code. The stored key is compared
+// to the current one in order to detect hash collisions.
+void llvm_state::cache_lookup()
+{
+    m_cache_key = get_cache_key();
+    m_cache_hit = false;
+    m_cached_object.clear();
+
+    std::ifstream ifile(get_cache_path(), std::ios::binary);
+    if (!ifile) {
+        return;
     }
 
-    return *this;
+    std::string contents{std::istreambuf_iterator<char>(ifile), std::istreambuf_iterator<char>()};
+    if (ifile.bad()) {
+        return;
+    }
+
+    const auto nl_pos = contents.find('\n');
+    if (nl_pos == std::string::npos) {
+        return;
+    }
+
+    std::size_t key_size = 0;
+    try {
+        key_size = boost::lexical_cast<std::size_t>(contents.substr(0, nl_pos));
+    } catch (const boost::bad_lexical_cast &) {
+        return;
+    }
+
+    if (contents.size() - (nl_pos + 1u) < key_size
+        || contents.compare(nl_pos + 1u, key_size, m_cache_key) != 0) {
+        // Corrupted file or hash collision.
+        return;
+    }
+
+    m_cached_object = contents.substr(nl_pos + 1u + key_size);
+    m_cache_hit = !m_cached_object.empty();
 }
 
-llvm_state &llvm_state::operator=(llvm_state &&) noexcept = default;
+// Store the object code obj in the cache.
+// NOTE: the cache is a best-effort optimisation, thus
+// failures in writing the cache file are ignored.
+void llvm_state::cache_store(const std::string &obj) const
+{
+    namespace fs = boost::filesystem;
 
-llvm_state::~llvm_state() = default;
+    try {
+        const fs::path cache_path{get_cache_path()};
 
-llvm::Module &llvm_state::module()
+        fs::create_directories(cache_path.parent_path());
+
+        // Write first to a temporary file, which is then renamed,
+        // so that concurrent readers never see partial files.
+        const auto tmp_path = cache_path.parent_path() / fs::unique_path("heyoka_tmp_%%%%-%%%%-%%%%-%%%%");
+
+        {
+            std::ofstream ofile(tmp_path.string(), std::ios::binary | std::ios::trunc);
+            ofile << m_cache_key.size() << '\n' << m_cache_key;
+            ofile.write(obj.data(), static_cast<std::streamsize>(obj.size()));
+
+            if (!ofile) {
+                ofile.close();
+                fs::remove(tmp_path);
+
+                return;
+            }
+        }
+
+        fs::rename(tmp_path, cache_path);
+    } catch (...) {
+    }
+}
+
+bool llvm_state::is_compiled() const
 {
-    check_uncompiled(__func__);
-    return *m_module;
+    return !m_module;
 }
 
-ir_builder &llvm_state::builder()
+// NOTE: this function will lookup symbol names,
+// so it does not necessarily return a function
+// pointer (could be, e.g., a global variable).
+// NOTE: the jit links the object code lazily
+// upon symbol lookup, thus the time spent here
+// is accounted as linking time.
+std::uintptr_t llvm_state::jit_lookup(const std::string &name)
+{
+    check_compiled(__func__);
+
+    detail::time_accumulator ta(m_stats.link_time);
+
+    auto sym = m_jitter->lookup(m_sym_prefix + name);
+    if (!sym) {
+        throw std::invalid_argument("Could not find the symbol '" + m_sym_prefix + name
+                                    + "' in the compiled module");
+    }
+
+    return static_cast<std::uintptr_t>((*sym).getAddress());
+}
+
+std::string llvm_state::get_ir() const
+{
+    if (m_module) {
+        // The module has not been compiled yet,
+        // get the IR from it.
+        std::string out;
+        llvm::raw_string_ostream ostr(out);
+        m_module->print(ostr, nullptr);
+        return ostr.str();
+    } else {
+        // The module has been compiled. Re-create
+        // the IR from the snapshot that was created
+        // before the compilation.
+        check_ir_snapshot(__func__);
+
+        return detail::ir_snapshot_str(m_ir_snapshot, m_module_name);
+    }
+}
+
+void llvm_state::dump_object_code(const std::string &filename) const
+{
+    const auto compiled = !m_module;
+
+    if (compiled && !m_save_object_code) {
+        throw std::invalid_argument("Cannot dump the object code after compilation if the 'save_object_code' "
+                                    "keyword argument was not set to true when constructing the llvm_state object");
+    }
+
+    std::error_code ec;
+    llvm::raw_fd_ostream dest(filename, ec, llvm::sys::fs::OF_None);
+
+    if (ec) {
+        throw std::invalid_argument("Could not open the file '" + filename
+                                    + "' for dumping object code. The full error message:\n" + ec.message());
+    }
+
+    if (compiled) {
+        // The module has been compiled already, dump the saved
+        // object code image.
+        dest << m_object_code;
+    } else {
+        // The module has not been compiled yet, run the JIT
+        // and dump the object code.
+        llvm::legacy::PassManager pass;
+
+        if (m_jitter->m_tm->addPassesToEmitFile(pass, dest, nullptr, llvm::CGFT_ObjectFile)) {
+            // Close and remove the file before throwing.
+            dest.close();
+            boost::filesystem::remove(boost::filesystem::path{filename});
+
+            throw std::invalid_argument("The target machine can't emit a file of this type");
+        }
+
+        pass.run(*m_module);
+    }
+}
+
+const std::string &llvm_state::get_object_code() const
+{
+    return m_object_code;
+}
+
+// NOTE: the memory used by the LLVM data structures of a
+// non-compiled module is not accounted for.
+llvm_state_memory_usage llvm_state::memory_usage() const
+{
+    llvm_state_memory_usage retval;
+
+    retval.ir_snapshot = m_ir_snapshot ? m_ir_snapshot->size() : 0u;
+    retval.object_code = m_object_code.size() + m_cached_object.size();
+    for (const auto &v : m_variants) {
+        retval.variants += v.cpu.size() + v.features.size() + v.eff_features.size() + v.ir.size() + v.obj.size();
+    }
+    retval.pgo_ir = m_pgo_ir.size();
+    if (is_compiled()) {
+        retval.jit_code = static_cast<std::size_t>(m_stats.object_size);
+    }
+
+    return retval;
+}
+
+// Drop the IR snapshot of a compiled state, in order to reduce
+// its memory footprint. Afterwards, get_ir() will throw, and
+// deep_copy() (and thus the copies of the integrators in compact mode)
+// and save() will work only if the object code was saved during
+// compilation (see the 'save_object_code' keyword argument).
+void llvm_state::drop_ir_snapshot()
+{
+    check_compiled(__func__);
+
+    m_ir_snapshot.reset();
+    m_ir_dropped = true;
+}
+
+bool llvm_state::ir_snapshot_dropped() const
+{
+    return m_ir_dropped;
+}
+
+// Add to the jit the object code stored in the file filename
+// (e.g., produced by dump_object_code()), in place of compiling
+// the current module. After this operation, the state is compiled.
+// NOTE: the file is memory-mapped (if large enough) and
+// handed over to the jit linker without intermediate copies.
+// The object code is copied only if save_object_code is true
+// (or if the IR snapshot is disabled), so that it can be serialised.
+void llvm_state::load_object_code(const std::string &filename)
 {
     check_uncompiled(__func__);
-    return *m_builder;
+
+    // NOTE: the null terminator is not required, so that
+    // the file can be mapped whatever its size.
+#if LLVM_VERSION_MAJOR >= 13
+    auto mb = llvm::MemoryBuffer::getFile(filename, false, false);
+#else
+    auto mb = llvm::MemoryBuffer::getFile(filename, -1, false);
+#endif
+
+    if (!mb) {
+        throw std::invalid_argument("Could not open the file '" + filename
+                                    + "' for loading object code. The full error message:\n"
+                                    + mb.getError().message());
+    }
+
+    // Store a snapshot of the IR before compiling.
+    if (m_ir_snapshot_enabled) {
+        m_ir_snapshot = std::make_shared<const std::string>(detail::module_to_bitcode(*m_module));
+    } else {
+        m_ir_dropped = true;
+    }
+
+    m_stats.object_size = (*mb)->getBufferSize();
+
+    if (m_save_object_code || !m_ir_snapshot_enabled) {
+        m_object_code = (*mb)->getBuffer().str();
+    }
+
+    {
+        detail::time_accumulator ta(m_stats.link_time);
+        m_jitter->add_object(std::move(*mb));
+    }
+
+    m_module.reset();
 }
 
-llvm::LLVMContext &llvm_state::context()
+// Create a copy of the current state with its own jit. If the
+// current state is compiled and its object code is available, the
+// object code is added to the new jit. Otherwise, the module is
+// re-created from the IR and (if the current state is compiled)
+// re-compiled.
+llvm_state llvm_state::deep_copy() const
 {
-    return m_jitter->get_context();
+    if (is_compiled() && !m_object_code.empty()) {
+        llvm_state retval(std::tuple{m_module_name, m_opt_level, m_fast_math, m_save_object_code, m_inline_functions,
+                                     m_cache_dir, m_n_compile_threads, m_prefer_vw512, m_target_cpu,
+                                     m_target_features, m_opt_profile, m_sleef_accuracy, m_jit_listeners,
+                                     m_sleef_bitcode, m_ir_snapshot_enabled});
+
+        {
+            detail::time_accumulator ta(retval.m_stats.link_time);
+            retval.m_jitter->add_object(m_object_code);
+        }
+        retval.m_stats.object_size = m_object_code.size();
+        retval.m_module.reset();
+
+        retval.m_ir_snapshot = m_ir_snapshot;
+        retval.m_object_code = m_object_code;
+        retval.m_variants = m_variants;
+        retval.m_lazy_functions = m_lazy_functions;
+        retval.m_pgo_instrument = m_pgo_instrument;
+        retval.m_pgo_ir = m_pgo_ir;
+        retval.m_ir_dropped = m_ir_dropped;
+        retval.m_sym_prefix = m_sym_prefix;
+
+        return retval;
+    }
+
+    check_ir_snapshot(__func__);
+
+    auto retval = uncompiled_copy();
+
+    // Run the compilation if this was compiled.
+    if (is_compiled()) {
+        retval.compile();
+    }
+
+    return retval;
 }
 
-unsigned &llvm_state::opt_level()
+llvm_state llvm_state::uncompiled_copy() const
 {
-    return m_opt_level;
+    check_ir_snapshot(__func__);
+
+    llvm_state retval(
+        std::tuple{m_module_name, m_opt_level, m_fast_math, m_save_object_code, m_inline_functions, m_cache_dir,
+                   m_n_compile_threads, m_prefer_vw512, m_target_cpu, m_target_features, m_opt_profile,
+                   m_sleef_accuracy, m_jit_listeners, m_sleef_bitcode, m_ir_snapshot_enabled});
+
+    // NOTE: the module is moved across contexts via bitcode,
+    // so that the textual IR does not need to be created.
+    retval.parse_bitcode(m_module ? detail::module_to_bitcode(*m_module) : *m_ir_snapshot);
+
+    retval.m_object_code = m_object_code;
+    retval.m_variants = m_variants;
+    retval.m_lazy_functions = m_lazy_functions;
+    retval.m_pgo_instrument = m_pgo_instrument;
+    retval.m_pgo_ir = m_pgo_ir;
+    retval.m_sym_prefix = m_sym_prefix;
+
+    return retval;
 }
 
-bool &llvm_state::fast_math()
+// Create an empty state with the same settings as this,
+// but targeting the CPU cpu with the features 'features'.
+// The code for the variant is expected to be added to the
+// returned state, which is then compiled and passed to add_variant().
+llvm_state llvm_state::make_variant(const std::string &cpu, const std::string &features) const
 {
-    return m_fast_math;
+    return llvm_state(std::tuple{m_module_name, m_opt_level, m_fast_math, m_save_object_code, m_inline_functions,
+                                 m_cache_dir, m_n_compile_threads, m_prefer_vw512, cpu, features, m_opt_profile,
+                                 m_sleef_accuracy, m_jit_listeners, m_sleef_bitcode, m_ir_snapshot_enabled});
 }
 
-bool &llvm_state::inline_functions()
+// Add the compiled code of v as an ISA variant of the
+// code in this. The variants are not used by this, they are
+// carried along in copies and saved together with this. When
+// loading a state, the best variant which can be run on
+// the host machine is selected (see load()).
+// NOTE: it is up to the user to ensure that v contains
+// the same functions as this.
+void llvm_state::add_variant(const llvm_state &v)
 {
-    return m_inline_functions;
+    if (!v.is_compiled()) {
+        throw std::invalid_argument("Cannot add a non-compiled llvm_state as an ISA variant");
+    }
+
+    if (v.m_ir_dropped) {
+        throw std::invalid_argument("Cannot add an llvm_state whose IR snapshot was dropped as an ISA variant");
+    }
+
+    if (v.m_jitter->get_target_triple() != m_jitter->get_target_triple()) {
+        throw std::invalid_argument("Cannot add an ISA variant compiled for the target triple '"
+                                    + v.m_jitter->get_target_triple().str() + "' to an llvm_state with target triple '"
+                                    + m_jitter->get_target_triple().str() + "'");
+    }
+
+    m_variants.push_back(isa_variant{v.m_target_cpu, v.m_target_features, v.m_jitter->get_effective_features(),
+                                     v.get_ir(), v.get_compiled_object_code()});
+}
+
+std::size_t llvm_state::get_n_variants() const
+{
+    return m_variants.size();
 }
 
-const llvm::Module &llvm_state::module() const
-{
-    check_uncompiled(__func__);
-    return *m_module;
+// Replace the module with the one
+// resulting from parsing the IR ir.
+void llvm_state::parse_ir(const std::string &ir)
+{
+    // Create the corresponding memory buffer.
+    auto mb = llvm::MemoryBuffer::getMemBuffer(ir);
+
+    // Construct a new module from the parsed IR.
+    llvm::SMDiagnostic err;
+    auto m = llvm::parseIR(*mb, err, context());
+    if (!m) {
+        std::string err_report;
+        llvm::raw_string_ostream ostr(err_report);
+
+        err.print("", ostr);
+
+        throw std::invalid_argument("Error parsing the IR of an llvm_state. The full error message:\n" + ostr.str());
+    }
+
+    m_module = std::move(m);
 }
 
-const ir_builder &llvm_state::builder() const
+// Replace the module with the one
+// resulting from parsing the bitcode bc.
+void llvm_state::parse_bitcode(const std::string &bc)
 {
-    check_uncompiled(__func__);
-    return *m_builder;
-}
+    auto m = detail::bitcode_to_module(bc, context());
+    m->setModuleIdentifier(m_module_name);
 
-const llvm::LLVMContext &llvm_state::context() const
-{
-    return m_jitter->get_context();
+    m_module = std::move(m);
 }
 
-const unsigned &llvm_state::opt_level() const
+// Run codegen on the module and return the object code.
+std::string llvm_state::emit_object_code()
 {
-    return m_opt_level;
-}
+    assert(m_module);
 
-const bool &llvm_state::fast_math() const
-{
-    return m_fast_math;
+    return detail::emit_object_code(*m_module, *m_jitter->m_tm);
 }
 
-const bool &llvm_state::inline_functions() const
+// Parallel optimisation: the module is split into
+// partitions which are optimised concurrently (each one
+// in its own LLVM context), and then linked back together.
+// NOTE: this prevents inlining across partitions.
+void llvm_state::parallel_optimise()
 {
-    return m_inline_functions;
+    assert(m_module);
+    assert(m_n_compile_threads > 1u);
+
+    auto parts = detail::split_module(std::move(m_module), m_n_compile_threads);
+
+    // NOTE: create the target machines in the current thread.
+    std::vector<std::unique_ptr<llvm::TargetMachine>> tms;
+    for (decltype(parts.size()) i = 0; i < parts.size(); ++i) {
+        tms.push_back(m_jitter->create_target_machine());
+    }
+
+    detail::parallel_run(parts.size(), [&](std::size_t i) {
+        llvm::LLVMContext ctx;
+
+        auto m = detail::bitcode_to_module(parts[i], ctx);
+        detail::optimise_module(*m, *tms[i], m_opt_level, m_inline_functions, m_prefer_vw512, m_opt_profile);
+        parts[i] = detail::module_to_bitcode(*m);
+    });
+
+    // Link the optimised partitions into a new module.
+    m_module = std::make_unique<llvm::Module>(m_module_name, context());
+    m_module->setDataLayout(m_jitter->get_data_layout());
+    m_module->setTargetTriple(m_jitter->get_target_triple().str());
+
+    for (const auto &bc : parts) {
+        if (llvm::Linker::linkModules(*m_module, detail::bitcode_to_module(bc, context()))) {
+            throw std::invalid_argument("Error linking the optimised partitions of the module '" + m_module_name
+                                        + "'");
+        }
+    }
 }
 
-void llvm_state::check_uncompiled(const char *f) const
+// Link into the module the definitions of the external functions
+// which are declared in the module and provided by the bitcode file
+// m_sleef_bitcode. The linked definitions are internalised, so that
+// the optimisation passes can inline (and specialise) them and then
+// drop the unused ones.
+// NOTE: a definition is inlined only if the target features of the
+// caller are a superset of those of the definition (e.g., the AVX2
+// SLEEF functions are not inlined when targeting a CPU without AVX2).
+void llvm_state::link_sleef_bitcode()
 {
-    if (!m_module) {
-        throw std::invalid_argument(std::string{"The function '"} + f
-                                    + "' can be invoked only if the module has not been compiled yet");
+    assert(m_module);
+
+#if LLVM_VERSION_MAJOR >= 13
+    auto mb = llvm::MemoryBuffer::getFile(m_sleef_bitcode, false, false);
+#else
+    auto mb = llvm::MemoryBuffer::getFile(m_sleef_bitcode, -1, false);
+#endif
+
+    if (!mb) {
+        throw std::invalid_argument("Could not open the bitcode file '" + m_sleef_bitcode
+                                    + "'. The full error message:\n" + mb.getError().message());
+    }
+
+    // NOTE: parseIR() accepts both bitcode and textual IR.
+    llvm::SMDiagnostic err;
+    auto src = llvm::parseIR((*mb)->getMemBufferRef(), err, context());
+    if (!src) {
+        std::string err_report;
+        llvm::raw_string_ostream ostr(err_report);
+        err.print("", ostr);
+
+        throw std::invalid_argument("Error parsing the bitcode file '" + m_sleef_bitcode
+                                    + "'. The full error message:\n" + ostr.str());
+    }
+
+    // NOTE: the bitcode is assumed to be compatible with
+    // the host, make the data layout and the triple match
+    // those of the module in order to avoid warnings from the linker.
+    src->setDataLayout(m_module->getDataLayout());
+    src->setTargetTriple(m_module->getTargetTriple());
+
+    // NOTE: with LinkOnlyNeeded, only the definitions of the functions
+    // declared in the module (and their dependencies) are linked.
+    if (llvm::Linker::linkModules(*m_module, std::move(src), llvm::Linker::Flags::LinkOnlyNeeded,
+                                  [](llvm::Module &m, const llvm::StringSet<> &linked) {
+                                      llvm::internalizeModule(m, [&linked](const llvm::GlobalValue &gv) {
+                                          return !gv.hasName() || linked.count(gv.getName()) == 0u;
+                                      });
+                                  })) {
+        throw std::invalid_argument("Error linking the bitcode file '" + m_sleef_bitcode + "' into the module '"
+                                    + m_module_name + "'");
     }
 }
 
-void llvm_state::check_compiled(const char *f) const
+// Parallel codegen: the module is split into partitions
+// whose object code is generated concurrently. The object
+// files are then added to the jit.
+void llvm_state::parallel_compile()
 {
-    if (m_module) {
-        throw std::invalid_argument(std::string{"The function '"} + f
-                                    + "' can be invoked only after the module has been compiled");
+    assert(m_module);
+    assert(m_n_compile_threads > 1u);
+
+    std::vector<std::string> parts;
+
+    {
+        detail::time_accumulator ta(m_stats.codegen_time);
+
+        parts = detail::split_module(std::move(m_module), m_n_compile_threads);
+
+        std::vector<std::unique_ptr<llvm::TargetMachine>> tms;
+        for (decltype(parts.size()) i = 0; i < parts.size(); ++i) {
+            tms.push_back(m_jitter->create_target_machine());
+        }
+
+        detail::parallel_run(parts.size(), [&](std::size_t i) {
+            llvm::LLVMContext ctx;
+
+            auto m = detail::bitcode_to_module(parts[i], ctx);
+            parts[i] = detail::emit_object_code(*m, *tms[i]);
+        });
+    }
+
+    detail::time_accumulator ta(m_stats.link_time);
+
+    m_stats.object_size = 0;
+    for (const auto &obj : parts) {
+        m_stats.object_size += obj.size();
+        m_jitter->add_object(obj);
     }
 }
 
-void llvm_state::verify_function(llvm::Function *f)
+// Fetch the object code of a compiled state.
+std::string llvm_state::get_compiled_object_code() const
 {
-    check_uncompiled(__func__);
+    assert(is_compiled());
+
+    if (m_object_code.empty()) {
+        // The object code was not saved during compilation,
+        // re-create it from the IR snapshot.
+        if (m_ir_dropped) {
+            throw std::invalid_argument("The object code of an llvm_state whose IR snapshot was dropped is available "
+                                        "only if the 'save_object_code' keyword argument was set to true when "
+                                        "constructing the llvm_state object");
+        }
 
-    if (f == nullptr) {
-        throw std::invalid_argument("Cannot verify a null function pointer");
-    }
+        llvm_state tmp(std::tuple{m_module_name, m_opt_level, m_fast_math, false, m_inline_functions, std::string{},
+                                  1u, m_prefer_vw512, m_target_cpu, m_target_features, m_opt_profile,
+                                  m_sleef_accuracy, jit_listener::none, m_sleef_bitcode, true});
+        tmp.parse_bitcode(*m_ir_snapshot);
 
-    std::string err_report;
-    llvm::raw_string_ostream ostr(err_report);
-    if (llvm::verifyFunction(*f, &ostr)) {
-        // Remove function before throwing.
-        const auto fname = std::string(f->getName());
-        f->eraseFromParent();
-        throw std::invalid_argument("The verification of the function '" + fname + "' failed. The full error message:\n"
-                                    + ostr.str());
+        return tmp.emit_object_code();
+    } else {
+        return m_object_code;
     }
 }
 
-void llvm_state::verify_function(const std::string &name)
+// Binary serialisation. A compiled state is saved together with its
+// object code (and the properties of the target machine), so that
+// it can be restored without re-compiling. The ISA variants (if any)
+// are saved after the main code.
+void llvm_state::save(std::ostream &os) const
 {
-    check_uncompiled(__func__);
+    detail::bin_save(os, m_module_name);
+    detail::bin_save(os, m_opt_level);
+    detail::bin_save(os, m_fast_math);
+    detail::bin_save(os, m_save_object_code);
+    detail::bin_save(os, m_inline_functions);
+    detail::bin_save(os, m_cache_dir);
+    detail::bin_save(os, m_n_compile_threads);
+    detail::bin_save(os, m_prefer_vw512);
+    detail::bin_save(os, m_target_cpu);
+    detail::bin_save(os, m_target_features);
+    detail::bin_save(os, m_opt_profile);
+    detail::bin_save(os, m_sleef_accuracy);
+    detail::bin_save(os, m_jit_listeners);
+    detail::bin_save(os, m_sleef_bitcode);
+    detail::bin_save(os, m_ir_snapshot_enabled);
+
+    const auto compiled = is_compiled();
+    detail::bin_save(os, compiled);
 
-    // Lookup the function in the module.
-    auto f = m_module->getFunction(name);
-    if (f == nullptr) {
-        throw std::invalid_argument("The function '" + name + "' does not exist in the module");
+    if (compiled) {
+        detail::bin_save(os, m_jitter->get_target_triple().str());
+        detail::bin_save(os, m_jitter->get_target_cpu());
+        detail::bin_save(os, m_jitter->get_effective_features());
+        detail::bin_save(os, m_ir_dropped ? std::string{} : get_ir());
+        detail::bin_save(os, get_compiled_object_code());
+    } else {
+        detail::bin_save(os, get_ir());
     }
 
-    // Run the actual check.
-    verify_function(f);
+    // Save the ISA variants.
+    detail::bin_save(os, static_cast<std::uint64_t>(m_variants.size()));
+    for (const auto &v : m_variants) {
+        detail::bin_save(os, v.cpu);
+        detail::bin_save(os, v.features);
+        detail::bin_save(os, v.eff_features);
+        detail::bin_save(os, v.ir);
+        detail::bin_save(os, v.obj);
+    }
+
+    detail::bin_save(os, m_lazy_functions);
+    detail::bin_save(os, m_pgo_instrument);
+    detail::bin_save(os, m_pgo_ir);
+    detail::bin_save(os, m_ir_dropped);
+    detail::bin_save(os, m_sym_prefix);
+
+    if (!os) {
+        throw std::invalid_argument("Error writing an llvm_state to an output stream");
+    }
 }
 
-void llvm_state::optimise()
+void llvm_state::load(std::istream &is)
 {
-    check_uncompiled(__func__);
+    std::string mod_name, c_dir, t_cpu, t_features, s_bc;
+    unsigned opt_level = 0, n_compile_threads = 0;
+    bool fmath = false, socode = false, i_func = false, vw512 = false, ir_snap = false, compiled = false;
+    auto o_profile = opt_profile::standard;
+    auto s_acc = sleef_accuracy::u10;
+    auto jit_ls = jit_listener::none;
+
+    detail::bin_load(is, mod_name);
+    detail::bin_load(is, opt_level);
+    detail::bin_load(is, fmath);
+    detail::bin_load(is, socode);
+    detail::bin_load(is, i_func);
+    detail::bin_load(is, c_dir);
+    detail::bin_load(is, n_compile_threads);
+    detail::bin_load(is, vw512);
+    detail::bin_load(is, t_cpu);
+    detail::bin_load(is, t_features);
+    detail::bin_load(is, o_profile);
+    detail::bin_load(is, s_acc);
+    detail::bin_load(is, jit_ls);
+    detail::bin_load(is, s_bc);
+    detail::bin_load(is, ir_snap);
+    detail::bin_load(is, compiled);
+
+    std::string triple, cpu, features, ir, obj;
 
-    if (m_opt_level > 0u) {
-        // NOTE: the logic here largely mimics (with a lot of simplifications)
-        // the implementation of the 'opt' tool. See:
-        // https://github.com/llvm/llvm-project/blob/release/10.x/llvm/tools/opt/opt.cpp
+    if (compiled) {
+        detail::bin_load(is, triple);
+        detail::bin_load(is, cpu);
+        detail::bin_load(is, features);
+        detail::bin_load(is, ir);
+        detail::bin_load(is, obj);
+    } else {
+        detail::bin_load(is, ir);
+    }
 
-        // For every function in the module, setup its attributes
-        // so that the codegen uses all the features available on
-        // the host CPU.
-#if LLVM_VERSION_MAJOR == 10
-        ::setFunctionAttributes(m_jitter->get_target_cpu(), m_jitter->get_target_features(), *m_module);
-#else
-        // NOTE: in LLVM > 10, the setFunctionAttributes() function is gone in favour of another
-        // function in another namespace, which however does not seem to work out of the box
-        // because (I think) it might be reading some non-existent command-line options. See:
-        // https://llvm.org/doxygen/CommandFlags_8cpp_source.html#l00552
-        // Here we are reproducing a trimmed-down version of the same function.
-        const auto cpu = m_jitter->get_target_cpu();
-        const auto features = m_jitter->get_target_features();
+    std::uint64_t n_variants = 0;
+    detail::bin_load(is, n_variants);
+
+    // NOTE: don't reserve() based on the size read from
+    // the stream, as it could be garbage.
+    std::vector<isa_variant> variants;
+    for (std::uint64_t i = 0; i < n_variants; ++i) {
+        variants.emplace_back();
+        auto &v = variants.back();
+
+        detail::bin_load(is, v.cpu);
+        detail::bin_load(is, v.features);
+        detail::bin_load(is, v.eff_features);
+        detail::bin_load(is, v.ir);
+        detail::bin_load(is, v.obj);
+    }
 
-        for (auto &f : module()) {
-            auto attrs = f.getAttributes();
-            llvm::AttrBuilder new_attrs;
+    std::vector<std::string> lazy_functions;
+    detail::bin_load(is, lazy_functions);
 
-            if (!cpu.empty() && !f.hasFnAttribute("target-cpu")) {
-                new_attrs.addAttribute("target-cpu", cpu);
-            }
+    bool pgo_inst = false, ir_dropped = false;
+    std::string pgo_ir;
+    detail::bin_load(is, pgo_inst);
+    detail::bin_load(is, pgo_ir);
+    detail::bin_load(is, ir_dropped);
 
-            if (!features.empty()) {
-                auto old_features = f.getFnAttribute("target-features").getValueAsString();
+    std::string sym_prefix;
+    detail::bin_load(is, sym_prefix);
 
-                if (old_features.empty()) {
-                    new_attrs.addAttribute("target-features", features);
-                } else {
-                    llvm::SmallString<256> appended(old_features);
-                    appended.push_back(',');
-                    appended.append(features);
-                    new_attrs.addAttribute("target-features", appended);
-                }
-            }
+    if (!compiled) {
+        llvm_state tmp(std::tuple{std::move(mod_name), opt_level, fmath, socode, i_func, std::move(c_dir),
+                                  n_compile_threads, vw512, std::move(t_cpu), std::move(t_features), o_profile,
+                                  s_acc, jit_ls, std::move(s_bc), ir_snap});
 
-            f.setAttributes(attrs.addAttributes(context(), llvm::AttributeList::FunctionIndex, new_attrs));
-        }
-#endif
+        tmp.parse_ir(ir);
+        tmp.m_variants = std::move(variants);
+        tmp.m_lazy_functions = std::move(lazy_functions);
+        tmp.m_pgo_instrument = pgo_inst;
+        tmp.m_pgo_ir = std::move(pgo_ir);
+        tmp.m_sym_prefix = std::move(sym_prefix);
 
-        // NOTE: currently LLVM forces 256-bit vector
-        // width when AVX-512 is available, due to clock
-        // frequency scaling concerns. We used to have the following
-        // code here:
-        // for (auto &f : *m_module) {
-        //     f.addFnAttr("prefer-vector-width", "512");
-        // }
-        // in order to force 512-bit vector width, but it looks
-        // like this can hurt performance in scalar mode.
-        // Let's keep this in mind for the future, perhaps
-        // we could consider enabling 512-bit vector width
-        // only in batch mode?
+        *this = std::move(tmp);
 
-        // Init the module pass manager.
-        auto module_pm = std::make_unique<llvm::legacy::PassManager>();
-        // These are passes which set up target-specific info
-        // that are used by successive optimisation passes.
-        auto tliwp = std::make_unique<llvm::TargetLibraryInfoWrapperPass>(
-            llvm::TargetLibraryInfoImpl(m_jitter->get_target_triple()));
-        module_pm->add(tliwp.release());
-        module_pm->add(llvm::createTargetTransformInfoWrapperPass(m_jitter->get_target_ir_analysis()));
+        return;
+    }
 
-        // NOTE: not sure what this does, presumably some target-specifc
-        // configuration.
-        module_pm->add(static_cast<llvm::LLVMTargetMachine &>(*m_jitter->m_tm).createPassConfig(*module_pm));
+    // The main code is treated as the first variant.
+    variants.insert(variants.begin(), isa_variant{std::move(t_cpu), std::move(t_features), std::move(features),
+                                                  std::move(ir), std::move(obj)});
+
+    // NOTE: the object code is specific to the machine
+    // it was compiled for, make sure that it can be run
+    // on the host machine. That is, the target triple must
+    // be the same, and all the CPU features used by the object
+    // code must be available on the host CPU. Among the variants
+    // which can be run on the host machine, we pick the one
+    // with the largest number of enabled features.
+    // NOTE: the target CPU may differ from the host CPU when
+    // the object code was compiled for another machine via
+    // the target_cpu/target_features keyword arguments.
+    const auto host_triple = llvm_state{}.m_jitter->get_target_triple().str();
+    const auto host_features
+        = detail::effective_target_features(detail::host_target_features(), detail::get_target_features());
+
+    auto best = variants.end();
+    if (triple == host_triple) {
+        for (auto it = variants.begin(); it != variants.end(); ++it) {
+            if (detail::target_features_compatible(it->eff_features, host_features)
+                && (best == variants.end()
+                    || detail::rank_target_features(it->eff_features)
+                           > detail::rank_target_features(best->eff_features))) {
+                best = it;
+            }
+        }
+    }
 
-        // Init the function pass manager.
-        auto f_pm = std::make_unique<llvm::legacy::FunctionPassManager>(m_module.get());
-        f_pm->add(llvm::createTargetTransformInfoWrapperPass(m_jitter->get_target_ir_analysis()));
+    if (best == variants.end()) {
+        using namespace fmt::literals;
 
-        // Add an initial pass to vectorize load/stores.
-        // This is useful to ensure that the
-        // pattern adopted in load_vector_from_memory() and
-        // store_vector_to_memory() is translated to
-        // vectorized store/load instructions.
-        auto lsv_pass = std::unique_ptr<llvm::Pass>(llvm::createLoadStoreVectorizerPass());
-        f_pm->add(lsv_pass.release());
+        throw std::invalid_argument(
+            "Cannot load a compiled llvm_state which was created for an incompatible target machine (the target "
+            "triple/CPU of the saved state are '{}'/'{}', while the target triple/CPU of the host machine are "
+            "'{}'/'{}')"_format(triple, cpu, host_triple, llvm::sys::getHostCPUName().str()));
+    }
 
-        // We use the helper class PassManagerBuilder to populate the module
-        // pass manager with standard options.
-        llvm::PassManagerBuilder pm_builder;
-        // See here for the defaults:
-        // https://llvm.org/doxygen/PassManagerBuilder_8cpp_source.html
-        // NOTE: we used to have the SLP vectorizer on here, but
-        // we don't activate it any more in favour of explicit vectorization.
-        // NOTE: perhaps in the future we can make the autovectorizer an
-        // option like the fast math flag.
-        pm_builder.OptLevel = m_opt_level;
-        if (m_inline_functions) {
-            // Enable function inlining if the inlining flag is enabled.
-            pm_builder.Inliner = llvm::createFunctionInliningPass(m_opt_level, 0, false);
-        }
+    // NOTE: the IR snapshot of the main code may have
+    // been dropped, while the IR of the other variants is
+    // always available.
+    ir_dropped = ir_dropped && best == variants.begin();
 
-        m_jitter->m_tm->adjustPassManager(pm_builder);
+    auto chosen = std::move(*best);
+    variants.erase(best);
 
-        // Populate both the function pass manager and the module pass manager.
-        pm_builder.populateFunctionPassManager(*f_pm);
-        pm_builder.populateModulePassManager(*module_pm);
+    llvm_state tmp(std::tuple{std::move(mod_name), opt_level, fmath, socode, i_func, std::move(c_dir),
+                              n_compile_threads, vw512, std::move(chosen.cpu), std::move(chosen.features),
+                              o_profile, s_acc, jit_ls, std::move(s_bc), ir_snap});
 
-        // Run the function pass manager on all functions in the module.
-        f_pm->doInitialization();
-        for (auto &f : *m_module) {
-            f_pm->run(f);
-        }
-        f_pm->doFinalization();
+    tmp.m_jitter->add_object(chosen.obj);
+    tmp.m_stats.object_size = chosen.obj.size();
 
-        // Run the module passes.
-        module_pm->run(*m_module);
+    // NOTE: the IR snapshot is stored in bitcode format.
+    if (!ir_dropped) {
+        tmp.parse_ir(chosen.ir);
+        tmp.m_ir_snapshot = std::make_shared<const std::string>(detail::module_to_bitcode(*tmp.m_module));
     }
+    tmp.m_object_code = std::move(chosen.obj);
+    tmp.m_module.reset();
+    tmp.m_variants = std::move(variants);
+    tmp.m_lazy_functions = std::move(lazy_functions);
+    tmp.m_pgo_instrument = pgo_inst;
+    tmp.m_pgo_ir = std::move(pgo_ir);
+    tmp.m_ir_dropped = ir_dropped;
+    tmp.m_sym_prefix = std::move(sym_prefix);
+
+    *this = std::move(tmp);
 }
 
-void llvm_state::compile()
+namespace detail
 {
-    check_uncompiled(__func__);
 
-    // Run a verification on the module before compiling.
-    {
-        std::string out;
-        llvm::raw_string_ostream ostr(out);
+namespace
+{
 
-        if (llvm::verifyModule(*m_module, &ostr)) {
-            using namespace fmt::literals;
+// Helper to compute the recommended batch size for a floating-point
+// type of size fp_size (in bytes) which can be vectorised (the
+// other floating-point types are never vectorised).
+std::uint32_t recommended_batch_size_impl(std::size_t fp_size, bool vw512)
+{
+    const auto &features = get_target_features();
 
-            throw std::runtime_error(
-                "The verification of the module '{}' produced an error:\n{}"_format(m_module_name, ostr.str()));
-        }
+    // NOTE: currently, only the x86 SIMD features are detected.
+    if (features.avx512f && vw512) {
+        return static_cast<std::uint32_t>(64u / fp_size);
     }
 
-    // Store a snapshot of the IR before compiling.
-    m_ir_snapshot = get_ir();
+    if (features.avx) {
+        return static_cast<std::uint32_t>(32u / fp_size);
+    }
 
-    // Store also the object code, if requested.
-    if (m_save_object_code) {
-        // Setup a buffer+stream for dumping the object code.
-        llvm::SmallVector<char, 0> buffer;
-        llvm::raw_svector_ostream buf_stream(buffer);
+    if (features.sse2) {
+        return static_cast<std::uint32_t>(16u / fp_size);
+    }
 
-        // Setup the machinery for dumping the object code.
-        llvm::legacy::PassManager pass;
+    return 1;
+}
 
-        if (m_jitter->m_tm->addPassesToEmitFile(pass, buf_stream, nullptr, llvm::CGFT_ObjectFile)) {
-            throw std::invalid_argument("The target machine can't emit a file of this type");
-        }
+} // namespace
 
-        // Dump the object code.
-        pass.run(*m_module);
+} // namespace detail
 
-        // Copy over to m_object_code.
-        auto str_ref = buf_stream.str();
-        m_object_code.assign(str_ref.begin(), str_ref.end());
-    }
+std::uint32_t recommended_batch_size_dbl(bool vw512)
+{
+    return detail::recommended_batch_size_impl(sizeof(double), vw512);
+}
 
-    m_jitter->add_module(std::move(m_module));
+// NOTE: long double and real128 are implemented
+// in terms of scalar operations.
+std::uint32_t recommended_batch_size_ldbl(bool)
+{
+    return 1;
 }
 
-bool llvm_state::is_compiled() const
+#if defined(HEYOKA_HAVE_REAL128)
+
+std::uint32_t recommended_batch_size_f128(bool)
 {
-    return !m_module;
+    return 1;
 }
 
-// NOTE: this function will lookup symbol names,
-// so it does not necessarily return a function
-// pointer (could be, e.g., a global variable).
-std::uintptr_t llvm_state::jit_lookup(const std::string &name)
+#endif
+
+std::ostream &operator<<(std::ostream &os, const llvm_state_stats &st)
 {
-    check_compiled(__func__);
+    std::ostringstream oss;
 
-    auto sym = m_jitter->lookup(name);
-    if (!sym) {
-        throw std::invalid_argument("Could not find the symbol '" + name + "' in the compiled module");
+    oss << "Decomposition time  : " << st.decompose_time << "s\n";
+    oss << "  CSE time          : " << st.cse_time << "s\n";
+    oss << "  Sorting time      : " << st.sort_time << "s\n";
+    oss << "IR generation time  : " << st.ir_gen_time << "s\n";
+    oss << "  Segmentation time : " << st.segment_time << "s\n";
+    oss << "Optimisation time   : " << st.opt_time << "s\n";
+    oss << "Codegen time        : " << st.codegen_time << "s\n";
+    oss << "Linking time        : " << st.link_time << "s\n";
+    oss << "IR instructions     : " << st.n_ir_instructions << '\n';
+    oss << "Opt IR instructions : " << st.n_opt_ir_instructions << '\n';
+    oss << "Object code size    : " << st.object_size << '\n';
+    if (st.cm_estimate != 0u) {
+        oss << "Compact mode (auto) : " << (st.cm_selected ? "on" : "off") << " (estimated ops: " << st.cm_estimate
+            << ", threshold: " << st.cm_threshold << ")\n";
     }
 
-    return static_cast<std::uintptr_t>((*sym).getAddress());
+    return os << oss.str();
 }
 
-std::string llvm_state::get_ir() const
+std::size_t llvm_state_memory_usage::total() const
 {
-    if (m_module) {
-        // The module has not been compiled yet,
-        // get the IR from it.
-        std::string out;
-        llvm::raw_string_ostream ostr(out);
-        m_module->print(ostr, nullptr);
-        return ostr.str();
-    } else {
-        // The module has been compiled.
-        // Return the IR snapshot that
-        // was created before the compilation.
-        return m_ir_snapshot;
-    }
+    return ir_snapshot + object_code + variants + pgo_ir + jit_code;
 }
 
-void llvm_state::dump_object_code(const std::string &filename) const
+std::ostream &operator<<(std::ostream &os, const llvm_state_memory_usage &mu)
 {
-    const auto compiled = !m_module;
+    std::ostringstream oss;
 
-    if (compiled && !m_save_object_code) {
-        throw std::invalid_argument("Cannot dump the object code after compilation if the 'save_object_code' "
-                                    "keyword argument was not set to true when constructing the llvm_state object");
+    oss << "IR snapshot : " << mu.ir_snapshot << '\n';
+    oss << "Object code : " << mu.object_code << '\n';
+    oss << "ISA variants: " << mu.variants << '\n';
+    oss << "PGO IR      : " << mu.pgo_ir << '\n';
+    oss << "JIT code    : " << mu.jit_code << '\n';
+    oss << "Total       : " << mu.total() << '\n';
+
+    return os << oss.str();
+}
+
+std::ostream &operator<<(std::ostream &os, opt_profile p)
+{
+    switch (p) {
+        case opt_profile::standard:
+            os << "standard";
+            break;
+        case opt_profile::fast_compile:
+            os << "fast_compile";
+            break;
+        case opt_profile::aggressive:
+            os << "aggressive";
+            break;
+        default:
+            os << "invalid";
     }
 
-    std::error_code ec;
-    llvm::raw_fd_ostream dest(filename, ec, llvm::sys::fs::OF_None);
+    return os;
+}
 
-    if (ec) {
-        throw std::invalid_argument("Could not open the file '" + filename
-                                    + "' for dumping object code. The full error message:\n" + ec.message());
+std::ostream &operator<<(std::ostream &os, sleef_accuracy a)
+{
+    switch (a) {
+        case sleef_accuracy::u10:
+            os << "u10";
+            break;
+        case sleef_accuracy::u35:
+            os << "u35";
+            break;
+        default:
+            os << "invalid";
     }
 
-    if (compiled) {
-        // The module has been compiled already, dump the saved
-        // object code image.
-        dest << m_object_code;
-    } else {
-        // The module has not been compiled yet, run the JIT
-        // and dump the object code.
-        llvm::legacy::PassManager pass;
+    return os;
+}
 
-        if (m_jitter->m_tm->addPassesToEmitFile(pass, dest, nullptr, llvm::CGFT_ObjectFile)) {
-            // Close and remove the file before throwing.
-            dest.close();
-            boost::filesystem::remove(boost::filesystem::path{filename});
+std::ostream &operator<<(std::ostream &os, jit_listener ls)
+{
+    if (ls == jit_listener::none) {
+        return os << "none";
+    }
 
-            throw std::invalid_argument("The target machine can't emit a file of this type");
+    bool first = true;
+    for (const auto &[l, name] : {std::pair{jit_listener::gdb, "gdb"}, std::pair{jit_listener::perf_map, "perf_map"},
+                                  std::pair{jit_listener::perf_jitdump, "perf_jitdump"},
+                                  std::pair{jit_listener::intel, "intel"}}) {
+        if ((ls & l) != jit_listener::none) {
+            os << (first ? "" : "|") << name;
+            first = false;
         }
-
-        pass.run(*m_module);
     }
-}
 
-const std::string &llvm_state::get_object_code() const
-{
-    return m_object_code;
+    return os;
 }
 
 std::ostream &operator<<(std::ostream &os, const llvm_state &s)
@@ -747,10 +2791,25 @@ std::ostream &operator<<(std::ostream &os, const llvm_state &s)
     oss << "Fast math          : " << s.m_fast_math << '\n';
     oss << "Optimisation level : " << s.m_opt_level << '\n';
     oss << "Inline functions   : " << s.m_inline_functions << '\n';
+    oss << "Cache directory    : " << s.m_cache_dir << '\n';
+    oss << "Compile threads    : " << s.m_n_compile_threads << '\n';
+    oss << "512-bit vectors    : " << s.m_prefer_vw512 << '\n';
+    oss << "Profile            : " << s.m_opt_profile << '\n';
+    oss << "SLEEF accuracy     : " << s.m_sleef_accuracy << '\n';
+    oss << "JIT listeners      : " << s.m_jit_listeners << '\n';
+    oss << "SLEEF bitcode      : " << (s.m_sleef_bitcode.empty() ? "none" : s.m_sleef_bitcode) << '\n';
+    if (!s.m_sym_prefix.empty()) {
+        oss << "Symbol prefix      : " << s.m_sym_prefix << '\n';
+    }
     oss << "Target triple      : " << s.m_jitter->get_target_triple().str() << '\n';
     oss << "Target CPU         : " << s.m_jitter->get_target_cpu() << '\n';
     oss << "Target features    : " << s.m_jitter->get_target_features() << '\n';
-    oss << "IR size            : " << s.get_ir().size() << '\n';
+    oss << "ISA variants       : " << s.m_variants.size() << '\n';
+    if (s.m_ir_dropped) {
+        oss << "IR size            : dropped\n";
+    } else {
+        oss << "IR size            : " << s.get_ir().size() << '\n';
+    }
 
     return os << oss.str();
 }
@@ -0,0 +1,120 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <heyoka/config.hpp>
+
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include <boost/filesystem/operations.hpp>
+#include <boost/filesystem/path.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <heyoka/mapped_columns.hpp>
+
+namespace heyoka
+{
+
+namespace detail
+{
+
+struct mapped_columns_impl {
+    boost::interprocess::file_mapping m_fm;
+    boost::interprocess::mapped_region m_region;
+};
+
+} // namespace detail
+
+template <typename T>
+mapped_columns<T>::mapped_columns(const std::string &path, std::size_t n_cols)
+    : m_impl(std::make_unique<detail::mapped_columns_impl>()), m_n_cols(n_cols)
+{
+    namespace bip = boost::interprocess;
+
+    if (n_cols == 0u) {
+        throw std::invalid_argument("The number of columns of a mapped dataset cannot be zero");
+    }
+
+    std::size_t size = 0;
+    try {
+        size = static_cast<std::size_t>(boost::filesystem::file_size(boost::filesystem::path(path)));
+    } catch (const boost::filesystem::filesystem_error &) {
+        throw std::invalid_argument("Cannot determine the size of the dataset file '" + path + "'");
+    }
+
+    if (size % (n_cols * sizeof(T)) != 0u) {
+        throw std::invalid_argument("The size of the dataset file '" + path + "' (" + std::to_string(size)
+                                    + " bytes) is not a multiple of the size of a row of " + std::to_string(n_cols)
+                                    + " values");
+    }
+
+    m_n_points = size / (n_cols * sizeof(T));
+
+    // NOTE: empty files cannot be mapped.
+    if (m_n_points == 0u) {
+        return;
+    }
+
+    try {
+        m_impl->m_fm = bip::file_mapping(path.c_str(), bip::read_only);
+        m_impl->m_region = bip::mapped_region(m_impl->m_fm, bip::read_only);
+    } catch (const bip::interprocess_exception &) {
+        throw std::invalid_argument("Cannot map the dataset file '" + path + "'");
+    }
+
+    // NOTE: the data is read sequentially.
+    m_impl->m_region.advise(bip::mapped_region::advice_sequential);
+}
+
+template <typename T>
+mapped_columns<T>::mapped_columns(mapped_columns &&) noexcept = default;
+
+template <typename T>
+mapped_columns<T> &mapped_columns<T>::operator=(mapped_columns &&) noexcept = default;
+
+template <typename T>
+mapped_columns<T>::~mapped_columns() = default;
+
+template <typename T>
+const T *mapped_columns<T>::data() const
+{
+    return m_n_points == 0u ? nullptr : static_cast<const T *>(m_impl->m_region.get_address());
+}
+
+template <typename T>
+const T *mapped_columns<T>::column(std::size_t i) const
+{
+    if (i >= m_n_cols) {
+        throw std::invalid_argument("Cannot fetch the column " + std::to_string(i) + " of a mapped dataset with "
+                                    + std::to_string(m_n_cols) + " columns");
+    }
+
+    return m_n_points == 0u ? nullptr : data() + i * m_n_points;
+}
+
+// Explicit instantiations.
+template class mapped_columns<double>;
+template class mapped_columns<long double>;
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+template class mapped_columns<mppp::real128>;
+
+#endif
+
+} // namespace heyoka
@@ -6,8 +6,18 @@
 // Public License v. 2.0. If a copy of the MPL was not distributed
 // with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
 
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <utility>
 #include <vector>
 
+#include <fmt/format.h>
+
 #include <heyoka/expression.hpp>
 #include <heyoka/mascon.hpp>
 #include <heyoka/math.hpp>
@@ -19,15 +29,43 @@ namespace detail
 
 {
 
+// Assemble the system from the contributions to the x/y/z accelerations
+// due to the asteroid and from the angular velocity of the asteroid.
+std::vector<std::pair<expression, expression>>
+mascon_assemble_system(std::vector<expression> x_acc, std::vector<expression> y_acc, std::vector<expression> z_acc,
+                       const expression &pe, const expression &qe, const expression &re)
+{
+    std::vector<std::pair<expression, expression>> retval;
+    auto [x, y, z, vx, vy, vz] = make_vars("x", "y", "z", "vx", "vy", "vz");
+    // SECOND: centripetal and Coriolis
+    // w x w x r
+    auto centripetal_x = -qe * qe * x - re * re * x + qe * y * pe + re * z * pe;
+    auto centripetal_y = -pe * pe * y - re * re * y + pe * x * qe + re * z * qe;
+    auto centripetal_z = -pe * pe * z - qe * qe * z + pe * x * re + qe * y * re;
+    // 2 w x v
+    auto coriolis_x = expression{2.} * (qe * vz - re * vy);
+    auto coriolis_y = expression{2.} * (re * vx - pe * vz);
+    auto coriolis_z = expression{2.} * (pe * vy - qe * vx);
+
+    // Assembling the return vector containing l.h.s. and r.h.s. (note the fundamental use of the n-ary sum for
+    // efficiency and to allow compact mode to do his job)
+    retval.push_back(prime(x) = vx);
+    retval.push_back(prime(y) = vy);
+    retval.push_back(prime(z) = vz);
+    retval.push_back(prime(vx) = sum(std::move(x_acc)) - centripetal_x - coriolis_x);
+    retval.push_back(prime(vy) = sum(std::move(y_acc)) - centripetal_y - coriolis_y);
+    retval.push_back(prime(vz) = sum(std::move(z_acc)) - centripetal_z - coriolis_z);
+
+    return retval;
+}
+
 std::vector<std::pair<expression, expression>>
 make_mascon_system_impl(expression Gconst, std::vector<std::vector<expression>> mascon_points,
                         std::vector<expression> mascon_masses, expression pe, expression qe, expression re)
 {
-    // 3 - Create the return value.
-    std::vector<std::pair<expression, expression>> retval;
-    // 4 - Main code
+    // 3 - Main code
     auto dim = std::size(mascon_masses);
-    auto [x, y, z, vx, vy, vz] = make_vars("x", "y", "z", "vx", "vy", "vz");
+    auto [x, y, z] = make_vars("x", "y", "z");
     // Assemble the contributions to the x/y/z accelerations from each mass.
     std::vector<expression> x_acc, y_acc, z_acc;
     // Assembling the r.h.s.
@@ -40,32 +78,41 @@ make_mascon_system_impl(expression Gconst, std::vector<std::vector<expression>>
         auto xdiff = (x - x_masc);
         auto ydiff = (y - y_masc);
         auto zdiff = (z - z_masc);
-        auto r2 = square(xdiff) + square(ydiff) + square(zdiff);
+        auto r2 = sum_sq({xdiff, ydiff, zdiff});
         auto common_factor = -Gconst * m_masc * pow(r2, expression{-3. / 2.});
         x_acc.push_back(common_factor * xdiff);
         y_acc.push_back(common_factor * ydiff);
         z_acc.push_back(common_factor * zdiff);
     }
-    // SECOND: centripetal and Coriolis
-    // w x w x r
-    auto centripetal_x = -qe * qe * x - re * re * x + qe * y * pe + re * z * pe;
-    auto centripetal_y = -pe * pe * y - re * re * y + pe * x * qe + re * z * qe;
-    auto centripetal_z = -pe * pe * z - qe * qe * z + pe * x * re + qe * y * re;
-    // 2 w x v
-    auto coriolis_x = expression{2.} * (qe * vz - re * vy);
-    auto coriolis_y = expression{2.} * (re * vx - pe * vz);
-    auto coriolis_z = expression{2.} * (pe * vy - qe * vx);
+    // SECOND: centripetal and Coriolis, and assembly of the system.
+    return mascon_assemble_system(std::move(x_acc), std::move(y_acc), std::move(z_acc), pe, qe, re);
+}
 
-    // Assembling the return vector containing l.h.s. and r.h.s. (note the fundamental use of pairwise_sum for
-    // efficiency and to allow compact mode to do his job)
-    retval.push_back(prime(x) = vx);
-    retval.push_back(prime(y) = vy);
-    retval.push_back(prime(z) = vz);
-    retval.push_back(prime(vx) = pairwise_sum(x_acc) - centripetal_x - coriolis_x);
-    retval.push_back(prime(vy) = pairwise_sum(y_acc) - centripetal_y - coriolis_y);
-    retval.push_back(prime(vz) = pairwise_sum(z_acc) - centripetal_z - coriolis_z);
+std::vector<std::pair<expression, expression>> make_mascon_par_system_impl(std::uint32_t n, expression Gconst)
+{
+    if (n > (std::numeric_limits<std::uint32_t>::max() - 3u) / 4u) {
+        throw std::overflow_error("Overflow detected in the construction of the mascon system with "
+                                  "parameters: the number of mascon points is too large");
+    }
 
-    return retval;
+    auto [x, y, z] = make_vars("x", "y", "z");
+    // Assemble the contributions to the x/y/z accelerations from each mass.
+    std::vector<expression> x_acc, y_acc, z_acc;
+    // FIRST: the acceleration due to the mascon points, whose positions
+    // and masses are read from the array of parameters.
+    for (std::uint32_t i = 0; i < n; ++i) {
+        auto xdiff = (x - par[4u * i]);
+        auto ydiff = (y - par[4u * i + 1u]);
+        auto zdiff = (z - par[4u * i + 2u]);
+        auto r2 = sum_sq({xdiff, ydiff, zdiff});
+        auto common_factor = -Gconst * par[4u * i + 3u] * pow(r2, expression{-3. / 2.});
+        x_acc.push_back(common_factor * xdiff);
+        y_acc.push_back(common_factor * ydiff);
+        z_acc.push_back(common_factor * zdiff);
+    }
+    // SECOND: centripetal and Coriolis, and assembly of the system.
+    return mascon_assemble_system(std::move(x_acc), std::move(y_acc), std::move(z_acc), par[4u * n],
+                                  par[4u * n + 1u], par[4u * n + 2u]);
 }
 
 expression energy_mascon_system_impl(expression Gconst, std::vector<expression> x,
@@ -86,6 +133,208 @@ expression energy_mascon_system_impl(expression Gconst, std::vector<expression>
     return kinetic + potential_g + potential_c;
 }
 
+namespace
+{
+
+// Maximum depth of the octree of the mascon points.
+constexpr unsigned mascon_mp_max_depth = 64;
+
+// The clusters with up to this number of points are never replaced by their
+// multipole expansion, as the expansion would be more expensive than
+// the direct sum over the points.
+constexpr std::size_t mascon_mp_min_cluster = 4;
+
+// Builder of the contributions to the accelerations for make_mascon_multipole_system().
+struct mascon_mp_builder {
+    const std::vector<std::array<double, 3>> &points;
+    const std::vector<double> &masses;
+    double Gconst, tol, min_radius;
+    expression x, y, z;
+    std::vector<expression> x_acc, y_acc, z_acc;
+
+    // Add the contribution of the i-th mascon point, as in make_mascon_system().
+    void add_direct(std::size_t i)
+    {
+        auto xdiff = (x - expression{points[i][0]});
+        auto ydiff = (y - expression{points[i][1]});
+        auto zdiff = (z - expression{points[i][2]});
+        auto r2 = sum_sq({xdiff, ydiff, zdiff});
+        auto common_factor = expression{-Gconst * masses[i]} * pow(r2, expression{-3. / 2.});
+        x_acc.push_back(common_factor * xdiff);
+        y_acc.push_back(common_factor * ydiff);
+        z_acc.push_back(common_factor * zdiff);
+    }
+
+    // Add the contribution of a cluster with total mass M, centre of mass com
+    // and (traceless) quadrupole tensor Q. With d the position relative to com,
+    // the acceleration is G * (-M * d / r**3 + Q d / r**5 - 5 / 2 (d.Q d) d / r**7).
+    void add_multipole(double M, const std::array<double, 3> &com, const std::array<std::array<double, 3>, 3> &Q)
+    {
+        const std::array<expression, 3> d{x - expression{com[0]}, y - expression{com[1]}, z - expression{com[2]}};
+        auto r2 = sum_sq({d[0], d[1], d[2]});
+
+        // G * Q d.
+        std::array<expression, 3> Qd;
+        for (auto i = 0u; i < 3u; ++i) {
+            Qd[i] = sum({expression{Gconst * Q[i][0]} * d[0], expression{Gconst * Q[i][1]} * d[1],
+                         expression{Gconst * Q[i][2]} * d[2]});
+        }
+        auto dQd = sum({d[0] * Qd[0], d[1] * Qd[1], d[2] * Qd[2]});
+
+        auto f = expression{-Gconst * M} * pow(r2, expression{-3. / 2.})
+                 - expression{5. / 2.} * dQd * pow(r2, expression{-7. / 2.});
+        auto g = pow(r2, expression{-5. / 2.});
+
+        x_acc.push_back(f * d[0] + g * Qd[0]);
+        y_acc.push_back(f * d[1] + g * Qd[1]);
+        z_acc.push_back(f * d[2] + g * Qd[2]);
+    }
+
+    // Process the octree node with the given centre and half-size,
+    // containing the points with indices idx.
+    void process(const std::vector<std::size_t> &idx, const std::array<double, 3> &centre, double half,
+                 unsigned depth)
+    {
+        // Total mass, centre of mass and radius of the cluster.
+        double M = 0;
+        std::array<double, 3> com{};
+        for (auto i : idx) {
+            M += masses[i];
+            for (auto k = 0u; k < 3u; ++k) {
+                com[k] += masses[i] * points[i][k];
+            }
+        }
+
+        if (M > 0 && idx.size() > mascon_mp_min_cluster) {
+            for (auto &c : com) {
+                c /= M;
+            }
+
+            double a = 0;
+            for (auto i : idx) {
+                a = std::max(a, std::hypot(points[i][0] - com[0], points[i][1] - com[1], points[i][2] - com[2]));
+            }
+
+            // Lower bound for the distance between the centre
+            // of mass and the orbits outside the sphere.
+            const auto dmin = min_radius - std::hypot(com[0], com[1], com[2]);
+
+            // NOTE: for an expansion up to the quadrupole around the centre of mass (where the dipole
+            // vanishes), the relative error in the acceleration at a distance d is bounded
+            // by roughly 4 * (a / d)**3 / (1 - a / d)**2.
+            if (dmin > a) {
+                const auto ratio = a / dmin;
+
+                if (4 * ratio * ratio * ratio / ((1 - ratio) * (1 - ratio)) <= tol) {
+                    std::array<std::array<double, 3>, 3> Q{};
+                    for (auto i : idx) {
+                        const std::array<double, 3> u{points[i][0] - com[0], points[i][1] - com[1],
+                                                      points[i][2] - com[2]};
+                        const auto u2 = u[0] * u[0] + u[1] * u[1] + u[2] * u[2];
+
+                        for (auto j = 0u; j < 3u; ++j) {
+                            for (auto k = 0u; k < 3u; ++k) {
+                                Q[j][k] += masses[i] * (3 * u[j] * u[k] - (j == k ? u2 : 0.));
+                            }
+                        }
+                    }
+
+                    add_multipole(M, com, Q);
+
+                    return;
+                }
+            }
+        }
+
+        if (idx.size() <= 2u * mascon_mp_min_cluster || depth == mascon_mp_max_depth || !(half > 0)) {
+            for (auto i : idx) {
+                add_direct(i);
+            }
+
+            return;
+        }
+
+        // Split the node into octants.
+        std::array<std::vector<std::size_t>, 8> children;
+        for (auto i : idx) {
+            const auto oct = static_cast<unsigned>(points[i][0] >= centre[0])
+                             + 2u * static_cast<unsigned>(points[i][1] >= centre[1])
+                             + 4u * static_cast<unsigned>(points[i][2] >= centre[2]);
+            children[oct].push_back(i);
+        }
+
+        for (auto oct = 0u; oct < 8u; ++oct) {
+            if (children[oct].empty()) {
+                continue;
+            }
+
+            const std::array<double, 3> child_centre{centre[0] + ((oct & 1u) ? half : -half) / 2,
+                                                     centre[1] + ((oct & 2u) ? half : -half) / 2,
+                                                     centre[2] + ((oct & 4u) ? half : -half) / 2};
+
+            process(children[oct], child_centre, half / 2, depth + 1u);
+        }
+    }
+};
+
+} // namespace
+
+std::vector<std::pair<expression, expression>>
+make_mascon_multipole_system_impl(double Gconst, std::vector<std::array<double, 3>> mascon_points,
+                                  std::vector<double> mascon_masses, std::array<double, 3> omega, double tol,
+                                  double min_radius)
+{
+    using namespace fmt::literals;
+
+    if (mascon_points.size() != mascon_masses.size()) {
+        throw std::invalid_argument(
+            "Inconsistent sizes detected in the construction of the mascon multipole system: the number of mascon "
+            "points is {}, while the number of mascon masses is {}"_format(mascon_points.size(),
+                                                                          mascon_masses.size()));
+    }
+
+    if (!std::isfinite(tol) || tol <= 0) {
+        throw std::invalid_argument(
+            "The tolerance in the construction of the mascon multipole system must be finite and positive, "
+            "but it is {} instead"_format(tol));
+    }
+
+    if (!std::isfinite(min_radius) || min_radius <= 0) {
+        throw std::invalid_argument(
+            "The minimum radius in the construction of the mascon multipole system must be finite and positive, "
+            "but it is {} instead"_format(min_radius));
+    }
+
+    auto [x, y, z] = make_vars("x", "y", "z");
+
+    mascon_mp_builder b{mascon_points, mascon_masses, Gconst, tol, min_radius, x, y, z, {}, {}, {}};
+
+    if (!mascon_points.empty()) {
+        // The root node is the bounding cube of the points.
+        constexpr auto inf = std::numeric_limits<double>::infinity();
+        std::array<double, 3> lb{inf, inf, inf}, ub{-inf, -inf, -inf};
+        for (const auto &pt : mascon_points) {
+            for (auto k = 0u; k < 3u; ++k) {
+                lb[k] = std::min(lb[k], pt[k]);
+                ub[k] = std::max(ub[k], pt[k]);
+            }
+        }
+
+        const std::array<double, 3> centre{(lb[0] + ub[0]) / 2, (lb[1] + ub[1]) / 2, (lb[2] + ub[2]) / 2};
+        const auto half = std::max({ub[0] - lb[0], ub[1] - lb[1], ub[2] - lb[2]}) / 2;
+
+        std::vector<std::size_t> idx(mascon_points.size());
+        for (std::size_t i = 0; i < idx.size(); ++i) {
+            idx[i] = i;
+        }
+
+        b.process(idx, centre, half, 0);
+    }
+
+    return mascon_assemble_system(std::move(b.x_acc), std::move(b.y_acc), std::move(b.z_acc), expression{omega[0]},
+                                  expression{omega[1]}, expression{omega[2]});
+}
+
 } // namespace detail
 
 } // namespace heyoka
@@ -9,6 +9,7 @@
 #include <heyoka/config.hpp>
 
 #include <cassert>
+#include <cmath>
 #include <cstdint>
 #include <initializer_list>
 #include <stdexcept>
@@ -40,11 +41,11 @@
 #endif
 
 #include <heyoka/detail/llvm_helpers.hpp>
-#include <heyoka/detail/sleef.hpp>
 #include <heyoka/detail/string_conv.hpp>
 #include <heyoka/detail/taylor_common.hpp>
 #include <heyoka/expression.hpp>
 #include <heyoka/func.hpp>
+#include <heyoka/interval.hpp>
 #include <heyoka/llvm_state.hpp>
 #include <heyoka/math/atan.hpp>
 #include <heyoka/math/square.hpp>
@@ -67,18 +68,8 @@ llvm::Value *atan_impl::codegen_dbl(llvm_state &s, const std::vector<llvm::Value
     assert(args.size() == 1u);
     assert(args[0] != nullptr);
 
-    if (auto vec_t = llvm::dyn_cast<llvm::VectorType>(args[0]->getType())) {
-        if (const auto sfn = sleef_function_name(s.context(), "atan", vec_t->getElementType(),
-                                                 boost::numeric_cast<std::uint32_t>(vec_t->getNumElements()));
-            !sfn.empty()) {
-            return llvm_invoke_external(
-                s, sfn, vec_t, args,
-                // NOTE: in theory we may add ReadNone here as well,
-                // but for some reason, at least up to LLVM 10,
-                // this causes strange codegen issues. Revisit
-                // in the future.
-                {llvm::Attribute::NoUnwind, llvm::Attribute::Speculatable, llvm::Attribute::WillReturn});
-        }
+    if (auto ret = llvm_invoke_sleef(s, "atan", args)) {
+        return ret;
     }
 
     return call_extern_vec(s, args[0], "atan");
@@ -113,6 +104,13 @@ llvm::Value *atan_impl::codegen_f128(llvm_state &s, const std::vector<llvm::Valu
 
 #endif
 
+interval atan_impl::eval_interval_dbl(const std::vector<interval> &a) const
+{
+    assert(a.size() == 1u);
+
+    return interval_monotonic(a[0], [](double x) { return std::atan(x); }, true);
+}
+
 std::vector<std::pair<expression, std::vector<std::uint32_t>>>::size_type
 atan_impl::taylor_decompose(std::vector<std::pair<expression, std::vector<std::uint32_t>>> &u_vars_defs) &&
 {
@@ -165,7 +163,7 @@ llvm::Value *taylor_diff_atan_impl(llvm_state &s, const atan_impl &f, const std:
     auto &builder = s.builder();
 
     // Fetch the index of the variable argument.
-    const auto b_idx = uname_to_index(var.name());
+    const auto b_idx = uname_to_index(var);
 
     if (order == 0u) {
         return codegen_from_values<T>(s, f, {taylor_fetch_diff(arr, b_idx, 0, n_uvars)});
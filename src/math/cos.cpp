@@ -42,11 +42,11 @@
 #endif
 
 #include <heyoka/detail/llvm_helpers.hpp>
-#include <heyoka/detail/sleef.hpp>
 #include <heyoka/detail/string_conv.hpp>
 #include <heyoka/detail/taylor_common.hpp>
 #include <heyoka/expression.hpp>
 #include <heyoka/func.hpp>
+#include <heyoka/interval.hpp>
 #include <heyoka/llvm_state.hpp>
 #include <heyoka/math/cos.hpp>
 #include <heyoka/math/sin.hpp>
@@ -69,18 +69,8 @@ llvm::Value *cos_impl::codegen_dbl(llvm_state &s, const std::vector<llvm::Value
     assert(args.size() == 1u);
     assert(args[0] != nullptr);
 
-    if (auto vec_t = llvm::dyn_cast<llvm::VectorType>(args[0]->getType())) {
-        if (const auto sfn = sleef_function_name(s.context(), "cos", vec_t->getElementType(),
-                                                 boost::numeric_cast<std::uint32_t>(vec_t->getNumElements()));
-            !sfn.empty()) {
-            return llvm_invoke_external(
-                s, sfn, vec_t, args,
-                // NOTE: in theory we may add ReadNone here as well,
-                // but for some reason, at least up to LLVM 10,
-                // this causes strange codegen issues. Revisit
-                // in the future.
-                {llvm::Attribute::NoUnwind, llvm::Attribute::Speculatable, llvm::Attribute::WillReturn});
-        }
+    if (auto ret = llvm_invoke_sleef(s, "cos", args)) {
+        return ret;
     }
 
     return llvm_invoke_intrinsic(s, "llvm.cos", {args[0]->getType()}, args);
@@ -165,6 +155,13 @@ double cos_impl::deval_num_dbl(const std::vector<double> &a, std::vector<double>
     return -std::sin(a[0]);
 }
 
+interval cos_impl::eval_interval_dbl(const std::vector<interval> &a) const
+{
+    assert(a.size() == 1u);
+
+    return interval_cos(a[0]);
+}
+
 std::vector<std::pair<expression, std::vector<std::uint32_t>>>::size_type
 cos_impl::taylor_decompose(std::vector<std::pair<expression, std::vector<std::uint32_t>>> &u_vars_defs) &&
 {
@@ -173,7 +170,7 @@ cos_impl::taylor_decompose(std::vector<std::pair<expression, std::vector<std::ui
     // Decompose the argument.
     auto &arg = *get_mutable_args_it().first;
     if (const auto dres = taylor_decompose_in_place(std::move(arg), u_vars_defs)) {
-        arg = expression{variable{"u_" + detail::li_to_string(dres)}};
+        arg = expression{detail::make_u_var(boost::numeric_cast<std::uint32_t>(dres))};
     }
 
     // Append the sine decomposition.
@@ -212,10 +209,19 @@ llvm::Value *taylor_diff_cos_impl(llvm_state &s, const cos_impl &f, const std::v
     auto &builder = s.builder();
 
     // Fetch the index of the variable.
-    const auto u_idx = uname_to_index(var.name());
+    const auto u_idx = uname_to_index(var);
 
     if (order == 0u) {
-        return codegen_from_values<T>(s, f, {taylor_fetch_diff(arr, u_idx, 0, n_uvars)});
+        auto arg0 = taylor_fetch_diff(arr, u_idx, 0, n_uvars);
+
+        // NOTE: compute cos() via sincos(), if available. The order-0 derivative
+        // of the hidden dependency sin() invokes sincos() with the same argument,
+        // so that the two invocations can be merged into one.
+        if (const auto [s_val, c_val] = llvm_sleef_sincos(s, arg0); s_val != nullptr) {
+            return c_val;
+        }
+
+        return codegen_from_values<T>(s, f, {arg0});
     }
 
     // NOTE: iteration in the [1, order] range
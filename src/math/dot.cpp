@@ -0,0 +1,518 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <heyoka/config.hpp>
+
+#include <cassert>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <llvm/IR/Attributes.h>
+#include <llvm/IR/BasicBlock.h>
+#include <llvm/IR/DerivedTypes.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/Type.h>
+#include <llvm/IR/Value.h>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <heyoka/detail/llvm_helpers.hpp>
+#include <heyoka/detail/string_conv.hpp>
+#include <heyoka/detail/type_traits.hpp>
+#include <heyoka/expression.hpp>
+#include <heyoka/func.hpp>
+#include <heyoka/interval.hpp>
+#include <heyoka/llvm_state.hpp>
+#include <heyoka/math/dot.hpp>
+#include <heyoka/math/sum.hpp>
+#include <heyoka/number.hpp>
+#include <heyoka/param.hpp>
+#include <heyoka/taylor.hpp>
+#include <heyoka/variable.hpp>
+
+namespace heyoka
+{
+
+namespace detail
+{
+
+namespace
+{
+
+// Interleave the coefficients and the terms of a dot product.
+std::vector<expression> dot_interleave(std::vector<expression> coeffs, std::vector<expression> terms)
+{
+    if (coeffs.size() != terms.size()) {
+        throw std::invalid_argument("The number of coefficients (" + std::to_string(coeffs.size())
+                                    + ") and the number of terms (" + std::to_string(terms.size())
+                                    + ") of a dot product must be equal");
+    }
+
+    std::vector<expression> retval;
+    retval.reserve(coeffs.size() * 2u);
+
+    for (decltype(coeffs.size()) i = 0; i < coeffs.size(); ++i) {
+        if (!std::holds_alternative<number>(coeffs[i].value()) && !std::holds_alternative<param>(coeffs[i].value())) {
+            throw std::invalid_argument("The coefficients of a dot product must be numbers or params");
+        }
+
+        retval.push_back(std::move(coeffs[i]));
+        retval.push_back(std::move(terms[i]));
+    }
+
+    return retval;
+}
+
+} // namespace
+
+dot_impl::dot_impl(std::vector<expression> coeffs, std::vector<expression> terms)
+    : func_base("dot", dot_interleave(std::move(coeffs), std::move(terms)))
+{
+}
+
+dot_impl::dot_impl() : dot_impl(std::vector<expression>{}, std::vector<expression>{}) {}
+
+llvm::Value *dot_impl::codegen_dbl(llvm_state &s, const std::vector<llvm::Value *> &args) const
+{
+    assert(!args.empty());
+    assert(args.size() % 2u == 0u);
+
+    auto &builder = s.builder();
+
+    std::vector<llvm::Value *> prods;
+    prods.reserve(args.size() / 2u);
+    for (decltype(args.size()) i = 0; i < args.size(); i += 2u) {
+        assert(args[i] != nullptr);
+        assert(args[i + 1u] != nullptr);
+
+        prods.push_back(builder.CreateFMul(args[i], args[i + 1u]));
+    }
+
+    return pairwise_sum(builder, prods);
+}
+
+llvm::Value *dot_impl::codegen_ldbl(llvm_state &s, const std::vector<llvm::Value *> &args) const
+{
+    // NOTE: codegen is identical as in dbl.
+    return codegen_dbl(s, args);
+}
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+llvm::Value *dot_impl::codegen_f128(llvm_state &s, const std::vector<llvm::Value *> &args) const
+{
+    // NOTE: codegen is identical as in dbl.
+    return codegen_dbl(s, args);
+}
+
+#endif
+
+interval dot_impl::eval_interval_dbl(const std::vector<interval> &a) const
+{
+    assert(a.size() % 2u == 0u);
+
+    interval retval{0., 0.};
+    for (decltype(a.size()) i = 0; i < a.size(); i += 2u) {
+        retval = retval + a[i] * a[i + 1u];
+    }
+
+    return retval;
+}
+
+namespace
+{
+
+// Derivative of the dot product.
+// NOTE: the dot product is linear in the terms, and the coefficients
+// are constant. Thus, the derivative of order n is the dot product of the
+// coefficients and of the derivatives of order n of the variable terms.
+template <typename T>
+llvm::Value *taylor_diff_dot_impl(llvm_state &s, const dot_impl &f, const std::vector<std::uint32_t> &deps,
+                                  const std::vector<llvm::Value *> &arr, llvm::Value *par_ptr, std::uint32_t n_uvars,
+                                  std::uint32_t order, std::uint32_t batch_size)
+{
+    assert(!f.args().empty());
+    assert(f.args().size() % 2u == 0u);
+
+    if (!deps.empty()) {
+        throw std::invalid_argument(fmt::format("An empty hidden dependency vector is expected in order to compute the "
+                                                "Taylor derivative of the dot product, but a vector of size {} was "
+                                                "passed instead",
+                                                deps.size()));
+    }
+
+    auto &builder = s.builder();
+
+    // Fetch the values of the arguments (or, for orders higher than zero,
+    // the products of the coefficients and of the derivatives of the
+    // variable terms).
+    std::vector<llvm::Value *> vals;
+    const auto &args = f.args();
+    for (decltype(args.size()) i = 0; i < args.size(); i += 2u) {
+        auto cf = std::visit(
+            [&](const auto &v) -> llvm::Value * {
+                using type = uncvref_t<decltype(v)>;
+
+                if constexpr (is_num_param_v<type>) {
+                    return taylor_codegen_numparam<T>(s, v, par_ptr, batch_size);
+                } else {
+                    throw std::invalid_argument("An invalid coefficient type was encountered while trying to build "
+                                                "the Taylor derivative of a dot product");
+                }
+            },
+            args[i].value());
+
+        std::visit(
+            [&](const auto &v) {
+                using type = uncvref_t<decltype(v)>;
+
+                if constexpr (std::is_same_v<type, variable>) {
+                    const auto u_idx = uname_to_index(v);
+
+                    if (order == 0u) {
+                        vals.push_back(cf);
+                        vals.push_back(taylor_fetch_diff(arr, u_idx, 0, n_uvars));
+                    } else {
+                        vals.push_back(builder.CreateFMul(cf, taylor_fetch_diff(arr, u_idx, order, n_uvars)));
+                    }
+                } else if constexpr (is_num_param_v<type>) {
+                    if (order == 0u) {
+                        vals.push_back(cf);
+                        vals.push_back(taylor_codegen_numparam<T>(s, v, par_ptr, batch_size));
+                    }
+                } else {
+                    throw std::invalid_argument("An invalid argument type was encountered while trying to build the "
+                                                "Taylor derivative of a dot product");
+                }
+            },
+            args[i + 1u].value());
+    }
+
+    if (order == 0u) {
+        return codegen_from_values<T>(s, f, vals);
+    }
+
+    if (vals.empty()) {
+        return vector_splat(builder, codegen<T>(s, number{0.}), batch_size);
+    }
+
+    return pairwise_sum(builder, vals);
+}
+
+} // namespace
+
+llvm::Value *dot_impl::taylor_diff_dbl(llvm_state &s, const std::vector<std::uint32_t> &deps,
+                                       const std::vector<llvm::Value *> &arr, llvm::Value *par_ptr, llvm::Value *,
+                                       std::uint32_t n_uvars, std::uint32_t order, std::uint32_t,
+                                       std::uint32_t batch_size) const
+{
+    return taylor_diff_dot_impl<double>(s, *this, deps, arr, par_ptr, n_uvars, order, batch_size);
+}
+
+llvm::Value *dot_impl::taylor_diff_ldbl(llvm_state &s, const std::vector<std::uint32_t> &deps,
+                                        const std::vector<llvm::Value *> &arr, llvm::Value *par_ptr, llvm::Value *,
+                                        std::uint32_t n_uvars, std::uint32_t order, std::uint32_t,
+                                        std::uint32_t batch_size) const
+{
+    return taylor_diff_dot_impl<long double>(s, *this, deps, arr, par_ptr, n_uvars, order, batch_size);
+}
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+llvm::Value *dot_impl::taylor_diff_f128(llvm_state &s, const std::vector<std::uint32_t> &deps,
+                                        const std::vector<llvm::Value *> &arr, llvm::Value *par_ptr, llvm::Value *,
+                                        std::uint32_t n_uvars, std::uint32_t order, std::uint32_t,
+                                        std::uint32_t batch_size) const
+{
+    return taylor_diff_dot_impl<mppp::real128>(s, *this, deps, arr, par_ptr, n_uvars, order, batch_size);
+}
+
+#endif
+
+namespace
+{
+
+// Derivative of the dot product in compact mode. The function accepts the arguments
+// of the dot product after the common arguments (diff order, index of the u variable,
+// diff array, par ptr and time ptr): the values of the numbers, the indices of the params
+// and the indices of the variables, in the same order as in fn.
+template <typename T>
+llvm::Function *taylor_c_diff_func_dot_impl(llvm_state &s, const dot_impl &fn, std::uint32_t n_uvars,
+                                            std::uint32_t batch_size)
+{
+    assert(!fn.args().empty());
+    assert(fn.args().size() % 2u == 0u);
+
+    auto &module = s.module();
+    auto &builder = s.builder();
+    auto &context = s.context();
+
+    // Fetch the floating-point type.
+    auto val_t = to_llvm_vector_type<T>(context, batch_size);
+
+    // The function arguments: the common ones,
+    // followed by the arguments of the dot product.
+    std::vector<llvm::Type *> fargs{llvm::Type::getInt32Ty(context), llvm::Type::getInt32Ty(context),
+                                    llvm::PointerType::getUnqual(val_t),
+                                    llvm::PointerType::getUnqual(to_llvm_type<T>(context)),
+                                    llvm::PointerType::getUnqual(to_llvm_type<T>(context))};
+
+    // Build the mangled list of the argument types.
+    // NOTE: as in the sum, the runs of arguments of the same
+    // type are encoded as the type followed by the length of the run.
+    std::string args_mangle, cur_kind;
+    std::uint32_t run_length = 0;
+    for (decltype(fn.args().size()) i = 0; i < fn.args().size(); ++i) {
+        const auto is_coeff = i % 2u == 0u;
+
+        const auto kind = std::visit(
+            [&](const auto &v) -> std::string {
+                using type = uncvref_t<decltype(v)>;
+
+                if constexpr (std::is_same_v<type, variable>) {
+                    if (is_coeff) {
+                        return "";
+                    }
+
+                    fargs.push_back(llvm::Type::getInt32Ty(context));
+                    return "var";
+                } else if constexpr (is_num_param_v<type>) {
+                    fargs.push_back(taylor_c_diff_numparam_argtype<T>(s, v));
+                    return taylor_c_diff_numparam_mangle(v);
+                } else {
+                    return "";
+                }
+            },
+            fn.args()[i].value());
+
+        if (kind.empty()) {
+            throw std::invalid_argument("An invalid argument type was encountered while trying to build the "
+                                        "Taylor derivative of a dot product in compact mode");
+        }
+
+        if (kind == cur_kind) {
+            ++run_length;
+        } else {
+            if (run_length > 0u) {
+                args_mangle += "_" + cur_kind + li_to_string(run_length);
+            }
+            cur_kind = kind;
+            run_length = 1;
+        }
+    }
+    args_mangle += "_" + cur_kind + li_to_string(run_length);
+
+    // Get the function name.
+    const auto fname = fmt::format("heyoka_taylor_diff_dot{}_{}_n_uvars_{}", args_mangle, taylor_mangle_suffix(val_t),
+                                   li_to_string(n_uvars));
+
+    // Try to see if we already created the function.
+    auto f = module.getFunction(fname);
+
+    if (f == nullptr) {
+        // The function was not created before, do it now.
+
+        // Fetch the current insertion block.
+        auto orig_bb = builder.GetInsertBlock();
+
+        // The return type is val_t.
+        auto *ft = llvm::FunctionType::get(val_t, fargs, false);
+        // Create the function
+        f = llvm::Function::Create(ft, llvm::Function::InternalLinkage, fname, &module);
+        assert(f != nullptr);
+
+        // Fetch the necessary function arguments.
+        auto ord = f->args().begin();
+        auto diff_ptr = f->args().begin() + 2;
+        auto par_ptr = f->args().begin() + 3;
+
+        // Create a new basic block to start insertion into.
+        builder.SetInsertPoint(llvm::BasicBlock::Create(context, "entry", f));
+
+        // Create the return value.
+        auto retval = builder.CreateAlloca(val_t);
+
+        // Helper to load the values of all the arguments (if o is null) or the
+        // products of the coefficients and of the derivatives of order o of the
+        // variable terms.
+        auto load_args = [&](llvm::Value *o) {
+            std::vector<llvm::Value *> ret;
+
+            auto f_arg = f->args().begin() + 5;
+            llvm::Value *cf = nullptr;
+            for (decltype(fn.args().size()) i = 0; i < fn.args().size(); ++i, ++f_arg) {
+                std::visit(
+                    [&](const auto &v) {
+                        using type = uncvref_t<decltype(v)>;
+
+                        if constexpr (std::is_same_v<type, variable>) {
+                            // NOTE: variables are terms, never coefficients.
+                            assert(i % 2u == 1u);
+
+                            if (o == nullptr) {
+                                ret.push_back(cf);
+                                ret.push_back(taylor_c_load_diff(s, diff_ptr, n_uvars, builder.getInt32(0), f_arg));
+                            } else {
+                                ret.push_back(
+                                    builder.CreateFMul(cf, taylor_c_load_diff(s, diff_ptr, n_uvars, o, f_arg)));
+                            }
+                        } else if constexpr (is_num_param_v<type>) {
+                            auto val = taylor_c_diff_numparam_codegen(s, v, f_arg, par_ptr, batch_size);
+
+                            if (i % 2u == 0u) {
+                                cf = val;
+                            } else if (o == nullptr) {
+                                ret.push_back(cf);
+                                ret.push_back(val);
+                            }
+                        }
+                    },
+                    fn.args()[i].value());
+            }
+
+            return ret;
+        };
+
+        llvm_if_then_else(
+            s, builder.CreateICmpEQ(ord, builder.getInt32(0)),
+            [&]() {
+                // For order 0, invoke the function on the values of the arguments.
+                builder.CreateStore(codegen_from_values<T>(s, fn, load_args(nullptr)), retval);
+            },
+            [&]() {
+                auto terms = load_args(ord);
+
+                if (terms.empty()) {
+                    // No variable terms, the derivative is zero.
+                    builder.CreateStore(vector_splat(builder, codegen<T>(s, number{0.}), batch_size), retval);
+                } else {
+                    builder.CreateStore(pairwise_sum(builder, terms), retval);
+                }
+            });
+
+        // Return the result.
+        builder.CreateRet(builder.CreateLoad(val_t, retval));
+
+        // Verify.
+        s.verify_function(f);
+
+        // Restore the original insertion block.
+        builder.SetInsertPoint(orig_bb);
+    } else {
+        // The function was created before. Check if the signatures match.
+        // NOTE: there could be a mismatch if the derivative function was created
+        // and then optimised - optimisation might remove arguments which are compile-time
+        // constants.
+        if (!compare_function_signature(f, val_t, fargs)) {
+            throw std::invalid_argument("Inconsistent function signature for the Taylor derivative of the dot "
+                                        "product in compact mode detected");
+        }
+    }
+
+    return f;
+}
+
+} // namespace
+
+llvm::Function *dot_impl::taylor_c_diff_func_dbl(llvm_state &s, std::uint32_t n_uvars, std::uint32_t batch_size) const
+{
+    return taylor_c_diff_func_dot_impl<double>(s, *this, n_uvars, batch_size);
+}
+
+llvm::Function *dot_impl::taylor_c_diff_func_ldbl(llvm_state &s, std::uint32_t n_uvars, std::uint32_t batch_size) const
+{
+    return taylor_c_diff_func_dot_impl<long double>(s, *this, n_uvars, batch_size);
+}
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+llvm::Function *dot_impl::taylor_c_diff_func_f128(llvm_state &s, std::uint32_t n_uvars, std::uint32_t batch_size) const
+{
+    return taylor_c_diff_func_dot_impl<mppp::real128>(s, *this, n_uvars, batch_size);
+}
+
+#endif
+
+// NOTE: the coefficients are constant.
+expression dot_impl::diff(const std::string &s) const
+{
+    std::vector<expression> coeffs, terms;
+    coeffs.reserve(args().size() / 2u);
+    terms.reserve(args().size() / 2u);
+
+    for (decltype(args().size()) i = 0; i < args().size(); i += 2u) {
+        coeffs.push_back(args()[i]);
+        terms.push_back(heyoka::diff(args()[i + 1u], s));
+    }
+
+    return heyoka::dot(std::move(coeffs), std::move(terms));
+}
+
+} // namespace detail
+
+// NOTE: the empty dot product is
+// simplified immediately.
+expression dot(std::vector<expression> coeffs, std::vector<expression> terms)
+{
+    if (coeffs.empty() && terms.empty()) {
+        return 0_dbl;
+    }
+
+    return expression{func{detail::dot_impl(std::move(coeffs), std::move(terms))}};
+}
+
+// NOTE: the bias is included in the dot product
+// as the coefficient of the constant term 1.
+std::vector<expression> dense_layer(const std::vector<expression> &inputs, std::uint32_t n_out,
+                                    std::uint32_t par_offset, const std::function<expression(expression)> &act)
+{
+    if (inputs.empty()) {
+        throw std::invalid_argument("A dense layer must have at least one input");
+    }
+
+    const auto n_in = inputs.size();
+
+    if (n_in >= std::numeric_limits<std::uint32_t>::max()
+        || n_out > (std::numeric_limits<std::uint32_t>::max() - par_offset) / (n_in + 1u)) {
+        throw std::overflow_error("Overflow detected in the indices of the params of a dense layer");
+    }
+
+    std::vector<expression> retval;
+    retval.reserve(n_out);
+
+    for (std::uint32_t i = 0; i < n_out; ++i) {
+        const auto offset = par_offset + i * static_cast<std::uint32_t>(n_in + 1u);
+
+        std::vector<expression> coeffs, terms;
+        for (decltype(inputs.size()) j = 0; j <= n_in; ++j) {
+            coeffs.emplace_back(param{offset + static_cast<std::uint32_t>(j)});
+            terms.push_back(j == n_in ? 1_dbl : inputs[j]);
+        }
+
+        auto out = dot(std::move(coeffs), std::move(terms));
+        retval.push_back(act ? act(std::move(out)) : std::move(out));
+    }
+
+    return retval;
+}
+
+} // namespace heyoka
@@ -0,0 +1,451 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <heyoka/config.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <llvm/IR/Attributes.h>
+#include <llvm/IR/BasicBlock.h>
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/DataLayout.h>
+#include <llvm/IR/DerivedTypes.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+#include <llvm/IR/Type.h>
+#include <llvm/IR/Value.h>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <heyoka/detail/llvm_helpers.hpp>
+#include <heyoka/detail/type_traits.hpp>
+#include <heyoka/detail/visibility.hpp>
+#include <heyoka/expression.hpp>
+#include <heyoka/func.hpp>
+#include <heyoka/llvm_state.hpp>
+#include <heyoka/math/ephem.hpp>
+#include <heyoka/number.hpp>
+#include <heyoka/taylor.hpp>
+#include <heyoka/taylor_traj.hpp>
+
+namespace heyoka
+{
+
+namespace detail
+{
+
+namespace
+{
+
+// Compute the normalised derivative of the given order of the component comp
+// of a Chebyshev trajectory at the time t. NaN is returned if t is outside
+// the time range of the trajectory.
+// NOTE: this is invoked from the JIT-compiled code, hence it must not throw.
+template <typename T>
+T ephem_eval(const taylor_cheb_traj<T> &traj, std::uint32_t comp, std::uint32_t order, T t) noexcept
+{
+    using std::isnan;
+
+    const auto &times = traj.get_times();
+
+    if (times.empty() || isnan(t)) {
+        return std::numeric_limits<T>::quiet_NaN();
+    }
+
+    const auto fwd = times.back() > times.front();
+    const auto t_min = fwd ? times.front() : times.back(), t_max = fwd ? times.back() : times.front();
+
+    if (t < t_min || t > t_max) {
+        return std::numeric_limits<T>::quiet_NaN();
+    }
+
+    // Locate the step containing t via binary search.
+    // NOTE: the end of the last step belongs to the last step.
+    auto it = fwd ? std::upper_bound(times.begin(), times.end(), t)
+                  : std::upper_bound(times.begin(), times.end(), t, std::greater<T>{});
+    const auto step_idx = std::min(static_cast<std::size_t>(it - times.begin()), times.size() - 1u) - 1u;
+
+    // Locate the Chebyshev coefficients of the component.
+    const auto *n_coeffs = traj.get_n_coeffs().data() + step_idx * traj.get_dim();
+    const auto *cc = traj.get_coeffs().data() + traj.get_offsets()[step_idx];
+    for (std::uint32_t i = 0; i < comp; ++i) {
+        cc += n_coeffs[i];
+    }
+    std::size_t nc = n_coeffs[comp];
+
+    if (order >= nc) {
+        return T(0);
+    }
+
+    const auto t0 = times[step_idx];
+    const auto h = times[step_idx + 1u] - t0;
+
+    if (order > 0u) {
+        // Differentiate the series order times. Each differentiation lowers the degree
+        // by one (via the recurrence on the coefficients of the Chebyshev series), and the
+        // result is scaled by dx/dt = 2 / h and by 1 / k, so that the final
+        // result is the normalised derivative.
+        // NOTE: the buffers are thread-local, as the JIT-compiled
+        // code may be invoked concurrently (e.g., in ensembles).
+        thread_local std::vector<T> buf_a, buf_b;
+        buf_a.assign(cc, cc + nc);
+        buf_b.resize(nc);
+
+        for (std::uint32_t k = 1; k <= order; ++k) {
+            const auto fac = T(2) / (h * static_cast<T>(k));
+
+            T d_p1(0), d_p2(0);
+            for (auto j = nc - 1u; j >= 1u; --j) {
+                const auto d = d_p2 + T(2) * static_cast<T>(j) * buf_a[j];
+                d_p2 = d_p1;
+                d_p1 = d;
+                buf_b[j - 1u] = d * fac;
+            }
+            buf_b[0] /= 2;
+
+            --nc;
+            std::swap(buf_a, buf_b);
+        }
+
+        cc = buf_a.data();
+    }
+
+    // Evaluate the series via the Clenshaw recurrence.
+    const auto x = 2 * (t - t0) / h - 1;
+
+    T b1(0), b2(0);
+    for (auto j = nc - 1u; j >= 1u; --j) {
+        const auto tmp = cc[j] + 2 * x * b1 - b2;
+        b2 = b1;
+        b1 = tmp;
+    }
+
+    return cc[0] + x * b1 - b2;
+}
+
+} // namespace
+
+} // namespace detail
+
+} // namespace heyoka
+
+// The functions invoked from the JIT-compiled code. The first
+// argument is the address of the trajectory.
+extern "C" HEYOKA_DLL_PUBLIC double heyoka_ephem_dbl(const void *traj, std::uint32_t comp, std::uint32_t order,
+                                                     double t) noexcept
+{
+    return heyoka::detail::ephem_eval(*static_cast<const heyoka::taylor_cheb_traj<double> *>(traj), comp, order, t);
+}
+
+extern "C" HEYOKA_DLL_PUBLIC long double heyoka_ephem_ldbl(const void *traj, std::uint32_t comp, std::uint32_t order,
+                                                           long double t) noexcept
+{
+    return heyoka::detail::ephem_eval(*static_cast<const heyoka::taylor_cheb_traj<long double> *>(traj), comp, order,
+                                      t);
+}
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+extern "C" HEYOKA_DLL_PUBLIC __float128 heyoka_ephem_f128(const void *traj, std::uint32_t comp, std::uint32_t order,
+                                                          __float128 t) noexcept
+{
+    return heyoka::detail::ephem_eval(*static_cast<const heyoka::taylor_cheb_traj<mppp::real128> *>(traj), comp,
+                                      order, mppp::real128{t})
+        .m_value;
+}
+
+#endif
+
+namespace heyoka
+{
+
+namespace detail
+{
+
+ephem_impl::ephem_impl() : ephem_impl("ephem", traj_ptr_t{}, 0) {}
+
+ephem_impl::ephem_impl(std::string name, traj_ptr_t traj, std::uint32_t comp)
+    : func_base(std::move(name), std::vector<expression>{}), m_traj(std::move(traj)), m_comp(comp)
+{
+}
+
+const ephem_impl::traj_ptr_t &ephem_impl::get_traj() const
+{
+    return m_traj;
+}
+
+std::uint32_t ephem_impl::get_comp() const
+{
+    return m_comp;
+}
+
+void ephem_impl::to_stream(std::ostream &os) const
+{
+    os << get_name() << "(t)";
+}
+
+bool ephem_impl::is_time_dependent() const
+{
+    return true;
+}
+
+expression ephem_impl::diff(const std::string &) const
+{
+    // NOTE: the trajectory does not depend on the variables.
+    return 0_dbl;
+}
+
+namespace
+{
+
+template <typename T>
+const taylor_cheb_traj<T> &ephem_get_traj(const ephem_impl &f)
+{
+    const auto *ptr = std::get_if<std::shared_ptr<const taylor_cheb_traj<T>>>(&f.get_traj());
+
+    if (ptr == nullptr || !*ptr) {
+        throw std::invalid_argument("The function '" + f.get_name()
+                                    + "' cannot be used in an integrator whose floating-point type is different from "
+                                      "the floating-point type of its trajectory");
+    }
+
+    return **ptr;
+}
+
+template <typename T>
+std::string ephem_ext_name()
+{
+    if constexpr (std::is_same_v<T, double>) {
+        return "heyoka_ephem_dbl";
+    } else if constexpr (std::is_same_v<T, long double>) {
+        return "heyoka_ephem_ldbl";
+#if defined(HEYOKA_HAVE_REAL128)
+    } else if constexpr (std::is_same_v<T, mppp::real128>) {
+        return "heyoka_ephem_f128";
+#endif
+    } else {
+        static_assert(always_false_v<T>, "Unhandled type.");
+    }
+}
+
+// Invoke the evaluation function of the trajectory of f on each
+// element of the vector of times for the given (runtime) order.
+template <typename T>
+llvm::Value *ephem_codegen_eval(llvm_state &s, const ephem_impl &f, llvm::Value *time_ptr, llvm::Value *order,
+                                std::uint32_t batch_size)
+{
+    auto &builder = s.builder();
+    auto &context = s.context();
+
+    const auto &traj = ephem_get_traj<T>(f);
+
+    // NOTE: the address of the trajectory is embedded in the code
+    // as a constant. The trajectory is kept alive by f and, in the
+    // integrators, independently of the Taylor decomposition (see
+    // taylor_dc_keep_alive()).
+    auto *int_ptr_t = s.module().getDataLayout().getIntPtrType(context);
+    auto *traj_ptr = builder.CreateIntToPtr(
+        llvm::ConstantInt::get(int_ptr_t, reinterpret_cast<std::uintptr_t>(static_cast<const void *>(&traj))),
+        llvm::PointerType::getUnqual(builder.getInt8Ty()));
+
+    // Decompose the vector of times into scalars.
+    auto scalars = vector_to_scalars(builder, load_vector_from_memory(builder, time_ptr, batch_size));
+
+    // Invoke the function on each scalar.
+    std::vector<llvm::Value *> retvals;
+    for (auto scal : scalars) {
+        retvals.push_back(llvm_invoke_external(s, ephem_ext_name<T>(), scal->getType(),
+                                               {traj_ptr, builder.getInt32(f.get_comp()), order, scal},
+                                               {llvm::Attribute::NoUnwind, llvm::Attribute::WillReturn}));
+    }
+
+    // Build a vector with the results.
+    return scalars_to_vector(builder, retvals);
+}
+
+} // namespace
+
+llvm::Value *ephem_impl::taylor_diff_dbl(llvm_state &s, const std::vector<std::uint32_t> &,
+                                         const std::vector<llvm::Value *> &, llvm::Value *, llvm::Value *time_ptr,
+                                         std::uint32_t, std::uint32_t order, std::uint32_t,
+                                         std::uint32_t batch_size) const
+{
+    return ephem_codegen_eval<double>(s, *this, time_ptr, s.builder().getInt32(order), batch_size);
+}
+
+llvm::Value *ephem_impl::taylor_diff_ldbl(llvm_state &s, const std::vector<std::uint32_t> &,
+                                          const std::vector<llvm::Value *> &, llvm::Value *, llvm::Value *time_ptr,
+                                          std::uint32_t, std::uint32_t order, std::uint32_t,
+                                          std::uint32_t batch_size) const
+{
+    return ephem_codegen_eval<long double>(s, *this, time_ptr, s.builder().getInt32(order), batch_size);
+}
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+llvm::Value *ephem_impl::taylor_diff_f128(llvm_state &s, const std::vector<std::uint32_t> &,
+                                          const std::vector<llvm::Value *> &, llvm::Value *, llvm::Value *time_ptr,
+                                          std::uint32_t, std::uint32_t order, std::uint32_t,
+                                          std::uint32_t batch_size) const
+{
+    return ephem_codegen_eval<mppp::real128>(s, *this, time_ptr, s.builder().getInt32(order), batch_size);
+}
+
+#endif
+
+namespace
+{
+
+template <typename T>
+llvm::Function *taylor_c_diff_ephem_impl(llvm_state &s, const ephem_impl &fn, std::uint32_t batch_size)
+{
+    auto &module = s.module();
+    auto &builder = s.builder();
+    auto &context = s.context();
+
+    // Fetch the floating-point type.
+    auto val_t = to_llvm_vector_type<T>(context, batch_size);
+
+    // Compose the function name.
+    // NOTE: the name of the function identifies
+    // the trajectory and the component.
+    const auto fname = fmt::format("heyoka_taylor_diff_{}_{}", fn.get_name(), taylor_mangle_suffix(val_t));
+
+    // The function arguments:
+    // - diff order,
+    // - idx of the u variable whose diff is being computed,
+    // - diff array,
+    // - par ptr,
+    // - time ptr.
+    std::vector<llvm::Type *> fargs{
+        llvm::Type::getInt32Ty(context), llvm::Type::getInt32Ty(context), llvm::PointerType::getUnqual(val_t),
+        llvm::PointerType::getUnqual(to_llvm_type<T>(context)), llvm::PointerType::getUnqual(to_llvm_type<T>(context))};
+
+    // Try to see if we already created the function.
+    auto f = module.getFunction(fname);
+
+    if (f == nullptr) {
+        // The function was not created before, do it now.
+
+        // Fetch the current insertion block.
+        auto orig_bb = builder.GetInsertBlock();
+
+        // The return type is val_t.
+        auto *ft = llvm::FunctionType::get(val_t, fargs, false);
+        // Create the function
+        f = llvm::Function::Create(ft, llvm::Function::InternalLinkage, fname, &module);
+        assert(f != nullptr);
+
+        // Fetch the necessary function arguments.
+        auto ord = f->args().begin();
+        auto t_ptr = f->args().begin() + 4;
+
+        // Create a new basic block to start insertion into.
+        builder.SetInsertPoint(llvm::BasicBlock::Create(context, "entry", f));
+
+        // Compute and return the result.
+        builder.CreateRet(ephem_codegen_eval<T>(s, fn, t_ptr, ord, batch_size));
+
+        // Verify.
+        s.verify_function(f);
+
+        // Restore the original insertion block.
+        builder.SetInsertPoint(orig_bb);
+    } else {
+        // The function was created before. Check if the signatures match.
+        // NOTE: there could be a mismatch if the derivative function was created
+        // and then optimised - optimisation might remove arguments which are compile-time
+        // constants.
+        if (!compare_function_signature(f, val_t, fargs)) {
+            throw std::invalid_argument("Inconsistent function signature for the Taylor derivative of " + fn.get_name()
+                                        + "() in compact mode detected");
+        }
+    }
+
+    return f;
+}
+
+} // namespace
+
+llvm::Function *ephem_impl::taylor_c_diff_func_dbl(llvm_state &s, std::uint32_t, std::uint32_t batch_size) const
+{
+    return taylor_c_diff_ephem_impl<double>(s, *this, batch_size);
+}
+
+llvm::Function *ephem_impl::taylor_c_diff_func_ldbl(llvm_state &s, std::uint32_t, std::uint32_t batch_size) const
+{
+    return taylor_c_diff_ephem_impl<long double>(s, *this, batch_size);
+}
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+llvm::Function *ephem_impl::taylor_c_diff_func_f128(llvm_state &s, std::uint32_t, std::uint32_t batch_size) const
+{
+    return taylor_c_diff_ephem_impl<mppp::real128>(s, *this, batch_size);
+}
+
+#endif
+
+} // namespace detail
+
+template <typename T>
+std::vector<expression> ephem(const taylor_cheb_traj<T> &traj)
+{
+    // NOTE: the functions are compared by name, hence each
+    // trajectory is identified by a unique id.
+    static std::atomic<unsigned long long> counter(0);
+
+    if (traj.get_n_steps() == 0u) {
+        throw std::invalid_argument("Cannot create the functions of an empty trajectory");
+    }
+
+    const auto id = counter++;
+    const auto ptr = std::make_shared<const taylor_cheb_traj<T>>(traj);
+
+    std::vector<expression> retval;
+    for (std::uint32_t i = 0; i < traj.get_dim(); ++i) {
+        retval.emplace_back(func{detail::ephem_impl{"ephem_" + std::to_string(id) + "_" + std::to_string(i), ptr, i}});
+    }
+
+    return retval;
+}
+
+// Explicit instantiations.
+template HEYOKA_DLL_PUBLIC std::vector<expression> ephem(const taylor_cheb_traj<double> &);
+template HEYOKA_DLL_PUBLIC std::vector<expression> ephem(const taylor_cheb_traj<long double> &);
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+template HEYOKA_DLL_PUBLIC std::vector<expression> ephem(const taylor_cheb_traj<mppp::real128> &);
+
+#endif
+
+} // namespace heyoka
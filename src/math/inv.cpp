@@ -0,0 +1,23 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <utility>
+
+#include <heyoka/expression.hpp>
+#include <heyoka/math/inv.hpp>
+#include <heyoka/math/pow.hpp>
+
+namespace heyoka
+{
+
+expression inv(expression e)
+{
+    return pow(std::move(e), -1.);
+}
+
+} // namespace heyoka
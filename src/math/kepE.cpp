@@ -0,0 +1,719 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <heyoka/config.hpp>
+
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <initializer_list>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include <boost/numeric/conversion/cast.hpp>
+
+#include <fmt/format.h>
+
+#include <llvm/IR/BasicBlock.h>
+#include <llvm/IR/DerivedTypes.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+#include <llvm/IR/Type.h>
+#include <llvm/IR/Value.h>
+#include <llvm/Support/Casting.h>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <heyoka/binary_operator.hpp>
+#include <heyoka/detail/eval_scratch.hpp>
+#include <heyoka/detail/llvm_helpers.hpp>
+#include <heyoka/detail/string_conv.hpp>
+#include <heyoka/detail/taylor_common.hpp>
+#include <heyoka/expression.hpp>
+#include <heyoka/func.hpp>
+#include <heyoka/llvm_state.hpp>
+#include <heyoka/math/cos.hpp>
+#include <heyoka/math/kepE.hpp>
+#include <heyoka/math/sin.hpp>
+#include <heyoka/number.hpp>
+#include <heyoka/taylor.hpp>
+#include <heyoka/variable.hpp>
+
+namespace heyoka
+{
+
+namespace detail
+{
+
+kepE_impl::kepE_impl(expression e, expression M) : func_base("kepE", std::vector{std::move(e), std::move(M)}) {}
+
+kepE_impl::kepE_impl() : kepE_impl(0_dbl, 0_dbl) {}
+
+namespace
+{
+
+// The maximum number of Newton iterations in the solution
+// of Kepler's equation.
+constexpr std::uint32_t kepE_max_iter = 50;
+
+// Solve Kepler's equation E - e * sin(E) = M via Newton iterations,
+// starting from Danby's initial guess E0 = M + 0.85 * e * sign(sin(M)).
+// The iterations stop when the relative correction is below 4 epsilon.
+double kepE_num(double e, double M)
+{
+    if (!(e >= 0 && e < 1)) {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+
+    auto E = M + (std::sin(M) < 0 ? -0.85 : 0.85) * e;
+    const auto tol = 4 * std::numeric_limits<double>::epsilon();
+
+    for (std::uint32_t i = 0; i < kepE_max_iter; ++i) {
+        const auto delta = (E - e * std::sin(E) - M) / (1 - e * std::cos(E));
+        E -= delta;
+
+        if (std::abs(delta) <= tol * std::abs(E)) {
+            break;
+        }
+    }
+
+    return E;
+}
+
+// Create an alloca in the entry block of the current function, so that
+// the stack allocation is not repeated if the current block ends up
+// being executed in a loop.
+llvm::Value *kepE_entry_alloca(ir_builder &builder, llvm::Type *tp)
+{
+    assert(builder.GetInsertBlock() != nullptr);
+    auto &entry_bb = builder.GetInsertBlock()->getParent()->getEntryBlock();
+
+    llvm::IRBuilderBase::InsertPointGuard ipg(builder);
+    builder.SetInsertPoint(&entry_bb, entry_bb.getFirstInsertionPt());
+
+    return builder.CreateAlloca(tp);
+}
+
+// Compute the sine and the cosine of x, via sincos() if available.
+template <typename T>
+std::pair<llvm::Value *, llvm::Value *> kepE_sincos(llvm_state &s, llvm::Value *x)
+{
+    if (const auto ret = llvm_sleef_sincos(s, x); ret.first != nullptr) {
+        return ret;
+    }
+
+    return {codegen_from_values<T>(s, sin_impl{}, {x}), codegen_from_values<T>(s, cos_impl{}, {x})};
+}
+
+// The codegen of kepE(e, M): the Newton iterations of kepE_num() are run
+// on all the batch elements at once, until the convergence criterion is
+// satisfied by all of them.
+template <typename T>
+llvm::Value *kepE_codegen_impl(llvm_state &s, llvm::Value *e, llvm::Value *M)
+{
+    assert(e != nullptr);
+    assert(M != nullptr);
+    assert(e->getType() == M->getType());
+
+    auto &builder = s.builder();
+
+    // Fetch the floating-point type and the batch size.
+    auto *fp_t = e->getType();
+    std::uint32_t batch_size = 1;
+    if (auto vec_t = llvm::dyn_cast<llvm::VectorType>(fp_t)) {
+        batch_size = boost::numeric_cast<std::uint32_t>(vec_t->getNumElements());
+    }
+
+    auto splat = [&](const T &x) { return vector_splat(builder, codegen<T>(s, number(x)), batch_size); };
+
+    auto *zero = splat(T(0));
+    auto *one = splat(T(1));
+    auto *tol = splat(4 * std::numeric_limits<T>::epsilon());
+
+    // The initial guess.
+    auto *fac = builder.CreateSelect(builder.CreateFCmpOLT(codegen_from_values<T>(s, sin_impl{}, {M}), zero),
+                                     splat(static_cast<T>(-0.85)), splat(static_cast<T>(0.85)));
+    auto *E_ptr = kepE_entry_alloca(builder, fp_t);
+    builder.CreateStore(builder.CreateFAdd(M, builder.CreateFMul(fac, e)), E_ptr);
+
+    // NOTE: the loop is interrupted by setting the next
+    // value of the counter to kepE_max_iter.
+    llvm::Value *all_conv = nullptr;
+    llvm_loop_u32(
+        s, builder.getInt32(0), builder.getInt32(kepE_max_iter),
+        [&](llvm::Value *) {
+            auto *E = builder.CreateLoad(E_ptr);
+            const auto sc = kepE_sincos<T>(s, E);
+
+            // delta = (E - e * sin(E) - M) / (1 - e * cos(E)).
+            llvm::Value *delta
+                = builder.CreateFDiv(builder.CreateFSub(builder.CreateFSub(E, builder.CreateFMul(e, sc.first)), M),
+                                     builder.CreateFSub(one, builder.CreateFMul(e, sc.second)));
+            llvm::Value *E_new = builder.CreateFSub(E, delta);
+            builder.CreateStore(E_new, E_ptr);
+
+            // Check the convergence of the batch elements.
+            auto *conv = builder.CreateFCmpOLE(llvm_invoke_intrinsic(s, "llvm.fabs", {fp_t}, {delta}),
+                                               builder.CreateFMul(tol, llvm_invoke_intrinsic(s, "llvm.fabs", {fp_t},
+                                                                                             {E_new})));
+            auto flags = vector_to_scalars(builder, conv);
+            all_conv = flags[0];
+            for (decltype(flags.size()) i = 1; i < flags.size(); ++i) {
+                all_conv = builder.CreateAnd(all_conv, flags[i]);
+            }
+        },
+        [&](llvm::Value *cur) {
+            assert(all_conv != nullptr);
+
+            return builder.CreateSelect(all_conv, builder.getInt32(kepE_max_iter),
+                                        builder.CreateAdd(cur, builder.getInt32(1)));
+        });
+
+    // Return NaN for the eccentricities outside the [0, 1) range.
+    auto *e_ok = builder.CreateAnd(builder.CreateFCmpOGE(e, zero), builder.CreateFCmpOLT(e, one));
+
+    return builder.CreateSelect(e_ok, builder.CreateLoad(E_ptr), splat(std::numeric_limits<T>::quiet_NaN()));
+}
+
+} // namespace
+
+llvm::Value *kepE_impl::codegen_dbl(llvm_state &s, const std::vector<llvm::Value *> &args) const
+{
+    assert(args.size() == 2u);
+
+    return kepE_codegen_impl<double>(s, args[0], args[1]);
+}
+
+llvm::Value *kepE_impl::codegen_ldbl(llvm_state &s, const std::vector<llvm::Value *> &args) const
+{
+    assert(args.size() == 2u);
+
+    return kepE_codegen_impl<long double>(s, args[0], args[1]);
+}
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+llvm::Value *kepE_impl::codegen_f128(llvm_state &s, const std::vector<llvm::Value *> &args) const
+{
+    assert(args.size() == 2u);
+
+    return kepE_codegen_impl<mppp::real128>(s, args[0], args[1]);
+}
+
+#endif
+
+double kepE_impl::eval_dbl(const std::unordered_map<std::string, double> &map, const std::vector<double> &pars) const
+{
+    assert(args().size() == 2u);
+
+    return kepE_num(heyoka::eval_dbl(args()[0], map, pars), heyoka::eval_dbl(args()[1], map, pars));
+}
+
+void kepE_impl::eval_batch_dbl(std::vector<double> &out,
+                               const std::unordered_map<std::string, std::vector<double>> &map,
+                               const std::vector<double> &pars) const
+{
+    assert(args().size() == 2u);
+
+    detail::eval_scratch es;
+    auto &out0 = es.get();
+    out0.resize(out.size());
+
+    heyoka::eval_batch_dbl(out0, args()[0], map, pars);
+    heyoka::eval_batch_dbl(out, args()[1], map, pars);
+    for (decltype(out.size()) i = 0; i < out.size(); ++i) {
+        out[i] = kepE_num(out0[i], out[i]);
+    }
+}
+
+double kepE_impl::eval_num_dbl(const std::vector<double> &a) const
+{
+    if (a.size() != 2u) {
+        using namespace fmt::literals;
+
+        throw std::invalid_argument(
+            "Inconsistent number of arguments when computing the numerical value of the "
+            "eccentric anomaly over doubles (2 arguments were expected, but {} arguments were provided"_format(
+                a.size()));
+    }
+
+    return kepE_num(a[0], a[1]);
+}
+
+double kepE_impl::deval_num_dbl(const std::vector<double> &a, std::vector<double>::size_type i) const
+{
+    if (a.size() != 2u || i > 1u) {
+        throw std::invalid_argument("Inconsistent number of arguments or derivative requested when computing "
+                                    "the numerical derivative of the eccentric anomaly");
+    }
+
+    const auto E = kepE_num(a[0], a[1]);
+
+    // dE/de = sin(E) / (1 - e * cos(E)), dE/dM = 1 / (1 - e * cos(E)).
+    return (i == 0u ? std::sin(E) : 1.) / (1 - a[0] * std::cos(E));
+}
+
+// NOTE: the decomposition of kepE(e, M) appends, after kepE(e, M) itself (E in the following):
+// - sin(E) and cos(E), with their usual hidden deps,
+// - e * cos(E).
+// sin(E) and e * cos(E) are the hidden deps of E, which are needed in the Taylor recurrence.
+std::vector<std::pair<expression, std::vector<std::uint32_t>>>::size_type
+kepE_impl::taylor_decompose(std::vector<std::pair<expression, std::vector<std::uint32_t>>> &u_vars_defs) &&
+{
+    assert(args().size() == 2u);
+
+    // Decompose the arguments.
+    for (auto [b, e] = get_mutable_args_it(); b != e; ++b) {
+        if (const auto dres = taylor_decompose_in_place(std::move(*b), u_vars_defs)) {
+            *b = expression{detail::make_u_var(boost::numeric_cast<std::uint32_t>(dres))};
+        }
+    }
+
+    // Save a copy of the decomposed eccentricity.
+    auto e_arg = args()[0];
+
+    // Append the kepE decomposition.
+    u_vars_defs.emplace_back(func{std::move(*this)}, std::vector<std::uint32_t>{});
+
+    // Compute the return value (pointing to the
+    // decomposed kepE).
+    const auto retval = u_vars_defs.size() - 1u;
+    const auto E = expression{detail::make_u_var(boost::numeric_cast<std::uint32_t>(retval))};
+
+    // Append the sine and cosine decompositions.
+    u_vars_defs.emplace_back(sin(E), std::vector<std::uint32_t>{});
+    u_vars_defs.emplace_back(cos(E), std::vector<std::uint32_t>{});
+    (u_vars_defs.end() - 2)->second.push_back(boost::numeric_cast<std::uint32_t>(u_vars_defs.size() - 1u));
+    (u_vars_defs.end() - 1)->second.push_back(boost::numeric_cast<std::uint32_t>(u_vars_defs.size() - 2u));
+
+    // Append e * cos(E).
+    // NOTE: the binary operator is built directly in order
+    // to avoid the simplifications of operator*() (e.g., if e is zero).
+    u_vars_defs.emplace_back(
+        binary_operator{binary_operator::type::mul, std::move(e_arg),
+                        expression{detail::make_u_var(boost::numeric_cast<std::uint32_t>(u_vars_defs.size() - 1u))}},
+        std::vector<std::uint32_t>{});
+
+    // Add the hidden deps.
+    u_vars_defs[retval].second.push_back(boost::numeric_cast<std::uint32_t>(retval + 1u));
+    u_vars_defs[retval].second.push_back(boost::numeric_cast<std::uint32_t>(u_vars_defs.size() - 1u));
+
+    return retval;
+}
+
+namespace
+{
+
+// The argument types for which the Taylor derivatives of kepE() are implemented.
+template <typename U>
+inline constexpr bool kepE_is_arg_v = std::disjunction_v<std::is_same<U, variable>, is_num_param<U>>;
+
+template <typename U, typename V>
+inline constexpr bool kepE_are_args_v = kepE_is_arg_v<U> && kepE_is_arg_v<V>;
+
+// Order-0 derivative of an argument of kepE().
+template <typename T, typename U>
+llvm::Value *taylor_diff_kepE_arg0(llvm_state &s, const U &a, const std::vector<llvm::Value *> &arr,
+                                   llvm::Value *par_ptr, std::uint32_t n_uvars, std::uint32_t batch_size)
+{
+    if constexpr (std::is_same_v<U, variable>) {
+        return taylor_fetch_diff(arr, uname_to_index(a), 0, n_uvars);
+    } else {
+        return taylor_codegen_numparam<T>(s, a, par_ptr, batch_size);
+    }
+}
+
+// Derivative of kepE(e, M), with e and M variables, numbers or params.
+// Differentiating Kepler's equation w.r.t. time yields E' * (1 - D) = M' + e' * sin(E),
+// with D = e * cos(E). The Taylor recurrence then reads:
+//
+// E^[n] = (n * M^[n] + sum_{j=0}^{n-1} (n - j) * e^[n-j] * sin(E)^[j]
+//          + sum_{j=1}^{n-1} (n - j) * D^[j] * E^[n-j]) / (n * (1 - D^[0])),
+//
+// where the terms containing the derivatives of numbers and params vanish.
+template <typename T, typename U, typename V, std::enable_if_t<kepE_are_args_v<U, V>, int> = 0>
+llvm::Value *taylor_diff_kepE_impl(llvm_state &s, const std::vector<std::uint32_t> &deps, const U &e, const V &M,
+                                   const std::vector<llvm::Value *> &arr, llvm::Value *par_ptr, std::uint32_t n_uvars,
+                                   std::uint32_t order, std::uint32_t idx, std::uint32_t batch_size)
+{
+    auto &builder = s.builder();
+
+    if (order == 0u) {
+        return kepE_codegen_impl<T>(s, taylor_diff_kepE_arg0<T>(s, e, arr, par_ptr, n_uvars, batch_size),
+                                    taylor_diff_kepE_arg0<T>(s, M, arr, par_ptr, n_uvars, batch_size));
+    }
+
+    auto fac = [&](std::uint32_t n) {
+        return vector_splat(builder, codegen<T>(s, number(static_cast<T>(n))), batch_size);
+    };
+
+    std::vector<llvm::Value *> sum;
+
+    if constexpr (std::is_same_v<V, variable>) {
+        sum.push_back(builder.CreateFMul(fac(order), taylor_fetch_diff(arr, uname_to_index(M), order, n_uvars)));
+    }
+
+    if constexpr (std::is_same_v<U, variable>) {
+        const auto e_idx = uname_to_index(e);
+
+        for (std::uint32_t j = 0; j < order; ++j) {
+            // NOTE: the first hidden dependency contains the index of the
+            // u variable whose definition is sin(E).
+            auto v0 = taylor_fetch_diff(arr, e_idx, order - j, n_uvars);
+            auto v1 = taylor_fetch_diff(arr, deps[0], j, n_uvars);
+
+            sum.push_back(builder.CreateFMul(fac(order - j), builder.CreateFMul(v0, v1)));
+        }
+    }
+
+    for (std::uint32_t j = 1; j < order; ++j) {
+        // NOTE: the second hidden dependency contains the index of the
+        // u variable whose definition is e * cos(E).
+        auto v0 = taylor_fetch_diff(arr, deps[1], j, n_uvars);
+        auto v1 = taylor_fetch_diff(arr, idx, order - j, n_uvars);
+
+        sum.push_back(builder.CreateFMul(fac(order - j), builder.CreateFMul(v0, v1)));
+    }
+
+    if (sum.empty()) {
+        // NOTE: this happens only for order 1 when both e and M
+        // are numbers/params.
+        return vector_splat(builder, codegen<T>(s, number{0.}), batch_size);
+    }
+
+    // Init the return value as the result of the sum.
+    auto ret_acc = pairwise_sum(builder, sum);
+
+    // Compute and return the result: ret_acc / (order * (1 - D^[0])).
+    auto div = builder.CreateFMul(fac(order), builder.CreateFSub(fac(1), taylor_fetch_diff(arr, deps[1], 0, n_uvars)));
+
+    return builder.CreateFDiv(ret_acc, div);
+}
+
+// All the other cases.
+template <typename T, typename U, typename V, std::enable_if_t<!kepE_are_args_v<U, V>, int> = 0>
+llvm::Value *taylor_diff_kepE_impl(llvm_state &, const std::vector<std::uint32_t> &, const U &, const V &,
+                                   const std::vector<llvm::Value *> &, llvm::Value *, std::uint32_t, std::uint32_t,
+                                   std::uint32_t, std::uint32_t)
+{
+    throw std::invalid_argument(
+        "An invalid argument type was encountered while trying to build the Taylor derivative of kepE()");
+}
+
+template <typename T>
+llvm::Value *taylor_diff_kepE(llvm_state &s, const kepE_impl &f, const std::vector<std::uint32_t> &deps,
+                              const std::vector<llvm::Value *> &arr, llvm::Value *par_ptr, std::uint32_t n_uvars,
+                              std::uint32_t order, std::uint32_t idx, std::uint32_t batch_size)
+{
+    assert(f.args().size() == 2u);
+
+    if (deps.size() != 2u) {
+        using namespace fmt::literals;
+
+        throw std::invalid_argument(
+            "A hidden dependency vector of size 2 is expected in order to compute the Taylor "
+            "derivative of kepE(), but a vector of size {} was passed instead"_format(deps.size()));
+    }
+
+    return std::visit(
+        [&](const auto &v1, const auto &v2) {
+            return taylor_diff_kepE_impl<T>(s, deps, v1, v2, arr, par_ptr, n_uvars, order, idx, batch_size);
+        },
+        f.args()[0].value(), f.args()[1].value());
+}
+
+} // namespace
+
+llvm::Value *kepE_impl::taylor_diff_dbl(llvm_state &s, const std::vector<std::uint32_t> &deps,
+                                        const std::vector<llvm::Value *> &arr, llvm::Value *par_ptr, llvm::Value *,
+                                        std::uint32_t n_uvars, std::uint32_t order, std::uint32_t idx,
+                                        std::uint32_t batch_size) const
+{
+    return taylor_diff_kepE<double>(s, *this, deps, arr, par_ptr, n_uvars, order, idx, batch_size);
+}
+
+llvm::Value *kepE_impl::taylor_diff_ldbl(llvm_state &s, const std::vector<std::uint32_t> &deps,
+                                         const std::vector<llvm::Value *> &arr, llvm::Value *par_ptr, llvm::Value *,
+                                         std::uint32_t n_uvars, std::uint32_t order, std::uint32_t idx,
+                                         std::uint32_t batch_size) const
+{
+    return taylor_diff_kepE<long double>(s, *this, deps, arr, par_ptr, n_uvars, order, idx, batch_size);
+}
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+llvm::Value *kepE_impl::taylor_diff_f128(llvm_state &s, const std::vector<std::uint32_t> &deps,
+                                         const std::vector<llvm::Value *> &arr, llvm::Value *par_ptr, llvm::Value *,
+                                         std::uint32_t n_uvars, std::uint32_t order, std::uint32_t idx,
+                                         std::uint32_t batch_size) const
+{
+    return taylor_diff_kepE<mppp::real128>(s, *this, deps, arr, par_ptr, n_uvars, order, idx, batch_size);
+}
+
+#endif
+
+namespace
+{
+
+// Helpers for the arguments of kepE() in compact mode: the variables
+// are passed as indices, the numbers/params as in the other functions.
+template <typename U>
+std::string taylor_c_diff_kepE_mangle(const U &a)
+{
+    if constexpr (std::is_same_v<U, variable>) {
+        return "var";
+    } else {
+        return taylor_c_diff_numparam_mangle(a);
+    }
+}
+
+template <typename T, typename U>
+llvm::Type *taylor_c_diff_kepE_argtype(llvm_state &s, const U &a)
+{
+    if constexpr (std::is_same_v<U, variable>) {
+        return llvm::Type::getInt32Ty(s.context());
+    } else {
+        return taylor_c_diff_numparam_argtype<T>(s, a);
+    }
+}
+
+template <typename T, typename U>
+llvm::Value *taylor_c_diff_kepE_arg0(llvm_state &s, const U &a, llvm::Value *arg, llvm::Value *diff_ptr,
+                                     llvm::Value *par_ptr, std::uint32_t n_uvars, std::uint32_t batch_size)
+{
+    if constexpr (std::is_same_v<U, variable>) {
+        return taylor_c_load_diff(s, diff_ptr, n_uvars, s.builder().getInt32(0), arg);
+    } else {
+        return taylor_c_diff_numparam_codegen(s, a, arg, par_ptr, batch_size);
+    }
+}
+
+// Derivative of kepE(e, M), with e and M variables, numbers or params.
+template <typename T, typename U, typename V, std::enable_if_t<kepE_are_args_v<U, V>, int> = 0>
+llvm::Function *taylor_c_diff_func_kepE_impl(llvm_state &s, const U &e, const V &M, std::uint32_t n_uvars,
+                                             std::uint32_t batch_size)
+{
+    using namespace fmt::literals;
+
+    auto &module = s.module();
+    auto &builder = s.builder();
+    auto &context = s.context();
+
+    // Fetch the floating-point type.
+    auto val_t = to_llvm_vector_type<T>(context, batch_size);
+
+    // Get the function name.
+    const auto fname = "heyoka_taylor_diff_kepE_{}_{}_{}_n_uvars_{}"_format(
+        taylor_c_diff_kepE_mangle(e), taylor_c_diff_kepE_mangle(M), taylor_mangle_suffix(val_t), li_to_string(n_uvars));
+
+    // The function arguments:
+    // - diff order,
+    // - idx of the u variable whose diff is being computed,
+    // - diff array,
+    // - par ptr,
+    // - time ptr,
+    // - eccentricity argument,
+    // - mean anomaly argument,
+    // - idx of the uvar whose definition is sin(E),
+    // - idx of the uvar whose definition is e * cos(E).
+    std::vector<llvm::Type *> fargs{llvm::Type::getInt32Ty(context),
+                                    llvm::Type::getInt32Ty(context),
+                                    llvm::PointerType::getUnqual(val_t),
+                                    llvm::PointerType::getUnqual(to_llvm_type<T>(context)),
+                                    llvm::PointerType::getUnqual(to_llvm_type<T>(context)),
+                                    taylor_c_diff_kepE_argtype<T>(s, e),
+                                    taylor_c_diff_kepE_argtype<T>(s, M),
+                                    llvm::Type::getInt32Ty(context),
+                                    llvm::Type::getInt32Ty(context)};
+
+    // Try to see if we already created the function.
+    auto f = module.getFunction(fname);
+
+    if (f == nullptr) {
+        // The function was not created before, do it now.
+
+        // Fetch the current insertion block.
+        auto orig_bb = builder.GetInsertBlock();
+
+        // The return type is val_t.
+        auto *ft = llvm::FunctionType::get(val_t, fargs, false);
+        // Create the function
+        f = llvm::Function::Create(ft, llvm::Function::InternalLinkage, fname, &module);
+        assert(f != nullptr);
+
+        // Fetch the necessary function arguments.
+        auto ord = f->args().begin();
+        auto u_idx = f->args().begin() + 1;
+        auto diff_ptr = f->args().begin() + 2;
+        auto par_ptr = f->args().begin() + 3;
+        auto e_arg = f->args().begin() + 5;
+        auto M_arg = f->args().begin() + 6;
+        auto sin_idx = f->args().begin() + 7;
+        auto D_idx = f->args().begin() + 8;
+
+        // Create a new basic block to start insertion into.
+        builder.SetInsertPoint(llvm::BasicBlock::Create(context, "entry", f));
+
+        // Create the return value.
+        auto retval = builder.CreateAlloca(val_t);
+
+        // Create the accumulator.
+        auto acc = builder.CreateAlloca(val_t);
+
+        llvm_if_then_else(
+            s, builder.CreateICmpEQ(ord, builder.getInt32(0)),
+            [&]() {
+                // For order 0, solve Kepler's equation.
+                builder.CreateStore(
+                    kepE_codegen_impl<T>(
+                        s, taylor_c_diff_kepE_arg0<T>(s, e, e_arg, diff_ptr, par_ptr, n_uvars, batch_size),
+                        taylor_c_diff_kepE_arg0<T>(s, M, M_arg, diff_ptr, par_ptr, n_uvars, batch_size)),
+                    retval);
+            },
+            [&]() {
+                auto ord_v = vector_splat(builder, builder.CreateUIToFP(ord, to_llvm_type<T>(context)), batch_size);
+
+                // Init the accumulator.
+                builder.CreateStore(vector_splat(builder, codegen<T>(s, number{0.}), batch_size), acc);
+
+                if constexpr (std::is_same_v<V, variable>) {
+                    builder.CreateStore(
+                        builder.CreateFMul(ord_v, taylor_c_load_diff(s, diff_ptr, n_uvars, ord, M_arg)), acc);
+                }
+
+                if constexpr (std::is_same_v<U, variable>) {
+                    llvm_loop_u32(s, builder.getInt32(0), ord, [&](llvm::Value *j) {
+                        auto e_nj = taylor_c_load_diff(s, diff_ptr, n_uvars, builder.CreateSub(ord, j), e_arg);
+                        auto sin_j = taylor_c_load_diff(s, diff_ptr, n_uvars, j, sin_idx);
+
+                        auto fac = vector_splat(
+                            builder, builder.CreateUIToFP(builder.CreateSub(ord, j), to_llvm_type<T>(context)),
+                            batch_size);
+
+                        auto term = builder.CreateFMul(fac, builder.CreateFMul(e_nj, sin_j));
+                        builder.CreateStore(builder.CreateFAdd(builder.CreateLoad(acc), term), acc);
+                    });
+                }
+
+                llvm_loop_u32(s, builder.getInt32(1), ord, [&](llvm::Value *j) {
+                    auto D_j = taylor_c_load_diff(s, diff_ptr, n_uvars, j, D_idx);
+                    auto E_nj = taylor_c_load_diff(s, diff_ptr, n_uvars, builder.CreateSub(ord, j), u_idx);
+
+                    auto fac = vector_splat(
+                        builder, builder.CreateUIToFP(builder.CreateSub(ord, j), to_llvm_type<T>(context)), batch_size);
+
+                    auto term = builder.CreateFMul(fac, builder.CreateFMul(D_j, E_nj));
+                    builder.CreateStore(builder.CreateFAdd(builder.CreateLoad(acc), term), acc);
+                });
+
+                // Divide by order * (1 - D^[0]) to produce the return value.
+                auto one = vector_splat(builder, codegen<T>(s, number{1.}), batch_size);
+                auto D_0 = taylor_c_load_diff(s, diff_ptr, n_uvars, builder.getInt32(0), D_idx);
+                auto div = builder.CreateFMul(ord_v, builder.CreateFSub(one, D_0));
+                builder.CreateStore(builder.CreateFDiv(builder.CreateLoad(acc), div), retval);
+            });
+
+        // Return the result.
+        builder.CreateRet(builder.CreateLoad(retval));
+
+        // Verify.
+        s.verify_function(f);
+
+        // Restore the original insertion block.
+        builder.SetInsertPoint(orig_bb);
+    } else {
+        // The function was created before. Check if the signatures match.
+        // NOTE: there could be a mismatch if the derivative function was created
+        // and then optimised - optimisation might remove arguments which are compile-time
+        // constants.
+        if (!compare_function_signature(f, val_t, fargs)) {
+            throw std::invalid_argument(
+                "Inconsistent function signature for the Taylor derivative of kepE() in compact mode detected");
+        }
+    }
+
+    return f;
+}
+
+// All the other cases.
+template <typename T, typename U, typename V, std::enable_if_t<!kepE_are_args_v<U, V>, int> = 0>
+llvm::Function *taylor_c_diff_func_kepE_impl(llvm_state &, const U &, const V &, std::uint32_t, std::uint32_t)
+{
+    throw std::invalid_argument("An invalid argument type was encountered while trying to build the Taylor derivative "
+                                "of kepE() in compact mode");
+}
+
+template <typename T>
+llvm::Function *taylor_c_diff_func_kepE(llvm_state &s, const kepE_impl &fn, std::uint32_t n_uvars,
+                                        std::uint32_t batch_size)
+{
+    assert(fn.args().size() == 2u);
+
+    return std::visit(
+        [&](const auto &v1, const auto &v2) {
+            return taylor_c_diff_func_kepE_impl<T>(s, v1, v2, n_uvars, batch_size);
+        },
+        fn.args()[0].value(), fn.args()[1].value());
+}
+
+} // namespace
+
+llvm::Function *kepE_impl::taylor_c_diff_func_dbl(llvm_state &s, std::uint32_t n_uvars, std::uint32_t batch_size) const
+{
+    return taylor_c_diff_func_kepE<double>(s, *this, n_uvars, batch_size);
+}
+
+llvm::Function *kepE_impl::taylor_c_diff_func_ldbl(llvm_state &s, std::uint32_t n_uvars,
+                                                   std::uint32_t batch_size) const
+{
+    return taylor_c_diff_func_kepE<long double>(s, *this, n_uvars, batch_size);
+}
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+llvm::Function *kepE_impl::taylor_c_diff_func_f128(llvm_state &s, std::uint32_t n_uvars,
+                                                   std::uint32_t batch_size) const
+{
+    return taylor_c_diff_func_kepE<mppp::real128>(s, *this, n_uvars, batch_size);
+}
+
+#endif
+
+// dE = (dM + sin(E) * de) / (1 - e * cos(E)).
+expression kepE_impl::diff(const std::string &s) const
+{
+    assert(args().size() == 2u);
+
+    const auto &e = args()[0];
+    const auto &M = args()[1];
+
+    const auto E = kepE(e, M);
+
+    return (heyoka::diff(M, s) + sin(E) * heyoka::diff(e, s)) / (1_dbl - e * cos(E));
+}
+
+} // namespace detail
+
+expression kepE(expression e, expression M)
+{
+    return expression{func{detail::kepE_impl(std::move(e), std::move(M))}};
+}
+
+} // namespace heyoka
@@ -8,10 +8,12 @@
 
 #include <heyoka/config.hpp>
 
+#include <algorithm>
 #include <cassert>
 #include <cmath>
 #include <cstdint>
 #include <initializer_list>
+#include <iterator>
 #include <stdexcept>
 #include <string>
 #include <type_traits>
@@ -26,6 +28,7 @@
 
 #include <llvm/IR/Attributes.h>
 #include <llvm/IR/BasicBlock.h>
+#include <llvm/IR/Constants.h>
 #include <llvm/IR/DerivedTypes.h>
 #include <llvm/IR/Function.h>
 #include <llvm/IR/Instructions.h>
@@ -39,12 +42,13 @@
 
 #endif
 
+#include <heyoka/detail/eval_scratch.hpp>
 #include <heyoka/detail/llvm_helpers.hpp>
-#include <heyoka/detail/sleef.hpp>
 #include <heyoka/detail/string_conv.hpp>
 #include <heyoka/detail/taylor_common.hpp>
 #include <heyoka/expression.hpp>
 #include <heyoka/func.hpp>
+#include <heyoka/interval.hpp>
 #include <heyoka/llvm_state.hpp>
 #include <heyoka/math/log.hpp>
 #include <heyoka/math/pow.hpp>
@@ -76,6 +80,114 @@ bool pow_allow_approx(const pow_impl &pi)
     return is_integral(pi.args()[1]) || is_odd_integral_half(pi.args()[1]);
 }
 
+// The numerical exponents for which pow() has a dedicated
+// implementation:
+// - 2, which is implemented as a multiplication and whose
+//   Taylor recurrence is the (division-free) one of square(),
+// - -1, -1/2 and -3/2 (the latter being the exponent of the r**-3 terms
+//   in the gravitational N-body problem), which are implemented on top
+//   of divisions and sqrt() and for which the reciprocal of the base
+//   in the Taylor recurrence can be computed from the zero-th order
+//   derivatives of the base and of the power via multiplications.
+enum class pow_exp_kind { generic, two, m1, m1_2, m3_2 };
+
+pow_exp_kind pow_get_exp_kind(const pow_impl &pi)
+{
+    if (const auto nptr = std::get_if<number>(&pi.args()[1].value())) {
+        if (*nptr == number{2.}) {
+            return pow_exp_kind::two;
+        } else if (*nptr == number{-1.}) {
+            return pow_exp_kind::m1;
+        } else if (*nptr == number{-.5}) {
+            return pow_exp_kind::m1_2;
+        } else if (*nptr == number{-1.5}) {
+            return pow_exp_kind::m3_2;
+        }
+    }
+
+    return pow_exp_kind::generic;
+}
+
+// The mangling of the exponent kinds in the names
+// of the compact mode functions.
+const char *pow_exp_kind_mangle(pow_exp_kind k)
+{
+    switch (k) {
+        case pow_exp_kind::two:
+            return "_2";
+        case pow_exp_kind::m1:
+            return "_m1";
+        case pow_exp_kind::m1_2:
+            return "_m1_2";
+        case pow_exp_kind::m3_2:
+            return "_m3_2";
+        default:
+            return "";
+    }
+}
+
+// Compute x**e for the non-generic exponent kinds:
+// - x**2 as x * x,
+// - x**-1 as 1 / x,
+// - x**-1/2 as 1 / sqrt(x),
+// - x**-3/2 as 1 / (x * sqrt(x)).
+llvm::Value *pow_special_codegen(llvm_state &s, pow_exp_kind k, llvm::Value *x)
+{
+    assert(k != pow_exp_kind::generic);
+
+    auto &builder = s.builder();
+
+    if (k == pow_exp_kind::two) {
+        return builder.CreateFMul(x, x);
+    }
+
+    auto *one = llvm::ConstantFP::get(x->getType(), 1.);
+
+    if (s.fast_math() && k != pow_exp_kind::m1) {
+        // NOTE: in fast math mode, allow the backend to implement the
+        // reciprocal square roots of double-precision vectors via the hardware
+        // approximation (when available, e.g., vrsqrt14pd on AVX-512) refined
+        // with two Newton iterations, instead of a square root and a division.
+        if (auto *cur_f = builder.GetInsertBlock()->getParent();
+            cur_f != nullptr && !cur_f->hasFnAttribute("reciprocal-estimates")) {
+            cur_f->addFnAttr("reciprocal-estimates", "vec-sqrtd:2");
+        }
+    }
+
+    switch (k) {
+        case pow_exp_kind::m1:
+            return builder.CreateFDiv(one, x);
+        case pow_exp_kind::m1_2:
+            return builder.CreateFDiv(one, llvm_invoke_intrinsic(s, "llvm.sqrt", {x->getType()}, {x}));
+        default:
+            return builder.CreateFDiv(
+                one, builder.CreateFMul(x, llvm_invoke_intrinsic(s, "llvm.sqrt", {x->getType()}, {x})));
+    }
+}
+
+// For the exponent kinds -1, -1/2 and -3/2, compute the reciprocal
+// of the zero-th order derivative a0 of the base from a0 itself
+// and from the zero-th order derivative b0 = a0**e of the power:
+// - 1 / a0 = b0 for e = -1,
+// - 1 / a0 = b0**2 for e = -1/2,
+// - 1 / a0 = (a0 * b0)**2 for e = -3/2.
+llvm::Value *pow_special_base_inv(ir_builder &builder, pow_exp_kind k, llvm::Value *a0, llvm::Value *b0)
+{
+    switch (k) {
+        case pow_exp_kind::m1:
+            return b0;
+        case pow_exp_kind::m1_2:
+            return builder.CreateFMul(b0, b0);
+        default: {
+            assert(k == pow_exp_kind::m3_2);
+
+            auto a0b0 = builder.CreateFMul(a0, b0);
+
+            return builder.CreateFMul(a0b0, a0b0);
+        }
+    }
+}
+
 } // namespace
 
 llvm::Value *pow_impl::codegen_dbl(llvm_state &s, const std::vector<llvm::Value *> &args) const
@@ -84,22 +196,18 @@ llvm::Value *pow_impl::codegen_dbl(llvm_state &s, const std::vector<llvm::Value
     assert(args[0] != nullptr);
     assert(args[1] != nullptr);
 
+    if (const auto k = pow_get_exp_kind(*this); k != pow_exp_kind::generic) {
+        return pow_special_codegen(s, k, args[0]);
+    }
+
     const auto allow_approx = pow_allow_approx(*this);
 
     // NOTE: we want to try the SLEEF route only if we are *not* approximating
     // pow() with sqrt() or iterated multiplications (in which case we are fine
     // with the LLVM builtin).
-    if (auto vec_t = llvm::dyn_cast<llvm::VectorType>(args[0]->getType()); !allow_approx && vec_t != nullptr) {
-        if (const auto sfn = sleef_function_name(s.context(), "pow", vec_t->getElementType(),
-                                                 boost::numeric_cast<std::uint32_t>(vec_t->getNumElements()));
-            !sfn.empty()) {
-            return llvm_invoke_external(
-                s, sfn, vec_t, args,
-                // NOTE: in theory we may add ReadNone here as well,
-                // but for some reason, at least up to LLVM 10,
-                // this causes strange codegen issues. Revisit
-                // in the future.
-                {llvm::Attribute::NoUnwind, llvm::Attribute::Speculatable, llvm::Attribute::WillReturn});
+    if (!allow_approx) {
+        if (auto ret = llvm_invoke_sleef(s, "pow", args)) {
+            return ret;
         }
     }
 
@@ -118,6 +226,10 @@ llvm::Value *pow_impl::codegen_ldbl(llvm_state &s, const std::vector<llvm::Value
     assert(args[0] != nullptr);
     assert(args[1] != nullptr);
 
+    if (const auto k = pow_get_exp_kind(*this); k != pow_exp_kind::generic) {
+        return pow_special_codegen(s, k, args[0]);
+    }
+
     const auto allow_approx = pow_allow_approx(*this);
 
     auto ret = llvm_invoke_intrinsic(s, "llvm.pow", {args[0]->getType()}, args);
@@ -173,7 +285,10 @@ void pow_impl::eval_batch_dbl(std::vector<double> &out, const std::unordered_map
 {
     assert(args().size() == 2u);
 
-    auto out0 = out; // is this allocation needed?
+    detail::eval_scratch es;
+    auto &out0 = es.get();
+    out0.resize(out.size());
+
     heyoka::eval_batch_dbl(out0, args()[0], map, pars);
     heyoka::eval_batch_dbl(out, args()[1], map, pars);
     for (decltype(out.size()) i = 0; i < out.size(); ++i) {
@@ -234,13 +349,35 @@ llvm::Value *taylor_diff_pow_impl(llvm_state &s, const pow_impl &f, const variab
     auto &builder = s.builder();
 
     // Fetch the index of the variable.
-    const auto u_idx = uname_to_index(var.name());
+    const auto u_idx = uname_to_index(var);
 
     if (order == 0u) {
         return codegen_from_values<T>(
             s, f, {taylor_fetch_diff(arr, u_idx, 0, n_uvars), taylor_codegen_numparam<T>(s, num, par_ptr, batch_size)});
     }
 
+    const auto k = pow_get_exp_kind(f);
+
+    if (k == pow_exp_kind::two) {
+        // NOTE: for the exponent 2, use the recurrence of square(), which
+        // does not involve divisions: sum_{j=0}^{order} a^[order-j] * a^[j].
+        std::vector<llvm::Value *> sum;
+        for (std::uint32_t j = 0; j < (order + 1u) / 2u; ++j) {
+            sum.push_back(builder.CreateFMul(taylor_fetch_diff(arr, u_idx, order - j, n_uvars),
+                                             taylor_fetch_diff(arr, u_idx, j, n_uvars)));
+        }
+
+        auto ret = pairwise_sum(builder, sum);
+        ret = builder.CreateFAdd(ret, ret);
+
+        if (order % 2u == 0u) {
+            auto ak2 = taylor_fetch_diff(arr, u_idx, order / 2u, n_uvars);
+            ret = builder.CreateFAdd(ret, builder.CreateFMul(ak2, ak2));
+        }
+
+        return ret;
+    }
+
     // NOTE: iteration in the [0, order) range
     // (i.e., order *not* included).
     std::vector<llvm::Value *> sum;
@@ -275,6 +412,19 @@ llvm::Value *taylor_diff_pow_impl(llvm_state &s, const pow_impl &f, const variab
     // Init the return value as the result of the sum.
     auto ret_acc = pairwise_sum(builder, sum);
 
+    if (k != pow_exp_kind::generic) {
+        // NOTE: for the exponents -1, -1/2 and -3/2, the reciprocal of the zero-th
+        // derivative of u_idx can be computed from the zero-th derivatives of u_idx
+        // and idx (see pow_special_base_inv()), which replaces the division
+        // with multiplications.
+        auto b0_inv = pow_special_base_inv(builder, k, taylor_fetch_diff(arr, u_idx, 0, n_uvars),
+                                           taylor_fetch_diff(arr, idx, 0, n_uvars));
+        auto ord_inv = vector_splat(builder, codegen<T>(s, number(static_cast<T>(1) / static_cast<T>(order))),
+                                    batch_size);
+
+        return builder.CreateFMul(builder.CreateFMul(ret_acc, b0_inv), ord_inv);
+    }
+
     // Compute the final divisor: order * (zero-th derivative of u_idx).
     auto ord_f = vector_splat(builder, codegen<T>(s, number(static_cast<T>(order))), batch_size);
     auto b0 = taylor_fetch_diff(arr, u_idx, 0, n_uvars);
@@ -319,6 +469,43 @@ llvm::Value *taylor_diff_pow(llvm_state &s, const pow_impl &f, const std::vector
 
 } // namespace
 
+interval pow_impl::eval_interval_dbl(const std::vector<interval> &a) const
+{
+    assert(a.size() == 2u);
+
+    const auto &x = a[0], &y = a[1];
+
+    if (interval_isnan(x) || interval_isnan(y)) {
+        return interval_nan();
+    }
+
+    if (y.lower == y.upper && std::isfinite(y.lower) && std::trunc(y.lower) == y.lower) {
+        // Integral exponent n: the base can be negative. Compute x**|n|,
+        // and then take the reciprocal if n is negative.
+        const auto n = y.lower;
+        if (n == 0) {
+            return {1., 1.};
+        }
+
+        const auto pw = [an = std::abs(n)](double v) { return std::pow(v, an); };
+        const auto p = std::fmod(n, 2.) == 0 ? interval_even(x, pw) : interval_monotonic(x, pw, true);
+
+        return n > 0 ? p : interval{1., 1.} / p;
+    }
+
+    // Non-integral exponent: the base must be non-negative. As x**y is monotonic
+    // in each argument, the extrema are attained at the corners.
+    if (x.lower < 0) {
+        return interval_nan();
+    }
+
+    const double c[] = {std::pow(x.lower, y.lower), std::pow(x.lower, y.upper), std::pow(x.upper, y.lower),
+                        std::pow(x.upper, y.upper)};
+
+    return interval_round_out(*std::min_element(std::begin(c), std::end(c)),
+                              *std::max_element(std::begin(c), std::end(c)));
+}
+
 llvm::Value *pow_impl::taylor_diff_dbl(llvm_state &s, const std::vector<std::uint32_t> &deps,
                                        const std::vector<llvm::Value *> &arr, llvm::Value *par_ptr, llvm::Value *,
                                        std::uint32_t n_uvars, std::uint32_t order, std::uint32_t idx,
@@ -463,9 +650,13 @@ llvm::Function *taylor_c_diff_func_pow_impl(llvm_state &s, const pow_impl &fn, c
     // Fetch the floating-point type.
     auto val_t = to_llvm_vector_type<T>(context, batch_size);
 
+    // NOTE: the special exponents are implemented in separate functions,
+    // as the recurrences are different (see below).
+    const auto k = pow_get_exp_kind(fn);
+
     // Get the function name.
-    const auto fname = "heyoka_taylor_diff_pow_var_{}_{}_n_uvars_{}"_format(
-        taylor_c_diff_numparam_mangle(n), taylor_mangle_suffix(val_t), li_to_string(n_uvars));
+    const auto fname = "heyoka_taylor_diff_pow{}_var_{}_{}_n_uvars_{}"_format(
+        pow_exp_kind_mangle(k), taylor_c_diff_numparam_mangle(n), taylor_mangle_suffix(val_t), li_to_string(n_uvars));
 
     // The function arguments:
     // - diff order,
@@ -526,6 +717,28 @@ llvm::Function *taylor_c_diff_func_pow_impl(llvm_state &s, const pow_impl &fn, c
                     retval);
             },
             [&]() {
+                if (k == pow_exp_kind::two) {
+                    // For the exponent 2, use the recurrence of square(). NOTE: here we do not
+                    // exploit the symmetry of the sum, as done in the non-compact implementation,
+                    // in order to keep the loop simple.
+                    builder.CreateStore(vector_splat(builder, codegen<T>(s, number{0.}), batch_size), acc);
+
+                    llvm_loop_u32(s, builder.getInt32(0), builder.CreateAdd(ord, builder.getInt32(1)),
+                                  [&](llvm::Value *j) {
+                                      auto a_nj = taylor_c_load_diff(s, diff_ptr, n_uvars, builder.CreateSub(ord, j),
+                                                                     var_idx);
+                                      auto aj = taylor_c_load_diff(s, diff_ptr, n_uvars, j, var_idx);
+
+                                      builder.CreateStore(
+                                          builder.CreateFAdd(builder.CreateLoad(acc), builder.CreateFMul(a_nj, aj)),
+                                          acc);
+                                  });
+
+                    builder.CreateStore(builder.CreateLoad(acc), retval);
+
+                    return;
+                }
+
                 // Create FP vector versions of exponent and order.
                 auto alpha_v = taylor_c_diff_numparam_codegen(s, n, exponent, par_ptr, batch_size);
                 auto ord_v = vector_splat(builder, builder.CreateUIToFP(ord, to_llvm_type<T>(context)), batch_size);
@@ -551,6 +764,25 @@ llvm::Function *taylor_c_diff_func_pow_impl(llvm_state &s, const pow_impl &fn, c
                                         acc);
                 });
 
+                if (k != pow_exp_kind::generic) {
+                    // Finalize the result: acc * (1 / b0) / n, with 1 / b0 computed
+                    // via multiplications (see the non-compact implementation).
+                    // NOTE: the reciprocal of the order does not depend on the
+                    // accumulation, and it can thus be computed while the loop is running.
+                    auto ord_inv = vector_splat(builder,
+                                                builder.CreateFDiv(codegen<T>(s, number{1.}),
+                                                                   builder.CreateUIToFP(ord, to_llvm_type<T>(context))),
+                                                batch_size);
+                    auto b0_inv = pow_special_base_inv(
+                        builder, k, taylor_c_load_diff(s, diff_ptr, n_uvars, builder.getInt32(0), var_idx),
+                        taylor_c_load_diff(s, diff_ptr, n_uvars, builder.getInt32(0), u_idx));
+
+                    builder.CreateStore(
+                        builder.CreateFMul(builder.CreateFMul(builder.CreateLoad(acc), b0_inv), ord_inv), retval);
+
+                    return;
+                }
+
                 // Finalize the result: acc / (n*b0).
                 builder.CreateStore(
                     builder.CreateFDiv(builder.CreateLoad(acc),
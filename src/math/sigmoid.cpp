@@ -42,11 +42,11 @@
 #endif
 
 #include <heyoka/detail/llvm_helpers.hpp>
-#include <heyoka/detail/sleef.hpp>
 #include <heyoka/detail/string_conv.hpp>
 #include <heyoka/detail/taylor_common.hpp>
 #include <heyoka/expression.hpp>
 #include <heyoka/func.hpp>
+#include <heyoka/interval.hpp>
 #include <heyoka/llvm_state.hpp>
 #include <heyoka/math/sigmoid.hpp>
 #include <heyoka/math/square.hpp>
@@ -94,22 +94,10 @@ llvm::Value *sigmoid_impl::codegen_dbl(llvm_state &s, const std::vector<llvm::Va
     if (auto vec_t = llvm::dyn_cast<llvm::VectorType>(args[0]->getType())) {
         const auto batch_size = boost::numeric_cast<std::uint32_t>(vec_t->getNumElements());
 
-        if (const auto sfn = sleef_function_name(s.context(), "exp", vec_t->getElementType(), batch_size);
-            !sfn.empty()) {
-            auto &builder = s.builder();
-
-            // Compute -arg.
-            auto m_arg = builder.CreateFNeg(args[0]);
-
-            // Compute e^(-arg).
-            auto e_m_arg = llvm_invoke_external(
-                s, sfn, vec_t, {m_arg},
-                // NOTE: in theory we may add ReadNone here as well,
-                // but for some reason, at least up to LLVM 10,
-                // this causes strange codegen issues. Revisit
-                // in the future.
-                {llvm::Attribute::NoUnwind, llvm::Attribute::Speculatable, llvm::Attribute::WillReturn});
+        auto &builder = s.builder();
 
+        // Compute e^(-arg).
+        if (auto e_m_arg = llvm_invoke_sleef(s, "exp", {builder.CreateFNeg(args[0])})) {
             // Return 1 / (1 + e_m_arg).
             auto one_fp = vector_splat(builder, codegen<double>(s, number{1.}), batch_size);
             return builder.CreateFDiv(one_fp, builder.CreateFAdd(one_fp, e_m_arg));
@@ -181,6 +169,13 @@ double sigmoid_impl::deval_num_dbl(const std::vector<double> &a, std::vector<dou
     return sigma * (1 - sigma);
 }
 
+interval sigmoid_impl::eval_interval_dbl(const std::vector<interval> &a) const
+{
+    assert(a.size() == 1u);
+
+    return interval_monotonic(a[0], [](double x) { return 1. / (1. + std::exp(-x)); }, true);
+}
+
 std::vector<std::pair<expression, std::vector<std::uint32_t>>>::size_type
 sigmoid_impl::taylor_decompose(std::vector<std::pair<expression, std::vector<std::uint32_t>>> &u_vars_defs) &&
 {
@@ -232,7 +227,7 @@ llvm::Value *taylor_diff_sigmoid_impl(llvm_state &s, const sigmoid_impl &f, cons
     auto &builder = s.builder();
 
     // Fetch the index of the variable.
-    const auto u_idx = uname_to_index(var.name());
+    const auto u_idx = uname_to_index(var);
 
     if (order == 0u) {
         return codegen_from_values<T>(s, f, {taylor_fetch_diff(arr, u_idx, 0, n_uvars)});
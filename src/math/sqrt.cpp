@@ -39,6 +39,7 @@
 #include <heyoka/detail/taylor_common.hpp>
 #include <heyoka/expression.hpp>
 #include <heyoka/func.hpp>
+#include <heyoka/interval.hpp>
 #include <heyoka/llvm_state.hpp>
 #include <heyoka/math/sqrt.hpp>
 #include <heyoka/number.hpp>
@@ -172,7 +173,7 @@ llvm::Value *taylor_diff_sqrt_impl(llvm_state &s, const sqrt_impl &f, const vari
     auto &builder = s.builder();
 
     // Fetch the index of the variable.
-    const auto u_idx = uname_to_index(var.name());
+    const auto u_idx = uname_to_index(var);
 
     if (order == 0u) {
         return codegen_from_values<T>(s, f, {taylor_fetch_diff(arr, u_idx, 0, n_uvars)});
@@ -251,6 +252,13 @@ llvm::Value *taylor_diff_sqrt(llvm_state &s, const sqrt_impl &f, const std::vect
 
 } // namespace
 
+interval sqrt_impl::eval_interval_dbl(const std::vector<interval> &a) const
+{
+    assert(a.size() == 1u);
+
+    return interval_monotonic(a[0], [](double x) { return std::sqrt(x); }, true, 0.);
+}
+
 llvm::Value *sqrt_impl::taylor_diff_dbl(llvm_state &s, const std::vector<std::uint32_t> &deps,
                                         const std::vector<llvm::Value *> &arr, llvm::Value *par_ptr, llvm::Value *,
                                         std::uint32_t n_uvars, std::uint32_t order, std::uint32_t idx,
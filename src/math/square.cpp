@@ -36,6 +36,7 @@
 #include <heyoka/detail/taylor_common.hpp>
 #include <heyoka/expression.hpp>
 #include <heyoka/func.hpp>
+#include <heyoka/interval.hpp>
 #include <heyoka/llvm_state.hpp>
 #include <heyoka/math/square.hpp>
 #include <heyoka/number.hpp>
@@ -101,7 +102,7 @@ llvm::Value *taylor_diff_square_impl(llvm_state &s, const square_impl &f, const
     auto &builder = s.builder();
 
     // Fetch the index of the variable.
-    const auto u_idx = uname_to_index(var.name());
+    const auto u_idx = uname_to_index(var);
 
     if (order == 0u) {
         return codegen_from_values<T>(s, f, {taylor_fetch_diff(arr, u_idx, 0, n_uvars)});
@@ -170,6 +171,13 @@ llvm::Value *taylor_diff_square(llvm_state &s, const square_impl &f, const std::
 
 } // namespace
 
+interval square_impl::eval_interval_dbl(const std::vector<interval> &a) const
+{
+    assert(a.size() == 1u);
+
+    return interval_even(a[0], [](double x) { return x * x; });
+}
+
 llvm::Value *square_impl::taylor_diff_dbl(llvm_state &s, const std::vector<std::uint32_t> &deps,
                                           const std::vector<llvm::Value *> &arr, llvm::Value *par_ptr, llvm::Value *,
                                           std::uint32_t n_uvars, std::uint32_t order, std::uint32_t idx,
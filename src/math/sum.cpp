@@ -0,0 +1,612 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <heyoka/config.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <llvm/IR/Attributes.h>
+#include <llvm/IR/BasicBlock.h>
+#include <llvm/IR/DerivedTypes.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/Type.h>
+#include <llvm/IR/Value.h>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <heyoka/detail/llvm_helpers.hpp>
+#include <heyoka/detail/string_conv.hpp>
+#include <heyoka/detail/type_traits.hpp>
+#include <heyoka/expression.hpp>
+#include <heyoka/func.hpp>
+#include <heyoka/interval.hpp>
+#include <heyoka/llvm_state.hpp>
+#include <heyoka/math/square.hpp>
+#include <heyoka/math/sum.hpp>
+#include <heyoka/number.hpp>
+#include <heyoka/param.hpp>
+#include <heyoka/taylor.hpp>
+#include <heyoka/variable.hpp>
+
+namespace heyoka
+{
+
+namespace detail
+{
+
+sum_impl::sum_impl(std::vector<expression> v) : func_base("sum", std::move(v)) {}
+
+sum_impl::sum_impl() : sum_impl(std::vector<expression>{}) {}
+
+sum_sq_impl::sum_sq_impl(std::vector<expression> v) : func_base("sum_sq", std::move(v)) {}
+
+sum_sq_impl::sum_sq_impl() : sum_sq_impl(std::vector<expression>{}) {}
+
+namespace
+{
+
+// Codegen for the sum (Sq == false) or the sum
+// of the squares (Sq == true) of the values in args.
+template <bool Sq>
+llvm::Value *sum_codegen_impl(llvm_state &s, const std::vector<llvm::Value *> &args)
+{
+    assert(!args.empty());
+
+    auto &builder = s.builder();
+
+    std::vector<llvm::Value *> terms;
+    terms.reserve(args.size());
+    for (auto *arg : args) {
+        assert(arg != nullptr);
+        terms.push_back(Sq ? builder.CreateFMul(arg, arg) : arg);
+    }
+
+    return pairwise_sum(builder, terms);
+}
+
+} // namespace
+
+llvm::Value *sum_impl::codegen_dbl(llvm_state &s, const std::vector<llvm::Value *> &args) const
+{
+    return sum_codegen_impl<false>(s, args);
+}
+
+llvm::Value *sum_impl::codegen_ldbl(llvm_state &s, const std::vector<llvm::Value *> &args) const
+{
+    // NOTE: codegen is identical as in dbl.
+    return codegen_dbl(s, args);
+}
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+llvm::Value *sum_impl::codegen_f128(llvm_state &s, const std::vector<llvm::Value *> &args) const
+{
+    // NOTE: codegen is identical as in dbl.
+    return codegen_dbl(s, args);
+}
+
+#endif
+
+llvm::Value *sum_sq_impl::codegen_dbl(llvm_state &s, const std::vector<llvm::Value *> &args) const
+{
+    return sum_codegen_impl<true>(s, args);
+}
+
+llvm::Value *sum_sq_impl::codegen_ldbl(llvm_state &s, const std::vector<llvm::Value *> &args) const
+{
+    // NOTE: codegen is identical as in dbl.
+    return codegen_dbl(s, args);
+}
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+llvm::Value *sum_sq_impl::codegen_f128(llvm_state &s, const std::vector<llvm::Value *> &args) const
+{
+    // NOTE: codegen is identical as in dbl.
+    return codegen_dbl(s, args);
+}
+
+#endif
+
+namespace
+{
+
+// Derivative of the sum (Sq == false) or of the sum of the squares (Sq == true).
+// NOTE: the derivatives of order higher than zero of the number/param
+// arguments are zero, thus only the variable arguments contribute
+// to the derivatives of order higher than zero.
+template <bool Sq, typename T, typename F>
+llvm::Value *taylor_diff_sum_impl(llvm_state &s, const F &f, const std::vector<std::uint32_t> &deps,
+                                  const std::vector<llvm::Value *> &arr, llvm::Value *par_ptr, std::uint32_t n_uvars,
+                                  std::uint32_t order, std::uint32_t batch_size)
+{
+    using namespace fmt::literals;
+
+    const auto *desc = Sq ? "sum of squares" : "sum";
+
+    assert(!f.args().empty());
+
+    if (!deps.empty()) {
+        throw std::invalid_argument("An empty hidden dependency vector is expected in order to compute the Taylor "
+                                    "derivative of the {}, but a vector of size {} was passed "
+                                    "instead"_format(desc, deps.size()));
+    }
+
+    auto &builder = s.builder();
+
+    // Fetch the indices of the variable arguments (or, for order zero,
+    // the values of all the arguments).
+    std::vector<std::uint32_t> u_idxs;
+    std::vector<llvm::Value *> vals;
+    for (const auto &arg : f.args()) {
+        std::visit(
+            [&](const auto &v) {
+                using type = uncvref_t<decltype(v)>;
+
+                if constexpr (std::is_same_v<type, variable>) {
+                    u_idxs.push_back(uname_to_index(v));
+
+                    if (order == 0u) {
+                        vals.push_back(taylor_fetch_diff(arr, u_idxs.back(), 0, n_uvars));
+                    }
+                } else if constexpr (is_num_param_v<type>) {
+                    if (order == 0u) {
+                        vals.push_back(taylor_codegen_numparam<T>(s, v, par_ptr, batch_size));
+                    }
+                } else {
+                    throw std::invalid_argument(
+                        "An invalid argument type was encountered while trying to build the Taylor derivative "
+                        "of a {}"_format(desc));
+                }
+            },
+            arg.value());
+    }
+
+    if (order == 0u) {
+        return codegen_from_values<T>(s, f, vals);
+    }
+
+    if (u_idxs.empty()) {
+        return vector_splat(builder, codegen<T>(s, number{0.}), batch_size);
+    }
+
+    if constexpr (Sq) {
+        // The derivative of the sum of squares is
+        // the sum of the derivatives of the squares.
+        std::vector<llvm::Value *> prods, mids;
+        for (auto u_idx : u_idxs) {
+            for (std::uint32_t j = 0; 2u * j < order; ++j) {
+                prods.push_back(builder.CreateFMul(taylor_fetch_diff(arr, u_idx, order - j, n_uvars),
+                                                   taylor_fetch_diff(arr, u_idx, j, n_uvars)));
+            }
+
+            if (order % 2u == 0u) {
+                auto ak2 = taylor_fetch_diff(arr, u_idx, order / 2u, n_uvars);
+                mids.push_back(builder.CreateFMul(ak2, ak2));
+            }
+        }
+
+        auto ret = pairwise_sum(builder, prods);
+        ret = builder.CreateFAdd(ret, ret);
+
+        if (!mids.empty()) {
+            ret = builder.CreateFAdd(ret, pairwise_sum(builder, mids));
+        }
+
+        return ret;
+    } else {
+        for (auto u_idx : u_idxs) {
+            vals.push_back(taylor_fetch_diff(arr, u_idx, order, n_uvars));
+        }
+
+        return pairwise_sum(builder, vals);
+    }
+}
+
+} // namespace
+
+interval sum_impl::eval_interval_dbl(const std::vector<interval> &a) const
+{
+    interval retval{0., 0.};
+    for (const auto &x : a) {
+        retval = retval + x;
+    }
+
+    return retval;
+}
+
+llvm::Value *sum_impl::taylor_diff_dbl(llvm_state &s, const std::vector<std::uint32_t> &deps,
+                                       const std::vector<llvm::Value *> &arr, llvm::Value *par_ptr, llvm::Value *,
+                                       std::uint32_t n_uvars, std::uint32_t order, std::uint32_t,
+                                       std::uint32_t batch_size) const
+{
+    return taylor_diff_sum_impl<false, double>(s, *this, deps, arr, par_ptr, n_uvars, order, batch_size);
+}
+
+llvm::Value *sum_impl::taylor_diff_ldbl(llvm_state &s, const std::vector<std::uint32_t> &deps,
+                                        const std::vector<llvm::Value *> &arr, llvm::Value *par_ptr, llvm::Value *,
+                                        std::uint32_t n_uvars, std::uint32_t order, std::uint32_t,
+                                        std::uint32_t batch_size) const
+{
+    return taylor_diff_sum_impl<false, long double>(s, *this, deps, arr, par_ptr, n_uvars, order, batch_size);
+}
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+llvm::Value *sum_impl::taylor_diff_f128(llvm_state &s, const std::vector<std::uint32_t> &deps,
+                                        const std::vector<llvm::Value *> &arr, llvm::Value *par_ptr, llvm::Value *,
+                                        std::uint32_t n_uvars, std::uint32_t order, std::uint32_t,
+                                        std::uint32_t batch_size) const
+{
+    return taylor_diff_sum_impl<false, mppp::real128>(s, *this, deps, arr, par_ptr, n_uvars, order, batch_size);
+}
+
+#endif
+
+interval sum_sq_impl::eval_interval_dbl(const std::vector<interval> &a) const
+{
+    interval retval{0., 0.};
+    for (const auto &x : a) {
+        retval = retval + interval_even(x, [](double v) { return v * v; });
+    }
+
+    return retval;
+}
+
+llvm::Value *sum_sq_impl::taylor_diff_dbl(llvm_state &s, const std::vector<std::uint32_t> &deps,
+                                          const std::vector<llvm::Value *> &arr, llvm::Value *par_ptr, llvm::Value *,
+                                          std::uint32_t n_uvars, std::uint32_t order, std::uint32_t,
+                                          std::uint32_t batch_size) const
+{
+    return taylor_diff_sum_impl<true, double>(s, *this, deps, arr, par_ptr, n_uvars, order, batch_size);
+}
+
+llvm::Value *sum_sq_impl::taylor_diff_ldbl(llvm_state &s, const std::vector<std::uint32_t> &deps,
+                                           const std::vector<llvm::Value *> &arr, llvm::Value *par_ptr, llvm::Value *,
+                                           std::uint32_t n_uvars, std::uint32_t order, std::uint32_t,
+                                           std::uint32_t batch_size) const
+{
+    return taylor_diff_sum_impl<true, long double>(s, *this, deps, arr, par_ptr, n_uvars, order, batch_size);
+}
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+llvm::Value *sum_sq_impl::taylor_diff_f128(llvm_state &s, const std::vector<std::uint32_t> &deps,
+                                           const std::vector<llvm::Value *> &arr, llvm::Value *par_ptr, llvm::Value *,
+                                           std::uint32_t n_uvars, std::uint32_t order, std::uint32_t,
+                                           std::uint32_t batch_size) const
+{
+    return taylor_diff_sum_impl<true, mppp::real128>(s, *this, deps, arr, par_ptr, n_uvars, order, batch_size);
+}
+
+#endif
+
+namespace
+{
+
+// Derivative of the sum (Sq == false) or of the sum of the squares (Sq == true)
+// in compact mode. The function accepts the arguments of the sum after
+// the common arguments (diff order, index of the u variable, diff array,
+// par ptr and time ptr): the indices of the variables, the values of the numbers
+// and the indices of the params, in the same order as in fn.
+template <bool Sq, typename T, typename F>
+llvm::Function *taylor_c_diff_func_sum_impl(llvm_state &s, const F &fn, std::uint32_t n_uvars,
+                                            std::uint32_t batch_size)
+{
+    using namespace fmt::literals;
+
+    const std::string desc = Sq ? "sum of squares" : "sum";
+
+    assert(!fn.args().empty());
+
+    auto &module = s.module();
+    auto &builder = s.builder();
+    auto &context = s.context();
+
+    // Fetch the floating-point type.
+    auto val_t = to_llvm_vector_type<T>(context, batch_size);
+
+    // The function arguments: the common ones,
+    // followed by the arguments of the sum.
+    std::vector<llvm::Type *> fargs{llvm::Type::getInt32Ty(context), llvm::Type::getInt32Ty(context),
+                                    llvm::PointerType::getUnqual(val_t),
+                                    llvm::PointerType::getUnqual(to_llvm_type<T>(context)),
+                                    llvm::PointerType::getUnqual(to_llvm_type<T>(context))};
+
+    // Build the mangled list of the argument types. In order
+    // to keep the function names short, the runs of arguments
+    // of the same type are encoded as the type followed by the
+    // length of the run (e.g., "var3_par1" for three variables
+    // followed by a param).
+    std::string args_mangle, cur_kind;
+    std::uint32_t run_length = 0;
+    for (const auto &arg : fn.args()) {
+        const auto kind = std::visit(
+            [&](const auto &v) -> std::string {
+                using type = uncvref_t<decltype(v)>;
+
+                if constexpr (std::is_same_v<type, variable>) {
+                    fargs.push_back(llvm::Type::getInt32Ty(context));
+                    return "var";
+                } else if constexpr (is_num_param_v<type>) {
+                    fargs.push_back(taylor_c_diff_numparam_argtype<T>(s, v));
+                    return taylor_c_diff_numparam_mangle(v);
+                } else {
+                    return "";
+                }
+            },
+            arg.value());
+
+        if (kind.empty()) {
+            throw std::invalid_argument("An invalid argument type was encountered while trying to build the "
+                                        "Taylor derivative of a {} in compact mode"_format(desc));
+        }
+
+        if (kind == cur_kind) {
+            ++run_length;
+        } else {
+            if (run_length > 0u) {
+                args_mangle += "_" + cur_kind + li_to_string(run_length);
+            }
+            cur_kind = kind;
+            run_length = 1;
+        }
+    }
+    args_mangle += "_" + cur_kind + li_to_string(run_length);
+
+    // Get the function name.
+    const auto fname = "heyoka_taylor_diff_{}{}_{}_n_uvars_{}"_format(
+        Sq ? "sum_sq" : "sum", args_mangle, taylor_mangle_suffix(val_t), li_to_string(n_uvars));
+
+    // Try to see if we already created the function.
+    auto f = module.getFunction(fname);
+
+    if (f == nullptr) {
+        // The function was not created before, do it now.
+
+        // Fetch the current insertion block.
+        auto orig_bb = builder.GetInsertBlock();
+
+        // The return type is val_t.
+        auto *ft = llvm::FunctionType::get(val_t, fargs, false);
+        // Create the function
+        f = llvm::Function::Create(ft, llvm::Function::InternalLinkage, fname, &module);
+        assert(f != nullptr);
+
+        // Fetch the necessary function arguments.
+        auto ord = f->args().begin();
+        auto diff_ptr = f->args().begin() + 2;
+        auto par_ptr = f->args().begin() + 3;
+
+        // Create a new basic block to start insertion into.
+        builder.SetInsertPoint(llvm::BasicBlock::Create(context, "entry", f));
+
+        // Create the return value.
+        auto retval = builder.CreateAlloca(val_t);
+
+        // Helper to load the derivatives of order o of all the variable
+        // arguments (or, if all_args is true, the values of all the arguments).
+        auto load_args = [&](llvm::Value *o, bool all_args) {
+            std::vector<llvm::Value *> ret;
+
+            auto f_arg = f->args().begin() + 5;
+            for (const auto &arg : fn.args()) {
+                std::visit(
+                    [&](const auto &v) {
+                        using type = uncvref_t<decltype(v)>;
+
+                        if constexpr (std::is_same_v<type, variable>) {
+                            ret.push_back(taylor_c_load_diff(s, diff_ptr, n_uvars, o, f_arg));
+                        } else if constexpr (is_num_param_v<type>) {
+                            if (all_args) {
+                                ret.push_back(taylor_c_diff_numparam_codegen(s, v, f_arg, par_ptr, batch_size));
+                            }
+                        }
+                    },
+                    arg.value());
+
+                ++f_arg;
+            }
+
+            return ret;
+        };
+
+        llvm_if_then_else(
+            s, builder.CreateICmpEQ(ord, builder.getInt32(0)),
+            [&]() {
+                // For order 0, invoke the function on the values of the arguments.
+                builder.CreateStore(codegen_from_values<T>(s, fn, load_args(builder.getInt32(0), true)), retval);
+            },
+            [&]() {
+                auto zero = vector_splat(builder, codegen<T>(s, number{0.}), batch_size);
+
+                if (std::none_of(fn.args().begin(), fn.args().end(), [](const expression &arg) {
+                        return std::holds_alternative<variable>(arg.value());
+                    })) {
+                    // No variable arguments, the derivative is zero.
+                    builder.CreateStore(zero, retval);
+                    return;
+                }
+
+                if constexpr (Sq) {
+                    // Accumulate the products a_i^[n - j] * a_i^[j]
+                    // for 2 * j < n in a single loop over j.
+                    auto acc = builder.CreateAlloca(val_t);
+                    builder.CreateStore(zero, acc);
+
+                    auto loop_end
+                        = builder.CreateUDiv(builder.CreateAdd(ord, builder.getInt32(1)), builder.getInt32(2));
+                    llvm_loop_u32(s, builder.getInt32(0), loop_end, [&](llvm::Value *j) {
+                        auto a_nj = load_args(builder.CreateSub(ord, j), false);
+                        auto aj = load_args(j, false);
+
+                        std::vector<llvm::Value *> prods;
+                        for (decltype(aj.size()) i = 0; i < aj.size(); ++i) {
+                            prods.push_back(builder.CreateFMul(a_nj[i], aj[i]));
+                        }
+
+                        builder.CreateStore(
+                            builder.CreateFAdd(builder.CreateLoad(val_t, acc), pairwise_sum(builder, prods)), acc);
+                    });
+
+                    auto acc_load = builder.CreateLoad(val_t, acc);
+                    auto ret = builder.CreateFAdd(acc_load, acc_load);
+
+                    // For even orders, add the squares of the derivatives of order n / 2.
+                    auto ak2 = load_args(builder.CreateUDiv(ord, builder.getInt32(2)), false);
+                    for (auto &v : ak2) {
+                        v = builder.CreateFMul(v, v);
+                    }
+                    auto ret_even = builder.CreateFAdd(ret, pairwise_sum(builder, ak2));
+
+                    builder.CreateStore(
+                        builder.CreateSelect(
+                            builder.CreateICmpEQ(builder.CreateURem(ord, builder.getInt32(2)), builder.getInt32(0)),
+                            ret_even, ret),
+                        retval);
+                } else {
+                    auto terms = load_args(ord, false);
+                    builder.CreateStore(pairwise_sum(builder, terms), retval);
+                }
+            });
+
+        // Return the result.
+        builder.CreateRet(builder.CreateLoad(val_t, retval));
+
+        // Verify.
+        s.verify_function(f);
+
+        // Restore the original insertion block.
+        builder.SetInsertPoint(orig_bb);
+    } else {
+        // The function was created before. Check if the signatures match.
+        // NOTE: there could be a mismatch if the derivative function was created
+        // and then optimised - optimisation might remove arguments which are compile-time
+        // constants.
+        if (!compare_function_signature(f, val_t, fargs)) {
+            throw std::invalid_argument("Inconsistent function signature for the Taylor derivative of the " + desc
+                                        + " in compact mode detected");
+        }
+    }
+
+    return f;
+}
+
+} // namespace
+
+llvm::Function *sum_impl::taylor_c_diff_func_dbl(llvm_state &s, std::uint32_t n_uvars, std::uint32_t batch_size) const
+{
+    return taylor_c_diff_func_sum_impl<false, double>(s, *this, n_uvars, batch_size);
+}
+
+llvm::Function *sum_impl::taylor_c_diff_func_ldbl(llvm_state &s, std::uint32_t n_uvars, std::uint32_t batch_size) const
+{
+    return taylor_c_diff_func_sum_impl<false, long double>(s, *this, n_uvars, batch_size);
+}
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+llvm::Function *sum_impl::taylor_c_diff_func_f128(llvm_state &s, std::uint32_t n_uvars, std::uint32_t batch_size) const
+{
+    return taylor_c_diff_func_sum_impl<false, mppp::real128>(s, *this, n_uvars, batch_size);
+}
+
+#endif
+
+llvm::Function *sum_sq_impl::taylor_c_diff_func_dbl(llvm_state &s, std::uint32_t n_uvars,
+                                                    std::uint32_t batch_size) const
+{
+    return taylor_c_diff_func_sum_impl<true, double>(s, *this, n_uvars, batch_size);
+}
+
+llvm::Function *sum_sq_impl::taylor_c_diff_func_ldbl(llvm_state &s, std::uint32_t n_uvars,
+                                                     std::uint32_t batch_size) const
+{
+    return taylor_c_diff_func_sum_impl<true, long double>(s, *this, n_uvars, batch_size);
+}
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+llvm::Function *sum_sq_impl::taylor_c_diff_func_f128(llvm_state &s, std::uint32_t n_uvars,
+                                                     std::uint32_t batch_size) const
+{
+    return taylor_c_diff_func_sum_impl<true, mppp::real128>(s, *this, n_uvars, batch_size);
+}
+
+#endif
+
+expression sum_impl::diff(const std::string &s) const
+{
+    std::vector<expression> ret;
+    ret.reserve(args().size());
+
+    for (const auto &arg : args()) {
+        ret.push_back(heyoka::diff(arg, s));
+    }
+
+    return heyoka::sum(std::move(ret));
+}
+
+expression sum_sq_impl::diff(const std::string &s) const
+{
+    std::vector<expression> ret;
+    ret.reserve(args().size());
+
+    for (const auto &arg : args()) {
+        ret.push_back(arg * heyoka::diff(arg, s));
+    }
+
+    return 2_dbl * heyoka::sum(std::move(ret));
+}
+
+} // namespace detail
+
+// NOTE: the sums of less than two terms
+// are simplified immediately.
+expression sum(std::vector<expression> args)
+{
+    if (args.empty()) {
+        return 0_dbl;
+    }
+
+    if (args.size() == 1u) {
+        return std::move(args[0]);
+    }
+
+    return expression{func{detail::sum_impl(std::move(args))}};
+}
+
+expression sum_sq(std::vector<expression> args)
+{
+    if (args.empty()) {
+        return 0_dbl;
+    }
+
+    if (args.size() == 1u) {
+        return square(std::move(args[0]));
+    }
+
+    return expression{func{detail::sum_sq_impl(std::move(args))}};
+}
+
+} // namespace heyoka
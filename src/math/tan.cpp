@@ -12,6 +12,7 @@
 #include <cmath>
 #include <cstdint>
 #include <initializer_list>
+#include <limits>
 #include <stdexcept>
 #include <string>
 #include <type_traits>
@@ -42,11 +43,11 @@
 #endif
 
 #include <heyoka/detail/llvm_helpers.hpp>
-#include <heyoka/detail/sleef.hpp>
 #include <heyoka/detail/string_conv.hpp>
 #include <heyoka/detail/taylor_common.hpp>
 #include <heyoka/expression.hpp>
 #include <heyoka/func.hpp>
+#include <heyoka/interval.hpp>
 #include <heyoka/llvm_state.hpp>
 #include <heyoka/math/square.hpp>
 #include <heyoka/math/tan.hpp>
@@ -69,18 +70,8 @@ llvm::Value *tan_impl::codegen_dbl(llvm_state &s, const std::vector<llvm::Value
     assert(args.size() == 1u);
     assert(args[0] != nullptr);
 
-    if (auto vec_t = llvm::dyn_cast<llvm::VectorType>(args[0]->getType())) {
-        if (const auto sfn = sleef_function_name(s.context(), "tan", vec_t->getElementType(),
-                                                 boost::numeric_cast<std::uint32_t>(vec_t->getNumElements()));
-            !sfn.empty()) {
-            return llvm_invoke_external(
-                s, sfn, vec_t, args,
-                // NOTE: in theory we may add ReadNone here as well,
-                // but for some reason, at least up to LLVM 10,
-                // this causes strange codegen issues. Revisit
-                // in the future.
-                {llvm::Attribute::NoUnwind, llvm::Attribute::Speculatable, llvm::Attribute::WillReturn});
-        }
+    if (auto ret = llvm_invoke_sleef(s, "tan", args)) {
+        return ret;
     }
 
     return call_extern_vec(s, args[0], "tan");
@@ -156,6 +147,26 @@ double tan_impl::deval_num_dbl(const std::vector<double> &a, std::vector<double>
     return std::tan(a[0]);
 }
 
+interval tan_impl::eval_interval_dbl(const std::vector<interval> &a) const
+{
+    assert(a.size() == 1u);
+
+    if (interval_isnan(a[0])) {
+        return interval_nan();
+    }
+
+    // NOTE: the poles of the tangent are at pi/2 + k*pi.
+    constexpr double pi = 3.141592653589793238462643383279502884;
+    constexpr auto inf = std::numeric_limits<double>::infinity();
+
+    if (!std::isfinite(a[0].lower) || !std::isfinite(a[0].upper) || a[0].upper - a[0].lower >= pi
+        || interval_contains_periodic(a[0], pi / 2, pi)) {
+        return {-inf, inf};
+    }
+
+    return interval_round_out(std::tan(a[0].lower), std::tan(a[0].upper));
+}
+
 std::vector<std::pair<expression, std::vector<std::uint32_t>>>::size_type
 tan_impl::taylor_decompose(std::vector<std::pair<expression, std::vector<std::uint32_t>>> &u_vars_defs) &&
 {
@@ -164,15 +175,16 @@ tan_impl::taylor_decompose(std::vector<std::pair<expression, std::vector<std::ui
     // Decompose the argument.
     auto &arg = *get_mutable_args_it().first;
     if (const auto dres = taylor_decompose_in_place(std::move(arg), u_vars_defs)) {
-        arg = expression{variable{"u_" + detail::li_to_string(dres)}};
+        arg = expression{detail::make_u_var(boost::numeric_cast<std::uint32_t>(dres))};
     }
 
     // Append the tan decomposition.
     u_vars_defs.emplace_back(tan(std::move(arg)), std::vector<std::uint32_t>{});
 
     // Append the auxiliary function tan(arg) * tan(arg).
-    u_vars_defs.emplace_back(square(expression{variable{"u_" + detail::li_to_string(u_vars_defs.size() - 1u)}}),
-                             std::vector<std::uint32_t>{});
+    u_vars_defs.emplace_back(
+        square(expression{detail::make_u_var(boost::numeric_cast<std::uint32_t>(u_vars_defs.size() - 1u))}),
+        std::vector<std::uint32_t>{});
 
     // Add the hidden dep.
     (u_vars_defs.end() - 2)->second.push_back(boost::numeric_cast<std::uint32_t>(u_vars_defs.size() - 1u));
@@ -204,7 +216,7 @@ llvm::Value *taylor_diff_tan_impl(llvm_state &s, const tan_impl &f, const std::v
     auto &builder = s.builder();
 
     // Fetch the index of the variable.
-    const auto u_idx = uname_to_index(var.name());
+    const auto u_idx = uname_to_index(var);
 
     if (order == 0u) {
         return codegen_from_values<T>(s, f, {taylor_fetch_diff(arr, u_idx, 0, n_uvars)});
@@ -0,0 +1,381 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <heyoka/config.hpp>
+
+#include <cassert>
+#include <cstdint>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <llvm/IR/BasicBlock.h>
+#include <llvm/IR/DerivedTypes.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+#include <llvm/IR/Type.h>
+#include <llvm/IR/Value.h>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <heyoka/detail/llvm_helpers.hpp>
+#include <heyoka/detail/string_conv.hpp>
+#include <heyoka/detail/type_traits.hpp>
+#include <heyoka/expression.hpp>
+#include <heyoka/func.hpp>
+#include <heyoka/llvm_state.hpp>
+#include <heyoka/math/cos.hpp>
+#include <heyoka/math/sin.hpp>
+#include <heyoka/math/tharm.hpp>
+#include <heyoka/number.hpp>
+#include <heyoka/param.hpp>
+#include <heyoka/taylor.hpp>
+
+namespace heyoka
+{
+
+namespace detail
+{
+
+tharm_impl::tharm_impl() : tharm_impl(false, 0_dbl, 0_dbl) {}
+
+tharm_impl::tharm_impl(bool is_sin, expression omega, expression phi)
+    : func_base(is_sin ? "tsin" : "tcos", std::vector{std::move(omega), std::move(phi)})
+{
+    for (const auto &arg : args()) {
+        if (!std::holds_alternative<number>(arg.value()) && !std::holds_alternative<param>(arg.value())) {
+            throw std::invalid_argument("The frequency and the phase of a harmonic function of time must be numbers "
+                                        "or params, but the expression '"
+                                        + detail::li_to_string(arg) + "' was provided instead");
+        }
+    }
+}
+
+bool tharm_impl::is_sin() const
+{
+    return get_name() == "tsin";
+}
+
+void tharm_impl::to_stream(std::ostream &os) const
+{
+    assert(args().size() == 2u);
+
+    os << (is_sin() ? "sin(" : "cos(") << args()[0] << " * t + " << args()[1] << ')';
+}
+
+bool tharm_impl::is_time_dependent() const
+{
+    return true;
+}
+
+expression tharm_impl::diff(const std::string &) const
+{
+    // NOTE: the function does not depend on the variables.
+    return 0_dbl;
+}
+
+namespace
+{
+
+// Compute the Taylor derivatives of orders 0 and 1 of the function f
+// from the frequency, the phase and the time at the beginning of the step.
+template <typename T>
+llvm::Value *tharm_codegen_low_order(llvm_state &s, const tharm_impl &f, bool order1, llvm::Value *omega,
+                                     llvm::Value *phi, llvm::Value *t)
+{
+    auto &builder = s.builder();
+
+    auto *arg = builder.CreateFAdd(builder.CreateFMul(omega, t), phi);
+
+    // NOTE: the derivative of order 1 of the sine is omega*cos(arg),
+    // the derivative of order 1 of the cosine is -omega*sin(arg).
+    if (f.is_sin() != order1) {
+        auto *ret = codegen_from_values<T>(s, sin_impl{}, {arg});
+
+        return order1 ? builder.CreateFNeg(builder.CreateFMul(omega, ret)) : ret;
+    } else {
+        auto *ret = codegen_from_values<T>(s, cos_impl{}, {arg});
+
+        return order1 ? builder.CreateFMul(omega, ret) : ret;
+    }
+}
+
+// Compute the Taylor derivative of order n >= 2 from the derivative a_nm2
+// of order n - 2 as -omega**2 * a_nm2 / (n * (n - 1)).
+llvm::Value *tharm_codegen_rec(llvm_state &s, llvm::Value *omega, llvm::Value *a_nm2, llvm::Value *n, llvm::Value *nm1)
+{
+    auto &builder = s.builder();
+
+    return builder.CreateFDiv(builder.CreateFNeg(builder.CreateFMul(builder.CreateFMul(omega, omega), a_nm2)),
+                              builder.CreateFMul(n, nm1));
+}
+
+template <typename T, typename U, typename V,
+          std::enable_if_t<std::conjunction_v<is_num_param<U>, is_num_param<V>>, int> = 0>
+llvm::Value *taylor_diff_tharm_impl(llvm_state &s, const tharm_impl &f, const U &omega, const V &phi,
+                                    const std::vector<llvm::Value *> &arr, llvm::Value *par_ptr,
+                                    llvm::Value *time_ptr, std::uint32_t n_uvars, std::uint32_t order,
+                                    std::uint32_t idx, std::uint32_t batch_size)
+{
+    auto &builder = s.builder();
+
+    auto *om = taylor_codegen_numparam<T>(s, omega, par_ptr, batch_size);
+
+    if (order < 2u) {
+        return tharm_codegen_low_order<T>(s, f, order == 1u, om,
+                                          taylor_codegen_numparam<T>(s, phi, par_ptr, batch_size),
+                                          load_vector_from_memory(builder, time_ptr, batch_size));
+    }
+
+    return tharm_codegen_rec(
+        s, om, taylor_fetch_diff(arr, idx, order - 2u, n_uvars),
+        vector_splat(builder, codegen<T>(s, number(static_cast<T>(order))), batch_size),
+        vector_splat(builder, codegen<T>(s, number(static_cast<T>(order - 1u))), batch_size));
+}
+
+template <typename T, typename U, typename V,
+          std::enable_if_t<!std::conjunction_v<is_num_param<U>, is_num_param<V>>, int> = 0>
+llvm::Value *taylor_diff_tharm_impl(llvm_state &, const tharm_impl &, const U &, const V &,
+                                    const std::vector<llvm::Value *> &, llvm::Value *, llvm::Value *, std::uint32_t,
+                                    std::uint32_t, std::uint32_t, std::uint32_t)
+{
+    throw std::invalid_argument("An invalid argument type was encountered while trying to build the Taylor "
+                                "derivative of a harmonic function of time");
+}
+
+template <typename T>
+llvm::Value *taylor_diff_tharm(llvm_state &s, const tharm_impl &f, const std::vector<llvm::Value *> &arr,
+                               llvm::Value *par_ptr, llvm::Value *time_ptr, std::uint32_t n_uvars,
+                               std::uint32_t order, std::uint32_t idx, std::uint32_t batch_size)
+{
+    assert(f.args().size() == 2u);
+
+    return std::visit(
+        [&](const auto &v1, const auto &v2) {
+            return taylor_diff_tharm_impl<T>(s, f, v1, v2, arr, par_ptr, time_ptr, n_uvars, order, idx, batch_size);
+        },
+        f.args()[0].value(), f.args()[1].value());
+}
+
+} // namespace
+
+llvm::Value *tharm_impl::taylor_diff_dbl(llvm_state &s, const std::vector<std::uint32_t> &,
+                                         const std::vector<llvm::Value *> &arr, llvm::Value *par_ptr,
+                                         llvm::Value *time_ptr, std::uint32_t n_uvars, std::uint32_t order,
+                                         std::uint32_t idx, std::uint32_t batch_size) const
+{
+    return taylor_diff_tharm<double>(s, *this, arr, par_ptr, time_ptr, n_uvars, order, idx, batch_size);
+}
+
+llvm::Value *tharm_impl::taylor_diff_ldbl(llvm_state &s, const std::vector<std::uint32_t> &,
+                                          const std::vector<llvm::Value *> &arr, llvm::Value *par_ptr,
+                                          llvm::Value *time_ptr, std::uint32_t n_uvars, std::uint32_t order,
+                                          std::uint32_t idx, std::uint32_t batch_size) const
+{
+    return taylor_diff_tharm<long double>(s, *this, arr, par_ptr, time_ptr, n_uvars, order, idx, batch_size);
+}
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+llvm::Value *tharm_impl::taylor_diff_f128(llvm_state &s, const std::vector<std::uint32_t> &,
+                                          const std::vector<llvm::Value *> &arr, llvm::Value *par_ptr,
+                                          llvm::Value *time_ptr, std::uint32_t n_uvars, std::uint32_t order,
+                                          std::uint32_t idx, std::uint32_t batch_size) const
+{
+    return taylor_diff_tharm<mppp::real128>(s, *this, arr, par_ptr, time_ptr, n_uvars, order, idx, batch_size);
+}
+
+#endif
+
+namespace
+{
+
+template <typename T, typename U, typename V,
+          std::enable_if_t<std::conjunction_v<is_num_param<U>, is_num_param<V>>, int> = 0>
+llvm::Function *taylor_c_diff_func_tharm_impl(llvm_state &s, const tharm_impl &fn, const U &omega, const V &phi,
+                                              std::uint32_t n_uvars, std::uint32_t batch_size)
+{
+    auto &module = s.module();
+    auto &builder = s.builder();
+    auto &context = s.context();
+
+    // Fetch the floating-point type.
+    auto val_t = to_llvm_vector_type<T>(context, batch_size);
+
+    // Get the function name.
+    const auto fname = fmt::format("heyoka_taylor_diff_{}_{}_{}_{}_n_uvars_{}", fn.get_name(),
+                                   taylor_c_diff_numparam_mangle(omega), taylor_c_diff_numparam_mangle(phi),
+                                   taylor_mangle_suffix(val_t), li_to_string(n_uvars));
+
+    // The function arguments:
+    // - diff order,
+    // - idx of the u variable whose diff is being computed,
+    // - diff array,
+    // - par ptr,
+    // - time ptr,
+    // - frequency argument,
+    // - phase argument.
+    std::vector<llvm::Type *> fargs{llvm::Type::getInt32Ty(context),
+                                    llvm::Type::getInt32Ty(context),
+                                    llvm::PointerType::getUnqual(val_t),
+                                    llvm::PointerType::getUnqual(to_llvm_type<T>(context)),
+                                    llvm::PointerType::getUnqual(to_llvm_type<T>(context)),
+                                    taylor_c_diff_numparam_argtype<T>(s, omega),
+                                    taylor_c_diff_numparam_argtype<T>(s, phi)};
+
+    // Try to see if we already created the function.
+    auto f = module.getFunction(fname);
+
+    if (f == nullptr) {
+        // The function was not created before, do it now.
+
+        // Fetch the current insertion block.
+        auto orig_bb = builder.GetInsertBlock();
+
+        // The return type is val_t.
+        auto *ft = llvm::FunctionType::get(val_t, fargs, false);
+        // Create the function
+        f = llvm::Function::Create(ft, llvm::Function::InternalLinkage, fname, &module);
+        assert(f != nullptr);
+
+        // Fetch the necessary function arguments.
+        auto ord = f->args().begin();
+        auto u_idx = f->args().begin() + 1;
+        auto diff_ptr = f->args().begin() + 2;
+        auto par_ptr = f->args().begin() + 3;
+        auto t_ptr = f->args().begin() + 4;
+        auto omega_arg = f->args().begin() + 5;
+        auto phi_arg = f->args().begin() + 6;
+
+        // Create a new basic block to start insertion into.
+        builder.SetInsertPoint(llvm::BasicBlock::Create(context, "entry", f));
+
+        // Create the return value.
+        auto retval = builder.CreateAlloca(val_t);
+
+        auto *om = taylor_c_diff_numparam_codegen(s, omega, omega_arg, par_ptr, batch_size);
+
+        llvm_if_then_else(
+            s, builder.CreateICmpULT(ord, builder.getInt32(2)),
+            [&]() {
+                // For orders 0 and 1, compute the sine/cosine of the argument.
+                auto *t = load_vector_from_memory(builder, t_ptr, batch_size);
+                auto *ph = taylor_c_diff_numparam_codegen(s, phi, phi_arg, par_ptr, batch_size);
+
+                llvm_if_then_else(
+                    s, builder.CreateICmpEQ(ord, builder.getInt32(0)),
+                    [&]() { builder.CreateStore(tharm_codegen_low_order<T>(s, fn, false, om, ph, t), retval); },
+                    [&]() { builder.CreateStore(tharm_codegen_low_order<T>(s, fn, true, om, ph, t), retval); });
+            },
+            [&]() {
+                // Otherwise, run the recurrence on the derivative of order ord - 2.
+                auto *a_nm2 = taylor_c_load_diff(s, diff_ptr, n_uvars, builder.CreateSub(ord, builder.getInt32(2)),
+                                                 u_idx);
+
+                auto *n = vector_splat(builder, builder.CreateUIToFP(ord, to_llvm_type<T>(context)), batch_size);
+                auto *nm1 = vector_splat(builder,
+                                         builder.CreateUIToFP(builder.CreateSub(ord, builder.getInt32(1)),
+                                                              to_llvm_type<T>(context)),
+                                         batch_size);
+
+                builder.CreateStore(tharm_codegen_rec(s, om, a_nm2, n, nm1), retval);
+            });
+
+        // Return the result.
+        builder.CreateRet(builder.CreateLoad(retval));
+
+        // Verify.
+        s.verify_function(f);
+
+        // Restore the original insertion block.
+        builder.SetInsertPoint(orig_bb);
+    } else {
+        // The function was created before. Check if the signatures match.
+        // NOTE: there could be a mismatch if the derivative function was created
+        // and then optimised - optimisation might remove arguments which are compile-time
+        // constants.
+        if (!compare_function_signature(f, val_t, fargs)) {
+            throw std::invalid_argument("Inconsistent function signature for the Taylor derivative of a harmonic "
+                                        "function of time in compact mode detected");
+        }
+    }
+
+    return f;
+}
+
+template <typename T, typename U, typename V,
+          std::enable_if_t<!std::conjunction_v<is_num_param<U>, is_num_param<V>>, int> = 0>
+llvm::Function *taylor_c_diff_func_tharm_impl(llvm_state &, const tharm_impl &, const U &, const V &, std::uint32_t,
+                                              std::uint32_t)
+{
+    throw std::invalid_argument("An invalid argument type was encountered while trying to build the Taylor "
+                                "derivative of a harmonic function of time in compact mode");
+}
+
+template <typename T>
+llvm::Function *taylor_c_diff_func_tharm(llvm_state &s, const tharm_impl &fn, std::uint32_t n_uvars,
+                                         std::uint32_t batch_size)
+{
+    assert(fn.args().size() == 2u);
+
+    return std::visit(
+        [&](const auto &v1, const auto &v2) {
+            return taylor_c_diff_func_tharm_impl<T>(s, fn, v1, v2, n_uvars, batch_size);
+        },
+        fn.args()[0].value(), fn.args()[1].value());
+}
+
+} // namespace
+
+llvm::Function *tharm_impl::taylor_c_diff_func_dbl(llvm_state &s, std::uint32_t n_uvars,
+                                                   std::uint32_t batch_size) const
+{
+    return taylor_c_diff_func_tharm<double>(s, *this, n_uvars, batch_size);
+}
+
+llvm::Function *tharm_impl::taylor_c_diff_func_ldbl(llvm_state &s, std::uint32_t n_uvars,
+                                                    std::uint32_t batch_size) const
+{
+    return taylor_c_diff_func_tharm<long double>(s, *this, n_uvars, batch_size);
+}
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+llvm::Function *tharm_impl::taylor_c_diff_func_f128(llvm_state &s, std::uint32_t n_uvars,
+                                                    std::uint32_t batch_size) const
+{
+    return taylor_c_diff_func_tharm<mppp::real128>(s, *this, n_uvars, batch_size);
+}
+
+#endif
+
+} // namespace detail
+
+expression tcos(expression omega, expression phi)
+{
+    return expression{func{detail::tharm_impl{false, std::move(omega), std::move(phi)}}};
+}
+
+expression tsin(expression omega, expression phi)
+{
+    return expression{func{detail::tharm_impl{true, std::move(omega), std::move(phi)}}};
+}
+
+} // namespace heyoka
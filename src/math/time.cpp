@@ -52,6 +52,11 @@ void time_impl::to_stream(std::ostream &os) const
     os << 't';
 }
 
+bool time_impl::is_time_dependent() const
+{
+    return true;
+}
+
 namespace
 {
 
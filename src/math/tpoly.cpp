@@ -0,0 +1,361 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <heyoka/config.hpp>
+
+#include <cassert>
+#include <cstdint>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include <boost/numeric/conversion/cast.hpp>
+
+#include <llvm/IR/BasicBlock.h>
+#include <llvm/IR/DerivedTypes.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+#include <llvm/IR/Type.h>
+#include <llvm/IR/Value.h>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <heyoka/detail/llvm_helpers.hpp>
+#include <heyoka/detail/string_conv.hpp>
+#include <heyoka/detail/type_traits.hpp>
+#include <heyoka/expression.hpp>
+#include <heyoka/func.hpp>
+#include <heyoka/llvm_state.hpp>
+#include <heyoka/math/tpoly.hpp>
+#include <heyoka/number.hpp>
+#include <heyoka/param.hpp>
+#include <heyoka/taylor.hpp>
+
+namespace heyoka
+{
+
+namespace detail
+{
+
+tpoly_impl::tpoly_impl() : tpoly_impl(std::vector{0_dbl}) {}
+
+tpoly_impl::tpoly_impl(std::vector<expression> cfs) : func_base("tpoly", std::move(cfs))
+{
+    if (args().empty()) {
+        throw std::invalid_argument("A polynomial of time needs at least one coefficient");
+    }
+
+    for (const auto &arg : args()) {
+        if (!std::holds_alternative<number>(arg.value()) && !std::holds_alternative<param>(arg.value())) {
+            throw std::invalid_argument("The coefficients of a polynomial of time must be numbers or params, but the "
+                                        "expression '"
+                                        + detail::li_to_string(arg) + "' was provided instead");
+        }
+    }
+}
+
+void tpoly_impl::to_stream(std::ostream &os) const
+{
+    assert(!args().empty());
+
+    os << "tpoly(";
+    for (decltype(args().size()) i = 0; i < args().size(); ++i) {
+        os << args()[i];
+        if (i + 1u != args().size()) {
+            os << ", ";
+        }
+    }
+    os << ')';
+}
+
+bool tpoly_impl::is_time_dependent() const
+{
+    return true;
+}
+
+expression tpoly_impl::diff(const std::string &) const
+{
+    // NOTE: the function does not depend on the variables.
+    return 0_dbl;
+}
+
+namespace
+{
+
+// Compute the Taylor derivative of the given order of the polynomial
+// with coefficients cfs at the time t via Horner's scheme on the
+// coefficients binomial(k, order) * cfs[k], k >= order.
+template <typename T>
+llvm::Value *tpoly_codegen_diff(llvm_state &s, const std::vector<llvm::Value *> &cfs, llvm::Value *t,
+                                std::uint32_t order, std::uint32_t batch_size)
+{
+    assert(!cfs.empty());
+
+    auto &builder = s.builder();
+
+    const auto n_cfs = boost::numeric_cast<std::uint32_t>(cfs.size());
+
+    if (order >= n_cfs) {
+        return vector_splat(builder, codegen<T>(s, number{0.}), batch_size);
+    }
+
+    // Compute the binomial coefficients binomial(k, order) for k in [order, n_cfs).
+    // NOTE: the binomial coefficients are computed via
+    // binomial(k + 1, order) = binomial(k, order) * (k + 1) / (k + 1 - order),
+    // which is exact as long as the coefficients fit in the significand.
+    std::vector<T> binoms{T(1)};
+    for (auto k = order; k + 1u < n_cfs; ++k) {
+        binoms.push_back(binoms.back() * static_cast<T>(k + 1u) / static_cast<T>(k + 1u - order));
+    }
+
+    auto bcoeff = [&](std::uint32_t k) {
+        auto *c = cfs[k];
+
+        if (binoms[k - order] == 1) {
+            return c;
+        }
+
+        return builder.CreateFMul(vector_splat(builder, codegen<T>(s, number(binoms[k - order])), batch_size), c);
+    };
+
+    auto *acc = bcoeff(n_cfs - 1u);
+    for (auto k = n_cfs - 1u; k > order; --k) {
+        acc = builder.CreateFAdd(builder.CreateFMul(acc, t), bcoeff(k - 1u));
+    }
+
+    return acc;
+}
+
+template <typename T>
+llvm::Value *taylor_diff_tpoly(llvm_state &s, const tpoly_impl &f, llvm::Value *par_ptr, llvm::Value *time_ptr,
+                               std::uint32_t order, std::uint32_t batch_size)
+{
+    auto &builder = s.builder();
+
+    if (order >= f.args().size()) {
+        return vector_splat(builder, codegen<T>(s, number{0.}), batch_size);
+    }
+
+    std::vector<llvm::Value *> cfs;
+    for (const auto &arg : f.args()) {
+        cfs.push_back(std::visit(
+            [&](const auto &v) -> llvm::Value * {
+                using type = uncvref_t<decltype(v)>;
+
+                if constexpr (is_num_param_v<type>) {
+                    return taylor_codegen_numparam<T>(s, v, par_ptr, batch_size);
+                } else {
+                    throw std::invalid_argument("An invalid argument type was encountered while trying to build the "
+                                                "Taylor derivative of a polynomial of time");
+                }
+            },
+            arg.value()));
+    }
+
+    return tpoly_codegen_diff<T>(s, cfs, load_vector_from_memory(builder, time_ptr, batch_size), order, batch_size);
+}
+
+} // namespace
+
+llvm::Value *tpoly_impl::taylor_diff_dbl(llvm_state &s, const std::vector<std::uint32_t> &,
+                                         const std::vector<llvm::Value *> &, llvm::Value *par_ptr,
+                                         llvm::Value *time_ptr, std::uint32_t, std::uint32_t order, std::uint32_t,
+                                         std::uint32_t batch_size) const
+{
+    return taylor_diff_tpoly<double>(s, *this, par_ptr, time_ptr, order, batch_size);
+}
+
+llvm::Value *tpoly_impl::taylor_diff_ldbl(llvm_state &s, const std::vector<std::uint32_t> &,
+                                          const std::vector<llvm::Value *> &, llvm::Value *par_ptr,
+                                          llvm::Value *time_ptr, std::uint32_t, std::uint32_t order, std::uint32_t,
+                                          std::uint32_t batch_size) const
+{
+    return taylor_diff_tpoly<long double>(s, *this, par_ptr, time_ptr, order, batch_size);
+}
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+llvm::Value *tpoly_impl::taylor_diff_f128(llvm_state &s, const std::vector<std::uint32_t> &,
+                                          const std::vector<llvm::Value *> &, llvm::Value *par_ptr,
+                                          llvm::Value *time_ptr, std::uint32_t, std::uint32_t order, std::uint32_t,
+                                          std::uint32_t batch_size) const
+{
+    return taylor_diff_tpoly<mppp::real128>(s, *this, par_ptr, time_ptr, order, batch_size);
+}
+
+#endif
+
+namespace
+{
+
+template <typename T>
+llvm::Function *taylor_c_diff_func_tpoly(llvm_state &s, const tpoly_impl &fn, std::uint32_t batch_size)
+{
+    auto &module = s.module();
+    auto &builder = s.builder();
+    auto &context = s.context();
+
+    // Fetch the floating-point type.
+    auto val_t = to_llvm_vector_type<T>(context, batch_size);
+
+    // The function arguments:
+    // - diff order,
+    // - idx of the u variable whose diff is being computed,
+    // - diff array,
+    // - par ptr,
+    // - time ptr,
+    // - the coefficients.
+    std::vector<llvm::Type *> fargs{
+        llvm::Type::getInt32Ty(context), llvm::Type::getInt32Ty(context), llvm::PointerType::getUnqual(val_t),
+        llvm::PointerType::getUnqual(to_llvm_type<T>(context)), llvm::PointerType::getUnqual(to_llvm_type<T>(context))};
+
+    // Get the function name, while adding the types of the coefficients
+    // to the function arguments.
+    // NOTE: the mangled name includes the type of each coefficient,
+    // and hence also the degree of the polynomial.
+    std::string fname = "heyoka_taylor_diff_tpoly_";
+    for (const auto &arg : fn.args()) {
+        std::visit(
+            [&](const auto &v) {
+                using type = uncvref_t<decltype(v)>;
+
+                if constexpr (is_num_param_v<type>) {
+                    fname += taylor_c_diff_numparam_mangle(v) + "_";
+                    fargs.push_back(taylor_c_diff_numparam_argtype<T>(s, v));
+                } else {
+                    throw std::invalid_argument("An invalid argument type was encountered while trying to build the "
+                                                "Taylor derivative of a polynomial of time in compact mode");
+                }
+            },
+            arg.value());
+    }
+    fname += taylor_mangle_suffix(val_t);
+
+    // Try to see if we already created the function.
+    auto f = module.getFunction(fname);
+
+    if (f == nullptr) {
+        // The function was not created before, do it now.
+
+        // Fetch the current insertion block.
+        auto orig_bb = builder.GetInsertBlock();
+
+        // The return type is val_t.
+        auto *ft = llvm::FunctionType::get(val_t, fargs, false);
+        // Create the function
+        f = llvm::Function::Create(ft, llvm::Function::InternalLinkage, fname, &module);
+        assert(f != nullptr);
+
+        // Fetch the necessary function arguments.
+        auto ord = f->args().begin();
+        auto par_ptr = f->args().begin() + 3;
+        auto t_ptr = f->args().begin() + 4;
+
+        // Create a new basic block to start insertion into.
+        builder.SetInsertPoint(llvm::BasicBlock::Create(context, "entry", f));
+
+        // Load the time and the coefficients.
+        auto *t = load_vector_from_memory(builder, t_ptr, batch_size);
+
+        std::vector<llvm::Value *> cfs;
+        auto cf_arg = f->args().begin() + 5;
+        for (const auto &arg : fn.args()) {
+            cfs.push_back(std::visit(
+                [&](const auto &v) -> llvm::Value * {
+                    using type = uncvref_t<decltype(v)>;
+
+                    if constexpr (is_num_param_v<type>) {
+                        return taylor_c_diff_numparam_codegen(s, v, cf_arg, par_ptr, batch_size);
+                    } else {
+                        // NOTE: unreachable, the argument types were checked above.
+                        assert(false);
+                        return nullptr;
+                    }
+                },
+                arg.value()));
+            ++cf_arg;
+        }
+
+        // Dispatch on the order: each derivative of order less than
+        // the number of coefficients is computed by its own block,
+        // the higher-order derivatives are zero.
+        const auto n_cfs = boost::numeric_cast<std::uint32_t>(cfs.size());
+
+        auto *bb_def = llvm::BasicBlock::Create(context, "", f);
+        auto *sw = builder.CreateSwitch(ord, bb_def, n_cfs);
+
+        for (std::uint32_t n = 0; n < n_cfs; ++n) {
+            auto *bb_case = llvm::BasicBlock::Create(context, "", f);
+            sw->addCase(builder.getInt32(n), bb_case);
+
+            builder.SetInsertPoint(bb_case);
+            builder.CreateRet(tpoly_codegen_diff<T>(s, cfs, t, n, batch_size));
+        }
+
+        builder.SetInsertPoint(bb_def);
+        builder.CreateRet(vector_splat(builder, codegen<T>(s, number{0.}), batch_size));
+
+        // Verify.
+        s.verify_function(f);
+
+        // Restore the original insertion block.
+        builder.SetInsertPoint(orig_bb);
+    } else {
+        // The function was created before. Check if the signatures match.
+        // NOTE: there could be a mismatch if the derivative function was created
+        // and then optimised - optimisation might remove arguments which are compile-time
+        // constants.
+        if (!compare_function_signature(f, val_t, fargs)) {
+            throw std::invalid_argument(
+                "Inconsistent function signature for the Taylor derivative of a polynomial of time in compact mode "
+                "detected");
+        }
+    }
+
+    return f;
+}
+
+} // namespace
+
+llvm::Function *tpoly_impl::taylor_c_diff_func_dbl(llvm_state &s, std::uint32_t, std::uint32_t batch_size) const
+{
+    return taylor_c_diff_func_tpoly<double>(s, *this, batch_size);
+}
+
+llvm::Function *tpoly_impl::taylor_c_diff_func_ldbl(llvm_state &s, std::uint32_t, std::uint32_t batch_size) const
+{
+    return taylor_c_diff_func_tpoly<long double>(s, *this, batch_size);
+}
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+llvm::Function *tpoly_impl::taylor_c_diff_func_f128(llvm_state &s, std::uint32_t, std::uint32_t batch_size) const
+{
+    return taylor_c_diff_func_tpoly<mppp::real128>(s, *this, batch_size);
+}
+
+#endif
+
+} // namespace detail
+
+expression tpoly(std::vector<expression> cfs)
+{
+    return expression{func{detail::tpoly_impl{std::move(cfs)}}};
+}
+
+} // namespace heyoka
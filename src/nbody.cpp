@@ -6,16 +6,26 @@
 // Public License v. 2.0. If a copy of the MPL was not distributed
 // with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
 
+#include <heyoka/config.hpp>
+
 #include <algorithm>
 #include <array>
+#include <atomic>
 #include <cassert>
 #include <cmath>
+#include <cstddef>
 #include <cstdint>
+#include <exception>
 #include <initializer_list>
 #include <limits>
 #include <random>
 #include <stdexcept>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
 #include <utility>
+#include <variant>
 #include <vector>
 
 #include <boost/math/constants/constants.hpp>
@@ -23,11 +33,33 @@
 
 #include <fmt/format.h>
 
+#include <llvm/IR/Attributes.h>
+#include <llvm/IR/BasicBlock.h>
+#include <llvm/IR/DerivedTypes.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/Module.h>
+#include <llvm/IR/Type.h>
+#include <llvm/IR/Value.h>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <heyoka/compiled_function.hpp>
+#include <heyoka/detail/llvm_helpers.hpp>
+#include <heyoka/detail/run_workers.hpp>
 #include <heyoka/detail/string_conv.hpp>
 #include <heyoka/expression.hpp>
+#include <heyoka/func.hpp>
+#include <heyoka/llvm_state.hpp>
 #include <heyoka/math.hpp>
 #include <heyoka/nbody.hpp>
 #include <heyoka/number.hpp>
+#include <heyoka/splitmix64.hpp>
+#include <heyoka/taylor.hpp>
 #include <heyoka/variable.hpp>
 
 namespace heyoka
@@ -120,7 +152,7 @@ std::vector<std::pair<expression, expression>> make_nbody_sys_fixed_masses(std::
                 auto diff_y = y_vars[j] - y_vars[i];
                 auto diff_z = z_vars[j] - z_vars[i];
 
-                auto r_m3 = pow(square(diff_x) + square(diff_y) + square(diff_z), expression{-3. / 2});
+                auto r_m3 = pow(sum_sq({diff_x, diff_y, diff_z}), expression{-3. / 2});
                 if (j < n_fc_massive) {
                     // Body j is massive and it interacts mutually with body i.
                     // NOTE: the idea here is that we want to help the CSE process
@@ -151,22 +183,22 @@ std::vector<std::pair<expression, expression>> make_nbody_sys_fixed_masses(std::
             }
 
             // Add the expressions of the accelerations to the system.
-            retval.push_back(prime(vx_vars[i]) = pairwise_sum(x_acc[i]));
-            retval.push_back(prime(vy_vars[i]) = pairwise_sum(y_acc[i]));
-            retval.push_back(prime(vz_vars[i]) = pairwise_sum(z_acc[i]));
+            retval.push_back(prime(vx_vars[i]) = sum(x_acc[i]));
+            retval.push_back(prime(vy_vars[i]) = sum(y_acc[i]));
+            retval.push_back(prime(vz_vars[i]) = sum(z_acc[i]));
         }
 
         // All the accelerations on the massless particles
         // have already been accumulated in the loop above.
-        // We just need to perform the pairwise sums on x/y/z_acc.
+        // We just need to perform the sums on x/y/z_acc.
         for (std::uint32_t i = n_fc_massive; i < n; ++i) {
             retval.push_back(prime(x_vars[i]) = vx_vars[i]);
             retval.push_back(prime(y_vars[i]) = vy_vars[i]);
             retval.push_back(prime(z_vars[i]) = vz_vars[i]);
 
-            retval.push_back(prime(vx_vars[i]) = pairwise_sum(x_acc[i]));
-            retval.push_back(prime(vy_vars[i]) = pairwise_sum(y_acc[i]));
-            retval.push_back(prime(vz_vars[i]) = pairwise_sum(z_acc[i]));
+            retval.push_back(prime(vx_vars[i]) = sum(x_acc[i]));
+            retval.push_back(prime(vy_vars[i]) = sum(y_acc[i]));
+            retval.push_back(prime(vz_vars[i]) = sum(z_acc[i]));
         }
     } else {
         for (std::uint32_t i = 0; i < n; ++i) {
@@ -181,11 +213,17 @@ std::vector<std::pair<expression, expression>> make_nbody_sys_fixed_masses(std::
             // the contribution from i to the total acceleration
             // on body j.
             for (std::uint32_t j = i + 1u; j < n; ++j) {
+                if (is_zero(masses[i]) && is_zero(masses[j])) {
+                    // NOTE: massless particles do not interact
+                    // with each other, skip the pair altogether.
+                    continue;
+                }
+
                 auto diff_x = x_vars[j] - x_vars[i];
                 auto diff_y = y_vars[j] - y_vars[i];
                 auto diff_z = z_vars[j] - z_vars[i];
 
-                auto r_m3 = pow(square(diff_x) + square(diff_y) + square(diff_z), expression{-3. / 2});
+                auto r_m3 = pow(sum_sq({diff_x, diff_y, diff_z}), expression{-3. / 2});
                 if (is_zero(masses[j])) {
                     // NOTE: special-case for m_j = 0, so that
                     // we avoid a division by zero in the other branch.
@@ -194,6 +232,15 @@ std::vector<std::pair<expression, expression>> make_nbody_sys_fixed_masses(std::
                     x_acc[j].push_back(diff_x * fac);
                     y_acc[j].push_back(diff_y * fac);
                     z_acc[j].push_back(diff_z * fac);
+                } else if (is_zero(masses[i])) {
+                    // NOTE: special-case for m_i = 0, so that
+                    // we avoid adding null terms to the acceleration
+                    // on body j.
+                    auto fac_j = expression{Gconst * masses[j]} * r_m3;
+
+                    x_acc[i].push_back(diff_x * fac_j);
+                    y_acc[i].push_back(diff_y * fac_j);
+                    z_acc[i].push_back(diff_z * fac_j);
                 } else {
                     // NOTE: the idea here is that we want to help the CSE process
                     // when computing the Taylor decomposition. Thus, we try
@@ -215,9 +262,9 @@ std::vector<std::pair<expression, expression>> make_nbody_sys_fixed_masses(std::
             }
 
             // Add the expressions of the accelerations to the system.
-            retval.push_back(prime(vx_vars[i]) = pairwise_sum(x_acc[i]));
-            retval.push_back(prime(vy_vars[i]) = pairwise_sum(y_acc[i]));
-            retval.push_back(prime(vz_vars[i]) = pairwise_sum(z_acc[i]));
+            retval.push_back(prime(vx_vars[i]) = sum(x_acc[i]));
+            retval.push_back(prime(vy_vars[i]) = sum(y_acc[i]));
+            retval.push_back(prime(vz_vars[i]) = sum(z_acc[i]));
         }
     }
 
@@ -280,7 +327,7 @@ std::vector<std::pair<expression, expression>> make_nbody_sys_par_masses(std::ui
             auto diff_y = y_vars[j] - y_vars[i];
             auto diff_z = z_vars[j] - z_vars[i];
 
-            auto r_m3 = pow(square(diff_x) + square(diff_y) + square(diff_z), expression{-3. / 2});
+            auto r_m3 = pow(sum_sq({diff_x, diff_y, diff_z}), expression{-3. / 2});
             if (j < n_massive) {
                 // Body j is massive and it interacts mutually with body i.
                 // NOTE: the idea here is that we want to help the CSE process
@@ -311,22 +358,261 @@ std::vector<std::pair<expression, expression>> make_nbody_sys_par_masses(std::ui
         }
 
         // Add the expressions of the accelerations to the system.
-        retval.push_back(prime(vx_vars[i]) = pairwise_sum(x_acc[i]));
-        retval.push_back(prime(vy_vars[i]) = pairwise_sum(y_acc[i]));
-        retval.push_back(prime(vz_vars[i]) = pairwise_sum(z_acc[i]));
+        retval.push_back(prime(vx_vars[i]) = sum(x_acc[i]));
+        retval.push_back(prime(vy_vars[i]) = sum(y_acc[i]));
+        retval.push_back(prime(vz_vars[i]) = sum(z_acc[i]));
     }
 
     // All the accelerations on the massless particles
     // have already been accumulated in the loop above.
-    // We just need to perform the pairwise sums on x/y/z_acc.
+    // We just need to perform the sums on x/y/z_acc.
     for (std::uint32_t i = n_massive; i < n; ++i) {
         retval.push_back(prime(x_vars[i]) = vx_vars[i]);
         retval.push_back(prime(y_vars[i]) = vy_vars[i]);
         retval.push_back(prime(z_vars[i]) = vz_vars[i]);
 
-        retval.push_back(prime(vx_vars[i]) = pairwise_sum(x_acc[i]));
-        retval.push_back(prime(vy_vars[i]) = pairwise_sum(y_acc[i]));
-        retval.push_back(prime(vz_vars[i]) = pairwise_sum(z_acc[i]));
+        retval.push_back(prime(vx_vars[i]) = sum(x_acc[i]));
+        retval.push_back(prime(vy_vars[i]) = sum(y_acc[i]));
+        retval.push_back(prime(vz_vars[i]) = sum(z_acc[i]));
+    }
+
+    return retval;
+}
+
+namespace
+{
+
+// Validation of the masses for the N-body systems in
+// Jacobi and democratic heliocentric coordinates.
+void check_nbody_rel_masses(std::uint32_t n, const std::vector<number> &masses, const char *coords)
+{
+    using namespace fmt::literals;
+
+    if (masses.size() != n) {
+        throw std::invalid_argument(
+            "Inconsistent sizes detected while creating an N-body system in {} coordinates: the vector of masses has "
+            "a size of {}, while the number of bodies is {}"_format(coords, masses.size(), n));
+    }
+
+    if (is_zero(masses[0])) {
+        throw std::invalid_argument(
+            "The mass of the first body cannot be zero in an N-body system in {} coordinates"_format(coords));
+    }
+}
+
+// Create the state variables x_i, y_i, ..., vz_i for i in [1, n).
+auto make_nbody_rel_vars(std::uint32_t n)
+{
+    std::array<std::vector<expression>, 6> retval;
+
+    for (std::uint32_t i = 1; i < n; ++i) {
+        const auto i_str = li_to_string(i);
+
+        retval[0].emplace_back(variable("x_" + i_str));
+        retval[1].emplace_back(variable("y_" + i_str));
+        retval[2].emplace_back(variable("z_" + i_str));
+
+        retval[3].emplace_back(variable("vx_" + i_str));
+        retval[4].emplace_back(variable("vy_" + i_str));
+        retval[5].emplace_back(variable("vz_" + i_str));
+    }
+
+    return retval;
+}
+
+} // namespace
+
+// NOTE: in the barycentric frame, the position of body k is expressed in terms
+// of the Jacobi vectors r_l (l in [1, n)) as
+//
+// x_k = eta_{k-1} / eta_k * r_k - sum_{l > k} m_l / eta_l * r_l,
+//
+// where eta_k is the total mass of the bodies [0, k] (x_0 lacks the first term).
+// The Jacobi acceleration of body i is a_i - sum_{k < i} m_k / eta_{i-1} * a_k,
+// where a_k is the Newtonian acceleration of body k. Both the accelerations and
+// the Jacobi accelerations are thus linear combinations of the pairwise terms
+// G * (x_q - x_p) / |x_q - x_p|**3, which are computed once per interacting pair.
+std::vector<std::pair<expression, expression>> make_nbody_jacobi_sys_impl(std::uint32_t n, number Gconst,
+                                                                          std::vector<number> masses)
+{
+    assert(n >= 2u);
+
+    check_nbody_rel_masses(n, masses, "Jacobi");
+
+    const auto vars = make_nbody_rel_vars(n);
+
+    // The cumulative masses.
+    std::vector<number> eta{masses[0]};
+    for (std::uint32_t i = 1; i < n; ++i) {
+        eta.push_back(eta.back() + masses[i]);
+
+        if (is_zero(eta.back())) {
+            throw std::invalid_argument("The total mass of the first {} bodies cannot be zero in an N-body "
+                                        "system in Jacobi coordinates"_format(i + 1u));
+        }
+    }
+
+    // Coefficient of r_l in x_k.
+    auto coeff = [&](std::uint32_t k, std::uint32_t l) {
+        if (l < k) {
+            return number{0.};
+        } else if (l == k) {
+            return eta[k - 1u] / eta[k];
+        } else {
+            return -masses[l] / eta[l];
+        }
+    };
+
+    // Coefficient of a_k in the Jacobi acceleration of body i.
+    auto acc_coeff = [&](std::uint32_t i, std::uint32_t k) {
+        if (k == i) {
+            return number{1.};
+        } else if (k < i) {
+            return -masses[k] / eta[i - 1u];
+        } else {
+            return number{0.};
+        }
+    };
+
+    // Accumulators for the Jacobi accelerations.
+    std::array<std::vector<std::vector<expression>>, 3> acc;
+    for (auto &v : acc) {
+        v.resize(boost::numeric_cast<decltype(v.size())>(n));
+    }
+
+    for (std::uint32_t p = 0; p < n; ++p) {
+        for (std::uint32_t q = p + 1u; q < n; ++q) {
+            if (is_zero(masses[p]) && is_zero(masses[q])) {
+                // NOTE: massless particles do not interact
+                // with each other, skip the pair altogether.
+                continue;
+            }
+
+            // x_q - x_p. The coefficients of r_l with l > q cancel out.
+            std::array<std::vector<expression>, 3> diff_terms;
+            for (std::uint32_t l = 1; l <= q; ++l) {
+                const auto c = coeff(q, l) - coeff(p, l);
+
+                if (is_zero(c)) {
+                    continue;
+                }
+
+                for (auto j = 0u; j < 3u; ++j) {
+                    diff_terms[j].push_back(is_one(c) ? vars[j][l - 1u] : expression{c} * vars[j][l - 1u]);
+                }
+            }
+
+            const std::array diff{sum(diff_terms[0]), sum(diff_terms[1]), sum(diff_terms[2])};
+            const auto fac = expression{Gconst} * pow(sum_sq({diff[0], diff[1], diff[2]}), expression{-3. / 2});
+
+            // The pairwise term contributes m_q * fac * diff to a_p
+            // and -m_p * fac * diff to a_q.
+            for (std::uint32_t i = 1; i < n; ++i) {
+                const auto w = acc_coeff(i, p) * masses[q] - acc_coeff(i, q) * masses[p];
+
+                if (is_zero(w)) {
+                    continue;
+                }
+
+                for (auto j = 0u; j < 3u; ++j) {
+                    acc[j][i].push_back(diff[j] * (expression{w} * fac));
+                }
+            }
+        }
+    }
+
+    std::vector<std::pair<expression, expression>> retval;
+
+    for (std::uint32_t i = 1; i < n; ++i) {
+        for (auto j = 0u; j < 3u; ++j) {
+            retval.push_back(prime(vars[j][i - 1u]) = vars[j + 3u][i - 1u]);
+        }
+
+        for (auto j = 0u; j < 3u; ++j) {
+            retval.push_back(prime(vars[j + 3u][i - 1u]) = sum(acc[j][i]));
+        }
+    }
+
+    return retval;
+}
+
+// NOTE: in democratic heliocentric coordinates, the positions are relative to body 0
+// and the velocities are barycentric, so that
+//
+// Q_i' = V_i + sum_{j >= 1} m_j / m_0 * V_j,
+// V_i' = -G * m_0 * Q_i / |Q_i|**3 + sum_{j >= 1, j != i} G * m_j * (Q_j - Q_i) / |Q_j - Q_i|**3.
+std::vector<std::pair<expression, expression>> make_nbody_dh_sys_impl(std::uint32_t n, number Gconst,
+                                                                      std::vector<number> masses)
+{
+    assert(n >= 2u);
+
+    check_nbody_rel_masses(n, masses, "democratic heliocentric");
+
+    const auto vars = make_nbody_rel_vars(n);
+
+    // The velocity of body 0 with respect to the barycentre, with the sign changed.
+    std::array<std::vector<expression>, 3> v0_terms;
+    for (std::uint32_t i = 1; i < n; ++i) {
+        if (is_zero(masses[i])) {
+            continue;
+        }
+
+        for (auto j = 0u; j < 3u; ++j) {
+            v0_terms[j].push_back(expression{masses[i] / masses[0]} * vars[j + 3u][i - 1u]);
+        }
+    }
+
+    // Accumulators for the accelerations.
+    std::array<std::vector<std::vector<expression>>, 3> acc;
+    for (auto &v : acc) {
+        v.resize(boost::numeric_cast<decltype(v.size())>(n));
+    }
+
+    for (std::uint32_t i = 1; i < n; ++i) {
+        // The acceleration due to body 0.
+        const auto fac0 = expression{-Gconst * masses[0]}
+                          * pow(sum_sq({vars[0][i - 1u], vars[1][i - 1u], vars[2][i - 1u]}), expression{-3. / 2});
+        for (auto j = 0u; j < 3u; ++j) {
+            acc[j][i].push_back(vars[j][i - 1u] * fac0);
+        }
+
+        for (std::uint32_t k = i + 1u; k < n; ++k) {
+            if (is_zero(masses[i]) && is_zero(masses[k])) {
+                continue;
+            }
+
+            std::array<expression, 3> diff;
+            for (auto j = 0u; j < 3u; ++j) {
+                diff[j] = vars[j][k - 1u] - vars[j][i - 1u];
+            }
+
+            const auto r_m3 = pow(sum_sq({diff[0], diff[1], diff[2]}), expression{-3. / 2});
+
+            for (auto j = 0u; j < 3u; ++j) {
+                if (!is_zero(masses[k])) {
+                    acc[j][i].push_back(diff[j] * (expression{Gconst * masses[k]} * r_m3));
+                }
+                if (!is_zero(masses[i])) {
+                    acc[j][k].push_back(diff[j] * (expression{-Gconst * masses[i]} * r_m3));
+                }
+            }
+        }
+    }
+
+    std::vector<std::pair<expression, expression>> retval;
+
+    for (std::uint32_t i = 1; i < n; ++i) {
+        for (auto j = 0u; j < 3u; ++j) {
+            if (v0_terms[j].empty()) {
+                retval.push_back(prime(vars[j][i - 1u]) = vars[j + 3u][i - 1u]);
+            } else {
+                retval.push_back(prime(vars[j][i - 1u]) = vars[j + 3u][i - 1u] + sum(v0_terms[j]));
+            }
+        }
+
+        for (auto j = 0u; j < 3u; ++j) {
+            retval.push_back(prime(vars[j + 3u][i - 1u]) = sum(acc[j][i]));
+        }
     }
 
     return retval;
@@ -335,6 +621,274 @@ std::vector<std::pair<expression, expression>> make_nbody_sys_par_masses(std::ui
 namespace
 {
 
+// Implementation of taylor_add_nbody_jet().
+// NOTE: the derivatives of the state variables are computed order by order. For each
+// pair of bodies (i, j), the Taylor coefficients of the squared distance s_ij and of
+// w_ij = s_ij**(-3/2) are computed via the recurrences of square() and pow(), and stored
+// in global arrays. The differences of the coordinates are computed on the fly from the jet,
+// and they are thus never stored.
+template <typename T>
+void taylor_add_nbody_jet_impl(llvm_state &s, const std::string &name, std::uint32_t n, std::uint32_t order,
+                               std::uint32_t batch_size, const number &Gconst)
+{
+    if (s.is_compiled()) {
+        throw std::invalid_argument("A function for the computation of the jet of Taylor derivatives cannot be added "
+                                    "to an llvm_state after compilation");
+    }
+
+    if (n < 2u) {
+        throw std::invalid_argument("At least 2 bodies are needed to construct an N-body system");
+    }
+
+    if (order == 0u) {
+        throw std::invalid_argument("The order of a Taylor jet cannot be zero");
+    }
+
+    if (batch_size == 0u) {
+        throw std::invalid_argument("The batch size of a Taylor jet cannot be zero");
+    }
+
+    // NOTE: overflow checking. We need to be able to index into the jet array
+    // (size n_eq * (order + 1) * batch_size), into the array of masses (size
+    // n * batch_size) and into the arrays of the pairwise quantities (size
+    // n_pairs * order) using uint32_t.
+    constexpr auto u32_max = std::numeric_limits<std::uint32_t>::max();
+    const auto n_pairs_64 = static_cast<std::uint64_t>(n) * (n - 1u) / 2u;
+
+    if (n > u32_max / 6u || order == u32_max || (order + 1u) > u32_max / batch_size
+        || 6u * n > u32_max / ((order + 1u) * batch_size) || n_pairs_64 > u32_max / order) {
+        throw std::overflow_error("An overflow condition was detected while adding an N-body Taylor jet");
+    }
+
+    const auto n_eq = 6u * n;
+    const auto n_pairs = static_cast<std::uint32_t>(n_pairs_64);
+
+    auto &builder = s.builder();
+    auto &context = s.context();
+    auto &md = s.module();
+
+    auto *fp_t = to_llvm_type<T>(context);
+    auto *val_t = to_llvm_vector_type<T>(context, batch_size);
+
+    // Prepare the function prototype. The arguments are the same
+    // as in the functions created by taylor_add_jet().
+    std::vector<llvm::Type *> fargs(3, llvm::PointerType::getUnqual(fp_t));
+    auto *ft = llvm::FunctionType::get(builder.getVoidTy(), fargs, false);
+    assert(ft != nullptr);
+    auto *f = llvm::Function::Create(ft, llvm::Function::ExternalLinkage, name, &md);
+    if (f == nullptr) {
+        throw std::invalid_argument(
+            "Unable to create a function for the computation of the jet of Taylor derivatives with name '" + name
+            + "'");
+    }
+
+    auto in_out = f->args().begin();
+    in_out->setName("in_out");
+    in_out->addAttr(llvm::Attribute::NoCapture);
+    in_out->addAttr(llvm::Attribute::NoAlias);
+
+    auto par_ptr = in_out + 1;
+    par_ptr->setName("par_ptr");
+    par_ptr->addAttr(llvm::Attribute::NoCapture);
+    par_ptr->addAttr(llvm::Attribute::NoAlias);
+    par_ptr->addAttr(llvm::Attribute::ReadOnly);
+
+    auto time_ptr = par_ptr + 1;
+    time_ptr->setName("time_ptr");
+    time_ptr->addAttr(llvm::Attribute::NoCapture);
+    time_ptr->addAttr(llvm::Attribute::NoAlias);
+    time_ptr->addAttr(llvm::Attribute::ReadOnly);
+
+    auto *bb = llvm::BasicBlock::Create(context, "entry", f);
+    assert(bb != nullptr);
+    builder.SetInsertPoint(bb);
+
+    // The global arrays for the Taylor coefficients of orders [0, order) of s_ij and w_ij
+    // (stored order by order), and for the accelerations on the bodies at the current order.
+    // NOTE: as in compact mode, we use global arrays rather than local ones
+    // because their sizes can grow quite large.
+    auto *pair_arr_t = llvm::ArrayType::get(val_t, static_cast<std::uint64_t>(n_pairs) * order);
+    auto *acc_arr_t = llvm::ArrayType::get(val_t, static_cast<std::uint64_t>(n) * 3u);
+
+    auto *s_arr = builder.CreateInBoundsGEP(pair_arr_t, make_global_zero_array(md, pair_arr_t),
+                                            {builder.getInt32(0), builder.getInt32(0)});
+    auto *w_arr = builder.CreateInBoundsGEP(pair_arr_t, make_global_zero_array(md, pair_arr_t),
+                                            {builder.getInt32(0), builder.getInt32(0)});
+    auto *acc_arr = builder.CreateInBoundsGEP(acc_arr_t, make_global_zero_array(md, acc_arr_t),
+                                              {builder.getInt32(0), builder.getInt32(0)});
+
+    // The index of the current pair and the accumulators.
+    // NOTE: these are created here in order to
+    // avoid allocas in the loops below.
+    auto *pair_idx = builder.CreateAlloca(builder.getInt32Ty());
+    auto *acc = builder.CreateAlloca(val_t);
+    std::array<llvm::Value *, 3> c_acc{};
+    for (auto &ptr : c_acc) {
+        ptr = builder.CreateAlloca(val_t);
+    }
+
+    // Constants.
+    auto *zero_v = vector_splat(builder, codegen<T>(s, number{0.}), batch_size);
+    auto *one_v = vector_splat(builder, codegen<T>(s, number{1.}), batch_size);
+    auto *alpha_v = vector_splat(builder, codegen<T>(s, number{-3. / 2}), batch_size);
+    auto *G_v = vector_splat(builder, codegen<T>(s, Gconst), batch_size);
+
+    // Helpers to convert an index into a vector of floating-point values.
+    auto to_fp_v = [&](llvm::Value *v) { return vector_splat(builder, builder.CreateUIToFP(v, fp_t), batch_size); };
+
+    // Pointer to the order cur_order of the state variable var_idx in the jet.
+    auto jet_ptr = [&](llvm::Value *cur_order, llvm::Value *var_idx) {
+        return builder.CreateInBoundsGEP(
+            in_out, {builder.CreateAdd(builder.CreateMul(cur_order, builder.getInt32(n_eq * batch_size)),
+                                       builder.CreateMul(var_idx, builder.getInt32(batch_size)))});
+    };
+
+    // Index of the coordinate k (0 to 2 for the positions,
+    // 3 to 5 for the velocities) of the body i in the state vector.
+    auto sv_idx = [&](llvm::Value *i, std::uint32_t k) {
+        return builder.CreateAdd(builder.CreateMul(i, builder.getInt32(6)), builder.getInt32(k));
+    };
+
+    // Order cur_order of the k-th coordinate of r_j - r_i.
+    auto diff = [&](llvm::Value *cur_order, llvm::Value *i, llvm::Value *j, std::uint32_t k) {
+        return builder.CreateFSub(load_vector_from_memory(builder, jet_ptr(cur_order, sv_idx(j, k)), batch_size),
+                                  load_vector_from_memory(builder, jet_ptr(cur_order, sv_idx(i, k)), batch_size));
+    };
+
+    // Pointer to the order cur_order of the pair p in arr.
+    auto pair_ptr = [&](llvm::Value *arr, llvm::Value *cur_order, llvm::Value *p) {
+        return builder.CreateInBoundsGEP(
+            arr, {builder.CreateAdd(builder.CreateMul(cur_order, builder.getInt32(n_pairs)), p)});
+    };
+
+    // Mass of the body i.
+    auto mass = [&](llvm::Value *i) {
+        return load_vector_from_memory(
+            builder, builder.CreateInBoundsGEP(par_ptr, {builder.CreateMul(i, builder.getInt32(batch_size))}),
+            batch_size);
+    };
+
+    // Accumulate v into the pointer ptr.
+    auto accumulate = [&](llvm::Value *ptr, llvm::Value *v) {
+        builder.CreateStore(builder.CreateFAdd(builder.CreateLoad(ptr), v), ptr);
+    };
+
+    llvm_loop_u32(s, builder.getInt32(1), builder.getInt32(order + 1u), [&](llvm::Value *cur_order) {
+        // The order m of the Taylor coefficients of the accelerations
+        // (and thus of the pairwise quantities) needed at this order.
+        auto *m = builder.CreateSub(cur_order, builder.getInt32(1));
+
+        llvm_loop_u32(s, builder.getInt32(0), builder.getInt32(3u * n), [&](llvm::Value *idx) {
+            builder.CreateStore(zero_v, builder.CreateInBoundsGEP(acc_arr, {idx}));
+        });
+
+        builder.CreateStore(builder.getInt32(0), pair_idx);
+
+        llvm_loop_u32(s, builder.getInt32(0), builder.getInt32(n), [&](llvm::Value *i) {
+            llvm_loop_u32(s, builder.CreateAdd(i, builder.getInt32(1)), builder.getInt32(n), [&](llvm::Value *j) {
+                auto *p = builder.CreateLoad(pair_idx);
+
+                // s_ij^[m] = sum_k sum_l d_k^[l] * d_k^[m - l].
+                builder.CreateStore(zero_v, acc);
+                llvm_loop_u32(s, builder.getInt32(0), cur_order, [&](llvm::Value *l) {
+                    auto *m_l = builder.CreateSub(m, l);
+
+                    for (std::uint32_t k = 0; k < 3u; ++k) {
+                        accumulate(acc, builder.CreateFMul(diff(l, i, j, k), diff(m_l, i, j, k)));
+                    }
+                });
+                builder.CreateStore(builder.CreateLoad(acc), pair_ptr(s_arr, m, p));
+
+                // w_ij^[m].
+                llvm_if_then_else(
+                    s, builder.CreateICmpEQ(m, builder.getInt32(0)),
+                    [&]() {
+                        // Order 0: w = 1 / (s * sqrt(s)).
+                        auto *s0 = builder.CreateLoad(acc);
+                        auto *sqrt_s0 = codegen_from_values<T>(s, sqrt_impl{}, {s0});
+
+                        builder.CreateStore(builder.CreateFDiv(one_v, builder.CreateFMul(s0, sqrt_s0)),
+                                            pair_ptr(w_arr, m, p));
+                    },
+                    [&]() {
+                        // w^[m] = 1 / (m * s^[0]) * sum_{l=0}^{m-1} (alpha * (m - l) - l) * s^[m - l] * w^[l].
+                        builder.CreateStore(zero_v, acc);
+                        llvm_loop_u32(s, builder.getInt32(0), m, [&](llvm::Value *l) {
+                            auto *m_l = builder.CreateSub(m, l);
+
+                            auto *fac = builder.CreateFSub(builder.CreateFMul(alpha_v, to_fp_v(m_l)), to_fp_v(l));
+
+                            accumulate(acc, builder.CreateFMul(fac, builder.CreateFMul(
+                                                                        builder.CreateLoad(pair_ptr(s_arr, m_l, p)),
+                                                                        builder.CreateLoad(pair_ptr(w_arr, l, p)))));
+                        });
+
+                        auto *s0 = builder.CreateLoad(pair_ptr(s_arr, builder.getInt32(0), p));
+
+                        builder.CreateStore(
+                            builder.CreateFDiv(builder.CreateLoad(acc), builder.CreateFMul(to_fp_v(m), s0)),
+                            pair_ptr(w_arr, m, p));
+                    });
+
+                // (d_k * w_ij)^[m] = sum_l d_k^[l] * w_ij^[m - l].
+                for (auto *ptr : c_acc) {
+                    builder.CreateStore(zero_v, ptr);
+                }
+                llvm_loop_u32(s, builder.getInt32(0), cur_order, [&](llvm::Value *l) {
+                    auto *w_ml = builder.CreateLoad(pair_ptr(w_arr, builder.CreateSub(m, l), p));
+
+                    for (std::uint32_t k = 0; k < 3u; ++k) {
+                        accumulate(c_acc[k], builder.CreateFMul(diff(l, i, j, k), w_ml));
+                    }
+                });
+
+                // Add the contributions to the accelerations on i and j.
+                auto *fac_i = builder.CreateFMul(G_v, mass(j));
+                auto *fac_j = builder.CreateFMul(G_v, mass(i));
+
+                for (std::uint32_t k = 0; k < 3u; ++k) {
+                    auto *c = builder.CreateLoad(c_acc[k]);
+
+                    accumulate(builder.CreateInBoundsGEP(
+                                   acc_arr, {builder.CreateAdd(builder.CreateMul(i, builder.getInt32(3)),
+                                                               builder.getInt32(k))}),
+                               builder.CreateFMul(fac_i, c));
+                    accumulate(builder.CreateInBoundsGEP(
+                                   acc_arr, {builder.CreateAdd(builder.CreateMul(j, builder.getInt32(3)),
+                                                               builder.getInt32(k))}),
+                               builder.CreateFNeg(builder.CreateFMul(fac_j, c)));
+                }
+
+                builder.CreateStore(builder.CreateAdd(p, builder.getInt32(1)), pair_idx);
+            });
+        });
+
+        // Write the derivatives of order cur_order of the state variables: r^[n] = v^[n - 1] / n
+        // and v^[n] = a^[n - 1] / n.
+        auto *ord_v = to_fp_v(cur_order);
+
+        llvm_loop_u32(s, builder.getInt32(0), builder.getInt32(n), [&](llvm::Value *i) {
+            for (std::uint32_t k = 0; k < 3u; ++k) {
+                auto *v = load_vector_from_memory(builder, jet_ptr(m, sv_idx(i, k + 3u)), batch_size);
+                store_vector_to_memory(builder, jet_ptr(cur_order, sv_idx(i, k)), builder.CreateFDiv(v, ord_v));
+
+                auto *a = builder.CreateLoad(builder.CreateInBoundsGEP(
+                    acc_arr, {builder.CreateAdd(builder.CreateMul(i, builder.getInt32(3)), builder.getInt32(k))}));
+                store_vector_to_memory(builder, jet_ptr(cur_order, sv_idx(i, k + 3u)), builder.CreateFDiv(a, ord_v));
+            }
+        });
+    });
+
+    // Finish off the function.
+    builder.CreateRetVoid();
+
+    // Verify it.
+    s.verify_function(f);
+
+    // Run the optimisation pass.
+    s.optimise();
+}
+
 // 3d dot product helper.
 template <typename T>
 auto dot(const T &a, const T &b)
@@ -346,19 +900,45 @@ auto dot(const T &a, const T &b)
 
 } // namespace detail
 
-// Helper to generate a random elliptic orbit and convert it to cartesian variables. The min/max
-// values of a, e, i, om, Om and f are passed in the bounds array. mu is the gravitational parameter
-// of the two-body system.
-std::array<double, 6> random_elliptic_state(double mu, const std::array<std::pair<double, double>, 6> &bounds,
-                                            unsigned seed)
+void taylor_add_nbody_jet_dbl(llvm_state &s, const std::string &name, std::uint32_t n, std::uint32_t order,
+                              std::uint32_t batch_size, number Gconst)
+{
+    detail::taylor_add_nbody_jet_impl<double>(s, name, n, order, batch_size, Gconst);
+}
+
+void taylor_add_nbody_jet_ldbl(llvm_state &s, const std::string &name, std::uint32_t n, std::uint32_t order,
+                               std::uint32_t batch_size, number Gconst)
+{
+    detail::taylor_add_nbody_jet_impl<long double>(s, name, n, order, batch_size, Gconst);
+}
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+void taylor_add_nbody_jet_f128(llvm_state &s, const std::string &name, std::uint32_t n, std::uint32_t order,
+                               std::uint32_t batch_size, number Gconst)
+{
+    detail::taylor_add_nbody_jet_impl<mppp::real128>(s, name, n, order, batch_size, Gconst);
+}
+
+#endif
+
+namespace detail
+{
+
+namespace
+{
+
+// Validate the parameters of random_elliptic_state() and of its
+// batch counterpart (whose name is fname).
+void check_elliptic_bounds(double mu, const std::array<std::pair<double, double>, 6> &bounds, const char *fname)
 {
     using namespace fmt::literals;
 
     // Validate input params.
     if (!std::isfinite(mu) || mu <= 0) {
         throw std::invalid_argument(
-            "Invalid mu parameter used in random_elliptic_state(): it must be positive and finite, but it is {} instead"_format(
-                mu));
+            "Invalid mu parameter used in {}(): it must be positive and finite, but it is {} instead"_format(
+                fname, mu));
     }
 
     for (const auto &b : bounds) {
@@ -366,8 +946,8 @@ std::array<double, 6> random_elliptic_state(double mu, const std::array<std::pai
 
         if (!std::isfinite(lb) || !std::isfinite(ub) || !(ub > lb)) {
             throw std::invalid_argument(
-                "Invalid lower/upper bounds detected in random_elliptic_state(): the bounds must be finite and such that ub > lb, but they are [{}, {}) instead"_format(
-                    lb, ub));
+                "Invalid lower/upper bounds detected in {}(): the bounds must be finite and such that ub > lb, but they are [{}, {}) instead"_format(
+                    fname, lb, ub));
         }
     }
 
@@ -375,41 +955,61 @@ std::array<double, 6> random_elliptic_state(double mu, const std::array<std::pai
     const auto &[a_min, a_max] = bounds[0];
     if (a_min <= 0) {
         throw std::invalid_argument(
-            "Invalid minimum semi-major axis detected in random_elliptic_state(): a_min must be positive, but it is {} instead"_format(
-                a_min));
+            "Invalid minimum semi-major axis detected in {}(): a_min must be positive, but it is {} instead"_format(
+                fname, a_min));
     }
     if ((a_max - a_min) > std::numeric_limits<double>::max()) {
-        throw std::overflow_error("Overflow error in the semi-major axis range passed to random_elliptic_state()");
+        throw std::overflow_error("Overflow error in the semi-major axis range passed to {}()"_format(fname));
     }
 
     const auto &[e_min, e_max] = bounds[1];
     if (e_min <= 0 || e_max > 1) {
         throw std::invalid_argument(
-            "Invalid eccentricity range detected in random_elliptic_state(): the range must be (0, 1), but it is [{}, {}) instead"_format(
-                e_min, e_max));
+            "Invalid eccentricity range detected in {}(): the range must be (0, 1), but it is [{}, {}) instead"_format(
+                fname, e_min, e_max));
     }
 
     const auto &[inc_min, inc_max] = bounds[2];
     if (inc_min <= 0 || inc_max > boost::math::constants::pi<double>()) {
         throw std::invalid_argument(
-            "Invalid inclination range detected in random_elliptic_state(): the range must be (0, π), but it is [{}, {}) instead"_format(
-                inc_min, inc_max));
+            "Invalid inclination range detected in {}(): the range must be (0, π), but it is [{}, {}) instead"_format(
+                fname, inc_min, inc_max));
     }
 
     const auto &[om_min, om_max] = bounds[3];
     if ((om_max - om_min) > std::numeric_limits<double>::max()) {
-        throw std::overflow_error("Overflow error in the omega range passed to random_elliptic_state()");
+        throw std::overflow_error("Overflow error in the omega range passed to {}()"_format(fname));
     }
 
     const auto &[Om_min, Om_max] = bounds[4];
     if ((Om_max - Om_min) > std::numeric_limits<double>::max()) {
-        throw std::overflow_error("Overflow error in the Omega range passed to random_elliptic_state()");
+        throw std::overflow_error("Overflow error in the Omega range passed to {}()"_format(fname));
     }
 
     const auto &[f_min, f_max] = bounds[5];
     if ((f_max - f_min) > std::numeric_limits<double>::max()) {
-        throw std::overflow_error("Overflow error in the true anomaly range passed to random_elliptic_state()");
+        throw std::overflow_error("Overflow error in the true anomaly range passed to {}()"_format(fname));
     }
+}
+
+} // namespace
+
+} // namespace detail
+
+// Helper to generate a random elliptic orbit and convert it to cartesian variables. The min/max
+// values of a, e, i, om, Om and f are passed in the bounds array. mu is the gravitational parameter
+// of the two-body system.
+std::array<double, 6> random_elliptic_state(double mu, const std::array<std::pair<double, double>, 6> &bounds,
+                                            unsigned seed)
+{
+    detail::check_elliptic_bounds(mu, bounds, "random_elliptic_state");
+
+    const auto &[a_min, a_max] = bounds[0];
+    const auto &[e_min, e_max] = bounds[1];
+    const auto &[inc_min, inc_max] = bounds[2];
+    const auto &[om_min, om_max] = bounds[3];
+    const auto &[Om_min, Om_max] = bounds[4];
+    const auto &[f_min, f_max] = bounds[5];
 
     // Setup the rng.
     static thread_local std::mt19937 rng;
@@ -430,7 +1030,31 @@ std::array<double, 6> random_elliptic_state(double mu, const std::array<std::pai
     rdist.param(p_type(f_min, f_max));
     const auto f = rdist(rng);
 
-    // Transform into cartesian state.
+    return oe_to_cartesian(mu, {a, e, inc, om, Om, f});
+}
+
+// Convert the input Keplerian orbital elements (a, e, i, om, Om, f) into a cartesian state.
+std::array<double, 6> oe_to_cartesian(double mu, const std::array<double, 6> &oe)
+{
+    using namespace fmt::literals;
+
+    if (!std::isfinite(mu) || mu <= 0) {
+        throw std::invalid_argument(
+            "Invalid mu parameter used in oe_to_cartesian(): it must be positive and finite, but it is {} instead"_format(
+                mu));
+    }
+
+    if (std::any_of(oe.begin(), oe.end(), [](const auto &x) { return !std::isfinite(x); })) {
+        throw std::invalid_argument("Non-finite values detected in the orbital elements passed to oe_to_cartesian()");
+    }
+
+    const auto [a, e, inc, om, Om, f] = oe;
+
+    if (a <= 0 || e < 0 || e >= 1) {
+        throw std::invalid_argument("oe_to_cartesian() supports only elliptic orbits, but a semi-major axis of {} and "
+                                    "an eccentricity of {} were provided"_format(a, e));
+    }
+
     using std::atan;
     using std::cos;
     using std::sin;
@@ -524,4 +1148,724 @@ std::array<double, 6> cartesian_to_oe(double mu, const std::array<double, 6> &s)
     return {a, e, inc, om, Om, f};
 }
 
+namespace detail
+{
+
+namespace
+{
+
+// Number of states processed at once by the workers
+// of the batch conversion functions.
+constexpr std::size_t oe_batch_chunk_size = 1024;
+
+// Compiled function for the conversion of the orbital elements (a, e, i, om, Om, f)
+// into cartesian states, with the same formulae as in oe_to_cartesian()
+// and the gravitational parameter stored in par[0].
+const compiled_function<double> &oe_to_cartesian_cfunc()
+{
+    static const compiled_function<double> cf = []() {
+        auto [a, e, inc, om, Om, f] = make_vars("a", "e", "i", "om", "Om", "f");
+        const auto &mu = par[0];
+
+        const auto E = 2_dbl * atan(sqrt((1_dbl - e) / (1_dbl + e)) * tan(f / 2_dbl));
+        const auto n = sqrt(mu / (a * a * a));
+
+        const auto cE = cos(E), sE = sin(E);
+        const auto sq_e = sqrt(1_dbl - e * e);
+        const auto den = 1_dbl - e * cE;
+
+        const std::array q{a * (cE - e), a * sq_e * sE};
+        const std::array vq{-n * a * sE / den, n * a * sq_e * cE / den};
+
+        const auto cOm = cos(Om), sOm = sin(Om), com = cos(om), som = sin(om), ci = cos(inc), si = sin(inc);
+
+        // NOTE: the third components of q and vq
+        // are zero, thus we need only the first two
+        // columns of the rotation matrix.
+        const std::array r1{cOm * com - sOm * ci * som, -cOm * som - sOm * ci * com};
+        const std::array r2{sOm * com + cOm * ci * som, -sOm * som + cOm * ci * com};
+        const std::array r3{si * som, si * com};
+
+        auto dot2 = [](const auto &u, const auto &v) { return u[0] * v[0] + u[1] * v[1]; };
+
+        return compiled_function<double>{
+            {dot2(r1, q), dot2(r2, q), dot2(r3, q), dot2(r1, vq), dot2(r2, vq), dot2(r3, vq)},
+            kw::vars = {a, e, inc, om, Om, f}};
+    }();
+
+    return cf;
+}
+
+// Compiled function for the conversion of the cartesian states into orbital elements,
+// with the same formulae as in cartesian_to_oe() and the gravitational parameter stored
+// in par[0]. The outputs are a, e, i, the arccosines of om, Om and f and the quantities
+// whose signs determine whether om, Om and f are larger than pi.
+const compiled_function<double> &cartesian_to_oe_cfunc()
+{
+    static const compiled_function<double> cf = []() {
+        auto [x, y, z, vx, vy, vz] = make_vars("x", "y", "z", "vx", "vy", "vz");
+        const auto &mu = par[0];
+
+        auto cross = [](const std::array<expression, 3> &u, const std::array<expression, 3> &v) {
+            return std::array{u[1] * v[2] - u[2] * v[1], u[2] * v[0] - u[0] * v[2], u[0] * v[1] - u[1] * v[0]};
+        };
+
+        const std::array<expression, 3> pos{x, y, z}, vel{vx, vy, vz};
+
+        const auto h = cross(pos, vel);
+        const auto r = sqrt(sum_sq({x, y, z}));
+        const auto vc = cross(vel, h);
+        const std::array e_v{vc[0] / mu - x / r, vc[1] / mu - y / r, vc[2] / mu - z / r};
+
+        const auto e = sqrt(sum_sq({e_v[0], e_v[1], e_v[2]}));
+        const auto h_norm = sqrt(sum_sq({h[0], h[1], h[2]}));
+        // NOTE: n = (-h[1], h[0], 0).
+        const auto n_norm = sqrt(sum_sq({h[0], h[1]}));
+
+        const auto acos_f = acos(sum({e_v[0] * x, e_v[1] * y, e_v[2] * z}) / (e * r));
+        const auto inc = acos(h[2] / h_norm);
+        const auto acos_Om = acos(-h[1] / n_norm);
+        const auto acos_om = acos((h[0] * e_v[1] - h[1] * e_v[0]) / (n_norm * e));
+        const auto a = 1_dbl / (2_dbl / r - sum_sq({vx, vy, vz}) / mu);
+
+        return compiled_function<double>{
+            {a, e, inc, acos_om, acos_Om, acos_f, e_v[2], h[0], sum({x * vx, y * vy, z * vz})},
+            kw::vars = {x, y, z, vx, vy, vz}};
+    }();
+
+    return cf;
+}
+
+void check_batch_mu(double mu, const char *fname)
+{
+    if (!std::isfinite(mu) || mu <= 0) {
+        using namespace fmt::literals;
+
+        throw std::invalid_argument(
+            "Invalid mu parameter used in {}(): it must be positive and finite, but it is {} instead"_format(fname,
+                                                                                                             mu));
+    }
+}
+
+// Run f(begin, end) over the chunks of the range [0, n), using n_threads
+// threads (0 means the number of hardware threads).
+template <typename F>
+void oe_batch_run(std::size_t n, unsigned n_threads, const F &f)
+{
+    if (n == 0u) {
+        return;
+    }
+
+    if (n_threads == 0u) {
+        n_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    const auto n_chunks = n / oe_batch_chunk_size + static_cast<std::size_t>(n % oe_batch_chunk_size != 0u);
+    if (n_threads > n_chunks) {
+        n_threads = static_cast<unsigned>(n_chunks);
+    }
+
+    std::atomic<std::size_t> next_chunk(0);
+    std::vector<std::exception_ptr> eptrs(n_threads);
+
+    auto worker_func = [&](unsigned thread_idx) {
+        try {
+            for (auto c = next_chunk.fetch_add(1); c < n_chunks; c = next_chunk.fetch_add(1)) {
+                f(c * oe_batch_chunk_size, std::min(n, (c + 1u) * oe_batch_chunk_size));
+            }
+        } catch (...) {
+            eptrs[thread_idx] = std::current_exception();
+
+            next_chunk.store(n_chunks);
+        }
+    };
+
+    run_workers(n_threads, worker_func, [&]() { next_chunk.store(n_chunks); }, eptrs);
+}
+
+// Convert the orbital elements in the range [begin, end) of the buffer in
+// (with a row stride of oe_batch_chunk_size) into cartesian states.
+void oe_batch_to_cartesian(double mu, const std::vector<double> &in, const std::array<double *, 6> &out,
+                           std::size_t begin, std::size_t end)
+{
+    const auto n = end - begin;
+
+    // NOTE: eval_batch() requires rows of size n.
+    std::vector<double> buf_in(6u * n), buf_out(6u * n);
+    for (auto j = 0u; j < 6u; ++j) {
+        std::copy(in.data() + j * oe_batch_chunk_size, in.data() + j * oe_batch_chunk_size + n,
+                  buf_in.data() + j * n);
+    }
+
+    const double pars[] = {mu};
+    oe_to_cartesian_cfunc().eval_batch(buf_out.data(), buf_in.data(), n, pars);
+
+    for (auto j = 0u; j < 6u; ++j) {
+        std::copy(buf_out.data() + j * n, buf_out.data() + (j + 1u) * n, out[j] + begin);
+    }
+}
+
+} // namespace
+
+} // namespace detail
+
+void oe_to_cartesian_batch(double mu, const std::array<const double *, 6> &oe, const std::array<double *, 6> &out,
+                           std::size_t n, unsigned n_threads)
+{
+    detail::check_batch_mu(mu, "oe_to_cartesian_batch");
+
+    detail::oe_batch_run(n, n_threads, [&](std::size_t begin, std::size_t end) {
+        std::vector<double> buf(6u * detail::oe_batch_chunk_size);
+
+        for (auto j = 0u; j < 6u; ++j) {
+            std::copy(oe[j] + begin, oe[j] + end, buf.data() + j * detail::oe_batch_chunk_size);
+        }
+
+        detail::oe_batch_to_cartesian(mu, buf, out, begin, end);
+    });
+}
+
+void cartesian_to_oe_batch(double mu, const std::array<const double *, 6> &s, const std::array<double *, 6> &out,
+                           std::size_t n, unsigned n_threads)
+{
+    detail::check_batch_mu(mu, "cartesian_to_oe_batch");
+
+    detail::oe_batch_run(n, n_threads, [&](std::size_t begin, std::size_t end) {
+        const auto m = end - begin;
+
+        std::vector<double> buf_in(6u * m), buf_out(9u * m);
+        for (auto j = 0u; j < 6u; ++j) {
+            std::copy(s[j] + begin, s[j] + end, buf_in.data() + j * m);
+        }
+
+        const double pars[] = {mu};
+        detail::cartesian_to_oe_cfunc().eval_batch(buf_out.data(), buf_in.data(), m, pars);
+
+        // a, e, i.
+        for (auto j = 0u; j < 3u; ++j) {
+            std::copy(buf_out.data() + j * m, buf_out.data() + (j + 1u) * m, out[j] + begin);
+        }
+
+        // om, Om and f, mapped into [0, 2*pi).
+        constexpr auto twopi = 2 * boost::math::constants::pi<double>();
+        for (auto j = 3u; j < 6u; ++j) {
+            const auto *acos_ptr = buf_out.data() + j * m;
+            const auto *sign_ptr = buf_out.data() + (j + 3u) * m;
+            auto *out_ptr = out[j] + begin;
+
+            for (std::size_t k = 0; k < m; ++k) {
+                out_ptr[k] = sign_ptr[k] < 0 ? twopi - acos_ptr[k] : acos_ptr[k];
+            }
+        }
+    });
+}
+
+void random_elliptic_state_batch(double mu, const std::array<std::pair<double, double>, 6> &bounds,
+                                 const std::array<double *, 6> &out, std::size_t n, std::uint64_t seed,
+                                 unsigned n_threads)
+{
+    detail::check_elliptic_bounds(mu, bounds, "random_elliptic_state_batch");
+
+    detail::oe_batch_run(n, n_threads, [&](std::size_t begin, std::size_t end) {
+        std::vector<double> buf(6u * detail::oe_batch_chunk_size);
+
+        for (auto i = begin; i < end; ++i) {
+            // The elements of the i-th state are drawn from the stream
+            // seeded with the i-th value of the sequence starting from seed,
+            // so that the result does not depend on the number of threads.
+            splitmix64 e{seed};
+            e.jump(i);
+            splitmix64 ei{e.next()};
+
+            for (auto j = 0u; j < 6u; ++j) {
+                const auto &[lb, ub] = bounds[j];
+
+                // NOTE: uniform value in [0, 1) from the top 53 bits.
+                const auto u = static_cast<double>(ei.next() >> 11) * 0x1p-53;
+
+                // NOTE: guard against rounding up to ub.
+                buf[j * detail::oe_batch_chunk_size + (i - begin)]
+                    = std::min(lb + (ub - lb) * u, std::nextafter(ub, lb));
+            }
+        }
+
+        detail::oe_batch_to_cartesian(mu, buf, out, begin, end);
+    });
+}
+
+namespace detail
+{
+
+namespace
+{
+
+// Validation of the arguments of the conversions between barycentric
+// states and Jacobi/democratic heliocentric states. n_rel is the number of
+// bodies in the input state (n for barycentric states, n - 1 otherwise).
+void check_nbody_conv_args(const std::vector<double> &masses, const std::vector<double> &state, std::size_t n_rel,
+                           const char *fname)
+{
+    using namespace fmt::literals;
+
+    if (masses.size() < 2u) {
+        throw std::invalid_argument("At least 2 bodies are needed in {}()"_format(fname));
+    }
+
+    for (const auto &m : masses) {
+        if (!std::isfinite(m) || m < 0) {
+            throw std::invalid_argument(
+                "The masses passed to {}() must be finite and non-negative, but the value {} was detected"_format(
+                    fname, m));
+        }
+    }
+
+    if (masses[0] == 0) {
+        throw std::invalid_argument("The mass of the first body cannot be zero in {}()"_format(fname));
+    }
+
+    if (n_rel > std::numeric_limits<std::size_t>::max() / 6u || state.size() != n_rel * 6u) {
+        throw std::invalid_argument(
+            "Invalid state vector passed to {}(): the size of the vector is {}, but a size of {} was expected"_format(
+                fname, state.size(), n_rel * 6u));
+    }
+}
+
+} // namespace
+
+} // namespace detail
+
+std::vector<double> nbody_to_jacobi(const std::vector<double> &masses, const std::vector<double> &state)
+{
+    detail::check_nbody_conv_args(masses, state, masses.size(), "nbody_to_jacobi");
+
+    const auto n = masses.size();
+    std::vector<double> retval;
+    retval.reserve(6u * (n - 1u));
+
+    // The position/velocity of the centre of mass of the
+    // bodies [0, i), and its total mass.
+    std::array<double, 6> com{};
+    std::copy(state.begin(), state.begin() + 6, com.begin());
+    auto eta = masses[0];
+
+    for (std::size_t i = 1; i < n; ++i) {
+        for (auto j = 0u; j < 6u; ++j) {
+            retval.push_back(state[6u * i + j] - com[j]);
+        }
+
+        const auto new_eta = eta + masses[i];
+        for (auto j = 0u; j < 6u; ++j) {
+            com[j] = (eta * com[j] + masses[i] * state[6u * i + j]) / new_eta;
+        }
+        eta = new_eta;
+    }
+
+    return retval;
+}
+
+std::vector<double> nbody_from_jacobi(const std::vector<double> &masses, const std::vector<double> &jstate)
+{
+    detail::check_nbody_conv_args(masses, jstate, masses.size() - 1u, "nbody_from_jacobi");
+
+    const auto n = masses.size();
+
+    std::vector<double> eta{masses[0]};
+    for (std::size_t i = 1; i < n; ++i) {
+        eta.push_back(eta.back() + masses[i]);
+    }
+
+    std::vector<double> retval(6u * n);
+
+    // Walk the chain backwards, starting from the centre of mass
+    // of all the bodies (which is at rest at the origin).
+    std::array<double, 6> com{};
+    for (auto i = n - 1u; i > 0u; --i) {
+        for (auto j = 0u; j < 6u; ++j) {
+            const auto r = jstate[6u * (i - 1u) + j];
+
+            // The centre of mass of the bodies [0, i).
+            const auto prev_com = com[j] - masses[i] / eta[i] * r;
+
+            retval[6u * i + j] = r + prev_com;
+            com[j] = prev_com;
+        }
+    }
+
+    std::copy(com.begin(), com.end(), retval.begin());
+
+    return retval;
+}
+
+std::vector<double> nbody_to_dh(const std::vector<double> &masses, const std::vector<double> &state)
+{
+    detail::check_nbody_conv_args(masses, state, masses.size(), "nbody_to_dh");
+
+    const auto n = masses.size();
+
+    // The velocity of the centre of mass.
+    std::array<double, 3> com_v{};
+    double tot_mass = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+        for (auto j = 0u; j < 3u; ++j) {
+            com_v[j] += masses[i] * state[6u * i + 3u + j];
+        }
+        tot_mass += masses[i];
+    }
+    for (auto &v : com_v) {
+        v /= tot_mass;
+    }
+
+    std::vector<double> retval;
+    retval.reserve(6u * (n - 1u));
+
+    for (std::size_t i = 1; i < n; ++i) {
+        for (auto j = 0u; j < 3u; ++j) {
+            retval.push_back(state[6u * i + j] - state[j]);
+        }
+        for (auto j = 0u; j < 3u; ++j) {
+            retval.push_back(state[6u * i + 3u + j] - com_v[j]);
+        }
+    }
+
+    return retval;
+}
+
+std::vector<double> nbody_from_dh(const std::vector<double> &masses, const std::vector<double> &dhstate)
+{
+    detail::check_nbody_conv_args(masses, dhstate, masses.size() - 1u, "nbody_from_dh");
+
+    const auto n = masses.size();
+
+    double tot_mass = masses[0];
+    std::array<double, 6> acc{};
+    for (std::size_t i = 1; i < n; ++i) {
+        for (auto j = 0u; j < 6u; ++j) {
+            acc[j] += masses[i] * dhstate[6u * (i - 1u) + j];
+        }
+        tot_mass += masses[i];
+    }
+
+    // The state of body 0 follows from the centre of mass
+    // being at rest at the origin.
+    std::vector<double> retval(6u * n);
+    for (auto j = 0u; j < 3u; ++j) {
+        retval[j] = -acc[j] / tot_mass;
+        retval[3u + j] = -acc[3u + j] / masses[0];
+    }
+
+    for (std::size_t i = 1; i < n; ++i) {
+        for (auto j = 0u; j < 3u; ++j) {
+            retval[6u * i + j] = dhstate[6u * (i - 1u) + j] + retval[j];
+            retval[6u * i + 3u + j] = dhstate[6u * (i - 1u) + 3u + j];
+        }
+    }
+
+    return retval;
+}
+
+namespace detail
+{
+
+namespace
+{
+
+bool is_zero_ex(const expression &ex)
+{
+    const auto *n = std::get_if<number>(&ex.value());
+
+    return n != nullptr && is_zero(*n);
+}
+
+} // namespace
+
+} // namespace detail
+
+std::vector<std::pair<expression, expression>> make_sundman_sys(number mu, std::array<expression, 3> pert, number alpha)
+{
+    auto [x, y, z, vx, vy, vz, t] = make_vars("x", "y", "z", "vx", "vy", "vz", "t");
+
+    const auto r2 = sum_sq({x, y, z});
+
+    // The factor dt/ds = r**alpha and the factor of the Keplerian
+    // acceleration, -mu * r**(alpha - 3).
+    const auto dt_ds = pow(r2, expression{alpha / number{2.}});
+    const auto fac = expression{-mu} * pow(r2, expression{(alpha - number{3.}) / number{2.}});
+
+    const std::array pos{x, y, z}, vel{vx, vy, vz};
+
+    std::vector<std::pair<expression, expression>> retval;
+
+    for (auto j = 0u; j < 3u; ++j) {
+        retval.push_back(prime(pos[j]) = dt_ds * vel[j]);
+    }
+
+    for (auto j = 0u; j < 3u; ++j) {
+        if (detail::is_zero_ex(pert[j])) {
+            retval.push_back(prime(vel[j]) = pos[j] * fac);
+        } else {
+            retval.push_back(prime(vel[j]) = pos[j] * fac + dt_ds * pert[j]);
+        }
+    }
+
+    retval.push_back(prime(t) = dt_ds);
+
+    return retval;
+}
+
+std::vector<std::pair<expression, expression>> make_ks_sys(number mu, std::array<expression, 3> pert)
+{
+    // NOTE: mu does not appear in the equations of motion: the Keplerian
+    // attraction enters them only via the energy E, which is initialised
+    // from mu by cartesian_to_ks(). It is validated here nonetheless,
+    // and the signature matches make_sundman_sys().
+    std::visit(
+        [](const auto &v) {
+            using std::isfinite;
+
+            if (!isfinite(v) || v <= 0) {
+                throw std::invalid_argument("Invalid mu parameter used in make_ks_sys(): it must be positive and "
+                                            "finite, but it is "
+                                            + detail::li_to_string(v) + " instead");
+            }
+        },
+        mu.value());
+
+    auto [u0, u1, u2, u3, up0, up1, up2, up3, E, t]
+        = make_vars("u0", "u1", "u2", "u3", "up0", "up1", "up2", "up3", "E", "t");
+
+    const std::array u{u0, u1, u2, u3}, up{up0, up1, up2, up3};
+
+    std::vector<std::pair<expression, expression>> retval;
+
+    for (auto j = 0u; j < 4u; ++j) {
+        retval.push_back(prime(u[j]) = up[j]);
+    }
+
+    const auto r = sum_sq({u0, u1, u2, u3});
+
+    if (std::all_of(pert.begin(), pert.end(), detail::is_zero_ex)) {
+        // Unperturbed motion: u'' = E / 2 * u, with constant energy.
+        for (auto j = 0u; j < 4u; ++j) {
+            retval.push_back(prime(up[j]) = 0.5_dbl * E * u[j]);
+        }
+
+        retval.push_back(prime(E) = 0_dbl);
+    } else {
+        // The KS expressions of the cartesian coordinates and velocities, x = L(u) u and
+        // v = 2 / r * L(u) u', where L(u) is the KS matrix.
+        const auto v_fac = 2_dbl / r;
+        std::unordered_map<std::string, expression> repl{
+            {"x", u0 * u0 - u1 * u1 - u2 * u2 + u3 * u3},
+            {"y", 2_dbl * (u0 * u1 - u2 * u3)},
+            {"z", 2_dbl * (u0 * u2 + u1 * u3)},
+            {"vx", v_fac * (u0 * up0 - u1 * up1 - u2 * up2 + u3 * up3)},
+            {"vy", v_fac * (u1 * up0 + u0 * up1 - u3 * up2 - u2 * up3)},
+            {"vz", v_fac * (u2 * up0 + u3 * up1 + u0 * up2 + u1 * up3)}};
+
+        std::array<expression, 3> P;
+        for (auto j = 0u; j < 3u; ++j) {
+            P[j] = subs(pert[j], repl);
+        }
+
+        // The transpose of L(u) times the perturbing acceleration.
+        const std::array LtP{u0 * P[0] + u1 * P[1] + u2 * P[2], -u1 * P[0] + u0 * P[1] + u3 * P[2],
+                             -u2 * P[0] - u3 * P[1] + u0 * P[2], u3 * P[0] - u2 * P[1] + u1 * P[2]};
+
+        // u'' = E / 2 * u + r / 2 * L(u)**T * P.
+        for (auto j = 0u; j < 4u; ++j) {
+            retval.push_back(prime(up[j]) = 0.5_dbl * (E * u[j] + r * LtP[j]));
+        }
+
+        // E' = r * v . P = 2 * u' . L(u)**T * P.
+        retval.push_back(prime(E) = 2_dbl * sum({up0 * LtP[0], up1 * LtP[1], up2 * LtP[2], up3 * LtP[3]}));
+    }
+
+    retval.push_back(prime(t) = r);
+
+    return retval;
+}
+
+std::array<double, 10> cartesian_to_ks(double mu, const std::array<double, 6> &st, double t)
+{
+    using namespace fmt::literals;
+
+    if (!std::isfinite(mu) || mu <= 0) {
+        throw std::invalid_argument(
+            "Invalid mu parameter used in cartesian_to_ks(): it must be positive and finite, but it is {} instead"_format(
+                mu));
+    }
+
+    if (std::any_of(st.begin(), st.end(), [](const auto &x) { return !std::isfinite(x); }) || !std::isfinite(t)) {
+        throw std::invalid_argument("Non-finite values detected in the state passed to cartesian_to_ks()");
+    }
+
+    const auto [x, y, z, vx, vy, vz] = st;
+
+    const auto r = std::sqrt(x * x + y * y + z * z);
+    if (r == 0) {
+        throw std::invalid_argument("cartesian_to_ks() requires a nonzero distance from the origin");
+    }
+
+    // NOTE: the KS coordinates are fixed up to a rotation, we choose u3 = 0 or u2 = 0
+    // depending on the sign of x, in order to avoid cancellations.
+    std::array<double, 10> retval{};
+    if (x >= 0) {
+        retval[0] = std::sqrt((r + x) / 2);
+        retval[1] = y / (2 * retval[0]);
+        retval[2] = z / (2 * retval[0]);
+    } else {
+        retval[1] = std::sqrt((r - x) / 2);
+        retval[0] = y / (2 * retval[1]);
+        retval[3] = z / (2 * retval[1]);
+    }
+
+    // u' = L(u)**T * v / 2.
+    const auto [u0, u1, u2, u3] = std::array{retval[0], retval[1], retval[2], retval[3]};
+    retval[4] = (u0 * vx + u1 * vy + u2 * vz) / 2;
+    retval[5] = (-u1 * vx + u0 * vy + u3 * vz) / 2;
+    retval[6] = (-u2 * vx - u3 * vy + u0 * vz) / 2;
+    retval[7] = (u3 * vx - u2 * vy + u1 * vz) / 2;
+
+    retval[8] = (vx * vx + vy * vy + vz * vz) / 2 - mu / r;
+    retval[9] = t;
+
+    return retval;
+}
+
+std::array<double, 7> ks_to_cartesian(const std::array<double, 10> &ks)
+{
+    if (std::any_of(ks.begin(), ks.end(), [](const auto &x) { return !std::isfinite(x); })) {
+        throw std::invalid_argument("Non-finite values detected in the state passed to ks_to_cartesian()");
+    }
+
+    const auto [u0, u1, u2, u3, up0, up1, up2, up3, E, t] = ks;
+
+    const auto r = u0 * u0 + u1 * u1 + u2 * u2 + u3 * u3;
+    if (r == 0) {
+        throw std::invalid_argument("ks_to_cartesian() requires a nonzero distance from the origin");
+    }
+
+    const auto v_fac = 2 / r;
+
+    return {u0 * u0 - u1 * u1 - u2 * u2 + u3 * u3,
+            2 * (u0 * u1 - u2 * u3),
+            2 * (u0 * u2 + u1 * u3),
+            v_fac * (u0 * up0 - u1 * up1 - u2 * up2 + u3 * up3),
+            v_fac * (u1 * up0 + u0 * up1 - u3 * up2 - u2 * up3),
+            v_fac * (u2 * up0 + u3 * up1 + u0 * up2 + u1 * up3),
+            t};
+}
+
+template <typename T>
+std::tuple<taylor_outcome, T, T, std::size_t> propagate_until_physical(taylor_adaptive<T> &ta, T t,
+                                                                       std::size_t max_steps)
+{
+    using std::abs;
+    using std::isfinite;
+
+    if (!isfinite(t)) {
+        throw std::invalid_argument("A non-finite physical time was passed to propagate_until_physical()");
+    }
+
+    const auto dim = ta.get_dim();
+    if (dim == 0u) {
+        throw std::invalid_argument("propagate_until_physical() requires an integrator with a nonzero dimension");
+    }
+
+    auto *const st = ta.get_state_data();
+    const auto t_idx = dim - 1u;
+
+    T min_h = std::numeric_limits<T>::infinity(), max_h(0);
+
+    if (st[t_idx] == t) {
+        return std::tuple{taylor_outcome::time_limit, min_h, max_h, std::size_t(0)};
+    }
+
+    // NOTE: the physical time is assumed to be an increasing
+    // function of the independent variable.
+    const auto fwd = t > st[t_idx];
+
+    for (std::size_t n_steps = 0;;) {
+        if (max_steps != 0u && n_steps == max_steps) {
+            return std::tuple{taylor_outcome::step_limit, min_h, max_h, n_steps};
+        }
+
+        const auto [oc, h] = fwd ? ta.step(true) : ta.step_backward(true);
+        ++n_steps;
+
+        const auto abs_h = abs(h);
+        min_h = std::min(min_h, abs_h);
+        max_h = std::max(max_h, abs_h);
+
+        const auto crossed = fwd ? st[t_idx] >= t : st[t_idx] <= t;
+
+        if (!crossed && oc != taylor_outcome::success) {
+            return std::tuple{oc, min_h, max_h, n_steps};
+        }
+
+        if (!crossed) {
+            continue;
+        }
+
+        // Find the value of the independent variable at which the physical time is t via the Illinois
+        // method on the dense output, bracketing the root between the endpoints of the last step.
+        // NOTE: f is negative at a and positive at b (for both directions of integration).
+        const auto sgn = fwd ? T(1) : T(-1);
+        auto f = [&](T s) { return sgn * (ta.update_d_output(s)[t_idx] - t); };
+
+        T a = ta.get_time() - h, b = ta.get_time();
+        T fa = f(a), fb = sgn * (st[t_idx] - t);
+        int side = 0;
+
+        for (auto i = 0; i < 200 && fb != 0 && fa < 0 && abs(b - a) > 4 * std::numeric_limits<T>::epsilon() * abs(b);
+             ++i) {
+            const auto c = (a * fb - b * fa) / (fb - fa);
+            const auto fc = f(c);
+
+            if (fc > 0) {
+                b = c;
+                fb = fc;
+                if (side == -1) {
+                    fa /= 2;
+                }
+                side = -1;
+            } else {
+                a = c;
+                fa = fc;
+                if (side == 1) {
+                    fb /= 2;
+                }
+                side = 1;
+            }
+
+            if (fc == 0) {
+                b = c;
+                break;
+            }
+        }
+
+        // Truncate the last step at b.
+        const auto &d_out = ta.update_d_output(b);
+        std::copy(d_out.begin(), d_out.end(), st);
+        st[t_idx] = t;
+        ta.set_time(b);
+
+        return std::tuple{taylor_outcome::time_limit, min_h, max_h, n_steps};
+    }
+}
+
+// Explicit instantiations.
+template HEYOKA_DLL_PUBLIC std::tuple<taylor_outcome, double, double, std::size_t>
+propagate_until_physical<double>(taylor_adaptive<double> &, double, std::size_t);
+
+template HEYOKA_DLL_PUBLIC std::tuple<taylor_outcome, long double, long double, std::size_t>
+propagate_until_physical<long double>(taylor_adaptive<long double> &, long double, std::size_t);
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+template HEYOKA_DLL_PUBLIC std::tuple<taylor_outcome, mppp::real128, mppp::real128, std::size_t>
+propagate_until_physical<mppp::real128>(taylor_adaptive<mppp::real128> &, mppp::real128, std::size_t);
+
+#endif
+
 } // namespace heyoka
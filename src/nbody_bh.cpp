@@ -0,0 +1,656 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/numeric/conversion/cast.hpp>
+
+#include <llvm/IR/Attributes.h>
+#include <llvm/IR/BasicBlock.h>
+#include <llvm/IR/DerivedTypes.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/Module.h>
+#include <llvm/IR/Type.h>
+#include <llvm/IR/Value.h>
+
+#include <heyoka/detail/llvm_helpers.hpp>
+#include <heyoka/detail/string_conv.hpp>
+#include <heyoka/func.hpp>
+#include <heyoka/llvm_state.hpp>
+#include <heyoka/math/sqrt.hpp>
+#include <heyoka/nbody_bh.hpp>
+#include <heyoka/number.hpp>
+
+namespace heyoka
+{
+
+namespace detail
+{
+
+namespace
+{
+
+// Add to s a function for the computation of the jet of Taylor derivatives of
+// the near interactions of an N-body problem. The function arguments are:
+// - the in/out jet array (with the layout of taylor_add_jet()),
+// - the masses of the bodies (n values), followed by the far-field
+//   accelerations (3 * n values),
+// - the list of the near pairs (i, j), in which body i is attracted by body j,
+// - the number of near pairs n_pairs,
+// - the storage for the Taylor coefficients of orders [0, order) of the squared
+//   distances and of their -3/2 powers (2 * n_pairs * order values).
+// The far-field accelerations contribute only to the order 0 of the accelerations.
+// NOTE: this mirrors the implementation of taylor_add_nbody_jet(), with the
+// pairs read from memory rather than enumerated.
+void nbody_bh_add_jet(llvm_state &s, const std::string &name, std::uint32_t n, std::uint32_t order)
+{
+    using T = double;
+
+    const auto n_eq = 6u * n;
+
+    auto &builder = s.builder();
+    auto &context = s.context();
+    auto &md = s.module();
+
+    auto *fp_t = to_llvm_type<T>(context);
+
+    std::vector<llvm::Type *> fargs{llvm::PointerType::getUnqual(fp_t), llvm::PointerType::getUnqual(fp_t),
+                                    llvm::PointerType::getUnqual(builder.getInt32Ty()), builder.getInt32Ty(),
+                                    llvm::PointerType::getUnqual(fp_t)};
+    auto *ft = llvm::FunctionType::get(builder.getVoidTy(), fargs, false);
+    assert(ft != nullptr);
+    auto *f = llvm::Function::Create(ft, llvm::Function::ExternalLinkage, name, &md);
+    assert(f != nullptr);
+
+    auto in_out = f->args().begin();
+    in_out->setName("in_out");
+    in_out->addAttr(llvm::Attribute::NoCapture);
+    in_out->addAttr(llvm::Attribute::NoAlias);
+
+    auto par_ptr = in_out + 1;
+    par_ptr->setName("par_ptr");
+    par_ptr->addAttr(llvm::Attribute::NoCapture);
+    par_ptr->addAttr(llvm::Attribute::NoAlias);
+    par_ptr->addAttr(llvm::Attribute::ReadOnly);
+
+    auto pairs_ptr = in_out + 2;
+    pairs_ptr->setName("pairs_ptr");
+    pairs_ptr->addAttr(llvm::Attribute::NoCapture);
+    pairs_ptr->addAttr(llvm::Attribute::NoAlias);
+    pairs_ptr->addAttr(llvm::Attribute::ReadOnly);
+
+    auto *n_pairs = in_out + 3;
+    n_pairs->setName("n_pairs");
+
+    auto scratch_ptr = in_out + 4;
+    scratch_ptr->setName("scratch_ptr");
+    scratch_ptr->addAttr(llvm::Attribute::NoCapture);
+    scratch_ptr->addAttr(llvm::Attribute::NoAlias);
+
+    builder.SetInsertPoint(llvm::BasicBlock::Create(context, "entry", f));
+
+    // The accelerations on the bodies at the current order.
+    auto *acc_arr_t = llvm::ArrayType::get(fp_t, static_cast<std::uint64_t>(n) * 3u);
+    auto *acc_arr = builder.CreateInBoundsGEP(acc_arr_t, make_global_zero_array(md, acc_arr_t),
+                                              {builder.getInt32(0), builder.getInt32(0)});
+
+    auto *acc = builder.CreateAlloca(fp_t);
+    std::array<llvm::Value *, 3> c_acc{};
+    for (auto &ptr : c_acc) {
+        ptr = builder.CreateAlloca(fp_t);
+    }
+
+    auto *zero_c = codegen<T>(s, number{0.});
+    auto *one_c = codegen<T>(s, number{1.});
+    auto *alpha_c = codegen<T>(s, number{-3. / 2});
+
+    auto to_fp = [&](llvm::Value *v) { return builder.CreateUIToFP(v, fp_t); };
+
+    auto jet_ptr = [&](llvm::Value *cur_order, llvm::Value *var_idx) {
+        return builder.CreateInBoundsGEP(
+            in_out, {builder.CreateAdd(builder.CreateMul(cur_order, builder.getInt32(n_eq)), var_idx)});
+    };
+
+    auto sv_idx = [&](llvm::Value *i, std::uint32_t k) {
+        return builder.CreateAdd(builder.CreateMul(i, builder.getInt32(6)), builder.getInt32(k));
+    };
+
+    auto acc_ptr = [&](llvm::Value *i, std::uint32_t k) {
+        return builder.CreateInBoundsGEP(
+            acc_arr, {builder.CreateAdd(builder.CreateMul(i, builder.getInt32(3)), builder.getInt32(k))});
+    };
+
+    auto diff = [&](llvm::Value *cur_order, llvm::Value *i, llvm::Value *j, std::uint32_t k) {
+        return builder.CreateFSub(builder.CreateLoad(jet_ptr(cur_order, sv_idx(j, k))),
+                                  builder.CreateLoad(jet_ptr(cur_order, sv_idx(i, k))));
+    };
+
+    // Pointers to the order cur_order of the squared distance (if w is false)
+    // or of its -3/2 power (if w is true) of the pair p.
+    auto pair_ptr = [&](bool w, llvm::Value *cur_order, llvm::Value *p) {
+        auto *idx = builder.CreateAdd(builder.CreateMul(cur_order, n_pairs), p);
+        if (w) {
+            idx = builder.CreateAdd(idx, builder.CreateMul(builder.getInt32(order), n_pairs));
+        }
+
+        return builder.CreateInBoundsGEP(scratch_ptr, {idx});
+    };
+
+    auto accumulate = [&](llvm::Value *ptr, llvm::Value *v) {
+        builder.CreateStore(builder.CreateFAdd(builder.CreateLoad(ptr), v), ptr);
+    };
+
+    llvm_loop_u32(s, builder.getInt32(1), builder.getInt32(order + 1u), [&](llvm::Value *cur_order) {
+        auto *m = builder.CreateSub(cur_order, builder.getInt32(1));
+        auto *m_is_zero = builder.CreateICmpEQ(m, builder.getInt32(0));
+
+        // Init the accelerations with the far-field
+        // contributions (at order 0) or with zero.
+        llvm_loop_u32(s, builder.getInt32(0), builder.getInt32(3u * n), [&](llvm::Value *idx) {
+            auto *far
+                = builder.CreateLoad(builder.CreateInBoundsGEP(par_ptr, {builder.CreateAdd(idx, builder.getInt32(n))}));
+
+            builder.CreateStore(builder.CreateSelect(m_is_zero, far, zero_c),
+                                builder.CreateInBoundsGEP(acc_arr, {idx}));
+        });
+
+        llvm_loop_u32(s, builder.getInt32(0), n_pairs, [&](llvm::Value *p) {
+            auto *i
+                = builder.CreateLoad(builder.CreateInBoundsGEP(pairs_ptr, {builder.CreateMul(p, builder.getInt32(2))}));
+            auto *j = builder.CreateLoad(builder.CreateInBoundsGEP(
+                pairs_ptr, {builder.CreateAdd(builder.CreateMul(p, builder.getInt32(2)), builder.getInt32(1))}));
+
+            // s^[m].
+            builder.CreateStore(zero_c, acc);
+            llvm_loop_u32(s, builder.getInt32(0), cur_order, [&](llvm::Value *l) {
+                auto *m_l = builder.CreateSub(m, l);
+
+                for (std::uint32_t k = 0; k < 3u; ++k) {
+                    accumulate(acc, builder.CreateFMul(diff(l, i, j, k), diff(m_l, i, j, k)));
+                }
+            });
+            builder.CreateStore(builder.CreateLoad(acc), pair_ptr(false, m, p));
+
+            // w^[m].
+            llvm_if_then_else(
+                s, m_is_zero,
+                [&]() {
+                    auto *s0 = builder.CreateLoad(acc);
+                    auto *sqrt_s0 = codegen_from_values<T>(s, sqrt_impl{}, {s0});
+
+                    builder.CreateStore(builder.CreateFDiv(one_c, builder.CreateFMul(s0, sqrt_s0)),
+                                        pair_ptr(true, m, p));
+                },
+                [&]() {
+                    builder.CreateStore(zero_c, acc);
+                    llvm_loop_u32(s, builder.getInt32(0), m, [&](llvm::Value *l) {
+                        auto *m_l = builder.CreateSub(m, l);
+                        auto *fac = builder.CreateFSub(builder.CreateFMul(alpha_c, to_fp(m_l)), to_fp(l));
+
+                        accumulate(acc, builder.CreateFMul(fac, builder.CreateFMul(
+                                                                    builder.CreateLoad(pair_ptr(false, m_l, p)),
+                                                                    builder.CreateLoad(pair_ptr(true, l, p)))));
+                    });
+
+                    auto *s0 = builder.CreateLoad(pair_ptr(false, builder.getInt32(0), p));
+
+                    builder.CreateStore(builder.CreateFDiv(builder.CreateLoad(acc), builder.CreateFMul(to_fp(m), s0)),
+                                        pair_ptr(true, m, p));
+                });
+
+            // (d_k * w)^[m].
+            for (auto *ptr : c_acc) {
+                builder.CreateStore(zero_c, ptr);
+            }
+            llvm_loop_u32(s, builder.getInt32(0), cur_order, [&](llvm::Value *l) {
+                auto *w_ml = builder.CreateLoad(pair_ptr(true, builder.CreateSub(m, l), p));
+
+                for (std::uint32_t k = 0; k < 3u; ++k) {
+                    accumulate(c_acc[k], builder.CreateFMul(diff(l, i, j, k), w_ml));
+                }
+            });
+
+            // Add the contribution to the acceleration on i.
+            // NOTE: the gravitational constant is already
+            // included in the masses.
+            auto *m_j = builder.CreateLoad(builder.CreateInBoundsGEP(par_ptr, {j}));
+
+            for (std::uint32_t k = 0; k < 3u; ++k) {
+                accumulate(acc_ptr(i, k), builder.CreateFMul(m_j, builder.CreateLoad(c_acc[k])));
+            }
+        });
+
+        auto *ord_fp = to_fp(cur_order);
+
+        llvm_loop_u32(s, builder.getInt32(0), builder.getInt32(n), [&](llvm::Value *i) {
+            for (std::uint32_t k = 0; k < 3u; ++k) {
+                builder.CreateStore(builder.CreateFDiv(builder.CreateLoad(jet_ptr(m, sv_idx(i, k + 3u))), ord_fp),
+                                    jet_ptr(cur_order, sv_idx(i, k)));
+                builder.CreateStore(builder.CreateFDiv(builder.CreateLoad(acc_ptr(i, k)), ord_fp),
+                                    jet_ptr(cur_order, sv_idx(i, k + 3u)));
+            }
+        });
+    });
+
+    builder.CreateRetVoid();
+
+    s.verify_function(f);
+}
+
+// Node of the octree.
+struct bh_node {
+    // Centre of mass and total mass.
+    std::array<double, 3> com;
+    double mass;
+    // Centre and half-size of the cell.
+    std::array<double, 3> centre;
+    double half_size;
+    // Range of the bodies in the permutation array.
+    std::uint32_t begin, end;
+    // Indices of the children (if any).
+    std::array<std::uint32_t, 8> children;
+    std::uint32_t n_children;
+};
+
+// NOTE: limit the depth of the tree, so that coincident
+// bodies do not lead to infinite recursion.
+constexpr unsigned bh_max_depth = 64;
+
+// Recursively build the octree for the bodies in perm[begin, end).
+std::uint32_t bh_build(std::vector<bh_node> &nodes, std::vector<std::uint32_t> &perm, std::vector<std::uint32_t> &tmp,
+                       const std::vector<double> &state, const std::vector<double> &masses, std::uint32_t begin,
+                       std::uint32_t end, const std::array<double, 3> &centre, double half_size,
+                       std::uint32_t leaf_size, unsigned depth)
+{
+    const auto idx = static_cast<std::uint32_t>(nodes.size());
+
+    bh_node node{};
+    node.centre = centre;
+    node.half_size = half_size;
+    node.begin = begin;
+    node.end = end;
+
+    for (auto k = begin; k < end; ++k) {
+        const auto b = perm[k];
+
+        node.mass += masses[b];
+        for (auto c = 0u; c < 3u; ++c) {
+            node.com[c] += masses[b] * state[6u * b + c];
+        }
+    }
+    for (auto c = 0u; c < 3u; ++c) {
+        node.com[c] = node.mass == 0 ? centre[c] : node.com[c] / node.mass;
+    }
+
+    nodes.push_back(node);
+
+    if (end - begin <= leaf_size || depth == bh_max_depth) {
+        return idx;
+    }
+
+    // Sort the bodies into the octants via counting sort.
+    auto octant = [&](std::uint32_t b) {
+        unsigned retval = 0;
+        for (auto c = 0u; c < 3u; ++c) {
+            retval |= static_cast<unsigned>(state[6u * b + c] >= centre[c]) << c;
+        }
+        return retval;
+    };
+
+    std::array<std::uint32_t, 9> offsets{};
+    for (auto k = begin; k < end; ++k) {
+        ++offsets[octant(perm[k]) + 1u];
+    }
+    for (auto o = 1u; o < 9u; ++o) {
+        offsets[o] += offsets[o - 1u];
+    }
+    auto pos = offsets;
+    for (auto k = begin; k < end; ++k) {
+        tmp[begin + pos[octant(perm[k])]++] = perm[k];
+    }
+    std::copy(tmp.begin() + begin, tmp.begin() + end, perm.begin() + begin);
+
+    // Build the children.
+    std::array<std::uint32_t, 8> children{};
+    std::uint32_t n_children = 0;
+    for (auto o = 0u; o < 8u; ++o) {
+        if (offsets[o] == offsets[o + 1u]) {
+            continue;
+        }
+
+        std::array<double, 3> c_centre{};
+        for (auto c = 0u; c < 3u; ++c) {
+            c_centre[c] = centre[c] + ((o >> c) & 1u ? half_size : -half_size) / 2;
+        }
+
+        children[n_children++] = bh_build(nodes, perm, tmp, state, masses, begin + offsets[o], begin + offsets[o + 1u],
+                                          c_centre, half_size / 2, leaf_size, depth + 1u);
+    }
+
+    // NOTE: nodes may have been reallocated, index it again.
+    nodes[idx].children = children;
+    nodes[idx].n_children = n_children;
+
+    return idx;
+}
+
+} // namespace
+
+} // namespace detail
+
+void nbody_bh::finalise_ctor(std::vector<double> masses, double Gconst, double tol, double theta,
+                             std::uint32_t leaf_size)
+{
+    if (m_state.size() % 6u != 0u) {
+        throw std::invalid_argument("The size of the state vector of a Barnes-Hut N-body integrator must be a "
+                                    "multiple of 6, but it is "
+                                    + detail::li_to_string(m_state.size()) + " instead");
+    }
+
+    m_n = boost::numeric_cast<std::uint32_t>(m_state.size() / 6u);
+
+    if (m_n < 2u) {
+        throw std::invalid_argument("At least 2 bodies are needed to construct an N-body system");
+    }
+
+    if (masses.size() != m_n) {
+        throw std::invalid_argument("Inconsistent sizes detected while creating a Barnes-Hut N-body integrator: the "
+                                    "vector of masses has a size of "
+                                    + detail::li_to_string(masses.size()) + ", while the number of bodies is "
+                                    + detail::li_to_string(m_n));
+    }
+
+    if (!std::isfinite(tol) || tol <= 0) {
+        throw std::invalid_argument(
+            "The tolerance in a Barnes-Hut N-body integrator must be finite and positive, but it is "
+            + detail::li_to_string(tol) + " instead");
+    }
+
+    if (!std::isfinite(theta) || theta < 0) {
+        throw std::invalid_argument(
+            "The opening angle in a Barnes-Hut N-body integrator must be finite and non-negative, but it is "
+            + detail::li_to_string(theta) + " instead");
+    }
+
+    if (leaf_size == 0u) {
+        throw std::invalid_argument("The leaf size in a Barnes-Hut N-body integrator cannot be zero");
+    }
+
+    m_masses = std::move(masses);
+    m_Gconst = Gconst;
+    m_tol = tol;
+    m_theta = theta;
+    m_leaf_size = leaf_size;
+
+    // Determine the order from the tolerance, as in taylor_adaptive.
+    m_order = static_cast<std::uint32_t>(std::max(2., std::ceil(-std::log(tol) / 2 + 1)));
+
+    // NOTE: overflow checking for the indexing into the jet.
+    if (m_order > std::numeric_limits<std::uint32_t>::max() / (6u * m_n) - 1u) {
+        throw std::overflow_error("An overflow condition was detected while creating a Barnes-Hut N-body integrator");
+    }
+
+    detail::nbody_bh_add_jet(m_llvm, "nbody_bh_jet", m_n, m_order);
+    m_llvm.optimise();
+    m_llvm.compile();
+
+    m_jet_f = reinterpret_cast<jet_f_t>(m_llvm.jit_lookup("nbody_bh_jet"));
+
+    m_jet.resize(m_state.size() * (m_order + 1u));
+    m_pars.resize(4u * static_cast<std::size_t>(m_n));
+}
+
+nbody_bh::nbody_bh(const nbody_bh &other)
+    : m_n(other.m_n), m_state(other.m_state), m_masses(other.m_masses), m_time(other.m_time),
+      m_Gconst(other.m_Gconst), m_tol(other.m_tol), m_theta(other.m_theta), m_leaf_size(other.m_leaf_size),
+      m_order(other.m_order), m_llvm(other.m_llvm), m_jet(other.m_jet), m_pars(other.m_pars),
+      m_scratch(other.m_scratch), m_pairs(other.m_pairs)
+{
+    // NOTE: the copy has its own compiled function
+    // (with its own global arrays).
+    m_jet_f = reinterpret_cast<jet_f_t>(m_llvm.jit_lookup("nbody_bh_jet"));
+}
+
+nbody_bh::nbody_bh(nbody_bh &&) noexcept = default;
+
+nbody_bh &nbody_bh::operator=(const nbody_bh &other)
+{
+    if (this != &other) {
+        *this = nbody_bh(other);
+    }
+
+    return *this;
+}
+
+nbody_bh &nbody_bh::operator=(nbody_bh &&) noexcept = default;
+
+nbody_bh::~nbody_bh() = default;
+
+const std::vector<double> &nbody_bh::get_state() const
+{
+    return m_state;
+}
+
+const std::vector<double> &nbody_bh::get_masses() const
+{
+    return m_masses;
+}
+
+double nbody_bh::get_time() const
+{
+    return m_time;
+}
+
+std::uint32_t nbody_bh::get_order() const
+{
+    return m_order;
+}
+
+double nbody_bh::get_theta() const
+{
+    return m_theta;
+}
+
+std::size_t nbody_bh::get_n_near_pairs() const
+{
+    return m_pairs.size() / 2u;
+}
+
+// Build the octree for the current state, and compute the list
+// of the near pairs and the far-field accelerations.
+void nbody_bh::compute_interactions()
+{
+    const auto n = m_n;
+
+    // The bounding cube of the bodies.
+    std::array<double, 3> lb{}, ub{};
+    for (auto c = 0u; c < 3u; ++c) {
+        lb[c] = ub[c] = m_state[c];
+    }
+    for (std::uint32_t b = 1; b < n; ++b) {
+        for (auto c = 0u; c < 3u; ++c) {
+            lb[c] = std::min(lb[c], m_state[6u * b + c]);
+            ub[c] = std::max(ub[c], m_state[6u * b + c]);
+        }
+    }
+
+    std::array<double, 3> centre{};
+    double half_size = 0;
+    for (auto c = 0u; c < 3u; ++c) {
+        centre[c] = (lb[c] + ub[c]) / 2;
+        half_size = std::max(half_size, (ub[c] - lb[c]) / 2);
+    }
+
+    if (!std::isfinite(half_size)) {
+        throw std::invalid_argument("Non-finite positions detected in a Barnes-Hut N-body integrator");
+    }
+
+    // Build the tree.
+    std::vector<detail::bh_node> nodes;
+    std::vector<std::uint32_t> perm(n), tmp(n), inv_perm(n);
+    for (std::uint32_t b = 0; b < n; ++b) {
+        perm[b] = b;
+    }
+    detail::bh_build(nodes, perm, tmp, m_state, m_masses, 0, n, centre, half_size, m_leaf_size, 0);
+    for (std::uint32_t k = 0; k < n; ++k) {
+        inv_perm[perm[k]] = k;
+    }
+
+    // Walk the tree for each body.
+    m_pairs.clear();
+    std::copy(m_masses.begin(), m_masses.end(), m_pars.begin());
+    for (auto &m : m_pars) {
+        m *= m_Gconst;
+    }
+    std::fill(m_pars.begin() + n, m_pars.end(), 0.);
+
+    std::vector<std::uint32_t> stack;
+
+    for (std::uint32_t i = 0; i < n; ++i) {
+        const auto *x_i = m_state.data() + 6u * i;
+        auto *a_i = m_pars.data() + n + 3u * i;
+
+        stack.assign(1, 0);
+
+        while (!stack.empty()) {
+            const auto &node = nodes[stack.back()];
+            stack.pop_back();
+
+            if (node.mass == 0) {
+                // Massless nodes do not contribute.
+                continue;
+            }
+
+            const auto contains_i = inv_perm[i] >= node.begin && inv_perm[i] < node.end;
+
+            if (!contains_i) {
+                const auto dx = node.com[0] - x_i[0], dy = node.com[1] - x_i[1], dz = node.com[2] - x_i[2];
+                const auto d2 = dx * dx + dy * dy + dz * dz;
+
+                // The Barnes-Hut criterion: size / distance < theta.
+                if (4 * node.half_size * node.half_size < m_theta * m_theta * d2) {
+                    const auto fac = m_Gconst * node.mass / (d2 * std::sqrt(d2));
+
+                    a_i[0] += fac * dx;
+                    a_i[1] += fac * dy;
+                    a_i[2] += fac * dz;
+
+                    continue;
+                }
+            }
+
+            if (node.n_children == 0u) {
+                // Leaf: near interactions with its massive bodies.
+                for (auto k = node.begin; k < node.end; ++k) {
+                    const auto j = perm[k];
+
+                    if (j != i && m_masses[j] != 0) {
+                        m_pairs.push_back(i);
+                        m_pairs.push_back(j);
+                    }
+                }
+            } else {
+                for (std::uint32_t c = 0; c < node.n_children; ++c) {
+                    stack.push_back(node.children[c]);
+                }
+            }
+        }
+    }
+
+    const auto n_pairs = m_pairs.size() / 2u;
+
+    // NOTE: overflow checking for the indexing into the scratch storage.
+    if (n_pairs > std::numeric_limits<std::uint32_t>::max() / (2u * m_order)) {
+        throw std::overflow_error("An overflow condition was detected in the step of a Barnes-Hut N-body integrator: "
+                                  "too many near interactions");
+    }
+
+    m_scratch.resize(2u * n_pairs * m_order);
+}
+
+double nbody_bh::step(double max_delta_t)
+{
+    if (std::isnan(max_delta_t) || max_delta_t < 0) {
+        throw std::invalid_argument(
+            "The maximum step size in a Barnes-Hut N-body integrator must be non-negative, but it is "
+            + detail::li_to_string(max_delta_t) + " instead");
+    }
+
+    compute_interactions();
+
+    // Compute the jet.
+    std::copy(m_state.begin(), m_state.end(), m_jet.begin());
+    m_jet_f(m_jet.data(), m_pars.data(), m_pairs.data(), static_cast<std::uint32_t>(m_pairs.size() / 2u),
+            m_scratch.data());
+
+    // Determine the step size as in taylor_adaptive.
+    const auto n_eq = m_state.size();
+    double max_abs_state = 0, max_abs_diff_o = 0, max_abs_diff_om1 = 0;
+    for (decltype(m_state.size()) k = 0; k < n_eq; ++k) {
+        max_abs_state = std::max(max_abs_state, std::abs(m_jet[k]));
+        max_abs_diff_o = std::max(max_abs_diff_o, std::abs(m_jet[m_order * n_eq + k]));
+        max_abs_diff_om1 = std::max(max_abs_diff_om1, std::abs(m_jet[(m_order - 1u) * n_eq + k]));
+    }
+
+    const auto num_rho = max_abs_state <= 1 ? 1. : max_abs_state;
+    const auto rho_m = std::min(std::pow(num_rho / max_abs_diff_o, 1. / m_order),
+                                std::pow(num_rho / max_abs_diff_om1, 1. / (m_order - 1u)));
+    const auto rhofac = std::exp(-.7 / (m_order - 1u)) / (std::exp(1.) * std::exp(1.));
+
+    auto h = std::min(rho_m * rhofac, max_delta_t);
+    if (!std::isfinite(h)) {
+        throw std::invalid_argument("A non-finite step size was computed in a Barnes-Hut N-body integrator");
+    }
+
+    // Update the state via the Horner scheme.
+    for (decltype(m_state.size()) k = 0; k < n_eq; ++k) {
+        auto v = m_jet[m_order * n_eq + k];
+        for (auto o = m_order; o > 0u; --o) {
+            v = v * h + m_jet[(o - 1u) * n_eq + k];
+        }
+        m_state[k] = v;
+    }
+
+    m_time += h;
+
+    return h;
+}
+
+std::size_t nbody_bh::propagate_until(double t)
+{
+    if (!std::isfinite(t) || t < m_time) {
+        throw std::invalid_argument("A Barnes-Hut N-body integrator cannot be propagated to the time "
+                                    + detail::li_to_string(t) + ", which is not finite or in the past");
+    }
+
+    std::size_t n_steps = 0;
+    while (m_time < t) {
+        // NOTE: land exactly on t.
+        const auto rem = t - m_time;
+        if (step(rem) == rem) {
+            m_time = t;
+        }
+
+        ++n_steps;
+    }
+
+    return n_steps;
+}
+
+} // namespace heyoka
@@ -0,0 +1,231 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <heyoka/detail/poly_roots.hpp>
+#include <heyoka/nbody_collisions.hpp>
+#include <heyoka/taylor.hpp>
+
+namespace heyoka
+{
+
+nbody_collision_detector::nbody_collision_detector(std::vector<double> radii) : m_radii(std::move(radii))
+{
+    using namespace fmt::literals;
+
+    if (m_radii.size() < 2u) {
+        throw std::invalid_argument("At least 2 bodies are needed in a collision detector");
+    }
+
+    // NOTE: the bodies are indexed via 32-bit integers,
+    // and the state contains 6 variables for each body.
+    if (m_radii.size() > std::numeric_limits<std::uint32_t>::max() / 6u) {
+        throw std::overflow_error("Too many bodies in a collision detector");
+    }
+
+    for (const auto &r : m_radii) {
+        if (!std::isfinite(r) || r < 0) {
+            throw std::invalid_argument(
+                "The radii of the bodies in a collision detector must be finite and non-negative, but the value {} "
+                "was detected"_format(r));
+        }
+    }
+}
+
+nbody_collision_detector::nbody_collision_detector(const nbody_collision_detector &) = default;
+
+nbody_collision_detector::nbody_collision_detector(nbody_collision_detector &&) noexcept = default;
+
+nbody_collision_detector &nbody_collision_detector::operator=(const nbody_collision_detector &) = default;
+
+nbody_collision_detector &nbody_collision_detector::operator=(nbody_collision_detector &&) noexcept = default;
+
+nbody_collision_detector::~nbody_collision_detector() = default;
+
+const std::vector<double> &nbody_collision_detector::get_radii() const
+{
+    return m_radii;
+}
+
+std::size_t nbody_collision_detector::get_n_candidates() const
+{
+    return m_pairs.size();
+}
+
+// Compute the bounding boxes of the trajectories of the bodies over the last
+// step, and determine the overlapping pairs of boxes via sweep and prune.
+void nbody_collision_detector::broad_phase(const taylor_adaptive<double> &ta)
+{
+    const auto n = static_cast<std::uint32_t>(m_radii.size());
+    const auto order = ta.get_order();
+    const auto h = ta.get_last_h();
+    const auto &tc = ta.get_tc();
+
+    // NOTE: over the step, the position of a body along an axis is
+    // p(tau) = sum_k c_k * (tau * h)**k, with tau in [0, 1], and it is thus
+    // contained in [c_0 + sum_{k>0} min(0, c_k * h**k), c_0 + sum_{k>0} max(0, c_k * h**k)].
+    m_boxes.resize(n);
+    for (std::uint32_t i = 0; i < n; ++i) {
+        for (auto a = 0u; a < 3u; ++a) {
+            const auto tc_begin = tc.data() + (6u * i + a) * static_cast<decltype(tc.size())>(order + 1u);
+
+            auto lb = tc_begin[0], ub = tc_begin[0];
+            auto cur_h = h;
+            for (std::uint32_t k = 1; k <= order; ++k) {
+                const auto c = tc_begin[k] * cur_h;
+
+                lb += std::min(0., c);
+                ub += std::max(0., c);
+
+                cur_h *= h;
+            }
+
+            m_boxes[i][2u * a] = lb - m_radii[i];
+            m_boxes[i][2u * a + 1u] = ub + m_radii[i];
+        }
+    }
+
+    // Sort the bodies according to the lower bounds of the boxes along the x axis.
+    m_order.resize(n);
+    for (std::uint32_t i = 0; i < n; ++i) {
+        m_order[i] = i;
+    }
+    std::sort(m_order.begin(), m_order.end(),
+              [this](std::uint32_t a, std::uint32_t b) { return m_boxes[a][0] < m_boxes[b][0]; });
+
+    // Sweep along the x axis: the boxes in m_active are those whose x interval
+    // contains the lower bound of the current box along the x axis.
+    m_active.clear();
+    m_pairs.clear();
+    for (const auto idx : m_order) {
+        const auto &box = m_boxes[idx];
+
+        m_active.erase(std::remove_if(m_active.begin(), m_active.end(),
+                                      [this, &box](std::uint32_t a) { return m_boxes[a][1] < box[0]; }),
+                       m_active.end());
+
+        for (const auto a : m_active) {
+            const auto &other = m_boxes[a];
+
+            if (other[2] <= box[3] && box[2] <= other[3] && other[4] <= box[5] && box[4] <= other[5]) {
+                m_pairs.emplace_back(std::min(a, idx), std::max(a, idx));
+            }
+        }
+
+        m_active.push_back(idx);
+    }
+}
+
+// Compute the earliest collision time between the bodies i and j during
+// the last step (in the timestep-normalised time coordinate), if any.
+std::optional<double> nbody_collision_detector::narrow_phase(const taylor_adaptive<double> &ta, std::uint32_t i,
+                                                             std::uint32_t j)
+{
+    const auto order = ta.get_order();
+    const auto h = ta.get_last_h();
+    const auto &tc = ta.get_tc();
+
+    // The Taylor coefficients of the differences
+    // of the positions, rescaled by the timestep.
+    for (auto a = 0u; a < 3u; ++a) {
+        const auto tc_i = tc.data() + (6u * i + a) * static_cast<decltype(tc.size())>(order + 1u);
+        const auto tc_j = tc.data() + (6u * j + a) * static_cast<decltype(tc.size())>(order + 1u);
+
+        m_diff[a].resize(order + 1u);
+        double cur_h = 1;
+        for (std::uint32_t k = 0; k <= order; ++k) {
+            m_diff[a][k] = (tc_j[k] - tc_i[k]) * cur_h;
+            cur_h *= h;
+        }
+    }
+
+    // The squared distance minus the squared collision radius.
+    m_poly.assign(2u * order + 1u, 0.);
+    for (auto a = 0u; a < 3u; ++a) {
+        for (std::uint32_t k = 0; k <= order; ++k) {
+            for (std::uint32_t l = 0; l <= order; ++l) {
+                m_poly[k + l] += m_diff[a][k] * m_diff[a][l];
+            }
+        }
+    }
+    const auto R = m_radii[i] + m_radii[j];
+    m_poly[0] -= R * R;
+
+    // NOTE: if the bodies overlap and they are approaching
+    // each other at the beginning of the step, report a collision
+    // at the beginning of the step.
+    if (m_poly[0] <= 0 && m_poly[1] < 0) {
+        return 0.;
+    }
+
+    m_roots.clear();
+    detail::poly_find_roots_01(m_poly, m_roots, m_tmp);
+
+    std::optional<double> retval;
+    for (const auto &tau : m_roots) {
+        // NOTE: the distance must be decreasing
+        // in the direction of the integration.
+        if (detail::poly_eval_der(m_poly, tau) < 0 && (!retval || tau < *retval)) {
+            retval = tau;
+        }
+    }
+
+    return retval;
+}
+
+std::optional<nbody_collision> nbody_collision_detector::detect(const taylor_adaptive<double> &ta)
+{
+    using namespace fmt::literals;
+
+    if (ta.get_dim() < 6u * m_radii.size()) {
+        throw std::invalid_argument("The integrator passed to a collision detector for {} bodies has a state of "
+                                    "dimension {}, but a dimension of at least {} is required"_format(
+                                        m_radii.size(), ta.get_dim(), 6u * m_radii.size()));
+    }
+
+    m_pairs.clear();
+
+    if (ta.get_last_h() == 0) {
+        // No step has been taken yet.
+        return {};
+    }
+
+    broad_phase(ta);
+
+    std::optional<nbody_collision> retval;
+    double min_tau = 0;
+    for (const auto &[i, j] : m_pairs) {
+        if (const auto tau = narrow_phase(ta, i, j); tau && (!retval || *tau < min_tau)) {
+            min_tau = *tau;
+            retval = nbody_collision{i, j, 0.};
+        }
+    }
+
+    if (retval) {
+        // NOTE: the Taylor polynomials are expanded around the time
+        // coordinate at the beginning of the last step.
+        const auto h = ta.get_last_h();
+        retval->t = (ta.get_time() - h) + min_tau * h;
+    }
+
+    return retval;
+}
+
+} // namespace heyoka
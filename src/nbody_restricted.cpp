@@ -0,0 +1,339 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <limits>
+#include <stdexcept>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include <boost/numeric/conversion/cast.hpp>
+
+#include <heyoka/detail/run_workers.hpp>
+#include <heyoka/detail/string_conv.hpp>
+#include <heyoka/expression.hpp>
+#include <heyoka/math.hpp>
+#include <heyoka/nbody.hpp>
+#include <heyoka/nbody_restricted.hpp>
+#include <heyoka/param.hpp>
+#include <heyoka/taylor.hpp>
+
+namespace heyoka
+{
+
+namespace detail
+{
+
+namespace
+{
+
+// The equations of motion of a test particle in the field of n massive bodies, whose
+// positions are polynomials of degree order of tau = t - par[0]. The coefficient of
+// degree j of the coordinate a of the body k is par[1 + (3 * k + a) * (order + 1) + j].
+std::vector<std::pair<expression, expression>> make_nbody_tp_sys(std::uint32_t n, std::uint32_t order, double Gconst,
+                                                                  const std::vector<double> &masses)
+{
+    auto [x, y, z, vx, vy, vz] = make_vars("x", "y", "z", "vx", "vy", "vz");
+    const std::array<expression, 3> pos{x, y, z};
+
+    const auto tau = heyoka::time - par[0];
+
+    std::array<std::vector<expression>, 3> acc;
+
+    for (std::uint32_t k = 0; k < n; ++k) {
+        if (masses[k] == 0) {
+            continue;
+        }
+
+        // The differences between the positions of
+        // body k (via the Horner scheme) and of the particle.
+        std::array<expression, 3> diff;
+        for (auto a = 0u; a < 3u; ++a) {
+            const auto idx = 1u + (3u * k + a) * (order + 1u);
+
+            auto p = par[idx + order];
+            for (auto j = order; j > 0u; --j) {
+                p = par[idx + j - 1u] + tau * p;
+            }
+
+            diff[a] = p - pos[a];
+        }
+
+        const auto fac = expression{Gconst * masses[k]} * pow(sum_sq({diff[0], diff[1], diff[2]}), expression{-3. / 2});
+
+        for (auto a = 0u; a < 3u; ++a) {
+            acc[a].push_back(diff[a] * fac);
+        }
+    }
+
+    return {prime(x) = vx,          prime(y) = vy,          prime(z) = vz,
+            prime(vx) = sum(acc[0]), prime(vy) = sum(acc[1]), prime(vz) = sum(acc[2])};
+}
+
+} // namespace
+
+} // namespace detail
+
+void nbody_restricted::finalise_ctor(std::vector<double> massive_state, std::vector<double> masses, double Gconst,
+                                     double tol, bool compact_mode, std::uint32_t batch_size)
+{
+    if (massive_state.size() % 6u != 0u) {
+        throw std::invalid_argument("The size of the state vector of the massive bodies in a restricted N-body "
+                                    "integrator must be a multiple of 6, but it is "
+                                    + detail::li_to_string(massive_state.size()) + " instead");
+    }
+
+    if (m_tp_state.size() % 6u != 0u) {
+        throw std::invalid_argument("The size of the state vector of the test particles in a restricted N-body "
+                                    "integrator must be a multiple of 6, but it is "
+                                    + detail::li_to_string(m_tp_state.size()) + " instead");
+    }
+
+    m_n_massive = boost::numeric_cast<std::uint32_t>(massive_state.size() / 6u);
+    m_n_tp = m_tp_state.size() / 6u;
+
+    if (m_n_massive < 2u) {
+        throw std::invalid_argument("At least 2 massive bodies are needed to construct a restricted N-body integrator");
+    }
+
+    if (masses.size() != m_n_massive) {
+        throw std::invalid_argument("Inconsistent sizes detected while creating a restricted N-body integrator: the "
+                                    "vector of masses has a size of "
+                                    + detail::li_to_string(masses.size()) + ", while the number of massive bodies is "
+                                    + detail::li_to_string(m_n_massive));
+    }
+
+    if (!std::isfinite(Gconst)) {
+        throw std::invalid_argument("The gravitational constant in a restricted N-body integrator must be finite");
+    }
+
+    if (batch_size == 0u) {
+        throw std::invalid_argument("The batch size in a restricted N-body integrator cannot be zero");
+    }
+
+    m_ta = taylor_adaptive<double>{make_nbody_sys(m_n_massive, kw::masses = masses, kw::Gconst = Gconst),
+                                   std::move(massive_state), kw::tol = tol, kw::compact_mode = compact_mode};
+
+    const auto order = m_ta.get_order();
+
+    // NOTE: overflow checking for the number of parameters.
+    if (m_n_massive > (std::numeric_limits<std::uint32_t>::max() - 1u) / 3u / (order + 1u)
+        || 1u + 3u * m_n_massive * (order + 1u) > std::numeric_limits<std::uint32_t>::max() / batch_size) {
+        throw std::overflow_error("An overflow condition was detected while creating a restricted N-body integrator");
+    }
+    const auto n_pars = 1u + 3u * m_n_massive * (order + 1u);
+
+    m_tp_ta = taylor_adaptive_batch<double>{detail::make_nbody_tp_sys(m_n_massive, order, Gconst, masses),
+                                            std::vector<double>(6u * batch_size),
+                                            batch_size,
+                                            kw::tol = tol,
+                                            kw::compact_mode = compact_mode,
+                                            kw::pars = std::vector<double>(n_pars * batch_size)};
+}
+
+nbody_restricted::nbody_restricted(const nbody_restricted &) = default;
+
+nbody_restricted::nbody_restricted(nbody_restricted &&) noexcept = default;
+
+nbody_restricted &nbody_restricted::operator=(const nbody_restricted &other)
+{
+    if (this != &other) {
+        *this = nbody_restricted(other);
+    }
+
+    return *this;
+}
+
+nbody_restricted &nbody_restricted::operator=(nbody_restricted &&) noexcept = default;
+
+nbody_restricted::~nbody_restricted() = default;
+
+double nbody_restricted::get_time() const
+{
+    return m_ta.get_time();
+}
+
+std::uint32_t nbody_restricted::get_n_massive() const
+{
+    return m_n_massive;
+}
+
+std::size_t nbody_restricted::get_n_tp() const
+{
+    return m_n_tp;
+}
+
+const std::vector<double> &nbody_restricted::get_massive_state() const
+{
+    return m_ta.get_state();
+}
+
+const std::vector<double> &nbody_restricted::get_tp_state() const
+{
+    return m_tp_state;
+}
+
+const taylor_adaptive<double> &nbody_restricted::get_massive_integrator() const
+{
+    return m_ta;
+}
+
+const taylor_adaptive_batch<double> &nbody_restricted::get_tp_integrator() const
+{
+    return m_tp_ta;
+}
+
+// Propagate the test particles over the last step of the massive bodies,
+// from t0 to t1, using the Taylor coefficients of the step.
+void nbody_restricted::propagate_tp(double t0, double t1)
+{
+    if (m_n_tp == 0u) {
+        return;
+    }
+
+    const auto batch_size = m_tp_ta.get_batch_size();
+    const auto order = m_ta.get_order();
+    const auto &tc = m_ta.get_tc();
+
+    // Load the Taylor coefficients of the positions of the
+    // massive bodies into the parameters of the template.
+    auto *pars = m_tp_ta.get_pars_data();
+    auto set_par = [pars, batch_size](std::size_t idx, double val) {
+        std::fill(pars + idx * batch_size, pars + (idx + 1u) * batch_size, val);
+    };
+
+    set_par(0, t0);
+    for (std::uint32_t k = 0; k < m_n_massive; ++k) {
+        for (auto a = 0u; a < 3u; ++a) {
+            const auto tc_begin = tc.data() + (6u * k + a) * static_cast<decltype(tc.size())>(order + 1u);
+            const auto par_begin = 1u + (3u * k + a) * static_cast<std::size_t>(order + 1u);
+
+            for (std::uint32_t j = 0; j <= order; ++j) {
+                set_par(par_begin + j, tc_begin[j]);
+            }
+        }
+    }
+
+    // Determine the number of worker threads.
+    const auto n_batches = m_n_tp / batch_size + static_cast<std::size_t>(m_n_tp % batch_size != 0u);
+    auto n_threads = m_n_threads == 0u ? std::max(1u, std::thread::hardware_concurrency()) : m_n_threads;
+    if (n_threads > n_batches) {
+        n_threads = static_cast<unsigned>(n_batches);
+    }
+
+    // NOTE: the workers are created on demand, and then
+    // re-used in the subsequent steps.
+    if (m_workers.size() < n_threads) {
+        m_workers.resize(n_threads, m_tp_ta);
+    }
+
+    // The index of the next batch to be processed.
+    std::atomic<std::size_t> next_idx(0);
+
+    std::vector<std::exception_ptr> eptrs(n_threads);
+
+    auto worker_func = [&](unsigned thread_idx) {
+        auto &ta = m_workers[thread_idx];
+
+        try {
+            std::copy(m_tp_ta.get_pars().begin(), m_tp_ta.get_pars().end(), ta.get_pars_data());
+
+            const std::vector<double> t_final(batch_size, t1);
+
+            for (auto b = next_idx.fetch_add(1); b < n_batches; b = next_idx.fetch_add(1)) {
+                const auto begin = b * batch_size;
+                const auto end = std::min(begin + batch_size, m_n_tp);
+
+                // Load the states of the particles in the batch. The unused
+                // lanes of the last batch contain copies of its first particle.
+                for (std::uint32_t lane = 0; lane < batch_size; ++lane) {
+                    const auto idx = begin + lane < end ? begin + lane : begin;
+
+                    for (auto j = 0u; j < 6u; ++j) {
+                        ta.get_state_data()[j * batch_size + lane] = m_tp_state[6u * idx + j];
+                    }
+                    ta.get_time_data()[lane] = t0;
+                }
+
+                for (const auto &res : ta.propagate_until(t_final)) {
+                    if (std::get<0>(res) != taylor_outcome::time_limit) {
+                        throw std::invalid_argument("The propagation of a test particle in a restricted N-body "
+                                                    "integrator failed with the outcome "
+                                                    + detail::li_to_string(static_cast<int>(std::get<0>(res))));
+                    }
+                }
+
+                for (auto idx = begin; idx < end; ++idx) {
+                    for (auto j = 0u; j < 6u; ++j) {
+                        m_tp_state[6u * idx + j] = ta.get_state()[j * batch_size + (idx - begin)];
+                    }
+                }
+            }
+        } catch (...) {
+            eptrs[thread_idx] = std::current_exception();
+
+            // Stop the other workers.
+            next_idx.store(n_batches);
+        }
+    };
+
+    detail::run_workers(n_threads, worker_func, [&]() { next_idx.store(n_batches); }, eptrs);
+}
+
+double nbody_restricted::step(double max_delta_t)
+{
+    if (std::isnan(max_delta_t) || max_delta_t < 0) {
+        throw std::invalid_argument(
+            "The maximum step size in a restricted N-body integrator must be non-negative, but it is "
+            + detail::li_to_string(max_delta_t) + " instead");
+    }
+
+    const auto t0 = m_ta.get_time();
+
+    const auto [oc, h] = m_ta.step(max_delta_t, true);
+    if (oc != taylor_outcome::success && oc != taylor_outcome::time_limit) {
+        throw std::invalid_argument("The step of the massive bodies in a restricted N-body integrator failed with "
+                                    "the outcome "
+                                    + detail::li_to_string(static_cast<int>(oc)));
+    }
+
+    propagate_tp(t0, m_ta.get_time());
+
+    return h;
+}
+
+std::size_t nbody_restricted::propagate_until(double t)
+{
+    if (!std::isfinite(t) || t < get_time()) {
+        throw std::invalid_argument("A restricted N-body integrator cannot be propagated to the time "
+                                    + detail::li_to_string(t) + ", which is not finite or in the past");
+    }
+
+    std::size_t n_steps = 0;
+    while (get_time() < t) {
+        // NOTE: land exactly on t.
+        const auto rem = t - get_time();
+        if (step(rem) == rem) {
+            m_ta.set_time(t);
+        }
+
+        ++n_steps;
+    }
+
+    return n_steps;
+}
+
+} // namespace heyoka
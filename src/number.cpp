@@ -85,25 +85,41 @@ void swap(number &n0, number &n1) noexcept
 // - all nan values hash to the same value,
 // - two numbers with the same value hash to the same value,
 //   even if they are of different types.
-// The strategy is then to cast the value to the largest
-// floating-point type (which ensures that the original
-// value is preserved exactly) and then hash on that.
+// The strategy is then to hash the values which are exactly
+// representable in double precision (that is, all the doubles and most
+// of the constants in practice) as doubles, and to cast the other
+// values to the largest floating-point type (which ensures that the
+// original value is preserved exactly) and then hash on that.
 std::size_t hash(const number &n)
 {
+    // NOTE: fast path for double, avoiding the
+    // conversion to a wider type.
+    if (const auto *ptr = std::get_if<double>(&n.value())) {
+        // NOTE: make sure that all nan values and
+        // the zeroes of both signs have the same hash.
+        return (std::isnan(*ptr) || *ptr == 0) ? 0 : std::hash<double>{}(*ptr);
+    }
+
     return std::visit(
         [](const auto &v) -> std::size_t {
-#if defined(HEYOKA_HAVE_REAL128)
-            // NOTE: mppp::hash() already ensures that
-            // all nans hash to the same value.
-            return mppp::hash(static_cast<mppp::real128>(v));
-#else
-            if (std::isnan(v)) {
+            using std::isnan;
+
+            if (isnan(v)) {
                 // Make sure all nan values
                 // have the same hash.
                 return 0;
-            } else {
-                return std::hash<long double>{}(static_cast<long double>(v));
             }
+
+            if (static_cast<double>(v) == v) {
+                const auto dv = static_cast<double>(v);
+
+                return dv == 0 ? 0 : std::hash<double>{}(dv);
+            }
+
+#if defined(HEYOKA_HAVE_REAL128)
+            return mppp::hash(static_cast<mppp::real128>(v));
+#else
+            return std::hash<long double>{}(static_cast<long double>(v));
 #endif
         },
         n.value());
@@ -137,64 +153,95 @@ std::vector<std::string> get_variables(const number &)
 
 void rename_variables(number &, const std::unordered_map<std::string, std::string> &) {}
 
+// NOTE: the functions below have fast paths for double (the type
+// of the vast majority of the numbers in practice), which avoid
+// the overhead of std::visit() and of the type promotions.
 bool is_zero(const number &n)
 {
+    if (const auto *ptr = std::get_if<double>(&n.value())) {
+        return *ptr == 0;
+    }
+
     return std::visit([](const auto &arg) { return arg == 0; }, n.value());
 }
 
 bool is_one(const number &n)
 {
+    if (const auto *ptr = std::get_if<double>(&n.value())) {
+        return *ptr == 1;
+    }
+
     return std::visit([](const auto &arg) { return arg == 1; }, n.value());
 }
 
 bool is_negative_one(const number &n)
 {
+    if (const auto *ptr = std::get_if<double>(&n.value())) {
+        return *ptr == -1;
+    }
+
     return std::visit([](const auto &arg) { return arg == -1; }, n.value());
 }
 
 number operator-(number n)
 {
+    if (const auto *ptr = std::get_if<double>(&n.value())) {
+        return number{-*ptr};
+    }
+
     return std::visit([](auto &&arg) { return number{-std::forward<decltype(arg)>(arg)}; }, std::move(n.value()));
 }
 
-number operator+(number n1, number n2)
+namespace
 {
+
+// Implementation of the binary arithmetic operators.
+template <typename Op>
+number number_binary_op(number &n1, number &n2, const Op &op)
+{
+    if (const auto *p1 = std::get_if<double>(&n1.value()), *p2 = std::get_if<double>(&n2.value());
+        p1 != nullptr && p2 != nullptr) {
+        return number{op(*p1, *p2)};
+    }
+
     return std::visit(
-        [](auto &&arg1, auto &&arg2) {
-            return number{std::forward<decltype(arg1)>(arg1) + std::forward<decltype(arg2)>(arg2)};
+        [&op](auto &&arg1, auto &&arg2) {
+            return number{op(std::forward<decltype(arg1)>(arg1), std::forward<decltype(arg2)>(arg2))};
         },
         std::move(n1.value()), std::move(n2.value()));
 }
 
+} // namespace
+
+number operator+(number n1, number n2)
+{
+    return number_binary_op(n1, n2, std::plus<>{});
+}
+
 number operator-(number n1, number n2)
 {
-    return std::visit(
-        [](auto &&arg1, auto &&arg2) {
-            return number{std::forward<decltype(arg1)>(arg1) - std::forward<decltype(arg2)>(arg2)};
-        },
-        std::move(n1.value()), std::move(n2.value()));
+    return number_binary_op(n1, n2, std::minus<>{});
 }
 
 number operator*(number n1, number n2)
 {
-    return std::visit(
-        [](auto &&arg1, auto &&arg2) {
-            return number{std::forward<decltype(arg1)>(arg1) * std::forward<decltype(arg2)>(arg2)};
-        },
-        std::move(n1.value()), std::move(n2.value()));
+    return number_binary_op(n1, n2, std::multiplies<>{});
 }
 
 number operator/(number n1, number n2)
 {
-    return std::visit(
-        [](auto &&arg1, auto &&arg2) {
-            return number{std::forward<decltype(arg1)>(arg1) / std::forward<decltype(arg2)>(arg2)};
-        },
-        std::move(n1.value()), std::move(n2.value()));
+    return number_binary_op(n1, n2, std::divides<>{});
 }
 
 bool operator==(const number &n1, const number &n2)
 {
+    if (const auto *p1 = std::get_if<double>(&n1.value()), *p2 = std::get_if<double>(&n2.value());
+        p1 != nullptr && p2 != nullptr) {
+        // NOTE: make nan compare equal, for consistency
+        // with hashing.
+        return (std::isnan(*p1) && std::isnan(*p2)) || *p1 == *p2;
+    }
+
     return std::visit(
         [](const auto &v1, const auto &v2) {
             using std::isnan;
@@ -27,7 +27,7 @@
 namespace heyoka
 {
 
-param::param(std::uint32_t idx) : m_index(idx) {}
+param::param(std::uint32_t idx, bool shared) : m_index(idx), m_shared(shared) {}
 
 param::param(const param &) = default;
 
@@ -49,21 +49,32 @@ std::uint32_t &param::idx()
     return m_index;
 }
 
+bool param::is_shared() const
+{
+    return m_shared;
+}
+
 void swap(param &p0, param &p1) noexcept
 {
-    std::swap(p0.idx(), p1.idx());
+    std::swap(p0, p1);
 }
 
 std::size_t hash(const param &p)
 {
-    return std::hash<std::uint32_t>{}(p.idx());
+    auto seed = std::hash<std::uint32_t>{}(p.idx());
+
+    if (p.is_shared()) {
+        seed = ~seed;
+    }
+
+    return seed;
 }
 
 std::ostream &operator<<(std::ostream &os, const param &p)
 {
     using namespace fmt::literals;
 
-    return os << "par[{}]"_format(p.idx());
+    return os << (p.is_shared() ? "shared_par[{}]"_format(p.idx()) : "par[{}]"_format(p.idx()));
 }
 
 std::vector<std::string> get_variables(const param &)
@@ -75,7 +86,7 @@ void rename_variables(param &, const std::unordered_map<std::string, std::string
 
 bool operator==(const param &p0, const param &p1)
 {
-    return p0.idx() == p1.idx();
+    return p0.idx() == p1.idx() && p0.is_shared() == p1.is_shared();
 }
 
 bool operator!=(const param &p0, const param &p1)
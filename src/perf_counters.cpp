@@ -0,0 +1,245 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+#if defined(__linux__)
+
+#include <cerrno>
+#include <cstring>
+#include <string>
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#endif
+
+#include <heyoka/exceptions.hpp>
+#include <heyoka/perf_counters.hpp>
+
+namespace heyoka
+{
+
+perf_counts &operator+=(perf_counts &a, const perf_counts &b)
+{
+    a.cycles += b.cycles;
+    a.instructions += b.instructions;
+    a.cache_misses += b.cache_misses;
+    a.raw += b.raw;
+
+    return a;
+}
+
+perf_counts operator+(const perf_counts &a, const perf_counts &b)
+{
+    auto retval = a;
+    retval += b;
+    return retval;
+}
+
+perf_counts operator-(const perf_counts &a, const perf_counts &b)
+{
+    auto sat_sub = [](std::uint64_t x, std::uint64_t y) { return x > y ? x - y : std::uint64_t(0); };
+
+    return perf_counts{sat_sub(a.cycles, b.cycles), sat_sub(a.instructions, b.instructions),
+                       sat_sub(a.cache_misses, b.cache_misses), sat_sub(a.raw, b.raw)};
+}
+
+std::ostream &operator<<(std::ostream &os, const perf_counts &c)
+{
+    os << "cycles: " << c.cycles << ", instructions: " << c.instructions << ", cache misses: " << c.cache_misses
+       << ", raw: " << c.raw;
+
+    return os;
+}
+
+std::ostream &operator<<(std::ostream &os, const step_perf_counts &c)
+{
+    os << "Step  : " << c.step << '\n';
+    os << "Jet   : " << c.jet() << '\n';
+    os << "Update: " << c.update << '\n';
+
+    return os;
+}
+
+namespace detail
+{
+
+namespace
+{
+
+#if defined(__linux__)
+
+// Open a counter of the calling thread for the event (type, config)
+// in the group with the leader group_fd (-1 to create a new group).
+// The return value is -1 in case of failure.
+int perf_open(std::uint32_t type, std::uint64_t config, int group_fd)
+{
+    ::perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    // NOTE: the group is enabled/disabled via the leader.
+    attr.disabled = group_fd == -1 ? 1 : 0;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP;
+
+    return static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0));
+}
+
+#endif
+
+} // namespace
+
+} // namespace detail
+
+bool perf_counters_available()
+{
+    try {
+        perf_counter_group g;
+        return true;
+    } catch (const std::runtime_error &) {
+        return false;
+    }
+}
+
+perf_counter_group::perf_counter_group(std::uint64_t raw_config)
+    : m_fds{-1, -1, -1, -1}, m_raw_config(raw_config), m_tid(std::this_thread::get_id())
+{
+#if defined(__linux__)
+    m_fds[0] = detail::perf_open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, -1);
+    if (m_fds[0] == -1) {
+        throw std::runtime_error("Unable to open the hardware performance counter of the cycles: "
+                                 + std::string(std::strerror(errno)));
+    }
+
+    m_fds[1] = detail::perf_open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, m_fds[0]);
+    if (m_fds[1] == -1) {
+        const auto err = errno;
+        close_fds();
+        throw std::runtime_error("Unable to open the hardware performance counter of the instructions: "
+                                 + std::string(std::strerror(err)));
+    }
+
+    // NOTE: the optional counters.
+    m_fds[2] = detail::perf_open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES, m_fds[0]);
+    if (raw_config != 0u) {
+        m_fds[3] = detail::perf_open(PERF_TYPE_RAW, raw_config, m_fds[0]);
+    }
+#else
+    throw not_implemented_error("Hardware performance counters are available only on Linux");
+#endif
+}
+
+perf_counter_group::perf_counter_group(perf_counter_group &&other) noexcept
+    : m_fds(other.m_fds), m_raw_config(other.m_raw_config), m_tid(other.m_tid)
+{
+    other.m_fds = {-1, -1, -1, -1};
+}
+
+perf_counter_group &perf_counter_group::operator=(perf_counter_group &&other) noexcept
+{
+    if (this != &other) {
+        close_fds();
+
+        m_fds = other.m_fds;
+        m_raw_config = other.m_raw_config;
+        m_tid = other.m_tid;
+
+        other.m_fds = {-1, -1, -1, -1};
+    }
+
+    return *this;
+}
+
+perf_counter_group::~perf_counter_group()
+{
+    close_fds();
+}
+
+void perf_counter_group::close_fds() noexcept
+{
+#if defined(__linux__)
+    // NOTE: close the group members before the leader.
+    for (auto i = m_fds.size(); i > 0u; --i) {
+        if (m_fds[i - 1u] != -1) {
+            ::close(m_fds[i - 1u]);
+            m_fds[i - 1u] = -1;
+        }
+    }
+#endif
+}
+
+bool perf_counter_group::has_cache_misses() const
+{
+    return m_fds[2] != -1;
+}
+
+bool perf_counter_group::has_raw() const
+{
+    return m_fds[3] != -1;
+}
+
+std::uint64_t perf_counter_group::get_raw_config() const
+{
+    return m_raw_config;
+}
+
+std::thread::id perf_counter_group::get_thread_id() const
+{
+    return m_tid;
+}
+
+void perf_counter_group::start()
+{
+#if defined(__linux__)
+    ::ioctl(m_fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ::ioctl(m_fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#endif
+}
+
+perf_counts perf_counter_group::stop()
+{
+    perf_counts retval;
+
+#if defined(__linux__)
+    ::ioctl(m_fds[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+
+    // NOTE: with PERF_FORMAT_GROUP, the leader reads the number
+    // of counters followed by their values, in the order in
+    // which the counters were added to the group.
+    std::array<std::uint64_t, 5> buf{};
+    if (::read(m_fds[0], buf.data(), sizeof(buf)) == -1) {
+        throw std::runtime_error("Unable to read the hardware performance counters: "
+                                 + std::string(std::strerror(errno)));
+    }
+
+    std::uint64_t *fields[] = {&retval.cycles, &retval.instructions, &retval.cache_misses, &retval.raw};
+
+    for (std::size_t i = 0, val_idx = 1; i < m_fds.size() && val_idx <= buf[0]; ++i) {
+        if (m_fds[i] != -1) {
+            *fields[i] = buf[val_idx++];
+        }
+    }
+#endif
+
+    return retval;
+}
+
+} // namespace heyoka
@@ -0,0 +1,241 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <map>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <heyoka/expression.hpp>
+#include <heyoka/mascon.hpp>
+#include <heyoka/math.hpp>
+#include <heyoka/polyhedral.hpp>
+
+namespace heyoka
+{
+
+namespace detail
+{
+
+namespace
+{
+
+using vec3_t = std::array<double, 3>;
+
+vec3_t vec3_sub(const vec3_t &a, const vec3_t &b)
+{
+    return {a[0] - b[0], a[1] - b[1], a[2] - b[2]};
+}
+
+vec3_t vec3_cross(const vec3_t &a, const vec3_t &b)
+{
+    return {a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0]};
+}
+
+double vec3_dot(const vec3_t &a, const vec3_t &b)
+{
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+// Normalise a, throwing if a is zero.
+vec3_t vec3_unit(const vec3_t &a)
+{
+    const auto n = std::sqrt(vec3_dot(a, a));
+
+    if (!std::isfinite(n) || n == 0) {
+        throw std::invalid_argument("A degenerate face was detected in the construction of the gravity field of a "
+                                    "polyhedron");
+    }
+
+    return {a[0] / n, a[1] / n, a[2] / n};
+}
+
+expression expr_dot(const std::array<expression, 3> &a, const std::array<expression, 3> &b)
+{
+    return sum({a[0] * b[0], a[1] * b[1], a[2] * b[2]});
+}
+
+std::array<expression, 3> expr_cross(const std::array<expression, 3> &a, const std::array<expression, 3> &b)
+{
+    return {a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0]};
+}
+
+// The terms of the gravitational acceleration (with unitary G * density)
+// along the three axes, for the field point (x, y, z).
+std::array<std::vector<expression>, 3> polyhedral_acc_terms(const expression &x, const expression &y,
+                                                            const expression &z, const std::vector<vec3_t> &vertices,
+                                                            const std::vector<std::array<std::uint32_t, 3>> &faces)
+{
+    using namespace fmt::literals;
+
+    if (faces.empty()) {
+        throw std::invalid_argument("A polyhedron must have at least one face");
+    }
+
+    // The unit outward normals of the faces.
+    std::vector<vec3_t> normals;
+    for (const auto &f : faces) {
+        for (auto idx : f) {
+            if (idx >= vertices.size()) {
+                throw std::invalid_argument(
+                    "Invalid vertex index {} detected in a face of a polyhedron with {} vertices"_format(
+                        idx, vertices.size()));
+            }
+        }
+
+        normals.push_back(vec3_unit(
+            vec3_cross(vec3_sub(vertices[f[1]], vertices[f[0]]), vec3_sub(vertices[f[2]], vertices[f[0]]))));
+    }
+
+    // The edge dyads, indexed by the oriented edges (i, j) with i < j.
+    // The dyad of an edge is the sum of the products of the normal of each adjacent face
+    // with the outward normal of the edge in that face.
+    // NOTE: we also count how many times each edge is traversed
+    // in each direction, in order to check that the mesh is closed and consistently oriented.
+    struct edge_data {
+        std::array<vec3_t, 3> E{};
+        unsigned n_fwd = 0, n_bwd = 0;
+    };
+    std::map<std::pair<std::uint32_t, std::uint32_t>, edge_data> edges;
+
+    for (decltype(faces.size()) fi = 0; fi < faces.size(); ++fi) {
+        const auto &f = faces[fi];
+        const auto &n = normals[fi];
+
+        for (auto k = 0u; k < 3u; ++k) {
+            const auto i = f[k], j = f[(k + 1u) % 3u];
+
+            if (i == j) {
+                throw std::invalid_argument("A degenerate face was detected in the construction of the gravity "
+                                            "field of a polyhedron");
+            }
+
+            const auto ne = vec3_unit(vec3_cross(vec3_sub(vertices[j], vertices[i]), n));
+
+            auto &ed = edges[{std::min(i, j), std::max(i, j)}];
+            ++(i < j ? ed.n_fwd : ed.n_bwd);
+
+            for (auto r = 0u; r < 3u; ++r) {
+                for (auto c = 0u; c < 3u; ++c) {
+                    ed.E[r][c] += n[r] * ne[c];
+                }
+            }
+        }
+    }
+
+    for (const auto &[e, ed] : edges) {
+        if (ed.n_fwd != 1u || ed.n_bwd != 1u) {
+            throw std::invalid_argument("The mesh of a polyhedron must be closed and consistently oriented, but the "
+                                        "edge ({}, {}) is shared by {} faces with one orientation and by {} faces "
+                                        "with the opposite orientation"_format(e.first, e.second, ed.n_fwd,
+                                                                               ed.n_bwd));
+        }
+    }
+
+    // The vectors from the field point to the vertices, and their norms.
+    std::vector<std::array<expression, 3>> r_vecs;
+    std::vector<expression> r_norms;
+    for (const auto &v : vertices) {
+        r_vecs.push_back({expression{v[0]} - x, expression{v[1]} - y, expression{v[2]} - z});
+        r_norms.push_back(sqrt(sum_sq({r_vecs.back()[0], r_vecs.back()[1], r_vecs.back()[2]})));
+    }
+
+    std::array<std::vector<expression>, 3> retval;
+
+    // The contributions of the edges: -E r_e L_e, where r_e is the vector
+    // from the field point to the first vertex of the edge, L_e = log((a + b + e) / (a + b - e)),
+    // a and b are the distances to the vertices and e is the length of the edge.
+    for (const auto &[e, ed] : edges) {
+        const auto [i, j] = e;
+
+        const auto diff = vec3_sub(vertices[j], vertices[i]);
+        const auto len = expression{std::sqrt(vec3_dot(diff, diff))};
+
+        const auto ab = r_norms[i] + r_norms[j];
+        const auto L_e = log((ab + len) / (ab - len));
+
+        for (auto r = 0u; r < 3u; ++r) {
+            retval[r].push_back(sum({expression{-ed.E[r][0]} * r_vecs[i][0], expression{-ed.E[r][1]} * r_vecs[i][1],
+                                     expression{-ed.E[r][2]} * r_vecs[i][2]})
+                                * L_e);
+        }
+    }
+
+    // The contributions of the faces: n (n . r_f) omega_f, where r_f is the vector
+    // from the field point to the first vertex of the face and omega_f is the signed
+    // solid angle subtended by the face, omega_f = 2 * atan2(N, D) with
+    // N = r1 . (r2 x r3), D = r1 r2 r3 + r1 (r2 . r3) + r2 (r3 . r1) + r3 (r1 . r2).
+    // NOTE: we use the identity atan2(N, D) = 2 * atan(N / (sqrt(N**2 + D**2) + D)),
+    // which is valid everywhere but on the faces of the polyhedron.
+    for (decltype(faces.size()) fi = 0; fi < faces.size(); ++fi) {
+        const auto &f = faces[fi];
+        const auto &n = normals[fi];
+
+        const auto &r1 = r_vecs[f[0]], &r2 = r_vecs[f[1]], &r3 = r_vecs[f[2]];
+        const auto &d1 = r_norms[f[0]], &d2 = r_norms[f[1]], &d3 = r_norms[f[2]];
+
+        const auto N = expr_dot(r1, expr_cross(r2, r3));
+        const auto D = sum({d1 * d2 * d3, d1 * expr_dot(r2, r3), d2 * expr_dot(r3, r1), d3 * expr_dot(r1, r2)});
+        const auto omega_f = expression{4.} * atan(N / (sqrt(sum_sq({N, D})) + D));
+
+        // n . r_f.
+        const auto n_rf = expression{vec3_dot(n, vertices[f[0]])} - sum({expression{n[0]} * x, expression{n[1]} * y,
+                                                                         expression{n[2]} * z});
+
+        const auto s_f = n_rf * omega_f;
+
+        for (auto r = 0u; r < 3u; ++r) {
+            retval[r].push_back(expression{n[r]} * s_f);
+        }
+    }
+
+    return retval;
+}
+
+} // namespace
+
+std::vector<std::pair<expression, expression>>
+make_polyhedral_system_impl(const std::vector<std::array<double, 3>> &vertices,
+                            const std::vector<std::array<std::uint32_t, 3>> &faces, double Grho,
+                            const std::array<double, 3> &omega)
+{
+    auto [x, y, z] = make_vars("x", "y", "z");
+
+    const auto acc = polyhedral_acc(x, y, z, vertices, faces, Grho);
+
+    return mascon_assemble_system({acc[0]}, {acc[1]}, {acc[2]}, expression{omega[0]}, expression{omega[1]},
+                                  expression{omega[2]});
+}
+
+} // namespace detail
+
+std::array<expression, 3> polyhedral_acc(const expression &x, const expression &y, const expression &z,
+                                         const std::vector<std::array<double, 3>> &vertices,
+                                         const std::vector<std::array<std::uint32_t, 3>> &faces, double Grho)
+{
+    if (!std::isfinite(Grho)) {
+        using namespace fmt::literals;
+
+        throw std::invalid_argument(
+            "The product of the gravitational constant and of the density of a polyhedron must be finite, but it is "
+            "{} instead"_format(Grho));
+    }
+
+    auto terms = detail::polyhedral_acc_terms(x, y, z, vertices, faces);
+
+    return {expression{Grho} * sum(std::move(terms[0])), expression{Grho} * sum(std::move(terms[1])),
+            expression{Grho} * sum(std::move(terms[2]))};
+}
+
+} // namespace heyoka
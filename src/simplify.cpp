@@ -0,0 +1,401 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include <heyoka/binary_operator.hpp>
+#include <heyoka/detail/type_traits.hpp>
+#include <heyoka/expression.hpp>
+#include <heyoka/func.hpp>
+#include <heyoka/math/pow.hpp>
+#include <heyoka/math/sqrt.hpp>
+#include <heyoka/math/square.hpp>
+#include <heyoka/number.hpp>
+#include <heyoka/param.hpp>
+#include <heyoka/variable.hpp>
+
+namespace heyoka
+{
+
+namespace detail
+{
+
+namespace
+{
+
+bool num_is_negative(const number &n)
+{
+    return std::visit([](const auto &x) { return x < 0; }, n.value());
+}
+
+bool num_is_integral(const number &n)
+{
+    return is_integral(expression{n});
+}
+
+// Structural total order on expressions, used to sort
+// the arguments of sums and products into a canonical order.
+bool expr_less(const expression &, const expression &);
+
+bool num_less(const number &n1, const number &n2)
+{
+    if (n1.value().index() != n2.value().index()) {
+        return n1.value().index() < n2.value().index();
+    }
+
+    // NOTE: this is a strict weak ordering only if nans
+    // are not involved, which is good enough for our purposes.
+    return std::visit([](const auto &x, const auto &y) { return x < y; }, n1.value(), n2.value());
+}
+
+bool expr_less(const expression &e1, const expression &e2)
+{
+    if (e1.value().index() != e2.value().index()) {
+        return e1.value().index() < e2.value().index();
+    }
+
+    return std::visit(
+        [&e2](const auto &v1) -> bool {
+            using type = uncvref_t<decltype(v1)>;
+
+            const auto &v2 = std::get<type>(e2.value());
+
+            if constexpr (std::is_same_v<type, number>) {
+                return num_less(v1, v2);
+            } else if constexpr (std::is_same_v<type, variable>) {
+                return v1.name() < v2.name();
+            } else if constexpr (std::is_same_v<type, param>) {
+                return v1.idx() < v2.idx();
+            } else if constexpr (std::is_same_v<type, binary_operator>) {
+                if (v1.op() != v2.op()) {
+                    return v1.op() < v2.op();
+                }
+
+                if (expr_less(v1.lhs(), v2.lhs())) {
+                    return true;
+                }
+                if (expr_less(v2.lhs(), v1.lhs())) {
+                    return false;
+                }
+
+                return expr_less(v1.rhs(), v2.rhs());
+            } else if constexpr (std::is_same_v<type, func>) {
+                if (v1.get_name() != v2.get_name()) {
+                    return v1.get_name() < v2.get_name();
+                }
+
+                return std::lexicographical_compare(v1.args().begin(), v1.args().end(), v2.args().begin(),
+                                                    v2.args().end(), expr_less);
+            } else {
+                static_assert(always_false_v<type>, "Unhandled expression type.");
+            }
+        },
+        e1.value());
+}
+
+// Detect if ex is a power with numerical exponent (i.e., square(), sqrt()
+// or pow() with a numerical exponent). If it is, the base and the
+// exponent will be returned.
+std::optional<std::pair<expression, number>> as_power(const expression &ex)
+{
+    if (auto fptr = std::get_if<func>(&ex.value())) {
+        const auto &name = fptr->get_name();
+        const auto &args = fptr->args();
+
+        if (name == "square") {
+            assert(args.size() == 1u);
+            return std::pair{args[0], number{2.}};
+        } else if (name == "sqrt") {
+            assert(args.size() == 1u);
+            return std::pair{args[0], number{.5}};
+        } else if (name == "pow") {
+            assert(args.size() == 2u);
+            if (auto nptr = std::get_if<number>(&args[1].value())) {
+                return std::pair{args[0], *nptr};
+            }
+        }
+    }
+
+    return {};
+}
+
+// Helper to build the term c * num / den, where num and den
+// are lists of factors.
+expression make_term(const number &c, const std::vector<expression> &num, const std::vector<expression> &den)
+{
+    auto prod = [](const std::vector<expression> &v) {
+        assert(!v.empty());
+
+        auto retval = v[0];
+        for (decltype(v.size()) i = 1; i < v.size(); ++i) {
+            retval = std::move(retval) * v[i];
+        }
+
+        return retval;
+    };
+
+    if (is_zero(c)) {
+        return expression{number{0.}};
+    }
+
+    if (num.empty() && den.empty()) {
+        return expression{c};
+    }
+
+    if (den.empty()) {
+        return expression{c} * prod(num);
+    }
+
+    if (num.empty()) {
+        return expression{c} / prod(den);
+    }
+
+    return expression{c} * prod(num) / prod(den);
+}
+
+struct simplifier {
+    std::unordered_map<expression, expression> memo;
+
+    // Flatten the product ex^e into the numerical coefficient c and
+    // the list of (base, exponent) factors. fidx maps the bases
+    // to their indices in factors.
+    void flatten_prod(const expression &ex, const number &e, number &c,
+                      std::vector<std::pair<expression, number>> &factors,
+                      std::unordered_map<expression, decltype(factors.size())> &fidx)
+    {
+        // NOTE: the products and powers are distributed only when
+        // this is valid for any value of the base: (a*b)^e = a^e * b^e
+        // only for e == +-1, (b^a)^e = b^(a*e) only for integral e.
+        const auto unit_exp = is_one(e) || is_negative_one(e);
+
+        if (auto nptr = std::get_if<number>(&ex.value()); nptr != nullptr && unit_exp) {
+            c = is_one(e) ? c * *nptr : c / *nptr;
+            return;
+        }
+
+        if (auto bptr = std::get_if<binary_operator>(&ex.value()); bptr != nullptr && unit_exp) {
+            if (bptr->op() == binary_operator::type::mul) {
+                flatten_prod(bptr->lhs(), e, c, factors, fidx);
+                flatten_prod(bptr->rhs(), e, c, factors, fidx);
+                return;
+            } else if (bptr->op() == binary_operator::type::div) {
+                flatten_prod(bptr->lhs(), e, c, factors, fidx);
+                flatten_prod(bptr->rhs(), -e, c, factors, fidx);
+                return;
+            }
+        }
+
+        if (num_is_integral(e)) {
+            if (auto pw = as_power(ex)) {
+                flatten_prod(pw->first, pw->second * e, c, factors, fidx);
+                return;
+            }
+        }
+
+        if (auto it = fidx.find(ex); it != fidx.end()) {
+            factors[it->second].second = factors[it->second].second + e;
+        } else {
+            fidx.emplace(ex, factors.size());
+            factors.emplace_back(ex, e);
+        }
+    }
+
+    // Simplify a product (or a power with numerical exponent),
+    // returning the numerical coefficient and the lists of factors
+    // in the numerator and in the denominator.
+    std::tuple<number, std::vector<expression>, std::vector<expression>> split_prod(const expression &ex)
+    {
+        number c{1.};
+        std::vector<std::pair<expression, number>> factors;
+        std::unordered_map<expression, decltype(factors.size())> fidx;
+
+        flatten_prod(ex, number{1.}, c, factors, fidx);
+
+        std::sort(factors.begin(), factors.end(),
+                  [](const auto &p1, const auto &p2) { return expr_less(p1.first, p2.first); });
+
+        std::vector<expression> num, den;
+        for (auto &[b, e] : factors) {
+            if (is_zero(e)) {
+                // b^0 = 1.
+                continue;
+            }
+
+            auto &v = num_is_negative(e) ? den : num;
+            const auto ae = num_is_negative(e) ? -e : e;
+
+            if (is_one(ae)) {
+                v.push_back(std::move(b));
+            } else if (ae == number{2.}) {
+                v.push_back(square(std::move(b)));
+            } else if (ae == number{.5}) {
+                v.push_back(sqrt(std::move(b)));
+            } else {
+                v.push_back(pow(std::move(b), expression{ae}));
+            }
+        }
+
+        return std::tuple{std::move(c), std::move(num), std::move(den)};
+    }
+
+    // Flatten the sum s * ex into the numerical constant k and
+    // the list of (coefficient, term) pairs.
+    void flatten_sum(const expression &ex, const number &s, number &k,
+                     std::vector<std::pair<number, expression>> &terms,
+                     std::unordered_map<expression, decltype(terms.size())> &tidx)
+    {
+        if (auto nptr = std::get_if<number>(&ex.value())) {
+            k = k + s * *nptr;
+            return;
+        }
+
+        if (auto bptr = std::get_if<binary_operator>(&ex.value())) {
+            if (bptr->op() == binary_operator::type::add) {
+                flatten_sum(bptr->lhs(), s, k, terms, tidx);
+                flatten_sum(bptr->rhs(), s, k, terms, tidx);
+                return;
+            } else if (bptr->op() == binary_operator::type::sub) {
+                flatten_sum(bptr->lhs(), s, k, terms, tidx);
+                flatten_sum(bptr->rhs(), -s, k, terms, tidx);
+                return;
+            }
+        }
+
+        // Separate the numerical coefficient of the term.
+        auto [c, num, den] = split_prod(ex);
+        auto t = make_term(number{1.}, num, den);
+        c = s * c;
+
+        if (auto it = tidx.find(t); it != tidx.end()) {
+            terms[it->second].first = terms[it->second].first + c;
+        } else {
+            tidx.emplace(t, terms.size());
+            terms.emplace_back(std::move(c), std::move(t));
+        }
+    }
+
+    expression simplify_sum(const expression &ex)
+    {
+        number k{0.};
+        std::vector<std::pair<number, expression>> terms;
+        std::unordered_map<expression, decltype(terms.size())> tidx;
+
+        flatten_sum(ex, number{1.}, k, terms, tidx);
+
+        // Remove the terms which cancelled out, and sort the others.
+        terms.erase(std::remove_if(terms.begin(), terms.end(), [](const auto &p) { return is_zero(p.first); }),
+                    terms.end());
+        std::sort(terms.begin(), terms.end(),
+                  [](const auto &p1, const auto &p2) { return expr_less(p1.second, p2.second); });
+
+        // Helper to rebuild the term c * t.
+        auto rebuild = [this](const number &c, const expression &t) {
+            auto [c1, num, den] = split_prod(t);
+            return make_term(c * c1, num, den);
+        };
+
+        std::optional<expression> retval;
+        for (const auto &[c, t] : terms) {
+            if (!retval) {
+                retval = rebuild(c, t);
+            } else if (num_is_negative(c)) {
+                retval = std::move(*retval) - rebuild(-c, t);
+            } else {
+                retval = std::move(*retval) + rebuild(c, t);
+            }
+        }
+
+        if (!retval) {
+            return expression{k};
+        }
+
+        // NOTE: operator+() takes care of zero and negative constants.
+        return std::move(*retval) + expression{k};
+    }
+
+    expression operator()(const expression &ex)
+    {
+        if (auto it = memo.find(ex); it != memo.end()) {
+            return it->second;
+        }
+
+        auto ret = std::visit(
+            [this, &ex](const auto &v) -> expression {
+                using type = uncvref_t<decltype(v)>;
+
+                if constexpr (std::is_same_v<type, binary_operator>) {
+                    auto tmp = binary_operator{v.op(), (*this)(v.lhs()), (*this)(v.rhs())};
+                    const auto sex = expression{std::move(tmp)};
+
+                    if (v.op() == binary_operator::type::add || v.op() == binary_operator::type::sub) {
+                        return simplify_sum(sex);
+                    } else {
+                        auto [c, num, den] = split_prod(sex);
+                        return make_term(c, num, den);
+                    }
+                } else if constexpr (std::is_same_v<type, func>) {
+                    auto tmp = v;
+                    for (auto [b, e] = tmp.get_mutable_args_it(); b != e; ++b) {
+                        *b = (*this)(*b);
+                    }
+                    auto sex = expression{std::move(tmp)};
+
+                    if (as_power(sex)) {
+                        auto [c, num, den] = split_prod(sex);
+                        return make_term(c, num, den);
+                    }
+
+                    return sex;
+                } else {
+                    // Numbers, variables and params are already simplified.
+                    return ex;
+                }
+            },
+            ex.value());
+
+        memo.emplace(ex, ret);
+
+        return ret;
+    }
+};
+
+} // namespace
+
+} // namespace detail
+
+expression simplify(const expression &ex)
+{
+    return detail::simplifier{}(ex);
+}
+
+std::vector<expression> simplify(const std::vector<expression> &v_ex)
+{
+    // NOTE: use a single simplifier, so that the subexpressions
+    // shared among the expressions are simplified only once.
+    detail::simplifier s;
+
+    std::vector<expression> retval;
+    retval.reserve(v_ex.size());
+    for (const auto &ex : v_ex) {
+        retval.push_back(s(ex));
+    }
+
+    return retval;
+}
+
+} // namespace heyoka
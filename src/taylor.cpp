@@ -10,23 +10,33 @@
 
 #include <algorithm>
 #include <array>
+#include <atomic>
 #include <cassert>
+#include <chrono>
 #include <cmath>
 #include <cstddef>
 #include <cstdint>
 #include <deque>
+#include <exception>
 #include <functional>
+#include <future>
+#include <istream>
 #include <iterator>
 #include <limits>
 #include <locale>
+#include <map>
+#include <memory>
 #include <numeric>
 #include <optional>
 #include <ostream>
+#include <queue>
 #include <sstream>
 #include <stdexcept>
 #include <string>
+#include <thread>
 #include <tuple>
 #include <type_traits>
+#include <typeindex>
 #include <typeinfo>
 #include <unordered_map>
 #include <unordered_set>
@@ -36,6 +46,18 @@
 
 #include <boost/graph/adjacency_list.hpp>
 #include <boost/numeric/conversion/cast.hpp>
+#include <boost/version.hpp>
+
+// NOTE: the header for hash_combine changed in version 1.67.
+#if (BOOST_VERSION / 100000 > 1) || (BOOST_VERSION / 100000 == 1 && BOOST_VERSION / 100 % 1000 >= 67)
+
+#include <boost/container_hash/hash.hpp>
+
+#else
+
+#include <boost/functional/hash.hpp>
+
+#endif
 
 #include <fmt/format.h>
 
@@ -58,18 +80,26 @@
 #endif
 
 #include <heyoka/binary_operator.hpp>
+#include <heyoka/compiled_function.hpp>
+#include <heyoka/detail/binary_io.hpp>
 #include <heyoka/detail/llvm_fwd.hpp>
 #include <heyoka/detail/llvm_helpers.hpp>
-#include <heyoka/detail/sleef.hpp>
+#include <heyoka/detail/poly_roots.hpp>
+#include <heyoka/detail/run_workers.hpp>
+#include <heyoka/detail/simple_timer.hpp>
 #include <heyoka/detail/string_conv.hpp>
+#include <heyoka/detail/traversal.hpp>
 #include <heyoka/detail/type_traits.hpp>
 #include <heyoka/detail/visibility.hpp>
 #include <heyoka/expression.hpp>
 #include <heyoka/func.hpp>
 #include <heyoka/llvm_state.hpp>
+#include <heyoka/math/ephem.hpp>
 #include <heyoka/number.hpp>
 #include <heyoka/param.hpp>
+#include <heyoka/perf_counters.hpp>
 #include <heyoka/taylor.hpp>
+#include <heyoka/tracing.hpp>
 #include <heyoka/variable.hpp>
 
 namespace heyoka
@@ -143,8 +173,10 @@ llvm::Value *taylor_codegen_numparam_par(llvm_state &s, const param &p, llvm::Va
     // Compute the pointer to load from.
     auto ptr = builder.CreateInBoundsGEP(par_ptr, {builder.getInt32(arr_idx)});
 
-    // Load.
-    return load_vector_from_memory(builder, ptr, batch_size);
+    // Load. For lane-shared params, load only the
+    // first element and broadcast it.
+    return p.is_shared() ? vector_splat(builder, builder.CreateLoad(ptr), batch_size)
+                         : load_vector_from_memory(builder, ptr, batch_size);
 }
 
 } // namespace
@@ -176,9 +208,11 @@ std::string taylor_c_diff_numparam_mangle(const number &)
     return "num";
 }
 
-std::string taylor_c_diff_numparam_mangle(const param &)
+std::string taylor_c_diff_numparam_mangle(const param &p)
 {
-    return "par";
+    // NOTE: lane-shared params are loaded differently,
+    // hence they need a different mangling.
+    return p.is_shared() ? "spar" : "par";
 }
 
 // Deduce the c_diff function argument type for number/param
@@ -203,7 +237,7 @@ llvm::Value *taylor_c_diff_numparam_codegen(llvm_state &s, const number &, llvm:
     return vector_splat(s.builder(), n, batch_size);
 }
 
-llvm::Value *taylor_c_diff_numparam_codegen(llvm_state &s, const param &, llvm::Value *p, llvm::Value *par_ptr,
+llvm::Value *taylor_c_diff_numparam_codegen(llvm_state &s, const param &par, llvm::Value *p, llvm::Value *par_ptr,
                                             std::uint32_t batch_size)
 {
     auto &builder = s.builder();
@@ -212,18 +246,107 @@ llvm::Value *taylor_c_diff_numparam_codegen(llvm_state &s, const param &, llvm::
     // NOTE: the overflow check is done in taylor_compute_jet().
     auto ptr = builder.CreateInBoundsGEP(par_ptr, {builder.CreateMul(p, builder.getInt32(batch_size))});
 
-    return load_vector_from_memory(builder, ptr, batch_size);
+    // NOTE: par is used only to determine
+    // whether or not the param is lane-shared.
+    return par.is_shared() ? vector_splat(builder, builder.CreateLoad(ptr), batch_size)
+                           : load_vector_from_memory(builder, ptr, batch_size);
 }
 
 namespace
 {
 
+// Rename the u variables in the definition ex according to the map
+// rename (from the original to the new indices of the u variables),
+// and return a structural hash of the renamed definition.
+// NOTE: the arguments of the definitions in a Taylor decomposition are
+// (almost always) u variables, numbers or params, hence this is in practice
+// an O(1) operation per definition. The u variables are hashed via their
+// indices, so that no string hashing is involved.
+// NOTE: the hash is consistent with operator==() on the renamed definitions.
+std::size_t taylor_cse_rename(expression &ex, const std::vector<std::uint32_t> &rename)
+{
+    if (auto *vptr = std::get_if<variable>(&ex.value())) {
+        assert(uname_to_index(*vptr) < rename.size());
+        const auto idx = rename[uname_to_index(*vptr)];
+
+        ex = expression{detail::make_u_var(idx)};
+
+        return std::hash<std::uint32_t>{}(idx);
+    }
+
+    if (auto *bptr = std::get_if<binary_operator>(&ex.value())) {
+        std::size_t seed = std::hash<binary_operator::type>{}(bptr->op());
+
+        boost::hash_combine(seed, taylor_cse_rename(bptr->lhs(), rename));
+        boost::hash_combine(seed, taylor_cse_rename(bptr->rhs(), rename));
+
+        return seed;
+    }
+
+    if (auto *fptr = std::get_if<func>(&ex.value())) {
+        std::size_t seed = std::hash<std::string>{}(fptr->get_name());
+
+        boost::hash_combine(seed, fptr->get_type_index());
+
+        for (auto [b, e] = fptr->get_mutable_args_it(); b != e; ++b) {
+            boost::hash_combine(seed, taylor_cse_rename(*b, rename));
+        }
+
+        return seed;
+    }
+
+    // Numbers and params.
+    return hash(ex);
+}
+
+// Append to out the indices of the u variables
+// in the definition ex (possibly with repetitions).
+void taylor_u_deps(const expression &ex, std::vector<std::uint32_t> &out)
+{
+    if (const auto *vptr = std::get_if<variable>(&ex.value())) {
+        out.push_back(uname_to_index(*vptr));
+    } else if (const auto *bptr = std::get_if<binary_operator>(&ex.value())) {
+        taylor_u_deps(bptr->lhs(), out);
+        taylor_u_deps(bptr->rhs(), out);
+    } else if (const auto *fptr = std::get_if<func>(&ex.value())) {
+        for (const auto &arg : fptr->args()) {
+            taylor_u_deps(arg, out);
+        }
+    }
+}
+
+// Key used for the detection of the common subexpressions
+// in a Taylor decomposition: a definition with its precomputed hash.
+struct taylor_cse_key {
+    expression ex;
+    std::size_t hash;
+};
+
+struct taylor_cse_key_hasher {
+    std::size_t operator()(const taylor_cse_key &k) const noexcept
+    {
+        return k.hash;
+    }
+};
+
+struct taylor_cse_key_eq {
+    bool operator()(const taylor_cse_key &k1, const taylor_cse_key &k2) const
+    {
+        return k1.hash == k2.hash && k1.ex == k2.ex;
+    }
+};
+
 // Simplify a Taylor decomposition by removing
 // common subexpressions.
 // NOTE: the hidden deps are not considered for CSE
 // purposes, only the actual subexpressions.
+// NOTE: the indices in sv_funcs_dc (i.e., the indices of the u variables
+// representing the extra functions passed to the decomposition) will be
+// updated in place in order to account for the removal of the redundant
+// u variables.
 std::vector<std::pair<expression, std::vector<std::uint32_t>>>
 taylor_decompose_cse(std::vector<std::pair<expression, std::vector<std::uint32_t>>> &v_ex,
+                     std::vector<std::uint32_t> &sv_funcs_dc,
                      std::vector<std::pair<expression, std::vector<std::uint32_t>>>::size_type n_eq)
 {
     using idx_t = std::vector<std::pair<expression, std::vector<std::uint32_t>>>::size_type;
@@ -237,15 +360,19 @@ taylor_decompose_cse(std::vector<std::pair<expression, std::vector<std::uint32_t
     // Init the return value.
     std::vector<std::pair<expression, std::vector<std::uint32_t>>> retval;
 
-    // expression -> idx map. This will end up containing
-    // all the unique expressions from v_ex, and it will
+    // Definition -> idx map. This will end up containing
+    // all the unique definitions from v_ex, and it will
     // map them to their indices in retval (which will
     // in general differ from their indices in v_ex).
-    std::unordered_map<expression, idx_t> ex_map;
+    std::unordered_map<taylor_cse_key, idx_t, taylor_cse_key_hasher, taylor_cse_key_eq> ex_map;
 
     // Map for the renaming of u variables
-    // in the expressions.
-    std::unordered_map<std::string, std::string> uvars_rename;
+    // in the expressions: the u variable u_i
+    // in v_ex will be renamed to u_{uvars_rename[i]}.
+    // NOTE: the indices of the decomposition are
+    // guaranteed to fit in std::uint32_t.
+    std::vector<std::uint32_t> uvars_rename;
+    uvars_rename.reserve(v_ex.size());
 
     // The first n_eq definitions are just renaming
     // of the state variables into u variables.
@@ -254,40 +381,40 @@ taylor_decompose_cse(std::vector<std::pair<expression, std::vector<std::uint32_t
         // NOTE: no hidden deps allowed here.
         assert(v_ex[i].second.empty());
         retval.push_back(std::move(v_ex[i]));
+
+        // NOTE: the state variables are never renamed.
+        uvars_rename.push_back(static_cast<std::uint32_t>(i));
     }
 
     // Handle the u variables which do not correspond to state variables.
     for (auto i = n_eq; i < v_ex.size() - n_eq; ++i) {
         auto &[ex, deps] = v_ex[i];
 
-        // Rename the u variables in ex.
-        rename_variables(ex, uvars_rename);
+        // Rename the u variables in ex and compute its hash.
+        taylor_cse_key key{std::move(ex), 0};
+        key.hash = taylor_cse_rename(key.ex, uvars_rename);
 
-        if (auto it = ex_map.find(ex); it == ex_map.end()) {
+        if (auto it = ex_map.find(key); it == ex_map.end()) {
             // This is the first occurrence of ex in the
             // decomposition. Add it to retval.
-            retval.emplace_back(ex, std::move(deps));
+            retval.emplace_back(key.ex, std::move(deps));
 
             // Add ex to ex_map, mapping it to
             // the index it corresponds to in retval
             // (let's call it j).
-            ex_map.emplace(std::move(ex), retval.size() - 1u);
+            ex_map.emplace(std::move(key), retval.size() - 1u);
 
             // Update uvars_rename. This will ensure that
             // occurrences of the variable 'u_i' in the next
             // elements of v_ex will be renamed to 'u_j'.
-            [[maybe_unused]] const auto res
-                = uvars_rename.emplace("u_" + li_to_string(i), "u_" + li_to_string(retval.size() - 1u));
-            assert(res.second);
+            uvars_rename.push_back(static_cast<std::uint32_t>(retval.size() - 1u));
         } else {
             // ex is redundant. This means
             // that it already appears in retval at index
             // it->second. Don't add anything to retval,
             // and remap the variable name 'u_i' to
             // 'u_{it->second}'.
-            [[maybe_unused]] const auto res
-                = uvars_rename.emplace("u_" + li_to_string(i), "u_" + li_to_string(it->second));
-            assert(res.second);
+            uvars_rename.push_back(static_cast<std::uint32_t>(it->second));
         }
     }
 
@@ -304,7 +431,7 @@ taylor_decompose_cse(std::vector<std::pair<expression, std::vector<std::uint32_t
                || std::holds_alternative<param>(ex.value()));
         assert(deps.empty());
 
-        rename_variables(ex, uvars_rename);
+        taylor_cse_rename(ex, uvars_rename);
 
         retval.emplace_back(std::move(ex), std::move(deps));
     }
@@ -314,12 +441,19 @@ taylor_decompose_cse(std::vector<std::pair<expression, std::vector<std::uint32_t
     // for the renaming of the uvars.
     for (auto &[_, deps] : retval) {
         for (auto &idx : deps) {
-            auto it = uvars_rename.find("u_" + li_to_string(idx));
-            assert(it != uvars_rename.end());
-            idx = uname_to_index(it->second);
+            assert(idx < uvars_rename.size());
+            idx = uvars_rename[idx];
         }
     }
 
+    // Same for the indices in sv_funcs_dc.
+    // NOTE: the indices of the state variables
+    // are never renamed.
+    for (auto &idx : sv_funcs_dc) {
+        assert(idx < uvars_rename.size());
+        idx = uvars_rename[idx];
+    }
+
     return retval;
 }
 
@@ -336,8 +470,17 @@ taylor_decompose_cse(std::vector<std::pair<expression, std::vector<std::uint32_t
 // expressions which are dependent on each other. By doing another topological
 // sort, this time based on breadth-first search, we determine another valid
 // sorting in which independent operations tend to be clustered together.
+// The other strategies are the original depth-first order (dfs), and
+// a topological sort in which, among the u variables whose arguments are
+// available, the one whose last argument was computed most recently
+// is picked first (live_range). The latter tends to consume the u variables
+// right after their definition, which shortens their live ranges.
+// NOTE: the indices in sv_funcs_dc will be updated in place
+// in order to account for the reordering.
 auto taylor_sort_dc(std::vector<std::pair<expression, std::vector<std::uint32_t>>> &dc,
-                    std::vector<std::pair<expression, std::vector<std::uint32_t>>>::size_type n_eq)
+                    std::vector<std::uint32_t> &sv_funcs_dc,
+                    std::vector<std::pair<expression, std::vector<std::uint32_t>>>::size_type n_eq,
+                    taylor_sort_strategy strategy)
 {
     // A Taylor decomposition is supposed
     // to have n_eq variables at the beginning,
@@ -345,6 +488,17 @@ auto taylor_sort_dc(std::vector<std::pair<expression, std::vector<std::uint32_t>
     // extra variables in the middle
     assert(dc.size() >= n_eq * 2u);
 
+    if (strategy == taylor_sort_strategy::dfs) {
+        // The decomposition is already
+        // sorted in depth-first order.
+        return std::move(dc);
+    }
+
+    if (strategy != taylor_sort_strategy::bfs && strategy != taylor_sort_strategy::live_range) {
+        throw std::invalid_argument("Invalid sort strategy specified for a Taylor decomposition: the value "
+                                    + std::to_string(static_cast<int>(strategy)) + " is not valid");
+    }
+
     // The graph type that we will use for the topological sorting.
     using graph_t = boost::adjacency_list<boost::vecS,           // std::vector for list of adjacent vertices
                                           boost::vecS,           // std::vector for the list of vertices
@@ -370,11 +524,15 @@ auto taylor_sort_dc(std::vector<std::pair<expression, std::vector<std::uint32_t>
     }
 
     // Add the rest of the u variables.
+    std::vector<std::uint32_t> vars;
     for (decltype(n_eq) i = n_eq; i < dc.size() - n_eq; ++i) {
         auto v = boost::add_vertex(g);
 
-        // Fetch the list of variables in the current expression.
-        const auto vars = get_variables(dc[i].first);
+        // Fetch the indices of the u variables in the current expression.
+        vars.clear();
+        taylor_u_deps(dc[i].first, vars);
+        std::sort(vars.begin(), vars.end());
+        vars.erase(std::unique(vars.begin(), vars.end()), vars.end());
 
         if (vars.empty()) {
             // The current expression does not contain
@@ -386,10 +544,7 @@ auto taylor_sort_dc(std::vector<std::pair<expression, std::vector<std::uint32_t>
         } else {
             // Mark the current u variable as depending on all the
             // variables in the current expression.
-            for (const auto &var : vars) {
-                // Extract the index.
-                const auto idx = uname_to_index(var);
-
+            for (const auto idx : vars) {
                 // Add the dependency.
                 // NOTE: add +1 because the i-th vertex
                 // corresponds to the (i-1)-th u variable
@@ -401,7 +556,7 @@ auto taylor_sort_dc(std::vector<std::pair<expression, std::vector<std::uint32_t>
 
     assert(boost::num_vertices(g) - 1u == dc.size() - n_eq);
 
-    // Run the BF topological sort on the graph. This is Kahn's algorithm:
+    // Run the topological sort on the graph. This is Kahn's algorithm:
     // https://en.wikipedia.org/wiki/Topological_sorting
 
     // The result of the sort.
@@ -410,17 +565,10 @@ auto taylor_sort_dc(std::vector<std::pair<expression, std::vector<std::uint32_t>
     // Temp variable used to sort a list of edges in the loop below.
     std::vector<boost::graph_traits<graph_t>::edge_descriptor> tmp_edges;
 
-    // The set of all nodes with no incoming edge.
-    std::deque<decltype(dc.size())> tmp;
-    // The root node has no incoming edge.
-    tmp.push_back(0);
-
-    // Main loop.
-    while (!tmp.empty()) {
-        // Pop the first element from tmp
-        // and append it to the result.
-        const auto v = tmp.front();
-        tmp.pop_front();
+    // Helper to append the vertex v to the result and to remove
+    // its out edges. The vertices which, as a result, do not have
+    // any incoming edge are passed to push().
+    auto emit = [&](decltype(dc.size()) v, const auto &push) {
         v_idx.push_back(v);
 
         // Fetch all the out edges of v and sort them according
@@ -436,7 +584,7 @@ auto taylor_sort_dc(std::vector<std::pair<expression, std::vector<std::uint32_t>
         // - eliminate it;
         // - check if the target vertex of the edge
         //   has other incoming edges;
-        // - if it does not, insert it into tmp.
+        // - if it does not, push it.
         for (auto &e : tmp_edges) {
             // Fetch the target of the edge.
             const auto t = boost::target(e, g);
@@ -448,10 +596,59 @@ auto taylor_sort_dc(std::vector<std::pair<expression, std::vector<std::uint32_t>
             const auto iav = boost::inv_adjacent_vertices(t, g);
 
             if (iav.first == iav.second) {
-                // t does not have any incoming edges, add it to tmp.
-                tmp.push_back(t);
+                // t does not have any incoming edges.
+                push(t);
             }
         }
+    };
+
+    if (strategy == taylor_sort_strategy::bfs) {
+        // The set of all nodes with no incoming edge.
+        std::deque<decltype(dc.size())> tmp;
+        // The root node has no incoming edge.
+        tmp.push_back(0);
+
+        // Main loop.
+        while (!tmp.empty()) {
+            // Pop the first element from tmp
+            // and append it to the result.
+            const auto v = tmp.front();
+            tmp.pop_front();
+
+            emit(v, [&tmp](auto t) { tmp.push_back(t); });
+        }
+    } else {
+        // The set of all nodes with no incoming edge, ordered by the position
+        // in v_idx of their last argument (most recent first), and then by
+        // their original index.
+        using item_t = std::pair<decltype(dc.size()), decltype(dc.size())>;
+        auto cmp = [](const item_t &a, const item_t &b) {
+            return a.first < b.first || (a.first == b.first && a.second > b.second);
+        };
+        std::priority_queue<item_t, std::vector<item_t>, decltype(cmp)> tmp(cmp);
+
+        // NOTE: the vertex which makes t ready is
+        // always the last vertex appended to v_idx.
+        auto push = [&tmp, &v_idx, n_eq](auto t) {
+            // NOTE: the state variables are emitted
+            // separately, in order, below.
+            if (t > n_eq) {
+                tmp.emplace(v_idx.size() - 1u, t);
+            }
+        };
+
+        // The root node and the state variables come first.
+        for (decltype(dc.size()) v = 0; v <= n_eq; ++v) {
+            emit(v, push);
+        }
+
+        // Main loop.
+        while (!tmp.empty()) {
+            const auto v = tmp.top().second;
+            tmp.pop();
+
+            emit(v, push);
+        }
     }
 
     assert(v_idx.size() == boost::num_vertices(g));
@@ -466,26 +663,34 @@ auto taylor_sort_dc(std::vector<std::pair<expression, std::vector<std::uint32_t>
     v_idx.resize(boost::numeric_cast<decltype(v_idx.size())>(dc.size()));
     std::iota(v_idx.data() + dc.size() - n_eq, v_idx.data() + dc.size(), dc.size() - n_eq);
 
-    // Create the remapping dictionary.
-    std::unordered_map<std::string, std::string> remap;
+    // Create the remapping table (from the original to
+    // the new indices of the u variables).
+    // NOTE: the indices of the state variables and of the
+    // final n_eq elements are not affected by the reordering.
+    std::vector<std::uint32_t> remap(dc.size());
+    std::iota(remap.begin(), remap.end(), std::uint32_t(0));
     for (decltype(v_idx.size()) i = n_eq; i < v_idx.size() - n_eq; ++i) {
-        [[maybe_unused]] const auto res = remap.emplace("u_" + li_to_string(v_idx[i]), "u_" + li_to_string(i));
-        assert(res.second);
+        remap[v_idx[i]] = static_cast<std::uint32_t>(i);
     }
 
     // Do the remap.
     for (auto it = dc.data() + n_eq; it != dc.data() + dc.size(); ++it) {
         // Remap the expression.
-        rename_variables(it->first, remap);
+        taylor_cse_rename(it->first, remap);
 
         // Remap the hidden dependencies.
         for (auto &idx : it->second) {
-            auto it_remap = remap.find("u_" + li_to_string(idx));
-            assert(it_remap != remap.end());
-            idx = uname_to_index(it_remap->second);
+            assert(idx < remap.size());
+            idx = remap[idx];
         }
     }
 
+    // Remap the indices in sv_funcs_dc.
+    for (auto &idx : sv_funcs_dc) {
+        assert(idx < remap.size());
+        idx = remap[idx];
+    }
+
     // Reorder the decomposition.
     std::vector<std::pair<expression, std::vector<std::uint32_t>>> retval;
     for (auto idx : v_idx) {
@@ -497,6 +702,115 @@ auto taylor_sort_dc(std::vector<std::pair<expression, std::vector<std::uint32_t>
 
 #if !defined(NDEBUG)
 
+// Hash-consing of expressions for the verification of the Taylor decompositions.
+// Structurally-equal expressions are assigned the same id (consistently with
+// operator==()), and each u variable is assigned the id of its expanded definition,
+// so that the decomposition can be checked against the original expressions
+// without expanding the definitions of the u variables (whose size can grow
+// exponentially with the number of u variables, e.g., after CSE). The nodes shared in the
+// original expressions are visited only once, thus the verification takes
+// linear time in the sizes of the decomposition and of the original expressions.
+class taylor_dec_hc
+{
+    using key_t = std::tuple<std::string, std::type_index, std::vector<std::size_t>>;
+
+    struct key_hasher {
+        std::size_t operator()(const key_t &k) const
+        {
+            auto seed = std::hash<std::string>{}(std::get<0>(k));
+            boost::hash_combine(seed, std::get<1>(k).hash_code());
+            boost::hash_range(seed, std::get<2>(k).begin(), std::get<2>(k).end());
+
+            return seed;
+        }
+    };
+
+    // The ids of the numbers, variables and params,
+    // and of the binary operators and functions.
+    std::unordered_map<expression, std::size_t> m_leaves;
+    std::unordered_map<key_t, std::size_t, key_hasher> m_nodes;
+    // The ids of the nodes of the original expressions.
+    std::unordered_map<const void *, std::size_t> m_memo;
+    // The ids of the u variables.
+    std::vector<std::size_t> m_u_ids;
+
+    std::size_t next_id() const
+    {
+        return m_leaves.size() + m_nodes.size();
+    }
+    std::size_t leaf_id(const expression &ex)
+    {
+        return m_leaves.emplace(ex, next_id()).first->second;
+    }
+    std::size_t node_id(const expression &ex, const std::size_t *args)
+    {
+        const auto [b, e] = node_args(ex);
+
+        key_t key{std::string{}, std::type_index(typeid(void)), std::vector<std::size_t>(args, args + (e - b))};
+
+        if (const auto bptr = std::get_if<binary_operator>(&ex.value())) {
+            std::get<0>(key) = std::to_string(static_cast<int>(bptr->op()));
+            std::get<1>(key) = std::type_index(typeid(binary_operator));
+        } else {
+            const auto &f = std::get<func>(ex.value());
+
+            std::get<0>(key) = f.get_name();
+            std::get<1>(key) = f.get_type_index();
+        }
+
+        return m_nodes.emplace(std::move(key), next_id()).first->second;
+    }
+    // The id of an argument in the definition of a u variable.
+    std::size_t u_arg_id(const expression &arg)
+    {
+        if (const auto vptr = std::get_if<variable>(&arg.value())) {
+            assert(uname_to_index(*vptr) < m_u_ids.size());
+
+            return m_u_ids[uname_to_index(*vptr)];
+        }
+
+        return leaf_id(arg);
+    }
+
+public:
+    // Add the definition of the next u variable (in the
+    // format of the decompositions). The definitions of the
+    // state variables are the original variables.
+    void add_u(const expression &def, bool is_state)
+    {
+        if (is_state || node_key(def) == nullptr) {
+            m_u_ids.push_back(is_state ? leaf_id(def) : u_arg_id(def));
+            return;
+        }
+
+        const auto [b, e] = node_args(def);
+
+        std::vector<std::size_t> args;
+        for (auto it = b; it != e; ++it) {
+            args.push_back(u_arg_id(*it));
+        }
+
+        m_u_ids.push_back(node_id(def, args.data()));
+    }
+    std::size_t u_id(std::size_t i) const
+    {
+        assert(i < m_u_ids.size());
+
+        return m_u_ids[i];
+    }
+    // The id of an original expression.
+    std::size_t operator()(const expression &ex)
+    {
+        return fold_postorder<std::size_t>(
+            ex,
+            // NOTE: the functions without arguments
+            // are mapped to ids as the other functions.
+            [this](const expression &n) { return node_key(n) == nullptr ? leaf_id(n) : node_id(n, nullptr); },
+            [this](const expression &n, const std::size_t *args) { return node_id(n, args); },
+            [](const expression &) { return true; }, m_memo);
+    }
+};
+
 // Helper to verify a Taylor decomposition.
 void verify_taylor_dec(const std::vector<expression> &orig,
                        const std::vector<std::pair<expression, std::vector<std::uint32_t>>> &dc)
@@ -530,7 +844,7 @@ void verify_taylor_dec(const std::vector<expression> &orig,
                     auto check_arg = [i](const auto &arg) {
                         if (auto p_var = std::get_if<variable>(&arg.value())) {
                             assert(p_var->name().rfind("u_", 0) == 0);
-                            assert(uname_to_index(p_var->name()) < i);
+                            assert(uname_to_index(*p_var) < i);
                         } else if (std::get_if<number>(&arg.value()) == nullptr
                                    && std::get_if<param>(&arg.value()) == nullptr) {
                             assert(false);
@@ -565,7 +879,7 @@ void verify_taylor_dec(const std::vector<expression> &orig,
 
                 if constexpr (std::is_same_v<type, variable>) {
                     assert(v.name().rfind("u_", 0) == 0);
-                    assert(uname_to_index(v.name()) < i);
+                    assert(uname_to_index(v) < i);
                 } else if constexpr (!std::is_same_v<type, number> && !std::is_same_v<type, param>) {
                     assert(false);
                 }
@@ -576,24 +890,202 @@ void verify_taylor_dec(const std::vector<expression> &orig,
         assert(dc[i].second.empty());
     }
 
-    std::unordered_map<std::string, expression> subs_map;
+    taylor_dec_hc hc;
 
-    // For each u variable, expand its definition
-    // in terms of state variables or other u variables,
-    // and store it in subs_map.
-    for (idx_t i = 0; i < dc.size() - n_eq; ++i) {
-        subs_map.emplace("u_" + li_to_string(i), subs(dc[i].first, subs_map));
+    // Assign the ids to the u variables (that is,
+    // to their expanded definitions in terms of
+    // the state variables) and to the right-hand sides
+    // of the system, and compare them to the ids
+    // of the original right-hand sides.
+    for (idx_t i = 0; i < dc.size(); ++i) {
+        hc.add_u(dc[i].first, i < n_eq);
     }
 
-    // Reconstruct the right-hand sides of the system
-    // and compare them to the original ones.
     for (auto i = dc.size() - n_eq; i < dc.size(); ++i) {
-        assert(subs(dc[i].first, subs_map) == orig[i - (dc.size() - n_eq)]);
+        assert(hc.u_id(i) == hc(orig[i - (dc.size() - n_eq)]));
+    }
+}
+
+// Helper to verify the decomposition of the extra functions
+// of the state variables. sv_funcs are the original functions
+// (expressed in terms of u variables), sv_funcs_dc their
+// indices in the decomposition dc.
+void verify_taylor_dec_sv_funcs(const std::vector<std::uint32_t> &sv_funcs_dc,
+                                const std::vector<expression> &sv_funcs,
+                                const std::vector<std::pair<expression, std::vector<std::uint32_t>>> &dc,
+                                std::vector<expression>::size_type n_eq)
+{
+    assert(sv_funcs.size() == sv_funcs_dc.size());
+
+    taylor_dec_hc hc;
+
+    // Assign the ids to the u variables, and compare
+    // the ids of the u variables representing the extra
+    // functions to the ids of the original ones.
+    for (decltype(dc.size()) i = 0; i < dc.size() - n_eq; ++i) {
+        hc.add_u(dc[i].first, i < n_eq);
+    }
+
+    for (decltype(sv_funcs.size()) i = 0; i < sv_funcs.size(); ++i) {
+        assert(sv_funcs_dc[i] < dc.size() - n_eq);
+        assert(hc.u_id(sv_funcs_dc[i]) == hc(sv_funcs[i]));
     }
 }
 
 #endif
 
+// Decompose the functions of the state variables sv_funcs into u_vars_defs,
+// after having renamed their variables via repl_map. The return value
+// contains the indices of the u variables representing sv_funcs.
+std::vector<std::uint32_t>
+taylor_decompose_sv_funcs(std::vector<expression> &sv_funcs,
+                          const std::unordered_map<std::string, std::string> &repl_map,
+                          std::vector<std::pair<expression, std::vector<std::uint32_t>>> &u_vars_defs)
+{
+    std::vector<std::uint32_t> retval;
+
+    for (auto &sv_ex : sv_funcs) {
+        // Check that the variables in sv_ex are state variables.
+        for (const auto &var : get_variables(sv_ex)) {
+            if (repl_map.find(var) == repl_map.end()) {
+                throw std::invalid_argument("The extra functions in a Taylor decomposition contain the variable '"
+                                            + var + "', which is not a state variable");
+            }
+        }
+
+        // Rename the variables.
+        rename_variables(sv_ex, repl_map);
+
+        if (const auto var_ptr = std::get_if<variable>(&sv_ex.value())) {
+            // The function is a state variable, no need
+            // to decompose it.
+            retval.push_back(uname_to_index(*var_ptr));
+        } else if (std::holds_alternative<number>(sv_ex.value()) || std::holds_alternative<param>(sv_ex.value())) {
+            throw std::invalid_argument(
+                "The extra functions in a Taylor decomposition cannot be numbers or parameters");
+        } else {
+            // NOTE: make a copy of sv_ex because we will
+            // need the original for verification purposes.
+            const auto dres = taylor_decompose_in_place(expression{sv_ex}, u_vars_defs);
+            assert(dres != 0u);
+
+            retval.push_back(boost::numeric_cast<std::uint32_t>(dres));
+        }
+    }
+
+    return retval;
+}
+
+// Minimum number of equations for the parallel
+// decomposition of a system, and number of equations
+// decomposed by a worker in one go.
+constexpr std::size_t taylor_par_dc_threshold = 1024;
+constexpr std::size_t taylor_par_dc_chunk = 256;
+
+// Decompose the equations eqs (already expressed in terms of u variables) into
+// u_vars_defs, which must contain only the definitions of the n_eq state variables.
+// The return value contains the indices of the u variables representing the equations
+// (or zero for the equations which do not need to be decomposed).
+// For large systems the equations are decomposed in parallel: each worker decomposes
+// chunks of equations into partial decompositions which begin (like u_vars_defs)
+// with the state variables, and the partial decompositions are then concatenated
+// in the order of the equations, shifting the indices of the u variables. The result
+// is thus identical to the sequential decomposition, and the duplicate
+// definitions across different chunks are removed later by the CSE pass.
+// NOTE: eqs is not modified, and it keeps alive the nodes of the original
+// expressions during the decomposition. Because of that, the nodes shared by
+// equations in different chunks are always shared as well with eqs
+// when a worker reaches them, thus they are copied on write rather than
+// modified in place.
+std::vector<std::vector<std::pair<expression, std::vector<std::uint32_t>>>::size_type>
+taylor_decompose_eqs(const std::vector<expression> &eqs,
+                     std::vector<std::pair<expression, std::vector<std::uint32_t>>> &u_vars_defs)
+{
+    using size_type = std::vector<std::pair<expression, std::vector<std::uint32_t>>>::size_type;
+
+    const auto n_eq = eqs.size();
+    assert(u_vars_defs.size() == n_eq);
+
+    std::vector<size_type> retval(n_eq);
+
+    if (n_eq < taylor_par_dc_threshold || std::thread::hardware_concurrency() <= 1u) {
+        for (decltype(eqs.size()) i = 0; i < n_eq; ++i) {
+            retval[i] = taylor_decompose_in_place(expression{eqs[i]}, u_vars_defs);
+        }
+
+        return retval;
+    }
+
+    const auto n_chunks = n_eq / taylor_par_dc_chunk + static_cast<std::size_t>(n_eq % taylor_par_dc_chunk != 0u);
+    const auto n_threads
+        = static_cast<unsigned>(std::min(static_cast<std::size_t>(std::thread::hardware_concurrency()), n_chunks));
+
+    // The partial decompositions.
+    std::vector<std::vector<std::pair<expression, std::vector<std::uint32_t>>>> partials(n_chunks);
+
+    std::atomic<std::size_t> next_chunk(0);
+    std::vector<std::exception_ptr> eptrs(n_threads);
+
+    auto worker = [&](unsigned thread_idx) {
+        try {
+            for (auto c = next_chunk++; c < n_chunks; c = next_chunk++) {
+                auto &pdc = partials[c];
+                pdc.assign(u_vars_defs.begin(), u_vars_defs.end());
+
+                const auto end = std::min(n_eq, (c + 1u) * taylor_par_dc_chunk);
+                for (auto i = c * taylor_par_dc_chunk; i < end; ++i) {
+                    retval[i] = taylor_decompose_in_place(expression{eqs[i]}, pdc);
+                }
+            }
+        } catch (...) {
+            eptrs[thread_idx] = std::current_exception();
+            next_chunk = n_chunks;
+        }
+    };
+
+    run_workers(n_threads, worker, [&next_chunk, n_chunks]() { next_chunk = n_chunks; }, eptrs);
+
+    // Merge the partial decompositions.
+    std::vector<std::uint32_t> rename(n_eq);
+    std::iota(rename.begin(), rename.end(), std::uint32_t(0));
+
+    for (decltype(partials.size()) c = 0; c < n_chunks; ++c) {
+        auto &pdc = partials[c];
+        assert(pdc.size() >= n_eq);
+
+        // Map the local indices of the u variables
+        // of the chunk to the global ones.
+        const auto base = boost::numeric_cast<std::uint32_t>(u_vars_defs.size());
+        rename.resize(pdc.size());
+        for (auto j = n_eq; j < pdc.size(); ++j) {
+            rename[j] = base + static_cast<std::uint32_t>(j - n_eq);
+        }
+
+        for (auto j = n_eq; j < pdc.size(); ++j) {
+            auto &[ex, deps] = pdc[j];
+
+            taylor_cse_rename(ex, rename);
+            for (auto &d : deps) {
+                d = rename[d];
+            }
+
+            u_vars_defs.emplace_back(std::move(ex), std::move(deps));
+        }
+
+        const auto end = std::min(n_eq, (c + 1u) * taylor_par_dc_chunk);
+        for (auto i = c * taylor_par_dc_chunk; i < end; ++i) {
+            if (retval[i] != 0u) {
+                retval[i] = rename[retval[i]];
+            }
+        }
+
+        // Free the memory of the chunk.
+        pdc = {};
+    }
+
+    return retval;
+}
+
 } // namespace
 
 } // namespace detail
@@ -604,13 +1096,31 @@ void verify_taylor_dec(const std::vector<expression> &orig,
 // we should consider avoiding adding hidden deps if the
 // function argument(s) is a number/param: the hidden deps
 // won't be used for the computation of the derivatives
-// and thus they can be optimised out. Note that a straightforward
-// implementation of this idea this will only work when the argument
-// is a number/param, not when, e.g., the argument is par[0] + par[1] - in
-// order to simplify this out, it should be recognized that the definition
-// of a u variable depends only on numbers/params.
+// and thus they can be optimised out. Note that in the adaptive
+// Taylor steppers the subexpressions depending only on numbers/params
+// (e.g., par[0] + par[1]) are replaced by new params before the
+// decomposition (see taylor_par_hoister), so that there the functions
+// whose arguments depend only on numbers/params never appear.
 std::vector<std::pair<expression, std::vector<std::uint32_t>>> taylor_decompose(std::vector<expression> v_ex)
 {
+    return taylor_decompose(std::move(v_ex), {}).first;
+}
+
+namespace detail
+{
+
+namespace
+{
+
+// Implementation of taylor_decompose() with extra functions of the state
+// variables. The timings of the decomposition are recorded in stats.
+// The decomposition is reordered according to sort_strategy.
+std::pair<std::vector<std::pair<expression, std::vector<std::uint32_t>>>, std::vector<std::uint32_t>>
+taylor_decompose_impl(std::vector<expression> v_ex, std::vector<expression> sv_funcs, llvm_state_stats &stats,
+                      taylor_sort_strategy sort_strategy = taylor_sort_strategy::bfs)
+{
+    time_accumulator ta(stats.decompose_time);
+
     if (v_ex.empty()) {
         throw std::invalid_argument("Cannot decompose a system of zero equations");
     }
@@ -665,19 +1175,27 @@ std::vector<std::pair<expression, std::vector<std::uint32_t>>> taylor_decompose(
     auto v_ex_copy = v_ex;
 
     // Run the decomposition on each equation.
+    const auto eqs_dres = detail::taylor_decompose_eqs(v_ex, u_vars_defs);
     for (decltype(v_ex.size()) i = 0; i < v_ex.size(); ++i) {
-        // Decompose the current equation.
-        if (const auto dres = taylor_decompose_in_place(std::move(v_ex[i]), u_vars_defs)) {
+        if (const auto dres = eqs_dres[i]) {
             // NOTE: if the equation was decomposed
             // (that is, it is not constant or a single variable),
             // we have to update the original definition
             // of the equation in v_ex_copy
             // so that it points to the u variable
             // that now represents it.
-            v_ex_copy[i] = expression{variable{"u_" + detail::li_to_string(dres)}};
+            v_ex_copy[i] = expression{detail::make_u_var(boost::numeric_cast<std::uint32_t>(dres))};
         }
     }
 
+#if !defined(NDEBUG)
+    // Store a copy of the original extra functions for checking later.
+    const auto orig_sv_funcs = sv_funcs;
+#endif
+
+    // Decompose the extra functions of the state variables.
+    auto sv_funcs_dc = detail::taylor_decompose_sv_funcs(sv_funcs, repl_map, u_vars_defs);
+
     // Append the (possibly updated) definitions of the diff equations
     // in terms of u variables.
     for (auto &ex : v_ex_copy) {
@@ -687,24 +1205,49 @@ std::vector<std::pair<expression, std::vector<std::uint32_t>>> taylor_decompose(
 #if !defined(NDEBUG)
     // Verify the decomposition.
     detail::verify_taylor_dec(orig_v_ex, u_vars_defs);
+    detail::verify_taylor_dec_sv_funcs(sv_funcs_dc, orig_sv_funcs, u_vars_defs, n_eq);
 #endif
 
     // Simplify the decomposition.
-    u_vars_defs = detail::taylor_decompose_cse(u_vars_defs, n_eq);
+    {
+        time_accumulator ta_cse(stats.cse_time);
+        u_vars_defs = detail::taylor_decompose_cse(u_vars_defs, sv_funcs_dc, n_eq);
+    }
 
 #if !defined(NDEBUG)
     // Verify the simplified decomposition.
     detail::verify_taylor_dec(orig_v_ex, u_vars_defs);
+    detail::verify_taylor_dec_sv_funcs(sv_funcs_dc, orig_sv_funcs, u_vars_defs, n_eq);
 #endif
 
-    u_vars_defs = detail::taylor_sort_dc(u_vars_defs, n_eq);
+    {
+        time_accumulator ta_sort(stats.sort_time);
+        u_vars_defs = detail::taylor_sort_dc(u_vars_defs, sv_funcs_dc, n_eq, sort_strategy);
+    }
 
 #if !defined(NDEBUG)
     // Verify the reordered decomposition.
     detail::verify_taylor_dec(orig_v_ex, u_vars_defs);
+    detail::verify_taylor_dec_sv_funcs(sv_funcs_dc, orig_sv_funcs, u_vars_defs, n_eq);
 #endif
 
-    return u_vars_defs;
+    return std::pair{std::move(u_vars_defs), std::move(sv_funcs_dc)};
+}
+
+} // namespace
+
+} // namespace detail
+
+// Taylor decomposition with extra functions of the state variables
+// (e.g., event equations). The second element of the return value
+// contains the indices of the u variables representing sv_funcs
+// in the decomposition.
+std::pair<std::vector<std::pair<expression, std::vector<std::uint32_t>>>, std::vector<std::uint32_t>>
+taylor_decompose(std::vector<expression> v_ex, std::vector<expression> sv_funcs)
+{
+    llvm_state_stats stats;
+
+    return detail::taylor_decompose_impl(std::move(v_ex), std::move(sv_funcs), stats);
 }
 
 // Taylor decomposition from lhs and rhs
@@ -712,6 +1255,22 @@ std::vector<std::pair<expression, std::vector<std::uint32_t>>> taylor_decompose(
 std::vector<std::pair<expression, std::vector<std::uint32_t>>>
 taylor_decompose(std::vector<std::pair<expression, expression>> sys)
 {
+    return taylor_decompose(std::move(sys), {}).first;
+}
+
+namespace detail
+{
+
+namespace
+{
+
+// NOTE: this mirrors the implementation above.
+std::pair<std::vector<std::pair<expression, std::vector<std::uint32_t>>>, std::vector<std::uint32_t>>
+taylor_decompose_impl(std::vector<std::pair<expression, expression>> sys, std::vector<expression> sv_funcs,
+                      llvm_state_stats &stats, taylor_sort_strategy sort_strategy = taylor_sort_strategy::bfs)
+{
+    time_accumulator ta(stats.decompose_time);
+
     if (sys.empty()) {
         throw std::invalid_argument("Cannot decompose a system of zero equations");
     }
@@ -816,19 +1375,32 @@ taylor_decompose(std::vector<std::pair<expression, expression>> sys)
     auto sys_copy = sys;
 
     // Run the decomposition on each equation.
+    std::vector<expression> rhs_eqs;
+    rhs_eqs.reserve(sys.size());
+    for (const auto &[_, rhs_ex] : sys) {
+        rhs_eqs.push_back(rhs_ex);
+    }
+    const auto eqs_dres = detail::taylor_decompose_eqs(rhs_eqs, u_vars_defs);
     for (decltype(sys.size()) i = 0; i < sys.size(); ++i) {
-        // Decompose the current equation.
-        if (const auto dres = taylor_decompose_in_place(std::move(sys[i].second), u_vars_defs)) {
+        if (const auto dres = eqs_dres[i]) {
             // NOTE: if the equation was decomposed
             // (that is, it is not constant or a single variable),
             // we have to update the original definition
             // of the equation in sys_copy
             // so that it points to the u variable
             // that now represents it.
-            sys_copy[i].second = expression{variable{"u_" + detail::li_to_string(dres)}};
+            sys_copy[i].second = expression{detail::make_u_var(boost::numeric_cast<std::uint32_t>(dres))};
         }
     }
 
+#if !defined(NDEBUG)
+    // Store a copy of the original extra functions for checking later.
+    const auto orig_sv_funcs = sv_funcs;
+#endif
+
+    // Decompose the extra functions of the state variables.
+    auto sv_funcs_dc = detail::taylor_decompose_sv_funcs(sv_funcs, repl_map, u_vars_defs);
+
     // Append the (possibly updated) definitions of the diff equations
     // in terms of u variables.
     for (auto &[_, rhs] : sys_copy) {
@@ -838,34 +1410,95 @@ taylor_decompose(std::vector<std::pair<expression, expression>> sys)
 #if !defined(NDEBUG)
     // Verify the decomposition.
     detail::verify_taylor_dec(orig_rhs, u_vars_defs);
+    detail::verify_taylor_dec_sv_funcs(sv_funcs_dc, orig_sv_funcs, u_vars_defs, n_eq);
 #endif
 
     // Simplify the decomposition.
-    u_vars_defs = detail::taylor_decompose_cse(u_vars_defs, n_eq);
+    {
+        time_accumulator ta_cse(stats.cse_time);
+        u_vars_defs = detail::taylor_decompose_cse(u_vars_defs, sv_funcs_dc, n_eq);
+    }
 
 #if !defined(NDEBUG)
     // Verify the simplified decomposition.
     detail::verify_taylor_dec(orig_rhs, u_vars_defs);
+    detail::verify_taylor_dec_sv_funcs(sv_funcs_dc, orig_sv_funcs, u_vars_defs, n_eq);
 #endif
 
-    u_vars_defs = detail::taylor_sort_dc(u_vars_defs, n_eq);
+    {
+        time_accumulator ta_sort(stats.sort_time);
+        u_vars_defs = detail::taylor_sort_dc(u_vars_defs, sv_funcs_dc, n_eq, sort_strategy);
+    }
 
 #if !defined(NDEBUG)
     // Verify the reordered decomposition.
     detail::verify_taylor_dec(orig_rhs, u_vars_defs);
+    detail::verify_taylor_dec_sv_funcs(sv_funcs_dc, orig_sv_funcs, u_vars_defs, n_eq);
 #endif
 
-    return u_vars_defs;
+    return std::pair{std::move(u_vars_defs), std::move(sv_funcs_dc)};
+}
+
+} // namespace
+
+} // namespace detail
+
+// Taylor decomposition from lhs and rhs of a system of equations,
+// with extra functions of the state variables.
+std::pair<std::vector<std::pair<expression, std::vector<std::uint32_t>>>, std::vector<std::uint32_t>>
+taylor_decompose(std::vector<std::pair<expression, expression>> sys, std::vector<expression> sv_funcs)
+{
+    llvm_state_stats stats;
+
+    return detail::taylor_decompose_impl(std::move(sys), std::move(sv_funcs), stats);
+}
+
+// NOTE: the serialised decomposition is preceded by a tag
+// and by the version of heyoka.
+void taylor_save_dc(std::ostream &os, const taylor_dc_t &dc)
+{
+    detail::bin_save(os, std::string{"taylor_dc"});
+    detail::bin_save(os, std::string{HEYOKA_VERSION_STRING});
+    detail::bin_save(os, dc);
+}
+
+taylor_dc_t taylor_load_dc(std::istream &is)
+{
+    std::string tag, version;
+
+    detail::bin_load(is, tag);
+    if (tag != "taylor_dc") {
+        throw std::invalid_argument(
+            "Error loading a Taylor decomposition from an input stream: the stream does not contain a Taylor "
+            "decomposition");
+    }
+
+    detail::bin_load(is, version);
+    if (version != HEYOKA_VERSION_STRING) {
+        throw std::invalid_argument("Error loading a Taylor decomposition from an input stream: the decomposition "
+                                    "was saved with heyoka version "
+                                    + version + ", but the current heyoka version is " + HEYOKA_VERSION_STRING);
+    }
+
+    taylor_dc_t retval;
+    detail::bin_load(is, retval);
+
+    return retval;
 }
 
 namespace detail
 {
 
+taylor_dc_t taylor_simplify_sys(taylor_dc_t)
+{
+    throw std::invalid_argument("A precomputed Taylor decomposition cannot be simplified");
+}
+
 namespace
 {
 
 // Small helper to deduce the number of parameters
-// present in the rhs of an ODE.
+// present in the rhs of an ODE (or in a Taylor decomposition).
 template <typename T>
 std::uint32_t n_pars_in_sys(const T &sys)
 {
@@ -874,6 +1507,8 @@ std::uint32_t n_pars_in_sys(const T &sys)
     for (const auto &p : sys) {
         if constexpr (std::is_same_v<uncvref_t<decltype(p)>, expression>) {
             retval = std::max(retval, get_param_size(p));
+        } else if constexpr (std::is_same_v<T, taylor_dc_t>) {
+            retval = std::max(retval, get_param_size(p.first));
         } else {
             retval = std::max(retval, get_param_size(p.second));
         }
@@ -882,357 +1517,558 @@ std::uint32_t n_pars_in_sys(const T &sys)
     return retval;
 }
 
-} // namespace
-
-template <typename T>
-template <typename U>
-void taylor_adaptive_impl<T>::finalise_ctor_impl(U sys, std::vector<T> state, T time, T tol, bool high_accuracy,
-                                                 bool compact_mode, std::vector<T> pars)
+// Helper to fetch the index of the u variable var in
+// a precomputed Taylor decomposition, throwing if var is
+// not a u variable or if the index is not less than i.
+std::uint32_t taylor_dc_u_index(const variable &var, taylor_dc_t::size_type i)
 {
-    using std::isfinite;
-
-    // Assign the data members.
-    m_state = std::move(state);
-    m_time = time;
-    m_pars = std::move(pars);
+    const auto &name = var.name();
 
-    // Check input params.
-    if (std::any_of(m_state.begin(), m_state.end(), [](const auto &x) { return !isfinite(x); })) {
-        throw std::invalid_argument(
-            "A non-finite value was detected in the initial state of an adaptive Taylor integrator");
+    if (name.size() < 3u || name.rfind("u_", 0) != 0
+        || !std::all_of(name.begin() + 2, name.end(), [](char c) { return c >= '0' && c <= '9'; })) {
+        throw std::invalid_argument("Invalid Taylor decomposition: the variable '" + name
+                                    + "' is not a u variable");
     }
 
-    if (m_state.size() != sys.size()) {
-        throw std::invalid_argument("Inconsistent sizes detected in the initialization of an adaptive Taylor "
-                                    "integrator: the state vector has a dimension of "
-                                    + std::to_string(m_state.size()) + ", while the number of equations is "
-                                    + std::to_string(sys.size()));
+    const auto idx = uname_to_index(name);
+    if (idx >= i) {
+        throw std::invalid_argument("Invalid Taylor decomposition: the expression at index " + std::to_string(i)
+                                    + " depends on the u variable '" + name + "'");
     }
 
-    if (!isfinite(m_time)) {
-        throw std::invalid_argument("Cannot initialise an adaptive Taylor integrator with a non-finite initial time of "
-                                    + detail::li_to_string(m_time));
+    return idx;
+}
+
+// Validate a precomputed Taylor decomposition (e.g., from
+// the get_decomposition() function of an integrator), returning
+// the number of equations. The checks mirror the assertions
+// in verify_taylor_dec().
+// NOTE: a decomposition starts with the n_eq state variables and terminates
+// with the n_eq right-hand sides, which are u variables, numbers or params.
+// If 2 * L <= dc.size(), where L is the number of leading variables, then
+// n_eq must be L (as the entries after the first n_eq must not be variables,
+// unless they are the right-hand sides). Otherwise, there are no entries
+// between the state variables and the right-hand sides.
+std::uint32_t taylor_check_dc(const taylor_dc_t &dc)
+{
+    using idx_t = taylor_dc_t::size_type;
+
+    idx_t n_lead = 0;
+    while (n_lead < dc.size() && std::holds_alternative<variable>(dc[n_lead].first.value())) {
+        ++n_lead;
     }
 
-    if (!isfinite(tol) || tol <= 0) {
-        throw std::invalid_argument(
-            "The tolerance in an adaptive Taylor integrator must be finite and positive, but it is " + li_to_string(tol)
-            + " instead");
-    }
+    const auto n_eq = n_lead * 2u <= dc.size() ? n_lead : dc.size() / 2u;
 
-    // Fix m_pars' size, if necessary.
-    const auto npars = n_pars_in_sys(sys);
-    if (m_pars.size() < npars) {
-        m_pars.resize(boost::numeric_cast<decltype(m_pars.size())>(npars));
-    } else if (m_pars.size() > npars) {
-        using namespace fmt::literals;
+    if (n_eq == 0u || dc.size() < n_eq * 2u || (n_lead * 2u > dc.size() && dc.size() % 2u != 0u)) {
+        throw std::invalid_argument("Invalid Taylor decomposition: the structure of the decomposition is not "
+                                    "consistent with a system of equations");
+    }
 
-        throw std::invalid_argument(
-            "Excessive number of parameter values passed to the constructor of an adaptive "
-            "Taylor integrator: {} parameter values were passed, but the ODE system contains only {} parameters"_format(
-                m_pars.size(), npars));
+    // The state variables.
+    std::unordered_set<std::string> vars;
+    for (idx_t i = 0; i < n_eq; ++i) {
+        if (!vars.insert(std::get<variable>(dc[i].first.value()).name()).second || !dc[i].second.empty()) {
+            throw std::invalid_argument("Invalid Taylor decomposition: the state variables must be distinct and "
+                                        "without hidden dependencies");
+        }
     }
 
-    // Store the dimension of the system.
-    m_dim = boost::numeric_cast<std::uint32_t>(sys.size());
+    // The u variables.
+    for (auto i = n_eq; i < dc.size() - n_eq; ++i) {
+        std::visit(
+            [i](const auto &v) {
+                using type = uncvref_t<decltype(v)>;
 
-    // Add the stepper function.
-    std::tie(m_dc, m_order)
-        = taylor_add_adaptive_step<T>(m_llvm, "step", std::move(sys), tol, 1, high_accuracy, compact_mode);
+                if constexpr (std::is_same_v<type, func> || std::is_same_v<type, binary_operator>) {
+                    for (const auto &arg : v.args()) {
+                        if (auto p_var = std::get_if<variable>(&arg.value())) {
+                            taylor_dc_u_index(*p_var, i);
+                        } else if (std::get_if<number>(&arg.value()) == nullptr
+                                   && std::get_if<param>(&arg.value()) == nullptr) {
+                            throw std::invalid_argument("Invalid Taylor decomposition: the arguments of the "
+                                                        "expression at index "
+                                                        + std::to_string(i)
+                                                        + " must be u variables, numbers or params");
+                        }
+                    }
+                } else {
+                    throw std::invalid_argument("Invalid Taylor decomposition: the expression at index "
+                                                + std::to_string(i) + " must be a function or a binary operator");
+                }
+            },
+            dc[i].first.value());
 
-    // Run the jit.
-    m_llvm.compile();
+        for (auto idx : dc[i].second) {
+            if (idx < n_eq || idx >= dc.size() - n_eq || idx == i) {
+                throw std::invalid_argument("Invalid hidden dependency " + std::to_string(idx)
+                                            + " detected at index " + std::to_string(i)
+                                            + " in a Taylor decomposition");
+            }
+        }
+    }
 
-    // Fetch the stepper.
-    m_step_f = reinterpret_cast<step_f_t>(m_llvm.jit_lookup("step"));
+    // The right-hand sides.
+    for (auto i = dc.size() - n_eq; i < dc.size(); ++i) {
+        if (auto p_var = std::get_if<variable>(&dc[i].first.value())) {
+            taylor_dc_u_index(*p_var, i);
+        } else if (std::get_if<number>(&dc[i].first.value()) == nullptr
+                   && std::get_if<param>(&dc[i].first.value()) == nullptr) {
+            throw std::invalid_argument("Invalid Taylor decomposition: the right-hand side at index "
+                                        + std::to_string(i) + " must be a u variable, a number or a param");
+        }
 
-    // Setup the vector for the Taylor coefficients.
-    // LCOV_EXCL_START
-    if (m_order == std::numeric_limits<std::uint32_t>::max()
-        || m_state.size() > std::numeric_limits<decltype(m_tc.size())>::max() / (m_order + 1u)) {
-        throw std::overflow_error("Overflow detected in the initialisation of an adaptive Taylor integrator: the order "
-                                  "or the state size is too large");
+        if (!dc[i].second.empty()) {
+            throw std::invalid_argument("Invalid Taylor decomposition: the right-hand sides cannot have hidden "
+                                        "dependencies");
+        }
     }
-    // LCOV_EXCL_STOP
 
-    m_tc.resize(m_state.size() * (m_order + 1u));
+    return boost::numeric_cast<std::uint32_t>(n_eq);
 }
 
-template <typename T>
-taylor_adaptive_impl<T>::taylor_adaptive_impl(const taylor_adaptive_impl &other)
-    // NOTE: make a manual copy of all members, apart from the function pointer.
-    : m_state(other.m_state), m_time(other.m_time), m_llvm(other.m_llvm), m_dim(other.m_dim), m_dc(other.m_dc),
-      m_order(other.m_order), m_pars(other.m_pars), m_tc(other.m_tc)
+// Number of equations in a system of equations
+// or in a (precomputed) Taylor decomposition.
+template <typename U>
+std::uint32_t taylor_n_eq(const U &sys)
 {
-    m_step_f = reinterpret_cast<step_f_t>(m_llvm.jit_lookup("step"));
+    if constexpr (std::is_same_v<U, taylor_dc_t>) {
+        return taylor_check_dc(sys);
+    } else {
+        return boost::numeric_cast<std::uint32_t>(sys.size());
+    }
 }
 
-template <typename T>
-taylor_adaptive_impl<T>::taylor_adaptive_impl(taylor_adaptive_impl &&) noexcept = default;
+// RAII helper to temporarily set the opt level to 0 in an llvm_state.
+struct opt_disabler {
+    llvm_state &m_s;
+    unsigned m_orig_opt_level;
+
+    explicit opt_disabler(llvm_state &s) : m_s(s), m_orig_opt_level(s.opt_level())
+    {
+        // Disable optimisations.
+        m_s.opt_level() = 0;
+    }
+    ~opt_disabler()
+    {
+        // Restore the original optimisation level.
+        m_s.opt_level() = m_orig_opt_level;
+    }
+};
 
+// Add to s a function for the computation of the dense output
+// in an adaptive Taylor integrator. The function takes as input:
+// - a pointer to the output state vector (write only),
+// - a pointer to the Taylor coefficients, in the format
+//   produced by the adaptive stepper (read only),
+// - a pointer to the time coordinate(s) at which the dense output
+//   will be computed, measured from the beginning of the timestep (read only).
+// These pointers cannot overlap. The Taylor polynomials are evaluated
+// via the Horner scheme.
 template <typename T>
-taylor_adaptive_impl<T> &taylor_adaptive_impl<T>::operator=(const taylor_adaptive_impl &other)
+void taylor_add_d_out_function(llvm_state &s, std::uint32_t n_eq, std::uint32_t order, std::uint32_t batch_size,
+                               bool compact_mode, const std::string &name = "d_out_f")
 {
-    if (this != &other) {
-        *this = taylor_adaptive_impl(other);
+    assert(n_eq > 0u);
+    assert(order > 0u);
+    assert(batch_size > 0u);
+
+    time_accumulator ta_ir(s.stats().ir_gen_time);
+
+    // Make sure we can index into the Taylor coefficients
+    // using 32-bit unsigned integers.
+    if (order == std::numeric_limits<std::uint32_t>::max()
+        || (order + 1u) > std::numeric_limits<std::uint32_t>::max() / batch_size
+        || n_eq > std::numeric_limits<std::uint32_t>::max() / ((order + 1u) * batch_size)) {
+        throw std::overflow_error(
+            "An overflow condition was detected in the creation of the dense output function of an adaptive "
+            "Taylor integrator");
     }
 
-    return *this;
-}
+    auto &builder = s.builder();
 
-template <typename T>
-taylor_adaptive_impl<T> &taylor_adaptive_impl<T>::operator=(taylor_adaptive_impl &&) noexcept = default;
+    // Prepare the function prototype.
+    std::vector<llvm::Type *> fargs(3, llvm::PointerType::getUnqual(to_llvm_type<T>(s.context())));
+    // The function does not return anything.
+    auto *ft = llvm::FunctionType::get(builder.getVoidTy(), fargs, false);
+    assert(ft != nullptr);
+    // Now create the function.
+    auto *f = llvm::Function::Create(ft, llvm::Function::ExternalLinkage, name, &s.module());
+    // LCOV_EXCL_START
+    if (f == nullptr) {
+        throw std::invalid_argument("Unable to create the dense output function of an adaptive Taylor integrator");
+    }
+    // LCOV_EXCL_STOP
 
-template <typename T>
-taylor_adaptive_impl<T>::~taylor_adaptive_impl() = default;
+    // Set the names/attributes of the function arguments.
+    auto out_ptr = f->args().begin();
+    out_ptr->setName("out_ptr");
+    out_ptr->addAttr(llvm::Attribute::NoCapture);
+    out_ptr->addAttr(llvm::Attribute::NoAlias);
+    out_ptr->addAttr(llvm::Attribute::WriteOnly);
 
-// Implementation detail to make a single integration timestep.
-// The magnitude of the timestep is automatically deduced, but it will
-// always be not greater than abs(max_delta_t). The propagation
-// is done forward in time if max_delta_t >= 0, backwards in
-// time otherwise.
-//
-// The function will return a pair, containing
-// a flag describing the outcome of the integration,
-// and the integration timestep that was used.
-template <typename T>
-std::tuple<taylor_outcome, T> taylor_adaptive_impl<T>::step_impl(T max_delta_t, bool wtc)
-{
-    using std::isfinite;
+    auto tc_ptr = out_ptr + 1;
+    tc_ptr->setName("tc_ptr");
+    tc_ptr->addAttr(llvm::Attribute::NoCapture);
+    tc_ptr->addAttr(llvm::Attribute::NoAlias);
+    tc_ptr->addAttr(llvm::Attribute::ReadOnly);
 
-#if !defined(NDEBUG)
-    // NOTE: this is the only precondition on max_delta_t.
-    using std::isnan;
-    assert(!isnan(max_delta_t));
-#endif
+    auto h_ptr = tc_ptr + 1;
+    h_ptr->setName("h_ptr");
+    h_ptr->addAttr(llvm::Attribute::NoCapture);
+    h_ptr->addAttr(llvm::Attribute::NoAlias);
+    h_ptr->addAttr(llvm::Attribute::ReadOnly);
 
-    // Invoke the stepper.
-    auto h = max_delta_t;
-    m_step_f(m_state.data(), m_pars.data(), &m_time, &h, wtc ? m_tc.data() : nullptr);
+    // Create a new basic block to start insertion into.
+    auto *bb = llvm::BasicBlock::Create(s.context(), "entry", f);
+    assert(bb != nullptr);
+    builder.SetInsertPoint(bb);
 
-    // Update the time.
-    m_time += h;
+    // Load the time coordinate(s).
+    auto h = load_vector_from_memory(builder, h_ptr, batch_size);
 
-    // Check if the time or the state vector are non-finite at the
-    // end of the timestep.
-    if (!isfinite(m_time)
-        || std::any_of(m_state.cbegin(), m_state.cend(), [](const auto &x) { return !isfinite(x); })) {
-        return std::tuple{taylor_outcome::err_nf_state, h};
+    // NOTE: the Taylor coefficients of the state variable j
+    // at order o begin at index (order + 1) * batch_size * j + o * batch_size.
+    if (compact_mode) {
+        // Create the storage for the accumulator.
+        auto acc = builder.CreateAlloca(to_llvm_vector_type<T>(s.context(), batch_size));
+
+        llvm_loop_u32(s, builder.getInt32(0), builder.getInt32(n_eq), [&](llvm::Value *cur_var_idx) {
+            // Index of the first coefficient of the current polynomial.
+            auto tc_idx = builder.CreateMul(builder.getInt32((order + 1u) * batch_size), cur_var_idx);
+
+            // Init the accumulator with the coefficient of the highest-degree monomial.
+            auto hd_ptr
+                = builder.CreateInBoundsGEP(tc_ptr, {builder.CreateAdd(tc_idx, builder.getInt32(order * batch_size))});
+            builder.CreateStore(load_vector_from_memory(builder, hd_ptr, batch_size), acc);
+
+            // Run the Horner scheme.
+            llvm_loop_u32(
+                s, builder.getInt32(1), builder.CreateAdd(builder.getInt32(order), builder.getInt32(1)),
+                [&](llvm::Value *cur_order) {
+                    // NOTE: we are loading the coefficients backwards wrt the order, hence
+                    // we specify order - cur_order.
+                    auto cf_idx = builder.CreateMul(builder.CreateSub(builder.getInt32(order), cur_order),
+                                                    builder.getInt32(batch_size));
+                    auto cf_ptr = builder.CreateInBoundsGEP(tc_ptr, {builder.CreateAdd(tc_idx, cf_idx)});
+                    auto cf = load_vector_from_memory(builder, cf_ptr, batch_size);
+
+                    builder.CreateStore(builder.CreateFAdd(cf, builder.CreateFMul(builder.CreateLoad(acc), h)), acc);
+                });
+
+            // Write the result.
+            store_vector_to_memory(
+                builder,
+                builder.CreateInBoundsGEP(out_ptr, {builder.CreateMul(cur_var_idx, builder.getInt32(batch_size))}),
+                builder.CreateLoad(acc));
+        });
+    } else {
+        for (std::uint32_t j = 0; j < n_eq; ++j) {
+            // Index of the first coefficient of the current polynomial.
+            const auto tc_idx = (order + 1u) * batch_size * j;
+
+            // Init the accumulator with the coefficient of the highest-degree monomial.
+            auto acc = load_vector_from_memory(
+                builder, builder.CreateInBoundsGEP(tc_ptr, {builder.getInt32(tc_idx + order * batch_size)}),
+                batch_size);
+
+            // Run the Horner scheme.
+            for (std::uint32_t i = 1; i <= order; ++i) {
+                auto cf_ptr = builder.CreateInBoundsGEP(tc_ptr, {builder.getInt32(tc_idx + (order - i) * batch_size)});
+                acc = builder.CreateFAdd(load_vector_from_memory(builder, cf_ptr, batch_size),
+                                         builder.CreateFMul(acc, h));
+            }
+
+            // Write the result.
+            store_vector_to_memory(builder, builder.CreateInBoundsGEP(out_ptr, {builder.getInt32(j * batch_size)}),
+                                   acc);
+        }
     }
 
-    return std::tuple{h == max_delta_t ? taylor_outcome::time_limit : taylor_outcome::success, h};
+    // Create the return value.
+    builder.CreateRetVoid();
+
+    // Verify the function.
+    s.verify_function(f);
 }
 
+// NOTE: forward declaration, the definition is below.
+template <typename T, typename U>
+std::tuple<std::vector<std::pair<expression, std::vector<std::uint32_t>>>, std::uint32_t>
+taylor_add_adaptive_step_impl(llvm_state &, const std::string &, U, T, std::uint32_t, bool, bool,
+                              std::vector<expression>, taylor_sort_strategy = taylor_sort_strategy::bfs,
+                              bool = false, std::uint32_t = 0, taylor_jet_layout = taylor_jet_layout::order_major,
+                              T = 0, T = 0, std::vector<T> = {}, std::uint32_t = 0, bool = false, bool = false,
+                              bool = false, bool = false);
+
+// NOTE: forward declaration, the definition is below.
 template <typename T>
-std::tuple<taylor_outcome, T> taylor_adaptive_impl<T>::step(bool wtc)
-{
-    // NOTE: time limit +inf means integration forward in time
-    // and no time limit.
-    return step_impl(std::numeric_limits<T>::infinity(), wtc);
-}
+void taylor_add_propagate_kernel(llvm_state &, const std::string &, const std::string &, bool, bool);
 
+// Add the timestep h to the time coordinate (hi, lo). If comp is true, (hi, lo)
+// is a double-length representation of the time coordinate, and the sum
+// is computed in double-length arithmetic (as in llvm_dl_add()). Otherwise,
+// lo is unused and h is simply added to hi.
 template <typename T>
-std::tuple<taylor_outcome, T> taylor_adaptive_impl<T>::step_backward(bool wtc)
+void taylor_time_add(T &hi, T &lo, const T &h, bool comp)
 {
-    return step_impl(-std::numeric_limits<T>::infinity(), wtc);
+    if (!comp) {
+        hi += h;
+        return;
+    }
+
+    // Error-free transformation of hi + h (two-sum).
+    const auto s = hi + h;
+    const auto bp = s - hi;
+    auto e = (hi - (s - bp)) + (h - bp);
+
+    // Add the low-order part and renormalise (quick two-sum).
+    e += lo;
+    hi = s + e;
+    lo = e - (hi - s);
 }
 
+// The logarithm of the scaling + safety factor of the step size of a stepper
+// with tolerance tol and explicitly-specified order (rather than deduced from tol).
+// NOTE: this is the generalisation of the factor exp(-0.7 / (order - 1)) / e**2
+// used when the order is deduced from the tolerance, for which tol**(1 / (order - 1))
+// is approximately 1 / e**2 (see Jorba and Zou, 2005).
 template <typename T>
-std::tuple<taylor_outcome, T> taylor_adaptive_impl<T>::step(T max_delta_t, bool wtc)
+T taylor_vo_log_rhofac(T tol, std::uint32_t order)
 {
-    using std::isnan;
+    using std::log;
 
-    if (isnan(max_delta_t)) {
-        throw std::invalid_argument(
-            "A NaN max_delta_t was passed to the step() function of an adaptive Taylor integrator");
-    }
+    assert(order >= 2u);
 
-    return step_impl(max_delta_t, wtc);
+    return (log(tol) - T(7) / T(10)) / (order - 1u);
 }
 
+// Check if the direction of a zero crossing matches the
+// direction of an event. der is the derivative of the
+// event equation with respect to time at the zero crossing.
 template <typename T>
-std::tuple<taylor_outcome, T, T, std::size_t> taylor_adaptive_impl<T>::propagate_for(T delta_t, std::size_t max_steps)
+bool taylor_ev_dir_match(event_direction dir, T der)
 {
-    return propagate_until(m_time + delta_t, max_steps);
+    switch (dir) {
+        case event_direction::positive:
+            return der > 0;
+        case event_direction::negative:
+            return der < 0;
+        default:
+            return true;
+    }
 }
 
-template <typename T>
-std::tuple<taylor_outcome, T, T, std::size_t> taylor_adaptive_impl<T>::propagate_until(T t, std::size_t max_steps)
+// Wrap the Taylor decomposition dc into the immutable, shared
+// representation stored in the integrators (null if dc is empty).
+std::shared_ptr<const taylor_dc_t> taylor_share_dc(taylor_dc_t &&dc)
 {
-    using std::isfinite;
-
-    // Check the current time.
-    if (!isfinite(m_time)) {
-        throw std::invalid_argument("Cannot invoke the propagate_until() function of an adaptive Taylor integrator if "
-                                    "the current time is not finite");
+    if (dc.empty()) {
+        return {};
     }
 
-    // Check the final time.
-    if (!isfinite(t)) {
-        throw std::invalid_argument(
-            "A non-finite time was passed to the propagate_until() function of an adaptive Taylor integrator");
-    }
+    return std::make_shared<const taylor_dc_t>(std::move(dc));
+}
 
-    // Initial values for the counters,
-    // the min/max abs of the integration
-    // timesteps, and min/max Taylor orders.
-    // NOTE: iter_counter is for keeping track of the max_steps
-    // limits, step_counter counts the number of timesteps performed
-    // with a non-zero h. Most of the time these two quantities
-    // will be identical, apart from corner cases.
-    std::size_t iter_counter = 0, step_counter = 0;
-    T min_h = std::numeric_limits<T>::infinity(), max_h(0);
+// Collect the objects whose addresses are embedded in the compiled
+// code of the decomposition dc (i.e., the trajectories of the ephem
+// functions). They are stored in the integrators, so that they are
+// kept alive after drop_decomposition().
+std::vector<std::shared_ptr<const void>> taylor_dc_keep_alive(const std::shared_ptr<const taylor_dc_t> &dc)
+{
+    std::vector<std::shared_ptr<const void>> retval;
 
-    while (true) {
-        // NOTE: t - m_time is guaranteed not to be nan: t is never non-finite,
-        // and at the first iteration we have checked above the value of m_time.
-        // At successive iterations, we know that m_time must be finite because
-        // otherwise we would have exited the loop when checking res.
-        const auto [res, h] = step_impl(t - m_time, false);
+    if (!dc) {
+        return retval;
+    }
 
-        if (res != taylor_outcome::success && res != taylor_outcome::time_limit) {
-            // Something went wrong in the propagation of the timestep, exit.
-            return std::tuple{res, min_h, max_h, step_counter};
+    for (const auto &[ex, _] : *dc) {
+        if (const auto *fptr = std::get_if<func>(&ex.value());
+            fptr != nullptr && fptr->get_type_index() == typeid(ephem_impl)) {
+            std::visit([&retval](const auto &traj) { retval.emplace_back(traj); },
+                       static_cast<const ephem_impl *>(fptr->get_ptr())->get_traj());
         }
+    }
 
-        // Update the number of iterations.
-        ++iter_counter;
+    return retval;
+}
 
-        // Update the number of steps.
-        step_counter += static_cast<std::size_t>(h != 0);
+// Fetch the Taylor decomposition from its shared representation.
+const taylor_dc_t &taylor_dc_or_empty(const std::shared_ptr<const taylor_dc_t> &dc)
+{
+    static const taylor_dc_t empty;
 
-        // Break out if the time limit is reached,
-        // *before* updating the min_h/max_h values.
-        if (res == taylor_outcome::time_limit) {
-            return std::tuple{taylor_outcome::time_limit, min_h, max_h, step_counter};
-        }
+    return dc ? *dc : empty;
+}
 
-        // Update min_h/max_h.
-        using std::abs;
-        const auto abs_h = abs(h);
-        min_h = std::min(min_h, abs_h);
-        max_h = std::max(max_h, abs_h);
+} // namespace
 
-        // Check the iteration limit.
-        if (max_steps != 0u && iter_counter == max_steps) {
-            return std::tuple{taylor_outcome::step_limit, min_h, max_h, step_counter};
-        }
+template <typename T>
+void nt_event_impl<T>::finalise_ctor(event_direction d)
+{
+    if (!callback) {
+        throw std::invalid_argument("Cannot construct a non-terminal event with an empty callback");
     }
+
+    if (d < event_direction::negative || d > event_direction::positive) {
+        throw std::invalid_argument("Invalid value selected for the direction of a non-terminal event");
+    }
+    dir = d;
 }
 
 template <typename T>
-const llvm_state &taylor_adaptive_impl<T>::get_llvm_state() const
-{
-    return m_llvm;
-}
+nt_event_impl<T>::nt_event_impl(const nt_event_impl &) = default;
 
 template <typename T>
-const std::vector<std::pair<expression, std::vector<std::uint32_t>>> &taylor_adaptive_impl<T>::get_decomposition() const
+nt_event_impl<T>::nt_event_impl(nt_event_impl &&) = default;
+
+template <typename T>
+nt_event_impl<T> &nt_event_impl<T>::operator=(const nt_event_impl<T> &) = default;
+
+template <typename T>
+nt_event_impl<T> &nt_event_impl<T>::operator=(nt_event_impl<T> &&) = default;
+
+template <typename T>
+nt_event_impl<T>::~nt_event_impl() = default;
+
+template <typename T>
+const expression &nt_event_impl<T>::get_expression() const
 {
-    return m_dc;
+    return eq;
 }
 
 template <typename T>
-std::uint32_t taylor_adaptive_impl<T>::get_order() const
+const typename nt_event_impl<T>::callback_t &nt_event_impl<T>::get_callback() const
 {
-    return m_order;
+    return callback;
 }
 
 template <typename T>
-std::uint32_t taylor_adaptive_impl<T>::get_dim() const
+event_direction nt_event_impl<T>::get_direction() const
 {
-    return m_dim;
+    return dir;
 }
 
-// Explicit instantiation of the implementation classes/functions.
-// NOTE: on Windows apparently it is necessary to declare that
-// these instantiations are meant to be dll-exported.
-template class taylor_adaptive_impl<double>;
-template HEYOKA_DLL_PUBLIC void taylor_adaptive_impl<double>::finalise_ctor_impl(std::vector<expression>,
-                                                                                 std::vector<double>, double, double,
-                                                                                 bool, bool, std::vector<double>);
-template HEYOKA_DLL_PUBLIC void
-taylor_adaptive_impl<double>::finalise_ctor_impl(std::vector<std::pair<expression, expression>>, std::vector<double>,
-                                                 double, double, bool, bool, std::vector<double>);
+template <typename T>
+void t_event_impl<T>::finalise_ctor(callback_t cb, T cd, event_direction d)
+{
+    using std::isfinite;
 
-template class taylor_adaptive_impl<long double>;
-template HEYOKA_DLL_PUBLIC void taylor_adaptive_impl<long double>::finalise_ctor_impl(std::vector<expression>,
-                                                                                      std::vector<long double>,
-                                                                                      long double, long double, bool,
-                                                                                      bool, std::vector<long double>);
-template HEYOKA_DLL_PUBLIC void
-taylor_adaptive_impl<long double>::finalise_ctor_impl(std::vector<std::pair<expression, expression>>,
-                                                      std::vector<long double>, long double, long double, bool, bool,
-                                                      std::vector<long double>);
+    callback = std::move(cb);
 
-#if defined(HEYOKA_HAVE_REAL128)
+    if (!isfinite(cd)) {
+        throw std::invalid_argument("Cannot set a non-finite cooldown value for a terminal event");
+    }
+    cooldown = cd;
 
-template class taylor_adaptive_impl<mppp::real128>;
-template HEYOKA_DLL_PUBLIC void taylor_adaptive_impl<mppp::real128>::finalise_ctor_impl(std::vector<expression>,
-                                                                                        std::vector<mppp::real128>,
-                                                                                        mppp::real128, mppp::real128,
-                                                                                        bool, bool,
-                                                                                        std::vector<mppp::real128>);
-template HEYOKA_DLL_PUBLIC void
-taylor_adaptive_impl<mppp::real128>::finalise_ctor_impl(std::vector<std::pair<expression, expression>>,
-                                                        std::vector<mppp::real128>, mppp::real128, mppp::real128, bool,
-                                                        bool, std::vector<mppp::real128>);
+    if (d < event_direction::negative || d > event_direction::positive) {
+        throw std::invalid_argument("Invalid value selected for the direction of a terminal event");
+    }
+    dir = d;
+}
 
-#endif
+template <typename T>
+t_event_impl<T>::t_event_impl(const t_event_impl &) = default;
 
-} // namespace detail
+template <typename T>
+t_event_impl<T>::t_event_impl(t_event_impl &&) = default;
 
-namespace detail
+template <typename T>
+t_event_impl<T> &t_event_impl<T>::operator=(const t_event_impl<T> &) = default;
+
+template <typename T>
+t_event_impl<T> &t_event_impl<T>::operator=(t_event_impl<T> &&) = default;
+
+template <typename T>
+t_event_impl<T>::~t_event_impl() = default;
+
+template <typename T>
+const expression &t_event_impl<T>::get_expression() const
+{
+    return eq;
+}
+
+template <typename T>
+const typename t_event_impl<T>::callback_t &t_event_impl<T>::get_callback() const
+{
+    return callback;
+}
+
+template <typename T>
+event_direction t_event_impl<T>::get_direction() const
 {
+    return dir;
+}
+
+template <typename T>
+T t_event_impl<T>::get_cooldown() const
+{
+    return cooldown;
+}
+
+// Explicit instantiation of the event classes.
+template class nt_event_impl<double>;
+template class nt_event_impl<long double>;
+template class t_event_impl<double>;
+template class t_event_impl<long double>;
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+template class nt_event_impl<mppp::real128>;
+template class t_event_impl<mppp::real128>;
+
+#endif
 
 template <typename T>
 template <typename U>
-void taylor_adaptive_batch_impl<T>::finalise_ctor_impl(U sys, std::vector<T> state, std::uint32_t batch_size,
-                                                       std::vector<T> time, T tol, bool high_accuracy,
-                                                       bool compact_mode, std::vector<T> pars)
+void taylor_adaptive_impl<T>::finalise_ctor_impl(U sys, std::vector<T> state, T time, T tol, bool high_accuracy,
+                                                 bool compact_mode, std::vector<T> pars, std::vector<t_event_t> tes,
+                                                 std::vector<nt_event_t> ntes, std::vector<std::string> isa_variants,
+                                                 std::size_t pgo_steps, taylor_sort_strategy sort_strategy,
+                                                 bool parallel_mode, std::uint32_t unroll_threshold,
+                                                 taylor_jet_layout jet_layout, T rtol, T atol,
+                                                 std::vector<T> err_weights, std::vector<std::uint32_t> orders,
+                                                 bool compensated_time, bool predict_h, bool simd_segments,
+                                                 bool estrin, std::uint32_t order, bool mem_hints)
 {
+    using std::abs;
+    using std::ceil;
     using std::isfinite;
+    using std::log;
+    using std::min;
 
-    // Init the data members.
-    m_batch_size = batch_size;
+    // Assign the data members.
     m_state = std::move(state);
-    m_time = std::move(time);
+    m_time = time;
+    m_time_lo = 0;
     m_pars = std::move(pars);
+    m_tes = std::move(tes);
+    m_ntes = std::move(ntes);
+    m_compact_mode = compact_mode;
+    m_comp_time = compensated_time;
+    m_predict_h = predict_h;
+    m_pred_h = 0;
+    m_pgo_steps = pgo_steps;
 
     // Check input params.
-    if (m_batch_size == 0u) {
-        throw std::invalid_argument("The batch size in an adaptive Taylor integrator cannot be zero");
-    }
-
     if (std::any_of(m_state.begin(), m_state.end(), [](const auto &x) { return !isfinite(x); })) {
         throw std::invalid_argument(
             "A non-finite value was detected in the initial state of an adaptive Taylor integrator");
     }
 
-    if (m_state.size() % m_batch_size != 0u) {
-        throw std::invalid_argument("Invalid size detected in the initialization of an adaptive Taylor "
-                                    "integrator: the state vector has a size of "
-                                    + std::to_string(m_state.size()) + ", which is not a multiple of the batch size ("
-                                    + std::to_string(m_batch_size) + ")");
-    }
+    // NOTE: this also validates a precomputed Taylor decomposition.
+    const auto n_eq = taylor_n_eq(sys);
 
-    if (m_state.size() / m_batch_size != sys.size()) {
+    if (m_state.size() != n_eq) {
         throw std::invalid_argument("Inconsistent sizes detected in the initialization of an adaptive Taylor "
                                     "integrator: the state vector has a dimension of "
-                                    + std::to_string(m_state.size() / m_batch_size)
-                                    + ", while the number of equations is " + std::to_string(sys.size()));
-    }
-
-    if (m_time.size() != m_batch_size) {
-        throw std::invalid_argument("Invalid size detected in the initialization of an adaptive Taylor "
-                                    "integrator: the time vector has a size of "
-                                    + std::to_string(m_time.size()) + ", which is not equal to the batch size ("
-                                    + std::to_string(m_batch_size) + ")");
+                                    + std::to_string(m_state.size()) + ", while the number of equations is "
+                                    + std::to_string(n_eq));
     }
 
-    if (std::any_of(m_time.begin(), m_time.end(), [](const auto &x) { return !isfinite(x); })) {
-        throw std::invalid_argument(
-            "A non-finite initial time was detected in the initialisation of an adaptive Taylor integrator");
+    if (!isfinite(m_time)) {
+        throw std::invalid_argument("Cannot initialise an adaptive Taylor integrator with a non-finite initial time of "
+                                    + detail::li_to_string(m_time));
     }
 
     if (!isfinite(tol) || tol <= 0) {
@@ -1243,338 +2079,3607 @@ void taylor_adaptive_batch_impl<T>::finalise_ctor_impl(U sys, std::vector<T> sta
 
     // Fix m_pars' size, if necessary.
     const auto npars = n_pars_in_sys(sys);
-    if (npars > std::numeric_limits<std::uint32_t>::max() / m_batch_size) {
-        throw std::overflow_error(
-            "Overflow detected when computing the size of the parameter array in an adaptive Taylor integrator");
-    }
-    if (m_pars.size() < npars * m_batch_size) {
-        m_pars.resize(boost::numeric_cast<decltype(m_pars.size())>(npars * m_batch_size));
-    } else if (m_pars.size() > npars * m_batch_size) {
+    if constexpr (std::is_same_v<U, taylor_dc_t>) {
+        // NOTE: the decomposition of an integrator may contain the params
+        // replacing the param-only subexpressions of the system (whose values
+        // are computed by the stepper), hence we cannot zero-fill here.
+        if (m_pars.size() != npars) {
+            using namespace fmt::literals;
+
+            throw std::invalid_argument(
+                "Invalid number of parameter values passed to the constructor of an adaptive Taylor integrator from "
+                "a precomputed decomposition: {} parameter values were passed, but the decomposition contains {} "
+                "parameters"_format(m_pars.size(), npars));
+        }
+    } else if (m_pars.size() < npars) {
+        m_pars.resize(boost::numeric_cast<decltype(m_pars.size())>(npars));
+    } else if (m_pars.size() > npars) {
         using namespace fmt::literals;
 
         throw std::invalid_argument(
             "Excessive number of parameter values passed to the constructor of an adaptive "
-            "Taylor integrator: {} parameter values were passed, but the ODE system contains only {} parameters "
-            "(in batches of {})"_format(m_pars.size(), npars, m_batch_size));
+            "Taylor integrator: {} parameter values were passed, but the ODE system contains only {} parameters"_format(
+                m_pars.size(), npars));
     }
 
     // Store the dimension of the system.
-    m_dim = boost::numeric_cast<std::uint32_t>(sys.size());
+    m_dim = n_eq;
 
-    // Add the stepper function.
-    std::tie(m_dc, m_order)
-        = taylor_add_adaptive_step<T>(m_llvm, "step", std::move(sys), tol, m_batch_size, high_accuracy, compact_mode);
+    // Assemble the event equations: the terminal events
+    // first, then the non-terminal ones.
+    std::vector<expression> ev_eqs;
+    for (const auto &ev : m_tes) {
+        ev_eqs.push_back(ev.get_expression());
+    }
+    for (const auto &ev : m_ntes) {
+        ev_eqs.push_back(ev.get_expression());
+    }
+    const auto n_ev = ev_eqs.size();
 
-    // Run the jit.
-    m_llvm.compile();
+    // Check the order override (zero means the order deduced from the tolerance).
+    if (order == 1u) {
+        throw std::invalid_argument("The order of an adaptive Taylor integrator must be at least 2");
+    }
 
-    // Fetch the stepper.
-    m_step_f = reinterpret_cast<step_f_t>(m_llvm.jit_lookup("step"));
+    if (order != 0u && !orders.empty()) {
+        throw std::invalid_argument(
+            "The order of an adaptive Taylor integrator cannot be specified in the variable-order integration");
+    }
+
+    // Check the orders of the variable-order integration.
+    if (!orders.empty()) {
+        if (std::any_of(orders.begin(), orders.end(), [](auto o) { return o < 2u; })) {
+            throw std::invalid_argument(
+                "The orders of a variable-order adaptive Taylor integrator must be at least 2");
+        }
+
+        if (std::adjacent_find(orders.begin(), orders.end(), [](auto a, auto b) { return a >= b; })
+            != orders.end()) {
+            throw std::invalid_argument(
+                "The orders of a variable-order adaptive Taylor integrator must be in strictly increasing order");
+        }
+
+        if (!isa_variants.empty()) {
+            throw std::invalid_argument(
+                "The ISA variants are not supported by the variable-order adaptive Taylor integrator");
+        }
+
+        if (predict_h) {
+            throw std::invalid_argument(
+                "The step size prediction is not supported by the variable-order adaptive Taylor integrator");
+        }
+    }
+
+    if (m_deferred && (!isa_variants.empty() || m_pgo_steps > 0u)) {
+        throw std::invalid_argument("The ISA variants and the profile-guided optimisation are not supported in the "
+                                    "construction of an adaptive Taylor integrator via taylor_multi_builder");
+    }
+
+    // Add the ISA variants of the integrator, if requested.
+    // NOTE: the code is generated anew for each variant, as some
+    // of the choices made during codegen (e.g., the vector math functions)
+    // depend on the target CPU.
+    for (const auto &cpu : isa_variants) {
+        auto vs = m_llvm.make_variant(cpu);
+
+        {
+            opt_disabler od(vs);
+
+            const auto v_order = std::get<1>(
+                taylor_add_adaptive_step_impl<T>(vs, "step", sys, tol, 1, high_accuracy, compact_mode, ev_eqs,
+                                                 sort_strategy, parallel_mode, unroll_threshold, jet_layout, rtol,
+                                                 atol, err_weights, order, predict_h, simd_segments, estrin,
+                                                 mem_hints));
+            taylor_add_d_out_function<T>(vs, m_dim, v_order, 1, compact_mode);
+            taylor_add_propagate_kernel<T>(vs, "prop_f", "step", compensated_time, predict_h);
+        }
+
+        vs.optimise();
+        vs.compile();
+
+        m_llvm.add_variant(vs);
+    }
+
+    // Instrument the stepper for the profile-guided
+    // optimisation, if requested.
+    if (m_pgo_steps > 0u) {
+        m_llvm.pgo_instrument();
+    }
+
+    {
+        // NOTE: disable the optimisations while the stepper is being added,
+        // the optimisation pass will be run below on the whole module.
+        opt_disabler od(m_llvm);
+
+        if (orders.empty()) {
+            // Add the stepper function.
+            // NOTE: the Taylor coefficients of the event equations
+            // will be computed and stored by the stepper alongside
+            // the Taylor coefficients of the state variables.
+            auto [dc, s_order]
+                = taylor_add_adaptive_step_impl<T>(m_llvm, "step", std::move(sys), tol, 1, high_accuracy,
+                                                   compact_mode, std::move(ev_eqs), sort_strategy, parallel_mode,
+                                                   unroll_threshold, jet_layout, rtol, atol, std::move(err_weights),
+                                                   order, predict_h, simd_segments, estrin, mem_hints);
+            m_dc = taylor_share_dc(std::move(dc));
+            m_keep_alive = taylor_dc_keep_alive(m_dc);
+            m_order = s_order;
+
+            // Add the function for the computation of
+            // the dense output.
+            taylor_add_d_out_function<T>(m_llvm, m_dim, m_order, 1, compact_mode);
+
+            // Add the propagate kernel, which runs the loop of
+            // propagate_until() within the compiled code.
+            // NOTE: the kernel is not available in the variable-order integration.
+            taylor_add_propagate_kernel<T>(m_llvm, "prop_f", "step", compensated_time, predict_h);
+        } else {
+            // Variable-order integration: add a stepper (and a dense output function)
+            // for each order. In compact mode, the functions for the computation of the
+            // derivatives are shared among the steppers, as they do not depend on the order.
+            for (const auto o : orders) {
+                const auto name = "step_" + std::to_string(o);
+
+                auto [dc, s_order] = taylor_add_adaptive_step_impl<T>(
+                    m_llvm, name, sys, tol, 1, high_accuracy, compact_mode, ev_eqs, sort_strategy, parallel_mode,
+                    unroll_threshold, jet_layout, rtol, atol, err_weights, o, false, simd_segments, estrin, mem_hints);
+                assert(s_order == o);
+
+                taylor_add_d_out_function<T>(m_llvm, m_dim, o, 1, compact_mode, "d_out_f_" + std::to_string(o));
+
+                if (!m_dc) {
+                    m_dc = taylor_share_dc(std::move(dc));
+                    m_keep_alive = taylor_dc_keep_alive(m_dc);
+                }
+            }
+        }
+    }
+
+    if (!orders.empty()) {
+        // NOTE: the tolerance determining the order and
+        // the step sizes, as computed by the steppers.
+        const auto vo_tol = (rtol != 0 || atol != 0 || !err_weights.empty()) ? (rtol == 0 ? atol : min(atol, rtol))
+                                                                               : tol;
+
+        m_vo_log_rhofac.clear();
+        for (const auto o : orders) {
+            m_vo_log_rhofac.push_back(taylor_vo_log_rhofac(vo_tol, o));
+        }
+
+        // The first step is taken with the order closest
+        // to the order deduced from the tolerance.
+        const auto tol_order = std::max(T(2), ceil(-log(vo_tol) / 2 + 1));
+        m_vo_idx = 0;
+        for (std::uint32_t i = 1; i < orders.size(); ++i) {
+            if (abs(orders[i] - tol_order) < abs(orders[m_vo_idx] - tol_order)) {
+                m_vo_idx = i;
+            }
+        }
+        m_order = orders[m_vo_idx];
+    }
+
+    // Run the optimisation pass.
+    // NOTE: in the deferred compilation, the optimisation and the
+    // compilation are run on the module shared with other integrators
+    // by taylor_multi_builder::compile(), which then invokes finalise_deferred().
+    if (!m_deferred) {
+        m_llvm.optimise();
+    }
+
+    // NOTE: the dense output functions and the propagate kernel
+    // are compiled lazily, as they are not needed by many use cases.
+    if (orders.empty()) {
+        m_llvm.mark_lazy("d_out_f");
+        m_llvm.mark_lazy("prop_f");
+    } else {
+        for (const auto o : orders) {
+            m_llvm.mark_lazy("d_out_f_" + std::to_string(o));
+        }
+    }
+
+    m_vo_orders = std::move(orders);
+
+    if (!m_deferred) {
+        // Run the jit.
+        m_llvm.compile();
+
+        // Fetch the stepper(s).
+        fetch_step_f();
+    }
+
+    // Setup the vector for the Taylor coefficients.
+    // NOTE: if there are events, the Taylor coefficients
+    // of the event equations are stored after the Taylor
+    // coefficients of the state variables. In the variable-order
+    // integration, the vector is sized for the highest order.
+    const auto max_order = m_vo_orders.empty() ? m_order : m_vo_orders.back();
+    // LCOV_EXCL_START
+    if (max_order == std::numeric_limits<std::uint32_t>::max()
+        || n_ev > std::numeric_limits<decltype(m_tc.size())>::max() - m_state.size()
+        || m_state.size() + n_ev > std::numeric_limits<decltype(m_tc.size())>::max() / (max_order + 1u)) {
+        throw std::overflow_error("Overflow detected in the initialisation of an adaptive Taylor integrator: the order "
+                                  "or the state size is too large");
+    }
+    // LCOV_EXCL_STOP
+
+    m_tc.resize((m_state.size() + n_ev) * (max_order + 1u));
+
+    // Init the size of the last timestep.
+    m_last_h = 0;
+
+    // Setup the vector for the dense output.
+    m_d_out.resize(m_state.size());
+
+    // Init the cooldowns of the terminal events.
+    m_te_cooldowns.resize(m_tes.size());
+}
+
+// NOTE: the default constructor builds an integrator
+// for the trivial ODE x' = 0.
+template <typename T>
+taylor_adaptive_impl<T>::taylor_adaptive_impl()
+    : taylor_adaptive_impl(std::vector<std::pair<expression, expression>>{{"x"_var, 0_dbl}}, std::vector<T>{T(0)})
+{
+}
+
+// The monitor of the invariants of an integrator: the invariants are
+// compiled into a function of the state variables and of the parameters,
+// and the record is updated every m_every steps.
+template <typename T>
+struct taylor_invariants_impl {
+    compiled_function<T> m_cf;
+    std::size_t m_every;
+    // The number of steps since the last evaluation.
+    std::size_t m_counter = 0;
+    taylor_invariants<T> m_rec;
+    // The output buffer of m_cf.
+    std::vector<T> m_buf;
+
+    explicit taylor_invariants_impl(const std::vector<expression> &inv, std::vector<expression> vars,
+                                    std::size_t every)
+        : m_cf(inv, kw::vars = std::move(vars)), m_every(every), m_buf(inv.size())
+    {
+    }
+
+    // Evaluate the invariants and take their
+    // values as references.
+    void reset(const T *state, const T *pars)
+    {
+        m_cf(m_buf.data(), state, pars);
+
+        m_rec.ref = m_buf;
+        m_rec.times.clear();
+        m_rec.drifts.clear();
+        m_rec.max_drift.assign(m_buf.size(), T(0));
+        m_counter = 0;
+    }
+
+    // Update the record after a step
+    // ending at the time t.
+    void update(T t, const T *state, const T *pars)
+    {
+        using std::abs;
+
+        if (++m_counter < m_every) {
+            return;
+        }
+        m_counter = 0;
+
+        m_cf(m_buf.data(), state, pars);
+
+        m_rec.times.push_back(t);
+        for (decltype(m_buf.size()) i = 0; i < m_buf.size(); ++i) {
+            const auto d = m_buf[i] - m_rec.ref[i];
+
+            m_rec.drifts.push_back(d);
+            m_rec.max_drift[i] = std::max(m_rec.max_drift[i], abs(d));
+        }
+    }
+};
+
+template <typename T>
+void taylor_invariants_deleter<T>::operator()(taylor_invariants_impl<T> *p) const noexcept
+{
+    delete p;
+}
+
+// NOTE: the copy shares the compiled code with other, unless
+// compact mode is active. In compact mode, the stepper stores the derivatives
+// in a global array, and thus it cannot be invoked concurrently from multiple
+// threads. In this case, we make a deep copy of the LLVM state, so that the copy
+// can be used safely in parallel with the original integrator.
+template <typename T>
+taylor_adaptive_impl<T>::taylor_adaptive_impl(const taylor_adaptive_impl &other)
+    // NOTE: make a manual copy of all members, apart from the function pointers.
+    : m_state(other.m_state), m_time(other.m_time), m_time_lo(other.m_time_lo),
+      m_llvm(other.m_compact_mode ? other.m_llvm.deep_copy() : other.m_llvm), m_dim(other.m_dim), m_dc(other.m_dc),
+      m_keep_alive(other.m_keep_alive), m_order(other.m_order), m_pars(other.m_pars), m_tc(other.m_tc),
+      m_last_h(other.m_last_h), m_d_out(other.m_d_out), m_compact_mode(other.m_compact_mode),
+      m_comp_time(other.m_comp_time), m_predict_h(other.m_predict_h), m_pred_h(other.m_pred_h),
+      m_pgo_steps(other.m_pgo_steps), m_tes(other.m_tes),
+      m_ntes(other.m_ntes), m_te_cooldowns(other.m_te_cooldowns), m_stats(other.m_stats),
+      m_ckpts(other.m_ckpts),
+      m_inv(other.m_inv ? new taylor_invariants_impl<T>(*other.m_inv) : nullptr),
+      m_stiff_threshold(other.m_stiff_threshold), m_stiff_n_steps(other.m_stiff_n_steps),
+      m_stiff_count(other.m_stiff_count), m_stiff_ratio(other.m_stiff_ratio), m_vo_orders(other.m_vo_orders),
+      m_vo_log_rhofac(other.m_vo_log_rhofac), m_vo_idx(other.m_vo_idx)
+{
+    fetch_step_f();
+
+    // NOTE: the external buffers are not shared with the copy,
+    // which stores their current contents in its own buffers.
+    std::copy(other.get_state_data(), other.get_state_data() + m_state.size(), m_state.begin());
+    std::copy(other.get_pars_data(), other.get_pars_data() + m_pars.size(), m_pars.begin());
+
+    // NOTE: the profiling state is not copied.
+}
+
+template <typename T>
+taylor_adaptive_impl<T>::taylor_adaptive_impl(taylor_adaptive_impl &&) noexcept = default;
+
+template <typename T>
+taylor_adaptive_impl<T> &taylor_adaptive_impl<T>::operator=(const taylor_adaptive_impl &other)
+{
+    if (this != &other) {
+        *this = taylor_adaptive_impl(other);
+    }
+
+    return *this;
+}
+
+template <typename T>
+taylor_adaptive_impl<T> &taylor_adaptive_impl<T>::operator=(taylor_adaptive_impl &&) noexcept = default;
+
+template <typename T>
+taylor_adaptive_impl<T>::~taylor_adaptive_impl() = default;
+
+namespace
+{
+
+// Fetch the hardware performance counters pc, re-creating them if the
+// calling thread is not the thread which created them (as the counters
+// measure only the thread which opened them).
+perf_counter_group &taylor_fetch_perf_counters(std::unique_ptr<perf_counter_group> &pc)
+{
+    assert(pc);
+
+    if (pc->get_thread_id() != std::this_thread::get_id()) {
+        *pc = perf_counter_group(pc->get_raw_config());
+    }
+
+    return *pc;
+}
+
+// Record in st the outcome and the timestep h of a (lane) step.
+template <typename T>
+void taylor_stats_record_step(taylor_stats &st, taylor_outcome oc, const T &h)
+{
+    switch (oc) {
+        case taylor_outcome::time_limit:
+            ++st.n_time_limited;
+            break;
+        case taylor_outcome::terminal_event:
+            ++st.n_terminal_events;
+            break;
+        case taylor_outcome::err_nf_state:
+            ++st.n_errors;
+            break;
+        default:;
+    }
+
+    if (h == 0) {
+        ++st.n_zero_h;
+    } else {
+        // NOTE: the binary exponent is computed in double precision.
+        ++st.h_hist[std::ilogb(std::abs(static_cast<double>(h)))];
+    }
+}
+
+// Record in st the wall-clock time of an invocation of the stepper.
+void taylor_stats_record_time(taylor_stats &st, double t)
+{
+    ++st.n_steps;
+    st.step_time += t;
+    st.min_step_time = std::min(st.min_step_time, t);
+    st.max_step_time = std::max(st.max_step_time, t);
+}
+
+// Estimate of the memory used by the Taylor decomposition dc.
+// NOTE: each node with arguments is accounted for with the storage
+// of its arguments plus one expression (as a rough estimate of the
+// size of the node itself). The nodes shared among copies are
+// counted only once.
+std::size_t taylor_dc_memory_usage(const std::vector<std::pair<expression, std::vector<std::uint32_t>>> &dc)
+{
+    std::size_t retval = dc.capacity() * sizeof(std::pair<expression, std::vector<std::uint32_t>>);
+
+    std::unordered_map<const void *, char> memo;
+    for (const auto &[ex, deps] : dc) {
+        retval += deps.capacity() * sizeof(std::uint32_t);
+
+        fold_postorder<char>(
+            ex, [](const expression &) { return char(0); },
+            [&retval](const expression &n, const char *) {
+                const auto [b, e] = node_args(n);
+                retval += (static_cast<std::size_t>(e - b) + 1u) * sizeof(expression);
+
+                return char(0);
+            },
+            [](const expression &) { return true; }, memo);
+    }
+
+    return retval;
+}
+
+// The memory used by the buffers vs.
+template <typename... V>
+std::size_t taylor_buffers_memory_usage(const V &...vs)
+{
+    return ((vs.capacity() * sizeof(typename V::value_type)) + ... + std::size_t(0));
+}
+
+} // namespace
+
+// Fetch the function for the computation of the dense output.
+// NOTE: the lookup is deferred to the first use, as the
+// dense output function is compiled lazily by the llvm_state.
+template <typename T>
+typename taylor_adaptive_impl<T>::d_out_f_t taylor_adaptive_impl<T>::get_d_out_f()
+{
+    if (!m_vo_orders.empty()) {
+        // NOTE: in the variable-order integration, fetch
+        // the dense output function of the order of the last step.
+        auto &f = m_vo_d_out_f[m_vo_idx];
+        if (f == nullptr) {
+            f = reinterpret_cast<d_out_f_t>(m_llvm.jit_lookup("d_out_f_" + std::to_string(m_order)));
+        }
+
+        return f;
+    }
+
+    if (m_d_out_f == nullptr) {
+        m_d_out_f = reinterpret_cast<d_out_f_t>(m_llvm.jit_lookup("d_out_f"));
+    }
+
+    return m_d_out_f;
+}
+
+// Fetch the propagate kernel.
+// NOTE: as for the dense output function, the
+// lookup is deferred to the first use.
+template <typename T>
+typename taylor_adaptive_impl<T>::prop_f_t taylor_adaptive_impl<T>::get_prop_f()
+{
+    assert(m_vo_orders.empty());
+
+    if (m_prop_f == nullptr) {
+        m_prop_f = reinterpret_cast<prop_f_t>(m_llvm.jit_lookup("prop_f"));
+    }
+
+    return m_prop_f;
+}
+
+// Fetch the stepper(s) from the compiled llvm_state.
+// Complete the deferred construction of the integrator: s is the compiled
+// state shared with other integrators (which contains the functions of
+// the integrator with their names prefixed by prefix).
+// NOTE: the copy of s shares the compiled code with s.
+template <typename T>
+void taylor_adaptive_impl<T>::finalise_deferred(const llvm_state &s, std::string prefix)
+{
+    assert(m_deferred);
+
+    m_llvm = s;
+    m_llvm.set_symbol_prefix(std::move(prefix));
+
+    fetch_step_f();
+
+    m_deferred = false;
+}
+
+// NOTE: the dense output function(s) and the propagate
+// kernel will be fetched on first use.
+template <typename T>
+void taylor_adaptive_impl<T>::fetch_step_f()
+{
+    m_d_out_f = nullptr;
+    m_prop_f = nullptr;
+
+    if (m_vo_orders.empty()) {
+        m_step_f = reinterpret_cast<step_f_t>(m_llvm.jit_lookup("step"));
+    } else {
+        m_vo_step_f.clear();
+        for (const auto o : m_vo_orders) {
+            m_vo_step_f.push_back(reinterpret_cast<step_f_t>(m_llvm.jit_lookup("step_" + std::to_string(o))));
+        }
+        m_vo_d_out_f.assign(m_vo_orders.size(), nullptr);
+
+        m_step_f = m_vo_step_f[m_vo_idx];
+    }
+}
+
+// Select the order of the next step in the variable-order integration.
+//
+// The selection is based on the Taylor coefficients of the last step (at the
+// order q of the last step), from which the radius of convergence is estimated
+// for the orders up to q as in the stepper (and, for the orders above q, via the
+// estimate for q). The step size for the order o is then h_o = rho_o * rhofac_o,
+// and the cost of a step is modelled as (o + 1)**2 (i.e., it is
+// dominated by the convolutions in the computation of the derivatives). The next order
+// is the one minimising the estimated cost per unit time, (o + 1)**2 / h_o,
+// among the current order and the next lower and higher orders.
+//
+// NOTE: if the estimates of the radius of convergence at the various orders
+// agree, the optimal order depends only on the tolerance, and it is close to the
+// order deduced from the tolerance (see Jorba and Zou, 2005). The order changes
+// when the estimates at the various orders disagree (e.g., during close
+// encounters), and the step sizes in the cost model account for this.
+template <typename T>
+void taylor_adaptive_impl<T>::vo_select_order()
+{
+    using std::abs;
+    using std::isnan;
+    using std::log;
+
+    // NOTE: no selection is possible without the Taylor
+    // coefficients of a previous step.
+    if (m_last_h == 0 || m_vo_orders.size() == 1u) {
+        return;
+    }
+
+    const auto q = m_order;
+
+    // Compute the norms infinity of the Taylor coefficients
+    // of the state variables, for the orders from 0 to q.
+    m_vo_norms.assign(q + 1u, T(0));
+    for (std::uint32_t i = 0; i < m_dim; ++i) {
+        const auto *tc = m_tc.data() + static_cast<decltype(m_tc.size())>(i) * (q + 1u);
+
+        for (std::uint32_t k = 0; k <= q; ++k) {
+            m_vo_norms[k] = std::max(m_vo_norms[k], abs(tc[k]));
+        }
+    }
+
+    // NOTE: relative or absolute estimate, as in the stepper.
+    const auto log_num_rho = log(std::max(T(1), m_vo_norms[0]));
+
+    // The logarithm of the cost per unit time of the order with index idx.
+    auto log_cost = [&](std::uint32_t idx) {
+        const auto o = std::min(m_vo_orders[idx], q);
+
+        const auto log_rho
+            = std::min((log_num_rho - log(m_vo_norms[o])) / o, (log_num_rho - log(m_vo_norms[o - 1u])) / (o - 1u));
+
+        return 2 * log(T(m_vo_orders[idx] + 1u)) - log_rho - m_vo_log_rhofac[idx];
+    };
+
+    auto new_idx = m_vo_idx;
+    auto min_cost = log_cost(m_vo_idx);
+    if (isnan(min_cost)) {
+        return;
+    }
+
+    for (const auto idx : {m_vo_idx - 1u, m_vo_idx + 1u}) {
+        // NOTE: m_vo_idx - 1 wraps around if m_vo_idx is zero.
+        if (idx >= m_vo_orders.size()) {
+            continue;
+        }
+
+        if (const auto cost = log_cost(idx); cost < min_cost) {
+            new_idx = idx;
+            min_cost = cost;
+        }
+    }
+
+    m_vo_idx = new_idx;
+    m_order = m_vo_orders[new_idx];
+    m_step_f = m_vo_step_f[new_idx];
+}
+
+template <typename T>
+void taylor_adaptive_impl<T>::enable_perf_counters(std::uint64_t raw_config)
+{
+    m_perf = std::make_unique<perf_counter_group>(raw_config);
+    m_perf_buf.resize(m_dim);
+
+    // NOTE: fetch the dense output function now, so that its lazy
+    // compilation does not take place within a profiled step.
+    get_d_out_f();
+}
+
+template <typename T>
+void taylor_adaptive_impl<T>::disable_perf_counters()
+{
+    m_perf.reset();
+}
+
+template <typename T>
+bool taylor_adaptive_impl<T>::perf_counters_enabled() const
+{
+    return static_cast<bool>(m_perf);
+}
+
+template <typename T>
+const std::vector<step_perf_counts> &taylor_adaptive_impl<T>::get_perf_counts() const
+{
+    return m_perf_counts;
+}
+
+template <typename T>
+void taylor_adaptive_impl<T>::reset_perf_counts()
+{
+    m_perf_counts.clear();
+}
+
+template <typename T>
+void taylor_adaptive_impl<T>::enable_stats()
+{
+    if (!m_stats) {
+        m_stats.emplace();
+    }
+}
+
+template <typename T>
+void taylor_adaptive_impl<T>::disable_stats()
+{
+    m_stats.reset();
+}
+
+template <typename T>
+bool taylor_adaptive_impl<T>::stats_enabled() const
+{
+    return m_stats.has_value();
+}
+
+template <typename T>
+const taylor_stats &taylor_adaptive_impl<T>::get_stats() const
+{
+    if (!m_stats) {
+        throw std::invalid_argument("Cannot fetch the statistics of an adaptive Taylor integrator if their "
+                                    "collection has not been enabled");
+    }
+
+    return *m_stats;
+}
+
+template <typename T>
+void taylor_adaptive_impl<T>::reset_stats()
+{
+    if (m_stats) {
+        m_stats.emplace();
+    }
+}
+
+template <typename T>
+void taylor_adaptive_impl<T>::enable_checkpoints()
+{
+    // NOTE: in the variable-order integration, the
+    // order of the Taylor coefficients changes from
+    // step to step.
+    if (!m_vo_orders.empty()) {
+        throw std::invalid_argument(
+            "The recording of the checkpoints is not supported by the variable-order adaptive Taylor integrator");
+    }
+
+    if (!m_ckpts) {
+        m_ckpts.emplace(m_dim, m_order);
+    }
+}
+
+template <typename T>
+void taylor_adaptive_impl<T>::disable_checkpoints()
+{
+    m_ckpts.reset();
+}
+
+template <typename T>
+bool taylor_adaptive_impl<T>::checkpoints_enabled() const
+{
+    return m_ckpts.has_value();
+}
+
+template <typename T>
+const taylor_checkpoints<T> &taylor_adaptive_impl<T>::get_checkpoints() const
+{
+    if (!m_ckpts) {
+        throw std::invalid_argument("Cannot fetch the checkpoints of an adaptive Taylor integrator if their "
+                                    "recording has not been enabled");
+    }
+
+    return *m_ckpts;
+}
+
+template <typename T>
+void taylor_adaptive_impl<T>::reset_checkpoints()
+{
+    if (m_ckpts) {
+        m_ckpts->clear();
+    }
+}
+
+template <typename T>
+void taylor_adaptive_impl<T>::enable_invariants(const std::vector<expression> &inv, std::size_t every)
+{
+    if (inv.empty()) {
+        throw std::invalid_argument(
+            "The list of the invariants monitored by an adaptive Taylor integrator cannot be empty");
+    }
+
+    if (every == 0u) {
+        throw std::invalid_argument("The number of steps between the evaluations of the invariants monitored by an "
+                                    "adaptive Taylor integrator cannot be zero");
+    }
+
+    const auto &dc = get_decomposition();
+    if (dc.empty()) {
+        throw std::invalid_argument("The monitoring of the invariants of an adaptive Taylor integrator requires the "
+                                    "Taylor decomposition, which was dropped");
+    }
+
+    std::uint32_t n_pars = 0;
+    for (const auto &ex : inv) {
+        n_pars = std::max(n_pars, get_param_size(ex));
+    }
+    if (n_pars > m_pars.size()) {
+        throw std::invalid_argument("The invariants monitored by an adaptive Taylor integrator depend on "
+                                    + std::to_string(n_pars) + " parameter(s), but the integrator has only "
+                                    + std::to_string(m_pars.size()) + " parameter(s)");
+    }
+
+    // NOTE: the first m_dim elements of the
+    // decomposition are the state variables.
+    std::vector<expression> vars;
+    for (std::uint32_t i = 0; i < m_dim; ++i) {
+        vars.push_back(dc[i].first);
+    }
+
+    m_inv.reset(new taylor_invariants_impl<T>(inv, std::move(vars), every));
+    m_inv->reset(get_state_data(), get_pars_data());
+}
+
+template <typename T>
+void taylor_adaptive_impl<T>::disable_invariants()
+{
+    m_inv.reset();
+}
+
+template <typename T>
+bool taylor_adaptive_impl<T>::invariants_enabled() const
+{
+    return static_cast<bool>(m_inv);
+}
+
+template <typename T>
+const taylor_invariants<T> &taylor_adaptive_impl<T>::get_invariants() const
+{
+    if (!m_inv) {
+        throw std::invalid_argument("Cannot fetch the invariants of an adaptive Taylor integrator if their "
+                                    "monitoring has not been enabled");
+    }
+
+    return m_inv->m_rec;
+}
+
+template <typename T>
+void taylor_adaptive_impl<T>::reset_invariants()
+{
+    if (m_inv) {
+        m_inv->reset(get_state_data(), get_pars_data());
+    }
+}
+
+template <typename T>
+void taylor_adaptive_impl<T>::enable_stiffness_detection(T threshold, std::size_t n)
+{
+    using std::isfinite;
+
+    if (!m_vo_orders.empty()) {
+        throw std::invalid_argument(
+            "The stiffness detection is not supported by the variable-order adaptive Taylor integrator");
+    }
+
+    if (!isfinite(threshold) || threshold <= 0) {
+        throw std::invalid_argument("The threshold for the stiffness detection must be finite and positive, but it is "
+                                    + li_to_string(threshold) + " instead");
+    }
+
+    if (n == 0u) {
+        throw std::invalid_argument(
+            "The number of consecutive steps for the stiffness detection must be nonzero");
+    }
+
+    m_stiff_threshold = threshold;
+    m_stiff_n_steps = n;
+    m_stiff_count = 0;
+    m_stiff_ratio = 0;
+}
+
+template <typename T>
+void taylor_adaptive_impl<T>::disable_stiffness_detection()
+{
+    m_stiff_threshold = 0;
+    m_stiff_n_steps = 0;
+    m_stiff_count = 0;
+    m_stiff_ratio = 0;
+}
+
+template <typename T>
+bool taylor_adaptive_impl<T>::stiffness_detection_enabled() const
+{
+    return m_stiff_n_steps > 0u;
+}
+
+template <typename T>
+T taylor_adaptive_impl<T>::get_stiffness_ratio() const
+{
+    return m_stiff_ratio;
+}
+
+template <typename T>
+taylor_memory_usage taylor_adaptive_impl<T>::memory_usage() const
+{
+    taylor_memory_usage retval;
+
+    retval.llvm = m_llvm.memory_usage();
+    retval.decomposition = m_dc ? taylor_dc_memory_usage(*m_dc) : 0u;
+    retval.tc = taylor_buffers_memory_usage(m_tc);
+    retval.buffers
+        = taylor_buffers_memory_usage(m_state, m_pars, m_d_out, m_tes, m_ntes, m_te_cooldowns, m_ev_poly, m_ev_tmp,
+                                      m_ev_roots, m_t_ev_times, m_nt_ev_times, m_perf_counts, m_perf_buf,
+                                      m_vo_orders, m_vo_step_f, m_vo_d_out_f, m_vo_log_rhofac, m_vo_norms,
+                                      m_sym_mid, m_sym_z);
+
+    return retval;
+}
+
+template <typename T>
+void taylor_adaptive_impl<T>::drop_decomposition()
+{
+    m_dc.reset();
+}
+
+template <typename T>
+void taylor_adaptive_impl<T>::drop_ir_snapshot()
+{
+    m_llvm.drop_ir_snapshot();
+}
+
+template <typename T>
+void taylor_adaptive_impl<T>::optimise_async(unsigned opt_level)
+{
+    // NOTE: the instrumented stepper would be replaced
+    // before the collection of the profile data.
+    if (m_pgo_steps != 0u) {
+        throw std::invalid_argument("The compiled code of an adaptive Taylor integrator cannot be re-optimised "
+                                    "before the profile-guided optimisation");
+    }
+
+    // Wait for the completion of the previous
+    // background compilation, if any.
+    wait_optimise();
+
+    // NOTE: the IR is parsed in the current thread,
+    // the background thread owns the copy.
+    auto tmp = m_llvm.uncompiled_copy();
+    tmp.opt_level() = opt_level;
+
+    m_opt_fut = std::async(std::launch::async, [s = std::move(tmp)]() mutable {
+        s.optimise();
+        s.compile();
+
+        return std::move(s);
+    });
+}
+
+template <typename T>
+bool taylor_adaptive_impl<T>::optimise_pending() const
+{
+    return m_opt_fut.valid();
+}
+
+template <typename T>
+bool taylor_adaptive_impl<T>::wait_optimise()
+{
+    if (!m_opt_fut.valid()) {
+        return false;
+    }
+
+    // NOTE: if the background compilation failed,
+    // get() re-throws the exception and the current
+    // code is kept.
+    auto s = m_opt_fut.get();
+
+    m_llvm = std::move(s);
+    fetch_step_f();
+
+    return true;
+}
+
+// Replace the compiled code with the re-optimised
+// code, if the background compilation is complete.
+template <typename T>
+void taylor_adaptive_impl<T>::poll_optimise()
+{
+    if (m_opt_fut.valid() && m_opt_fut.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+        wait_optimise();
+    }
+}
+
+// Recompile the stepper using the profile data
+// collected by the instrumented stepper.
+template <typename T>
+void taylor_adaptive_impl<T>::pgo_recompile()
+{
+    m_llvm.pgo_recompile();
+
+    fetch_step_f();
+}
+
+// Implementation detail to make a single integration timestep.
+// The magnitude of the timestep is automatically deduced, but it will
+// always be not greater than abs(max_delta_t). The propagation
+// is done forward in time if max_delta_t >= 0, backwards in
+// time otherwise.
+//
+// The function will return a pair, containing
+// a flag describing the outcome of the integration,
+// and the integration timestep that was used.
+//
+// If events are present, the zero crossings of the event equations
+// within the timestep are detected. The callbacks of the non-terminal
+// events are invoked in chronological order, and the timestep is truncated
+// at the earliest zero crossing of a terminal event (if any).
+template <typename T>
+std::tuple<taylor_outcome, T> taylor_adaptive_impl<T>::step_impl_core(T max_delta_t, bool wtc)
+{
+    using std::abs;
+    using std::isfinite;
+
+#if !defined(NDEBUG)
+    // NOTE: this is the only precondition on max_delta_t.
+    using std::isnan;
+    assert(!isnan(max_delta_t));
+#endif
+
+    const auto has_events = !m_tes.empty() || !m_ntes.empty();
+
+    // Select the order of the step in the variable-order integration.
+    const auto var_order = !m_vo_orders.empty();
+    if (var_order) {
+        vo_select_order();
+    }
+
+    // Record the time at the beginning of the timestep.
+    const auto t0 = m_time, t0_lo = m_time_lo;
+
+    // Invoke the stepper.
+    // NOTE: if there are events, if the step is being profiled or if
+    // the order is variable, we always need the Taylor coefficients.
+    // NOTE: the stepper also checks if the updated
+    // state vector contains only finite values.
+    // NOTE: with the step size prediction, the max timestep is followed
+    // by the predicted timestep in the buffer passed to the stepper.
+    T h_buf[2] = {max_delta_t, m_pred_h};
+    auto &h = h_buf[0];
+    auto *tc_ptr = (wtc || has_events || m_perf || var_order) ? m_tc.data() : nullptr;
+    std::uint32_t sv_finite = 0;
+    if (m_perf) {
+        auto &pc = taylor_fetch_perf_counters(m_perf);
+        step_perf_counts spc;
+
+        pc.start();
+        sv_finite = m_step_f(get_state_data(), get_pars_data(), &m_time, h_buf, tc_ptr);
+        spc.step = pc.stop();
+
+        // Measure the state update by evaluating the
+        // Taylor polynomials of the step once more.
+        const auto d_out_f = get_d_out_f();
+        pc.start();
+        d_out_f(m_perf_buf.data(), m_tc.data(), &h);
+        spc.update = pc.stop();
+
+        m_perf_counts.push_back(spc);
+    } else {
+        sv_finite = m_step_f(get_state_data(), get_pars_data(), &m_time, h_buf, tc_ptr);
+    }
+    m_pred_h = h_buf[1];
+
+    // Recompile the stepper using the profile data once the
+    // instrumented stepper has been run for the requested
+    // number of steps.
+    if (m_pgo_steps != 0u && --m_pgo_steps == 0u) {
+        pgo_recompile();
+    }
+
+    // Update the time and the size of the last timestep.
+    taylor_time_add(m_time, m_time_lo, h, m_comp_time);
+    m_last_h = h;
+
+    // Check if the time or the state vector are non-finite at the
+    // end of the timestep.
+    if (!isfinite(m_time) || sv_finite == 0u) {
+        return std::tuple{taylor_outcome::err_nf_state, h};
+    }
+
+    if (!has_events) {
+        return std::tuple{h == max_delta_t ? taylor_outcome::time_limit : taylor_outcome::success, h};
+    }
+
+    // Helper to detect the zero crossings of the event equation
+    // with index ev_idx in [0, 1] (in the timestep-normalised
+    // time coordinate), and to append the zero crossings with the
+    // correct direction to out as (tau, event index) pairs.
+    auto detect_events = [this, h](std::uint32_t ev_idx, event_direction dir, auto &out, auto cd_filter) {
+        // Fetch the Taylor coefficients of the event equation,
+        // and rescale them so that the polynomial is expressed
+        // in terms of tau = (t - t0) / h.
+        const auto tc_begin = m_tc.data() + (m_dim + ev_idx) * static_cast<decltype(m_tc.size())>(m_order + 1u);
+        m_ev_poly.assign(tc_begin, tc_begin + (m_order + 1u));
+        T cur_h(1);
+        for (auto &c : m_ev_poly) {
+            c *= cur_h;
+            cur_h *= h;
+        }
+
+        // Find the roots.
+        m_ev_roots.clear();
+        poly_find_roots_01(m_ev_poly, m_ev_roots, m_ev_tmp);
+
+        // NOTE: poly_find_roots_01() searches [0, 1), thus add the root at the end of the
+        // timestep, if any. A zero crossing falling exactly on the boundary between two
+        // timesteps is then detected at tau = 1 in the earlier timestep, and it is discarded
+        // (for the non-terminal events) at tau = 0 in the later one.
+        if (poly_eval(m_ev_poly, T(1)) == 0) {
+            m_ev_roots.emplace_back(1);
+        }
+
+        for (const auto &tau : m_ev_roots) {
+            // NOTE: the derivative of the event equation with respect to time
+            // has the sign of the derivative with respect to tau times the sign of h.
+            const auto der = poly_eval_der(m_ev_poly, tau) * (h >= 0 ? T(1) : T(-1));
+
+            if (taylor_ev_dir_match(dir, der) && cd_filter(tau)) {
+                out.emplace_back(tau, ev_idx);
+            }
+        }
+    };
+
+    {
+        HEYOKA_TRACE_SCOPE("event_detection", this);
+
+        // Detect the terminal events.
+        m_t_ev_times.clear();
+        for (std::uint32_t i = 0; i < m_tes.size(); ++i) {
+            detect_events(i, m_tes[i].get_direction(), m_t_ev_times, [this, i, t0, h](const T &tau) {
+                // Ignore the zero crossings within the cooldown time
+                // of a previous triggering of the event.
+                if (const auto &cd = m_te_cooldowns[i]) {
+                    return abs((t0 + tau * h) - cd->first) >= cd->second;
+                }
+
+                return true;
+            });
+        }
+
+        // Detect the non-terminal events.
+        // NOTE: the zero crossings at tau = 0 are discarded, since they were
+        // reported at tau = 1 in the previous timestep (or they are at the
+        // initial time of the integration).
+        m_nt_ev_times.clear();
+        for (std::uint32_t i = 0; i < m_ntes.size(); ++i) {
+            detect_events(static_cast<std::uint32_t>(m_tes.size() + i), m_ntes[i].get_direction(), m_nt_ev_times,
+                          [](const T &tau) { return tau > 0; });
+        }
+    }
+
+    // Find the earliest terminal event, if any.
+    const auto te_it = std::min_element(m_t_ev_times.begin(), m_t_ev_times.end(),
+                                        [](const auto &a, const auto &b) { return std::get<0>(a) < std::get<0>(b); });
+    const auto has_te = te_it != m_t_ev_times.end();
+
+    // The full timestep, before the (possible) truncation.
+    const auto full_h = h;
+
+    if (has_te) {
+        // Truncate the timestep at the terminal event, and
+        // compute the state at the event time via the dense output.
+        h = std::get<0>(*te_it) * full_h;
+        get_d_out_f()(get_state_data(), m_tc.data(), &h);
+
+        m_time = t0;
+        m_time_lo = t0_lo;
+        taylor_time_add(m_time, m_time_lo, h, m_comp_time);
+        m_last_h = h;
+    }
+
+    // Invoke the callbacks of the non-terminal events in
+    // chronological order, ignoring the zero crossings
+    // past the terminal event.
+    std::sort(m_nt_ev_times.begin(), m_nt_ev_times.end(),
+              [](const auto &a, const auto &b) { return std::get<0>(a) < std::get<0>(b); });
+    for (const auto &[tau, ev_idx] : m_nt_ev_times) {
+        if (has_te && tau > std::get<0>(*te_it)) {
+            break;
+        }
+
+        m_ntes[ev_idx - m_tes.size()].get_callback()(*this, t0 + tau * full_h);
+    }
+
+    // Expire the cooldowns.
+    for (auto &cd : m_te_cooldowns) {
+        if (cd && abs(m_time - cd->first) >= cd->second) {
+            cd.reset();
+        }
+    }
+
+    if (!has_te) {
+        return std::tuple{h == max_delta_t ? taylor_outcome::time_limit : taylor_outcome::success, h};
+    }
+
+    const auto te_idx = std::get<1>(*te_it);
+    const auto &te = m_tes[te_idx];
+
+    // Set the cooldown for the terminal event.
+    // NOTE: if no cooldown was specified, use a small
+    // fraction of the full timestep.
+    using std::sqrt;
+    const auto cd_val
+        = te.get_cooldown() >= 0 ? te.get_cooldown() : sqrt(std::numeric_limits<T>::epsilon()) * abs(full_h);
+    m_te_cooldowns[te_idx].emplace(m_time, cd_val);
+
+    // Invoke the callback, if present. If the callback
+    // returns true, the integration is not stopped.
+    if (te.get_callback() && te.get_callback()(*this, m_time)) {
+        return std::tuple{taylor_outcome::success, h};
+    }
+
+    return std::tuple{taylor_outcome::terminal_event, h};
+}
+
+// Update the stiffness detection after a step with outcome
+// and timestep retval (the outcome is changed to stiff if
+// the stiffness was detected).
+template <typename T>
+void taylor_adaptive_impl<T>::stiffness_update(std::tuple<taylor_outcome, T> &retval)
+{
+    using std::abs;
+
+    auto &[oc, h] = retval;
+
+    // NOTE: the timestep of the steps which were not successful
+    // (e.g., limited by the time limit or by a terminal event)
+    // is not representative of the dynamics.
+    if (oc != taylor_outcome::success || h == 0) {
+        return;
+    }
+
+    // NOTE: the Taylor coefficients of order 0 are the state
+    // at the beginning of the step, the coefficients of order 1 the
+    // first derivatives.
+    const auto ncoeff = static_cast<std::size_t>(m_order) + 1u;
+    T n0 = 0, n1 = 0;
+    for (std::uint32_t i = 0; i < m_dim; ++i) {
+        n0 = std::max(n0, T(abs(m_tc[i * ncoeff])));
+        n1 = std::max(n1, T(abs(m_tc[i * ncoeff + 1u])));
+    }
+
+    // NOTE: a zero ratio if the state or its derivative vanish,
+    // which happens only at (non-stiff) special points.
+    m_stiff_ratio = (n0 == 0 || n1 == 0) ? T(0) : T(n0 / (n1 * abs(h)));
+
+    const auto is_stiff = m_stiff_ratio > m_stiff_threshold;
+    m_stiff_count = is_stiff ? m_stiff_count + 1u : 0u;
+
+    if (m_stats) {
+        m_stats->n_stiff += static_cast<std::size_t>(is_stiff);
+        m_stats->max_stiffness_ratio = std::max(m_stats->max_stiffness_ratio, static_cast<double>(m_stiff_ratio));
+    }
+
+    if (m_stiff_count >= m_stiff_n_steps) {
+        oc = taylor_outcome::stiff;
+        m_stiff_count = 0;
+    }
+}
+
+// Wrapper around step_impl_core() which collects the statistics
+// of the step, updates the stiffness detection, records the checkpoint
+// and updates the monitor of the invariants, if enabled.
+template <typename T>
+std::tuple<taylor_outcome, T> taylor_adaptive_impl<T>::step_impl(T max_delta_t, bool wtc)
+{
+    HEYOKA_TRACE_SCOPE("step", this);
+
+    poll_optimise();
+
+    if (!m_stats && !m_ckpts && !m_inv && m_stiff_n_steps == 0u) {
+        return step_impl_core(max_delta_t, wtc);
+    }
+
+    // NOTE: the recording of the checkpoints and the
+    // stiffness detection need the Taylor coefficients.
+    const auto t0 = m_time;
+    wtc = wtc || m_ckpts || m_stiff_n_steps > 0u;
+
+    std::tuple<taylor_outcome, T> retval;
+    double elapsed = 0;
+    if (m_stats) {
+        time_accumulator ta(elapsed);
+        retval = step_impl_core(max_delta_t, wtc);
+    } else {
+        retval = step_impl_core(max_delta_t, wtc);
+    }
+
+    if (m_stiff_n_steps > 0u) {
+        stiffness_update(retval);
+    }
+
+    if (m_stats) {
+        taylor_stats_record_time(*m_stats, elapsed);
+        taylor_stats_record_step(*m_stats, std::get<0>(retval), std::get<1>(retval));
+    }
+
+    if (m_ckpts && std::get<1>(retval) != 0 && std::get<0>(retval) != taylor_outcome::err_nf_state) {
+        m_ckpts->add_step(t0, m_time, m_tc.data());
+    }
+
+    if (m_inv && std::get<1>(retval) != 0 && std::get<0>(retval) != taylor_outcome::err_nf_state) {
+        m_inv->update(m_time, get_state_data(), get_pars_data());
+    }
+
+    return retval;
+}
+
+template <typename T>
+std::tuple<taylor_outcome, T> taylor_adaptive_impl<T>::step(bool wtc)
+{
+    // NOTE: time limit +inf means integration forward in time
+    // and no time limit.
+    return step_impl(std::numeric_limits<T>::infinity(), wtc);
+}
+
+template <typename T>
+std::tuple<taylor_outcome, T> taylor_adaptive_impl<T>::step_backward(bool wtc)
+{
+    return step_impl(-std::numeric_limits<T>::infinity(), wtc);
+}
+
+template <typename T>
+std::tuple<taylor_outcome, T> taylor_adaptive_impl<T>::step(T max_delta_t, bool wtc)
+{
+    using std::isnan;
+
+    if (isnan(max_delta_t)) {
+        throw std::invalid_argument(
+            "A NaN max_delta_t was passed to the step() function of an adaptive Taylor integrator");
+    }
+
+    return step_impl(max_delta_t, wtc);
+}
+
+// Propagate the state from the current time over the time interval delta_t
+// via adaptive steps (i.e., the flow of the integrator used in step_symmetric()).
+// NOTE: the step size prediction is reset, so that the flow depends
+// only on the state, on the time and on delta_t.
+template <typename T>
+taylor_outcome taylor_adaptive_impl<T>::sym_flow(T delta_t)
+{
+    m_pred_h = 0;
+
+    while (true) {
+        const auto [res, h] = step_impl(delta_t, false);
+
+        if (res == taylor_outcome::time_limit) {
+            return taylor_outcome::success;
+        }
+
+        if (res != taylor_outcome::success) {
+            return res;
+        }
+
+        delta_t -= h;
+    }
+}
+
+// Denoting with Phi_h the flow of the integrator over the time interval h (see sym_flow()),
+// the symmetric step is the composition Phi*_{h/2} o Phi_{h/2}, where Phi*_{h/2} = (Phi_{-h/2})^-1
+// is the adjoint of Phi_{h/2}. The composition of a map with its adjoint is time-symmetric,
+// which, for time-reversible systems, prevents the secular drift of the conserved quantities
+// (e.g., the energy in Hamiltonian systems) at loose tolerances. The implicit half-step is
+// computed via a fixed-point iteration on the residual of the backward flow, and thus
+// the step is reversible only up to the tolerance of the iteration (see below).
+// NOTE: on failure of one of the flows (or on non-finite corrections), the state and the
+// time are left as computed by the last flow, and thus they refer neither to the beginning
+// nor to the end of the step.
+// NOTE: the Taylor coefficients at the end of the step do not refer to the step,
+// thus the last timestep is reset to zero (as in reset()).
+template <typename T>
+std::tuple<taylor_outcome, std::uint32_t> taylor_adaptive_impl<T>::step_symmetric(T h, std::uint32_t max_iter)
+{
+    using std::abs;
+    using std::isfinite;
+
+    if (!isfinite(h) || h == 0) {
+        throw std::invalid_argument("The timestep passed to the step_symmetric() function of an adaptive Taylor "
+                                    "integrator must be finite and nonzero, but it is "
+                                    + li_to_string(h) + " instead");
+    }
+
+    if (max_iter == 0u) {
+        throw std::invalid_argument("The maximum number of iterations passed to the step_symmetric() function of an "
+                                    "adaptive Taylor integrator cannot be zero");
+    }
+
+    if (!m_tes.empty() || !m_ntes.empty()) {
+        throw std::invalid_argument("The symmetric step is not supported by an adaptive Taylor integrator with events");
+    }
+
+    if (m_ckpts) {
+        throw std::invalid_argument("The symmetric step is not supported by an adaptive Taylor integrator while the "
+                                    "recording of the checkpoints is enabled");
+    }
+
+    auto *state = get_state_data();
+    const auto n = m_state.size();
+    const auto half_h = h / 2;
+
+    // The time at the end of the step.
+    auto t1 = m_time, t1_lo = m_time_lo;
+    taylor_time_add(t1, t1_lo, h, m_comp_time);
+
+    m_last_h = 0;
+
+    // The explicit half-step.
+    if (const auto oc = sym_flow(half_h); oc != taylor_outcome::success) {
+        return std::tuple{oc, std::uint32_t(0)};
+    }
+    m_sym_mid.assign(state, state + n);
+
+    // The initial guess for the implicit half-step.
+    if (const auto oc = sym_flow(half_h); oc != taylor_outcome::success) {
+        return std::tuple{oc, std::uint32_t(0)};
+    }
+    m_sym_z.assign(state, state + n);
+
+    // NOTE: the iteration stops when the correction is at the level
+    // of the rounding errors in the evaluation of the flow, relative
+    // to max(1, |z|).
+    const auto thr = 16 * std::numeric_limits<T>::epsilon();
+
+    auto retval = taylor_outcome::step_limit;
+    std::uint32_t iter = 0;
+    while (iter < max_iter) {
+        ++iter;
+
+        // Backward flow from the current guess.
+        std::copy(m_sym_z.begin(), m_sym_z.end(), state);
+        m_time = t1;
+        m_time_lo = t1_lo;
+        if (const auto oc = sym_flow(-half_h); oc != taylor_outcome::success) {
+            return std::tuple{oc, iter};
+        }
+
+        // Correct the guess via the residual.
+        T max_corr(0), max_abs(1);
+        for (decltype(m_sym_z.size()) i = 0; i < n; ++i) {
+            const auto corr = m_sym_mid[i] - state[i];
+            if (!isfinite(corr)) {
+                return std::tuple{taylor_outcome::err_nf_state, iter};
+            }
+            m_sym_z[i] += corr;
+
+            max_corr = std::max(max_corr, abs(corr));
+            max_abs = std::max(max_abs, abs(m_sym_z[i]));
+        }
+
+        if (max_corr <= thr * max_abs) {
+            retval = taylor_outcome::success;
+            break;
+        }
+    }
+
+    std::copy(m_sym_z.begin(), m_sym_z.end(), state);
+    m_time = t1;
+    m_time_lo = t1_lo;
+
+    return std::tuple{retval, iter};
+}
+
+template <typename T>
+std::tuple<taylor_outcome, T, T, std::size_t> taylor_adaptive_impl<T>::propagate_for(T delta_t, std::size_t max_steps,
+                                                                                     step_callback cb)
+{
+    HEYOKA_TRACE_SCOPE("propagate_for", this);
+
+    return propagate_until(m_time + delta_t, max_steps, cb);
+}
+
+template <typename T>
+std::tuple<taylor_outcome, T, T, std::size_t> taylor_adaptive_impl<T>::propagate_until(T t, std::size_t max_steps,
+                                                                                       step_callback cb)
+{
+    HEYOKA_TRACE_SCOPE("propagate_until", this);
+
+    using std::isfinite;
+
+    // Check the current time.
+    if (!isfinite(m_time)) {
+        throw std::invalid_argument("Cannot invoke the propagate_until() function of an adaptive Taylor integrator if "
+                                    "the current time is not finite");
+    }
+
+    // Check the final time.
+    if (!isfinite(t)) {
+        throw std::invalid_argument(
+            "A non-finite time was passed to the propagate_until() function of an adaptive Taylor integrator");
+    }
+
+    // Initial values for the counters,
+    // the min/max abs of the integration
+    // timesteps, and min/max Taylor orders.
+    // NOTE: iter_counter is for keeping track of the max_steps
+    // limits, step_counter counts the number of timesteps performed
+    // with a non-zero h. Most of the time these two quantities
+    // will be identical, apart from corner cases.
+    std::size_t iter_counter = 0, step_counter = 0;
+    T min_h = std::numeric_limits<T>::infinity(), max_h(0);
+
+    // Run the loop within the compiled propagate kernel, if possible.
+    // NOTE: the step-by-step loop below is needed for the events,
+    // the profiling, the statistics, the checkpoints, the invariants, the profile-guided
+    // optimisation, the variable-order integration, the stiffness detection and the tracing of the steps.
+    poll_optimise();
+    if (m_tes.empty() && m_ntes.empty() && !m_perf && !m_stats && !m_ckpts && !m_inv && m_pgo_steps == 0u
+        && m_vo_orders.empty() && m_stiff_n_steps == 0u && !trace_active()) {
+        T h_buf[6] = {t, T(0), T(0), T(0), m_time_lo, m_pred_h};
+        std::uint64_t cnt_buf[3] = {boost::numeric_cast<std::uint64_t>(max_steps), 0, 0};
+
+        const auto ret = get_prop_f()(get_state_data(), get_pars_data(), &m_time, h_buf, cnt_buf, cb.f, cb.ctx);
+
+        m_last_h = h_buf[3];
+        m_time_lo = h_buf[4];
+        m_pred_h = h_buf[5];
+
+        constexpr taylor_outcome ocs[]
+            = {taylor_outcome::time_limit, taylor_outcome::step_limit, taylor_outcome::err_nf_state,
+               taylor_outcome::cb_stop};
+        const auto oc = ocs[ret];
+
+        return std::tuple{oc, h_buf[1], h_buf[2], boost::numeric_cast<std::size_t>(cnt_buf[2])};
+    }
+
+    while (true) {
+        // NOTE: t - m_time is guaranteed not to be nan: t is never non-finite,
+        // and at the first iteration we have checked above the value of m_time.
+        // At successive iterations, we know that m_time must be finite because
+        // otherwise we would have exited the loop when checking res.
+        // NOTE: the low-order part of the time is zero without
+        // the compensated summation of the time.
+        const auto [res, h] = step_impl((t - m_time) - m_time_lo, false);
+
+        // NOTE: the stiff outcome is returned after a successful step.
+        if (res != taylor_outcome::success && res != taylor_outcome::time_limit
+            && res != taylor_outcome::terminal_event && res != taylor_outcome::stiff) {
+            // Something went wrong in the propagation of the timestep, exit.
+            return std::tuple{res, min_h, max_h, step_counter};
+        }
+
+        // Update the number of iterations.
+        ++iter_counter;
+
+        // Update the number of steps.
+        step_counter += static_cast<std::size_t>(h != 0);
+
+        // Update min_h/max_h, unless the time limit is reached or
+        // a terminal event was triggered.
+        const auto last = res == taylor_outcome::time_limit || res == taylor_outcome::terminal_event;
+        if (!last) {
+            using std::abs;
+            const auto abs_h = abs(h);
+            min_h = std::min(min_h, abs_h);
+            max_h = std::max(max_h, abs_h);
+        }
+
+        // Invoke the step callback.
+        if (cb.f != nullptr && !cb.f(cb.ctx)) {
+            return std::tuple{taylor_outcome::cb_stop, min_h, max_h, step_counter};
+        }
+
+        // Break out if the time limit is reached, if
+        // a terminal event was triggered or if the
+        // stiffness was detected.
+        if (last || res == taylor_outcome::stiff) {
+            return std::tuple{res, min_h, max_h, step_counter};
+        }
+
+        // Check the iteration limit.
+        if (max_steps != 0u && iter_counter == max_steps) {
+            return std::tuple{taylor_outcome::step_limit, min_h, max_h, step_counter};
+        }
+    }
+}
+
+// Propagate the state of the system over a monotonically-sorted
+// time grid. The integration first proceeds up to the first grid point
+// via propagate_until(). Afterwards, the integration proceeds with
+// the natural timesteps (limited only by the last grid point), and the
+// state at the grid points is computed via dense output.
+//
+// The return value contains the same information returned by propagate_until()
+// (taking into account all the timesteps undertaken), plus the state vectors at the
+// grid points that were reached, in grid-major/state-minor order. The
+// state vectors are guaranteed to be available for all grid points only
+// if the outcome of the propagation is time_limit.
+template <typename T>
+std::tuple<taylor_outcome, T, T, std::size_t, std::vector<T>>
+taylor_adaptive_impl<T>::propagate_grid(const std::vector<T> &grid, std::size_t max_steps)
+{
+    HEYOKA_TRACE_SCOPE("propagate_grid", this);
+
+    using std::abs;
+    using std::isfinite;
+
+    // Check the current time.
+    if (!isfinite(m_time)) {
+        throw std::invalid_argument("Cannot invoke the propagate_grid() function of an adaptive Taylor integrator if "
+                                    "the current time is not finite");
+    }
+
+    // Check the grid.
+    if (grid.empty()) {
+        throw std::invalid_argument(
+            "Cannot invoke the propagate_grid() function of an adaptive Taylor integrator with an empty time grid");
+    }
+
+    if (std::any_of(grid.begin(), grid.end(), [](const auto &t) { return !isfinite(t); })) {
+        throw std::invalid_argument(
+            "A non-finite time was passed to the propagate_grid() function of an adaptive Taylor integrator");
+    }
+
+    // Determine the direction of the integration.
+    const auto forward = grid.back() >= grid.front();
+
+    for (decltype(grid.size()) i = 1; i < grid.size(); ++i) {
+        if (forward ? grid[i] < grid[i - 1u] : grid[i] > grid[i - 1u]) {
+            throw std::invalid_argument("The time grid passed to the propagate_grid() function of an adaptive "
+                                        "Taylor integrator must be sorted monotonically");
+        }
+    }
+
+    // Prepare the output buffer.
+    // LCOV_EXCL_START
+    if (grid.size() > std::numeric_limits<decltype(grid.size())>::max() / m_state.size()) {
+        throw std::overflow_error(
+            "Overflow detected in the creation of the output buffer in the propagate_grid() function of an "
+            "adaptive Taylor integrator");
+    }
+    // LCOV_EXCL_STOP
+    std::vector<T> retval;
+    retval.resize(grid.size() * m_state.size());
+
+    // Helper to shrink the output buffer to the
+    // first n grid points, and assemble the return value.
+    auto make_retval = [&retval, this](taylor_outcome oc, T min_h, T max_h, std::size_t n_steps, std::size_t n) {
+        retval.resize(n * m_state.size());
+
+        return std::tuple{oc, min_h, max_h, n_steps, std::move(retval)};
+    };
+
+    // Propagate up to the first grid point.
+    auto [oc, min_h, max_h, step_counter] = propagate_until(grid[0], max_steps);
+    if (oc != taylor_outcome::time_limit) {
+        return make_retval(oc, min_h, max_h, step_counter, 0);
+    }
+
+    // Write out the state at the first grid point.
+    std::copy(get_state_data(), get_state_data() + m_state.size(), retval.begin());
+
+    // NOTE: the max_steps limit also takes into account
+    // the timesteps undertaken by propagate_until().
+    auto iter_counter = step_counter;
+
+    // The index of the next grid point.
+    decltype(grid.size()) grid_idx = 1;
+
+    while (grid_idx < grid.size()) {
+        // Check the iteration limit.
+        if (max_steps != 0u && iter_counter == max_steps) {
+            return make_retval(taylor_outcome::step_limit, min_h, max_h, step_counter, grid_idx);
+        }
+
+        // NOTE: grid.back() - m_time is guaranteed not to be nan, as
+        // m_time is finite at this point.
+        const auto [res, h] = step_impl(grid.back() - m_time, true);
+
+        if (res != taylor_outcome::success && res != taylor_outcome::time_limit
+            && res != taylor_outcome::terminal_event && res != taylor_outcome::stiff) {
+            // Something went wrong in the propagation of the timestep, exit.
+            return make_retval(res, min_h, max_h, step_counter, grid_idx);
+        }
+
+        // Update the counters.
+        ++iter_counter;
+        step_counter += static_cast<std::size_t>(h != 0);
+
+        // Compute the state at the grid points
+        // within the last timestep.
+        // NOTE: if we reached the time limit, all the remaining
+        // grid points are within the last timestep. We need to handle
+        // this case explicitly because, due to floating-point rounding,
+        // m_time might end up being slightly different from grid.back().
+        for (; grid_idx < grid.size()
+               && (res == taylor_outcome::time_limit
+                   || (forward ? grid[grid_idx] <= m_time : grid[grid_idx] >= m_time));
+             ++grid_idx) {
+            auto out_ptr = retval.data() + grid_idx * m_state.size();
+
+            if (grid[grid_idx] == m_time) {
+                // NOTE: no need to go through the dense
+                // output if we are exactly at the end of the timestep.
+                std::copy(get_state_data(), get_state_data() + m_state.size(), out_ptr);
+            } else {
+                const auto &d_out = update_d_output(grid[grid_idx]);
+                std::copy(d_out.begin(), d_out.end(), out_ptr);
+            }
+        }
+
+        // Break out if the time limit is reached,
+        // *before* updating the min_h/max_h values.
+        if (res == taylor_outcome::time_limit) {
+            break;
+        }
+
+        // Stop if a terminal event was triggered. The state vectors
+        // are available only for the grid points within the
+        // truncated timestep.
+        if (res == taylor_outcome::terminal_event) {
+            return make_retval(res, min_h, max_h, step_counter, grid_idx);
+        }
+
+        // Update min_h/max_h.
+        const auto abs_h = abs(h);
+        min_h = std::min(min_h, abs_h);
+        max_h = std::max(max_h, abs_h);
+
+        // Stop if the stiffness was detected. The state vectors
+        // are available for the grid points within the last timestep.
+        if (res == taylor_outcome::stiff) {
+            return make_retval(res, min_h, max_h, step_counter, grid_idx);
+        }
+    }
+
+    return make_retval(taylor_outcome::time_limit, min_h, max_h, step_counter, grid.size());
+}
+
+// Compute the dense output at the time coordinate t, using the Taylor
+// coefficients from the last timestep. The dense output is meaningful
+// only if the Taylor coefficients have been written to m_tc during
+// the last timestep (i.e., step() was invoked with wtc = true), and
+// t is within the last timestep.
+template <typename T>
+const std::vector<T> &taylor_adaptive_impl<T>::update_d_output(T t)
+{
+    using std::isfinite;
+
+    if (!isfinite(t)) {
+        throw std::invalid_argument(
+            "Cannot compute the dense output of an adaptive Taylor integrator at the non-finite time "
+            + li_to_string(t));
+    }
+
+    // NOTE: the Taylor polynomials are expanded around the time coordinate
+    // at the beginning of the last timestep, that is, m_time - m_last_h.
+    const auto h = ((t - m_time) - m_time_lo) + m_last_h;
+
+    get_d_out_f()(m_d_out.data(), m_tc.data(), &h);
+
+    return m_d_out;
+}
+
+// Reset the cooldowns of the terminal events.
+template <typename T>
+void taylor_adaptive_impl<T>::reset_cooldowns()
+{
+    for (auto &cd : m_te_cooldowns) {
+        cd.reset();
+    }
+}
+
+// NOTE: the validation mirrors the checks in finalise_ctor_impl(). The state
+// and the parameters are copied into the current buffers (which may be external,
+// see bind_buffers()), without any reallocation.
+template <typename T>
+void taylor_adaptive_impl<T>::reset_impl(const std::vector<T> &state, T time, const std::vector<T> *pars)
+{
+    using std::isfinite;
+
+    if (state.size() != m_state.size()) {
+        throw std::invalid_argument("Invalid state vector passed to the reset() function of an adaptive Taylor "
+                                    "integrator: the size of the state vector is "
+                                    + std::to_string(state.size()) + ", but it must be "
+                                    + std::to_string(m_state.size()));
+    }
+
+    if (std::any_of(state.begin(), state.end(), [](const auto &x) { return !isfinite(x); })) {
+        throw std::invalid_argument(
+            "A non-finite value was detected in the state vector passed to the reset() function of an adaptive "
+            "Taylor integrator");
+    }
+
+    if (!isfinite(time)) {
+        throw std::invalid_argument(
+            "A non-finite time was passed to the reset() function of an adaptive Taylor integrator");
+    }
+
+    if (pars != nullptr && pars->size() != m_pars.size()) {
+        throw std::invalid_argument("Invalid vector of parameters passed to the reset() function of an adaptive "
+                                    "Taylor integrator: the size of the vector is "
+                                    + std::to_string(pars->size()) + ", but it must be "
+                                    + std::to_string(m_pars.size()));
+    }
+
+    std::copy(state.begin(), state.end(), get_state_data());
+    if (pars != nullptr) {
+        std::copy(pars->begin(), pars->end(), get_pars_data());
+    }
+
+    m_time = time;
+    m_time_lo = 0;
+
+    // Clear the per-run data.
+    // NOTE: a zero last timestep signals that the Taylor
+    // coefficients do not refer to a previous step (e.g.,
+    // in the variable-order integration).
+    m_last_h = 0;
+    m_pred_h = 0;
+    reset_cooldowns();
+}
+
+template <typename T>
+void taylor_adaptive_impl<T>::reset(const std::vector<T> &state, T time)
+{
+    reset_impl(state, time, nullptr);
+}
+
+template <typename T>
+void taylor_adaptive_impl<T>::reset(const std::vector<T> &state, T time, const std::vector<T> &pars)
+{
+    reset_impl(state, time, &pars);
+}
+
+namespace
+{
+
+// Helpers to write/read the header of the binary
+// serialisation format of the adaptive integrators.
+// The header contains the name of the integrator class,
+// the version of heyoka and information about the
+// floating-point type.
+template <typename T>
+void taylor_save_header(std::ostream &os, const std::string &name)
+{
+    bin_save(os, name);
+    bin_save(os, std::string{HEYOKA_VERSION_STRING});
+    bin_save(os, static_cast<std::uint32_t>(sizeof(T)));
+    bin_save(os, static_cast<std::int32_t>(std::numeric_limits<T>::digits));
+}
+
+template <typename T>
+void taylor_load_header(std::istream &is, const std::string &name)
+{
+    std::string s_name, version;
+    std::uint32_t size = 0;
+    std::int32_t digits = 0;
+
+    bin_load(is, s_name);
+    if (s_name != name) {
+        throw std::invalid_argument("Error loading an integrator of type '" + name
+                                    + "' from an input stream: the stream contains an object of type '" + s_name
+                                    + "' instead");
+    }
+
+    bin_load(is, version);
+    if (version != HEYOKA_VERSION_STRING) {
+        throw std::invalid_argument("Error loading an integrator from an input stream: the integrator was saved with "
+                                    "heyoka version "
+                                    + version + ", but the current heyoka version is " + HEYOKA_VERSION_STRING);
+    }
+
+    bin_load(is, size);
+    bin_load(is, digits);
+    if (size != sizeof(T) || digits != std::numeric_limits<T>::digits) {
+        throw std::invalid_argument(
+            "Error loading an integrator from an input stream: the floating-point type is inconsistent");
+    }
+}
+
+} // namespace
+
+template <typename T>
+void taylor_adaptive_impl<T>::save(std::ostream &os) const
+{
+    if (!m_tes.empty() || !m_ntes.empty()) {
+        throw std::invalid_argument("Cannot save an adaptive Taylor integrator containing events (the event "
+                                    "callbacks cannot be serialised)");
+    }
+
+    taylor_save_header<T>(os, "taylor_adaptive");
+
+    // NOTE: save the contents of the
+    // external buffers, if bound.
+    bin_save(os, std::vector<T>(get_state_data(), get_state_data() + m_state.size()));
+    bin_save(os, m_time);
+    bin_save(os, m_dim);
+    bin_save(os, get_decomposition());
+    bin_save(os, m_order);
+    bin_save(os, std::vector<T>(get_pars_data(), get_pars_data() + m_pars.size()));
+    bin_save(os, m_tc);
+    bin_save(os, m_last_h);
+    bin_save(os, m_d_out);
+    bin_save(os, m_compact_mode);
+    bin_save(os, m_pgo_steps);
+    bin_save(os, m_time_lo);
+    bin_save(os, m_comp_time);
+    bin_save(os, m_predict_h);
+    bin_save(os, m_pred_h);
+    bin_save(os, m_vo_orders);
+    bin_save(os, m_vo_log_rhofac);
+    bin_save(os, m_vo_idx);
+
+    m_llvm.save(os);
+}
+
+template <typename T>
+void taylor_adaptive_impl<T>::load(std::istream &is)
+{
+    taylor_load_header<T>(is, "taylor_adaptive");
+
+    // NOTE: load everything into temporaries first,
+    // so that this is not altered if an error occurs.
+    std::vector<T> state, pars, tc, d_out, vo_log_rhofac;
+    T time(0), time_lo(0), last_h(0), pred_h(0);
+    std::uint32_t dim = 0, order = 0, vo_idx = 0;
+    std::vector<std::pair<expression, std::vector<std::uint32_t>>> dc;
+    bool compact_mode = false, comp_time = false, predict_h = false;
+    std::size_t pgo_steps = 0;
+    std::vector<std::uint32_t> vo_orders;
+    llvm_state llvm;
+
+    bin_load(is, state);
+    bin_load(is, time);
+    bin_load(is, dim);
+    bin_load(is, dc);
+    bin_load(is, order);
+    bin_load(is, pars);
+    bin_load(is, tc);
+    bin_load(is, last_h);
+    bin_load(is, d_out);
+    bin_load(is, compact_mode);
+    bin_load(is, pgo_steps);
+    bin_load(is, time_lo);
+    bin_load(is, comp_time);
+    bin_load(is, predict_h);
+    bin_load(is, pred_h);
+    bin_load(is, vo_orders);
+    bin_load(is, vo_log_rhofac);
+    bin_load(is, vo_idx);
+
+    llvm.load(is);
+
+    // Minimal consistency checks.
+    // NOTE: in the variable-order integration, the Taylor
+    // coefficients are sized for the highest order.
+    const auto var_order = !vo_orders.empty();
+    if (var_order
+        && (vo_log_rhofac.size() != vo_orders.size() || vo_idx >= vo_orders.size() || vo_orders[vo_idx] != order)) {
+        throw std::invalid_argument("Inconsistent data detected while loading an adaptive Taylor integrator");
+    }
+    const auto max_order = var_order ? vo_orders.back() : order;
+    if (state.size() != dim || d_out.size() != dim
+        || tc.size() != static_cast<decltype(tc.size())>(dim) * (max_order + 1u) || !llvm.is_compiled()) {
+        throw std::invalid_argument("Inconsistent data detected while loading an adaptive Taylor integrator");
+    }
+
+    std::vector<step_f_t> vo_step_f;
+    for (const auto o : vo_orders) {
+        vo_step_f.push_back(reinterpret_cast<step_f_t>(llvm.jit_lookup("step_" + std::to_string(o))));
+    }
+    const auto step_f = var_order ? vo_step_f[vo_idx] : reinterpret_cast<step_f_t>(llvm.jit_lookup("step"));
+    const auto d_out_f = var_order ? d_out_f_t(nullptr) : reinterpret_cast<d_out_f_t>(llvm.jit_lookup("d_out_f"));
+
+    m_state = std::move(state);
+    m_time = time;
+    m_time_lo = time_lo;
+    m_llvm = std::move(llvm);
+    m_dim = dim;
+    m_dc = taylor_share_dc(std::move(dc));
+    m_keep_alive = taylor_dc_keep_alive(m_dc);
+    m_order = order;
+    m_step_f = step_f;
+    m_pars = std::move(pars);
+    m_ext_state = nullptr;
+    m_ext_pars = nullptr;
+    m_tc = std::move(tc);
+    m_last_h = last_h;
+    m_d_out_f = d_out_f;
+    m_prop_f = nullptr;
+    m_d_out = std::move(d_out);
+    m_compact_mode = compact_mode;
+    m_comp_time = comp_time;
+    m_predict_h = predict_h;
+    m_pred_h = pred_h;
+    m_pgo_steps = pgo_steps;
+    m_vo_orders = std::move(vo_orders);
+    m_vo_step_f = std::move(vo_step_f);
+    m_vo_d_out_f.assign(m_vo_orders.size(), nullptr);
+    m_vo_log_rhofac = std::move(vo_log_rhofac);
+    m_vo_idx = vo_idx;
+
+    m_tes.clear();
+    m_ntes.clear();
+    m_te_cooldowns.clear();
+
+    // NOTE: the monitor of the invariants and the background
+    // compilation refer to the previous system.
+    m_inv.reset();
+    m_opt_fut = std::future<llvm_state>{};
+
+    // NOTE: the stiffness detection is not serialised.
+    disable_stiffness_detection();
+}
+
+template <typename T>
+const llvm_state &taylor_adaptive_impl<T>::get_llvm_state() const
+{
+    return m_llvm;
+}
+
+template <typename T>
+const std::vector<std::pair<expression, std::vector<std::uint32_t>>> &taylor_adaptive_impl<T>::get_decomposition() const
+{
+    return taylor_dc_or_empty(m_dc);
+}
+
+template <typename T>
+std::uint32_t taylor_adaptive_impl<T>::get_order() const
+{
+    return m_order;
+}
+
+template <typename T>
+const std::vector<std::uint32_t> &taylor_adaptive_impl<T>::get_orders() const
+{
+    return m_vo_orders;
+}
+
+namespace
+{
+
+// Check the external buffers for the state and the parameters of an adaptive
+// Taylor integrator (of sizes state_size and pars_size respectively).
+// NOTE: the compiled functions access the buffers via scalar loads/stores
+// (see load_vector_from_memory()/store_vector_to_memory()), thus the natural
+// alignment of T is sufficient. The buffers cannot overlap, as the compiled
+// functions assume no aliasing between the state and the parameters.
+template <typename T>
+void taylor_check_ext_buffers(const T *state, std::size_t state_size, const T *pars, std::size_t pars_size)
+{
+    for (const auto *ptr : {state, pars}) {
+        if (reinterpret_cast<std::uintptr_t>(ptr) % alignof(T) != 0u) {
+            throw std::invalid_argument("An external buffer for an adaptive Taylor integrator must be aligned to "
+                                        + std::to_string(alignof(T)) + " bytes");
+        }
+    }
+
+    const auto *state_end = state + (state == nullptr ? 0u : state_size);
+    const auto *pars_end = pars + (pars == nullptr ? 0u : pars_size);
+
+    if (state != nullptr && pars != nullptr && state_size > 0u && pars_size > 0u
+        && std::less<const T *>{}(state, pars_end) && std::less<const T *>{}(pars, state_end)) {
+        throw std::invalid_argument(
+            "The external buffers for the state and the parameters of an adaptive Taylor integrator cannot overlap");
+    }
+}
+
+} // namespace
+
+template <typename T>
+void taylor_adaptive_impl<T>::set_dtime(T hi, T lo)
+{
+    using std::isfinite;
+
+    if (!isfinite(hi) || !isfinite(lo)) {
+        throw std::invalid_argument("A non-finite time was passed to the set_dtime() function of an adaptive "
+                                    "Taylor integrator");
+    }
+
+    if (!m_comp_time && lo != 0) {
+        throw std::invalid_argument("A nonzero low-order part of the time can be passed to the set_dtime() function "
+                                    "of an adaptive Taylor integrator only with the compensated summation of the time");
+    }
+
+    // NOTE: normalise the double-length value.
+    m_time = hi;
+    m_time_lo = 0;
+    taylor_time_add(m_time, m_time_lo, lo, m_comp_time);
+}
+
+template <typename T>
+const std::vector<T> &taylor_adaptive_impl<T>::get_state() const
+{
+    if (m_ext_state != nullptr) {
+        throw std::invalid_argument("The state vector of an adaptive Taylor integrator cannot be fetched while an "
+                                    "external buffer is bound: use get_state_data() instead");
+    }
+
+    return m_state;
+}
+
+template <typename T>
+const std::vector<T> &taylor_adaptive_impl<T>::get_pars() const
+{
+    if (m_ext_pars != nullptr) {
+        throw std::invalid_argument("The parameters of an adaptive Taylor integrator cannot be fetched while an "
+                                    "external buffer is bound: use get_pars_data() instead");
+    }
+
+    return m_pars;
+}
+
+template <typename T>
+void taylor_adaptive_impl<T>::bind_buffers(T *state, T *pars)
+{
+    taylor_check_ext_buffers(state, m_state.size(), pars, m_pars.size());
+
+    m_ext_state = state;
+    m_ext_pars = pars;
+}
+
+// NOTE: the current contents of the external
+// buffers are copied into the internal buffers.
+template <typename T>
+void taylor_adaptive_impl<T>::unbind_buffers()
+{
+    std::copy(get_state_data(), get_state_data() + m_state.size(), m_state.begin());
+    std::copy(get_pars_data(), get_pars_data() + m_pars.size(), m_pars.begin());
+
+    m_ext_state = nullptr;
+    m_ext_pars = nullptr;
+}
+
+template <typename T>
+std::uint32_t taylor_adaptive_impl<T>::get_dim() const
+{
+    return m_dim;
+}
+
+// Explicit instantiation of the implementation classes/functions.
+// NOTE: on Windows apparently it is necessary to declare that
+// these instantiations are meant to be dll-exported.
+} // namespace detail
+
+template <typename T>
+taylor_checkpoints<T>::taylor_checkpoints() = default;
+
+template <typename T>
+taylor_checkpoints<T>::taylor_checkpoints(std::uint32_t dim, std::uint32_t order)
+    : m_dim(dim), m_order(order), m_out(dim)
+{
+    if (m_dim == 0u || m_order == 0u) {
+        throw std::invalid_argument("The dimension and the order of a store of checkpoints must be nonzero");
+    }
+
+    // LCOV_EXCL_START
+    if (m_order == std::numeric_limits<std::uint32_t>::max()
+        || m_dim > std::numeric_limits<std::size_t>::max() / (m_order + 1u)) {
+        throw std::overflow_error("Overflow detected in the creation of a store of checkpoints");
+    }
+    // LCOV_EXCL_STOP
+}
+
+template <typename T>
+std::pair<T, T> taylor_checkpoints<T>::get_bounds() const
+{
+    if (m_times.empty()) {
+        throw std::invalid_argument("Cannot fetch the bounds of an empty store of checkpoints");
+    }
+
+    return {m_times.front(), m_times.back()};
+}
+
+// NOTE: the Taylor coefficients in tc are in the layout
+// of the Taylor coefficients of the scalar integrator.
+template <typename T>
+void taylor_checkpoints<T>::add_step(T t0, T t1, const T *tc)
+{
+    using std::isfinite;
+
+    assert(tc != nullptr);
+
+    if (!isfinite(t0) || !isfinite(t1) || t0 == t1) {
+        throw std::invalid_argument("Invalid time range [" + detail::li_to_string(t0) + ", " + detail::li_to_string(t1)
+                                    + "] passed to the add_step() function of a store of checkpoints");
+    }
+
+    if (!m_times.empty()) {
+        if (t0 != m_times.back()) {
+            throw std::invalid_argument(
+                "The steps recorded in a store of checkpoints must be contiguous: the step begins at the time "
+                + detail::li_to_string(t0) + ", but the last recorded step ends at the time "
+                + detail::li_to_string(m_times.back()));
+        }
+
+        if ((t1 > t0) != (m_times.back() > m_times.front())) {
+            throw std::invalid_argument(
+                "The steps recorded in a store of checkpoints must be all in the same direction in time");
+        }
+    }
+
+    const auto n_tc = static_cast<std::size_t>(m_dim) * (m_order + 1u);
+
+    if (m_times.empty()) {
+        m_times.push_back(t0);
+    }
+    m_times.push_back(t1);
+    m_tcs.insert(m_tcs.end(), tc, tc + n_tc);
+}
+
+template <typename T>
+void taylor_checkpoints<T>::clear()
+{
+    m_times.clear();
+    m_tcs.clear();
+}
+
+template <typename T>
+void taylor_checkpoints<T>::shrink_to_fit()
+{
+    m_times.shrink_to_fit();
+    m_tcs.shrink_to_fit();
+}
+
+template <typename T>
+const std::vector<T> &taylor_checkpoints<T>::operator()(T t)
+{
+    using std::isnan;
+
+    if (m_times.empty()) {
+        throw std::invalid_argument("Cannot evaluate an empty store of checkpoints");
+    }
+
+    const auto fwd = m_times.back() > m_times.front();
+    const auto [t_min, t_max] = fwd ? get_bounds() : std::pair{m_times.back(), m_times.front()};
+
+    if (isnan(t) || t < t_min || t > t_max) {
+        throw std::invalid_argument("Cannot evaluate a store of checkpoints at the time " + detail::li_to_string(t)
+                                    + ", which is outside the time range [" + detail::li_to_string(t_min) + ", "
+                                    + detail::li_to_string(t_max) + "] of the recorded steps");
+    }
+
+    // Locate the step containing t via binary search.
+    // NOTE: the end of the last step belongs to the last step.
+    auto it = fwd ? std::upper_bound(m_times.begin(), m_times.end(), t)
+                  : std::upper_bound(m_times.begin(), m_times.end(), t, std::greater<T>{});
+    const auto step_idx = std::min(static_cast<std::size_t>(it - m_times.begin()), m_times.size() - 1u) - 1u;
+
+    // Evaluate the Taylor polynomials via the Horner scheme.
+    const auto h = t - m_times[step_idx];
+    const auto *tc = m_tcs.data() + step_idx * (static_cast<std::size_t>(m_dim) * (m_order + 1u));
+
+    for (std::uint32_t i = 0; i < m_dim; ++i) {
+        const auto *cur_tc = tc + static_cast<std::size_t>(i) * (m_order + 1u);
+
+        auto acc = cur_tc[m_order];
+        for (std::uint32_t o = 1; o <= m_order; ++o) {
+            acc = cur_tc[m_order - o] + acc * h;
+        }
+
+        m_out[i] = acc;
+    }
+
+    return m_out;
+}
+
+template <typename T>
+void taylor_checkpoints<T>::save(std::ostream &os) const
+{
+    detail::taylor_save_header<T>(os, "taylor_checkpoints");
+
+    detail::bin_save(os, m_dim);
+    detail::bin_save(os, m_order);
+    detail::bin_save(os, m_times);
+    detail::bin_save(os, m_tcs);
+}
+
+template <typename T>
+void taylor_checkpoints<T>::load(std::istream &is)
+{
+    detail::taylor_load_header<T>(is, "taylor_checkpoints");
+
+    std::uint32_t dim = 0, order = 0;
+    std::vector<T> times, tcs;
+
+    detail::bin_load(is, dim);
+    detail::bin_load(is, order);
+    detail::bin_load(is, times);
+    detail::bin_load(is, tcs);
+
+    // NOTE: the validation of the dimension and of the order
+    // is performed by the constructor.
+    taylor_checkpoints tmp(dim, order);
+    if (times.size() == 1u
+        || tcs.size() != (times.empty() ? 0u : times.size() - 1u) * (static_cast<std::size_t>(dim) * (order + 1u))) {
+        throw std::invalid_argument("Error loading a store of checkpoints from an input stream: the sizes of the "
+                                    "times and of the Taylor coefficients are inconsistent");
+    }
+
+    tmp.m_times = std::move(times);
+    tmp.m_tcs = std::move(tcs);
+
+    *this = std::move(tmp);
+}
+
+template class taylor_checkpoints<double>;
+template class taylor_checkpoints<long double>;
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+template class taylor_checkpoints<mppp::real128>;
+
+#endif
+
+namespace detail
+{
+
+template struct taylor_invariants_deleter<double>;
+template class taylor_adaptive_impl<double>;
+template HEYOKA_DLL_PUBLIC void taylor_adaptive_impl<double>::finalise_ctor_impl(
+    std::vector<expression>, std::vector<double>, double, double, bool, bool, std::vector<double>,
+    std::vector<t_event_t>, std::vector<nt_event_t>, std::vector<std::string>, std::size_t, taylor_sort_strategy, bool,
+    std::uint32_t, taylor_jet_layout, double, double, std::vector<double>,
+    std::vector<std::uint32_t>, bool, bool, bool, bool, std::uint32_t, bool);
+template HEYOKA_DLL_PUBLIC void taylor_adaptive_impl<double>::finalise_ctor_impl(
+    std::vector<std::pair<expression, expression>>, std::vector<double>, double, double, bool, bool,
+    std::vector<double>, std::vector<t_event_t>, std::vector<nt_event_t>, std::vector<std::string>, std::size_t,
+    taylor_sort_strategy, bool, std::uint32_t, taylor_jet_layout, double, double, std::vector<double>,
+    std::vector<std::uint32_t>, bool, bool, bool, bool, std::uint32_t, bool);
+template HEYOKA_DLL_PUBLIC void taylor_adaptive_impl<double>::finalise_ctor_impl(
+    taylor_dc_t, std::vector<double>, double, double, bool, bool,
+    std::vector<double>, std::vector<t_event_t>, std::vector<nt_event_t>, std::vector<std::string>, std::size_t,
+    taylor_sort_strategy, bool, std::uint32_t, taylor_jet_layout, double, double, std::vector<double>,
+    std::vector<std::uint32_t>, bool, bool, bool, bool, std::uint32_t, bool);
+
+template struct taylor_invariants_deleter<long double>;
+template class taylor_adaptive_impl<long double>;
+template HEYOKA_DLL_PUBLIC void taylor_adaptive_impl<long double>::finalise_ctor_impl(
+    std::vector<expression>, std::vector<long double>, long double, long double, bool, bool, std::vector<long double>,
+    std::vector<t_event_t>, std::vector<nt_event_t>, std::vector<std::string>, std::size_t, taylor_sort_strategy, bool,
+    std::uint32_t, taylor_jet_layout, long double, long double, std::vector<long double>,
+    std::vector<std::uint32_t>, bool, bool, bool, bool, std::uint32_t, bool);
+template HEYOKA_DLL_PUBLIC void taylor_adaptive_impl<long double>::finalise_ctor_impl(
+    std::vector<std::pair<expression, expression>>, std::vector<long double>, long double, long double, bool, bool,
+    std::vector<long double>, std::vector<t_event_t>, std::vector<nt_event_t>, std::vector<std::string>, std::size_t,
+    taylor_sort_strategy, bool, std::uint32_t, taylor_jet_layout, long double, long double, std::vector<long double>,
+    std::vector<std::uint32_t>, bool, bool, bool, bool, std::uint32_t, bool);
+template HEYOKA_DLL_PUBLIC void taylor_adaptive_impl<long double>::finalise_ctor_impl(
+    taylor_dc_t, std::vector<long double>, long double, long double, bool, bool,
+    std::vector<long double>, std::vector<t_event_t>, std::vector<nt_event_t>, std::vector<std::string>, std::size_t,
+    taylor_sort_strategy, bool, std::uint32_t, taylor_jet_layout, long double, long double, std::vector<long double>,
+    std::vector<std::uint32_t>, bool, bool, bool, bool, std::uint32_t, bool);
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+template struct taylor_invariants_deleter<mppp::real128>;
+template class taylor_adaptive_impl<mppp::real128>;
+template HEYOKA_DLL_PUBLIC void taylor_adaptive_impl<mppp::real128>::finalise_ctor_impl(
+    std::vector<expression>, std::vector<mppp::real128>, mppp::real128, mppp::real128, bool, bool,
+    std::vector<mppp::real128>, std::vector<t_event_t>, std::vector<nt_event_t>, std::vector<std::string>, std::size_t,
+    taylor_sort_strategy, bool, std::uint32_t, taylor_jet_layout, mppp::real128, mppp::real128,
+    std::vector<mppp::real128>, std::vector<std::uint32_t>, bool, bool, bool, bool, std::uint32_t, bool);
+template HEYOKA_DLL_PUBLIC void taylor_adaptive_impl<mppp::real128>::finalise_ctor_impl(
+    std::vector<std::pair<expression, expression>>, std::vector<mppp::real128>, mppp::real128, mppp::real128, bool,
+    bool, std::vector<mppp::real128>, std::vector<t_event_t>, std::vector<nt_event_t>, std::vector<std::string>,
+    std::size_t, taylor_sort_strategy, bool, std::uint32_t, taylor_jet_layout, mppp::real128, mppp::real128,
+    std::vector<mppp::real128>, std::vector<std::uint32_t>, bool, bool, bool, bool, std::uint32_t, bool);
+template HEYOKA_DLL_PUBLIC void taylor_adaptive_impl<mppp::real128>::finalise_ctor_impl(
+    taylor_dc_t, std::vector<mppp::real128>, mppp::real128, mppp::real128, bool,
+    bool, std::vector<mppp::real128>, std::vector<t_event_t>, std::vector<nt_event_t>, std::vector<std::string>,
+    std::size_t, taylor_sort_strategy, bool, std::uint32_t, taylor_jet_layout, mppp::real128, mppp::real128,
+    std::vector<mppp::real128>, std::vector<std::uint32_t>, bool, bool, bool, bool, std::uint32_t, bool);
+
+#endif
+
+} // namespace detail
+
+namespace detail
+{
+
+template <typename T>
+template <typename U>
+void taylor_adaptive_batch_impl<T>::finalise_ctor_impl(U sys, std::vector<T> state, std::uint32_t batch_size,
+                                                       std::vector<T> time, T tol, bool high_accuracy,
+                                                       bool compact_mode, std::vector<T> pars,
+                                                       std::vector<std::string> isa_variants, std::size_t pgo_steps,
+                                                       taylor_sort_strategy sort_strategy, bool parallel_mode,
+                                                       std::uint32_t unroll_threshold, taylor_jet_layout jet_layout,
+                                                       T rtol, T atol, std::vector<T> err_weights,
+                                                       bool compensated_time, bool predict_h, bool estrin,
+                                                       std::uint32_t order, bool mem_hints)
+{
+    using std::isfinite;
+
+    // Init the data members.
+    m_batch_size = batch_size;
+    m_state = std::move(state);
+    m_time = std::move(time);
+    m_pars = std::move(pars);
+    m_compact_mode = compact_mode;
+    m_comp_time = compensated_time;
+    m_predict_h = predict_h;
+    m_pgo_steps = pgo_steps;
+
+    // Check input params.
+    if (m_batch_size == 0u) {
+        throw std::invalid_argument("The batch size in an adaptive Taylor integrator cannot be zero");
+    }
+
+    if (std::any_of(m_state.begin(), m_state.end(), [](const auto &x) { return !isfinite(x); })) {
+        throw std::invalid_argument(
+            "A non-finite value was detected in the initial state of an adaptive Taylor integrator");
+    }
+
+    if (m_state.size() % m_batch_size != 0u) {
+        throw std::invalid_argument("Invalid size detected in the initialization of an adaptive Taylor "
+                                    "integrator: the state vector has a size of "
+                                    + std::to_string(m_state.size()) + ", which is not a multiple of the batch size ("
+                                    + std::to_string(m_batch_size) + ")");
+    }
+
+    // NOTE: this also validates a precomputed Taylor decomposition.
+    const auto n_eq = taylor_n_eq(sys);
+
+    if (m_state.size() / m_batch_size != n_eq) {
+        throw std::invalid_argument("Inconsistent sizes detected in the initialization of an adaptive Taylor "
+                                    "integrator: the state vector has a dimension of "
+                                    + std::to_string(m_state.size() / m_batch_size)
+                                    + ", while the number of equations is " + std::to_string(n_eq));
+    }
+
+    if (m_time.size() != m_batch_size) {
+        throw std::invalid_argument("Invalid size detected in the initialization of an adaptive Taylor "
+                                    "integrator: the time vector has a size of "
+                                    + std::to_string(m_time.size()) + ", which is not equal to the batch size ("
+                                    + std::to_string(m_batch_size) + ")");
+    }
+
+    if (std::any_of(m_time.begin(), m_time.end(), [](const auto &x) { return !isfinite(x); })) {
+        throw std::invalid_argument(
+            "A non-finite initial time was detected in the initialisation of an adaptive Taylor integrator");
+    }
+
+    m_time_lo.resize(m_time.size());
+
+    if (!isfinite(tol) || tol <= 0) {
+        throw std::invalid_argument(
+            "The tolerance in an adaptive Taylor integrator must be finite and positive, but it is " + li_to_string(tol)
+            + " instead");
+    }
+
+    // NOTE: zero means the order deduced from the tolerance.
+    if (order == 1u) {
+        throw std::invalid_argument("The order of an adaptive Taylor integrator must be at least 2");
+    }
+
+    // Fix m_pars' size, if necessary.
+    const auto npars = n_pars_in_sys(sys);
+    if (npars > std::numeric_limits<std::uint32_t>::max() / m_batch_size) {
+        throw std::overflow_error(
+            "Overflow detected when computing the size of the parameter array in an adaptive Taylor integrator");
+    }
+    if constexpr (std::is_same_v<U, taylor_dc_t>) {
+        // NOTE: see the scalar integrator.
+        if (m_pars.size() != npars * m_batch_size) {
+            using namespace fmt::literals;
+
+            throw std::invalid_argument(
+                "Invalid number of parameter values passed to the constructor of an adaptive Taylor integrator from "
+                "a precomputed decomposition: {} parameter values were passed, but the decomposition contains {} "
+                "parameters (in batches of {})"_format(m_pars.size(), npars, m_batch_size));
+        }
+    } else if (m_pars.size() < npars * m_batch_size) {
+        m_pars.resize(boost::numeric_cast<decltype(m_pars.size())>(npars * m_batch_size));
+    } else if (m_pars.size() > npars * m_batch_size) {
+        using namespace fmt::literals;
+
+        throw std::invalid_argument(
+            "Excessive number of parameter values passed to the constructor of an adaptive "
+            "Taylor integrator: {} parameter values were passed, but the ODE system contains only {} parameters "
+            "(in batches of {})"_format(m_pars.size(), npars, m_batch_size));
+    }
+
+    // Store the dimension of the system.
+    m_dim = n_eq;
+
+    if (m_deferred && (!isa_variants.empty() || m_pgo_steps > 0u)) {
+        throw std::invalid_argument("The ISA variants and the profile-guided optimisation are not supported in the "
+                                    "construction of an adaptive batch Taylor integrator via taylor_multi_builder");
+    }
+
+    // Add the ISA variants of the integrator, if requested.
+    // NOTE: this mirrors the scalar integrator.
+    for (const auto &cpu : isa_variants) {
+        auto vs = m_llvm.make_variant(cpu);
+
+        {
+            opt_disabler od(vs);
+
+            const auto v_order = std::get<1>(
+                taylor_add_adaptive_step_impl<T>(vs, "step", sys, tol, m_batch_size, high_accuracy, compact_mode, {},
+                                                 sort_strategy, parallel_mode, unroll_threshold, jet_layout, rtol,
+                                                 atol, err_weights, order, predict_h, false, estrin, mem_hints));
+            taylor_add_d_out_function<T>(vs, m_dim, v_order, m_batch_size, compact_mode);
+        }
+
+        vs.optimise();
+        vs.compile();
+
+        m_llvm.add_variant(vs);
+    }
+
+    // Instrument the stepper for the profile-guided
+    // optimisation, if requested.
+    if (m_pgo_steps > 0u) {
+        m_llvm.pgo_instrument();
+    }
+
+    {
+        // NOTE: disable the optimisations while the stepper is being added,
+        // the optimisation pass will be run below on the whole module.
+        opt_disabler od(m_llvm);
+
+        // Add the stepper function.
+        auto [dc, s_order]
+            = taylor_add_adaptive_step_impl<T>(m_llvm, "step", std::move(sys), tol, m_batch_size, high_accuracy,
+                                               compact_mode, {}, sort_strategy, parallel_mode, unroll_threshold,
+                                               jet_layout, rtol, atol, std::move(err_weights), order, predict_h, false,
+                                               estrin, mem_hints);
+        m_dc = taylor_share_dc(std::move(dc));
+        m_keep_alive = taylor_dc_keep_alive(m_dc);
+        m_order = s_order;
+
+        // Add the function for the computation of
+        // the dense output.
+        taylor_add_d_out_function<T>(m_llvm, m_dim, m_order, m_batch_size, compact_mode);
+    }
+
+    // Run the optimisation pass.
+    // NOTE: see the scalar counterpart for the deferred compilation.
+    if (!m_deferred) {
+        m_llvm.optimise();
+    }
+
+    // NOTE: the dense output function is compiled
+    // lazily, as it is not needed by many use cases.
+    m_llvm.mark_lazy("d_out_f");
+
+    if (!m_deferred) {
+        // Run the jit.
+        m_llvm.compile();
+
+        // Fetch the stepper.
+        m_step_f = reinterpret_cast<step_f_t>(m_llvm.jit_lookup("step"));
+    }
+
+    // NOTE: the function to compute the dense
+    // output will be fetched on first use.
+    m_d_out_f = nullptr;
+
+    // Setup the vector for the Taylor coefficients.
+    // LCOV_EXCL_START
+    if (m_order == std::numeric_limits<std::uint32_t>::max()
+        || m_state.size() > std::numeric_limits<decltype(m_tc.size())>::max() / (m_order + 1u)) {
+        throw std::overflow_error("Overflow detected in the initialisation of an adaptive Taylor integrator: the order "
+                                  "or the state size is too large");
+    }
+    // LCOV_EXCL_STOP
+
+    // NOTE: the size of m_state.size() already takes
+    // into account the batch size.
+    m_tc.resize(m_state.size() * (m_order + 1u));
+
+    // Init the sizes of the last timesteps.
+    m_last_h.resize(m_batch_size);
+
+    // Setup the vector for the dense output.
+    m_d_out.resize(m_state.size());
+
+    // Prepare the temp vectors.
+    m_pinf.resize(m_batch_size, std::numeric_limits<T>::infinity());
+    m_minf.resize(m_batch_size, -std::numeric_limits<T>::infinity());
+    // NOTE: with the step size prediction, the predicted
+    // timesteps are initialised to zero.
+    m_delta_ts.resize(m_predict_h ? 2u * m_batch_size : m_batch_size);
+
+    // NOTE: default init of these vectors is fine.
+    m_step_res.resize(boost::numeric_cast<decltype(m_step_res.size())>(m_batch_size));
+    m_prop_res.resize(boost::numeric_cast<decltype(m_prop_res.size())>(m_batch_size));
+
+    m_ts_count.resize(boost::numeric_cast<decltype(m_ts_count.size())>(m_batch_size));
+    m_min_abs_h.resize(m_batch_size);
+    m_max_abs_h.resize(m_batch_size);
+    m_cur_max_delta_ts.resize(m_batch_size);
+    m_pfor_ts.resize(m_batch_size);
+    m_d_out_time.resize(m_batch_size);
+    m_grid_idx.resize(boost::numeric_cast<decltype(m_grid_idx.size())>(m_batch_size));
+    m_grid_lane_t.resize(m_batch_size);
+}
+
+// NOTE: the default constructor builds an integrator
+// for the trivial ODE x' = 0, with a batch size of 1.
+template <typename T>
+taylor_adaptive_batch_impl<T>::taylor_adaptive_batch_impl()
+    : taylor_adaptive_batch_impl(std::vector<std::pair<expression, expression>>{{"x"_var, 0_dbl}},
+                                 std::vector<T>{T(0)}, 1)
+{
+}
+
+// NOTE: see the scalar counterpart.
+template <typename T>
+void taylor_adaptive_batch_impl<T>::finalise_deferred(const llvm_state &s, std::string prefix)
+{
+    assert(m_deferred);
+
+    m_llvm = s;
+    m_llvm.set_symbol_prefix(std::move(prefix));
+
+    m_step_f = reinterpret_cast<step_f_t>(m_llvm.jit_lookup("step"));
+    m_d_out_f = nullptr;
+
+    m_deferred = false;
+}
+
+// NOTE: see the scalar counterpart for the handling of the LLVM state.
+template <typename T>
+taylor_adaptive_batch_impl<T>::taylor_adaptive_batch_impl(const taylor_adaptive_batch_impl &other)
+    // NOTE: make a manual copy of all members, apart from the function pointers.
+    : m_batch_size(other.m_batch_size), m_state(other.m_state), m_time(other.m_time), m_time_lo(other.m_time_lo),
+      m_llvm(other.m_compact_mode ? other.m_llvm.deep_copy() : other.m_llvm), m_dim(other.m_dim), m_dc(other.m_dc),
+      m_keep_alive(other.m_keep_alive), m_order(other.m_order), m_pars(other.m_pars), m_tc(other.m_tc),
+      m_last_h(other.m_last_h), m_d_out(other.m_d_out), m_compact_mode(other.m_compact_mode),
+      m_comp_time(other.m_comp_time), m_predict_h(other.m_predict_h), m_pgo_steps(other.m_pgo_steps),
+      m_pinf(other.m_pinf), m_minf(other.m_minf), m_delta_ts(other.m_delta_ts), m_step_res(other.m_step_res),
+      m_prop_res(other.m_prop_res), m_ts_count(other.m_ts_count), m_min_abs_h(other.m_min_abs_h),
+      m_max_abs_h(other.m_max_abs_h), m_cur_max_delta_ts(other.m_cur_max_delta_ts), m_pfor_ts(other.m_pfor_ts),
+      m_d_out_time(other.m_d_out_time), m_grid_idx(other.m_grid_idx), m_grid_lane_t(other.m_grid_lane_t),
+      m_stats(other.m_stats)
+{
+    m_step_f = reinterpret_cast<step_f_t>(m_llvm.jit_lookup("step"));
+    m_d_out_f = nullptr;
+
+    // NOTE: see the scalar counterpart for the external buffers.
+    std::copy(other.get_state_data(), other.get_state_data() + m_state.size(), m_state.begin());
+    std::copy(other.get_pars_data(), other.get_pars_data() + m_pars.size(), m_pars.begin());
+
+    // NOTE: the profiling state is not copied.
+}
+
+template <typename T>
+taylor_adaptive_batch_impl<T>::taylor_adaptive_batch_impl(taylor_adaptive_batch_impl &&) noexcept = default;
+
+template <typename T>
+taylor_adaptive_batch_impl<T> &taylor_adaptive_batch_impl<T>::operator=(const taylor_adaptive_batch_impl &other)
+{
+    if (this != &other) {
+        *this = taylor_adaptive_batch_impl(other);
+    }
+
+    return *this;
+}
+
+template <typename T>
+taylor_adaptive_batch_impl<T> &
+taylor_adaptive_batch_impl<T>::operator=(taylor_adaptive_batch_impl &&) noexcept = default;
+
+template <typename T>
+taylor_adaptive_batch_impl<T>::~taylor_adaptive_batch_impl() = default;
+
+// Fetch the function for the computation of the dense output.
+// NOTE: the lookup is deferred to the first use, as the
+// dense output function is compiled lazily by the llvm_state.
+template <typename T>
+typename taylor_adaptive_batch_impl<T>::d_out_f_t taylor_adaptive_batch_impl<T>::get_d_out_f()
+{
+    if (m_d_out_f == nullptr) {
+        m_d_out_f = reinterpret_cast<d_out_f_t>(m_llvm.jit_lookup("d_out_f"));
+    }
+
+    return m_d_out_f;
+}
+
+template <typename T>
+void taylor_adaptive_batch_impl<T>::enable_perf_counters(std::uint64_t raw_config)
+{
+    m_perf = std::make_unique<perf_counter_group>(raw_config);
+    m_perf_buf.resize(m_dim * static_cast<decltype(m_perf_buf.size())>(m_batch_size));
+
+    // NOTE: fetch the dense output function now, so that its lazy
+    // compilation does not take place within a profiled step.
+    get_d_out_f();
+}
+
+template <typename T>
+void taylor_adaptive_batch_impl<T>::disable_perf_counters()
+{
+    m_perf.reset();
+}
+
+template <typename T>
+bool taylor_adaptive_batch_impl<T>::perf_counters_enabled() const
+{
+    return static_cast<bool>(m_perf);
+}
+
+template <typename T>
+const std::vector<step_perf_counts> &taylor_adaptive_batch_impl<T>::get_perf_counts() const
+{
+    return m_perf_counts;
+}
+
+template <typename T>
+void taylor_adaptive_batch_impl<T>::reset_perf_counts()
+{
+    m_perf_counts.clear();
+}
+
+template <typename T>
+void taylor_adaptive_batch_impl<T>::enable_stats()
+{
+    if (!m_stats) {
+        m_stats.emplace();
+        m_stats->lane_n_active.resize(m_batch_size);
+    }
+}
+
+template <typename T>
+void taylor_adaptive_batch_impl<T>::disable_stats()
+{
+    m_stats.reset();
+}
+
+template <typename T>
+bool taylor_adaptive_batch_impl<T>::stats_enabled() const
+{
+    return m_stats.has_value();
+}
+
+template <typename T>
+const taylor_stats &taylor_adaptive_batch_impl<T>::get_stats() const
+{
+    if (!m_stats) {
+        throw std::invalid_argument("Cannot fetch the statistics of an adaptive batch Taylor integrator if their "
+                                    "collection has not been enabled");
+    }
+
+    return *m_stats;
+}
+
+template <typename T>
+void taylor_adaptive_batch_impl<T>::reset_stats()
+{
+    if (m_stats) {
+        m_stats.emplace();
+        m_stats->lane_n_active.resize(m_batch_size);
+    }
+}
+
+template <typename T>
+taylor_memory_usage taylor_adaptive_batch_impl<T>::memory_usage() const
+{
+    taylor_memory_usage retval;
+
+    retval.llvm = m_llvm.memory_usage();
+    retval.decomposition = m_dc ? taylor_dc_memory_usage(*m_dc) : 0u;
+    retval.tc = taylor_buffers_memory_usage(m_tc);
+    retval.buffers = taylor_buffers_memory_usage(
+        m_state, m_time, m_time_lo, m_pars, m_last_h, m_d_out, m_pinf, m_minf, m_delta_ts, m_step_res, m_prop_res,
+        m_ts_count, m_min_abs_h, m_max_abs_h, m_cur_max_delta_ts, m_pfor_ts, m_d_out_time, m_grid_idx, m_grid_lane_t,
+        m_perf_counts, m_perf_buf);
+
+    return retval;
+}
+
+template <typename T>
+void taylor_adaptive_batch_impl<T>::drop_decomposition()
+{
+    m_dc.reset();
+}
+
+template <typename T>
+void taylor_adaptive_batch_impl<T>::drop_ir_snapshot()
+{
+    m_llvm.drop_ir_snapshot();
+}
+
+// Recompile the stepper using the profile data
+// collected by the instrumented stepper.
+template <typename T>
+void taylor_adaptive_batch_impl<T>::pgo_recompile()
+{
+    m_llvm.pgo_recompile();
+
+    m_step_f = reinterpret_cast<step_f_t>(m_llvm.jit_lookup("step"));
+    m_d_out_f = nullptr;
+}
+
+// Implementation detail to make a single integration timestep.
+// The magnitude of the timestep is automatically deduced for each
+// state vector, but it will always be not greater than
+// the absolute value of the corresponding element in max_delta_ts.
+// For each state vector, the propagation
+// is done forward in time if max_delta_t >= 0, backwards in
+// time otherwise.
+//
+// The function will write to res a pair for each state
+// vector, containing a flag describing the outcome of the integration
+// and the integration timestep that was used.
+template <typename T>
+const std::vector<std::tuple<taylor_outcome, T>> &
+taylor_adaptive_batch_impl<T>::step_impl_core(const std::vector<T> &max_delta_ts, bool wtc)
+{
+    using std::isfinite;
+
+    // Check preconditions.
+    assert(max_delta_ts.size() == m_batch_size);
+    assert(std::none_of(max_delta_ts.begin(), max_delta_ts.end(), [](const auto &x) {
+        using std::isnan;
+        return isnan(x);
+    }));
+
+    // Sanity check.
+    assert(m_step_res.size() == m_batch_size);
+
+    // Copy max_delta_ts to the tmp buffer.
+    // NOTE: with the step size prediction, the predicted
+    // timesteps in the second half of the buffer are left untouched.
+    std::copy(max_delta_ts.begin(), max_delta_ts.end(), m_delta_ts.begin());
+
+    // Invoke the stepper.
+    // NOTE: if the step is being profiled, we always need the Taylor coefficients.
+    // NOTE: the stepper also checks if the updated state
+    // vectors of all batch elements contain only finite values.
+    auto *tc_ptr = (wtc || m_perf) ? m_tc.data() : nullptr;
+    std::uint32_t sv_finite = 0;
+    if (m_perf) {
+        auto &pc = taylor_fetch_perf_counters(m_perf);
+        step_perf_counts spc;
+
+        pc.start();
+        sv_finite = m_step_f(get_state_data(), get_pars_data(), m_time.data(), m_delta_ts.data(), tc_ptr);
+        spc.step = pc.stop();
+
+        // Measure the state update by evaluating the
+        // Taylor polynomials of the step once more.
+        const auto d_out_f = get_d_out_f();
+        pc.start();
+        d_out_f(m_perf_buf.data(), m_tc.data(), m_delta_ts.data());
+        spc.update = pc.stop();
+
+        m_perf_counts.push_back(spc);
+    } else {
+        sv_finite = m_step_f(get_state_data(), get_pars_data(), m_time.data(), m_delta_ts.data(), tc_ptr);
+    }
+
+    // Recompile the stepper using the profile data once the
+    // instrumented stepper has been run for the requested
+    // number of steps.
+    if (m_pgo_steps != 0u && --m_pgo_steps == 0u) {
+        pgo_recompile();
+    }
+
+    // Helper to check if the state vector of a batch element
+    // contains a non-finite value.
+    // NOTE: the state vectors need to be scanned only if the stepper
+    // detected a non-finite value, in order to determine which
+    // batch elements are affected.
+    auto check_nf_batch = [this, sv_finite](std::uint32_t batch_idx) {
+        if (sv_finite != 0u) {
+            return false;
+        }
+
+        for (std::uint32_t i = 0; i < m_dim; ++i) {
+            if (!isfinite(get_state_data()[i * m_batch_size + batch_idx])) {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    // Update the times and write out the result.
+    for (std::uint32_t i = 0; i < m_batch_size; ++i) {
+        // The timestep that was actually used for
+        // this batch element.
+        const auto h = m_delta_ts[i];
+        taylor_time_add(m_time[i], m_time_lo[i], h, m_comp_time);
+        m_last_h[i] = h;
+
+        if (!isfinite(m_time[i]) || check_nf_batch(i)) {
+            // Either the new time or state contain non-finite values,
+            // return an error condition.
+            m_step_res[i] = std::tuple{taylor_outcome::err_nf_state, h};
+        } else {
+            m_step_res[i] = std::tuple{h == max_delta_ts[i] ? taylor_outcome::time_limit : taylor_outcome::success, h};
+        }
+    }
+
+    return m_step_res;
+}
+
+// Wrapper around step_impl_core() which
+// collects the statistics of the step, if enabled.
+template <typename T>
+const std::vector<std::tuple<taylor_outcome, T>> &
+taylor_adaptive_batch_impl<T>::step_impl(const std::vector<T> &max_delta_ts, bool wtc)
+{
+    HEYOKA_TRACE_SCOPE("step", this);
+
+    if (!m_stats) {
+        return step_impl_core(max_delta_ts, wtc);
+    }
+
+    double elapsed = 0;
+    {
+        time_accumulator ta(elapsed);
+        step_impl_core(max_delta_ts, wtc);
+    }
+
+    taylor_stats_record_time(*m_stats, elapsed);
+
+    assert(m_stats->lane_n_active.size() == m_batch_size);
+    for (std::uint32_t i = 0; i < m_batch_size; ++i) {
+        const auto &[oc, h] = m_step_res[i];
+
+        taylor_stats_record_step(*m_stats, oc, h);
+        m_stats->lane_n_active[i] += static_cast<std::size_t>(h != 0);
+    }
+
+    return m_step_res;
+}
+
+template <typename T>
+const std::vector<std::tuple<taylor_outcome, T>> &taylor_adaptive_batch_impl<T>::step(bool wtc)
+{
+    return step_impl(m_pinf, wtc);
+}
+
+template <typename T>
+const std::vector<std::tuple<taylor_outcome, T>> &taylor_adaptive_batch_impl<T>::step_backward(bool wtc)
+{
+    return step_impl(m_minf, wtc);
+}
+
+template <typename T>
+const std::vector<std::tuple<taylor_outcome, T>> &
+taylor_adaptive_batch_impl<T>::step(const std::vector<T> &max_delta_ts, bool wtc)
+{
+    // Check the dimensionality of max_delta_ts.
+    if (max_delta_ts.size() != m_batch_size) {
+        throw std::invalid_argument(
+            "Invalid number of max timesteps specified in a Taylor integrator in batch mode: the batch size is "
+            + std::to_string(m_batch_size) + ", but the number of specified timesteps is "
+            + std::to_string(max_delta_ts.size()));
+    }
+
+    // Make sure no values in max_delta_ts are nan.
+    if (std::any_of(max_delta_ts.begin(), max_delta_ts.end(), [](const auto &x) {
+            using std::isnan;
+            return isnan(x);
+        })) {
+        throw std::invalid_argument(
+            "Cannot invoke the step() function of an adaptive Taylor integrator in batch mode if "
+            "one of the max timesteps is nan");
+    }
+
+    return step_impl(max_delta_ts, wtc);
+}
+
+template <typename T>
+const std::vector<std::tuple<taylor_outcome, T, T, std::size_t>> &
+taylor_adaptive_batch_impl<T>::propagate_for(const std::vector<T> &delta_ts, std::size_t max_steps, step_callback cb)
+{
+    HEYOKA_TRACE_SCOPE("propagate_for", this);
+
+    // Check the dimensionality of delta_ts.
+    if (delta_ts.size() != m_batch_size) {
+        throw std::invalid_argument(
+            "Invalid number of time intervals specified in a Taylor integrator in batch mode: the batch size is "
+            + std::to_string(m_batch_size) + ", but the number of specified time intervals is "
+            + std::to_string(delta_ts.size()));
+    }
+
+    for (std::uint32_t i = 0; i < m_batch_size; ++i) {
+        m_pfor_ts[i] = m_time[i] + delta_ts[i];
+    }
+
+    return propagate_until(m_pfor_ts, max_steps, cb);
+}
+
+template <typename T>
+const std::vector<std::tuple<taylor_outcome, T, T, std::size_t>> &
+taylor_adaptive_batch_impl<T>::propagate_until(const std::vector<T> &ts, std::size_t max_steps, step_callback cb)
+{
+    HEYOKA_TRACE_SCOPE("propagate_until", this);
+
+    using std::isfinite;
+
+    // Check the dimensionality of ts.
+    if (ts.size() != m_batch_size) {
+        throw std::invalid_argument(
+            "Invalid number of time limits specified in a Taylor integrator in batch mode: the batch size is "
+            + std::to_string(m_batch_size) + ", but the number of specified time limits is "
+            + std::to_string(ts.size()));
+    }
+
+    // Check the current times.
+    if (std::any_of(m_time.begin(), m_time.end(), [](const auto &t) { return !isfinite(t); })) {
+        throw std::invalid_argument(
+            "Cannot invoke the propagate_until() function of an adaptive Taylor integrator in batch mode if "
+            "one of the current times is not finite");
+    }
+
+    // Check the final times.
+    if (std::any_of(ts.begin(), ts.end(), [](const auto &t) { return !isfinite(t); })) {
+        throw std::invalid_argument("A non-finite time was passed to the propagate_until() function of an adaptive "
+                                    "Taylor integrator in batch mode");
+    }
+
+    // Reset the counters and the min/max abs(h) vectors.
+    std::size_t iter_counter = 0;
+    for (std::uint32_t i = 0; i < m_batch_size; ++i) {
+        m_ts_count[i] = 0;
+        m_min_abs_h[i] = std::numeric_limits<T>::infinity();
+        m_max_abs_h[i] = 0;
+    }
+
+    // Helper to compute the max integration times for the next timestep.
+    // NOTE: ts[i] - m_time[i] is guaranteed not to be nan: ts[i] is never non-finite,
+    // and at the first iteration we have checked above the value of m_time.
+    // At successive iterations, we know that m_time[i] must be finite because
+    // otherwise we would have exited the loop when checking m_step_res.
+    auto cur_max_delta_t = [&](std::uint32_t i) { return (ts[i] - m_time[i]) - m_time_lo[i]; };
+
+    for (std::uint32_t i = 0; i < m_batch_size; ++i) {
+        m_cur_max_delta_ts[i] = cur_max_delta_t(i);
+    }
+
+    bool cb_stop = false;
+
+    while (true) {
+        // Run the integration timestep.
+        step_impl(m_cur_max_delta_ts, false);
+
+        // Check if the integration timestep produced an error condition,
+        // and if all the batch elements reached the time limit.
+        // NOTE: this is done in a single branchless pass over
+        // the outcomes, without early exits.
+        bool err = false, all_tl = true;
+        for (std::uint32_t i = 0; i < m_batch_size; ++i) {
+            const auto oc = std::get<0>(m_step_res[i]);
+
+            err |= (oc != taylor_outcome::success) & (oc != taylor_outcome::time_limit);
+            all_tl &= (oc == taylor_outcome::time_limit);
+        }
+
+        if (err) {
+            break;
+        }
+
+        // Update the iteration counter.
+        ++iter_counter;
+
+        // Update the local step counters and min_h/max_h, and compute
+        // the max integration times for the next timestep.
+        // NOTE: all the per-lane bookkeeping is done in this single pass.
+        for (std::uint32_t i = 0; i < m_batch_size; ++i) {
+            const auto &[oc, h] = m_step_res[i];
+
+            // NOTE: the local step counters increase only if we integrated
+            // for a non-zero time.
+            m_ts_count[i] += static_cast<std::size_t>(h != 0);
+
+            // NOTE: min_h/max_h are not updated for the batch
+            // elements which reached the time limit.
+            if (oc != taylor_outcome::time_limit) {
+                using std::abs;
+                const auto abs_h = abs(h);
+                m_min_abs_h[i] = std::min(m_min_abs_h[i], abs_h);
+                m_max_abs_h[i] = std::max(m_max_abs_h[i], abs_h);
+            }
+
+            m_cur_max_delta_ts[i] = cur_max_delta_t(i);
+        }
+
+        // Invoke the step callback.
+        if (cb.f != nullptr && !cb.f(cb.ctx)) {
+            cb_stop = true;
+            break;
+        }
+
+        // Break out if we have reached the time limit for all
+        // batch elements.
+        if (all_tl) {
+            break;
+        }
+
+        // Check the iteration limit.
+        if (max_steps != 0u && iter_counter == max_steps) {
+            break;
+        }
+    }
+
+    // Assemble the return value.
+    if (cb_stop) {
+        for (std::uint32_t i = 0; i < m_batch_size; ++i) {
+            m_prop_res[i]
+                = std::tuple{std::get<0>(m_step_res[i]) == taylor_outcome::time_limit ? taylor_outcome::time_limit
+                                                                                      : taylor_outcome::cb_stop,
+                             m_min_abs_h[i], m_max_abs_h[i], m_ts_count[i]};
+        }
+    } else if (max_steps != 0u && iter_counter == max_steps) {
+        // We exited because we reached the max_steps limit: if the last integration step was successful
+        // return step_limit, otherwise time_limit.
+        for (std::uint32_t i = 0; i < m_batch_size; ++i) {
+            m_prop_res[i]
+                = std::tuple{std::get<0>(m_step_res[i]) == taylor_outcome::success ? taylor_outcome::step_limit
+                                                                                   : taylor_outcome::time_limit,
+                             m_min_abs_h[i], m_max_abs_h[i], m_ts_count[i]};
+        }
+    } else {
+        // We exited either because of an error, or because all the batch
+        // elements reached the time limits. In this case, we just use the
+        // outcome of the last timestep.
+        for (std::uint32_t i = 0; i < m_batch_size; ++i) {
+            m_prop_res[i] = std::tuple{std::get<0>(m_step_res[i]), m_min_abs_h[i], m_max_abs_h[i], m_ts_count[i]};
+        }
+    }
+
+    return m_prop_res;
+}
+
+// Batch counterpart of the scalar propagate_grid() function. The time grid
+// is stored in grid-major/batch-minor order, that is, the first batch_size
+// values are the first grid point for all batch elements, and so on. Each
+// batch element must have a monotonically-sorted time grid.
+//
+// The return value contains the state vectors at all grid points, in
+// grid-major/state-minor order (i.e., each grid point results
+// in a block of values of the same size as the state vector).
+// The values corresponding to grid points which were not reached are set to NaN.
+// The outcomes of the propagation for each batch element are stored in m_prop_res,
+// which can be fetched via get_propagate_res().
+template <typename T>
+std::vector<T> taylor_adaptive_batch_impl<T>::propagate_grid(const std::vector<T> &grid, std::size_t max_steps)
+{
+    HEYOKA_TRACE_SCOPE("propagate_grid", this);
+
+    using std::abs;
+    using std::isfinite;
+
+    // Check the current times.
+    if (std::any_of(m_time.begin(), m_time.end(), [](const auto &t) { return !isfinite(t); })) {
+        throw std::invalid_argument(
+            "Cannot invoke the propagate_grid() function of an adaptive Taylor integrator in batch mode if "
+            "one of the current times is not finite");
+    }
+
+    // Check the grid.
+    if (grid.empty() || grid.size() % m_batch_size != 0u) {
+        throw std::invalid_argument(
+            "Invalid time grid passed to the propagate_grid() function of an adaptive Taylor integrator in batch "
+            "mode: the size of the grid is "
+            + std::to_string(grid.size()) + ", which is not a nonzero multiple of the batch size ("
+            + std::to_string(m_batch_size) + ")");
+    }
+
+    if (std::any_of(grid.begin(), grid.end(), [](const auto &t) { return !isfinite(t); })) {
+        throw std::invalid_argument("A non-finite time was passed to the propagate_grid() function of an adaptive "
+                                    "Taylor integrator in batch mode");
+    }
+
+    // The number of grid points.
+    const auto n_points = grid.size() / m_batch_size;
+
+    // Helper to fetch the value of the k-th grid point
+    // for the i-th batch element.
+    auto grid_t = [&grid, this](decltype(grid.size()) k, std::uint32_t i) { return grid[k * m_batch_size + i]; };
+
+    // Helper to determine if the integration is
+    // forward in time for the i-th batch element.
+    auto forward = [&grid_t, n_points](std::uint32_t i) { return grid_t(n_points - 1u, i) >= grid_t(0, i); };
+
+    for (std::uint32_t i = 0; i < m_batch_size; ++i) {
+        const auto fwd = forward(i);
+
+        for (decltype(grid.size()) k = 1; k < n_points; ++k) {
+            if (fwd ? grid_t(k, i) < grid_t(k - 1u, i) : grid_t(k, i) > grid_t(k - 1u, i)) {
+                throw std::invalid_argument("The time grid passed to the propagate_grid() function of an adaptive "
+                                            "Taylor integrator in batch mode must be sorted monotonically");
+            }
+        }
+    }
+
+    // Prepare the output buffer.
+    // LCOV_EXCL_START
+    if (n_points > std::numeric_limits<decltype(grid.size())>::max() / m_state.size()) {
+        throw std::overflow_error(
+            "Overflow detected in the creation of the output buffer in the propagate_grid() function of an "
+            "adaptive Taylor integrator in batch mode");
+    }
+    // LCOV_EXCL_STOP
+    std::vector<T> retval;
+    retval.resize(n_points * m_state.size(), std::numeric_limits<T>::quiet_NaN());
+
+    // Propagate up to the first grid point.
+    std::copy(grid.begin(), grid.begin() + m_batch_size, m_pfor_ts.begin());
+    propagate_until(m_pfor_ts, max_steps);
+    if (std::any_of(m_prop_res.begin(), m_prop_res.end(),
+                    [](const auto &tup) { return std::get<0>(tup) != taylor_outcome::time_limit; })) {
+        return retval;
+    }
+
+    // Write out the state at the first grid point.
+    std::copy(get_state_data(), get_state_data() + m_state.size(), retval.begin());
+
+    // Init the grid indices and the counters.
+    // NOTE: the max_steps limit also takes into account
+    // the timesteps undertaken by propagate_until().
+    std::size_t iter_counter = 0;
+    for (std::uint32_t i = 0; i < m_batch_size; ++i) {
+        m_grid_idx[i] = 1;
+        m_min_abs_h[i] = std::get<1>(m_prop_res[i]);
+        m_max_abs_h[i] = std::get<2>(m_prop_res[i]);
+        m_ts_count[i] = std::get<3>(m_prop_res[i]);
+        iter_counter = std::max(iter_counter, m_ts_count[i]);
+    }
+
+    // Helper to determine if the i-th batch element
+    // has been propagated up to the last grid point.
+    auto done = [this, n_points](std::uint32_t i) { return m_grid_idx[i] == n_points; };
+
+    // Helper to determine if the next grid point of the
+    // i-th batch element is within the last timestep.
+    auto pending = [&](std::uint32_t i) {
+        if (done(i)) {
+            return false;
+        }
+
+        // NOTE: if we reached the time limit, all the remaining
+        // grid points are within the last timestep. We need to handle
+        // this case explicitly because, due to floating-point rounding,
+        // m_time[i] might end up being slightly different from the last grid point.
+        if (std::get<0>(m_step_res[i]) == taylor_outcome::time_limit) {
+            return true;
+        }
+
+        const auto t = grid_t(m_grid_idx[i], i);
+        return forward(i) ? t <= m_time[i] : t >= m_time[i];
+    };
+
+    // Flag to signal that we exited because of the max_steps limit.
+    bool step_limit = false;
+
+    while (true) {
+        // Break out if all batch elements reached
+        // the last grid point.
+        if (std::all_of(m_grid_idx.begin(), m_grid_idx.end(), [n_points](auto idx) { return idx == n_points; })) {
+            break;
+        }
+
+        // Check the iteration limit.
+        if (max_steps != 0u && iter_counter == max_steps) {
+            step_limit = true;
+            break;
+        }
+
+        // Compute the max integration times for this timestep.
+        // NOTE: the batch elements which have already reached the
+        // last grid point are not propagated any further.
+        for (std::uint32_t i = 0; i < m_batch_size; ++i) {
+            m_cur_max_delta_ts[i] = done(i) ? T(0) : (grid_t(n_points - 1u, i) - m_time[i]) - m_time_lo[i];
+        }
+
+        // Run the integration timestep.
+        step_impl(m_cur_max_delta_ts, true);
+
+        // Check if the integration timestep produced an error condition.
+        if (std::any_of(m_step_res.begin(), m_step_res.end(), [](const auto &tup) {
+                return std::get<0>(tup) != taylor_outcome::success && std::get<0>(tup) != taylor_outcome::time_limit;
+            })) {
+            break;
+        }
+
+        // Update the counters and min_h/max_h.
+        ++iter_counter;
+        for (std::uint32_t i = 0; i < m_batch_size; ++i) {
+            const auto [res, h] = m_step_res[i];
+
+            m_ts_count[i] += static_cast<std::size_t>(h != 0);
+
+            // NOTE: don't update min_h/max_h if we reached the time limit.
+            if (res == taylor_outcome::success) {
+                const auto abs_h = abs(h);
+                m_min_abs_h[i] = std::min(m_min_abs_h[i], abs_h);
+                m_max_abs_h[i] = std::max(m_max_abs_h[i], abs_h);
+            }
+        }
+
+        // Compute the state at the grid points
+        // within the last timestep. Each iteration of this loop
+        // computes the dense output for at most one grid point
+        // per batch element.
+        while (true) {
+            bool any_pending = false;
+            for (std::uint32_t i = 0; i < m_batch_size; ++i) {
+                if (pending(i)) {
+                    m_grid_lane_t[i] = grid_t(m_grid_idx[i], i);
+                    any_pending = true;
+                } else {
+                    // NOTE: the dense output for this batch element
+                    // will be ignored.
+                    m_grid_lane_t[i] = m_time[i];
+                }
+            }
+
+            if (!any_pending) {
+                break;
+            }
+
+            const auto &d_out = update_d_output(m_grid_lane_t);
+
+            for (std::uint32_t i = 0; i < m_batch_size; ++i) {
+                if (!pending(i)) {
+                    continue;
+                }
+
+                const auto out_offset = m_grid_idx[i] * m_state.size();
+                for (std::uint32_t j = 0; j < m_dim; ++j) {
+                    retval[out_offset + j * m_batch_size + i] = d_out[j * m_batch_size + i];
+                }
+
+                ++m_grid_idx[i];
+            }
+        }
+    }
+
+    // Assemble the outcomes.
+    for (std::uint32_t i = 0; i < m_batch_size; ++i) {
+        taylor_outcome oc{};
+
+        if (done(i)) {
+            oc = taylor_outcome::time_limit;
+        } else if (step_limit) {
+            oc = taylor_outcome::step_limit;
+        } else {
+            // NOTE: we exited because of an error condition
+            // in one of the batch elements: use the outcome
+            // of the last timestep.
+            oc = std::get<0>(m_step_res[i]);
+        }
+
+        m_prop_res[i] = std::tuple{oc, m_min_abs_h[i], m_max_abs_h[i], m_ts_count[i]};
+    }
+
+    return retval;
+}
+
+// Compute the dense output at the time coordinates ts, using the Taylor
+// coefficients from the last timestep. See the comments in the scalar
+// counterpart for the preconditions.
+template <typename T>
+const std::vector<T> &taylor_adaptive_batch_impl<T>::update_d_output(const std::vector<T> &ts)
+{
+    // Check the dimensionality of ts.
+    if (ts.size() != m_batch_size) {
+        throw std::invalid_argument(
+            "Invalid number of time coordinates specified for the dense output in a Taylor integrator in batch "
+            "mode: the batch size is "
+            + std::to_string(m_batch_size) + ", but the number of time coordinates is " + std::to_string(ts.size()));
+    }
+
+    if (std::any_of(ts.begin(), ts.end(), [](const auto &t) {
+            using std::isfinite;
+            return !isfinite(t);
+        })) {
+        throw std::invalid_argument("Cannot compute the dense output of an adaptive Taylor integrator in batch mode "
+                                    "if one of the time coordinates is not finite");
+    }
+
+    // NOTE: the Taylor polynomials are expanded around the time coordinates
+    // at the beginning of the last timestep.
+    for (std::uint32_t i = 0; i < m_batch_size; ++i) {
+        m_d_out_time[i] = ((ts[i] - m_time[i]) - m_time_lo[i]) + m_last_h[i];
+    }
+
+    get_d_out_f()(m_d_out.data(), m_tc.data(), m_d_out_time.data());
+
+    return m_d_out;
+}
+
+template <typename T>
+const llvm_state &taylor_adaptive_batch_impl<T>::get_llvm_state() const
+{
+    return m_llvm;
+}
+
+template <typename T>
+void taylor_adaptive_batch_impl<T>::save(std::ostream &os) const
+{
+    taylor_save_header<T>(os, "taylor_adaptive_batch");
+
+    bin_save(os, m_batch_size);
+    // NOTE: save the contents of the
+    // external buffers, if bound.
+    bin_save(os, std::vector<T>(get_state_data(), get_state_data() + m_state.size()));
+    bin_save(os, m_time);
+    bin_save(os, m_dim);
+    bin_save(os, get_decomposition());
+    bin_save(os, m_order);
+    bin_save(os, std::vector<T>(get_pars_data(), get_pars_data() + m_pars.size()));
+    bin_save(os, m_tc);
+    bin_save(os, m_last_h);
+    bin_save(os, m_d_out);
+    bin_save(os, m_compact_mode);
+    bin_save(os, m_pgo_steps);
+    bin_save(os, m_time_lo);
+    bin_save(os, m_comp_time);
+    bin_save(os, m_predict_h);
+    bin_save(os, std::vector<T>(m_delta_ts.begin() + static_cast<std::ptrdiff_t>(m_batch_size), m_delta_ts.end()));
+
+    m_llvm.save(os);
+}
 
-    // Setup the vector for the Taylor coefficients.
-    // LCOV_EXCL_START
-    if (m_order == std::numeric_limits<std::uint32_t>::max()
-        || m_state.size() > std::numeric_limits<decltype(m_tc.size())>::max() / (m_order + 1u)) {
-        throw std::overflow_error("Overflow detected in the initialisation of an adaptive Taylor integrator: the order "
-                                  "or the state size is too large");
+template <typename T>
+void taylor_adaptive_batch_impl<T>::load(std::istream &is)
+{
+    taylor_load_header<T>(is, "taylor_adaptive_batch");
+
+    // NOTE: load everything into temporaries first,
+    // so that this is not altered if an error occurs.
+    std::uint32_t batch_size = 0, dim = 0, order = 0;
+    std::vector<T> state, time, pars, tc, last_h, d_out, time_lo, pred_h;
+    std::vector<std::pair<expression, std::vector<std::uint32_t>>> dc;
+    bool compact_mode = false, comp_time = false, predict_h = false;
+    std::size_t pgo_steps = 0;
+    llvm_state llvm;
+
+    bin_load(is, batch_size);
+    bin_load(is, state);
+    bin_load(is, time);
+    bin_load(is, dim);
+    bin_load(is, dc);
+    bin_load(is, order);
+    bin_load(is, pars);
+    bin_load(is, tc);
+    bin_load(is, last_h);
+    bin_load(is, d_out);
+    bin_load(is, compact_mode);
+    bin_load(is, pgo_steps);
+    bin_load(is, time_lo);
+    bin_load(is, comp_time);
+    bin_load(is, predict_h);
+    bin_load(is, pred_h);
+
+    llvm.load(is);
+
+    // Minimal consistency checks.
+    const auto state_size = static_cast<decltype(state.size())>(dim) * batch_size;
+    if (batch_size == 0u || state.size() != state_size || d_out.size() != state_size || time.size() != batch_size
+        || time_lo.size() != batch_size || last_h.size() != batch_size || tc.size() != state_size * (order + 1u)
+        || pred_h.size() != (predict_h ? batch_size : 0u) || !llvm.is_compiled()) {
+        throw std::invalid_argument("Inconsistent data detected while loading an adaptive Taylor integrator");
     }
-    // LCOV_EXCL_STOP
 
-    // NOTE: the size of m_state.size() already takes
-    // into account the batch size.
-    m_tc.resize(m_state.size() * (m_order + 1u));
+    const auto step_f = reinterpret_cast<step_f_t>(llvm.jit_lookup("step"));
+    const auto d_out_f = reinterpret_cast<d_out_f_t>(llvm.jit_lookup("d_out_f"));
 
     // Prepare the temp vectors.
-    m_pinf.resize(m_batch_size, std::numeric_limits<T>::infinity());
-    m_minf.resize(m_batch_size, -std::numeric_limits<T>::infinity());
-    m_delta_ts.resize(m_batch_size);
+    // NOTE: this mirrors finalise_ctor_impl().
+    std::vector<T> pinf(batch_size, std::numeric_limits<T>::infinity()),
+        minf(batch_size, -std::numeric_limits<T>::infinity());
 
-    // NOTE: default init of these vectors is fine.
+    m_batch_size = batch_size;
+    m_state = std::move(state);
+    m_time = std::move(time);
+    m_time_lo = std::move(time_lo);
+    m_llvm = std::move(llvm);
+    m_dim = dim;
+    m_dc = taylor_share_dc(std::move(dc));
+    m_keep_alive = taylor_dc_keep_alive(m_dc);
+    m_order = order;
+    m_step_f = step_f;
+    m_pars = std::move(pars);
+    m_ext_state = nullptr;
+    m_ext_pars = nullptr;
+    m_tc = std::move(tc);
+    m_last_h = std::move(last_h);
+    m_d_out_f = d_out_f;
+    m_d_out = std::move(d_out);
+    m_compact_mode = compact_mode;
+    m_comp_time = comp_time;
+    m_predict_h = predict_h;
+    m_pgo_steps = pgo_steps;
+    m_pinf = std::move(pinf);
+    m_minf = std::move(minf);
+
+    m_delta_ts.resize(m_batch_size);
+    m_delta_ts.insert(m_delta_ts.end(), pred_h.begin(), pred_h.end());
     m_step_res.resize(boost::numeric_cast<decltype(m_step_res.size())>(m_batch_size));
     m_prop_res.resize(boost::numeric_cast<decltype(m_prop_res.size())>(m_batch_size));
-
     m_ts_count.resize(boost::numeric_cast<decltype(m_ts_count.size())>(m_batch_size));
     m_min_abs_h.resize(m_batch_size);
     m_max_abs_h.resize(m_batch_size);
     m_cur_max_delta_ts.resize(m_batch_size);
     m_pfor_ts.resize(m_batch_size);
+    m_d_out_time.resize(m_batch_size);
+    m_grid_idx.resize(boost::numeric_cast<decltype(m_grid_idx.size())>(m_batch_size));
+    m_grid_lane_t.resize(m_batch_size);
 }
 
 template <typename T>
-taylor_adaptive_batch_impl<T>::taylor_adaptive_batch_impl(const taylor_adaptive_batch_impl &other)
-    // NOTE: make a manual copy of all members, apart from the function pointers.
-    : m_batch_size(other.m_batch_size), m_state(other.m_state), m_time(other.m_time), m_llvm(other.m_llvm),
-      m_dim(other.m_dim), m_dc(other.m_dc), m_order(other.m_order), m_pars(other.m_pars), m_tc(other.m_tc),
-      m_pinf(other.m_pinf), m_minf(other.m_minf), m_delta_ts(other.m_delta_ts), m_step_res(other.m_step_res),
-      m_prop_res(other.m_prop_res), m_ts_count(other.m_ts_count), m_min_abs_h(other.m_min_abs_h),
-      m_max_abs_h(other.m_max_abs_h), m_cur_max_delta_ts(other.m_cur_max_delta_ts), m_pfor_ts(other.m_pfor_ts)
+const std::vector<T> &taylor_adaptive_batch_impl<T>::get_state() const
 {
-    m_step_f = reinterpret_cast<step_f_t>(m_llvm.jit_lookup("step"));
-}
+    if (m_ext_state != nullptr) {
+        throw std::invalid_argument("The state vectors of an adaptive Taylor integrator in batch mode cannot be "
+                                    "fetched while an external buffer is bound: use get_state_data() instead");
+    }
 
-template <typename T>
-taylor_adaptive_batch_impl<T>::taylor_adaptive_batch_impl(taylor_adaptive_batch_impl &&) noexcept = default;
+    return m_state;
+}
 
 template <typename T>
-taylor_adaptive_batch_impl<T> &taylor_adaptive_batch_impl<T>::operator=(const taylor_adaptive_batch_impl &other)
+const std::vector<T> &taylor_adaptive_batch_impl<T>::get_pars() const
 {
-    if (this != &other) {
-        *this = taylor_adaptive_batch_impl(other);
+    if (m_ext_pars != nullptr) {
+        throw std::invalid_argument("The parameters of an adaptive Taylor integrator in batch mode cannot be "
+                                    "fetched while an external buffer is bound: use get_pars_data() instead");
     }
 
-    return *this;
+    return m_pars;
 }
 
+// NOTE: the layout of the external buffers is the same
+// as the layout of the internal buffers (i.e., the values
+// of the batch elements are contiguous for each variable/parameter).
 template <typename T>
-taylor_adaptive_batch_impl<T> &
-taylor_adaptive_batch_impl<T>::operator=(taylor_adaptive_batch_impl &&) noexcept = default;
-
-template <typename T>
-taylor_adaptive_batch_impl<T>::~taylor_adaptive_batch_impl() = default;
-
-// Implementation detail to make a single integration timestep.
-// The magnitude of the timestep is automatically deduced for each
-// state vector, but it will always be not greater than
-// the absolute value of the corresponding element in max_delta_ts.
-// For each state vector, the propagation
-// is done forward in time if max_delta_t >= 0, backwards in
-// time otherwise.
-//
-// The function will write to res a pair for each state
-// vector, containing a flag describing the outcome of the integration
-// and the integration timestep that was used.
-template <typename T>
-const std::vector<std::tuple<taylor_outcome, T>> &
-taylor_adaptive_batch_impl<T>::step_impl(const std::vector<T> &max_delta_ts, bool wtc)
+void taylor_adaptive_batch_impl<T>::bind_buffers(T *state, T *pars)
 {
-    using std::isfinite;
-
-    // Check preconditions.
-    assert(max_delta_ts.size() == m_batch_size);
-    assert(std::none_of(max_delta_ts.begin(), max_delta_ts.end(), [](const auto &x) {
-        using std::isnan;
-        return isnan(x);
-    }));
-
-    // Sanity check.
-    assert(m_step_res.size() == m_batch_size);
-
-    // Copy max_delta_ts to the tmp buffer.
-    std::copy(max_delta_ts.begin(), max_delta_ts.end(), m_delta_ts.begin());
-
-    // Invoke the stepper.
-    m_step_f(m_state.data(), m_pars.data(), m_time.data(), m_delta_ts.data(), wtc ? m_tc.data() : nullptr);
-
-    // Helper to check if the state vector of a batch element
-    // contains a non-finite value.
-    auto check_nf_batch = [this](std::uint32_t batch_idx) {
-        for (std::uint32_t i = 0; i < m_dim; ++i) {
-            if (!isfinite(m_state[i * m_batch_size + batch_idx])) {
-                return true;
-            }
-        }
-        return false;
-    };
-
-    // Update the times and write out the result.
-    for (std::uint32_t i = 0; i < m_batch_size; ++i) {
-        // The timestep that was actually used for
-        // this batch element.
-        const auto h = m_delta_ts[i];
-        m_time[i] += h;
-
-        if (!isfinite(m_time[i]) || check_nf_batch(i)) {
-            // Either the new time or state contain non-finite values,
-            // return an error condition.
-            m_step_res[i] = std::tuple{taylor_outcome::err_nf_state, h};
-        } else {
-            m_step_res[i] = std::tuple{h == max_delta_ts[i] ? taylor_outcome::time_limit : taylor_outcome::success, h};
-        }
-    }
+    taylor_check_ext_buffers(state, m_state.size(), pars, m_pars.size());
 
-    return m_step_res;
+    m_ext_state = state;
+    m_ext_pars = pars;
 }
 
 template <typename T>
-const std::vector<std::tuple<taylor_outcome, T>> &taylor_adaptive_batch_impl<T>::step(bool wtc)
+void taylor_adaptive_batch_impl<T>::unbind_buffers()
 {
-    return step_impl(m_pinf, wtc);
+    std::copy(get_state_data(), get_state_data() + m_state.size(), m_state.begin());
+    std::copy(get_pars_data(), get_pars_data() + m_pars.size(), m_pars.begin());
+
+    m_ext_state = nullptr;
+    m_ext_pars = nullptr;
 }
 
 template <typename T>
-const std::vector<std::tuple<taylor_outcome, T>> &taylor_adaptive_batch_impl<T>::step_backward(bool wtc)
+void taylor_adaptive_batch_impl<T>::set_time(const std::vector<T> &t)
 {
-    return step_impl(m_minf, wtc);
+    set_dtime(t, std::vector<T>(t.size()));
 }
 
 template <typename T>
-const std::vector<std::tuple<taylor_outcome, T>> &
-taylor_adaptive_batch_impl<T>::step(const std::vector<T> &max_delta_ts, bool wtc)
+void taylor_adaptive_batch_impl<T>::set_dtime(const std::vector<T> &hi, const std::vector<T> &lo)
 {
-    // Check the dimensionality of max_delta_ts.
-    if (max_delta_ts.size() != m_batch_size) {
-        throw std::invalid_argument(
-            "Invalid number of max timesteps specified in a Taylor integrator in batch mode: the batch size is "
-            + std::to_string(m_batch_size) + ", but the number of specified timesteps is "
-            + std::to_string(max_delta_ts.size()));
-    }
+    using std::isfinite;
 
-    // Make sure no values in max_delta_ts are nan.
-    if (std::any_of(max_delta_ts.begin(), max_delta_ts.end(), [](const auto &x) {
-            using std::isnan;
-            return isnan(x);
-        })) {
-        throw std::invalid_argument(
-            "Cannot invoke the step() function of an adaptive Taylor integrator in batch mode if "
-            "one of the max timesteps is nan");
+    if (hi.size() != m_batch_size || lo.size() != m_batch_size) {
+        throw std::invalid_argument("Invalid sizes detected in the set_dtime() function of an adaptive Taylor "
+                                    "integrator in batch mode: the time vectors have sizes of "
+                                    + std::to_string(hi.size()) + " and " + std::to_string(lo.size())
+                                    + ", but they must both be equal to the batch size ("
+                                    + std::to_string(m_batch_size) + ")");
     }
 
-    return step_impl(max_delta_ts, wtc);
-}
+    if (std::any_of(hi.begin(), hi.end(), [](const auto &x) { return !isfinite(x); })
+        || std::any_of(lo.begin(), lo.end(), [](const auto &x) { return !isfinite(x); })) {
+        throw std::invalid_argument("A non-finite time was passed to the set_dtime() function of an adaptive "
+                                    "Taylor integrator in batch mode");
+    }
 
-template <typename T>
-const std::vector<std::tuple<taylor_outcome, T, T, std::size_t>> &
-taylor_adaptive_batch_impl<T>::propagate_for(const std::vector<T> &delta_ts, std::size_t max_steps)
-{
-    // Check the dimensionality of delta_ts.
-    if (delta_ts.size() != m_batch_size) {
-        throw std::invalid_argument(
-            "Invalid number of time intervals specified in a Taylor integrator in batch mode: the batch size is "
-            + std::to_string(m_batch_size) + ", but the number of specified time intervals is "
-            + std::to_string(delta_ts.size()));
+    if (!m_comp_time && std::any_of(lo.begin(), lo.end(), [](const auto &x) { return x != 0; })) {
+        throw std::invalid_argument("A nonzero low-order part of the time can be passed to the set_dtime() function "
+                                    "of an adaptive Taylor integrator only with the compensated summation of the time");
     }
 
+    // NOTE: normalise the double-length values. The input
+    // values are copied first, as hi/lo may be aliasing m_time/m_time_lo.
     for (std::uint32_t i = 0; i < m_batch_size; ++i) {
-        m_pfor_ts[i] = m_time[i] + delta_ts[i];
-    }
+        const auto cur_hi = hi[i], cur_lo = lo[i];
 
-    return propagate_until(m_pfor_ts, max_steps);
+        m_time[i] = cur_hi;
+        m_time_lo[i] = 0;
+        taylor_time_add(m_time[i], m_time_lo[i], cur_lo, m_comp_time);
+    }
 }
 
+// NOTE: see the scalar counterpart.
 template <typename T>
-const std::vector<std::tuple<taylor_outcome, T, T, std::size_t>> &
-taylor_adaptive_batch_impl<T>::propagate_until(const std::vector<T> &ts, std::size_t max_steps)
+void taylor_adaptive_batch_impl<T>::reset_impl(const std::vector<T> &state, const std::vector<T> &time,
+                                               const std::vector<T> *pars)
 {
     using std::isfinite;
 
-    // Check the dimensionality of ts.
-    if (ts.size() != m_batch_size) {
-        throw std::invalid_argument(
-            "Invalid number of time limits specified in a Taylor integrator in batch mode: the batch size is "
-            + std::to_string(m_batch_size) + ", but the number of specified time limits is "
-            + std::to_string(ts.size()));
+    if (state.size() != m_state.size()) {
+        throw std::invalid_argument("Invalid state vector passed to the reset() function of an adaptive Taylor "
+                                    "integrator in batch mode: the size of the state vector is "
+                                    + std::to_string(state.size()) + ", but it must be "
+                                    + std::to_string(m_state.size()));
     }
 
-    // Check the current times.
-    if (std::any_of(m_time.begin(), m_time.end(), [](const auto &t) { return !isfinite(t); })) {
+    if (std::any_of(state.begin(), state.end(), [](const auto &x) { return !isfinite(x); })) {
         throw std::invalid_argument(
-            "Cannot invoke the propagate_until() function of an adaptive Taylor integrator in batch mode if "
-            "one of the current times is not finite");
+            "A non-finite value was detected in the state vector passed to the reset() function of an adaptive "
+            "Taylor integrator in batch mode");
     }
 
-    // Check the final times.
-    if (std::any_of(ts.begin(), ts.end(), [](const auto &t) { return !isfinite(t); })) {
-        throw std::invalid_argument("A non-finite time was passed to the propagate_until() function of an adaptive "
-                                    "Taylor integrator in batch mode");
+    if (time.size() != m_batch_size) {
+        throw std::invalid_argument("Invalid time vector passed to the reset() function of an adaptive Taylor "
+                                    "integrator in batch mode: the size of the time vector is "
+                                    + std::to_string(time.size()) + ", but it must be equal to the batch size ("
+                                    + std::to_string(m_batch_size) + ")");
     }
 
-    // Reset the counters and the min/max abs(h) vectors.
-    std::size_t iter_counter = 0;
-    for (std::uint32_t i = 0; i < m_batch_size; ++i) {
-        m_ts_count[i] = 0;
-        m_min_abs_h[i] = std::numeric_limits<T>::infinity();
-        m_max_abs_h[i] = 0;
+    if (std::any_of(time.begin(), time.end(), [](const auto &x) { return !isfinite(x); })) {
+        throw std::invalid_argument("A non-finite time was passed to the reset() function of an adaptive Taylor "
+                                    "integrator in batch mode");
     }
 
-    while (true) {
-        // Compute the max integration times for this timestep.
-        // NOTE: ts[i] - m_time[i] is guaranteed not to be nan: ts[i] is never non-finite,
-        // and at the first iteration we have checked above the value of m_time.
-        // At successive iterations, we know that m_time[i] must be finite because
-        // otherwise we would have exited the loop when checking m_step_res.
-        for (std::uint32_t i = 0; i < m_batch_size; ++i) {
-            m_cur_max_delta_ts[i] = ts[i] - m_time[i];
-        }
-
-        // Run the integration timestep.
-        step_impl(m_cur_max_delta_ts, false);
-
-        // Check if the integration timestep produced an error condition.
-        if (std::any_of(m_step_res.begin(), m_step_res.end(), [](const auto &tup) {
-                return std::get<0>(tup) != taylor_outcome::success && std::get<0>(tup) != taylor_outcome::time_limit;
-            })) {
-            break;
-        }
-
-        // Update the iteration counter.
-        ++iter_counter;
-
-        // Update the local step counters.
-        for (std::uint32_t i = 0; i < m_batch_size; ++i) {
-            // NOTE: the local step counters increase only if we integrated
-            // for a non-zero time.
-            m_ts_count[i] += static_cast<std::size_t>(std::get<1>(m_step_res[i]) != 0);
-        }
-
-        // Break out if we have reached the time limit for all
-        // batch elements.
-        if (std::all_of(m_step_res.begin(), m_step_res.end(),
-                        [](const auto &tup) { return std::get<0>(tup) == taylor_outcome::time_limit; })) {
-            break;
-        }
-
-        // Update min_h/max_h.
-        for (std::uint32_t i = 0; i < m_batch_size; ++i) {
-            // Don't update if we reached the time limit.
-            if (std::get<0>(m_step_res[i]) == taylor_outcome::time_limit) {
-                continue;
-            }
-
-            using std::abs;
-            const auto abs_h = abs(std::get<1>(m_step_res[i]));
-            m_min_abs_h[i] = std::min(m_min_abs_h[i], abs_h);
-            m_max_abs_h[i] = std::max(m_max_abs_h[i], abs_h);
-        }
-
-        // Check the iteration limit.
-        if (max_steps != 0u && iter_counter == max_steps) {
-            break;
-        }
+    if (pars != nullptr && pars->size() != m_pars.size()) {
+        throw std::invalid_argument("Invalid vector of parameters passed to the reset() function of an adaptive "
+                                    "Taylor integrator in batch mode: the size of the vector is "
+                                    + std::to_string(pars->size()) + ", but it must be "
+                                    + std::to_string(m_pars.size()));
     }
 
-    // Assemble the return value.
-    if (max_steps != 0u && iter_counter == max_steps) {
-        // We exited because we reached the max_steps limit: if the last integration step was successful
-        // return step_limit, otherwise time_limit.
-        for (std::uint32_t i = 0; i < m_batch_size; ++i) {
-            m_prop_res[i]
-                = std::tuple{std::get<0>(m_step_res[i]) == taylor_outcome::success ? taylor_outcome::step_limit
-                                                                                   : taylor_outcome::time_limit,
-                             m_min_abs_h[i], m_max_abs_h[i], m_ts_count[i]};
-        }
-    } else {
-        // We exited either because of an error, or because all the batch
-        // elements reached the time limits. In this case, we just use the
-        // outcome of the last timestep.
-        for (std::uint32_t i = 0; i < m_batch_size; ++i) {
-            m_prop_res[i] = std::tuple{std::get<0>(m_step_res[i]), m_min_abs_h[i], m_max_abs_h[i], m_ts_count[i]};
-        }
+    std::copy(state.begin(), state.end(), get_state_data());
+    if (pars != nullptr) {
+        std::copy(pars->begin(), pars->end(), get_pars_data());
     }
 
-    return m_prop_res;
+    std::copy(time.begin(), time.end(), m_time.begin());
+    std::fill(m_time_lo.begin(), m_time_lo.end(), T(0));
+
+    // Clear the per-run data.
+    // NOTE: this includes the predicted timesteps
+    // stored in m_delta_ts (see step_impl_core()).
+    std::fill(m_last_h.begin(), m_last_h.end(), T(0));
+    std::fill(m_delta_ts.begin(), m_delta_ts.end(), T(0));
 }
 
 template <typename T>
-const llvm_state &taylor_adaptive_batch_impl<T>::get_llvm_state() const
+void taylor_adaptive_batch_impl<T>::reset(const std::vector<T> &state, const std::vector<T> &time)
 {
-    return m_llvm;
+    reset_impl(state, time, nullptr);
+}
+
+template <typename T>
+void taylor_adaptive_batch_impl<T>::reset(const std::vector<T> &state, const std::vector<T> &time,
+                                          const std::vector<T> &pars)
+{
+    reset_impl(state, time, &pars);
 }
 
 template <typename T>
 const std::vector<std::pair<expression, std::vector<std::uint32_t>>> &
 taylor_adaptive_batch_impl<T>::get_decomposition() const
 {
-    return m_dc;
+    return taylor_dc_or_empty(m_dc);
 }
 
 template <typename T>
@@ -1597,33 +5702,52 @@ std::uint32_t taylor_adaptive_batch_impl<T>::get_dim() const
 
 // Explicit instantiation of the batch implementation classes.
 template class taylor_adaptive_batch_impl<double>;
-template HEYOKA_DLL_PUBLIC void
-taylor_adaptive_batch_impl<double>::finalise_ctor_impl(std::vector<expression>, std::vector<double>, std::uint32_t,
-                                                       std::vector<double>, double, bool, bool, std::vector<double>);
-template HEYOKA_DLL_PUBLIC void
-taylor_adaptive_batch_impl<double>::finalise_ctor_impl(std::vector<std::pair<expression, expression>>,
-                                                       std::vector<double>, std::uint32_t, std::vector<double>, double,
-                                                       bool, bool, std::vector<double>);
+template HEYOKA_DLL_PUBLIC void taylor_adaptive_batch_impl<double>::finalise_ctor_impl(
+    std::vector<expression>, std::vector<double>, std::uint32_t, std::vector<double>, double, bool, bool,
+    std::vector<double>, std::vector<std::string>, std::size_t, taylor_sort_strategy, bool, std::uint32_t,
+    taylor_jet_layout, double, double, std::vector<double>, bool, bool, bool, std::uint32_t, bool);
+template HEYOKA_DLL_PUBLIC void taylor_adaptive_batch_impl<double>::finalise_ctor_impl(
+    std::vector<std::pair<expression, expression>>, std::vector<double>, std::uint32_t, std::vector<double>, double,
+    bool, bool, std::vector<double>, std::vector<std::string>, std::size_t, taylor_sort_strategy, bool, std::uint32_t,
+    taylor_jet_layout, double, double, std::vector<double>, bool, bool, bool, std::uint32_t, bool);
+template HEYOKA_DLL_PUBLIC void taylor_adaptive_batch_impl<double>::finalise_ctor_impl(
+    taylor_dc_t, std::vector<double>, std::uint32_t, std::vector<double>, double,
+    bool, bool, std::vector<double>, std::vector<std::string>, std::size_t, taylor_sort_strategy, bool, std::uint32_t,
+    taylor_jet_layout, double, double, std::vector<double>, bool, bool, bool, std::uint32_t, bool);
 
 template class taylor_adaptive_batch_impl<long double>;
-template HEYOKA_DLL_PUBLIC void
-taylor_adaptive_batch_impl<long double>::finalise_ctor_impl(std::vector<expression>, std::vector<long double>,
-                                                            std::uint32_t, std::vector<long double>, long double, bool,
-                                                            bool, std::vector<long double>);
+template HEYOKA_DLL_PUBLIC void taylor_adaptive_batch_impl<long double>::finalise_ctor_impl(
+    std::vector<expression>, std::vector<long double>, std::uint32_t, std::vector<long double>, long double, bool, bool,
+    std::vector<long double>, std::vector<std::string>, std::size_t, taylor_sort_strategy, bool, std::uint32_t,
+    taylor_jet_layout, long double, long double, std::vector<long double>, bool, bool, bool, std::uint32_t, bool);
 template HEYOKA_DLL_PUBLIC void taylor_adaptive_batch_impl<long double>::finalise_ctor_impl(
     std::vector<std::pair<expression, expression>>, std::vector<long double>, std::uint32_t, std::vector<long double>,
-    long double, bool, bool, std::vector<long double>);
+    long double, bool, bool, std::vector<long double>, std::vector<std::string>, std::size_t, taylor_sort_strategy,
+    bool, std::uint32_t, taylor_jet_layout, long double, long double, std::vector<long double>, bool, bool, bool,
+    std::uint32_t, bool);
+template HEYOKA_DLL_PUBLIC void taylor_adaptive_batch_impl<long double>::finalise_ctor_impl(
+    taylor_dc_t, std::vector<long double>, std::uint32_t, std::vector<long double>,
+    long double, bool, bool, std::vector<long double>, std::vector<std::string>, std::size_t, taylor_sort_strategy,
+    bool, std::uint32_t, taylor_jet_layout, long double, long double, std::vector<long double>, bool, bool, bool,
+    std::uint32_t, bool);
 
 #if defined(HEYOKA_HAVE_REAL128)
 
 template class taylor_adaptive_batch_impl<mppp::real128>;
-template HEYOKA_DLL_PUBLIC void
-taylor_adaptive_batch_impl<mppp::real128>::finalise_ctor_impl(std::vector<expression>, std::vector<mppp::real128>,
-                                                              std::uint32_t, std::vector<mppp::real128>, mppp::real128,
-                                                              bool, bool, std::vector<mppp::real128>);
+template HEYOKA_DLL_PUBLIC void taylor_adaptive_batch_impl<mppp::real128>::finalise_ctor_impl(
+    std::vector<expression>, std::vector<mppp::real128>, std::uint32_t, std::vector<mppp::real128>, mppp::real128, bool,
+    bool, std::vector<mppp::real128>, std::vector<std::string>, std::size_t, taylor_sort_strategy, bool, std::uint32_t,
+    taylor_jet_layout, mppp::real128, mppp::real128, std::vector<mppp::real128>, bool, bool, bool, std::uint32_t, bool);
 template HEYOKA_DLL_PUBLIC void taylor_adaptive_batch_impl<mppp::real128>::finalise_ctor_impl(
     std::vector<std::pair<expression, expression>>, std::vector<mppp::real128>, std::uint32_t,
-    std::vector<mppp::real128>, mppp::real128, bool, bool, std::vector<mppp::real128>);
+    std::vector<mppp::real128>, mppp::real128, bool, bool, std::vector<mppp::real128>, std::vector<std::string>,
+    std::size_t, taylor_sort_strategy, bool, std::uint32_t, taylor_jet_layout, mppp::real128, mppp::real128,
+    std::vector<mppp::real128>, bool, bool, bool, std::uint32_t, bool);
+template HEYOKA_DLL_PUBLIC void taylor_adaptive_batch_impl<mppp::real128>::finalise_ctor_impl(
+    taylor_dc_t, std::vector<mppp::real128>, std::uint32_t,
+    std::vector<mppp::real128>, mppp::real128, bool, bool, std::vector<mppp::real128>, std::vector<std::string>,
+    std::size_t, taylor_sort_strategy, bool, std::uint32_t, taylor_jet_layout, mppp::real128, mppp::real128,
+    std::vector<mppp::real128>, bool, bool, bool, std::uint32_t, bool);
 
 #endif
 
@@ -1680,6 +5804,68 @@ void taylor_c_store_diff(llvm_state &s, llvm::Value *diff_arr, std::uint32_t n_u
     builder.CreateStore(val, ptr);
 }
 
+// Prefetch, for writing, the slot of the derivative of order 'order + 1' of the u variable
+// u_idx in the array of Taylor derivatives diff_arr. n_uvars is the total number of u variables.
+// NOTE: in the order-major layout (and for large n_uvars) the slots of the same u
+// variable at consecutive orders are far apart, so that the slot written (and then read
+// by the dependent u variables) at the next order is likely not in cache.
+void taylor_c_prefetch_diff(llvm_state &s, llvm::Value *diff_arr, std::uint32_t n_uvars, llvm::Value *order,
+                            llvm::Value *u_idx)
+{
+    auto &builder = s.builder();
+
+    // NOTE: the prefetching past the end of the array (i.e., at the
+    // last order) is harmless, hence the non-inbounds GEP.
+    auto *idx = builder.CreateAdd(
+        builder.CreateMul(builder.CreateAdd(order, builder.getInt32(1)), builder.getInt32(n_uvars)), u_idx);
+    auto *ptr
+        = builder.CreateGEP(llvm::cast<llvm::PointerType>(diff_arr->getType())->getElementType(), diff_arr, {idx});
+
+    llvm_invoke_intrinsic(s, "llvm.prefetch", {ptr->getType()},
+                          {ptr, builder.getInt32(1), builder.getInt32(3), builder.getInt32(1)});
+}
+
+// Layout of the array of Taylor derivatives in compact mode: the derivative
+// of order o of the u variable i is stored at index o * order_stride + i * u_stride.
+// NOTE: taylor_c_load_diff() and taylor_c_store_diff(), and the compact-mode
+// functions for the computation of the derivatives, index into the array as
+// o * n_uvars + i. They are thus passed order_stride in place of n_uvars, and
+// the indices of the u variables premultiplied by u_stride.
+struct taylor_c_jet_layout {
+    std::uint32_t order_stride;
+    std::uint32_t u_stride;
+};
+
+// NOTE: the overflow checking is done in taylor_compute_jet().
+taylor_c_jet_layout taylor_c_make_jet_layout(taylor_jet_layout l, std::uint32_t n_uvars, std::uint32_t order)
+{
+    switch (l) {
+        case taylor_jet_layout::order_major:
+            return {n_uvars, 1};
+        case taylor_jet_layout::var_major:
+            return {1, order + 1u};
+        default:
+            throw std::invalid_argument("Invalid jet layout specified for a Taylor integrator: the value "
+                                        + std::to_string(static_cast<int>(l)) + " is not valid");
+    }
+}
+
+// Premultiply the index u_idx of a u variable by the u stride of the layout jl.
+llvm::Value *taylor_c_scale_u_idx(llvm_state &s, const taylor_c_jet_layout &jl, llvm::Value *u_idx)
+{
+    auto &builder = s.builder();
+
+    return jl.u_stride == 1u ? u_idx : builder.CreateMul(u_idx, builder.getInt32(jl.u_stride));
+}
+
+// Load the derivative of order 'order' of the u variable u_idx from the array
+// of Taylor derivatives diff_arr, whose layout is jl.
+llvm::Value *taylor_c_load_jet(llvm_state &s, llvm::Value *diff_arr, const taylor_c_jet_layout &jl, llvm::Value *order,
+                               llvm::Value *u_idx)
+{
+    return taylor_c_load_diff(s, diff_arr, jl.order_stride, order, taylor_c_scale_u_idx(s, jl, u_idx));
+}
+
 // Compute the derivative of order "order" of a state variable.
 // ex is the formula for the first-order derivative of the state variable (which
 // is either a u variable or a number/param), n_uvars the number of variables in
@@ -1701,7 +5887,7 @@ llvm::Value *taylor_compute_sv_diff(llvm_state &s, const expression &ex, const s
             if constexpr (std::is_same_v<type, variable>) {
                 // Extract the index of the u variable in the expression
                 // of the first-order derivative.
-                const auto u_idx = uname_to_index(v.name());
+                const auto u_idx = uname_to_index(v);
 
                 // Fetch from arr the derivative
                 // of order 'order - 1' of the u variable at u_idx. The index is:
@@ -1725,8 +5911,44 @@ llvm::Value *taylor_compute_sv_diff(llvm_state &s, const expression &ex, const s
                     return vector_splat(builder, codegen<T>(s, number{0.}), batch_size);
                 }
             } else {
-                assert(false);
-                return nullptr;
+                assert(false);
+                return nullptr;
+            }
+        },
+        ex.value());
+}
+
+// Helper that takes in input the definition ex of a u variable, and returns
+// in output the list of indices of the u variables on which ex depends.
+std::vector<std::uint32_t> taylor_udef_args_indices(const expression &ex)
+{
+    return std::visit(
+        [](const auto &v) -> std::vector<std::uint32_t> {
+            using type = detail::uncvref_t<decltype(v)>;
+
+            if constexpr (std::is_same_v<type, func> || std::is_same_v<type, binary_operator>) {
+                std::vector<std::uint32_t> retval;
+
+                for (const auto &arg : v.args()) {
+                    std::visit(
+                        [&retval](const auto &x) {
+                            using tp = detail::uncvref_t<decltype(x)>;
+
+                            if constexpr (std::is_same_v<tp, variable>) {
+                                retval.push_back(uname_to_index(x));
+                            } else if constexpr (!std::is_same_v<tp, number> && !std::is_same_v<tp, param>) {
+                                throw std::invalid_argument(
+                                    "Invalid argument encountered in an element of a Taylor decomposition: the "
+                                    "argument is not a variable or a number/param");
+                            }
+                        },
+                        arg.value());
+                }
+
+                return retval;
+            } else {
+                throw std::invalid_argument("Invalid expression encountered in a Taylor decomposition: the "
+                                            "expression is not a function or a binary operator");
             }
         },
         ex.value());
@@ -1735,102 +5957,87 @@ llvm::Value *taylor_compute_sv_diff(llvm_state &s, const expression &ex, const s
 // Function to split the central part of the decomposition (i.e., the definitions of the u variables
 // that do not represent state variables) into parallelisable segments. Within a segment,
 // the definition of a u variable does not depend on any u variable defined within that segment.
+// The segments are returned as lists of indices of u variables.
+// NOTE: each u variable is assigned to the segment immediately following the last segment
+// containing one of its arguments (i.e., the segment index is the length of the longest
+// dependency chain leading to the u variable). This results in the minimum number of
+// segments, and it merges into the same segment the u variables which would end up in
+// distinct segments if the decomposition were split only at the dependency boundaries
+// in its sequential order. Within a segment, the u variables are sorted by index.
 // NOTE: the hidden deps are not considered as dependencies.
-std::vector<std::vector<std::pair<expression, std::vector<std::uint32_t>>>>
+std::vector<std::vector<std::uint32_t>>
 taylor_segment_dc(const std::vector<std::pair<expression, std::vector<std::uint32_t>>> &dc, std::uint32_t n_eq)
 {
-    // Helper that takes in input the definition ex of a u variable, and returns
-    // in output the list of indices of the u variables on which ex depends.
-    auto udef_args_indices = [](const expression &ex) -> std::vector<std::uint32_t> {
-        return std::visit(
-            [](const auto &v) -> std::vector<std::uint32_t> {
-                using type = detail::uncvref_t<decltype(v)>;
-
-                if constexpr (std::is_same_v<type, func> || std::is_same_v<type, binary_operator>) {
-                    std::vector<std::uint32_t> retval;
-
-                    for (const auto &arg : v.args()) {
-                        std::visit(
-                            [&retval](const auto &x) {
-                                using tp = detail::uncvref_t<decltype(x)>;
-
-                                if constexpr (std::is_same_v<tp, variable>) {
-                                    retval.push_back(uname_to_index(x.name()));
-                                } else if constexpr (!std::is_same_v<tp, number> && !std::is_same_v<tp, param>) {
-                                    throw std::invalid_argument(
-                                        "Invalid argument encountered in an element of a Taylor decomposition: the "
-                                        "argument is not a variable or a number/param");
-                                }
-                            },
-                            arg.value());
-                    }
-
-                    return retval;
-                } else {
-                    throw std::invalid_argument("Invalid expression encountered in a Taylor decomposition: the "
-                                                "expression is not a function or a binary operator");
-                }
-            },
-            ex.value());
-    };
+    assert(dc.size() >= n_eq * 2u);
 
     // Init the return value.
-    std::vector<std::vector<std::pair<expression, std::vector<std::uint32_t>>>> s_dc;
+    std::vector<std::vector<std::uint32_t>> s_dc;
+
+    // The segment index of each u variable which
+    // is not a state variable.
+    std::vector<decltype(s_dc.size())> seg_idx;
+    seg_idx.reserve(dc.size() - n_eq * 2u);
 
-    // cur_limit_idx is initially the index of the first
-    // u variable which is not a state variable.
-    auto cur_limit_idx = n_eq;
     for (std::uint32_t i = n_eq; i < dc.size() - n_eq; ++i) {
-        // NOTE: at the very first iteration of this for loop,
-        // no block has been created yet. Do it now.
-        if (i == n_eq) {
-            assert(s_dc.empty());
-            s_dc.emplace_back();
-        } else {
-            assert(!s_dc.empty());
-        }
+        // Determine the u indices on which the definition depends.
+        const auto u_indices = taylor_udef_args_indices(dc[i].first);
 
-        const auto &[ex, deps] = dc[i];
+        // The segment of the current u variable follows
+        // the segments of all its arguments.
+        decltype(s_dc.size()) cur_seg = 0;
+        for (auto idx : u_indices) {
+            assert(idx < i);
 
-        // Determine the u indices on which ex depends.
-        const auto u_indices = udef_args_indices(ex);
+            if (idx >= n_eq) {
+                cur_seg = std::max(cur_seg, seg_idx[idx - n_eq] + 1u);
+            }
+        }
+        seg_idx.push_back(cur_seg);
 
-        if (std::any_of(u_indices.begin(), u_indices.end(),
-                        [cur_limit_idx](auto idx) { return idx >= cur_limit_idx; })) {
-            // The current expression depends on one or more variables
-            // within the current block. Start a new block and
-            // update cur_limit_idx with the start index of the new block.
+        if (cur_seg == s_dc.size()) {
             s_dc.emplace_back();
-            cur_limit_idx = i;
         }
+        assert(cur_seg < s_dc.size());
 
-        // Append ex to the current block.
-        s_dc.back().emplace_back(ex, deps);
+        s_dc[cur_seg].push_back(i);
     }
 
 #if !defined(NDEBUG)
     // Verify s_dc.
 
+    // The segment index of each u variable (the state
+    // variables are marked as belonging to no segment).
+    std::vector<decltype(s_dc.size())> v_seg(dc.size(), s_dc.size());
+
     decltype(dc.size()) counter = 0;
-    for (const auto &s : s_dc) {
+    for (decltype(s_dc.size()) j = 0; j < s_dc.size(); ++j) {
         // No segment can be empty.
-        assert(!s.empty());
+        assert(!s_dc[j].empty());
+        assert(std::is_sorted(s_dc[j].begin(), s_dc[j].end()));
 
-        for (const auto &[ex, _] : s) {
-            // All the indices in the definitions of the
-            // u variables in the current block must be
-            // less than counter + n_eq (which is the starting
-            // index of the block).
-            const auto u_indices = udef_args_indices(ex);
-            assert(std::all_of(u_indices.begin(), u_indices.end(),
-                               [idx_limit = counter + n_eq](auto idx) { return idx < idx_limit; }));
+        for (auto idx : s_dc[j]) {
+            assert(idx >= n_eq && idx < dc.size() - n_eq);
+            assert(v_seg[idx] == s_dc.size());
+            v_seg[idx] = j;
         }
 
         // Update the counter.
-        counter += s.size();
+        counter += s_dc[j].size();
     }
 
     assert(counter == dc.size() - n_eq * 2u);
+
+    for (const auto &seg : s_dc) {
+        for (auto idx : seg) {
+            // All the u variables in the definitions of the
+            // u variables in the current segment must be state
+            // variables or belong to previous segments.
+            const auto u_indices = taylor_udef_args_indices(dc[idx].first);
+            assert(std::all_of(u_indices.begin(), u_indices.end(), [&](auto u_idx) {
+                return u_idx < n_eq || (v_seg[u_idx] < v_seg[idx]);
+            }));
+        }
+    }
 #endif
 
     return s_dc;
@@ -1845,26 +6052,64 @@ std::uint32_t taylor_c_gl_arr_size(llvm::Value *v)
         llvm::cast<llvm::ArrayType>(llvm::cast<llvm::PointerType>(v->getType())->getElementType())->getNumElements());
 }
 
+// Helper to create a global read-only array containing the indices ind.
+// The indices are stored in the narrowest unsigned integer type (8, 16 or 32 bits)
+// which can represent all of them, so as to reduce the data cache footprint
+// of the compact-mode code. The arrays with the same content are interned
+// (see make_global_const_array()).
+llvm::GlobalVariable *taylor_c_make_idx_array(llvm_state &s, const std::vector<std::uint32_t> &ind)
+{
+    auto &builder = s.builder();
+
+    const auto max_idx = ind.empty() ? std::uint32_t(0) : *std::max_element(ind.begin(), ind.end());
+    auto *int_t = max_idx <= std::numeric_limits<std::uint8_t>::max()    ? builder.getInt8Ty()
+                  : max_idx <= std::numeric_limits<std::uint16_t>::max() ? builder.getInt16Ty()
+                                                                          : builder.getInt32Ty();
+
+    std::vector<llvm::Constant *> tmp_c_vec;
+    for (const auto &val : ind) {
+        tmp_c_vec.push_back(llvm::ConstantInt::get(int_t, val));
+    }
+
+    auto *arr_type = llvm::ArrayType::get(int_t, boost::numeric_cast<std::uint64_t>(ind.size()));
+
+    return make_global_const_array(s.module(), llvm::ConstantArray::get(arr_type, tmp_c_vec));
+}
+
+// Load the index at position idx from the global array gv created by
+// taylor_c_make_idx_array(). The index is returned as a 32-bit integer.
+llvm::Value *taylor_c_load_idx(llvm_state &s, llvm::GlobalVariable *gv, llvm::Value *idx)
+{
+    auto &builder = s.builder();
+
+    // NOTE: CreateZExt() is a no-op if the index is already a 32-bit integer.
+    return builder.CreateZExt(builder.CreateLoad(builder.CreateInBoundsGEP(gv, {builder.getInt32(0), idx})),
+                              builder.getInt32Ty());
+}
+
 // Helper to construct the global arrays needed for the computation of the
 // derivatives of the state variables. The return value is a set
-// of 6 arrays:
+// of 8 arrays:
 // - the indices of the state variables whose derivative is a u variable, paired to
 // - the indices of the u variables appearing in the derivatives, and
 // - the indices of the state variables whose derivative is a constant, paired to
 // - the values of said constants, and
 // - the indices of the state variables whose derivative is a param, paired to
-// - the indices of the params.
+// - the indices of the params, and
+// - the indices of the state variables whose derivative is a lane-shared param, paired to
+// - the indices of the lane-shared params.
+// The indices of the state and u variables are premultiplied by the u stride of the layout jl.
 template <typename T>
 auto taylor_c_make_sv_diff_globals(llvm_state &s,
                                    const std::vector<std::pair<expression, std::vector<std::uint32_t>>> &dc,
-                                   std::uint32_t n_uvars)
+                                   std::uint32_t n_uvars, const taylor_c_jet_layout &jl)
 {
     auto &context = s.context();
-    auto &builder = s.builder();
     auto &module = s.module();
 
-    // Build iteratively the output values as vectors of constants.
-    std::vector<llvm::Constant *> var_indices, vars, num_indices, nums, par_indices, pars;
+    // Build iteratively the output values as vectors of indices/constants.
+    std::vector<std::uint32_t> var_indices, vars, num_indices, par_indices, pars, spar_indices, spars;
+    std::vector<llvm::Constant *> nums;
 
     // NOTE: the derivatives of the state variables are at the end of the decomposition.
     for (auto i = n_uvars; i < boost::numeric_cast<std::uint32_t>(dc.size()); ++i) {
@@ -1875,14 +6120,14 @@ auto taylor_c_make_sv_diff_globals(llvm_state &s,
                 if constexpr (std::is_same_v<type, variable>) {
                     // NOTE: remove from i the n_uvars offset to get the
                     // true index of the state variable.
-                    var_indices.push_back(builder.getInt32(i - n_uvars));
-                    vars.push_back(builder.getInt32(uname_to_index(v.name())));
+                    var_indices.push_back((i - n_uvars) * jl.u_stride);
+                    vars.push_back(uname_to_index(v) * jl.u_stride);
                 } else if constexpr (std::is_same_v<type, number>) {
-                    num_indices.push_back(builder.getInt32(i - n_uvars));
+                    num_indices.push_back((i - n_uvars) * jl.u_stride);
                     nums.push_back(llvm::cast<llvm::Constant>(codegen<T>(s, v)));
                 } else if constexpr (std::is_same_v<type, param>) {
-                    par_indices.push_back(builder.getInt32(i - n_uvars));
-                    pars.push_back(builder.getInt32(v.idx()));
+                    (v.is_shared() ? spar_indices : par_indices).push_back((i - n_uvars) * jl.u_stride);
+                    (v.is_shared() ? spars : pars).push_back(v.idx());
                 } else {
                     assert(false);
                 }
@@ -1893,78 +6138,62 @@ auto taylor_c_make_sv_diff_globals(llvm_state &s,
     assert(var_indices.size() == vars.size());
     assert(num_indices.size() == nums.size());
     assert(par_indices.size() == pars.size());
+    assert(spar_indices.size() == spars.size());
 
     // Turn the vectors into global read-only LLVM arrays.
 
     // Variables.
-    auto var_arr_type
-        = llvm::ArrayType::get(llvm::Type::getInt32Ty(context), boost::numeric_cast<std::uint64_t>(var_indices.size()));
-
-    auto var_indices_arr = llvm::ConstantArray::get(var_arr_type, var_indices);
-    auto g_var_indices = new llvm::GlobalVariable(module, var_indices_arr->getType(), true,
-                                                  llvm::GlobalVariable::InternalLinkage, var_indices_arr);
-
-    auto vars_arr = llvm::ConstantArray::get(var_arr_type, vars);
-    auto g_vars
-        = new llvm::GlobalVariable(module, vars_arr->getType(), true, llvm::GlobalVariable::InternalLinkage, vars_arr);
+    auto g_var_indices = taylor_c_make_idx_array(s, var_indices);
+    auto g_vars = taylor_c_make_idx_array(s, vars);
 
     // Numbers.
-    auto num_indices_arr_type
-        = llvm::ArrayType::get(llvm::Type::getInt32Ty(context), boost::numeric_cast<std::uint64_t>(num_indices.size()));
-    auto num_indices_arr = llvm::ConstantArray::get(num_indices_arr_type, num_indices);
-    auto g_num_indices = new llvm::GlobalVariable(module, num_indices_arr->getType(), true,
-                                                  llvm::GlobalVariable::InternalLinkage, num_indices_arr);
+    auto g_num_indices = taylor_c_make_idx_array(s, num_indices);
 
     auto nums_arr_type
         = llvm::ArrayType::get(to_llvm_type<T>(context), boost::numeric_cast<std::uint64_t>(nums.size()));
-    auto nums_arr = llvm::ConstantArray::get(nums_arr_type, nums);
-    auto g_nums
-        = new llvm::GlobalVariable(module, nums_arr->getType(), true, llvm::GlobalVariable::InternalLinkage, nums_arr);
+    auto g_nums = make_global_const_array(module, llvm::ConstantArray::get(nums_arr_type, nums));
 
-    // Params.
-    auto par_arr_type
-        = llvm::ArrayType::get(llvm::Type::getInt32Ty(context), boost::numeric_cast<std::uint64_t>(par_indices.size()));
+    // Params and lane-shared params.
+    auto g_par_indices = taylor_c_make_idx_array(s, par_indices);
+    auto g_pars = taylor_c_make_idx_array(s, pars);
+    auto g_spar_indices = taylor_c_make_idx_array(s, spar_indices);
+    auto g_spars = taylor_c_make_idx_array(s, spars);
 
-    auto par_indices_arr = llvm::ConstantArray::get(par_arr_type, par_indices);
-    auto g_par_indices = new llvm::GlobalVariable(module, par_indices_arr->getType(), true,
-                                                  llvm::GlobalVariable::InternalLinkage, par_indices_arr);
-
-    auto pars_arr = llvm::ConstantArray::get(par_arr_type, pars);
-    auto g_pars
-        = new llvm::GlobalVariable(module, pars_arr->getType(), true, llvm::GlobalVariable::InternalLinkage, pars_arr);
-
-    return std::array{g_var_indices, g_vars, g_num_indices, g_nums, g_par_indices, g_pars};
+    return std::array{g_var_indices, g_vars, g_num_indices, g_nums, g_par_indices, g_pars, g_spar_indices, g_spars};
 }
 
 // Helper to compute and store the derivatives of the state variables in compact mode at order 'order'.
 // sv_diff_gl is the set of arrays produced by taylor_c_make_sv_diff_globals(), which contain
-// the indices/constants necessary for the computation.
+// the indices/constants necessary for the computation. jl is the layout of diff_arr.
 template <typename T>
-void taylor_c_compute_sv_diffs(llvm_state &s, const std::array<llvm::GlobalVariable *, 6> &sv_diff_gl,
-                               llvm::Value *diff_arr, llvm::Value *par_ptr, std::uint32_t n_uvars, llvm::Value *order,
-                               std::uint32_t batch_size)
+void taylor_c_compute_sv_diffs(llvm_state &s, const std::array<llvm::GlobalVariable *, 8> &sv_diff_gl,
+                               llvm::Value *diff_arr, llvm::Value *par_ptr, const taylor_c_jet_layout &jl,
+                               llvm::Value *order, std::uint32_t batch_size)
 {
     assert(batch_size > 0u);
 
+    // NOTE: the indices in sv_diff_gl are already premultiplied
+    // by the u stride, see taylor_c_make_sv_diff_globals().
+
     auto &builder = s.builder();
     auto &context = s.context();
 
     // Recover the number of state variables whose derivatives are given
-    // by u variables, numbers and params.
+    // by u variables and numbers.
     const auto n_vars = taylor_c_gl_arr_size(sv_diff_gl[0]);
     const auto n_nums = taylor_c_gl_arr_size(sv_diff_gl[2]);
-    const auto n_pars = taylor_c_gl_arr_size(sv_diff_gl[4]);
 
     // Handle the u variables definitions.
     llvm_loop_u32(s, builder.getInt32(0), builder.getInt32(n_vars), [&](llvm::Value *cur_idx) {
         // Fetch the index of the state variable.
-        auto sv_idx = builder.CreateLoad(builder.CreateInBoundsGEP(sv_diff_gl[0], {builder.getInt32(0), cur_idx}));
+        auto sv_idx = taylor_c_load_idx(s, sv_diff_gl[0], cur_idx);
 
         // Fetch the index of the u variable.
-        auto u_idx = builder.CreateLoad(builder.CreateInBoundsGEP(sv_diff_gl[1], {builder.getInt32(0), cur_idx}));
+        auto u_idx = taylor_c_load_idx(s, sv_diff_gl[1], cur_idx);
 
         // Fetch from diff_arr the derivative of order 'order - 1' of the u variable u_idx.
-        auto ret = taylor_c_load_diff(s, diff_arr, n_uvars, builder.CreateSub(order, builder.getInt32(1)), u_idx);
+        auto ret
+            = taylor_c_load_diff(s, diff_arr, jl.order_stride, builder.CreateSub(order, builder.getInt32(1)), u_idx);
 
         // We have to divide the derivative by 'order' in order
         // to get the normalised derivative of the state variable.
@@ -1972,13 +6201,13 @@ void taylor_c_compute_sv_diffs(llvm_state &s, const std::array<llvm::GlobalVaria
             ret, vector_splat(builder, builder.CreateUIToFP(order, to_llvm_type<T>(context)), batch_size));
 
         // Store the derivative.
-        taylor_c_store_diff(s, diff_arr, n_uvars, order, sv_idx, ret);
+        taylor_c_store_diff(s, diff_arr, jl.order_stride, order, sv_idx, ret);
     });
 
     // Handle the number definitions.
     llvm_loop_u32(s, builder.getInt32(0), builder.getInt32(n_nums), [&](llvm::Value *cur_idx) {
         // Fetch the index of the state variable.
-        auto sv_idx = builder.CreateLoad(builder.CreateInBoundsGEP(sv_diff_gl[2], {builder.getInt32(0), cur_idx}));
+        auto sv_idx = taylor_c_load_idx(s, sv_diff_gl[2], cur_idx);
 
         // Fetch the constant.
         auto num = builder.CreateLoad(builder.CreateInBoundsGEP(sv_diff_gl[3], {builder.getInt32(0), cur_idx}));
@@ -1993,46 +6222,55 @@ void taylor_c_compute_sv_diffs(llvm_state &s, const std::array<llvm::GlobalVaria
                                         vector_splat(builder, codegen<T>(s, number{0.}), batch_size));
 
         // Store the derivative.
-        taylor_c_store_diff(s, diff_arr, n_uvars, order, sv_idx, ret);
+        taylor_c_store_diff(s, diff_arr, jl.order_stride, order, sv_idx, ret);
     });
 
-    // Handle the param definitions.
-    llvm_loop_u32(s, builder.getInt32(0), builder.getInt32(n_pars), [&](llvm::Value *cur_idx) {
-        // Fetch the index of the state variable.
-        auto sv_idx = builder.CreateLoad(builder.CreateInBoundsGEP(sv_diff_gl[4], {builder.getInt32(0), cur_idx}));
-
-        // Fetch the index of the param.
-        auto par_idx = builder.CreateLoad(builder.CreateInBoundsGEP(sv_diff_gl[5], {builder.getInt32(0), cur_idx}));
-
-        // If the first-order derivative is being requested,
-        // do the codegen for the constant itself, otherwise
-        // return 0. No need for normalization as the only
-        // nonzero value that can be produced here is the first-order
-        // derivative.
-        llvm_if_then_else(
-            s, builder.CreateICmpEQ(order, builder.getInt32(1)),
-            [&]() {
-                // Derivative of order 1. Fetch the value from par_ptr.
-                // NOTE: param{0} is unused, its only purpose is type tagging.
-                taylor_c_store_diff(s, diff_arr, n_uvars, order, sv_idx,
-                                    taylor_c_diff_numparam_codegen(s, param{0}, par_idx, par_ptr, batch_size));
-            },
-            [&]() {
-                // Derivative of order > 1, return 0.
-                taylor_c_store_diff(s, diff_arr, n_uvars, order, sv_idx,
-                                    vector_splat(builder, codegen<T>(s, number{0.}), batch_size));
-            });
-    });
+    // Handle the param and lane-shared param definitions.
+    for (auto shared : {false, true}) {
+        const auto gl_offset = shared ? 6u : 4u;
+        const auto n_pars = taylor_c_gl_arr_size(sv_diff_gl[gl_offset]);
+
+        llvm_loop_u32(s, builder.getInt32(0), builder.getInt32(n_pars), [&](llvm::Value *cur_idx) {
+            // Fetch the index of the state variable.
+            auto sv_idx = taylor_c_load_idx(s, sv_diff_gl[gl_offset], cur_idx);
+
+            // Fetch the index of the param.
+            auto par_idx = taylor_c_load_idx(s, sv_diff_gl[gl_offset + 1u], cur_idx);
+
+            // If the first-order derivative is being requested,
+            // do the codegen for the constant itself, otherwise
+            // return 0. No need for normalization as the only
+            // nonzero value that can be produced here is the first-order
+            // derivative.
+            llvm_if_then_else(
+                s, builder.CreateICmpEQ(order, builder.getInt32(1)),
+                [&]() {
+                    // Derivative of order 1. Fetch the value from par_ptr.
+                    // NOTE: the index of param{0, shared} is unused, its only
+                    // purpose is type tagging.
+                    taylor_c_store_diff(
+                        s, diff_arr, jl.order_stride, order, sv_idx,
+                        taylor_c_diff_numparam_codegen(s, param{0, shared}, par_idx, par_ptr, batch_size));
+                },
+                [&]() {
+                    // Derivative of order > 1, return 0.
+                    taylor_c_store_diff(s, diff_arr, jl.order_stride, order, sv_idx,
+                                        vector_splat(builder, codegen<T>(s, number{0.}), batch_size));
+                });
+        });
+    }
 }
 
 // Helper to convert the arguments of the definition of a u variable
 // into a vector of variants. u variables will be converted to their indices,
 // numbers will be unchanged, parameters will be converted to their indices.
-// The hidden deps will also be converted to indices.
-auto taylor_udef_to_variants(const expression &ex, const std::vector<std::uint32_t> &deps)
+// The hidden deps will also be converted to indices. The indices of the u variables
+// (including the hidden deps) are multiplied by u_stride.
+auto taylor_udef_to_variants(const expression &ex, const std::vector<std::uint32_t> &deps,
+                             std::uint32_t u_stride = 1)
 {
     return std::visit(
-        [&deps](const auto &v) -> std::vector<std::variant<std::uint32_t, number>> {
+        [&deps, u_stride](const auto &v) -> std::vector<std::variant<std::uint32_t, number>> {
             using type = detail::uncvref_t<decltype(v)>;
 
             if constexpr (std::is_same_v<type, func> || std::is_same_v<type, binary_operator>) {
@@ -2040,11 +6278,11 @@ auto taylor_udef_to_variants(const expression &ex, const std::vector<std::uint32
 
                 for (const auto &arg : v.args()) {
                     std::visit(
-                        [&retval](const auto &x) {
+                        [&retval, u_stride](const auto &x) {
                             using tp = detail::uncvref_t<decltype(x)>;
 
                             if constexpr (std::is_same_v<tp, variable>) {
-                                retval.emplace_back(uname_to_index(x.name()));
+                                retval.emplace_back(uname_to_index(x) * u_stride);
                             } else if constexpr (std::is_same_v<tp, number>) {
                                 retval.emplace_back(x);
                             } else if constexpr (std::is_same_v<tp, param>) {
@@ -2060,7 +6298,7 @@ auto taylor_udef_to_variants(const expression &ex, const std::vector<std::uint32
 
                 // Handle the hidden deps.
                 for (auto idx : deps) {
-                    retval.emplace_back(idx);
+                    retval.emplace_back(idx * u_stride);
                 }
 
                 return retval;
@@ -2157,32 +6395,11 @@ std::function<llvm::Value *(llvm::Value *)> taylor_c_make_arg_gen_vidx(llvm_stat
         };
     }
 
-    auto &module = s.module();
-
-    // Generate the array of indices as llvm constants.
-    std::vector<llvm::Constant *> tmp_c_vec;
-    for (const auto &val : ind) {
-        tmp_c_vec.push_back(builder.getInt32(val));
-    }
-
-    // Create the array type.
-    auto arr_type = llvm::ArrayType::get(tmp_c_vec[0]->getType(), boost::numeric_cast<std::uint64_t>(ind.size()));
-    assert(arr_type != nullptr);
-
-    // Create the constant array as a global read-only variable.
-    auto const_arr = llvm::ConstantArray::get(arr_type, tmp_c_vec);
-    assert(const_arr != nullptr);
-    // NOTE: naked new here is fine, gvar will be registered in the module
-    // object and cleaned up when the module is destroyed.
-    auto gvar = new llvm::GlobalVariable(module, const_arr->getType(), true, llvm::GlobalVariable::InternalLinkage,
-                                         const_arr);
+    // Create the (interned and packed) array of indices as a global read-only variable.
+    auto gvar = taylor_c_make_idx_array(s, ind);
 
     // Return the generator.
-    return [gvar, &s](llvm::Value *cur_call_idx) -> llvm::Value * {
-        auto &builder = s.builder();
-
-        return builder.CreateLoad(builder.CreateInBoundsGEP(gvar, {builder.getInt32(0), cur_call_idx}));
-    };
+    return [gvar, &s](llvm::Value *cur_call_idx) -> llvm::Value * { return taylor_c_load_idx(s, gvar, cur_call_idx); };
 }
 
 template <typename T>
@@ -2199,8 +6416,6 @@ std::function<llvm::Value *(llvm::Value *)> taylor_c_make_arg_gen_vc(llvm_state
         return [num = codegen<T>(s, vc[0])](llvm::Value *) -> llvm::Value * { return num; };
     }
 
-    auto &module = s.module();
-
     // Generate the array of constants as llvm constants.
     std::vector<llvm::Constant *> tmp_c_vec;
     for (const auto &val : vc) {
@@ -2212,12 +6427,10 @@ std::function<llvm::Value *(llvm::Value *)> taylor_c_make_arg_gen_vc(llvm_state
     assert(arr_type != nullptr);
 
     // Create the constant array as a global read-only variable.
+    // NOTE: the arrays with the same content are interned.
     auto const_arr = llvm::ConstantArray::get(arr_type, tmp_c_vec);
     assert(const_arr != nullptr);
-    // NOTE: naked new here is fine, gvar will be registered in the module
-    // object and cleaned up when the module is destroyed.
-    auto gvar = new llvm::GlobalVariable(module, const_arr->getType(), true, llvm::GlobalVariable::InternalLinkage,
-                                         const_arr);
+    auto gvar = make_global_const_array(s.module(), const_arr);
 
     // Return the generator.
     return [gvar, &s](llvm::Value *cur_call_idx) -> llvm::Value * {
@@ -2234,19 +6447,17 @@ std::function<llvm::Value *(llvm::Value *)> taylor_c_make_arg_gen_vc(llvm_state
 // The meaning in this example is that the arity of f is 3 and it will be called with 2 different
 // sets of arguments. The g_i functions are expected to be called with input argument j in [0, 1]
 // to yield the value of the i-th function argument for f at the j-th invocation.
+// jl is the layout of the array of derivatives.
 template <typename T>
-auto taylor_build_function_maps(llvm_state &s,
-                                const std::vector<std::vector<std::pair<expression, std::vector<std::uint32_t>>>> &s_dc,
-                                std::uint32_t n_eq, std::uint32_t n_uvars, std::uint32_t batch_size)
+auto taylor_build_function_maps(llvm_state &s, const std::vector<std::pair<expression, std::vector<std::uint32_t>>> &dc,
+                                const std::vector<std::vector<std::uint32_t>> &s_dc, const taylor_c_jet_layout &jl,
+                                std::uint32_t batch_size)
 {
     // Init the return value.
     std::vector<std::unordered_map<llvm::Function *,
                                    std::pair<std::uint32_t, std::vector<std::function<llvm::Value *(llvm::Value *)>>>>>
         retval;
 
-    // Variable to keep track of the u variable
-    // on whose definition we are operating.
-    auto cur_u_idx = n_eq;
     for (const auto &seg : s_dc) {
         // This structure maps an LLVM function to sets of arguments
         // with which the function is to be called. For instance, if function
@@ -2256,102 +6467,379 @@ auto taylor_build_function_maps(llvm_state &s,
         // in the map the sets of arguments have all the same size.
         std::unordered_map<llvm::Function *, std::vector<std::vector<std::variant<std::uint32_t, number>>>> tmp_map;
 
-        for (const auto &ex : seg) {
-            // Get the function for the computation of the derivative.
-            auto func = taylor_c_diff_func<T>(s, ex.first, n_uvars, batch_size);
+        for (const auto cur_u_idx : seg) {
+            const auto &ex = dc[cur_u_idx];
+
+            // Get the function for the computation of the derivative.
+            auto func = taylor_c_diff_func<T>(s, ex.first, jl.order_stride, batch_size);
+
+            // Insert the function into tmp_map.
+            const auto [it, is_new_func] = tmp_map.try_emplace(func);
+
+            assert(is_new_func || !it->second.empty());
+
+            // Convert the variables/constants in the current dc
+            // element into a set of indices/constants.
+            const auto cdiff_args = taylor_udef_to_variants(ex.first, ex.second, jl.u_stride);
+
+            if (!is_new_func && it->second.back().size() - 1u != cdiff_args.size()) {
+                throw std::invalid_argument("Inconsistent arity detected in a Taylor derivative function in compact "
+                                            "mode: the same function is being called with both "
+                                            + std::to_string(it->second.back().size() - 1u) + " and "
+                                            + std::to_string(cdiff_args.size()) + " arguments");
+            }
+
+            // Add the new set of arguments.
+            it->second.emplace_back();
+            // Add the idx of the u variable.
+            it->second.back().emplace_back(cur_u_idx * jl.u_stride);
+            // Add the actual function arguments.
+            it->second.back().insert(it->second.back().end(), cdiff_args.begin(), cdiff_args.end());
+        }
+
+        // Now we build the transposition of tmp_map: from {f : [[a, b, c], [d, e, f]]}
+        // to {f : [[a, d], [b, e], [c, f]]}.
+        std::unordered_map<llvm::Function *, std::vector<std::variant<std::vector<std::uint32_t>, std::vector<number>>>>
+            tmp_map_transpose;
+        for (const auto &[func, vv] : tmp_map) {
+            assert(!vv.empty());
+
+            // Add the function.
+            const auto [it, ins_status] = tmp_map_transpose.try_emplace(func);
+            assert(ins_status);
+
+            const auto n_calls = vv.size();
+            const auto n_args = vv[0].size();
+            // NOTE: n_args must be at least 1 because the u idx
+            // is prepended to the actual function arguments in
+            // the tmp_map entries.
+            assert(n_args >= 1u);
+
+            for (decltype(vv[0].size()) i = 0; i < n_args; ++i) {
+                // Build the vector of values corresponding
+                // to the current argument index.
+                std::vector<std::variant<std::uint32_t, number>> tmp_c_vec;
+                for (decltype(vv.size()) j = 0; j < n_calls; ++j) {
+                    tmp_c_vec.push_back(vv[j][i]);
+                }
+
+                // Turn tmp_c_vec (a vector of variants) into a variant
+                // of vectors, and insert the result.
+                it->second.push_back(taylor_c_vv_transpose(tmp_c_vec));
+            }
+        }
+
+        // Add a new entry in retval for the current segment.
+        retval.emplace_back();
+        auto &a_map = retval.back();
+
+        for (const auto &[func, vv] : tmp_map_transpose) {
+            assert(!vv.empty());
+
+            // Add the function.
+            const auto [it, ins_status] = a_map.try_emplace(func);
+            assert(ins_status);
+
+            // Set the number of calls for this function.
+            it->second.first
+                = std::visit([](const auto &x) { return boost::numeric_cast<std::uint32_t>(x.size()); }, vv[0]);
+            assert(it->second.first > 0u);
+
+            // Create the g functions for each argument.
+            for (const auto &v : vv) {
+                it->second.second.push_back(std::visit(
+                    [&s](const auto &x) {
+                        using type = detail::uncvref_t<decltype(x)>;
+
+                        if constexpr (std::is_same_v<type, std::vector<std::uint32_t>>) {
+                            return taylor_c_make_arg_gen_vidx(s, x);
+                        } else {
+                            return taylor_c_make_arg_gen_vc<T>(s, x);
+                        }
+                    },
+                    v));
+            }
+        }
+    }
+
+    return retval;
+}
+
+// Minimum number of function calls in a segment of the decomposition
+// for the segment to be computed in parallel in parallel compact mode.
+// NOTE: the dispatch of a parallel loop to the thread pool has a cost
+// in the order of microseconds.
+constexpr std::uint32_t taylor_cm_par_min_seg_size = 128;
+
+// Helper to remap in place the params appearing in ex onto a dense range of
+// slots, in order of first appearance. Each distinct pair (index, lane-sharing
+// flag) is assigned a slot. slots maps the pairs to the slot indices, and
+// slot_pars contains, for each slot, the corresponding param.
+void taylor_c_remap_pars(expression &ex, std::map<std::pair<std::uint32_t, bool>, std::uint32_t> &slots,
+                         std::vector<param> &slot_pars)
+{
+    std::visit(
+        [&](auto &v) {
+            using type = uncvref_t<decltype(v)>;
+
+            if constexpr (std::is_same_v<type, param>) {
+                const auto [it, new_slot] = slots.try_emplace(std::pair{v.idx(), v.is_shared()},
+                                                              boost::numeric_cast<std::uint32_t>(slot_pars.size()));
+                if (new_slot) {
+                    slot_pars.push_back(v);
+                }
+
+                v = param{it->second, v.is_shared()};
+            } else if constexpr (std::is_same_v<type, binary_operator>) {
+                taylor_c_remap_pars(v.lhs(), slots, slot_pars);
+                taylor_c_remap_pars(v.rhs(), slots, slot_pars);
+            } else if constexpr (std::is_same_v<type, func>) {
+                for (auto [b, e] = v.get_mutable_args_it(); b != e; ++b) {
+                    taylor_c_remap_pars(*b, slots, slot_pars);
+                }
+            }
+        },
+        ex.value());
+}
+
+// Helper to preload in compact mode, once per step, the params used in the decomposition dc
+// into a global buffer of vectors. The params are remapped in dc onto the slots of the buffer
+// (see taylor_c_remap_pars()), so that the params used by the system are contiguous, and
+// the lane-shared params are broadcast into all the batch elements of their slots.
+// The return value is the pointer to the first element of the buffer (to be used in place
+// of par_ptr), or par_ptr if dc does not contain params.
+// NOTE: like the array of derivatives, the buffer
+// makes the compact-mode code non-reentrant.
+template <typename T>
+llvm::Value *taylor_c_preload_pars(llvm_state &s, std::vector<std::pair<expression, std::vector<std::uint32_t>>> &dc,
+                                   llvm::Value *par_ptr, std::uint32_t batch_size)
+{
+    auto &builder = s.builder();
+    auto &context = s.context();
+
+    std::map<std::pair<std::uint32_t, bool>, std::uint32_t> slots;
+    std::vector<param> slot_pars;
+    for (auto &p : dc) {
+        taylor_c_remap_pars(p.first, slots, slot_pars);
+    }
+
+    if (slot_pars.empty()) {
+        return par_ptr;
+    }
+
+    const auto n_slots = boost::numeric_cast<std::uint32_t>(slot_pars.size());
+
+    // Create the buffer.
+    auto *val_t = to_llvm_vector_type<T>(context, batch_size);
+    auto *buf_t = llvm::ArrayType::get(val_t, n_slots);
+    auto *buf_gl = make_global_zero_array(s.module(), buf_t);
+
+    // Fill in the buffer. The original indices of the params
+    // are fetched from a global array, split according
+    // to the lane-sharing flag.
+    std::vector<llvm::Constant *> idx_pars, idx_spars, slot_idx_pars, slot_idx_spars;
+    for (std::uint32_t i = 0; i < n_slots; ++i) {
+        const auto &p = slot_pars[i];
+
+        (p.is_shared() ? idx_spars : idx_pars).push_back(builder.getInt32(p.idx()));
+        (p.is_shared() ? slot_idx_spars : slot_idx_pars).push_back(builder.getInt32(i));
+    }
+
+    auto make_idx_arr = [&](const std::vector<llvm::Constant *> &v) {
+        auto *arr_t = llvm::ArrayType::get(builder.getInt32Ty(), boost::numeric_cast<std::uint64_t>(v.size()));
+
+        return new llvm::GlobalVariable(s.module(), arr_t, true, llvm::GlobalVariable::InternalLinkage,
+                                        llvm::ConstantArray::get(arr_t, v));
+    };
+
+    for (auto shared : {false, true}) {
+        const auto &idx_v = shared ? idx_spars : idx_pars;
+        if (idx_v.empty()) {
+            continue;
+        }
+
+        auto *g_idx = make_idx_arr(idx_v);
+        auto *g_slot_idx = make_idx_arr(shared ? slot_idx_spars : slot_idx_pars);
+
+        llvm_loop_u32(
+            s, builder.getInt32(0), builder.getInt32(static_cast<std::uint32_t>(idx_v.size())), [&](llvm::Value *i) {
+                auto *p_idx = builder.CreateLoad(builder.CreateInBoundsGEP(g_idx, {builder.getInt32(0), i}));
+                auto *slot_idx = builder.CreateLoad(builder.CreateInBoundsGEP(g_slot_idx, {builder.getInt32(0), i}));
+
+                // NOTE: the overflow check on the indices
+                // is done in taylor_compute_jet().
+                auto *ptr = builder.CreateInBoundsGEP(par_ptr, {builder.CreateMul(p_idx, builder.getInt32(batch_size))});
+                auto *val = shared ? vector_splat(builder, builder.CreateLoad(ptr), batch_size)
+                                   : load_vector_from_memory(builder, ptr, batch_size);
+
+                builder.CreateStore(val, builder.CreateInBoundsGEP(buf_gl, {builder.getInt32(0), slot_idx}));
+            });
+    }
+
+    // Return the buffer as a pointer to the scalar type.
+    return builder.CreateBitCast(builder.CreateInBoundsGEP(buf_gl, {builder.getInt32(0), builder.getInt32(0)}),
+                                 par_ptr->getType());
+}
+
+// The hints for the loops over the calls of a function in compact mode, given
+// the number of calls. The calls are independent from each other, hence, in
+// long enough loops, partial unrolling exposes the instruction-level parallelism
+// among the calls (after inlining), with a bounded code growth. The short loops are
+// left to the default heuristics (which usually unroll them fully). Vectorisation
+// over the calls is disabled, as it would require gathers/scatters on the array
+// of derivatives (and the values are already SIMD vectors in batch mode).
+llvm_loop_hints taylor_c_call_loop_hints(std::uint32_t ncalls)
+{
+    llvm_loop_hints retval;
+
+    retval.unroll_count = ncalls >= 16u ? 4 : 0;
+    retval.vectorize_width = 1;
+
+    return retval;
+}
+
+// Value signalling that a u variable is not known to be a polynomial
+// in time of degree not greater than the order of a Taylor jet.
+constexpr std::uint32_t taylor_no_tdeg = std::numeric_limits<std::uint32_t>::max();
+
+// Upper bounds on the degrees of the u variables of the decomposition dc as polynomials
+// in time. The derivatives of a u variable of order higher than its degree are identically
+// zero, thus they do not need to be computed. The degrees higher than order are replaced by
+// taylor_no_tdeg, since they do not allow to skip the computation of any derivative.
+// NOTE: the degree of a state variable is the degree of its right-hand side plus one,
+// and the right-hand side may in turn depend on the state variables. The degrees are thus
+// determined iteratively, starting from zero: the degrees cannot decrease across the
+// iterations, hence they are guaranteed to settle (possibly on taylor_no_tdeg, which is
+// the case for the state variables depending on themselves via their right-hand sides).
+std::vector<std::uint32_t> taylor_dc_tdegrees(const std::vector<std::pair<expression, std::vector<std::uint32_t>>> &dc,
+                                              std::uint32_t n_eq, std::uint32_t order)
+{
+    assert(dc.size() > n_eq);
+
+    const auto n_uvars = dc.size() - n_eq;
+
+    std::vector<std::uint32_t> degs(n_uvars, 0);
+
+    auto clamp = [order](std::uint64_t d) {
+        return d > order ? taylor_no_tdeg : static_cast<std::uint32_t>(d);
+    };
+
+    // The degree of an argument in the decomposition.
+    auto arg_deg = [&degs](const expression &arg) -> std::uint32_t {
+        if (const auto *vptr = std::get_if<variable>(&arg.value())) {
+            assert(uname_to_index(*vptr) < degs.size());
+
+            return degs[uname_to_index(*vptr)];
+        }
+
+        // Numbers and params.
+        return 0;
+    };
+
+    // The degree of the product of two arguments, and
+    // of an argument raised to the power of k.
+    auto mul_deg = [clamp](std::uint32_t a, std::uint32_t b) {
+        return (a == taylor_no_tdeg || b == taylor_no_tdeg) ? taylor_no_tdeg
+                                                            : clamp(static_cast<std::uint64_t>(a) + b);
+    };
+    auto pow_deg = [clamp](std::uint32_t a, std::uint32_t k) {
+        if (k == 0u) {
+            return std::uint32_t(0);
+        }
 
-            // Insert the function into tmp_map.
-            const auto [it, is_new_func] = tmp_map.try_emplace(func);
+        return a == taylor_no_tdeg ? taylor_no_tdeg : clamp(static_cast<std::uint64_t>(a) * k);
+    };
 
-            assert(is_new_func || !it->second.empty());
+    // The degree of the definition of a u variable
+    // (or of the right-hand side of a state variable).
+    auto def_deg = [&](const expression &ex) -> std::uint32_t {
+        if (const auto *bptr = std::get_if<binary_operator>(&ex.value())) {
+            const auto l = arg_deg(bptr->lhs()), r = arg_deg(bptr->rhs());
+
+            switch (bptr->op()) {
+                case binary_operator::type::add:
+                case binary_operator::type::sub:
+                    return std::max(l, r);
+                case binary_operator::type::mul:
+                    return mul_deg(l, r);
+                default:
+                    // Division: polynomial only if
+                    // the denominator is constant.
+                    return r == 0u ? l : taylor_no_tdeg;
+            }
+        }
 
-            // Convert the variables/constants in the current dc
-            // element into a set of indices/constants.
-            const auto cdiff_args = taylor_udef_to_variants(ex.first, ex.second);
+        if (const auto *fptr = std::get_if<func>(&ex.value())) {
+            const auto &name = fptr->get_name();
+            const auto &args = fptr->args();
 
-            if (!is_new_func && it->second.back().size() - 1u != cdiff_args.size()) {
-                throw std::invalid_argument("Inconsistent arity detected in a Taylor derivative function in compact "
-                                            "mode: the same function is being called with both "
-                                            + std::to_string(it->second.back().size() - 1u) + " and "
-                                            + std::to_string(cdiff_args.size()) + " arguments");
+            std::uint32_t max_deg = 0;
+            for (const auto &arg : args) {
+                max_deg = std::max(max_deg, arg_deg(arg));
             }
 
-            // Add the new set of arguments.
-            it->second.emplace_back();
-            // Add the idx of the u variable.
-            it->second.back().emplace_back(cur_u_idx);
-            // Add the actual function arguments.
-            it->second.back().insert(it->second.back().end(), cdiff_args.begin(), cdiff_args.end());
+            if (name == "time") {
+                return clamp(1);
+            }
 
-            ++cur_u_idx;
-        }
+            if (name == "tpoly") {
+                assert(!args.empty());
 
-        // Now we build the transposition of tmp_map: from {f : [[a, b, c], [d, e, f]]}
-        // to {f : [[a, d], [b, e], [c, f]]}.
-        std::unordered_map<llvm::Function *, std::vector<std::variant<std::vector<std::uint32_t>, std::vector<number>>>>
-            tmp_map_transpose;
-        for (const auto &[func, vv] : tmp_map) {
-            assert(!vv.empty());
+                return clamp(args.size() - 1u);
+            }
 
-            // Add the function.
-            const auto [it, ins_status] = tmp_map_transpose.try_emplace(func);
-            assert(ins_status);
+            // NOTE: the coefficients of a dot
+            // product are numbers or params.
+            if (name == "sum" || name == "dot") {
+                return max_deg;
+            }
 
-            const auto n_calls = vv.size();
-            const auto n_args = vv[0].size();
-            // NOTE: n_args must be at least 1 because the u idx
-            // is prepended to the actual function arguments in
-            // the tmp_map entries.
-            assert(n_args >= 1u);
+            if (name == "square" || name == "sum_sq") {
+                return pow_deg(max_deg, 2);
+            }
 
-            for (decltype(vv[0].size()) i = 0; i < n_args; ++i) {
-                // Build the vector of values corresponding
-                // to the current argument index.
-                std::vector<std::variant<std::uint32_t, number>> tmp_c_vec;
-                for (decltype(vv.size()) j = 0; j < n_calls; ++j) {
-                    tmp_c_vec.push_back(vv[j][i]);
+            if (name == "pow" && args.size() == 2u) {
+                if (const auto *nptr = std::get_if<number>(&args[1].value())) {
+                    // Small non-negative integral exponents.
+                    for (std::uint32_t k = 0; k <= 64u; ++k) {
+                        if (std::visit([k](const auto &v) { return v == k; }, nptr->value())) {
+                            return pow_deg(arg_deg(args[0]), k);
+                        }
+                    }
                 }
-
-                // Turn tmp_c_vec (a vector of variants) into a variant
-                // of vectors, and insert the result.
-                it->second.push_back(taylor_c_vv_transpose(tmp_c_vec));
             }
-        }
 
-        // Add a new entry in retval for the current segment.
-        retval.emplace_back();
-        auto &a_map = retval.back();
+            // The other functions are constant if their arguments are constant,
+            // unless they depend explicitly on time (e.g., the harmonic forcings
+            // and the ephemerides, whose arguments are numbers/params, if any).
+            return max_deg == 0u && !fptr->is_time_dependent() ? 0 : taylor_no_tdeg;
+        }
 
-        for (const auto &[func, vv] : tmp_map_transpose) {
-            assert(!vv.empty());
+        return arg_deg(ex);
+    };
 
-            // Add the function.
-            const auto [it, ins_status] = a_map.try_emplace(func);
-            assert(ins_status);
+    while (true) {
+        for (auto i = static_cast<decltype(dc.size())>(n_eq); i < n_uvars; ++i) {
+            degs[i] = def_deg(dc[i].first);
+        }
 
-            // Set the number of calls for this function.
-            it->second.first
-                = std::visit([](const auto &x) { return boost::numeric_cast<std::uint32_t>(x.size()); }, vv[0]);
-            assert(it->second.first > 0u);
+        bool changed = false;
+        for (std::uint32_t j = 0; j < n_eq; ++j) {
+            const auto rhs_deg = def_deg(dc[n_uvars + j].first);
+            const auto new_deg = rhs_deg == taylor_no_tdeg ? taylor_no_tdeg : clamp(rhs_deg + std::uint64_t(1));
 
-            // Create the g functions for each argument.
-            for (const auto &v : vv) {
-                it->second.second.push_back(std::visit(
-                    [&s](const auto &x) {
-                        using type = detail::uncvref_t<decltype(x)>;
+            assert(new_deg >= degs[j]);
 
-                        if constexpr (std::is_same_v<type, std::vector<std::uint32_t>>) {
-                            return taylor_c_make_arg_gen_vidx(s, x);
-                        } else {
-                            return taylor_c_make_arg_gen_vc<T>(s, x);
-                        }
-                    },
-                    v));
+            if (new_deg != degs[j]) {
+                degs[j] = new_deg;
+                changed = true;
             }
         }
-    }
 
-    return retval;
+        if (!changed) {
+            return degs;
+        }
+    }
 }
 
 // Helper for the computation of a jet of derivatives in compact mode,
@@ -2359,41 +6847,89 @@ auto taylor_build_function_maps(llvm_state &s,
 template <typename T>
 llvm::Value *taylor_compute_jet_compact_mode(llvm_state &s, llvm::Value *order0, llvm::Value *par_ptr,
                                              llvm::Value *time_ptr,
-                                             const std::vector<std::pair<expression, std::vector<std::uint32_t>>> &dc,
+                                             const std::vector<std::pair<expression, std::vector<std::uint32_t>>> &orig_dc,
                                              std::uint32_t n_eq, std::uint32_t n_uvars, std::uint32_t order,
-                                             std::uint32_t batch_size)
+                                             std::uint32_t batch_size, bool has_sv_funcs, bool parallel_mode,
+                                             std::uint32_t unroll_threshold, const taylor_c_jet_layout &jl,
+                                             bool mem_hints)
 {
     auto &builder = s.builder();
+    auto &md = s.module();
+
+    // Preload the params used in the decomposition. From now on, the
+    // params in the decomposition refer to the slots of the buffer.
+    // NOTE: the copy of dc only affects the param arguments, hence the
+    // segments and the function maps are the same as for the original dc.
+    auto pre_dc = orig_dc;
+    par_ptr = taylor_c_preload_pars<T>(s, pre_dc, par_ptr, batch_size);
+    const auto &dc = pre_dc;
 
     // Split dc into segments.
-    const auto s_dc = taylor_segment_dc(dc, n_eq);
+    const auto s_dc = [&]() {
+        time_accumulator ta_seg(s.stats().segment_time);
+
+        return taylor_segment_dc(dc, n_eq);
+    }();
+
+    // The segments with fewer than unroll_threshold u variables are unrolled:
+    // the compact-mode functions are invoked directly with constant arguments,
+    // rather than in loops fetching the arguments from global arrays. These
+    // segments are replaced by empty segments in the function maps.
+    std::vector<std::vector<std::uint32_t>> s_dc_loop;
+    for (const auto &seg : s_dc) {
+        s_dc_loop.push_back(seg.size() < unroll_threshold ? std::vector<std::uint32_t>{} : seg);
+    }
 
     // Generate the function maps.
-    const auto f_maps = taylor_build_function_maps<T>(s, s_dc, n_eq, n_uvars, batch_size);
+    const auto f_maps = taylor_build_function_maps<T>(s, dc, s_dc_loop, jl, batch_size);
+
+    // The maximum degree (as polynomials in time) of the u variables in each segment.
+    // The derivatives of the segments of order higher than their degrees are
+    // zero and they are not computed: their slots in the (zero-initialised)
+    // array of derivatives are never written.
+    std::vector<std::uint32_t> s_dc_tdegs;
+    {
+        const auto tdegs = taylor_dc_tdegrees(dc, n_eq, order);
+
+        for (const auto &seg : s_dc) {
+            std::uint32_t seg_deg = 0;
+            for (const auto u_idx : seg) {
+                seg_deg = std::max(seg_deg, tdegs[u_idx]);
+            }
+
+            s_dc_tdegs.push_back(seg_deg);
+        }
+    }
 
     // Generate the global arrays for the computation of the derivatives
     // of the state variables.
-    const auto sv_diff_gl = taylor_c_make_sv_diff_globals<T>(s, dc, n_uvars);
+    const auto sv_diff_gl = taylor_c_make_sv_diff_globals<T>(s, dc, n_uvars, jl);
 
     // Prepare the array that will contain the jet of derivatives.
     // We will be storing all the derivatives of the u variables
     // up to order 'order - 1', plus the derivatives of order
-    // 'order' of the state variables only.
+    // 'order' of the state variables only. If there are extra
+    // functions of the state variables, the derivatives
+    // of order 'order' of all the u variables will be stored.
+    // In the var_major layout, the derivatives of all the u variables
+    // are stored up to order 'order'.
     // NOTE: the array size is specified as a 64-bit integer in the
     // LLVM API.
     // NOTE: fp_type is the original, scalar floating-point type.
     // It will be turned into a vector type (if necessary) by
     // make_vector_type() below.
     auto fp_type = llvm::cast<llvm::PointerType>(order0->getType())->getElementType();
-    auto array_type = llvm::ArrayType::get(make_vector_type(fp_type, batch_size), n_uvars * order + n_eq);
+    auto array_type
+        = llvm::ArrayType::get(make_vector_type(fp_type, batch_size),
+                               (has_sv_funcs || jl.u_stride != 1u) ? n_uvars * (order + 1u) : n_uvars * order + n_eq);
 
     // Make the global array and fetch a pointer to its first element.
     // NOTE: we use a global array rather than a local one here because
     // its size can grow quite large, which can lead to stack overflow issues.
     // This has of course consequences in terms of thread safety, which
     // we will have to document.
-    auto diff_arr = builder.CreateInBoundsGEP(make_global_zero_array(s.module(), array_type),
-                                              {builder.getInt32(0), builder.getInt32(0)});
+    auto diff_arr_gl = make_global_zero_array(md, array_type);
+    auto diff_arr = builder.CreateInBoundsGEP(array_type, diff_arr_gl, {builder.getInt32(0), builder.getInt32(0)});
 
     // Copy over the order-0 derivatives of the state variables.
     // NOTE: overflow checking is already done in the parent function.
@@ -2405,50 +6941,230 @@ llvm::Value *taylor_compute_jet_compact_mode(llvm_state &s, llvm::Value *order0,
         auto vec = load_vector_from_memory(builder, ptr, batch_size);
 
         // Store into diff_arr.
-        builder.CreateStore(vec, builder.CreateInBoundsGEP(diff_arr, {cur_var_idx}));
+        taylor_c_store_diff(s, diff_arr, jl.order_stride, builder.getInt32(0), taylor_c_scale_u_idx(s, jl, cur_var_idx),
+                            vec);
     });
 
-    // Helper to compute and store the derivatives of order cur_order
-    // of the u variables which are not state variables.
-    auto compute_u_diffs = [&](llvm::Value *cur_order) {
-        for (const auto &map : f_maps) {
+    // The prefetching is useful only in the order-major layout, where the
+    // derivatives of a u variable are order_stride = n_uvars slots apart.
+    const auto prefetch = mem_hints && jl.u_stride == 1u;
+
+    // Helper to emit the computation and the storing of the derivative of
+    // order cur_order for the invocation cur_call_idx of the function in p.
+    auto emit_call = [&](const auto &p, llvm::Value *cur_call_idx, llvm::Value *cur_order, llvm::Value *d_arr,
+                         llvm::Value *p_ptr, llvm::Value *t_ptr) {
+        // The LLVM function for the computation of the
+        // derivative in compact mode.
+        const auto &func = p.first;
+
+        // The generators for the arguments of func.
+        const auto &gens = p.second.second;
+
+        assert(!gens.empty());
+        assert(std::all_of(gens.begin(), gens.end(), [](const auto &f) { return static_cast<bool>(f); }));
+
+        // Create the u variable index from the first generator.
+        auto u_idx = gens[0](cur_call_idx);
+
+        // Initialise the vector of arguments with which func must be called. The following
+        // initial arguments are always present:
+        // - current Taylor order,
+        // - u index of the variable,
+        // - array of derivatives,
+        // - pointer to the param values,
+        // - pointer to the time value(s).
+        std::vector<llvm::Value *> args{cur_order, u_idx, d_arr, p_ptr, t_ptr};
+
+        // Create the other arguments via the generators.
+        for (decltype(gens.size()) i = 1; i < gens.size(); ++i) {
+            args.push_back(gens[i](cur_call_idx));
+        }
+
+        // Calculate the derivative and store the result.
+        taylor_c_store_diff(s, d_arr, jl.order_stride, cur_order, u_idx, builder.CreateCall(func, args));
+
+        if (prefetch) {
+            taylor_c_prefetch_diff(s, d_arr, jl.order_stride, cur_order, u_idx);
+        }
+    };
+
+    // In parallel mode, the segments with enough function calls are computed
+    // by worker functions invoked via heyoka_cm_par_looper() from multiple threads.
+    // The calls of all the functions in a segment are laid out one after the
+    // other in a single index range, and a worker function computes the calls
+    // in a subrange [begin, end). The current order and the pointers to the
+    // params/time values are passed to the workers via global variables.
+    // NOTE: like diff_arr, these global variables make the compact-mode
+    // code non-reentrant.
+    std::vector<std::pair<llvm::Function *, std::uint32_t>> workers(f_maps.size(), {nullptr, 0});
+    llvm::GlobalVariable *order_gl = nullptr;
+
+    if (parallel_mode) {
+        auto &context = s.context();
+
+        auto make_gl = [&md](llvm::Type *t) {
+            return new llvm::GlobalVariable(md, t, false, llvm::GlobalVariable::InternalLinkage,
+                                            llvm::Constant::getNullValue(t));
+        };
+
+        order_gl = make_gl(builder.getInt32Ty());
+        auto par_ptr_gl = make_gl(par_ptr->getType());
+        auto time_ptr_gl = make_gl(time_ptr->getType());
+
+        // NOTE: par_ptr and time_ptr do not change
+        // during the computation of the jet.
+        builder.CreateStore(par_ptr, par_ptr_gl);
+        builder.CreateStore(time_ptr, time_ptr_gl);
+
+        auto *ft = llvm::FunctionType::get(builder.getVoidTy(), {builder.getInt32Ty(), builder.getInt32Ty()}, false);
+        assert(ft != nullptr);
+
+        for (decltype(f_maps.size()) i = 0; i < f_maps.size(); ++i) {
+            const auto &map = f_maps[i];
+
+            // Compute the total number of calls in the segment.
+            std::uint32_t seg_ncalls = 0;
             for (const auto &p : map) {
-                // The LLVM function for the computation of the
-                // derivative in compact mpde.
-                const auto &func = p.first;
+                if (p.second.first > std::numeric_limits<std::uint32_t>::max() - seg_ncalls) {
+                    throw std::overflow_error("An overflow condition was detected in the computation of a jet of "
+                                              "Taylor derivatives in parallel compact mode");
+                }
+                seg_ncalls += p.second.first;
+            }
 
-                // The number of func calls.
-                const auto ncalls = p.second.first;
+            if (seg_ncalls < taylor_cm_par_min_seg_size) {
+                // The segment is too small, it will be computed serially.
+                continue;
+            }
+
+            // Fetch the current insertion block.
+            auto orig_bb = builder.GetInsertBlock();
 
-                // The generators for the arguments of func.
-                const auto &gens = p.second.second;
+            // Create the worker function.
+            auto *f = llvm::Function::Create(ft, llvm::Function::InternalLinkage, "heyoka.cm_par_worker", &md);
+            if (f == nullptr) {
+                throw std::invalid_argument(
+                    "Unable to create a worker function for the computation of a jet of Taylor derivatives");
+            }
+            f->addFnAttr(llvm::Attribute::NoUnwind);
+
+            auto begin = f->args().begin();
+            auto end = f->args().begin() + 1;
+
+            builder.SetInsertPoint(llvm::BasicBlock::Create(context, "entry", f));
+
+            auto cur_order = builder.CreateLoad(builder.getInt32Ty(), order_gl);
+            auto p_ptr = builder.CreateLoad(par_ptr->getType(), par_ptr_gl);
+            auto t_ptr = builder.CreateLoad(time_ptr->getType(), time_ptr_gl);
+            auto d_arr
+                = builder.CreateInBoundsGEP(array_type, diff_arr_gl, {builder.getInt32(0), builder.getInt32(0)});
 
+            std::uint32_t offset = 0;
+            for (const auto &p : map) {
+                const auto ncalls = p.second.first;
                 assert(ncalls > 0u);
-                assert(!gens.empty());
-                assert(std::all_of(gens.begin(), gens.end(), [](const auto &f) { return static_cast<bool>(f); }));
-
-                // Loop over the number of calls.
-                llvm_loop_u32(s, builder.getInt32(0), builder.getInt32(ncalls), [&](llvm::Value *cur_call_idx) {
-                    // Create the u variable index from the first generator.
-                    auto u_idx = gens[0](cur_call_idx);
-
-                    // Initialise the vector of arguments with which func must be called. The following
-                    // initial arguments are always present:
-                    // - current Taylor order,
-                    // - u index of the variable,
-                    // - array of derivatives,
-                    // - pointer to the param values,
-                    // - pointer to the time value(s).
-                    std::vector<llvm::Value *> args{cur_order, u_idx, diff_arr, par_ptr, time_ptr};
-
-                    // Create the other arguments via the generators.
-                    for (decltype(gens.size()) i = 1; i < gens.size(); ++i) {
-                        args.push_back(gens[i](cur_call_idx));
-                    }
 
-                    // Calculate the derivative and store the result.
-                    taylor_c_store_diff(s, diff_arr, n_uvars, cur_order, u_idx, builder.CreateCall(func, args));
-                });
+                // Intersect [begin, end) with the index range
+                // of the calls of the current function.
+                auto f_begin = builder.getInt32(offset), f_end = builder.getInt32(offset + ncalls);
+                auto lo = builder.CreateSelect(builder.CreateICmpUGT(begin, f_begin), begin, f_begin);
+                auto hi = builder.CreateSelect(builder.CreateICmpULT(end, f_end), end, f_end);
+
+                llvm_loop_u32(
+                    s, lo, hi,
+                    [&](llvm::Value *idx) {
+                        emit_call(p, builder.CreateSub(idx, f_begin), cur_order, d_arr, p_ptr, t_ptr);
+                    },
+                    {}, taylor_c_call_loop_hints(ncalls));
+
+                offset += ncalls;
+            }
+
+            builder.CreateRetVoid();
+
+            // Verify the function.
+            s.verify_function(f);
+
+            // Restore the original insertion block.
+            builder.SetInsertPoint(orig_bb);
+
+            workers[i] = {f, seg_ncalls};
+        }
+    }
+
+    // Helper to compute and store the derivatives of order cur_order
+    // of the u variables in the segment i.
+    auto compute_seg_diffs = [&](decltype(f_maps.size()) i, llvm::Value *cur_order) {
+        if (const auto [wf, seg_ncalls] = workers[i]; wf != nullptr) {
+            // Parallel segment.
+            llvm_invoke_external(s, "heyoka_cm_par_looper", builder.getVoidTy(), {builder.getInt32(seg_ncalls), wf},
+                                 {llvm::Attribute::NoUnwind});
+
+            return;
+        }
+
+        if (s_dc_loop[i].empty()) {
+            // Unrolled segment.
+            for (const auto cur_u_idx : s_dc[i]) {
+                const auto &ex = dc[cur_u_idx];
+
+                // Get the function for the computation of the derivative.
+                auto func = taylor_c_diff_func<T>(s, ex.first, jl.order_stride, batch_size);
+
+                // NOTE: see emit_call() for the meaning of the initial arguments.
+                auto u_idx = builder.getInt32(cur_u_idx * jl.u_stride);
+                std::vector<llvm::Value *> args{cur_order, u_idx, diff_arr, par_ptr, time_ptr};
+
+                for (const auto &arg : taylor_udef_to_variants(ex.first, ex.second, jl.u_stride)) {
+                    args.push_back(std::visit(
+                        [&s](const auto &v) -> llvm::Value * {
+                            if constexpr (std::is_same_v<detail::uncvref_t<decltype(v)>, std::uint32_t>) {
+                                return s.builder().getInt32(v);
+                            } else {
+                                return codegen<T>(s, v);
+                            }
+                        },
+                        arg));
+                }
+
+                taylor_c_store_diff(s, diff_arr, jl.order_stride, cur_order, u_idx, builder.CreateCall(func, args));
+
+                if (prefetch) {
+                    taylor_c_prefetch_diff(s, diff_arr, jl.order_stride, cur_order, u_idx);
+                }
+            }
+
+            return;
+        }
+
+        for (const auto &p : f_maps[i]) {
+            assert(p.second.first > 0u);
+
+            // Loop over the number of calls.
+            llvm_loop_u32(
+                s, builder.getInt32(0), builder.getInt32(p.second.first),
+                [&](llvm::Value *cur_call_idx) {
+                    emit_call(p, cur_call_idx, cur_order, diff_arr, par_ptr, time_ptr);
+                },
+                {}, taylor_c_call_loop_hints(p.second.first));
+        }
+    };
+
+    // Helper to compute and store the derivatives of order cur_order
+    // of the u variables which are not state variables.
+    auto compute_u_diffs = [&](llvm::Value *cur_order) {
+        if (order_gl != nullptr) {
+            builder.CreateStore(cur_order, order_gl);
+        }
+
+        for (decltype(f_maps.size()) i = 0; i < f_maps.size(); ++i) {
+            if (s_dc_tdegs[i] != taylor_no_tdeg) {
+                // Skip the derivatives which are known to be zero.
+                llvm_if_then_else(
+                    s, builder.CreateICmpULE(cur_order, builder.getInt32(s_dc_tdegs[i])),
+                    [&]() { compute_seg_diffs(i, cur_order); }, []() {});
+            } else {
+                compute_seg_diffs(i, cur_order);
             }
         }
     };
@@ -2460,14 +7176,20 @@ llvm::Value *taylor_compute_jet_compact_mode(llvm_state &s, llvm::Value *order0,
     // Compute all derivatives up to order 'order - 1'.
     llvm_loop_u32(s, builder.getInt32(1), builder.getInt32(order), [&](llvm::Value *cur_order) {
         // State variables first.
-        taylor_c_compute_sv_diffs<T>(s, sv_diff_gl, diff_arr, par_ptr, n_uvars, cur_order, batch_size);
+        taylor_c_compute_sv_diffs<T>(s, sv_diff_gl, diff_arr, par_ptr, jl, cur_order, batch_size);
 
         // The other u variables.
         compute_u_diffs(cur_order);
     });
 
     // Compute the last-order derivatives for the state variables.
-    taylor_c_compute_sv_diffs<T>(s, sv_diff_gl, diff_arr, par_ptr, n_uvars, builder.getInt32(order), batch_size);
+    taylor_c_compute_sv_diffs<T>(s, sv_diff_gl, diff_arr, par_ptr, jl, builder.getInt32(order), batch_size);
+
+    // If there are extra functions of the state variables,
+    // compute the last-order derivatives of the other u variables too.
+    if (has_sv_funcs) {
+        compute_u_diffs(builder.getInt32(order));
+    }
 
     // Return the array of derivatives of the u variables.
     return diff_arr;
@@ -2494,6 +7216,184 @@ auto taylor_load_values(llvm_state &s, llvm::Value *in, std::uint32_t n, std::ui
     return retval;
 }
 
+// Max width of the SIMD vectors used in the vectorisation
+// across the u variables (see taylor_simd_make_plan()).
+constexpr std::uint32_t taylor_simd_max_width = 4;
+
+// A group of u variables within a segment of the decomposition
+// whose Taylor derivatives are computed together in SIMD fashion.
+struct taylor_simd_group {
+    // The common definition of the u variables of the group,
+    // in terms of the placeholder variables u_0, ..., u_{n_args - 1}.
+    // The placeholder u_{n_args} represents the u variable itself.
+    // NOTE: if the group contains a single u variable, ex is
+    // unused and the derivatives are computed in scalar mode.
+    expression ex;
+    // The indices of the u variables in the group.
+    std::vector<std::uint32_t> u_idx;
+    // For each argument of the definition, the indices of the
+    // corresponding u variables across the group.
+    std::vector<std::vector<std::uint32_t>> args_idx;
+    // The array of derivatives of the placeholder variables,
+    // in the [order][placeholder] layout.
+    std::vector<llvm::Value *> arr;
+};
+
+// Helper to compute the definition in terms of placeholder variables
+// of the u variable with definition ex and hidden dependencies deps (see taylor_simd_group),
+// together with the indices of its arguments. An empty optional is returned if the u variable
+// cannot be part of a SIMD group, that is, if it has hidden dependencies or arguments
+// which are not u variables (e.g., params, whose values are not replicated across the lanes).
+std::optional<std::pair<expression, std::vector<std::uint32_t>>>
+taylor_simd_placeholder(const expression &ex, const std::vector<std::uint32_t> &deps)
+{
+    if (!deps.empty()) {
+        return {};
+    }
+
+    return std::visit(
+        [](const auto &v) -> std::optional<std::pair<expression, std::vector<std::uint32_t>>> {
+            using type = detail::uncvref_t<decltype(v)>;
+
+            if constexpr (std::is_same_v<type, func> || std::is_same_v<type, binary_operator>) {
+                std::vector<std::uint32_t> args_idx;
+                for (const auto &arg : v.args()) {
+                    if (const auto *var_ptr = std::get_if<variable>(&arg.value())) {
+                        args_idx.push_back(uname_to_index(*var_ptr));
+                    } else {
+                        return {};
+                    }
+                }
+
+                // NOTE: exclude the functions without arguments (e.g., time),
+                // whose derivatives may depend on data which is not
+                // replicated across the lanes.
+                if (args_idx.empty()) {
+                    return {};
+                }
+
+                if constexpr (std::is_same_v<type, func>) {
+                    auto tmp = v;
+                    std::uint32_t j = 0;
+                    for (auto [b, e] = tmp.get_mutable_args_it(); b != e; ++b, ++j) {
+                        *b = expression{detail::make_u_var(j)};
+                    }
+
+                    return std::pair{expression{std::move(tmp)}, std::move(args_idx)};
+                } else {
+                    return std::pair{expression{binary_operator{v.op(), expression{variable{"u_0"}},
+                                                                expression{variable{"u_1"}}}},
+                                     std::move(args_idx)};
+                }
+            } else {
+                return {};
+            }
+        },
+        ex.value());
+}
+
+// Group the u variables of each segment of the decomposition dc into SIMD groups. Within a segment,
+// the u variables whose definitions are identical up to the renaming of their arguments
+// (e.g., u_5 = u_1 * u_2 and u_6 = u_3 * u_0) are gathered into groups of at most
+// taylor_simd_max_width elements.
+// NOTE: the u variables within a segment are independent of each other, and thus the
+// parallelism across the u variables of a segment becomes SIMD parallelism.
+std::vector<std::vector<taylor_simd_group>>
+taylor_simd_make_plan(const std::vector<std::pair<expression, std::vector<std::uint32_t>>> &dc, std::uint32_t n_eq)
+{
+    std::vector<std::vector<taylor_simd_group>> retval;
+
+    for (const auto &seg : taylor_segment_dc(dc, n_eq)) {
+        auto &groups = retval.emplace_back();
+
+        // Map from the placeholder definitions to the index
+        // in groups of the group being filled.
+        std::unordered_map<expression, decltype(groups.size())> open_groups;
+
+        for (auto idx : seg) {
+            auto ph = taylor_simd_placeholder(dc[idx].first, dc[idx].second);
+
+            if (!ph) {
+                groups.push_back(taylor_simd_group{expression{}, {idx}, {}, {}});
+                continue;
+            }
+
+            auto &[ph_ex, args_idx] = *ph;
+
+            auto it = open_groups.find(ph_ex);
+            if (it == open_groups.end()) {
+                it = open_groups.emplace(ph_ex, groups.size()).first;
+                groups.push_back(
+                    taylor_simd_group{ph_ex, {}, std::vector<std::vector<std::uint32_t>>(args_idx.size()), {}});
+            }
+
+            auto &g = groups[it->second];
+            g.u_idx.push_back(idx);
+            for (decltype(args_idx.size()) k = 0; k < args_idx.size(); ++k) {
+                g.args_idx[k].push_back(args_idx[k]);
+            }
+
+            if (g.u_idx.size() == taylor_simd_max_width) {
+                // The group is full.
+                open_groups.erase(it);
+            }
+        }
+    }
+
+    return retval;
+}
+
+// Compute the derivatives of order cur_order of the u variables which are not state variables,
+// according to the SIMD plan. The derivatives are written into the slots of diff_arr (which must
+// already be allocated for the order cur_order).
+template <typename T>
+void taylor_simd_compute_u_diffs(llvm_state &s, std::vector<std::vector<taylor_simd_group>> &plan,
+                                 const std::vector<std::pair<expression, std::vector<std::uint32_t>>> &dc,
+                                 std::vector<llvm::Value *> &diff_arr, llvm::Value *par_ptr, llvm::Value *time_ptr,
+                                 std::uint32_t n_uvars, std::uint32_t cur_order)
+{
+    auto &builder = s.builder();
+
+    for (auto &groups : plan) {
+        for (auto &g : groups) {
+            const auto width = boost::numeric_cast<std::uint32_t>(g.u_idx.size());
+
+            if (width == 1u) {
+                const auto idx = g.u_idx[0];
+
+                diff_arr[static_cast<decltype(diff_arr.size())>(cur_order) * n_uvars + idx] = taylor_diff<T>(
+                    s, dc[idx].first, dc[idx].second, diff_arr, par_ptr, time_ptr, n_uvars, cur_order, idx, 1);
+
+                continue;
+            }
+
+            // Gather the derivatives of the arguments at the current order
+            // into the placeholder array.
+            const auto n_args = boost::numeric_cast<std::uint32_t>(g.args_idx.size());
+            for (const auto &a_idx : g.args_idx) {
+                std::vector<llvm::Value *> scalars;
+                for (auto idx : a_idx) {
+                    scalars.push_back(taylor_fetch_diff(diff_arr, idx, cur_order, n_uvars));
+                }
+
+                g.arr.push_back(scalars_to_vector(builder, scalars));
+            }
+            // NOTE: the slot of the u variables of the group at the current
+            // order is filled in below.
+            g.arr.push_back(nullptr);
+
+            auto *res = taylor_diff<T>(s, g.ex, {}, g.arr, par_ptr, time_ptr, n_args + 1u, cur_order, n_args, width);
+            g.arr.back() = res;
+
+            // Scatter the result into diff_arr.
+            const auto res_scalars = vector_to_scalars(builder, res);
+            for (std::uint32_t i = 0; i < width; ++i) {
+                diff_arr[static_cast<decltype(diff_arr.size())>(cur_order) * n_uvars + g.u_idx[i]] = res_scalars[i];
+            }
+        }
+    }
+}
+
 // Helper function to compute the jet of Taylor derivatives up to a given order. n_eq
 // is the number of equations/variables in the ODE sys, dc its Taylor decomposition,
 // n_uvars the total number of u variables in the decomposition.
@@ -2502,24 +7402,45 @@ auto taylor_load_values(llvm_state &s, llvm::Value *in, std::uint32_t n, std::ui
 // containing the derivatives of order 0. par_ptr is a pointer to an array containing
 // the numerical values of the parameters, time_ptr a pointer to the time value(s).
 //
+// sv_funcs_dc contains the indices, in dc, of extra functions of the state variables
+// whose Taylor expansions are to be computed alongside the jet (e.g., event equations).
+//
+// In compact mode, if parallel_mode is true, the large segments of the decomposition
+// are computed in parallel, and the segments with fewer than unroll_threshold u variables
+// are unrolled (see taylor_compute_jet_compact_mode()). jet_layout is the layout of the
+// array of derivatives returned in compact mode.
+//
+// In default mode, if simd_segments is true and batch_size is 1 (in double precision),
+// the derivatives of the u variables within each segment of the decomposition are
+// computed in SIMD fashion across the u variables (see taylor_simd_make_plan()).
+//
+// In compact mode, if mem_hints is true, the slots of the array of derivatives
+// which will be written at the next order are prefetched (see taylor_c_prefetch_diff()).
+//
 // The return value is a variant containing either:
 // - in compact mode, the array containing the derivatives of all u variables,
-// - otherwise, the jet of derivatives of the state variables up to order 'order'.
+// - otherwise, the jet of derivatives of the state variables up to order 'order',
+//   followed by the jet of derivatives of the extra functions up to order 'order'
+//   (in the same [order][function] layout).
 template <typename T>
 std::variant<llvm::Value *, std::vector<llvm::Value *>>
 taylor_compute_jet(llvm_state &s, llvm::Value *order0, llvm::Value *par_ptr, llvm::Value *time_ptr,
-                   const std::vector<std::pair<expression, std::vector<std::uint32_t>>> &dc, std::uint32_t n_eq,
-                   std::uint32_t n_uvars, std::uint32_t order, std::uint32_t batch_size, bool compact_mode)
+                   const std::vector<std::pair<expression, std::vector<std::uint32_t>>> &dc,
+                   const std::vector<std::uint32_t> &sv_funcs_dc, std::uint32_t n_eq, std::uint32_t n_uvars,
+                   std::uint32_t order, std::uint32_t batch_size, bool compact_mode, bool parallel_mode = false,
+                   std::uint32_t unroll_threshold = 0, taylor_jet_layout jet_layout = taylor_jet_layout::order_major,
+                   bool simd_segments = false, bool mem_hints = false)
 {
     assert(batch_size > 0u);
     assert(n_eq > 0u);
     assert(order > 0u);
+    assert(std::all_of(sv_funcs_dc.begin(), sv_funcs_dc.end(), [n_uvars](auto idx) { return idx < n_uvars; }));
 
-    // Make sure we can represent a size of n_uvars * order + n_eq as a 32-bit
-    // unsigned integer. This is the total number of derivatives we will have to compute
-    // and store.
-    if (n_uvars > std::numeric_limits<std::uint32_t>::max() / order
-        || n_uvars * order > std::numeric_limits<std::uint32_t>::max() - n_eq) {
+    // Make sure we can represent a size of n_uvars * (order + 1) as a 32-bit
+    // unsigned integer. This is (an upper bound on) the total number of derivatives
+    // we will have to compute and store.
+    if (order == std::numeric_limits<std::uint32_t>::max()
+        || n_uvars > std::numeric_limits<std::uint32_t>::max() / (order + 1u)) {
         throw std::overflow_error(
             "An overflow condition was detected in the computation of a jet of Taylor derivatives");
     }
@@ -2544,16 +7465,48 @@ taylor_compute_jet(llvm_state &s, llvm::Value *order0, llvm::Value *par_ptr, llv
                 "An overflow condition was detected in the computation of a jet of Taylor derivatives in compact mode");
         }
 
-        return taylor_compute_jet_compact_mode<T>(s, order0, par_ptr, time_ptr, dc, n_eq, n_uvars, order, batch_size);
+        return taylor_compute_jet_compact_mode<T>(s, order0, par_ptr, time_ptr, dc, n_eq, n_uvars, order, batch_size,
+                                                  !sv_funcs_dc.empty(), parallel_mode, unroll_threshold,
+                                                  taylor_c_make_jet_layout(jet_layout, n_uvars, order), mem_hints);
     } else {
+        // The plan for the vectorisation across the u variables, if requested.
+        std::vector<std::vector<taylor_simd_group>> simd_plan;
+        if constexpr (std::is_same_v<T, double>) {
+            if (simd_segments && batch_size == 1u && n_uvars > n_eq) {
+                simd_plan = taylor_simd_make_plan(dc, n_eq);
+            }
+        }
+
+        // The degrees of the u variables as polynomials in time: the
+        // derivatives of order higher than the degrees are zero.
+        const auto tdegs = taylor_dc_tdegrees(dc, n_eq, order);
+
+        auto zero_diff = [&]() { return vector_splat(s.builder(), codegen<T>(s, number{0.}), batch_size); };
+
+        // Helper to compute the derivatives of order cur_order
+        // of the u variables which are not state variables.
+        auto compute_u_diffs = [&](std::vector<llvm::Value *> &diff_arr, std::uint32_t cur_order) {
+            if (simd_plan.empty()) {
+                for (auto i = n_eq; i < n_uvars; ++i) {
+                    if (cur_order > tdegs[i]) {
+                        diff_arr.push_back(zero_diff());
+                    } else {
+                        diff_arr.push_back(taylor_diff<T>(s, dc[i].first, dc[i].second, diff_arr, par_ptr,
+                                                          time_ptr, n_uvars, cur_order, i, batch_size));
+                    }
+                }
+            } else {
+                diff_arr.resize(diff_arr.size() + (n_uvars - n_eq), nullptr);
+
+                taylor_simd_compute_u_diffs<T>(s, simd_plan, dc, diff_arr, par_ptr, time_ptr, n_uvars, cur_order);
+            }
+        };
+
         // Init the derivatives array with the order 0 of the state variables.
         auto diff_arr = taylor_load_values(s, order0, n_eq, batch_size);
 
         // Compute the order-0 derivatives of the other u variables.
-        for (auto i = n_eq; i < n_uvars; ++i) {
-            diff_arr.push_back(
-                taylor_diff<T>(s, dc[i].first, dc[i].second, diff_arr, par_ptr, time_ptr, n_uvars, 0, i, batch_size));
-        }
+        compute_u_diffs(diff_arr, 0);
 
         // Compute the derivatives order by order, starting from 1 to order excluded.
         // We will compute the highest derivatives of the state variables separately
@@ -2563,24 +7516,39 @@ taylor_compute_jet(llvm_state &s, llvm::Value *order0, llvm::Value *par_ptr, llv
             // NOTE: the derivatives of the state variables
             // are at the end of the decomposition vector.
             for (auto i = n_uvars; i < boost::numeric_cast<std::uint32_t>(dc.size()); ++i) {
-                diff_arr.push_back(
-                    taylor_compute_sv_diff<T>(s, dc[i].first, diff_arr, par_ptr, n_uvars, cur_order, batch_size));
+                if (cur_order > tdegs[i - n_uvars]) {
+                    diff_arr.push_back(zero_diff());
+                } else {
+                    diff_arr.push_back(
+                        taylor_compute_sv_diff<T>(s, dc[i].first, diff_arr, par_ptr, n_uvars, cur_order, batch_size));
+                }
             }
 
             // Now the other u variables.
-            for (auto i = n_eq; i < n_uvars; ++i) {
-                diff_arr.push_back(taylor_diff<T>(s, dc[i].first, dc[i].second, diff_arr, par_ptr, time_ptr, n_uvars,
-                                                  cur_order, i, batch_size));
-            }
+            compute_u_diffs(diff_arr, cur_order);
         }
 
         // Compute the last-order derivatives for the state variables.
         for (auto i = n_uvars; i < boost::numeric_cast<std::uint32_t>(dc.size()); ++i) {
-            diff_arr.push_back(
-                taylor_compute_sv_diff<T>(s, dc[i].first, diff_arr, par_ptr, n_uvars, order, batch_size));
+            if (order > tdegs[i - n_uvars]) {
+                diff_arr.push_back(zero_diff());
+            } else {
+                diff_arr.push_back(
+                    taylor_compute_sv_diff<T>(s, dc[i].first, diff_arr, par_ptr, n_uvars, order, batch_size));
+            }
         }
 
-        assert(diff_arr.size() == static_cast<decltype(diff_arr.size())>(n_uvars) * order + n_eq);
+        // If there are extra functions of the state variables,
+        // compute the last-order derivatives of the other u variables too.
+        // NOTE: the optimiser will remove the computations
+        // which are not needed for the extra functions.
+        if (!sv_funcs_dc.empty()) {
+            compute_u_diffs(diff_arr, order);
+
+            assert(diff_arr.size() == static_cast<decltype(diff_arr.size())>(n_uvars) * (order + 1u));
+        } else {
+            assert(diff_arr.size() == static_cast<decltype(diff_arr.size())>(n_uvars) * order + n_eq);
+        }
 
         // Extract the derivatives of the state variables from diff_arr.
         std::vector<llvm::Value *> retval;
@@ -2590,6 +7558,13 @@ taylor_compute_jet(llvm_state &s, llvm::Value *order0, llvm::Value *par_ptr, llv
             }
         }
 
+        // Extract the derivatives of the extra functions.
+        for (std::uint32_t o = 0; o <= order; ++o) {
+            for (auto idx : sv_funcs_dc) {
+                retval.push_back(taylor_fetch_diff(diff_arr, idx, o, n_uvars));
+            }
+        }
+
         return retval;
     }
 }
@@ -2602,31 +7577,17 @@ taylor_compute_jet(llvm_state &s, llvm::Value *order0, llvm::Value *par_ptr, llv
 // compile-time constant). A workaround to avoid issues is to set the optimisation level to zero
 // in the state, add the 2 jets and then run a single optimisation pass.
 // NOTE: document this eventually.
-template <typename T, typename U>
-auto taylor_add_jet_impl(llvm_state &s, const std::string &name, U sys, std::uint32_t order, std::uint32_t batch_size,
-                         bool, bool compact_mode)
+//
+// Add to s the function with the given name and linkage for the computation of the jet
+// of Taylor derivatives of the system of n_eq equations with decomposition dc.
+template <typename T>
+llvm::Function *taylor_add_jet_func(llvm_state &s, const std::string &name,
+                                    const std::vector<std::pair<expression, std::vector<std::uint32_t>>> &dc,
+                                    std::uint32_t n_eq, std::uint32_t order, std::uint32_t batch_size,
+                                    bool compact_mode, llvm::GlobalValue::LinkageTypes linkage)
 {
-    if (s.is_compiled()) {
-        throw std::invalid_argument("A function for the computation of the jet of Taylor derivatives cannot be added "
-                                    "to an llvm_state after compilation");
-    }
-
-    if (order == 0u) {
-        throw std::invalid_argument("The order of a Taylor jet cannot be zero");
-    }
-
-    if (batch_size == 0u) {
-        throw std::invalid_argument("The batch size of a Taylor jet cannot be zero");
-    }
-
     auto &builder = s.builder();
 
-    // Record the number of equations/variables.
-    const auto n_eq = boost::numeric_cast<std::uint32_t>(sys.size());
-
-    // Decompose the system of equations.
-    auto dc = taylor_decompose(std::move(sys));
-
     // Compute the number of u variables.
     assert(dc.size() > n_eq);
     const auto n_uvars = boost::numeric_cast<std::uint32_t>(dc.size() - n_eq);
@@ -2639,7 +7600,7 @@ auto taylor_add_jet_impl(llvm_state &s, const std::string &name, U sys, std::uin
     auto *ft = llvm::FunctionType::get(s.builder().getVoidTy(), fargs, false);
     assert(ft != nullptr);
     // Now create the function.
-    auto *f = llvm::Function::Create(ft, llvm::Function::ExternalLinkage, name, &s.module());
+    auto *f = llvm::Function::Create(ft, linkage, name, &s.module());
     if (f == nullptr) {
         throw std::invalid_argument(
             "Unable to create a function for the computation of the jet of Taylor derivatives with name '" + name
@@ -2671,7 +7632,7 @@ auto taylor_add_jet_impl(llvm_state &s, const std::string &name, U sys, std::uin
 
     // Compute the jet of derivatives.
     auto diff_variant
-        = taylor_compute_jet<T>(s, in_out, par_ptr, time_ptr, dc, n_eq, n_uvars, order, batch_size, compact_mode);
+        = taylor_compute_jet<T>(s, in_out, par_ptr, time_ptr, dc, {}, n_eq, n_uvars, order, batch_size, compact_mode);
 
     // Write the derivatives to in_out.
     // NOTE: overflow checking. We need to be able to index into the jet array (size n_eq * (order + 1) * batch_size)
@@ -2727,6 +7688,539 @@ auto taylor_add_jet_impl(llvm_state &s, const std::string &name, U sys, std::uin
     // Verify it.
     s.verify_function(f);
 
+    return f;
+}
+
+template <typename T, typename U>
+auto taylor_add_jet_impl(llvm_state &s, const std::string &name, U sys, std::uint32_t order, std::uint32_t batch_size,
+                         bool, bool compact_mode)
+{
+    if (s.is_compiled()) {
+        throw std::invalid_argument("A function for the computation of the jet of Taylor derivatives cannot be added "
+                                    "to an llvm_state after compilation");
+    }
+
+    if (order == 0u) {
+        throw std::invalid_argument("The order of a Taylor jet cannot be zero");
+    }
+
+    if (batch_size == 0u) {
+        throw std::invalid_argument("The batch size of a Taylor jet cannot be zero");
+    }
+
+    // Record the number of equations/variables.
+    // NOTE: this also validates a precomputed Taylor decomposition.
+    const auto n_eq = taylor_n_eq(sys);
+
+    // Decompose the system of equations (unless
+    // the decomposition was precomputed).
+    auto dc = [&]() {
+        if constexpr (std::is_same_v<U, taylor_dc_t>) {
+            return std::move(sys);
+        } else {
+            return taylor_decompose_impl(std::move(sys), {}, s.stats()).first;
+        }
+    }();
+
+    // Time the IR generation.
+    std::optional<time_accumulator> ta_ir;
+    ta_ir.emplace(s.stats().ir_gen_time);
+
+    taylor_add_jet_func<T>(s, name, dc, n_eq, order, batch_size, compact_mode, llvm::Function::ExternalLinkage);
+
+    ta_ir.reset();
+
+    // Run the optimisation pass.
+    s.optimise();
+
+    return dc;
+}
+
+// Remove from sys the equations of the state variables which do not feed
+// the outputs, neither directly nor via the equations of other
+// state variables. The order of the retained equations is preserved.
+// NOTE: the validation of sys and outputs is left to the decomposition:
+// if a lhs is not a variable, sys is returned unchanged.
+std::vector<std::pair<expression, expression>> taylor_prune_sys(std::vector<std::pair<expression, expression>> sys,
+                                                                const std::vector<expression> &outputs)
+{
+    // Map the names of the state variables to the indices of their equations.
+    std::unordered_map<std::string, decltype(sys.size())> var_map;
+    for (decltype(sys.size()) i = 0; i < sys.size(); ++i) {
+        const auto *var_ptr = std::get_if<variable>(&sys[i].first.value());
+        if (var_ptr == nullptr) {
+            return sys;
+        }
+
+        var_map.emplace(var_ptr->name(), i);
+    }
+
+    // Flag the equations needed by the outputs, via a worklist
+    // seeded with the variables appearing in the outputs.
+    std::vector<char> needed(sys.size(), 0);
+    std::vector<std::string> wl;
+    for (const auto &ex : outputs) {
+        auto vars = get_variables(ex);
+        wl.insert(wl.end(), vars.begin(), vars.end());
+    }
+
+    while (!wl.empty()) {
+        const auto name = std::move(wl.back());
+        wl.pop_back();
+
+        const auto it = var_map.find(name);
+        if (it == var_map.end() || needed[it->second]) {
+            continue;
+        }
+
+        needed[it->second] = 1;
+
+        auto vars = get_variables(sys[it->second].second);
+        wl.insert(wl.end(), vars.begin(), vars.end());
+    }
+
+    std::vector<std::pair<expression, expression>> retval;
+    for (decltype(sys.size()) i = 0; i < sys.size(); ++i) {
+        if (needed[i]) {
+            retval.push_back(std::move(sys[i]));
+        }
+    }
+
+    return retval;
+}
+
+template <typename T>
+auto taylor_add_jet_outputs_impl(llvm_state &s, const std::string &name,
+                                 std::vector<std::pair<expression, expression>> sys, std::vector<expression> outputs,
+                                 std::uint32_t order, std::uint32_t batch_size, bool, bool compact_mode)
+{
+    if (s.is_compiled()) {
+        throw std::invalid_argument("A function for the computation of the jet of Taylor derivatives cannot be added "
+                                    "to an llvm_state after compilation");
+    }
+
+    if (order == 0u) {
+        throw std::invalid_argument("The order of a Taylor jet cannot be zero");
+    }
+
+    if (batch_size == 0u) {
+        throw std::invalid_argument("The batch size of a Taylor jet cannot be zero");
+    }
+
+    if (outputs.empty()) {
+        throw std::invalid_argument("At least one output is needed in order to add a Taylor jet of outputs");
+    }
+
+    sys = taylor_prune_sys(std::move(sys), outputs);
+    if (sys.empty()) {
+        throw std::invalid_argument("The outputs of a Taylor jet must depend on at least one state variable");
+    }
+
+    const auto n_eq = taylor_n_eq(sys);
+    const auto n_out = boost::numeric_cast<std::uint32_t>(outputs.size());
+
+    auto [dc, sv_funcs_dc] = taylor_decompose_impl(std::move(sys), std::move(outputs), s.stats());
+    assert(sv_funcs_dc.size() == n_out);
+
+    const auto n_uvars = boost::numeric_cast<std::uint32_t>(dc.size() - n_eq);
+
+    // NOTE: overflow checking. We need to be able to index into the output
+    // array (size n_out * (order + 1) * batch_size) using uint32_t.
+    if (order == std::numeric_limits<std::uint32_t>::max()
+        || (order + 1u) > std::numeric_limits<std::uint32_t>::max() / batch_size
+        || n_out > std::numeric_limits<std::uint32_t>::max() / ((order + 1u) * batch_size)) {
+        throw std::overflow_error("An overflow condition was detected while adding a Taylor jet");
+    }
+
+    // Time the IR generation.
+    std::optional<time_accumulator> ta_ir;
+    ta_ir.emplace(s.stats().ir_gen_time);
+
+    auto &builder = s.builder();
+
+    // Prepare the function prototype (same as in taylor_add_jet_func()).
+    std::vector<llvm::Type *> fargs(3, llvm::PointerType::getUnqual(to_llvm_type<T>(s.context())));
+    auto *ft = llvm::FunctionType::get(builder.getVoidTy(), fargs, false);
+    assert(ft != nullptr);
+    auto *f = llvm::Function::Create(ft, llvm::Function::ExternalLinkage, name, &s.module());
+    if (f == nullptr) {
+        throw std::invalid_argument(
+            "Unable to create a function for the computation of the jet of Taylor derivatives with name '" + name
+            + "'");
+    }
+
+    auto in_out = f->args().begin();
+    in_out->setName("in_out");
+    in_out->addAttr(llvm::Attribute::NoCapture);
+    in_out->addAttr(llvm::Attribute::NoAlias);
+
+    auto par_ptr = in_out + 1;
+    par_ptr->setName("par_ptr");
+    par_ptr->addAttr(llvm::Attribute::NoCapture);
+    par_ptr->addAttr(llvm::Attribute::NoAlias);
+    par_ptr->addAttr(llvm::Attribute::ReadOnly);
+
+    auto time_ptr = par_ptr + 1;
+    time_ptr->setName("time_ptr");
+    time_ptr->addAttr(llvm::Attribute::NoCapture);
+    time_ptr->addAttr(llvm::Attribute::NoAlias);
+    time_ptr->addAttr(llvm::Attribute::ReadOnly);
+
+    auto *bb = llvm::BasicBlock::Create(s.context(), "entry", f);
+    assert(bb != nullptr);
+    builder.SetInsertPoint(bb);
+
+    // Compute the jet of derivatives.
+    // NOTE: the order-0 values of the state variables are read
+    // in full before the derivatives are written to in_out.
+    auto diff_variant = taylor_compute_jet<T>(s, in_out, par_ptr, time_ptr, dc, sv_funcs_dc, n_eq, n_uvars, order,
+                                              batch_size, compact_mode);
+
+    // Write the derivatives of the outputs to in_out.
+    if (compact_mode) {
+        auto diff_arr = std::get<llvm::Value *>(diff_variant);
+
+        // NOTE: the indices of the outputs in the decomposition are known
+        // at compile time, thus we can unroll the loop over the outputs.
+        for (std::uint32_t j = 0; j < n_out; ++j) {
+            llvm_loop_u32(s, builder.getInt32(0), builder.CreateAdd(builder.getInt32(order), builder.getInt32(1)),
+                          [&](llvm::Value *cur_order) {
+                              auto diff_val = taylor_c_load_diff(s, diff_arr, n_uvars, cur_order,
+                                                                 builder.getInt32(sv_funcs_dc[j]));
+
+                              auto out_idx = builder.CreateAdd(
+                                  builder.CreateMul(builder.getInt32(n_out * batch_size), cur_order),
+                                  builder.getInt32(j * batch_size));
+
+                              store_vector_to_memory(builder, builder.CreateInBoundsGEP(in_out, {out_idx}), diff_val);
+                          });
+        }
+    } else {
+        const auto &diff_arr = std::get<std::vector<llvm::Value *>>(diff_variant);
+
+        // NOTE: in non-compact mode, the derivatives of the outputs are stored
+        // in diff_arr after the derivatives of the state variables.
+        for (std::uint32_t cur_order = 0; cur_order <= order; ++cur_order) {
+            for (std::uint32_t j = 0; j < n_out; ++j) {
+                const auto arr_idx = (order + 1u) * n_eq + cur_order * n_out + j;
+                assert(arr_idx < diff_arr.size());
+
+                const auto out_idx = n_out * batch_size * cur_order + j * batch_size;
+                store_vector_to_memory(builder, builder.CreateInBoundsGEP(in_out, {builder.getInt32(out_idx)}),
+                                       diff_arr[arr_idx]);
+            }
+        }
+    }
+
+    builder.CreateRetVoid();
+
+    s.verify_function(f);
+
+    ta_ir.reset();
+
+    // Run the optimisation pass.
+    s.optimise();
+
+    return std::pair{std::move(dc), std::move(sv_funcs_dc)};
+}
+
+// Distance, in number of batches, of the prefetching
+// of the input values in the functions added by taylor_add_jet_multi().
+constexpr std::uint32_t taylor_jet_multi_prefetch_dist = 8;
+
+// Add to s the driver function with the given name for the computation of the jets of
+// Taylor derivatives at multiple points (see taylor_add_jet_multi()). jet_f is the function
+// computing the jet at batch_size points, scalar_jet_f the function computing the jet at a single
+// point (null if batch_size is 1). n_pars is the number of parameters of the system.
+template <typename T>
+void taylor_add_jet_multi_driver(llvm_state &s, const std::string &name, llvm::Function *jet_f,
+                                 llvm::Function *scalar_jet_f, std::uint32_t n_eq, std::uint32_t order,
+                                 std::uint32_t n_pars, std::uint32_t batch_size, bool parallel_mode)
+{
+    assert(jet_f != nullptr);
+    assert((scalar_jet_f == nullptr) == (batch_size == 1u));
+
+    auto &builder = s.builder();
+    auto &context = s.context();
+    auto &md = s.module();
+
+    auto *fp_t = to_llvm_type<T>(context);
+    auto *fp_ptr_t = llvm::PointerType::getUnqual(fp_t);
+
+    // NOTE: the overflow checks for the size of the jet
+    // have been performed when adding jet_f.
+    const auto n_rows = n_eq * (order + 1u);
+    if (n_pars > std::numeric_limits<std::uint32_t>::max() / batch_size) {
+        throw std::overflow_error("An overflow condition was detected while adding a Taylor jet for multiple points");
+    }
+
+    // Prepare the function prototype. The arguments are the pointers to the output array,
+    // to the input array, to the pars and to the times, the number of points and the stride.
+    // The arrays cannot overlap.
+    std::vector<llvm::Type *> fargs(4, fp_ptr_t);
+    fargs.push_back(builder.getInt32Ty());
+    fargs.push_back(builder.getInt64Ty());
+    // The function does not return anything.
+    auto *ft = llvm::FunctionType::get(builder.getVoidTy(), fargs, false);
+    assert(ft != nullptr);
+    // Now create the function.
+    auto *f = llvm::Function::Create(ft, llvm::Function::ExternalLinkage, name, &md);
+    if (f == nullptr) {
+        throw std::invalid_argument(
+            "Unable to create a function for the computation of the jets of Taylor derivatives with name '" + name
+            + "'");
+    }
+
+    // Set the names/attributes of the function arguments.
+    auto out_ptr = f->args().begin();
+    out_ptr->setName("out_ptr");
+    out_ptr->addAttr(llvm::Attribute::NoCapture);
+    out_ptr->addAttr(llvm::Attribute::NoAlias);
+    out_ptr->addAttr(llvm::Attribute::WriteOnly);
+
+    auto in_ptr = out_ptr + 1;
+    in_ptr->setName("in_ptr");
+    in_ptr->addAttr(llvm::Attribute::NoCapture);
+    in_ptr->addAttr(llvm::Attribute::NoAlias);
+    in_ptr->addAttr(llvm::Attribute::ReadOnly);
+
+    auto par_ptr = in_ptr + 1;
+    par_ptr->setName("par_ptr");
+    par_ptr->addAttr(llvm::Attribute::NoCapture);
+    par_ptr->addAttr(llvm::Attribute::NoAlias);
+    par_ptr->addAttr(llvm::Attribute::ReadOnly);
+
+    auto time_ptr = par_ptr + 1;
+    time_ptr->setName("time_ptr");
+    time_ptr->addAttr(llvm::Attribute::NoCapture);
+    time_ptr->addAttr(llvm::Attribute::NoAlias);
+    time_ptr->addAttr(llvm::Attribute::ReadOnly);
+
+    auto n_points = time_ptr + 1;
+    n_points->setName("n_points");
+
+    auto stride = n_points + 1;
+    stride->setName("stride");
+
+    builder.SetInsertPoint(llvm::BasicBlock::Create(context, "entry", f));
+
+    // The pointers to the output array, to the input array, to the pars
+    // and to the times, followed by the stride.
+    using ptrs_t = std::array<llvm::Value *, 5>;
+    // The local buffers for the jet and for the pars.
+    using bufs_t = std::pair<llvm::Value *, llvm::Value *>;
+
+    // Helper to create in the current (entry) block the local buffers
+    // for the jet and for the parameters passed to jet_f/scalar_jet_f.
+    auto make_bufs = [&]() {
+        auto *jet_arr_t = llvm::ArrayType::get(fp_t, n_rows * batch_size);
+        auto *jet_buf = builder.CreateInBoundsGEP(jet_arr_t, builder.CreateAlloca(jet_arr_t),
+                                                  {builder.getInt32(0), builder.getInt32(0)});
+
+        llvm::Value *par_buf = nullptr;
+        if (n_pars > 0u) {
+            auto *par_arr_t = llvm::ArrayType::get(fp_t, n_pars * batch_size);
+            par_buf = builder.CreateInBoundsGEP(par_arr_t, builder.CreateAlloca(par_arr_t),
+                                                {builder.getInt32(0), builder.getInt32(0)});
+        }
+
+        return bufs_t{jet_buf, par_buf};
+    };
+
+    // Helper to compute the jets at the bs points starting from the point
+    // with index p (a 64-bit integer) via jf.
+    // NOTE: the values are gathered from/scattered to the SoA arrays via the
+    // local buffers, in which the values are laid out as expected by jf. The copies
+    // happen in registers/L1, and they replace the copying into the interleaved
+    // jet layout which would otherwise be needed on the caller's side.
+    auto emit_points = [&](const ptrs_t &ptrs, const bufs_t &bufs, llvm::Value *p, llvm::Function *jf,
+                           std::uint32_t bs) {
+        auto *o_ptr = ptrs[0], *i_ptr = ptrs[1], *p_ptr = ptrs[2], *t_ptr = ptrs[3], *str = ptrs[4];
+        auto *jet_buf = bufs.first, *par_buf = bufs.second;
+
+        // Pointer to the value of the point p in the row with index row (a 32-bit integer).
+        auto row_ptr = [&](llvm::Value *base, llvm::Value *row) {
+            auto *row_offset = builder.CreateMul(builder.CreateZExt(row, builder.getInt64Ty()), str);
+
+            return builder.CreateInBoundsGEP(fp_t, base, {builder.CreateAdd(row_offset, p)});
+        };
+
+        // Helper to copy n rows from the SoA array base into the buffer buf.
+        auto gather = [&](llvm::Value *base, llvm::Value *buf, std::uint32_t n) {
+            llvm_loop_u32(s, builder.getInt32(0), builder.getInt32(n), [&](llvm::Value *row) {
+                auto *src = row_ptr(base, row);
+
+                auto *dst = builder.CreateInBoundsGEP(fp_t, buf, {builder.CreateMul(row, builder.getInt32(bs))});
+                store_vector_to_memory(builder, dst, load_vector_from_memory(builder, src, bs));
+
+                if (bs > 1u) {
+                    // Prefetch the values of the subsequent points.
+                    // NOTE: the prefetching past the end of the
+                    // array is harmless, hence the non-inbounds GEP.
+                    auto *pf_ptr = builder.CreateGEP(fp_t, src, {builder.getInt64(static_cast<std::uint64_t>(bs)
+                                                                                 * taylor_jet_multi_prefetch_dist)});
+                    llvm_invoke_intrinsic(s, "llvm.prefetch", {pf_ptr->getType()},
+                                          {pf_ptr, builder.getInt32(0), builder.getInt32(3), builder.getInt32(1)});
+                }
+            });
+        };
+
+        // Copy the state variables and the parameters into the local buffers.
+        gather(i_ptr, jet_buf, n_eq);
+
+        llvm::Value *jet_par_ptr = p_ptr;
+        if (n_pars > 0u) {
+            gather(p_ptr, par_buf, n_pars);
+            jet_par_ptr = par_buf;
+        }
+
+        // Compute the jet.
+        // NOTE: the time pointer is dereferenced only if
+        // the system is non-autonomous, hence the non-inbounds GEP.
+        builder.CreateCall(jf, {jet_buf, jet_par_ptr, builder.CreateGEP(fp_t, t_ptr, {p})});
+
+        // Copy the jet into the output array.
+        llvm_loop_u32(s, builder.getInt32(0), builder.getInt32(n_rows), [&](llvm::Value *row) {
+            auto *src = builder.CreateInBoundsGEP(fp_t, jet_buf, {builder.CreateMul(row, builder.getInt32(bs))});
+            store_vector_to_memory(builder, row_ptr(o_ptr, row), load_vector_from_memory(builder, src, bs));
+        });
+    };
+
+    auto *bs_v = builder.getInt32(batch_size);
+    auto *n_batches = builder.CreateUDiv(n_points, bs_v);
+
+    // Helper to compute the jets for the batches in the range [begin, end).
+    auto emit_batches = [&](const ptrs_t &ptrs, const bufs_t &bufs, llvm::Value *begin, llvm::Value *end) {
+        llvm_loop_u32(s, begin, end, [&](llvm::Value *idx) {
+            emit_points(ptrs, bufs, builder.CreateZExt(builder.CreateMul(idx, bs_v), builder.getInt64Ty()), jet_f,
+                        batch_size);
+        });
+    };
+
+    const ptrs_t ptrs{out_ptr, in_ptr, par_ptr, time_ptr, stride};
+    const auto bufs = make_bufs();
+
+    if (parallel_mode) {
+        // The batches are computed by a worker function invoked
+        // via heyoka_cm_par_looper() from multiple threads. The pointers
+        // and the stride are passed to the worker via global variables.
+        // NOTE: the global variables make the driver non-reentrant.
+        auto make_gl = [&md](llvm::Type *t) {
+            return new llvm::GlobalVariable(md, t, false, llvm::GlobalVariable::InternalLinkage,
+                                            llvm::Constant::getNullValue(t));
+        };
+
+        std::array<llvm::GlobalVariable *, 5> gls{};
+        for (std::size_t i = 0; i < gls.size(); ++i) {
+            gls[i] = make_gl(ptrs[i]->getType());
+            builder.CreateStore(ptrs[i], gls[i]);
+        }
+
+        // Fetch the current insertion block.
+        auto *orig_bb = builder.GetInsertBlock();
+
+        // Create the worker function.
+        auto *wft = llvm::FunctionType::get(builder.getVoidTy(), {builder.getInt32Ty(), builder.getInt32Ty()}, false);
+        assert(wft != nullptr);
+        auto *wf = llvm::Function::Create(wft, llvm::Function::InternalLinkage, "heyoka.jet_multi_worker", &md);
+        if (wf == nullptr) {
+            throw std::invalid_argument(
+                "Unable to create a worker function for the computation of the jets of Taylor derivatives");
+        }
+        wf->addFnAttr(llvm::Attribute::NoUnwind);
+
+        builder.SetInsertPoint(llvm::BasicBlock::Create(context, "entry", wf));
+
+        ptrs_t w_ptrs{};
+        for (std::size_t i = 0; i < gls.size(); ++i) {
+            w_ptrs[i] = builder.CreateLoad(ptrs[i]->getType(), gls[i]);
+        }
+
+        emit_batches(w_ptrs, make_bufs(), wf->args().begin(), wf->args().begin() + 1);
+
+        builder.CreateRetVoid();
+
+        s.verify_function(wf);
+
+        // Restore the original insertion block and invoke the worker.
+        builder.SetInsertPoint(orig_bb);
+
+        llvm_invoke_external(s, "heyoka_cm_par_looper", builder.getVoidTy(), {n_batches, wf},
+                             {llvm::Attribute::NoUnwind});
+    } else {
+        emit_batches(ptrs, bufs, builder.getInt32(0), n_batches);
+    }
+
+    // Compute the jets at the remaining points (if any) in scalar mode.
+    if (scalar_jet_f != nullptr) {
+        llvm_loop_u32(s, builder.CreateMul(n_batches, bs_v), n_points, [&](llvm::Value *idx) {
+            emit_points(ptrs, bufs, builder.CreateZExt(idx, builder.getInt64Ty()), scalar_jet_f, 1);
+        });
+    }
+
+    // Finish off the function.
+    builder.CreateRetVoid();
+
+    // Verify it.
+    s.verify_function(f);
+}
+
+template <typename T, typename U>
+auto taylor_add_jet_multi_impl(llvm_state &s, const std::string &name, U sys, std::uint32_t order,
+                               std::uint32_t batch_size, bool, bool compact_mode, bool parallel_mode)
+{
+    if (s.is_compiled()) {
+        throw std::invalid_argument("A function for the computation of the jets of Taylor derivatives cannot be "
+                                    "added to an llvm_state after compilation");
+    }
+
+    if (order == 0u) {
+        throw std::invalid_argument("The order of a Taylor jet cannot be zero");
+    }
+
+    if (batch_size == 0u) {
+        throw std::invalid_argument("The batch size of a Taylor jet cannot be zero");
+    }
+
+    // NOTE: in compact mode, the jet of derivatives is stored in a global
+    // array (see taylor_compute_jet_compact_mode()), which cannot be shared
+    // among multiple threads.
+    if (compact_mode && parallel_mode) {
+        throw std::invalid_argument("The parallel mode is not supported in compact mode for the computation of the "
+                                    "jets of Taylor derivatives at multiple points");
+    }
+
+    // Record the number of equations/variables.
+    const auto n_eq = boost::numeric_cast<std::uint32_t>(sys.size());
+
+    // Decompose the system of equations.
+    auto dc = taylor_decompose_impl(std::move(sys), {}, s.stats()).first;
+
+    // Time the IR generation.
+    std::optional<time_accumulator> ta_ir;
+    ta_ir.emplace(s.stats().ir_gen_time);
+
+    // Deduce the number of parameters from the decomposition.
+    std::uint32_t n_pars = 0;
+    for (const auto &ex : dc) {
+        n_pars = std::max(n_pars, get_param_size(ex.first));
+    }
+
+    // Add the jet functions in batch and scalar mode.
+    // NOTE: the optimisation pass is run only after all the functions have been
+    // added (see the comments on compact mode above taylor_add_jet_func()).
+    auto *jet_f = taylor_add_jet_func<T>(s, name + ".jet", dc, n_eq, order, batch_size, compact_mode,
+                                         llvm::Function::InternalLinkage);
+    llvm::Function *scalar_jet_f = nullptr;
+    if (batch_size > 1u) {
+        scalar_jet_f = taylor_add_jet_func<T>(s, name + ".jet_scalar", dc, n_eq, order, 1, compact_mode,
+                                              llvm::Function::InternalLinkage);
+    }
+
+    taylor_add_jet_multi_driver<T>(s, name, jet_f, scalar_jet_f, n_eq, order, n_pars, batch_size, parallel_mode);
+
+    ta_ir.reset();
+
     // Run the optimisation pass.
     s.optimise();
 
@@ -2791,6 +8285,120 @@ taylor_add_jet_f128(llvm_state &s, const std::string &name, std::vector<std::pai
 
 #endif
 
+taylor_dc_t taylor_add_jet_dbl(llvm_state &s, const std::string &name, taylor_dc_t dc, std::uint32_t order,
+                               std::uint32_t batch_size, bool high_accuracy, bool compact_mode)
+{
+    return detail::taylor_add_jet_impl<double>(s, name, std::move(dc), order, batch_size, high_accuracy, compact_mode);
+}
+
+taylor_dc_t taylor_add_jet_ldbl(llvm_state &s, const std::string &name, taylor_dc_t dc, std::uint32_t order,
+                                std::uint32_t batch_size, bool high_accuracy, bool compact_mode)
+{
+    return detail::taylor_add_jet_impl<long double>(s, name, std::move(dc), order, batch_size, high_accuracy,
+                                                    compact_mode);
+}
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+taylor_dc_t taylor_add_jet_f128(llvm_state &s, const std::string &name, taylor_dc_t dc, std::uint32_t order,
+                                std::uint32_t batch_size, bool high_accuracy, bool compact_mode)
+{
+    return detail::taylor_add_jet_impl<mppp::real128>(s, name, std::move(dc), order, batch_size, high_accuracy,
+                                                      compact_mode);
+}
+
+#endif
+
+std::pair<taylor_dc_t, std::vector<std::uint32_t>>
+taylor_add_jet_outputs_dbl(llvm_state &s, const std::string &name, std::vector<std::pair<expression, expression>> sys,
+                           std::vector<expression> outputs, std::uint32_t order, std::uint32_t batch_size,
+                           bool high_accuracy, bool compact_mode)
+{
+    return detail::taylor_add_jet_outputs_impl<double>(s, name, std::move(sys), std::move(outputs), order, batch_size,
+                                                       high_accuracy, compact_mode);
+}
+
+std::pair<taylor_dc_t, std::vector<std::uint32_t>>
+taylor_add_jet_outputs_ldbl(llvm_state &s, const std::string &name, std::vector<std::pair<expression, expression>> sys,
+                            std::vector<expression> outputs, std::uint32_t order, std::uint32_t batch_size,
+                            bool high_accuracy, bool compact_mode)
+{
+    return detail::taylor_add_jet_outputs_impl<long double>(s, name, std::move(sys), std::move(outputs), order,
+                                                            batch_size, high_accuracy, compact_mode);
+}
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+std::pair<taylor_dc_t, std::vector<std::uint32_t>>
+taylor_add_jet_outputs_f128(llvm_state &s, const std::string &name, std::vector<std::pair<expression, expression>> sys,
+                            std::vector<expression> outputs, std::uint32_t order, std::uint32_t batch_size,
+                            bool high_accuracy, bool compact_mode)
+{
+    return detail::taylor_add_jet_outputs_impl<mppp::real128>(s, name, std::move(sys), std::move(outputs), order,
+                                                              batch_size, high_accuracy, compact_mode);
+}
+
+#endif
+
+std::vector<std::pair<expression, std::vector<std::uint32_t>>>
+taylor_add_jet_multi_dbl(llvm_state &s, const std::string &name, std::vector<expression> sys, std::uint32_t order,
+                         std::uint32_t batch_size, bool high_accuracy, bool compact_mode, bool parallel_mode)
+{
+    return detail::taylor_add_jet_multi_impl<double>(s, name, std::move(sys), order, batch_size, high_accuracy,
+                                                     compact_mode, parallel_mode);
+}
+
+std::vector<std::pair<expression, std::vector<std::uint32_t>>>
+taylor_add_jet_multi_ldbl(llvm_state &s, const std::string &name, std::vector<expression> sys, std::uint32_t order,
+                          std::uint32_t batch_size, bool high_accuracy, bool compact_mode, bool parallel_mode)
+{
+    return detail::taylor_add_jet_multi_impl<long double>(s, name, std::move(sys), order, batch_size, high_accuracy,
+                                                          compact_mode, parallel_mode);
+}
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+std::vector<std::pair<expression, std::vector<std::uint32_t>>>
+taylor_add_jet_multi_f128(llvm_state &s, const std::string &name, std::vector<expression> sys, std::uint32_t order,
+                          std::uint32_t batch_size, bool high_accuracy, bool compact_mode, bool parallel_mode)
+{
+    return detail::taylor_add_jet_multi_impl<mppp::real128>(s, name, std::move(sys), order, batch_size,
+                                                            high_accuracy, compact_mode, parallel_mode);
+}
+
+#endif
+
+std::vector<std::pair<expression, std::vector<std::uint32_t>>>
+taylor_add_jet_multi_dbl(llvm_state &s, const std::string &name, std::vector<std::pair<expression, expression>> sys,
+                         std::uint32_t order, std::uint32_t batch_size, bool high_accuracy, bool compact_mode,
+                         bool parallel_mode)
+{
+    return detail::taylor_add_jet_multi_impl<double>(s, name, std::move(sys), order, batch_size, high_accuracy,
+                                                     compact_mode, parallel_mode);
+}
+
+std::vector<std::pair<expression, std::vector<std::uint32_t>>>
+taylor_add_jet_multi_ldbl(llvm_state &s, const std::string &name, std::vector<std::pair<expression, expression>> sys,
+                          std::uint32_t order, std::uint32_t batch_size, bool high_accuracy, bool compact_mode,
+                          bool parallel_mode)
+{
+    return detail::taylor_add_jet_multi_impl<long double>(s, name, std::move(sys), order, batch_size, high_accuracy,
+                                                          compact_mode, parallel_mode);
+}
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+std::vector<std::pair<expression, std::vector<std::uint32_t>>>
+taylor_add_jet_multi_f128(llvm_state &s, const std::string &name, std::vector<std::pair<expression, expression>> sys,
+                          std::uint32_t order, std::uint32_t batch_size, bool high_accuracy, bool compact_mode,
+                          bool parallel_mode)
+{
+    return detail::taylor_add_jet_multi_impl<mppp::real128>(s, name, std::move(sys), order, batch_size,
+                                                            high_accuracy, compact_mode, parallel_mode);
+}
+
+#endif
+
 namespace detail
 {
 
@@ -2917,11 +8525,14 @@ llvm::Value *taylor_step_min(llvm_state &s, llvm::Value *x_v, llvm::Value *y_v)
 #endif
 }
 
-// Helper to compute pow(x_v, y_v) in the Taylor stepper implementation.
-llvm::Value *taylor_step_pow(llvm_state &s, llvm::Value *x_v, llvm::Value *y_v)
+// Helper to compute the elementary function name ("exp" or "log") of x_v
+// in the Taylor stepper implementation.
+llvm::Value *taylor_step_elem_func(llvm_state &s, const std::string &name, llvm::Value *x_v)
 {
+    assert(name == "exp" || name == "log");
+
 #if defined(HEYOKA_HAVE_REAL128)
-    // Determine the scalar type of the vector arguments.
+    // Determine the scalar type of the vector argument.
     auto x_t = x_v->getType()->getScalarType();
 
     if (x_t == llvm::Type::getFP128Ty(s.context())) {
@@ -2929,15 +8540,15 @@ llvm::Value *taylor_step_pow(llvm_state &s, llvm::Value *x_v, llvm::Value *y_v)
         // to call an external function.
         auto &builder = s.builder();
 
-        // Convert the vector arguments to scalars.
-        auto x_scalars = vector_to_scalars(builder, x_v), y_scalars = vector_to_scalars(builder, y_v);
+        // Convert the vector argument to scalars.
+        auto x_scalars = vector_to_scalars(builder, x_v);
 
-        // Execute the pow() function on the scalar values and store
+        // Execute the heyoka_{exp,log}128() function on the scalar values and store
         // the results in res_scalars.
         std::vector<llvm::Value *> res_scalars;
-        for (decltype(x_scalars.size()) i = 0; i < x_scalars.size(); ++i) {
+        for (auto x_scal : x_scalars) {
             res_scalars.push_back(llvm_invoke_external(
-                s, "heyoka_pow128", llvm::Type::getFP128Ty(s.context()), {x_scalars[i], y_scalars[i]},
+                s, "heyoka_" + name + "128", x_t, {x_scal},
                 // NOTE: in theory we may add ReadNone here as well,
                 // but for some reason, at least up to LLVM 10,
                 // this causes strange codegen issues. Revisit
@@ -2950,24 +8561,14 @@ llvm::Value *taylor_step_pow(llvm_state &s, llvm::Value *x_v, llvm::Value *y_v)
     } else {
 #endif
         // If we are operating on SIMD vectors, try to see if we have a sleef
-        // function available for pow().
-        if (auto vec_t = llvm::dyn_cast<llvm::VectorType>(x_v->getType())) {
-            // NOTE: if sfn ends up empty, we will be falling through
-            // below and use the LLVM intrinsic instead.
-            if (const auto sfn = sleef_function_name(s.context(), "pow", vec_t->getElementType(),
-                                                     boost::numeric_cast<std::uint32_t>(vec_t->getNumElements()));
-                !sfn.empty()) {
-                return llvm_invoke_external(
-                    s, sfn, vec_t, {x_v, y_v},
-                    // NOTE: in theory we may add ReadNone here as well,
-                    // but for some reason, at least up to LLVM 10,
-                    // this causes strange codegen issues. Revisit
-                    // in the future.
-                    {llvm::Attribute::NoUnwind, llvm::Attribute::Speculatable, llvm::Attribute::WillReturn});
-            }
+        // function available.
+        // NOTE: if no sleef function is available, we will be falling
+        // through below and use the LLVM intrinsic instead.
+        if (auto ret = llvm_invoke_sleef(s, name, {x_v})) {
+            return ret;
         }
 
-        return llvm_invoke_intrinsic(s, "llvm.pow", {x_v->getType()}, {x_v, y_v});
+        return llvm_invoke_intrinsic(s, "llvm." + name, {x_v->getType()}, {x_v});
 #if defined(HEYOKA_HAVE_REAL128)
     }
 #endif
@@ -3011,15 +8612,94 @@ llvm::Value *taylor_step_abs(llvm_state &s, llvm::Value *x_v)
 #endif
 }
 
+// Helper to check if the (scalar or vector) floating-point value x_v is finite. The return
+// value is a boolean (or a vector of booleans in batch mode).
+// NOTE: the check is performed on the bit representation of x_v: after
+// clearing the sign bit, a value is finite if and only if it is less than
+// the representation of +inf (as an unsigned integer). This works for all the
+// floating-point types we support, does not require external
+// function calls for __float128 and, contrary to a floating-point comparison,
+// it cannot be optimised away when fast math is enabled.
+llvm::Value *taylor_step_finite(llvm_state &s, llvm::Value *x_v)
+{
+    auto &builder = s.builder();
+
+    // Determine the scalar type of the argument and its size in bits.
+    auto x_t = x_v->getType()->getScalarType();
+    const auto nbits = x_t->getScalarSizeInBits();
+
+    // Determine the integral type with the same size as x_v.
+    llvm::Type *int_t = builder.getIntNTy(nbits);
+    if (auto vec_t = llvm::dyn_cast<llvm::VectorType>(x_v->getType())) {
+        int_t = llvm::VectorType::getInteger(vec_t);
+    }
+
+    // The mask for clearing the sign bit and the representation of +inf.
+    auto sign_mask = llvm::ConstantInt::get(int_t, llvm::APInt::getSignedMaxValue(nbits));
+    auto inf_bits = llvm::ConstantInt::get(int_t, llvm::APFloat::getInf(x_t->getFltSemantics()).bitcastToAPInt());
+
+    auto abs_bits = builder.CreateAnd(builder.CreateBitCast(x_v, int_t), sign_mask);
+
+    return builder.CreateICmpULT(abs_bits, inf_bits);
+}
+
+// Evaluate at h, via Estrin's scheme, the n_eq polynomials of degree order whose coefficients
+// are the diff_arr[k * n_eq + j] (k being the degree of the monomial and j the index of the
+// polynomial). At each level of the scheme, the adjacent pairs of the current coefficients
+// (c_2i, c_2i+1) are replaced by c_2i + c_2i+1 * x, and x is then squared (x being initially h).
+// The chains of dependent operations have thus a length of log2(order + 1), rather than order
+// as in Horner's scheme, which exposes more instruction-level parallelism. The powers of h
+// are shared by all the polynomials.
+std::vector<llvm::Value *> taylor_run_estrin(llvm_state &s, const std::vector<llvm::Value *> &diff_arr,
+                                             llvm::Value *h, std::uint32_t n_eq, std::uint32_t order)
+{
+    auto &builder = s.builder();
+
+    std::vector<std::vector<llvm::Value *>> cfs(n_eq);
+    for (std::uint32_t j = 0; j < n_eq; ++j) {
+        for (std::uint32_t k = 0; k <= order; ++k) {
+            cfs[j].push_back(diff_arr[k * n_eq + j]);
+        }
+    }
+
+    auto *x = h;
+    while (cfs[0].size() > 1u) {
+        for (auto &cf : cfs) {
+            std::vector<llvm::Value *> new_cf;
+            for (decltype(cf.size()) i = 0; i + 1u < cf.size(); i += 2u) {
+                new_cf.push_back(builder.CreateFAdd(cf[i], builder.CreateFMul(cf[i + 1u], x)));
+            }
+            if (cf.size() % 2u == 1u) {
+                new_cf.push_back(cf.back());
+            }
+
+            cf = std::move(new_cf);
+        }
+
+        if (cfs[0].size() > 1u) {
+            x = builder.CreateFMul(x, x);
+        }
+    }
+
+    std::vector<llvm::Value *> retval;
+    for (const auto &cf : cfs) {
+        retval.push_back(cf[0]);
+    }
+
+    return retval;
+}
+
 // Run the Horner scheme to propagate an ODE state via the evaluation of the Taylor polynomials.
 // diff_var contains either the derivatives for all u variables (in compact mode) or only
 // for the state variables (non-compact mode). The evaluation point (i.e., the timestep)
 // is h. The evaluation is run in parallel over the polynomials of all the state
-// variables.
+// variables. In compact mode, jl is the layout of the array of derivatives. If estrin
+// is true, Estrin's scheme is used instead of Horner's scheme in non-compact mode
+// (see taylor_run_estrin()).
 std::variant<llvm::Value *, std::vector<llvm::Value *>>
 taylor_run_multihorner(llvm_state &s, const std::variant<llvm::Value *, std::vector<llvm::Value *>> &diff_var,
-                       llvm::Value *h, std::uint32_t n_eq, std::uint32_t n_uvars, std::uint32_t order, std::uint32_t,
-                       bool compact_mode)
+                       llvm::Value *h, std::uint32_t n_eq, const taylor_c_jet_layout &jl, std::uint32_t order,
+                       std::uint32_t, bool compact_mode, bool estrin = false)
 {
     auto &builder = s.builder();
 
@@ -3036,7 +8716,7 @@ taylor_run_multihorner(llvm_state &s, const std::variant<llvm::Value *, std::vec
         // coefficients of the highest-degree monomial in each polynomial.
         llvm_loop_u32(s, builder.getInt32(0), builder.getInt32(n_eq), [&](llvm::Value *cur_var_idx) {
             // Load the value from diff_arr and store it in res_arr.
-            builder.CreateStore(taylor_c_load_diff(s, diff_arr, n_uvars, builder.getInt32(order), cur_var_idx),
+            builder.CreateStore(taylor_c_load_jet(s, diff_arr, jl, builder.getInt32(order), cur_var_idx),
                                 builder.CreateInBoundsGEP(res_arr, {cur_var_idx}));
         });
 
@@ -3047,9 +8727,9 @@ taylor_run_multihorner(llvm_state &s, const std::variant<llvm::Value *, std::vec
                               // Load the current poly coeff from diff_arr.
                               // NOTE: we are loading the coefficients backwards wrt the order, hence
                               // we specify order - cur_order.
-                              auto cf = taylor_c_load_diff(s, diff_arr, n_uvars,
-                                                           builder.CreateSub(builder.getInt32(order), cur_order),
-                                                           cur_var_idx);
+                              auto cf = taylor_c_load_jet(s, diff_arr, jl,
+                                                          builder.CreateSub(builder.getInt32(order), cur_order),
+                                                          cur_var_idx);
 
                               // Accumulate in res_arr.
                               auto res_ptr = builder.CreateInBoundsGEP(res_arr, {cur_var_idx});
@@ -3063,6 +8743,10 @@ taylor_run_multihorner(llvm_state &s, const std::variant<llvm::Value *, std::vec
         // Non-compact mode.
         const auto &diff_arr = std::get<std::vector<llvm::Value *>>(diff_var);
 
+        if (estrin) {
+            return taylor_run_estrin(s, diff_arr, h, n_eq, order);
+        }
+
         // Init the return value, filling it with the values of the
         // coefficients of the highest-degree monomial in each polynomial.
         std::vector<llvm::Value *> res_arr;
@@ -3172,13 +8856,16 @@ void taylor_run_multihorner_state_updater(llvm_state &s, llvm::Value *jet_ptr, l
     }
 }
 
-// Same as taylor_run_multihorner(), but instead of the Horner scheme this implementation uses
-// a compensated summation over the naive evaluation of monomials.
+// Same as taylor_run_multihorner(), but this implementation uses the compensated Horner
+// scheme, in which the rounding errors of each step of the Horner scheme are computed
+// exactly via error-free transformations (based on fma) and accumulated in a separate
+// error term, which is added to the result at the end of the evaluation. The result
+// is as accurate as if it had been computed in twice the working precision.
 template <typename T>
 std::variant<llvm::Value *, std::vector<llvm::Value *>>
 taylor_run_ceval(llvm_state &s, const std::variant<llvm::Value *, std::vector<llvm::Value *>> &diff_var, llvm::Value *h,
-                 std::uint32_t n_eq, std::uint32_t n_uvars, std::uint32_t order, std::uint32_t batch_size, bool,
-                 bool compact_mode)
+                 std::uint32_t n_eq, const taylor_c_jet_layout &jl, std::uint32_t order, std::uint32_t batch_size,
+                 bool, bool compact_mode)
 {
     auto &builder = s.builder();
 
@@ -3186,89 +8873,75 @@ taylor_run_ceval(llvm_state &s, const std::variant<llvm::Value *, std::vector<ll
         // Compact mode.
         auto diff_arr = std::get<llvm::Value *>(diff_var);
 
-        // Create the arrays storing the results of the evaluation and the running compensations.
+        // Create the arrays storing the results of the evaluation and the error terms.
         auto array_type = llvm::ArrayType::get(pointee_type(diff_arr), n_eq);
         auto res_arr
             = builder.CreateInBoundsGEP(builder.CreateAlloca(array_type), {builder.getInt32(0), builder.getInt32(0)});
         auto comp_arr
             = builder.CreateInBoundsGEP(builder.CreateAlloca(array_type), {builder.getInt32(0), builder.getInt32(0)});
 
-        // Init res_arr with the order-0 monomials, and the running
-        // compensations with zero.
+        // Init res_arr with the coefficients of the highest-degree monomial
+        // in each polynomial, and the error terms with zero.
         llvm_loop_u32(s, builder.getInt32(0), builder.getInt32(n_eq), [&](llvm::Value *cur_var_idx) {
-            // Load the value from diff_arr.
-            auto val = builder.CreateLoad(builder.CreateInBoundsGEP(diff_arr, {cur_var_idx}));
-
-            // Store it in res_arr.
-            builder.CreateStore(val, builder.CreateInBoundsGEP(res_arr, {cur_var_idx}));
-
-            // Zero-init the element in comp_arr.
+            builder.CreateStore(taylor_c_load_jet(s, diff_arr, jl, builder.getInt32(order), cur_var_idx),
+                                builder.CreateInBoundsGEP(res_arr, {cur_var_idx}));
             builder.CreateStore(vector_splat(builder, codegen<T>(s, number{0.}), batch_size),
                                 builder.CreateInBoundsGEP(comp_arr, {cur_var_idx}));
         });
 
-        // Init the running updater for the powers of h.
-        auto cur_h = builder.CreateAlloca(h->getType());
-        builder.CreateStore(h, cur_h);
-
         // Run the evaluation.
         llvm_loop_u32(s, builder.getInt32(1), builder.CreateAdd(builder.getInt32(order), builder.getInt32(1)),
                       [&](llvm::Value *cur_order) {
-                          // Load the current power of h.
-                          auto cur_h_val = builder.CreateLoad(cur_h);
-
                           llvm_loop_u32(s, builder.getInt32(0), builder.getInt32(n_eq), [&](llvm::Value *cur_var_idx) {
-                              // Evaluate the current monomial.
-                              auto cf = taylor_c_load_diff(s, diff_arr, n_uvars, cur_order, cur_var_idx);
-                              auto tmp = builder.CreateFMul(cf, cur_h_val);
+                              // Load the current poly coeff from diff_arr.
+                              // NOTE: we are loading the coefficients backwards wrt the order, hence
+                              // we specify order - cur_order.
+                              auto cf = taylor_c_load_jet(s, diff_arr, jl,
+                                                          builder.CreateSub(builder.getInt32(order), cur_order),
+                                                          cur_var_idx);
 
-                              // Compute the quantities for the compensation.
-                              auto comp_ptr = builder.CreateInBoundsGEP(comp_arr, {cur_var_idx});
+                              // Run the compensated Horner step.
                               auto res_ptr = builder.CreateInBoundsGEP(res_arr, {cur_var_idx});
-                              auto y = builder.CreateFSub(tmp, builder.CreateLoad(comp_ptr));
-                              auto cur_res = builder.CreateLoad(res_ptr);
-                              auto t = builder.CreateFAdd(cur_res, y);
+                              auto comp_ptr = builder.CreateInBoundsGEP(comp_arr, {cur_var_idx});
+                              auto [r, c] = llvm_comp_horner_step(s, builder.CreateLoad(res_ptr),
+                                                                  builder.CreateLoad(comp_ptr), cf, h);
 
-                              // Update the compensation and the return value.
-                              builder.CreateStore(builder.CreateFSub(builder.CreateFSub(t, cur_res), y), comp_ptr);
-                              builder.CreateStore(t, res_ptr);
+                              builder.CreateStore(r, res_ptr);
+                              builder.CreateStore(c, comp_ptr);
                           });
-
-                          // Update the value of h.
-                          builder.CreateStore(builder.CreateFMul(cur_h_val, h), cur_h);
                       });
 
+        // Add the error terms to the results.
+        llvm_loop_u32(s, builder.getInt32(0), builder.getInt32(n_eq), [&](llvm::Value *cur_var_idx) {
+            auto res_ptr = builder.CreateInBoundsGEP(res_arr, {cur_var_idx});
+            auto comp_ptr = builder.CreateInBoundsGEP(comp_arr, {cur_var_idx});
+            builder.CreateStore(builder.CreateFAdd(builder.CreateLoad(res_ptr), builder.CreateLoad(comp_ptr)), res_ptr);
+        });
+
         return res_arr;
     } else {
         // Non-compact mode.
         const auto &diff_arr = std::get<std::vector<llvm::Value *>>(diff_var);
 
-        // Init the return values with the order-0 monomials, and the running
-        // compensations with zero.
+        // Init the return values with the coefficients of the highest-degree
+        // monomial in each polynomial, and the error terms with zero.
         std::vector<llvm::Value *> res_arr, comp_arr;
         for (std::uint32_t i = 0; i < n_eq; ++i) {
-            res_arr.push_back(diff_arr[i]);
+            res_arr.push_back(diff_arr[(n_eq * order) + i]);
             comp_arr.push_back(vector_splat(builder, codegen<T>(s, number{0.}), batch_size));
         }
 
-        // Evaluate and sum.
-        auto cur_h = h;
+        // Run the compensated Horner scheme simultaneously for all polynomials.
         for (std::uint32_t i = 1; i <= order; ++i) {
             for (std::uint32_t j = 0; j < n_eq; ++j) {
-                // Evaluate the current monomial.
-                auto tmp = builder.CreateFMul(diff_arr[i * n_eq + j], cur_h);
-
-                // Compute the quantities for the compensation.
-                auto y = builder.CreateFSub(tmp, comp_arr[j]);
-                auto t = builder.CreateFAdd(res_arr[j], y);
-
-                // Update the compensation and the return value.
-                comp_arr[j] = builder.CreateFSub(builder.CreateFSub(t, res_arr[j]), y);
-                res_arr[j] = t;
+                std::tie(res_arr[j], comp_arr[j])
+                    = llvm_comp_horner_step(s, res_arr[j], comp_arr[j], diff_arr[(order - i) * n_eq + j], h);
             }
+        }
 
-            // Update the power of h.
-            cur_h = builder.CreateFMul(cur_h, h);
+        // Add the error terms to the results.
+        for (std::uint32_t i = 0; i < n_eq; ++i) {
+            res_arr[i] = builder.CreateFAdd(res_arr[i], comp_arr[i]);
         }
 
         return res_arr;
@@ -3288,116 +8961,313 @@ void taylor_run_ceval_state_updater(llvm_state &s, llvm::Value *jet_ptr, llvm::V
     if (compact_mode) {
         // Compact mode.
 
-        // Create the array storing the results of the evaluation and the running compensations.
+        // Create the arrays storing the results of the evaluation and the error terms.
         auto array_type = llvm::ArrayType::get(make_vector_type(pointee_type(jet_ptr), batch_size), n_eq);
         auto res_arr
             = builder.CreateInBoundsGEP(builder.CreateAlloca(array_type), {builder.getInt32(0), builder.getInt32(0)});
         auto comp_arr
             = builder.CreateInBoundsGEP(builder.CreateAlloca(array_type), {builder.getInt32(0), builder.getInt32(0)});
 
-        // Init res_arr with the order-0 monomials, and the running
-        // compensations with zero.
+        // Init res_arr with the coefficients of the highest-degree monomial
+        // in each polynomial, and the error terms with zero.
         llvm_loop_u32(s, builder.getInt32(0), builder.getInt32(n_eq), [&](llvm::Value *cur_var_idx) {
             // Load the value from jet_ptr.
-            // NOTE: the index is cur_var_idx * batch_size.
+            // NOTE: the index is order * n_eq * batch_size + cur_var_idx * batch_size.
             // NOTE: overflow checking was done in taylor_add_jet_impl().
-            auto ptr
-                = builder.CreateInBoundsGEP(jet_ptr, {builder.CreateMul(builder.getInt32(batch_size), cur_var_idx)});
+            auto ptr = builder.CreateInBoundsGEP(
+                jet_ptr, {builder.CreateAdd(builder.getInt32(order * n_eq * batch_size),
+                                            builder.CreateMul(builder.getInt32(batch_size), cur_var_idx))});
             auto val = load_vector_from_memory(builder, ptr, batch_size);
 
-            // Store it in res_arr.
-            builder.CreateStore(val, builder.CreateInBoundsGEP(res_arr, {cur_var_idx}));
+            // Store it in res_arr.
+            builder.CreateStore(val, builder.CreateInBoundsGEP(res_arr, {cur_var_idx}));
+
+            // Zero-init the element in comp_arr.
+            builder.CreateStore(vector_splat(builder, codegen<T>(s, number{0.}), batch_size),
+                                builder.CreateInBoundsGEP(comp_arr, {cur_var_idx}));
+        });
+
+        // Run the evaluation.
+        llvm_loop_u32(
+            s, builder.getInt32(1), builder.CreateAdd(builder.getInt32(order), builder.getInt32(1)),
+            [&](llvm::Value *cur_order) {
+                llvm_loop_u32(s, builder.getInt32(0), builder.getInt32(n_eq), [&](llvm::Value *cur_var_idx) {
+                    // Load the current poly coeff from jet_ptr.
+                    // NOTE: the index is (order - cur_order) * n_eq * batch_size + cur_var_idx * batch_size.
+                    auto cf_ptr = builder.CreateInBoundsGEP(
+                        jet_ptr,
+                        {builder.CreateAdd(builder.CreateMul(builder.CreateSub(builder.getInt32(order), cur_order),
+                                                             builder.getInt32(n_eq * batch_size)),
+                                           builder.CreateMul(cur_var_idx, builder.getInt32(batch_size)))});
+                    auto cf = load_vector_from_memory(builder, cf_ptr, batch_size);
+
+                    // Run the compensated Horner step.
+                    auto res_ptr = builder.CreateInBoundsGEP(res_arr, {cur_var_idx});
+                    auto comp_ptr = builder.CreateInBoundsGEP(comp_arr, {cur_var_idx});
+                    auto [r, c]
+                        = llvm_comp_horner_step(s, builder.CreateLoad(res_ptr), builder.CreateLoad(comp_ptr), cf, h);
+
+                    builder.CreateStore(r, res_ptr);
+                    builder.CreateStore(c, comp_ptr);
+                });
+            });
+
+        // Add the error terms to the results and copy them to jet_ptr.
+        llvm_loop_u32(s, builder.getInt32(0), builder.getInt32(n_eq), [&](llvm::Value *cur_var_idx) {
+            auto val = builder.CreateFAdd(builder.CreateLoad(builder.CreateInBoundsGEP(res_arr, {cur_var_idx})),
+                                          builder.CreateLoad(builder.CreateInBoundsGEP(comp_arr, {cur_var_idx})));
+            store_vector_to_memory(
+                builder,
+                builder.CreateInBoundsGEP(jet_ptr, {builder.CreateMul(cur_var_idx, builder.getInt32(batch_size))}),
+                val);
+        });
+    } else {
+        // Non-compact mode.
+
+        // Init the results with the coefficients of the highest-degree monomial
+        // in each polynomial, and the error terms with zero.
+        std::vector<llvm::Value *> res_arr, comp_arr;
+        for (std::uint32_t i = 0; i < n_eq; ++i) {
+            auto ptr
+                = builder.CreateInBoundsGEP(jet_ptr, {builder.getInt32(order * n_eq * batch_size + i * batch_size)});
+            res_arr.push_back(load_vector_from_memory(builder, ptr, batch_size));
+
+            comp_arr.push_back(vector_splat(builder, codegen<T>(s, number{0.}), batch_size));
+        }
+
+        // Run the evaluation.
+        for (std::uint32_t i = 1; i <= order; ++i) {
+            for (std::uint32_t j = 0; j < n_eq; ++j) {
+                auto cf_ptr = builder.CreateInBoundsGEP(
+                    jet_ptr, {builder.getInt32((order - i) * n_eq * batch_size + j * batch_size)});
+                auto cf = load_vector_from_memory(builder, cf_ptr, batch_size);
+
+                std::tie(res_arr[j], comp_arr[j]) = llvm_comp_horner_step(s, res_arr[j], comp_arr[j], cf, h);
+            }
+        }
+
+        // Add the error terms to the results and write them to jet_ptr.
+        for (std::uint32_t i = 0; i < n_eq; ++i) {
+            store_vector_to_memory(builder, builder.CreateInBoundsGEP(jet_ptr, {builder.getInt32(batch_size * i)}),
+                                   builder.CreateFAdd(res_arr[i], comp_arr[i]));
+        }
+    }
+}
+
+// Helper to replace the subexpressions of the rhs of an ODE system
+// which depend only on numbers and params with new params, whose values
+// are computed once per step (rather than once per Taylor order).
+//
+// The replaced subexpressions are those which contain at least one param
+// and no variables (the time function, which has no arguments, is treated
+// like a variable), which are not params themselves, and which are not subexpressions
+// of another replaced subexpression. The new params are indexed from n_pars onwards,
+// where n_pars is the number of params in the original system.
+class taylor_par_hoister
+{
+    // The result of the transformation of a subexpression:
+    // the transformed subexpression and its kind
+    // (0 for numbers only, 1 for numbers and params
+    // with at least one param, 2 for everything else).
+    struct res_t {
+        expression ex;
+        int kind;
+    };
+
+    std::uint32_t m_n_pars;
+    std::vector<expression> m_hoisted;
+    std::unordered_map<expression, std::uint32_t> m_hmap;
+    std::unordered_map<const void *, res_t> m_memo;
+
+    // Replace the param-only subexpression ex with a new param.
+    expression hoist(const expression &ex)
+    {
+        if (std::holds_alternative<param>(ex.value())) {
+            // Params are left alone.
+            return ex;
+        }
+
+        if (auto it = m_hmap.find(ex); it != m_hmap.end()) {
+            return expression{param{m_n_pars + it->second}};
+        }
+
+        // LCOV_EXCL_START
+        if (m_hoisted.size() >= std::numeric_limits<std::uint32_t>::max() - m_n_pars) {
+            throw std::overflow_error("Overflow detected in the number of params of an adaptive Taylor stepper");
+        }
+        // LCOV_EXCL_STOP
+
+        const auto idx = static_cast<std::uint32_t>(m_hoisted.size());
+        m_hmap.emplace(ex, idx);
+        m_hoisted.push_back(ex);
+
+        return expression{param{m_n_pars + idx}};
+    }
+
+public:
+    explicit taylor_par_hoister(std::uint32_t n_pars) : m_n_pars(n_pars) {}
+
+    // NOTE: the nodes of the expressions passed to operator()
+    // must be kept alive as long as the hoister is in use,
+    // as the results of the transformation are memoised
+    // on the identity of the nodes.
+    expression operator()(const expression &ex)
+    {
+        auto leaf = [](const expression &e) -> res_t {
+            if (std::holds_alternative<number>(e.value())) {
+                return {e, 0};
+            } else if (std::holds_alternative<param>(e.value())) {
+                return {e, 1};
+            } else {
+                return {e, 2};
+            }
+        };
+
+        auto node = [this](const expression &n, res_t *args) -> res_t {
+            const auto [b, e] = node_args(n);
+            const auto n_args = static_cast<std::size_t>(e - b);
+
+            if (n_args == 0u) {
+                // Functions without arguments (i.e., time).
+                return {n, 2};
+            }
+
+            int kind = 0;
+            for (std::size_t i = 0; i < n_args; ++i) {
+                kind = std::max(kind, args[i].kind);
+            }
+
+            if (kind < 2) {
+                // NOTE: the arguments of a param-only
+                // node are never transformed.
+                return {n, kind};
+            }
+
+            // The node depends on the variables: replace
+            // its param-only arguments with new params.
+            std::vector<expression> new_args;
+            new_args.reserve(n_args);
+            for (std::size_t i = 0; i < n_args; ++i) {
+                new_args.push_back(args[i].kind == 1 ? hoist(args[i].ex) : args[i].ex);
+            }
+
+            return {node_rebuild(n, new_args.data()), 2};
+        };
+
+        auto r = fold_postorder<res_t>(
+            ex, leaf, node, [](const expression &) { return true; }, m_memo);
 
-            // Zero-init the element in comp_arr.
-            builder.CreateStore(vector_splat(builder, codegen<T>(s, number{0.}), batch_size),
-                                builder.CreateInBoundsGEP(comp_arr, {cur_var_idx}));
-        });
+        return r.kind == 1 ? hoist(r.ex) : std::move(r.ex);
+    }
 
-        // Init the running updater for the powers of h.
-        auto cur_h = builder.CreateAlloca(h->getType());
-        builder.CreateStore(h, cur_h);
+    std::vector<expression> get_hoisted() &&
+    {
+        return std::move(m_hoisted);
+    }
+};
 
-        // Run the evaluation.
-        llvm_loop_u32(s, builder.getInt32(1), builder.CreateAdd(builder.getInt32(order), builder.getInt32(1)),
-                      [&](llvm::Value *cur_order) {
-                          // Load the current power of h.
-                          auto cur_h_val = builder.CreateLoad(cur_h);
+// Hoist the param-only subexpressions out of the rhs of sys
+// and out of sv_funcs (see taylor_par_hoister). The return values are the
+// number of params in the original system and the hoisted subexpressions.
+template <typename U>
+std::pair<std::uint32_t, std::vector<expression>> taylor_hoist_par_subexprs(U &sys, std::vector<expression> &sv_funcs)
+{
+    auto n_pars = n_pars_in_sys(sys);
+    for (const auto &ex : sv_funcs) {
+        n_pars = std::max(n_pars, get_param_size(ex));
+    }
 
-                          llvm_loop_u32(s, builder.getInt32(0), builder.getInt32(n_eq), [&](llvm::Value *cur_var_idx) {
-                              // Evaluate the current monomial.
-                              // NOTE: the index is cur_order * n_eq * batch_size + cur_var_idx * batch_size.
-                              auto cf_ptr = builder.CreateInBoundsGEP(
-                                  jet_ptr,
-                                  {builder.CreateAdd(builder.CreateMul(cur_order, builder.getInt32(n_eq * batch_size)),
-                                                     builder.CreateMul(cur_var_idx, builder.getInt32(batch_size)))});
-                              auto cf = load_vector_from_memory(builder, cf_ptr, batch_size);
-                              auto tmp = builder.CreateFMul(cf, cur_h_val);
-
-                              // Compute the quantities for the compensation.
-                              auto comp_ptr = builder.CreateInBoundsGEP(comp_arr, {cur_var_idx});
-                              auto res_ptr = builder.CreateInBoundsGEP(res_arr, {cur_var_idx});
-                              auto y = builder.CreateFSub(tmp, builder.CreateLoad(comp_ptr));
-                              auto cur_res = builder.CreateLoad(res_ptr);
-                              auto t = builder.CreateFAdd(cur_res, y);
+    taylor_par_hoister h(n_pars);
 
-                              // Update the compensation and the result.
-                              builder.CreateStore(builder.CreateFSub(builder.CreateFSub(t, cur_res), y), comp_ptr);
-                              builder.CreateStore(t, res_ptr);
-                          });
+    // NOTE: the original expressions are replaced only
+    // at the end, as the hoister requires them to be alive.
+    std::vector<expression> new_rhs, new_sv_funcs;
+    new_rhs.reserve(sys.size());
+    for (const auto &eq : sys) {
+        if constexpr (std::is_same_v<uncvref_t<decltype(eq)>, expression>) {
+            new_rhs.push_back(h(eq));
+        } else {
+            new_rhs.push_back(h(eq.second));
+        }
+    }
+    new_sv_funcs.reserve(sv_funcs.size());
+    for (const auto &ex : sv_funcs) {
+        new_sv_funcs.push_back(h(ex));
+    }
 
-                          // Update the value of h.
-                          builder.CreateStore(builder.CreateFMul(cur_h_val, h), cur_h);
-                      });
+    for (decltype(sys.size()) i = 0; i < sys.size(); ++i) {
+        if constexpr (std::is_same_v<uncvref_t<decltype(sys[i])>, expression>) {
+            sys[i] = std::move(new_rhs[i]);
+        } else {
+            sys[i].second = std::move(new_rhs[i]);
+        }
+    }
+    sv_funcs = std::move(new_sv_funcs);
 
-        // Copy the result to jet_ptr.
-        llvm_loop_u32(s, builder.getInt32(0), builder.getInt32(n_eq), [&](llvm::Value *cur_var_idx) {
-            auto val = builder.CreateLoad(builder.CreateInBoundsGEP(res_arr, {cur_var_idx}));
-            store_vector_to_memory(
-                builder,
-                builder.CreateInBoundsGEP(jet_ptr, {builder.CreateMul(cur_var_idx, builder.getInt32(batch_size))}),
-                val);
-        });
-    } else {
-        // Non-compact mode.
+    return {n_pars, std::move(h).get_hoisted()};
+}
 
-        // Init the results with the order-0 monomials, and the running
-        // compensations with zero.
-        std::vector<llvm::Value *> res_arr, comp_arr;
-        for (std::uint32_t i = 0; i < n_eq; ++i) {
-            auto ptr = builder.CreateInBoundsGEP(jet_ptr, {builder.getInt32(i * batch_size)});
-            res_arr.push_back(load_vector_from_memory(builder, ptr, batch_size));
+// Codegen for the param-only expression ex, with the
+// values of the params loaded from par_ptr. The values of
+// the subexpressions are memoised in memo.
+template <typename T>
+llvm::Value *taylor_codegen_par_expr(llvm_state &s, const expression &ex,
+                                     std::unordered_map<expression, llvm::Value *> &memo, llvm::Value *par_ptr,
+                                     std::uint32_t batch_size)
+{
+    if (auto it = memo.find(ex); it != memo.end()) {
+        return it->second;
+    }
 
-            comp_arr.push_back(vector_splat(builder, codegen<T>(s, number{0.}), batch_size));
-        }
+    auto &builder = s.builder();
 
-        // Evaluate and sum.
-        auto cur_h = h;
-        for (std::uint32_t i = 1; i <= order; ++i) {
-            for (std::uint32_t j = 0; j < n_eq; ++j) {
-                auto cf_ptr
-                    = builder.CreateInBoundsGEP(jet_ptr, {builder.getInt32(i * n_eq * batch_size + j * batch_size)});
-                auto cf = load_vector_from_memory(builder, cf_ptr, batch_size);
-                auto tmp = builder.CreateFMul(cf, cur_h);
+    auto rec = [&](const expression &e) { return taylor_codegen_par_expr<T>(s, e, memo, par_ptr, batch_size); };
 
-                // Compute the quantities for the compensation.
-                auto y = builder.CreateFSub(tmp, comp_arr[j]);
-                auto t = builder.CreateFAdd(res_arr[j], y);
+    auto *ret = std::visit(
+        [&](const auto &v) -> llvm::Value * {
+            using type = uncvref_t<decltype(v)>;
+
+            if constexpr (std::is_same_v<type, number>) {
+                return taylor_codegen_numparam_num<T>(s, v, batch_size);
+            } else if constexpr (std::is_same_v<type, param>) {
+                return taylor_codegen_numparam_par(s, v, par_ptr, batch_size);
+            } else if constexpr (std::is_same_v<type, variable>) {
+                // LCOV_EXCL_START
+                assert(false);
+                throw std::invalid_argument("Cannot generate the code for the variable '" + v.name()
+                                            + "' in a param-only expression");
+                // LCOV_EXCL_STOP
+            } else if constexpr (std::is_same_v<type, binary_operator>) {
+                auto *a = rec(v.lhs());
+                auto *b = rec(v.rhs());
+
+                switch (v.op()) {
+                    case binary_operator::type::add:
+                        return builder.CreateFAdd(a, b);
+                    case binary_operator::type::sub:
+                        return builder.CreateFSub(a, b);
+                    case binary_operator::type::mul:
+                        return builder.CreateFMul(a, b);
+                    default:
+                        return builder.CreateFDiv(a, b);
+                }
+            } else if constexpr (std::is_same_v<type, func>) {
+                std::vector<llvm::Value *> args;
+                args.reserve(v.args().size());
+                for (const auto &arg : v.args()) {
+                    args.push_back(rec(arg));
+                }
 
-                // Update the compensation and the result.
-                comp_arr[j] = builder.CreateFSub(builder.CreateFSub(t, res_arr[j]), y);
-                res_arr[j] = t;
+                return codegen_from_values<T>(s, v, args);
+            } else {
+                static_assert(always_false_v<T>, "Unhandled expression type.");
             }
+        },
+        ex.value());
 
-            // Update the power of h.
-            cur_h = builder.CreateFMul(cur_h, h);
-        }
+    memo.emplace(ex, ret);
 
-        // Write the result to jet_ptr.
-        for (std::uint32_t i = 0; i < n_eq; ++i) {
-            store_vector_to_memory(builder, builder.CreateInBoundsGEP(jet_ptr, {builder.getInt32(batch_size * i)}),
-                                   res_arr[i]);
-        }
-    }
+    return ret;
 }
 
 // NOTE: in compact mode, care must be taken when adding multiple stepper functions to the same llvm state
@@ -3410,14 +9280,23 @@ void taylor_run_ceval_state_updater(llvm_state &s, llvm::Value *jet_ptr, llvm::V
 // NOTE: document this eventually.
 // NOTE: this is not an issue in the Taylor integrators, where we are certain that only 1 stepper
 // is ever added to the LLVM state.
+// NOTE: sv_funcs are extra functions of the state variables (e.g., event equations)
+// whose Taylor coefficients will be written to tc_ptr after the Taylor coefficients
+// of the state variables.
 template <typename T, typename U>
-auto taylor_add_adaptive_step_impl(llvm_state &s, const std::string &name, U sys, T tol, std::uint32_t batch_size,
-                                   bool high_accuracy, bool compact_mode)
+std::tuple<std::vector<std::pair<expression, std::vector<std::uint32_t>>>, std::uint32_t>
+taylor_add_adaptive_step_impl(llvm_state &s, const std::string &name, U sys, T tol, std::uint32_t batch_size,
+                              bool high_accuracy, bool compact_mode, std::vector<expression> sv_funcs,
+                              taylor_sort_strategy sort_strategy, bool parallel_mode,
+                              std::uint32_t unroll_threshold, taylor_jet_layout jet_layout, T rtol, T atol,
+                              std::vector<T> err_weights, std::uint32_t order_ovr, bool predict_h,
+                              bool simd_segments, bool estrin, bool mem_hints)
 {
     using std::ceil;
     using std::exp;
     using std::isfinite;
     using std::log;
+    using std::min;
 
     if (s.is_compiled()) {
         throw std::invalid_argument("An adaptive Taylor stepper cannot be added to an llvm_state after compilation");
@@ -3427,6 +9306,47 @@ auto taylor_add_adaptive_step_impl(llvm_state &s, const std::string &name, U sys
         throw std::invalid_argument("The batch size of a Taylor stepper cannot be zero");
     }
 
+    // Check the mixed absolute/relative error control. If enabled, the
+    // tolerance determining the order is the smallest nonzero between
+    // atol and rtol, and the step size is controlled via a per-component
+    // error norm (see below).
+    const auto mixed_ctrl = rtol != 0 || atol != 0 || !err_weights.empty();
+    if (mixed_ctrl) {
+        if (!isfinite(atol) || atol <= 0) {
+            throw std::invalid_argument(
+                "The absolute tolerance in an adaptive Taylor stepper must be finite and positive, but it is "
+                + li_to_string(atol) + " instead");
+        }
+
+        if (!isfinite(rtol) || rtol < 0) {
+            throw std::invalid_argument(
+                "The relative tolerance in an adaptive Taylor stepper must be finite and non-negative, but it is "
+                + li_to_string(rtol) + " instead");
+        }
+
+        if (!err_weights.empty() && err_weights.size() != taylor_n_eq(sys)) {
+            throw std::invalid_argument("The number of error weights in an adaptive Taylor stepper ("
+                                        + std::to_string(err_weights.size())
+                                        + ") differs from the number of equations ("
+                                        + std::to_string(taylor_n_eq(sys)) + ")");
+        }
+
+        for (const auto &w : err_weights) {
+            if (!isfinite(w) || w < 0) {
+                throw std::invalid_argument("The error weights in an adaptive Taylor stepper must be finite and "
+                                            "non-negative, but the weight "
+                                            + li_to_string(w) + " was detected");
+            }
+        }
+
+        if (!err_weights.empty()
+            && std::all_of(err_weights.begin(), err_weights.end(), [](const auto &w) { return w == 0; })) {
+            throw std::invalid_argument("The error weights in an adaptive Taylor stepper cannot be all zero");
+        }
+
+        tol = rtol == 0 ? atol : min(atol, rtol);
+    }
+
     if (!isfinite(tol) || tol <= 0) {
         throw std::invalid_argument(
             "The tolerance in an adaptive Taylor stepper must be finite and positive, but it is " + li_to_string(tol)
@@ -3448,18 +9368,84 @@ auto taylor_add_adaptive_step_impl(llvm_state &s, const std::string &name, U sys
         throw std::overflow_error("The computation of the Taylor order in an adaptive Taylor stepper resulted "
                                   "in an overflow condition");
     }
-    const auto order = static_cast<std::uint32_t>(order_f);
+    // NOTE: a nonzero order_ovr overrides the order deduced from the tolerance.
+    if (order_ovr == 1u) {
+        throw std::invalid_argument("The order of an adaptive Taylor stepper must be at least 2");
+    }
+    const auto order = order_ovr == 0u ? static_cast<std::uint32_t>(order_f) : order_ovr;
 
     // Record the number of equations/variables.
-    const auto n_eq = boost::numeric_cast<std::uint32_t>(sys.size());
+    // NOTE: this also validates a precomputed Taylor decomposition.
+    const auto n_eq = taylor_n_eq(sys);
+
+    // Record the number of extra functions.
+    const auto n_sv_funcs = boost::numeric_cast<std::uint32_t>(sv_funcs.size());
+
+    std::uint32_t n_pars = 0;
+    std::vector<expression> hoisted;
+    taylor_dc_t dc;
+    std::vector<std::uint32_t> sv_funcs_dc;
+
+    if constexpr (std::is_same_v<U, taylor_dc_t>) {
+        // NOTE: with a precomputed decomposition, the symbolic processing
+        // of the system (hoisting, decomposition, CSE and sorting) is skipped.
+        // The extra functions would need to be decomposed
+        // together with the system, hence they are not supported.
+        if (n_sv_funcs > 0u) {
+            throw std::invalid_argument(
+                "The event equations are not supported in an adaptive Taylor stepper constructed "
+                "from a precomputed decomposition");
+        }
 
-    // Decompose the system of equations.
-    auto dc = taylor_decompose(std::move(sys));
+        n_pars = n_pars_in_sys(sys);
+        dc = std::move(sys);
+    } else {
+        // Replace the param-only subexpressions in the system of equations
+        // and in the extra functions with new params, whose values will be
+        // computed at the beginning of each step.
+        auto hoist_res = taylor_hoist_par_subexprs(sys, sv_funcs);
+        n_pars = hoist_res.first;
+        hoisted = std::move(hoist_res.second);
+
+        // Decompose the system of equations and the extra functions.
+        auto dec_res = taylor_decompose_impl(std::move(sys), std::move(sv_funcs), s.stats(), sort_strategy);
+        dc = std::move(dec_res.first);
+        sv_funcs_dc = std::move(dec_res.second);
+        assert(sv_funcs_dc.size() == n_sv_funcs);
+    }
+
+    const auto n_hoisted = boost::numeric_cast<std::uint32_t>(hoisted.size());
+
+    // Overflow check: we need to be able to index into the
+    // extended parameter array (size (n_pars + n_hoisted) * batch_size)
+    // using uint32_t.
+    // LCOV_EXCL_START
+    if (n_hoisted > std::numeric_limits<std::uint32_t>::max() - n_pars
+        || n_pars + n_hoisted > std::numeric_limits<std::uint32_t>::max() / batch_size) {
+        throw std::overflow_error("An overflow condition was detected while adding an adaptive Taylor stepper");
+    }
+    // LCOV_EXCL_STOP
+
+    // Time the IR generation.
+    std::optional<time_accumulator> ta_ir;
+    ta_ir.emplace(s.stats().ir_gen_time);
 
     // Compute the number of u variables.
     assert(dc.size() > n_eq);
     const auto n_uvars = boost::numeric_cast<std::uint32_t>(dc.size() - n_eq);
 
+    // Overflow check: we need to be able to index into tc_ptr
+    // (size (n_eq + n_sv_funcs) * (order + 1) * batch_size)
+    // using uint32_t.
+    // LCOV_EXCL_START
+    if (n_sv_funcs > std::numeric_limits<std::uint32_t>::max() - n_eq
+        || order == std::numeric_limits<std::uint32_t>::max()
+        || (order + 1u) > std::numeric_limits<std::uint32_t>::max() / batch_size
+        || n_eq + n_sv_funcs > std::numeric_limits<std::uint32_t>::max() / ((order + 1u) * batch_size)) {
+        throw std::overflow_error("An overflow condition was detected while adding an adaptive Taylor stepper");
+    }
+    // LCOV_EXCL_STOP
+
     auto &builder = s.builder();
     auto &context = s.context();
 
@@ -3470,9 +9456,12 @@ auto taylor_add_adaptive_step_impl(llvm_state &s, const std::string &name, U sys
     // - pointer to the array of max timesteps (read & write),
     // - pointer to the Taylor coefficients output (write only).
     // These pointers cannot overlap.
+    // NOTE: with the step size prediction, the array of max timesteps is
+    // followed by the array of the predicted timesteps (read & write, see below).
     std::vector<llvm::Type *> fargs(5, llvm::PointerType::getUnqual(to_llvm_type<T>(s.context())));
-    // The function does not return anything.
-    auto *ft = llvm::FunctionType::get(builder.getVoidTy(), fargs, false);
+    // The function returns a 32-bit integer flag signalling whether
+    // or not the updated state vector(s) contain only finite values.
+    auto *ft = llvm::FunctionType::get(builder.getInt32Ty(), fargs, false);
     assert(ft != nullptr);
     // Now create the function.
     auto *f = llvm::Function::Create(ft, llvm::Function::ExternalLinkage, name, &s.module());
@@ -3515,15 +9504,131 @@ auto taylor_add_adaptive_step_impl(llvm_state &s, const std::string &name, U sys
     assert(bb != nullptr);
     builder.SetInsertPoint(bb);
 
+    // Compute the values of the hoisted subexpressions. They are stored,
+    // together with a copy of the original params, in an extended parameter
+    // array which is then used in place of par_ptr in the computation of the jet.
+    // NOTE: the values are computed at every step, so that the changes
+    // to the values of the params in between steps are always taken into account.
+    llvm::Value *jet_par_ptr = par_ptr;
+    if (n_hoisted > 0u) {
+        auto *fp_t = to_llvm_type<T>(context);
+        auto *ext_arr_t = llvm::ArrayType::get(fp_t, (n_pars + n_hoisted) * batch_size);
+
+        jet_par_ptr = builder.CreateInBoundsGEP(ext_arr_t, builder.CreateAlloca(ext_arr_t),
+                                                {builder.getInt32(0), builder.getInt32(0)});
+
+        // Copy the original params.
+        llvm_loop_u32(s, builder.getInt32(0), builder.getInt32(n_pars * batch_size), [&](llvm::Value *cur_idx) {
+            builder.CreateStore(builder.CreateLoad(fp_t, builder.CreateInBoundsGEP(fp_t, par_ptr, cur_idx)),
+                                builder.CreateInBoundsGEP(fp_t, jet_par_ptr, cur_idx));
+        });
+
+        // Compute and store the hoisted subexpressions.
+        std::unordered_map<expression, llvm::Value *> hoist_memo;
+        for (std::uint32_t i = 0; i < n_hoisted; ++i) {
+            auto *val = taylor_codegen_par_expr<T>(s, hoisted[i], hoist_memo, par_ptr, batch_size);
+
+            store_vector_to_memory(
+                builder,
+                builder.CreateInBoundsGEP(fp_t, jet_par_ptr, builder.getInt32((n_pars + i) * batch_size)), val);
+        }
+    }
+
     // Compute the jet of derivatives at the given order.
-    // NOTE: in taylor_compute_jet() we ensure that n_uvars * order + n_eq
+    // NOTE: in taylor_compute_jet() we ensure that n_uvars * (order + 1)
     // is representable as a 32-bit unsigned integer.
     auto diff_variant
-        = taylor_compute_jet<T>(s, state_ptr, par_ptr, time_ptr, dc, n_eq, n_uvars, order, batch_size, compact_mode);
+        = taylor_compute_jet<T>(s, state_ptr, jet_par_ptr, time_ptr, dc, sv_funcs_dc, n_eq, n_uvars, order, batch_size,
+                                compact_mode, parallel_mode, unroll_threshold, jet_layout, simd_segments, mem_hints);
 
-    llvm::Value *max_abs_state, *max_abs_diff_o, *max_abs_diff_om1;
+    // The layout of the array of derivatives in compact mode.
+    const auto jl = taylor_c_make_jet_layout(jet_layout, n_uvars, order);
 
-    if (compact_mode) {
+    llvm::Value *max_abs_state = nullptr, *max_abs_diff_o, *max_abs_diff_om1;
+
+    if (mixed_ctrl) {
+        // Mixed absolute/relative error control: the norms of the derivatives at orders
+        // order and order - 1 are computed as the max over the components of
+        // w_i * |x_i^[k]| / (atol + rtol * |x_i|), rescaled by tol. With these norms, the
+        // estimation of rho below targets an error of (atol + rtol * |x_i|) / w_i
+        // on each component.
+        auto *fp_t = to_llvm_type<T>(context);
+        auto *fp_vec_t = to_llvm_vector_type<T>(context, batch_size);
+
+        if (err_weights.empty()) {
+            err_weights.resize(boost::numeric_cast<decltype(err_weights.size())>(n_eq), T(1));
+        }
+
+        const auto a_vec = vector_splat(builder, codegen<T>(s, number{atol / tol}), batch_size);
+        const auto r_vec = vector_splat(builder, codegen<T>(s, number{rtol / tol}), batch_size);
+
+        // Helper to compute the error scaling factor w / (atol + rtol * |x|)
+        // (rescaled by tol) for the component x with weight w.
+        auto err_scale = [&](llvm::Value *x, llvm::Value *w) {
+            return builder.CreateFDiv(w, builder.CreateFAdd(a_vec, builder.CreateFMul(r_vec, taylor_step_abs(s, x))));
+        };
+
+        if (compact_mode) {
+            auto diff_arr = std::get<llvm::Value *>(diff_variant);
+
+            // Store the weights in a global read-only array.
+            std::vector<llvm::Constant *> w_consts;
+            for (const auto &w : err_weights) {
+                w_consts.push_back(llvm::cast<llvm::Constant>(codegen<T>(s, number{w})));
+            }
+            auto *w_arr_t = llvm::ArrayType::get(fp_t, boost::numeric_cast<std::uint64_t>(n_eq));
+            auto *g_w = new llvm::GlobalVariable(s.module(), w_arr_t, true, llvm::GlobalVariable::InternalLinkage,
+                                                 llvm::ConstantArray::get(w_arr_t, w_consts));
+
+            max_abs_diff_o = builder.CreateAlloca(fp_vec_t);
+            max_abs_diff_om1 = builder.CreateAlloca(fp_vec_t);
+            builder.CreateStore(llvm::Constant::getNullValue(fp_vec_t), max_abs_diff_o);
+            builder.CreateStore(llvm::Constant::getNullValue(fp_vec_t), max_abs_diff_om1);
+
+            llvm_loop_u32(s, builder.getInt32(0), builder.getInt32(n_eq), [&](llvm::Value *cur_idx) {
+                auto *w_ptr = builder.CreateInBoundsGEP(w_arr_t, g_w, {builder.getInt32(0), cur_idx});
+                auto w = vector_splat(builder, builder.CreateLoad(fp_t, w_ptr), batch_size);
+                auto scale = err_scale(taylor_c_load_jet(s, diff_arr, jl, builder.getInt32(0), cur_idx), w);
+
+                builder.CreateStore(
+                    taylor_step_maxabs(
+                        s, builder.CreateLoad(max_abs_diff_o),
+                        builder.CreateFMul(taylor_c_load_jet(s, diff_arr, jl, builder.getInt32(order), cur_idx),
+                                           scale)),
+                    max_abs_diff_o);
+                builder.CreateStore(
+                    taylor_step_maxabs(
+                        s, builder.CreateLoad(max_abs_diff_om1),
+                        builder.CreateFMul(taylor_c_load_jet(s, diff_arr, jl, builder.getInt32(order - 1u), cur_idx),
+                                           scale)),
+                    max_abs_diff_om1);
+            });
+
+            max_abs_diff_o = builder.CreateLoad(max_abs_diff_o);
+            max_abs_diff_om1 = builder.CreateLoad(max_abs_diff_om1);
+        } else {
+            const auto &diff_arr = std::get<std::vector<llvm::Value *>>(diff_variant);
+
+            max_abs_diff_o = llvm::Constant::getNullValue(fp_vec_t);
+            max_abs_diff_om1 = llvm::Constant::getNullValue(fp_vec_t);
+
+            for (std::uint32_t i = 0; i < n_eq; ++i) {
+                // NOTE: the components with zero weight
+                // do not contribute to the error control.
+                if (err_weights[i] == 0) {
+                    continue;
+                }
+
+                auto scale = err_scale(diff_arr[i], vector_splat(builder, codegen<T>(s, number{err_weights[i]}),
+                                                                 batch_size));
+
+                max_abs_diff_o = taylor_step_maxabs(s, max_abs_diff_o,
+                                                    builder.CreateFMul(diff_arr[order * n_eq + i], scale));
+                max_abs_diff_om1 = taylor_step_maxabs(s, max_abs_diff_om1,
+                                                      builder.CreateFMul(diff_arr[(order - 1u) * n_eq + i], scale));
+            }
+        }
+    } else if (compact_mode) {
         auto diff_arr = std::get<llvm::Value *>(diff_variant);
 
         // Compute the norm infinity of the state vector and the norm infinity of the derivatives
@@ -3533,32 +9638,30 @@ auto taylor_add_adaptive_step_impl(llvm_state &s, const std::string &name, U sys
         max_abs_diff_om1 = builder.CreateAlloca(to_llvm_vector_type<T>(context, batch_size));
 
         // Initialise with the abs(derivatives) of the first state variable at orders 0, 'order' and 'order - 1'.
+        // NOTE: in compact mode diff_arr contains the derivatives for *all* uvars,
+        // laid out according to jl.
         builder.CreateStore(
-            taylor_step_abs(s, builder.CreateLoad(builder.CreateInBoundsGEP(diff_arr, {builder.getInt32(0)}))),
+            taylor_step_abs(s, taylor_c_load_jet(s, diff_arr, jl, builder.getInt32(0), builder.getInt32(0))),
             max_abs_state);
-        // NOTE: in compact mode diff_arr contains the derivatives for *all* uvars,
-        // hence the indexing is order * n_uvars.
-        builder.CreateStore(taylor_step_abs(s, builder.CreateLoad(builder.CreateInBoundsGEP(
-                                                   diff_arr, {builder.getInt32(order * n_uvars)}))),
-                            max_abs_diff_o);
-        builder.CreateStore(taylor_step_abs(s, builder.CreateLoad(builder.CreateInBoundsGEP(
-                                                   diff_arr, {builder.getInt32((order - 1u) * n_uvars)}))),
-                            max_abs_diff_om1);
+        builder.CreateStore(
+            taylor_step_abs(s, taylor_c_load_jet(s, diff_arr, jl, builder.getInt32(order), builder.getInt32(0))),
+            max_abs_diff_o);
+        builder.CreateStore(
+            taylor_step_abs(s, taylor_c_load_jet(s, diff_arr, jl, builder.getInt32(order - 1u), builder.getInt32(0))),
+            max_abs_diff_om1);
 
         llvm_loop_u32(s, builder.getInt32(1), builder.getInt32(n_eq), [&](llvm::Value *cur_idx) {
-            builder.CreateStore(taylor_step_maxabs(s, builder.CreateLoad(max_abs_state),
-                                                   builder.CreateLoad(builder.CreateInBoundsGEP(diff_arr, {cur_idx}))),
-                                max_abs_state);
+            builder.CreateStore(
+                taylor_step_maxabs(s, builder.CreateLoad(max_abs_state),
+                                   taylor_c_load_jet(s, diff_arr, jl, builder.getInt32(0), cur_idx)),
+                max_abs_state);
             builder.CreateStore(
                 taylor_step_maxabs(s, builder.CreateLoad(max_abs_diff_o),
-                                   builder.CreateLoad(builder.CreateInBoundsGEP(
-                                       diff_arr, {builder.CreateAdd(builder.getInt32(order * n_uvars), cur_idx)}))),
+                                   taylor_c_load_jet(s, diff_arr, jl, builder.getInt32(order), cur_idx)),
                 max_abs_diff_o);
             builder.CreateStore(
-                taylor_step_maxabs(
-                    s, builder.CreateLoad(max_abs_diff_om1),
-                    builder.CreateLoad(builder.CreateInBoundsGEP(
-                        diff_arr, {builder.CreateAdd(builder.getInt32((order - 1u) * n_uvars), cur_idx)}))),
+                taylor_step_maxabs(s, builder.CreateLoad(max_abs_diff_om1),
+                                   taylor_c_load_jet(s, diff_arr, jl, builder.getInt32(order - 1u), cur_idx)),
                 max_abs_diff_om1);
         });
 
@@ -3583,27 +9686,100 @@ auto taylor_add_adaptive_step_impl(llvm_state &s, const std::string &name, U sys
         }
     }
 
-    // Determine if we are in absolute or relative tolerance mode.
-    auto abs_or_rel
-        = builder.CreateFCmpOLE(max_abs_state, vector_splat(builder, codegen<T>(s, number{1.}), batch_size));
-
     // Estimate rho at orders order - 1 and order.
-    auto num_rho
-        = builder.CreateSelect(abs_or_rel, vector_splat(builder, codegen<T>(s, number{1.}), batch_size), max_abs_state);
-    auto rho_o = taylor_step_pow(s, builder.CreateFDiv(num_rho, max_abs_diff_o),
-                                 vector_splat(builder, codegen<T>(s, number{T(1) / order}), batch_size));
-    auto rho_om1 = taylor_step_pow(s, builder.CreateFDiv(num_rho, max_abs_diff_om1),
-                                   vector_splat(builder, codegen<T>(s, number{T(1) / (order - 1u)}), batch_size));
+    // NOTE: with the mixed error control, the scaling of the
+    // components is already included in the norms of the derivatives.
+    llvm::Value *num_rho = vector_splat(builder, codegen<T>(s, number{1.}), batch_size);
+    if (!mixed_ctrl) {
+        // Determine if we are in absolute or relative tolerance mode.
+        auto abs_or_rel
+            = builder.CreateFCmpOLE(max_abs_state, vector_splat(builder, codegen<T>(s, number{1.}), batch_size));
+
+        num_rho = builder.CreateSelect(abs_or_rel, num_rho, max_abs_state);
+    }
+    // NOTE: rho_m = min(rho_o, rho_om1), with rho_o = (num_rho / max_abs_diff_o)**(1 / order)
+    // and rho_om1 = (num_rho / max_abs_diff_om1)**(1 / (order - 1)), is computed in the logarithmic
+    // domain as exp(min(log(rho_o), log(rho_om1))): this replaces the two pow() invocations
+    // with two log() and a single exp() invocations, with the reciprocals of the orders
+    // computed at compile time.
+    auto log_rho_o
+        = builder.CreateFMul(taylor_step_elem_func(s, "log", builder.CreateFDiv(num_rho, max_abs_diff_o)),
+                             vector_splat(builder, codegen<T>(s, number{T(1) / order}), batch_size));
+    auto log_rho_om1
+        = builder.CreateFMul(taylor_step_elem_func(s, "log", builder.CreateFDiv(num_rho, max_abs_diff_om1)),
+                             vector_splat(builder, codegen<T>(s, number{T(1) / (order - 1u)}), batch_size));
 
     // Take the minimum.
-    auto rho_m = taylor_step_min(s, rho_o, rho_om1);
+    auto rho_m = taylor_step_elem_func(s, "exp", taylor_step_min(s, log_rho_o, log_rho_om1));
 
     // Compute the scaling + safety factor.
-    const auto rhofac = exp((T(-7) / T(10)) / (order - 1u)) / (exp(T(1)) * exp(T(1)));
+    const auto rhofac = order_ovr == 0u ? exp((T(-7) / T(10)) / (order - 1u)) / (exp(T(1)) * exp(T(1)))
+                                        : exp(taylor_vo_log_rhofac(tol, order));
 
     // Determine the step size in absolute value.
     auto h = builder.CreateFMul(rho_m, vector_splat(builder, codegen<T>(s, number{rhofac}), batch_size));
 
+    if (predict_h) {
+        // Step size prediction: the step size h_p estimated from the Taylor coefficients
+        // of the previous step is accepted if it does not exceed the step size h estimated
+        // from the current Taylor coefficients. The check is performed without logarithms
+        // and exponentials, as h_p <= h is equivalent to:
+        //
+        // max_abs_diff_o * (h_p / rhofac)**order <= num_rho and
+        // max_abs_diff_om1 * (h_p / rhofac)**(order - 1) <= num_rho.
+        //
+        // If h_p is accepted in all the batch elements, the evaluation of the Taylor
+        // polynomials below does not depend on h, whose computation can thus overlap
+        // with the update of the state. h is then stored as the prediction for the next step.
+        // NOTE: a prediction of zero (e.g., in the first step) is never accepted, and
+        // neither are the predictions compared to non-finite norms. In these
+        // cases, h is used.
+        auto *fp_vec_t = to_llvm_vector_type<T>(context, batch_size);
+        auto *pred_h_ptr = builder.CreateInBoundsGEP(to_llvm_type<T>(context), h_ptr, {builder.getInt32(batch_size)});
+        auto *h_p = load_vector_from_memory(builder, pred_h_ptr, batch_size);
+
+        // Compute x**n via repeated squaring.
+        auto vec_powi = [&](llvm::Value *x, std::uint32_t n) {
+            llvm::Value *ret = vector_splat(builder, codegen<T>(s, number{1.}), batch_size);
+            for (; n != 0u; n /= 2u) {
+                if (n % 2u == 1u) {
+                    ret = builder.CreateFMul(ret, x);
+                }
+                if (n > 1u) {
+                    x = builder.CreateFMul(x, x);
+                }
+            }
+            return ret;
+        };
+
+        auto *h_p_sc = builder.CreateFMul(h_p, vector_splat(builder, codegen<T>(s, number{T(1) / rhofac}), batch_size));
+        auto *h_p_sc_om1 = vec_powi(h_p_sc, order - 1u);
+
+        auto *ok = builder.CreateFCmpOGT(h_p, llvm::Constant::getNullValue(fp_vec_t));
+        ok = builder.CreateAnd(ok, builder.CreateFCmpOLE(builder.CreateFMul(max_abs_diff_om1, h_p_sc_om1), num_rho));
+        ok = builder.CreateAnd(
+            ok, builder.CreateFCmpOLE(builder.CreateFMul(max_abs_diff_o, builder.CreateFMul(h_p_sc_om1, h_p_sc)),
+                                      num_rho));
+
+        // Reduce the flags of the batch elements to a single flag.
+        auto flags = vector_to_scalars(builder, ok);
+        auto *all_ok = flags[0];
+        for (decltype(flags.size()) i = 1; i < flags.size(); ++i) {
+            all_ok = builder.CreateAnd(all_ok, flags[i]);
+        }
+
+        // Store h as the prediction for the next step.
+        store_vector_to_memory(builder, pred_h_ptr, h);
+
+        // NOTE: branch on the flag (instead of selecting between h_p and h), so that
+        // the step size does not depend on h when the prediction is accepted.
+        auto *h_var = builder.CreateAlloca(fp_vec_t);
+        builder.CreateStore(h_p, h_var);
+        llvm_if_then_else(
+            s, all_ok, []() {}, [&]() { builder.CreateStore(builder.CreateSelect(ok, h_p, h), h_var); });
+        h = builder.CreateLoad(fp_vec_t, h_var);
+    }
+
     // Ensure that the step size does not exceed the limit in absolute value.
     auto max_h_vec = load_vector_from_memory(builder, h_ptr, batch_size);
     h = taylor_step_minabs(s, h, max_h_vec);
@@ -3617,31 +9793,57 @@ auto taylor_add_adaptive_step_impl(llvm_state &s, const std::string &name, U sys
     // Evaluate the Taylor polynomials, producing the updated state of the system.
     auto new_state_var
         = high_accuracy
-              ? taylor_run_ceval<T>(s, diff_variant, h, n_eq, n_uvars, order, batch_size, high_accuracy, compact_mode)
-              : taylor_run_multihorner(s, diff_variant, h, n_eq, n_uvars, order, batch_size, compact_mode);
+              ? taylor_run_ceval<T>(s, diff_variant, h, n_eq, jl, order, batch_size, high_accuracy, compact_mode)
+              : taylor_run_multihorner(s, diff_variant, h, n_eq, jl, order, batch_size, compact_mode, estrin);
 
-    // Store the new state.
+    // Store the new state, checking at the same time
+    // if it contains only finite values.
     // NOTE: no need to perform overflow check on n_eq * batch_size,
     // as in taylor_compute_jet() we already checked.
+    llvm::Value *all_finite;
     if (compact_mode) {
         auto new_state = std::get<llvm::Value *>(new_state_var);
 
+        // NOTE: the finiteness flag is accumulated
+        // across the loop iterations in local storage.
+        auto *flag_t = make_vector_type(builder.getInt1Ty(), batch_size);
+        all_finite = builder.CreateAlloca(flag_t);
+        builder.CreateStore(llvm::Constant::getAllOnesValue(flag_t), all_finite);
+
         llvm_loop_u32(s, builder.getInt32(0), builder.getInt32(n_eq), [&](llvm::Value *cur_var_idx) {
             auto val = builder.CreateLoad(builder.CreateInBoundsGEP(new_state, {cur_var_idx}));
             store_vector_to_memory(
                 builder,
                 builder.CreateInBoundsGEP(state_ptr, builder.CreateMul(cur_var_idx, builder.getInt32(batch_size))),
                 val);
+            builder.CreateStore(builder.CreateAnd(builder.CreateLoad(all_finite), taylor_step_finite(s, val)),
+                                all_finite);
         });
+
+        all_finite = builder.CreateLoad(all_finite);
     } else {
         const auto &new_state = std::get<std::vector<llvm::Value *>>(new_state_var);
 
         assert(new_state.size() == n_eq);
 
+        all_finite = taylor_step_finite(s, new_state[0]);
         for (std::uint32_t var_idx = 0; var_idx < n_eq; ++var_idx) {
             store_vector_to_memory(builder,
                                    builder.CreateInBoundsGEP(state_ptr, builder.getInt32(var_idx * batch_size)),
                                    new_state[var_idx]);
+            if (var_idx > 0u) {
+                all_finite = builder.CreateAnd(all_finite, taylor_step_finite(s, new_state[var_idx]));
+            }
+        }
+    }
+
+    // In batch mode, reduce the finiteness flags of the batch
+    // elements to a single flag.
+    {
+        auto flags = vector_to_scalars(builder, all_finite);
+        all_finite = flags[0];
+        for (decltype(flags.size()) i = 1; i < flags.size(); ++i) {
+            all_finite = builder.CreateAnd(all_finite, flags[i]);
         }
     }
 
@@ -3655,6 +9857,9 @@ auto taylor_add_adaptive_step_impl(llvm_state &s, const std::string &name, U sys
         [&]() {
             // tc_ptr is not null: copy the Taylor coefficients
             // for the state variables.
+            // NOTE: in compact mode, if mem_hints is true, the Taylor coefficients
+            // are written via non-temporal stores, as they are not read back
+            // by the stepper.
             if (compact_mode) {
                 auto diff_arr = std::get<llvm::Value *>(diff_variant);
 
@@ -3663,55 +9868,354 @@ auto taylor_add_adaptive_step_impl(llvm_state &s, const std::string &name, U sys
                         s, builder.getInt32(0), builder.CreateAdd(builder.getInt32(order), builder.getInt32(1)),
                         [&](llvm::Value *cur_order) {
                             // Load the value of the derivative from diff_arr.
-                            auto diff_val = taylor_c_load_diff(s, diff_arr, n_uvars, cur_order, cur_var);
+                            auto diff_val = taylor_c_load_jet(s, diff_arr, jl, cur_order, cur_var);
+
+                            // Compute the index in the output pointer.
+                            auto out_idx = builder.CreateAdd(
+                                builder.CreateMul(builder.getInt32((order + 1u) * batch_size), cur_var),
+                                builder.CreateMul(cur_order, builder.getInt32(batch_size)));
+
+                            // Store into tc_ptr.
+                            store_vector_to_memory(builder, builder.CreateInBoundsGEP(tc_ptr, {out_idx}), diff_val,
+                                                   mem_hints);
+                        });
+                });
+
+                // Copy the Taylor coefficients for the extra functions,
+                // after the Taylor coefficients for the state variables.
+                // NOTE: the indices of the extra functions in the
+                // decomposition are known at compile time, thus
+                // we can unroll the loop over the extra functions.
+                for (std::uint32_t j = 0; j < n_sv_funcs; ++j) {
+                    llvm_loop_u32(
+                        s, builder.getInt32(0), builder.CreateAdd(builder.getInt32(order), builder.getInt32(1)),
+                        [&](llvm::Value *cur_order) {
+                            // Load the value of the derivative from diff_arr.
+                            auto diff_val
+                                = taylor_c_load_jet(s, diff_arr, jl, cur_order, builder.getInt32(sv_funcs_dc[j]));
+
+                            // Compute the index in the output pointer.
+                            auto out_idx
+                                = builder.CreateAdd(builder.getInt32((order + 1u) * batch_size * (n_eq + j)),
+                                                    builder.CreateMul(cur_order, builder.getInt32(batch_size)));
+
+                            // Store into tc_ptr.
+                            store_vector_to_memory(builder, builder.CreateInBoundsGEP(tc_ptr, {out_idx}), diff_val,
+                                                   mem_hints);
+                        });
+                }
+            } else {
+                const auto &diff_arr = std::get<std::vector<llvm::Value *>>(diff_variant);
+
+                for (std::uint32_t j = 0; j < n_eq; ++j) {
+                    for (decltype(diff_arr.size()) cur_order = 0; cur_order <= order; ++cur_order) {
+                        // Index in the jet of derivatives.
+                        // NOTE: in non-compact mode, diff_arr contains the derivatives only of the
+                        // state variables (not all u vars), hence the indexing is cur_order * n_eq + j.
+                        const auto arr_idx = cur_order * n_eq + j;
+                        assert(arr_idx < diff_arr.size());
+                        const auto val = diff_arr[arr_idx];
+
+                        // Index in tc_ptr.
+                        const auto out_idx = (order + 1u) * batch_size * j + cur_order * batch_size;
+
+                        // Write to tc_ptr.
+                        auto out_ptr = builder.CreateInBoundsGEP(
+                            tc_ptr, {builder.getInt32(static_cast<std::uint32_t>(out_idx))});
+                        store_vector_to_memory(builder, out_ptr, val);
+                    }
+                }
+
+                // Copy the Taylor coefficients for the extra functions,
+                // after the Taylor coefficients for the state variables.
+                // NOTE: in non-compact mode, the derivatives of the extra functions
+                // are stored in diff_arr after the derivatives of the state variables,
+                // hence the indexing is (order + 1) * n_eq + cur_order * n_sv_funcs + j.
+                for (std::uint32_t j = 0; j < n_sv_funcs; ++j) {
+                    for (std::uint32_t cur_order = 0; cur_order <= order; ++cur_order) {
+                        const auto arr_idx = (order + 1u) * n_eq + cur_order * n_sv_funcs + j;
+                        assert(arr_idx < diff_arr.size());
+                        const auto val = diff_arr[arr_idx];
+
+                        // Index in tc_ptr.
+                        const auto out_idx = (order + 1u) * batch_size * (n_eq + j) + cur_order * batch_size;
+
+                        // Write to tc_ptr.
+                        auto out_ptr = builder.CreateInBoundsGEP(tc_ptr, {builder.getInt32(out_idx)});
+                        store_vector_to_memory(builder, out_ptr, val);
+                    }
+                }
+            }
+        },
+        [&]() {
+            // Taylor coefficients were not requested,
+            // don't do anything in this branch.
+        });
+
+    // Return the finiteness flag.
+    builder.CreateRet(builder.CreateZExt(all_finite, builder.getInt32Ty()));
+
+    // Verify the function.
+    s.verify_function(f);
+
+    ta_ir.reset();
+
+    // Run the optimisation pass.
+    s.optimise();
+
+    return std::tuple{std::move(dc), order};
+}
+
+// Add to s a function running the loop of the propagate functions of the scalar adaptive
+// Taylor integrator: the function invokes repeatedly the stepper step_name (which must
+// be already in s), until the final time is reached, the maximum number of steps is reached
+// or the state becomes non-finite. The function takes as input:
+// - a pointer to the state vector (read & write),
+// - a pointer to the parameters (read only),
+// - a pointer to the time value (read & write),
+// - a pointer to an array of 6 values: the final time (read only),
+//   followed by the min/max absolute values of the timesteps and
+//   the last timestep (write only), as computed by propagate_until(),
+//   by the low-order part of the time (read & write, used only if
+//   comp_time is true, i.e., with the compensated summation of the time)
+//   and by the predicted timestep (read & write, used only if predict_h
+//   is true, i.e., with the step size prediction in the stepper),
+// - a pointer to an array of 3 counters: the maximum number of steps (read only, zero
+//   means no limit), followed by the number of iterations and the number of
+//   timesteps with nonzero size (write only).
+// - a pointer to the step callback (see step_callback, may be null) and its context pointer.
+// These pointers cannot overlap. The return value is 0 if the final time was reached,
+// 1 if the step limit was reached, 2 if a non-finite time or state was produced
+// and 3 if the propagation was stopped by the step callback.
+// NOTE: the time is accumulated in the same way as in the C++ loop, so that
+// the results are consistent with the step-by-step integration. For the same reason,
+// the fast math flags (including fp contraction) are turned off in the
+// implementation, as the stepper may be inlined.
+template <typename T>
+void taylor_add_propagate_kernel(llvm_state &s, const std::string &name, const std::string &step_name,
+                                 bool comp_time, bool predict_h)
+{
+    time_accumulator ta_ir(s.stats().ir_gen_time);
+
+    auto &builder = s.builder();
+    auto &context = s.context();
+    auto &md = s.module();
+
+    llvm::IRBuilderBase::FastMathFlagGuard fmf_guard(builder);
+    builder.setFastMathFlags(llvm::FastMathFlags{});
+
+    auto *step_f = md.getFunction(step_name);
+    assert(step_f != nullptr);
+
+    auto *fp_t = to_llvm_type<T>(context);
+    auto *fp_ptr_t = llvm::PointerType::getUnqual(fp_t);
+    auto *cnt_t = builder.getInt64Ty();
+
+    // Prepare the function prototype.
+    // NOTE: the step callback is passed as an i8 pointer (bool is
+    // returned as an 8-bit integer in the supported ABIs).
+    auto *cb_ft = llvm::FunctionType::get(builder.getInt8Ty(), {builder.getInt8PtrTy()}, false);
+    std::vector<llvm::Type *> fargs{fp_ptr_t,
+                                    fp_ptr_t,
+                                    fp_ptr_t,
+                                    fp_ptr_t,
+                                    llvm::PointerType::getUnqual(cnt_t),
+                                    builder.getInt8PtrTy(),
+                                    builder.getInt8PtrTy()};
+    auto *ft = llvm::FunctionType::get(builder.getInt32Ty(), fargs, false);
+    assert(ft != nullptr);
+    auto *f = llvm::Function::Create(ft, llvm::Function::ExternalLinkage, name, &md);
+    // LCOV_EXCL_START
+    if (f == nullptr) {
+        throw std::invalid_argument("Unable to create the propagate kernel of an adaptive Taylor integrator");
+    }
+    // LCOV_EXCL_STOP
+
+    // Set the names/attributes of the function arguments.
+    auto *state_ptr = f->args().begin();
+    state_ptr->setName("state_ptr");
+    state_ptr->addAttr(llvm::Attribute::NoCapture);
+    state_ptr->addAttr(llvm::Attribute::NoAlias);
+
+    auto *par_ptr = state_ptr + 1;
+    par_ptr->setName("par_ptr");
+    par_ptr->addAttr(llvm::Attribute::NoCapture);
+    par_ptr->addAttr(llvm::Attribute::NoAlias);
+    par_ptr->addAttr(llvm::Attribute::ReadOnly);
+
+    auto *time_ptr = par_ptr + 1;
+    time_ptr->setName("time_ptr");
+    time_ptr->addAttr(llvm::Attribute::NoCapture);
+    time_ptr->addAttr(llvm::Attribute::NoAlias);
+
+    auto *h_ptr = time_ptr + 1;
+    h_ptr->setName("h_ptr");
+    h_ptr->addAttr(llvm::Attribute::NoCapture);
+    h_ptr->addAttr(llvm::Attribute::NoAlias);
 
-                            // Compute the index in the output pointer.
-                            auto out_idx = builder.CreateAdd(
-                                builder.CreateMul(builder.getInt32((order + 1u) * batch_size), cur_var),
-                                builder.CreateMul(cur_order, builder.getInt32(batch_size)));
+    auto *cnt_ptr = h_ptr + 1;
+    cnt_ptr->setName("cnt_ptr");
+    cnt_ptr->addAttr(llvm::Attribute::NoCapture);
+    cnt_ptr->addAttr(llvm::Attribute::NoAlias);
+
+    auto *cb_ptr = cnt_ptr + 1;
+    cb_ptr->setName("cb_ptr");
+
+    auto *cb_ctx = cb_ptr + 1;
+    cb_ctx->setName("cb_ctx");
+
+    // Create the blocks.
+    auto *entry_bb = llvm::BasicBlock::Create(context, "entry", f);
+    auto *loop_bb = llvm::BasicBlock::Create(context, "loop", f);
+    auto *cont_bb = llvm::BasicBlock::Create(context, "cont", f);
+    auto *upd_bb = llvm::BasicBlock::Create(context, "upd", f);
+    auto *cb_bb = llvm::BasicBlock::Create(context, "cb", f);
+    auto *cb_call_bb = llvm::BasicBlock::Create(context, "cb_call", f);
+    auto *chk_bb = llvm::BasicBlock::Create(context, "chk", f);
+    auto *lim_bb = llvm::BasicBlock::Create(context, "lim", f);
+    auto *exit_bb = llvm::BasicBlock::Create(context, "exit", f);
+
+    builder.SetInsertPoint(entry_bb);
+
+    // Load the inputs and init the local variables.
+    auto *t_final = builder.CreateLoad(fp_t, h_ptr);
+    auto *max_steps = builder.CreateLoad(cnt_t, cnt_ptr);
+
+    auto *t_var = builder.CreateAlloca(fp_t);
+    auto *t_lo_var = builder.CreateAlloca(fp_t);
+    // NOTE: the timestep is followed by the predicted
+    // timestep, as required by the stepper.
+    auto *h_var = builder.CreateAlloca(fp_t, builder.getInt32(2));
+    auto *pred_h_var = builder.CreateInBoundsGEP(fp_t, h_var, {builder.getInt32(1)});
+    auto *min_h_var = builder.CreateAlloca(fp_t);
+    auto *max_h_var = builder.CreateAlloca(fp_t);
+    auto *iter_var = builder.CreateAlloca(cnt_t);
+    auto *step_var = builder.CreateAlloca(cnt_t);
+    auto *ret_var = builder.CreateAlloca(builder.getInt32Ty());
+
+    builder.CreateStore(builder.CreateLoad(fp_t, time_ptr), t_var);
+    if (comp_time) {
+        builder.CreateStore(builder.CreateLoad(fp_t, builder.CreateInBoundsGEP(fp_t, h_ptr, {builder.getInt32(4)})),
+                            t_lo_var);
+    } else {
+        builder.CreateStore(llvm::Constant::getNullValue(fp_t), t_lo_var);
+    }
+    builder.CreateStore(llvm::Constant::getNullValue(fp_t), h_var);
+    if (predict_h) {
+        builder.CreateStore(builder.CreateLoad(fp_t, builder.CreateInBoundsGEP(fp_t, h_ptr, {builder.getInt32(5)})),
+                            pred_h_var);
+    } else {
+        builder.CreateStore(llvm::Constant::getNullValue(fp_t), pred_h_var);
+    }
+    builder.CreateStore(llvm::ConstantFP::getInfinity(fp_t), min_h_var);
+    builder.CreateStore(llvm::Constant::getNullValue(fp_t), max_h_var);
+    builder.CreateStore(builder.getInt64(0), iter_var);
+    builder.CreateStore(builder.getInt64(0), step_var);
 
-                            // Store into tc_ptr.
-                            store_vector_to_memory(builder, builder.CreateInBoundsGEP(tc_ptr, {out_idx}), diff_val);
-                        });
-                });
-            } else {
-                const auto &diff_arr = std::get<std::vector<llvm::Value *>>(diff_variant);
+    builder.CreateBr(loop_bb);
 
-                for (std::uint32_t j = 0; j < n_eq; ++j) {
-                    for (decltype(diff_arr.size()) cur_order = 0; cur_order <= order; ++cur_order) {
-                        // Index in the jet of derivatives.
-                        // NOTE: in non-compact mode, diff_arr contains the derivatives only of the
-                        // state variables (not all u vars), hence the indexing is cur_order * n_eq + j.
-                        const auto arr_idx = cur_order * n_eq + j;
-                        assert(arr_idx < diff_arr.size());
-                        const auto val = diff_arr[arr_idx];
+    // The loop body: take a step up to the final time.
+    builder.SetInsertPoint(loop_bb);
 
-                        // Index in tc_ptr.
-                        const auto out_idx = (order + 1u) * batch_size * j + cur_order * batch_size;
+    auto *max_delta_t = builder.CreateFSub(t_final, builder.CreateLoad(fp_t, t_var));
+    if (comp_time) {
+        max_delta_t = builder.CreateFSub(max_delta_t, builder.CreateLoad(fp_t, t_lo_var));
+    }
+    builder.CreateStore(max_delta_t, h_var);
+
+    // NOTE: the stepper reads the time via time_ptr, which
+    // is thus kept up to date at each iteration.
+    auto *sv_finite = builder.CreateCall(
+        step_f, {state_ptr, par_ptr, time_ptr, h_var, llvm::ConstantPointerNull::get(fp_ptr_t)});
+
+    auto *h = builder.CreateLoad(fp_t, h_var);
+    llvm::Value *new_t = nullptr;
+    if (comp_time) {
+        auto [hi, lo] = llvm_dl_add(s, builder.CreateLoad(fp_t, t_var), builder.CreateLoad(fp_t, t_lo_var), h,
+                                    llvm::Constant::getNullValue(fp_t));
+        new_t = hi;
+        builder.CreateStore(lo, t_lo_var);
+    } else {
+        new_t = builder.CreateFAdd(builder.CreateLoad(fp_t, t_var), h);
+    }
+    builder.CreateStore(new_t, t_var);
+    builder.CreateStore(new_t, time_ptr);
+
+    // Exit if the time or the state are non-finite.
+    builder.CreateStore(builder.getInt32(2), ret_var);
+    builder.CreateCondBr(
+        builder.CreateAnd(taylor_step_finite(s, new_t), builder.CreateICmpNE(sv_finite, builder.getInt32(0))), cont_bb,
+        exit_bb);
+
+    builder.SetInsertPoint(cont_bb);
+
+    // Update the counters.
+    auto *iter = builder.CreateAdd(builder.CreateLoad(cnt_t, iter_var), builder.getInt64(1));
+    builder.CreateStore(iter, iter_var);
+    builder.CreateStore(
+        builder.CreateAdd(builder.CreateLoad(cnt_t, step_var),
+                          builder.CreateZExt(builder.CreateFCmpUNE(h, llvm::Constant::getNullValue(fp_t)), cnt_t)),
+        step_var);
+
+    // NOTE: the min/max timesteps are not updated if the final time was reached.
+    auto *final_step = builder.CreateFCmpOEQ(h, max_delta_t);
+    builder.CreateCondBr(final_step, cb_bb, upd_bb);
+
+    builder.SetInsertPoint(upd_bb);
+
+    // Update the min/max timesteps.
+    auto *abs_h = taylor_step_abs(s, h);
+    auto *min_h = builder.CreateLoad(fp_t, min_h_var);
+    auto *max_h = builder.CreateLoad(fp_t, max_h_var);
+    builder.CreateStore(builder.CreateSelect(builder.CreateFCmpOLT(abs_h, min_h), abs_h, min_h), min_h_var);
+    builder.CreateStore(builder.CreateSelect(builder.CreateFCmpOGT(abs_h, max_h), abs_h, max_h), max_h_var);
+    builder.CreateBr(cb_bb);
+
+    // Invoke the step callback, if present.
+    builder.SetInsertPoint(cb_bb);
+    builder.CreateCondBr(builder.CreateIsNull(cb_ptr), chk_bb, cb_call_bb);
+
+    builder.SetInsertPoint(cb_call_bb);
+    auto *cb_ret
+        = builder.CreateCall(cb_ft, builder.CreateBitCast(cb_ptr, llvm::PointerType::getUnqual(cb_ft)), {cb_ctx});
+    builder.CreateStore(builder.getInt32(3), ret_var);
+    builder.CreateCondBr(builder.CreateICmpEQ(cb_ret, builder.getInt8(0)), exit_bb, chk_bb);
+
+    // Exit if the final time was reached.
+    builder.SetInsertPoint(chk_bb);
+    builder.CreateStore(builder.getInt32(0), ret_var);
+    builder.CreateCondBr(final_step, exit_bb, lim_bb);
+
+    // Check the iteration limit.
+    builder.SetInsertPoint(lim_bb);
+    builder.CreateStore(builder.getInt32(1), ret_var);
+    builder.CreateCondBr(
+        builder.CreateAnd(builder.CreateICmpNE(max_steps, builder.getInt64(0)), builder.CreateICmpEQ(iter, max_steps)),
+        exit_bb, loop_bb);
+
+    // Write the outputs and return.
+    builder.SetInsertPoint(exit_bb);
+
+    auto store_out = [&](llvm::Type *t, llvm::Value *var, llvm::Value *ptr, std::uint32_t idx) {
+        builder.CreateStore(builder.CreateLoad(t, var), builder.CreateInBoundsGEP(t, ptr, {builder.getInt32(idx)}));
+    };
 
-                        // Write to tc_ptr.
-                        auto out_ptr = builder.CreateInBoundsGEP(
-                            tc_ptr, {builder.getInt32(static_cast<std::uint32_t>(out_idx))});
-                        store_vector_to_memory(builder, out_ptr, val);
-                    }
-                }
-            }
-        },
-        [&]() {
-            // Taylor coefficients were not requested,
-            // don't do anything in this branch.
-        });
+    store_out(fp_t, min_h_var, h_ptr, 1);
+    store_out(fp_t, max_h_var, h_ptr, 2);
+    store_out(fp_t, h_var, h_ptr, 3);
+    store_out(cnt_t, iter_var, cnt_ptr, 1);
+    store_out(cnt_t, step_var, cnt_ptr, 2);
+    if (comp_time) {
+        store_out(fp_t, t_lo_var, h_ptr, 4);
+    }
+    if (predict_h) {
+        store_out(fp_t, pred_h_var, h_ptr, 5);
+    }
 
-    // Create the return value.
-    builder.CreateRetVoid();
+    builder.CreateRet(builder.CreateLoad(builder.getInt32Ty(), ret_var));
 
     // Verify the function.
     s.verify_function(f);
-
-    // Run the optimisation pass.
-    s.optimise();
-
-    return std::tuple{std::move(dc), order};
 }
 
 } // namespace
@@ -3723,7 +10227,7 @@ taylor_add_adaptive_step_dbl(llvm_state &s, const std::string &name, std::vector
                              std::uint32_t batch_size, bool high_accuracy, bool compact_mode)
 {
     return detail::taylor_add_adaptive_step_impl<double>(s, name, std::move(sys), tol, batch_size, high_accuracy,
-                                                         compact_mode);
+                                                         compact_mode, {});
 }
 
 std::tuple<std::vector<std::pair<expression, std::vector<std::uint32_t>>>, std::uint32_t>
@@ -3731,7 +10235,7 @@ taylor_add_adaptive_step_ldbl(llvm_state &s, const std::string &name, std::vecto
                               std::uint32_t batch_size, bool high_accuracy, bool compact_mode)
 {
     return detail::taylor_add_adaptive_step_impl<long double>(s, name, std::move(sys), tol, batch_size, high_accuracy,
-                                                              compact_mode);
+                                                              compact_mode, {});
 }
 
 #if defined(HEYOKA_HAVE_REAL128)
@@ -3741,7 +10245,7 @@ taylor_add_adaptive_step_f128(llvm_state &s, const std::string &name, std::vecto
                               std::uint32_t batch_size, bool high_accuracy, bool compact_mode)
 {
     return detail::taylor_add_adaptive_step_impl<mppp::real128>(s, name, std::move(sys), tol, batch_size, high_accuracy,
-                                                                compact_mode);
+                                                                compact_mode, {});
 }
 
 #endif
@@ -3751,7 +10255,7 @@ taylor_add_adaptive_step_dbl(llvm_state &s, const std::string &name, std::vector
                              double tol, std::uint32_t batch_size, bool high_accuracy, bool compact_mode)
 {
     return detail::taylor_add_adaptive_step_impl<double>(s, name, std::move(sys), tol, batch_size, high_accuracy,
-                                                         compact_mode);
+                                                         compact_mode, {});
 }
 
 std::tuple<std::vector<std::pair<expression, std::vector<std::uint32_t>>>, std::uint32_t>
@@ -3760,7 +10264,7 @@ taylor_add_adaptive_step_ldbl(llvm_state &s, const std::string &name,
                               std::uint32_t batch_size, bool high_accuracy, bool compact_mode)
 {
     return detail::taylor_add_adaptive_step_impl<long double>(s, name, std::move(sys), tol, batch_size, high_accuracy,
-                                                              compact_mode);
+                                                              compact_mode, {});
 }
 
 #if defined(HEYOKA_HAVE_REAL128)
@@ -3771,7 +10275,7 @@ taylor_add_adaptive_step_f128(llvm_state &s, const std::string &name,
                               std::uint32_t batch_size, bool high_accuracy, bool compact_mode)
 {
     return detail::taylor_add_adaptive_step_impl<mppp::real128>(s, name, std::move(sys), tol, batch_size, high_accuracy,
-                                                                compact_mode);
+                                                                compact_mode, {});
 }
 
 #endif
@@ -3854,23 +10358,6 @@ auto taylor_add_state_updater_impl(llvm_state &s, const std::string &name, std::
     // run from the main function below.
 }
 
-// RAII helper to temporarily set the opt level to 0 in an llvm_state.
-struct opt_disabler {
-    llvm_state &m_s;
-    unsigned m_orig_opt_level;
-
-    explicit opt_disabler(llvm_state &s) : m_s(s), m_orig_opt_level(s.opt_level())
-    {
-        // Disable optimisations.
-        m_s.opt_level() = 0;
-    }
-    ~opt_disabler()
-    {
-        // Restore the original optimisation level.
-        m_s.opt_level() = m_orig_opt_level;
-    }
-};
-
 template <typename T, typename U>
 auto taylor_add_custom_step_impl(llvm_state &s, const std::string &name, U sys, std::uint32_t order,
                                  std::uint32_t batch_size, bool high_accuracy, bool compact_mode)
@@ -3959,6 +10446,74 @@ taylor_add_custom_step_f128(llvm_state &s, const std::string &name, std::vector<
 
 #endif
 
+std::vector<std::map<std::string, std::uint32_t>>
+taylor_segment_stats(const std::vector<std::pair<expression, std::vector<std::uint32_t>>> &dc, std::uint32_t n_eq)
+{
+    if (dc.size() < n_eq * 2u) {
+        throw std::invalid_argument("Invalid Taylor decomposition passed to taylor_segment_stats(): the decomposition "
+                                    "has "
+                                    + std::to_string(dc.size()) + " elements, but for a system of "
+                                    + std::to_string(n_eq) + " equations at least " + std::to_string(n_eq * 2u)
+                                    + " are needed");
+    }
+
+    // Helper to build the name of the kind of operation
+    // of the definition ex (e.g., "mul_var_num").
+    auto op_name = [](const expression &ex) {
+        std::string retval;
+        const expression *b = nullptr, *e = nullptr;
+
+        if (const auto *bptr = std::get_if<binary_operator>(&ex.value())) {
+            switch (bptr->op()) {
+                case binary_operator::type::add:
+                    retval = "add";
+                    break;
+                case binary_operator::type::sub:
+                    retval = "sub";
+                    break;
+                case binary_operator::type::mul:
+                    retval = "mul";
+                    break;
+                default:
+                    retval = "div";
+            }
+
+            b = bptr->args().data();
+            e = b + 2;
+        } else {
+            const auto &f = std::get<func>(ex.value());
+
+            retval = f.get_name();
+            b = f.args().data();
+            e = b + f.args().size();
+        }
+
+        for (; b != e; ++b) {
+            if (std::holds_alternative<variable>(b->value())) {
+                retval += "_var";
+            } else if (std::holds_alternative<number>(b->value())) {
+                retval += "_num";
+            } else {
+                retval += "_par";
+            }
+        }
+
+        return retval;
+    };
+
+    std::vector<std::map<std::string, std::uint32_t>> retval;
+
+    for (const auto &seg : detail::taylor_segment_dc(dc, n_eq)) {
+        auto &m = retval.emplace_back();
+
+        for (auto idx : seg) {
+            ++m[op_name(dc[idx].first)];
+        }
+    }
+
+    return retval;
+}
+
 namespace detail
 {
 
@@ -3975,23 +10530,27 @@ std::ostream &taylor_adaptive_stream_impl(std::ostream &os, const taylor_adaptiv
     oss << std::showpoint;
     oss.precision(std::numeric_limits<T>::max_digits10);
 
+    const std::size_t state_size = ta.get_dim();
+
     oss << "Taylor order: " << ta.get_order() << '\n';
     oss << "Dimension   : " << ta.get_dim() << '\n';
     oss << "Time        : " << ta.get_time() << '\n';
+    // NOTE: access the state and the pars via the data
+    // pointers, which account for the external buffers.
     oss << "State       : [";
-    for (decltype(ta.get_state().size()) i = 0; i < ta.get_state().size(); ++i) {
-        oss << ta.get_state()[i];
-        if (i != ta.get_state().size() - 1u) {
+    for (std::size_t i = 0; i < state_size; ++i) {
+        oss << ta.get_state_data()[i];
+        if (i != state_size - 1u) {
             oss << ", ";
         }
     }
     oss << "]\n";
 
-    if (!ta.get_pars().empty()) {
+    if (ta.get_pars_size() != 0u) {
         oss << "Parameters  : [";
-        for (decltype(ta.get_pars().size()) i = 0; i < ta.get_pars().size(); ++i) {
-            oss << ta.get_pars()[i];
-            if (i != ta.get_pars().size() - 1u) {
+        for (decltype(ta.get_pars_size()) i = 0; i < ta.get_pars_size(); ++i) {
+            oss << ta.get_pars_data()[i];
+            if (i != ta.get_pars_size() - 1u) {
                 oss << ", ";
             }
         }
@@ -4011,6 +10570,8 @@ std::ostream &taylor_adaptive_batch_stream_impl(std::ostream &os, const taylor_a
     oss << std::showpoint;
     oss.precision(std::numeric_limits<T>::max_digits10);
 
+    const auto state_size = static_cast<std::size_t>(ta.get_dim()) * ta.get_batch_size();
+
     oss << "Taylor order: " << ta.get_order() << '\n';
     oss << "Dimension   : " << ta.get_dim() << '\n';
     oss << "Batch size  : " << ta.get_batch_size() << '\n';
@@ -4022,20 +10583,22 @@ std::ostream &taylor_adaptive_batch_stream_impl(std::ostream &os, const taylor_a
         }
     }
     oss << "]\n";
+    // NOTE: access the state and the pars via the data
+    // pointers, which account for the external buffers.
     oss << "State       : [";
-    for (decltype(ta.get_state().size()) i = 0; i < ta.get_state().size(); ++i) {
-        oss << ta.get_state()[i];
-        if (i != ta.get_state().size() - 1u) {
+    for (std::size_t i = 0; i < state_size; ++i) {
+        oss << ta.get_state_data()[i];
+        if (i != state_size - 1u) {
             oss << ", ";
         }
     }
     oss << "]\n";
 
-    if (!ta.get_pars().empty()) {
+    if (ta.get_pars_size() != 0u) {
         oss << "Parameters  : [";
-        for (decltype(ta.get_pars().size()) i = 0; i < ta.get_pars().size(); ++i) {
-            oss << ta.get_pars()[i];
-            if (i != ta.get_pars().size() - 1u) {
+        for (decltype(ta.get_pars_size()) i = 0; i < ta.get_pars_size(); ++i) {
+            oss << ta.get_pars_data()[i];
+            if (i != ta.get_pars_size() - 1u) {
                 oss << ", ";
             }
         }
@@ -4108,6 +10671,385 @@ std::ostream &operator<<(std::ostream &os, taylor_outcome oc)
         case taylor_outcome::err_nf_state:
             os << "err_nf_state";
             break;
+        case taylor_outcome::terminal_event:
+            os << "terminal_event";
+            break;
+        case taylor_outcome::cb_stop:
+            os << "cb_stop";
+            break;
+        case taylor_outcome::stiff:
+            os << "stiff";
+            break;
+    }
+
+    return os;
+}
+
+std::size_t taylor_memory_usage::total() const
+{
+    return llvm.total() + decomposition + tc + buffers;
+}
+
+std::ostream &operator<<(std::ostream &os, const taylor_memory_usage &mu)
+{
+    std::ostringstream oss;
+
+    oss << "LLVM state   : " << mu.llvm.total() << '\n';
+    oss << "Decomposition: " << mu.decomposition << '\n';
+    oss << "Taylor coeffs: " << mu.tc << '\n';
+    oss << "Buffers      : " << mu.buffers << '\n';
+    oss << "Total        : " << mu.total() << '\n';
+
+    return os << oss.str();
+}
+
+std::ostream &operator<<(std::ostream &os, const taylor_batch_tuning &bt)
+{
+    std::ostringstream oss;
+
+    for (decltype(bt.batch_sizes.size()) i = 0; i < bt.batch_sizes.size(); ++i) {
+        oss << "Batch size " << bt.batch_sizes[i] << ": " << bt.throughputs[i] << " steps/s\n";
+    }
+    oss << "Recommended batch size: " << bt.batch_size << '\n';
+
+    return os << oss.str();
+}
+
+std::ostream &operator<<(std::ostream &os, const taylor_order_tuning &ot)
+{
+    std::ostringstream oss;
+
+    for (decltype(ot.orders.size()) i = 0; i < ot.orders.size(); ++i) {
+        oss << "Order " << ot.orders[i] << ": " << ot.steps_per_time[i] << " steps/time unit, " << ot.step_costs[i]
+            << " s/step\n";
+    }
+    oss << "Recommended order: " << ot.order << '\n';
+
+    return os << oss.str();
+}
+
+namespace detail
+{
+
+// The orders tried in taylor_tune_order() by default: the orders from o - 8
+// to o + 8 in steps of 2 (and not lower than 2), where o is the order
+// deduced from the tolerance tol.
+std::vector<std::uint32_t> taylor_order_tuning_candidates(double tol)
+{
+    if (!std::isfinite(tol) || tol <= 0) {
+        throw std::invalid_argument(
+            "The tolerance in the selection of the order must be finite and positive, but it is "
+            + li_to_string(tol) + " instead");
+    }
+
+    const auto o = static_cast<std::int64_t>(std::max(2., std::ceil(-std::log(tol) / 2 + 1)));
+
+    std::vector<std::uint32_t> retval;
+    for (auto k = o - 8; k <= o + 8; k += 2) {
+        if (k >= 2) {
+            retval.push_back(boost::numeric_cast<std::uint32_t>(k));
+        }
+    }
+
+    return retval;
+}
+
+// Select the recommended order from the measurements, i.e., the order
+// minimising the wall-clock time per unit of integration time.
+std::uint32_t taylor_order_tuning_select(const taylor_order_tuning &ot)
+{
+    assert(ot.orders.size() == ot.steps_per_time.size());
+    assert(ot.orders.size() == ot.step_costs.size());
+
+    if (ot.orders.empty()) {
+        throw std::invalid_argument("At least one order must be tried in the selection of the order");
+    }
+
+    auto best_idx = 0u;
+    auto best_cost = std::numeric_limits<double>::infinity();
+
+    for (decltype(ot.orders.size()) i = 0; i < ot.orders.size(); ++i) {
+        // NOTE: the non-finite costs (e.g., if all the steps
+        // failed) are never selected, unless all costs are non-finite.
+        const auto cost = ot.steps_per_time[i] * ot.step_costs[i];
+        if (std::isfinite(cost) && cost < best_cost) {
+            best_cost = cost;
+            best_idx = static_cast<unsigned>(i);
+        }
+    }
+
+    return ot.orders[best_idx];
+}
+
+// The batch sizes tried in taylor_tune_batch_size(): the powers
+// of two up to max_batch_size, plus max_batch_size itself.
+std::vector<std::uint32_t> taylor_batch_tuning_candidates(std::uint32_t max_batch_size)
+{
+    if (max_batch_size == 0u) {
+        throw std::invalid_argument("The maximum batch size in the selection of the batch size cannot be zero");
+    }
+
+    std::vector<std::uint32_t> retval;
+    for (std::uint32_t b = 1; b <= max_batch_size; b *= 2u) {
+        retval.push_back(b);
+
+        if (b > std::numeric_limits<std::uint32_t>::max() / 2u) {
+            break;
+        }
+    }
+
+    if (retval.back() != max_batch_size) {
+        retval.push_back(max_batch_size);
+    }
+
+    return retval;
+}
+
+// Select the recommended batch size from the measured throughputs.
+// NOTE: the smallest batch size whose throughput is within 5% of the
+// best throughput is selected, as smaller batches are cheaper to
+// compile and to fill, and the measurements are noisy.
+std::uint32_t taylor_batch_tuning_select(const std::vector<std::uint32_t> &batch_sizes,
+                                         const std::vector<double> &throughputs)
+{
+    assert(batch_sizes.size() == throughputs.size());
+    assert(!batch_sizes.empty());
+
+    const auto best = *std::max_element(throughputs.begin(), throughputs.end());
+
+    for (decltype(batch_sizes.size()) i = 0; i < batch_sizes.size(); ++i) {
+        if (throughputs[i] >= .95 * best) {
+            return batch_sizes[i];
+        }
+    }
+
+    // NOTE: this can be reached only if the throughputs contain NaNs.
+    return batch_sizes[0];
+}
+
+// Threshold on the estimated number of operations in the default-mode
+// computation of the Taylor derivatives above which the compact
+// mode is selected by taylor_select_compact_mode().
+constexpr std::uint64_t taylor_auto_cm_threshold = 200000;
+
+namespace
+{
+
+// Number of unique subexpressions (i.e., binary operators and functions) in exs,
+// which approximates the number of u variables in the Taylor decomposition.
+std::uint64_t taylor_n_unique_nodes(const std::vector<expression> &exs)
+{
+    std::unordered_set<const void *> visited;
+    std::vector<const expression *> stack;
+
+    for (const auto &ex : exs) {
+        stack.push_back(&ex);
+
+        while (!stack.empty()) {
+            const auto cur = stack.back();
+            stack.pop_back();
+
+            if (const auto key = node_key(*cur); key == nullptr || !visited.insert(key).second) {
+                continue;
+            }
+
+            const auto [b, e] = node_args(*cur);
+            for (auto it = b; it != e; ++it) {
+                stack.push_back(it);
+            }
+        }
+    }
+
+    return static_cast<std::uint64_t>(visited.size());
+}
+
+std::vector<expression> taylor_sys_rhs(const std::vector<expression> &sys)
+{
+    return sys;
+}
+
+std::vector<expression> taylor_sys_rhs(const std::vector<std::pair<expression, expression>> &sys)
+{
+    std::vector<expression> retval;
+    for (const auto &p : sys) {
+        retval.push_back(p.second);
+    }
+
+    return retval;
+}
+
+} // namespace
+
+// NOTE: the computation of the derivative of order n of a u variable
+// requires O(n) operations for most u variables (e.g., multiplications,
+// divisions and elementary functions), hence the computation of the
+// Taylor derivatives requires O(n_uvars * order**2) operations, and the
+// IR in default mode grows accordingly (whereas in compact mode the IR
+// is roughly independent of the order and of the number of u variables
+// sharing the same function).
+template <typename T, typename U>
+bool taylor_select_compact_mode(llvm_state &s, const U &sys, T tol, T rtol, T atol,
+                                const std::vector<std::uint32_t> &orders)
+{
+    using std::ceil;
+    using std::isfinite;
+    using std::log;
+
+    // Determine the Taylor order as in taylor_add_adaptive_step_impl().
+    if (rtol != 0 || atol != 0) {
+        tol = rtol == 0 ? atol : std::min(atol, rtol);
+    }
+
+    std::uint64_t order = 0;
+    if (!orders.empty()) {
+        order = orders.back();
+    } else if (isfinite(tol) && tol > 0) {
+        const auto order_f = std::max(T(2), ceil(-log(tol) / 2 + 1));
+
+        order = order_f < static_cast<T>(std::numeric_limits<std::uint32_t>::max())
+                    ? static_cast<std::uint64_t>(order_f)
+                    : std::numeric_limits<std::uint32_t>::max();
+    }
+    // NOTE: otherwise, the invalid tolerance will be
+    // reported by the construction of the integrator.
+
+    // NOTE: in a precomputed decomposition, the u variables
+    // (besides the state variables and the right-hand sides) are
+    // the unique subexpressions.
+    const auto n_nodes = [&sys]() -> std::uint64_t {
+        if constexpr (std::is_same_v<U, taylor_dc_t>) {
+            return sys.size() - 2u * taylor_n_eq(sys);
+        } else {
+            return taylor_n_unique_nodes(taylor_sys_rhs(sys));
+        }
+    }();
+
+    // NOTE: the estimate is kept nonzero, as a zero estimate
+    // signals that no automatic selection took place.
+    const auto est = std::max(std::uint64_t(1), n_nodes * ((order + 1u) * (order + 2u) / 2u));
+    const auto retval = est > taylor_auto_cm_threshold;
+
+    auto &st = s.stats();
+    st.cm_estimate = est;
+    st.cm_threshold = taylor_auto_cm_threshold;
+    st.cm_selected = retval;
+
+    return retval;
+}
+
+// Explicit instantiations.
+template HEYOKA_DLL_PUBLIC bool taylor_select_compact_mode(llvm_state &, const std::vector<expression> &, double,
+                                                           double, double, const std::vector<std::uint32_t> &);
+template HEYOKA_DLL_PUBLIC bool taylor_select_compact_mode(llvm_state &,
+                                                           const std::vector<std::pair<expression, expression>> &,
+                                                           double, double, double, const std::vector<std::uint32_t> &);
+template HEYOKA_DLL_PUBLIC bool taylor_select_compact_mode(llvm_state &, const taylor_dc_t &, double, double,
+                                                           double, const std::vector<std::uint32_t> &);
+
+template HEYOKA_DLL_PUBLIC bool taylor_select_compact_mode(llvm_state &, const std::vector<expression> &,
+                                                           long double, long double, long double,
+                                                           const std::vector<std::uint32_t> &);
+template HEYOKA_DLL_PUBLIC bool taylor_select_compact_mode(llvm_state &,
+                                                           const std::vector<std::pair<expression, expression>> &,
+                                                           long double, long double, long double,
+                                                           const std::vector<std::uint32_t> &);
+template HEYOKA_DLL_PUBLIC bool taylor_select_compact_mode(llvm_state &, const taylor_dc_t &,
+                                                           long double, long double, long double,
+                                                           const std::vector<std::uint32_t> &);
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+template HEYOKA_DLL_PUBLIC bool taylor_select_compact_mode(llvm_state &, const std::vector<expression> &,
+                                                           mppp::real128, mppp::real128, mppp::real128,
+                                                           const std::vector<std::uint32_t> &);
+template HEYOKA_DLL_PUBLIC bool taylor_select_compact_mode(llvm_state &,
+                                                           const std::vector<std::pair<expression, expression>> &,
+                                                           mppp::real128, mppp::real128, mppp::real128,
+                                                           const std::vector<std::uint32_t> &);
+template HEYOKA_DLL_PUBLIC bool taylor_select_compact_mode(llvm_state &, const taylor_dc_t &,
+                                                           mppp::real128, mppp::real128, mppp::real128,
+                                                           const std::vector<std::uint32_t> &);
+
+#endif
+
+} // namespace detail
+
+std::ostream &operator<<(std::ostream &os, const taylor_stats &st)
+{
+    os << "Number of steps             : " << st.n_steps << '\n';
+    os << "Time-limited steps          : " << st.n_time_limited << '\n';
+    os << "Terminal events             : " << st.n_terminal_events << '\n';
+    os << "Non-finite states           : " << st.n_errors << '\n';
+    os << "Zero timesteps              : " << st.n_zero_h << '\n';
+    os << "Stiff steps                 : " << st.n_stiff << '\n';
+    os << "Max stiffness ratio         : " << st.max_stiffness_ratio << '\n';
+    os << "Total step time             : " << st.step_time << "s\n";
+    if (st.n_steps > 0u) {
+        os << "Min/mean/max step time      : " << st.min_step_time << "s, "
+           << st.step_time / static_cast<double>(st.n_steps) << "s, " << st.max_step_time << "s\n";
+    }
+    for (decltype(st.lane_n_active.size()) i = 0; i < st.lane_n_active.size(); ++i) {
+        os << "Utilisation of lane " << i << "       : "
+           << (st.n_steps == 0u ? 0. : static_cast<double>(st.lane_n_active[i]) / static_cast<double>(st.n_steps))
+           << '\n';
+    }
+    os << "Timestep histogram:\n";
+    for (const auto &[e, n] : st.h_hist) {
+        os << "  [2**" << e << ", 2**" << (e + 1) << "): " << n << '\n';
+    }
+
+    return os;
+}
+
+std::ostream &operator<<(std::ostream &os, event_direction dir)
+{
+    switch (dir) {
+        case event_direction::any:
+            os << "any";
+            break;
+        case event_direction::positive:
+            os << "positive";
+            break;
+        case event_direction::negative:
+            os << "negative";
+            break;
+        default:
+            os << "invalid";
+    }
+
+    return os;
+}
+
+std::ostream &operator<<(std::ostream &os, taylor_sort_strategy ss)
+{
+    switch (ss) {
+        case taylor_sort_strategy::bfs:
+            os << "bfs";
+            break;
+        case taylor_sort_strategy::dfs:
+            os << "dfs";
+            break;
+        case taylor_sort_strategy::live_range:
+            os << "live_range";
+            break;
+        default:
+            os << "invalid";
+    }
+
+    return os;
+}
+
+std::ostream &operator<<(std::ostream &os, taylor_jet_layout jl)
+{
+    switch (jl) {
+        case taylor_jet_layout::order_major:
+            os << "order_major";
+            break;
+        case taylor_jet_layout::var_major:
+            os << "var_major";
+            break;
+        default:
+            os << "invalid";
     }
 
     return os;
@@ -0,0 +1,353 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <unordered_set>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include <heyoka/expression.hpp>
+#include <heyoka/interval.hpp>
+#include <heyoka/taylor.hpp>
+#include <heyoka/taylor_interval.hpp>
+#include <heyoka/variable.hpp>
+
+namespace heyoka
+{
+
+namespace detail
+{
+
+namespace
+{
+
+// Max number of iterations in the
+// validation of the a priori enclosure.
+constexpr unsigned taylor_interval_max_apriori_iter = 20;
+
+// The smallest interval containing a and b.
+interval interval_hull(const interval &a, const interval &b)
+{
+    return {std::min(a.lower, b.lower), std::max(a.upper, b.upper)};
+}
+
+// Check if a is contained in b.
+bool interval_subset(const interval &a, const interval &b)
+{
+    return b.lower <= a.lower && a.upper <= b.upper;
+}
+
+// Inflate a, in order to produce a candidate
+// a priori enclosure.
+interval interval_inflate(const interval &a)
+{
+    const auto eps = (a.upper - a.lower) / 10 + 1e-15 * (1 + std::max(std::abs(a.lower), std::abs(a.upper)));
+
+    return {a.lower - eps, a.upper + eps};
+}
+
+void taylor_interval_check_state(const std::vector<interval> &state, std::uint32_t dim)
+{
+    if (state.empty() || state.size() % dim != 0u) {
+        throw std::invalid_argument("Invalid state vector passed to a validated Taylor integrator: the size of the "
+                                    "state vector is "
+                                    + std::to_string(state.size())
+                                    + ", which is not a nonzero multiple of the number of equations ("
+                                    + std::to_string(dim) + ")");
+    }
+
+    if (std::any_of(state.begin(), state.end(), [](const interval &a) { return !(a.lower <= a.upper); })) {
+        throw std::invalid_argument(
+            "Invalid state vector passed to a validated Taylor integrator: the state vector contains "
+            "an invalid interval");
+    }
+}
+
+} // namespace
+
+} // namespace detail
+
+taylor_interval::taylor_interval(std::vector<std::pair<expression, expression>> sys, std::vector<interval> state,
+                                 std::uint32_t order, std::vector<double> pars, double time)
+    : m_order(order), m_pars(std::move(pars)), m_time(time), m_state(std::move(state))
+{
+    if (sys.empty()) {
+        throw std::invalid_argument("Cannot create a validated Taylor integrator from an empty system of ODEs");
+    }
+
+    if (sys.size() > std::numeric_limits<std::uint32_t>::max()) {
+        throw std::overflow_error("The number of equations in a validated Taylor integrator is too large");
+    }
+
+    if (order == 0u) {
+        throw std::invalid_argument("The order of a validated Taylor integrator cannot be zero");
+    }
+
+    if (!std::isfinite(time)) {
+        throw std::invalid_argument("Cannot create a validated Taylor integrator with a non-finite initial time");
+    }
+
+    m_dim = static_cast<std::uint32_t>(sys.size());
+
+    // Fetch the names of the state variables
+    // and the right-hand sides.
+    std::unordered_set<std::string> names;
+    std::vector<expression> rhs;
+    for (auto &[lhs, r] : sys) {
+        const auto vptr = std::get_if<variable>(&lhs.value());
+        if (vptr == nullptr) {
+            throw std::invalid_argument("The left-hand sides of the equations of a validated Taylor integrator "
+                                        "must be variables");
+        }
+
+        if (!names.insert(vptr->name()).second) {
+            throw std::invalid_argument("The variable '" + vptr->name()
+                                        + "' appears multiple times in the left-hand sides of the equations of "
+                                          "a validated Taylor integrator");
+        }
+
+        m_vars.push_back(vptr->name());
+        rhs.push_back(std::move(r));
+    }
+
+    for (const auto &r : rhs) {
+        for (const auto &name : get_variables(r)) {
+            if (names.count(name) == 0u) {
+                throw std::invalid_argument("The right-hand sides of the equations of a validated Taylor integrator "
+                                            "contain the variable '"
+                                            + name + "', which is not a state variable");
+            }
+        }
+    }
+
+    detail::taylor_interval_check_state(m_state, m_dim);
+
+    // Compute the time derivatives of the state variables via the recursion
+    // x^(k+1) = J(x^(k)) * f, where J is the Jacobian with respect
+    // to the state variables and x^(1) = f.
+    // NOTE: the normalisation by k! is not done symbolically, so that
+    // no inexact constants are introduced in the expressions.
+    m_tc = simplify(rhs);
+    for (std::uint32_t k = 1; k < order; ++k) {
+        const auto jac = diff(std::vector<expression>(m_tc.end() - static_cast<std::ptrdiff_t>(m_dim), m_tc.end()),
+                              m_vars);
+
+        std::vector<expression> next;
+        for (std::uint32_t i = 0; i < m_dim; ++i) {
+            std::vector<expression> terms;
+            for (std::uint32_t j = 0; j < m_dim; ++j) {
+                terms.push_back(jac[i * m_dim + j] * m_tc[j]);
+            }
+
+            next.push_back(pairwise_sum(std::move(terms)));
+        }
+
+        for (auto &ex : simplify(next)) {
+            m_tc.push_back(std::move(ex));
+        }
+    }
+
+    // Compute the enclosures of the inverse factorials.
+    interval fact_inv{1, 1};
+    for (std::uint32_t k = 1; k <= order; ++k) {
+        fact_inv = fact_inv / interval{static_cast<double>(k), static_cast<double>(k)};
+        m_fact_inv.push_back(fact_inv);
+    }
+}
+
+void taylor_interval::set_state(std::vector<interval> state)
+{
+    detail::taylor_interval_check_state(state, m_dim);
+
+    m_state = std::move(state);
+}
+
+// Setup m_map for the evaluation over the boxes (in the layout of m_state).
+void taylor_interval::load_boxes(const std::vector<interval> &boxes)
+{
+    const auto n_boxes = get_n_boxes();
+
+    for (std::uint32_t i = 0; i < m_dim; ++i) {
+        auto &col = m_map[m_vars[i]];
+        col.resize(n_boxes);
+
+        for (decltype(col.size()) b = 0; b < n_boxes; ++b) {
+            col[b] = boxes[b * m_dim + i];
+        }
+    }
+}
+
+// Validate an a priori enclosure of the solutions over the time range h_range,
+// starting from the current state, and store it in m_b. The return value is
+// false if no enclosure could be validated.
+bool taylor_interval::apriori_enclosure(const interval &h_range)
+{
+    const auto n_boxes = get_n_boxes();
+
+    // Helper to compute X0 + h_range * f(B), where B
+    // is the current content of m_b, into m_new_b.
+    auto picard = [&]() {
+        load_boxes(m_b);
+
+        m_new_b.resize(m_state.size());
+        for (std::uint32_t i = 0; i < m_dim; ++i) {
+            eval_batch_interval_dbl(m_out, m_tc[i], m_map, m_pars);
+
+            for (decltype(m_out.size()) b = 0; b < n_boxes; ++b) {
+                m_new_b[b * m_dim + i] = m_state[b * m_dim + i] + h_range * m_out[b];
+            }
+        }
+    };
+
+    // The first candidate is the inflated image of X0.
+    m_b = m_state;
+    picard();
+    for (decltype(m_b.size()) j = 0; j < m_b.size(); ++j) {
+        m_b[j] = detail::interval_inflate(m_new_b[j]);
+    }
+
+    for (unsigned it = 0; it < detail::taylor_interval_max_apriori_iter; ++it) {
+        picard();
+
+        bool valid = true;
+        for (decltype(m_b.size()) j = 0; j < m_b.size(); ++j) {
+            if (!is_finite(m_new_b[j])) {
+                return false;
+            }
+
+            valid = valid && detail::interval_subset(m_new_b[j], m_b[j]);
+        }
+
+        if (valid) {
+            // NOTE: the image of a validated enclosure
+            // is a (tighter) enclosure as well.
+            m_b.swap(m_new_b);
+
+            return true;
+        }
+
+        for (decltype(m_b.size()) j = 0; j < m_b.size(); ++j) {
+            m_b[j] = detail::interval_inflate(detail::interval_hull(m_b[j], m_new_b[j]));
+        }
+    }
+
+    return false;
+}
+
+bool taylor_interval::step(double h)
+{
+    if (!std::isfinite(h)) {
+        throw std::invalid_argument("A non-finite step size was passed to the step() function of a validated "
+                                    "Taylor integrator");
+    }
+
+    if (!apriori_enclosure(interval{std::min(0., h), std::max(0., h)})) {
+        return false;
+    }
+
+    const auto n_boxes = get_n_boxes();
+    const interval h_ival{h, h};
+
+    // Init the accumulators with the enclosures of the remainders,
+    // i.e., the Taylor coefficients of the highest order over B.
+    load_boxes(m_b);
+    m_acc.resize(m_state.size());
+    for (std::uint32_t i = 0; i < m_dim; ++i) {
+        eval_batch_interval_dbl(m_out, m_tc[(m_order - 1u) * m_dim + i], m_map, m_pars);
+
+        for (decltype(m_out.size()) b = 0; b < n_boxes; ++b) {
+            m_acc[b * m_dim + i] = m_out[b] * m_fact_inv[m_order - 1u];
+        }
+    }
+
+    // Run the Horner scheme with the coefficients
+    // of the lower orders over X0.
+    load_boxes(m_state);
+    for (auto k = m_order - 1u; k > 0u; --k) {
+        for (std::uint32_t i = 0; i < m_dim; ++i) {
+            eval_batch_interval_dbl(m_out, m_tc[(k - 1u) * m_dim + i], m_map, m_pars);
+
+            for (decltype(m_out.size()) b = 0; b < n_boxes; ++b) {
+                auto &acc = m_acc[b * m_dim + i];
+                acc = m_out[b] * m_fact_inv[k - 1u] + h_ival * acc;
+            }
+        }
+    }
+
+    for (decltype(m_acc.size()) j = 0; j < m_acc.size(); ++j) {
+        m_acc[j] = m_state[j] + h_ival * m_acc[j];
+
+        if (!is_finite(m_acc[j])) {
+            return false;
+        }
+    }
+
+    m_state.swap(m_acc);
+    m_time += h;
+
+    return true;
+}
+
+std::tuple<taylor_outcome, std::size_t> taylor_interval::propagate_until(double t, double h,
+                                                                         std::uint32_t n_halvings)
+{
+    if (!std::isfinite(t)) {
+        throw std::invalid_argument("A non-finite time was passed to the propagate_until() function of a validated "
+                                    "Taylor integrator");
+    }
+
+    if (!std::isfinite(h) || h == 0) {
+        throw std::invalid_argument("The step size passed to the propagate_until() function of a validated "
+                                    "Taylor integrator must be finite and nonzero, but it is "
+                                    + std::to_string(h) + " instead");
+    }
+
+    const auto max_h = std::abs(h);
+    auto cur_h = max_h;
+    std::uint32_t n_halved = 0;
+    std::size_t n_steps = 0;
+
+    while (m_time != t) {
+        const auto delta = t - m_time;
+        const auto last = std::abs(delta) <= cur_h;
+
+        if (step(last ? delta : std::copysign(cur_h, delta))) {
+            ++n_steps;
+
+            if (last) {
+                // NOTE: avoid the accumulation of rounding
+                // errors in the final time.
+                m_time = t;
+            }
+
+            if (n_halved > 0u) {
+                --n_halved;
+                cur_h *= 2;
+            }
+        } else {
+            if (n_halved == n_halvings) {
+                return std::tuple{taylor_outcome::err_nf_state, n_steps};
+            }
+
+            ++n_halved;
+            cur_h /= 2;
+        }
+    }
+
+    return std::tuple{taylor_outcome::time_limit, n_steps};
+}
+
+} // namespace heyoka
@@ -0,0 +1,184 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <heyoka/config.hpp>
+
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <heyoka/llvm_state.hpp>
+#include <heyoka/taylor.hpp>
+#include <heyoka/taylor_multi.hpp>
+
+namespace heyoka
+{
+
+namespace detail
+{
+
+namespace
+{
+
+// The prefix of the symbols of the i-th
+// integrator in the shared module.
+std::string taylor_multi_prefix(std::size_t i)
+{
+    return "heyoka.multi." + std::to_string(i) + ".";
+}
+
+} // namespace
+
+} // namespace detail
+
+template <typename T>
+taylor_multi_builder<T>::taylor_multi_builder(llvm_state s) : m_llvm(std::move(s))
+{
+    if (m_llvm.is_compiled()) {
+        throw std::invalid_argument("The llvm_state of a taylor_multi_builder cannot be compiled");
+    }
+}
+
+template <typename T>
+void taylor_multi_builder<T>::check_uncompiled(const char *f) const
+{
+    if (m_compiled) {
+        throw std::invalid_argument(std::string{"The function '"} + f
+                                    + "' can be invoked only before the compilation of a taylor_multi_builder");
+    }
+}
+
+template <typename T>
+void taylor_multi_builder<T>::check_compiled(const char *f) const
+{
+    if (!m_compiled) {
+        throw std::invalid_argument(std::string{"The function '"} + f
+                                    + "' can be invoked only after the compilation of a taylor_multi_builder");
+    }
+}
+
+// Check that the settings affecting the code generation in the
+// llvm_state s of an integrator match those of the builder.
+template <typename T>
+void taylor_multi_builder<T>::check_llvm_state(const llvm_state &s) const
+{
+    if (s.fast_math() != m_llvm.fast_math() || s.prefer_vw512() != m_llvm.prefer_vw512()
+        || s.get_target_cpu() != m_llvm.get_target_cpu() || s.get_target_features() != m_llvm.get_target_features()
+        || s.get_sleef_accuracy() != m_llvm.get_sleef_accuracy()) {
+        throw std::invalid_argument(
+            "The code generation settings (fast math, target CPU and features, 512-bit vectors and accuracy of the "
+            "SLEEF functions) of an integrator added to a taylor_multi_builder must match those of the builder");
+    }
+}
+
+template <typename T>
+std::size_t taylor_multi_builder<T>::get_n_integrators() const
+{
+    return m_tas.size();
+}
+
+template <typename T>
+std::size_t taylor_multi_builder<T>::get_n_batch_integrators() const
+{
+    return m_tabs.size();
+}
+
+// Link the modules of the integrators into the
+// shared module, optimise and compile it, and
+// complete the construction of the integrators.
+template <typename T>
+void taylor_multi_builder<T>::compile()
+{
+    check_uncompiled(__func__);
+
+    if (m_tas.empty() && m_tabs.empty()) {
+        throw std::invalid_argument("Cannot compile a taylor_multi_builder without integrators");
+    }
+
+    // NOTE: the scalar integrators come first in
+    // the numbering of the prefixes.
+    std::size_t idx = 0;
+    for (const auto &ta : m_tas) {
+        m_llvm.link_module(ta.get_llvm_state(), detail::taylor_multi_prefix(idx++));
+    }
+    for (const auto &ta : m_tabs) {
+        m_llvm.link_module(ta.get_llvm_state(), detail::taylor_multi_prefix(idx++));
+    }
+
+    m_llvm.optimise();
+    m_llvm.compile();
+
+    idx = 0;
+    for (auto &ta : m_tas) {
+        ta.finalise_deferred(m_llvm, detail::taylor_multi_prefix(idx++));
+    }
+    for (auto &ta : m_tabs) {
+        ta.finalise_deferred(m_llvm, detail::taylor_multi_prefix(idx++));
+    }
+
+    m_compiled = true;
+}
+
+template <typename T>
+bool taylor_multi_builder<T>::is_compiled() const
+{
+    return m_compiled;
+}
+
+template <typename T>
+const llvm_state &taylor_multi_builder<T>::get_llvm_state() const
+{
+    return m_llvm;
+}
+
+template <typename T>
+taylor_adaptive<T> &taylor_multi_builder<T>::get(std::size_t i)
+{
+    check_compiled(__func__);
+
+    if (i >= m_tas.size()) {
+        throw std::out_of_range("Invalid index " + std::to_string(i) + " passed to the get() function of a "
+                                "taylor_multi_builder containing "
+                                + std::to_string(m_tas.size()) + " integrator(s)");
+    }
+
+    return m_tas[i];
+}
+
+template <typename T>
+taylor_adaptive_batch<T> &taylor_multi_builder<T>::get_batch(std::size_t i)
+{
+    check_compiled(__func__);
+
+    if (i >= m_tabs.size()) {
+        throw std::out_of_range("Invalid index " + std::to_string(i) + " passed to the get_batch() function of a "
+                                "taylor_multi_builder containing "
+                                + std::to_string(m_tabs.size()) + " batch integrator(s)");
+    }
+
+    return m_tabs[i];
+}
+
+// Explicit instantiations.
+template class taylor_multi_builder<double>;
+template class taylor_multi_builder<long double>;
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+template class taylor_multi_builder<mppp::real128>;
+
+#endif
+
+} // namespace heyoka
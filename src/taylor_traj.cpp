@@ -0,0 +1,878 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <heyoka/config.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <ios>
+#include <istream>
+#include <limits>
+#include <memory>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/filesystem/operations.hpp>
+#include <boost/filesystem/path.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <heyoka/detail/binary_io.hpp>
+#include <heyoka/detail/string_conv.hpp>
+#include <heyoka/taylor.hpp>
+#include <heyoka/taylor_traj.hpp>
+
+namespace heyoka
+{
+
+namespace detail
+{
+
+namespace
+{
+
+namespace bip = boost::interprocess;
+
+// The layout of the header of a trajectory file:
+// - the magic string (8 bytes),
+// - the size and the number of binary digits of the
+//   floating-point type (2 x 4 bytes),
+// - the dimension and the order (2 x 4 bytes),
+// - the number of steps (8 bytes).
+constexpr char traj_magic[8] = {'h', 'y', 't', 'r', 'a', 'j', '0', '1'};
+constexpr std::size_t traj_header_size = 32;
+
+struct traj_header {
+    std::uint32_t size = 0;
+    std::int32_t digits = 0;
+    std::uint32_t dim = 0;
+    std::uint32_t order = 0;
+    std::uint64_t n_steps = 0;
+};
+
+void traj_write_header(char *buf, const traj_header &h)
+{
+    std::memcpy(buf, traj_magic, sizeof(traj_magic));
+    std::memcpy(buf + 8, &h.size, 4);
+    std::memcpy(buf + 12, &h.digits, 4);
+    std::memcpy(buf + 16, &h.dim, 4);
+    std::memcpy(buf + 20, &h.order, 4);
+    std::memcpy(buf + 24, &h.n_steps, 8);
+}
+
+template <typename T>
+traj_header traj_make_header(std::uint32_t dim, std::uint32_t order, std::uint64_t n_steps)
+{
+    return traj_header{static_cast<std::uint32_t>(sizeof(T)),
+                       static_cast<std::int32_t>(std::numeric_limits<T>::digits), dim, order, n_steps};
+}
+
+// Compute the size (in bytes) of the record of a step.
+template <typename T>
+std::size_t traj_record_size(std::uint32_t dim, std::uint32_t order)
+{
+    if (dim == 0u || order == 0u) {
+        throw std::invalid_argument("The dimension and the order of a trajectory file must be nonzero");
+    }
+
+    // LCOV_EXCL_START
+    if (order == std::numeric_limits<std::uint32_t>::max()
+        || dim > (std::numeric_limits<std::size_t>::max() / sizeof(T) - 2u) / (order + 1u)) {
+        throw std::overflow_error("Overflow detected in the computation of the record size of a trajectory file");
+    }
+    // LCOV_EXCL_STOP
+
+    return (static_cast<std::size_t>(dim) * (order + 1u) + 2u) * sizeof(T);
+}
+
+} // namespace
+
+template <typename T>
+struct taylor_traj_writer_impl {
+    std::string m_path;
+    std::uint32_t m_dim = 0;
+    std::uint32_t m_order = 0;
+    std::size_t m_rec_size = 0;
+    std::size_t m_chunk_steps = 0;
+    // The number of written steps and the
+    // number of records the file can hold.
+    std::size_t m_n_steps = 0;
+    std::size_t m_capacity = 0;
+    // The first and last times of the written steps.
+    T m_t_first = 0, m_t_last = 0;
+    // The mapping of the file and the mapped
+    // chunk, whose first record is m_chunk_first.
+    bip::file_mapping m_fm;
+    bip::mapped_region m_chunk;
+    std::size_t m_chunk_first = 0;
+    bool m_closed = false;
+
+    // Grow the file by one chunk and map the new chunk.
+    void grow()
+    {
+        // LCOV_EXCL_START
+        const auto max_steps = (std::numeric_limits<std::size_t>::max() - traj_header_size) / m_rec_size;
+        if (m_chunk_steps > max_steps || m_capacity > max_steps - m_chunk_steps) {
+            throw std::overflow_error("Overflow detected while growing a trajectory file");
+        }
+        // LCOV_EXCL_STOP
+
+        // NOTE: unmap the current chunk before resizing the
+        // file, as some platforms do not allow resizing a mapped file.
+        m_chunk = bip::mapped_region();
+
+        boost::filesystem::resize_file(boost::filesystem::path(m_path),
+                                       traj_header_size + (m_capacity + m_chunk_steps) * m_rec_size);
+
+        m_chunk = bip::mapped_region(m_fm, bip::read_write,
+                                     static_cast<bip::offset_t>(traj_header_size + m_capacity * m_rec_size),
+                                     m_chunk_steps * m_rec_size);
+        m_chunk_first = m_capacity;
+        m_capacity += m_chunk_steps;
+    }
+
+    // Write the header with the current number of steps.
+    void write_header() const
+    {
+        char buf[traj_header_size] = {};
+        traj_write_header(buf, traj_make_header<T>(m_dim, m_order, m_n_steps));
+
+        std::fstream fs(m_path, std::ios::binary | std::ios::in | std::ios::out);
+        if (!fs || !fs.write(buf, static_cast<std::streamsize>(traj_header_size))) {
+            throw std::invalid_argument("Error writing the header of the trajectory file '" + m_path + "'");
+        }
+    }
+};
+
+template <typename T>
+struct taylor_traj_reader_impl {
+    std::uint32_t m_dim = 0;
+    std::uint32_t m_order = 0;
+    std::size_t m_rec_size = 0;
+    std::size_t m_n_steps = 0;
+    bip::file_mapping m_fm;
+    bip::mapped_region m_region;
+    // Buffer for the Taylor coefficients of a step
+    // and the output of operator().
+    std::vector<T> m_tc, m_out;
+
+    const char *record(std::size_t i) const
+    {
+        assert(i < m_n_steps);
+
+        return static_cast<const char *>(m_region.get_address()) + traj_header_size + i * m_rec_size;
+    }
+
+    // Fetch the first (second) time of the step i if second is false (true).
+    T step_time(std::size_t i, bool second) const
+    {
+        T retval;
+        std::memcpy(&retval, record(i) + (second ? sizeof(T) : 0u), sizeof(T));
+
+        return retval;
+    }
+};
+
+} // namespace detail
+
+template <typename T>
+taylor_traj_writer<T>::taylor_traj_writer(const std::string &path, std::uint32_t dim, std::uint32_t order,
+                                          std::size_t chunk_steps)
+{
+    const auto rec_size = detail::traj_record_size<T>(dim, order);
+
+    if (chunk_steps == 0u) {
+        throw std::invalid_argument("The number of steps per chunk of a trajectory file must be nonzero");
+    }
+
+    // LCOV_EXCL_START
+    if (chunk_steps > std::numeric_limits<std::size_t>::max() / rec_size) {
+        throw std::overflow_error("Overflow detected in the computation of the chunk size of a trajectory file");
+    }
+    // LCOV_EXCL_STOP
+
+    // Create the file and write the header.
+    {
+        char buf[detail::traj_header_size] = {};
+        detail::traj_write_header(buf, detail::traj_make_header<T>(dim, order, 0));
+
+        std::ofstream ofs(path, std::ios::binary | std::ios::trunc);
+        if (!ofs || !ofs.write(buf, static_cast<std::streamsize>(detail::traj_header_size))) {
+            throw std::invalid_argument("Cannot create the trajectory file '" + path + "'");
+        }
+    }
+
+    auto impl = std::make_unique<detail::taylor_traj_writer_impl<T>>();
+    impl->m_path = path;
+    impl->m_dim = dim;
+    impl->m_order = order;
+    impl->m_rec_size = rec_size;
+    impl->m_chunk_steps = chunk_steps;
+    impl->m_fm = detail::bip::file_mapping(path.c_str(), detail::bip::read_write);
+
+    m_impl = std::move(impl);
+}
+
+template <typename T>
+taylor_traj_writer<T>::taylor_traj_writer(taylor_traj_writer &&) noexcept = default;
+
+template <typename T>
+taylor_traj_writer<T> &taylor_traj_writer<T>::operator=(taylor_traj_writer &&) noexcept = default;
+
+template <typename T>
+taylor_traj_writer<T>::~taylor_traj_writer()
+{
+    if (m_impl && !m_impl->m_closed) {
+        // NOTE: the errors cannot be reported from the destructor.
+        try {
+            close();
+            // LCOV_EXCL_START
+        } catch (...) {
+        }
+        // LCOV_EXCL_STOP
+    }
+}
+
+template <typename T>
+detail::taylor_traj_writer_impl<T> &taylor_traj_writer<T>::get_impl() const
+{
+    if (!m_impl) {
+        throw std::invalid_argument("Cannot use a moved-from trajectory writer");
+    }
+
+    return *m_impl;
+}
+
+template <typename T>
+std::uint32_t taylor_traj_writer<T>::get_dim() const
+{
+    return get_impl().m_dim;
+}
+
+template <typename T>
+std::uint32_t taylor_traj_writer<T>::get_order() const
+{
+    return get_impl().m_order;
+}
+
+template <typename T>
+std::size_t taylor_traj_writer<T>::get_n_steps() const
+{
+    return get_impl().m_n_steps;
+}
+
+template <typename T>
+void taylor_traj_writer<T>::add_step(T t0, T t1, const T *tc)
+{
+    using std::isfinite;
+
+    auto &impl = get_impl();
+
+    assert(tc != nullptr);
+
+    if (impl.m_closed) {
+        throw std::invalid_argument("Cannot write a step into a closed trajectory writer");
+    }
+
+    if (!isfinite(t0) || !isfinite(t1) || t0 == t1) {
+        throw std::invalid_argument("Invalid time range [" + detail::li_to_string(t0) + ", " + detail::li_to_string(t1)
+                                    + "] passed to the add_step() function of a trajectory writer");
+    }
+
+    if (impl.m_n_steps > 0u) {
+        if (t0 != impl.m_t_last) {
+            throw std::invalid_argument(
+                "The steps written into a trajectory writer must be contiguous: the step begins at the time "
+                + detail::li_to_string(t0) + ", but the last written step ends at the time "
+                + detail::li_to_string(impl.m_t_last));
+        }
+
+        if ((t1 > t0) != (impl.m_t_last > impl.m_t_first)) {
+            throw std::invalid_argument(
+                "The steps written into a trajectory writer must be all in the same direction in time");
+        }
+    }
+
+    if (impl.m_n_steps == impl.m_capacity) {
+        impl.grow();
+    }
+
+    // Write the record.
+    auto *rec = static_cast<char *>(impl.m_chunk.get_address())
+                + (impl.m_n_steps - impl.m_chunk_first) * impl.m_rec_size;
+    std::memcpy(rec, &t0, sizeof(T));
+    std::memcpy(rec + sizeof(T), &t1, sizeof(T));
+    std::memcpy(rec + 2u * sizeof(T), tc, impl.m_rec_size - 2u * sizeof(T));
+
+    if (impl.m_n_steps == 0u) {
+        impl.m_t_first = t0;
+    }
+    impl.m_t_last = t1;
+    ++impl.m_n_steps;
+}
+
+template <typename T>
+void taylor_traj_writer<T>::append(const taylor_checkpoints<T> &ckpts)
+{
+    auto &impl = get_impl();
+
+    if (ckpts.get_dim() != impl.m_dim || ckpts.get_order() != impl.m_order) {
+        throw std::invalid_argument("Cannot append to a trajectory writer with dimension "
+                                    + std::to_string(impl.m_dim) + " and order " + std::to_string(impl.m_order)
+                                    + " a store of checkpoints with dimension " + std::to_string(ckpts.get_dim())
+                                    + " and order " + std::to_string(ckpts.get_order()));
+    }
+
+    const auto n_tc = static_cast<std::size_t>(impl.m_dim) * (impl.m_order + 1u);
+    const auto &times = ckpts.get_times();
+
+    for (std::size_t i = 0; i < ckpts.get_n_steps(); ++i) {
+        add_step(times[i], times[i + 1u], ckpts.get_tcs().data() + i * n_tc);
+    }
+}
+
+template <typename T>
+void taylor_traj_writer<T>::flush()
+{
+    auto &impl = get_impl();
+
+    if (impl.m_closed) {
+        return;
+    }
+
+    if (impl.m_chunk.get_size() != 0u) {
+        impl.m_chunk.flush();
+    }
+
+    impl.write_header();
+}
+
+template <typename T>
+void taylor_traj_writer<T>::close()
+{
+    auto &impl = get_impl();
+
+    if (impl.m_closed) {
+        return;
+    }
+
+    flush();
+
+    // Unmap and truncate the file to the written steps.
+    impl.m_chunk = detail::bip::mapped_region();
+    impl.m_fm = detail::bip::file_mapping();
+    boost::filesystem::resize_file(boost::filesystem::path(impl.m_path),
+                                   detail::traj_header_size + impl.m_n_steps * impl.m_rec_size);
+
+    impl.m_closed = true;
+}
+
+template <typename T>
+taylor_traj_reader<T>::taylor_traj_reader(const std::string &path)
+{
+    auto impl = std::make_unique<detail::taylor_traj_reader_impl<T>>();
+
+    try {
+        impl->m_fm = detail::bip::file_mapping(path.c_str(), detail::bip::read_only);
+        impl->m_region = detail::bip::mapped_region(impl->m_fm, detail::bip::read_only);
+    } catch (const detail::bip::interprocess_exception &) {
+        throw std::invalid_argument("Cannot map the trajectory file '" + path + "'");
+    }
+
+    const auto *buf = static_cast<const char *>(impl->m_region.get_address());
+    const auto size = impl->m_region.get_size();
+
+    if (size < detail::traj_header_size || std::memcmp(buf, detail::traj_magic, sizeof(detail::traj_magic)) != 0) {
+        throw std::invalid_argument("The file '" + path + "' is not a trajectory file");
+    }
+
+    detail::traj_header h;
+    std::memcpy(&h.size, buf + 8, 4);
+    std::memcpy(&h.digits, buf + 12, 4);
+    std::memcpy(&h.dim, buf + 16, 4);
+    std::memcpy(&h.order, buf + 20, 4);
+    std::memcpy(&h.n_steps, buf + 24, 8);
+
+    const auto exp_h = detail::traj_make_header<T>(0, 0, 0);
+    if (h.size != exp_h.size || h.digits != exp_h.digits) {
+        throw std::invalid_argument("The trajectory file '" + path
+                                    + "' was written with a floating-point type different from the type of the reader");
+    }
+
+    impl->m_dim = h.dim;
+    impl->m_order = h.order;
+    impl->m_rec_size = detail::traj_record_size<T>(h.dim, h.order);
+
+    // NOTE: the file may be larger than the written steps (e.g.,
+    // if the writer was flushed but not closed).
+    if (h.n_steps > (size - detail::traj_header_size) / impl->m_rec_size) {
+        throw std::invalid_argument("The trajectory file '" + path + "' is truncated");
+    }
+    impl->m_n_steps = static_cast<std::size_t>(h.n_steps);
+
+    impl->m_tc.resize(static_cast<std::size_t>(h.dim) * (h.order + 1u));
+    impl->m_out.resize(h.dim);
+
+    m_impl = std::move(impl);
+}
+
+template <typename T>
+taylor_traj_reader<T>::taylor_traj_reader(taylor_traj_reader &&) noexcept = default;
+
+template <typename T>
+taylor_traj_reader<T> &taylor_traj_reader<T>::operator=(taylor_traj_reader &&) noexcept = default;
+
+template <typename T>
+taylor_traj_reader<T>::~taylor_traj_reader() = default;
+
+template <typename T>
+std::uint32_t taylor_traj_reader<T>::get_dim() const
+{
+    return m_impl->m_dim;
+}
+
+template <typename T>
+std::uint32_t taylor_traj_reader<T>::get_order() const
+{
+    return m_impl->m_order;
+}
+
+template <typename T>
+std::size_t taylor_traj_reader<T>::get_n_steps() const
+{
+    return m_impl->m_n_steps;
+}
+
+template <typename T>
+std::pair<T, T> taylor_traj_reader<T>::get_bounds() const
+{
+    const auto &impl = *m_impl;
+
+    if (impl.m_n_steps == 0u) {
+        throw std::invalid_argument("Cannot fetch the bounds of an empty trajectory file");
+    }
+
+    return {impl.step_time(0, false), impl.step_time(impl.m_n_steps - 1u, true)};
+}
+
+template <typename T>
+const std::vector<T> &taylor_traj_reader<T>::operator()(T t)
+{
+    using std::isnan;
+
+    auto &impl = *m_impl;
+
+    if (impl.m_n_steps == 0u) {
+        throw std::invalid_argument("Cannot evaluate an empty trajectory file");
+    }
+
+    const auto [t_first, t_last] = get_bounds();
+    const auto fwd = t_last > t_first;
+    const auto t_min = fwd ? t_first : t_last, t_max = fwd ? t_last : t_first;
+
+    if (isnan(t) || t < t_min || t > t_max) {
+        throw std::invalid_argument("Cannot evaluate a trajectory file at the time " + detail::li_to_string(t)
+                                    + ", which is outside the time range [" + detail::li_to_string(t_min) + ", "
+                                    + detail::li_to_string(t_max) + "] of the recorded steps");
+    }
+
+    // Locate via binary search the first step beginning after t.
+    // NOTE: the end of the last step belongs to the last step.
+    std::size_t lo = 0, hi = impl.m_n_steps;
+    while (lo < hi) {
+        const auto mid = lo + (hi - lo) / 2u;
+        const auto t0 = impl.step_time(mid, false);
+
+        if (fwd ? t0 > t : t0 < t) {
+            hi = mid;
+        } else {
+            lo = mid + 1u;
+        }
+    }
+    assert(lo > 0u);
+    const auto step_idx = lo - 1u;
+
+    // Evaluate the Taylor polynomials via the Horner scheme.
+    const auto h = t - impl.step_time(step_idx, false);
+    std::memcpy(impl.m_tc.data(), impl.record(step_idx) + 2u * sizeof(T), impl.m_tc.size() * sizeof(T));
+
+    const auto order = impl.m_order;
+    for (std::uint32_t i = 0; i < impl.m_dim; ++i) {
+        const auto *cur_tc = impl.m_tc.data() + static_cast<std::size_t>(i) * (order + 1u);
+
+        auto acc = cur_tc[order];
+        for (std::uint32_t o = 1; o <= order; ++o) {
+            acc = cur_tc[order - o] + acc * h;
+        }
+
+        impl.m_out[i] = acc;
+    }
+
+    return impl.m_out;
+}
+
+template <typename T>
+taylor_cheb_traj<T>::taylor_cheb_traj() = default;
+
+template <typename T>
+taylor_cheb_traj<T>::taylor_cheb_traj(std::uint32_t dim, std::uint32_t order, T tol)
+    : m_dim(dim), m_order(order), m_tol(tol), m_out(dim)
+{
+    using std::isfinite;
+
+    if (m_dim == 0u || m_order == 0u) {
+        throw std::invalid_argument("The dimension and the order of a Chebyshev trajectory must be nonzero");
+    }
+
+    // LCOV_EXCL_START
+    if (m_order == std::numeric_limits<std::uint32_t>::max()
+        || m_dim > std::numeric_limits<std::size_t>::max() / (m_order + 1u)
+        || m_order + 1u > std::numeric_limits<std::size_t>::max() / (m_order + 1u)) {
+        throw std::overflow_error("Overflow detected in the creation of a Chebyshev trajectory");
+    }
+    // LCOV_EXCL_STOP
+
+    if (!isfinite(m_tol) || m_tol < 0) {
+        throw std::invalid_argument("The tolerance of a Chebyshev trajectory must be finite and non-negative, but it is "
+                                    + detail::li_to_string(m_tol) + " instead");
+    }
+
+    init_cos();
+}
+
+template <typename T>
+taylor_cheb_traj<T>::taylor_cheb_traj(const taylor_checkpoints<T> &ckpts, T tol)
+    : taylor_cheb_traj(ckpts.get_dim(), ckpts.get_order(), tol)
+{
+    append(ckpts);
+}
+
+// Compute the cosines cos(pi * j * (k + 1/2) / n), where n = order + 1,
+// for j, k in [0, n). The Chebyshev nodes are the values for j == 1.
+template <typename T>
+void taylor_cheb_traj<T>::init_cos()
+{
+    using std::atan;
+    using std::cos;
+
+    const auto n = static_cast<std::size_t>(m_order) + 1u;
+    const auto pi = 4 * atan(T(1));
+
+    m_cos.resize(n * n);
+    for (std::size_t j = 0; j < n; ++j) {
+        for (std::size_t k = 0; k < n; ++k) {
+            m_cos[j * n + k] = cos(pi * static_cast<T>(j) * (static_cast<T>(k) + T(1) / 2) / static_cast<T>(n));
+        }
+    }
+
+    m_buf.resize(n * 2u);
+}
+
+template <typename T>
+std::pair<T, T> taylor_cheb_traj<T>::get_bounds() const
+{
+    if (m_times.empty()) {
+        throw std::invalid_argument("Cannot fetch the bounds of an empty Chebyshev trajectory");
+    }
+
+    return {m_times.front(), m_times.back()};
+}
+
+template <typename T>
+void taylor_cheb_traj<T>::add_step(T t0, T t1, const T *tc)
+{
+    using std::abs;
+    using std::isfinite;
+
+    assert(tc != nullptr);
+
+    if (m_dim == 0u) {
+        throw std::invalid_argument("Cannot record a step into a default-constructed Chebyshev trajectory");
+    }
+
+    if (!isfinite(t0) || !isfinite(t1) || t0 == t1) {
+        throw std::invalid_argument("Invalid time range [" + detail::li_to_string(t0) + ", " + detail::li_to_string(t1)
+                                    + "] passed to the add_step() function of a Chebyshev trajectory");
+    }
+
+    if (!m_times.empty()) {
+        if (t0 != m_times.back()) {
+            throw std::invalid_argument(
+                "The steps recorded in a Chebyshev trajectory must be contiguous: the step begins at the time "
+                + detail::li_to_string(t0) + ", but the last recorded step ends at the time "
+                + detail::li_to_string(m_times.back()));
+        }
+
+        if ((t1 > t0) != (m_times.back() > m_times.front())) {
+            throw std::invalid_argument(
+                "The steps recorded in a Chebyshev trajectory must be all in the same direction in time");
+        }
+    }
+
+    const auto n = static_cast<std::size_t>(m_order) + 1u;
+    const auto h = t1 - t0;
+    // The values of the Taylor polynomial at the nodes
+    // and the Chebyshev coefficients.
+    auto *vals = m_buf.data(), *cc = m_buf.data() + n;
+
+    if (m_times.empty()) {
+        m_offsets.push_back(m_coeffs.size());
+    }
+
+    for (std::uint32_t i = 0; i < m_dim; ++i) {
+        const auto *cur_tc = tc + static_cast<std::size_t>(i) * n;
+
+        // Evaluate the Taylor polynomial at the Chebyshev nodes, mapped
+        // from [-1, 1] to the time range of the step.
+        for (std::size_t k = 0; k < n; ++k) {
+            const auto dt = (m_cos[n + k] + 1) * h / 2;
+
+            auto acc = cur_tc[m_order];
+            for (std::uint32_t o = 1; o <= m_order; ++o) {
+                acc = cur_tc[m_order - o] + acc * dt;
+            }
+
+            vals[k] = acc;
+        }
+
+        // Compute the Chebyshev coefficients via the discrete cosine transform. The
+        // interpolation at n nodes is exact for the polynomials of degree n - 1.
+        for (std::size_t j = 0; j < n; ++j) {
+            T acc(0);
+            for (std::size_t k = 0; k < n; ++k) {
+                acc += vals[k] * m_cos[j * n + k];
+            }
+
+            cc[j] = acc * 2 / static_cast<T>(n);
+        }
+        cc[0] /= 2;
+
+        // Truncate the series: drop the trailing coefficients as
+        // long as the sum of their absolute values is within the tolerance.
+        auto n_keep = n;
+        T tail(0);
+        while (n_keep > 1u && tail + abs(cc[n_keep - 1u]) <= m_tol) {
+            tail += abs(cc[n_keep - 1u]);
+            --n_keep;
+        }
+
+        m_n_coeffs.push_back(static_cast<std::uint32_t>(n_keep));
+        m_coeffs.insert(m_coeffs.end(), cc, cc + n_keep);
+    }
+
+    if (m_times.empty()) {
+        m_times.push_back(t0);
+    }
+    m_times.push_back(t1);
+    m_offsets.push_back(m_coeffs.size());
+}
+
+template <typename T>
+void taylor_cheb_traj<T>::append(const taylor_checkpoints<T> &ckpts)
+{
+    if (ckpts.get_dim() != m_dim || ckpts.get_order() != m_order) {
+        throw std::invalid_argument("Cannot append to a Chebyshev trajectory with dimension " + std::to_string(m_dim)
+                                    + " and order " + std::to_string(m_order)
+                                    + " a store of checkpoints with dimension " + std::to_string(ckpts.get_dim())
+                                    + " and order " + std::to_string(ckpts.get_order()));
+    }
+
+    const auto n_tc = static_cast<std::size_t>(m_dim) * (m_order + 1u);
+    const auto &times = ckpts.get_times();
+
+    for (std::size_t i = 0; i < ckpts.get_n_steps(); ++i) {
+        add_step(times[i], times[i + 1u], ckpts.get_tcs().data() + i * n_tc);
+    }
+}
+
+template <typename T>
+void taylor_cheb_traj<T>::clear()
+{
+    m_times.clear();
+    m_n_coeffs.clear();
+    m_offsets.clear();
+    m_coeffs.clear();
+}
+
+template <typename T>
+void taylor_cheb_traj<T>::shrink_to_fit()
+{
+    m_times.shrink_to_fit();
+    m_n_coeffs.shrink_to_fit();
+    m_offsets.shrink_to_fit();
+    m_coeffs.shrink_to_fit();
+}
+
+template <typename T>
+const std::vector<T> &taylor_cheb_traj<T>::operator()(T t)
+{
+    using std::isnan;
+
+    if (m_times.empty()) {
+        throw std::invalid_argument("Cannot evaluate an empty Chebyshev trajectory");
+    }
+
+    const auto fwd = m_times.back() > m_times.front();
+    const auto [t_min, t_max] = fwd ? get_bounds() : std::pair{m_times.back(), m_times.front()};
+
+    if (isnan(t) || t < t_min || t > t_max) {
+        throw std::invalid_argument("Cannot evaluate a Chebyshev trajectory at the time " + detail::li_to_string(t)
+                                    + ", which is outside the time range [" + detail::li_to_string(t_min) + ", "
+                                    + detail::li_to_string(t_max) + "] of the recorded steps");
+    }
+
+    // Locate the step containing t via binary search.
+    // NOTE: the end of the last step belongs to the last step.
+    auto it = fwd ? std::upper_bound(m_times.begin(), m_times.end(), t)
+                  : std::upper_bound(m_times.begin(), m_times.end(), t, std::greater<T>{});
+    const auto step_idx = std::min(static_cast<std::size_t>(it - m_times.begin()), m_times.size() - 1u) - 1u;
+
+    // Map t to [-1, 1] and evaluate the Chebyshev series via the Clenshaw recurrence.
+    const auto x = 2 * (t - m_times[step_idx]) / (m_times[step_idx + 1u] - m_times[step_idx]) - 1;
+    const auto *cc = m_coeffs.data() + m_offsets[step_idx];
+    const auto *n_coeffs = m_n_coeffs.data() + step_idx * m_dim;
+
+    for (std::uint32_t i = 0; i < m_dim; ++i) {
+        const auto nc = n_coeffs[i];
+
+        T b1(0), b2(0);
+        for (auto j = nc - 1u; j >= 1u; --j) {
+            const auto tmp = cc[j] + 2 * x * b1 - b2;
+            b2 = b1;
+            b1 = tmp;
+        }
+
+        m_out[i] = cc[0] + x * b1 - b2;
+        cc += nc;
+    }
+
+    return m_out;
+}
+
+template <typename T>
+void taylor_cheb_traj<T>::save(std::ostream &os) const
+{
+    detail::bin_save(os, std::string{"taylor_cheb_traj"});
+    detail::bin_save(os, static_cast<std::uint32_t>(sizeof(T)));
+    detail::bin_save(os, static_cast<std::int32_t>(std::numeric_limits<T>::digits));
+
+    detail::bin_save(os, m_dim);
+    detail::bin_save(os, m_order);
+    detail::bin_save(os, m_tol);
+    detail::bin_save(os, m_times);
+    detail::bin_save(os, m_n_coeffs);
+    detail::bin_save(os, m_coeffs);
+}
+
+template <typename T>
+void taylor_cheb_traj<T>::load(std::istream &is)
+{
+    std::string name;
+    std::uint32_t size = 0;
+    std::int32_t digits = 0;
+
+    detail::bin_load(is, name);
+    detail::bin_load(is, size);
+    detail::bin_load(is, digits);
+
+    if (name != "taylor_cheb_traj") {
+        throw std::invalid_argument("Error loading a Chebyshev trajectory from an input stream: the stream contains "
+                                    "an object of type '"
+                                    + name + "' instead");
+    }
+
+    if (size != sizeof(T) || digits != std::numeric_limits<T>::digits) {
+        throw std::invalid_argument("Error loading a Chebyshev trajectory from an input stream: the trajectory was "
+                                    "saved with a floating-point type different from the current one");
+    }
+
+    std::uint32_t dim = 0, order = 0;
+    T tol(0);
+    std::vector<T> times, coeffs;
+    std::vector<std::uint32_t> n_coeffs;
+
+    detail::bin_load(is, dim);
+    detail::bin_load(is, order);
+    detail::bin_load(is, tol);
+    detail::bin_load(is, times);
+    detail::bin_load(is, n_coeffs);
+    detail::bin_load(is, coeffs);
+
+    // NOTE: the validation of the dimension, of the order
+    // and of the tolerance is performed by the constructor.
+    taylor_cheb_traj tmp(dim, order, tol);
+
+    const auto n_steps = times.empty() ? std::size_t(0) : times.size() - 1u;
+    const auto err_msg = "Error loading a Chebyshev trajectory from an input stream: the sizes of the times and of "
+                         "the Chebyshev coefficients are inconsistent";
+
+    if (times.size() == 1u || n_steps > std::numeric_limits<std::size_t>::max() / dim
+        || n_coeffs.size() != n_steps * dim) {
+        throw std::invalid_argument(err_msg);
+    }
+
+    // Rebuild the offsets of the steps.
+    std::vector<std::size_t> offsets;
+    if (n_steps > 0u) {
+        offsets.push_back(0);
+    }
+    std::size_t tot = 0;
+    for (std::size_t i = 0; i < n_steps; ++i) {
+        for (std::uint32_t j = 0; j < dim; ++j) {
+            const auto nc = n_coeffs[i * dim + j];
+            if (nc == 0u || nc > order + 1u || tot > coeffs.size()) {
+                throw std::invalid_argument(err_msg);
+            }
+            tot += nc;
+        }
+        offsets.push_back(tot);
+    }
+    if (tot != coeffs.size()) {
+        throw std::invalid_argument(err_msg);
+    }
+
+    tmp.m_times = std::move(times);
+    tmp.m_n_coeffs = std::move(n_coeffs);
+    tmp.m_offsets = std::move(offsets);
+    tmp.m_coeffs = std::move(coeffs);
+
+    *this = std::move(tmp);
+}
+
+// Explicit instantiations.
+template class taylor_traj_writer<double>;
+template class taylor_traj_writer<long double>;
+template class taylor_traj_reader<double>;
+template class taylor_traj_reader<long double>;
+template class taylor_cheb_traj<double>;
+template class taylor_cheb_traj<long double>;
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+template class taylor_traj_writer<mppp::real128>;
+template class taylor_traj_reader<mppp::real128>;
+template class taylor_cheb_traj<mppp::real128>;
+
+#endif
+
+} // namespace heyoka
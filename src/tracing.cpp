@@ -0,0 +1,158 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <heyoka/config.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <ios>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <heyoka/tracing.hpp>
+
+namespace heyoka
+{
+
+namespace detail
+{
+
+namespace
+{
+
+// The global trace sink.
+// NOTE: the sink is accessed via the atomic functions for shared_ptr,
+// so that it can be replaced while the traced operations are running
+// in other threads. The flag allows to check cheaply if a sink is set.
+std::shared_ptr<const trace_sink> trace_global_sink;
+std::atomic<bool> trace_sink_set{false};
+
+} // namespace
+
+bool trace_active()
+{
+    return trace_sink_set.load(std::memory_order_relaxed);
+}
+
+void trace_emit(const char *name, trace_phase phase, const void *object)
+{
+    const auto sink = std::atomic_load(&trace_global_sink);
+
+    if (!sink) {
+        return;
+    }
+
+    const auto ts = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now().time_since_epoch())
+                        .count();
+
+    (*sink)(trace_event{name, phase, static_cast<std::int64_t>(ts),
+                        static_cast<std::uint64_t>(std::hash<std::thread::id>{}(std::this_thread::get_id())), object});
+}
+
+} // namespace detail
+
+bool tracing_available()
+{
+#if defined(HEYOKA_WITH_TRACING)
+    return true;
+#else
+    return false;
+#endif
+}
+
+void set_trace_sink(trace_sink s)
+{
+    std::shared_ptr<const trace_sink> ptr;
+    if (s) {
+        ptr = std::make_shared<const trace_sink>(std::move(s));
+    }
+
+    detail::trace_sink_set.store(static_cast<bool>(ptr), std::memory_order_relaxed);
+    std::atomic_store(&detail::trace_global_sink, std::move(ptr));
+}
+
+struct chrome_trace_sink::impl {
+    std::mutex mutex;
+    std::vector<trace_event> events;
+};
+
+chrome_trace_sink::chrome_trace_sink() : m_impl(std::make_shared<impl>()) {}
+
+void chrome_trace_sink::operator()(const trace_event &ev) const
+{
+    std::lock_guard lock(m_impl->mutex);
+
+    m_impl->events.push_back(ev);
+}
+
+std::size_t chrome_trace_sink::size() const
+{
+    std::lock_guard lock(m_impl->mutex);
+
+    return m_impl->events.size();
+}
+
+void chrome_trace_sink::clear() const
+{
+    std::lock_guard lock(m_impl->mutex);
+
+    m_impl->events.clear();
+}
+
+// NOTE: the events are written as duration events (with the 'B'/'E'
+// phases), with the timestamps in microseconds. The addresses of the
+// objects are stored in the arguments of the events.
+std::string chrome_trace_sink::to_json() const
+{
+    std::vector<trace_event> events;
+    {
+        std::lock_guard lock(m_impl->mutex);
+        events = m_impl->events;
+    }
+
+    std::ostringstream oss;
+    oss.precision(3);
+    oss << std::fixed;
+
+    oss << "{\"traceEvents\": [";
+    for (decltype(events.size()) i = 0; i < events.size(); ++i) {
+        const auto &ev = events[i];
+
+        oss << (i == 0u ? "\n" : ",\n") << "  {\"name\": \"" << ev.name << "\", \"cat\": \"heyoka\"";
+        oss << ", \"ph\": \"" << (ev.phase == trace_phase::begin ? 'B' : 'E') << '"';
+        oss << ", \"ts\": " << static_cast<double>(ev.timestamp) / 1000;
+        oss << ", \"pid\": 1, \"tid\": " << ev.thread_id;
+        oss << ", \"args\": {\"object\": \"" << ev.object << "\"}}";
+    }
+    oss << "\n]}\n";
+
+    return oss.str();
+}
+
+void chrome_trace_sink::write(const std::string &filename) const
+{
+    std::ofstream of(filename, std::ios_base::out | std::ios_base::trunc);
+    if (!of) {
+        throw std::invalid_argument("Cannot open the file '" + filename + "' for writing a trace");
+    }
+
+    of << to_json();
+}
+
+} // namespace heyoka
@@ -0,0 +1,182 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include <heyoka/binary_operator.hpp>
+#include <heyoka/detail/type_traits.hpp>
+#include <heyoka/expression.hpp>
+#include <heyoka/func.hpp>
+#include <heyoka/trig_pairs.hpp>
+#include <heyoka/variable.hpp>
+
+namespace heyoka
+{
+
+namespace detail
+{
+
+namespace
+{
+
+// Replace sin(v) and cos(v), for the variables v in the keys of tmap,
+// with the corresponding variables in tmap.
+expression trig_pairs_replace(const expression &ex,
+                              const std::unordered_map<std::string, std::pair<expression, expression>> &tmap,
+                              std::unordered_map<expression, expression> &memo)
+{
+    if (auto it = memo.find(ex); it != memo.end()) {
+        return it->second;
+    }
+
+    auto ret = std::visit(
+        [&](const auto &v) -> expression {
+            using type = uncvref_t<decltype(v)>;
+
+            if constexpr (std::is_same_v<type, binary_operator>) {
+                return expression{binary_operator{v.op(), trig_pairs_replace(v.lhs(), tmap, memo),
+                                                  trig_pairs_replace(v.rhs(), tmap, memo)}};
+            } else if constexpr (std::is_same_v<type, func>) {
+                if ((v.get_name() == "sin" || v.get_name() == "cos") && v.args().size() == 1u) {
+                    if (auto vptr = std::get_if<variable>(&v.args()[0].value())) {
+                        if (auto it = tmap.find(vptr->name()); it != tmap.end()) {
+                            return v.get_name() == "sin" ? it->second.first : it->second.second;
+                        }
+                    }
+                }
+
+                auto tmp = v;
+                for (auto [b, e] = tmp.get_mutable_args_it(); b != e; ++b) {
+                    *b = trig_pairs_replace(*b, tmap, memo);
+                }
+
+                return expression{std::move(tmp)};
+            } else {
+                return ex;
+            }
+        },
+        ex.value());
+
+    memo.emplace(ex, ret);
+
+    return ret;
+}
+
+} // namespace
+
+// Fetch the indices in sys of the equations for the variables in angles,
+// validating sys and angles.
+std::vector<std::vector<std::pair<expression, expression>>::size_type>
+trig_pairs_indices(const std::vector<std::pair<expression, expression>> &sys, const std::vector<expression> &angles)
+{
+    std::unordered_map<std::string, std::vector<std::pair<expression, expression>>::size_type> svars;
+    for (decltype(sys.size()) i = 0; i < sys.size(); ++i) {
+        const auto &lhs = sys[i].first;
+
+        if (!std::holds_alternative<variable>(lhs.value())) {
+            std::ostringstream oss;
+            oss << lhs;
+
+            throw std::invalid_argument("Invalid system passed to make_trig_pairs(): the left-hand side '" + oss.str()
+                                        + "' is not a variable");
+        }
+
+        svars.emplace(std::get<variable>(lhs.value()).name(), i);
+    }
+
+    std::set<std::string> seen;
+    std::vector<std::vector<std::pair<expression, expression>>::size_type> retval;
+    for (const auto &a : angles) {
+        auto vptr = std::get_if<variable>(&a.value());
+        if (vptr == nullptr) {
+            std::ostringstream oss;
+            oss << a;
+
+            throw std::invalid_argument("The angle '" + oss.str() + "' passed to make_trig_pairs() is not a variable");
+        }
+
+        const auto it = svars.find(vptr->name());
+        if (it == svars.end()) {
+            throw std::invalid_argument("The angle '" + vptr->name()
+                                        + "' passed to make_trig_pairs() is not a state variable of the system");
+        }
+
+        if (!seen.insert(vptr->name()).second) {
+            throw std::invalid_argument("The list of angles passed to make_trig_pairs() contains duplicates");
+        }
+
+        retval.push_back(it->second);
+    }
+
+    return retval;
+}
+
+} // namespace detail
+
+std::vector<std::pair<expression, expression>>
+make_trig_pairs(const std::vector<std::pair<expression, expression>> &sys, const std::vector<expression> &angles)
+{
+    const auto idxs = detail::trig_pairs_indices(sys, angles);
+
+    // Collect the variables of sys, for the detection of name clashes.
+    std::set<std::string> all_vars;
+    for (const auto &[lhs, rhs] : sys) {
+        all_vars.insert(std::get<variable>(lhs.value()).name());
+
+        for (auto &name : get_variables(rhs)) {
+            all_vars.insert(std::move(name));
+        }
+    }
+
+    auto make_var = [&all_vars](std::string name) {
+        if (all_vars.count(name) != 0u) {
+            throw std::invalid_argument("Cannot construct the trigonometric pairs of a system containing the "
+                                        "variable '"
+                                        + name + "'");
+        }
+
+        return expression{variable{std::move(name)}};
+    };
+
+    // Create the new state variables.
+    std::unordered_map<std::string, std::pair<expression, expression>> tmap;
+    for (auto idx : idxs) {
+        const auto &name = std::get<variable>(sys[idx].first.value()).name();
+
+        tmap.emplace(name, std::pair{make_var("sin_" + name), make_var("cos_" + name)});
+    }
+
+    // Transform the original equations.
+    std::unordered_map<expression, expression> memo;
+    std::vector<std::pair<expression, expression>> retval;
+    retval.reserve(sys.size() + 2u * idxs.size());
+    for (const auto &[lhs, rhs] : sys) {
+        retval.emplace_back(lhs, detail::trig_pairs_replace(rhs, tmap, memo));
+    }
+
+    // Append the equations for the trigonometric pairs.
+    for (auto idx : idxs) {
+        const auto &[sv, cv] = tmap.at(std::get<variable>(sys[idx].first.value()).name());
+        const auto &f = retval[idx].second;
+
+        retval.emplace_back(sv, cv * f);
+        retval.emplace_back(cv, -(sv * f));
+    }
+
+    return retval;
+}
+
+} // namespace heyoka
@@ -0,0 +1,611 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <heyoka/config.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <map>
+#include <numeric>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <heyoka/binary_operator.hpp>
+#include <heyoka/detail/type_traits.hpp>
+#include <heyoka/expression.hpp>
+#include <heyoka/func.hpp>
+#include <heyoka/number.hpp>
+#include <heyoka/param.hpp>
+#include <heyoka/taylor.hpp>
+#include <heyoka/vareqs.hpp>
+#include <heyoka/variable.hpp>
+
+namespace heyoka
+{
+
+namespace detail
+{
+
+namespace
+{
+
+bool vareqs_is_zero(const expression &ex)
+{
+    auto nptr = std::get_if<number>(&ex.value());
+
+    return nptr != nullptr && is_zero(*nptr);
+}
+
+// Replace the params with index less than pvars.size() with the
+// corresponding placeholder variables in pvars.
+expression vareqs_par_to_var(const expression &ex, const std::vector<expression> &pvars,
+                             std::unordered_map<expression, expression> &memo)
+{
+    if (auto it = memo.find(ex); it != memo.end()) {
+        return it->second;
+    }
+
+    auto ret = std::visit(
+        [&](const auto &v) -> expression {
+            using type = uncvref_t<decltype(v)>;
+
+            if constexpr (std::is_same_v<type, param>) {
+                return v.idx() < pvars.size() ? pvars[v.idx()] : ex;
+            } else if constexpr (std::is_same_v<type, binary_operator>) {
+                return expression{binary_operator{v.op(), vareqs_par_to_var(v.lhs(), pvars, memo),
+                                                  vareqs_par_to_var(v.rhs(), pvars, memo)}};
+            } else if constexpr (std::is_same_v<type, func>) {
+                auto tmp = v;
+                for (auto [b, e] = tmp.get_mutable_args_it(); b != e; ++b) {
+                    *b = vareqs_par_to_var(*b, pvars, memo);
+                }
+
+                return expression{std::move(tmp)};
+            } else {
+                return ex;
+            }
+        },
+        ex.value());
+
+    memo.emplace(ex, ret);
+
+    return ret;
+}
+
+} // namespace
+
+} // namespace detail
+
+std::vector<std::pair<expression, expression>> make_vareqs(const std::vector<std::pair<expression, expression>> &sys,
+                                                           std::uint32_t n_pars)
+{
+    if (sys.empty()) {
+        throw std::invalid_argument("Cannot construct the variational equations of an empty system");
+    }
+
+    const auto n = sys.size();
+
+    if (n > std::numeric_limits<decltype(sys.size())>::max() / (n + n_pars + 1u)) {
+        throw std::overflow_error("Overflow detected in the construction of a system of variational equations");
+    }
+
+    // Fetch and validate the state variables.
+    std::vector<std::string> svars;
+    std::set<std::string> all_vars;
+    for (const auto &[lhs, rhs] : sys) {
+        if (!std::holds_alternative<variable>(lhs.value())) {
+            std::ostringstream oss;
+            oss << lhs;
+
+            throw std::invalid_argument("Invalid system passed to make_vareqs(): the left-hand side '" + oss.str()
+                                        + "' is not a variable");
+        }
+
+        svars.push_back(std::get<variable>(lhs.value()).name());
+        all_vars.insert(svars.back());
+
+        for (auto &name : get_variables(rhs)) {
+            all_vars.insert(std::move(name));
+        }
+    }
+
+    // Helper to create the variational variables, checking
+    // that their names do not clash with the variables of sys.
+    auto make_var = [&all_vars](std::string name) {
+        if (all_vars.count(name) != 0u) {
+            throw std::invalid_argument("Cannot construct the variational equations of a system containing the "
+                                        "variable '"
+                                        + name + "'");
+        }
+
+        return expression{variable{std::move(name)}};
+    };
+
+    // The variational variables.
+    std::vector<expression> phi, sens;
+    for (const auto &xi : svars) {
+        for (const auto &xj : svars) {
+            phi.push_back(make_var("d" + xi + "/d" + xj + "_0"));
+        }
+    }
+    for (const auto &xi : svars) {
+        for (std::uint32_t k = 0; k < n_pars; ++k) {
+            sens.push_back(make_var("d" + xi + "/dpar[" + std::to_string(k) + "]"));
+        }
+    }
+
+    // The Jacobian of the right-hand sides with respect to the state.
+    // NOTE: each element of the Jacobian appears in several variational
+    // equations, and it is shared among them.
+    std::vector<expression> rhs_vec;
+    for (const auto &[_, rhs] : sys) {
+        rhs_vec.push_back(rhs);
+    }
+    const auto jac = diff(rhs_vec, svars);
+
+    // The derivatives of the right-hand sides with respect to the parameters.
+    // NOTE: the parameters are replaced by placeholder variables for
+    // the symbolic differentiation, and then restored.
+    std::vector<expression> dpar;
+    if (n_pars > 0u) {
+        std::vector<expression> pvars;
+        std::vector<std::string> pnames;
+        std::unordered_map<std::string, expression> smap;
+        for (std::uint32_t k = 0; k < n_pars; ++k) {
+            pnames.push_back("__vareqs_par_" + std::to_string(k));
+            pvars.emplace_back(variable{pnames.back()});
+            smap.emplace(pnames.back(), par[k]);
+        }
+
+        std::unordered_map<expression, expression> memo;
+        std::vector<expression> tmp;
+        for (const auto &rhs : rhs_vec) {
+            tmp.push_back(detail::vareqs_par_to_var(rhs, pvars, memo));
+        }
+
+        for (const auto &ex : diff(tmp, pnames)) {
+            dpar.push_back(subs(ex, smap));
+        }
+    }
+
+    // Helper to compute the row-by-column product of the Jacobian
+    // with the matrix m (with n_cols columns), at the position (i, j).
+    auto jac_prod = [&jac, n](const std::vector<expression> &m, decltype(m.size()) n_cols, decltype(m.size()) i,
+                              decltype(m.size()) j) {
+        std::vector<expression> terms;
+        for (decltype(m.size()) k = 0; k < n; ++k) {
+            const auto &jik = jac[i * n + k];
+
+            if (!detail::vareqs_is_zero(jik)) {
+                terms.push_back(jik * m[k * n_cols + j]);
+            }
+        }
+
+        return pairwise_sum(std::move(terms));
+    };
+
+    auto retval = sys;
+    retval.reserve(n * (n + n_pars + 1u));
+
+    for (decltype(sys.size()) i = 0; i < n; ++i) {
+        for (decltype(sys.size()) j = 0; j < n; ++j) {
+            retval.emplace_back(phi[i * n + j], jac_prod(phi, n, i, j));
+        }
+    }
+
+    for (decltype(sys.size()) i = 0; i < n; ++i) {
+        for (decltype(sys.size()) k = 0; k < n_pars; ++k) {
+            retval.emplace_back(sens[i * n_pars + k], jac_prod(sens, n_pars, i, k) + dpar[i * n_pars + k]);
+        }
+    }
+
+    return retval;
+}
+
+namespace detail
+{
+
+namespace
+{
+
+// Append to out all the multi-indices of n components and degree deg, in lexicographically
+// descending order. cur is the current (partial) multi-index, and k the current component.
+void vareqs_ho_indices_impl(std::vector<std::vector<std::uint32_t>> &out, std::vector<std::uint32_t> &cur,
+                            std::uint32_t k, std::uint32_t deg)
+{
+    if (k + 1u == cur.size()) {
+        cur[k] = deg;
+        out.push_back(cur);
+
+        return;
+    }
+
+    for (auto d = deg + 1u; d-- > 0u;) {
+        cur[k] = d;
+        vareqs_ho_indices_impl(out, cur, k + 1u, deg - d);
+    }
+}
+
+} // namespace
+
+} // namespace detail
+
+std::vector<std::vector<std::uint32_t>> vareqs_ho_indices(std::uint32_t n, std::uint32_t order)
+{
+    std::vector<std::vector<std::uint32_t>> retval;
+
+    if (n == 0u) {
+        return retval;
+    }
+
+    std::vector<std::uint32_t> cur(n);
+    for (std::uint32_t deg = 0; deg <= order; ++deg) {
+        detail::vareqs_ho_indices_impl(retval, cur, 0, deg);
+    }
+
+    return retval;
+}
+
+std::vector<std::pair<expression, expression>>
+make_vareqs_ho(const std::vector<std::pair<expression, expression>> &sys, std::uint32_t order)
+{
+    if (sys.empty()) {
+        throw std::invalid_argument("Cannot construct the high-order variational equations of an empty system");
+    }
+
+    if (sys.size() > std::numeric_limits<std::uint32_t>::max()) {
+        throw std::overflow_error("Overflow detected in the construction of a system of high-order variational "
+                                  "equations");
+    }
+
+    const auto n = static_cast<std::uint32_t>(sys.size());
+
+    // Fetch and validate the state variables.
+    std::vector<std::string> svars;
+    std::set<std::string> all_vars;
+    for (const auto &[lhs, rhs] : sys) {
+        if (!std::holds_alternative<variable>(lhs.value())) {
+            std::ostringstream oss;
+            oss << lhs;
+
+            throw std::invalid_argument("Invalid system passed to make_vareqs_ho(): the left-hand side '" + oss.str()
+                                        + "' is not a variable");
+        }
+
+        svars.push_back(std::get<variable>(lhs.value()).name());
+        all_vars.insert(svars.back());
+
+        for (auto &name : get_variables(rhs)) {
+            all_vars.insert(std::move(name));
+        }
+    }
+
+    const auto indices = vareqs_ho_indices(n, order);
+    const auto n_idx = indices.size();
+
+    if (n_idx > std::numeric_limits<std::size_t>::max() / n) {
+        throw std::overflow_error("Overflow detected in the construction of a system of high-order variational "
+                                  "equations");
+    }
+
+    // The positions of the multi-indices.
+    std::map<std::vector<std::uint32_t>, std::size_t> idx_pos;
+    for (std::size_t a = 0; a < n_idx; ++a) {
+        idx_pos.emplace(indices[a], a);
+    }
+
+    // Create the variables, checking that their
+    // names do not clash with the variables of sys.
+    // NOTE: the variable of the derivative of the i-th state variable
+    // wrt the a-th multi-index is at position a * n + i, and
+    // lookup maps the names of the variables to their positions.
+    std::vector<expression> vars;
+    std::unordered_map<std::string, std::size_t> lookup;
+    for (std::size_t a = 0; a < n_idx; ++a) {
+        for (std::uint32_t i = 0; i < n; ++i) {
+            std::string name;
+
+            if (a == 0u) {
+                name = svars[i];
+            } else {
+                name = "d" + svars[i] + "/";
+                for (std::uint32_t j = 0; j < n; ++j) {
+                    if (indices[a][j] != 0u) {
+                        name += "d" + svars[j] + "_0";
+                        if (indices[a][j] > 1u) {
+                            name += "^" + std::to_string(indices[a][j]);
+                        }
+                    }
+                }
+
+                if (all_vars.count(name) != 0u) {
+                    throw std::invalid_argument("Cannot construct the high-order variational equations of a system "
+                                                "containing the variable '"
+                                                + name + "'");
+                }
+            }
+
+            lookup.emplace(name, vars.size());
+            vars.emplace_back(variable{std::move(name)});
+        }
+    }
+
+    // The right-hand sides, in the layout of vars.
+    std::vector<expression> rhs(n_idx * n);
+    for (std::uint32_t i = 0; i < n; ++i) {
+        rhs[i] = sys[i].second;
+    }
+
+    // The derivatives of the multi-index a are computed from the derivatives of
+    // its parent a - e_j, where j is the first nonzero component of a, as
+    // D_j(rhs) = sum_v d(rhs)/dv * D_j(v), with D_j(v) the variable of the
+    // derivative of v wrt the j-th initial condition.
+    // NOTE: the multi-indices are sorted by degree, hence the
+    // parents are processed before their children.
+    for (std::size_t b = 0; b < n_idx; ++b) {
+        const auto &beta = indices[b];
+
+        // Determine the components j for which the parent
+        // of beta + e_j is beta.
+        std::uint32_t max_j = 0;
+        while (max_j + 1u < n && beta[max_j] == 0u) {
+            ++max_j;
+        }
+        if (std::all_of(beta.begin(), beta.end(), [](auto x) { return x == 0u; })) {
+            max_j = n - 1u;
+        }
+
+        // Check if the children of beta are within the order.
+        if (std::accumulate(beta.begin(), beta.end(), std::uint64_t(0)) == order) {
+            continue;
+        }
+
+        // Compute the partial derivatives of the right-hand sides of beta
+        // wrt all the variables appearing in them.
+        const std::vector<expression> cur_rhs(rhs.begin() + static_cast<std::ptrdiff_t>(b * n),
+                                              rhs.begin() + static_cast<std::ptrdiff_t>((b + 1u) * n));
+        std::set<std::string> cur_vars;
+        for (const auto &ex : cur_rhs) {
+            for (auto &name : get_variables(ex)) {
+                if (lookup.count(name) != 0u) {
+                    cur_vars.insert(std::move(name));
+                }
+            }
+        }
+        const std::vector<std::string> cur_vars_vec(cur_vars.begin(), cur_vars.end());
+        const auto jac = diff(cur_rhs, cur_vars_vec);
+
+        for (std::uint32_t j = 0; j <= max_j; ++j) {
+            auto alpha = beta;
+            ++alpha[j];
+            const auto a = idx_pos.at(alpha);
+
+            for (std::uint32_t i = 0; i < n; ++i) {
+                std::vector<expression> terms;
+
+                for (decltype(cur_vars_vec.size()) k = 0; k < cur_vars_vec.size(); ++k) {
+                    const auto &d = jac[i * cur_vars_vec.size() + k];
+
+                    if (detail::vareqs_is_zero(d)) {
+                        continue;
+                    }
+
+                    // Locate the variable D_j(v).
+                    const auto v_pos = lookup.at(cur_vars_vec[k]);
+                    auto v_idx = indices[v_pos / n];
+                    ++v_idx[j];
+
+                    terms.push_back(d * vars[idx_pos.at(v_idx) * n + v_pos % n]);
+                }
+
+                rhs[a * n + i] = terms.empty() ? expression{number{0.}} : pairwise_sum(std::move(terms));
+            }
+        }
+    }
+
+    std::vector<std::pair<expression, expression>> retval;
+    retval.reserve(n_idx * n);
+    for (std::size_t k = 0; k < n_idx * n; ++k) {
+        retval.emplace_back(vars[k], std::move(rhs[k]));
+    }
+
+    return retval;
+}
+
+template <typename T>
+std::vector<T> eval_vareqs_ho(const T *state, std::uint32_t n, std::uint32_t order, const std::vector<T> &dx)
+{
+    if (dx.size() != n) {
+        throw std::invalid_argument("Invalid deviations passed to eval_vareqs_ho(): the number of deviations is "
+                                    + std::to_string(dx.size()) + ", but the number of state variables is "
+                                    + std::to_string(n));
+    }
+
+    const auto indices = vareqs_ho_indices(n, order);
+
+    std::vector<T> retval(n, T(0));
+    for (decltype(indices.size()) a = 0; a < indices.size(); ++a) {
+        // Compute dx**alpha / alpha!.
+        T mon(1);
+        for (std::uint32_t j = 0; j < n; ++j) {
+            for (std::uint32_t k = 1; k <= indices[a][j]; ++k) {
+                mon *= dx[j] / T(k);
+            }
+        }
+
+        for (std::uint32_t i = 0; i < n; ++i) {
+            retval[i] += state[a * n + i] * mon;
+        }
+    }
+
+    return retval;
+}
+
+template <typename T>
+std::pair<T, std::vector<T>> vareqs_loss_grad_batch(taylor_adaptive_batch<T> &ta, std::uint32_t n_pars,
+                                                    const std::vector<T> &states, T t,
+                                                    const std::function<T(const T *, T *, std::size_t)> &loss,
+                                                    std::size_t max_steps)
+{
+    using std::isfinite;
+
+    const auto batch_size = ta.get_batch_size();
+    const auto dim = ta.get_dim();
+
+    // Determine the dimension n of the original system
+    // from the dimension n * (n + n_pars + 1) of ta.
+    std::uint32_t n = 0;
+    while (static_cast<std::uint64_t>(n) * (static_cast<std::uint64_t>(n) + n_pars + 1u) < dim) {
+        ++n;
+    }
+    if (static_cast<std::uint64_t>(n) * (static_cast<std::uint64_t>(n) + n_pars + 1u) != dim) {
+        throw std::invalid_argument("The dimension of the integrator passed to vareqs_loss_grad_batch() ("
+                                    + std::to_string(dim)
+                                    + ") is not compatible with a system of variational equations with "
+                                    + std::to_string(n_pars) + " parameter(s)");
+    }
+
+    if (states.empty() || states.size() % n != 0u) {
+        throw std::invalid_argument("The size of the initial states passed to vareqs_loss_grad_batch() ("
+                                    + std::to_string(states.size())
+                                    + ") is not a nonzero multiple of the dimension of the system ("
+                                    + std::to_string(n) + ")");
+    }
+
+    if (!isfinite(t)) {
+        throw std::invalid_argument("A non-finite final time was passed to vareqs_loss_grad_batch()");
+    }
+
+    if (!loss) {
+        throw std::invalid_argument("An empty loss function was passed to vareqs_loss_grad_batch()");
+    }
+
+    const auto n_traj = states.size() / n;
+
+    // The initial times, which are restored for each group of trajectories.
+    const auto t0 = ta.get_time();
+
+    // The offset of the sensitivities with respect to the parameters
+    // in the state of the system of variational equations.
+    const auto sens_offset = static_cast<std::size_t>(n) * (n + 1u);
+
+    T tot_loss(0);
+    std::vector<T> grad(n_pars, T(0)), x(n), dl(n);
+    const std::vector<T> tf(batch_size, t);
+
+    for (std::size_t first = 0; first < n_traj; first += batch_size) {
+        // NOTE: the slots exceeding the number of trajectories
+        // in the last group are filled with the first trajectory
+        // of the group, and their results are discarded.
+        const auto n_active = static_cast<std::uint32_t>(std::min<std::size_t>(batch_size, n_traj - first));
+
+        // Set up the initial states.
+        auto *sdata = ta.get_state_data();
+        for (std::uint32_t lane = 0; lane < batch_size; ++lane) {
+            const auto *init = states.data() + (first + (lane < n_active ? lane : 0u)) * n;
+
+            for (std::uint32_t i = 0; i < n; ++i) {
+                sdata[static_cast<std::size_t>(i) * batch_size + lane] = init[i];
+            }
+
+            // The state transition matrix and the sensitivities
+            // with respect to the parameters.
+            for (auto j = static_cast<std::size_t>(n); j < dim; ++j) {
+                const auto idx = j - n;
+                const auto is_diag = idx < sens_offset - n && idx / n == idx % n;
+
+                sdata[j * batch_size + lane] = is_diag ? T(1) : T(0);
+            }
+        }
+        ta.set_time(t0);
+
+        // Propagate.
+        const auto &res = ta.propagate_until(tf, max_steps);
+
+        for (std::uint32_t lane = 0; lane < n_active; ++lane) {
+            if (std::get<0>(res[lane]) != taylor_outcome::time_limit) {
+                throw std::invalid_argument("The propagation of the trajectory " + std::to_string(first + lane)
+                                            + " in vareqs_loss_grad_batch() did not reach the final time");
+            }
+        }
+
+        // Apply the chain rule.
+        const auto *fdata = ta.get_state_data();
+        for (std::uint32_t lane = 0; lane < n_active; ++lane) {
+            for (std::uint32_t i = 0; i < n; ++i) {
+                x[i] = fdata[static_cast<std::size_t>(i) * batch_size + lane];
+            }
+            std::fill(dl.begin(), dl.end(), T(0));
+
+            tot_loss += loss(x.data(), dl.data(), first + lane);
+
+            for (std::uint32_t i = 0; i < n; ++i) {
+                for (std::uint32_t k = 0; k < n_pars; ++k) {
+                    grad[k] += dl[i]
+                               * fdata[(sens_offset + static_cast<std::size_t>(i) * n_pars + k) * batch_size + lane];
+                }
+            }
+        }
+    }
+
+    return std::pair{tot_loss, std::move(grad)};
+}
+
+// Explicit instantiations.
+template HEYOKA_DLL_PUBLIC std::vector<double> eval_vareqs_ho(const double *, std::uint32_t, std::uint32_t,
+                                                              const std::vector<double> &);
+
+template HEYOKA_DLL_PUBLIC std::vector<long double> eval_vareqs_ho(const long double *, std::uint32_t, std::uint32_t,
+                                                                   const std::vector<long double> &);
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+template HEYOKA_DLL_PUBLIC std::vector<mppp::real128> eval_vareqs_ho(const mppp::real128 *, std::uint32_t,
+                                                                     std::uint32_t,
+                                                                     const std::vector<mppp::real128> &);
+
+#endif
+
+template HEYOKA_DLL_PUBLIC std::pair<double, std::vector<double>>
+vareqs_loss_grad_batch(taylor_adaptive_batch<double> &, std::uint32_t, const std::vector<double> &, double,
+                       const std::function<double(const double *, double *, std::size_t)> &, std::size_t);
+
+template HEYOKA_DLL_PUBLIC std::pair<long double, std::vector<long double>>
+vareqs_loss_grad_batch(taylor_adaptive_batch<long double> &, std::uint32_t, const std::vector<long double> &,
+                       long double, const std::function<long double(const long double *, long double *, std::size_t)> &,
+                       std::size_t);
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+template HEYOKA_DLL_PUBLIC std::pair<mppp::real128, std::vector<mppp::real128>>
+vareqs_loss_grad_batch(taylor_adaptive_batch<mppp::real128> &, std::uint32_t, const std::vector<mppp::real128> &,
+                       mppp::real128,
+                       const std::function<mppp::real128(const mppp::real128 *, mppp::real128 *, std::size_t)> &,
+                       std::size_t);
+
+#endif
+
+} // namespace heyoka
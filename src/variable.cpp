@@ -11,10 +11,15 @@
 #include <cassert>
 #include <cstddef>
 #include <cstdint>
+#include <deque>
 #include <functional>
+#include <limits>
+#include <mutex>
 #include <ostream>
 #include <stdexcept>
 #include <string>
+#include <string_view>
+#include <tuple>
 #include <unordered_map>
 #include <utility>
 #include <vector>
@@ -41,7 +46,110 @@
 namespace heyoka
 {
 
-variable::variable(std::string s) : m_name(std::move(s)) {}
+namespace detail
+{
+
+namespace
+{
+
+constexpr auto no_u_idx = std::numeric_limits<std::uint32_t>::max();
+
+// The table of the interned variable names.
+struct var_table {
+    std::mutex mutex;
+    // NOTE: std::deque guarantees the stability
+    // of the references to the names upon insertion.
+    std::deque<std::string> names;
+    std::unordered_map<std::string_view, std::uint32_t> ids;
+    // The ids of the interned u variables, indexed
+    // by the indices of the u variables (no_u_idx if
+    // the u variable is not interned).
+    std::vector<std::uint32_t> u_ids;
+};
+
+// Compute the index of the u variable with the name s (e.g., 123 for
+// "u_123"), or no_u_idx if s is not the canonical name of a u variable
+// (i.e., "u_" followed by the decimal digits of the index,
+// without leading zeroes).
+std::uint32_t u_var_index(const std::string &s)
+{
+    if (s.size() < 3u || s[0] != 'u' || s[1] != '_' || (s[2] == '0' && s.size() > 3u)) {
+        return no_u_idx;
+    }
+
+    std::uint64_t idx = 0;
+    for (auto it = s.begin() + 2; it != s.end(); ++it) {
+        if (*it < '0' || *it > '9') {
+            return no_u_idx;
+        }
+
+        idx = idx * 10u + static_cast<std::uint64_t>(*it - '0');
+        if (idx >= no_u_idx) {
+            return no_u_idx;
+        }
+    }
+
+    return static_cast<std::uint32_t>(idx);
+}
+
+var_table &get_var_table()
+{
+    // NOTE: the table is never destroyed, so that variables
+    // can be safely used during the destruction of static objects.
+    static auto *table = new var_table;
+
+    return *table;
+}
+
+// Intern the name s, returning a pointer to the interned
+// name, its id and its index as a u variable.
+std::tuple<const std::string *, std::uint32_t, std::uint32_t> intern_var_name(std::string s)
+{
+    const auto u_idx = u_var_index(s);
+
+    auto &table = get_var_table();
+
+    std::lock_guard lock(table.mutex);
+
+    if (auto it = table.ids.find(s); it != table.ids.end()) {
+        return {&table.names[it->second], it->second, u_idx};
+    }
+
+    if (table.names.size() == std::numeric_limits<std::uint32_t>::max()) {
+        throw std::overflow_error("Overflow detected in the interning of the name of a variable");
+    }
+
+    const auto id = static_cast<std::uint32_t>(table.names.size());
+    const auto &name = table.names.emplace_back(std::move(s));
+    table.ids.emplace(name, id);
+
+    // NOTE: the u variables are created in increasing order of their
+    // indices in the decompositions. The bound on the growth of the table
+    // prevents the allocation of a huge table for user-defined variables
+    // such as u_4000000000, which are interned without caching their ids.
+    if (u_idx != no_u_idx && u_idx < table.u_ids.size() + (1u << 16)) {
+        if (u_idx >= table.u_ids.size()) {
+            table.u_ids.resize(static_cast<decltype(table.u_ids.size())>(u_idx) + 1u, no_u_idx);
+        }
+        table.u_ids[u_idx] = id;
+    }
+
+    return {&name, id, u_idx};
+}
+
+} // namespace
+
+} // namespace detail
+
+variable::variable(std::string s)
+{
+    std::tie(m_name, m_id, m_u_idx) = detail::intern_var_name(std::move(s));
+}
+
+variable::variable(const std::string *name, std::uint32_t id, std::uint32_t u_idx)
+    : m_name(name), m_id(id), m_u_idx(u_idx)
+{
+}
 
 variable::variable(const variable &) = default;
 
@@ -53,24 +161,51 @@ variable &variable::operator=(const variable &) = default;
 
 variable &variable::operator=(variable &&) noexcept = default;
 
-std::string &variable::name()
+const std::string &variable::name() const
 {
-    return m_name;
+    return *m_name;
 }
 
-const std::string &variable::name() const
+std::uint32_t variable::id() const
 {
-    return m_name;
+    return m_id;
 }
 
+namespace detail
+{
+
+variable make_u_var(std::uint32_t i)
+{
+    {
+        auto &table = get_var_table();
+
+        std::lock_guard lock(table.mutex);
+
+        if (i < table.u_ids.size() && table.u_ids[i] != no_u_idx) {
+            const auto id = table.u_ids[i];
+
+            return variable(&table.names[id], id, i);
+        }
+    }
+
+    return variable("u_" + std::to_string(i));
+}
+
+std::uint32_t uname_to_index(const variable &v)
+{
+    return v.m_u_idx != no_u_idx ? v.m_u_idx : uname_to_index(v.name());
+}
+
+} // namespace detail
+
 void swap(variable &v0, variable &v1) noexcept
 {
-    std::swap(v0.name(), v1.name());
+    std::swap(v0, v1);
 }
 
 std::size_t hash(const variable &v)
 {
-    return std::hash<std::string>{}(v.name());
+    return std::hash<std::uint32_t>{}(v.id());
 }
 
 std::ostream &operator<<(std::ostream &os, const variable &var)
@@ -86,13 +221,13 @@ std::vector<std::string> get_variables(const variable &var)
 void rename_variables(variable &var, const std::unordered_map<std::string, std::string> &repl_map)
 {
     if (auto it = repl_map.find(var.name()); it != repl_map.end()) {
-        var.name() = it->second;
+        var = variable{it->second};
     }
 }
 
 bool operator==(const variable &v1, const variable &v2)
 {
-    return v1.name() == v2.name();
+    return v1.id() == v2.id();
 }
 
 bool operator!=(const variable &v1, const variable &v2)
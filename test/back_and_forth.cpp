@@ -8,9 +8,11 @@
 
 #include <heyoka/config.hpp>
 
+#include <algorithm>
 #include <array>
 #include <cmath>
 #include <initializer_list>
+#include <stdexcept>
 #include <tuple>
 #include <vector>
 
@@ -122,3 +124,80 @@ TEST_CASE("three body")
         }
     }
 }
+
+TEST_CASE("symmetric step")
+{
+    using Catch::Matchers::Message;
+
+    auto tester = [](auto fp_x, bool compact_mode) {
+        using std::abs;
+        using std::cos;
+
+        using fp_t = decltype(fp_x);
+
+        auto [th, v] = make_vars("th", "v");
+
+        // NOTE: use a loose tolerance.
+        taylor_adaptive<fp_t> ta{{prime(th) = v, prime(v) = -9.8_dbl / 1.5_dbl * sin(th)},
+                                 {fp_t{0.5}, fp_t{0.25}},
+                                 kw::compact_mode = compact_mode,
+                                 kw::tol = fp_t(1e-4)};
+
+        const auto energy = [&ta]() {
+            const auto &st = ta.get_state();
+            return st[1] * st[1] / 2 - fp_t(9.8) / fp_t(1.5) * cos(st[0]);
+        };
+
+        const auto E0 = energy();
+
+        // The symmetric steps forth and back
+        // reproduce the initial state.
+        for (auto i = 0; i < 50; ++i) {
+            REQUIRE(std::get<0>(ta.step_symmetric(fp_t(0.1))) == taylor_outcome::success);
+        }
+        REQUIRE(ta.get_time() == approximately(fp_t(5), fp_t(100)));
+        for (auto i = 0; i < 50; ++i) {
+            REQUIRE(std::get<0>(ta.step_symmetric(fp_t(-0.1))) == taylor_outcome::success);
+        }
+
+        REQUIRE(abs(ta.get_state()[0] - fp_t(0.5)) < fp_t(1e-11));
+        REQUIRE(abs(ta.get_state()[1] - fp_t(0.25)) < fp_t(1e-11));
+        REQUIRE(abs(ta.get_time()) < fp_t(1e-12));
+
+        // The energy error stays bounded.
+        fp_t max_err(0);
+        for (auto i = 0; i < 2000; ++i) {
+            ta.step_symmetric(fp_t(0.1));
+            max_err = std::max(max_err, abs((energy() - E0) / E0));
+        }
+        REQUIRE(max_err < fp_t(1e-3));
+    };
+
+    tuple_for_each(fp_types, [&tester](auto x) { tester(x, false); });
+    tuple_for_each(fp_types, [&tester](auto x) { tester(x, true); });
+
+    // Error checking.
+    auto [th, v] = make_vars("th", "v");
+
+    taylor_adaptive<double> ta{{prime(th) = v, prime(v) = -th}, {0.5, 0.25}};
+
+    REQUIRE_THROWS_MATCHES(ta.step_symmetric(0.), std::invalid_argument,
+                           Message("The timestep passed to the step_symmetric() function of an adaptive Taylor "
+                                   "integrator must be finite and nonzero, but it is 0 instead"));
+    REQUIRE_THROWS_MATCHES(ta.step_symmetric(1., 0), std::invalid_argument,
+                           Message("The maximum number of iterations passed to the step_symmetric() function of an "
+                                   "adaptive Taylor integrator cannot be zero"));
+
+    ta.enable_checkpoints();
+    REQUIRE_THROWS_MATCHES(ta.step_symmetric(1.), std::invalid_argument,
+                           Message("The symmetric step is not supported by an adaptive Taylor integrator while the "
+                                   "recording of the checkpoints is enabled"));
+
+    using ev_t = taylor_adaptive<double>::nt_event_t;
+    taylor_adaptive<double> ta_ev{{prime(th) = v, prime(v) = -th},
+                                  {0.5, 0.25},
+                                  kw::nt_events = std::vector<ev_t>{ev_t(v, [](auto &, double) {})}};
+    REQUIRE_THROWS_MATCHES(
+        ta_ev.step_symmetric(1.), std::invalid_argument,
+        Message("The symmetric step is not supported by an adaptive Taylor integrator with events"));
+}
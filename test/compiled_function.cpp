@@ -0,0 +1,511 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <heyoka/config.hpp>
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <ios>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <heyoka/compiled_function.hpp>
+#include <heyoka/expression.hpp>
+#include <heyoka/llvm_state.hpp>
+#include <heyoka/mapped_columns.hpp>
+#include <heyoka/math.hpp>
+
+#include "catch.hpp"
+#include "test_utils.hpp"
+
+static std::mt19937 rng;
+
+using namespace heyoka;
+using namespace heyoka_test;
+
+const auto fp_types = std::tuple<double, long double
+#if defined(HEYOKA_HAVE_REAL128)
+                                 ,
+                                 mppp::real128
+#endif
+                                 >{};
+
+TEST_CASE("compiled function")
+{
+    using Catch::Matchers::Message;
+
+    auto tester = [](auto fp_x, unsigned opt_level, std::uint32_t batch_size) {
+        using std::cos;
+        using std::exp;
+        using fp_t = decltype(fp_x);
+
+        auto [x, y] = make_vars("x", "y");
+
+        compiled_function<fp_t> cf{{x * y + cos(x * y), exp(y) - par[0], 3_dbl},
+                                   kw::opt_level = opt_level,
+                                   kw::batch_size = batch_size};
+
+        REQUIRE(cf.get_vars() == std::vector{x, y});
+        REQUIRE(cf.get_fn().size() == 3u);
+        if (batch_size != 0u) {
+            REQUIRE(cf.get_batch_size() == batch_size);
+        } else {
+            REQUIRE(cf.get_batch_size() > 0u);
+        }
+
+        // Single point.
+        auto out = cf({fp_t(2), fp_t(-1)}, {fp_t(3)});
+        REQUIRE(out.size() == 3u);
+        REQUIRE(out[0] == approximately(fp_t(-2) + cos(fp_t(-2))));
+        REQUIRE(out[1] == approximately(exp(fp_t(-1)) - fp_t(3)));
+        REQUIRE(out[2] == 3);
+
+        // Batch evaluation, with a number of points
+        // which is not a multiple of the batch size.
+        const auto n_points = 37u;
+        std::uniform_real_distribution<double> dist(-1., 1.);
+        std::vector<fp_t> in(2u * n_points), out_b;
+        for (auto &v : in) {
+            v = fp_t(dist(rng));
+        }
+
+        cf.eval_batch(out_b, in, n_points, {fp_t(3)});
+        REQUIRE(out_b.size() == 3u * n_points);
+
+        for (auto i = 0u; i < n_points; ++i) {
+            const auto xv = in[i], yv = in[n_points + i];
+
+            REQUIRE(out_b[i] == approximately(xv * yv + cos(xv * yv)));
+            REQUIRE(out_b[n_points + i] == approximately(exp(yv) - fp_t(3)));
+            REQUIRE(out_b[2u * n_points + i] == 3);
+        }
+
+        // Copy semantics.
+        auto cf2 = cf;
+        REQUIRE(cf2({fp_t(2), fp_t(-1)}, {fp_t(3)}) == out);
+
+        // Error checking.
+        REQUIRE_THROWS_MATCHES(cf({fp_t(2)}, {fp_t(3)}), std::invalid_argument,
+                               Message("Invalid input array passed to a compiled function: the number of variables "
+                                       "is 2, but the size of the input array is 1"));
+        REQUIRE_THROWS_MATCHES(cf({fp_t(2), fp_t(-1)}), std::invalid_argument,
+                               Message("Invalid array of parameters passed to a compiled function: the number of "
+                                       "parameters is 1, but the size of the array of parameters is 0"));
+        REQUIRE_THROWS_AS(cf.eval_batch(out_b, in, n_points + 1u, {fp_t(3)}), std::invalid_argument);
+    };
+
+    for (auto opt_level : {0u, 3u}) {
+        for (auto batch_size : {0u, 1u, 4u}) {
+            tuple_for_each(fp_types, [&tester, opt_level, batch_size](auto x) { tester(x, opt_level, batch_size); });
+        }
+    }
+}
+
+TEST_CASE("compiled function vars")
+{
+    using Catch::Matchers::Message;
+
+    auto [x, y, z] = make_vars("x", "y", "z");
+
+    // Explicit list of variables, including
+    // a variable which does not appear in the expressions.
+    compiled_function<double> cf{{x - y}, kw::vars = {y, z, x}};
+    REQUIRE(cf.get_vars() == std::vector{y, z, x});
+    REQUIRE(cf({1., 2., 3.}) == std::vector{2.});
+
+    REQUIRE_THROWS_MATCHES((compiled_function<double>{{x - y}, kw::vars = {x}}), std::invalid_argument,
+                           Message("Cannot generate the code for the variable 'y', because it is not in the list "
+                                   "of the variables of the compiled function"));
+    REQUIRE_THROWS_MATCHES((compiled_function<double>{{x - y}, kw::vars = {x, y, x}}), std::invalid_argument,
+                           Message("The list of variables of a compiled function contains the variable 'x' more "
+                                   "than once"));
+    REQUIRE_THROWS_MATCHES((compiled_function<double>{{x - y}, kw::vars = {x, x * y}}), std::invalid_argument,
+                           Message("The list of variables of a compiled function can contain only variables, but the "
+                                   "expression '(x * y)' was found instead"));
+}
+
+TEST_CASE("compiled function mapped columns")
+{
+    using Catch::Matchers::Message;
+
+    auto tester = [](auto fp_x) {
+        using std::cos;
+        using fp_t = decltype(fp_x);
+
+        auto [x, y] = make_vars("x", "y");
+
+        compiled_function<fp_t> cf{{x * y + cos(x * y), y - par[0]}, kw::batch_size = 4u};
+
+        // Write a dataset (the x column followed by the y column)
+        // with a number of points which is not a multiple of the chunk size.
+        const auto n_points = 5001u;
+        std::uniform_real_distribution<double> dist(-1., 1.);
+        std::vector<fp_t> in(2u * n_points);
+        for (auto &v : in) {
+            v = fp_t(dist(rng));
+        }
+
+        const auto path = std::string("heyoka_test_columns.bin");
+        {
+            std::ofstream ofs(path, std::ios::binary);
+            ofs.write(reinterpret_cast<const char *>(in.data()),
+                      static_cast<std::streamsize>(in.size() * sizeof(fp_t)));
+        }
+
+        {
+            mapped_columns<fp_t> mc(path, 2);
+
+            REQUIRE(mc.get_n_cols() == 2u);
+            REQUIRE(mc.get_n_points() == n_points);
+            REQUIRE(mc.column(0) == mc.data());
+            REQUIRE(mc.column(1) == mc.data() + n_points);
+            REQUIRE(*mc.column(1) == in[n_points]);
+            REQUIRE_THROWS_AS(mc.column(2), std::invalid_argument);
+
+            std::vector<fp_t> out(2u * n_points), out_b;
+            const std::vector<fp_t> pars{fp_t(3)};
+
+            cf.eval_batch(out_b, in, n_points, pars);
+
+            for (auto n_threads : {0u, 1u, 3u}) {
+                cf.eval_batch_parallel(out.data(), mc.data(), n_points, pars.data(), n_threads);
+                REQUIRE(out == out_b);
+            }
+
+            // Wrong number of columns.
+            REQUIRE_THROWS_AS(mapped_columns<fp_t>(path, 3), std::invalid_argument);
+        }
+
+        std::remove(path.c_str());
+
+        REQUIRE_THROWS_AS(mapped_columns<fp_t>(path, 2), std::invalid_argument);
+    };
+
+    tuple_for_each(fp_types, tester);
+}
+
+TEST_CASE("add_cfunc")
+{
+    auto [x, y] = make_vars("x", "y");
+
+    llvm_state s;
+
+    const auto vars = add_cfunc<double>(s, "f", {x + y, x * y}, {}, 2);
+    REQUIRE(vars == std::vector{x, y});
+
+    REQUIRE_THROWS_MATCHES(add_cfunc<double>(s, "g", {x}, {}, 0), std::invalid_argument,
+                           Catch::Matchers::Message("The batch size of a compiled function cannot be zero"));
+
+    s.compile();
+
+    auto f = reinterpret_cast<void (*)(double *, const double *, const double *, std::uint64_t)>(s.jit_lookup("f"));
+
+    // Two points, with stride 3.
+    const std::vector<double> in{1., 2., 0., 3., 4., 0.};
+    std::vector<double> out(6);
+    f(out.data(), in.data(), nullptr, 3);
+
+    REQUIRE(out[0] == 4.);
+    REQUIRE(out[1] == 6.);
+    REQUIRE(out[3] == 3.);
+    REQUIRE(out[4] == 8.);
+
+    REQUIRE_THROWS_MATCHES(add_cfunc<double>(s, "g", {x}, {}, 1), std::invalid_argument,
+                           Catch::Matchers::Message("A compiled function cannot be added to an llvm_state after "
+                                                    "compilation"));
+}
+
+TEST_CASE("add_cfunc cse")
+{
+    auto [x, y] = make_vars("x", "y");
+
+    // NOTE: no optimisation, so that the IR reflects
+    // the code emitted for the expressions.
+    llvm_state s{kw::opt_level = 0u};
+
+    // The product of x and y is shared by all the outputs
+    // (also with the operands in the opposite order).
+    add_cfunc<double>(s, "f", {x * y + cos(x * y), cos(y * x) - x, y * x}, {}, 1);
+
+    const auto ir = s.get_ir();
+
+    std::size_t n_fmul = 0;
+    for (auto pos = ir.find(" fmul "); pos != std::string::npos; pos = ir.find(" fmul ", pos + 1u)) {
+        ++n_fmul;
+    }
+    REQUIRE(n_fmul == 1u);
+
+    s.compile();
+
+    auto f = reinterpret_cast<void (*)(double *, const double *, const double *, std::uint64_t)>(s.jit_lookup("f"));
+
+    const std::vector<double> in{2., 3.};
+    std::vector<double> out(3);
+    f(out.data(), in.data(), nullptr, 1);
+
+    REQUIRE(out[0] == approximately(6. + std::cos(6.)));
+    REQUIRE(out[1] == approximately(std::cos(6.) - 2.));
+    REQUIRE(out[2] == 6.);
+}
+
+// Batch evaluation from/to buffers which are aligned only to the scalar
+// type, with a stride which is not a multiple of the batch size.
+TEST_CASE("add_cfunc unaligned batch")
+{
+    auto tester = [](auto fp_x, unsigned opt_level) {
+        using std::cos;
+        using fp_t = decltype(fp_x);
+
+        auto [x, y] = make_vars("x", "y");
+
+        for (std::uint32_t batch_size : {2u, 4u}) {
+            llvm_state s{kw::opt_level = opt_level};
+
+            add_cfunc<fp_t>(s, "f", {x * y + cos(x), x - y}, {}, batch_size);
+
+            s.compile();
+
+            auto f = reinterpret_cast<void (*)(fp_t *, const fp_t *, const fp_t *, std::uint64_t)>(s.jit_lookup("f"));
+
+            const std::uint64_t stride = batch_size + 3u;
+
+            // NOTE: the buffers are offset by one element from the
+            // beginning of the storage allocated by std::vector.
+            std::uniform_real_distribution<double> dist(-1., 1.);
+            std::vector<fp_t> in_buf(1u + 2u * stride), out_buf(1u + 2u * stride, fp_t(-42));
+            for (auto &v : in_buf) {
+                v = fp_t(dist(rng));
+            }
+
+            const auto *in = in_buf.data() + 1;
+            auto *out = out_buf.data() + 1;
+
+            f(out, in, nullptr, stride);
+
+            for (std::uint64_t i = 0; i < stride; ++i) {
+                if (i < batch_size) {
+                    const auto xv = in[i], yv = in[stride + i];
+
+                    REQUIRE(out[i] == approximately(xv * yv + cos(xv)));
+                    REQUIRE(out[stride + i] == approximately(xv - yv));
+                } else {
+                    // The padding must not be touched.
+                    REQUIRE(out[i] == -42);
+                    REQUIRE(out[stride + i] == -42);
+                }
+            }
+
+            REQUIRE(out_buf[0] == -42);
+        }
+    };
+
+    for (auto opt_level : {0u, 3u}) {
+        tuple_for_each(fp_types, [&tester, opt_level](auto x) { tester(x, opt_level); });
+    }
+}
+
+TEST_CASE("add_cfunc_jac")
+{
+    auto tester = [](auto fp_x, std::uint32_t batch_size) {
+        using std::cos;
+        using std::exp;
+        using std::sin;
+        using fp_t = decltype(fp_x);
+
+        auto [x, y, z] = make_vars("x", "y", "z");
+
+        llvm_state s;
+
+        const auto vars
+            = add_cfunc_jac<fp_t>(s, "jac", {x * y + sin(x * y), exp(y) / x, par[0] * x - y, 3_dbl}, {x, y, z},
+                                  batch_size);
+        REQUIRE(vars == std::vector{x, y, z});
+
+        s.compile();
+
+        auto f = reinterpret_cast<void (*)(fp_t *, const fp_t *, const fp_t *, std::uint64_t)>(s.jit_lookup("jac"));
+
+        // Evaluate over batch_size points, with stride batch_size.
+        std::uniform_real_distribution<double> dist(.5, 2.);
+        std::vector<fp_t> in(3u * batch_size), out(12u * batch_size);
+        for (auto &v : in) {
+            v = fp_t(dist(rng));
+        }
+        const std::vector<fp_t> pars{fp_t(3)};
+
+        f(out.data(), in.data(), pars.data(), batch_size);
+
+        for (std::uint32_t i = 0; i < batch_size; ++i) {
+            const auto xv = in[i], yv = in[batch_size + i];
+
+            auto jac = [&](std::uint32_t row) { return out[row * batch_size + i]; };
+
+            REQUIRE(jac(0) == approximately(yv + yv * cos(xv * yv)));
+            REQUIRE(jac(1) == approximately(xv + xv * cos(xv * yv)));
+            REQUIRE(jac(2) == 0);
+            REQUIRE(jac(3) == approximately(-exp(yv) / (xv * xv)));
+            REQUIRE(jac(4) == approximately(exp(yv) / xv));
+            REQUIRE(jac(5) == 0);
+            REQUIRE(jac(6) == 3);
+            REQUIRE(jac(7) == -1);
+            REQUIRE(jac(8) == 0);
+            REQUIRE(jac(9) == 0);
+            REQUIRE(jac(10) == 0);
+            REQUIRE(jac(11) == 0);
+        }
+    };
+
+    for (auto batch_size : {1u, 2u, 4u}) {
+        tuple_for_each(fp_types, [&tester, batch_size](auto x) { tester(x, batch_size); });
+    }
+}
+
+TEST_CASE("add_cfunc_par_jac")
+{
+    auto tester = [](auto fp_x, std::uint32_t batch_size) {
+        using std::cos;
+        using std::exp;
+        using std::sin;
+        using fp_t = decltype(fp_x);
+
+        auto [x, y] = make_vars("x", "y");
+
+        llvm_state s;
+
+        const auto vars = add_cfunc_par_jac<fp_t>(
+            s, "par_jac", {par[0] * sin(par[1] * x), exp(par[1]) / y, x - y}, {x, y}, batch_size);
+        REQUIRE(vars == std::vector{x, y});
+
+        s.compile();
+
+        auto f
+            = reinterpret_cast<void (*)(fp_t *, const fp_t *, const fp_t *, std::uint64_t)>(s.jit_lookup("par_jac"));
+
+        std::uniform_real_distribution<double> dist(.5, 2.);
+        std::vector<fp_t> in(2u * batch_size), out(9u * batch_size);
+        for (auto &v : in) {
+            v = fp_t(dist(rng));
+        }
+        const std::vector<fp_t> pars{fp_t(3), fp_t(.5)};
+
+        f(out.data(), in.data(), pars.data(), batch_size);
+
+        for (std::uint32_t i = 0; i < batch_size; ++i) {
+            const auto xv = in[i], yv = in[batch_size + i];
+            const auto p0 = pars[0], p1 = pars[1];
+
+            auto val = [&](std::uint32_t row) { return out[row * batch_size + i]; };
+
+            // Each expression is followed by its derivatives
+            // with respect to par[0] and par[1].
+            REQUIRE(val(0) == approximately(p0 * sin(p1 * xv)));
+            REQUIRE(val(1) == approximately(sin(p1 * xv)));
+            REQUIRE(val(2) == approximately(p0 * xv * cos(p1 * xv)));
+            REQUIRE(val(3) == approximately(exp(p1) / yv));
+            REQUIRE(val(4) == 0);
+            REQUIRE(val(5) == approximately(exp(p1) / yv));
+            REQUIRE(val(6) == approximately(xv - yv));
+            REQUIRE(val(7) == 0);
+            REQUIRE(val(8) == 0);
+        }
+    };
+
+    for (auto batch_size : {1u, 2u, 4u}) {
+        tuple_for_each(fp_types, [&tester, batch_size](auto x) { tester(x, batch_size); });
+    }
+}
+
+TEST_CASE("compiled population")
+{
+    using Catch::Matchers::Message;
+
+    auto tester = [](auto fp_x, std::uint32_t batch_size) {
+        using std::cos;
+        using std::exp;
+        using fp_t = decltype(fp_x);
+
+        auto [x, y] = make_vars("x", "y");
+
+        const std::vector pop{x * y + cos(x * y), exp(y) - par[0], 3_dbl, x / (y + 2_dbl)};
+
+        compiled_population<fp_t> cp{pop, kw::batch_size = batch_size};
+
+        REQUIRE(cp.get_vars() == std::vector{x, y});
+        REQUIRE(cp.get_pop() == pop);
+        REQUIRE(cp.get_llvm_state().opt_level() == 1u);
+        if (batch_size != 0u) {
+            REQUIRE(cp.get_batch_size() == batch_size);
+        } else {
+            REQUIRE(cp.get_batch_size() > 0u);
+        }
+
+        // Compare to a compiled function, with a number
+        // of points which is not a multiple of the batch size.
+        compiled_function<fp_t> cf{pop, kw::batch_size = batch_size};
+
+        const auto n_points = 37u;
+        std::uniform_real_distribution<double> dist(-1., 1.);
+        std::vector<fp_t> in(2u * n_points), out, out_cf;
+        for (auto &v : in) {
+            v = fp_t(dist(rng));
+        }
+
+        cp.eval_batch(out, in, n_points, {fp_t(3)});
+        cf.eval_batch(out_cf, in, n_points, {fp_t(3)});
+        REQUIRE(out.size() == pop.size() * n_points);
+
+        for (decltype(out.size()) i = 0; i < out.size(); ++i) {
+            REQUIRE(out[i] == approximately(out_cf[i]));
+        }
+
+        // Evaluation of a single expression.
+        std::vector<fp_t> out1(n_points);
+        const std::vector<fp_t> pars{fp_t(3)};
+        cp.eval_batch(1, out1.data(), in.data(), n_points, pars.data());
+        for (auto i = 0u; i < n_points; ++i) {
+            REQUIRE(out1[i] == out[n_points + i]);
+        }
+
+        // Copy semantics.
+        auto cp2 = cp;
+        std::vector<fp_t> out2;
+        cp2.eval_batch(out2, in, n_points, {fp_t(3)});
+        REQUIRE(out2 == out);
+
+        // Error checking.
+        REQUIRE_THROWS_MATCHES(
+            cp.eval_batch(4, out1.data(), in.data(), n_points, pars.data()), std::invalid_argument,
+            Message("Invalid index 4 passed to the evaluation of a compiled population of size 4"));
+        REQUIRE_THROWS_MATCHES(cp.eval_batch(out, in, n_points), std::invalid_argument,
+                               Message("Invalid array of parameters passed to the batch evaluation of a compiled "
+                                       "population: the number of parameters is 1, but the size of the array of "
+                                       "parameters is 0"));
+        REQUIRE_THROWS_AS(cp.eval_batch(out, in, n_points + 1u, {fp_t(3)}), std::invalid_argument);
+    };
+
+    for (auto batch_size : {0u, 1u, 4u}) {
+        tuple_for_each(fp_types, [&tester, batch_size](auto x) { tester(x, batch_size); });
+    }
+
+    // Explicit optimisation level and empty population.
+    compiled_population<double> cp{{}, kw::opt_level = 3u};
+    REQUIRE(cp.get_llvm_state().opt_level() == 3u);
+    REQUIRE(cp.get_pop().empty());
+}
@@ -0,0 +1,541 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <tuple>
+#include <vector>
+
+#include <heyoka/ensemble_propagate.hpp>
+#include <heyoka/executor.hpp>
+#include <heyoka/expression.hpp>
+#include <heyoka/math/sin.hpp>
+#include <heyoka/taylor.hpp>
+
+#include "catch.hpp"
+#include "test_utils.hpp"
+
+using namespace heyoka;
+using namespace heyoka_test;
+
+TEST_CASE("ensemble propagate until")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    for (auto cm : {false, true}) {
+        for (auto n_threads : {0u, 1u, 3u}) {
+            auto tmpl = taylor_adaptive<double>{
+                {prime(x) = v, prime(v) = -9.8 * sin(x)}, {0.05, 0.025}, kw::compact_mode = cm};
+
+            // Vary the initial amplitude with the iteration index.
+            auto gen = [](taylor_adaptive<double> &ta, std::size_t i) {
+                ta.get_state_data()[0] += static_cast<double>(i) / 100.;
+            };
+
+            const auto res = ensemble_propagate_until<double>(tmpl, 10., 20, gen, 0, n_threads);
+
+            REQUIRE(res.size() == 20u);
+
+            // The template is not altered.
+            REQUIRE(tmpl.get_time() == 0.);
+            REQUIRE(tmpl.get_state() == std::vector{0.05, 0.025});
+
+            // Compare with serial propagations.
+            for (std::size_t i = 0; i < 20u; ++i) {
+                auto ta = tmpl;
+                gen(ta, i);
+                const auto [oc, min_h, max_h, n_steps] = ta.propagate_until(10.);
+
+                REQUIRE(std::get<0>(res[i]) == oc);
+                REQUIRE(std::get<1>(res[i]) == min_h);
+                REQUIRE(std::get<2>(res[i]) == max_h);
+                REQUIRE(std::get<3>(res[i]) == n_steps);
+                REQUIRE(std::get<4>(res[i]) == 10.);
+                REQUIRE(std::get<5>(res[i]) == ta.get_state());
+            }
+        }
+    }
+
+    // Terminal events in the workers.
+    {
+        using ev_t = taylor_adaptive<double>::t_event_t;
+
+        auto tmpl = taylor_adaptive<double>{
+            {prime(x) = v, prime(v) = -9.8 * sin(x)},
+            {0.05, 0.025},
+            kw::t_events = std::vector<ev_t>{ev_t(x, kw::direction = event_direction::positive)}};
+
+        const auto res = ensemble_propagate_until<double>(
+            tmpl, 10., 8, [](auto &, std::size_t) {}, 0, 4);
+
+        for (const auto &r : res) {
+            REQUIRE(std::get<0>(r) == taylor_outcome::terminal_event);
+            REQUIRE(std::get<4>(r) == std::get<4>(res[0]));
+        }
+    }
+
+    // Corner cases and error modes.
+    auto tmpl = taylor_adaptive<double>{{prime(x) = v, prime(v) = -9.8 * sin(x)}, {0.05, 0.025}};
+
+    REQUIRE(ensemble_propagate_until<double>(
+                tmpl, 10., 0, [](auto &, std::size_t) {})
+                .empty());
+    REQUIRE_THROWS_AS(ensemble_propagate_until<double>(tmpl, 10., 10, {}), std::invalid_argument);
+    REQUIRE_THROWS_AS(ensemble_propagate_until<double>(
+                          tmpl, 10., 10,
+                          [](auto &, std::size_t i) {
+                              if (i == 5u) {
+                                  throw std::runtime_error("");
+                              }
+                          },
+                          0, 2),
+                      std::runtime_error);
+}
+
+TEST_CASE("ensemble propagate until batch")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    for (auto cm : {false, true}) {
+        for (auto n_threads : {0u, 1u, 3u}) {
+            auto tmpl = taylor_adaptive_batch<double>{{prime(x) = v, prime(v) = -9.8 * sin(x)},
+                                                      {0.05, 0.06, 0.07, 0.08, 0.025, 0.026, 0.027, 0.028},
+                                                      4,
+                                                      kw::compact_mode = cm};
+
+            // Vary the initial amplitude with the iteration index.
+            // NOTE: with large amplitudes, the propagations require
+            // a different number of steps.
+            auto gen = [](taylor_adaptive_batch<double> &ta, std::uint32_t lane, std::size_t i) {
+                ta.get_state_data()[lane] += static_cast<double>(i) / 10.;
+            };
+
+            const auto res = ensemble_propagate_until_batch<double>(tmpl, 10., 13, gen, 0, n_threads);
+
+            REQUIRE(res.size() == 13u);
+
+            // Compare with scalar propagations. In order to determine the
+            // initial conditions, we need to know which batch slot was
+            // used for each iteration: we just try all of them.
+            for (std::size_t i = 0; i < 13u; ++i) {
+                auto found = false;
+
+                for (std::uint32_t lane = 0; lane < 4u; ++lane) {
+                    auto ta = taylor_adaptive<double>{{prime(x) = v, prime(v) = -9.8 * sin(x)},
+                                                      {tmpl.get_state()[lane] + static_cast<double>(i) / 10.,
+                                                       tmpl.get_state()[4u + lane]},
+                                                      kw::compact_mode = cm};
+                    const auto [oc, min_h, max_h, n_steps] = ta.propagate_until(10.);
+
+                    if (std::get<5>(res[i])[0] == approximately(ta.get_state()[0], 1000.)
+                        && std::get<5>(res[i])[1] == approximately(ta.get_state()[1], 1000.)) {
+                        found = true;
+
+                        REQUIRE(std::get<0>(res[i]) == oc);
+                        REQUIRE(std::get<1>(res[i]) == approximately(min_h, 1000.));
+                        REQUIRE(std::get<2>(res[i]) == approximately(max_h, 1000.));
+                        REQUIRE(std::get<3>(res[i]) == n_steps);
+                        REQUIRE(std::get<4>(res[i]) == approximately(10.));
+
+                        break;
+                    }
+                }
+
+                REQUIRE(found);
+            }
+
+            // The template is not altered.
+            REQUIRE(tmpl.get_time() == std::vector<double>(4, 0.));
+            REQUIRE(tmpl.get_state() == std::vector{0.05, 0.06, 0.07, 0.08, 0.025, 0.026, 0.027, 0.028});
+        }
+    }
+
+    auto tmpl
+        = taylor_adaptive_batch<double>{{prime(x) = v, prime(v) = -9.8 * sin(x)}, {0.05, 0.06, 0.025, 0.026}, 2};
+
+    // Step limit.
+    {
+        const auto res = ensemble_propagate_until_batch<double>(
+            tmpl, 10., 5, [](auto &, std::uint32_t, std::size_t) {}, 3, 1);
+
+        for (const auto &r : res) {
+            REQUIRE(std::get<0>(r) == taylor_outcome::step_limit);
+            REQUIRE(std::get<3>(r) == 3u);
+        }
+    }
+
+    // Corner cases and error modes.
+    REQUIRE(ensemble_propagate_until_batch<double>(
+                tmpl, 10., 0, [](auto &, std::uint32_t, std::size_t) {})
+                .empty());
+    REQUIRE_THROWS_AS(ensemble_propagate_until_batch<double>(tmpl, 10., 10, {}), std::invalid_argument);
+    REQUIRE_THROWS_AS(ensemble_propagate_until_batch<double>(
+                          tmpl, std::numeric_limits<double>::infinity(), 10, [](auto &, std::uint32_t, std::size_t) {}),
+                      std::invalid_argument);
+    REQUIRE_THROWS_AS(ensemble_propagate_until_batch<double>(
+                          tmpl, 10., 10,
+                          [](auto &ta, std::uint32_t lane, std::size_t i) {
+                              if (i == 5u) {
+                                  ta.get_time_data()[lane] = std::numeric_limits<double>::quiet_NaN();
+                              }
+                          },
+                          0, 2),
+                      std::invalid_argument);
+    REQUIRE_THROWS_AS(ensemble_propagate_until_batch<double>(
+                          tmpl, 10., 10,
+                          [](auto &, std::uint32_t, std::size_t i) {
+                              if (i == 5u) {
+                                  throw std::runtime_error("");
+                              }
+                          },
+                          0, 2),
+                      std::runtime_error);
+}
+
+TEST_CASE("ensemble sweep pars batch")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    for (auto n_threads : {0u, 1u, 3u}) {
+        auto tmpl = taylor_adaptive_batch<double>{
+            {prime(x) = v, prime(v) = -par[0] * sin(x) - par[1] * v}, {0.05, 0.05, 0.025, 0.025}, 2};
+
+        // 7 parameter sets.
+        std::vector<double> pars;
+        for (auto i = 0; i < 7; ++i) {
+            pars.push_back(9.8 + i / 10.);
+            pars.push_back(i / 100.);
+        }
+
+        const auto [ocs, states] = ensemble_sweep_pars_batch<double>(tmpl, 10., pars, 0, n_threads);
+
+        REQUIRE(ocs.size() == 7u);
+        REQUIRE(states.size() == 14u);
+
+        // Compare with scalar propagations.
+        for (std::size_t i = 0; i < 7u; ++i) {
+            auto ta = taylor_adaptive<double>{{prime(x) = v, prime(v) = -par[0] * sin(x) - par[1] * v},
+                                              {0.05, 0.025},
+                                              kw::pars = std::vector{pars[2u * i], pars[2u * i + 1u]}};
+            const auto oc = std::get<0>(ta.propagate_until(10.));
+
+            REQUIRE(ocs[i] == oc);
+            REQUIRE(states[2u * i] == approximately(ta.get_state()[0], 1000.));
+            REQUIRE(states[2u * i + 1u] == approximately(ta.get_state()[1], 1000.));
+        }
+    }
+
+    // Corner cases and error modes.
+    auto tmpl = taylor_adaptive_batch<double>{
+        {prime(x) = v, prime(v) = -par[0] * sin(x)}, {0.05, 0.05, 0.025, 0.025}, 2};
+
+    const auto [ocs, states] = ensemble_sweep_pars_batch<double>(tmpl, 10., {});
+    REQUIRE(ocs.empty());
+    REQUIRE(states.empty());
+
+    auto tmpl_nopars
+        = taylor_adaptive_batch<double>{{prime(x) = v, prime(v) = -9.8 * sin(x)}, {0.05, 0.05, 0.025, 0.025}, 2};
+    REQUIRE_THROWS_AS(ensemble_sweep_pars_batch<double>(tmpl_nopars, 10., {1., 2.}), std::invalid_argument);
+
+    auto tmpl2 = taylor_adaptive_batch<double>{
+        {prime(x) = v, prime(v) = -par[0] * sin(x) - par[1] * v}, {0.05, 0.05, 0.025, 0.025}, 2};
+    REQUIRE_THROWS_AS(ensemble_sweep_pars_batch<double>(tmpl2, 10., {1., 2., 3.}), std::invalid_argument);
+}
+
+TEST_CASE("ensemble propagate jobs batch")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    const auto sys = {prime(x) = v, prime(v) = -par[0] * sin(x)};
+
+    // Jobs with different initial conditions, params and time ranges.
+    std::vector<propagate_job<double>> jobs;
+    for (auto i = 0; i < 9; ++i) {
+        jobs.push_back(propagate_job<double>{{0.05 + i / 10., 0.025}, {9.8 - i / 10.}, i / 2., 5. + i});
+    }
+
+    for (auto n_threads : {0u, 1u, 2u}) {
+        auto tmpl = taylor_adaptive_batch<double>{sys, std::vector<double>(8, 0.), 4};
+
+        const auto res = ensemble_propagate_jobs_batch<double>(tmpl, jobs, 0, n_threads);
+
+        REQUIRE(res.size() == 9u);
+
+        // Compare with scalar propagations.
+        for (std::size_t i = 0; i < 9u; ++i) {
+            auto ta = taylor_adaptive<double>{sys, jobs[i].state, kw::time = jobs[i].time, kw::pars = jobs[i].pars};
+            const auto [oc, min_h, max_h, n_steps] = ta.propagate_until(jobs[i].final_time);
+
+            REQUIRE(std::get<0>(res[i]) == oc);
+            REQUIRE(std::get<3>(res[i]) == n_steps);
+            REQUIRE(std::get<4>(res[i]) == approximately(jobs[i].final_time));
+            REQUIRE(std::get<5>(res[i])[0] == approximately(ta.get_state()[0], 1000.));
+            REQUIRE(std::get<5>(res[i])[1] == approximately(ta.get_state()[1], 1000.));
+        }
+    }
+
+    // Error modes.
+    auto tmpl = taylor_adaptive_batch<double>{sys, std::vector<double>(4, 0.), 2};
+
+    REQUIRE(ensemble_propagate_jobs_batch<double>(tmpl, {}).empty());
+    REQUIRE_THROWS_AS(ensemble_propagate_jobs_batch<double>(tmpl, {propagate_job<double>{{1.}, {1.}, 0., 1.}}),
+                      std::invalid_argument);
+    REQUIRE_THROWS_AS(ensemble_propagate_jobs_batch<double>(tmpl, {propagate_job<double>{{1., 2.}, {}, 0., 1.}}),
+                      std::invalid_argument);
+    REQUIRE_THROWS_AS(ensemble_propagate_jobs_batch<double>(
+                          tmpl, {propagate_job<double>{{1., 2.}, {1.}, 0., std::numeric_limits<double>::infinity()}}),
+                      std::invalid_argument);
+}
+
+// Distribution of an ensemble across processes: the template
+// is serialised, and each process works on a chunk of the iterations.
+TEST_CASE("ensemble propagate until chunks")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    auto tmpl = taylor_adaptive<double>{{prime(x) = v, prime(v) = -9.8 * sin(x)}, {0.05, 0.025}};
+
+    auto gen = [](taylor_adaptive<double> &ta, std::size_t i) {
+        ta.get_state_data()[0] += static_cast<double>(i) / 100.;
+    };
+
+    const auto res = ensemble_propagate_until<double>(tmpl, 10., 20, gen);
+
+    std::stringstream ss;
+    tmpl.save(ss);
+    const auto bytes = ss.str();
+
+    for (std::size_t begin = 0; begin < 20u; begin += 7u) {
+        const auto end = std::min<std::size_t>(begin + 7u, 20u);
+
+        std::stringstream iss(bytes);
+        taylor_adaptive<double> tmpl2;
+        tmpl2.load(iss);
+
+        // The loaded template is not recompiled.
+        REQUIRE(tmpl2.get_llvm_state().stats().opt_time == 0.);
+        REQUIRE(tmpl2.get_llvm_state().stats().codegen_time == 0.);
+
+        const auto res_chunk = ensemble_propagate_until<double>(
+            tmpl2, 10., end - begin, [&](taylor_adaptive<double> &ta, std::size_t i) { gen(ta, begin + i); });
+
+        for (auto i = begin; i < end; ++i) {
+            REQUIRE(res_chunk[i - begin] == res[i]);
+        }
+    }
+}
+
+TEST_CASE("ensemble stats")
+{
+    // Compare with the two-pass computation.
+    const std::vector<std::vector<double>> samples{{1., 2.}, {-1., 0.5}, {3., 3.}, {0.25, -2.}, {2., 1.}};
+
+    auto check = [&samples](const ensemble_stats<double> &st, std::size_t begin, std::size_t end) {
+        const auto n = static_cast<double>(end - begin);
+
+        REQUIRE(st.get_count() == end - begin);
+
+        std::vector<double> mean(2);
+        for (auto k = begin; k < end; ++k) {
+            mean[0] += samples[k][0] / n;
+            mean[1] += samples[k][1] / n;
+        }
+
+        for (auto i = 0u; i < 2u; ++i) {
+            REQUIRE(st.get_mean()[i] == approximately(mean[i]));
+        }
+
+        const auto cov = st.get_cov();
+        for (auto i = 0u; i < 2u; ++i) {
+            for (auto j = 0u; j < 2u; ++j) {
+                double c = 0;
+                for (auto k = begin; k < end; ++k) {
+                    c += (samples[k][i] - mean[i]) * (samples[k][j] - mean[j]) / (n - 1.);
+                }
+
+                REQUIRE(cov[i * 2u + j] == approximately(c));
+            }
+        }
+    };
+
+    ensemble_stats<double> st(2, 4, {-2., -2.}, {2., 2.}), st0(2, 4, {-2., -2.}, {2., 2.}),
+        st1(2, 4, {-2., -2.}, {2., 2.});
+    for (std::size_t k = 0; k < samples.size(); ++k) {
+        st.add(samples[k].data());
+        (k < 2u ? st0 : st1).add(samples[k].data());
+    }
+
+    check(st, 0, 5);
+    check(st0, 0, 2);
+
+    // Merging.
+    st0.merge(st1);
+    check(st0, 0, 5);
+    st0.merge(ensemble_stats<double>(2, 4, {-2., -2.}, {2., 2.}));
+    check(st0, 0, 5);
+
+    // The histograms (the values outside the bounds are not counted).
+    REQUIRE(st.get_hist() == std::vector<std::size_t>{0, 1, 1, 1, 1, 0, 1, 1});
+    REQUIRE(st0.get_hist() == st.get_hist());
+
+    // Strided samples.
+    ensemble_stats<double> st_s(2);
+    const std::vector<double> strided{1., 42., 2., 42.};
+    st_s.add(strided.data(), 2);
+    REQUIRE(st_s.get_mean() == std::vector{1., 2.});
+    REQUIRE(st_s.get_n_bins() == 0u);
+    REQUIRE(st_s.get_hist().empty());
+
+    // Errors.
+    REQUIRE_THROWS_AS(st_s.get_cov(), std::invalid_argument);
+    REQUIRE_THROWS_AS(st_s.merge(st), std::invalid_argument);
+    REQUIRE_THROWS_AS(ensemble_stats<double>(2, 0, {-2., -2.}, {2., 2.}), std::invalid_argument);
+    REQUIRE_THROWS_AS(ensemble_stats<double>(2, 4, {-2.}, {2., 2.}), std::invalid_argument);
+    REQUIRE_THROWS_AS(ensemble_stats<double>(2, 4, {-2., 2.}, {2., 2.}), std::invalid_argument);
+}
+
+TEST_CASE("ensemble propagate stats")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    const auto sys = std::vector{prime(x) = v, prime(v) = -9.8 * sin(x)};
+
+    auto gen = [](taylor_adaptive<double> &ta, std::size_t i) {
+        ta.get_state_data()[0] += static_cast<double>(i) / 100.;
+    };
+    auto gen_batch = [](taylor_adaptive_batch<double> &ta, std::uint32_t lane, std::size_t i) {
+        ta.get_state_data()[lane] += static_cast<double>(i) / 100.;
+    };
+
+    // Check the accumulator st against the states in res.
+    auto check = [](const ensemble_stats<double> &st, const auto &res) {
+        ensemble_stats<double> ref(2);
+        for (const auto &r : res) {
+            ref.add(std::get<5>(r).data());
+        }
+
+        REQUIRE(st.get_count() == ref.get_count());
+        for (auto i = 0u; i < 2u; ++i) {
+            REQUIRE(st.get_mean()[i] == approximately(ref.get_mean()[i], 1000.));
+        }
+        for (auto i = 0u; i < 4u; ++i) {
+            REQUIRE(st.get_cov()[i] == approximately(ref.get_cov()[i], 1000.));
+        }
+    };
+
+    for (auto n_threads : {0u, 1u, 3u}) {
+        auto tmpl = taylor_adaptive<double>{sys, {0.05, 0.025}};
+
+        const auto res = ensemble_propagate_until<double>(tmpl, 10., 20, gen, 0, n_threads);
+        const auto [st, failed]
+            = ensemble_propagate_until_stats<double>(tmpl, 10., 20, gen, ensemble_stats<double>(2), 0, n_threads);
+
+        REQUIRE(failed.empty());
+        check(st, res);
+
+        // Failed iterations.
+        const auto [st_f, failed_f]
+            = ensemble_propagate_until_stats<double>(tmpl, 10., 20, gen, ensemble_stats<double>(2), 1, n_threads);
+        REQUIRE(st_f.get_count() == 0u);
+        REQUIRE(failed_f.size() == 20u);
+        REQUIRE(std::is_sorted(failed_f.begin(), failed_f.end()));
+
+        // Grid.
+        const auto st_g = ensemble_propagate_grid_stats<double>(tmpl, {0., 5., 10.}, 20, gen,
+                                                                ensemble_stats<double>(2), 0, n_threads);
+        REQUIRE(st_g.size() == 3u);
+        REQUIRE(st_g[0].get_count() == 20u);
+        REQUIRE(st_g[0].get_mean()[0] == approximately(0.05 + 0.095));
+        check(st_g[2], res);
+
+        // Batch.
+        auto tmpl_b = taylor_adaptive_batch<double>{sys, {0.05, 0.05, 0.025, 0.025}, 2};
+
+        const auto res_b = ensemble_propagate_until_batch<double>(tmpl_b, 10., 13, gen_batch, 0, n_threads);
+        const auto [st_b, failed_b] = ensemble_propagate_until_batch_stats<double>(
+            tmpl_b, 10., 13, gen_batch, ensemble_stats<double>(2), 0, n_threads);
+
+        REQUIRE(failed_b.empty());
+        check(st_b, res_b);
+    }
+
+    // Errors.
+    auto tmpl = taylor_adaptive<double>{sys, {0.05, 0.025}};
+
+    REQUIRE_THROWS_AS(ensemble_propagate_until_stats<double>(tmpl, 10., 20, gen, ensemble_stats<double>(3)),
+                      std::invalid_argument);
+
+    ensemble_stats<double> non_empty(2);
+    non_empty.add(tmpl.get_state().data());
+    REQUIRE_THROWS_AS(ensemble_propagate_until_stats<double>(tmpl, 10., 20, gen, non_empty), std::invalid_argument);
+    REQUIRE_THROWS_AS(ensemble_propagate_until_stats<double>(tmpl, 10., 20, {}, ensemble_stats<double>(2)),
+                      std::invalid_argument);
+}
+
+TEST_CASE("ensemble propagate pinned")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    auto tmpl = taylor_adaptive<double>{{prime(x) = v, prime(v) = -9.8 * sin(x)}, {0.05, 0.025}};
+
+    auto gen = [](taylor_adaptive<double> &ta, std::size_t i) {
+        ta.get_state_data()[0] += static_cast<double>(i) / 100.;
+    };
+
+    const auto ref = ensemble_propagate_until<double>(tmpl, 10., 20, gen, 0, 3);
+
+    const auto orig = get_thread_config();
+
+    // The pinning policy and the default number
+    // of threads do not alter the results.
+    for (auto p : {pin_policy::compact, pin_policy::scatter}) {
+        set_thread_config({2, p});
+
+        REQUIRE(ensemble_propagate_until<double>(tmpl, 10., 20, gen, 0, 3) == ref);
+        REQUIRE(ensemble_propagate_until<double>(tmpl, 10., 20, gen) == ref);
+    }
+
+    set_thread_config(orig);
+}
+
+// The copies of the template are created in the worker
+// threads, and their exceptions propagate to the caller.
+TEST_CASE("ensemble propagate worker copy error")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    // NOTE: in compact mode, the integrators cannot be
+    // copied after the IR snapshot has been dropped.
+    auto tmpl = taylor_adaptive<double>{
+        {prime(x) = v, prime(v) = -9.8 * sin(x)}, {0.05, 0.025}, kw::compact_mode = true};
+    tmpl.drop_ir_snapshot();
+
+    auto gen = [](taylor_adaptive<double> &, std::size_t) {};
+
+    for (auto n_threads : {1u, 3u}) {
+        REQUIRE_THROWS_AS(ensemble_propagate_until<double>(tmpl, 10., 20, gen, 0, n_threads), std::invalid_argument);
+    }
+
+    auto tmpl_batch = taylor_adaptive_batch<double>{{prime(x) = v, prime(v) = -9.8 * sin(x)},
+                                                    {0.05, 0.06, 0.025, 0.026},
+                                                    2,
+                                                    kw::compact_mode = true};
+    tmpl_batch.drop_ir_snapshot();
+
+    auto gen_batch = [](taylor_adaptive_batch<double> &, std::uint32_t, std::size_t) {};
+
+    for (auto n_threads : {1u, 3u}) {
+        REQUIRE_THROWS_AS(ensemble_propagate_until_batch<double>(tmpl_batch, 10., 20, gen_batch, 0, n_threads),
+                          std::invalid_argument);
+    }
+}
@@ -0,0 +1,204 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <future>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <tuple>
+#include <vector>
+
+#if defined(__linux__)
+
+#include <pthread.h>
+#include <sched.h>
+
+#endif
+
+#include <heyoka/executor.hpp>
+#include <heyoka/expression.hpp>
+#include <heyoka/math/sin.hpp>
+#include <heyoka/taylor.hpp>
+
+#include "catch.hpp"
+#include "test_utils.hpp"
+
+using namespace heyoka;
+using namespace heyoka_test;
+
+TEST_CASE("executor")
+{
+    std::atomic<int> counter(0);
+
+    {
+        executor ex(3);
+        REQUIRE(ex.get_n_threads() == 3u);
+
+        for (auto i = 0; i < 100; ++i) {
+            ex.submit([&counter]() { ++counter; });
+        }
+
+        // The exceptions thrown by the tasks are discarded.
+        ex.submit([]() { throw std::runtime_error(""); });
+
+        REQUIRE_THROWS_AS(ex.submit({}), std::invalid_argument);
+
+        // NOTE: the destructor waits for the pending tasks.
+    }
+
+    REQUIRE(counter == 100);
+
+    REQUIRE(executor{}.get_n_threads() > 0u);
+    REQUIRE(default_executor().get_n_threads() > 0u);
+}
+
+TEST_CASE("propagate async")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    const auto sys = {prime(x) = v, prime(v) = -9.8 * sin(x)};
+
+    executor ex(2);
+
+    // Several integrators propagated concurrently.
+    std::vector<taylor_adaptive<double>> tas;
+    for (auto i = 0; i < 4; ++i) {
+        tas.emplace_back(sys, std::vector{0.05 + i / 100., 0.025});
+    }
+    auto ta_ref = tas;
+
+    std::vector<std::future<std::tuple<taylor_outcome, double, double, std::size_t>>> futs;
+    for (auto &ta : tas) {
+        futs.push_back(propagate_until_async(ta, 10., 0, ex));
+    }
+
+    for (auto i = 0u; i < 4u; ++i) {
+        const auto res = futs[i].get();
+        const auto ref = ta_ref[i].propagate_until(10.);
+
+        REQUIRE(res == ref);
+        REQUIRE(tas[i].get_state() == ta_ref[i].get_state());
+    }
+
+    // propagate_for_async(), with the default executor.
+    {
+        auto ta = taylor_adaptive<double>{sys, {0.05, 0.025}};
+        REQUIRE(std::get<0>(propagate_for_async(ta, 5.).get()) == taylor_outcome::time_limit);
+        REQUIRE(ta.get_time() == approximately(5.));
+    }
+
+    // Exceptions are transported via the futures.
+    {
+        auto ta = taylor_adaptive<double>{sys, {0.05, 0.025}};
+        auto fut = propagate_until_async(ta, std::numeric_limits<double>::infinity(), 0, ex);
+        REQUIRE_THROWS_AS(fut.get(), std::invalid_argument);
+    }
+
+    // Batch mode.
+    {
+        auto tab = taylor_adaptive_batch<double>{sys, {0.05, 0.06, 0.025, 0.026}, 2};
+        auto tab_ref = tab;
+
+        const auto res = propagate_until_async<double>(tab, {10., 11.}, 0, ex).get();
+        REQUIRE(res == tab_ref.propagate_until({10., 11.}));
+        REQUIRE(tab.get_state() == tab_ref.get_state());
+
+        const auto res_for = propagate_for_async<double>(tab, {1., 2.}, 0, ex).get();
+        REQUIRE(res_for == tab_ref.propagate_for({1., 2.}));
+        REQUIRE(tab.get_time() == tab_ref.get_time());
+    }
+}
+
+TEST_CASE("thread config")
+{
+    const auto orig = get_thread_config();
+
+    std::ostringstream oss;
+    oss << pin_policy::none << pin_policy::compact << pin_policy::scatter;
+    REQUIRE(oss.str() == "nonecompactscatter");
+
+    set_thread_config({2, pin_policy::compact});
+    REQUIRE(get_thread_config().n_threads == 2u);
+    REQUIRE(get_thread_config().pinning == pin_policy::compact);
+
+    // The executors use the configuration.
+    {
+        executor ex;
+        REQUIRE(ex.get_n_threads() == 2u);
+        REQUIRE(ex.get_pin_policy() == pin_policy::compact);
+    }
+
+    REQUIRE_THROWS_AS(set_thread_config({0, static_cast<pin_policy>(100)}), std::invalid_argument);
+    REQUIRE_THROWS_AS(executor(1, static_cast<pin_policy>(100)), std::invalid_argument);
+
+    set_thread_config(orig);
+
+    // Parsing of the environment variables.
+    ::setenv("HEYOKA_NUM_THREADS", "3", 1);
+    ::setenv("HEYOKA_PIN_POLICY", "scatter", 1);
+    REQUIRE(detail::thread_config_from_env().n_threads == 3u);
+    REQUIRE(detail::thread_config_from_env().pinning == pin_policy::scatter);
+
+    ::setenv("HEYOKA_NUM_THREADS", "3x", 1);
+    REQUIRE_THROWS_AS(detail::thread_config_from_env(), std::invalid_argument);
+    ::setenv("HEYOKA_NUM_THREADS", "", 1);
+    ::setenv("HEYOKA_PIN_POLICY", "spread", 1);
+    REQUIRE_THROWS_AS(detail::thread_config_from_env(), std::invalid_argument);
+
+    ::unsetenv("HEYOKA_NUM_THREADS");
+    ::unsetenv("HEYOKA_PIN_POLICY");
+    REQUIRE(detail::thread_config_from_env().n_threads == 0u);
+    REQUIRE(detail::thread_config_from_env().pinning == pin_policy::none);
+
+#if defined(__linux__)
+    // The workers of a pinned executor run on a single CPU each.
+    for (auto p : {pin_policy::compact, pin_policy::scatter}) {
+        std::atomic<int> n_single(0);
+
+        {
+            executor ex(3, p);
+
+            for (auto i = 0; i < 3; ++i) {
+                ex.submit([&n_single]() {
+                    ::cpu_set_t set;
+                    CPU_ZERO(&set);
+                    ::pthread_getaffinity_np(::pthread_self(), sizeof(set), &set);
+
+                    n_single += static_cast<int>(CPU_COUNT(&set) == 1);
+                });
+            }
+        }
+
+        REQUIRE(n_single == 3);
+    }
+
+    // The pin guard restores the original affinity.
+    {
+        ::cpu_set_t set;
+        CPU_ZERO(&set);
+        ::pthread_getaffinity_np(::pthread_self(), sizeof(set), &set);
+        const auto n_cpus = CPU_COUNT(&set);
+
+        {
+            const detail::thread_pin_guard pg(pin_policy::scatter, 1);
+            REQUIRE(pg.pinned());
+
+            CPU_ZERO(&set);
+            ::pthread_getaffinity_np(::pthread_self(), sizeof(set), &set);
+            REQUIRE(CPU_COUNT(&set) == 1);
+        }
+
+        CPU_ZERO(&set);
+        ::pthread_getaffinity_np(::pthread_self(), sizeof(set), &set);
+        REQUIRE(CPU_COUNT(&set) == n_cpus);
+    }
+#endif
+}
@@ -6,12 +6,26 @@
 // Public License v. 2.0. If a copy of the MPL was not distributed
 // with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
 
+#include <algorithm>
+#include <cmath>
 #include <cstddef>
+#include <cstdint>
 #include <limits>
+#include <memory>
+#include <sstream>
 #include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <variant>
+#include <vector>
 
 #include <heyoka/binary_operator.hpp>
+#include <heyoka/detail/traversal.hpp>
 #include <heyoka/expression.hpp>
+#include <heyoka/expression_arena.hpp>
+#include <heyoka/func.hpp>
+#include <heyoka/gp.hpp>
 #include <heyoka/llvm_state.hpp>
 #include <heyoka/math.hpp>
 #include <heyoka/number.hpp>
@@ -111,6 +125,119 @@ TEST_CASE("eval_batch_dbl")
     }
 }
 
+TEST_CASE("variable ids")
+{
+    auto x = variable{"x"}, y = variable{"y"};
+
+    REQUIRE(x.id() != y.id());
+    REQUIRE(variable{"x"}.id() == x.id());
+    REQUIRE(&variable{"x"}.name() == &x.name());
+    REQUIRE(x.name() == "x");
+
+    rename_variables(x, {{"x", "y"}});
+    REQUIRE(x == y);
+    REQUIRE(x.id() == y.id());
+    REQUIRE(x.name() == "y");
+
+    auto z = variable{"z"};
+    swap(x, z);
+    REQUIRE(x.name() == "z");
+    REQUIRE(z.name() == "y");
+}
+
+TEST_CASE("u variables")
+{
+    using detail::make_u_var;
+    using detail::uname_to_index;
+
+    // The u variables are the same variables
+    // constructed from their names.
+    REQUIRE(make_u_var(12345) == variable{"u_12345"});
+    REQUIRE(make_u_var(12345).name() == "u_12345");
+    REQUIRE(make_u_var(0) == variable{"u_0"});
+    REQUIRE(variable{"u_31"} == make_u_var(31));
+
+    REQUIRE(uname_to_index(make_u_var(12345)) == 12345u);
+    REQUIRE(uname_to_index(variable{"u_0"}) == 0u);
+    REQUIRE(uname_to_index(variable{"u_4000000000"}) == 4000000000u);
+    REQUIRE(make_u_var(4000000000u) == variable{"u_4000000000"});
+
+    // Non-canonical names.
+    REQUIRE(uname_to_index(variable{"u_007"}) == 7u);
+    REQUIRE(make_u_var(7) != variable{"u_007"});
+}
+
+TEST_CASE("eval by id")
+{
+    auto [x, y] = make_vars("x", "y");
+
+    const auto x_id = std::get<variable>(x.value()).id(), y_id = std::get<variable>(y.value()).id();
+
+    std::vector<double> in(std::max(x_id, y_id) + 1u);
+    in[x_id] = 2.345;
+    in[y_id] = -1.;
+
+    auto ex = x * y + cos(x * y) - 1. / par[0];
+    const std::vector<double> pars{2.};
+
+    REQUIRE(eval_dbl_by_id(ex, in.data(), in.size(), pars)
+            == eval_dbl(ex, {{"x", 2.345}, {"y", -1.}}, pars));
+    REQUIRE(eval_dbl_by_id(2.345_dbl, nullptr, 0) == 2.345);
+
+    REQUIRE_THROWS_AS(eval_dbl_by_id(ex, in.data(), std::min(x_id, y_id), pars), std::invalid_argument);
+
+    // Batch mode.
+    std::vector<double> in_batch(in.size() * 2u), out(2);
+    in_batch[x_id * 2u] = 3.;
+    in_batch[x_id * 2u + 1u] = 4.;
+    in_batch[y_id * 2u] = -1.;
+    in_batch[y_id * 2u + 1u] = -2.;
+
+    eval_batch_dbl_by_id(out.data(), ex, in_batch.data(), in.size(), 2, pars);
+
+    std::vector<double> out_map(2);
+    eval_batch_dbl(out_map, ex, {{"x", {3., 4.}}, {"y", {-1., -2.}}}, pars);
+    REQUIRE(out == out_map);
+
+    // Multiple blocks of points, with a partial last block.
+    {
+        const std::size_t n = 1300;
+
+        std::vector<double> xs(n), ys(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            xs[i] = static_cast<double>(i) / 100.;
+            ys[i] = -static_cast<double>(i) / 200.;
+        }
+
+        std::vector<double> in_big(in.size() * n), out_big(n), out_big_map(n);
+        std::copy(xs.begin(), xs.end(), in_big.begin() + static_cast<std::ptrdiff_t>(x_id * n));
+        std::copy(ys.begin(), ys.end(), in_big.begin() + static_cast<std::ptrdiff_t>(y_id * n));
+
+        eval_batch_dbl_by_id(out_big.data(), ex, in_big.data(), in.size(), n, pars);
+        eval_batch_dbl(out_big_map, ex, {{"x", xs}, {"y", ys}}, pars);
+        REQUIRE(out_big == out_big_map);
+
+        // Columnar evaluation.
+        std::vector<const double *> cols(in.size());
+        cols[x_id] = xs.data();
+        cols[y_id] = ys.data();
+
+        std::vector<double> out_cols(n);
+        eval_batch_dbl_cols(out_cols.data(), ex, cols, n, pars);
+        REQUIRE(out_cols == out_big_map);
+
+        // Null and missing columns.
+        cols[y_id] = nullptr;
+        REQUIRE_THROWS_AS(eval_batch_dbl_cols(out_cols.data(), ex, cols, n, pars), std::invalid_argument);
+        cols.resize(std::min(x_id, y_id));
+        REQUIRE_THROWS_AS(eval_batch_dbl_cols(out_cols.data(), ex, cols, n, pars), std::invalid_argument);
+    }
+
+    // Substitution.
+    REQUIRE(subs_by_id(ex, {{x_id, y}}) == y * y + cos(y * y) - 1. / par[0]);
+    REQUIRE(subs_by_id(ex, {}) == ex);
+}
+
 TEST_CASE("operator == and !=")
 {
     // Expression 1
@@ -328,6 +455,40 @@ TEST_CASE("diff")
     }
 }
 
+TEST_CASE("diff vector")
+{
+    auto [x, y, z] = make_vars("x", "y", "z");
+
+    // Shared subexpressions, functions and params.
+    const auto r2 = x * x + y * y + z * z;
+    const auto r = sqrt(r2);
+    const std::vector<expression> v_ex{par[0] * x / (r2 * r), sin(r) + pow(y, 3_dbl), 2_dbl, exp(x * y) - z / r};
+
+    const std::vector<std::string> vars{"x", "z", "y"};
+    const auto jac = diff(v_ex, vars);
+    REQUIRE(jac.size() == v_ex.size() * vars.size());
+
+    const std::unordered_map<std::string, double> in{{"x", .3}, {"y", -.4}, {"z", 1.2}};
+    const std::vector<double> pars{1.5};
+
+    for (decltype(v_ex.size()) i = 0; i < v_ex.size(); ++i) {
+        for (decltype(vars.size()) j = 0; j < vars.size(); ++j) {
+            REQUIRE(eval_dbl(jac[i * vars.size() + j], in, pars)
+                    == Approx(eval_dbl(diff(v_ex[i], vars[j]), in, pars)));
+        }
+    }
+
+    // Zero derivatives.
+    REQUIRE(jac[6] == 0_dbl);
+    REQUIRE(jac[7] == 0_dbl);
+    REQUIRE(jac[8] == 0_dbl);
+    REQUIRE(diff(std::vector{sin(x)}, {"y", "x"}) == std::vector{0_dbl, cos(x)});
+
+    // Empty inputs.
+    REQUIRE(diff(std::vector<expression>{}, {"x"}).empty());
+    REQUIRE(diff(v_ex, {}).empty());
+}
+
 TEST_CASE("is_integral")
 {
     REQUIRE(!detail::is_integral("x"_var));
@@ -404,3 +565,393 @@ TEST_CASE("binary simpls")
     REQUIRE(x + -1. == x - 1.);
     REQUIRE(y - -1. == y + 1.);
 }
+
+TEST_CASE("shared subexpressions")
+{
+    auto [x, y] = make_vars("x", "y");
+
+    auto ex = sin(x) * cos(y) + x;
+
+    // Copies share the subexpressions, and they
+    // compare equal.
+    auto ex2 = ex;
+    REQUIRE(ex2 == ex);
+    REQUIRE(&std::get<binary_operator>(std::as_const(ex2).value()).args()
+            == &std::get<binary_operator>(std::as_const(ex).value()).args());
+
+    // Altering a copy does not alter the original.
+    rename_variables(ex2, {{"x", "z"}});
+    REQUIRE(ex2 == sin("z"_var) * cos(y) + "z"_var);
+    REQUIRE(ex == sin(x) * cos(y) + x);
+
+    // Same for the function objects.
+    auto sx = sin(x), sx2 = sx;
+    REQUIRE(std::get<func>(std::as_const(sx).value()).get_ptr()
+            == std::get<func>(std::as_const(sx2).value()).get_ptr());
+    rename_variables(sx2, {{"x", "w"}});
+    REQUIRE(sx == sin(x));
+    REQUIRE(sx2 == sin("w"_var));
+
+    // The transformations rebuild only the
+    // subexpressions which change.
+    auto ex3 = ex;
+    rename_variables(ex3, {{"y", "z"}});
+    REQUIRE(ex3 == sin(x) * cos("z"_var) + x);
+    const auto &lhs = std::get<binary_operator>(std::as_const(ex).value()).lhs();
+    const auto &lhs3 = std::get<binary_operator>(std::as_const(ex3).value()).lhs();
+    REQUIRE(std::get<func>(std::get<binary_operator>(lhs.value()).lhs().value()).get_ptr()
+            == std::get<func>(std::get<binary_operator>(lhs3.value()).lhs().value()).get_ptr());
+    REQUIRE(std::get<func>(std::get<binary_operator>(lhs.value()).rhs().value()).get_ptr()
+            != std::get<func>(std::get<binary_operator>(lhs3.value()).rhs().value()).get_ptr());
+
+    auto ex4 = ex;
+    rename_variables(ex4, {{"w", "z"}});
+    REQUIRE(&std::get<binary_operator>(std::as_const(ex4).value()).args()
+            == &std::get<binary_operator>(std::as_const(ex).value()).args());
+    const auto ex5 = subs(ex, {{"w", x}});
+    REQUIRE(&std::get<binary_operator>(ex5.value()).args()
+            == &std::get<binary_operator>(std::as_const(ex).value()).args());
+
+    // The Taylor decomposition does not alter
+    // the shared subexpressions.
+    auto sys = std::vector{prime(x) = ex, prime(y) = ex};
+    const auto sys_copy = sys;
+    taylor_decompose(sys);
+    REQUIRE(sys == sys_copy);
+}
+
+TEST_CASE("taylor_decompose cse")
+{
+    auto [x, y] = make_vars("x", "y");
+
+    // x * y, sin(x * y) and the numbers/params appear several times,
+    // built independently.
+    const auto dc
+        = taylor_decompose({prime(x) = x * y + sin(x * y) + par[0] * 2_dbl, prime(y) = sin(x * y) - par[0] * 2_dbl});
+
+    const auto count = [&dc](const expression &ex) {
+        return std::count_if(dc.begin(), dc.end(), [&ex](const auto &p) { return p.first == ex; });
+    };
+
+    REQUIRE(count("u_0"_var * "u_1"_var) == 1);
+    REQUIRE(count(par[0] * 2_dbl) == 1);
+
+    auto n_sin = 0;
+    for (const auto &[ex, deps] : dc) {
+        if (const auto *fptr = std::get_if<func>(&ex.value()); fptr != nullptr && fptr->get_name() == "sin") {
+            ++n_sin;
+            // The hidden dependency of sin() (i.e., cos())
+            // has been remapped to a valid u variable.
+            REQUIRE(deps.size() == 1u);
+            REQUIRE(deps[0] < dc.size());
+            REQUIRE(std::get<func>(dc[deps[0]].first.value()).get_name() == "cos");
+        }
+    }
+    REQUIRE(n_sin == 1);
+}
+
+TEST_CASE("expression arena")
+{
+    REQUIRE(!detail::current_expr_arena());
+
+    auto [x, y] = make_vars("x", "y");
+
+    std::vector<std::pair<expression, expression>> sys;
+    std::vector<std::pair<expression, std::vector<std::uint32_t>>> dc;
+
+    {
+        expression_arena ea;
+
+        const auto ar = detail::current_expr_arena();
+        REQUIRE(ar);
+
+        {
+            // Nested scopes.
+            expression_arena ea2;
+            REQUIRE(detail::current_expr_arena());
+            REQUIRE(detail::current_expr_arena() != ar);
+        }
+
+        REQUIRE(detail::current_expr_arena() == ar);
+
+        sys = {prime(x) = sin(x) * cos(y) + x, prime(y) = exp(x * y) - y};
+        dc = taylor_decompose(sys);
+    }
+
+    REQUIRE(!detail::current_expr_arena());
+
+    // The expressions outlive the arena scope.
+    REQUIRE(sys[0].second == sin(x) * cos(y) + x);
+    REQUIRE(sys[1].second == exp(x * y) - y);
+    REQUIRE(dc == taylor_decompose({prime(x) = sin(x) * cos(y) + x, prime(y) = exp(x * y) - y}));
+
+    // Copies and modifications outside the scope.
+    auto sys_copy = sys;
+    rename_variables(sys_copy[0].second, {{"x", "z"}});
+    REQUIRE(sys_copy[0].second == sin("z"_var) * cos(y) + "z"_var);
+    REQUIRE(sys[0].second == sin(x) * cos(y) + x);
+
+    sys.clear();
+    dc.clear();
+    REQUIRE(sys_copy[1].second == exp(x * y) - y);
+
+    // Large allocations.
+    detail::expr_arena big;
+    auto ptr = big.allocate(1024u * 1024u, 64u);
+    REQUIRE(reinterpret_cast<std::uintptr_t>(ptr) % 64u == 0u);
+    ptr = big.allocate(8u, 8u);
+    REQUIRE(reinterpret_cast<std::uintptr_t>(ptr) % 8u == 0u);
+}
+
+TEST_CASE("simplify")
+{
+    auto [x, y] = make_vars("x", "y");
+
+    // Constant folding and identities.
+    REQUIRE(simplify(x - x) == 0_dbl);
+    REQUIRE(simplify(x * y - y * x) == 0_dbl);
+    REQUIRE(simplify(x + x) == 2_dbl * x);
+    REQUIRE(simplify(2_dbl * x * 3_dbl) == 6_dbl * x);
+    REQUIRE(simplify(x / x) == 1_dbl);
+    REQUIRE(simplify(1_dbl + x - 1_dbl) == x);
+
+    // Canonical order.
+    REQUIRE(simplify(y + x) == x + y);
+    REQUIRE(simplify(y * x) == x * y);
+    REQUIRE(simplify(y * x + x * y) == simplify(2_dbl * x * y));
+
+    // Powers.
+    REQUIRE(simplify(x * x) == square(x));
+    REQUIRE(simplify(x * x * x) == pow(x, 3_dbl));
+    REQUIRE(simplify(x * x / x) == x);
+    REQUIRE(simplify(square(sqrt(x))) == x);
+    REQUIRE(simplify(sqrt(x) * sqrt(x)) == x);
+    REQUIRE(simplify(pow(x, 2_dbl)) == square(x));
+    // sqrt(square(x)) is |x|, not x.
+    REQUIRE(simplify(sqrt(square(x))) == sqrt(square(x)));
+
+    // Simplification inside functions.
+    REQUIRE(simplify(cos(x * 1_dbl + y - y)) == cos(x));
+
+    // Numerical check.
+    const auto ex = (x + y) * (x - y) / x + square(sqrt(y)) + x * y * 2_dbl - y * x + x / y * y + cos(y) * cos(y);
+    const auto sex = simplify(ex);
+    const std::unordered_map<std::string, double> in{{"x", 1.5}, {"y", .75}};
+    REQUIRE(eval_dbl(sex, in) == Approx(eval_dbl(ex, in)));
+
+    // Vector overload.
+    REQUIRE(simplify(std::vector{x - x, y * y}) == std::vector{0_dbl, square(y)});
+
+    // Simplification in the integrator.
+    auto ta = taylor_adaptive<double>{
+        {prime(x) = y + y - y, prime(y) = -x * x / x}, {0.05, 0.025}, kw::simplify = true};
+    auto ta_ref = taylor_adaptive<double>{{prime(x) = y, prime(y) = -x}, {0.05, 0.025}};
+    REQUIRE(ta.get_decomposition().size() <= ta_ref.get_decomposition().size());
+    ta.propagate_until(1.);
+    ta_ref.propagate_until(1.);
+    REQUIRE(ta.get_state()[0] == Approx(ta_ref.get_state()[0]));
+    REQUIRE(ta.get_state()[1] == Approx(ta_ref.get_state()[1]));
+}
+
+TEST_CASE("deep expressions")
+{
+    auto [x, y] = make_vars("x", "y");
+
+    // A long unbalanced sum, deep enough to overflow
+    // the stack in a recursive traversal.
+    const auto n = 200000;
+    auto ex = x;
+    for (auto i = 1; i < n; ++i) {
+        ex = ex + (i % 2 == 0 ? x : y);
+    }
+
+    REQUIRE(get_variables(ex) == std::vector<std::string>{"x", "y"});
+    REQUIRE(eval_dbl(ex, {{"x", 1.}, {"y", 2.}}) == (n / 2) + 2. * (n / 2));
+    REQUIRE(eval_dbl(diff(ex, "y"), {{"x", 1.}, {"y", 2.}}) == n / 2);
+
+    auto ex2 = subs(ex, {{"x", y}});
+    REQUIRE(get_variables(ex2) == std::vector<std::string>{"y"});
+    REQUIRE(eval_dbl(ex2, {{"y", 2.}}) == 2. * n);
+
+    rename_variables(ex, {{"y", "z"}});
+    REQUIRE(get_variables(ex) == std::vector<std::string>{"x", "z"});
+
+    REQUIRE(count_nodes(ex) == 2u * n - 1u);
+    REQUIRE(*fetch_from_node_id(ex, 2u * n - 2u) == "z"_var);
+    REQUIRE(fetch_from_node_id(ex, 2u * n - 1u) == nullptr);
+
+    // Shared subtrees.
+    auto sh = x * y;
+    for (auto i = 0; i < 100; ++i) {
+        sh = sh + sh;
+    }
+    REQUIRE(get_variables(sh) == std::vector<std::string>{"x", "y"});
+    REQUIRE(eval_dbl(sh, {{"x", 1.}, {"y", 1.}}) == std::ldexp(1., 100));
+}
+
+TEST_CASE("binary serialisation")
+{
+    auto [x, y] = make_vars("x", "y");
+
+    const auto ex = sin(x) * cos(y) + x / par[1] - 1.5_dbl * shared_par[0] + heyoka::time + pow(x, 2.5_ldbl);
+
+    {
+        std::stringstream ss;
+        save_expression(ss, ex);
+        REQUIRE(load_expression(ss) == ex);
+    }
+
+    // The shared subexpressions.
+    auto sh = x * y;
+    for (auto i = 0; i < 100; ++i) {
+        sh = sh + sh;
+    }
+
+    {
+        std::stringstream ss;
+        save_expression(ss, sh);
+        REQUIRE(ss.str().size() < 5000u);
+
+        const auto sh2 = load_expression(ss);
+        const auto &lhs = std::get<binary_operator>(sh2.value()).lhs();
+        const auto &rhs = std::get<binary_operator>(sh2.value()).rhs();
+        REQUIRE(&std::get<binary_operator>(lhs.value()).args() == &std::get<binary_operator>(rhs.value()).args());
+        REQUIRE(eval_dbl(sh2, {{"x", 1.}, {"y", 1.}}) == std::ldexp(1., 100));
+    }
+
+    // Vectors of expressions and systems of equations.
+    {
+        const auto v = std::vector{ex, sh, x, 2_dbl};
+
+        std::stringstream ss;
+        save_expressions(ss, v);
+
+        const auto v2 = load_expressions(ss);
+        REQUIRE(v2.size() == 4u);
+        REQUIRE(v2[0] == ex);
+        REQUIRE(v2[2] == x);
+        REQUIRE(v2[3] == 2_dbl);
+
+        // The subexpression shared among the expressions
+        // is shared after loading.
+        const auto sys = std::vector{prime(x) = ex * y, prime(y) = ex};
+
+        save_sys(ss, sys);
+        const auto sys2 = load_sys(ss);
+        REQUIRE(sys2 == sys);
+        REQUIRE(&std::get<binary_operator>(std::get<binary_operator>(sys2[0].second.value()).lhs().value()).args()
+                == &std::get<binary_operator>(sys2[1].second.value()).args());
+    }
+
+    // Errors.
+    {
+        std::stringstream ss;
+        save_expressions(ss, {x});
+        REQUIRE_THROWS_AS(load_expression(ss), std::invalid_argument);
+
+        ss.str("");
+        save_expression(ss, ex);
+        const auto str = ss.str();
+        ss.str(str.substr(0, str.size() - 1u));
+        REQUIRE_THROWS_AS(load_expression(ss), std::invalid_argument);
+    }
+}
+
+TEST_CASE("bulk subs")
+{
+    auto [x, y, z] = make_vars("x", "y", "z");
+
+    // Heavily-shared expressions.
+    auto sh = x * par[0];
+    for (auto i = 0; i < 40; ++i) {
+        sh = sh + sh;
+    }
+    const auto ex = std::vector{sh, sin(sh) + z, cos(z)};
+
+    const auto res = subs(ex, {{"x", y * y}});
+    REQUIRE(res.size() == 3u);
+    REQUIRE(get_n_nodes(res[0]) == (std::size_t(1) << 43) - 1u);
+    REQUIRE(get_variables(res[0]) == std::vector<std::string>{"y"});
+    REQUIRE(get_variables(res[1]) == std::vector<std::string>{"y", "z"});
+    REQUIRE(eval_dbl(res[0], {{"y", 1.}}, {1.}) == std::ldexp(1., 40));
+
+    // The results for the subexpressions shared among the expressions are shared.
+    const auto &sin_arg = std::get<func>(std::get<binary_operator>(res[1].value()).lhs().value()).args()[0];
+    REQUIRE(detail::node_key(sin_arg) == detail::node_key(res[0]));
+
+    // The subexpressions not containing the substituted variables are shared with the input.
+    REQUIRE(detail::node_key(res[2]) == detail::node_key(ex[2]));
+    REQUIRE(detail::node_key(subs(ex, {{"w", y}})[0]) == detail::node_key(sh));
+    REQUIRE(detail::node_key(subs(ex, {})[1]) == detail::node_key(ex[1]));
+
+    // The results match the substitution of the single expressions.
+    // NOTE: compare the (cached) hash values, as the comparison
+    // of the expressions does not take into account the sharing.
+    for (decltype(ex.size()) i = 0; i < ex.size(); ++i) {
+        REQUIRE(hash(res[i]) == hash(subs(ex[i], {{"x", y * y}})));
+    }
+    REQUIRE(subs(std::vector{x + z, x * y}, {{"x", z}}) == std::vector{z + z, z * y});
+
+    // Substitution by id.
+    const auto x_id = std::get<variable>(x.value()).id();
+    const auto res_id = subs_by_id(ex, {{x_id, y * y}});
+    REQUIRE(get_n_nodes(res_id[0]) == get_n_nodes(res[0]));
+    REQUIRE(hash(res_id[1]) == hash(res[1]));
+    REQUIRE(detail::node_key(res_id[2]) == detail::node_key(ex[2]));
+    REQUIRE(get_variables(subs_by_id(sh, {{x_id, z}})) == std::vector<std::string>{"z"});
+    REQUIRE(detail::node_key(subs_by_id(ex, {})[1]) == detail::node_key(ex[1]));
+}
+
+TEST_CASE("cached node properties")
+{
+    auto [x, y, z] = make_vars("x", "y", "z");
+
+    // The properties of heavily-shared expressions.
+    auto sh = x * par[3];
+    for (auto i = 0; i < 40; ++i) {
+        sh = sh + sh;
+    }
+
+    REQUIRE(get_n_nodes(sh) == (std::size_t(1) << 42) - 1u);
+    REQUIRE(count_nodes(sh) == get_n_nodes(sh));
+    REQUIRE(get_depth(sh) == 41u);
+    REQUIRE(get_depth(x) == 0u);
+    REQUIRE(get_param_size(sh) == 4u);
+    REQUIRE(get_variables(sh) == std::vector<std::string>{"x"});
+    REQUIRE(hash(sh) == hash(sh));
+
+    // The hash values do not depend on the sharing.
+    const auto a = x * y;
+    REQUIRE(hash(a + a) == hash((x * y) + (x * y)));
+    REQUIRE(hash(sin(a) + a) == hash(sin(x * y) + x * y));
+
+    // The cache is cleared when the nodes are modified.
+    auto ex = x + par[1];
+    auto ex_copy = ex;
+    REQUIRE(get_variables(ex) == std::vector<std::string>{"x"});
+    REQUIRE(get_param_size(ex) == 2u);
+    const auto h = hash(ex);
+
+    std::get<binary_operator>(ex.value()).rhs() = z * par[4];
+    REQUIRE(get_variables(ex) == std::vector<std::string>{"x", "z"});
+    REQUIRE(get_param_size(ex) == 5u);
+    REQUIRE(get_n_nodes(ex) == 5u);
+    REQUIRE(get_depth(ex) == 2u);
+    REQUIRE(hash(ex) == hash(x + z * par[4]));
+
+    std::get<binary_operator>(ex.value()).op() = binary_operator::type::mul;
+    REQUIRE(hash(ex) == hash(x * (z * par[4])));
+
+    // The copy is not affected.
+    REQUIRE(get_variables(ex_copy) == std::vector<std::string>{"x"});
+    REQUIRE(get_param_size(ex_copy) == 2u);
+    REQUIRE(hash(ex_copy) == h);
+
+    auto f = sin(x);
+    REQUIRE(get_variables(f) == std::vector<std::string>{"x"});
+    const auto hf = hash(f);
+    *std::get<func>(f.value()).get_mutable_args_it().first = y;
+    REQUIRE(get_variables(f) == std::vector<std::string>{"y"});
+    REQUIRE(hash(f) == hash(sin(y)));
+    REQUIRE(hash(f) != hf);
+}
@@ -0,0 +1,93 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <cmath>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <variant>
+
+#include <heyoka/binary_operator.hpp>
+#include <heyoka/detail/traversal.hpp>
+#include <heyoka/expression.hpp>
+#include <heyoka/expression_parser.hpp>
+#include <heyoka/math.hpp>
+#include <heyoka/number.hpp>
+#include <heyoka/param.hpp>
+
+#include "catch.hpp"
+
+using namespace heyoka;
+
+TEST_CASE("expression parser")
+{
+    auto [x, y] = make_vars("x", "y");
+
+    // Round trip of the output of operator<<.
+    for (const auto &ex : {x, 1.5_dbl, par[3], shared_par[0], heyoka::time, -x, x + y * 2.5_dbl - x / y,
+                           sin(x) * cos(y) + pow(x, 2.5_dbl) - exp(-y), sum({x, y, par[0]}), x - (-1.25_dbl)}) {
+        std::ostringstream oss;
+        oss << ex;
+        REQUIRE(parse_expression(oss.str()) == ex);
+    }
+
+    // Precedence, associativity and unary minus.
+    REQUIRE(parse_expression("x + y * 2") == expression{binary_operator{binary_operator::type::add, x,
+                                                                        expression{binary_operator{
+                                                                            binary_operator::type::mul, y, 2_dbl}}}});
+    REQUIRE(parse_expression("x - y - 1") == expression{binary_operator{
+                binary_operator::type::sub,
+                expression{binary_operator{binary_operator::type::sub, x, y}}, 1_dbl}});
+    REQUIRE(parse_expression("-(x)") == expression{binary_operator{binary_operator::type::mul, -1_dbl, x}});
+    REQUIRE(parse_expression(" - 2e1 ") == -20_dbl);
+    REQUIRE(parse_expression("(((x)))") == x);
+    REQUIRE(parse_expression("inf") == expression{std::numeric_limits<double>::infinity()});
+    REQUIRE(std::isnan(std::get<double>(std::get<number>(parse_expression("nan").value()).value())));
+
+    // The identical subexpressions are shared.
+    {
+        const auto ex = parse_expression("sin(x * y) + sin(x * y)");
+        const auto &bo = std::get<binary_operator>(ex.value());
+        REQUIRE(detail::node_key(bo.lhs()) == detail::node_key(bo.rhs()));
+    }
+
+    // Deep expressions.
+    {
+        std::string s = "1.";
+        for (auto i = 0; i < 10000; ++i) {
+            s += " + 1.";
+        }
+        REQUIRE(eval_dbl(parse_expression(s), {}) == 10001.);
+    }
+
+    // Lists of expressions and systems.
+    REQUIRE(parse_expressions("").empty());
+    REQUIRE(parse_expressions("x; y;") == std::vector{x, y});
+    REQUIRE(parse_sys("x = y; y = -x") == std::vector{std::pair{x, y}, std::pair{y, -x}});
+}
+
+TEST_CASE("expression parser errors")
+{
+    for (const auto *s : {"", "x +", "x y", "(x", "x)", "foo(x)", "sin(x,", "par[", "par[1", "par[99999999999]",
+                          "1e", "x # y", "x; y", "x = y", "*x", "sin(, x)"}) {
+        REQUIRE_THROWS_AS(parse_expression(s), std::invalid_argument);
+    }
+
+    REQUIRE_THROWS_AS(parse_expressions("x = y"), std::invalid_argument);
+    REQUIRE_THROWS_AS(parse_sys("x"), std::invalid_argument);
+    REQUIRE_THROWS_AS(parse_sys("x = y = z"), std::invalid_argument);
+
+    // The position of the error.
+    try {
+        parse_expression("x + foo(y)");
+        REQUIRE(false);
+    } catch (const std::invalid_argument &ex) {
+        REQUIRE(std::string{ex.what()}.find("position 4") != std::string::npos);
+    }
+}
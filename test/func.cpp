@@ -6,11 +6,13 @@
 // Public License v. 2.0. If a copy of the MPL was not distributed
 // with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
 
+#include <cstdint>
 #include <initializer_list>
 #include <iostream>
 #include <sstream>
 #include <stdexcept>
 #include <string>
+#include <tuple>
 #include <type_traits>
 #include <typeinfo>
 #include <unordered_map>
@@ -23,6 +25,8 @@
 #include <heyoka/expression.hpp>
 #include <heyoka/func.hpp>
 #include <heyoka/llvm_state.hpp>
+#include <heyoka/math.hpp>
+#include <heyoka/taylor.hpp>
 
 #include "catch.hpp"
 
@@ -670,3 +674,75 @@ TEST_CASE("func to_stream")
     oss << f2;
     REQUIRE(oss.str() == "Custom to stream");
 }
+
+// Count the invocations of the function fname in the textual IR ir.
+static int count_calls(const std::string &ir, const std::string &fname)
+{
+    int retval = 0;
+
+    for (auto pos = ir.find("call "); pos != std::string::npos; pos = ir.find("call ", pos + 1u)) {
+        if (ir.compare(ir.find('@', pos), fname.size() + 2u, "@" + fname + "(") == 0) {
+            ++retval;
+        }
+    }
+
+    return retval;
+}
+
+TEST_CASE("func vector functions")
+{
+    using Catch::Matchers::Message;
+
+#if defined(_MSC_VER)
+    const std::string fname = "heyoka_atanl";
+#else
+    const std::string fname = "atanl";
+#endif
+
+    REQUIRE(get_vector_functions(fname).empty());
+
+    register_vector_function(fname, 2, "heyoka_test_atanl2");
+    register_vector_function(fname, 4, "heyoka_test_atanl4_old");
+    register_vector_function(fname, 4, "heyoka_test_atanl4");
+
+    using impls_t = std::vector<std::pair<std::uint32_t, std::string>>;
+    REQUIRE(get_vector_functions(fname) == impls_t{{4, "heyoka_test_atanl4"}, {2, "heyoka_test_atanl2"}});
+
+    auto x = "x"_var;
+
+    // NOTE: the batch size 7 is split into chunks of 4, 2 and 2 (padded).
+    for (auto [batch_size, n4, n2] : {std::tuple{2u, 0, 1}, std::tuple{4u, 1, 0}, std::tuple{7u, 1, 2}}) {
+        llvm_state s;
+
+        taylor_add_jet<long double>(s, "jet", {atan(x)}, 1, batch_size, false, false);
+
+        const auto ir = s.get_ir();
+
+        REQUIRE(count_calls(ir, "heyoka_test_atanl4") == n4);
+        REQUIRE(count_calls(ir, "heyoka_test_atanl2") == n2);
+        REQUIRE(count_calls(ir, fname) == 0);
+    }
+
+    unregister_vector_functions(fname);
+    REQUIRE(get_vector_functions(fname).empty());
+
+    {
+        llvm_state s;
+
+        taylor_add_jet<long double>(s, "jet", {atan(x)}, 1, 2, false, false);
+
+        const auto ir = s.get_ir();
+
+        REQUIRE(count_calls(ir, "heyoka_test_atanl2") == 0);
+        REQUIRE(count_calls(ir, fname) == 2);
+    }
+
+    // Error checking.
+    REQUIRE_THROWS_MATCHES(register_vector_function("", 2, "foo"), std::invalid_argument,
+                           Message("The names of a function and of its vector implementation cannot be empty"));
+    REQUIRE_THROWS_MATCHES(register_vector_function("foo", 2, ""), std::invalid_argument,
+                           Message("The names of a function and of its vector implementation cannot be empty"));
+    REQUIRE_THROWS_MATCHES(register_vector_function("foo", 1, "bar"), std::invalid_argument,
+                           Message("The SIMD width of the vector implementation 'bar' of the function 'foo' must be "
+                                   "at least 2, but it is 1 instead"));
+}
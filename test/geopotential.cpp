@@ -0,0 +1,210 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <heyoka/expression.hpp>
+#include <heyoka/geopotential.hpp>
+#include <heyoka/kw.hpp>
+#include <heyoka/math.hpp>
+#include <heyoka/taylor.hpp>
+
+#include "catch.hpp"
+#include "test_utils.hpp"
+
+using namespace heyoka;
+using namespace heyoka_test;
+
+// Normalisation factor of the coefficients.
+static double norm_factor(unsigned n, unsigned m)
+{
+    return std::sqrt((m == 0u ? 1. : 2.) * (2. * n + 1) * std::tgamma(n - m + 1.) / std::tgamma(n + m + 1.));
+}
+
+// Direct evaluation of the geopotential via the associated Legendre functions.
+static double potential(const std::vector<double> &pars, unsigned n_max, double mu, double R, double x, double y,
+                        double z)
+{
+    const auto r = std::sqrt(x * x + y * y + z * z);
+    const auto t = z / r, u = std::sqrt(1 - t * t), lam = std::atan2(y, x);
+
+    std::vector<std::vector<double>> P(n_max + 1u, std::vector<double>(n_max + 1u));
+    for (auto m = 0u; m <= n_max; ++m) {
+        P[m][m] = std::pow(u, m);
+        for (auto k = 1u; k < 2u * m; k += 2u) {
+            P[m][m] *= k;
+        }
+        if (m + 1u <= n_max) {
+            P[m + 1u][m] = t * (2. * m + 1) * P[m][m];
+        }
+        for (auto n = m + 2u; n <= n_max; ++n) {
+            P[n][m] = ((2. * n - 1) * t * P[n - 1u][m] - (n + m - 1.) * P[n - 2u][m]) / (n - m);
+        }
+    }
+
+    double U = 0;
+    for (auto n = 0u; n <= n_max; ++n) {
+        for (auto m = 0u; m <= n; ++m) {
+            const auto idx = geopotential_par_index(n, m);
+            U += std::pow(R / r, n) * P[n][m] * norm_factor(n, m)
+                 * (pars[idx] * std::cos(m * lam) + pars[idx + 1u] * std::sin(m * lam));
+        }
+    }
+
+    return mu / r * U;
+}
+
+TEST_CASE("geopotential acc")
+{
+    REQUIRE(geopotential_n_pars(0) == 2u);
+    REQUIRE(geopotential_n_pars(3) == 20u);
+    REQUIRE(geopotential_par_index(0, 0) == 0u);
+    REQUIRE(geopotential_par_index(1, 0) == 2u);
+    REQUIRE(geopotential_par_index(1, 1) == 4u);
+    REQUIRE(geopotential_par_index(3, 3) == 18u);
+
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<double> cdist(-.1, .1), pdist(-2., 2.);
+
+    auto [x, y, z] = make_vars("x", "y", "z");
+
+    const auto mu = 1.3, R = .8;
+
+    for (auto n_max : {0u, 1u, 2u, 5u, 8u}) {
+        std::vector<double> pars(geopotential_n_pars(n_max));
+        for (auto n = 0u; n <= n_max; ++n) {
+            for (auto m = 0u; m <= n; ++m) {
+                const auto idx = geopotential_par_index(n, m);
+                pars[idx] = n == 0u ? 1. : cdist(rng);
+                pars[idx + 1u] = m == 0u ? 0. : cdist(rng);
+            }
+        }
+
+        const auto acc = geopotential_acc(x, y, z, n_max, n_max, mu, R);
+
+        for (auto k = 0; k < 10; ++k) {
+            const std::vector<double> pt{pdist(rng), pdist(rng), pdist(rng)};
+            const std::unordered_map<std::string, double> map{{"x", pt[0]}, {"y", pt[1]}, {"z", pt[2]}};
+
+            // Central finite differences of the potential.
+            const auto h = 1e-5;
+            for (auto j = 0u; j < 3u; ++j) {
+                auto p_plus = pt, p_minus = pt;
+                p_plus[j] += h;
+                p_minus[j] -= h;
+
+                const auto fd = (potential(pars, n_max, mu, R, p_plus[0], p_plus[1], p_plus[2])
+                                 - potential(pars, n_max, mu, R, p_minus[0], p_minus[1], p_minus[2]))
+                                / (2 * h);
+
+                REQUIRE(std::abs(eval_dbl(acc[j], map, pars) - fd) < 1e-6 * (1 + std::abs(fd)));
+            }
+        }
+    }
+
+    // Truncation to a lower order.
+    {
+        std::vector<double> pars(geopotential_n_pars(4));
+        for (auto n = 0u; n <= 4u; ++n) {
+            for (auto m = 0u; m <= n; ++m) {
+                const auto idx = geopotential_par_index(n, m);
+                pars[idx] = (n == 0u || m <= 1u) ? cdist(rng) : 0.;
+                pars[idx + 1u] = m == 1u ? cdist(rng) : 0.;
+            }
+        }
+        auto pars_tr = pars;
+        for (auto n = 2u; n <= 4u; ++n) {
+            for (auto m = 2u; m <= n; ++m) {
+                pars_tr[geopotential_par_index(n, m)] = 1.;
+                pars_tr[geopotential_par_index(n, m) + 1u] = 1.;
+            }
+        }
+
+        const auto acc = geopotential_acc(x, y, z, 4, 4, mu, R);
+        const auto acc_tr = geopotential_acc(x, y, z, 4, 1, mu, R);
+        const std::unordered_map<std::string, double> map{{"x", 1.}, {"y", -.5}, {"z", .3}};
+
+        for (auto j = 0u; j < 3u; ++j) {
+            REQUIRE(eval_dbl(acc_tr[j], map, pars_tr) == approximately(eval_dbl(acc[j], map, pars)));
+        }
+    }
+
+    // Parameter offset.
+    {
+        const auto acc = geopotential_acc(x, y, z, 0, 0, mu, R, 3);
+        const std::unordered_map<std::string, double> map{{"x", 1.}, {"y", -.5}, {"z", .3}};
+        const auto r = std::sqrt(1. + .25 + .09);
+
+        REQUIRE(eval_dbl(acc[0], map, {0., 0., 0., 1., 0.}) == approximately(-mu / (r * r * r)));
+    }
+
+    // Error handling.
+    REQUIRE_THROWS_AS(geopotential_acc(x, y, z, 2, 3, mu, R), std::invalid_argument);
+    REQUIRE_THROWS_AS(geopotential_acc(x, y, z, 2, 2, std::numeric_limits<double>::infinity(), R),
+                      std::invalid_argument);
+    REQUIRE_THROWS_AS(geopotential_acc(x, y, z, 2, 2, mu, 0.), std::invalid_argument);
+    REQUIRE_THROWS_AS(geopotential_acc(x, y, z, 2, 2, mu, R, std::numeric_limits<std::uint32_t>::max() - 5u),
+                      std::overflow_error);
+    REQUIRE_THROWS_AS(geopotential_par_index(2, 3), std::invalid_argument);
+    REQUIRE_THROWS_AS(geopotential_n_pars(100000u), std::overflow_error);
+}
+
+TEST_CASE("geopotential J2")
+{
+    auto [x, y, z, vx, vy, vz] = make_vars("x", "y", "z", "vx", "vy", "vz");
+
+    const auto mu = 1., R = .5, J2 = 1e-3;
+
+    std::vector<double> pars(geopotential_n_pars(2));
+    pars[geopotential_par_index(0, 0)] = 1.;
+    pars[geopotential_par_index(2, 0)] = -J2 / std::sqrt(5.);
+
+    const auto acc = geopotential_acc(x, y, z, 2, 2, mu, R);
+
+    // The explicit expression of the J2 acceleration.
+    auto r2 = x * x + y * y + z * z;
+    auto r_m3 = pow(r2, -3_dbl / 2_dbl);
+    auto fac = expression{1.5 * J2 * R * R} / r2;
+    auto z2r2 = z * z / r2;
+    std::vector<expression> acc_ex{-mu * x * r_m3 * (1_dbl + fac * (1_dbl - 5_dbl * z2r2)),
+                                   -mu * y * r_m3 * (1_dbl + fac * (1_dbl - 5_dbl * z2r2)),
+                                   -mu * z * r_m3 * (1_dbl + fac * (3_dbl - 5_dbl * z2r2))};
+
+    const std::unordered_map<std::string, double> map{{"x", 1.}, {"y", -.5}, {"z", .3}};
+    for (auto j = 0u; j < 3u; ++j) {
+        REQUIRE(eval_dbl(acc[j], map, pars) == approximately(eval_dbl(acc_ex[j], map)));
+    }
+
+    const std::vector<double> ic{1., 0., 0., 0., .7, .7};
+
+    for (auto cm : {false, true}) {
+        taylor_adaptive<double> ta{
+            {prime(x) = vx, prime(y) = vy, prime(z) = vz, prime(vx) = acc[0], prime(vy) = acc[1], prime(vz) = acc[2]},
+            ic,
+            kw::pars = pars,
+            kw::compact_mode = cm};
+        taylor_adaptive<double> ta_ex{{prime(x) = vx, prime(y) = vy, prime(z) = vz, prime(vx) = acc_ex[0],
+                                       prime(vy) = acc_ex[1], prime(vz) = acc_ex[2]},
+                                      ic,
+                                      kw::compact_mode = cm};
+
+        ta.propagate_until(20.);
+        ta_ex.propagate_until(20.);
+
+        for (auto j = 0u; j < 6u; ++j) {
+            REQUIRE(ta.get_state()[j] == approximately(ta_ex.get_state()[j], 10000.));
+        }
+    }
+}
@@ -6,7 +6,12 @@
 // Public License v. 2.0. If a copy of the MPL was not distributed
 // with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
 
+#include <cmath>
 #include <random>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 #include <heyoka/expression.hpp>
 #include <heyoka/gp.hpp>
@@ -15,8 +20,10 @@
 #include <heyoka/variable.hpp>
 
 #include "catch.hpp"
+#include "test_utils.hpp"
 
 using namespace heyoka;
+using namespace heyoka_test;
 using namespace Catch::literals;
 
 #include <iostream>
@@ -69,6 +76,55 @@ TEST_CASE("expression_generator")
     }
 }
 
+TEST_CASE("generate_population")
+{
+    // Jump-ahead of splitmix64.
+    {
+        splitmix64 e1(42u), e2(42u);
+        for (auto i = 0; i < 10; ++i) {
+            e1.next();
+        }
+        e2.jump(10);
+        REQUIRE(e1.next() == e2.next());
+    }
+
+    // The population does not depend on the number of threads.
+    for (auto n : {0u, 1u, 10u, 1000u}) {
+        splitmix64 engine(123456789ul);
+        expression_generator generator({"x", "y"}, engine);
+        auto generator2 = generator;
+
+        const auto pop1 = generator.generate_population(n, 1u, 4u, 1u);
+        const auto pop2 = generator2.generate_population(n, 1u, 4u, 3u);
+
+        REQUIRE(pop1.size() == n);
+        REQUIRE(pop1 == pop2);
+
+        for (const auto &ex : pop1) {
+            REQUIRE(count_nodes(ex) > 1u);
+            REQUIRE(get_variables(ex).size() <= 2u);
+        }
+
+        // The internal engine is advanced.
+        if (n > 0u) {
+            REQUIRE(generator.generate_population(n, 1u, 4u) != pop1);
+        }
+    }
+
+    // Expressions without leaves are not possible.
+    {
+        splitmix64 engine(123456789ul);
+        expression_generator generator({"x", "y"}, engine);
+        generator.set_bos({});
+        generator.set_u_funcs({});
+
+        REQUIRE_THROWS_MATCHES(generator(1u, 2u), std::invalid_argument,
+                               Catch::Matchers::Message("Cannot generate a random expression: all the node types have "
+                                                        "a null probability"));
+        REQUIRE_THROWS_AS(generator.generate_population(100u, 1u, 2u), std::invalid_argument);
+    }
+}
+
 TEST_CASE("setters and getters")
 {
     splitmix64 engine(123456789ul);
@@ -172,3 +228,228 @@ TEST_CASE("mutations")
     REQUIRE(count_nodes(ex) == 1u);
     REQUIRE_THROWS(mutate(ex, 3u, generator, 0u, 0u));
 }
+
+TEST_CASE("population mse")
+{
+    using Catch::Matchers::Message;
+
+    auto [x, y] = make_vars("x", "y");
+
+    splitmix64 engine(123456789ul);
+    expression_generator generator({"x", "y"}, engine);
+
+    // A population with shared subexpressions, params, functions
+    // and randomly-generated individuals.
+    const auto tmp = x * y;
+    std::vector<expression> pop{x, 1.5_dbl, tmp * tmp - sin(tmp), par[0] * x + y / (x + 3_dbl), exp(y) - par[1]};
+    for (auto i = 0; i < 20; ++i) {
+        pop.push_back(generator(2, 5));
+    }
+
+    // The dataset, spanning several blocks of points.
+    const auto n_points = 1000u;
+    std::uniform_real_distribution<double> dist(-1., 1.);
+    std::vector<double> data(2u * n_points), target(n_points);
+    for (auto &v : data) {
+        v = dist(engine);
+    }
+    for (auto &v : target) {
+        v = dist(engine);
+    }
+
+    const std::vector<double> pars{.5, -2.};
+
+    for (auto n_threads : {0u, 1u, 3u, 100u}) {
+        const auto res = population_mse(pop, {"x", "y"}, data.data(), target.data(), n_points, pars, n_threads);
+        REQUIRE(res.size() == pop.size());
+
+        for (decltype(pop.size()) i = 0; i < pop.size(); ++i) {
+            double ref = 0;
+            for (auto j = 0u; j < n_points; ++j) {
+                const auto r = eval_dbl(pop[i], {{"x", data[j]}, {"y", data[n_points + j]}}, pars) - target[j];
+                ref += r * r;
+            }
+            ref /= n_points;
+
+            if (std::isfinite(ref)) {
+                REQUIRE(res[i] == approximately(ref, 1000.));
+            } else {
+                REQUIRE(!std::isfinite(res[i]));
+            }
+        }
+    }
+
+    // A different order of the variables in the dataset.
+    const auto res_xy = population_mse({x - y}, {"x", "y"}, data.data(), target.data(), n_points);
+    const auto res_yx = population_mse({y - x}, {"y", "x"}, data.data(), target.data(), n_points);
+    REQUIRE(res_xy[0] == res_yx[0]);
+
+    // Empty population.
+    REQUIRE(population_mse({}, {"x", "y"}, data.data(), target.data(), n_points).empty());
+
+    // Error checking.
+    REQUIRE_THROWS_MATCHES(population_mse({x}, {"x"}, data.data(), target.data(), 0), std::invalid_argument,
+                           Message("Cannot evaluate the fitness of a population over an empty dataset"));
+    REQUIRE_THROWS_MATCHES(population_mse({x}, {"x", "x"}, data.data(), target.data(), n_points),
+                           std::invalid_argument, Message("The list of variables of a dataset contains duplicates"));
+    REQUIRE_THROWS_MATCHES(population_mse({x, x * y}, {"x"}, data.data(), target.data(), n_points, {}, 2),
+                           std::invalid_argument,
+                           Message("The variable 'y' is not in the list of the variables of the dataset"));
+    REQUIRE_THROWS_AS(population_mse({par[2]}, {"x"}, data.data(), target.data(), n_points, pars), std::out_of_range);
+}
+
+TEST_CASE("fitness cache")
+{
+    auto [x, y] = make_vars("x", "y");
+
+    const auto n_points = 100u;
+    splitmix64 engine(123456789ul);
+    std::uniform_real_distribution<double> dist(-1., 1.);
+    std::vector<double> data(2u * n_points), target(n_points);
+    for (auto &v : data) {
+        v = dist(engine);
+    }
+    for (auto &v : target) {
+        v = dist(engine);
+    }
+
+    // A population with copies and with structurally-identical
+    // but distinct individuals.
+    const auto ex = x * y + cos(x);
+    std::vector<expression> pop{ex, x * y + cos(x), ex, y, y, 2_dbl, x - y};
+    const auto ref = population_mse(pop, {"x", "y"}, data.data(), target.data(), n_points);
+    REQUIRE(ref[0] == ref[1]);
+    REQUIRE(ref[0] == ref[2]);
+    REQUIRE(ref[3] == ref[4]);
+    for (decltype(pop.size()) i = 0; i < pop.size(); ++i) {
+        REQUIRE(ref[i] == population_mse({pop[i]}, {"x", "y"}, data.data(), target.data(), n_points)[0]);
+    }
+
+    fitness_cache cache;
+    auto res = population_mse(pop, {"x", "y"}, data.data(), target.data(), n_points, cache);
+    REQUIRE(res == ref);
+    REQUIRE(cache.size() == 4u);
+
+    // The cached values are used in place of the evaluation.
+    cache.insert(x * y + cos(x), -1.);
+    REQUIRE(cache.find(ex) == -1.);
+    pop.push_back(x + y);
+    res = population_mse(pop, {"x", "y"}, data.data(), target.data(), n_points, cache);
+    REQUIRE(res[0] == -1.);
+    REQUIRE(res[1] == -1.);
+    REQUIRE(res[2] == -1.);
+    REQUIRE(res[3] == ref[3]);
+    REQUIRE(res[6] == ref[6]);
+    REQUIRE(cache.size() == 5u);
+    REQUIRE(!cache.find(x / y));
+
+    // The cache is not updated if the evaluation fails.
+    REQUIRE_THROWS_AS(population_mse({x / y, x + expression{variable{"z"}}}, {"x", "y"}, data.data(), target.data(),
+                                     n_points, cache),
+                      std::invalid_argument);
+    REQUIRE(cache.size() == 5u);
+
+    cache.clear();
+    REQUIRE(cache.size() == 0u);
+    REQUIRE(!cache.find(ex));
+}
+
+TEST_CASE("numbers_to_pars")
+{
+    auto [x, y] = make_vars("x", "y");
+
+    {
+        const auto [ex, vals] = numbers_to_pars(1.5_dbl * x + sin(y - 2_dbl));
+        REQUIRE(ex == par[0] * x + sin(y - par[1]));
+        REQUIRE(vals == std::vector{1.5, 2.});
+    }
+
+    // The params already present are not renumbered.
+    {
+        const auto [ex, vals] = numbers_to_pars(par[1] * x + 3_dbl);
+        REQUIRE(ex == par[1] * x + par[2]);
+        REQUIRE(vals == std::vector{3.});
+    }
+
+    // No numbers.
+    {
+        const auto [ex, vals] = numbers_to_pars(x * y);
+        REQUIRE(ex == x * y);
+        REQUIRE(vals.empty());
+    }
+}
+
+TEST_CASE("optimise_constants")
+{
+    using Catch::Matchers::Message;
+
+    auto [x, y] = make_vars("x", "y");
+
+    // A dataset generated by 2.5 * sin(1.3 * x) + y / 4, spanning
+    // several SIMD batches and with a remainder.
+    const auto n_points = 203u;
+    splitmix64 engine(123456789ul);
+    std::uniform_real_distribution<double> dist(-1., 1.);
+    std::vector<double> data(2u * n_points), target(n_points);
+    for (auto &v : data) {
+        v = dist(engine);
+    }
+    for (auto i = 0u; i < n_points; ++i) {
+        target[i] = 2.5 * std::sin(1.3 * data[i]) + data[n_points + i] / 4;
+    }
+
+    {
+        const auto [ex, mse] = optimise_constants(2_dbl * sin(1.1_dbl * x) + y / 3_dbl, {"x", "y"}, data.data(),
+                                                  target.data(), n_points, {}, 100);
+
+        REQUIRE(mse < 1e-16);
+
+        const auto [ex_p, vals] = numbers_to_pars(ex);
+        REQUIRE(ex_p == par[0] * sin(par[1] * x) + y / par[2]);
+        REQUIRE(vals[0] == approximately(2.5, 1000.));
+        REQUIRE(vals[1] == approximately(1.3, 1000.));
+        REQUIRE(vals[2] == approximately(4., 1000.));
+    }
+
+    // The params already present are held fixed.
+    {
+        const auto [ex, mse] = optimise_constants(par[0] * sin(1.1_dbl * x) + .5_dbl * y, {"x", "y"}, data.data(),
+                                                  target.data(), n_points, {2.5}, 100);
+
+        REQUIRE(mse < 1e-16);
+
+        const auto [ex_p, vals] = numbers_to_pars(ex);
+        REQUIRE(ex_p == par[0] * sin(par[1] * x) + par[2] * y);
+        REQUIRE(vals[1] == approximately(1.3, 1000.));
+        REQUIRE(vals[2] == approximately(.25, 1000.));
+    }
+
+    // The mean squared error never increases.
+    expression_generator generator({"x", "y"}, engine);
+    for (auto i = 0; i < 20; ++i) {
+        const auto ex = generator(2, 4);
+        const auto mse0 = population_mse({ex}, {"x", "y"}, data.data(), target.data(), n_points)[0];
+        const auto [ex_opt, mse] = optimise_constants(ex, {"x", "y"}, data.data(), target.data(), n_points);
+
+        if (std::isfinite(mse0)) {
+            REQUIRE(mse <= mse0);
+        }
+    }
+
+    // No constants.
+    {
+        const auto [ex, mse] = optimise_constants(x - y, {"x", "y"}, data.data(), target.data(), n_points);
+        REQUIRE(ex == x - y);
+        REQUIRE(mse == population_mse({x - y}, {"x", "y"}, data.data(), target.data(), n_points)[0]);
+    }
+
+    // Error checking.
+    REQUIRE_THROWS_MATCHES(optimise_constants(x, {"x"}, data.data(), target.data(), 0), std::invalid_argument,
+                           Message("Cannot optimise the constants of an expression over an empty dataset"));
+    REQUIRE_THROWS_MATCHES(optimise_constants(x, {"x", "x"}, data.data(), target.data(), n_points),
+                           std::invalid_argument, Message("The list of variables of a dataset contains duplicates"));
+    REQUIRE_THROWS_MATCHES(
+        optimise_constants(par[1] * x, {"x"}, data.data(), target.data(), n_points, {1.}), std::invalid_argument,
+        Message("The optimisation of the constants of an expression requires 2 param value(s), but only 1 value(s) "
+                "were provided"));
+}
@@ -0,0 +1,110 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <cmath>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include <heyoka/expression.hpp>
+#include <heyoka/gp.hpp>
+#include <heyoka/gp_islands.hpp>
+#include <heyoka/splitmix64.hpp>
+
+#include "catch.hpp"
+#include "test_utils.hpp"
+
+using namespace heyoka;
+using namespace heyoka_test;
+
+TEST_CASE("gp_islands")
+{
+    using Catch::Matchers::Message;
+
+    // The dataset, generated by x * y + sin(x).
+    const auto n_points = 50u;
+    splitmix64 engine(123456789ul);
+    std::uniform_real_distribution<double> dist(-1., 1.);
+    std::vector<double> data(2u * n_points), target(n_points);
+    for (auto &v : data) {
+        v = dist(engine);
+    }
+    for (auto i = 0u; i < n_points; ++i) {
+        target[i] = data[i] * data[n_points + i] + std::sin(data[i]);
+    }
+
+    expression_generator generator({"x", "y"}, engine);
+
+    // Comparison of fitness vectors, accounting for NaNs.
+    auto same_fitness = [](const std::vector<double> &a, const std::vector<double> &b) {
+        if (a.size() != b.size()) {
+            return false;
+        }
+
+        for (decltype(a.size()) i = 0; i < a.size(); ++i) {
+            if (!(a[i] == b[i] || (std::isnan(a[i]) && std::isnan(b[i])))) {
+                return false;
+            }
+        }
+
+        return true;
+    };
+
+    gp_islands isl(generator, data.data(), target.data(), n_points, 4, 30, 42);
+    REQUIRE(isl.get_islands().size() == 4u);
+    REQUIRE(isl.get_n_gens() == 0u);
+    for (const auto &i : isl.get_islands()) {
+        REQUIRE(i.pop.size() == 30u);
+        REQUIRE(same_fitness(i.fitness, population_mse(i.pop, {"x", "y"}, data.data(), target.data(), n_points)));
+    }
+
+    // The results do not depend on the number of threads.
+    auto isl2 = isl;
+
+    auto best = isl.get_best().second;
+
+    isl.evolve(25, 10, 2, 1);
+    isl2.evolve(25, 10, 2, 3);
+    REQUIRE(isl.get_n_gens() == 25u);
+
+    for (auto i = 0u; i < 4u; ++i) {
+        REQUIRE(isl.get_islands()[i].pop == isl2.get_islands()[i].pop);
+        REQUIRE(same_fitness(isl.get_islands()[i].fitness, isl2.get_islands()[i].fitness));
+    }
+
+    // The best fitness never increases.
+    REQUIRE(isl.get_best().second <= best);
+    best = isl.get_best().second;
+
+    // Evolving in several calls is equivalent to evolving in one
+    // call, as the migrations happen at the same generations.
+    isl.evolve(10, 10, 2);
+    isl2.evolve(3, 10, 2);
+    isl2.evolve(7, 10, 2);
+    REQUIRE(isl.get_islands()[0].pop == isl2.get_islands()[0].pop);
+    REQUIRE(isl.get_best().second <= best);
+
+    const auto [ex, fit] = isl.get_best();
+    REQUIRE(fit == population_mse({ex}, {"x", "y"}, data.data(), target.data(), n_points)[0]);
+
+    // Error checking.
+    REQUIRE_THROWS_MATCHES(gp_islands(generator, data.data(), target.data(), n_points, 0, 30, 42),
+                           std::invalid_argument,
+                           Message("The number of islands of an island model cannot be zero"));
+    REQUIRE_THROWS_MATCHES(gp_islands(generator, data.data(), target.data(), n_points, 4, 0, 42),
+                           std::invalid_argument,
+                           Message("The population size of an island model cannot be zero"));
+    REQUIRE_THROWS_MATCHES(gp_islands(generator, data.data(), target.data(), 0, 4, 30, 42), std::invalid_argument,
+                           Message("Cannot run an island model over an empty dataset"));
+    REQUIRE_THROWS_MATCHES(gp_islands(generator, data.data(), target.data(), n_points, 4, 30, 42, 2, 4, 1.5),
+                           std::invalid_argument,
+                           Message("The crossover and mutation probabilities of an island model must be in the "
+                                   "[0, 1] range"));
+    REQUIRE_THROWS_MATCHES(isl.evolve(1, 0), std::invalid_argument,
+                           Message("The migration interval of an island model cannot be zero"));
+}
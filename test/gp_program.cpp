@@ -0,0 +1,270 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <cmath>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <heyoka/expression.hpp>
+#include <heyoka/gp.hpp>
+#include <heyoka/gp_program.hpp>
+#include <heyoka/math.hpp>
+#include <heyoka/splitmix64.hpp>
+
+#include "catch.hpp"
+#include "test_utils.hpp"
+
+using namespace heyoka;
+using namespace heyoka_test;
+
+namespace
+{
+
+// Compare the evaluation of p to the evaluation of ex.
+void compare_eval(const gp_program &p, const expression &ex, const std::vector<double> &pars = {})
+{
+    std::uniform_real_distribution<double> dist(-1., 1.);
+    splitmix64 engine(42u);
+
+    const auto n_vars = p.get_vars().size();
+    const auto n_points = 300u;
+
+    std::vector<double> in(n_vars * n_points), out(n_points);
+    for (auto &v : in) {
+        v = dist(engine);
+    }
+
+    p.eval_batch(out.data(), in.data(), n_points, pars);
+
+    for (auto j = 0u; j < n_points; ++j) {
+        std::vector<double> pt;
+        for (decltype(p.get_vars().size()) i = 0; i < n_vars; ++i) {
+            pt.push_back(in[i * n_points + j]);
+        }
+
+        std::unordered_map<std::string, double> in_map;
+        for (decltype(p.get_vars().size()) i = 0; i < n_vars; ++i) {
+            in_map.emplace(p.get_vars()[i], pt[i]);
+        }
+
+        const auto ref = eval_dbl(ex, in_map, pars);
+
+        if (std::isfinite(ref)) {
+            REQUIRE(out[j] == approximately(ref));
+        } else {
+            REQUIRE(!std::isfinite(out[j]));
+        }
+    }
+}
+
+} // namespace
+
+TEST_CASE("gp_program basic")
+{
+    using Catch::Matchers::Message;
+
+    auto [x, y] = make_vars("x", "y");
+
+    // Shared subexpressions are expanded into a tree.
+    const auto tmp = x * y;
+    const auto ex = tmp * tmp + sin(tmp) - exp(y) / (x + 2_dbl) + par[1] * x;
+
+    gp_program p{ex};
+    REQUIRE(p.get_vars() == std::vector<std::string>{"x", "y"});
+    REQUIRE(p.size() == count_nodes(ex));
+    REQUIRE(p.get_code().back().size == p.size());
+    REQUIRE(p.to_expression() == ex);
+
+    compare_eval(p, ex, {1., -.5});
+
+    // The subtrees match fetch_from_node_id().
+    auto ex_copy = ex;
+    for (std::size_t i = 0; i < p.size(); ++i) {
+        const auto [b, e] = p.subtree(i);
+        REQUIRE(e - b == count_nodes(*fetch_from_node_id(ex_copy, i)));
+        REQUIRE(e > b);
+    }
+
+    // A variable which does not appear in the expression.
+    gp_program p2{x * x, {"z", "x"}};
+    REQUIRE(p2.get_vars() == std::vector<std::string>{"z", "x"});
+    compare_eval(p2, x * x);
+
+    // Error checking.
+    REQUIRE_THROWS_MATCHES((gp_program{x * y, {"x"}}), std::invalid_argument,
+                           Message("The variable 'y' is not in the list of the variables of the program"));
+    REQUIRE_THROWS_MATCHES((gp_program{x * y, {"x", "y", "x"}}), std::invalid_argument,
+                           Message("The list of variables of a program contains duplicates"));
+    REQUIRE_THROWS_MATCHES(p.subtree(p.size()), std::invalid_argument,
+                           Message("The node id requested: " + std::to_string(p.size())
+                                   + " was not found in the program"));
+
+    std::vector<double> in(2), out(1);
+    REQUIRE_THROWS_MATCHES(p.eval_batch(out.data(), in.data(), 1, {1.}), std::invalid_argument,
+                           Message("The evaluation of the program requires 2 param(s), but only 1 value(s) were "
+                                   "provided"));
+}
+
+TEST_CASE("gp_program mutate crossover")
+{
+    using Catch::Matchers::Message;
+
+    splitmix64 engine(123456789ul);
+    expression_generator generator({"x", "y"}, engine);
+
+    for (auto i = 0; i < 100; ++i) {
+        auto ex1 = generator(2, 5), ex2 = generator(2, 5);
+
+        gp_program p1{ex1, {"x", "y"}}, p2{ex2, {"x", "y"}};
+        REQUIRE(p1.to_expression() == ex1);
+        REQUIRE(p2.to_expression() == ex2);
+
+        // Crossover on the programs and on the expressions.
+        std::uniform_int_distribution<std::size_t> t1(0, p1.size() - 1u), t2(0, p2.size() - 1u);
+        const auto id1 = t1(engine), id2 = t2(engine);
+
+        crossover(p1, p2, id1, id2);
+        crossover(ex1, ex2, id1, id2);
+
+        REQUIRE(p1.to_expression() == ex1);
+        REQUIRE(p2.to_expression() == ex2);
+        REQUIRE(p1.size() == count_nodes(ex1));
+        REQUIRE(p2.size() == count_nodes(ex2));
+
+        compare_eval(p1, ex1);
+        compare_eval(p2, ex2);
+
+        // The subtrees after the replacement.
+        for (std::size_t j = 0; j < p1.size(); ++j) {
+            const auto [b, e] = p1.subtree(j);
+            REQUIRE(e - b == count_nodes(*fetch_from_node_id(ex1, j)));
+            REQUIRE(p1.get_code()[e - 1u].size == e - b);
+        }
+
+        // Mutation.
+        std::uniform_int_distribution<std::size_t> t3(0, p1.size() - 1u);
+        const auto id3 = t3(engine);
+        const auto [b, e] = p1.subtree(id3);
+        const auto old_size = p1.size();
+
+        mutate(p1, id3, generator, 0u, 2u);
+
+        const auto ex3 = p1.to_expression();
+        REQUIRE(p1.size() == count_nodes(ex3));
+        REQUIRE(p1.size() - p1.subtree(id3).second + p1.subtree(id3).first == old_size - (e - b));
+        compare_eval(p1, ex3);
+
+        // Random crossover.
+        crossover(p1, p2, engine);
+        compare_eval(p1, p1.to_expression());
+        compare_eval(p2, p2.to_expression());
+    }
+
+    // Error checking.
+    auto [x, y] = make_vars("x", "y");
+    gp_program p1{x + y}, p2{x * x, {"x"}}, p3{x - y};
+    REQUIRE_THROWS_MATCHES(crossover(p1, p2, 0, 0), std::invalid_argument,
+                           Message("Cannot replace a subtree of a program with the subtree of a program "
+                                   "with a different list of variables"));
+    REQUIRE_THROWS_AS(crossover(p1, p3, 0, 3), std::invalid_argument);
+    REQUIRE_THROWS_AS(mutate(p1, 3, generator, 0, 2), std::invalid_argument);
+    REQUIRE(p1.to_expression() == x + y);
+    REQUIRE(p3.to_expression() == x - y);
+}
+
+TEST_CASE("cached_gp_program")
+{
+    using Catch::Matchers::Message;
+
+    splitmix64 engine(987654321ul);
+    expression_generator generator({"x", "y"}, engine);
+
+    std::uniform_real_distribution<double> dist(-1., 1.);
+    const auto n_points = 100u;
+    std::vector<double> data(2u * n_points), data2(2u * n_points);
+    for (auto &v : data) {
+        v = dist(engine);
+    }
+    for (auto &v : data2) {
+        v = dist(engine);
+    }
+
+    // Check the cached values of cp against a full evaluation.
+    auto check = [n_points](const cached_gp_program &cp, const std::vector<double> &in) {
+        std::vector<double> out(n_points);
+        cp.get_program().eval_batch(out.data(), in.data(), n_points);
+
+        for (auto j = 0u; j < n_points; ++j) {
+            if (std::isfinite(out[j])) {
+                REQUIRE(cp.get_values()[j] == approximately(out[j]));
+            } else {
+                REQUIRE(!std::isfinite(cp.get_values()[j]));
+            }
+        }
+
+        REQUIRE(cp.get_node_values(0) == cp.get_values());
+    };
+
+    for (auto i = 0; i < 50; ++i) {
+        // NOTE: p3 is defined over a different dataset,
+        // so that its values cannot be reused.
+        cached_gp_program p1{gp_program{generator(2, 5), {"x", "y"}}, data.data(), n_points},
+            p2{gp_program{generator(2, 5), {"x", "y"}}, data.data(), n_points},
+            p3{gp_program{generator(2, 5), {"x", "y"}}, data2.data(), n_points};
+
+        check(p1, data);
+        check(p2, data);
+        check(p3, data2);
+
+        crossover(p1, p2, engine);
+        check(p1, data);
+        check(p2, data);
+
+        crossover(p1, p3, engine);
+        check(p1, data);
+        check(p3, data2);
+
+        std::uniform_int_distribution<std::size_t> t(0, p1.get_program().size() - 1u);
+        mutate(p1, t(engine), generator, 0u, 2u);
+        check(p1, data);
+
+        // The values of the nodes.
+        std::uniform_int_distribution<std::size_t> t2(0, p2.get_program().size() - 1u);
+        const auto id = t2(engine);
+        auto ex = p2.get_program().to_expression();
+        const gp_program sub{*fetch_from_node_id(ex, id), {"x", "y"}};
+        std::vector<double> out(n_points);
+        sub.eval_batch(out.data(), data.data(), n_points);
+        for (auto j = 0u; j < n_points; ++j) {
+            if (std::isfinite(out[j])) {
+                REQUIRE(p2.get_node_values(id)[j] == approximately(out[j]));
+            }
+        }
+    }
+
+    // Params.
+    auto [x, y] = make_vars("x", "y");
+    cached_gp_program cp{gp_program{x * par[0], {"x", "y"}}, data.data(), n_points, {2.}};
+    REQUIRE(cp.get_values()[0] == 2. * data[0]);
+    cp.replace_subtree(1, gp_program{y + 1_dbl, {"x", "y"}}, 0);
+    REQUIRE(cp.get_values()[0] == approximately((data[n_points] + 1.) * 2.));
+
+    // Error checking.
+    REQUIRE_THROWS_MATCHES((cached_gp_program{gp_program{x}, data.data(), 0}), std::invalid_argument,
+                           Message("The number of points of a cached program cannot be zero"));
+    REQUIRE_THROWS_MATCHES((cached_gp_program{gp_program{x * par[0]}, data.data(), n_points}), std::invalid_argument,
+                           Message("The evaluation of the program requires 1 param(s), but only 0 value(s) were "
+                                   "provided"));
+    REQUIRE_THROWS_MATCHES(cp.replace_subtree(1, gp_program{par[3] * x, {"x", "y"}}, 0), std::invalid_argument,
+                           Message("The evaluation of the program requires 4 param(s), but only 1 value(s) were "
+                                   "provided"));
+    REQUIRE(cp.get_values()[0] == approximately((data[n_points] + 1.) * 2.));
+}
@@ -0,0 +1,102 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <cmath>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <heyoka/expression.hpp>
+#include <heyoka/gradient_tape.hpp>
+#include <heyoka/math.hpp>
+
+#include "catch.hpp"
+#include "test_utils.hpp"
+
+static std::mt19937 rng;
+
+using namespace heyoka;
+using namespace heyoka_test;
+
+TEST_CASE("gradient tape")
+{
+    using Catch::Matchers::Message;
+
+    auto [x, y, z] = make_vars("x", "y", "z");
+
+    // Shared subexpressions and functions.
+    const auto tmp = x * y;
+    const auto ex = tmp * tmp + sin(tmp) - exp(z) / (y + 2_dbl) + par[0] * x * x;
+
+    gradient_tape gt{ex};
+    REQUIRE(gt.get_expression() == ex);
+    REQUIRE(gt.get_vars() == std::vector<std::string>{"x", "y", "z"});
+    REQUIRE(gt.get_n_nodes() > 0u);
+
+    // Compare to compute_grad_dbl() at a single point.
+    const std::vector<double> pars{1.5};
+
+    std::uniform_real_distribution<double> dist(-1., 1.);
+
+    for (auto i = 0; i < 10; ++i) {
+        const std::vector<double> in{dist(rng), dist(rng), dist(rng)};
+        const std::unordered_map<std::string, double> in_map{{"x", in[0]}, {"y", in[1]}, {"z", in[2]}};
+
+        std::vector<double> grad(3);
+        const auto val = gt(grad.data(), in.data(), pars.data());
+
+        REQUIRE(val == approximately(eval_dbl(ex, in_map, pars)));
+
+        // NOTE: compute_grad_dbl() does not support params,
+        // compare the gradient of the expression without them.
+        const auto ex_np = tmp * tmp + sin(tmp) - exp(z) / (y + 2_dbl) + 1.5_dbl * x * x;
+        const auto grad_ref = compute_grad_dbl(ex_np, in_map, compute_connections(ex_np));
+
+        REQUIRE(grad[0] == approximately(grad_ref.at("x")));
+        REQUIRE(grad[1] == approximately(grad_ref.at("y")));
+        REQUIRE(grad[2] == approximately(grad_ref.at("z")));
+    }
+
+    // Batch evaluation, across several blocks.
+    const auto n_points = 150u;
+    std::vector<double> in(3u * n_points), out(n_points), grad(3u * n_points);
+    for (auto &v : in) {
+        v = dist(rng);
+    }
+
+    gt.eval_batch(out.data(), grad.data(), in.data(), n_points, pars.data());
+
+    auto gt2 = gt;
+
+    for (auto i = 0u; i < n_points; ++i) {
+        const std::vector<double> pt{in[i], in[n_points + i], in[2u * n_points + i]};
+        std::vector<double> g(3);
+
+        REQUIRE(out[i] == approximately(gt2(g.data(), pt.data(), pars.data())));
+        REQUIRE(grad[i] == approximately(g[0]));
+        REQUIRE(grad[n_points + i] == approximately(g[1]));
+        REQUIRE(grad[2u * n_points + i] == approximately(g[2]));
+    }
+
+    // x * x, division and a variable which does not appear in the expression.
+    gradient_tape gt3{x * x + 1_dbl / y, {"z", "y", "x"}};
+    std::vector<double> g3(3);
+    const std::vector<double> in3{10., 2., 3.};
+    REQUIRE(gt3(g3.data(), in3.data()) == approximately(9.5));
+    REQUIRE(g3[0] == 0.);
+    REQUIRE(g3[1] == approximately(-0.25));
+    REQUIRE(g3[2] == approximately(6.));
+
+    // Error checking.
+    REQUIRE_THROWS_MATCHES((gradient_tape{x * y, {"x"}}), std::invalid_argument,
+                           Message("The variable 'y' is not in the list of the variables of the gradient tape"));
+    REQUIRE_THROWS_MATCHES((gradient_tape{x * y, {"x", "y", "x"}}), std::invalid_argument,
+                           Message("The list of variables of a gradient tape contains duplicates"));
+}
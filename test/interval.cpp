@@ -0,0 +1,200 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <cmath>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <heyoka/expression.hpp>
+#include <heyoka/interval.hpp>
+#include <heyoka/math.hpp>
+#include <heyoka/splitmix64.hpp>
+
+#include "catch.hpp"
+#include "test_utils.hpp"
+
+using namespace heyoka;
+using namespace heyoka_test;
+
+// Check if a contains v.
+static bool contains(const interval &a, double v)
+{
+    return a.lower <= v && v <= a.upper;
+}
+
+TEST_CASE("interval arithmetic")
+{
+    const auto inf = std::numeric_limits<double>::infinity();
+
+    auto r = interval{1, 2} + interval{3, 4};
+    REQUIRE(contains(r, 4));
+    REQUIRE(contains(r, 6));
+    REQUIRE(r.lower > 3.99);
+    REQUIRE(r.upper < 6.01);
+
+    r = interval{1, 2} - interval{3, 4};
+    REQUIRE(contains(r, -3));
+    REQUIRE(contains(r, -1));
+
+    r = interval{-1, 2} * interval{3, 4};
+    REQUIRE(contains(r, -4));
+    REQUIRE(contains(r, 8));
+    REQUIRE(r.lower > -4.01);
+    REQUIRE(r.upper < 8.01);
+
+    r = interval{1, 2} / interval{4, 8};
+    REQUIRE(contains(r, .125));
+    REQUIRE(contains(r, .5));
+
+    // Division by an interval containing zero.
+    REQUIRE(interval{1, 2} / interval{-1, 1} == interval{-inf, inf});
+    REQUIRE(!is_finite(interval{1, 2} / interval{-1, 1}));
+    REQUIRE(std::isnan((interval{1, 2} / interval{0, 0}).lower));
+
+    // 0 * inf.
+    r = interval{0, 0} * interval{1, inf};
+    REQUIRE(is_finite(r));
+    REQUIRE(contains(r, 0));
+}
+
+TEST_CASE("eval_interval_dbl")
+{
+    using Catch::Matchers::Message;
+
+    auto [x, y] = make_vars("x", "y");
+
+    const auto inf = std::numeric_limits<double>::infinity();
+    const auto pi = 3.141592653589793238462643383279502884;
+
+    // Monotonic functions.
+    auto r = eval_interval_dbl(exp(x), {{"x", {0, 1}}});
+    REQUIRE(contains(r, 1));
+    REQUIRE(contains(r, std::exp(1.)));
+    REQUIRE(r.upper < std::exp(1.) + 1e-12);
+
+    r = eval_interval_dbl(acos(x), {{"x", {0, 1}}});
+    REQUIRE(contains(r, 0));
+    REQUIRE(contains(r, pi / 2));
+
+    // Domain errors.
+    REQUIRE(std::isnan(eval_interval_dbl(log(x), {{"x", {-1, 1}}}).lower));
+    REQUIRE(std::isnan(eval_interval_dbl(sqrt(x), {{"x", {-1, 1}}}).lower));
+    REQUIRE(std::isnan(eval_interval_dbl(asin(x), {{"x", {0, 2}}}).lower));
+
+    // Non-monotonic functions.
+    r = eval_interval_dbl(square(x), {{"x", {-2, 1}}});
+    REQUIRE(contains(r, 0));
+    REQUIRE(contains(r, 4));
+    REQUIRE(r.lower > -1e-300);
+
+    r = eval_interval_dbl(sin(x), {{"x", {0, pi}}});
+    REQUIRE(contains(r, 0));
+    REQUIRE(r.upper == 1);
+    REQUIRE(r.lower > -1e-12);
+
+    r = eval_interval_dbl(cos(x), {{"x", {-1, 1}}});
+    REQUIRE(r.upper == 1);
+    REQUIRE(contains(r, std::cos(1.)));
+
+    r = eval_interval_dbl(tan(x), {{"x", {1, 2}}});
+    REQUIRE(r == interval{-inf, inf});
+
+    r = eval_interval_dbl(tan(x), {{"x", {-1, 1}}});
+    REQUIRE(contains(r, std::tan(-1.)));
+    REQUIRE(contains(r, std::tan(1.)));
+    REQUIRE(is_finite(r));
+
+    // Powers.
+    r = eval_interval_dbl(pow(x, 3_dbl), {{"x", {-2, 1}}});
+    REQUIRE(contains(r, -8));
+    REQUIRE(contains(r, 1));
+    REQUIRE(r.lower > -8.01);
+
+    r = eval_interval_dbl(pow(x, -2_dbl), {{"x", {1, 2}}});
+    REQUIRE(contains(r, .25));
+    REQUIRE(contains(r, 1));
+
+    REQUIRE(std::isnan(eval_interval_dbl(pow(x, .5_dbl), {{"x", {-1, 1}}}).lower));
+
+    // Sums.
+    r = eval_interval_dbl(sum_sq({x, y}), {{"x", {-1, 1}}, {"y", {2, 3}}});
+    REQUIRE(contains(r, 4));
+    REQUIRE(contains(r, 10));
+    REQUIRE(r.lower > 3.99);
+
+    // Params.
+    r = eval_interval_dbl(x * par[0], {{"x", {1, 2}}}, {3.});
+    REQUIRE(contains(r, 3));
+    REQUIRE(contains(r, 6));
+
+    // Dependency problem: x - x is not [0, 0].
+    r = eval_interval_dbl(x - x, {{"x", {1, 2}}});
+    REQUIRE(contains(r, -1));
+    REQUIRE(contains(r, 1));
+
+    // Random checks of the enclosure property.
+    const auto ex = sin(x) * cos(y) + exp(x * y) / (1.5_dbl + tanh(y)) - sqrt(square(x) + 1_dbl);
+    splitmix64 engine(42u);
+    std::uniform_real_distribution<double> dist(-2., 2.);
+
+    for (auto i = 0; i < 100; ++i) {
+        auto a = dist(engine), b = dist(engine), c = dist(engine), d = dist(engine);
+        if (a > b) {
+            std::swap(a, b);
+        }
+        if (c > d) {
+            std::swap(c, d);
+        }
+
+        r = eval_interval_dbl(ex, {{"x", {a, b}}, {"y", {c, d}}});
+
+        for (auto j = 0; j < 10; ++j) {
+            const auto xv = a + (b - a) * (dist(engine) + 2) / 4, yv = c + (d - c) * (dist(engine) + 2) / 4;
+
+            REQUIRE(contains(r, eval_dbl(ex, {{"x", xv}, {"y", yv}})));
+        }
+    }
+
+    // Error handling.
+    REQUIRE_THROWS_MATCHES(
+        eval_interval_dbl(x + y, {{"x", {1, 2}}}), std::invalid_argument,
+        Message("Cannot evaluate the variable 'y' because it is missing from the evaluation map"));
+    REQUIRE_THROWS_MATCHES(
+        eval_interval_dbl(x, {{"x", {2, 1}}}), std::invalid_argument,
+        Message("Invalid interval [2, 1] supplied for the variable 'x' in an interval evaluation"));
+}
+
+TEST_CASE("eval_batch_interval_dbl")
+{
+    using Catch::Matchers::Message;
+
+    auto [x, y] = make_vars("x", "y");
+
+    const auto ex = x * y + exp(x);
+
+    std::vector<interval> out;
+    eval_batch_interval_dbl(out, ex, {{"x", {{0, 1}, {-1, 0}, {2, 2}}}, {"y", {{1, 2}, {0, 1}, {3, 4}}}});
+
+    REQUIRE(out.size() == 3u);
+    REQUIRE(out[0] == eval_interval_dbl(ex, {{"x", {0, 1}}, {"y", {1, 2}}}));
+    REQUIRE(out[1] == eval_interval_dbl(ex, {{"x", {-1, 0}}, {"y", {0, 1}}}));
+    REQUIRE(out[2] == eval_interval_dbl(ex, {{"x", {2, 2}}, {"y", {3, 4}}}));
+
+    // Empty map.
+    eval_batch_interval_dbl(out, 1_dbl + par[0], {}, {2.});
+    REQUIRE(out.size() == 1u);
+    REQUIRE(contains(out[0], 3));
+
+    REQUIRE_THROWS_AS(eval_batch_interval_dbl(out, ex, {{"x", {{0, 1}}}, {"y", {{1, 2}, {0, 1}}}}),
+                      std::invalid_argument);
+}
@@ -6,15 +6,37 @@
 // Public License v. 2.0. If a copy of the MPL was not distributed
 // with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
 
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <initializer_list>
 #include <iostream>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+
+#include <unistd.h>
+
+#endif
 
 #include <heyoka/expression.hpp>
+#include <heyoka/func.hpp>
 #include <heyoka/llvm_state.hpp>
+#include <heyoka/math/atan.hpp>
+#include <heyoka/math/sin.hpp>
 #include <heyoka/taylor.hpp>
 
 #include "catch.hpp"
+#include "test_utils.hpp"
 
 using namespace heyoka;
+using namespace heyoka_test;
 
 TEST_CASE("basic")
 {
@@ -36,3 +58,989 @@ TEST_CASE("save object code")
 
     std::cout << "The object code size is: " << s.get_object_code().size() << '\n';
 }
+
+TEST_CASE("copy semantics")
+{
+    auto [x, y] = make_vars("x", "y");
+
+    // Uncompiled state.
+    {
+        llvm_state s{kw::mname = "sample state", kw::opt_level = 2u, kw::fast_math = true};
+        taylor_add_jet_dbl(s, "foo", {prime(x) = y, prime(y) = (1_dbl - x * x) * y - x}, 21, 1, true, false);
+
+        auto s2 = s;
+        REQUIRE(!s2.is_compiled());
+        REQUIRE(s2.get_ir() == s.get_ir());
+        REQUIRE(s2.opt_level() == 2u);
+        REQUIRE(s2.fast_math());
+
+        s.compile();
+        s2.compile();
+
+        REQUIRE(s.jit_lookup("foo") != s2.jit_lookup("foo"));
+    }
+
+    // Compiled state.
+    {
+        llvm_state s{kw::save_object_code = true};
+        taylor_add_jet_dbl(s, "foo", {prime(x) = y, prime(y) = (1_dbl - x * x) * y - x}, 21, 1, true, false);
+        s.compile();
+
+        // The copy shares the compiled code.
+        auto s2 = s;
+        REQUIRE(s2.is_compiled());
+        REQUIRE(s2.get_ir() == s.get_ir());
+        REQUIRE(s2.get_object_code() == s.get_object_code());
+        REQUIRE(s2.jit_lookup("foo") == s.jit_lookup("foo"));
+
+        // The compiled code is kept alive by the copy.
+        const auto addr = s2.jit_lookup("foo");
+        s = llvm_state{};
+        REQUIRE(s2.jit_lookup("foo") == addr);
+
+        // A deep copy re-compiles the code.
+        auto s3 = s2.deep_copy();
+        REQUIRE(s3.is_compiled());
+        REQUIRE(s3.get_ir() == s2.get_ir());
+        REQUIRE(!s3.get_object_code().empty());
+        REQUIRE(s3.jit_lookup("foo") != s2.jit_lookup("foo"));
+    }
+}
+
+TEST_CASE("object cache")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    // Reference integrator, without cache.
+    auto ta0 = taylor_adaptive<double>{{prime(x) = v, prime(v) = -9.8 * sin(x)}, {0.05, 0.025}};
+    REQUIRE(!ta0.get_llvm_state().cache_hit());
+    REQUIRE(ta0.get_llvm_state().get_cache_dir().empty());
+
+    // NOTE: the first integrator may or may not hit the cache,
+    // depending on whether the test was already run.
+    auto ta1 = taylor_adaptive<double>{
+        {prime(x) = v, prime(v) = -9.8 * sin(x)}, {0.05, 0.025}, kw::cache_dir = "heyoka_test_cache"};
+    REQUIRE(ta1.get_llvm_state().get_cache_dir() == "heyoka_test_cache");
+
+    auto ta2 = taylor_adaptive<double>{
+        {prime(x) = v, prime(v) = -9.8 * sin(x)}, {0.05, 0.025}, kw::cache_dir = "heyoka_test_cache"};
+    REQUIRE(ta2.get_llvm_state().cache_hit());
+
+    // Copies preserve the cache information.
+    auto ta3 = ta2;
+    REQUIRE(ta3.get_llvm_state().cache_hit());
+
+    // The cached code produces the same results.
+    ta0.propagate_until(10.);
+    ta2.propagate_until(10.);
+    ta3.propagate_until(10.);
+
+    REQUIRE(ta2.get_state() == ta0.get_state());
+    REQUIRE(ta3.get_state() == ta0.get_state());
+}
+
+TEST_CASE("parallel compilation")
+{
+    REQUIRE(llvm_state{}.get_compile_threads() == 1u);
+    REQUIRE(llvm_state{kw::compile_threads = 0u}.get_compile_threads() >= 1u);
+    REQUIRE(llvm_state{kw::compile_threads = 3u}.get_compile_threads() == 3u);
+
+    auto [x, v] = make_vars("x", "v");
+
+    for (auto cm : {false, true}) {
+        auto ta0 = taylor_adaptive<double>{
+            {prime(x) = v, prime(v) = -9.8 * sin(x)}, {0.05, 0.025}, kw::compact_mode = cm};
+        auto ta1 = taylor_adaptive<double>{{prime(x) = v, prime(v) = -9.8 * sin(x)},
+                                           {0.05, 0.025},
+                                           kw::compact_mode = cm,
+                                           kw::compile_threads = 4u};
+
+        REQUIRE(ta1.get_llvm_state().get_compile_threads() == 4u);
+
+        ta0.propagate_until(10.);
+        ta1.propagate_until(10.);
+
+        // NOTE: the results may not be bitwise identical, as the
+        // partitioned optimisation prevents inlining across partitions.
+        REQUIRE(ta1.get_state()[0] == approximately(ta0.get_state()[0], 10000.));
+        REQUIRE(ta1.get_state()[1] == approximately(ta0.get_state()[1], 10000.));
+
+        // Copies and serialisation.
+        auto ta2 = ta1;
+        REQUIRE(ta2.get_llvm_state().get_compile_threads() == 4u);
+
+        std::stringstream ss;
+        ta1.save(ss);
+        taylor_adaptive<double> ta3;
+        ta3.load(ss);
+        REQUIRE(ta3.get_llvm_state().get_compile_threads() == 4u);
+
+        ta1.propagate_until(20.);
+        ta3.propagate_until(20.);
+        REQUIRE(ta3.get_state() == ta1.get_state());
+    }
+}
+
+TEST_CASE("512-bit vectors")
+{
+    REQUIRE(!llvm_state{}.prefer_vw512());
+    REQUIRE(llvm_state{kw::prefer_vw512 = true}.prefer_vw512());
+
+    // The recommended batch sizes.
+    REQUIRE(recommended_batch_size<double>() >= 1u);
+    REQUIRE(recommended_batch_size<double>(true) >= recommended_batch_size<double>());
+    REQUIRE(recommended_batch_size<long double>() == 1u);
+    REQUIRE(recommended_batch_size<long double>(true) == 1u);
+
+    auto [x, v] = make_vars("x", "v");
+
+    const auto batch_size = recommended_batch_size<double>(true);
+
+    for (auto cm : {false, true}) {
+        auto ta0 = taylor_adaptive<double>{
+            {prime(x) = v, prime(v) = -9.8 * sin(x)}, {0.05, 0.025}, kw::compact_mode = cm};
+
+        auto tab = taylor_adaptive_batch<double>{{prime(x) = v, prime(v) = -9.8 * sin(x)},
+                                                 std::vector<double>(2u * batch_size, 0.05),
+                                                 batch_size,
+                                                 kw::compact_mode = cm,
+                                                 kw::prefer_vw512 = true};
+        for (std::uint32_t i = 0; i < batch_size; ++i) {
+            tab.get_state_data()[batch_size + i] = 0.025;
+        }
+
+        REQUIRE(tab.get_llvm_state().prefer_vw512());
+
+        ta0.propagate_until(10.);
+        tab.propagate_until(std::vector<double>(batch_size, 10.));
+
+        for (std::uint32_t i = 0; i < batch_size; ++i) {
+            REQUIRE(tab.get_state()[i] == approximately(ta0.get_state()[0], 1000.));
+            REQUIRE(tab.get_state()[batch_size + i] == approximately(ta0.get_state()[1], 1000.));
+        }
+
+        // Copies and serialisation.
+        auto tab2 = tab;
+        REQUIRE(tab2.get_llvm_state().prefer_vw512());
+
+        std::stringstream ss;
+        tab.save(ss);
+        taylor_adaptive_batch<double> tab3;
+        tab3.load(ss);
+        REQUIRE(tab3.get_llvm_state().prefer_vw512());
+    }
+}
+
+TEST_CASE("target cpu")
+{
+    const auto host_cpu = llvm_state{}.get_target_cpu();
+
+    REQUIRE_THROWS_AS(llvm_state{kw::target_cpu = "not_a_cpu"}, std::invalid_argument);
+
+    auto [x, v] = make_vars("x", "v");
+
+    // Compile an integrator for an explicitly-specified target CPU
+    // (the host CPU, so that we can run the code).
+    auto ta0 = taylor_adaptive<double>{{prime(x) = v, prime(v) = -9.8 * sin(x)}, {0.05, 0.025}};
+    auto ta1 = taylor_adaptive<double>{
+        {prime(x) = v, prime(v) = -9.8 * sin(x)}, {0.05, 0.025}, kw::target_cpu = host_cpu};
+
+    REQUIRE(ta1.get_llvm_state().get_target_cpu() == host_cpu);
+
+    // Save the integrator, load it back and run it.
+    std::stringstream ss;
+    ta1.save(ss);
+    taylor_adaptive<double> ta2;
+    ta2.load(ss);
+
+    REQUIRE(ta2.get_llvm_state().get_target_cpu() == host_cpu);
+    REQUIRE(ta2.get_llvm_state().get_target_features() == ta1.get_llvm_state().get_target_features());
+
+    ta0.propagate_until(10.);
+    ta2.propagate_until(10.);
+
+    REQUIRE(ta2.get_state()[0] == approximately(ta0.get_state()[0], 1000.));
+    REQUIRE(ta2.get_state()[1] == approximately(ta0.get_state()[1], 1000.));
+}
+
+TEST_CASE("isa variants")
+{
+    const auto host_cpu = llvm_state{}.get_target_cpu();
+
+    // ISA variants can be added only if compiled.
+    {
+        llvm_state s;
+        auto vs = s.make_variant(host_cpu);
+        REQUIRE(vs.get_target_cpu() == host_cpu);
+        REQUIRE_THROWS_AS(s.add_variant(vs), std::invalid_argument);
+    }
+
+    auto [x, v] = make_vars("x", "v");
+
+    auto ta0 = taylor_adaptive<double>{{prime(x) = v, prime(v) = -9.8 * sin(x)}, {0.05, 0.025}};
+    auto ta1 = taylor_adaptive<double>{{prime(x) = v, prime(v) = -9.8 * sin(x)},
+                                       {0.05, 0.025},
+                                       kw::isa_variants = std::vector<std::string>{host_cpu}};
+
+    REQUIRE(ta1.get_llvm_state().get_n_variants() == 1u);
+
+    // The variants are preserved in copies.
+    auto ta2 = ta1;
+    REQUIRE(ta2.get_llvm_state().get_n_variants() == 1u);
+
+    // Save and load back: the variants not selected are kept around.
+    std::stringstream ss;
+    ta1.save(ss);
+    taylor_adaptive<double> ta3;
+    ta3.load(ss);
+
+    REQUIRE(ta3.get_llvm_state().get_n_variants() == 1u);
+    REQUIRE(ta3.get_llvm_state().get_target_cpu() == host_cpu);
+
+    ta0.propagate_until(10.);
+    ta3.propagate_until(10.);
+
+    REQUIRE(ta3.get_state()[0] == approximately(ta0.get_state()[0], 1000.));
+    REQUIRE(ta3.get_state()[1] == approximately(ta0.get_state()[1], 1000.));
+
+#if defined(__x86_64__)
+
+    // Compile the main code for the generic x86-64 CPU, with a variant
+    // for the host CPU. On loading, the host variant must be selected
+    // (provided that the host CPU is more capable than the generic one).
+    if (host_cpu != "x86-64" && recommended_batch_size_dbl() >= 4u) {
+        auto tab = taylor_adaptive_batch<double>{{prime(x) = v, prime(v) = -9.8 * sin(x)},
+                                                 {0.05, 0.051, 0.025, 0.026},
+                                                 2,
+                                                 kw::target_cpu = "x86-64",
+                                                 kw::isa_variants = std::vector<std::string>{host_cpu}};
+
+        REQUIRE(tab.get_llvm_state().get_target_cpu() == "x86-64");
+
+        ss.str("");
+        tab.save(ss);
+        taylor_adaptive_batch<double> tab2;
+        tab2.load(ss);
+
+        REQUIRE(tab2.get_llvm_state().get_target_cpu() == host_cpu);
+        REQUIRE(tab2.get_llvm_state().get_n_variants() == 1u);
+
+        tab.propagate_until({10., 10.});
+        tab2.propagate_until({10., 10.});
+
+        for (auto i = 0u; i < 4u; ++i) {
+            REQUIRE(tab2.get_state()[i] == approximately(tab.get_state()[i], 1000.));
+        }
+    }
+
+#endif
+}
+
+TEST_CASE("shared jit session")
+{
+    using std::cos;
+    using std::sqrt;
+
+    auto [x, v] = make_vars("x", "v");
+
+    // Several integrators share the same jit session: make sure
+    // that the symbols of the different states do not clash,
+    // also after some of the states have been destroyed.
+    std::vector<taylor_adaptive<double>> tas;
+    for (auto i = 0; i < 10; ++i) {
+        tas.push_back(taylor_adaptive<double>{{prime(x) = v, prime(v) = -(i + 1.) * x}, {1., 0.}});
+    }
+
+    for (auto i = 0; i < 10; ++i) {
+        tas[i].propagate_until(1.);
+        REQUIRE(tas[i].get_state()[0] == approximately(cos(sqrt(i + 1.)), 10000.));
+    }
+
+    tas.erase(tas.begin(), tas.begin() + 5);
+
+    for (auto i = 10; i < 15; ++i) {
+        tas.push_back(taylor_adaptive<double>{{prime(x) = v, prime(v) = -(i + 1.) * x}, {1., 0.}});
+    }
+
+    for (auto i = 5; i < 15; ++i) {
+        auto &ta = tas[static_cast<decltype(tas.size())>(i - 5)];
+
+        ta.propagate_until(2.);
+        REQUIRE(ta.get_state()[0] == approximately(cos(sqrt(i + 1.) * 2.), 10000.));
+    }
+}
+
+TEST_CASE("opt profiles")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    {
+        std::ostringstream oss;
+        oss << opt_profile::fast_compile;
+        REQUIRE(oss.str() == "fast_compile");
+    }
+
+    REQUIRE(llvm_state{}.get_opt_profile() == opt_profile::standard);
+
+    auto ta0 = taylor_adaptive<double>{{prime(x) = v, prime(v) = -9.8 * sin(x)}, {0.05, 0.025}};
+    ta0.propagate_until(10.);
+
+    for (auto p : {opt_profile::standard, opt_profile::fast_compile, opt_profile::aggressive}) {
+        for (auto cm : {false, true}) {
+            auto ta = taylor_adaptive<double>{
+                {prime(x) = v, prime(v) = -9.8 * sin(x)}, {0.05, 0.025}, kw::opt_profile = p, kw::compact_mode = cm};
+
+            REQUIRE(ta.get_llvm_state().get_opt_profile() == p);
+            REQUIRE(ta.get_llvm_state().get_optimise_time() > 0);
+            REQUIRE(ta.get_llvm_state().get_compile_time() > 0);
+
+            // Copies and serialisation.
+            auto ta2 = ta;
+            REQUIRE(ta2.get_llvm_state().get_opt_profile() == p);
+
+            std::stringstream ss;
+            ta.save(ss);
+            taylor_adaptive<double> ta3;
+            ta3.load(ss);
+            REQUIRE(ta3.get_llvm_state().get_opt_profile() == p);
+
+            ta.propagate_until(10.);
+
+            REQUIRE(ta.get_state()[0] == approximately(ta0.get_state()[0], 1000.));
+            REQUIRE(ta.get_state()[1] == approximately(ta0.get_state()[1], 1000.));
+        }
+    }
+}
+
+TEST_CASE("sleef accuracy")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    {
+        std::ostringstream oss;
+        oss << sleef_accuracy::u35;
+        REQUIRE(oss.str() == "u35");
+    }
+
+    REQUIRE(llvm_state{}.get_sleef_accuracy() == sleef_accuracy::u10);
+
+    {
+        std::ostringstream oss;
+        oss << llvm_state{kw::sleef_accuracy = sleef_accuracy::u35};
+        REQUIRE(oss.str().find("SLEEF accuracy     : u35") != std::string::npos);
+    }
+
+    // The 3.5-ULP variants are used only if requested.
+    for (auto acc : {sleef_accuracy::u10, sleef_accuracy::u35}) {
+        llvm_state s{kw::sleef_accuracy = acc};
+
+        taylor_add_jet<double>(s, "jet", {prime(x) = v, prime(v) = -9.8 * sin(x)}, 3, 4, false, false);
+
+        const auto ir = s.get_ir();
+
+        if (acc == sleef_accuracy::u10) {
+            REQUIRE(ir.find("_u35") == std::string::npos);
+        } else if (ir.find("Sleef_sind") != std::string::npos) {
+            REQUIRE(ir.find("_u35") != std::string::npos);
+        }
+    }
+
+    auto ta0 = taylor_adaptive_batch<double>{
+        {prime(x) = v, prime(v) = -9.8 * sin(x)}, {0.05, 0.06, 0.07, 0.08, 0.025, 0.026, 0.027, 0.028}, 4};
+    ta0.propagate_until({10., 10., 10., 10.});
+
+    for (auto cm : {false, true}) {
+        auto ta = taylor_adaptive_batch<double>{{prime(x) = v, prime(v) = -9.8 * sin(x)},
+                                                {0.05, 0.06, 0.07, 0.08, 0.025, 0.026, 0.027, 0.028},
+                                                4,
+                                                kw::sleef_accuracy = sleef_accuracy::u35,
+                                                kw::compact_mode = cm};
+
+        REQUIRE(ta.get_llvm_state().get_sleef_accuracy() == sleef_accuracy::u35);
+
+        // Copies and serialisation.
+        auto ta2 = ta;
+        REQUIRE(ta2.get_llvm_state().get_sleef_accuracy() == sleef_accuracy::u35);
+
+        std::stringstream ss;
+        ta.save(ss);
+        taylor_adaptive_batch<double> ta3;
+        ta3.load(ss);
+        REQUIRE(ta3.get_llvm_state().get_sleef_accuracy() == sleef_accuracy::u35);
+
+        ta.propagate_until({10., 10., 10., 10.});
+
+        for (auto i = 0u; i < 8u; ++i) {
+            REQUIRE(ta.get_state()[i] == approximately(ta0.get_state()[i], 10000.));
+        }
+    }
+}
+
+TEST_CASE("sleef bitcode")
+{
+    auto x = "x"_var;
+
+    REQUIRE(llvm_state{}.get_sleef_bitcode().empty());
+
+    {
+        std::ostringstream oss;
+        oss << llvm_state{};
+        REQUIRE(oss.str().find("SLEEF bitcode      : none") != std::string::npos);
+    }
+
+#if defined(_MSC_VER)
+    const std::string fname = "heyoka_atanl";
+#else
+    const std::string fname = "atanl";
+#endif
+
+    // Fetch the LLVM type of long double from the IR.
+    std::string ldbl_t;
+    {
+        llvm_state s;
+        taylor_add_jet<long double>(s, "jet", {atan(x)}, 1, 1, false, false);
+
+        const auto ir = s.get_ir();
+        const auto end = ir.find(" @" + fname + "(");
+        REQUIRE(end != std::string::npos);
+        const auto beg = ir.rfind("declare ", end) + 8u;
+        ldbl_t = ir.substr(beg, end - beg);
+        // NOTE: skip the attributes of the return
+        // value, if any.
+        ldbl_t = ldbl_t.substr(ldbl_t.rfind(' ') + 1u);
+    }
+
+    // Write a vector implementation of the function in textual IR.
+    const auto vec_t = "<2 x " + ldbl_t + ">";
+    {
+        std::ofstream ofs("heyoka_test_sleef_bitcode.ll");
+        ofs << "declare " << ldbl_t << " @" << fname << "(" << ldbl_t << ")\n\n";
+        ofs << "define " << vec_t << " @heyoka_test_bc_atanl2(" << vec_t << " %x) {\n";
+        ofs << "  %a = extractelement " << vec_t << " %x, i32 0\n";
+        ofs << "  %b = extractelement " << vec_t << " %x, i32 1\n";
+        ofs << "  %ra = call " << ldbl_t << " @" << fname << "(" << ldbl_t << " %a)\n";
+        ofs << "  %rb = call " << ldbl_t << " @" << fname << "(" << ldbl_t << " %b)\n";
+        ofs << "  %v0 = insertelement " << vec_t << " undef, " << ldbl_t << " %ra, i32 0\n";
+        ofs << "  %v1 = insertelement " << vec_t << " %v0, " << ldbl_t << " %rb, i32 1\n";
+        ofs << "  ret " << vec_t << " %v1\n}\n\n";
+        // An unused function, which must not be linked.
+        ofs << "define " << ldbl_t << " @heyoka_test_bc_unused(" << ldbl_t << " %x) {\n";
+        ofs << "  ret " << ldbl_t << " %x\n}\n";
+    }
+
+    using jet_t = void (*)(long double *, const long double *, const long double *);
+
+    std::vector<long double> jet0{.1l, .2l, 0, 0}, jet1 = jet0;
+
+    llvm_state s_ref;
+    taylor_add_jet<long double>(s_ref, "jet", {atan(x)}, 1, 2, false, false);
+    s_ref.compile();
+    reinterpret_cast<jet_t>(s_ref.jit_lookup("jet"))(jet0.data(), nullptr, nullptr);
+
+    register_vector_function(fname, 2, "heyoka_test_bc_atanl2");
+
+    llvm_state s{kw::sleef_bitcode = "heyoka_test_sleef_bitcode.ll"};
+    REQUIRE(s.get_sleef_bitcode() == "heyoka_test_sleef_bitcode.ll");
+    taylor_add_jet<long double>(s, "jet", {atan(x)}, 1, 2, false, false);
+
+    unregister_vector_functions(fname);
+
+    REQUIRE(s.get_ir().find("declare " + vec_t + " @heyoka_test_bc_atanl2") != std::string::npos);
+
+    s.optimise();
+
+    // The vector implementation was linked in and inlined.
+    auto ir = s.get_ir();
+    REQUIRE(ir.find("@heyoka_test_bc_atanl2") == std::string::npos);
+    REQUIRE(ir.find("@heyoka_test_bc_unused") == std::string::npos);
+
+    s.compile();
+    reinterpret_cast<jet_t>(s.jit_lookup("jet"))(jet1.data(), nullptr, nullptr);
+    REQUIRE(jet0 == jet1);
+
+    // Copies and serialisation.
+    {
+        auto s2 = s;
+        REQUIRE(s2.get_sleef_bitcode() == "heyoka_test_sleef_bitcode.ll");
+
+        std::stringstream ss;
+        s.save(ss);
+        llvm_state s3;
+        s3.load(ss);
+        REQUIRE(s3.get_sleef_bitcode() == "heyoka_test_sleef_bitcode.ll");
+    }
+
+    // Error handling.
+    {
+        llvm_state s_err{kw::sleef_bitcode = "heyoka_test_nonexistent.bc"};
+        taylor_add_jet<long double>(s_err, "jet", {atan(x)}, 1, 1, false, false);
+        REQUIRE_THROWS_AS(s_err.optimise(), std::invalid_argument);
+    }
+
+    {
+        {
+            std::ofstream ofs("heyoka_test_sleef_bitcode_invalid.ll");
+            ofs << "invalid IR";
+        }
+
+        llvm_state s_err{kw::sleef_bitcode = "heyoka_test_sleef_bitcode_invalid.ll"};
+        taylor_add_jet<long double>(s_err, "jet", {atan(x)}, 1, 1, false, false);
+        REQUIRE_THROWS_AS(s_err.optimise(), std::invalid_argument);
+    }
+}
+
+TEST_CASE("stats")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    for (auto cm : {false, true}) {
+        for (auto n_threads : {1u, 2u}) {
+            auto ta = taylor_adaptive<double>{{prime(x) = v, prime(v) = -9.8 * sin(x)},
+                                              {0.05, 0.025},
+                                              kw::compact_mode = cm,
+                                              kw::compile_threads = n_threads};
+
+            const auto &st = ta.get_llvm_state().stats();
+
+            std::cout << st << '\n';
+
+            REQUIRE(st.decompose_time > 0);
+            REQUIRE(st.cse_time > 0);
+            REQUIRE(st.sort_time > 0);
+            REQUIRE(st.decompose_time >= st.cse_time + st.sort_time);
+            REQUIRE(st.ir_gen_time > 0);
+            REQUIRE(st.segment_time <= st.ir_gen_time);
+            if (cm) {
+                REQUIRE(st.segment_time > 0);
+            } else {
+                REQUIRE(st.segment_time == 0);
+            }
+            REQUIRE(st.opt_time > 0);
+            REQUIRE(st.codegen_time > 0);
+            REQUIRE(st.link_time > 0);
+            REQUIRE(st.n_ir_instructions > 0u);
+            REQUIRE(st.n_opt_ir_instructions > 0u);
+            REQUIRE(st.object_size > 0u);
+        }
+    }
+}
+
+TEST_CASE("lazy functions")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    {
+        llvm_state s;
+        s.mark_lazy("jet");
+        s.mark_lazy("missing");
+        taylor_add_jet<double>(s, "jet", {prime(x) = v, prime(v) = -9.8 * sin(x)}, 3, 1, false, false);
+        s.compile();
+
+        REQUIRE_THROWS_AS(s.mark_lazy("jet"), std::invalid_argument);
+
+        llvm_state s_eager{kw::save_object_code = true};
+        s_eager.mark_lazy("jet");
+        taylor_add_jet<double>(s_eager, "jet", {prime(x) = v, prime(v) = -9.8 * sin(x)}, 3, 1, false, false);
+        s_eager.compile();
+
+        using jet_t = void (*)(double *, const double *, const double *);
+
+        std::vector<double> jet0{0.05, 0.025, 0, 0, 0, 0, 0, 0}, jet1 = jet0;
+
+        reinterpret_cast<jet_t>(s.jit_lookup("jet"))(jet0.data(), nullptr, nullptr);
+        reinterpret_cast<jet_t>(s_eager.jit_lookup("jet"))(jet1.data(), nullptr, nullptr);
+
+        REQUIRE(jet0 == jet1);
+
+        // Copies share the lazily-compiled code.
+        auto s2 = s;
+        REQUIRE(s2.jit_lookup("jet") == s.jit_lookup("jet"));
+    }
+
+    // The dense output in the integrators.
+    for (auto cm : {false, true}) {
+        auto ta0 = taylor_adaptive<double>{
+            {prime(x) = v, prime(v) = -9.8 * sin(x)}, {0.05, 0.025}, kw::compact_mode = cm};
+        auto ta1 = taylor_adaptive<double>{{prime(x) = v, prime(v) = -9.8 * sin(x)},
+                                           {0.05, 0.025},
+                                           kw::compact_mode = cm,
+                                           kw::save_object_code = true};
+
+        ta0.step(true);
+        ta1.step(true);
+
+        auto ta2 = ta0;
+
+        REQUIRE(ta0.update_d_output(ta0.get_time() / 2) == ta1.update_d_output(ta1.get_time() / 2));
+        REQUIRE(ta2.update_d_output(ta2.get_time() / 2) == ta1.update_d_output(ta1.get_time() / 2));
+
+        std::stringstream ss;
+        ta0.save(ss);
+        taylor_adaptive<double> ta3;
+        ta3.load(ss);
+        REQUIRE(ta3.update_d_output(ta3.get_time() / 2) == ta1.update_d_output(ta1.get_time() / 2));
+    }
+}
+
+TEST_CASE("load object code")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    llvm_state s0{kw::save_object_code = true};
+    taylor_add_jet<double>(s0, "jet", {prime(x) = v, prime(v) = -9.8 * sin(x)}, 3, 1, false, false);
+    s0.compile();
+    s0.dump_object_code("heyoka_test_load_object_code.o");
+
+    llvm_state s1;
+    s1.load_object_code("heyoka_test_load_object_code.o");
+
+    REQUIRE(s1.is_compiled());
+    REQUIRE(s1.get_object_code().empty());
+    REQUIRE(s1.stats().object_size == s0.get_object_code().size());
+    REQUIRE_THROWS_AS(s1.load_object_code("heyoka_test_load_object_code.o"), std::invalid_argument);
+
+    // Keep a copy of the object code if requested.
+    llvm_state s2{kw::save_object_code = true};
+    s2.load_object_code("heyoka_test_load_object_code.o");
+    REQUIRE(s2.get_object_code() == s0.get_object_code());
+
+    using jet_t = void (*)(double *, const double *, const double *);
+
+    std::vector<double> jet0{0.05, 0.025, 0, 0, 0, 0, 0, 0}, jet1 = jet0;
+
+    reinterpret_cast<jet_t>(s0.jit_lookup("jet"))(jet0.data(), nullptr, nullptr);
+    reinterpret_cast<jet_t>(s1.jit_lookup("jet"))(jet1.data(), nullptr, nullptr);
+
+    REQUIRE(jet0 == jet1);
+
+    REQUIRE_THROWS_AS(llvm_state{}.load_object_code("heyoka_test_nonexistent.o"), std::invalid_argument);
+}
+
+TEST_CASE("pgo")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    {
+        llvm_state s;
+        REQUIRE(!s.pgo_instrumented());
+        REQUIRE_THROWS_AS(s.pgo_recompile(), std::invalid_argument);
+
+        taylor_add_jet<double>(s, "jet", {prime(x) = v, prime(v) = -9.8 * sin(x)}, 3, 1, false, true);
+        s.compile();
+
+        REQUIRE_THROWS_AS(s.pgo_instrument(), std::invalid_argument);
+        REQUIRE_THROWS_AS(s.pgo_recompile(), std::invalid_argument);
+    }
+
+    for (auto cm : {false, true}) {
+        for (auto batch_size : {1u, 2u}) {
+            auto ta0 = taylor_adaptive_batch<double>{{prime(x) = v, prime(v) = -9.8 * sin(x)},
+                                                     std::vector<double>(2u * batch_size, 0.05),
+                                                     batch_size,
+                                                     kw::compact_mode = cm};
+            auto ta1 = taylor_adaptive_batch<double>{{prime(x) = v, prime(v) = -9.8 * sin(x)},
+                                                     std::vector<double>(2u * batch_size, 0.05),
+                                                     batch_size,
+                                                     kw::compact_mode = cm,
+                                                     kw::pgo_steps = 10u};
+
+            REQUIRE(!ta0.get_llvm_state().pgo_instrumented());
+            REQUIRE(ta1.get_llvm_state().pgo_instrumented());
+
+            for (auto i = 0; i < 9; ++i) {
+                ta0.step();
+                ta1.step();
+            }
+
+            REQUIRE(ta1.get_llvm_state().pgo_instrumented());
+
+            // The copies and the serialised integrators
+            // preserve the pending recompilation.
+            auto ta2 = ta1;
+
+            std::stringstream ss;
+            ta1.save(ss);
+            taylor_adaptive_batch<double> ta3;
+            ta3.load(ss);
+
+            ta0.step();
+            ta1.step();
+            ta2.step();
+            ta3.step();
+
+            REQUIRE(!ta1.get_llvm_state().pgo_instrumented());
+            REQUIRE(!ta2.get_llvm_state().pgo_instrumented());
+            REQUIRE(!ta3.get_llvm_state().pgo_instrumented());
+
+            for (auto i = 0; i < 10; ++i) {
+                ta0.step();
+                ta1.step();
+            }
+
+            // NOTE: the results may not be bitwise identical,
+            // as the profile data alters the optimisation.
+            for (auto j = 0u; j < 2u * batch_size; ++j) {
+                REQUIRE(ta1.get_state()[j] == approximately(ta0.get_state()[j], 1000.));
+            }
+
+            const auto &d_out0 = ta0.update_d_output(ta0.get_time());
+            const auto &d_out1 = ta1.update_d_output(ta1.get_time());
+            for (auto j = 0u; j < 2u * batch_size; ++j) {
+                REQUIRE(d_out1[j] == approximately(d_out0[j], 1000.));
+            }
+        }
+    }
+
+    auto ta0 = taylor_adaptive<double>{{prime(x) = v, prime(v) = -9.8 * sin(x)}, {0.05, 0.025}};
+    auto ta1
+        = taylor_adaptive<double>{{prime(x) = v, prime(v) = -9.8 * sin(x)}, {0.05, 0.025}, kw::pgo_steps = 5u};
+
+    ta0.propagate_until(10.);
+    ta1.propagate_until(10.);
+
+    REQUIRE(!ta1.get_llvm_state().pgo_instrumented());
+    REQUIRE(ta1.get_state()[0] == approximately(ta0.get_state()[0], 1000.));
+    REQUIRE(ta1.get_state()[1] == approximately(ta0.get_state()[1], 1000.));
+}
+
+TEST_CASE("concurrent construction")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    for (auto cm : {false, true}) {
+        auto ta0 = taylor_adaptive<double>{
+            {prime(x) = v, prime(v) = -9.8 * sin(x)}, {0.05, 0.025}, kw::compact_mode = cm};
+        ta0.propagate_until(10.);
+
+        const auto n_threads = std::max(4u, std::thread::hardware_concurrency());
+
+        std::vector<std::vector<double>> states(n_threads);
+        std::vector<std::thread> threads;
+
+        for (auto i = 0u; i < n_threads; ++i) {
+            threads.emplace_back([&, i]() {
+                // NOTE: use different profiles, so that
+                // the integrators share or do not share
+                // the jit session.
+                auto ta = taylor_adaptive<double>{{prime(x) = v, prime(v) = -9.8 * sin(x)},
+                                                  {0.05, 0.025},
+                                                  kw::compact_mode = cm,
+                                                  kw::opt_profile = i % 2u == 0u ? opt_profile::standard
+                                                                                 : opt_profile::fast_compile};
+
+                ta.propagate_until(10.);
+
+                states[i] = ta.get_state();
+            });
+        }
+
+        for (auto &t : threads) {
+            t.join();
+        }
+
+        for (auto i = 0u; i < n_threads; ++i) {
+            REQUIRE(states[i][0] == approximately(ta0.get_state()[0], 1000.));
+            REQUIRE(states[i][1] == approximately(ta0.get_state()[1], 1000.));
+        }
+    }
+}
+
+TEST_CASE("jit listeners")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    {
+        std::ostringstream oss;
+        oss << (jit_listener::gdb | jit_listener::intel);
+        REQUIRE(oss.str() == "gdb|intel");
+    }
+
+    {
+        std::ostringstream oss;
+        oss << jit_listener::none;
+        REQUIRE(oss.str() == "none");
+    }
+
+    REQUIRE(llvm_state{}.get_jit_listeners() == jit_listener::none);
+
+#if defined(__linux__)
+    const auto ls = jit_listener::gdb | jit_listener::perf_map;
+#else
+    const auto ls = jit_listener::gdb;
+#endif
+
+    {
+        std::ostringstream oss;
+        oss << llvm_state{kw::jit_listeners = jit_listener::gdb};
+        REQUIRE(oss.str().find("JIT listeners      : gdb") != std::string::npos);
+    }
+
+    auto ta0 = taylor_adaptive<double>{{prime(x) = v, prime(v) = -9.8 * sin(x)}, {0.05, 0.025}};
+    ta0.propagate_until(10.);
+
+    for (auto cm : {false, true}) {
+        auto ta = taylor_adaptive<double>{
+            {prime(x) = v, prime(v) = -9.8 * sin(x)}, {0.05, 0.025}, kw::compact_mode = cm, kw::jit_listeners = ls};
+
+        REQUIRE(ta.get_llvm_state().get_jit_listeners() == ls);
+
+        // Copies and serialisation.
+        auto ta2 = ta;
+        REQUIRE(ta2.get_llvm_state().get_jit_listeners() == ls);
+
+        std::stringstream ss;
+        ta.save(ss);
+        taylor_adaptive<double> ta3;
+        ta3.load(ss);
+        REQUIRE(ta3.get_llvm_state().get_jit_listeners() == ls);
+
+        // The listeners do not alter the compiled code.
+        ta.propagate_until(10.);
+        REQUIRE(ta.get_state() == ta0.get_state());
+    }
+
+#if defined(__linux__)
+    // The symbols of the compiled functions
+    // were written to the perf map file.
+    std::ifstream pmap("/tmp/perf-" + std::to_string(::getpid()) + ".map");
+    REQUIRE(pmap.good());
+    const std::string pmap_str{std::istreambuf_iterator<char>(pmap), std::istreambuf_iterator<char>()};
+    REQUIRE(pmap_str.find(" step\n") != std::string::npos);
+#endif
+}
+
+TEST_CASE("memory usage")
+{
+    auto [x, y] = make_vars("x", "y");
+
+    llvm_state s;
+    taylor_add_jet_dbl(s, "foo", {prime(x) = y, prime(y) = (1_dbl - x * x) * y - x}, 21, 1, true, false);
+
+    // Nothing is accounted for before the compilation.
+    REQUIRE(s.memory_usage().total() == 0u);
+    REQUIRE_THROWS_AS(s.drop_ir_snapshot(), std::invalid_argument);
+
+    s.compile();
+
+    auto mu = s.memory_usage();
+    REQUIRE(mu.ir_snapshot > 0u);
+    REQUIRE(mu.object_code == 0u);
+    REQUIRE(mu.jit_code > 0u);
+    REQUIRE(mu.total() == mu.ir_snapshot + mu.jit_code);
+
+    std::ostringstream oss;
+    oss << mu;
+    REQUIRE(oss.str().find("Total       : " + std::to_string(mu.total())) != std::string::npos);
+
+    REQUIRE(!s.ir_snapshot_dropped());
+    s.drop_ir_snapshot();
+    REQUIRE(s.ir_snapshot_dropped());
+    REQUIRE(s.memory_usage().ir_snapshot == 0u);
+
+    // The compiled code is still usable.
+    REQUIRE(s.jit_lookup("foo") != 0u);
+
+    REQUIRE_THROWS_AS(s.get_ir(), std::invalid_argument);
+    REQUIRE_THROWS_AS(s.deep_copy(), std::invalid_argument);
+
+    // Without the object code, the state cannot be saved.
+    {
+        std::stringstream ss;
+        REQUIRE_THROWS_AS(s.save(ss), std::invalid_argument);
+    }
+
+    // The copies share the flag.
+    auto s2 = s;
+    REQUIRE(s2.ir_snapshot_dropped());
+
+    oss.str("");
+    oss << s;
+    REQUIRE(oss.str().find("IR size            : dropped") != std::string::npos);
+
+    // With the object code, the saved state
+    // keeps track of the dropped snapshot.
+    llvm_state s3{kw::save_object_code = true};
+    taylor_add_jet_dbl(s3, "foo", {prime(x) = y, prime(y) = (1_dbl - x * x) * y - x}, 21, 1, true, false);
+    s3.compile();
+    REQUIRE(s3.memory_usage().object_code == s3.get_object_code().size());
+    s3.drop_ir_snapshot();
+
+    std::stringstream ss;
+    s3.save(ss);
+    llvm_state s4;
+    s4.load(ss);
+    REQUIRE(s4.ir_snapshot_dropped());
+    REQUIRE(s4.memory_usage().jit_code == s3.get_object_code().size());
+    REQUIRE(s4.jit_lookup("foo") != 0u);
+}
+
+TEST_CASE("ir snapshot")
+{
+    auto [x, y] = make_vars("x", "y");
+
+    // The IR of a compiled state is re-created from the snapshot.
+    {
+        llvm_state s;
+        taylor_add_jet_dbl(s, "foo", {prime(x) = y, prime(y) = (1_dbl - x * x) * y - x}, 21, 1, true, false);
+        s.compile();
+
+        REQUIRE(s.memory_usage().ir_snapshot > 0u);
+        REQUIRE(s.get_ir().find("@foo") != std::string::npos);
+        REQUIRE(s.get_ir() == s.uncompiled_copy().get_ir());
+    }
+
+    // Disable the snapshot.
+    llvm_state s{kw::ir_snapshot = false};
+    taylor_add_jet_dbl(s, "foo", {prime(x) = y, prime(y) = (1_dbl - x * x) * y - x}, 21, 1, true, false);
+
+    // The IR is available before the compilation.
+    REQUIRE(s.get_ir().find("@foo") != std::string::npos);
+
+    s.compile();
+
+    REQUIRE(s.ir_snapshot_dropped());
+    REQUIRE(s.memory_usage().ir_snapshot == 0u);
+    REQUIRE_THROWS_AS(s.get_ir(), std::invalid_argument);
+    REQUIRE_THROWS_AS(s.uncompiled_copy(), std::invalid_argument);
+
+    // The object code is stored instead.
+    REQUIRE(!s.get_object_code().empty());
+
+    // The deep copies re-use the object code.
+    auto s2 = s.deep_copy();
+    REQUIRE(s2.is_compiled());
+    REQUIRE(s2.ir_snapshot_dropped());
+    REQUIRE(s2.get_object_code() == s.get_object_code());
+    REQUIRE(s2.jit_lookup("foo") != 0u);
+    REQUIRE(s2.jit_lookup("foo") != s.jit_lookup("foo"));
+
+    // Serialisation.
+    std::stringstream ss;
+    s.save(ss);
+    llvm_state s3;
+    s3.load(ss);
+    REQUIRE(s3.ir_snapshot_dropped());
+    REQUIRE(s3.jit_lookup("foo") != 0u);
+
+    // The deep copies of a state with the snapshot
+    // and the object code share the snapshot.
+    llvm_state s4{kw::save_object_code = true};
+    taylor_add_jet_dbl(s4, "foo", {prime(x) = y, prime(y) = (1_dbl - x * x) * y - x}, 21, 1, true, false);
+    s4.compile();
+    auto s5 = s4.deep_copy();
+    REQUIRE(!s5.ir_snapshot_dropped());
+    REQUIRE(s5.get_ir() == s4.get_ir());
+    REQUIRE(s5.jit_lookup("foo") != s4.jit_lookup("foo"));
+
+    // Integrators in compact mode can be copied without the snapshot.
+    auto ta = taylor_adaptive<double>{{prime(x) = y, prime(y) = (1_dbl - x * x) * y - x},
+                                      {0., 1.},
+                                      kw::compact_mode = true,
+                                      kw::ir_snapshot = false};
+    REQUIRE(ta.get_llvm_state().ir_snapshot_dropped());
+
+    auto ta2 = ta;
+    ta.propagate_until(10.);
+    ta2.propagate_until(10.);
+    REQUIRE(ta.get_state() == ta2.get_state());
+}
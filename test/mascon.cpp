@@ -0,0 +1,194 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <heyoka/expression.hpp>
+#include <heyoka/kw.hpp>
+#include <heyoka/mascon.hpp>
+#include <heyoka/taylor.hpp>
+
+#include "catch.hpp"
+#include "test_utils.hpp"
+
+using namespace heyoka;
+using namespace heyoka_test;
+
+TEST_CASE("mascon multipole")
+{
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<double> pdist(-.5, .5), mdist(.5, 1.5);
+
+    const auto n_points = 300u;
+
+    std::vector<std::vector<double>> points;
+    std::vector<double> masses;
+    for (auto i = 0u; i < n_points; ++i) {
+        points.push_back({pdist(rng), pdist(rng), pdist(rng)});
+        masses.push_back(mdist(rng) / n_points);
+    }
+
+    const std::vector<double> omega{.1, .2, .3};
+
+    auto full = make_mascon_system(kw::points = points, kw::masses = masses, kw::omega = omega, kw::Gconst = 1.5);
+    const auto full_size = taylor_decompose(full).size();
+
+    for (auto tol : {1e-4, 1e-6, 1e-8}) {
+        for (auto min_radius : {2., 5., 20.}) {
+            auto mp = make_mascon_multipole_system(kw::points = points, kw::masses = masses, kw::omega = omega,
+                                                   kw::Gconst = 1.5, kw::tol = tol, kw::min_radius = min_radius);
+
+            REQUIRE(mp.size() == 6u);
+            REQUIRE(taylor_decompose(mp).size() <= full_size);
+
+            // Compare the accelerations in random points outside the sphere.
+            std::normal_distribution<double> ndist;
+            std::uniform_real_distribution<double> rdist(min_radius, 2 * min_radius);
+
+            for (auto k = 0; k < 20; ++k) {
+                const auto gx = ndist(rng), gy = ndist(rng), gz = ndist(rng);
+                const auto r = rdist(rng) / std::sqrt(gx * gx + gy * gy + gz * gz);
+
+                std::unordered_map<std::string, double> map{{"x", gx * r},   {"y", gy * r},   {"z", gz * r},
+                                                            {"vx", ndist(rng)}, {"vy", ndist(rng)}, {"vz", ndist(rng)}};
+
+                for (auto j = 0u; j < 3u; ++j) {
+                    REQUIRE(eval_dbl(mp[j].second, map) == eval_dbl(full[j].second, map));
+                }
+
+                // Compare the gravitational accelerations only.
+                std::vector<double> acc_mp, acc_full;
+                auto map0 = map;
+                map0["vx"] = map0["vy"] = map0["vz"] = 0;
+                for (auto j = 3u; j < 6u; ++j) {
+                    acc_mp.push_back(eval_dbl(mp[j].second, map0));
+                    acc_full.push_back(eval_dbl(full[j].second, map0));
+                }
+
+                auto diff = 0., norm = 0.;
+                for (auto j = 0u; j < 3u; ++j) {
+                    diff += (acc_mp[j] - acc_full[j]) * (acc_mp[j] - acc_full[j]);
+                    norm += acc_full[j] * acc_full[j];
+                }
+
+                REQUIRE(std::sqrt(diff) <= 10 * tol * std::sqrt(norm) + 1e-14);
+            }
+        }
+    }
+
+    // The multipole system decreases in size as min_radius grows.
+    auto mp_near = make_mascon_multipole_system(kw::points = points, kw::masses = masses, kw::omega = omega,
+                                                kw::tol = 1e-4, kw::min_radius = 2.);
+    auto mp_far = make_mascon_multipole_system(kw::points = points, kw::masses = masses, kw::omega = omega,
+                                               kw::tol = 1e-4, kw::min_radius = 20.);
+    REQUIRE(taylor_decompose(mp_far).size() < taylor_decompose(mp_near).size());
+    REQUIRE(taylor_decompose(mp_far).size() < full_size);
+
+    // A very small sphere yields the full model.
+    auto mp_exact = make_mascon_multipole_system(kw::points = points, kw::masses = masses, kw::omega = omega,
+                                                 kw::tol = 1e-8, kw::min_radius = 1e-3);
+    std::unordered_map<std::string, double> map{{"x", 1.},  {"y", -.5}, {"z", .25},
+                                                {"vx", .1}, {"vy", .2}, {"vz", .3}};
+    for (auto j = 3u; j < 6u; ++j) {
+        REQUIRE(eval_dbl(mp_exact[j].second, map) == approximately(eval_dbl(full[j].second, map), 1000.));
+    }
+
+    // Error handling.
+    REQUIRE_THROWS_AS(make_mascon_multipole_system(kw::points = points, kw::masses = std::vector<double>{1.},
+                                                   kw::omega = omega, kw::tol = 1e-8, kw::min_radius = 2.),
+                      std::invalid_argument);
+    REQUIRE_THROWS_AS(make_mascon_multipole_system(kw::points = points, kw::masses = masses, kw::omega = omega,
+                                                   kw::tol = -1., kw::min_radius = 2.),
+                      std::invalid_argument);
+    REQUIRE_THROWS_AS(make_mascon_multipole_system(kw::points = points, kw::masses = masses, kw::omega = omega,
+                                                   kw::tol = 1e-8, kw::min_radius = 0.),
+                      std::invalid_argument);
+    REQUIRE_THROWS_AS(make_mascon_multipole_system(kw::points = std::vector<std::vector<double>>{{1., 2.}},
+                                                   kw::masses = std::vector<double>{1.}, kw::omega = omega,
+                                                   kw::tol = 1e-8, kw::min_radius = 2.),
+                      std::invalid_argument);
+}
+
+TEST_CASE("mascon par system")
+{
+    std::mt19937 rng(123);
+    std::uniform_real_distribution<double> pdist(-.5, .5), mdist(.5, 1.5);
+
+    const auto n_points = 20u;
+
+    auto make_model = [&]() {
+        std::vector<std::vector<double>> points;
+        std::vector<double> masses;
+        for (auto i = 0u; i < n_points; ++i) {
+            points.push_back({pdist(rng), pdist(rng), pdist(rng)});
+            masses.push_back(mdist(rng) / n_points);
+        }
+
+        return std::make_pair(points, masses);
+    };
+
+    const auto [points_a, masses_a] = make_model();
+    const auto [points_b, masses_b] = make_model();
+    const std::vector<double> omega_a{0., 0., .5}, omega_b{.1, -.2, .3};
+
+    auto sys = make_mascon_par_system(n_points, kw::Gconst = 1.5);
+    REQUIRE(sys.size() == 6u);
+
+    const auto pars_a = make_mascon_pars(points_a, masses_a, omega_a);
+    REQUIRE(pars_a.size() == 4u * n_points + 3u);
+
+    // Check the values of the r.h.s.
+    auto full_a = make_mascon_system(kw::points = points_a, kw::masses = masses_a, kw::omega = omega_a,
+                                     kw::Gconst = 1.5);
+    std::unordered_map<std::string, double> map{{"x", 1.},  {"y", -.5}, {"z", .25},
+                                                {"vx", .1}, {"vy", .2}, {"vz", .3}};
+    for (auto j = 0u; j < 6u; ++j) {
+        REQUIRE(eval_dbl(sys[j].second, map, pars_a) == approximately(eval_dbl(full_a[j].second, map)));
+    }
+
+    // The same integrator is re-used for different models.
+    const std::vector<double> ic{2., 0., 0., 0., .6, .2};
+
+    for (auto cm : {false, true}) {
+        auto ta = taylor_adaptive<double>{sys, ic, kw::pars = pars_a, kw::compact_mode = cm};
+
+        auto ta_a = taylor_adaptive<double>{full_a, ic, kw::compact_mode = cm};
+        ta.propagate_until(5.);
+        ta_a.propagate_until(5.);
+
+        for (auto j = 0u; j < 6u; ++j) {
+            REQUIRE(ta.get_state()[j] == approximately(ta_a.get_state()[j], 1000.));
+        }
+
+        auto ta_b = taylor_adaptive<double>{make_mascon_system(kw::points = points_b, kw::masses = masses_b,
+                                                               kw::omega = omega_b, kw::Gconst = 1.5),
+                                            ic, kw::compact_mode = cm};
+        const auto pars_b = make_mascon_pars(points_b, masses_b, omega_b);
+        std::copy(pars_b.begin(), pars_b.end(), ta.get_pars_data());
+        ta.set_time(0.);
+        std::copy(ic.begin(), ic.end(), ta.get_state_data());
+        ta.propagate_until(5.);
+        ta_b.propagate_until(5.);
+
+        for (auto j = 0u; j < 6u; ++j) {
+            REQUIRE(ta.get_state()[j] == approximately(ta_b.get_state()[j], 1000.));
+        }
+    }
+
+    // Error handling.
+    REQUIRE_THROWS_AS(make_mascon_pars(points_a, std::vector<double>{1.}, omega_a), std::invalid_argument);
+    REQUIRE_THROWS_AS(make_mascon_pars(std::vector<std::vector<double>>{{1., 2.}}, std::vector<double>{1.}, omega_a),
+                      std::invalid_argument);
+}
@@ -9,11 +9,20 @@
 #include <algorithm>
 #include <array>
 #include <cmath>
+#include <cstddef>
+#include <cstdint>
 #include <initializer_list>
 #include <iostream>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <string>
 #include <utility>
+#include <variant>
 #include <vector>
 
+#include <boost/math/constants/constants.hpp>
+
 #include <xtensor-blas/xlinalg.hpp>
 #include <xtensor/xadapt.hpp>
 #include <xtensor/xfixed.hpp>
@@ -21,7 +30,12 @@
 #include <xtensor/xview.hpp>
 
 #include <heyoka/detail/simple_timer.hpp>
+#include <heyoka/expression.hpp>
+#include <heyoka/func.hpp>
+#include <heyoka/llvm_state.hpp>
+#include <heyoka/math.hpp>
 #include <heyoka/nbody.hpp>
+#include <heyoka/number.hpp>
 #include <heyoka/taylor.hpp>
 
 #include "catch.hpp"
@@ -41,6 +55,42 @@ TEST_CASE("N-body param")
     }
 }
 
+// Check that the r**-3 terms are computed once per interacting
+// pair in the Taylor decompositions.
+TEST_CASE("N-body pair terms")
+{
+    auto count_func = [](const auto &sys, const std::string &name) {
+        const auto dc = taylor_decompose(sys);
+
+        return std::count_if(dc.begin(), dc.end(), [&name](const auto &p) {
+            const auto fptr = std::get_if<func>(&p.first.value());
+
+            return fptr != nullptr && fptr->get_name() == name;
+        });
+    };
+
+    auto check = [&count_func](const auto &sys, long n_pairs) {
+        REQUIRE(count_func(sys, "pow") == n_pairs);
+        REQUIRE(count_func(sys, "sum_sq") == n_pairs);
+    };
+
+    // All bodies interact with each other.
+    check(make_nbody_sys(6), 15);
+    check(make_nbody_par_sys(6), 15);
+
+    // Restricted cases: the massless-massless
+    // interactions are skipped.
+    check(make_nbody_sys(6, kw::masses = {1., 1., 0., 0., 0., 0.}), 9);
+    check(make_nbody_par_sys(6, kw::n_massive = 2), 9);
+    check(make_nbody_sys(6, kw::masses = {0., 1., 0., 1., 0., 0.}), 9);
+    check(make_nbody_sys(3, kw::masses = {0., 0., 0.}), 0);
+
+    // Large system, whose equations are decomposed in parallel:
+    // the pair terms shared by equations decomposed
+    // by different workers must be merged as well.
+    check(make_nbody_sys(200), 19900);
+}
+
 // Test case for an issue that arised when using
 // null masses.
 TEST_CASE("zero mass")
@@ -199,3 +249,366 @@ TEST_CASE("N-body")
         }
     }
 }
+
+TEST_CASE("N-body loop jet")
+{
+    using Catch::Matchers::Message;
+
+    const auto G = 1.5;
+    const auto order = 8u;
+
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<double> dist(-1., 1.), mdist(.5, 2.);
+
+    for (auto n : {2u, 3u, 5u}) {
+        for (auto batch_size : {1u, 2u, 4u}) {
+            llvm_state s;
+
+            taylor_add_nbody_jet<double>(s, "jet_loop", n, order, batch_size, number{G});
+            taylor_add_jet<double>(s, "jet_sys", make_nbody_par_sys(n, kw::Gconst = G), order, batch_size, false,
+                                   false);
+
+            s.compile();
+
+            auto jptr_loop
+                = reinterpret_cast<void (*)(double *, const double *, const double *)>(s.jit_lookup("jet_loop"));
+            auto jptr_sys
+                = reinterpret_cast<void (*)(double *, const double *, const double *)>(s.jit_lookup("jet_sys"));
+
+            // Random initial conditions, with the bodies far enough from each other.
+            std::vector<double> jet_loop(6u * n * (order + 1u) * batch_size), pars(n * batch_size);
+            for (auto i = 0u; i < 6u * n * batch_size; ++i) {
+                jet_loop[i] = dist(rng) + ((i / batch_size) % 6u < 3u ? 3. * ((i / batch_size) / 6u) : 0.);
+            }
+            for (auto &m : pars) {
+                m = mdist(rng);
+            }
+            auto jet_sys = jet_loop;
+
+            const double time = 0;
+            jptr_loop(jet_loop.data(), pars.data(), &time);
+            jptr_sys(jet_sys.data(), pars.data(), &time);
+
+            for (decltype(jet_loop.size()) i = 0; i < jet_loop.size(); ++i) {
+                REQUIRE(jet_loop[i] == approximately(jet_sys[i], 10000.));
+            }
+
+            // Check that massless bodies are supported.
+            std::fill(pars.begin() + static_cast<std::ptrdiff_t>(batch_size), pars.end(), 0.);
+            std::fill(jet_loop.begin() + static_cast<std::ptrdiff_t>(6u * n * batch_size), jet_loop.end(), 0.);
+            jptr_loop(jet_loop.data(), pars.data(), &time);
+
+            // The acceleration on the only massive body is zero.
+            for (auto k = 3u; k < 6u; ++k) {
+                for (auto b = 0u; b < batch_size; ++b) {
+                    REQUIRE(jet_loop[6u * n * batch_size + k * batch_size + b] == 0.);
+                }
+            }
+        }
+    }
+
+    // Error handling.
+    llvm_state s;
+
+    REQUIRE_THROWS_MATCHES(taylor_add_nbody_jet<double>(s, "jet", 1, 3, 1), std::invalid_argument,
+                           Message("At least 2 bodies are needed to construct an N-body system"));
+    REQUIRE_THROWS_MATCHES(taylor_add_nbody_jet<double>(s, "jet", 2, 0, 1), std::invalid_argument,
+                           Message("The order of a Taylor jet cannot be zero"));
+    REQUIRE_THROWS_MATCHES(taylor_add_nbody_jet<double>(s, "jet", 2, 3, 0), std::invalid_argument,
+                           Message("The batch size of a Taylor jet cannot be zero"));
+    REQUIRE_THROWS_AS(taylor_add_nbody_jet<double>(s, "jet", 100000u, 3, 1), std::overflow_error);
+}
+
+TEST_CASE("oe conversions")
+{
+    const auto pi = boost::math::constants::pi<double>();
+    const std::array<std::pair<double, double>, 6> bounds{std::pair{.5, 5.}, std::pair{.01, .9},
+                                                          std::pair{.01, pi - .01}, std::pair{0., 2 * pi},
+                                                          std::pair{0., 2 * pi}, std::pair{0., 2 * pi}};
+
+    // Round trip of the scalar versions.
+    for (auto i = 0u; i < 100u; ++i) {
+        const auto s = random_elliptic_state(1.5, bounds, i);
+        const auto oe = cartesian_to_oe(1.5, s);
+        const auto s2 = oe_to_cartesian(1.5, oe);
+
+        for (auto j = 0u; j < 6u; ++j) {
+            REQUIRE(std::abs(s2[j] - s[j]) < 1e-10 * (1 + std::abs(s[j])));
+        }
+    }
+
+    // Batch versions.
+    const std::size_t n = 5000;
+    std::array<std::vector<double>, 6> st, st1, oe, st2;
+    for (auto j = 0u; j < 6u; ++j) {
+        st[j].resize(n);
+        st1[j].resize(n);
+        oe[j].resize(n);
+        st2[j].resize(n);
+    }
+
+    auto ptrs = [](auto &v) {
+        return std::array{v[0].data(), v[1].data(), v[2].data(), v[3].data(), v[4].data(), v[5].data()};
+    };
+    auto cptrs = [](const auto &v) {
+        return std::array<const double *, 6>{v[0].data(), v[1].data(), v[2].data(),
+                                             v[3].data(), v[4].data(), v[5].data()};
+    };
+
+    random_elliptic_state_batch(1.5, bounds, ptrs(st), n, 42);
+
+    // The results do not depend on the number of threads.
+    for (auto n_threads : {1u, 3u}) {
+        random_elliptic_state_batch(1.5, bounds, ptrs(st1), n, 42, n_threads);
+        REQUIRE(st1 == st);
+    }
+
+    // A different seed gives different states.
+    random_elliptic_state_batch(1.5, bounds, ptrs(st1), n, 43);
+    REQUIRE(st1 != st);
+
+    cartesian_to_oe_batch(1.5, cptrs(st), ptrs(oe), n);
+    oe_to_cartesian_batch(1.5, cptrs(oe), ptrs(st2), n);
+
+    for (std::size_t i = 0; i < n; ++i) {
+        const std::array s{st[0][i], st[1][i], st[2][i], st[3][i], st[4][i], st[5][i]};
+
+        // Consistency with the scalar versions.
+        const auto oe_s = cartesian_to_oe(1.5, s);
+        for (auto j = 0u; j < 6u; ++j) {
+            REQUIRE(std::abs(oe[j][i] - oe_s[j]) < 1e-9 * (1 + std::abs(oe_s[j])));
+        }
+
+        // The elements are within the bounds.
+        for (auto j = 0u; j < 3u; ++j) {
+            REQUIRE(oe[j][i] >= bounds[j].first * (1 - 1e-9));
+            REQUIRE(oe[j][i] <= bounds[j].second * (1 + 1e-9));
+        }
+
+        // Round trip.
+        for (auto j = 0u; j < 6u; ++j) {
+            REQUIRE(std::abs(st2[j][i] - st[j][i]) < 1e-10 * (1 + std::abs(st[j][i])));
+        }
+    }
+
+    // Empty batches.
+    REQUIRE_NOTHROW(cartesian_to_oe_batch(1.5, cptrs(st), ptrs(oe), 0));
+
+    // Error handling.
+    REQUIRE_THROWS_AS(oe_to_cartesian(-1., {1., .1, .1, .1, .1, .1}), std::invalid_argument);
+    REQUIRE_THROWS_AS(oe_to_cartesian(1., {1., 1.1, .1, .1, .1, .1}), std::invalid_argument);
+    REQUIRE_THROWS_AS(oe_to_cartesian(1., {-1., .1, .1, .1, .1, .1}), std::invalid_argument);
+    REQUIRE_THROWS_AS(oe_to_cartesian(1., {1., .1, .1, std::nan(""), .1, .1}), std::invalid_argument);
+    REQUIRE_THROWS_AS(oe_to_cartesian_batch(0., cptrs(oe), ptrs(st2), n), std::invalid_argument);
+    REQUIRE_THROWS_AS(cartesian_to_oe_batch(0., cptrs(st), ptrs(oe), n), std::invalid_argument);
+    auto bad_bounds = bounds;
+    bad_bounds[1] = std::pair{.1, 1.5};
+    REQUIRE_THROWS_AS(random_elliptic_state_batch(1.5, bad_bounds, ptrs(st1), n, 42), std::invalid_argument);
+}
+
+TEST_CASE("N-body jacobi dh")
+{
+    const std::vector<double> masses{1., 1e-3, 3e-4, 0.};
+    const auto n = static_cast<std::uint32_t>(masses.size());
+
+    // Build a barycentric state from heliocentric orbits.
+    std::vector<double> state(6u * n);
+    const std::array<std::array<double, 6>, 3> oes{std::array{1., .05, .1, .2, .3, .4},
+                                                   std::array{2.1, .1, .05, 1., 2., 3.},
+                                                   std::array{3.5, .2, .3, 4., 5., 6.}};
+    for (auto i = 1u; i < n; ++i) {
+        const auto s = oe_to_cartesian(masses[0] + masses[i], oes[i - 1u]);
+        std::copy(s.begin(), s.end(), state.begin() + 6 * i);
+    }
+    const auto tot_mass = masses[0] + masses[1] + masses[2] + masses[3];
+    for (auto j = 0u; j < 6u; ++j) {
+        double com = 0;
+        for (auto i = 0u; i < n; ++i) {
+            com += masses[i] * state[6u * i + j];
+        }
+        com /= tot_mass;
+        for (auto i = 0u; i < n; ++i) {
+            state[6u * i + j] -= com;
+        }
+    }
+
+    // Round trips of the conversions.
+    const auto jstate = nbody_to_jacobi(masses, state);
+    const auto dhstate = nbody_to_dh(masses, state);
+    REQUIRE(jstate.size() == 6u * (n - 1u));
+    REQUIRE(dhstate.size() == 6u * (n - 1u));
+
+    for (const auto &s : {nbody_from_jacobi(masses, jstate), nbody_from_dh(masses, dhstate)}) {
+        REQUIRE(s.size() == state.size());
+        for (decltype(s.size()) i = 0; i < s.size(); ++i) {
+            REQUIRE(s[i] == approximately(state[i], 1000.));
+        }
+    }
+
+    // The first Jacobi vector and the heliocentric
+    // positions are relative to body 0.
+    for (auto j = 0u; j < 3u; ++j) {
+        REQUIRE(jstate[j] == approximately(state[6u + j] - state[j], 1000.));
+        REQUIRE(dhstate[j] == approximately(state[6u + j] - state[j], 1000.));
+    }
+
+    // Compare the integrations with the barycentric system.
+    const auto tf = 20.;
+
+    auto ta = taylor_adaptive<double>{make_nbody_sys(n, kw::masses = masses), state};
+    auto ta_j = taylor_adaptive<double>{make_nbody_jacobi_sys(n, kw::masses = masses), jstate};
+    auto ta_dh = taylor_adaptive<double>{make_nbody_dh_sys(n, kw::masses = masses), dhstate};
+
+    REQUIRE(ta_j.get_state().size() == 6u * (n - 1u));
+    REQUIRE(ta_dh.get_state().size() == 6u * (n - 1u));
+
+    REQUIRE(std::get<0>(ta.propagate_until(tf)) == taylor_outcome::time_limit);
+    REQUIRE(std::get<0>(ta_j.propagate_until(tf)) == taylor_outcome::time_limit);
+    REQUIRE(std::get<0>(ta_dh.propagate_until(tf)) == taylor_outcome::time_limit);
+
+    for (const auto &s : {nbody_from_jacobi(masses, ta_j.get_state()), nbody_from_dh(masses, ta_dh.get_state())}) {
+        for (decltype(s.size()) i = 0; i < s.size(); ++i) {
+            REQUIRE(std::abs(s[i] - ta.get_state()[i]) < 1e-10);
+        }
+    }
+
+    // Error handling.
+    REQUIRE_THROWS_AS(make_nbody_jacobi_sys(1), std::invalid_argument);
+    REQUIRE_THROWS_AS(make_nbody_dh_sys(1), std::invalid_argument);
+    REQUIRE_THROWS_AS(make_nbody_jacobi_sys(3, kw::masses = {1., 1.}), std::invalid_argument);
+    REQUIRE_THROWS_AS(make_nbody_dh_sys(3, kw::masses = {1., 1.}), std::invalid_argument);
+    REQUIRE_THROWS_AS(make_nbody_jacobi_sys(2, kw::masses = {0., 1.}), std::invalid_argument);
+    REQUIRE_THROWS_AS(make_nbody_dh_sys(2, kw::masses = {0., 1.}), std::invalid_argument);
+
+    REQUIRE_THROWS_AS(nbody_to_jacobi({1.}, {0., 0., 0., 0., 0., 0.}), std::invalid_argument);
+    REQUIRE_THROWS_AS(nbody_to_jacobi({0., 1.}, std::vector<double>(12u)), std::invalid_argument);
+    REQUIRE_THROWS_AS(nbody_to_dh({1., -1.}, std::vector<double>(12u)), std::invalid_argument);
+    REQUIRE_THROWS_AS(nbody_from_jacobi({1., 1.}, std::vector<double>(12u)), std::invalid_argument);
+    REQUIRE_THROWS_AS(nbody_from_dh({1., 1.}, std::vector<double>(5u)), std::invalid_argument);
+}
+
+TEST_CASE("two-body regularised")
+{
+    const auto pi = boost::math::constants::pi<double>();
+    const auto mu = 1.5;
+
+    // Round trips of the KS conversions (covering both signs of x).
+    const std::array<std::pair<double, double>, 6> bounds{std::pair{.5, 5.}, std::pair{.01, .99},
+                                                          std::pair{.01, pi - .01}, std::pair{0., 2 * pi},
+                                                          std::pair{0., 2 * pi}, std::pair{0., 2 * pi}};
+    for (auto i = 0u; i < 100u; ++i) {
+        const auto s = random_elliptic_state(mu, bounds, i);
+        const auto ks = cartesian_to_ks(mu, s, 1.25);
+
+        // The bilinear relation.
+        REQUIRE(std::abs(ks[3] * ks[4] - ks[2] * ks[5] + ks[1] * ks[6] - ks[0] * ks[7]) < 1e-12);
+        REQUIRE(ks[9] == 1.25);
+
+        const auto s2 = ks_to_cartesian(ks);
+        for (auto j = 0u; j < 6u; ++j) {
+            REQUIRE(std::abs(s2[j] - s[j]) < 1e-12 * (1 + std::abs(s[j])));
+        }
+        REQUIRE(s2[6] == 1.25);
+    }
+
+    // Unperturbed, highly eccentric orbit starting from the pericentre: compare
+    // the states at the apocentre and after 3 periods with the analytical solution.
+    const std::array oe{1., .99, .3, .4, .5, 0.};
+    const auto s0 = oe_to_cartesian(mu, oe);
+    auto oe_apo = oe;
+    oe_apo[5] = pi;
+    const auto s_apo = oe_to_cartesian(mu, oe_apo);
+    const auto period = 2 * pi / std::sqrt(mu);
+
+    for (auto alpha : {1., 1.5}) {
+        std::vector<double> init(s0.begin(), s0.end());
+        init.push_back(0.);
+        auto ta = taylor_adaptive<double>{make_sundman_sys(number{mu}, {}, number{alpha}), init};
+
+        auto res = propagate_until_physical(ta, period / 2);
+        REQUIRE(std::get<0>(res) == taylor_outcome::time_limit);
+        REQUIRE(ta.get_state()[6] == period / 2);
+        for (auto j = 0u; j < 6u; ++j) {
+            REQUIRE(std::abs(ta.get_state()[j] - s_apo[j]) < 1e-9);
+        }
+
+        res = propagate_until_physical(ta, 3 * period);
+        REQUIRE(std::get<0>(res) == taylor_outcome::time_limit);
+        for (auto j = 0u; j < 6u; ++j) {
+            REQUIRE(std::abs(ta.get_state()[j] - s0[j]) < 1e-8);
+        }
+
+        // Backward propagation.
+        res = propagate_until_physical(ta, 0.);
+        REQUIRE(std::get<0>(res) == taylor_outcome::time_limit);
+        REQUIRE(ta.get_state()[6] == 0.);
+        for (auto j = 0u; j < 6u; ++j) {
+            REQUIRE(std::abs(ta.get_state()[j] - s0[j]) < 1e-8);
+        }
+    }
+
+    {
+        const auto ks0 = cartesian_to_ks(mu, s0);
+        auto ta = taylor_adaptive<double>{make_ks_sys(number{mu}), std::vector<double>(ks0.begin(), ks0.end())};
+
+        REQUIRE(std::get<0>(propagate_until_physical(ta, period / 2)) == taylor_outcome::time_limit);
+
+        std::array<double, 10> ks;
+        std::copy(ta.get_state().begin(), ta.get_state().end(), ks.begin());
+        const auto s = ks_to_cartesian(ks);
+        for (auto j = 0u; j < 6u; ++j) {
+            REQUIRE(std::abs(s[j] - s_apo[j]) < 1e-9);
+        }
+        REQUIRE(s[6] == period / 2);
+
+        REQUIRE(std::get<0>(propagate_until_physical(ta, 3 * period)) == taylor_outcome::time_limit);
+        std::copy(ta.get_state().begin(), ta.get_state().end(), ks.begin());
+        const auto s3 = ks_to_cartesian(ks);
+        for (auto j = 0u; j < 6u; ++j) {
+            REQUIRE(std::abs(s3[j] - s0[j]) < 1e-8);
+        }
+
+        // Step limit.
+        REQUIRE(std::get<0>(propagate_until_physical(ta, 10 * period, 1)) == taylor_outcome::step_limit);
+    }
+
+    // Perturbed orbit: compare with the integration in cartesian coordinates.
+    auto [x, y, z, vx, vy, vz, t] = make_vars("x", "y", "z", "vx", "vy", "vz", "t");
+    const std::array pert{1e-2 * cos(t), -1e-2 * vy, 1e-3 * x * z};
+
+    const auto s1 = oe_to_cartesian(mu, {1., .7, .3, .4, .5, 1.});
+    const auto tf = 10.;
+
+    const auto r_m3 = pow(sum_sq({x, y, z}), expression{-3. / 2});
+    auto ta_c = taylor_adaptive<double>{{prime(x) = vx, prime(y) = vy, prime(z) = vz,
+                                         prime(vx) = -mu * x * r_m3 + subs(pert[0], {{"t", heyoka::time}}),
+                                         prime(vy) = -mu * y * r_m3 + pert[1], prime(vz) = -mu * z * r_m3 + pert[2]},
+                                        std::vector<double>(s1.begin(), s1.end())};
+    REQUIRE(std::get<0>(ta_c.propagate_until(tf)) == taylor_outcome::time_limit);
+
+    std::vector<double> init(s1.begin(), s1.end());
+    init.push_back(0.);
+    auto ta_s = taylor_adaptive<double>{make_sundman_sys(number{mu}, pert), init};
+    REQUIRE(std::get<0>(propagate_until_physical(ta_s, tf)) == taylor_outcome::time_limit);
+
+    const auto ks1 = cartesian_to_ks(mu, s1);
+    auto ta_ks = taylor_adaptive<double>{make_ks_sys(number{mu}, pert), std::vector<double>(ks1.begin(), ks1.end())};
+    REQUIRE(std::get<0>(propagate_until_physical(ta_ks, tf)) == taylor_outcome::time_limit);
+
+    std::array<double, 10> ks;
+    std::copy(ta_ks.get_state().begin(), ta_ks.get_state().end(), ks.begin());
+    const auto s_ks = ks_to_cartesian(ks);
+
+    for (auto j = 0u; j < 6u; ++j) {
+        REQUIRE(std::abs(ta_s.get_state()[j] - ta_c.get_state()[j]) < 1e-9);
+        REQUIRE(std::abs(s_ks[j] - ta_c.get_state()[j]) < 1e-9);
+    }
+
+    // Error handling.
+    REQUIRE_THROWS_AS(cartesian_to_ks(0., s1), std::invalid_argument);
+    REQUIRE_THROWS_AS(make_ks_sys(number{-1.}), std::invalid_argument);
+    REQUIRE_THROWS_AS(make_ks_sys(number{std::numeric_limits<double>::quiet_NaN()}, pert), std::invalid_argument);
+    REQUIRE_THROWS_AS(cartesian_to_ks(mu, {0., 0., 0., 1., 0., 0.}), std::invalid_argument);
+    REQUIRE_THROWS_AS(ks_to_cartesian({}), std::invalid_argument);
+    REQUIRE_THROWS_AS(propagate_until_physical(ta_s, std::numeric_limits<double>::infinity()), std::invalid_argument);
+}
@@ -0,0 +1,134 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include <heyoka/nbody.hpp>
+#include <heyoka/nbody_bh.hpp>
+#include <heyoka/taylor.hpp>
+
+#include "catch.hpp"
+#include "test_utils.hpp"
+
+using namespace heyoka;
+using namespace heyoka_test;
+
+// A random cloud of n bodies with small velocities.
+static std::vector<double> make_cloud(std::uint32_t n, std::mt19937 &rng)
+{
+    std::uniform_real_distribution<double> pdist(-10., 10.), vdist(-.1, .1);
+
+    std::vector<double> retval(6u * n);
+    for (std::uint32_t i = 0; i < n; ++i) {
+        for (auto k = 0u; k < 3u; ++k) {
+            retval[6u * i + k] = pdist(rng);
+            retval[6u * i + 3u + k] = vdist(rng);
+        }
+    }
+
+    return retval;
+}
+
+TEST_CASE("nbody_bh exact")
+{
+    std::mt19937 rng(42);
+
+    const auto n = 20u;
+    const auto init_state = make_cloud(n, rng);
+
+    std::uniform_real_distribution<double> mdist(.5, 1.5);
+    std::vector<double> masses(n);
+    for (auto &m : masses) {
+        m = mdist(rng);
+    }
+    // Add a massless body.
+    masses[3] = 0;
+
+    // With theta = 0, all interactions are near, and the
+    // integration must match taylor_adaptive.
+    for (auto leaf_size : {1u, 8u, 100u}) {
+        nbody_bh bh{init_state, kw::masses = masses, kw::Gconst = 1.1, kw::theta = 0., kw::leaf_size = leaf_size};
+
+        REQUIRE(bh.get_order() == 20u);
+        REQUIRE(bh.get_theta() == 0.);
+
+        taylor_adaptive<double> ta{make_nbody_sys(n, kw::masses = masses, kw::Gconst = 1.1), init_state};
+
+        bh.propagate_until(2.);
+        ta.propagate_until(2.);
+
+        REQUIRE(bh.get_time() == 2.);
+        // NOTE: the massless body is not attracting anybody.
+        REQUIRE(bh.get_n_near_pairs() == n * (n - 1u) - (n - 1u));
+
+        for (auto i = 0u; i < 6u * n; ++i) {
+            REQUIRE(std::abs(bh.get_state()[i] - ta.get_state()[i]) < 1e-8 * (1 + std::abs(ta.get_state()[i])));
+        }
+
+        // Copy semantics.
+        auto bh2 = bh;
+        bh2.propagate_until(3.);
+        bh.propagate_until(3.);
+        REQUIRE(bh2.get_state() == bh.get_state());
+    }
+}
+
+TEST_CASE("nbody_bh approx")
+{
+    std::mt19937 rng(43);
+
+    const auto n = 200u;
+    const auto init_state = make_cloud(n, rng);
+
+    nbody_bh exact{init_state, kw::theta = 0., kw::Gconst = .01, kw::tol = 1e-10};
+    nbody_bh approx{init_state, kw::theta = .5, kw::Gconst = .01, kw::tol = 1e-10};
+
+    REQUIRE(approx.get_n_near_pairs() == 0u);
+
+    exact.propagate_until(1.);
+    approx.propagate_until(1.);
+
+    REQUIRE(approx.get_n_near_pairs() < exact.get_n_near_pairs());
+
+    // The difference in the positions must be small
+    // with respect to the size of the cloud.
+    double max_diff = 0;
+    for (auto i = 0u; i < n; ++i) {
+        for (auto k = 0u; k < 3u; ++k) {
+            max_diff = std::max(max_diff, std::abs(exact.get_state()[6u * i + k] - approx.get_state()[6u * i + k]));
+        }
+    }
+    REQUIRE(max_diff < 1e-2);
+}
+
+TEST_CASE("nbody_bh errors")
+{
+    using Catch::Matchers::Message;
+
+    REQUIRE_THROWS_MATCHES(nbody_bh(std::vector<double>(7)), std::invalid_argument,
+                           Message("The size of the state vector of a Barnes-Hut N-body integrator must be a "
+                                   "multiple of 6, but it is 7 instead"));
+    REQUIRE_THROWS_MATCHES(nbody_bh(std::vector<double>(6)), std::invalid_argument,
+                           Message("At least 2 bodies are needed to construct an N-body system"));
+    REQUIRE_THROWS_MATCHES(nbody_bh(std::vector<double>(12), kw::masses = std::vector{1.}), std::invalid_argument,
+                           Message("Inconsistent sizes detected while creating a Barnes-Hut N-body integrator: the "
+                                   "vector of masses has a size of 1, while the number of bodies is 2"));
+    REQUIRE_THROWS_AS(nbody_bh(std::vector<double>(12), kw::tol = -1.), std::invalid_argument);
+    REQUIRE_THROWS_AS(nbody_bh(std::vector<double>(12), kw::theta = -1.), std::invalid_argument);
+    REQUIRE_THROWS_MATCHES(nbody_bh(std::vector<double>(12), kw::leaf_size = 0u), std::invalid_argument,
+                           Message("The leaf size in a Barnes-Hut N-body integrator cannot be zero"));
+
+    nbody_bh bh{{0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 1, 0}};
+    REQUIRE_THROWS_AS(bh.propagate_until(-1.), std::invalid_argument);
+    REQUIRE_THROWS_AS(bh.step(-1.), std::invalid_argument);
+}
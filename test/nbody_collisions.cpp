@@ -0,0 +1,141 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <cmath>
+#include <cstdint>
+#include <optional>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <heyoka/expression.hpp>
+#include <heyoka/math.hpp>
+#include <heyoka/nbody.hpp>
+#include <heyoka/nbody_collisions.hpp>
+#include <heyoka/taylor.hpp>
+
+#include "catch.hpp"
+#include "test_utils.hpp"
+
+using namespace heyoka;
+using namespace heyoka_test;
+
+TEST_CASE("collisions straight lines")
+{
+    // Three non-interacting bodies: two approaching each
+    // other along the x axis, and a distant one at rest.
+    auto ta = taylor_adaptive<double>{make_nbody_sys(3, kw::Gconst = 0.),
+                                      {-1., 0, 0, 1., 0, 0, 1., 0, 0, -1., 0, 0, 0, 50., 0, 0, 0, 0}};
+
+    nbody_collision_detector det{{.1, .1, .1}};
+    REQUIRE(det.get_radii() == std::vector{.1, .1, .1});
+
+    // No step has been taken yet.
+    REQUIRE(!det.detect(ta));
+    REQUIRE(det.get_n_candidates() == 0u);
+
+    ta.step(2., true);
+
+    const auto coll = det.detect(ta);
+    REQUIRE(coll);
+    REQUIRE(coll->i == 0u);
+    REQUIRE(coll->j == 1u);
+    REQUIRE(coll->t == approximately(.9, 1000.));
+
+    // The distant body was pruned in the broad phase.
+    REQUIRE(det.get_n_candidates() == 1u);
+
+    // Separating bodies, no collision.
+    auto ta2 = taylor_adaptive<double>{make_nbody_sys(2, kw::Gconst = 0.),
+                                       {-1., 0, 0, -1., 0, 0, 1., 0, 0, 1., 0, 0}};
+    ta2.step(2., true);
+    REQUIRE(!det.detect(ta2));
+
+    // Error handling.
+    REQUIRE_THROWS_AS(nbody_collision_detector({1.}), std::invalid_argument);
+    REQUIRE_THROWS_AS(nbody_collision_detector({1., -1.}), std::invalid_argument);
+    REQUIRE_THROWS_AS(nbody_collision_detector({1., std::nan("")}), std::invalid_argument);
+    REQUIRE_THROWS_AS(nbody_collision_detector({1., 1., 1., 1.}).detect(ta), std::invalid_argument);
+}
+
+// Compare the detector with terminal events
+// on the pairwise distances.
+TEST_CASE("collisions vs events")
+{
+    using ev_t = taylor_adaptive<double>::t_event_t;
+
+    const std::uint32_t n = 8;
+    const auto R = .25;
+
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<double> pdist(-2., 2.), vdist(-.3, .3);
+
+    for (auto k = 0; k < 5; ++k) {
+        // Random initial positions, without overlaps.
+        std::vector<double> state(6u * n);
+        for (std::uint32_t i = 0; i < n; ++i) {
+            bool ok = false;
+            while (!ok) {
+                for (auto a = 0u; a < 3u; ++a) {
+                    state[6u * i + a] = pdist(rng);
+                    state[6u * i + 3u + a] = vdist(rng);
+                }
+
+                ok = true;
+                for (std::uint32_t j = 0; j < i; ++j) {
+                    const auto dx = state[6u * i] - state[6u * j], dy = state[6u * i + 1u] - state[6u * j + 1u],
+                               dz = state[6u * i + 2u] - state[6u * j + 2u];
+                    ok = ok && std::sqrt(dx * dx + dy * dy + dz * dz) > 2 * R + .1;
+                }
+            }
+        }
+
+        const auto sys = make_nbody_sys(n, kw::masses = std::vector<double>(n, .1));
+
+        std::vector<ev_t> evs;
+        for (std::uint32_t i = 0; i < n; ++i) {
+            for (auto j = i + 1u; j < n; ++j) {
+                std::vector<expression> diff;
+                for (const auto *c : {"x_", "y_", "z_"}) {
+                    diff.push_back(expression{variable(c + std::to_string(j))}
+                                   - expression{variable(c + std::to_string(i))});
+                }
+
+                evs.emplace_back(sum_sq(diff) - expression{4 * R * R}, kw::direction = event_direction::negative);
+            }
+        }
+
+        auto ta_ev = taylor_adaptive<double>{sys, state, kw::t_events = evs};
+        const auto oc = std::get<0>(ta_ev.propagate_until(10.));
+
+        auto ta = taylor_adaptive<double>{sys, state};
+        nbody_collision_detector det{std::vector<double>(n, R)};
+
+        std::optional<nbody_collision> coll;
+        while (!coll && ta.get_time() < 10.) {
+            REQUIRE(std::get<0>(ta.step(10. - ta.get_time(), true)) != taylor_outcome::err_nf_state);
+            coll = det.detect(ta);
+            REQUIRE(det.get_n_candidates() <= n * (n - 1u) / 2u);
+        }
+
+        if (oc == taylor_outcome::terminal_event) {
+            REQUIRE(coll);
+            REQUIRE(std::abs(coll->t - ta_ev.get_time()) < 1e-9);
+
+            // The bodies of the collision are in contact at the event time.
+            const auto &s = ta_ev.get_state();
+            const auto dx = s[6u * coll->i] - s[6u * coll->j], dy = s[6u * coll->i + 1u] - s[6u * coll->j + 1u],
+                       dz = s[6u * coll->i + 2u] - s[6u * coll->j + 2u];
+            REQUIRE(std::sqrt(dx * dx + dy * dy + dz * dz) == approximately(2 * R, 10000.));
+        } else {
+            REQUIRE(oc == taylor_outcome::time_limit);
+            REQUIRE(!coll);
+        }
+    }
+}
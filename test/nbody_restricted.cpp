@@ -0,0 +1,99 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#include <heyoka/nbody.hpp>
+#include <heyoka/nbody_restricted.hpp>
+#include <heyoka/taylor.hpp>
+
+#include "catch.hpp"
+#include "test_utils.hpp"
+
+using namespace heyoka;
+using namespace heyoka_test;
+
+TEST_CASE("nbody restricted")
+{
+    // Sun and Jupiter, plus n_tp test particles
+    // (not a multiple of the batch size).
+    const std::vector<double> masses{1., 1e-3};
+    const auto n_tp = 10u;
+
+    // The Sun is at rest at the origin.
+    std::vector<double> massive_state(6u);
+    const auto jup = oe_to_cartesian(masses[0] + masses[1], {5.2, .05, .02, 1., 2., 3.});
+    massive_state.insert(massive_state.end(), jup.begin(), jup.end());
+
+    std::vector<double> tp_state;
+    for (auto i = 0u; i < n_tp; ++i) {
+        const auto s = oe_to_cartesian(1., {1. + .3 * i, .1, .05 * i, .1 * i, .2 * i, .3 * i});
+        tp_state.insert(tp_state.end(), s.begin(), s.end());
+    }
+
+    // The monolithic integrator.
+    auto all_masses = masses;
+    all_masses.resize(2u + n_tp, 0.);
+    auto all_state = massive_state;
+    all_state.insert(all_state.end(), tp_state.begin(), tp_state.end());
+    auto ta = taylor_adaptive<double>{make_nbody_sys(2u + n_tp, kw::masses = all_masses), all_state};
+
+    const auto tf = 20.;
+    REQUIRE(std::get<0>(ta.propagate_until(tf)) == taylor_outcome::time_limit);
+
+    std::vector<double> prev_tp_state;
+    for (auto n_threads : {1u, 3u}) {
+        nbody_restricted nr{massive_state, tp_state, kw::masses = masses, kw::n_threads = n_threads};
+
+        REQUIRE(nr.get_n_massive() == 2u);
+        REQUIRE(nr.get_n_tp() == n_tp);
+        REQUIRE(nr.get_tp_integrator().get_batch_size() == 4u);
+
+        REQUIRE(nr.propagate_until(tf) > 0u);
+        REQUIRE(nr.get_time() == tf);
+
+        for (auto i = 0u; i < 12u; ++i) {
+            REQUIRE(std::abs(nr.get_massive_state()[i] - ta.get_state()[i]) < 1e-10);
+        }
+        for (auto i = 0u; i < 6u * n_tp; ++i) {
+            REQUIRE(std::abs(nr.get_tp_state()[i] - ta.get_state()[12u + i]) < 1e-10);
+        }
+
+        // The results do not depend on the number of threads.
+        if (!prev_tp_state.empty()) {
+            REQUIRE(nr.get_tp_state() == prev_tp_state);
+        }
+        prev_tp_state = nr.get_tp_state();
+    }
+
+    // No test particles.
+    nbody_restricted nr0{massive_state, {}, kw::masses = masses, kw::batch_size = 2u};
+    nr0.step();
+    REQUIRE(nr0.get_n_tp() == 0u);
+    REQUIRE(nr0.get_time() > 0);
+
+    // Copy semantics.
+    auto nr1 = nr0;
+    REQUIRE(nr1.get_massive_state() == nr0.get_massive_state());
+    nr1.step();
+    nr0.step();
+    REQUIRE(nr1.get_massive_state() == nr0.get_massive_state());
+
+    // Error handling.
+    REQUIRE_THROWS_AS(nbody_restricted(std::vector<double>(6u), tp_state), std::invalid_argument);
+    REQUIRE_THROWS_AS(nbody_restricted(std::vector<double>(13u), tp_state), std::invalid_argument);
+    REQUIRE_THROWS_AS(nbody_restricted(massive_state, std::vector<double>(5u)), std::invalid_argument);
+    REQUIRE_THROWS_AS(nbody_restricted(massive_state, tp_state, kw::masses = {1.}), std::invalid_argument);
+    REQUIRE_THROWS_AS(nbody_restricted(massive_state, tp_state, kw::batch_size = 0u), std::invalid_argument);
+    REQUIRE_THROWS_AS(nr1.step(-1.), std::invalid_argument);
+    REQUIRE_THROWS_AS(nr1.propagate_until(0.), std::invalid_argument);
+}
@@ -11,6 +11,7 @@
 #include <functional>
 #include <initializer_list>
 #include <limits>
+#include <variant>
 
 #include <boost/algorithm/string/predicate.hpp>
 
@@ -50,6 +51,9 @@ TEST_CASE("number hash eq")
     REQUIRE(number{1.2l} != number{1.1});
     REQUIRE(hash_number(number{1.l}) == hash_number(number{1.}));
     REQUIRE(hash_number(number{0.l}) == hash_number(number{-0.}));
+    REQUIRE(hash_number(number{0.}) == hash_number(number{-0.}));
+    REQUIRE(hash_number(number{1.1}) == hash_number(number{static_cast<long double>(1.1)}));
+    REQUIRE(hash_number(number{1.1l}) == hash_number(number{1.1l}));
 
     REQUIRE(number{std::numeric_limits<double>::quiet_NaN()} == number{std::numeric_limits<double>::quiet_NaN()});
     REQUIRE(number{std::numeric_limits<long double>::quiet_NaN()}
@@ -117,3 +121,22 @@ TEST_CASE("number hash eq")
     // optimised out because both constants are 1.
     REQUIRE(!boost::contains(s.get_ir(), "internal constant [2 x double]"));
 }
+
+TEST_CASE("number arith")
+{
+    REQUIRE(number{1.} + number{2.} == number{3.});
+    REQUIRE(std::holds_alternative<double>((number{1.} + number{2.}).value()));
+    REQUIRE(std::holds_alternative<long double>((number{1.} + number{2.l}).value()));
+    REQUIRE(std::holds_alternative<long double>((number{1.l} * number{2.}).value()));
+
+    REQUIRE(number{1.} - number{2.} == number{-1.});
+    REQUIRE(number{3.} * number{2.} == number{6.});
+    REQUIRE(number{3.} / number{2.} == number{1.5});
+    REQUIRE(-number{3.} == number{-3.});
+    REQUIRE(std::holds_alternative<long double>((-number{3.l}).value()));
+
+    REQUIRE(is_zero(number{-0.}));
+    REQUIRE(is_one(number{1.l}));
+    REQUIRE(is_negative_one(number{-1.}));
+    REQUIRE(!is_zero(number{1.}));
+}
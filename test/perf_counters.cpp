@@ -0,0 +1,104 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <stdexcept>
+#include <tuple>
+#include <vector>
+
+#include <heyoka/expression.hpp>
+#include <heyoka/math.hpp>
+#include <heyoka/perf_counters.hpp>
+#include <heyoka/taylor.hpp>
+
+#include "catch.hpp"
+
+using namespace heyoka;
+
+TEST_CASE("perf counts arith")
+{
+    const perf_counts a{10, 20, 3, 4}, b{1, 25, 3, 1};
+
+    const auto s = a + b;
+    REQUIRE(s.cycles == 11u);
+    REQUIRE(s.instructions == 45u);
+    REQUIRE(s.cache_misses == 6u);
+    REQUIRE(s.raw == 5u);
+
+    // The subtraction saturates at zero.
+    const auto d = a - b;
+    REQUIRE(d.cycles == 9u);
+    REQUIRE(d.instructions == 0u);
+    REQUIRE(d.cache_misses == 0u);
+    REQUIRE(d.raw == 3u);
+
+    const step_perf_counts spc{a, b};
+    REQUIRE(spc.jet().cycles == 9u);
+}
+
+TEST_CASE("taylor perf counters")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    const auto sys = {prime(x) = v, prime(v) = -9.8 * sin(x)};
+
+    auto ta = taylor_adaptive<double>{sys, {0.05, 0.025}};
+    auto ta_ref = ta;
+
+    REQUIRE(!ta.perf_counters_enabled());
+
+    if (!perf_counters_available()) {
+        // NOTE: the counters may not be accessible
+        // (e.g., due to the perf_event_paranoid setting).
+        REQUIRE_THROWS_AS(ta.enable_perf_counters(), std::runtime_error);
+        REQUIRE(!ta.perf_counters_enabled());
+
+        return;
+    }
+
+    ta.enable_perf_counters();
+    REQUIRE(ta.perf_counters_enabled());
+
+    for (auto i = 0; i < 10; ++i) {
+        ta.step();
+        ta_ref.step();
+    }
+
+    // The profiling must not alter the integration.
+    REQUIRE(ta.get_state() == ta_ref.get_state());
+    REQUIRE(ta.get_time() == ta_ref.get_time());
+
+    REQUIRE(ta.get_perf_counts().size() == 10u);
+    for (const auto &spc : ta.get_perf_counts()) {
+        REQUIRE(spc.step.instructions > 0u);
+        REQUIRE(spc.update.instructions > 0u);
+        REQUIRE(spc.jet().instructions > 0u);
+        // The raw event was not requested.
+        REQUIRE(spc.step.raw == 0u);
+    }
+
+    // The profiling state is not copied.
+    auto ta_copy = ta;
+    REQUIRE(!ta_copy.perf_counters_enabled());
+    REQUIRE(ta_copy.get_perf_counts().empty());
+
+    ta.reset_perf_counts();
+    REQUIRE(ta.get_perf_counts().empty());
+
+    ta.disable_perf_counters();
+    REQUIRE(!ta.perf_counters_enabled());
+    ta.step();
+    REQUIRE(ta.get_perf_counts().empty());
+
+    // Batch mode.
+    auto tab = taylor_adaptive_batch<double>{sys, {0.05, 0.06, 0.025, 0.026}, 2};
+    tab.enable_perf_counters();
+    tab.propagate_until({1., 1.});
+
+    REQUIRE(!tab.get_perf_counts().empty());
+    REQUIRE(tab.get_perf_counts()[0].step.instructions > tab.get_perf_counts()[0].update.instructions);
+}
@@ -0,0 +1,134 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <heyoka/expression.hpp>
+#include <heyoka/kw.hpp>
+#include <heyoka/math.hpp>
+#include <heyoka/polyhedral.hpp>
+#include <heyoka/taylor.hpp>
+
+#include "catch.hpp"
+#include "test_utils.hpp"
+
+using namespace heyoka;
+using namespace heyoka_test;
+
+// The unit cube centred in the origin.
+static const std::vector<std::array<double, 3>> cube_vertices
+    = {{-.5, -.5, -.5}, {-.5, -.5, .5}, {-.5, .5, -.5}, {-.5, .5, .5},
+       {.5, -.5, -.5},  {.5, -.5, .5},  {.5, .5, -.5},  {.5, .5, .5}};
+
+static const std::vector<std::array<std::uint32_t, 3>> cube_faces
+    = {{4, 6, 7}, {4, 7, 5}, {0, 1, 3}, {0, 3, 2}, {2, 3, 7}, {2, 7, 6},
+       {0, 4, 5}, {0, 5, 1}, {1, 5, 7}, {1, 7, 3}, {0, 2, 6}, {0, 6, 4}};
+
+TEST_CASE("polyhedral acc")
+{
+    auto [x, y, z] = make_vars("x", "y", "z");
+
+    const auto acc = polyhedral_acc(x, y, z, cube_vertices, cube_faces);
+
+    auto eval_acc = [&](double a, double b, double c) {
+        const std::unordered_map<std::string, double> map{{"x", a}, {"y", b}, {"z", c}};
+
+        return std::array<double, 3>{eval_dbl(acc[0], map), eval_dbl(acc[1], map), eval_dbl(acc[2], map)};
+    };
+
+    // Far away, the cube behaves as a point mass (the quadrupole
+    // moment vanishes because of the symmetry).
+    {
+        const auto a = eval_acc(100., 30., -20.);
+        const auto r = std::sqrt(100. * 100. + 30. * 30. + 20. * 20.);
+
+        REQUIRE(std::abs(a[0] + 100. / (r * r * r)) < 1e-8 * std::abs(a[0]));
+        REQUIRE(std::abs(a[1] + 30. / (r * r * r)) < 1e-8 * std::abs(a[1]));
+        REQUIRE(std::abs(a[2] - 20. / (r * r * r)) < 1e-8 * std::abs(a[2]));
+    }
+
+    // Values computed with an independent implementation.
+    {
+        const auto a = eval_acc(3., 1., .5);
+
+        REQUIRE(a[0] == approximately(-0.09140227321916966, 1000.));
+        REQUIRE(a[1] == approximately(-0.030434938867129002, 1000.));
+        REQUIRE(a[2] == approximately(-0.015215654336680484, 1000.));
+    }
+
+    // Inside the polyhedron.
+    {
+        const auto a = eval_acc(.1, .2, .3);
+
+        REQUIRE(a[0] == approximately(-0.3459221390941938, 1000.));
+        REQUIRE(a[1] == approximately(-0.7456805925193053, 1000.));
+        REQUIRE(a[2] == approximately(-1.275395167441785, 1000.));
+    }
+
+    // Scaling.
+    const auto acc2 = polyhedral_acc(x, y, z, cube_vertices, cube_faces, 2.5);
+    const std::unordered_map<std::string, double> map{{"x", 3.}, {"y", 1.}, {"z", .5}};
+    REQUIRE(eval_dbl(acc2[0], map) == approximately(2.5 * -0.09140227321916966, 1000.));
+
+    // Error handling.
+    auto bad_faces = cube_faces;
+    bad_faces.pop_back();
+    REQUIRE_THROWS_AS(polyhedral_acc(x, y, z, cube_vertices, bad_faces), std::invalid_argument);
+    bad_faces = cube_faces;
+    bad_faces[0] = {4, 7, 6};
+    REQUIRE_THROWS_AS(polyhedral_acc(x, y, z, cube_vertices, bad_faces), std::invalid_argument);
+    bad_faces[0] = {4, 6, 8};
+    REQUIRE_THROWS_AS(polyhedral_acc(x, y, z, cube_vertices, bad_faces), std::invalid_argument);
+    bad_faces[0] = {4, 4, 7};
+    REQUIRE_THROWS_AS(polyhedral_acc(x, y, z, cube_vertices, bad_faces), std::invalid_argument);
+    REQUIRE_THROWS_AS(polyhedral_acc(x, y, z, cube_vertices, {}), std::invalid_argument);
+    REQUIRE_THROWS_AS(polyhedral_acc(x, y, z, cube_vertices, cube_faces, std::nan("")), std::invalid_argument);
+}
+
+TEST_CASE("polyhedral system")
+{
+    // A far orbit, compared with the Keplerian motion.
+    const std::vector<double> ic{50., 0., 0., 0., std::sqrt(1. / 50.), 0.};
+
+    for (auto cm : {false, true}) {
+        taylor_adaptive<double> ta{make_polyhedral_system(kw::vertices = cube_vertices, kw::faces = cube_faces,
+                                                          kw::omega = std::vector<double>{0., 0., 0.}),
+                                   ic, kw::compact_mode = cm};
+
+        auto [x, y, z, vx, vy, vz] = make_vars("x", "y", "z", "vx", "vy", "vz");
+        auto r_m3 = pow(x * x + y * y + z * z, -3_dbl / 2_dbl);
+        taylor_adaptive<double> ta_kep{{prime(x) = vx, prime(y) = vy, prime(z) = vz, prime(vx) = -x * r_m3,
+                                        prime(vy) = -y * r_m3, prime(vz) = -z * r_m3},
+                                       ic,
+                                       kw::compact_mode = cm};
+
+        ta.propagate_until(100.);
+        ta_kep.propagate_until(100.);
+
+        for (auto j = 0u; j < 3u; ++j) {
+            REQUIRE(std::abs(ta.get_state()[j] - ta_kep.get_state()[j]) < 1e-6);
+        }
+    }
+
+    // Density and G constant.
+    auto sys = make_polyhedral_system(kw::vertices = cube_vertices, kw::faces = cube_faces, kw::density = 2.,
+                                      kw::Gconst = 1.5, kw::omega = std::vector<double>{0., 0., 0.});
+    const std::unordered_map<std::string, double> map{{"x", 3.},  {"y", 1.},  {"z", .5},
+                                                      {"vx", 0.}, {"vy", 0.}, {"vz", 0.}};
+    REQUIRE(eval_dbl(sys[3].second, map) == approximately(3 * -0.09140227321916966, 1000.));
+
+    REQUIRE_THROWS_AS(make_polyhedral_system(kw::vertices = std::vector<std::vector<double>>{{1., 2.}},
+                                             kw::faces = cube_faces, kw::omega = std::vector<double>{0., 0., 0.}),
+                      std::invalid_argument);
+}
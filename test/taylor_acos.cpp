@@ -46,7 +46,7 @@ const auto fp_types = std::tuple<double, long double
 template <typename T, typename U>
 void compare_batch_scalar(std::initializer_list<U> sys, unsigned opt_level, bool high_accuracy, bool compact_mode)
 {
-    for (auto batch_size : {2u, 4u, 8u, 23u}) {
+    for (auto batch_size : {2u, 3u, 4u, 5u, 8u, 23u}) {
         llvm_state s{kw::opt_level = opt_level};
 
         taylor_add_jet<T>(s, "jet_batch", sys, 3, batch_size, high_accuracy, compact_mode);
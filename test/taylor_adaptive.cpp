@@ -8,12 +8,22 @@
 
 #include <algorithm>
 #include <cmath>
+#include <cstddef>
+#include <cstdint>
 #include <initializer_list>
+#include <limits>
+#include <map>
+#include <set>
 #include <sstream>
+#include <stdexcept>
+#include <string>
+#include <tuple>
 #include <utility>
+#include <vector>
 
 #include <boost/math/constants/constants.hpp>
 
+#include <heyoka/math.hpp>
 #include <heyoka/nbody.hpp>
 #include <heyoka/taylor.hpp>
 
@@ -169,3 +179,2025 @@ TEST_CASE("param batch")
     REQUIRE(tad.get_state()[20 + 1] == approximately(v0));
     REQUIRE(tad.get_state()[22 + 1] == approximately(0.));
 }
+
+// Test the detection of non-finite values
+// in the state vector at the end of a timestep.
+TEST_CASE("nf state")
+{
+    auto [x, y] = make_vars("x", "y");
+
+    for (auto cm : {false, true}) {
+        for (auto ha : {false, true}) {
+            // Scalar mode.
+            auto ta = taylor_adaptive<double>{
+                {prime(x) = par[0], prime(y) = 1_dbl}, {1e308, 1.}, kw::compact_mode = cm, kw::high_accuracy = ha};
+            ta.get_pars_data()[0] = 1e308;
+
+            // NOTE: the timestep is limited only by max_delta_t.
+            REQUIRE(std::get<0>(ta.step(10.)) == taylor_outcome::err_nf_state);
+            REQUIRE(!std::isfinite(ta.get_state()[0]));
+            REQUIRE(std::isfinite(ta.get_time()));
+
+            ta.get_state_data()[0] = 1.;
+            ta.get_pars_data()[0] = 1.;
+            REQUIRE(std::get<0>(ta.step(10.)) == taylor_outcome::time_limit);
+
+            // Batch mode: only the first batch element
+            // ends up with a non-finite state.
+            auto tab = taylor_adaptive_batch<double>{{prime(x) = par[0], prime(y) = 1_dbl},
+                                                     {1e308, 1., 1e308, 1., 1., 1., 1., 1.},
+                                                     4,
+                                                     kw::compact_mode = cm,
+                                                     kw::high_accuracy = ha};
+            tab.get_pars_data()[0] = 1e308;
+            tab.get_pars_data()[1] = 1.;
+            tab.get_pars_data()[2] = 1.;
+            tab.get_pars_data()[3] = 1.;
+
+            const auto &res = tab.step({10., 10., 10., 10.});
+
+            REQUIRE(std::get<0>(res[0]) == taylor_outcome::err_nf_state);
+            REQUIRE(std::get<0>(res[1]) == taylor_outcome::time_limit);
+            REQUIRE(std::get<0>(res[2]) == taylor_outcome::time_limit);
+            REQUIRE(std::get<0>(res[3]) == taylor_outcome::time_limit);
+            REQUIRE(!std::isfinite(tab.get_state()[0]));
+            REQUIRE(std::isfinite(tab.get_state()[2]));
+        }
+    }
+}
+
+TEST_CASE("sort strategy")
+{
+    using Catch::Matchers::Message;
+
+    const auto init_state = std::vector<double>{0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 1, 0, -1, 0, 0, 0, -1, 0};
+    const auto sys = make_nbody_sys(3, kw::masses = {1., .1, .1});
+
+    auto ta_bfs = taylor_adaptive<double>{sys, init_state};
+
+    for (auto ss : {taylor_sort_strategy::bfs, taylor_sort_strategy::dfs, taylor_sort_strategy::live_range}) {
+        for (auto cm : {false, true}) {
+            auto ta = taylor_adaptive<double>{sys, init_state, kw::compact_mode = cm, kw::sort_strategy = ss};
+
+            // The reordering does not change the number of u variables
+            // nor the definitions of the state variables.
+            const auto &dc = ta.get_decomposition();
+            REQUIRE(dc.size() == ta_bfs.get_decomposition().size());
+            REQUIRE(std::equal(dc.begin(), dc.begin() + 18, ta_bfs.get_decomposition().begin()));
+
+            // The trajectories are unchanged.
+            REQUIRE(std::get<0>(ta.propagate_until(1.)) == taylor_outcome::time_limit);
+            if (ss == taylor_sort_strategy::bfs && !cm) {
+                ta_bfs.propagate_until(1.);
+            }
+            for (auto i = 0u; i < 18u; ++i) {
+                REQUIRE(ta.get_state()[i] == approximately(ta_bfs.get_state()[i], 10000.));
+            }
+
+            auto tab = taylor_adaptive_batch<double>{sys, std::vector<double>(36u, 1.), 2, kw::compact_mode = cm,
+                                                     kw::sort_strategy = ss};
+            REQUIRE(tab.get_decomposition().size() == dc.size());
+        }
+    }
+
+    std::ostringstream oss;
+    oss << taylor_sort_strategy::live_range;
+    REQUIRE(oss.str() == "live_range");
+
+    REQUIRE_THROWS_MATCHES((taylor_adaptive<double>{sys, init_state, kw::sort_strategy = taylor_sort_strategy{42}}),
+                           std::invalid_argument,
+                           Message("Invalid sort strategy specified for a Taylor decomposition: the value 42 is not "
+                                   "valid"));
+}
+
+TEST_CASE("parallel mode")
+{
+    // A system large enough to contain segments
+    // which are computed in parallel.
+    const auto n_bodies = 20u;
+    const auto sys = make_nbody_sys(n_bodies);
+
+    std::vector<double> init_state(6u * n_bodies);
+    for (auto i = 0u; i < n_bodies; ++i) {
+        init_state[6u * i] = std::cos(2. * i);
+        init_state[6u * i + 1u] = std::sin(2. * i);
+        init_state[6u * i + 2u] = .1 * i;
+        init_state[6u * i + 3u] = -.1 * std::sin(2. * i);
+        init_state[6u * i + 4u] = .1 * std::cos(2. * i);
+    }
+
+    auto ta = taylor_adaptive<double>{sys, init_state, kw::compact_mode = true};
+    auto ta_par = taylor_adaptive<double>{sys, init_state, kw::compact_mode = true, kw::parallel_mode = true};
+
+    // The derivatives are computed with the same operations
+    // in the same order: the results must be identical.
+    for (auto i = 0; i < 10; ++i) {
+        const auto [oc, h] = ta.step();
+        const auto [oc_par, h_par] = ta_par.step();
+
+        REQUIRE(oc == oc_par);
+        REQUIRE(h == h_par);
+        REQUIRE(ta.get_state() == ta_par.get_state());
+    }
+
+    // Copies work as well.
+    auto ta_par2 = ta_par;
+    ta.step();
+    ta_par2.step();
+    REQUIRE(ta.get_state() == ta_par2.get_state());
+
+    // Batch mode.
+    std::vector<double> init_state_b(12u * n_bodies);
+    for (auto i = 0u; i < 6u * n_bodies; ++i) {
+        init_state_b[2u * i] = init_state[i];
+        init_state_b[2u * i + 1u] = init_state[i] * 1.01;
+    }
+
+    auto tab = taylor_adaptive_batch<double>{sys, init_state_b, 2, kw::compact_mode = true};
+    auto tab_par
+        = taylor_adaptive_batch<double>{sys, init_state_b, 2, kw::compact_mode = true, kw::parallel_mode = true};
+
+    for (auto i = 0; i < 10; ++i) {
+        tab.step();
+        tab_par.step();
+
+        REQUIRE(tab.get_state() == tab_par.get_state());
+    }
+
+    // Without compact mode, parallel mode has no effect.
+    auto ta_nc = taylor_adaptive<double>{make_nbody_sys(2), {0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 1, 0},
+                                         kw::parallel_mode = true};
+    REQUIRE(std::get<0>(ta_nc.step()) == taylor_outcome::success);
+}
+
+TEST_CASE("unroll threshold")
+{
+    const auto n_bodies = 6u;
+    const auto sys = make_nbody_sys(n_bodies);
+
+    std::vector<double> init_state(6u * n_bodies);
+    for (auto i = 0u; i < n_bodies; ++i) {
+        init_state[6u * i] = std::cos(i + 1.);
+        init_state[6u * i + 1u] = std::sin(i + 1.);
+        init_state[6u * i + 3u] = -.1 * std::sin(i + 1.);
+        init_state[6u * i + 4u] = .1 * std::cos(i + 1.);
+    }
+
+    auto ta = taylor_adaptive<double>{sys, init_state};
+    REQUIRE(std::get<0>(ta.propagate_until(1.)) == taylor_outcome::time_limit);
+
+    // No unrolling, partial unrolling and full unrolling.
+    for (auto ut : {0u, 10u, 100000u}) {
+        for (auto pm : {false, true}) {
+            auto ta_h = taylor_adaptive<double>{sys, init_state, kw::compact_mode = true, kw::unroll_threshold = ut,
+                                                kw::parallel_mode = pm};
+            REQUIRE(std::get<0>(ta_h.propagate_until(1.)) == taylor_outcome::time_limit);
+
+            for (auto i = 0u; i < 6u * n_bodies; ++i) {
+                REQUIRE(ta_h.get_state()[i] == approximately(ta.get_state()[i], 1000.));
+            }
+        }
+
+        std::vector<double> init_state_b(12u * n_bodies);
+        for (auto i = 0u; i < 6u * n_bodies; ++i) {
+            init_state_b[2u * i] = init_state[i];
+            init_state_b[2u * i + 1u] = init_state[i];
+        }
+
+        auto tab = taylor_adaptive_batch<double>{sys, init_state_b, 2, kw::compact_mode = true,
+                                                 kw::unroll_threshold = ut};
+        tab.propagate_until({1., 1.});
+
+        for (auto i = 0u; i < 6u * n_bodies; ++i) {
+            REQUIRE(tab.get_state()[2u * i] == approximately(ta.get_state()[i], 1000.));
+            REQUIRE(tab.get_state()[2u * i + 1u] == approximately(ta.get_state()[i], 1000.));
+        }
+    }
+}
+
+TEST_CASE("jet layout")
+{
+    using Catch::Matchers::Message;
+    using ev_t = taylor_adaptive<double>::nt_event_t;
+
+    auto [x, v] = make_vars("x", "v");
+
+    const auto sys = std::vector{prime(x) = v, prime(v) = -9.8 * sin(x) + par[0] * cos(v)};
+    const auto init_state = std::vector{0.05, 0.025};
+
+    for (auto ha : {false, true}) {
+        auto ta = taylor_adaptive<double>{sys, init_state, kw::compact_mode = true, kw::high_accuracy = ha,
+                                          kw::pars = {.1}};
+
+        // The var_major layout, with an event equation (which requires the storage
+        // of the derivatives of all the u variables) and in hybrid mode.
+        std::vector<double> times;
+        auto ta_vm = taylor_adaptive<double>{
+            sys,
+            init_state,
+            kw::compact_mode = true,
+            kw::high_accuracy = ha,
+            kw::pars = {.1},
+            kw::jet_layout = taylor_jet_layout::var_major,
+            kw::unroll_threshold = 2u,
+            kw::nt_events = std::vector<ev_t>{ev_t(v, [&times](auto &, double t) { times.push_back(t); })}};
+
+        std::vector<double> tc;
+        for (auto i = 0; i < 20; ++i) {
+            const auto [oc, h] = ta.step(true);
+            const auto [oc_vm, h_vm] = ta_vm.step(true);
+
+            REQUIRE(oc == oc_vm);
+            REQUIRE(h == approximately(h_vm, 1000.));
+            REQUIRE(ta.get_state()[0] == approximately(ta_vm.get_state()[0], 1000.));
+            REQUIRE(ta.get_state()[1] == approximately(ta_vm.get_state()[1], 1000.));
+
+            // The Taylor coefficients are laid out in the same way.
+            for (decltype(ta.get_tc().size()) j = 0; j < ta.get_tc().size(); ++j) {
+                REQUIRE(ta.get_tc()[j] == approximately(ta_vm.get_tc()[j], 1000.));
+            }
+        }
+
+        REQUIRE(!times.empty());
+    }
+
+    // Batch mode.
+    auto tab = taylor_adaptive_batch<double>{sys, {0.05, 0.06, 0.025, 0.026}, 2, kw::compact_mode = true};
+    auto tab_vm = taylor_adaptive_batch<double>{sys, {0.05, 0.06, 0.025, 0.026}, 2, kw::compact_mode = true,
+                                                kw::jet_layout = taylor_jet_layout::var_major};
+
+    tab.propagate_until({10., 10.});
+    tab_vm.propagate_until({10., 10.});
+
+    for (auto i = 0u; i < 4u; ++i) {
+        REQUIRE(tab.get_state()[i] == approximately(tab_vm.get_state()[i], 1000.));
+    }
+
+    std::ostringstream oss;
+    oss << taylor_jet_layout::var_major;
+    REQUIRE(oss.str() == "var_major");
+
+    REQUIRE_THROWS_MATCHES(
+        (taylor_adaptive<double>{sys, init_state, kw::compact_mode = true, kw::jet_layout = taylor_jet_layout{42}}),
+        std::invalid_argument,
+        Message("Invalid jet layout specified for a Taylor integrator: the value 42 is not valid"));
+}
+
+TEST_CASE("segment stats")
+{
+    using Catch::Matchers::Message;
+
+    auto [x, y] = make_vars("x", "y");
+
+    const auto dc = taylor_decompose({prime(x) = sin(x) + y * 2_dbl, prime(y) = cos(y) * x});
+
+    const auto st = taylor_segment_stats(dc, 2);
+
+    // The sines, the cosines and the multiplication by 2 depend
+    // only on the state variables, the sum and the second
+    // multiplication depend on them.
+    REQUIRE(st.size() == 2u);
+    REQUIRE(st[0].at("sin_var") == 2u);
+    REQUIRE(st[0].at("cos_var") == 2u);
+    REQUIRE(st[0].at("mul_var_num") == 1u);
+    REQUIRE(st[1].at("add_var_var") == 1u);
+    REQUIRE(st[1].at("mul_var_var") == 1u);
+
+    std::uint32_t tot = 0;
+    for (const auto &m : st) {
+        for (const auto &[_, n] : m) {
+            tot += n;
+        }
+    }
+    REQUIRE(tot == dc.size() - 4u);
+
+    REQUIRE_THROWS_MATCHES(taylor_segment_stats(dc, 10), std::invalid_argument,
+                           Message("Invalid Taylor decomposition passed to taylor_segment_stats(): the decomposition "
+                                   "has 11 elements, but for a system of 10 equations at least 20 are needed"));
+}
+
+TEST_CASE("param hoisting")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    // The param-only subexpressions par[0] * par[1] (which appears twice)
+    // and exp(par[2]) are replaced by two new params.
+    auto make_sys = [x = x, v = v](const expression &a, const expression &b, const expression &c) {
+        return std::vector{prime(x) = v + a * b * x * 1e-3_dbl, prime(v) = a * b * sin(x) + exp(c) * cos(heyoka::time)};
+    };
+
+    const auto sys = make_sys(par[0], par[1], par[2]);
+
+    for (auto cm : {false, true}) {
+        auto ta = taylor_adaptive<double>{sys, {0.1, 0.2}, kw::compact_mode = cm, kw::pars = {-1., 2., .5}};
+        REQUIRE(ta.get_pars().size() == 3u);
+
+        // No u variable depends only on params.
+        const auto &dc = ta.get_decomposition();
+        std::uint32_t n_pars = 0;
+        for (decltype(dc.size()) i = 2; i < dc.size() - 2u; ++i) {
+            REQUIRE((!get_variables(dc[i].first).empty() || dc[i].first == heyoka::time));
+            n_pars = std::max(n_pars, get_param_size(dc[i].first));
+        }
+        REQUIRE(n_pars == 5u);
+
+        auto ta_ref = taylor_adaptive<double>{make_sys(-1_dbl, 2_dbl, .5_dbl), {0.1, 0.2}, kw::compact_mode = cm};
+
+        ta.propagate_until(5.);
+        ta_ref.propagate_until(5.);
+
+        REQUIRE(ta.get_state()[0] == approximately(ta_ref.get_state()[0], 1000.));
+        REQUIRE(ta.get_state()[1] == approximately(ta_ref.get_state()[1], 1000.));
+
+        // The hoisted values are recomputed after a change in the params.
+        ta.get_pars_data()[0] = -2.;
+        auto ta_ref2 = taylor_adaptive<double>{make_sys(-2_dbl, 2_dbl, .5_dbl), ta.get_state(),
+                                               kw::compact_mode = cm, kw::time = 5.};
+
+        ta.propagate_until(10.);
+        ta_ref2.propagate_until(10.);
+
+        REQUIRE(ta.get_state()[0] == approximately(ta_ref2.get_state()[0], 1000.));
+        REQUIRE(ta.get_state()[1] == approximately(ta_ref2.get_state()[1], 1000.));
+
+        // Batch mode.
+        auto tab = taylor_adaptive_batch<double>{
+            sys, {0.1, 0.1, 0.2, 0.2}, 2, kw::compact_mode = cm, kw::pars = {-1., -2., 2., 2., .5, .5}};
+
+        tab.propagate_until({5., 5.});
+
+        REQUIRE(tab.get_state()[0] == approximately(ta_ref.get_state()[0], 1000.));
+        REQUIRE(tab.get_state()[2] == approximately(ta_ref.get_state()[1], 1000.));
+
+        auto ta_ref3 = taylor_adaptive<double>{make_sys(-2_dbl, 2_dbl, .5_dbl), {0.1, 0.2}, kw::compact_mode = cm};
+        ta_ref3.propagate_until(5.);
+
+        REQUIRE(tab.get_state()[1] == approximately(ta_ref3.get_state()[0], 1000.));
+        REQUIRE(tab.get_state()[3] == approximately(ta_ref3.get_state()[1], 1000.));
+    }
+}
+
+TEST_CASE("memory usage")
+{
+    const auto init_state = std::vector<double>{0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 1, 0};
+
+    for (auto cm : {false, true}) {
+        auto ta = taylor_adaptive<double>{make_nbody_sys(2, kw::masses = {1., 0.}), init_state, kw::compact_mode = cm};
+
+        auto mu = ta.memory_usage();
+        REQUIRE(mu.llvm.total() == ta.get_llvm_state().memory_usage().total());
+        REQUIRE(mu.decomposition > 0u);
+        REQUIRE(mu.tc >= ta.get_tc().size() * sizeof(double));
+        REQUIRE(mu.buffers >= 12u * sizeof(double));
+        REQUIRE(mu.total() == mu.llvm.total() + mu.decomposition + mu.tc + mu.buffers);
+
+        ta.drop_decomposition();
+        ta.drop_ir_snapshot();
+        REQUIRE(ta.get_decomposition().empty());
+        REQUIRE(ta.memory_usage().decomposition == 0u);
+        REQUIRE(ta.memory_usage().llvm.ir_snapshot == 0u);
+
+        // The integration is not affected.
+        auto ta0 = taylor_adaptive<double>{make_nbody_sys(2, kw::masses = {1., 0.}), init_state, kw::compact_mode = cm};
+        ta.propagate_until(10.);
+        ta0.propagate_until(10.);
+        REQUIRE(ta.get_state() == ta0.get_state());
+
+        if (cm) {
+            REQUIRE_THROWS_AS(taylor_adaptive<double>(ta), std::invalid_argument);
+        } else {
+            auto ta2 = ta;
+            REQUIRE(ta2.get_decomposition().empty());
+        }
+
+        auto tab = taylor_adaptive_batch<double>{make_nbody_sys(2, kw::masses = {1., 0.}),
+                                                 std::vector<double>(24u, 0.), 2, kw::compact_mode = cm};
+        REQUIRE(tab.memory_usage().decomposition > 0u);
+        REQUIRE(tab.memory_usage().tc >= 2u * ta.get_tc().size() * sizeof(double));
+        tab.drop_decomposition();
+        tab.drop_ir_snapshot();
+        REQUIRE(tab.memory_usage().decomposition == 0u);
+        REQUIRE(tab.get_llvm_state().ir_snapshot_dropped());
+    }
+}
+
+TEST_CASE("batch size tuning")
+{
+    using Catch::Matchers::Message;
+
+    auto [x, v] = make_vars("x", "v");
+
+    const auto sys = std::vector{prime(x) = v, prime(v) = -par[0] * sin(x)};
+
+    auto bt = taylor_tune_batch_size<double>(sys, std::vector{0.05, 0.025}, kw::max_batch_size = 3u,
+                                             kw::tuning_steps = 10u, kw::pars = std::vector{9.8});
+    REQUIRE(bt.batch_sizes == std::vector<std::uint32_t>{1, 2, 3});
+    REQUIRE(bt.throughputs.size() == 3u);
+    REQUIRE(std::all_of(bt.throughputs.begin(), bt.throughputs.end(), [](double t) { return t > 0; }));
+    REQUIRE(std::find(bt.batch_sizes.begin(), bt.batch_sizes.end(), bt.batch_size) != bt.batch_sizes.end());
+
+    std::ostringstream oss;
+    oss << bt;
+    REQUIRE(oss.str().find("Recommended batch size: " + std::to_string(bt.batch_size)) != std::string::npos);
+
+    REQUIRE(taylor_tune_batch_size<double>(sys, std::vector{0.05, 0.025}, kw::max_batch_size = 8u,
+                                           kw::tuning_steps = 1u)
+                .batch_sizes
+            == std::vector<std::uint32_t>{1, 2, 4, 8});
+
+    REQUIRE_THROWS_MATCHES(
+        taylor_tune_batch_size<double>(sys, std::vector{0.05, 0.025}, kw::max_batch_size = 0u), std::invalid_argument,
+        Message("The maximum batch size in the selection of the batch size cannot be zero"));
+
+    // Construction with the automatic selection of the batch size: the state
+    // and the parameters are replicated over the lanes.
+    auto ta = taylor_adaptive_batch<double>{sys, {0.05, 0.025}, batch_size_auto, kw::max_batch_size = 2u,
+                                            kw::tuning_steps = 10u, kw::pars = {9.8}};
+    const auto bs = ta.get_batch_size();
+    REQUIRE((bs == 1u || bs == 2u));
+    REQUIRE(ta.get_state() == detail::taylor_replicate_lanes(std::vector{0.05, 0.025}, bs));
+    REQUIRE(ta.get_pars() == std::vector<double>(bs, 9.8));
+    REQUIRE(ta.get_time() == std::vector<double>(bs, 0.));
+
+    auto ta0 = taylor_adaptive<double>{sys, {0.05, 0.025}, kw::pars = {9.8}};
+    ta.propagate_until(std::vector<double>(bs, 10.));
+    ta0.propagate_until(10.);
+
+    for (std::uint32_t i = 0; i < bs; ++i) {
+        REQUIRE(ta.get_state()[i] == approximately(ta0.get_state()[0], 1000.));
+        REQUIRE(ta.get_state()[bs + i] == approximately(ta0.get_state()[1], 1000.));
+    }
+}
+
+TEST_CASE("mixed error control")
+{
+    using Catch::Matchers::Message;
+
+    auto [x, v, y, w] = make_vars("x", "v", "y", "w");
+
+    // A slow and a fast harmonic oscillator.
+    const auto sys = std::vector{prime(x) = v, prime(v) = -x, prime(y) = w, prime(w) = -100. * y};
+    const auto init_state = std::vector{1., 0., 1., 0.};
+
+    for (auto cm : {false, true}) {
+        for (auto ha : {false, true}) {
+            auto ta = taylor_adaptive<double>{sys, init_state, kw::compact_mode = cm, kw::high_accuracy = ha,
+                                              kw::rtol = 1e-12, kw::atol = 1e-12};
+            REQUIRE(ta.get_order() == taylor_adaptive<double>{sys, init_state, kw::tol = 1e-12}.get_order());
+
+            const auto n_steps = std::get<3>(ta.propagate_until(10.));
+            REQUIRE(ta.get_state()[0] == approximately(std::cos(10.), 1000000.));
+            REQUIRE(ta.get_state()[2] == approximately(std::cos(100.), 100000000.));
+
+            // Excluding the fast oscillator from the error
+            // control results in fewer steps.
+            auto ta_w = taylor_adaptive<double>{sys,
+                                                init_state,
+                                                kw::compact_mode = cm,
+                                                kw::high_accuracy = ha,
+                                                kw::rtol = 1e-12,
+                                                kw::atol = 1e-12,
+                                                kw::err_weights = {1., 1., 0., 0.}};
+            const auto n_steps_w = std::get<3>(ta_w.propagate_until(10.));
+            REQUIRE(n_steps_w < n_steps);
+            REQUIRE(ta_w.get_state()[0] == approximately(std::cos(10.), 1000000.));
+
+            // The order is determined by the smallest tolerance.
+            auto ta_o = taylor_adaptive<double>{sys, init_state, kw::compact_mode = cm, kw::rtol = 1e-6,
+                                                kw::atol = 1e-15};
+            REQUIRE(ta_o.get_order() == taylor_adaptive<double>{sys, init_state, kw::tol = 1e-15}.get_order());
+
+            // Batch mode.
+            auto tab = taylor_adaptive_batch<double>{sys,
+                                                     {1., 1., 0., 0., 1., 1., 0., 0.},
+                                                     2,
+                                                     kw::compact_mode = cm,
+                                                     kw::high_accuracy = ha,
+                                                     kw::rtol = 1e-12,
+                                                     kw::atol = 1e-12,
+                                                     kw::err_weights = {1., 1., 0., 0.}};
+            tab.propagate_until({10., 10.});
+            REQUIRE(std::get<3>(tab.get_propagate_res()[0]) < n_steps);
+            REQUIRE(tab.get_state()[0] == approximately(std::cos(10.), 1000000.));
+            REQUIRE(tab.get_state()[1] == approximately(std::cos(10.), 1000000.));
+        }
+    }
+
+    // Error handling.
+    REQUIRE_THROWS_MATCHES((taylor_adaptive<double>{sys, init_state, kw::atol = 0.}), std::invalid_argument,
+                           Message("The absolute tolerance in an adaptive Taylor stepper must be finite and "
+                                   "positive, but it is 0 instead"));
+    REQUIRE_THROWS_AS((taylor_adaptive<double>{sys, init_state, kw::atol = -1e-10}), std::invalid_argument);
+    REQUIRE_THROWS_AS((taylor_adaptive<double>{sys, init_state, kw::rtol = -1e-10}), std::invalid_argument);
+    REQUIRE_THROWS_MATCHES((taylor_adaptive<double>{sys, init_state, kw::err_weights = {1., 1.}}),
+                           std::invalid_argument,
+                           Message("The number of error weights in an adaptive Taylor stepper (2) differs from the "
+                                   "number of equations (4)"));
+    REQUIRE_THROWS_AS((taylor_adaptive<double>{sys, init_state, kw::err_weights = {1., 1., -1., 0.}}),
+                      std::invalid_argument);
+    REQUIRE_THROWS_MATCHES((taylor_adaptive<double>{sys, init_state, kw::err_weights = {0., 0., 0., 0.}}),
+                           std::invalid_argument,
+                           Message("The error weights in an adaptive Taylor stepper cannot be all zero"));
+}
+
+TEST_CASE("variable order")
+{
+    using Catch::Matchers::Message;
+
+    auto [x, y, vx, vy] = make_vars("x", "y", "vx", "vy");
+
+    // Highly-eccentric Keplerian orbit (e = 0.9), starting at the apocentre.
+    const auto r3 = pow(x * x + y * y, 1.5);
+    const auto sys = std::vector{prime(x) = vx, prime(y) = vy, prime(vx) = -x / r3, prime(vy) = -y / r3};
+    const auto init_state = std::vector{1.9, 0., 0., std::sqrt(0.1 / 1.9)};
+    const auto period = 2 * boost::math::constants::pi<double>();
+
+    const auto orders = std::vector<std::uint32_t>{8, 12, 16, 20, 24};
+
+    for (auto cm : {false, true}) {
+        for (auto ha : {false, true}) {
+            auto ta = taylor_adaptive<double>{sys, init_state, kw::compact_mode = cm, kw::high_accuracy = ha,
+                                              kw::orders = orders};
+            REQUIRE(ta.get_orders() == orders);
+            // The first step is taken with the order closest
+            // to the order deduced from the tolerance.
+            REQUIRE(ta.get_order() == 20u);
+
+            // Integrate for one period, recording the orders of the steps.
+            std::map<std::uint32_t, int> n_order_steps;
+            while (ta.get_time() < period) {
+                const auto [oc, h] = ta.step(period - ta.get_time());
+                REQUIRE(oc != taylor_outcome::err_nf_state);
+                ++n_order_steps[ta.get_order()];
+            }
+
+            for (const auto &p : n_order_steps) {
+                REQUIRE(std::find(orders.begin(), orders.end(), p.first) != orders.end());
+            }
+
+            // Back to the initial state after one period.
+            REQUIRE(ta.get_state()[0] == approximately(init_state[0], 10000.));
+            REQUIRE(std::abs(ta.get_state()[1]) < 1e-11);
+            REQUIRE(std::abs(ta.get_state()[2]) < 1e-11);
+            REQUIRE(ta.get_state()[3] == approximately(init_state[3], 10000.));
+
+            // The dense output uses the order of the last step.
+            ta.update_d_output(ta.get_time());
+            for (auto i = 0u; i < 4u; ++i) {
+                REQUIRE(std::abs(ta.get_d_output()[i] - ta.get_state()[i]) < 1e-14);
+            }
+
+            // Copy and serialisation.
+            auto ta_copy = ta;
+            REQUIRE(ta_copy.get_orders() == orders);
+            REQUIRE(ta_copy.get_order() == ta.get_order());
+
+            std::stringstream ss;
+            ta.save(ss);
+            taylor_adaptive<double> ta_load;
+            ta_load.load(ss);
+            REQUIRE(ta_load.get_orders() == orders);
+            REQUIRE(ta_load.get_order() == ta.get_order());
+            REQUIRE(ta_load.get_tc() == ta.get_tc());
+
+            ta.step();
+            ta_copy.step();
+            ta_load.step();
+            REQUIRE(ta_copy.get_state() == ta.get_state());
+            REQUIRE(ta_load.get_state() == ta.get_state());
+            REQUIRE(ta_load.get_order() == ta.get_order());
+        }
+    }
+
+    // A single order.
+    auto ta = taylor_adaptive<double>{sys, init_state, kw::orders = std::vector<std::uint32_t>{10}};
+    ta.propagate_for(1.);
+    REQUIRE(ta.get_order() == 10u);
+    REQUIRE(taylor_adaptive<double>{sys, init_state}.get_orders().empty());
+
+    // Error handling.
+    REQUIRE_THROWS_MATCHES((taylor_adaptive<double>{sys, init_state, kw::orders = std::vector<std::uint32_t>{1, 2}}),
+                           std::invalid_argument,
+                           Message("The orders of a variable-order adaptive Taylor integrator must be at least 2"));
+    REQUIRE_THROWS_MATCHES(
+        (taylor_adaptive<double>{sys, init_state, kw::orders = std::vector<std::uint32_t>{10, 10}}),
+        std::invalid_argument,
+        Message("The orders of a variable-order adaptive Taylor integrator must be in strictly increasing order"));
+    REQUIRE_THROWS_AS(
+        (taylor_adaptive<double>{sys, init_state, kw::orders = std::vector<std::uint32_t>{10, 12},
+                                 kw::isa_variants = std::vector<std::string>{"generic"}}),
+        std::invalid_argument);
+}
+
+TEST_CASE("propagate kernel")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    const auto sys = std::vector{prime(x) = v, prime(v) = -9.8 * sin(x)};
+    const auto init_state = std::vector{0.05, 0.025};
+
+    for (auto cm : {false, true}) {
+        for (auto ha : {false, true}) {
+            // NOTE: the collection of the statistics disables
+            // the propagate kernel, thus ta_loop runs the
+            // step-by-step loop.
+            auto ta = taylor_adaptive<double>{sys, init_state, kw::compact_mode = cm, kw::high_accuracy = ha};
+            auto ta_loop = ta;
+            ta_loop.enable_stats();
+
+            // Time limit.
+            for (auto tf : {10., 25., -3.}) {
+                const auto res = ta.propagate_until(tf);
+                const auto res_loop = ta_loop.propagate_until(tf);
+
+                REQUIRE(std::get<0>(res) == taylor_outcome::time_limit);
+                REQUIRE(std::get<0>(res_loop) == taylor_outcome::time_limit);
+                REQUIRE(std::get<1>(res) == approximately(std::get<1>(res_loop)));
+                REQUIRE(std::get<2>(res) == approximately(std::get<2>(res_loop)));
+                REQUIRE(std::get<3>(res) == std::get<3>(res_loop));
+                REQUIRE(ta.get_time() == tf);
+                REQUIRE(ta.get_last_h() == approximately(ta_loop.get_last_h()));
+                REQUIRE(ta.get_state()[0] == approximately(ta_loop.get_state()[0]));
+                REQUIRE(ta.get_state()[1] == approximately(ta_loop.get_state()[1]));
+            }
+
+            // Step limit.
+            const auto res = ta.propagate_for(100., 7);
+            const auto res_loop = ta_loop.propagate_for(100., 7);
+            REQUIRE(std::get<0>(res) == taylor_outcome::step_limit);
+            REQUIRE(std::get<0>(res_loop) == taylor_outcome::step_limit);
+            REQUIRE(std::get<3>(res) == 7u);
+            REQUIRE(ta.get_time() == approximately(ta_loop.get_time()));
+
+            // Zero timestep.
+            const auto res0 = ta.propagate_until(ta.get_time());
+            REQUIRE(std::get<0>(res0) == taylor_outcome::time_limit);
+            REQUIRE(std::get<3>(res0) == 0u);
+
+            // Non-finite state.
+            ta.get_state_data()[1] = std::numeric_limits<double>::infinity();
+            REQUIRE(std::get<0>(ta.propagate_for(10.)) == taylor_outcome::err_nf_state);
+        }
+    }
+}
+
+TEST_CASE("compensated time")
+{
+    using Catch::Matchers::Message;
+
+    auto [x, v] = make_vars("x", "v");
+
+    const auto sys = std::vector{prime(x) = v, prime(v) = 1_dbl};
+    const auto init_state = std::vector{0., 0.};
+
+    // The exact sum of n steps of size h, as a double-length value.
+    const auto n_steps = 10000;
+    const auto h = 0.1;
+    const auto ref_hi = n_steps * h;
+    const auto ref_lo = std::fma(n_steps, h, -ref_hi);
+
+    for (auto cm : {false, true}) {
+        auto ta = taylor_adaptive<double>{sys, init_state, kw::compact_mode = cm};
+        auto ta_comp = taylor_adaptive<double>{sys, init_state, kw::compact_mode = cm, kw::compensated_time = true};
+
+        REQUIRE(!ta.get_compensated_time());
+        REQUIRE(ta_comp.get_compensated_time());
+
+        for (auto i = 0; i < n_steps; ++i) {
+            REQUIRE(std::get<1>(ta.step(h)) == h);
+            REQUIRE(std::get<1>(ta_comp.step(h)) == h);
+        }
+
+        REQUIRE(ta.get_dtime().second == 0.);
+        const auto err = std::abs((ta.get_time() - ref_hi) - ref_lo);
+        const auto [hi, lo] = ta_comp.get_dtime();
+        const auto err_comp = std::abs((hi - ref_hi) + (lo - ref_lo));
+
+        REQUIRE(err > 1e-12);
+        REQUIRE(err_comp < 1e-20);
+
+        // Copy and serialisation.
+        auto ta_copy = ta_comp;
+        REQUIRE(ta_copy.get_compensated_time());
+        REQUIRE(ta_copy.get_dtime() == ta_comp.get_dtime());
+
+        std::stringstream ss;
+        ta_comp.save(ss);
+        taylor_adaptive<double> ta_load;
+        ta_load.load(ss);
+        REQUIRE(ta_load.get_compensated_time());
+        REQUIRE(ta_load.get_dtime() == ta_comp.get_dtime());
+
+        // The propagate functions.
+        REQUIRE(std::get<0>(ta_comp.propagate_until(1500.)) == taylor_outcome::time_limit);
+        REQUIRE(ta_comp.get_time() == 1500.);
+        REQUIRE(std::abs(ta_comp.get_dtime().second) < 1e-20);
+        REQUIRE(ta_comp.get_state()[0] == approximately(1500. * 1500. / 2));
+
+        // set_time() and set_dtime().
+        ta_comp.set_dtime(1., 1e-17);
+        REQUIRE(ta_comp.get_dtime() == std::pair{1., 1e-17});
+        ta_comp.set_dtime(1e-17, 1.);
+        REQUIRE(ta_comp.get_dtime() == std::pair{1., 1e-17});
+        ta_comp.set_time(2.);
+        REQUIRE(ta_comp.get_dtime() == std::pair{2., 0.});
+
+        REQUIRE_THROWS_MATCHES(ta_comp.set_dtime(1., std::numeric_limits<double>::infinity()),
+                               std::invalid_argument,
+                               Message("A non-finite time was passed to the set_dtime() function of an adaptive "
+                                       "Taylor integrator"));
+        REQUIRE_THROWS_MATCHES(ta.set_dtime(1., 1e-17), std::invalid_argument,
+                               Message("A nonzero low-order part of the time can be passed to the set_dtime() function "
+                                       "of an adaptive Taylor integrator only with the compensated summation of the "
+                                       "time"));
+        ta.set_dtime(3., 0.);
+        REQUIRE(ta.get_dtime() == std::pair{3., 0.});
+
+        // Batch mode.
+        auto tab = taylor_adaptive_batch<double>{
+            sys, std::vector<double>(4u, 0.), 2, kw::compact_mode = cm, kw::compensated_time = true};
+        REQUIRE(tab.get_compensated_time());
+
+        for (auto i = 0; i < n_steps; ++i) {
+            tab.step({h, -h});
+        }
+
+        REQUIRE(std::abs((tab.get_dtime().first[0] - ref_hi) + (tab.get_dtime().second[0] - ref_lo)) < 1e-20);
+        REQUIRE(std::abs((tab.get_dtime().first[1] + ref_hi) + (tab.get_dtime().second[1] + ref_lo)) < 1e-20);
+
+        std::stringstream ssb;
+        tab.save(ssb);
+        taylor_adaptive_batch<double> tab_load;
+        tab_load.load(ssb);
+        REQUIRE(tab_load.get_compensated_time());
+        REQUIRE(tab_load.get_dtime().first == tab.get_dtime().first);
+        REQUIRE(tab_load.get_dtime().second == tab.get_dtime().second);
+
+        tab.propagate_until({1500., -1500.});
+        REQUIRE(tab.get_time() == std::vector{1500., -1500.});
+
+        tab.set_time({1., 2.});
+        REQUIRE(tab.get_dtime().second == std::vector{0., 0.});
+
+        REQUIRE_THROWS_MATCHES(tab.set_time({1.}), std::invalid_argument,
+                               Message("Invalid sizes detected in the set_dtime() function of an adaptive Taylor "
+                                       "integrator in batch mode: the time vectors have sizes of 1 and 1, but they "
+                                       "must both be equal to the batch size (2)"));
+    }
+}
+
+TEST_CASE("step size prediction")
+{
+    using Catch::Matchers::Message;
+
+    auto [x, v] = make_vars("x", "v");
+
+    const auto sys = std::vector{prime(x) = v, prime(v) = -9.8 * sin(x)};
+    const auto init_state = std::vector{0.05, 0.025};
+
+    for (auto cm : {false, true}) {
+        for (auto ha : {false, true}) {
+            auto ta = taylor_adaptive<double>{sys, init_state, kw::compact_mode = cm, kw::high_accuracy = ha};
+            auto ta_pred = taylor_adaptive<double>{sys, init_state, kw::compact_mode = cm, kw::high_accuracy = ha,
+                                                   kw::predict_h = true};
+
+            REQUIRE(!ta.get_predict_h());
+            REQUIRE(ta_pred.get_predict_h());
+
+            // The first step has no prediction available.
+            REQUIRE(std::get<1>(ta_pred.step()) == std::get<1>(ta.step()));
+
+            // The step sizes never exceed the step sizes
+            // estimated from the current Taylor coefficients.
+            auto ta_chk = ta;
+            for (auto i = 0; i < 20; ++i) {
+                std::copy(ta_pred.get_state().begin(), ta_pred.get_state().end(), ta_chk.get_state_data());
+                ta_chk.set_time(ta_pred.get_time());
+
+                const auto [oc, h] = ta_pred.step();
+                REQUIRE(oc == taylor_outcome::success);
+                REQUIRE(h > 0);
+                REQUIRE(h <= std::get<1>(ta_chk.step()) * (1 + 1e-12));
+            }
+
+            // The results are consistent with the integration without prediction.
+            ta.propagate_until(10.);
+            ta_pred.propagate_until(10.);
+            REQUIRE(ta_pred.get_time() == 10.);
+            REQUIRE(ta_pred.get_state()[0] == approximately(ta.get_state()[0], 1000.));
+            REQUIRE(ta_pred.get_state()[1] == approximately(ta.get_state()[1], 1000.));
+
+            // The step-by-step loop and the propagate kernel
+            // produce the same results.
+            auto ta_loop = ta_pred;
+            ta_loop.enable_stats();
+            ta_pred.propagate_until(20.);
+            ta_loop.propagate_until(20.);
+            REQUIRE(ta_pred.get_state()[0] == approximately(ta_loop.get_state()[0]));
+            REQUIRE(ta_pred.get_state()[1] == approximately(ta_loop.get_state()[1]));
+
+            // Serialisation: the prediction is preserved.
+            std::stringstream ss;
+            ta_pred.save(ss);
+            taylor_adaptive<double> ta_load;
+            ta_load.load(ss);
+            REQUIRE(ta_load.get_predict_h());
+            REQUIRE(std::get<1>(ta_load.step()) == std::get<1>(ta_pred.step()));
+            REQUIRE(ta_load.get_state() == ta_pred.get_state());
+        }
+    }
+
+    // Batch mode.
+    for (auto cm : {false, true}) {
+        auto tab = taylor_adaptive_batch<double>{sys, {0.05, 0.06, 0.025, 0.026}, 2, kw::compact_mode = cm};
+        auto tab_pred = taylor_adaptive_batch<double>{sys, {0.05, 0.06, 0.025, 0.026}, 2, kw::compact_mode = cm,
+                                                      kw::predict_h = true};
+        REQUIRE(tab_pred.get_predict_h());
+
+        tab.propagate_until({10., -10.});
+        tab_pred.propagate_until({10., -10.});
+        REQUIRE(tab_pred.get_time() == std::vector{10., -10.});
+        for (auto i = 0u; i < 4u; ++i) {
+            REQUIRE(tab_pred.get_state()[i] == approximately(tab.get_state()[i], 1000.));
+        }
+
+        std::stringstream ss;
+        tab_pred.save(ss);
+        taylor_adaptive_batch<double> tab_load;
+        tab_load.load(ss);
+        REQUIRE(tab_load.get_predict_h());
+        REQUIRE(tab_load.step() == tab_pred.step());
+    }
+
+    REQUIRE_THROWS_MATCHES(
+        (taylor_adaptive<double>{sys, init_state, kw::orders = std::vector<std::uint32_t>{10, 20},
+                                 kw::predict_h = true}),
+        std::invalid_argument,
+        Message("The step size prediction is not supported by the variable-order adaptive Taylor integrator"));
+}
+
+TEST_CASE("simd segments")
+{
+    // The u variables of the N-body system are grouped
+    // into several SIMD groups within each segment.
+    const auto sys = make_nbody_sys(4, kw::masses = {1., .1, .01, .001});
+    const auto init_state = std::vector{0., 0., 0., 1., 0., 0., 0., 1., 0., 0., 1.1, 0.,
+                                        0., -.9, 0., -1.2, 0., 0., 0., 0., 1.3, 0., -.8, 0.};
+
+    for (auto ha : {false, true}) {
+        auto ta = taylor_adaptive<double>{sys, init_state, kw::high_accuracy = ha};
+        auto ta_simd = taylor_adaptive<double>{sys, init_state, kw::high_accuracy = ha, kw::simd_segments = true};
+
+        ta.propagate_until(5.);
+        ta_simd.propagate_until(5.);
+
+        for (auto i = 0u; i < init_state.size(); ++i) {
+            REQUIRE(ta_simd.get_state()[i] == approximately(ta.get_state()[i], 1000.));
+        }
+    }
+
+    // The option has no effect in compact mode
+    // and in extended precision.
+    auto ta = taylor_adaptive<double>{sys, init_state, kw::compact_mode = true, kw::simd_segments = true};
+    ta.propagate_until(1.);
+
+    auto ta_ld = taylor_adaptive<long double>{sys, std::vector<long double>(init_state.begin(), init_state.end()),
+                                              kw::simd_segments = true};
+    ta_ld.propagate_until(1.);
+    REQUIRE(static_cast<double>(ta_ld.get_state()[0]) == approximately(ta.get_state()[0], 1000.));
+}
+
+TEST_CASE("estrin")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    const auto sys = std::vector{prime(x) = v, prime(v) = -9.8 * sin(x)};
+    const auto init_state = std::vector{0.05, 0.025};
+
+    auto ta = taylor_adaptive<double>{sys, init_state};
+    auto ta_e = taylor_adaptive<double>{sys, init_state, kw::estrin = true};
+
+    ta.propagate_until(10.);
+    ta_e.propagate_until(10.);
+
+    REQUIRE(ta_e.get_state()[0] == approximately(ta.get_state()[0], 1000.));
+    REQUIRE(ta_e.get_state()[1] == approximately(ta.get_state()[1], 1000.));
+
+    // Batch mode.
+    auto tab = taylor_adaptive_batch<double>{sys, {0.05, 0.06, 0.025, 0.026}, 2, kw::estrin = true};
+    tab.propagate_until({10., 10.});
+
+    REQUIRE(tab.get_state()[0] == approximately(ta.get_state()[0], 1000.));
+    REQUIRE(tab.get_state()[2] == approximately(ta.get_state()[1], 1000.));
+
+    // The option has no effect in compact mode
+    // and in high-accuracy mode.
+    for (auto [cm, ha] : {std::pair{true, false}, std::pair{false, true}}) {
+        auto ta2 = taylor_adaptive<double>{sys, init_state, kw::compact_mode = cm, kw::high_accuracy = ha,
+                                           kw::estrin = true};
+        ta2.propagate_until(10.);
+
+        REQUIRE(ta2.get_state()[0] == approximately(ta.get_state()[0], 1000.));
+    }
+
+    // Variable-order integration.
+    auto ta_vo = taylor_adaptive<double>{sys, init_state, kw::orders = std::vector<std::uint32_t>{8, 12, 16},
+                                         kw::estrin = true};
+    ta_vo.propagate_until(10.);
+
+    REQUIRE(ta_vo.get_state()[0] == approximately(ta.get_state()[0], 1000.));
+}
+
+TEST_CASE("external buffers")
+{
+    using Catch::Matchers::Message;
+
+    auto [x, v] = make_vars("x", "v");
+
+    const auto sys = std::vector{prime(x) = v, prime(v) = -par[0] * sin(x)};
+    const auto init_state = std::vector{0.05, 0.025};
+
+    for (auto cm : {false, true}) {
+        auto ta = taylor_adaptive<double>{sys, init_state, kw::compact_mode = cm, kw::pars = {9.8}};
+        auto ta_ref = ta;
+
+        // Bind the state and the parameters.
+        auto ext_state = init_state;
+        std::vector ext_pars{9.8};
+        ta.bind_buffers(ext_state.data(), ext_pars.data());
+        REQUIRE(ta.get_state_data() == ext_state.data());
+        REQUIRE(ta.get_pars_data() == ext_pars.data());
+        REQUIRE(ta.get_pars_size() == 1u);
+
+        REQUIRE_THROWS_MATCHES(ta.get_state(), std::invalid_argument,
+                               Message("The state vector of an adaptive Taylor integrator cannot be fetched while an "
+                                       "external buffer is bound: use get_state_data() instead"));
+        REQUIRE_THROWS_MATCHES(ta.get_pars(), std::invalid_argument,
+                               Message("The parameters of an adaptive Taylor integrator cannot be fetched while an "
+                                       "external buffer is bound: use get_pars_data() instead"));
+
+        // The integration operates in place.
+        ta.propagate_until(10.);
+        ta_ref.propagate_until(10.);
+        REQUIRE(ext_state == ta_ref.get_state());
+
+        ta.step();
+        ta_ref.step();
+        REQUIRE(ext_state == ta_ref.get_state());
+
+        const auto grid_out = ta.propagate_grid({ta.get_time(), ta.get_time() + 1.});
+        const auto grid_ref = ta_ref.propagate_grid({ta_ref.get_time(), ta_ref.get_time() + 1.});
+        REQUIRE(std::get<4>(grid_out) == std::get<4>(grid_ref));
+        REQUIRE(ext_state == ta_ref.get_state());
+
+        // Changes to the external buffers are seen by the integrator.
+        ext_pars[0] = 1.;
+        ta_ref.get_pars_data()[0] = 1.;
+        ta.propagate_for(5.);
+        ta_ref.propagate_for(5.);
+        REQUIRE(ext_state == ta_ref.get_state());
+
+        // Streaming.
+        std::ostringstream oss;
+        oss << ta;
+        REQUIRE(!oss.str().empty());
+
+        // Copies and serialisation store the contents of the external buffers.
+        auto ta_copy = ta;
+        REQUIRE(ta_copy.get_state() == ext_state);
+        REQUIRE(ta_copy.get_pars() == ext_pars);
+
+        std::stringstream ss;
+        ta.save(ss);
+        taylor_adaptive<double> ta_load;
+        ta_load.load(ss);
+        REQUIRE(ta_load.get_state() == ext_state);
+        REQUIRE(ta_load.get_pars() == ext_pars);
+
+        // Unbinding copies back the contents of the external buffers.
+        ta.unbind_buffers();
+        REQUIRE(ta.get_state() == ext_state);
+        REQUIRE(ta.get_pars() == ext_pars);
+        REQUIRE(ta.get_state_data() != ext_state.data());
+
+        // Binding only the state.
+        ta.bind_buffers(ext_state.data(), nullptr);
+        REQUIRE(ta.get_pars() == ext_pars);
+        ta.unbind_buffers();
+
+        // Error checking.
+        std::vector<double> buf(4);
+        REQUIRE_THROWS_MATCHES(ta.bind_buffers(buf.data(), buf.data() + 1), std::invalid_argument,
+                               Message("The external buffers for the state and the parameters of an adaptive Taylor "
+                                       "integrator cannot overlap"));
+        REQUIRE_THROWS_MATCHES(
+            ta.bind_buffers(reinterpret_cast<double *>(reinterpret_cast<char *>(buf.data()) + 1), nullptr),
+            std::invalid_argument,
+            Message("An external buffer for an adaptive Taylor integrator must be aligned to "
+                    + std::to_string(alignof(double)) + " bytes"));
+        ta.bind_buffers(buf.data(), buf.data() + 2);
+        ta.unbind_buffers();
+
+        // Batch mode.
+        auto tab = taylor_adaptive_batch<double>{sys, {0.05, 0.06, 0.025, 0.026}, 2, kw::compact_mode = cm,
+                                                 kw::pars = {9.8, 9.9}};
+        auto tab_ref = tab;
+
+        std::vector ext_bstate{0.05, 0.06, 0.025, 0.026}, ext_bpars{9.8, 9.9};
+        tab.bind_buffers(ext_bstate.data(), ext_bpars.data());
+        REQUIRE_THROWS_AS(tab.get_state(), std::invalid_argument);
+        REQUIRE_THROWS_AS(tab.get_pars(), std::invalid_argument);
+
+        tab.propagate_until({10., -10.});
+        tab_ref.propagate_until({10., -10.});
+        REQUIRE(ext_bstate == tab_ref.get_state());
+
+        tab.unbind_buffers();
+        REQUIRE(tab.get_state() == ext_bstate);
+    }
+}
+
+TEST_CASE("reset")
+{
+    using Catch::Matchers::Message;
+
+    auto [x, v] = make_vars("x", "v");
+
+    const auto sys = std::vector{prime(x) = v, prime(v) = -par[0] * sin(x)};
+    const auto init_state = std::vector{0.05, 0.025};
+
+    using ev_t = taylor_adaptive<double>::t_event_t;
+
+    auto ta = taylor_adaptive<double>{sys, init_state, kw::pars = {9.8}, kw::predict_h = true,
+                                      kw::t_events = std::vector<ev_t>{ev_t(v, kw::cooldown = 1.)}};
+    auto ta_fresh = ta;
+
+    // Integrate, then reset to the initial conditions.
+    ta.propagate_until(10.);
+    ta.reset(init_state, 0.);
+
+    REQUIRE(ta.get_state() == init_state);
+    REQUIRE(ta.get_time() == 0.);
+    REQUIRE(ta.get_last_h() == 0.);
+
+    // The reset integrator behaves like a fresh one.
+    const auto res = ta.propagate_until(10.);
+    const auto res_fresh = ta_fresh.propagate_until(10.);
+    REQUIRE(std::get<0>(res) == std::get<0>(res_fresh));
+    REQUIRE(std::get<3>(res) == std::get<3>(res_fresh));
+    REQUIRE(ta.get_time() == ta_fresh.get_time());
+    REQUIRE(ta.get_state() == ta_fresh.get_state());
+
+    // Reset with new parameters.
+    ta.reset({0.1, 0.}, 1., {2.});
+    REQUIRE(ta.get_state() == std::vector{0.1, 0.});
+    REQUIRE(ta.get_time() == 1.);
+    REQUIRE(ta.get_pars() == std::vector{2.});
+
+    // Error checking.
+    REQUIRE_THROWS_MATCHES(ta.reset({1.}), std::invalid_argument,
+                           Message("Invalid state vector passed to the reset() function of an adaptive Taylor "
+                                   "integrator: the size of the state vector is 1, but it must be 2"));
+    REQUIRE_THROWS_MATCHES(ta.reset({1., std::numeric_limits<double>::quiet_NaN()}), std::invalid_argument,
+                           Message("A non-finite value was detected in the state vector passed to the reset() "
+                                   "function of an adaptive Taylor integrator"));
+    REQUIRE_THROWS_MATCHES(ta.reset({1., 2.}, std::numeric_limits<double>::infinity()), std::invalid_argument,
+                           Message("A non-finite time was passed to the reset() function of an adaptive Taylor "
+                                   "integrator"));
+    REQUIRE_THROWS_MATCHES(ta.reset({1., 2.}, 0., {1., 2.}), std::invalid_argument,
+                           Message("Invalid vector of parameters passed to the reset() function of an adaptive "
+                                   "Taylor integrator: the size of the vector is 2, but it must be 1"));
+
+    // The failed resets do not alter the integrator.
+    REQUIRE(ta.get_state() == std::vector{0.1, 0.});
+    REQUIRE(ta.get_time() == 1.);
+    REQUIRE(ta.get_pars() == std::vector{2.});
+
+    // Batch mode.
+    auto tab = taylor_adaptive_batch<double>{sys, {0.05, 0.06, 0.025, 0.026}, 2, kw::pars = {9.8, 9.9}};
+    auto tab_fresh = tab;
+
+    tab.propagate_until({10., -10.});
+    tab.reset({0.05, 0.06, 0.025, 0.026}, {0., 0.});
+    REQUIRE(tab.get_last_h() == std::vector{0., 0.});
+
+    tab.propagate_until({10., -10.});
+    tab_fresh.propagate_until({10., -10.});
+    REQUIRE(tab.get_state() == tab_fresh.get_state());
+    REQUIRE(tab.get_time() == tab_fresh.get_time());
+
+    tab.reset({0.05, 0.06, 0.025, 0.026}, {1., 2.}, {1., 2.});
+    REQUIRE(tab.get_time() == std::vector{1., 2.});
+    REQUIRE(tab.get_pars() == std::vector{1., 2.});
+
+    REQUIRE_THROWS_MATCHES(tab.reset({0.05, 0.06, 0.025, 0.026}, {1.}), std::invalid_argument,
+                           Message("Invalid time vector passed to the reset() function of an adaptive Taylor "
+                                   "integrator in batch mode: the size of the time vector is 1, but it must be equal "
+                                   "to the batch size (2)"));
+}
+
+TEST_CASE("checkpoints")
+{
+    using Catch::Matchers::Message;
+    using std::cos;
+    using std::sin;
+
+    auto [x, v] = make_vars("x", "v");
+
+    // Harmonic oscillator: x(t) = cos(t), v(t) = -sin(t).
+    auto ta = taylor_adaptive<double>{{prime(x) = v, prime(v) = -x}, {1., 0.}};
+
+    REQUIRE(!ta.checkpoints_enabled());
+    REQUIRE_THROWS_MATCHES(ta.get_checkpoints(), std::invalid_argument,
+                           Message("Cannot fetch the checkpoints of an adaptive Taylor integrator if their "
+                                   "recording has not been enabled"));
+
+    ta.enable_checkpoints();
+    REQUIRE(ta.checkpoints_enabled());
+    REQUIRE(ta.get_checkpoints().get_n_steps() == 0u);
+    REQUIRE(ta.get_checkpoints().get_dim() == 2u);
+    REQUIRE(ta.get_checkpoints().get_order() == ta.get_order());
+
+    const auto res = ta.propagate_until(10.);
+    REQUIRE(std::get<0>(res) == taylor_outcome::time_limit);
+
+    auto ckpts = ta.get_checkpoints();
+    REQUIRE(ckpts.get_n_steps() == std::get<3>(res));
+    REQUIRE(ckpts.get_bounds() == std::pair{0., 10.});
+    REQUIRE(ckpts.get_times().size() == ckpts.get_n_steps() + 1u);
+    REQUIRE(ckpts.get_tcs().size() == ckpts.get_n_steps() * 2u * (ta.get_order() + 1u));
+
+    // The final state is reproduced.
+    REQUIRE(ckpts(10.)[0] == approximately(ta.get_state()[0], 100.));
+    REQUIRE(ckpts(10.)[1] == approximately(ta.get_state()[1], 100.));
+
+    // Evaluation backward in time at arbitrary points.
+    for (auto t = 10.; t >= 0; t -= 0.37) {
+        REQUIRE(ckpts(t)[0] == approximately(cos(t), 1000.));
+        REQUIRE(ckpts(t)[1] == approximately(-sin(t), 1000.));
+    }
+    REQUIRE(ckpts(0.) == std::vector{1., 0.});
+
+    REQUIRE_THROWS_MATCHES(ckpts(10.5), std::invalid_argument,
+                           Message("Cannot evaluate a store of checkpoints at the time 10.5, which is outside the "
+                                   "time range [0, 10] of the recorded steps"));
+
+    // Serialisation.
+    {
+        std::stringstream ss;
+        ckpts.save(ss);
+
+        taylor_checkpoints<double> ckpts2;
+        ckpts2.load(ss);
+
+        REQUIRE(ckpts2.get_times() == ckpts.get_times());
+        REQUIRE(ckpts2.get_tcs() == ckpts.get_tcs());
+        REQUIRE(ckpts2(1.23) == ckpts(1.23));
+    }
+
+    // Non-contiguous steps.
+    ta.set_time(20.);
+    REQUIRE_THROWS_AS(ta.step(), std::invalid_argument);
+
+    // Record a backward integration.
+    ta.reset_checkpoints();
+    REQUIRE(ta.get_checkpoints().get_n_steps() == 0u);
+
+    ta.reset({1., 0.}, 10.);
+    ta.propagate_until(0.);
+
+    ckpts = ta.get_checkpoints();
+    REQUIRE(ckpts.get_bounds() == std::pair{10., 0.});
+    for (auto t = 0.; t <= 10.; t += 0.37) {
+        REQUIRE(ckpts(t)[0] == approximately(cos(t - 10.), 1000.));
+    }
+
+    // Steps in the opposite direction are rejected.
+    REQUIRE_THROWS_MATCHES(ta.step(), std::invalid_argument,
+                           Message("The steps recorded in a store of checkpoints must be all in the same direction "
+                                   "in time"));
+
+    ta.disable_checkpoints();
+    REQUIRE(!ta.checkpoints_enabled());
+
+    // Empty store.
+    taylor_checkpoints<double> empty;
+    REQUIRE_THROWS_MATCHES(empty.get_bounds(), std::invalid_argument,
+                           Message("Cannot fetch the bounds of an empty store of checkpoints"));
+    REQUIRE_THROWS_MATCHES(empty(0.), std::invalid_argument,
+                           Message("Cannot evaluate an empty store of checkpoints"));
+
+    // Variable-order integrator.
+    auto ta_vo = taylor_adaptive<double>{
+        {prime(x) = v, prime(v) = -x}, {1., 0.}, kw::orders = std::vector<std::uint32_t>{10, 20}};
+    REQUIRE_THROWS_MATCHES(
+        ta_vo.enable_checkpoints(), std::invalid_argument,
+        Message("The recording of the checkpoints is not supported by the variable-order adaptive Taylor integrator"));
+}
+
+TEST_CASE("shared pars")
+{
+    using std::exp;
+
+    auto [x] = make_vars("x");
+
+    REQUIRE(shared_par[0] != par[0]);
+    REQUIRE(std::hash<expression>{}(shared_par[0]) != std::hash<expression>{}(par[0]));
+
+    std::ostringstream oss;
+    oss << shared_par[3];
+    REQUIRE(oss.str() == "shared_par[3]");
+
+    for (auto cm : {false, true}) {
+        // x' = shared_par[0] * x + par[1], with
+        // the state-variable derivative of v given
+        // directly by a lane-shared param.
+        auto [v] = make_vars("v");
+        auto ta = taylor_adaptive_batch<double>{{prime(x) = shared_par[0] * x + par[1], prime(v) = shared_par[2]},
+                                                {1., 1., 1., 1., 0., 0., 0., 0.},
+                                                4,
+                                                kw::compact_mode = cm};
+
+        // NOTE: only the values in the first batch
+        // element of the lane-shared params are read.
+        ta.get_pars_data()[0] = 0.5;
+        ta.get_pars_data()[1] = ta.get_pars_data()[2] = ta.get_pars_data()[3] = 100.;
+        for (auto i = 0u; i < 4u; ++i) {
+            ta.get_pars_data()[4u + i] = static_cast<double>(i);
+        }
+        ta.get_pars_data()[8] = 3.;
+        ta.get_pars_data()[9] = ta.get_pars_data()[10] = ta.get_pars_data()[11] = -100.;
+
+        ta.propagate_until({1., 1., 1., 1.});
+
+        for (auto i = 0u; i < 4u; ++i) {
+            // x(t) = (1 + 2p) * exp(t / 2) - 2p.
+            const auto p = static_cast<double>(i);
+            REQUIRE(ta.get_state()[i] == approximately((1. + 2. * p) * exp(.5) - 2. * p, 1000.));
+            REQUIRE(ta.get_state()[4u + i] == approximately(3., 1000.));
+        }
+
+        // Serialisation preserves the lane-sharing.
+        std::stringstream ss;
+        ta.save(ss);
+        auto ta2 = taylor_adaptive_batch<double>{};
+        ta2.load(ss);
+        REQUIRE(ta2.get_decomposition() == ta.get_decomposition());
+    }
+}
+
+TEST_CASE("compact mode param preload")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    // A sparse set of params, with the same index used both
+    // as a lane-shared and as a regular param, and a param
+    // as the derivative of a state variable.
+    const auto sys = {prime(x) = par[5] * v + shared_par[5], prime(v) = -par[2] * x + par[7] * par[5]};
+
+    std::vector<double> pars(8u * 2u);
+    for (auto i = 0u; i < pars.size(); ++i) {
+        pars[i] = 0.1 * static_cast<double>(i + 1u);
+    }
+
+    auto ta_d = taylor_adaptive_batch<double>{sys, {1., 2., 0., 1.}, 2, kw::pars = pars};
+    auto ta_c = taylor_adaptive_batch<double>{sys, {1., 2., 0., 1.}, 2, kw::pars = pars, kw::compact_mode = true};
+
+    ta_d.propagate_until({3., 3.});
+    ta_c.propagate_until({3., 3.});
+
+    for (auto i = 0u; i < 4u; ++i) {
+        REQUIRE(ta_c.get_state()[i] == approximately(ta_d.get_state()[i], 1000.));
+    }
+}
+
+TEST_CASE("compact mode loop hints")
+{
+    llvm_state s;
+
+    // An n-body system, with many calls of the same
+    // derivative functions in each segment.
+    taylor_add_jet<double>(s, "jet", make_nbody_sys(6), 3, 1, false, true);
+
+    const auto ir = s.get_ir();
+    REQUIRE(ir.find("llvm.loop.unroll.count") != std::string::npos);
+    REQUIRE(ir.find("llvm.loop.vectorize.width") != std::string::npos);
+}
+
+TEST_CASE("param switched terms")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    // A damping term switched off via par[1].
+    auto ta = taylor_adaptive<double>{
+        {prime(x) = v, prime(v) = -9.8 * sin(x) - par[1] * par[0] * v}, {0.05, 0.025}, kw::pars = {0.1, 0.}};
+    auto ta_undamped = taylor_adaptive<double>{{prime(x) = v, prime(v) = -9.8 * sin(x)}, {0.05, 0.025}};
+    auto ta_damped = taylor_adaptive<double>{{prime(x) = v, prime(v) = -9.8 * sin(x) - 0.1 * v}, {0.05, 0.025}};
+
+    ta.propagate_until(5.);
+    ta_undamped.propagate_until(5.);
+
+    REQUIRE(ta.get_state()[0] == approximately(ta_undamped.get_state()[0], 1000.));
+    REQUIRE(ta.get_state()[1] == approximately(ta_undamped.get_state()[1], 1000.));
+
+    // Switch the term on.
+    ta.set_time(0.);
+    ta.get_state_data()[0] = 0.05;
+    ta.get_state_data()[1] = 0.025;
+    ta.get_pars_data()[1] = 1.;
+
+    ta.propagate_until(5.);
+    ta_damped.propagate_until(5.);
+
+    REQUIRE(ta.get_state()[0] == approximately(ta_damped.get_state()[0], 1000.));
+    REQUIRE(ta.get_state()[1] == approximately(ta_damped.get_state()[1], 1000.));
+}
+
+TEST_CASE("shared decomposition")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    auto ta = taylor_adaptive<double>{{prime(x) = v, prime(v) = -9.8 * sin(x)}, {0.05, 0.025}};
+    auto ta_copy = ta;
+
+    // The copies share the decomposition.
+    REQUIRE(&ta_copy.get_decomposition() == &ta.get_decomposition());
+
+    // Dropping the decomposition in a copy
+    // does not affect the other copies.
+    ta_copy.drop_decomposition();
+    REQUIRE(ta_copy.get_decomposition().empty());
+    REQUIRE(!ta.get_decomposition().empty());
+
+    auto tab = taylor_adaptive_batch<double>{{prime(x) = v, prime(v) = -9.8 * sin(x)}, {0.05, 0.06, 0.025, 0.026}, 2};
+    auto tab_copy = tab;
+
+    REQUIRE(&tab_copy.get_decomposition() == &tab.get_decomposition());
+    REQUIRE(tab_copy.get_llvm_state().get_ir() == tab.get_llvm_state().get_ir());
+}
+
+TEST_CASE("invariants")
+{
+    using Catch::Matchers::Message;
+
+    auto [x, v] = make_vars("x", "v");
+
+    // Pendulum, with the energy and the (non-conserved) velocity as invariants.
+    auto ta = taylor_adaptive<double>{{prime(x) = v, prime(v) = -par[0] * sin(x)}, {0.05, 0.025}, kw::pars = {9.8}};
+    const auto energy = v * v / 2_dbl + par[0] * (1_dbl - cos(x));
+
+    REQUIRE(!ta.invariants_enabled());
+    REQUIRE_THROWS_MATCHES(ta.get_invariants(), std::invalid_argument,
+                           Message("Cannot fetch the invariants of an adaptive Taylor integrator if their "
+                                   "monitoring has not been enabled"));
+
+    ta.enable_invariants({energy, v}, 3);
+    REQUIRE(ta.invariants_enabled());
+    REQUIRE(ta.get_invariants().ref.size() == 2u);
+    REQUIRE(ta.get_invariants().ref[0] == approximately(0.025 * 0.025 / 2 + 9.8 * (1 - std::cos(0.05))));
+    REQUIRE(ta.get_invariants().ref[1] == 0.025);
+    REQUIRE(ta.get_invariants().times.empty());
+    REQUIRE(ta.get_invariants().max_drift == std::vector{0., 0.});
+
+    const auto res = ta.propagate_until(10.);
+    REQUIRE(std::get<0>(res) == taylor_outcome::time_limit);
+
+    const auto inv = ta.get_invariants();
+    REQUIRE(inv.times.size() == std::get<3>(res) / 3u);
+    REQUIRE(inv.drifts.size() == 2u * inv.times.size());
+    REQUIRE(std::is_sorted(inv.times.begin(), inv.times.end()));
+
+    // The energy is conserved, the velocity is not.
+    REQUIRE(inv.max_drift[0] < 1e-14);
+    REQUIRE(inv.max_drift[1] > 0.01);
+    for (decltype(inv.times.size()) i = 0; i < inv.times.size(); ++i) {
+        REQUIRE(std::abs(inv.drifts[2u * i]) <= inv.max_drift[0]);
+    }
+
+    // The last evaluation is consistent with the state.
+    if (std::get<3>(res) % 3u == 0u) {
+        REQUIRE(inv.times.back() == 10.);
+        REQUIRE(inv.drifts.back() + inv.ref[1] == approximately(ta.get_state()[1]));
+    }
+
+    // Copy semantics.
+    auto ta_copy = ta;
+    REQUIRE(ta_copy.invariants_enabled());
+    REQUIRE(ta_copy.get_invariants().times == inv.times);
+
+    // Reset.
+    ta.reset_invariants();
+    REQUIRE(ta.get_invariants().times.empty());
+    REQUIRE(ta.get_invariants().ref[1] == ta.get_state()[1]);
+
+    ta.disable_invariants();
+    REQUIRE(!ta.invariants_enabled());
+    REQUIRE(ta_copy.invariants_enabled());
+
+    // Error checking.
+    REQUIRE_THROWS_MATCHES(ta.enable_invariants({}), std::invalid_argument,
+                           Message("The list of the invariants monitored by an adaptive Taylor integrator cannot "
+                                   "be empty"));
+    REQUIRE_THROWS_MATCHES(ta.enable_invariants({energy}, 0), std::invalid_argument,
+                           Message("The number of steps between the evaluations of the invariants monitored by an "
+                                   "adaptive Taylor integrator cannot be zero"));
+    REQUIRE_THROWS_MATCHES(ta.enable_invariants({par[1] * x}), std::invalid_argument,
+                           Message("The invariants monitored by an adaptive Taylor integrator depend on 2 "
+                                   "parameter(s), but the integrator has only 1 parameter(s)"));
+    REQUIRE_THROWS_AS(ta.enable_invariants({"y"_var}), std::invalid_argument);
+
+    ta.drop_decomposition();
+    REQUIRE_THROWS_MATCHES(ta.enable_invariants({energy}), std::invalid_argument,
+                           Message("The monitoring of the invariants of an adaptive Taylor integrator requires the "
+                                   "Taylor decomposition, which was dropped"));
+}
+
+TEST_CASE("optimise async")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    for (auto cm : {false, true}) {
+        auto ta = taylor_adaptive<double>{
+            {prime(x) = v, prime(v) = -9.8 * sin(x)}, {0.05, 0.025}, kw::compact_mode = cm, kw::opt_level = 0u};
+        auto ta_ref = taylor_adaptive<double>{{prime(x) = v, prime(v) = -9.8 * sin(x)}, {0.05, 0.025},
+                                              kw::compact_mode = cm};
+
+        REQUIRE(!ta.optimise_pending());
+        REQUIRE(!ta.wait_optimise());
+
+        ta.optimise_async();
+        REQUIRE(ta.optimise_pending());
+
+        // The integrator can be used while the
+        // background compilation is running.
+        ta.propagate_until(1.);
+        ta.step();
+
+        ta.wait_optimise();
+        REQUIRE(!ta.optimise_pending());
+        REQUIRE(ta.get_llvm_state().opt_level() == 3u);
+        REQUIRE(ta.get_llvm_state().is_compiled());
+
+        ta.propagate_until(10.);
+        ta_ref.propagate_until(10.);
+
+        REQUIRE(ta.get_state()[0] == approximately(ta_ref.get_state()[0], 1000.));
+        REQUIRE(ta.get_state()[1] == approximately(ta_ref.get_state()[1], 1000.));
+
+        // A pending background compilation
+        // is not copied.
+        ta.optimise_async(2);
+        auto ta_copy = ta;
+        REQUIRE(!ta_copy.optimise_pending());
+        REQUIRE(ta_copy.get_llvm_state().opt_level() == 3u);
+    }
+}
+
+TEST_CASE("compact mode auto")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    // No automatic selection.
+    auto ta = taylor_adaptive<double>{{prime(x) = v, prime(v) = -9.8 * sin(x)}, {0.05, 0.025}};
+    REQUIRE(ta.get_llvm_state().stats().cm_estimate == 0u);
+
+    // Small system: default mode.
+    ta = taylor_adaptive<double>{
+        {prime(x) = v, prime(v) = -9.8 * sin(x)}, {0.05, 0.025}, kw::compact_mode = compact_mode_auto};
+    REQUIRE(ta.get_llvm_state().stats().cm_estimate > 0u);
+    REQUIRE(ta.get_llvm_state().stats().cm_estimate <= ta.get_llvm_state().stats().cm_threshold);
+    REQUIRE(!ta.get_llvm_state().stats().cm_selected);
+
+    const auto [oc, h] = ta.step();
+    REQUIRE(oc == taylor_outcome::success);
+
+    std::ostringstream oss;
+    oss << ta.get_llvm_state().stats();
+    REQUIRE(oss.str().find("Compact mode (auto) : off") != std::string::npos);
+
+    // Large system: compact mode.
+    std::vector<double> init_state;
+    for (auto i = 0; i < 20; ++i) {
+        init_state.insert(init_state.end(), {1. + i, 0., 0., 0., 1. / std::sqrt(1. + i), 0.});
+    }
+
+    auto tb = taylor_adaptive<double>{make_nbody_sys(20), init_state, kw::compact_mode = compact_mode_auto};
+    REQUIRE(tb.get_llvm_state().stats().cm_estimate > tb.get_llvm_state().stats().cm_threshold);
+    REQUIRE(tb.get_llvm_state().stats().cm_selected);
+
+    // Batch mode.
+    auto tc = taylor_adaptive_batch<double>{{prime(x) = v, prime(v) = -9.8 * sin(x)},
+                                            {0.05, 0.06, 0.025, 0.026},
+                                            2,
+                                            kw::compact_mode = compact_mode_auto};
+    REQUIRE(tc.get_llvm_state().stats().cm_estimate > 0u);
+    REQUIRE(!tc.get_llvm_state().stats().cm_selected);
+}
+
+TEST_CASE("step callback")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    const auto sys = std::vector{prime(x) = v, prime(v) = -9.8 * sin(x)};
+    const auto init_state = std::vector{0.05, 0.025};
+
+    for (auto cm : {false, true}) {
+        // NOTE: ta runs the propagate kernel, ta_loop the step-by-step loop.
+        auto ta = taylor_adaptive<double>{sys, init_state, kw::compact_mode = cm};
+        auto ta_loop = ta;
+        ta_loop.enable_stats();
+
+        for (auto *t : {&ta, &ta_loop}) {
+            // Count the steps and record the times.
+            std::vector<double> times;
+            auto res = t->propagate_until(10., 0, [&times](auto &tint) {
+                times.push_back(tint.get_time());
+                return true;
+            });
+
+            REQUIRE(std::get<0>(res) == taylor_outcome::time_limit);
+            REQUIRE(times.size() == std::get<3>(res));
+            REQUIRE(times.back() == 10.);
+            REQUIRE(std::is_sorted(times.begin(), times.end()));
+
+            // Stop after 3 steps.
+            auto n = 0;
+            res = t->propagate_for(10., 0, [&n](auto &) { return ++n < 3; });
+            REQUIRE(std::get<0>(res) == taylor_outcome::cb_stop);
+            REQUIRE(n == 3);
+            REQUIRE(std::get<3>(res) == 3u);
+            REQUIRE(t->get_time() < 20.);
+
+            // Stop when x becomes negative, via a raw function pointer.
+            auto stop_neg = [](void *p) { return static_cast<taylor_adaptive<double> *>(p)->get_state()[0] >= 0; };
+            res = t->propagate_until(100., 0, step_callback{+stop_neg, t});
+            REQUIRE(std::get<0>(res) == taylor_outcome::cb_stop);
+            REQUIRE(t->get_state()[0] < 0);
+
+            // Exceptions are propagated.
+            REQUIRE_THROWS_AS(t->propagate_for(10., 0,
+                                               [](auto &) -> bool {
+                                                   throw std::runtime_error("");
+                                               }),
+                              std::runtime_error);
+        }
+
+        REQUIRE(ta.get_time() == approximately(ta_loop.get_time()));
+        REQUIRE(ta.get_state()[0] == approximately(ta_loop.get_state()[0]));
+    }
+
+    // Batch mode.
+    auto tb = taylor_adaptive_batch<double>{sys, {0.05, 0.06, 0.025, 0.026}, 2};
+
+    auto n = 0;
+    const auto &res = tb.propagate_until({10., 1e-3}, 0, [&n](auto &) { return ++n < 2; });
+    REQUIRE(n == 2);
+    REQUIRE(std::get<0>(res[0]) == taylor_outcome::cb_stop);
+    REQUIRE(std::get<0>(res[1]) == taylor_outcome::time_limit);
+    REQUIRE(tb.get_time()[1] == 1e-3);
+
+    std::ostringstream oss;
+    oss << taylor_outcome::cb_stop;
+    REQUIRE(oss.str() == "cb_stop");
+}
+
+TEST_CASE("order override")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    const auto sys = std::vector{prime(x) = v, prime(v) = -9.8 * sin(x)};
+    const auto init_state = std::vector{0.05, 0.025};
+
+    auto ta = taylor_adaptive<double>{sys, init_state};
+    REQUIRE(ta.get_order() == 20u);
+
+    for (auto cm : {false, true}) {
+        for (auto order : {12u, 28u}) {
+            auto ta_o = taylor_adaptive<double>{sys, init_state, kw::compact_mode = cm, kw::order = order};
+            REQUIRE(ta_o.get_order() == order);
+            REQUIRE(ta_o.get_orders().empty());
+
+            // The accuracy is preserved.
+            REQUIRE(std::get<0>(ta_o.propagate_until(10.)) == taylor_outcome::time_limit);
+            auto ta_c = ta;
+            REQUIRE(std::get<0>(ta_c.propagate_until(10.)) == taylor_outcome::time_limit);
+            REQUIRE(ta_o.get_state()[0] == approximately(ta_c.get_state()[0], 1000.));
+            REQUIRE(ta_o.get_state()[1] == approximately(ta_c.get_state()[1], 1000.));
+
+            auto tb = taylor_adaptive_batch<double>{
+                sys, {0.05, 0.06, 0.025, 0.026}, 2, kw::compact_mode = cm, kw::order = order};
+            REQUIRE(tb.get_order() == order);
+        }
+    }
+
+    REQUIRE_THROWS_AS((taylor_adaptive<double>{sys, init_state, kw::order = 1u}), std::invalid_argument);
+    REQUIRE_THROWS_AS((taylor_adaptive_batch<double>{sys, {0.05, 0.06, 0.025, 0.026}, 2, kw::order = 1}),
+                      std::invalid_argument);
+
+    // Selection of the order.
+    const auto ot = taylor_tune_order(sys, init_state, kw::tuning_orders = {8u, 14u, 20u}, kw::tuning_steps = 20);
+    REQUIRE(ot.orders == std::vector<std::uint32_t>{8, 14, 20});
+    REQUIRE(ot.steps_per_time.size() == 3u);
+    REQUIRE(ot.step_costs.size() == 3u);
+    // NOTE: higher orders take longer steps.
+    REQUIRE(ot.steps_per_time[0] > ot.steps_per_time[2]);
+    REQUIRE(std::find(ot.orders.begin(), ot.orders.end(), ot.order) != ot.orders.end());
+
+    const auto ot2 = taylor_tune_order(sys, init_state, kw::tol = 1e-10, kw::tuning_steps = 5);
+    REQUIRE(ot2.orders == std::vector<std::uint32_t>{5, 7, 9, 11, 13, 15, 17, 19, 21});
+
+    std::ostringstream oss;
+    oss << ot;
+    REQUIRE(oss.str().find("Recommended order: ") != std::string::npos);
+}
+
+TEST_CASE("mem hints")
+{
+    std::vector<double> init_state;
+    for (auto i = 0; i < 6; ++i) {
+        init_state.insert(init_state.end(), {1. + i, 0., 0., 0., 1. / std::sqrt(1. + i), 0.});
+    }
+
+    // The memory hints must not change the results.
+    for (auto jl : {taylor_jet_layout::order_major, taylor_jet_layout::var_major}) {
+        for (auto pm : {false, true}) {
+            auto ta0 = taylor_adaptive<double>{make_nbody_sys(6), init_state, kw::compact_mode = true,
+                                               kw::jet_layout = jl, kw::parallel_mode = pm};
+            auto ta1 = taylor_adaptive<double>{make_nbody_sys(6),   init_state, kw::compact_mode = true,
+                                               kw::jet_layout = jl, kw::parallel_mode = pm, kw::mem_hints = true};
+
+            for (auto i = 0; i < 20; ++i) {
+                ta0.step(true);
+                ta1.step(true);
+            }
+
+            REQUIRE(ta0.get_state() == ta1.get_state());
+            REQUIRE(ta0.get_tc() == ta1.get_tc());
+        }
+    }
+
+    // Batch mode.
+    std::vector<double> init_state_b;
+    for (auto x : init_state) {
+        init_state_b.insert(init_state_b.end(), {x, x});
+    }
+
+    auto tb0 = taylor_adaptive_batch<double>{make_nbody_sys(6), init_state_b, 2, kw::compact_mode = true};
+    auto tb1 = taylor_adaptive_batch<double>{make_nbody_sys(6), init_state_b, 2, kw::compact_mode = true,
+                                             kw::mem_hints = true};
+
+    for (auto i = 0; i < 20; ++i) {
+        tb0.step(true);
+        tb1.step(true);
+    }
+
+    REQUIRE(tb0.get_state() == tb1.get_state());
+    REQUIRE(tb0.get_tc() == tb1.get_tc());
+
+    // The hints are ignored in default mode.
+    auto tc = taylor_adaptive<double>{make_nbody_sys(2), {1., 0., 0., 0., 1., 0., -1., 0., 0., 0., -1., 0.},
+                                      kw::mem_hints = true};
+    REQUIRE(std::get<0>(tc.step()) == taylor_outcome::success);
+}
+
+TEST_CASE("compact mode const arrays")
+{
+    std::vector<double> init_state;
+    for (auto i = 0; i < 6; ++i) {
+        init_state.insert(init_state.end(), {1. + i, 0., 0., 0., 1. / std::sqrt(1. + i), 0.});
+    }
+
+    auto ta = taylor_adaptive<double>{make_nbody_sys(6), init_state, kw::compact_mode = true, kw::opt_level = 0u};
+
+    // The global read-only arrays in compact mode are interned and
+    // the index arrays are packed into narrower integer types.
+    std::istringstream iss(ta.get_llvm_state().get_ir());
+    std::set<std::string> inits;
+    std::size_t n_arrays = 0;
+    bool packed = false;
+    for (std::string line; std::getline(iss, line);) {
+        if (line.rfind("@heyoka.const_arr.", 0) != 0u) {
+            continue;
+        }
+
+        const auto pos = line.find(" constant [");
+        REQUIRE(pos != std::string::npos);
+
+        inits.insert(line.substr(pos, line.rfind(", align") - pos));
+        ++n_arrays;
+        packed = packed || line.find(" x i8] ") != std::string::npos;
+    }
+
+    REQUIRE(n_arrays > 0u);
+    REQUIRE(inits.size() == n_arrays);
+    REQUIRE(packed);
+
+    // Compare with the default mode.
+    auto tb = taylor_adaptive<double>{make_nbody_sys(6), init_state};
+
+    for (auto i = 0; i < 20; ++i) {
+        ta.step(true);
+        tb.step(true);
+    }
+
+    for (decltype(init_state.size()) i = 0; i < init_state.size(); ++i) {
+        REQUIRE(ta.get_state()[i] == approximately(tb.get_state()[i], 1000.));
+    }
+}
+
+TEST_CASE("stiffness detection")
+{
+    using Catch::Matchers::Message;
+
+    auto [x, v] = make_vars("x", "v");
+
+    // Stiff Van der Pol oscillator.
+    const auto mu = 1000.;
+    const auto vdp = std::vector{prime(x) = v, prime(v) = mu * (1_dbl - x * x) * v - x};
+
+    // Non-stiff pendulum.
+    const auto pend = std::vector{prime(x) = v, prime(v) = -9.8_dbl * sin(x)};
+
+    auto ta = taylor_adaptive<double>{vdp, {2., 0.}};
+    REQUIRE(!ta.stiffness_detection_enabled());
+    REQUIRE(ta.get_stiffness_ratio() == 0.);
+
+    ta.enable_stiffness_detection();
+    ta.enable_stats();
+    REQUIRE(ta.stiffness_detection_enabled());
+
+    const auto [oc, min_h, max_h, n_steps] = ta.propagate_until(10.);
+    REQUIRE(oc == taylor_outcome::stiff);
+    REQUIRE(n_steps >= 100u);
+    REQUIRE(ta.get_time() < 10.);
+    REQUIRE(ta.get_stiffness_ratio() > 1000.);
+    REQUIRE(ta.get_stats().n_stiff >= 100u);
+    REQUIRE(ta.get_stats().max_stiffness_ratio > 1000.);
+
+    // The propagation can be resumed.
+    REQUIRE(std::get<0>(ta.propagate_until(10.)) == taylor_outcome::stiff);
+
+    // The configuration is copied.
+    auto ta_copy = ta;
+    REQUIRE(ta_copy.stiffness_detection_enabled());
+
+    ta.disable_stiffness_detection();
+    REQUIRE(!ta.stiffness_detection_enabled());
+    REQUIRE(std::get<0>(ta.propagate_until(ta.get_time() + 1e-2)) == taylor_outcome::time_limit);
+
+    // propagate_grid().
+    ta_copy.enable_stiffness_detection(1000., 10);
+    const auto t0 = ta_copy.get_time();
+    const auto res = ta_copy.propagate_grid({t0, t0 + 1., t0 + 2.});
+    REQUIRE(std::get<0>(res) == taylor_outcome::stiff);
+    REQUIRE(std::get<4>(res).size() == 2u);
+
+    // The pendulum does not trigger the detection.
+    auto tp = taylor_adaptive<double>{pend, {0.05, 0.025}};
+    tp.enable_stiffness_detection(1000., 1);
+    REQUIRE(std::get<0>(tp.propagate_until(10.)) == taylor_outcome::time_limit);
+    REQUIRE(tp.get_stiffness_ratio() < 1000.);
+
+    // The invalid configurations.
+    REQUIRE_THROWS_AS(tp.enable_stiffness_detection(-1.), std::invalid_argument);
+    REQUIRE_THROWS_AS(tp.enable_stiffness_detection(std::numeric_limits<double>::infinity()), std::invalid_argument);
+    REQUIRE_THROWS_MATCHES(tp.enable_stiffness_detection(1000., 0), std::invalid_argument,
+                           Message("The number of consecutive steps for the stiffness detection must be nonzero"));
+
+    auto tv = taylor_adaptive<double>{pend, {0.05, 0.025}, kw::orders = std::vector<std::uint32_t>{10, 20}};
+    REQUIRE_THROWS_MATCHES(
+        tv.enable_stiffness_detection(), std::invalid_argument,
+        Message("The stiffness detection is not supported by the variable-order adaptive Taylor integrator"));
+
+    std::ostringstream oss;
+    oss << taylor_outcome::stiff;
+    REQUIRE(oss.str() == "stiff");
+}
+
+// The timestep deduced from the Taylor coefficients tc (in the layout of get_tc()) of
+// a step in the batch element idx, via the pow() formulation of the radius of convergence,
+// rhofac * min((num / max_o)**(1 / order), (num / max_om1)**(1 / (order - 1))).
+// NOTE: fmax()/fmin() discard the NaNs as the maxnum/minnum intrinsics.
+template <typename T>
+T pow_timestep(const std::vector<T> &tc, std::uint32_t n_eq, std::uint32_t order, std::uint32_t batch_size,
+               std::uint32_t idx, T rhofac)
+{
+    using std::abs;
+    using std::fmax;
+    using std::fmin;
+    using std::pow;
+
+    auto cf = [&](std::uint32_t i, std::uint32_t k) { return abs(tc[(i * (order + 1u) + k) * batch_size + idx]); };
+
+    auto max_abs_state = cf(0, 0), max_o = cf(0, order), max_om1 = cf(0, order - 1u);
+    for (std::uint32_t i = 1; i < n_eq; ++i) {
+        max_abs_state = fmax(max_abs_state, cf(i, 0));
+        max_o = fmax(max_o, cf(i, order));
+        max_om1 = fmax(max_om1, cf(i, order - 1u));
+    }
+
+    const auto num = max_abs_state <= 1 ? T(1) : max_abs_state;
+
+    return rhofac * fmin(pow(num / max_o, T(1) / order), pow(num / max_om1, T(1) / (order - 1u)));
+}
+
+TEST_CASE("timestep deduction")
+{
+    using std::exp;
+    using std::log;
+
+    auto [x, v] = make_vars("x", "v");
+
+    const auto pend = std::vector{prime(x) = v, prime(v) = -9.8 * sin(x)};
+
+    tuple_for_each(std::tuple<double, long double>{}, [&](auto fp_x) {
+        using fp_t = decltype(fp_x);
+
+        for (auto cm : {false, true}) {
+            // Scalar mode.
+            auto ta = taylor_adaptive<fp_t>{pend, {fp_t(0.05), fp_t(0.025)}, kw::compact_mode = cm};
+
+            const auto order = ta.get_order();
+            const auto rhofac = exp(fp_t(-7) / fp_t(10) / (order - 1u)) / (exp(fp_t(1)) * exp(fp_t(1)));
+
+            for (auto i = 0; i < 20; ++i) {
+                const auto [oc, h] = ta.step(true);
+                REQUIRE(oc == taylor_outcome::success);
+                REQUIRE(h == approximately(pow_timestep(ta.get_tc(), 2, order, 1, 0, rhofac), fp_t(1000)));
+            }
+
+            // Batch mode, with a large state in the second batch
+            // element (i.e., with the relative error control).
+            auto tb = taylor_adaptive_batch<fp_t>{
+                pend, {fp_t(0.05), fp_t(3), fp_t(0.025), fp_t(-20)}, 2, kw::compact_mode = cm};
+
+            for (auto i = 0; i < 20; ++i) {
+                const auto &res = tb.step(true);
+
+                for (std::uint32_t j = 0; j < 2u; ++j) {
+                    REQUIRE(std::get<0>(res[j]) == taylor_outcome::success);
+                    REQUIRE(std::get<1>(res[j])
+                            == approximately(pow_timestep(tb.get_tc(), 2, order, 2, j, rhofac), fp_t(1000)));
+                }
+            }
+
+            // Zero norm at the highest order: with the order override, the state
+            // is a polynomial of degree order - 1 and the radius of convergence
+            // is determined by the coefficients of order order - 1.
+            const auto tol = std::numeric_limits<fp_t>::epsilon();
+            auto tp = taylor_adaptive<fp_t>{{prime(x) = v, prime(v) = 1_dbl},
+                                            {fp_t(1), fp_t(0.5)},
+                                            kw::compact_mode = cm,
+                                            kw::order = 3u};
+
+            const auto rhofac_ovr = exp((log(tol) - fp_t(7) / fp_t(10)) / 2);
+            const auto [oc_p, h_p] = tp.step(true);
+            REQUIRE(oc_p == taylor_outcome::success);
+            REQUIRE(std::isfinite(h_p));
+            REQUIRE(h_p == approximately(pow_timestep(tp.get_tc(), 2, 3, 1, 0, rhofac_ovr), fp_t(1000)));
+
+            // Zero norms at both orders: infinite radius of convergence.
+            auto tz = taylor_adaptive<fp_t>{{prime(x) = 0_dbl, prime(v) = 0_dbl}, {fp_t(1), fp_t(2)},
+                                            kw::compact_mode = cm};
+            REQUIRE(std::isinf(pow_timestep(std::vector<fp_t>(2u * (tz.get_order() + 1u)), 2, tz.get_order(), 1, 0,
+                                       rhofac)));
+            const auto [oc_z, h_z] = tz.step(fp_t(1.5));
+            REQUIRE(oc_z == taylor_outcome::time_limit);
+            REQUIRE(h_z == fp_t(1.5));
+            REQUIRE(tz.get_state() == std::vector{fp_t(1), fp_t(2)});
+
+            // Infinite and NaN norms.
+            for (const auto bad : {std::numeric_limits<fp_t>::infinity(), std::numeric_limits<fp_t>::quiet_NaN()}) {
+                auto tn = taylor_adaptive<fp_t>{pend, {bad, fp_t(0.025)}, kw::compact_mode = cm};
+                REQUIRE(std::get<0>(tn.step()) == taylor_outcome::err_nf_state);
+            }
+        }
+    });
+}
+
+// Reference implementation of the batch propagate_until(), driving the
+// integrator via step() and doing the per-lane bookkeeping lane by lane.
+template <typename T>
+std::vector<std::tuple<taylor_outcome, T, T, std::size_t>>
+ref_batch_propagate_until(taylor_adaptive_batch<T> &tb, const std::vector<T> &ts, std::size_t max_steps)
+{
+    const auto batch_size = tb.get_batch_size();
+
+    std::vector<T> min_h(batch_size, std::numeric_limits<T>::infinity()), max_h(batch_size, T(0)),
+        max_delta_ts(batch_size);
+    std::vector<std::size_t> n_steps(batch_size);
+    std::vector<std::tuple<taylor_outcome, T>> res;
+    std::size_t iter_counter = 0;
+
+    while (true) {
+        for (std::uint32_t i = 0; i < batch_size; ++i) {
+            max_delta_ts[i] = (ts[i] - tb.get_dtime().first[i]) - tb.get_dtime().second[i];
+        }
+
+        res = tb.step(max_delta_ts);
+
+        if (std::any_of(res.begin(), res.end(), [](const auto &tup) {
+                return std::get<0>(tup) != taylor_outcome::success && std::get<0>(tup) != taylor_outcome::time_limit;
+            })) {
+            break;
+        }
+
+        ++iter_counter;
+
+        for (std::uint32_t i = 0; i < batch_size; ++i) {
+            n_steps[i] += static_cast<std::size_t>(std::get<1>(res[i]) != 0);
+        }
+
+        if (std::all_of(res.begin(), res.end(),
+                        [](const auto &tup) { return std::get<0>(tup) == taylor_outcome::time_limit; })) {
+            break;
+        }
+
+        for (std::uint32_t i = 0; i < batch_size; ++i) {
+            if (std::get<0>(res[i]) != taylor_outcome::time_limit) {
+                min_h[i] = std::min(min_h[i], std::abs(std::get<1>(res[i])));
+                max_h[i] = std::max(max_h[i], std::abs(std::get<1>(res[i])));
+            }
+        }
+
+        if (max_steps != 0u && iter_counter == max_steps) {
+            break;
+        }
+    }
+
+    const auto step_limit = max_steps != 0u && iter_counter == max_steps;
+
+    std::vector<std::tuple<taylor_outcome, T, T, std::size_t>> retval;
+    for (std::uint32_t i = 0; i < batch_size; ++i) {
+        auto oc = std::get<0>(res[i]);
+        if (step_limit) {
+            oc = oc == taylor_outcome::success ? taylor_outcome::step_limit : taylor_outcome::time_limit;
+        }
+
+        retval.emplace_back(oc, min_h[i], max_h[i], n_steps[i]);
+    }
+
+    return retval;
+}
+
+// The bookkeeping of the batch propagate_until() on a batch mixing error,
+// time limit and success outcomes, and on the step limit and time limit exits.
+TEST_CASE("batch propagate_until bookkeeping")
+{
+    auto [x] = make_vars("x");
+
+    for (auto cm : {false, true}) {
+        // The exponential growth x' = p0 * x.
+        auto tb_init = taylor_adaptive_batch<double>{
+            {prime(x) = par[0] * x}, {1., 1., 1., 1.}, 4, kw::compact_mode = cm, kw::pars = {1., 1., -.5, .25}};
+
+        // Compare propagate_until() with the reference implementation,
+        // starting from a copy of tb_init.
+        auto check = [&tb_init](const std::vector<double> &ts, std::size_t max_steps) {
+            auto tb = tb_init, tb_ref = tb_init;
+
+            const auto res = tb.propagate_until(ts, max_steps);
+            const auto res_ref = ref_batch_propagate_until(tb_ref, ts, max_steps);
+
+            REQUIRE(res == res_ref);
+            REQUIRE(tb.get_state() == tb_ref.get_state());
+            REQUIRE(tb.get_time() == tb_ref.get_time());
+
+            return res;
+        };
+
+        // Step limit exit.
+        auto res = check({100., .5, 100., 100.}, 5);
+        REQUIRE(std::get<0>(res[0]) == taylor_outcome::step_limit);
+        REQUIRE(std::get<0>(res[1]) == taylor_outcome::time_limit);
+        REQUIRE(std::get<0>(res[2]) == taylor_outcome::step_limit);
+        REQUIRE(std::get<0>(res[3]) == taylor_outcome::step_limit);
+        REQUIRE(std::get<3>(res[0]) == 5u);
+        REQUIRE(std::get<3>(res[1]) < 5u);
+        REQUIRE(std::get<1>(res[0]) <= std::get<2>(res[0]));
+
+        // Time limit exit for all the batch elements.
+        res = check({1., 2., .5, 1.5}, 0);
+        for (const auto &r : res) {
+            REQUIRE(std::get<0>(r) == taylor_outcome::time_limit);
+            REQUIRE(std::get<3>(r) > 0u);
+        }
+
+        // Error exit: the first batch element overflows after a few steps,
+        // the second one reaches its time limit early on, the last two
+        // are still integrating when the overflow happens.
+        tb_init.get_state_data()[0] = 1e300;
+
+        res = check({1000., .5, 1000., 1000.}, 0);
+        REQUIRE(std::get<0>(res[0]) == taylor_outcome::err_nf_state);
+        REQUIRE(std::get<0>(res[1]) == taylor_outcome::time_limit);
+        REQUIRE(std::get<0>(res[2]) == taylor_outcome::success);
+        REQUIRE(std::get<0>(res[3]) == taylor_outcome::success);
+        // NOTE: the step which produced the error is
+        // not accounted for in the step counters.
+        REQUIRE(std::get<3>(res[0]) > 1u);
+        REQUIRE(std::get<3>(res[0]) == std::get<3>(res[2]));
+        REQUIRE(std::get<3>(res[1]) < std::get<3>(res[2]));
+        REQUIRE(std::get<1>(res[2]) <= std::get<2>(res[2]));
+    }
+}
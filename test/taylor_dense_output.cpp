@@ -0,0 +1,141 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <initializer_list>
+#include <limits>
+#include <stdexcept>
+#include <tuple>
+#include <vector>
+
+#include <heyoka/expression.hpp>
+#include <heyoka/math/sin.hpp>
+#include <heyoka/taylor.hpp>
+
+#include "catch.hpp"
+#include "test_utils.hpp"
+
+using namespace heyoka;
+using namespace heyoka_test;
+
+TEST_CASE("taylor dense output scalar")
+{
+    for (auto opt_level : {0u, 3u}) {
+        for (auto cm : {false, true}) {
+            for (auto ha : {false, true}) {
+                auto [x, v] = make_vars("x", "v");
+
+                auto ta = taylor_adaptive<double>{{prime(x) = v, prime(v) = -9.8 * sin(x)},
+                                                  {0.05, 0.025},
+                                                  kw::high_accuracy = ha,
+                                                  kw::compact_mode = cm,
+                                                  kw::opt_level = opt_level};
+
+                REQUIRE(ta.get_d_output().size() == 2u);
+                REQUIRE(ta.get_last_h() == 0.);
+
+                // Forward step.
+                auto old_state = ta.get_state();
+                auto old_time = ta.get_time();
+                auto [oc, h] = ta.step(true);
+                REQUIRE(ta.get_last_h() == h);
+
+                ta.update_d_output(old_time);
+                REQUIRE(ta.get_d_output()[0] == approximately(old_state[0], 1000.));
+                REQUIRE(ta.get_d_output()[1] == approximately(old_state[1], 1000.));
+
+                ta.update_d_output(ta.get_time());
+                REQUIRE(ta.get_d_output()[0] == approximately(ta.get_state()[0], 1000.));
+                REQUIRE(ta.get_d_output()[1] == approximately(ta.get_state()[1], 1000.));
+
+                // Compare the dense output at mid-step with a second
+                // integrator stepping for half the timestep.
+                auto ta_half = taylor_adaptive<double>{{prime(x) = v, prime(v) = -9.8 * sin(x)},
+                                                       old_state,
+                                                       kw::time = old_time,
+                                                       kw::high_accuracy = ha,
+                                                       kw::compact_mode = cm,
+                                                       kw::opt_level = opt_level};
+                ta_half.step(h / 2);
+
+                ta.update_d_output(old_time + h / 2);
+                REQUIRE(ta.get_d_output()[0] == approximately(ta_half.get_state()[0], 1000.));
+                REQUIRE(ta.get_d_output()[1] == approximately(ta_half.get_state()[1], 1000.));
+
+                // Backward step.
+                old_state = ta.get_state();
+                old_time = ta.get_time();
+                std::tie(oc, h) = ta.step_backward(true);
+                REQUIRE(h < 0);
+
+                ta.update_d_output(old_time);
+                REQUIRE(ta.get_d_output()[0] == approximately(old_state[0], 1000.));
+                REQUIRE(ta.get_d_output()[1] == approximately(old_state[1], 1000.));
+
+                ta.update_d_output(ta.get_time());
+                REQUIRE(ta.get_d_output()[0] == approximately(ta.get_state()[0], 1000.));
+                REQUIRE(ta.get_d_output()[1] == approximately(ta.get_state()[1], 1000.));
+
+                // Copy semantics.
+                auto ta_copy = ta;
+                ta_copy.update_d_output(old_time);
+                REQUIRE(ta_copy.get_d_output()[0] == approximately(old_state[0], 1000.));
+                REQUIRE(ta_copy.get_d_output()[1] == approximately(old_state[1], 1000.));
+
+                // Error handling.
+                REQUIRE_THROWS_AS(ta.update_d_output(std::numeric_limits<double>::infinity()), std::invalid_argument);
+            }
+        }
+    }
+}
+
+TEST_CASE("taylor dense output batch")
+{
+    for (auto batch_size : {1u, 4u, 23u}) {
+        for (auto cm : {false, true}) {
+            for (auto ha : {false, true}) {
+                auto [x, v] = make_vars("x", "v");
+
+                std::vector<double> init_state;
+                for (auto i = 0u; i < batch_size; ++i) {
+                    init_state.push_back(0.05 + i / 100.);
+                }
+                for (auto i = 0u; i < batch_size; ++i) {
+                    init_state.push_back(0.025 + i / 1000.);
+                }
+
+                auto ta = taylor_adaptive_batch<double>{{prime(x) = v, prime(v) = -9.8 * sin(x)},
+                                                        init_state,
+                                                        batch_size,
+                                                        kw::high_accuracy = ha,
+                                                        kw::compact_mode = cm};
+
+                REQUIRE(ta.get_d_output().size() == 2u * batch_size);
+                REQUIRE(ta.get_last_h().size() == batch_size);
+
+                const auto old_time = ta.get_time();
+                ta.step(true);
+
+                ta.update_d_output(old_time);
+                for (auto i = 0u; i < 2u * batch_size; ++i) {
+                    REQUIRE(ta.get_d_output()[i] == approximately(init_state[i], 1000.));
+                }
+
+                ta.update_d_output(ta.get_time());
+                for (auto i = 0u; i < 2u * batch_size; ++i) {
+                    REQUIRE(ta.get_d_output()[i] == approximately(ta.get_state()[i], 1000.));
+                }
+
+                // Error handling.
+                REQUIRE_THROWS_AS(ta.update_d_output(std::vector<double>(batch_size + 1u)), std::invalid_argument);
+                auto bad_t = old_time;
+                bad_t[0] = std::numeric_limits<double>::quiet_NaN();
+                REQUIRE_THROWS_AS(ta.update_d_output(bad_t), std::invalid_argument);
+            }
+        }
+    }
+}
@@ -0,0 +1,168 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <heyoka/config.hpp>
+
+#include <cstdint>
+#include <initializer_list>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <heyoka/expression.hpp>
+#include <heyoka/llvm_state.hpp>
+#include <heyoka/math/dot.hpp>
+#include <heyoka/math/sigmoid.hpp>
+#include <heyoka/number.hpp>
+#include <heyoka/taylor.hpp>
+
+#include "catch.hpp"
+#include "test_utils.hpp"
+
+static std::mt19937 rng;
+
+using namespace heyoka;
+using namespace heyoka_test;
+
+const auto fp_types = std::tuple<double, long double
+#if defined(HEYOKA_HAVE_REAL128)
+                                 ,
+                                 mppp::real128
+#endif
+                                 >{};
+
+TEST_CASE("dot basic")
+{
+    using Catch::Matchers::Message;
+
+    auto [x, y] = make_vars("x", "y");
+
+    REQUIRE(dot({}, {}) == 0_dbl);
+
+    std::ostringstream oss;
+    oss << dot({par[0], par[1]}, {x, y});
+    REQUIRE(oss.str() == "dot(p0, x, p1, y)");
+
+    REQUIRE(diff(dot({par[0], 2_dbl}, {x * y, y}), "x") == dot({par[0], 2_dbl}, {diff(x * y, "x"), 0_dbl}));
+
+    REQUIRE_THROWS_MATCHES(dot({par[0]}, {x, y}), std::invalid_argument,
+                           Message("The number of coefficients (1) and the number of terms (2) of a dot product "
+                                   "must be equal"));
+    REQUIRE_THROWS_MATCHES(dot({x}, {y}), std::invalid_argument,
+                           Message("The coefficients of a dot product must be numbers or params"));
+
+    // Dense layers.
+    const auto out = dense_layer({x, y}, 2, 1, [](expression e) { return sigmoid(std::move(e)); });
+    REQUIRE(out.size() == 2u);
+    REQUIRE(out[0] == sigmoid(dot({par[1], par[2], par[3]}, {x, y, 1_dbl})));
+    REQUIRE(out[1] == sigmoid(dot({par[4], par[5], par[6]}, {x, y, 1_dbl})));
+
+    REQUIRE(dense_layer({x}, 1, 0) == std::vector{dot({par[0], par[1]}, {x, 1_dbl})});
+    REQUIRE(dense_layer({x}, 0, 0).empty());
+
+    REQUIRE_THROWS_MATCHES(dense_layer({}, 1, 0), std::invalid_argument,
+                           Message("A dense layer must have at least one input"));
+    REQUIRE_THROWS_AS(dense_layer({x}, 1, 4294967295u), std::overflow_error);
+}
+
+// Compare the jets of the systems sys and sys_ref, which are
+// expected to be mathematically equivalent.
+template <typename T>
+void compare_jets(const std::vector<expression> &sys, const std::vector<expression> &sys_ref, unsigned n_pars,
+                  unsigned opt_level, bool high_accuracy, bool compact_mode)
+{
+    const auto order = 5u;
+
+    for (auto batch_size : {1u, 2u, 4u}) {
+        llvm_state s{kw::opt_level = opt_level};
+
+        taylor_add_jet<T>(s, "jet", sys, order, batch_size, high_accuracy, compact_mode);
+        taylor_add_jet<T>(s, "jet_ref", sys_ref, order, batch_size, high_accuracy, compact_mode);
+
+        s.compile();
+
+        auto jptr = reinterpret_cast<void (*)(T *, const T *, const T *)>(s.jit_lookup("jet"));
+        auto jptr_ref = reinterpret_cast<void (*)(T *, const T *, const T *)>(s.jit_lookup("jet_ref"));
+
+        std::uniform_real_distribution<float> dist(-1.f, 1.f);
+
+        std::vector<T> jet((order + 1u) * 2u * batch_size), pars(n_pars * batch_size);
+        for (auto i = 0u; i < 2u * batch_size; ++i) {
+            jet[i] = T{dist(rng)};
+        }
+        for (auto &p : pars) {
+            p = T{dist(rng)};
+        }
+        auto jet_ref = jet;
+
+        jptr(jet.data(), pars.data(), nullptr);
+        jptr_ref(jet_ref.data(), pars.data(), nullptr);
+
+        for (decltype(jet.size()) i = 0; i < jet.size(); ++i) {
+            REQUIRE(jet[i] == approximately(jet_ref[i], T(1000)));
+        }
+    }
+}
+
+TEST_CASE("taylor dot")
+{
+    auto tester = [](auto fp_x, unsigned opt_level, bool high_accuracy, bool compact_mode) {
+        using fp_t = decltype(fp_x);
+
+        auto [x, y] = make_vars("x", "y");
+
+        // Mixed coefficients and terms.
+        compare_jets<fp_t>({dot({par[0], 2_dbl, par[1]}, {x, y, 3_dbl}), dot({par[1], par[0]}, {y * x, par[2]})},
+                           {par[0] * x + 2_dbl * y + par[1] * 3_dbl, par[1] * (y * x) + par[0] * par[2]}, 3,
+                           opt_level, high_accuracy, compact_mode);
+
+        // Repeated terms and dot products of numbers/params only.
+        compare_jets<fp_t>({dot({par[0], par[1]}, {x, x}), dot({2_dbl}, {par[0]})},
+                           {par[0] * x + par[1] * x, 2_dbl * par[0]}, 2, opt_level, high_accuracy, compact_mode);
+
+        // Dense layers.
+        const auto act = [](expression e) { return sigmoid(std::move(e)); };
+        const auto hidden = dense_layer({x, y}, 3, 0, act);
+        const auto out = dense_layer(hidden, 2, 9);
+
+        const auto ref_layer = [](const std::vector<expression> &in, std::uint32_t n_out, std::uint32_t offset,
+                                  bool with_act) {
+            std::vector<expression> ret;
+            for (std::uint32_t i = 0; i < n_out; ++i) {
+                const auto off = offset + i * static_cast<std::uint32_t>(in.size() + 1u);
+
+                auto acc = par[off + static_cast<std::uint32_t>(in.size())];
+                for (std::uint32_t j = 0; j < in.size(); ++j) {
+                    acc += par[off + j] * in[j];
+                }
+
+                ret.push_back(with_act ? sigmoid(acc) : acc);
+            }
+            return ret;
+        };
+        const auto out_ref = ref_layer(ref_layer({x, y}, 3, 0, true), 2, 9, false);
+
+        compare_jets<fp_t>(out, out_ref, 17, opt_level, high_accuracy, compact_mode);
+    };
+
+    for (auto cm : {false, true}) {
+        for (auto f : {false, true}) {
+            tuple_for_each(fp_types, [&tester, f, cm](auto x) { tester(x, 0, f, cm); });
+            tuple_for_each(fp_types, [&tester, f, cm](auto x) { tester(x, 3, f, cm); });
+        }
+    }
+}
@@ -0,0 +1,165 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <cmath>
+#include <initializer_list>
+#include <sstream>
+#include <stdexcept>
+#include <variant>
+#include <vector>
+
+#include <heyoka/expression.hpp>
+#include <heyoka/func.hpp>
+#include <heyoka/math/ephem.hpp>
+#include <heyoka/math/sin.hpp>
+#include <heyoka/math/tharm.hpp>
+#include <heyoka/math/time.hpp>
+#include <heyoka/taylor.hpp>
+#include <heyoka/taylor_traj.hpp>
+
+#include "catch.hpp"
+#include "test_utils.hpp"
+
+using namespace heyoka;
+using namespace heyoka_test;
+
+TEST_CASE("taylor ephem")
+{
+    using std::cos;
+    using std::sin;
+
+    auto [x, v, y] = make_vars("x", "v", "y");
+
+    // The trajectory of the harmonic oscillator
+    // x(t) = cos(t), v(t) = -sin(t).
+    auto ta_ho = taylor_adaptive<double>{{prime(x) = v, prime(v) = -x}, {1., 0.}};
+    ta_ho.enable_checkpoints();
+    ta_ho.propagate_until(10.);
+
+    const auto eph = ephem(taylor_cheb_traj<double>(ta_ho.get_checkpoints(), 1e-15));
+    REQUIRE(eph.size() == 2u);
+    REQUIRE(eph[0] != eph[1]);
+
+    std::ostringstream oss;
+    oss << eph[0];
+    REQUIRE(oss.str().find("(t)") != std::string::npos);
+
+    REQUIRE(diff(eph[0], "x") == 0_dbl);
+
+    for (auto cm : {false, true}) {
+        // y' = x(t) + v(t), hence y(t) = sin(t) + cos(t) - 1.
+        auto ta = taylor_adaptive<double>{{prime(y) = eph[0] + eph[1]}, {0.}, kw::compact_mode = cm};
+
+        REQUIRE(std::get<0>(ta.propagate_until(10.)) == taylor_outcome::time_limit);
+        REQUIRE(ta.get_state()[0] == approximately(sin(10.) + cos(10.) - 1., 10000.));
+
+        // Outside the time range of the
+        // trajectory, the state becomes NaN.
+        REQUIRE(std::get<0>(ta.propagate_until(11.)) == taylor_outcome::err_nf_state);
+    }
+
+    // Batch mode.
+    for (auto cm : {false, true}) {
+        auto ta = taylor_adaptive_batch<double>{{prime(y) = eph[0]}, {0., 0.}, 2, kw::compact_mode = cm};
+        ta.set_time({1., 2.});
+
+        ta.propagate_until({5., 8.});
+        REQUIRE(ta.get_state()[0] == approximately(sin(5.) - sin(1.), 10000.));
+        REQUIRE(ta.get_state()[1] == approximately(sin(8.) - sin(2.), 10000.));
+    }
+
+    // Type mismatch.
+    REQUIRE_THROWS_AS((taylor_adaptive<long double>{{prime(y) = eph[0]}, {0.l}}), std::invalid_argument);
+
+    // Empty trajectory.
+    REQUIRE_THROWS_AS(ephem(taylor_cheb_traj<double>(2, 10, 1e-10)), std::invalid_argument);
+}
+
+// The functions depending explicitly on time must not be treated as
+// constants when their arguments are numbers/params (which would
+// zero out their Taylor derivatives of order greater than zero).
+TEST_CASE("taylor time dependent funcs")
+{
+    using std::cos;
+    using std::sin;
+
+    auto [x, v, y, z, w] = make_vars("x", "v", "y", "z", "w");
+
+    auto ta_ho = taylor_adaptive<double>{{prime(x) = v, prime(v) = -x}, {1., 0.}};
+    ta_ho.enable_checkpoints();
+    ta_ho.propagate_until(10.);
+
+    const auto eph = ephem(taylor_cheb_traj<double>(ta_ho.get_checkpoints(), 1e-15));
+
+    REQUIRE(std::get<func>(tsin(par[0], par[1]).value()).is_time_dependent());
+    REQUIRE(std::get<func>(tcos(2_dbl).value()).is_time_dependent());
+    REQUIRE(std::get<func>(eph[0].value()).is_time_dependent());
+    REQUIRE(std::get<func>(heyoka::time.value()).is_time_dependent());
+    REQUIRE(!std::get<func>(sin(x).value()).is_time_dependent());
+
+    for (auto cm : {false, true}) {
+        auto ta = taylor_adaptive<double>{{prime(y) = tsin(par[0], par[1]), prime(z) = tcos(2_dbl), prime(w) = eph[1]},
+                                          {0., 0., 0.},
+                                          kw::compact_mode = cm,
+                                          kw::pars = {1.5, .5}};
+
+        REQUIRE(std::get<0>(ta.propagate_until(8.)) == taylor_outcome::time_limit);
+
+        // y(t) = (cos(phi) - cos(omega * t + phi)) / omega,
+        // z(t) = sin(2 * t) / 2, w(t) = cos(t) - 1.
+        REQUIRE(ta.get_state()[0] == approximately((cos(.5) - cos(1.5 * 8. + .5)) / 1.5, 10000.));
+        REQUIRE(ta.get_state()[1] == approximately(sin(16.) / 2., 10000.));
+        REQUIRE(ta.get_state()[2] == approximately(cos(8.) - 1., 10000.));
+    }
+}
+
+// The compiled code of the integrators embeds the addresses of the
+// trajectories, which must outlive both the system and the decomposition.
+TEST_CASE("taylor ephem drop decomposition")
+{
+    using std::cos;
+
+    auto [x, v, w] = make_vars("x", "v", "w");
+
+    auto ta_ho = taylor_adaptive<double>{{prime(x) = v, prime(v) = -x}, {1., 0.}};
+    ta_ho.enable_checkpoints();
+    ta_ho.propagate_until(10.);
+
+    for (auto cm : {false, true}) {
+        auto ta = [&]() {
+            const auto eph = ephem(taylor_cheb_traj<double>(ta_ho.get_checkpoints(), 1e-15));
+
+            auto ret = taylor_adaptive<double>{{prime(w) = eph[1]}, {0.}, kw::compact_mode = cm};
+            ret.drop_decomposition();
+
+            return ret;
+        }();
+
+        auto ta_copy = ta;
+
+        REQUIRE(std::get<0>(ta.propagate_until(8.)) == taylor_outcome::time_limit);
+        REQUIRE(ta.get_state()[0] == approximately(cos(8.) - 1., 10000.));
+
+        REQUIRE(std::get<0>(ta_copy.propagate_until(8.)) == taylor_outcome::time_limit);
+        REQUIRE(ta_copy.get_state()[0] == approximately(cos(8.) - 1., 10000.));
+
+        auto tab = [&]() {
+            const auto eph = ephem(taylor_cheb_traj<double>(ta_ho.get_checkpoints(), 1e-15));
+
+            auto ret = taylor_adaptive_batch<double>{{prime(w) = eph[1]}, {0., 0.}, 2u, kw::compact_mode = cm};
+            ret.drop_decomposition();
+
+            return ret;
+        }();
+
+        tab.propagate_until({8., 4.});
+
+        REQUIRE(tab.get_state()[0] == approximately(cos(8.) - 1., 10000.));
+        REQUIRE(tab.get_state()[1] == approximately(cos(4.) - 1., 10000.));
+    }
+}
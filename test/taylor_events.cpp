@@ -0,0 +1,282 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <cmath>
+#include <initializer_list>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <tuple>
+#include <vector>
+
+#include <heyoka/expression.hpp>
+#include <heyoka/math/cos.hpp>
+#include <heyoka/math/sin.hpp>
+#include <heyoka/math/time.hpp>
+#include <heyoka/taylor.hpp>
+
+#include "catch.hpp"
+#include "test_utils.hpp"
+
+using namespace heyoka;
+using namespace heyoka_test;
+
+TEST_CASE("taylor decompose sv funcs")
+{
+    auto [x, y] = make_vars("x", "y");
+
+    auto [dc, sv_dc] = taylor_decompose({prime(x) = y, prime(y) = -sin(x)}, {y, cos(x) * y, sin(x)});
+
+    REQUIRE(sv_dc.size() == 3u);
+
+    // A state variable maps directly to its index.
+    REQUIRE(sv_dc[0] == 1u);
+
+    // The other functions are represented by u variables which are not state variables.
+    REQUIRE(sv_dc[1] >= 2u);
+    REQUIRE(sv_dc[1] < dc.size() - 2u);
+    REQUIRE(sv_dc[2] >= 2u);
+    REQUIRE(sv_dc[2] < dc.size() - 2u);
+
+    // The indices point to the definitions of the functions.
+    REQUIRE(dc[sv_dc[2]].first == sin("u_0"_var));
+
+    // Error modes.
+    REQUIRE_THROWS_AS(taylor_decompose({prime(x) = y, prime(y) = -sin(x)}, {"z"_var}), std::invalid_argument);
+    REQUIRE_THROWS_AS(taylor_decompose({prime(x) = y, prime(y) = -sin(x)}, {expression{1.}}), std::invalid_argument);
+    REQUIRE_THROWS_AS(taylor_decompose({prime(x) = y, prime(y) = -sin(x)}, {par[0]}), std::invalid_argument);
+}
+
+TEST_CASE("taylor nt event")
+{
+    using ev_t = taylor_adaptive<double>::nt_event_t;
+
+    for (auto opt_level : {0u, 3u}) {
+        for (auto cm : {false, true}) {
+            for (auto ha : {false, true}) {
+                auto [x, v] = make_vars("x", "v");
+
+                // Record the times at which the velocity is zero.
+                std::vector<double> times;
+
+                auto ta = taylor_adaptive<double>{
+                    {prime(x) = v, prime(v) = -9.8 * sin(x)},
+                    {0.05, 0.025},
+                    kw::high_accuracy = ha,
+                    kw::compact_mode = cm,
+                    kw::opt_level = opt_level,
+                    kw::nt_events = std::vector<ev_t>{ev_t(v, [&times](auto &ta_, double t) {
+                        // Check the state at the event time via the dense output.
+                        ta_.update_d_output(t);
+                        REQUIRE(std::abs(ta_.get_d_output()[1]) < 1e-12);
+
+                        times.push_back(t);
+                    })}};
+
+                REQUIRE(ta.get_nt_events().size() == 1u);
+                REQUIRE(ta.get_nt_events()[0].get_direction() == event_direction::any);
+
+                // The Taylor coefficients of the event equation
+                // are stored after the ones of the state variables.
+                REQUIRE(ta.get_tc().size() == 3u * (ta.get_order() + 1u));
+
+                auto oc = std::get<0>(ta.propagate_until(10.));
+                REQUIRE(oc == taylor_outcome::time_limit);
+
+                // The period of the small oscillations is 2*pi/sqrt(9.8) ~ 2.007,
+                // hence we expect about 10 zero crossings of the velocity.
+                REQUIRE(times.size() >= 9u);
+                REQUIRE(times.size() <= 11u);
+
+                for (decltype(times.size()) i = 1; i < times.size(); ++i) {
+                    REQUIRE(times[i] > times[i - 1u]);
+
+                    // Consecutive zero crossings are half a period apart.
+                    REQUIRE(std::abs(times[i] - times[i - 1u] - 1.0036) < 1e-2);
+                }
+
+                // Direction filtering.
+                times.clear();
+
+                auto ta_pos = taylor_adaptive<double>{
+                    {prime(x) = v, prime(v) = -9.8 * sin(x)},
+                    {0.05, 0.025},
+                    kw::high_accuracy = ha,
+                    kw::compact_mode = cm,
+                    kw::opt_level = opt_level,
+                    kw::nt_events = std::vector<ev_t>{
+                        ev_t(v, [&times](auto &, double t) { times.push_back(t); },
+                             kw::direction = event_direction::positive)}};
+
+                ta_pos.propagate_until(10.);
+
+                // Only the crossings with positive derivative (i.e., x < 0).
+                REQUIRE(times.size() >= 4u);
+                REQUIRE(times.size() <= 6u);
+            }
+        }
+    }
+
+    // Error modes.
+    auto [x, v] = make_vars("x", "v");
+
+    REQUIRE_THROWS_AS(ev_t(v, ev_t::callback_t{}), std::invalid_argument);
+    REQUIRE_THROWS_AS(ev_t(
+                          v, [](auto &, double) {}, kw::direction = event_direction{42}),
+                      std::invalid_argument);
+    REQUIRE_THROWS_AS((taylor_adaptive<double>{
+                          {prime(x) = v, prime(v) = -9.8 * sin(x)},
+                          {0.05, 0.025},
+                          kw::nt_events = std::vector<ev_t>{ev_t("z"_var, [](auto &, double) {})}}),
+                      std::invalid_argument);
+}
+
+// A zero crossing of a non-terminal event falling exactly
+// on the boundary between two timesteps must be reported once.
+TEST_CASE("taylor nt event step boundary")
+{
+    using ev_t = taylor_adaptive<double>::nt_event_t;
+
+    auto [x, v] = make_vars("x", "v");
+
+    for (auto cm : {false, true}) {
+        std::vector<double> times;
+
+        // NOTE: the event time is an endpoint of propagate_until(). The times are
+        // within a factor of 2 of each other, so that the final timestep and
+        // the time of the event equation at its end are computed exactly.
+        auto ta = taylor_adaptive<double>{
+            {prime(x) = v, prime(v) = -x},
+            {0.05, 0.025},
+            kw::compact_mode = cm,
+            kw::nt_events
+            = std::vector<ev_t>{ev_t(heyoka::time - 1., [&times](auto &, double t) { times.push_back(t); })}};
+        ta.set_time(.75);
+
+        REQUIRE(std::get<0>(ta.propagate_until(1.)) == taylor_outcome::time_limit);
+        REQUIRE(ta.get_time() == 1.);
+        REQUIRE(times == std::vector{1.});
+
+        REQUIRE(std::get<0>(ta.propagate_until(1.5)) == taylor_outcome::time_limit);
+        REQUIRE(times == std::vector{1.});
+    }
+}
+
+TEST_CASE("taylor t event")
+{
+    using ev_t = taylor_adaptive<double>::t_event_t;
+
+    for (auto opt_level : {0u, 3u}) {
+        for (auto cm : {false, true}) {
+            for (auto ha : {false, true}) {
+                auto [x, v] = make_vars("x", "v");
+
+                // Stop when x crosses zero from below.
+                auto ta = taylor_adaptive<double>{
+                    {prime(x) = v, prime(v) = -9.8 * sin(x)},
+                    {0.05, 0.025},
+                    kw::high_accuracy = ha,
+                    kw::compact_mode = cm,
+                    kw::opt_level = opt_level,
+                    kw::t_events = std::vector<ev_t>{ev_t(x, kw::direction = event_direction::positive)}};
+
+                auto [oc, min_h, max_h, n_steps] = ta.propagate_until(10.);
+                REQUIRE(oc == taylor_outcome::terminal_event);
+                REQUIRE(ta.get_time() < 10.);
+                REQUIRE(std::abs(ta.get_state()[0]) < 1e-12);
+                REQUIRE(ta.get_state()[1] > 0);
+
+                // The dense output is consistent with the truncated timestep.
+                ta.update_d_output(ta.get_time());
+                REQUIRE(ta.get_d_output()[0] == approximately(ta.get_state()[0], 1000.));
+                REQUIRE(ta.get_d_output()[1] == approximately(ta.get_state()[1], 1000.));
+
+                const auto t_ev = ta.get_time();
+
+                // Resume the integration: the next event is a full period later
+                // (the cooldown prevents the event from triggering again immediately).
+                oc = std::get<0>(ta.propagate_until(10.));
+                REQUIRE(oc == taylor_outcome::terminal_event);
+                REQUIRE(std::abs(ta.get_state()[0]) < 1e-12);
+                REQUIRE(std::abs(ta.get_time() - t_ev - 2.0073) < 1e-2);
+
+                // Callback returning true, the integration continues.
+                std::vector<double> times;
+
+                auto ta_cb = taylor_adaptive<double>{
+                    {prime(x) = v, prime(v) = -9.8 * sin(x)},
+                    {0.05, 0.025},
+                    kw::high_accuracy = ha,
+                    kw::compact_mode = cm,
+                    kw::opt_level = opt_level,
+                    kw::t_events = std::vector<ev_t>{ev_t(
+                        x, kw::callback =
+                               [&times](auto &ta_, double t) {
+                                   REQUIRE(ta_.get_time() == t);
+                                   REQUIRE(std::abs(ta_.get_state()[0]) < 1e-12);
+
+                                   times.push_back(t);
+
+                                   return true;
+                               })}};
+
+                oc = std::get<0>(ta_cb.propagate_until(10.));
+                REQUIRE(oc == taylor_outcome::time_limit);
+                REQUIRE(ta_cb.get_time() == 10.);
+                REQUIRE(times.size() >= 9u);
+                REQUIRE(times.size() <= 11u);
+
+                // Copy semantics.
+                auto ta_copy = ta;
+                REQUIRE(ta_copy.get_t_events().size() == 1u);
+                oc = std::get<0>(ta_copy.propagate_until(20.));
+                REQUIRE(oc == taylor_outcome::terminal_event);
+                REQUIRE(std::abs(ta_copy.get_time() - t_ev - 2 * 2.0073) < 2e-2);
+            }
+        }
+    }
+
+    // Events in propagate_grid().
+    {
+        auto [x, v] = make_vars("x", "v");
+
+        auto ta = taylor_adaptive<double>{
+            {prime(x) = v, prime(v) = -9.8 * sin(x)},
+            {0.05, 0.025},
+            kw::t_events = std::vector<ev_t>{ev_t(x, kw::direction = event_direction::positive)}};
+
+        std::vector<double> grid;
+        for (auto i = 0; i < 100; ++i) {
+            grid.push_back(i / 10.);
+        }
+
+        const auto res = ta.propagate_grid(grid);
+        REQUIRE(std::get<0>(res) == taylor_outcome::terminal_event);
+
+        // The state is available for the grid points up to the event time.
+        const auto n_points = std::get<4>(res).size() / 2u;
+        REQUIRE(n_points > 0u);
+        REQUIRE(n_points < 100u);
+        REQUIRE(grid[n_points - 1u] <= ta.get_time());
+        REQUIRE(grid[n_points] > ta.get_time());
+    }
+
+    // Error modes.
+    auto [x, v] = make_vars("x", "v");
+
+    REQUIRE_THROWS_AS(ev_t(x, kw::cooldown = std::numeric_limits<double>::infinity()), std::invalid_argument);
+    REQUIRE_THROWS_AS(ev_t(x, kw::direction = event_direction{-42}), std::invalid_argument);
+
+    std::ostringstream oss;
+    oss << taylor_outcome::terminal_event;
+    REQUIRE(oss.str() == "terminal_event");
+
+    oss.str("");
+    oss << event_direction::positive;
+    REQUIRE(oss.str() == "positive");
+}
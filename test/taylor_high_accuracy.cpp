@@ -0,0 +1,118 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <heyoka/config.hpp>
+
+#include <cmath>
+#include <initializer_list>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <heyoka/expression.hpp>
+#include <heyoka/taylor.hpp>
+
+#include "catch.hpp"
+#include "test_utils.hpp"
+
+using namespace heyoka;
+using namespace heyoka_test;
+
+const auto fp_types = std::tuple<double, long double
+#if defined(HEYOKA_HAVE_REAL128)
+                                 ,
+                                 mppp::real128
+#endif
+                                 >{};
+
+// The reference values of cos(t) and sin(t), computed in higher precision
+// (in long double for double, in quadruple precision for long double).
+template <typename T>
+std::tuple<T, T> ref_cos_sin(T t)
+{
+    if constexpr (std::is_same_v<T, double>) {
+        const auto lt = static_cast<long double>(t);
+
+        return {static_cast<double>(std::cos(lt)), static_cast<double>(std::sin(lt))};
+#if defined(HEYOKA_HAVE_REAL128)
+    } else if constexpr (std::is_same_v<T, long double>) {
+        const auto qt = mppp::real128{t};
+
+        return {static_cast<long double>(mppp::cos(qt)), static_cast<long double>(mppp::sin(qt))};
+    } else if constexpr (std::is_same_v<T, mppp::real128>) {
+        return {mppp::cos(t), mppp::sin(t)};
+#endif
+    } else {
+        using std::cos;
+        using std::sin;
+
+        return {cos(t), sin(t)};
+    }
+}
+
+// The compensated Horner scheme of the high-accuracy mode, on the harmonic
+// oscillator x' = v, v' = -x (whose solution is a * cos(t), -a * sin(t)),
+// covering the scalar and batch integrators, the compact and default
+// modes and the fast math flags (including the fp contraction,
+// which must not be applied to the error-free transformations).
+TEST_CASE("high accuracy harmonic oscillator")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    const auto sys = std::vector{prime(x) = v, prime(v) = -x};
+
+    tuple_for_each(fp_types, [&](auto fp_x) {
+        using fp_t = decltype(fp_x);
+
+        const auto final_t = fp_t(100);
+
+        for (auto cm : {false, true}) {
+            for (auto fm : {false, true}) {
+                // Scalar mode.
+                auto ta = taylor_adaptive<fp_t>{sys,
+                                                {fp_t(1), fp_t(0)},
+                                                kw::high_accuracy = true,
+                                                kw::compact_mode = cm,
+                                                kw::fast_math = fm};
+
+                REQUIRE(std::get<0>(ta.propagate_until(final_t)) == taylor_outcome::time_limit);
+
+                const auto [c, s] = ref_cos_sin(ta.get_time());
+                REQUIRE(ta.get_state()[0] == approximately(c, fp_t(1000)));
+                REQUIRE(ta.get_state()[1] == approximately(-s, fp_t(1000)));
+
+                // Batch mode.
+                const auto amps = std::vector{fp_t(1), fp_t(1) / 2, fp_t(3), fp_t(1) / 3};
+
+                auto tb = taylor_adaptive_batch<fp_t>{sys,
+                                                      {amps[0], amps[1], amps[2], amps[3], fp_t(0), fp_t(0),
+                                                       fp_t(0), fp_t(0)},
+                                                      4,
+                                                      kw::high_accuracy = true,
+                                                      kw::compact_mode = cm,
+                                                      kw::fast_math = fm};
+
+                tb.propagate_until({final_t, final_t, final_t, final_t});
+
+                for (auto i = 0u; i < 4u; ++i) {
+                    REQUIRE(std::get<0>(tb.get_propagate_res()[i]) == taylor_outcome::time_limit);
+
+                    const auto [cb, sb] = ref_cos_sin(tb.get_time()[i]);
+                    REQUIRE(tb.get_state()[i] == approximately(amps[i] * cb, fp_t(1000)));
+                    REQUIRE(tb.get_state()[4u + i] == approximately(-amps[i] * sb, fp_t(1000)));
+                }
+            }
+        }
+    });
+}
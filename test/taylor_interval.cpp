@@ -0,0 +1,159 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <cmath>
+#include <random>
+#include <stdexcept>
+#include <tuple>
+#include <vector>
+
+#include <heyoka/expression.hpp>
+#include <heyoka/interval.hpp>
+#include <heyoka/math.hpp>
+#include <heyoka/taylor.hpp>
+#include <heyoka/taylor_interval.hpp>
+
+#include "catch.hpp"
+#include "test_utils.hpp"
+
+using namespace heyoka;
+using namespace heyoka_test;
+
+// Check if a contains v.
+static bool contains(const interval &a, double v)
+{
+    return a.lower <= v && v <= a.upper;
+}
+
+TEST_CASE("taylor interval derivatives")
+{
+    auto [x] = make_vars("x");
+
+    taylor_interval ti{{prime(x) = -x}, {interval{1, 1}}, 5};
+
+    REQUIRE(ti.get_dim() == 1u);
+    REQUIRE(ti.get_order() == 5u);
+    REQUIRE(ti.get_n_boxes() == 1u);
+    REQUIRE(ti.get_tc().size() == 5u);
+
+    // The k-th derivative of exp(-t) is (-1)**k * x.
+    for (auto k = 1u; k <= 5u; ++k) {
+        REQUIRE(eval_dbl(ti.get_tc()[k - 1u], {{"x", 2.}}) == approximately(k % 2u == 0u ? 2. : -2.));
+    }
+}
+
+TEST_CASE("taylor interval exp")
+{
+    auto [x] = make_vars("x");
+
+    taylor_interval ti{{prime(x) = -x}, {interval{1, 1.001}, interval{2, 2}}, 10};
+
+    const auto [oc, n_steps] = ti.propagate_until(1., .1);
+
+    REQUIRE(oc == taylor_outcome::time_limit);
+    REQUIRE(n_steps >= 10u);
+    REQUIRE(ti.get_time() == 1.);
+
+    const auto &st = ti.get_state();
+    REQUIRE(contains(st[0], std::exp(-1.)));
+    REQUIRE(contains(st[0], 1.001 * std::exp(-1.)));
+    REQUIRE(st[0].upper - st[0].lower < 1e-2);
+
+    // The degenerate box stays tight.
+    REQUIRE(contains(st[1], 2 * std::exp(-1.)));
+    REQUIRE(st[1].upper - st[1].lower < 1e-8);
+
+    // Backwards propagation.
+    ti.set_state({interval{1, 1}});
+    ti.set_time(0);
+    ti.propagate_until(-1., .1);
+    REQUIRE(contains(ti.get_state()[0], std::exp(1.)));
+}
+
+TEST_CASE("taylor interval pendulum")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    const auto sys = std::vector{prime(x) = v, prime(v) = -9.8 * sin(x)};
+
+    // Two boxes of initial conditions.
+    const std::vector<double> lb = {.05, .02, -.3, .1}, ub = {.051, .021, -.299, .101};
+
+    std::vector<interval> boxes;
+    for (auto i = 0u; i < 4u; ++i) {
+        boxes.push_back(interval{lb[i], ub[i]});
+    }
+
+    taylor_interval ti{sys, boxes, 8};
+    REQUIRE(ti.get_n_boxes() == 2u);
+
+    const auto [oc, n_steps] = ti.propagate_until(1., .05);
+    REQUIRE(oc == taylor_outcome::time_limit);
+    REQUIRE(n_steps > 0u);
+
+    // Check the enclosures against point integrations
+    // of random initial conditions within the boxes.
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<double> rdist(0., 1.);
+
+    auto ta = taylor_adaptive<double>{sys, {0., 0.}};
+
+    for (auto b = 0u; b < 2u; ++b) {
+        for (auto i = 0; i < 100; ++i) {
+            ta.set_time(0);
+            ta.get_state_data()[0] = lb[2u * b] + (ub[2u * b] - lb[2u * b]) * rdist(rng);
+            ta.get_state_data()[1] = lb[2u * b + 1u] + (ub[2u * b + 1u] - lb[2u * b + 1u]) * rdist(rng);
+
+            ta.propagate_until(1.);
+
+            REQUIRE(contains(ti.get_state()[2u * b], ta.get_state()[0]));
+            REQUIRE(contains(ti.get_state()[2u * b + 1u], ta.get_state()[1]));
+        }
+
+        REQUIRE(ti.get_state()[2u * b].upper - ti.get_state()[2u * b].lower < .1);
+    }
+}
+
+TEST_CASE("taylor interval step failure")
+{
+    auto [x] = make_vars("x");
+
+    // The solution of x' = x**2 with x(0) = 1 blows up at t = 1.
+    taylor_interval ti{{prime(x) = x * x}, {interval{1, 1}}, 6};
+
+    REQUIRE(!ti.step(2.));
+    REQUIRE(ti.get_state()[0] == interval{1, 1});
+    REQUIRE(ti.get_time() == 0.);
+
+    REQUIRE(ti.step(.01));
+    REQUIRE(contains(ti.get_state()[0], 1 / (1 - .01)));
+
+    // The propagation stops before the singularity.
+    const auto oc = std::get<0>(ti.propagate_until(2., .1, 10));
+    REQUIRE(oc == taylor_outcome::err_nf_state);
+    REQUIRE(ti.get_time() < 1.);
+}
+
+TEST_CASE("taylor interval errors")
+{
+    auto [x, y] = make_vars("x", "y");
+
+    REQUIRE_THROWS_AS(taylor_interval({}, {interval{1, 1}}), std::invalid_argument);
+    REQUIRE_THROWS_AS(taylor_interval({prime(x) = -x}, {interval{1, 1}}, 0), std::invalid_argument);
+    REQUIRE_THROWS_AS(taylor_interval({prime(x) = -y}, {interval{1, 1}}), std::invalid_argument);
+    REQUIRE_THROWS_AS(taylor_interval({{x + y, -x}}, {interval{1, 1}}), std::invalid_argument);
+    REQUIRE_THROWS_AS(taylor_interval({prime(x) = -x, prime(x) = x}, {interval{1, 1}, interval{1, 1}}),
+                      std::invalid_argument);
+    REQUIRE_THROWS_AS(taylor_interval({prime(x) = -x, prime(y) = x}, {interval{1, 1}}), std::invalid_argument);
+    REQUIRE_THROWS_AS(taylor_interval({prime(x) = -x}, {interval{2, 1}}), std::invalid_argument);
+
+    taylor_interval ti{{prime(x) = -x}, {interval{1, 1}}};
+    REQUIRE_THROWS_AS(ti.set_state({}), std::invalid_argument);
+    REQUIRE_THROWS_AS(ti.step(std::nan("")), std::invalid_argument);
+    REQUIRE_THROWS_AS(ti.propagate_until(1., 0.), std::invalid_argument);
+}
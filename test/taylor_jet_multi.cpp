@@ -0,0 +1,348 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <heyoka/config.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <heyoka/expression.hpp>
+#include <heyoka/llvm_state.hpp>
+#include <heyoka/math.hpp>
+#include <heyoka/taylor.hpp>
+
+#include "catch.hpp"
+#include "test_utils.hpp"
+
+static std::mt19937 rng;
+
+using namespace heyoka;
+using namespace heyoka_test;
+namespace hy = heyoka;
+
+const auto fp_types = std::tuple<double, long double
+#if defined(HEYOKA_HAVE_REAL128)
+                                 ,
+                                 mppp::real128
+#endif
+                                 >{};
+
+// Compare the jets computed at multiple points with the jets computed
+// point by point via taylor_add_jet().
+TEST_CASE("taylor jet multi")
+{
+    auto tester = [](auto fp_x, unsigned opt_level, bool compact_mode, bool parallel_mode) {
+        using fp_t = decltype(fp_x);
+
+        auto [x, v] = make_vars("x", "v");
+
+        const auto sys = {prime(x) = v, prime(v) = -par[0] * sin(x) + par[1] * cos(hy::time)};
+
+        const std::uint32_t order = 4, n_eq = 2, n_pars = 2;
+
+        for (auto batch_size : {1u, 2u, 4u, 5u}) {
+            // NOTE: use separate states, as in compact mode the jets might
+            // not be added to the same state after optimisation.
+            llvm_state s{kw::opt_level = opt_level}, s_ref{kw::opt_level = opt_level};
+
+            taylor_add_jet_multi<fp_t>(s, "jet_multi", sys, order, batch_size, false, compact_mode, parallel_mode);
+            taylor_add_jet<fp_t>(s_ref, "jet", sys, order, 1, false, compact_mode);
+
+            s.compile();
+            s_ref.compile();
+
+            auto jptr_multi
+                = reinterpret_cast<void (*)(fp_t *, const fp_t *, const fp_t *, const fp_t *, std::uint32_t,
+                                            std::uint64_t)>(s.jit_lookup("jet_multi"));
+            auto jptr = reinterpret_cast<void (*)(fp_t *, const fp_t *, const fp_t *)>(s_ref.jit_lookup("jet"));
+
+            std::uniform_real_distribution<float> dist(-1.f, 1.f);
+
+            for (std::uint32_t n_points : {0u, 1u, 7u, 37u}) {
+                // NOTE: use a stride larger than the number of points.
+                const std::uint64_t stride = n_points + 3u;
+
+                std::vector<fp_t> in(n_eq * stride), pars(n_pars * stride), times(n_points),
+                    out((order + 1u) * n_eq * stride, fp_t(-42));
+                std::generate(in.begin(), in.end(), [&dist]() { return fp_t(dist(rng)); });
+                std::generate(pars.begin(), pars.end(), [&dist]() { return fp_t(dist(rng)); });
+                std::generate(times.begin(), times.end(), [&dist]() { return fp_t(dist(rng)); });
+
+                jptr_multi(out.data(), in.data(), pars.data(), times.data(), n_points, stride);
+
+                std::vector<fp_t> jet((order + 1u) * n_eq), p(n_pars);
+                for (std::uint32_t pt = 0; pt < n_points; ++pt) {
+                    for (std::uint32_t i = 0; i < n_eq; ++i) {
+                        jet[i] = in[i * stride + pt];
+                    }
+                    for (std::uint32_t j = 0; j < n_pars; ++j) {
+                        p[j] = pars[j * stride + pt];
+                    }
+
+                    jptr(jet.data(), p.data(), &times[pt]);
+
+                    for (std::uint32_t r = 0; r < (order + 1u) * n_eq; ++r) {
+                        REQUIRE(out[r * stride + pt] == approximately(jet[r]));
+                    }
+                }
+
+                // The padding must not be touched.
+                for (std::uint32_t r = 0; r < (order + 1u) * n_eq; ++r) {
+                    for (auto pt = n_points; pt < stride; ++pt) {
+                        REQUIRE(out[r * stride + pt] == -42);
+                    }
+                }
+            }
+        }
+    };
+
+    for (auto cm : {false, true}) {
+        tuple_for_each(fp_types, [&tester, cm](auto x) { tester(x, 0, cm, false); });
+        tuple_for_each(fp_types, [&tester, cm](auto x) { tester(x, 3, cm, false); });
+    }
+
+    tuple_for_each(fp_types, [&tester](auto x) { tester(x, 0, false, true); });
+    tuple_for_each(fp_types, [&tester](auto x) { tester(x, 3, false, true); });
+
+    // Error checking.
+    using Catch::Matchers::Message;
+
+    auto [x, v] = make_vars("x", "v");
+    const auto sys = {prime(x) = v, prime(v) = -x};
+
+    {
+        llvm_state s;
+        REQUIRE_THROWS_MATCHES(
+            taylor_add_jet_multi<double>(s, "jet", sys, 3, 2, false, true, true), std::invalid_argument,
+            Message("The parallel mode is not supported in compact mode for the computation of the jets of Taylor "
+                    "derivatives at multiple points"));
+    }
+
+    {
+        llvm_state s;
+        REQUIRE_THROWS_MATCHES(taylor_add_jet_multi<double>(s, "jet", sys, 0, 2, false, false),
+                               std::invalid_argument, Message("The order of a Taylor jet cannot be zero"));
+        REQUIRE_THROWS_MATCHES(taylor_add_jet_multi<double>(s, "jet", sys, 3, 0, false, false),
+                               std::invalid_argument, Message("The batch size of a Taylor jet cannot be zero"));
+    }
+}
+
+// Compare the jet of the outputs with the jet of an augmented
+// system in which the output is integrated as a state variable.
+TEST_CASE("taylor jet outputs")
+{
+    auto tester = [](auto fp_x, unsigned opt_level, bool compact_mode) {
+        using fp_t = decltype(fp_x);
+
+        auto [x, v, y, w] = make_vars("x", "v", "y", "w");
+
+        // NOTE: y does not feed the output and it must be pruned.
+        const auto sys = {prime(y) = y * x, prime(x) = v, prime(v) = -par[0] * sin(x)};
+        const auto out = x * v + cos(hy::time);
+
+        // The augmented system, with w = x * v + cos(t).
+        const auto sys_ref = {prime(x) = v, prime(v) = -par[0] * sin(x),
+                              prime(w) = v * v - x * par[0] * sin(x) - sin(hy::time)};
+
+        const std::uint32_t order = 5;
+
+        for (auto batch_size : {1u, 2u, 4u}) {
+            llvm_state s{kw::opt_level = opt_level}, s_ref{kw::opt_level = opt_level};
+
+            const auto [dc, sv_idx]
+                = taylor_add_jet_outputs<fp_t>(s, "jet", sys, {out, x}, order, batch_size, false, compact_mode);
+            taylor_add_jet<fp_t>(s_ref, "jet", sys_ref, order, 1, false, compact_mode);
+
+            // Only x and v are retained, in the original order.
+            REQUIRE(dc[0].first == x);
+            REQUIRE(dc[1].first == v);
+            REQUIRE(sv_idx.size() == 2u);
+            REQUIRE(sv_idx[1] == 0u);
+
+            s.compile();
+            s_ref.compile();
+
+            auto jptr = reinterpret_cast<void (*)(fp_t *, const fp_t *, const fp_t *)>(s.jit_lookup("jet"));
+            auto jptr_ref = reinterpret_cast<void (*)(fp_t *, const fp_t *, const fp_t *)>(s_ref.jit_lookup("jet"));
+
+            std::uniform_real_distribution<float> dist(-1.f, 1.f);
+
+            std::vector<fp_t> in_out(2u * (order + 1u) * batch_size), pars(batch_size), times(batch_size);
+            std::generate(in_out.begin(), in_out.begin() + 2 * batch_size, [&dist]() { return fp_t(dist(rng)); });
+            std::generate(pars.begin(), pars.end(), [&dist]() { return fp_t(dist(rng)); });
+            std::generate(times.begin(), times.end(), [&dist]() { return fp_t(dist(rng)); });
+
+            std::vector<fp_t> jet_ref(3u * (order + 1u));
+            std::vector<std::vector<fp_t>> refs;
+            for (std::uint32_t b = 0; b < batch_size; ++b) {
+                using std::cos;
+
+                jet_ref[0] = in_out[b];
+                jet_ref[1] = in_out[batch_size + b];
+                jet_ref[2] = jet_ref[0] * jet_ref[1] + cos(times[b]);
+
+                jptr_ref(jet_ref.data(), &pars[b], &times[b]);
+                refs.push_back(jet_ref);
+            }
+
+            jptr(in_out.data(), pars.data(), times.data());
+
+            for (std::uint32_t b = 0; b < batch_size; ++b) {
+                for (std::uint32_t o = 0; o <= order; ++o) {
+                    REQUIRE(in_out[(o * 2u) * batch_size + b] == approximately(refs[b][o * 3u + 2u], fp_t(100)));
+                    REQUIRE(in_out[(o * 2u + 1u) * batch_size + b] == approximately(refs[b][o * 3u]));
+                }
+            }
+        }
+    };
+
+    for (auto cm : {false, true}) {
+        tuple_for_each(fp_types, [&tester, cm](auto x) { tester(x, 0, cm); });
+        tuple_for_each(fp_types, [&tester, cm](auto x) { tester(x, 3, cm); });
+    }
+
+    // Error checking.
+    using Catch::Matchers::Message;
+
+    auto [x, v] = make_vars("x", "v");
+    const auto sys = {prime(x) = v, prime(v) = -x};
+
+    llvm_state s;
+    REQUIRE_THROWS_MATCHES(taylor_add_jet_outputs<double>(s, "jet", sys, {x}, 0, 2, false, false),
+                           std::invalid_argument, Message("The order of a Taylor jet cannot be zero"));
+    REQUIRE_THROWS_MATCHES(taylor_add_jet_outputs<double>(s, "jet", sys, {x}, 3, 0, false, false),
+                           std::invalid_argument, Message("The batch size of a Taylor jet cannot be zero"));
+    REQUIRE_THROWS_MATCHES(
+        taylor_add_jet_outputs<double>(s, "jet", sys, {}, 3, 1, false, false), std::invalid_argument,
+        Message("At least one output is needed in order to add a Taylor jet of outputs"));
+    REQUIRE_THROWS_MATCHES(
+        taylor_add_jet_outputs<double>(s, "jet", sys, {par[0] + 1_dbl}, 3, 1, false, false), std::invalid_argument,
+        Message("The outputs of a Taylor jet must depend on at least one state variable"));
+}
+
+// Count the lines of the textual IR ir containing both s1 and s2.
+inline unsigned count_ir_lines(const std::string &ir, const std::string &s1, const std::string &s2)
+{
+    unsigned retval = 0;
+
+    std::istringstream iss(ir);
+    for (std::string line; std::getline(iss, line);) {
+        retval += line.find(s1) != std::string::npos && line.find(s2) != std::string::npos;
+    }
+
+    return retval;
+}
+
+// Compare the batch jets computed from buffers which are aligned only to the scalar
+// type (i.e., they start at an odd offset) with the jets computed lane by lane.
+// NOTE: this exercises both the single vector loads/stores (for double and real128)
+// and the elementwise fallback (for x86 long double, whose layout is padded).
+TEST_CASE("taylor jet unaligned batch")
+{
+    auto tester = [](auto fp_x, unsigned opt_level, bool compact_mode) {
+        using fp_t = decltype(fp_x);
+
+        auto [x, v] = make_vars("x", "v");
+
+        const auto sys = {prime(x) = v, prime(v) = -par[0] * x * v + par[1] * hy::time / (x * x + 1_dbl)};
+
+        const std::uint32_t order = 4, n_eq = 2, n_pars = 2;
+
+        for (auto batch_size : {2u, 4u}) {
+            llvm_state s{kw::opt_level = opt_level}, s_ref{kw::opt_level = opt_level};
+
+            taylor_add_jet<fp_t>(s, "jet", sys, order, batch_size, false, compact_mode);
+            taylor_add_jet<fp_t>(s_ref, "jet", sys, order, 1, false, compact_mode);
+
+            s.compile();
+            s_ref.compile();
+
+            auto jptr = reinterpret_cast<void (*)(fp_t *, const fp_t *, const fp_t *)>(s.jit_lookup("jet"));
+            auto jptr_ref = reinterpret_cast<void (*)(fp_t *, const fp_t *, const fp_t *)>(s_ref.jit_lookup("jet"));
+
+            std::uniform_real_distribution<float> dist(-1.f, 1.f);
+
+            // NOTE: the buffers are offset by one element from the
+            // beginning of the storage allocated by std::vector.
+            std::vector<fp_t> jet_buf(1u + (order + 1u) * n_eq * batch_size), par_buf(1u + n_pars * batch_size),
+                time_buf(1u + batch_size);
+            std::generate(jet_buf.begin(), jet_buf.end(), [&dist]() { return fp_t(dist(rng)); });
+            std::generate(par_buf.begin(), par_buf.end(), [&dist]() { return fp_t(dist(rng)); });
+            std::generate(time_buf.begin(), time_buf.end(), [&dist]() { return fp_t(dist(rng)); });
+
+            auto *jet = jet_buf.data() + 1;
+            const auto *pars = par_buf.data() + 1;
+            const auto *times = time_buf.data() + 1;
+
+            std::vector<fp_t> init(jet, jet + n_eq * batch_size);
+
+            jptr(jet, pars, times);
+
+            std::vector<fp_t> jet_ref((order + 1u) * n_eq), p(n_pars);
+            for (std::uint32_t lane = 0; lane < batch_size; ++lane) {
+                for (std::uint32_t i = 0; i < n_eq; ++i) {
+                    jet_ref[i] = init[i * batch_size + lane];
+                }
+                for (std::uint32_t j = 0; j < n_pars; ++j) {
+                    p[j] = pars[j * batch_size + lane];
+                }
+
+                jptr_ref(jet_ref.data(), p.data(), times + lane);
+
+                for (std::uint32_t r = 0; r < (order + 1u) * n_eq; ++r) {
+                    REQUIRE(jet[r * batch_size + lane] == approximately(jet_ref[r]));
+                }
+            }
+        }
+    };
+
+    for (auto cm : {false, true}) {
+        tuple_for_each(fp_types, [&tester, cm](auto x) { tester(x, 0, cm); });
+        tuple_for_each(fp_types, [&tester, cm](auto x) { tester(x, 3, cm); });
+    }
+
+    auto [x, v] = make_vars("x", "v");
+
+    // In double precision the state and the derivatives are loaded/stored
+    // as whole vectors, with the alignment of the scalar type.
+    {
+        llvm_state s{kw::opt_level = 0u};
+
+        taylor_add_jet<double>(s, "jet", {prime(x) = v, prime(v) = -x * v}, 3, 4, false, false);
+
+        const auto ir = s.get_ir();
+
+        REQUIRE(count_ir_lines(ir, "load <4 x double>", "align 8") > 0u);
+        REQUIRE(count_ir_lines(ir, "store <4 x double>", "align 8") > 0u);
+    }
+
+    // The x86 extended-precision long double is padded in memory, hence
+    // the vectors must be assembled element by element.
+    {
+        llvm_state s{kw::opt_level = 0u};
+
+        taylor_add_jet<long double>(s, "jet", {prime(x) = v, prime(v) = -x * v}, 3, 4, false, false);
+
+        const auto ir = s.get_ir();
+
+        REQUIRE(count_ir_lines(ir, "load <4 x x86_fp80>", "") == 0u);
+        REQUIRE(count_ir_lines(ir, "store <4 x x86_fp80>", "") == 0u);
+    }
+}
@@ -0,0 +1,162 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <heyoka/config.hpp>
+
+#include <cmath>
+#include <initializer_list>
+#include <sstream>
+#include <tuple>
+#include <vector>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <heyoka/compiled_function.hpp>
+#include <heyoka/expression.hpp>
+#include <heyoka/expression_parser.hpp>
+#include <heyoka/math/cos.hpp>
+#include <heyoka/math/kepE.hpp>
+#include <heyoka/math/sin.hpp>
+#include <heyoka/taylor.hpp>
+
+#include "catch.hpp"
+#include "test_utils.hpp"
+
+using namespace heyoka;
+using namespace heyoka_test;
+
+const auto fp_types = std::tuple<double, long double
+#if defined(HEYOKA_HAVE_REAL128)
+                                 ,
+                                 mppp::real128
+#endif
+                                 >{};
+
+TEST_CASE("kepE")
+{
+    auto [e, M] = make_vars("e", "M");
+
+    // Numerical evaluation.
+    for (auto ev : {0., .1, .5, .9, .99}) {
+        for (auto Mv : {-10., -1., 0., 1e-10, .5, 3., 100.}) {
+            const auto E = eval_dbl(kepE(e, M), {{"e", ev}, {"M", Mv}});
+            REQUIRE(E - ev * std::sin(E) == approximately(Mv, 1000.));
+        }
+    }
+    REQUIRE(std::isnan(eval_dbl(kepE(e, M), {{"e", 1.}, {"M", 1.}})));
+    REQUIRE(std::isnan(eval_dbl(kepE(e, M), {{"e", -.1}, {"M", 1.}})));
+
+    // Symbolic differentiation.
+    const auto dE = eval_dbl(diff(kepE(e, M), "M"), {{"e", .3}, {"M", 1.2}});
+    const auto E = eval_dbl(kepE(e, M), {{"e", .3}, {"M", 1.2}});
+    REQUIRE(dE == approximately(1. / (1. - .3 * std::cos(E))));
+
+    // Serialisation and parsing.
+    std::ostringstream oss;
+    oss << kepE(e, M);
+    REQUIRE(oss.str() == "kepE(e, M)");
+    REQUIRE(parse_expression(oss.str()) == kepE(e, M));
+
+    std::stringstream ss;
+    save_expression(ss, kepE(e, 2_dbl));
+    REQUIRE(load_expression(ss) == kepE(e, 2_dbl));
+
+    // Codegen.
+    tuple_for_each(fp_types, [&](auto fp_x) {
+        using fp_t = decltype(fp_x);
+        using std::sin;
+
+        for (auto batch_size : {1u, 4u}) {
+            compiled_function<fp_t> cf{{kepE(e, M)}, kw::batch_size = batch_size};
+
+            for (auto ev : {0., .1, .5, .9, .999}) {
+                for (auto Mv : {-10., 0., .5, 3., 100.}) {
+                    // NOTE: the variables are sorted alphabetically.
+                    const auto out = cf({fp_t(Mv), fp_t(ev)});
+                    REQUIRE(out[0] - fp_t(ev) * sin(out[0]) == approximately(fp_t(Mv), fp_t(1000)));
+                }
+            }
+
+            using std::isnan;
+            REQUIRE(isnan(cf({fp_t(1), fp_t(1)})[0]));
+        }
+    });
+}
+
+TEST_CASE("taylor kepE")
+{
+    auto [x, y, z, e, M, E, E2] = make_vars("x", "y", "z", "e", "M", "E", "E2");
+
+    // Compare the integration of kepE() with the integration of the
+    // time derivative of the solution of Kepler's equation,
+    // E' = (M' + e' * sin(E)) / (1 - e * cos(E)), covering the
+    // variable/number/param arguments.
+    const auto de = .01;
+
+    // The integral of kepE(.7, M) + kepE(.2, 2 * M) over [0, 10],
+    // computed via the midpoint rule.
+    auto quad = 0.;
+    const auto n_quad = 100000;
+    for (auto i = 0; i < n_quad; ++i) {
+        const auto t = (i + .5) * 10. / n_quad;
+        quad += eval_dbl(kepE(par[0], M) + kepE(.2_dbl, 2_dbl * M), {{"M", t}}, {.7});
+    }
+    quad *= 10. / n_quad;
+
+    for (auto cm : {false, true}) {
+        for (auto ha : {false, true}) {
+            auto ta0 = taylor_adaptive<double>{
+                {prime(e) = expression{de}, prime(M) = 1_dbl, prime(x) = kepE(e, M), prime(y) = kepE(e, 1.5_dbl),
+                 prime(z) = kepE(par[0], M) + kepE(.2_dbl, 2_dbl * M)},
+                {.1, 0., 0., 0., 0.},
+                kw::compact_mode = cm,
+                kw::high_accuracy = ha,
+                kw::pars = {.7}};
+
+            const auto E0 = eval_dbl(kepE(e, M), {{"e", .1}, {"M", 1.5}});
+            auto ta1 = taylor_adaptive<double>{{prime(e) = expression{de}, prime(M) = 1_dbl,
+                                                prime(E) = (1_dbl + de * sin(E)) / (1_dbl - e * cos(E)),
+                                                prime(E2) = de * sin(E2) / (1_dbl - e * cos(E2)), prime(x) = E,
+                                                prime(y) = E2},
+                                               {.1, 0., 0., E0, 0., 0.},
+                                               kw::compact_mode = cm,
+                                               kw::high_accuracy = ha};
+
+            REQUIRE(std::get<0>(ta0.propagate_until(10.)) == taylor_outcome::time_limit);
+            REQUIRE(std::get<0>(ta1.propagate_until(10.)) == taylor_outcome::time_limit);
+
+            REQUIRE(ta0.get_state()[2] == approximately(ta1.get_state()[4], 1000.));
+            REQUIRE(ta0.get_state()[3] == approximately(ta1.get_state()[5], 1000.));
+
+            // The integral of kepE(.7, M) + kepE(.2, 2 * M).
+            REQUIRE(ta0.get_state()[4] == approximately(quad, 1e8));
+        }
+    }
+
+    // Batch mode.
+    for (auto cm : {false, true}) {
+        auto ta = taylor_adaptive_batch<double>{
+            {prime(M) = 1_dbl, prime(x) = kepE(par[0], M)}, {0., 0., 0., 0.}, 2, kw::compact_mode = cm,
+            kw::pars = {.3, .9}};
+
+        ta.propagate_until({5., 5.});
+
+        for (auto i = 0u; i < 2u; ++i) {
+            auto ta_s = taylor_adaptive<double>{
+                {prime(M) = 1_dbl, prime(x) = kepE(par[0], M)}, {0., 0.}, kw::compact_mode = cm,
+                kw::pars = {ta.get_pars()[i]}};
+            ta_s.propagate_until(5.);
+
+            REQUIRE(ta.get_state()[2u + i] == approximately(ta_s.get_state()[1], 1000.));
+        }
+    }
+}
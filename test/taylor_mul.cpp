@@ -9,8 +9,12 @@
 #include <heyoka/config.hpp>
 
 #include <algorithm>
+#include <cmath>
+#include <cstdint>
 #include <initializer_list>
+#include <limits>
 #include <random>
+#include <string>
 #include <tuple>
 #include <vector>
 
@@ -991,3 +995,97 @@ TEST_CASE("taylor mul")
         }
     }
 }
+
+// The Taylor coefficients of the mul/div recurrences, computed with and
+// without hardware fma (the latter via disabling the fma feature of the target),
+// compared against reference values computed in extended precision.
+TEST_CASE("taylor mul div fma")
+{
+    auto [x, y] = make_vars("x", "y");
+
+    // NOTE: var * var, var / var and num / var.
+    const auto sys = {prime(x) = x * y - x / y, prime(y) = 2_dbl / y + y * x};
+
+    const std::uint32_t order = 12, n_eq = 2;
+
+    auto n_fma = [](const std::string &ir) {
+        unsigned retval = 0;
+        for (auto pos = ir.find("@llvm.fma."); pos != std::string::npos; pos = ir.find("@llvm.fma.", pos + 1u)) {
+            ++retval;
+        }
+        return retval;
+    };
+
+    std::uniform_real_distribution<double> dist(1., 2.);
+
+    for (auto cm : {false, true}) {
+        for (std::uint32_t batch_size : {1u, 4u}) {
+            llvm_state s_ref;
+            taylor_add_jet<long double>(s_ref, "jet", sys, order, batch_size, false, cm);
+            s_ref.compile();
+            auto jptr_ref
+                = reinterpret_cast<void (*)(long double *, const long double *, const long double *)>(
+                    s_ref.jit_lookup("jet"));
+
+            std::vector<double> init(n_eq * batch_size);
+            for (auto &v : init) {
+                v = dist(rng);
+            }
+
+            std::vector<long double> jet_ref((order + 1u) * n_eq * batch_size);
+            std::copy(init.begin(), init.end(), jet_ref.begin());
+            jptr_ref(jet_ref.data(), nullptr, nullptr);
+
+            for (const auto *feat : {"", "-fma"}) {
+                for (auto opt_level : {0u, 3u}) {
+                    llvm_state s{kw::opt_level = opt_level, kw::target_features = std::string(feat)};
+
+                    taylor_add_jet<double>(s, "jet", sys, order, batch_size, false, cm);
+
+#if defined(__x86_64__) || defined(_M_X64)
+                    // Disabling the fma feature must suppress the fma intrinsic (with
+                    // the default features, it is emitted if the host supports it).
+                    if (!std::string(feat).empty()) {
+                        REQUIRE(n_fma(s.get_ir()) == 0u);
+                    }
+#endif
+
+                    s.compile();
+
+                    auto jptr
+                        = reinterpret_cast<void (*)(double *, const double *, const double *)>(s.jit_lookup("jet"));
+
+                    std::vector<double> jet((order + 1u) * n_eq * batch_size);
+                    std::copy(init.begin(), init.end(), jet.begin());
+                    jptr(jet.data(), nullptr, nullptr);
+
+                    // NOTE: the errors are measured relative to the largest
+                    // coefficient of each order, so that the cancellations
+                    // in the small coefficients are tolerated.
+                    for (std::uint32_t o = 0; o <= order; ++o) {
+                        const auto begin = o * n_eq * batch_size, end = (o + 1u) * n_eq * batch_size;
+
+                        long double scale = 0;
+                        for (auto i = begin; i < end; ++i) {
+                            scale = std::max(scale, std::abs(jet_ref[i]));
+                        }
+
+                        const auto tol = 1000 * std::numeric_limits<double>::epsilon() * scale;
+                        for (auto i = begin; i < end; ++i) {
+                            REQUIRE(std::abs(jet[i] - jet_ref[i]) <= tol);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // No fma for the long double recurrences.
+    {
+        llvm_state s;
+
+        taylor_add_jet<long double>(s, "jet", sys, order, 1, false, false);
+
+        REQUIRE(n_fma(s.get_ir()) == 0u);
+    }
+}
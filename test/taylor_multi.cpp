@@ -0,0 +1,166 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <cstdint>
+#include <initializer_list>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <heyoka/expression.hpp>
+#include <heyoka/llvm_state.hpp>
+#include <heyoka/math/sin.hpp>
+#include <heyoka/taylor.hpp>
+#include <heyoka/taylor_multi.hpp>
+
+#include "catch.hpp"
+#include "test_utils.hpp"
+
+using namespace heyoka;
+using namespace heyoka_test;
+
+TEST_CASE("taylor multi")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    const auto pend = std::vector{prime(x) = v, prime(v) = -9.8 * sin(x)};
+    const auto osc = std::vector{prime(x) = v, prime(v) = -x};
+
+    for (auto cm : {false, true}) {
+        taylor_multi_builder<double> b;
+
+        REQUIRE(b.add(pend, {0.05, 0.025}, kw::compact_mode = cm) == 0u);
+        REQUIRE(b.add(osc, {0., 1.}, kw::compact_mode = cm, kw::tol = 1e-8) == 1u);
+        REQUIRE(b.add(pend, {0.05, 0.025}, kw::orders = std::vector<std::uint32_t>{10, 20}) == 2u);
+        REQUIRE(b.add_batch(pend, {0.05, 0.06, 0.025, 0.026}, 2, kw::compact_mode = cm) == 0u);
+
+        REQUIRE(b.get_n_integrators() == 3u);
+        REQUIRE(b.get_n_batch_integrators() == 1u);
+        REQUIRE(!b.is_compiled());
+        REQUIRE(!b.get_llvm_state().is_compiled());
+
+        b.compile();
+
+        REQUIRE(b.is_compiled());
+        REQUIRE(b.get_llvm_state().is_compiled());
+        REQUIRE(b.get(0).get_llvm_state().get_symbol_prefix() == "heyoka.multi.0.");
+        REQUIRE(b.get_batch(0).get_llvm_state().get_symbol_prefix() == "heyoka.multi.3.");
+
+        // Compare with the integrators constructed directly.
+        auto ta0 = taylor_adaptive<double>{pend, {0.05, 0.025}, kw::compact_mode = cm};
+        auto ta1 = taylor_adaptive<double>{osc, {0., 1.}, kw::compact_mode = cm, kw::tol = 1e-8};
+        auto ta2 = taylor_adaptive<double>{pend, {0.05, 0.025}, kw::orders = std::vector<std::uint32_t>{10, 20}};
+        auto tab = taylor_adaptive_batch<double>{pend, {0.05, 0.06, 0.025, 0.026}, 2, kw::compact_mode = cm};
+
+        REQUIRE(b.get(0).get_order() == ta0.get_order());
+        REQUIRE(b.get(1).get_order() == ta1.get_order());
+
+        b.get(0).propagate_until(10.);
+        b.get(1).propagate_until(10.);
+        b.get(2).propagate_until(10.);
+        b.get_batch(0).propagate_until(std::vector{10., 10.});
+        ta0.propagate_until(10.);
+        ta1.propagate_until(10.);
+        ta2.propagate_until(10.);
+        tab.propagate_until(std::vector{10., 10.});
+
+        for (auto i = 0u; i < 2u; ++i) {
+            REQUIRE(b.get(0).get_state()[i] == approximately(ta0.get_state()[i], 1000.));
+            REQUIRE(b.get(1).get_state()[i] == approximately(ta1.get_state()[i], 1000.));
+            REQUIRE(b.get(2).get_state()[i] == approximately(ta2.get_state()[i], 1000.));
+        }
+        for (auto i = 0u; i < 4u; ++i) {
+            REQUIRE(b.get_batch(0).get_state()[i] == approximately(tab.get_state()[i], 1000.));
+        }
+
+        // The lazily-compiled functions.
+        b.get(0).update_d_output(9.5);
+        ta0.update_d_output(9.5);
+        REQUIRE(b.get(0).get_d_output()[0] == approximately(ta0.get_d_output()[0], 1000.));
+        b.get_batch(0).update_d_output({9.5, 9.5});
+        tab.update_d_output({9.5, 9.5});
+        REQUIRE(b.get_batch(0).get_d_output()[0] == approximately(tab.get_d_output()[0], 1000.));
+
+        // Copies.
+        auto ta_copy = b.get(1);
+        REQUIRE(ta_copy.get_llvm_state().get_symbol_prefix() == "heyoka.multi.1.");
+        ta_copy.propagate_until(20.);
+        b.get(1).propagate_until(20.);
+        REQUIRE(ta_copy.get_state() == b.get(1).get_state());
+
+        // Serialisation.
+        std::stringstream ss;
+        b.get(0).save(ss);
+
+        taylor_adaptive<double> ta_load;
+        ta_load.load(ss);
+        REQUIRE(ta_load.get_llvm_state().get_symbol_prefix() == "heyoka.multi.0.");
+
+        ta_load.propagate_until(20.);
+        b.get(0).propagate_until(20.);
+        REQUIRE(ta_load.get_state() == b.get(0).get_state());
+    }
+}
+
+TEST_CASE("taylor multi llvm_state")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    // Linking of the module of an integrator into another state.
+    auto ta = taylor_adaptive<double>{{prime(x) = v, prime(v) = -x}, {0., 1.}};
+
+    llvm_state s;
+    REQUIRE_THROWS_AS(s.link_module(ta.get_llvm_state(), "p."), std::invalid_argument);
+    REQUIRE_THROWS_AS(s.link_module(s, "p."), std::invalid_argument);
+
+    auto s2 = ta.get_llvm_state().uncompiled_copy();
+    REQUIRE_THROWS_AS(s.link_module(s2, ""), std::invalid_argument);
+    s.link_module(s2, "p.");
+    s.compile();
+
+    REQUIRE_THROWS_AS(s.jit_lookup("step"), std::invalid_argument);
+    s.set_symbol_prefix("p.");
+    REQUIRE(s.get_symbol_prefix() == "p.");
+    REQUIRE(s.jit_lookup("step") != 0u);
+    REQUIRE(s.jit_lookup("d_out_f") != 0u);
+
+    std::ostringstream oss;
+    oss << s;
+    REQUIRE(oss.str().find("Symbol prefix      : p.") != std::string::npos);
+}
+
+TEST_CASE("taylor multi errors")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    const auto osc = std::vector{prime(x) = v, prime(v) = -x};
+
+    taylor_multi_builder<double> b;
+
+    REQUIRE_THROWS_AS(b.compile(), std::invalid_argument);
+    REQUIRE_THROWS_AS(b.add(osc, {0., 1.}, kw::fast_math = true), std::invalid_argument);
+    REQUIRE_THROWS_AS(b.add(osc, {0., 1.}, kw::pgo_steps = 10u), std::invalid_argument);
+    REQUIRE_THROWS_AS(b.add_batch(osc, {0., 0., 1., 1.}, 2, kw::pgo_steps = 10u), std::invalid_argument);
+    REQUIRE(b.get_n_integrators() == 0u);
+    REQUIRE(b.get_n_batch_integrators() == 0u);
+
+    b.add(osc, {0., 1.});
+    REQUIRE_THROWS_AS(b.get(0), std::invalid_argument);
+
+    b.compile();
+
+    REQUIRE_THROWS_AS(b.compile(), std::invalid_argument);
+    REQUIRE_THROWS_AS(b.add(osc, {0., 1.}), std::invalid_argument);
+    REQUIRE_THROWS_AS(b.get(1), std::out_of_range);
+    REQUIRE_THROWS_AS(b.get_batch(0), std::out_of_range);
+
+    llvm_state s;
+    s.compile();
+    REQUIRE_THROWS_AS(taylor_multi_builder<double>{s}, std::invalid_argument);
+}
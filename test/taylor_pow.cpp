@@ -46,7 +46,7 @@ const auto fp_types = std::tuple<double, long double
 template <typename T, typename U>
 void compare_batch_scalar(std::initializer_list<U> sys, unsigned opt_level, bool high_accuracy, bool compact_mode)
 {
-    for (auto batch_size : {2u, 4u, 8u, 23u}) {
+    for (auto batch_size : {2u, 3u, 4u, 5u, 8u, 23u}) {
         llvm_state s{kw::opt_level = opt_level};
 
         taylor_add_jet<T>(s, "jet_batch", sys, 3, batch_size, high_accuracy, compact_mode);
@@ -704,3 +704,55 @@ TEST_CASE("taylor pow")
         }
     }
 }
+
+// Test the dedicated implementation of the exponent -3/2,
+// comparing it to the generic implementation (which is used
+// if the exponent is a param).
+// Test the dedicated implementations for the exponents
+// 2, -1, -1/2 and -3/2 against the generic one.
+TEST_CASE("taylor pow special exponents")
+{
+    auto tester = [](auto fp_x, unsigned opt_level, bool high_accuracy, bool compact_mode) {
+        using fp_t = decltype(fp_x);
+
+        auto x = "x"_var, y = "y"_var;
+
+        const auto order = 6u;
+
+        for (auto ex : {fp_t{2}, fp_t{-1}, fp_t{-1} / 2, fp_t{-3} / 2}) {
+            for (auto batch_size : {1u, 2u, 4u}) {
+                llvm_state s{kw::opt_level = opt_level};
+
+                taylor_add_jet<fp_t>(s, "jet", {prime(x) = pow(y, expression{number{ex}}), prime(y) = pow(y, par[0])},
+                                     order, batch_size, high_accuracy, compact_mode);
+
+                s.compile();
+
+                auto jptr = reinterpret_cast<void (*)(fp_t *, const fp_t *, const fp_t *)>(s.jit_lookup("jet"));
+
+                std::vector<fp_t> jet((order + 1u) * 2u * batch_size);
+                std::uniform_real_distribution<float> dist(.1f, 20.f);
+                for (auto i = 0u; i < 2u * batch_size; ++i) {
+                    jet[i] = fp_t{dist(rng)};
+                }
+                const std::vector<fp_t> pars(batch_size, ex);
+
+                jptr(jet.data(), pars.data(), nullptr);
+
+                for (auto o = 1u; o <= order; ++o) {
+                    for (auto i = 0u; i < batch_size; ++i) {
+                        REQUIRE(jet[o * 2u * batch_size + i]
+                                == approximately(jet[o * 2u * batch_size + batch_size + i], fp_t{1000}));
+                    }
+                }
+            }
+        }
+    };
+
+    for (auto cm : {false, true}) {
+        for (auto f : {false, true}) {
+            tuple_for_each(fp_types, [&tester, f, cm](auto x) { tester(x, 0, f, cm); });
+            tuple_for_each(fp_types, [&tester, f, cm](auto x) { tester(x, 3, f, cm); });
+        }
+    }
+}
@@ -0,0 +1,155 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <cstdint>
+#include <initializer_list>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include <heyoka/expression.hpp>
+#include <heyoka/llvm_state.hpp>
+#include <heyoka/math/sin.hpp>
+#include <heyoka/number.hpp>
+#include <heyoka/param.hpp>
+#include <heyoka/taylor.hpp>
+
+#include "catch.hpp"
+#include "test_utils.hpp"
+
+using namespace heyoka;
+using namespace heyoka_test;
+
+TEST_CASE("taylor precomputed dc")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    const auto sys = std::vector{prime(x) = v, prime(v) = -par[0] * sin(x)};
+
+    for (auto cm : {false, true}) {
+        auto ta = taylor_adaptive<double>{sys, {0.05, 0.025}, kw::compact_mode = cm, kw::pars = {9.8}};
+        auto ta_dc = taylor_adaptive<double>{ta.get_decomposition(), {0.05, 0.025}, kw::compact_mode = cm,
+                                             kw::pars = {9.8}};
+
+        REQUIRE(ta_dc.get_decomposition() == ta.get_decomposition());
+        REQUIRE(ta_dc.get_order() == ta.get_order());
+        REQUIRE(ta_dc.get_dim() == 2u);
+
+        ta.propagate_until(10.);
+        ta_dc.propagate_until(10.);
+        REQUIRE(ta_dc.get_state() == ta.get_state());
+
+        // Batch mode.
+        auto tab = taylor_adaptive_batch<double>{
+            sys, {0.05, 0.06, 0.025, 0.026}, 2, kw::compact_mode = cm, kw::pars = {9.8, 9.8}};
+        auto tab_dc = taylor_adaptive_batch<double>{tab.get_decomposition(), {0.05, 0.06, 0.025, 0.026}, 2,
+                                                    kw::compact_mode = cm, kw::pars = {9.8, 9.8}};
+
+        REQUIRE(tab_dc.get_decomposition() == tab.get_decomposition());
+
+        tab.propagate_until({10., 10.});
+        tab_dc.propagate_until({10., 10.});
+        REQUIRE(tab_dc.get_state() == tab.get_state());
+
+        // Jet.
+        llvm_state s;
+        REQUIRE(taylor_add_jet<double>(s, "jet", ta.get_decomposition(), 3, 1, false, cm) == ta.get_decomposition());
+        taylor_add_jet<double>(s, "jet_sys", sys, 3, 1, false, cm);
+        s.compile();
+
+        auto jet = reinterpret_cast<void (*)(double *, const double *, const double *)>(s.jit_lookup("jet"));
+        auto jet_sys = reinterpret_cast<void (*)(double *, const double *, const double *)>(s.jit_lookup("jet_sys"));
+
+        std::vector<double> jv(8u), jv_sys(8u), pars{9.8};
+        jv[0] = jv_sys[0] = 0.05;
+        jv[1] = jv_sys[1] = 0.025;
+        jet(jv.data(), pars.data(), nullptr);
+        jet_sys(jv_sys.data(), pars.data(), nullptr);
+        REQUIRE(jv == jv_sys);
+    }
+}
+
+TEST_CASE("taylor precomputed dc serialisation")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    auto ta = taylor_adaptive<double>{{prime(x) = v, prime(v) = -9.8 * sin(x)}, {0.05, 0.025}};
+
+    std::stringstream ss;
+    taylor_save_dc(ss, ta.get_decomposition());
+
+    const auto dc = taylor_load_dc(ss);
+    REQUIRE(dc == ta.get_decomposition());
+
+    auto ta_dc = taylor_adaptive<double>{dc, {0.05, 0.025}};
+
+    ta.propagate_until(10.);
+    ta_dc.propagate_until(10.);
+    REQUIRE(ta_dc.get_state() == ta.get_state());
+
+    // A decomposition with no u variables besides
+    // the state variables and the right-hand sides.
+    auto ta_lin = taylor_adaptive<double>{{prime(x) = v, prime(v) = x}, {0.05, 0.025}};
+    REQUIRE(ta_lin.get_decomposition().size() == 4u);
+
+    auto ta_lin_dc = taylor_adaptive<double>{ta_lin.get_decomposition(), {0.05, 0.025}};
+    REQUIRE(ta_lin_dc.get_dim() == 2u);
+
+    // Wrong tag.
+    std::stringstream ss2;
+    ta.save(ss2);
+    REQUIRE_THROWS_AS(taylor_load_dc(ss2), std::invalid_argument);
+}
+
+TEST_CASE("taylor precomputed dc errors")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    auto ta = taylor_adaptive<double>{{prime(x) = v, prime(v) = -par[0] * sin(x)}, {0.05, 0.025}};
+    const auto &dc = ta.get_decomposition();
+
+    // Wrong number of parameters.
+    REQUIRE_THROWS_AS((taylor_adaptive<double>{dc, {0.05, 0.025}}), std::invalid_argument);
+    REQUIRE_THROWS_AS((taylor_adaptive<double>{dc, {0.05, 0.025}, kw::pars = {1., 2.}}), std::invalid_argument);
+
+    // Wrong state size.
+    REQUIRE_THROWS_AS((taylor_adaptive<double>{dc, {0.05}, kw::pars = {9.8}}), std::invalid_argument);
+
+    // Simplification.
+    REQUIRE_THROWS_AS((taylor_adaptive<double>{dc, {0.05, 0.025}, kw::pars = {9.8}, kw::simplify = true}),
+                      std::invalid_argument);
+
+    // Events.
+    using ev_t = taylor_adaptive<double>::nt_event_t;
+    REQUIRE_THROWS_AS((taylor_adaptive<double>{dc,
+                                               {0.05, 0.025},
+                                               kw::pars = {9.8},
+                                               kw::nt_events = std::vector<ev_t>{ev_t(v, [](auto &, double) {})}}),
+                      std::invalid_argument);
+
+    // Invalid decompositions.
+    REQUIRE_THROWS_AS((taylor_adaptive<double>{taylor_dc_t{}, {}}), std::invalid_argument);
+
+    auto bad_dc = dc;
+    bad_dc[1].first = x;
+    REQUIRE_THROWS_AS((taylor_adaptive<double>{bad_dc, {0.05, 0.025}, kw::pars = {9.8}}), std::invalid_argument);
+
+    bad_dc = dc;
+    bad_dc.back().first = "u_100"_var;
+    REQUIRE_THROWS_AS((taylor_adaptive<double>{bad_dc, {0.05, 0.025}, kw::pars = {9.8}}), std::invalid_argument);
+
+    bad_dc = dc;
+    bad_dc[2].second.push_back(0);
+    REQUIRE_THROWS_AS((taylor_adaptive<double>{bad_dc, {0.05, 0.025}, kw::pars = {9.8}}), std::invalid_argument);
+
+    llvm_state s;
+    bad_dc = dc;
+    bad_dc.back().first = x;
+    REQUIRE_THROWS_AS(taylor_add_jet<double>(s, "jet", bad_dc, 3, 1, false, false), std::invalid_argument);
+}
@@ -0,0 +1,149 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <cmath>
+#include <initializer_list>
+#include <limits>
+#include <stdexcept>
+#include <tuple>
+#include <vector>
+
+#include <heyoka/expression.hpp>
+#include <heyoka/taylor.hpp>
+
+#include "catch.hpp"
+#include "test_utils.hpp"
+
+using namespace heyoka;
+using namespace heyoka_test;
+
+TEST_CASE("propagate grid scalar")
+{
+    using std::cos;
+    using std::sin;
+
+    auto [x, v] = make_vars("x", "v");
+
+    for (auto cm : {false, true}) {
+        for (auto ha : {false, true}) {
+            auto ta = taylor_adaptive<double>{
+                {prime(x) = v, prime(v) = -x}, {0., 1.}, kw::high_accuracy = ha, kw::compact_mode = cm};
+
+            // Error handling.
+            REQUIRE_THROWS_AS(ta.propagate_grid({}), std::invalid_argument);
+            REQUIRE_THROWS_AS(ta.propagate_grid({0., std::numeric_limits<double>::infinity()}),
+                              std::invalid_argument);
+            REQUIRE_THROWS_AS(ta.propagate_grid({0., 2., 1.}), std::invalid_argument);
+
+            // Forward propagation.
+            std::vector<double> grid;
+            for (auto i = 0; i < 1000; ++i) {
+                grid.push_back(i / 10.);
+            }
+
+            auto [oc, min_h, max_h, n_steps, out] = ta.propagate_grid(grid);
+
+            REQUIRE(oc == taylor_outcome::time_limit);
+            REQUIRE(out.size() == 2000u);
+            REQUIRE(ta.get_time() == approximately(grid.back()));
+            // NOTE: the timesteps are not truncated at the grid points.
+            REQUIRE(n_steps < 1000u);
+
+            for (decltype(grid.size()) i = 0; i < grid.size(); ++i) {
+                REQUIRE(std::abs(out[2u * i] - sin(grid[i])) < 1e-12);
+                REQUIRE(std::abs(out[2u * i + 1u] - cos(grid[i])) < 1e-12);
+            }
+
+            // Backward propagation.
+            auto bgrid = grid;
+            for (auto &t : bgrid) {
+                t = -t;
+            }
+            ta.set_time(0.);
+            ta.get_state_data()[0] = 0;
+            ta.get_state_data()[1] = 1;
+
+            std::tie(oc, min_h, max_h, n_steps, out) = ta.propagate_grid(bgrid);
+
+            REQUIRE(oc == taylor_outcome::time_limit);
+            REQUIRE(out.size() == 2000u);
+
+            for (decltype(bgrid.size()) i = 0; i < bgrid.size(); ++i) {
+                REQUIRE(std::abs(out[2u * i] - sin(bgrid[i])) < 1e-12);
+                REQUIRE(std::abs(out[2u * i + 1u] - cos(bgrid[i])) < 1e-12);
+            }
+
+            // Step limit.
+            ta.set_time(0.);
+            ta.get_state_data()[0] = 0;
+            ta.get_state_data()[1] = 1;
+
+            std::tie(oc, min_h, max_h, n_steps, out) = ta.propagate_grid(grid, 5);
+
+            REQUIRE(oc == taylor_outcome::step_limit);
+            REQUIRE(n_steps == 5u);
+            REQUIRE(out.size() < 2000u);
+            REQUIRE(out.size() % 2u == 0u);
+
+            for (decltype(out.size()) i = 0; i < out.size() / 2u; ++i) {
+                REQUIRE(std::abs(out[2u * i] - sin(grid[i])) < 1e-12);
+                REQUIRE(std::abs(out[2u * i + 1u] - cos(grid[i])) < 1e-12);
+            }
+        }
+    }
+}
+
+TEST_CASE("propagate grid batch")
+{
+    using std::cos;
+    using std::sin;
+
+    auto [x, v] = make_vars("x", "v");
+
+    for (auto batch_size : {1u, 4u, 5u}) {
+        for (auto cm : {false, true}) {
+            std::vector<double> init_state(2u * batch_size);
+            for (auto i = 0u; i < batch_size; ++i) {
+                init_state[batch_size + i] = 1;
+            }
+
+            auto ta = taylor_adaptive_batch<double>{
+                {prime(x) = v, prime(v) = -x}, init_state, batch_size, kw::compact_mode = cm};
+
+            // Error handling.
+            REQUIRE_THROWS_AS(ta.propagate_grid({}), std::invalid_argument);
+            REQUIRE_THROWS_AS(ta.propagate_grid(std::vector<double>(batch_size + 1u)), std::invalid_argument);
+
+            // Build a grid with a different final time for each batch element.
+            const auto n_points = 500u;
+            std::vector<double> grid(n_points * batch_size);
+            for (auto k = 0u; k < n_points; ++k) {
+                for (auto i = 0u; i < batch_size; ++i) {
+                    grid[k * batch_size + i] = k / (10. + i);
+                }
+            }
+
+            auto out = ta.propagate_grid(grid);
+
+            REQUIRE(out.size() == n_points * 2u * batch_size);
+
+            for (const auto &res : ta.get_propagate_res()) {
+                REQUIRE(std::get<0>(res) == taylor_outcome::time_limit);
+            }
+
+            for (auto k = 0u; k < n_points; ++k) {
+                for (auto i = 0u; i < batch_size; ++i) {
+                    const auto t = grid[k * batch_size + i];
+
+                    REQUIRE(std::abs(out[k * 2u * batch_size + i] - sin(t)) < 1e-12);
+                    REQUIRE(std::abs(out[k * 2u * batch_size + batch_size + i] - cos(t)) < 1e-12);
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,98 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <heyoka/config.hpp>
+
+#include <cmath>
+#include <initializer_list>
+#include <random>
+#include <tuple>
+#include <vector>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <heyoka/expression.hpp>
+#include <heyoka/llvm_state.hpp>
+#include <heyoka/math/rsqrt.hpp>
+#include <heyoka/math/pow.hpp>
+#include <heyoka/taylor.hpp>
+
+#include "catch.hpp"
+#include "test_utils.hpp"
+
+static std::mt19937 rng;
+
+using namespace heyoka;
+using namespace heyoka_test;
+
+const auto fp_types = std::tuple<double, long double
+#if defined(HEYOKA_HAVE_REAL128)
+                                 ,
+                                 mppp::real128
+#endif
+                                 >{};
+
+TEST_CASE("rsqrt def")
+{
+    auto x = "x"_var;
+
+    REQUIRE(rsqrt(x) == pow(x, -.5_dbl));
+    REQUIRE(rsqrt(x + 1_dbl) == pow(x + 1_dbl, -.5_dbl));
+}
+
+TEST_CASE("taylor rsqrt")
+{
+    auto tester = [](auto fp_x, unsigned opt_level, bool high_accuracy, bool compact_mode, bool fast_math) {
+        using fp_t = decltype(fp_x);
+
+        auto x = "x"_var, y = "y"_var;
+
+        for (auto batch_size : {1u, 2u, 4u}) {
+            llvm_state s{kw::opt_level = opt_level, kw::fast_math = fast_math};
+
+            taylor_add_jet<fp_t>(s, "jet", {prime(x) = rsqrt(y), prime(y) = x}, 2, batch_size, high_accuracy,
+                                 compact_mode);
+
+            s.compile();
+
+            auto jptr = reinterpret_cast<void (*)(fp_t *, const fp_t *, const fp_t *)>(s.jit_lookup("jet"));
+
+            std::vector<fp_t> jet(6u * batch_size);
+            std::uniform_real_distribution<float> dist(.1f, 20.f);
+            for (auto i = 0u; i < 2u * batch_size; ++i) {
+                jet[i] = fp_t{dist(rng)};
+            }
+
+            jptr(jet.data(), nullptr, nullptr);
+
+            for (auto i = 0u; i < batch_size; ++i) {
+                using std::sqrt;
+
+                const auto x0 = jet[i], y0 = jet[batch_size + i];
+
+                REQUIRE(jet[2u * batch_size + i] == approximately(1 / sqrt(y0), fp_t{100}));
+                REQUIRE(jet[3u * batch_size + i] == approximately(x0, fp_t{100}));
+                REQUIRE(jet[4u * batch_size + i] == approximately(-x0 / (4 * y0 * sqrt(y0)), fp_t{100}));
+                REQUIRE(jet[5u * batch_size + i] == approximately(1 / (2 * sqrt(y0)), fp_t{100}));
+            }
+        }
+    };
+
+    for (auto cm : {false, true}) {
+        for (auto f : {false, true}) {
+            tuple_for_each(fp_types, [&tester, f, cm](auto x) { tester(x, 0, f, cm, false); });
+            tuple_for_each(fp_types, [&tester, f, cm](auto x) { tester(x, 3, f, cm, false); });
+        }
+
+        tester(1., 3, false, cm, true);
+    }
+}
@@ -0,0 +1,158 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <initializer_list>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+#include <heyoka/expression.hpp>
+#include <heyoka/llvm_state.hpp>
+#include <heyoka/math/cos.hpp>
+#include <heyoka/math/pow.hpp>
+#include <heyoka/math/sin.hpp>
+#include <heyoka/math/time.hpp>
+#include <heyoka/taylor.hpp>
+
+#include "catch.hpp"
+#include "test_utils.hpp"
+
+using namespace heyoka;
+using namespace heyoka_test;
+
+TEST_CASE("taylor scalar serialization")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    for (auto cm : {false, true}) {
+        for (auto so : {false, true}) {
+            auto ta = taylor_adaptive<double>{{prime(x) = v, prime(v) = -9.8 * sin(x) + par[0] * cos(heyoka::time)},
+                                              {0.05, 0.025},
+                                              kw::compact_mode = cm,
+                                              kw::save_object_code = so,
+                                              kw::pars = std::vector{0.1}};
+
+            ta.propagate_until(1.);
+
+            std::stringstream ss;
+            ta.save(ss);
+
+            taylor_adaptive<double> ta2;
+            ta2.load(ss);
+
+            REQUIRE(ta2.get_state() == ta.get_state());
+            REQUIRE(ta2.get_time() == ta.get_time());
+            REQUIRE(ta2.get_pars() == ta.get_pars());
+            REQUIRE(ta2.get_tc() == ta.get_tc());
+            REQUIRE(ta2.get_last_h() == ta.get_last_h());
+            REQUIRE(ta2.get_order() == ta.get_order());
+            REQUIRE(ta2.get_dim() == ta.get_dim());
+            REQUIRE(ta2.get_decomposition() == ta.get_decomposition());
+            REQUIRE(ta2.get_llvm_state().is_compiled());
+            REQUIRE(ta2.get_llvm_state().get_ir() == ta.get_llvm_state().get_ir());
+
+            // The restored integrator behaves exactly like the original one.
+            ta.propagate_until(10.);
+            ta2.propagate_until(10.);
+
+            REQUIRE(ta2.get_state() == ta.get_state());
+
+            ta.update_d_output(9.5);
+            ta2.update_d_output(9.5);
+            REQUIRE(ta2.get_d_output() == ta.get_d_output());
+        }
+    }
+
+    // Error modes.
+    {
+        using ev_t = taylor_adaptive<double>::nt_event_t;
+
+        auto ta = taylor_adaptive<double>{{prime(x) = v, prime(v) = -9.8 * sin(x)},
+                                          {0.05, 0.025},
+                                          kw::nt_events = std::vector<ev_t>{ev_t(v, [](auto &, double) {})}};
+
+        std::stringstream ss;
+        REQUIRE_THROWS_AS(ta.save(ss), std::invalid_argument);
+    }
+
+    {
+        taylor_adaptive<double> ta;
+        const auto orig_state = ta.get_state();
+
+        std::stringstream ss;
+        ss << "garbage";
+        REQUIRE_THROWS_AS(ta.load(ss), std::invalid_argument);
+        REQUIRE(ta.get_state() == orig_state);
+
+        // Mismatched integrator type.
+        ss.str("");
+        ss.clear();
+        taylor_adaptive_batch<double>{}.save(ss);
+        REQUIRE_THROWS_AS(ta.load(ss), std::invalid_argument);
+
+        // Mismatched floating-point type.
+        ss.str("");
+        ss.clear();
+        taylor_adaptive<long double>{}.save(ss);
+        REQUIRE_THROWS_AS(ta.load(ss), std::invalid_argument);
+    }
+}
+
+TEST_CASE("taylor batch serialization")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    for (auto cm : {false, true}) {
+        auto ta = taylor_adaptive_batch<double>{{prime(x) = v, prime(v) = -9.8 * sin(x) + pow(x, 3_dbl)},
+                                                {0.05, 0.06, 0.025, 0.026},
+                                                2,
+                                                kw::compact_mode = cm};
+
+        ta.propagate_until({1., 2.});
+
+        std::stringstream ss;
+        ta.save(ss);
+
+        taylor_adaptive_batch<double> ta2;
+        ta2.load(ss);
+
+        REQUIRE(ta2.get_batch_size() == 2u);
+        REQUIRE(ta2.get_state() == ta.get_state());
+        REQUIRE(ta2.get_time() == ta.get_time());
+        REQUIRE(ta2.get_tc() == ta.get_tc());
+        REQUIRE(ta2.get_decomposition() == ta.get_decomposition());
+
+        ta.propagate_until({10., 11.});
+        ta2.propagate_until({10., 11.});
+
+        REQUIRE(ta2.get_state() == ta.get_state());
+        REQUIRE(ta2.get_propagate_res() == ta.get_propagate_res());
+    }
+}
+
+TEST_CASE("llvm_state serialization")
+{
+    auto [x, y] = make_vars("x", "y");
+
+    // Uncompiled state.
+    llvm_state s{kw::mname = "foo", kw::opt_level = 1u};
+    taylor_add_jet_dbl(s, "jet", {prime(x) = y, prime(y) = x}, 3, 1, false, false);
+
+    std::stringstream ss;
+    s.save(ss);
+
+    llvm_state s2;
+    s2.load(ss);
+
+    REQUIRE(!s2.is_compiled());
+    REQUIRE(s2.opt_level() == 1u);
+    REQUIRE(s2.get_ir() == s.get_ir());
+
+    s2.compile();
+    REQUIRE(s2.jit_lookup("jet") != 0u);
+}
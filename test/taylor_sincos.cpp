@@ -11,6 +11,7 @@
 #include <cmath>
 #include <initializer_list>
 #include <random>
+#include <string>
 #include <tuple>
 #include <vector>
 
@@ -44,7 +45,7 @@ const auto fp_types = std::tuple<double, long double
 template <typename T, typename U>
 void compare_batch_scalar(std::initializer_list<U> sys, unsigned opt_level, bool high_accuracy, bool compact_mode)
 {
-    for (auto batch_size : {2u, 4u, 8u, 23u}) {
+    for (auto batch_size : {2u, 3u, 4u, 5u, 8u, 23u}) {
         llvm_state s{kw::opt_level = opt_level};
 
         taylor_add_jet<T>(s, "jet_batch", sys, 3, batch_size, high_accuracy, compact_mode);
@@ -554,3 +555,52 @@ TEST_CASE("taylor sincos cse")
             == approximately((cos(jet[1]) * jet[3] - sin(jet[0]) * jet[2] + cos(jet[0]) * jet[2] - sin(jet[1]) * jet[3])
                              / 2));
 }
+
+// Test the computation of sin() and cos() via a single sincos() in batch mode.
+TEST_CASE("taylor sincos fused")
+{
+    using std::cos;
+    using std::sin;
+
+    auto [x, y] = make_vars("x", "y");
+
+    for (auto batch_size : {2u, 4u, 8u}) {
+        llvm_state s;
+
+        taylor_add_jet<double>(s, "jet", {sin(y), cos(x)}, 2, batch_size, false, false);
+
+        s.optimise();
+
+        // If sincos() is being used, the sin() and cos() of the
+        // same argument must result in a single sincos() invocation.
+        const auto ir = s.get_ir();
+        auto n_calls = 0;
+        for (auto pos = ir.find("call {"); pos != std::string::npos; pos = ir.find("call {", pos + 1u)) {
+            if (ir.compare(ir.find('@', pos), 20, "@heyoka_Sleef_sincos") == 0) {
+                ++n_calls;
+            }
+        }
+        REQUIRE(n_calls <= 2);
+
+        s.compile();
+
+        auto jptr = reinterpret_cast<void (*)(double *, const double *, const double *)>(s.jit_lookup("jet"));
+
+        std::vector<double> jet(6u * batch_size);
+        std::uniform_real_distribution<double> dist(-10., 10.);
+        for (auto i = 0u; i < 2u * batch_size; ++i) {
+            jet[i] = dist(rng);
+        }
+
+        jptr(jet.data(), nullptr, nullptr);
+
+        for (auto i = 0u; i < batch_size; ++i) {
+            const auto xv = jet[i], yv = jet[batch_size + i];
+
+            REQUIRE(jet[2u * batch_size + i] == approximately(sin(yv)));
+            REQUIRE(jet[3u * batch_size + i] == approximately(cos(xv)));
+            REQUIRE(jet[4u * batch_size + i] == approximately(cos(yv) * jet[3u * batch_size + i] / 2));
+            REQUIRE(jet[5u * batch_size + i] == approximately(-sin(xv) * jet[2u * batch_size + i] / 2));
+        }
+    }
+}
@@ -0,0 +1,96 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <cmath>
+#include <cstddef>
+#include <sstream>
+#include <stdexcept>
+#include <tuple>
+#include <vector>
+
+#include <heyoka/expression.hpp>
+#include <heyoka/math.hpp>
+#include <heyoka/taylor.hpp>
+
+#include "catch.hpp"
+
+using namespace heyoka;
+
+TEST_CASE("taylor stats")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    const auto sys = {prime(x) = v, prime(v) = -9.8 * sin(x)};
+
+    auto ta = taylor_adaptive<double>{sys, {0.05, 0.025}};
+
+    REQUIRE(!ta.stats_enabled());
+    REQUIRE_THROWS_AS(ta.get_stats(), std::invalid_argument);
+
+    ta.enable_stats();
+    REQUIRE(ta.stats_enabled());
+    REQUIRE(ta.get_stats().n_steps == 0u);
+
+    const auto n_steps = std::get<3>(ta.propagate_until(10.));
+
+    const auto &st = ta.get_stats();
+    REQUIRE(st.n_steps == n_steps);
+    // Only the last step is limited by the final time.
+    REQUIRE(st.n_time_limited == 1u);
+    REQUIRE(st.n_terminal_events == 0u);
+    REQUIRE(st.n_errors == 0u);
+    REQUIRE(st.n_zero_h == 0u);
+    REQUIRE(st.step_time > 0);
+    REQUIRE(st.min_step_time <= st.max_step_time);
+    REQUIRE(st.lane_n_active.empty());
+
+    std::size_t n_hist = 0;
+    for (const auto &[e, n] : st.h_hist) {
+        n_hist += n;
+    }
+    REQUIRE(n_hist == n_steps);
+
+    // A zero timestep.
+    ta.step(0.);
+    REQUIRE(ta.get_stats().n_steps == n_steps + 1u);
+    REQUIRE(ta.get_stats().n_zero_h == 1u);
+
+    std::ostringstream oss;
+    oss << ta.get_stats();
+    REQUIRE(!oss.str().empty());
+
+    // The statistics are copied.
+    auto ta_copy = ta;
+    REQUIRE(ta_copy.stats_enabled());
+    REQUIRE(ta_copy.get_stats().n_steps == n_steps + 1u);
+
+    ta.reset_stats();
+    REQUIRE(ta.get_stats().n_steps == 0u);
+    REQUIRE(ta.get_stats().h_hist.empty());
+
+    ta.disable_stats();
+    REQUIRE(!ta.stats_enabled());
+
+    // Batch mode: the first lane reaches its final
+    // time earlier than the second one.
+    auto tab = taylor_adaptive_batch<double>{sys, {0.05, 0.06, 0.025, 0.026}, 2};
+    tab.enable_stats();
+    REQUIRE(tab.get_stats().lane_n_active.size() == 2u);
+
+    tab.propagate_until({1., 10.});
+
+    const auto &bst = tab.get_stats();
+    REQUIRE(bst.lane_n_active[0] == std::get<3>(tab.get_propagate_res()[0]));
+    REQUIRE(bst.lane_n_active[1] == std::get<3>(tab.get_propagate_res()[1]));
+    REQUIRE(bst.lane_n_active[0] < bst.lane_n_active[1]);
+    REQUIRE(bst.n_steps == bst.lane_n_active[1]);
+    REQUIRE(bst.n_zero_h == bst.n_steps - bst.lane_n_active[0]);
+
+    tab.reset_stats();
+    REQUIRE(tab.get_stats().lane_n_active == std::vector<std::size_t>{0, 0});
+}
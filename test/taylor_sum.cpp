@@ -0,0 +1,241 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <heyoka/config.hpp>
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <heyoka/compiled_function.hpp>
+#include <heyoka/expression.hpp>
+#include <heyoka/llvm_state.hpp>
+#include <heyoka/math/square.hpp>
+#include <heyoka/math/sum.hpp>
+#include <heyoka/number.hpp>
+#include <heyoka/taylor.hpp>
+
+#include "catch.hpp"
+#include "test_utils.hpp"
+
+static std::mt19937 rng;
+
+using namespace heyoka;
+using namespace heyoka_test;
+
+const auto fp_types = std::tuple<double, long double
+#if defined(HEYOKA_HAVE_REAL128)
+                                 ,
+                                 mppp::real128
+#endif
+                                 >{};
+
+TEST_CASE("sum basic")
+{
+    auto [x, y] = make_vars("x", "y");
+
+    REQUIRE(sum({}) == 0_dbl);
+    REQUIRE(sum({x}) == x);
+    REQUIRE(sum_sq({}) == 0_dbl);
+    REQUIRE(sum_sq({x}) == square(x));
+
+    std::ostringstream oss;
+    oss << sum({x, y, par[0]});
+    REQUIRE(oss.str() == "sum(x, y, p0)");
+
+    REQUIRE(diff(sum({x, y * x, 2_dbl}), "x") == sum({1_dbl, diff(y * x, "x"), 0_dbl}));
+    REQUIRE(diff(sum_sq({x, y}), "y") == 2_dbl * sum({0_dbl, y}));
+}
+
+// Compare the jets of the systems sys and sys_ref, which are
+// expected to be mathematically equivalent.
+template <typename T>
+void compare_jets(const std::vector<expression> &sys, const std::vector<expression> &sys_ref, unsigned opt_level,
+                  bool high_accuracy, bool compact_mode)
+{
+    const auto order = 5u;
+
+    for (auto batch_size : {1u, 2u, 4u}) {
+        llvm_state s{kw::opt_level = opt_level};
+
+        taylor_add_jet<T>(s, "jet", sys, order, batch_size, high_accuracy, compact_mode);
+        taylor_add_jet<T>(s, "jet_ref", sys_ref, order, batch_size, high_accuracy, compact_mode);
+
+        s.compile();
+
+        auto jptr = reinterpret_cast<void (*)(T *, const T *, const T *)>(s.jit_lookup("jet"));
+        auto jptr_ref = reinterpret_cast<void (*)(T *, const T *, const T *)>(s.jit_lookup("jet_ref"));
+
+        std::uniform_real_distribution<float> dist(-1.f, 1.f);
+
+        std::vector<T> jet((order + 1u) * 2u * batch_size), pars(batch_size);
+        for (auto i = 0u; i < 2u * batch_size; ++i) {
+            jet[i] = T{dist(rng)};
+        }
+        for (auto &p : pars) {
+            p = T{dist(rng)};
+        }
+        auto jet_ref = jet;
+
+        jptr(jet.data(), pars.data(), nullptr);
+        jptr_ref(jet_ref.data(), pars.data(), nullptr);
+
+        for (decltype(jet.size()) i = 0; i < jet.size(); ++i) {
+            REQUIRE(jet[i] == approximately(jet_ref[i], T(1000)));
+        }
+    }
+}
+
+TEST_CASE("taylor sum")
+{
+    auto tester = [](auto fp_x, unsigned opt_level, bool high_accuracy, bool compact_mode) {
+        using fp_t = decltype(fp_x);
+
+        auto [x, y] = make_vars("x", "y");
+
+        // Mixed arguments.
+        compare_jets<fp_t>({sum({x, y, par[0], 2_dbl}), sum_sq({y, x, par[0], 3_dbl})},
+                           {x + y + par[0] + 2_dbl, square(y) + square(x) + square(par[0]) + 9_dbl}, opt_level,
+                           high_accuracy, compact_mode);
+
+        // Repeated arguments and sums of numbers/params only.
+        compare_jets<fp_t>({sum({x, x, y}), sum_sq({par[0], 2_dbl})},
+                           {x + x + y, square(par[0]) + 4_dbl}, opt_level, high_accuracy, compact_mode);
+
+        // Nested sums.
+        compare_jets<fp_t>({sum({x * y, sum_sq({x, y}), y}), sum_sq({x - y, sum({x, y})})},
+                           {x * y + (x * x + y * y) + y, square(x - y) + square(x + y)}, opt_level, high_accuracy,
+                           compact_mode);
+    };
+
+    for (auto cm : {false, true}) {
+        for (auto f : {false, true}) {
+            tuple_for_each(fp_types, [&tester, f, cm](auto x) { tester(x, 0, f, cm); });
+            tuple_for_each(fp_types, [&tester, f, cm](auto x) { tester(x, 3, f, cm); });
+        }
+    }
+}
+
+// The pairwise sum of v, with the summation order of the code generation
+// of sum() on scalar values: for n >= 8 terms in double precision, the first
+// 4 * (n / 4) terms are summed pairwise as 4-wide vectors, which are then
+// reduced horizontally, and the leftover terms are summed with the result.
+template <typename T>
+T ref_pairwise_sum(std::vector<T> v, bool packed)
+{
+    if (packed && v.size() >= 8u) {
+        const auto n_vec = v.size() / 4u;
+
+        std::vector<T> lanes;
+        for (auto l = 0u; l < 4u; ++l) {
+            std::vector<T> tmp;
+            for (decltype(v.size()) i = 0; i < n_vec; ++i) {
+                tmp.push_back(v[i * 4u + l]);
+            }
+            lanes.push_back(ref_pairwise_sum(std::move(tmp), false));
+        }
+
+        std::vector<T> new_v(v.begin() + static_cast<std::ptrdiff_t>(n_vec * 4u), v.end());
+        new_v.push_back((lanes[0] + lanes[2]) + (lanes[1] + lanes[3]));
+        v.swap(new_v);
+    }
+
+    while (v.size() != 1u) {
+        std::vector<T> new_v;
+
+        for (decltype(v.size()) i = 0; i < v.size(); i += 2u) {
+            new_v.push_back(i + 1u == v.size() ? v[i] : v[i] + v[i + 1u]);
+        }
+
+        v.swap(new_v);
+    }
+
+    return v[0];
+}
+
+TEST_CASE("sum pairwise")
+{
+    using std::abs;
+
+    auto tester = [](auto fp_x, unsigned opt_level, std::uint32_t batch_size, unsigned n) {
+        using fp_t = decltype(fp_x);
+
+        std::vector<expression> vars;
+        for (auto i = 0u; i < n; ++i) {
+            vars.emplace_back("x_" + std::to_string(i));
+        }
+
+        compiled_function<fp_t> cf{
+            {sum(vars)}, kw::vars = vars, kw::opt_level = opt_level, kw::batch_size = batch_size};
+
+        // Terms with mixed signs and magnitudes, so that
+        // the summation order is visible in the result.
+        const auto n_points = 20u;
+        std::uniform_real_distribution<double> dist(-1., 1.);
+        std::uniform_int_distribution<int> edist(-20, 20);
+        std::vector<fp_t> in(n * n_points), out;
+        for (auto &x : in) {
+            x = std::ldexp(fp_t(dist(rng)), edist(rng));
+        }
+
+        cf.eval_batch(out, in, n_points);
+
+        // The vectorised summation applies only to scalar double values (NOTE:
+        // long double is mapped to double on some platforms).
+        const auto packed
+            = std::numeric_limits<fp_t>::digits == std::numeric_limits<double>::digits && batch_size == 1u;
+
+        for (auto p = 0u; p < n_points; ++p) {
+            std::vector<fp_t> terms;
+            for (auto i = 0u; i < n; ++i) {
+                terms.push_back(in[i * n_points + p]);
+            }
+
+            REQUIRE(out[p] == ref_pairwise_sum(terms, packed));
+
+            // Check the error bound of the pairwise summation,
+            // ceil(log2(n)) * eps * sum(|x_i|) (to first order), against
+            // a compensated sum in extended precision.
+            long double acc = 0, comp = 0, abs_sum = 0;
+            for (const auto &x : terms) {
+                const auto lx = static_cast<long double>(x);
+                const auto t = acc + lx;
+                comp += abs(acc) >= abs(lx) ? (acc - t) + lx : (lx - t) + acc;
+                acc = t;
+                abs_sum += abs(lx);
+            }
+
+            const auto bound = (std::ceil(std::log2(static_cast<long double>(n))) + 1)
+                               * static_cast<long double>(std::numeric_limits<fp_t>::epsilon()) * abs_sum;
+            REQUIRE(abs(static_cast<long double>(out[p]) - (acc + comp)) <= bound);
+        }
+    };
+
+    for (auto opt_level : {0u, 3u}) {
+        for (auto batch_size : {1u, 4u}) {
+            for (auto n : {8u, 9u, 13u, 16u}) {
+                tester(0., opt_level, batch_size, n);
+                tester(0.l, opt_level, batch_size, n);
+            }
+        }
+    }
+}
@@ -0,0 +1,149 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <cmath>
+#include <initializer_list>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+#include <heyoka/expression.hpp>
+#include <heyoka/math/cos.hpp>
+#include <heyoka/math/sin.hpp>
+#include <heyoka/math/tharm.hpp>
+#include <heyoka/math/time.hpp>
+#include <heyoka/math/tpoly.hpp>
+#include <heyoka/taylor.hpp>
+
+#include "catch.hpp"
+#include "test_utils.hpp"
+
+using namespace heyoka;
+using namespace heyoka_test;
+
+TEST_CASE("tharm")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    REQUIRE_THROWS_AS(tcos(x), std::invalid_argument);
+    REQUIRE_THROWS_AS(tsin(1_dbl, x + 1_dbl), std::invalid_argument);
+
+    REQUIRE(tcos(1_dbl) != tsin(1_dbl));
+    REQUIRE(diff(tcos(par[0], 1_dbl), "x") == 0_dbl);
+
+    std::ostringstream oss;
+    oss << tsin(2_dbl, par[1]);
+    REQUIRE(oss.str() == "sin(2.0000000000000000 * t + par[1])");
+
+    // Forced damped pendulum, with the forcing term expressed via the
+    // generic functions and via the harmonic functions of time.
+    const auto rhs_v = -sin(x) - .1 * v;
+
+    for (auto cm : {false, true}) {
+        auto ta0 = taylor_adaptive<double>{
+            {prime(x) = v, prime(v) = rhs_v + cos(par[0] * heyoka::time + .3) + sin(2. * heyoka::time)},
+            {0.1, 0.2},
+            kw::compact_mode = cm,
+            kw::pars = {1.5}};
+        auto ta1 = taylor_adaptive<double>{{prime(x) = v, prime(v) = rhs_v + tcos(par[0], .3_dbl) + tsin(2_dbl)},
+                                           {0.1, 0.2},
+                                           kw::compact_mode = cm,
+                                           kw::pars = {1.5}};
+
+        // The forcing terms do not add u variables.
+        REQUIRE(ta1.get_decomposition().size() < ta0.get_decomposition().size());
+
+        ta0.set_time(1.);
+        ta1.set_time(1.);
+
+        REQUIRE(std::get<0>(ta0.propagate_until(20.)) == taylor_outcome::time_limit);
+        REQUIRE(std::get<0>(ta1.propagate_until(20.)) == taylor_outcome::time_limit);
+
+        REQUIRE(ta1.get_state()[0] == approximately(ta0.get_state()[0], 10000.));
+        REQUIRE(ta1.get_state()[1] == approximately(ta0.get_state()[1], 10000.));
+    }
+
+    // Batch mode, with lane-specific frequencies.
+    for (auto cm : {false, true}) {
+        auto ta = taylor_adaptive_batch<double>{
+            {prime(x) = tsin(par[0], par[1])}, {0., 0.}, 2, kw::compact_mode = cm, kw::pars = {1., 2., .5, .5}};
+
+        ta.propagate_until({3., 3.});
+
+        // x(t) = (cos(phi) - cos(omega * t + phi)) / omega.
+        REQUIRE(ta.get_state()[0] == approximately((std::cos(.5) - std::cos(3. + .5)), 1000.));
+        REQUIRE(ta.get_state()[1] == approximately((std::cos(.5) - std::cos(6. + .5)) / 2., 1000.));
+    }
+
+    // Serialisation.
+    auto ta = taylor_adaptive<double>{{prime(x) = v, prime(v) = rhs_v + tcos(par[0], .3_dbl) + tsin(2_dbl)},
+                                      {0.1, 0.2},
+                                      kw::pars = {1.5}};
+
+    std::stringstream ss;
+    ta.save(ss);
+    taylor_adaptive<double> ta2;
+    ta2.load(ss);
+
+    ta.propagate_until(10.);
+    ta2.propagate_until(10.);
+    REQUIRE(ta2.get_state() == ta.get_state());
+}
+
+TEST_CASE("tpoly")
+{
+    auto [x] = make_vars("x");
+
+    REQUIRE_THROWS_AS(tpoly({}), std::invalid_argument);
+    REQUIRE_THROWS_AS(tpoly({1_dbl, x}), std::invalid_argument);
+
+    REQUIRE(diff(tpoly({1_dbl, par[0]}), "x") == 0_dbl);
+
+    std::ostringstream oss;
+    oss << tpoly({1_dbl, par[0]});
+    REQUIRE(oss.str() == "tpoly(1.0000000000000000, par[0])");
+
+    // x' = 1 + 2*t - 3*t**2 + 4*t**3, hence
+    // x(t) = x0 + t + t**2 - t**3 + t**4 (with x0 chosen
+    // so that x(1) = 0).
+    auto sol = [](double t) { return t + t * t - t * t * t + t * t * t * t - 2.; };
+
+    for (auto cm : {false, true}) {
+        auto ta = taylor_adaptive<double>{
+            {prime(x) = tpoly({1_dbl, par[0], -3_dbl, par[1]})}, {0.}, kw::compact_mode = cm, kw::pars = {2., 4.}};
+        ta.set_time(1.);
+
+        REQUIRE(std::get<0>(ta.propagate_until(3.)) == taylor_outcome::time_limit);
+        REQUIRE(ta.get_state()[0] == approximately(sol(3.), 1000.));
+    }
+
+    // Batch mode.
+    for (auto cm : {false, true}) {
+        auto ta = taylor_adaptive_batch<double>{{prime(x) = tpoly({1_dbl, 2_dbl, -3_dbl, 4_dbl})},
+                                                {0., 0.},
+                                                2,
+                                                kw::compact_mode = cm};
+        ta.set_time({1., 1.});
+
+        ta.propagate_until({2., 3.});
+        REQUIRE(ta.get_state()[0] == approximately(sol(2.), 1000.));
+        REQUIRE(ta.get_state()[1] == approximately(sol(3.), 1000.));
+    }
+
+    // Serialisation.
+    auto ta = taylor_adaptive<double>{{prime(x) = tpoly({1_dbl, par[0]})}, {0.}, kw::pars = {2.}};
+
+    std::stringstream ss;
+    ta.save(ss);
+    taylor_adaptive<double> ta2;
+    ta2.load(ss);
+
+    ta.propagate_until(3.);
+    ta2.propagate_until(3.);
+    REQUIRE(ta2.get_state() == ta.get_state());
+}
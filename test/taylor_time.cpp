@@ -302,3 +302,47 @@ TEST_CASE("taylor time")
         }
     }
 }
+
+// Jet of a system containing polynomials in time, whose
+// derivatives beyond the degrees of the polynomials are zero.
+TEST_CASE("taylor time poly")
+{
+    auto [x, y] = make_vars("x", "y");
+
+    for (auto cm : {false, true}) {
+        for (auto opt_level : {0u, 3u}) {
+            llvm_state s{kw::opt_level = opt_level};
+
+            taylor_add_jet<double>(s, "jet", {hy::time * hy::time, x + y}, 6, 1, false, cm);
+
+            s.compile();
+
+            auto jptr = reinterpret_cast<void (*)(double *, const double *, const double *)>(s.jit_lookup("jet"));
+
+            std::vector<double> jet{2., 3.};
+            jet.resize(14);
+
+            const double t = 1.5;
+
+            // NOTE: in compact mode, run the jet twice in order
+            // to check that the skipped derivatives stay zero.
+            for (auto i = 0; i < (cm ? 2 : 1); ++i) {
+                jptr(jet.data(), nullptr, &t);
+            }
+
+            REQUIRE(jet[0] == 2);
+            REQUIRE(jet[2] == approximately(t * t));
+            REQUIRE(jet[4] == approximately(t));
+            REQUIRE(jet[6] == approximately(1. / 3));
+
+            for (auto o = 4; o <= 6; ++o) {
+                REQUIRE(jet[2 * o] == 0);
+            }
+
+            REQUIRE(jet[1] == 3);
+            for (auto o = 1; o <= 6; ++o) {
+                REQUIRE(jet[2 * o + 1] == approximately((jet[2 * (o - 1)] + jet[2 * (o - 1) + 1]) / o));
+            }
+        }
+    }
+}
@@ -0,0 +1,152 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <cmath>
+#include <cstdio>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <heyoka/expression.hpp>
+#include <heyoka/math.hpp>
+#include <heyoka/taylor.hpp>
+#include <heyoka/taylor_traj.hpp>
+
+#include "catch.hpp"
+#include "test_utils.hpp"
+
+using namespace heyoka;
+using namespace heyoka_test;
+
+TEST_CASE("traj streaming")
+{
+    using std::cos;
+    using std::sin;
+
+    auto [x, v] = make_vars("x", "v");
+
+    const std::string fname = "heyoka_test_traj.bin";
+
+    // Harmonic oscillator: x(t) = cos(t), v(t) = -sin(t).
+    auto ta = taylor_adaptive<double>{{prime(x) = v, prime(v) = -x}, {1., 0.}};
+    ta.enable_checkpoints();
+
+    {
+        // NOTE: use small chunks, so that the
+        // file is grown several times.
+        taylor_traj_writer<double> w(fname, 2, ta.get_order(), 4);
+
+        // Stream the steps after each propagation.
+        for (auto t : {2.5, 5., 7.5, 10.}) {
+            ta.propagate_until(t);
+
+            w.append(ta.get_checkpoints());
+            ta.reset_checkpoints();
+        }
+
+        REQUIRE(w.get_n_steps() > 8u);
+
+        // The flushed steps are visible to a reader
+        // before the writer is closed.
+        w.flush();
+        taylor_traj_reader<double> r(fname);
+        REQUIRE(r.get_n_steps() == w.get_n_steps());
+
+        w.close();
+        REQUIRE_THROWS_MATCHES(w.add_step(10., 11., ta.get_tc().data()), std::invalid_argument,
+                               Catch::Matchers::Message("Cannot write a step into a closed trajectory writer"));
+    }
+
+    taylor_traj_reader<double> r(fname);
+    REQUIRE(r.get_dim() == 2u);
+    REQUIRE(r.get_order() == ta.get_order());
+    REQUIRE(r.get_bounds().first == 0.);
+    REQUIRE(r.get_bounds().second == 10.);
+
+    for (auto t : {0., 1.2, 3.7, 6.1, 9.9, 10.}) {
+        const auto &st = r(t);
+        REQUIRE(st[0] == approximately(cos(t), 1000.));
+        REQUIRE(st[1] == approximately(-sin(t), 1000.));
+    }
+
+    REQUIRE_THROWS_AS(r(10.5), std::invalid_argument);
+    REQUIRE_THROWS_MATCHES(taylor_traj_reader<long double>(fname), std::invalid_argument,
+                           Catch::Matchers::Message("The trajectory file '" + fname
+                                                    + "' was written with a floating-point type different from the "
+                                                      "type of the reader"));
+
+    // Contiguity checks.
+    {
+        taylor_traj_writer<double> w(fname, 2, ta.get_order());
+        w.add_step(0., 1., ta.get_tc().data());
+        REQUIRE_THROWS_AS(w.add_step(2., 3., ta.get_tc().data()), std::invalid_argument);
+        REQUIRE_THROWS_AS(w.add_step(1., 0.5, ta.get_tc().data()), std::invalid_argument);
+    }
+
+    std::remove(fname.c_str());
+}
+
+TEST_CASE("cheb traj")
+{
+    using std::abs;
+    using std::cos;
+    using std::sin;
+
+    auto [x, v] = make_vars("x", "v");
+
+    auto ta = taylor_adaptive<double>{{prime(x) = v, prime(v) = -x}, {1., 0.}};
+    ta.enable_checkpoints();
+    ta.propagate_until(10.);
+
+    auto ckpts = ta.get_checkpoints();
+    const auto n_tc = ckpts.get_tcs().size();
+
+    // With a zero tolerance only the (exactly) zero
+    // trailing coefficients can be dropped.
+    taylor_cheb_traj<double> ct0(ckpts, 0.);
+    REQUIRE(ct0.get_n_steps() == ckpts.get_n_steps());
+    REQUIRE(ct0.get_coeffs().size() <= n_tc);
+
+    for (auto tol : {1e-12, 1e-8, 1e-4}) {
+        taylor_cheb_traj<double> ct(ckpts, tol);
+        REQUIRE(ct.get_tol() == tol);
+        REQUIRE(ct.get_bounds() == ckpts.get_bounds());
+        REQUIRE(ct.get_coeffs().size() < n_tc);
+
+        for (auto t : {0., 1.2, 3.7, 6.1, 9.9, 10.}) {
+            const auto st = ct(t);
+            const auto ref = ckpts(t);
+
+            REQUIRE(abs(st[0] - ref[0]) <= tol * 1.01 + 1e-14);
+            REQUIRE(abs(st[1] - ref[1]) <= tol * 1.01 + 1e-14);
+            REQUIRE(abs(st[0] - cos(t)) <= tol * 1.01 + 1e-13);
+            REQUIRE(abs(st[1] + sin(t)) <= tol * 1.01 + 1e-13);
+        }
+
+        // Save/load.
+        std::stringstream ss;
+        ct.save(ss);
+        taylor_cheb_traj<double> ct2;
+        ct2.load(ss);
+        REQUIRE(ct2.get_dim() == 2u);
+        REQUIRE(ct2.get_order() == ta.get_order());
+        REQUIRE(ct2.get_coeffs() == ct.get_coeffs());
+        REQUIRE(ct2(4.2) == ct(4.2));
+    }
+
+    // The truncation is more aggressive
+    // for larger tolerances.
+    REQUIRE(taylor_cheb_traj<double>(ckpts, 1e-4).get_coeffs().size()
+            < taylor_cheb_traj<double>(ckpts, 1e-12).get_coeffs().size());
+
+    REQUIRE_THROWS_AS(taylor_cheb_traj<double>(ckpts, -1.), std::invalid_argument);
+    REQUIRE_THROWS_AS(taylor_cheb_traj<double>(2, 0, 1e-8), std::invalid_argument);
+    REQUIRE_THROWS_AS(taylor_cheb_traj<double>(ckpts, 1e-8)(10.5), std::invalid_argument);
+    REQUIRE_THROWS_AS(taylor_cheb_traj<double>(3, ta.get_order(), 1e-8).append(ckpts), std::invalid_argument);
+}
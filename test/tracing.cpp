@@ -0,0 +1,129 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <heyoka/config.hpp>
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <heyoka/expression.hpp>
+#include <heyoka/math.hpp>
+#include <heyoka/taylor.hpp>
+#include <heyoka/tracing.hpp>
+
+#include "catch.hpp"
+
+using namespace heyoka;
+
+TEST_CASE("tracing available")
+{
+#if defined(HEYOKA_WITH_TRACING)
+    REQUIRE(tracing_available());
+#else
+    REQUIRE(!tracing_available());
+#endif
+}
+
+TEST_CASE("tracing sink")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    std::mutex mutex;
+    std::vector<trace_event> events;
+
+    set_trace_sink([&](const trace_event &ev) {
+        std::lock_guard lock(mutex);
+        events.push_back(ev);
+    });
+
+    auto ta = taylor_adaptive<double>{{prime(x) = v, prime(v) = -9.8 * sin(x)}, {0.05, 0.025}};
+
+    ta.step();
+    ta.propagate_until(10.);
+    ta.propagate_for(10.);
+
+    auto tab = taylor_adaptive_batch<double>{{prime(x) = v, prime(v) = -9.8 * sin(x)}, {0.05, 0.06, 0.025, 0.026}, 2};
+
+    tab.step();
+    tab.propagate_until({10., 11.});
+
+    set_trace_sink({});
+
+    if (!tracing_available()) {
+        REQUIRE(events.empty());
+
+        return;
+    }
+
+    // Check that the begin/end events are balanced and
+    // ordered in time for each operation and object.
+    std::map<std::string, int> n_begin, n_end;
+    std::map<std::pair<std::string, const void *>, std::vector<trace_event>> open;
+
+    for (const auto &ev : events) {
+        const auto key = std::pair{std::string(ev.name), ev.object};
+
+        if (ev.phase == trace_phase::begin) {
+            ++n_begin[ev.name];
+            open[key].push_back(ev);
+        } else {
+            ++n_end[ev.name];
+            REQUIRE(!open[key].empty());
+            REQUIRE(open[key].back().timestamp <= ev.timestamp);
+            open[key].pop_back();
+        }
+    }
+
+    REQUIRE(n_begin == n_end);
+    for (const auto &p : open) {
+        REQUIRE(p.second.empty());
+    }
+
+    REQUIRE(n_begin["step"] > 2);
+    REQUIRE(n_begin["propagate_until"] == 3);
+    REQUIRE(n_begin["propagate_for"] == 1);
+    REQUIRE(n_begin["compile"] >= 2);
+
+    // No events after the removal of the sink.
+    const auto n_events = events.size();
+    ta.step();
+    REQUIRE(events.size() == n_events);
+}
+
+TEST_CASE("chrome trace sink")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    chrome_trace_sink cts;
+    REQUIRE(cts.size() == 0u);
+
+    set_trace_sink(cts);
+
+    auto ta = taylor_adaptive<double>{{prime(x) = v, prime(v) = -9.8 * sin(x)}, {0.05, 0.025}};
+    ta.propagate_until(1.);
+
+    set_trace_sink({});
+
+    const auto json = cts.to_json();
+    REQUIRE(json.find("\"traceEvents\"") != std::string::npos);
+
+    if (tracing_available()) {
+        REQUIRE(cts.size() > 0u);
+        REQUIRE(json.find("\"name\": \"propagate_until\"") != std::string::npos);
+        REQUIRE(json.find("\"ph\": \"B\"") != std::string::npos);
+        REQUIRE(json.find("\"ph\": \"E\"") != std::string::npos);
+    } else {
+        REQUIRE(cts.size() == 0u);
+    }
+
+    cts.clear();
+    REQUIRE(cts.size() == 0u);
+}
@@ -0,0 +1,80 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <cmath>
+#include <stdexcept>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include <heyoka/expression.hpp>
+#include <heyoka/func.hpp>
+#include <heyoka/math.hpp>
+#include <heyoka/taylor.hpp>
+#include <heyoka/trig_pairs.hpp>
+
+#include "catch.hpp"
+#include "test_utils.hpp"
+
+using namespace heyoka;
+using namespace heyoka_test;
+
+TEST_CASE("trig pairs pendulum")
+{
+    using Catch::Matchers::Message;
+
+    auto [x, v, y] = make_vars("x", "v", "y");
+
+    const auto orig = std::vector{prime(x) = v, prime(v) = -9.8_dbl * sin(x) + 0.1_dbl * cos(x) * v};
+    const auto sys = make_trig_pairs(orig, {x});
+
+    REQUIRE(sys.size() == 4u);
+    REQUIRE(sys[0].first == x);
+    REQUIRE(sys[0].second == v);
+    REQUIRE(sys[1].first == v);
+    REQUIRE(sys[2].first == "sin_x"_var);
+    REQUIRE(sys[2].second == "cos_x"_var * v);
+    REQUIRE(sys[3].first == "cos_x"_var);
+    REQUIRE(sys[3].second == -("sin_x"_var * v));
+
+    // No trigonometric functions left in the decomposition.
+    for (const auto &[ex, _] : taylor_decompose(sys)) {
+        if (auto fptr = std::get_if<func>(&ex.value())) {
+            REQUIRE(fptr->get_name() != "sin");
+            REQUIRE(fptr->get_name() != "cos");
+        }
+    }
+
+    const std::vector init{.5, .25};
+    const auto init_tp = make_trig_pairs_state(orig, init, {x});
+    REQUIRE(init_tp.size() == 4u);
+    REQUIRE(init_tp[2] == std::sin(.5));
+    REQUIRE(init_tp[3] == std::cos(.5));
+
+    auto ta = taylor_adaptive<double>{orig, init};
+    auto ta_tp = taylor_adaptive<double>{sys, init_tp};
+
+    ta.propagate_until(10.);
+    ta_tp.propagate_until(10.);
+
+    REQUIRE(ta_tp.get_state()[0] == approximately(ta.get_state()[0], 10000.));
+    REQUIRE(ta_tp.get_state()[1] == approximately(ta.get_state()[1], 10000.));
+    REQUIRE(ta_tp.get_state()[2] == approximately(std::sin(ta.get_state()[0]), 10000.));
+    REQUIRE(ta_tp.get_state()[3] == approximately(std::cos(ta.get_state()[0]), 10000.));
+
+    // Error checking.
+    REQUIRE_THROWS_MATCHES(make_trig_pairs(orig, {y}), std::invalid_argument,
+                           Message("The angle 'y' passed to make_trig_pairs() is not a state variable of the system"));
+    REQUIRE_THROWS_MATCHES(make_trig_pairs(orig, {x + v}), std::invalid_argument,
+                           Message("The angle '(x + v)' passed to make_trig_pairs() is not a variable"));
+    REQUIRE_THROWS_MATCHES(make_trig_pairs(orig, {x, x}), std::invalid_argument,
+                           Message("The list of angles passed to make_trig_pairs() contains duplicates"));
+    REQUIRE_THROWS_MATCHES(
+        make_trig_pairs({prime(x) = "sin_x"_var, prime(v) = sin(x)}, {x}), std::invalid_argument,
+        Message("Cannot construct the trigonometric pairs of a system containing the variable 'sin_x'"));
+}
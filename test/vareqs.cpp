@@ -0,0 +1,263 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include <heyoka/expression.hpp>
+#include <heyoka/math.hpp>
+#include <heyoka/taylor.hpp>
+#include <heyoka/vareqs.hpp>
+
+#include "catch.hpp"
+#include "test_utils.hpp"
+
+using namespace heyoka;
+using namespace heyoka_test;
+
+TEST_CASE("vareqs harmonic oscillator")
+{
+    using std::cos;
+    using std::sin;
+    using std::sqrt;
+
+    auto [x, v] = make_vars("x", "v");
+
+    // Harmonic oscillator with squared frequency par[0].
+    const auto sys = make_vareqs({prime(x) = v, prime(v) = -par[0] * x}, 1);
+
+    REQUIRE(sys.size() == 8u);
+    REQUIRE(sys[2].first == "dx/dx_0"_var);
+    REQUIRE(sys[3].first == "dx/dv_0"_var);
+    REQUIRE(sys[4].first == "dv/dx_0"_var);
+    REQUIRE(sys[5].first == "dv/dv_0"_var);
+    REQUIRE(sys[6].first == "dx/dpar[0]"_var);
+    REQUIRE(sys[7].first == "dv/dpar[0]"_var);
+
+    const auto init = make_vareqs_state(std::vector{1., .5}, 1);
+    REQUIRE(init == std::vector{1., .5, 1., 0., 0., 1., 0., 0.});
+
+    const auto k = 2.;
+    auto ta = taylor_adaptive<double>{sys, init, kw::pars = {k}};
+
+    const auto tf = 3.;
+    ta.propagate_until(tf);
+
+    const auto w = sqrt(k);
+    const auto &st = ta.get_state();
+
+    // The state transition matrix.
+    REQUIRE(st[2] == approximately(cos(w * tf), 1000.));
+    REQUIRE(st[3] == approximately(sin(w * tf) / w, 1000.));
+    REQUIRE(st[4] == approximately(-w * sin(w * tf), 1000.));
+    REQUIRE(st[5] == approximately(cos(w * tf), 1000.));
+
+    // The sensitivities with respect to par[0], from the analytical solution
+    // x(t) = x0 * cos(w * t) + v0 / w * sin(w * t), with w = sqrt(par[0]).
+    const auto x0 = 1., v0 = .5;
+    const auto dw = 1 / (2 * w);
+    const auto dx = (-x0 * tf * sin(w * tf) - v0 / (w * w) * sin(w * tf) + v0 / w * tf * cos(w * tf)) * dw;
+    const auto dv = (-x0 * sin(w * tf) - x0 * w * tf * cos(w * tf) - v0 * tf * sin(w * tf)) * dw;
+    REQUIRE(st[6] == approximately(dx, 1000.));
+    REQUIRE(st[7] == approximately(dv, 1000.));
+}
+
+TEST_CASE("vareqs shared derivatives")
+{
+    auto [x, y] = make_vars("x", "y");
+
+    // The decomposition of the augmented system should not
+    // be much larger than the decomposition of the original one
+    // times the number of variational equations.
+    const auto orig = std::vector{prime(x) = cos(x * y) + y, prime(y) = sin(x * y) - x};
+    const auto sys = make_vareqs(orig);
+    REQUIRE(sys.size() == 6u);
+
+    const auto dc_orig = taylor_decompose(orig);
+    const auto dc = taylor_decompose(sys);
+    REQUIRE(dc.size() < 6u * dc_orig.size());
+
+    // Check against the numerical integration with perturbed initial conditions.
+    auto ta = taylor_adaptive<double>{sys, make_vareqs_state(std::vector{.1, .2})};
+    ta.propagate_until(1.);
+
+    const auto eps = 1e-6;
+    auto ta_p = taylor_adaptive<double>{orig, {.1 + eps, .2}};
+    auto ta_m = taylor_adaptive<double>{orig, {.1 - eps, .2}};
+    ta_p.propagate_until(1.);
+    ta_m.propagate_until(1.);
+
+    REQUIRE(std::abs(ta.get_state()[2] - (ta_p.get_state()[0] - ta_m.get_state()[0]) / (2 * eps)) < 1e-6);
+    REQUIRE(std::abs(ta.get_state()[4] - (ta_p.get_state()[1] - ta_m.get_state()[1]) / (2 * eps)) < 1e-6);
+}
+
+TEST_CASE("vareqs loss grad batch")
+{
+    using Catch::Matchers::Message;
+    using std::cos;
+    using std::sin;
+    using std::sqrt;
+
+    auto [x, v] = make_vars("x", "v");
+
+    const auto sys = make_vareqs({prime(x) = v, prime(v) = -par[0] * x}, 1);
+
+    const auto k = 2.;
+    auto ta = taylor_adaptive_batch<double>{sys, std::vector<double>(16u), 2, kw::pars = {k, k}};
+
+    // Three trajectories, so that the second group
+    // of trajectories fills only one batch slot.
+    const std::vector<double> states{1., .5, .2, -.1, -.3, .7};
+    const auto tf = 3.;
+
+    // Loss: 1/2 * x(tf)**2.
+    auto [l, grad] = vareqs_loss_grad_batch<double>(
+        ta, 1, states, tf, [](const double *st, double *dl, std::size_t) {
+            dl[0] = st[0];
+
+            return st[0] * st[0] / 2;
+        });
+
+    REQUIRE(grad.size() == 1u);
+
+    const auto w = sqrt(k);
+    const auto dw = 1 / (2 * w);
+    auto l_ex = 0., grad_ex = 0.;
+    for (auto i = 0u; i < 3u; ++i) {
+        const auto x0 = states[2u * i], v0 = states[2u * i + 1u];
+        const auto xf = x0 * cos(w * tf) + v0 / w * sin(w * tf);
+        const auto dx = (-x0 * tf * sin(w * tf) - v0 / (w * w) * sin(w * tf) + v0 / w * tf * cos(w * tf)) * dw;
+
+        l_ex += xf * xf / 2;
+        grad_ex += xf * dx;
+    }
+
+    REQUIRE(l == approximately(l_ex, 1000.));
+    REQUIRE(grad[0] == approximately(grad_ex, 1000.));
+
+    REQUIRE_THROWS_MATCHES(
+        vareqs_loss_grad_batch<double>(ta, 2, states, tf, [](const double *, double *, std::size_t) { return 0.; }),
+        std::invalid_argument,
+        Message("The dimension of the integrator passed to vareqs_loss_grad_batch() (8) is not compatible with a "
+                "system of variational equations with 2 parameter(s)"));
+    REQUIRE_THROWS_MATCHES(
+        vareqs_loss_grad_batch<double>(ta, 1, {1.}, tf, [](const double *, double *, std::size_t) { return 0.; }),
+        std::invalid_argument,
+        Message("The size of the initial states passed to vareqs_loss_grad_batch() (1) is not a nonzero multiple of "
+                "the dimension of the system (2)"));
+}
+
+TEST_CASE("vareqs errors")
+{
+    using Catch::Matchers::Message;
+
+    auto [x, v] = make_vars("x", "v");
+
+    REQUIRE_THROWS_MATCHES(make_vareqs({}), std::invalid_argument,
+                           Message("Cannot construct the variational equations of an empty system"));
+    REQUIRE_THROWS_MATCHES(make_vareqs({std::pair{x + v, v}}), std::invalid_argument,
+                           Message("Invalid system passed to make_vareqs(): the left-hand side '(x + v)' is not a "
+                                   "variable"));
+    REQUIRE_THROWS_MATCHES(make_vareqs({prime(x) = "dx/dx_0"_var}), std::invalid_argument,
+                           Message("Cannot construct the variational equations of a system containing the variable "
+                                   "'dx/dx_0'"));
+}
+
+TEST_CASE("vareqs ho indices")
+{
+    using idx_t = std::vector<std::vector<std::uint32_t>>;
+
+    REQUIRE(vareqs_ho_indices(2, 2) == idx_t{{0, 0}, {1, 0}, {0, 1}, {2, 0}, {1, 1}, {0, 2}});
+    REQUIRE(vareqs_ho_indices(1, 3) == idx_t{{0}, {1}, {2}, {3}});
+    REQUIRE(vareqs_ho_indices(3, 0) == idx_t{{0, 0, 0}});
+    REQUIRE(vareqs_ho_indices(3, 3).size() == 20u);
+}
+
+TEST_CASE("vareqs ho")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    {
+        // x' = -x**2, with solution x(t) = x0 / (1 + x0 * t).
+        const auto sys = make_vareqs_ho({prime(x) = -x * x}, 3);
+        REQUIRE(sys.size() == 4u);
+        REQUIRE(sys[1].first == "dx/dx_0"_var);
+        REQUIRE(sys[2].first == "dx/dx_0^2"_var);
+        REQUIRE(sys[3].first == "dx/dx_0^3"_var);
+
+        const auto init = make_vareqs_ho_state(std::vector{1.}, 3);
+        REQUIRE(init == std::vector{1., 1., 0., 0.});
+
+        auto ta = taylor_adaptive<double>{sys, init};
+        ta.propagate_until(1.);
+
+        const auto &st = ta.get_state();
+        REQUIRE(st[0] == approximately(.5, 1000.));
+        REQUIRE(st[1] == approximately(.25, 1000.));
+        REQUIRE(st[2] == approximately(-.25, 1000.));
+        REQUIRE(st[3] == approximately(6. / 16, 1000.));
+
+        // The polynomial map approximates the solution with
+        // perturbed initial conditions to fourth order.
+        const auto res = eval_vareqs_ho(st.data(), 1, 3, std::vector{.01});
+        REQUIRE(std::abs(res[0] - 1.01 / 2.01) < 1e-8);
+    }
+
+    {
+        // Pendulum: the first-order derivatives match make_vareqs(), and the map
+        // matches the integration with perturbed initial conditions.
+        const auto orig = std::vector{prime(x) = v, prime(v) = -9.8 * sin(x)};
+        const auto sys = make_vareqs_ho(orig, 4);
+        REQUIRE(sys.size() == 30u);
+        REQUIRE(sys[7].first == "dv/dx_0^2"_var);
+        REQUIRE(sys[8].first == "dx/dx_0dv_0"_var);
+
+        auto ta = taylor_adaptive<double>{sys, make_vareqs_ho_state(std::vector{.5, .1}, 4), kw::compact_mode = true};
+        ta.propagate_until(1.);
+
+        auto ta1 = taylor_adaptive<double>{make_vareqs(orig), make_vareqs_state(std::vector{.5, .1})};
+        ta1.propagate_until(1.);
+
+        const auto &st = ta.get_state(), &st1 = ta1.get_state();
+        REQUIRE(st[2] == approximately(st1[2], 1000.));
+        REQUIRE(st[3] == approximately(st1[4], 1000.));
+        REQUIRE(st[4] == approximately(st1[3], 1000.));
+        REQUIRE(st[5] == approximately(st1[5], 1000.));
+
+        const auto dx = std::vector{2e-3, -4e-3};
+        auto ta_p = taylor_adaptive<double>{orig, {.5 + dx[0], .1 + dx[1]}};
+        ta_p.propagate_until(1.);
+
+        const auto res = eval_vareqs_ho(st.data(), 2, 4, dx);
+        REQUIRE(std::abs(res[0] - ta_p.get_state()[0]) < 1e-9);
+        REQUIRE(std::abs(res[1] - ta_p.get_state()[1]) < 1e-9);
+    }
+}
+
+TEST_CASE("vareqs ho errors")
+{
+    using Catch::Matchers::Message;
+
+    auto [x, v] = make_vars("x", "v");
+
+    REQUIRE_THROWS_MATCHES(make_vareqs_ho({}, 2), std::invalid_argument,
+                           Message("Cannot construct the high-order variational equations of an empty system"));
+    REQUIRE_THROWS_MATCHES(make_vareqs_ho({std::pair{x + v, v}}, 2), std::invalid_argument,
+                           Message("Invalid system passed to make_vareqs_ho(): the left-hand side '(x + v)' is not a "
+                                   "variable"));
+    REQUIRE_THROWS_MATCHES(make_vareqs_ho({prime(x) = "dx/dx_0^2"_var}, 2), std::invalid_argument,
+                           Message("Cannot construct the high-order variational equations of a system containing the "
+                                   "variable 'dx/dx_0^2'"));
+
+    const std::vector<double> st(3);
+    REQUIRE_THROWS_AS(eval_vareqs_ho(st.data(), 1, 2, std::vector{1., 2.}), std::invalid_argument);
+}
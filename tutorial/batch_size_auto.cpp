@@ -0,0 +1,37 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <iostream>
+#include <vector>
+
+#include <heyoka/heyoka.hpp>
+
+using namespace heyoka;
+
+int main()
+{
+    // Create an nbody system with 3 particles.
+    auto sys = make_nbody_sys(3);
+
+    // Initial state vector (6 values per body)
+    // for a single integration.
+    auto sv = std::vector<double>{1, 0, 0, 0, 1, 0, -1, 0, 0, 0, -1, 0, 0, 0, 0, 0, 0, 0};
+
+    // Measure the step throughput of the system for
+    // batch sizes up to 8, and print the results.
+    auto bt = taylor_tune_batch_size<double>(sys, sv, kw::max_batch_size = 8u);
+
+    std::cout << bt << '\n';
+
+    // Construct a batch integrator with the automatically-selected
+    // batch size. The initial state is replicated over
+    // the lanes of the batch.
+    auto ta = taylor_adaptive_batch<double>{sys, sv, batch_size_auto, kw::max_batch_size = 8u};
+
+    std::cout << "Selected batch size: " << ta.get_batch_size() << '\n';
+}